@@ -15,18 +15,56 @@
 
 #include <core/FileInfo.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 #include <core/FilePath.hpp>
 
 namespace rstudio {
 namespace core {
 
+namespace {
+
+// compare the concatenation of two strings with that of two others (as
+// strcmp would compare the concatenated strings)
+int compareJoined(const std::string& a1, const std::string& a2,
+                  const std::string& b1, const std::string& b2)
+{
+   std::size_t aSize = a1.size() + a2.size();
+   std::size_t bSize = b1.size() + b2.size();
+   std::size_t size = std::min(aSize, bSize);
+
+   // compare the runs of characters which are contiguous in both
+   std::size_t i = 0;
+   while (i < size)
+   {
+      const char* pA = i < a1.size() ? a1.data() + i : a2.data() + (i - a1.size());
+      std::size_t aRun = i < a1.size() ? a1.size() - i : aSize - i;
+      const char* pB = i < b1.size() ? b1.data() + i : b2.data() + (i - b1.size());
+      std::size_t bRun = i < b1.size() ? b1.size() - i : bSize - i;
+
+      std::size_t run = std::min(std::min(aRun, bRun), size - i);
+      int result = std::memcmp(pA, pB, run);
+      if (result != 0)
+         return result;
+
+      i += run;
+   }
+
+   if (aSize == bSize)
+      return 0;
+   return aSize < bSize ? -1 : 1;
+}
+
+} // anonymous namespace
+
 FileInfo::FileInfo(const FilePath& filePath, bool isSymlink)
-   :  absolutePath_(filePath.absolutePath()),
-      isDirectory_(filePath.isDirectory()),
-      size_(0),
+   :  size_(0),
       lastWriteTime_(0),
+      isDirectory_(filePath.isDirectory()),
       isSymlink_(isSymlink)
 {
+   setPath(filePath.absolutePath());
    if (!isDirectory_ && filePath.exists())
    {
       size_ = filePath.size();
@@ -37,12 +75,12 @@ FileInfo::FileInfo(const FilePath& filePath, bool isSymlink)
 FileInfo::FileInfo(const std::string& absolutePath,
                    bool isDirectory,
                    bool isSymlink)
- :    absolutePath_(absolutePath),
-      isDirectory_(isDirectory),
-      size_(0),
+ :    size_(0),
       lastWriteTime_(0),
+      isDirectory_(isDirectory),
       isSymlink_(isSymlink)
 {
+   setPath(absolutePath);
 }
    
 FileInfo::FileInfo(const std::string& absolutePath,
@@ -50,12 +88,36 @@ FileInfo::FileInfo(const std::string& absolutePath,
                    uintmax_t size,
                    std::time_t lastWriteTime,
                    bool isSymlink)
-   :  absolutePath_(absolutePath),
-      isDirectory_(isDirectory),
-      size_(size),
+   :  size_(size),
       lastWriteTime_(lastWriteTime),
+      isDirectory_(isDirectory),
       isSymlink_(isSymlink)
 {
+   setPath(absolutePath);
+}
+
+void FileInfo::setPath(const std::string& absolutePath)
+{
+   std::string::size_type pos = absolutePath.find_last_of('/');
+   if (pos == std::string::npos)
+   {
+      name_ = absolutePath;
+   }
+   else
+   {
+      directory_ = InternedString(absolutePath.substr(0, pos + 1));
+      name_ = absolutePath.substr(pos + 1);
+   }
+}
+
+int FileInfo::comparePath(const FileInfo& other) const
+{
+   // siblings share their directory
+   if (directory_ == other.directory_)
+      return ::strcmp(name_.c_str(), other.name_.c_str());
+
+   return compareJoined(directory_.str(), name_,
+                        other.directory_.str(), other.name_);
 }
    
 std::ostream& operator << (std::ostream& stream, const FileInfo& fileInfo)
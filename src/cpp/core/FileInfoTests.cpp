@@ -0,0 +1,105 @@
+/*
+ * FileInfoTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/FileInfo.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <core/collection/Tree.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+namespace {
+
+int sign(int value)
+{
+   return value < 0 ? -1 : (value > 0 ? 1 : 0);
+}
+
+} // anonymous namespace
+
+context("FileInfo")
+{
+   test_that("Paths are preserved")
+   {
+      const char* paths[] = { "/", "/a", "/a/b.R", "/a/b/", "a", "C:/a/b", "" };
+      for (std::size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+      {
+         FileInfo fileInfo(paths[i], false);
+         expect_true(fileInfo.absolutePath() == paths[i]);
+      }
+
+      expect_true(FileInfo().empty());
+      expect_false(FileInfo("/", true).empty());
+   }
+
+   test_that("Paths are compared as strcmp would compare them")
+   {
+      const char* paths[] = {
+         "/a", "/a/b", "/a/b/c", "/a/bc", "/a/b-c", "/a.R", "/ab/c",
+         "/a/\xc3\xa9", "/b", ""
+      };
+
+      std::size_t count = sizeof(paths) / sizeof(paths[0]);
+      for (std::size_t i = 0; i < count; i++)
+      {
+         for (std::size_t j = 0; j < count; j++)
+         {
+            FileInfo a(paths[i], false);
+            FileInfo b(paths[j], false);
+            expect_true(sign(a.comparePath(b)) ==
+                        sign(::strcmp(paths[i], paths[j])));
+         }
+      }
+   }
+
+   test_that("Equal paths compare equal")
+   {
+      expect_true(FileInfo("/a/b", false, 10, 20) ==
+                  FileInfo(std::string("/a/") + "b", false, 10, 20));
+      expect_false(FileInfo("/a/b", false, 10, 20) ==
+                   FileInfo("/a/c", false, 10, 20));
+      expect_false(FileInfo("/a/b", false, 10, 20) ==
+                   FileInfo("/b/b", false, 10, 20));
+      expect_false(FileInfo("/a/b", false, 10, 20) ==
+                   FileInfo("/a/b", false, 11, 20));
+   }
+
+   test_that("Trees of files can be built and copied")
+   {
+      tree<FileInfo> fileTree;
+      tree<FileInfo>::iterator root = fileTree.set_head(FileInfo("/a", true));
+      for (int i = 0; i < 1000; i++)
+      {
+         std::string name = std::string(1, 'a' + i % 26) + "/";
+         fileTree.append_child(root, FileInfo("/a/" + name, true));
+      }
+
+      tree<FileInfo> copy = fileTree;
+      fileTree.clear();
+      expect_true(copy.size() == 1001);
+      expect_true(copy.begin()->absolutePath() == "/a");
+   }
+}
+
+} // namespace tests
+} // namespace core
+} // namespace rstudio
@@ -21,6 +21,8 @@
 
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Settings.hpp>
 
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
@@ -191,24 +193,98 @@ TEST_CASE("File Locking")
       {
          AdvisoryFileLock transientLock;
          error = transientLock.acquire(s_lockFilePath);
-         CHECK(error == Success());
+         if (AdvisoryFileLock::isOfdLockingAvailable())
+         {
+            // OFD locks conflict with other locks in the same process
+            CHECK_FALSE(error == Success());
+         }
+         else
+         {
+            CHECK(error == Success());
+         }
          forkAndCheckLock();
       }
       
-      // TODO: this fails (the destructor above kills lock)
-      // forkAndCheckLock();
+      // TODO: with POSIX record locks this fails (the destructor above
+      // kills lock)
+      if (AdvisoryFileLock::isOfdLockingAvailable())
+         forkAndCheckLock();
       
       // ensure lock acquired
       error = lock.acquire(s_lockFilePath);
       CHECK(error == Success());
       
-      // TODO: checking if a file is locked from same process will release lock
-      // lock.isLocked(s_lockFilePath);
-      // forkAndCheckLock();
+      // TODO: with POSIX record locks checking if a file is locked from
+      // same process will release lock
+      if (AdvisoryFileLock::isOfdLockingAvailable())
+      {
+         CHECK(lock.isLocked(s_lockFilePath));
+         forkAndCheckLock();
+      }
 
       // clean up lockfile
       s_lockFilePath.removeIfExists();
    }
+
+   SECTION("link-based locks use advisory locks on local filesystems when enabled")
+   {
+      FilePath confPath("/tmp/rstudio-test-file-locks");
+      Error error = core::writeStringToFile(confPath, "local-advisory-locks=1\n");
+      CHECK(error == Success());
+      FileLock::initialize(confPath);
+      CHECK(FileLock::isLocalAdvisoryLockingEnabled());
+
+      if (AdvisoryFileLock::isOfdLockingAvailable())
+      {
+         LinkBasedFileLock lock1;
+         LinkBasedFileLock lock2;
+
+         error = lock1.acquire(s_lockFilePath);
+         CHECK(error == Success());
+         CHECK(lock2.isLocked(s_lockFilePath));
+
+         error = lock2.acquire(s_lockFilePath);
+         CHECK_FALSE(error == Success());
+
+         error = lock1.release();
+         CHECK(error == Success());
+
+         error = lock2.acquire(s_lockFilePath);
+         CHECK(error == Success());
+
+         error = lock2.release();
+         CHECK(error == Success());
+      }
+
+      // restore defaults
+      FileLock::initialize(Settings());
+      confPath.removeIfExists();
+      s_lockFilePath.removeIfExists();
+   }
+
+   SECTION("lock acquisition timings are collected")
+   {
+      FileLock::collectAcquisitionStats();
+
+      LinkBasedFileLock lock1;
+      LinkBasedFileLock lock2;
+      CHECK(lock1.acquire(s_lockFilePath) == Success());
+      CHECK_FALSE(lock2.acquire(s_lockFilePath) == Success());
+
+      FileLock::AcquisitionStats stats = FileLock::collectAcquisitionStats();
+      CHECK(stats.acquired == 1);
+      CHECK(stats.failed == 1);
+      CHECK(stats.maxMs >= 0);
+      CHECK(stats.totalMs >= stats.maxMs);
+
+      // collecting resets the stats
+      stats = FileLock::collectAcquisitionStats();
+      CHECK(stats.acquired == 0);
+      CHECK(stats.failed == 0);
+
+      lock1.release();
+      s_lockFilePath.removeIfExists();
+   }
 }
 
 } // end namespace tests
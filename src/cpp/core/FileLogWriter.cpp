@@ -15,19 +15,156 @@
 
 #include <core/FileLogWriter.hpp>
 
+#include <atomic>
+#include <cstdlib>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread.hpp>
+
 #include <core/FileInfo.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/system/System.hpp>
 #include <core/Thread.hpp>
 
 namespace rstudio {
 namespace core {
 
+namespace {
+
+#define LOGMAX (2048*1024)  // rotate/remove every 2 megabytes
+
+// the most entries which can be waiting to be written (a power of 2)
+const std::size_t kQueueCapacity = 4096;
+
+// queued entries are written at least this often
+const int kWriteIntervalMs = 100;
+
+// bounded queue of log entries which many threads can add to without
+// blocking one another (a single consumer removes them)
+class EntryQueue : boost::noncopyable
+{
+public:
+   explicit EntryQueue(std::size_t capacity)
+      : slots_(new Slot[capacity]), mask_(capacity - 1), enqueuePos_(0),
+        dequeuePos_(0)
+   {
+      for (std::size_t i = 0; i < capacity; i++)
+         slots_[i].sequence.store(i, std::memory_order_relaxed);
+   }
+
+   // returns false (leaving the entry alone) if the queue is full
+   bool enqueue(std::string* pEntry)
+   {
+      Slot* pSlot;
+      std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+      for (;;)
+      {
+         pSlot = &slots_[pos & mask_];
+         std::size_t sequence = pSlot->sequence.load(std::memory_order_acquire);
+         std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence - pos);
+         if (diff == 0)
+         {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed))
+               break;
+         }
+         else if (diff < 0)
+         {
+            return false;
+         }
+         else
+         {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+         }
+      }
+
+      pSlot->entry.swap(*pEntry);
+      pSlot->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+   }
+
+   // only one thread may dequeue at a time
+   bool dequeue(std::string* pEntry)
+   {
+      Slot* pSlot = &slots_[dequeuePos_ & mask_];
+      std::size_t sequence = pSlot->sequence.load(std::memory_order_acquire);
+      if (static_cast<std::ptrdiff_t>(sequence - (dequeuePos_ + 1)) < 0)
+         return false;
+
+      pEntry->swap(pSlot->entry);
+      pSlot->entry.clear();
+      pSlot->sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+      dequeuePos_++;
+      return true;
+   }
+
+   // approximate number of entries queued
+   std::size_t size() const
+   {
+      return enqueuePos_.load(std::memory_order_relaxed) - dequeuePos_;
+   }
+
+private:
+   struct Slot
+   {
+      std::atomic<std::size_t> sequence;
+      std::string entry;
+   };
+
+   boost::scoped_array<Slot> slots_;
+   const std::size_t mask_;
+   std::atomic<std::size_t> enqueuePos_;
+   std::size_t dequeuePos_;
+};
+
+// queued entries of the current writer are written when the process exits
+FileLogWriter* s_pExitWriter = NULL;
+
+void flushOnExit()
+{
+   if (s_pExitWriter)
+      s_pExitWriter->flush();
+}
+
+} // anonymous namespace
+
+struct FileLogWriter::Impl
+{
+   Impl()
+      : queue(kQueueCapacity), dropped(0), started(false),
+        threadRunning(true), stopping(false),
+        pid(core::system::currentProcessId())
+   {
+   }
+
+   EntryQueue queue;
+   std::atomic<std::size_t> dropped;
+
+   std::atomic<bool> started;
+   std::atomic<bool> threadRunning;
+   boost::mutex startMutex;
+   boost::thread thread;
+
+   // wakes the writer thread
+   boost::mutex wakeMutex;
+   boost::condition_variable wakeCondition;
+   bool stopping;
+
+   // held while dequeuing and writing
+   boost::mutex writeMutex;
+
+   // the process we were created in (forked children write directly)
+   PidType pid;
+};
+
 FileLogWriter::FileLogWriter(const std::string& programIdentity,
                              int logLevel,
                              const FilePath& logDir)
                                 : programIdentity_(programIdentity),
-                                  logLevel_(logLevel)
+                                  logLevel_(logLevel),
+                                  pImpl_(new Impl())
 {
    logDir.ensureDirectory();
 
@@ -39,13 +176,35 @@ FileLogWriter::FileLogWriter(const std::string& programIdentity,
       // swallow errors -- we can't log so it doesn't matter
       core::appendToFile(logFile_, "");
    }
+
+   static bool s_exitHandlerRegistered = false;
+   if (!s_exitHandlerRegistered)
+   {
+      s_exitHandlerRegistered = true;
+      std::atexit(flushOnExit);
+   }
+   s_pExitWriter = this;
 }
 
 FileLogWriter::~FileLogWriter()
 {
    try
    {
-      // we don't keep a file handle open so do nothing here
+      if (s_pExitWriter == this)
+         s_pExitWriter = NULL;
+
+      if (pImpl_->thread.joinable())
+      {
+         LOCK_MUTEX(pImpl_->wakeMutex)
+         {
+            pImpl_->stopping = true;
+         }
+         END_LOCK_MUTEX
+         pImpl_->wakeCondition.notify_all();
+         pImpl_->thread.join();
+      }
+
+      flush();
    }
    catch(...)
    {
@@ -65,19 +224,133 @@ void FileLogWriter::log(const std::string& programIdentity,
    if (logLevel > logLevel_)
       return;
 
-   LOCK_MUTEX(mutex_)
+   std::string entry = formatLogEntry(programIdentity, message);
+
+   // forked children don't have our writer thread (and may have inherited
+   // our locks in any state) so write directly
+   if (core::system::currentProcessId() != pImpl_->pid)
    {
       rotateLogFile();
 
       // Swallow errors--we can't do anything anyway
-      core::appendToFile(logFile_, formatLogEntry(programIdentity, message));
+      core::appendToFile(logFile_, entry);
+      return;
+   }
+
+   startWriterThread();
+
+   if (!pImpl_->queue.enqueue(&entry))
+   {
+      // errors are never dropped; write them after whatever is queued
+      if (logLevel == core::system::kLogLevelError)
+      {
+         flush();
+         LOCK_MUTEX(pImpl_->writeMutex)
+         {
+            writeEntries(entry);
+         }
+         END_LOCK_MUTEX
+         return;
+      }
+
+      pImpl_->dropped++;
+   }
+
+   // make sure errors are written before we return (in case we're about
+   // to exit or crash) and wake the writer early if the queue is filling up
+   if (logLevel == core::system::kLogLevelError || !pImpl_->threadRunning)
+      flush();
+   else if (pImpl_->queue.size() > kQueueCapacity / 2)
+      pImpl_->wakeCondition.notify_one();
+}
+
+void FileLogWriter::flush()
+{
+   LOCK_MUTEX(pImpl_->writeMutex)
+   {
+      std::string entries, entry;
+      while (pImpl_->queue.dequeue(&entry))
+         entries.append(entry);
+
+      std::size_t dropped = pImpl_->dropped.exchange(0);
+      if (dropped > 0)
+      {
+         entries.append(formatLogEntry(
+               programIdentity_,
+               "[" + safe_convert::numberToString(dropped) +
+               " log entries dropped]"));
+      }
+
+      writeEntries(entries);
    }
    END_LOCK_MUTEX
 }
 
+void FileLogWriter::startWriterThread()
+{
+   if (pImpl_->started.load(std::memory_order_acquire))
+      return;
 
+   LOCK_MUTEX(pImpl_->startMutex)
+   {
+      if (pImpl_->started.load())
+         return;
+
+      // mark as started first (launching the thread may itself log)
+      pImpl_->started.store(true, std::memory_order_release);
+   }
+   END_LOCK_MUTEX
+
+   core::thread::safeLaunchThread(
+         boost::bind(&FileLogWriter::writerThreadMain, this),
+         &pImpl_->thread);
+
+   // without a writer thread entries are written as they're logged
+   pImpl_->threadRunning.store(pImpl_->thread.joinable());
+}
+
+void FileLogWriter::writerThreadMain()
+{
+   try
+   {
+      bool stopping = false;
+      while (!stopping)
+      {
+         boost::unique_lock<boost::mutex> lock(pImpl_->wakeMutex);
+         if (!pImpl_->stopping)
+         {
+            pImpl_->wakeCondition.timed_wait(
+                  lock, boost::posix_time::milliseconds(kWriteIntervalMs));
+         }
+         stopping = pImpl_->stopping;
+         lock.unlock();
+
+         flush();
+      }
+   }
+   catch(const boost::thread_interrupted&)
+   {
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
+void FileLogWriter::writeEntries(const std::string& entries)
+{
+   // NOTE: called with the write mutex held
+
+   if (entries.empty())
+      return;
+
+   // the file is opened for each batch rather than kept open, so that other
+   // processes logging to it can open it too (on Windows opening it for
+   // writing is exclusive) and so that we follow the file if another process
+   // rotates it
+   rotateLogFile();
+
+   // swallow errors--we can't do anything anyway
+   core::appendToFile(logFile_, entries);
+}
 
-#define LOGMAX (2048*1024)  // rotate/remove every 2 megabytes
 bool FileLogWriter::rotateLogFile()
 {
    if (logFile_.exists() && logFile_.size() > LOGMAX)
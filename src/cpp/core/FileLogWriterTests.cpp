@@ -0,0 +1,128 @@
+/*
+ * FileLogWriterTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/FileLogWriter.hpp>
+
+#include <algorithm>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/system/System.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+namespace {
+
+FilePath logDir()
+{
+   FilePath dir;
+   REQUIRE_FALSE(FilePath::tempFilePath(&dir));
+   REQUIRE_FALSE(dir.ensureDirectory());
+   return dir;
+}
+
+std::string readLog(const FilePath& file)
+{
+   std::string contents;
+   readStringFromFile(file, &contents);
+   return contents;
+}
+
+std::size_t countLines(const FilePath& file)
+{
+   std::string contents = readLog(file);
+   return std::count(contents.begin(), contents.end(), '\n');
+}
+
+void logMessages(FileLogWriter* pWriter, int count)
+{
+   for (int i = 0; i < count; i++)
+      pWriter->log(core::system::kLogLevelWarning, "message");
+}
+
+} // anonymous namespace
+
+context("FileLogWriterTests")
+{
+   test_that("Queued entries are written when flushed")
+   {
+      FilePath dir = logDir();
+      FileLogWriter writer("test", core::system::kLogLevelDebug, dir);
+      logMessages(&writer, 10);
+      writer.flush();
+
+      expect_true(countLines(dir.childPath("test.log")) == 10);
+   }
+
+   test_that("Errors are written immediately")
+   {
+      FilePath dir = logDir();
+      FileLogWriter writer("test", core::system::kLogLevelDebug, dir);
+      writer.log(core::system::kLogLevelError, "error");
+
+      expect_true(countLines(dir.childPath("test.log")) == 1);
+   }
+
+   test_that("Entries from many threads are all written or counted")
+   {
+      FilePath dir = logDir();
+      {
+         FileLogWriter writer("test", core::system::kLogLevelDebug, dir);
+         boost::thread_group threads;
+         for (int i = 0; i < 4; i++)
+            threads.create_thread(boost::bind(logMessages, &writer, 5000));
+         threads.join_all();
+      }
+
+      // any entries which were dropped are summarized in a single entry
+      std::size_t lines = countLines(dir.childPath("test.log"));
+      expect_true(lines > 0);
+      if (lines != 20000)
+      {
+         expect_true(readLog(dir.childPath("test.log")).find(
+                        "log entries dropped]") != std::string::npos);
+      }
+   }
+
+   test_that("The log is rotated once it is large enough")
+   {
+      FilePath dir = logDir();
+      {
+         FileLogWriter writer("test", core::system::kLogLevelDebug, dir);
+         std::string message(1024, 'x');
+         for (int i = 0; i < 3000; i++)
+         {
+            writer.log(core::system::kLogLevelWarning, message);
+            if (i % 100 == 0)
+               writer.flush();
+         }
+      }
+
+      expect_true(dir.childPath("test.rotated.log").exists());
+      expect_true(dir.childPath("test.log").size() < 2048 * 1024);
+   }
+}
+
+} // namespace tests
+} // namespace core
+} // namespace rstudio
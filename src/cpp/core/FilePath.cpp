@@ -16,6 +16,7 @@
 #include <core/FilePath.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <fstream>
 
 #ifdef _WIN32
@@ -141,6 +142,24 @@ bool addItemSize(const FilePath& item, boost::shared_ptr<uintmax_t> pTotal)
    return true;
 }
 
+// counts of filesystem operations, by kind (see collectOperationStats); on
+// network filesystems each is a round trip to the server
+enum Operation
+{
+   kOperationQuery,
+   kOperationListing,
+   kOperationOpen,
+   kOperationChange,
+   kOperationKinds
+};
+
+std::atomic<std::size_t> s_operationCounts[kOperationKinds];
+
+void countOperation(Operation operation)
+{
+   s_operationCounts[operation].fetch_add(1, std::memory_order_relaxed);
+}
+
 }
 
 struct FilePath::Impl
@@ -237,6 +256,8 @@ FilePath FilePath::resolveAliasedPath(const std::string& aliasedPath,
 
 bool FilePath::exists(const std::string& path)
 {
+   countOperation(kOperationQuery);
+
    if (path.empty())
       return false;
 
@@ -287,6 +308,16 @@ Error FilePath::tempFilePath(FilePath* pFilePath)
    return pathNotFoundError(ERROR_LOCATION);
 }
 
+FilePath::OperationStats FilePath::collectOperationStats()
+{
+   OperationStats stats;
+   stats.queries = s_operationCounts[kOperationQuery].exchange(0);
+   stats.listings = s_operationCounts[kOperationListing].exchange(0);
+   stats.opens = s_operationCounts[kOperationOpen].exchange(0);
+   stats.changes = s_operationCounts[kOperationChange].exchange(0);
+   return stats;
+}
+
 FilePath::FilePath()
    : pImpl_(new Impl())
 {
@@ -316,6 +347,8 @@ bool FilePath::empty() const
 
 bool FilePath::exists() const
 {
+   countOperation(kOperationQuery);
+
     try
     {
        return !empty() && boost::filesystem::exists(pImpl_->path) ;
@@ -330,6 +363,8 @@ bool FilePath::exists() const
 
 bool FilePath::isSymlink() const
 {
+   countOperation(kOperationQuery);
+
    try
    {
       return exists() && boost::filesystem::is_symlink(pImpl_->path);
@@ -359,6 +394,8 @@ FilePath FilePath::resolveSymlink() const
 
 uintmax_t FilePath::size() const
 {
+   countOperation(kOperationQuery);
+
    try
    {
       if (!exists() || !boost::filesystem::is_regular_file(pImpl_->path))
@@ -377,6 +414,24 @@ uintmax_t FilePath::size() const
    }
 }
 
+uintmax_t FilePath::hardLinkCount() const
+{
+   countOperation(kOperationQuery);
+
+   try
+   {
+      if (!exists() || !boost::filesystem::is_regular_file(pImpl_->path))
+         return 0;
+      else
+         return boost::filesystem::hard_link_count(pImpl_->path) ;
+   }
+   catch(const boost::filesystem::filesystem_error& e)
+   {
+      logError(pImpl_->path, e, ERROR_LOCATION) ;
+      return 0;
+   }
+}
+
 std::string FilePath::filename() const
 {
    return BOOST_FS_STRING(pImpl_->path.filename()) ;
@@ -573,6 +628,8 @@ bool FilePath::hasTextMimeType() const
 
 void FilePath::setLastWriteTime(std::time_t time) const
 {
+   countOperation(kOperationChange);
+
    try
    {
       if (!exists())
@@ -589,6 +646,8 @@ void FilePath::setLastWriteTime(std::time_t time) const
 
 std::time_t FilePath::lastWriteTime() const
 {
+   countOperation(kOperationQuery);
+
    try
    {
       if (!exists())
@@ -659,6 +718,8 @@ std::wstring FilePath::absolutePathW() const
 
 Error FilePath::remove() const
 {
+   countOperation(kOperationChange);
+
    try
    {
       if (isDirectory())
@@ -685,6 +746,8 @@ Error FilePath::removeIfExists() const
 
 Error FilePath::move(const FilePath& targetPath, MoveType type) const
 {
+   countOperation(kOperationChange);
+
    try
    {
       boost::filesystem::rename(pImpl_->path, targetPath.pImpl_->path) ;
@@ -730,6 +793,8 @@ Error FilePath::moveIndirect(const FilePath& targetPath) const
 
 Error FilePath::copy(const FilePath& targetPath) const
 {
+   countOperation(kOperationChange);
+
    try
    {
       boost::filesystem::copy_file(pImpl_->path, targetPath.pImpl_->path) ;
@@ -744,6 +809,25 @@ Error FilePath::copy(const FilePath& targetPath) const
    }
 }
 
+Error FilePath::link(const FilePath& targetPath) const
+{
+   countOperation(kOperationChange);
+
+   try
+   {
+      boost::filesystem::create_hard_link(pImpl_->path,
+                                          targetPath.pImpl_->path) ;
+      return Success() ;
+   }
+   catch(const boost::filesystem::filesystem_error& e)
+   {
+      Error error(e.code(), ERROR_LOCATION) ;
+      addErrorProperties(pImpl_->path, &error) ;
+      error.addProperty("target-path", targetPath.absolutePath()) ;
+      return error ;
+   }
+}
+
 
 
 bool FilePath::isHidden() const
@@ -779,6 +863,8 @@ bool FilePath::isJunction() const
 
 bool FilePath::isDirectory() const
 {
+   countOperation(kOperationQuery);
+
    try
    {
       if (!exists())
@@ -811,6 +897,8 @@ Error FilePath::ensureDirectory() const
 
 Error FilePath::createDirectory(const std::string& name) const
 {
+   countOperation(kOperationChange);
+
    try
    {
       path_t targetDirectory ;
@@ -974,6 +1062,8 @@ Error notFoundError(const FilePath& filePath,
 
 Error FilePath::children(std::vector<FilePath>* pFilePaths) const
 {
+   countOperation(kOperationListing);
+
    if (!exists())
       return notFoundError(*this, ERROR_LOCATION);
 
@@ -1004,6 +1094,9 @@ Error FilePath::childrenRecursive(
    if (!exists())
       return notFoundError(*this, ERROR_LOCATION);
 
+   // (counted once, though each directory of the tree is listed)
+   countOperation(kOperationListing);
+
    try
    {
       recursive_dir_iterator end ;
@@ -1055,6 +1148,8 @@ Error FilePath::makeCurrentPath(bool autoCreate) const
 
 Error FilePath::open_r(boost::shared_ptr<std::istream>* pStream) const
 {
+   countOperation(kOperationOpen);
+
    try
    {
       std::istream* pResult = NULL;
@@ -1107,6 +1202,8 @@ Error FilePath::open_r(boost::shared_ptr<std::istream>* pStream) const
 
 Error FilePath::open_w(boost::shared_ptr<std::ostream>* pStream, bool truncate) const
 {
+   countOperation(kOperationOpen);
+
    try
    {
       std::ostream* pResult = NULL;
@@ -0,0 +1,110 @@
+/*
+ * FilePathBenchmarks.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/FilePath.hpp>
+
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+
+#include <tests/Benchmark.hpp>
+
+namespace rstudio {
+namespace core {
+
+namespace {
+
+// a scratch directory of a few directories of files (removed at exit)
+class ScratchTree
+{
+public:
+   ScratchTree()
+   {
+      Error error = FilePath::tempFilePath(&root_);
+      if (!error)
+         error = root_.ensureDirectory();
+      for (int dir = 0; dir < 10 && !error; dir++)
+      {
+         FilePath dirPath =
+               root_.complete("dir" + boost::lexical_cast<std::string>(dir));
+         error = dirPath.ensureDirectory();
+         for (int file = 0; file < 100 && !error; file++)
+         {
+            FilePath filePath = dirPath.complete(
+                     "file" + boost::lexical_cast<std::string>(file) + ".R");
+            error = filePath.ensureFile();
+         }
+      }
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   ~ScratchTree()
+   {
+      Error error = root_.removeIfExists();
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   const FilePath& root() const { return root_; }
+
+private:
+   FilePath root_;
+};
+
+const ScratchTree& scratchTree()
+{
+   static ScratchTree tree;
+   return tree;
+}
+
+bool countEntry(int, const FilePath&, std::size_t* pCount)
+{
+   (*pCount)++;
+   return true;
+}
+
+} // anonymous namespace
+
+BENCHMARK(FilePath, children)
+{
+   FilePath dirPath = scratchTree().root().complete("dir0");
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      std::vector<FilePath> children;
+      Error error = dirPath.children(&children);
+      tests::benchmark::doNotOptimize(children.size());
+   }
+}
+
+BENCHMARK(FilePath, childrenRecursive)
+{
+   const FilePath& root = scratchTree().root();
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      std::size_t count = 0;
+      Error error = root.childrenRecursive(
+               boost::bind(countEntry, _1, _2, &count));
+      tests::benchmark::doNotOptimize(count);
+   }
+}
+
+} // namespace core
+} // namespace rstudio
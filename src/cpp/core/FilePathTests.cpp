@@ -18,6 +18,7 @@
 
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
 
 namespace rstudio {
 namespace core {
@@ -38,6 +39,58 @@ TEST_CASE("file paths")
 
       CHECK(aPath.relativePath(pPath) == "a");
    }
+
+   SECTION("hard links")
+   {
+      FilePath dir;
+      REQUIRE(!FilePath::tempFilePath(&dir));
+      REQUIRE(!dir.ensureDirectory());
+
+      FilePath original = dir.complete("original");
+      FilePath linked = dir.complete("linked");
+      REQUIRE(!writeStringToFile(original, "contents"));
+      CHECK(original.hardLinkCount() == 1);
+
+      REQUIRE(!original.link(linked));
+      CHECK(original.hardLinkCount() == 2);
+
+      std::string contents;
+      REQUIRE(!readStringFromFile(linked, &contents));
+      CHECK(contents == "contents");
+
+      // removing one link leaves the other intact
+      REQUIRE(!original.remove());
+      CHECK(linked.hardLinkCount() == 1);
+      CHECK(!dir.complete("missing").hardLinkCount());
+
+      dir.remove();
+   }
+
+   SECTION("operation counts")
+   {
+      FilePath dir;
+      REQUIRE(!FilePath::tempFilePath(&dir));
+      FilePath::collectOperationStats();
+
+      REQUIRE(!dir.ensureDirectory());
+      FilePath file = dir.complete("file");
+      REQUIRE(!file.ensureFile());
+      CHECK(file.exists());
+      std::vector<FilePath> children;
+      REQUIRE(!dir.children(&children));
+
+      FilePath::OperationStats stats = FilePath::collectOperationStats();
+      CHECK(stats.queries >= 3);
+      CHECK(stats.listings == 1);
+      CHECK(stats.opens == 1);
+      CHECK(stats.changes == 1);
+
+      // counts are reset when collected
+      stats = FilePath::collectOperationStats();
+      CHECK(stats.listings == 0);
+
+      dir.remove();
+   }
 }
 
 } // end namespace tests
@@ -19,6 +19,13 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -153,6 +160,138 @@ Error writeStringToFile(const FilePath& filePath,
    }
 }
 
+#ifndef _WIN32
+namespace {
+
+Error fileError(int errorNumber,
+                const FilePath& filePath,
+                const ErrorLocation& location)
+{
+   Error error = systemError(errorNumber, location);
+   error.addProperty("path", filePath.absolutePath());
+   return error;
+}
+
+Error writeAndSync(int fd, const std::string& str, const FilePath& filePath)
+{
+   const char* pData = str.data();
+   std::size_t remaining = str.size();
+   while (remaining > 0)
+   {
+      ssize_t written = ::write(fd, pData, remaining);
+      if (written == -1)
+      {
+         if (errno == EINTR)
+            continue;
+         return fileError(errno, filePath, ERROR_LOCATION);
+      }
+      pData += written;
+      remaining -= written;
+   }
+
+   if (::fsync(fd) == -1)
+      return fileError(errno, filePath, ERROR_LOCATION);
+
+   return Success();
+}
+
+Error writeInPlace(const FilePath& filePath, const std::string& str)
+{
+   int fd = ::open(filePath.absolutePath().c_str(),
+                   O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                   0666);
+   if (fd == -1)
+      return fileError(errno, filePath, ERROR_LOCATION);
+
+   Error error = writeAndSync(fd, str, filePath);
+   if (::close(fd) == -1 && !error)
+      error = fileError(errno, filePath, ERROR_LOCATION);
+   return error;
+}
+
+void syncDirectory(const FilePath& dirPath)
+{
+   // (best effort: the rename has happened either way)
+   int fd = ::open(dirPath.absolutePath().c_str(), O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+      return;
+   ::fsync(fd);
+   ::close(fd);
+}
+
+} // anonymous namespace
+#endif
+
+Error writeStringToFileAtomically(const FilePath& filePath,
+                                  const std::string& str,
+                                  string_utils::LineEnding lineEnding)
+{
+#ifdef _WIN32
+   return writeStringToFile(filePath, str, lineEnding);
+#else
+   std::string normalized = str;
+   string_utils::convertLineEndings(&normalized, lineEnding);
+
+   // new files (which have no contents to lose) and files which replacing
+   // would change the nature of are written in place
+   std::string path = filePath.absolutePath();
+   struct stat info;
+   if (::lstat(path.c_str(), &info) == -1 ||
+       !S_ISREG(info.st_mode) ||
+       info.st_nlink > 1 ||
+       info.st_uid != ::geteuid())
+   {
+      return writeInPlace(filePath, normalized);
+   }
+
+   // create the temporary file alongside the target (so the rename is
+   // within a filesystem) with the target's permissions and group
+   FilePath parentPath = filePath.parent();
+   std::string tempTemplate =
+         parentPath.complete("." + filePath.filename() + ".XXXXXX").absolutePath();
+   std::vector<char> tempPathBuffer(tempTemplate.begin(), tempTemplate.end());
+   tempPathBuffer.push_back('\0');
+   int fd = ::mkstemp(&tempPathBuffer[0]);
+   if (fd == -1)
+      return writeInPlace(filePath, normalized);
+   std::string tempPath(&tempPathBuffer[0]);
+   ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+   struct stat tempInfo;
+   if (::fchmod(fd, info.st_mode & 07777) == -1 ||
+       ::fstat(fd, &tempInfo) == -1 ||
+       (tempInfo.st_gid != info.st_gid &&
+        ::fchown(fd, static_cast<uid_t>(-1), info.st_gid) == -1))
+   {
+      ::close(fd);
+      ::unlink(tempPath.c_str());
+      return writeInPlace(filePath, normalized);
+   }
+
+   // write it (a failure here, e.g. a full disk, would fail in place too,
+   // so we report it rather than falling back and losing the old contents)
+   Error error = writeAndSync(fd, normalized, filePath);
+   if (::close(fd) == -1 && !error)
+      error = fileError(errno, filePath, ERROR_LOCATION);
+   if (error)
+   {
+      ::unlink(tempPath.c_str());
+      return error;
+   }
+
+   // replace the target
+   if (::rename(tempPath.c_str(), path.c_str()) == -1)
+   {
+      error = fileError(errno, filePath, ERROR_LOCATION);
+      ::unlink(tempPath.c_str());
+      return error;
+   }
+
+   syncDirectory(parentPath);
+   return Success();
+#endif
+}
+
 Error readStringFromFile(const FilePath& filePath,
                          std::string* pStr,
                          string_utils::LineEnding lineEnding,
@@ -0,0 +1,114 @@
+/*
+ * FileSerializerTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <core/FileSerializer.hpp>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+namespace {
+
+std::string readFile(const FilePath& filePath)
+{
+   std::string contents;
+   Error error = readStringFromFile(filePath, &contents);
+   return error ? std::string() : contents;
+}
+
+mode_t fileMode(const FilePath& filePath)
+{
+   struct stat info;
+   if (::stat(filePath.absolutePath().c_str(), &info) == -1)
+      return 0;
+   return info.st_mode & 07777;
+}
+
+} // anonymous namespace
+
+context("FileSerializerTests")
+{
+   FilePath dirPath;
+   FilePath::tempFilePath(&dirPath);
+   dirPath.ensureDirectory();
+
+   test_that("Atomic writes create and replace files")
+   {
+      FilePath filePath = dirPath.complete("created.R");
+      expect_false(writeStringToFileAtomically(filePath, "x <- 1\n"));
+      expect_true(readFile(filePath) == "x <- 1\n");
+
+      expect_false(writeStringToFileAtomically(filePath, "y <- 2\n"));
+      expect_true(readFile(filePath) == "y <- 2\n");
+
+      // no temporary files are left behind
+      std::vector<FilePath> children;
+      dirPath.children(&children);
+      expect_true(children.size() == 1);
+   }
+
+   test_that("Atomic writes keep the file's permissions")
+   {
+      FilePath filePath = dirPath.complete("mode.R");
+      expect_false(writeStringToFile(filePath, "old"));
+      ::chmod(filePath.absolutePath().c_str(), 0640);
+
+      expect_false(writeStringToFileAtomically(filePath, "new"));
+      expect_true(readFile(filePath) == "new");
+      expect_true(fileMode(filePath) == 0640);
+   }
+
+   test_that("Atomic writes through a symlink update its target")
+   {
+      FilePath targetPath = dirPath.complete("target.R");
+      FilePath linkPath = dirPath.complete("link.R");
+      expect_false(writeStringToFile(targetPath, "old"));
+      expect_true(::symlink(targetPath.absolutePath().c_str(),
+                            linkPath.absolutePath().c_str()) == 0);
+
+      expect_false(writeStringToFileAtomically(linkPath, "new"));
+      expect_true(readFile(targetPath) == "new");
+
+      struct stat info;
+      expect_true(::lstat(linkPath.absolutePath().c_str(), &info) == 0);
+      expect_true(S_ISLNK(info.st_mode));
+   }
+
+   test_that("Atomic writes convert line endings")
+   {
+      FilePath filePath = dirPath.complete("endings.R");
+      expect_false(writeStringToFileAtomically(filePath, "a\nb\n",
+                                               string_utils::LineEndingWindows));
+      expect_true(readFile(filePath) == "a\r\nb\r\n");
+   }
+
+   dirPath.remove();
+}
+
+} // namespace tests
+} // namespace core
+} // namespace rstudio
+
+#endif // _WIN32
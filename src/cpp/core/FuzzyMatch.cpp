@@ -0,0 +1,304 @@
+/*
+ * FuzzyMatch.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/FuzzyMatch.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/algorithm/string/case_conv.hpp>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+namespace rstudio {
+namespace core {
+namespace fuzzy_match {
+
+namespace {
+
+inline bool isUpper(char ch)
+{
+   return ch >= 'A' && ch <= 'Z';
+}
+
+inline bool isLower(char ch)
+{
+   return ch >= 'a' && ch <= 'z';
+}
+
+// (only ascii letters are folded, as with to_lower in the C locale)
+inline char toLower(char ch)
+{
+   return isUpper(ch) ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+// maps each byte to its bit in a character mask: lower case letters,
+// upper case letters and digits each get their own bit while punctuation
+// and non ascii bytes share the remaining two
+struct MaskTable
+{
+   MaskTable()
+   {
+      for (int i = 0; i < 256; i++)
+      {
+         char ch = static_cast<char>(i);
+         int bit;
+         if (isLower(ch))
+            bit = ch - 'a';
+         else if (isUpper(ch))
+            bit = 26 + (ch - 'A');
+         else if (ch >= '0' && ch <= '9')
+            bit = 52 + (ch - '0');
+         else if (ch == '_' || ch == '.' || ch == '-' || ch == '/')
+            bit = 62;
+         else
+            bit = 63;
+
+         caseSensitive[i] = boost::uint64_t(1) << bit;
+         caseInsensitive[i] = isUpper(ch) ?
+                  boost::uint64_t(1) << (ch - 'A') : caseSensitive[i];
+      }
+   }
+
+   boost::uint64_t caseSensitive[256];
+   boost::uint64_t caseInsensitive[256];
+};
+
+const MaskTable& maskTable()
+{
+   static const MaskTable instance;
+   return instance;
+}
+
+// find the first occurrence of either ch1 or ch2 at or after begin
+const char* findEither(const char* begin,
+                       const char* end,
+                       char ch1,
+                       char ch2)
+{
+   const char* it = begin;
+
+#if defined(__SSE2__)
+   // compare 16 bytes at a time
+   const __m128i v1 = _mm_set1_epi8(ch1);
+   const __m128i v2 = _mm_set1_epi8(ch2);
+   for (; end - it >= 16; it += 16)
+   {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+      __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, v1),
+                                     _mm_cmpeq_epi8(chunk, v2));
+      int bits = _mm_movemask_epi8(matches);
+      if (bits != 0)
+         return it + __builtin_ctz(bits);
+   }
+#endif
+
+   for (; it < end; ++it)
+   {
+      if (*it == ch1 || *it == ch2)
+         return it;
+   }
+
+   return NULL;
+}
+
+bool equals(const char* begin, const char* end, const char* text)
+{
+   std::size_t size = end - begin;
+   return std::strlen(text) == size && std::memcmp(begin, text, size) == 0;
+}
+
+const char* findLast(const char* begin, const char* end, char ch)
+{
+   for (const char* it = end; it > begin; --it)
+   {
+      if (it[-1] == ch)
+         return it - 1;
+   }
+
+   return NULL;
+}
+
+} // anonymous namespace
+
+boost::uint64_t characterMask(const char* begin,
+                              const char* end,
+                              bool caseInsensitive)
+{
+   const boost::uint64_t* table = caseInsensitive ?
+            maskTable().caseInsensitive : maskTable().caseSensitive;
+
+   boost::uint64_t mask = 0;
+   for (const char* it = begin; it < end; ++it)
+      mask |= table[static_cast<unsigned char>(*it)];
+   return mask;
+}
+
+Query::Query(const std::string& query, bool caseInsensitive)
+   : query_(caseInsensitive ? boost::algorithm::to_lower_copy(query) : query),
+     caseInsensitive_(caseInsensitive),
+     mask_(characterMask(query_, caseInsensitive))
+{
+}
+
+bool Query::isSubsequenceOf(const char* begin, const char* end) const
+{
+   if (query_.empty())
+      return true;
+
+   if (query_.size() > static_cast<std::size_t>(end - begin))
+      return false;
+
+   const char* it = begin;
+   for (std::string::const_iterator queryIt = query_.begin();
+        queryIt != query_.end();
+        ++queryIt)
+   {
+      char ch = *queryIt;
+      if (caseInsensitive_ && isLower(ch))
+      {
+         it = findEither(it, end, ch, static_cast<char>(ch - 'a' + 'A'));
+      }
+      else
+      {
+         it = static_cast<const char*>(std::memchr(it, ch, end - it));
+      }
+
+      if (it == NULL)
+         return false;
+      ++it;
+   }
+
+   return true;
+}
+
+void filterSubsequences(const std::vector<std::string>& candidates,
+                        const Query& query,
+                        std::vector<bool>* pMatches)
+{
+   std::size_t n = candidates.size();
+
+   // compute the masks up front so that the prefilter is a tight loop
+   std::vector<boost::uint64_t> masks(n);
+   for (std::size_t i = 0; i < n; i++)
+      masks[i] = characterMask(candidates[i], query.caseInsensitive());
+
+   pMatches->assign(n, false);
+   for (std::size_t i = 0; i < n; i++)
+   {
+      if (query.mayMatch(masks[i]))
+         (*pMatches)[i] = query.isSubsequenceOf(candidates[i]);
+   }
+}
+
+int scoreMatch(const char* begin,
+               const char* end,
+               const std::string& query,
+               bool isFile)
+{
+   std::size_t size = end - begin;
+
+   // No penalty for perfect matches
+   if (size == query.size() && std::equal(begin, end, query.begin()))
+      return 0;
+
+   // More penalty for 'uninteresting' files and extensions (e.g. .Rd),
+   // applied for each matched character
+   int uninterestingPenalty = 0;
+   if (equals(begin, end, "RcppExports.R") ||
+       equals(begin, end, "RcppExports.cpp"))
+      uninterestingPenalty += 6;
+
+   const char* extension = findLast(begin, end, '.');
+   if (extension != NULL &&
+       end - extension == 3 &&
+       (extension[1] == 'r' || extension[1] == 'R') &&
+       (extension[2] == 'd' || extension[2] == 'D'))
+      uninterestingPenalty += 6;
+
+   int totalPenalty = 0;
+   int matchCount = 0;
+
+   // Loop over the matches and assign a score (query characters which
+   // can't be matched are skipped)
+   const char* searchFrom = begin;
+   for (std::string::size_type i = 0; i < query.size(); i++)
+   {
+      const char* match = static_cast<const char*>(
+               std::memchr(searchFrom, query[i], end - searchFrom));
+      if (match == NULL)
+         continue;
+      searchFrom = match + 1;
+
+      int j = matchCount++;
+      int matchPos = static_cast<int>(match - begin);
+      int penalty = matchPos;
+
+      // Less penalty if character follows special delim
+      if (matchPos >= 1)
+      {
+         char prevChar = match[-1];
+         if (prevChar == '_' || prevChar == '-' || (!isFile && prevChar == '.'))
+         {
+            penalty = j + 1;
+         }
+      }
+
+      // Less penalty for perfect match (ie, reward case-sensitive match)
+      penalty -= *match == query[j];
+
+      totalPenalty += penalty + uninterestingPenalty;
+   }
+
+   // Penalize files
+   if (isFile)
+      ++totalPenalty;
+
+   // Penalize unmatched characters
+   totalPenalty += static_cast<int>((query.size() - matchCount) * query.size());
+
+   return totalPenalty;
+}
+
+int scoreMatch(const std::string& suggestion,
+               const std::string& query,
+               bool isFile)
+{
+   return scoreMatch(suggestion.data(),
+                     suggestion.data() + suggestion.size(),
+                     query,
+                     isFile);
+}
+
+void scoreMatches(const std::vector<std::string>& suggestions,
+                  const std::string& query,
+                  bool isFile,
+                  std::vector<int>* pScores)
+{
+   pScores->clear();
+   pScores->reserve(suggestions.size());
+   for (std::vector<std::string>::const_iterator it = suggestions.begin();
+        it != suggestions.end();
+        ++it)
+   {
+      pScores->push_back(scoreMatch(*it, query, isFile));
+   }
+}
+
+} // namespace fuzzy_match
+} // namespace core
+} // namespace rstudio
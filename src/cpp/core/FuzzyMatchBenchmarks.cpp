@@ -0,0 +1,79 @@
+/*
+ * FuzzyMatchBenchmarks.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/FuzzyMatch.hpp>
+
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include <tests/Benchmark.hpp>
+
+namespace rstudio {
+namespace core {
+namespace fuzzy_match {
+
+namespace {
+
+// file paths like those of a large project
+const std::vector<std::string>& candidates()
+{
+   static std::vector<std::string> paths;
+   if (paths.empty())
+   {
+      const char* const kDirs[] = {
+         "R/", "src/cpp/session/modules/", "inst/extdata/", "tests/testthat/",
+         "vignettes/articles/"
+      };
+      const char* const kNames[] = {
+         "environment", "source_database", "parse_data", "helpers",
+         "fuzzy-match", "SessionCodeSearch", "utils"
+      };
+      for (int i = 0; i < 10000; i++)
+      {
+         paths.push_back(std::string(kDirs[i % 5]) + kNames[i % 7] + "_" +
+                         boost::lexical_cast<std::string>(i) + ".R");
+      }
+   }
+   return paths;
+}
+
+} // anonymous namespace
+
+BENCHMARK(FuzzyMatch, scoreMatches)
+{
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      std::vector<int> scores;
+      scoreMatches(candidates(), "sesdb", true, &scores);
+      tests::benchmark::doNotOptimize(scores.size());
+   }
+}
+
+BENCHMARK(FuzzyMatch, filterSubsequences)
+{
+   Query query("envhelp", true);
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      std::vector<bool> matches;
+      filterSubsequences(candidates(), query, &matches);
+      tests::benchmark::doNotOptimize(matches.size());
+   }
+}
+
+} // namespace fuzzy_match
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,116 @@
+/*
+ * FuzzyMatchTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/FuzzyMatch.hpp>
+#include <core/StringUtils.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace fuzzy_match {
+namespace tests {
+
+context("FuzzyMatchTests")
+{
+   test_that("Subsequence matching agrees with string_utils")
+   {
+      std::vector<std::string> candidates;
+      candidates.push_back("");
+      candidates.push_back("readData");
+      candidates.push_back("read_data.R");
+      candidates.push_back("R/plotting/ggplot-helpers.R");
+      candidates.push_back("SessionCodeSearch.cpp");
+      candidates.push_back("a very long candidate which spans several chunks.R");
+
+      std::vector<std::string> queries;
+      queries.push_back("");
+      queries.push_back("rd");
+      queries.push_back("RD");
+      queries.push_back("rdR");
+      queries.push_back("ggh");
+      queries.push_back("scs");
+      queries.push_back("SCS");
+      queries.push_back("chunks.r");
+      queries.push_back("zz");
+
+      for (std::size_t i = 0; i < queries.size(); i++)
+      {
+         for (int caseInsensitive = 0; caseInsensitive < 2; caseInsensitive++)
+         {
+            Query query(queries[i], caseInsensitive != 0);
+
+            std::vector<bool> matches;
+            filterSubsequences(candidates, query, &matches);
+            REQUIRE(matches.size() == candidates.size());
+
+            for (std::size_t j = 0; j < candidates.size(); j++)
+            {
+               bool expected = string_utils::isSubsequence(
+                        candidates[j], queries[i], caseInsensitive != 0);
+               expect_true(query.isSubsequenceOf(candidates[j]) == expected);
+               expect_true(matches[j] == expected);
+            }
+         }
+      }
+   }
+
+   test_that("Character masks rule out candidates")
+   {
+      Query query("xyz");
+      expect_false(query.mayMatch(characterMask("readData", false)));
+      expect_true(query.mayMatch(characterMask("zyx", false)));
+
+      Query caseInsensitiveQuery("RD", true);
+      expect_true(caseInsensitiveQuery.mayMatch(characterMask("rd", true)));
+      expect_false(Query("RD").mayMatch(characterMask("rd", false)));
+   }
+
+   test_that("Scores match the client side scoring")
+   {
+      expect_true(scoreMatch("plot", "plot", false) == 0);
+      expect_true(scoreMatch("read_data.R", "rd", true) == 2);
+      expect_true(scoreMatch("plot.Rd", "pl", true) == 12);
+      expect_true(scoreMatch("RcppExports.R", "Rc", true) == 12);
+      expect_true(scoreMatch("my.func", "mf", false) == 0);
+      expect_true(scoreMatch("foo-bar", "fb", false) == 0);
+      expect_true(scoreMatch("abc", "axc", false) == 4);
+
+      std::vector<std::string> suggestions;
+      suggestions.push_back("my.func");
+      suggestions.push_back("abc");
+      std::vector<int> scores;
+      scoreMatches(suggestions, "mf", false, &scores);
+      REQUIRE(scores.size() == 2);
+      expect_true(scores[0] == 0);
+      expect_true(scores[1] == scoreMatch("abc", "mf", false));
+   }
+
+   test_that("Character ranges are scored as strings are")
+   {
+      // ranges needn't be null terminated
+      const char* text = "plot.Rd.x";
+      expect_true(scoreMatch(text, text + 7, "pl", true) == 12);
+      expect_true(scoreMatch(text, text + 4, "plot", false) == 0);
+      expect_true(scoreMatch(text, text + 2, "pl", false) == 0);
+      expect_true(scoreMatch(text, text, "pl", false) ==
+                  scoreMatch(std::string(), "pl", false));
+   }
+}
+
+} // namespace tests
+} // namespace fuzzy_match
+} // namespace core
+} // namespace rstudio
@@ -15,39 +15,252 @@
 
 #include <core/Hash.hpp>
 
+#include <cstring>
+#include <iomanip>
 #include <sstream>
 
-#include <boost/crc.hpp>
-#include <boost/lexical_cast.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
 #include <core/SafeConvert.hpp>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# define RSTUDIO_HAVE_SSE42_CRC32
+# include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+# define RSTUDIO_HAVE_ARM_CRC32
+# include <arm_acle.h>
+#endif
+
 namespace rstudio {
 namespace core {
 namespace hash {   
 
-std::string crc32Hash(const std::string& content)
+namespace {
+
+// tables for computing a (reflected) CRC eight bytes at a time
+// ("slicing-by-8"), which is several times faster than a byte at a time
+struct CrcTables
 {
-   boost::crc_32_type result;
-   result.process_bytes(content.data(), content.length());
-   return safe_convert::numberToString(result.checksum());
+   explicit CrcTables(boost::uint32_t polynomial)
+   {
+      for (boost::uint32_t i = 0; i < 256; i++)
+      {
+         boost::uint32_t crc = i;
+         for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+         table[0][i] = crc;
+      }
+
+      for (boost::uint32_t i = 0; i < 256; i++)
+      {
+         for (int slice = 1; slice < 8; slice++)
+         {
+            boost::uint32_t previous = table[slice - 1][i];
+            table[slice][i] = (previous >> 8) ^ table[0][previous & 0xFF];
+         }
+      }
+   }
+
+   boost::uint32_t table[8][256];
+};
+
+const CrcTables& crc32Tables()
+{
+   static const CrcTables tables(0xEDB88320);
+   return tables;
 }
 
-std::string crc32HexHash(const std::string& content)
+const CrcTables& crc32cTables()
+{
+   static const CrcTables tables(0x82F63B78);
+   return tables;
+}
+
+inline boost::uint32_t readUInt32(const unsigned char* data)
+{
+   return static_cast<boost::uint32_t>(data[0]) |
+          static_cast<boost::uint32_t>(data[1]) << 8 |
+          static_cast<boost::uint32_t>(data[2]) << 16 |
+          static_cast<boost::uint32_t>(data[3]) << 24;
+}
+
+boost::uint32_t updateCrc(const CrcTables& tables,
+                          boost::uint32_t crc,
+                          const unsigned char* data,
+                          std::size_t size)
+{
+   const boost::uint32_t (*table)[256] = tables.table;
+
+   for (; size >= 8; data += 8, size -= 8)
+   {
+      boost::uint32_t low = readUInt32(data) ^ crc;
+      boost::uint32_t high = readUInt32(data + 4);
+      crc = table[7][low & 0xFF] ^
+            table[6][(low >> 8) & 0xFF] ^
+            table[5][(low >> 16) & 0xFF] ^
+            table[4][low >> 24] ^
+            table[3][high & 0xFF] ^
+            table[2][(high >> 8) & 0xFF] ^
+            table[1][(high >> 16) & 0xFF] ^
+            table[0][high >> 24];
+   }
+
+   for (; size > 0; data++, size--)
+      crc = table[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+
+   return crc;
+}
+
+#if defined(RSTUDIO_HAVE_SSE42_CRC32)
+
+bool haveSse42()
+{
+   static const bool haveSse42 = __builtin_cpu_supports("sse4.2");
+   return haveSse42;
+}
+
+__attribute__((target("sse4.2")))
+boost::uint32_t updateCrc32cHardware(boost::uint32_t crc,
+                                     const unsigned char* data,
+                                     std::size_t size)
+{
+   boost::uint64_t crc64 = crc;
+   for (; size >= 8; data += 8, size -= 8)
+   {
+      boost::uint64_t value;
+      std::memcpy(&value, data, sizeof(value));
+      crc64 = _mm_crc32_u64(crc64, value);
+   }
+
+   crc = static_cast<boost::uint32_t>(crc64);
+   for (; size > 0; data++, size--)
+      crc = _mm_crc32_u8(crc, *data);
+
+   return crc;
+}
+
+#elif defined(RSTUDIO_HAVE_ARM_CRC32)
+
+boost::uint32_t updateCrc32cHardware(boost::uint32_t crc,
+                                     const unsigned char* data,
+                                     std::size_t size)
+{
+   for (; size >= 8; data += 8, size -= 8)
+   {
+      boost::uint64_t value;
+      std::memcpy(&value, data, sizeof(value));
+      crc = __crc32cd(crc, value);
+   }
+
+   for (; size > 0; data++, size--)
+      crc = __crc32cb(crc, *data);
+
+   return crc;
+}
+
+#endif
+
+bool haveHardwareCrc32c()
 {
-   // compute checksum
-   boost::crc_32_type result;
-   result.process_bytes(content.data(), content.length());
+#if defined(RSTUDIO_HAVE_SSE42_CRC32)
+   return haveSse42();
+#elif defined(RSTUDIO_HAVE_ARM_CRC32)
+   return true;
+#else
+   return false;
+#endif
+}
 
-   // return hex representation
+std::string hexString(boost::uint32_t value, bool pad)
+{
    std::ostringstream output;
-   output << std::uppercase << std::hex << result.checksum();
+   output << std::uppercase << std::hex;
+   if (pad)
+      output << std::setw(8) << std::setfill('0');
+   output << value;
    return output.str();
 }
+
+boost::uint32_t crc32Checksum(const std::string& content)
+{
+   boost::uint32_t crc = updateCrc(
+            crc32Tables(),
+            0xFFFFFFFF,
+            reinterpret_cast<const unsigned char*>(content.data()),
+            content.size());
+   return crc ^ 0xFFFFFFFF;
+}
+
+} // anonymous namespace
+
+std::string crc32Hash(const std::string& content)
+{
+   return safe_convert::numberToString(crc32Checksum(content));
+}
+
+std::string crc32HexHash(const std::string& content)
+{
+   return hexString(crc32Checksum(content), false);
+}
+
+void Crc32c::update(const void* data, std::size_t size)
+{
+   const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+#if defined(RSTUDIO_HAVE_SSE42_CRC32) || defined(RSTUDIO_HAVE_ARM_CRC32)
+   if (haveHardwareCrc32c())
+   {
+      crc_ = updateCrc32cHardware(crc_, bytes, size);
+      return;
+   }
+#endif
+
+   crc_ = updateCrc(crc32cTables(), crc_, bytes, size);
+}
+
+std::string Crc32c::hexChecksum() const
+{
+   return hexString(checksum(), true);
+}
+
+std::string crc32cHexHash(const std::string& content)
+{
+   Crc32c crc;
+   crc.update(content);
+   return crc.hexChecksum();
+}
+
+Error crc32cHexHash(const FilePath& filePath, std::string* pHash)
+{
+   if (!filePath.exists())
+      return fileNotFoundError(filePath, ERROR_LOCATION);
+
+   Crc32c crc;
+
+   // empty files can't be mapped
+   if (filePath.size() > 0)
+   {
+      try
+      {
+         boost::iostreams::mapped_file_source file(filePath.absolutePathNative());
+         crc.update(file.data(), file.size());
+      }
+      catch(const std::exception& e)
+      {
+         Error error = systemError(boost::system::errc::io_error,
+                                   e.what(),
+                                   ERROR_LOCATION);
+         error.addProperty("path", filePath);
+         return error;
+      }
+   }
+
+   *pHash = crc.hexChecksum();
+   return Success();
+}
    
 } // namespace hash
 } // namespace core 
 } // namespace rstudio
-
-
-
@@ -0,0 +1,100 @@
+/*
+ * HashTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/Hash.hpp>
+
+#include <boost/crc.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace hash {
+namespace tests {
+
+namespace {
+
+std::string testContent()
+{
+   std::string content;
+   for (int i = 0; i < 10000; i++)
+      content += safe_convert::numberToString(i * 7919) + "\n";
+   return content;
+}
+
+} // anonymous namespace
+
+context("Hash")
+{
+   test_that("crc32 hashes are unchanged")
+   {
+      std::string content = testContent();
+      for (std::size_t size = 0; size < 20; size++)
+      {
+         boost::crc_32_type expected;
+         expected.process_bytes(content.data(), size);
+         expect_true(crc32Hash(content.substr(0, size)) ==
+                     safe_convert::numberToString(expected.checksum()));
+      }
+
+      expect_true(crc32HexHash("123456789") == "CBF43926");
+   }
+
+   test_that("crc32c hashes match the reference value")
+   {
+      expect_true(crc32cHexHash("123456789") == "E3069283");
+      expect_true(crc32cHexHash("") == "00000000");
+   }
+
+   test_that("crc32c hashes can be computed incrementally")
+   {
+      std::string content = testContent();
+
+      Crc32c crc;
+      for (std::size_t i = 0; i < content.size(); i += 13)
+         crc.update(content.substr(i, 13));
+
+      expect_true(crc.hexChecksum() == crc32cHexHash(content));
+   }
+
+   test_that("crc32c hashes of files match those of their contents")
+   {
+      std::string content = testContent();
+      FilePath filePath;
+      REQUIRE_FALSE(FilePath::tempFilePath(&filePath));
+      REQUIRE_FALSE(writeStringToFile(filePath, content));
+
+      std::string hash;
+      expect_false(crc32cHexHash(filePath, &hash));
+      expect_true(hash == crc32cHexHash(content));
+
+      REQUIRE_FALSE(writeStringToFile(filePath, ""));
+      expect_false(crc32cHexHash(filePath, &hash));
+      expect_true(hash == "00000000");
+
+      REQUIRE_FALSE(filePath.remove());
+      expect_true(crc32cHexHash(filePath, &hash));
+   }
+}
+
+} // namespace tests
+} // namespace hash
+} // namespace core
+} // namespace rstudio
@@ -18,11 +18,13 @@
 #include <core/system/System.hpp>
 
 #include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
 #include <core/Base64.hpp>
 #include <core/FileSerializer.hpp>
 #include <core/RegexUtils.hpp>
+#include <core/collection/LruCache.hpp>
 
 #include <core/http/Util.hpp>
 
@@ -30,6 +32,30 @@ namespace rstudio {
 namespace core {
 namespace html_utils {
 
+namespace {
+
+// base64 encodings of the images and fonts most recently embedded (keyed by
+// path, size and modification time) so that documents which are re-rendered
+// repeatedly (e.g. presentations) don't re-encode unchanged resources
+collection::LruCache<std::string, std::string> s_base64Cache(64);
+
+Error encodeBase64(const FilePath& filePath, std::string* pEncoded)
+{
+   std::string key = filePath.absolutePath() + ":" +
+      boost::lexical_cast<std::string>(filePath.size()) + ":" +
+      boost::lexical_cast<std::string>(filePath.lastWriteTime());
+   if (s_base64Cache.get(key, pEncoded))
+      return Success();
+
+   Error error = core::base64::encode(filePath, pEncoded);
+   if (error)
+      return error;
+
+   s_base64Cache.insert(key, *pEncoded);
+   return Success();
+}
+
+} // anonymous namespace
 
 HTML::HTML(const std::string& text, bool isHTML)
 {
@@ -76,7 +102,7 @@ std::string Base64ImageFilter::toBase64Image(const boost::cmatch& match)
        boost::algorithm::starts_with(imagePath.mimeContentType(), "image/"))
    {     
       std::string imageBase64;
-      Error error = core::base64::encode(imagePath, &imageBase64);
+      Error error = encodeBase64(imagePath, &imageBase64);
       if (!error)
       {
          imgRef = "data:" + imagePath.mimeContentType() + ";base64,";
@@ -111,7 +137,7 @@ std::string CssUrlFilter::toBase64Url(const boost::cmatch& match)
    if (urlPath.exists() && (ext == ".ttf" || ext == ".otf"))
    {
       std::string fontBase64;
-      Error error = core::base64::encode(urlPath, &fontBase64);
+      Error error = encodeBase64(urlPath, &fontBase64);
       if (!error)
       {
          // return base64 encoded font
@@ -0,0 +1,255 @@
+/*
+ * InitGraph.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/InitGraph.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+#include <core/StartupTrace.hpp>
+#include <core/Thread.hpp>
+
+namespace rstudio {
+namespace core {
+
+namespace {
+
+struct Step
+{
+   Step() : background(false), finished(false) {}
+
+   std::string name;
+   InitGraph::Function function;
+   std::vector<boost::shared_ptr<Step> > dependencies;
+   bool background;
+
+   // guarded by the graph's mutex
+   bool finished;
+   Error error;
+
+   boost::thread thread;
+};
+
+} // anonymous namespace
+
+struct InitGraph::Impl
+{
+   void finishStep(boost::shared_ptr<Step> pStep, const Error& error);
+   void runStep(boost::shared_ptr<Step> pStep);
+
+   boost::mutex mutex;
+   boost::condition_variable finishedCondition;
+   std::vector<boost::shared_ptr<Step> > steps;
+   Error addError;
+};
+
+void InitGraph::Impl::finishStep(boost::shared_ptr<Step> pStep,
+                                 const Error& error)
+{
+   LOCK_MUTEX(mutex)
+   {
+      pStep->error = error;
+      pStep->finished = true;
+   }
+   END_LOCK_MUTEX
+
+   finishedCondition.notify_all();
+}
+
+void InitGraph::Impl::runStep(boost::shared_ptr<Step> pStep)
+{
+   // wait for our dependencies, skipping the step if one of them failed
+   Error dependencyError;
+   try
+   {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      BOOST_FOREACH(const boost::shared_ptr<Step>& pDependency,
+                    pStep->dependencies)
+      {
+         while (!pDependency->finished)
+            finishedCondition.wait(lock);
+
+         if (pDependency->error && !dependencyError)
+            dependencyError = pDependency->error;
+      }
+   }
+   catch(const boost::thread_resource_error& e)
+   {
+      dependencyError = Error(boost::thread_error::ec_from_exception(e),
+                              ERROR_LOCATION);
+   }
+
+   if (dependencyError)
+   {
+      finishStep(pStep, dependencyError);
+      return;
+   }
+
+   Error error;
+   try
+   {
+      startup_trace::Scope scope(pStep->name,
+                                 pStep->background ? "background" : "phase");
+      error = pStep->function();
+   }
+   catch(const std::exception& e)
+   {
+      error = systemError(boost::system::errc::state_not_recoverable,
+                          std::string("Unexpected exception: ") + e.what(),
+                          ERROR_LOCATION);
+   }
+   catch(...)
+   {
+      error = systemError(boost::system::errc::state_not_recoverable,
+                          "Unknown exception",
+                          ERROR_LOCATION);
+   }
+
+   if (error)
+      error.addProperty("step", pStep->name);
+
+   finishStep(pStep, error);
+}
+
+InitGraph::InitGraph()
+   : pImpl_(new Impl())
+{
+}
+
+InitGraph::~InitGraph()
+{
+   try
+   {
+      // execute joins its threads, but be safe if it was interrupted
+      BOOST_FOREACH(const boost::shared_ptr<Step>& pStep, pImpl_->steps)
+      {
+         if (pStep->thread.joinable())
+            pStep->thread.join();
+      }
+   }
+   catch(...)
+   {
+   }
+}
+
+InitGraph& InitGraph::addMain(const std::string& name,
+                              const Function& function,
+                              const std::vector<std::string>& dependencies)
+{
+   return add(name, function, dependencies, false);
+}
+
+InitGraph& InitGraph::addBackground(const std::string& name,
+                                    const Function& function,
+                                    const std::vector<std::string>& dependencies)
+{
+   return add(name, function, dependencies, true);
+}
+
+InitGraph& InitGraph::add(const std::string& name,
+                          const Function& function,
+                          const std::vector<std::string>& dependencies,
+                          bool background)
+{
+   boost::shared_ptr<Step> pStep = boost::make_shared<Step>();
+   pStep->name = name;
+   pStep->function = function;
+   pStep->background = background;
+
+   // resolve dependencies against the steps added so far
+   BOOST_FOREACH(const std::string& dependency, dependencies)
+   {
+      boost::shared_ptr<Step> pDependency;
+      BOOST_FOREACH(const boost::shared_ptr<Step>& pExisting, pImpl_->steps)
+      {
+         if (pExisting->name == dependency)
+         {
+            pDependency = pExisting;
+            break;
+         }
+      }
+
+      if (pDependency)
+      {
+         pStep->dependencies.push_back(pDependency);
+      }
+      else if (!pImpl_->addError)
+      {
+         pImpl_->addError = systemError(
+                  boost::system::errc::invalid_argument,
+                  "Init step '" + name + "' depends on unknown step '" +
+                     dependency + "'",
+                  ERROR_LOCATION);
+      }
+   }
+
+   pImpl_->steps.push_back(pStep);
+   return *this;
+}
+
+Error InitGraph::execute()
+{
+   if (pImpl_->addError)
+      return pImpl_->addError;
+
+   // dependencies always precede their dependents, so walking the steps in
+   // order never blocks a main step on one that hasn't been started
+   Error mainError;
+   BOOST_FOREACH(const boost::shared_ptr<Step>& pStep, pImpl_->steps)
+   {
+      if (pStep->background)
+      {
+         core::thread::safeLaunchThread(
+                  boost::bind(&Impl::runStep, pImpl_.get(), pStep),
+                  &pStep->thread);
+
+         // run it here if we couldn't get a thread
+         if (!pStep->thread.joinable())
+            pImpl_->runStep(pStep);
+      }
+      else if (mainError)
+      {
+         pImpl_->finishStep(pStep, mainError);
+      }
+      else
+      {
+         pImpl_->runStep(pStep);
+         mainError = pStep->error;
+      }
+   }
+
+   // wait for the background steps
+   BOOST_FOREACH(const boost::shared_ptr<Step>& pStep, pImpl_->steps)
+   {
+      if (pStep->thread.joinable())
+         pStep->thread.join();
+   }
+
+   // report the first failure
+   BOOST_FOREACH(const boost::shared_ptr<Step>& pStep, pImpl_->steps)
+   {
+      if (pStep->error)
+         return pStep->error;
+   }
+
+   return Success();
+}
+
+} // namespace core
+} // namespace rstudio
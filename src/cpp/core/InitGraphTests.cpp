@@ -0,0 +1,123 @@
+/*
+ * InitGraphTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/InitGraph.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <core/Error.hpp>
+#include <core/Thread.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+namespace {
+
+boost::mutex s_mutex;
+std::vector<std::string> s_log;
+
+Error logStep(const std::string& name, bool fail)
+{
+   LOCK_MUTEX(s_mutex)
+   {
+      s_log.push_back(name);
+   }
+   END_LOCK_MUTEX
+
+   if (fail)
+      return systemError(boost::system::errc::io_error, ERROR_LOCATION);
+   return Success();
+}
+
+InitGraph::Function step(const std::string& name, bool fail = false)
+{
+   return boost::bind(logStep, name, fail);
+}
+
+std::vector<std::string> deps(const std::string& name)
+{
+   return std::vector<std::string>(1, name);
+}
+
+std::size_t position(const std::string& name)
+{
+   return std::find(s_log.begin(), s_log.end(), name) - s_log.begin();
+}
+
+bool ran(const std::string& name)
+{
+   return position(name) != s_log.size();
+}
+
+} // anonymous namespace
+
+TEST_CASE("Init Graph")
+{
+   s_log.clear();
+
+   SECTION("Main steps run in order after their dependencies")
+   {
+      InitGraph graph;
+      graph.addBackground("load", step("load"))
+           .addMain("first", step("first"))
+           .addMain("second", step("second"), deps("load"))
+           .addBackground("after", step("after"), deps("second"));
+
+      CHECK(graph.execute() == Success());
+      REQUIRE(s_log.size() == 4);
+      CHECK(position("first") < position("second"));
+      CHECK(position("load") < position("second"));
+      CHECK(position("second") < position("after"));
+   }
+
+   SECTION("Failures skip dependents and later main steps")
+   {
+      InitGraph graph;
+      graph.addBackground("load", step("load", true))
+           .addBackground("parse", step("parse"), deps("load"))
+           .addMain("independent", step("independent"))
+           .addMain("consume", step("consume"), deps("parse"))
+           .addMain("later", step("later"));
+
+      Error error = graph.execute();
+      CHECK(error);
+      CHECK(error.getProperty("step") == "load");
+      CHECK(ran("load"));
+      CHECK(ran("independent"));
+      CHECK_FALSE(ran("parse"));
+      CHECK_FALSE(ran("consume"));
+      CHECK_FALSE(ran("later"));
+   }
+
+   SECTION("Unknown dependencies are reported before anything runs")
+   {
+      InitGraph graph;
+      graph.addMain("first", step("first"), deps("missing"));
+      CHECK(graph.execute());
+      CHECK(s_log.empty());
+   }
+}
+
+} // end namespace tests
+} // end namespace core
+} // end namespace rstudio
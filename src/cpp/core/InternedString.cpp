@@ -0,0 +1,213 @@
+/*
+ * InternedString.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/InternedString.hpp>
+
+#include <deque>
+#include <ostream>
+
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <core/Thread.hpp>
+
+namespace rstudio {
+namespace core {
+
+namespace {
+
+typedef InternedString::Entry Entry;
+
+struct EntryHash
+{
+   std::size_t operator()(const std::string& value) const
+   {
+      return boost::hash_range(value.begin(), value.end());
+   }
+
+   std::size_t operator()(const Entry* pEntry) const
+   {
+      return (*this)(pEntry->value);
+   }
+};
+
+struct EntryEqual
+{
+   bool operator()(const std::string& value, const Entry* pEntry) const
+   {
+      return value == pEntry->value;
+   }
+
+   bool operator()(const Entry* pLhs, const Entry* pRhs) const
+   {
+      return pLhs->value == pRhs->value;
+   }
+};
+
+class StringPool
+{
+public:
+   StringPool()
+      : bytes_(0)
+   {
+      // the empty string is always present, as id 0
+      add(std::string());
+   }
+
+   const Entry* empty() const
+   {
+      return &entries_.front();
+   }
+
+   const Entry* intern(const std::string& value)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         const Entry* pEntry = lookup(value);
+         return pEntry ? pEntry : add(value);
+      }
+      END_LOCK_MUTEX
+
+      return NULL;
+   }
+
+   const Entry* find(const std::string& value)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         return lookup(value);
+      }
+      END_LOCK_MUTEX
+
+      return NULL;
+   }
+
+   std::size_t size()
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         return entries_.size();
+      }
+      END_LOCK_MUTEX
+
+      return 0;
+   }
+
+   std::size_t bytes()
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         return bytes_;
+      }
+      END_LOCK_MUTEX
+
+      return 0;
+   }
+
+private:
+   const Entry* lookup(const std::string& value) const
+   {
+      Index::const_iterator it = index_.find(value, EntryHash(), EntryEqual());
+      return it == index_.end() ? NULL : *it;
+   }
+
+   const Entry* add(const std::string& value)
+   {
+      // entries in a deque are never moved, so pointers to them are stable
+      Entry entry;
+      entry.value = value;
+      entry.id = static_cast<StringId>(entries_.size());
+      entries_.push_back(entry);
+
+      const Entry* pEntry = &entries_.back();
+      index_.insert(pEntry);
+      bytes_ += value.size();
+      return pEntry;
+   }
+
+   typedef boost::unordered_set<const Entry*, EntryHash, EntryEqual> Index;
+
+   boost::mutex mutex_;
+   std::deque<Entry> entries_;
+   Index index_;
+   std::size_t bytes_;
+};
+
+StringPool& stringPool()
+{
+   // leaked so that strings remain valid during static destruction
+   static StringPool* pPool = new StringPool();
+   return *pPool;
+}
+
+const Entry* internOrEmpty(const std::string& value)
+{
+   if (value.empty())
+      return stringPool().empty();
+
+   const Entry* pEntry = stringPool().intern(value);
+   return pEntry ? pEntry : stringPool().empty();
+}
+
+} // anonymous namespace
+
+InternedString::InternedString()
+   : pEntry_(stringPool().empty())
+{
+}
+
+InternedString::InternedString(const std::string& value)
+   : pEntry_(internOrEmpty(value))
+{
+}
+
+InternedString::InternedString(const char* value)
+   : pEntry_(internOrEmpty(value ? std::string(value) : std::string()))
+{
+}
+
+bool InternedString::find(const std::string& value, InternedString* pInterned)
+{
+   const Entry* pEntry = value.empty() ?
+            stringPool().empty() :
+            stringPool().find(value);
+   if (!pEntry)
+      return false;
+
+   *pInterned = InternedString(pEntry);
+   return true;
+}
+
+std::ostream& operator<<(std::ostream& os, const InternedString& string)
+{
+   return os << string.str();
+}
+
+namespace string_pool {
+
+std::size_t size()
+{
+   return stringPool().size();
+}
+
+std::size_t bytes()
+{
+   return stringPool().bytes();
+}
+
+} // namespace string_pool
+
+} // namespace core
+} // namespace rstudio
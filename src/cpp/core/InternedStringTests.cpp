@@ -0,0 +1,82 @@
+/*
+ * InternedStringTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <set>
+
+#include <core/InternedString.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+context("Interned strings")
+{
+   test_that("Equal strings share an entry and id")
+   {
+      InternedString a("interned_string_test_a");
+      InternedString b(std::string("interned_string_test_a"));
+      InternedString c("interned_string_test_c");
+
+      expect_true(a == b);
+      expect_true(a.id() == b.id());
+      expect_true(&a.str() == &b.str());
+      expect_true(a != c);
+      expect_true(a.str() == "interned_string_test_a");
+   }
+
+   test_that("The empty string is id 0")
+   {
+      expect_true(InternedString().id() == 0);
+      expect_true(InternedString("").id() == 0);
+      expect_true(InternedString().empty());
+   }
+
+   test_that("Strings can be found without interning them")
+   {
+      std::size_t size = string_pool::size();
+
+      InternedString found;
+      expect_false(InternedString::find("interned_string_test_never", &found));
+      expect_true(found.empty());
+      expect_true(string_pool::size() == size);
+
+      InternedString d("interned_string_test_d");
+      expect_true(InternedString::find("interned_string_test_d", &found));
+      expect_true(found == d);
+   }
+
+   test_that("Interned strings sort alphabetically")
+   {
+      std::set<InternedString> sorted;
+      sorted.insert(InternedString("interned_string_test_z"));
+      sorted.insert(InternedString("interned_string_test_m"));
+      sorted.insert(InternedString("interned_string_test_m"));
+      sorted.insert(InternedString("interned_string_test_b"));
+
+      expect_true(sorted.size() == 3);
+      expect_true(sorted.begin()->str() == "interned_string_test_b");
+      expect_true(sorted.rbegin()->str() == "interned_string_test_z");
+
+      InternedStringSet set(sorted.begin(), sorted.end());
+      expect_true(set.count(InternedString("interned_string_test_m")) == 1);
+      expect_true(set.count(InternedString("interned_string_test_q")) == 0);
+   }
+}
+
+} // end namespace tests
+} // end namespace core
+} // end namespace rstudio
@@ -0,0 +1,71 @@
+/*
+ * LruCacheBenchmarks.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/collection/LruCache.hpp>
+
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include <tests/Benchmark.hpp>
+
+namespace rstudio {
+namespace core {
+namespace collection {
+
+namespace {
+
+const std::vector<std::string>& keys()
+{
+   static std::vector<std::string> keys;
+   if (keys.empty())
+   {
+      for (int i = 0; i < 4096; i++)
+         keys.push_back("key-" + boost::lexical_cast<std::string>(i));
+   }
+   return keys;
+}
+
+} // anonymous namespace
+
+BENCHMARK(LruCache, get_hit)
+{
+   static LruCache<std::string, int> cache(4096);
+   const std::vector<std::string>& all = keys();
+   if (cache.size() == 0)
+   {
+      for (std::size_t i = 0; i < all.size(); i++)
+         cache.insert(all[i], static_cast<int>(i));
+   }
+
+   int value = 0;
+   for (std::size_t i = 0; i < iterations; i++)
+      tests::benchmark::doNotOptimize(cache.get(all[i % all.size()], &value));
+}
+
+BENCHMARK(LruCache, insert_evict)
+{
+   // a cache smaller than the set of keys, so most inserts evict
+   static LruCache<std::string, int> cache(1024);
+   const std::vector<std::string>& all = keys();
+   for (std::size_t i = 0; i < iterations; i++)
+      cache.insert(all[i % all.size()], static_cast<int>(i));
+   tests::benchmark::doNotOptimize(cache.size());
+}
+
+} // namespace collection
+} // namespace core
+} // namespace rstudio
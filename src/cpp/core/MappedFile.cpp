@@ -0,0 +1,154 @@
+/*
+ * MappedFile.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/MappedFile.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <core/Error.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/collection/LruCache.hpp>
+
+namespace rstudio {
+namespace core {
+
+namespace {
+
+// the most resources kept mapped (these use address space and page cache
+// rather than memory of their own, but MathJax alone has many files)
+const unsigned int kMaxMappedResources = 1000;
+
+collection::LruCache<std::string, boost::shared_ptr<const MappedFile> >&
+                                                            resourceCache()
+{
+   // (allocated so that it's never destroyed, as it may be used at exit)
+   static collection::LruCache<std::string, boost::shared_ptr<const MappedFile> >*
+         pCache = new collection::LruCache<std::string,
+                                           boost::shared_ptr<const MappedFile> >(
+                                              kMaxMappedResources);
+   return *pCache;
+}
+
+} // anonymous namespace
+
+MappedFile::MappedFile()
+   : lastWriteTime_(0), pData_(NULL), size_(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+   if (pData_ != NULL && pData_ != contents_.data())
+      ::munmap(const_cast<char*>(pData_), size_);
+#endif
+}
+
+Error MappedFile::open(const FilePath& filePath,
+                       boost::shared_ptr<MappedFile>* pMappedFile)
+{
+   boost::shared_ptr<MappedFile> pFile(new MappedFile());
+   pFile->filePath_ = filePath;
+
+#ifndef _WIN32
+   int fd = ::open(filePath.absolutePath().c_str(), O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+   {
+      Error error = systemError(errno, ERROR_LOCATION);
+      error.addProperty("path", filePath);
+      return error;
+   }
+
+   struct stat info;
+   if (::fstat(fd, &info) == -1)
+   {
+      Error error = systemError(errno, ERROR_LOCATION);
+      error.addProperty("path", filePath);
+      ::close(fd);
+      return error;
+   }
+   pFile->lastWriteTime_ = info.st_mtime;
+   pFile->size_ = static_cast<std::size_t>(info.st_size);
+
+   // (empty files can't be mapped)
+   if (pFile->size_ == 0)
+   {
+      pFile->pData_ = pFile->contents_.data();
+      ::close(fd);
+      *pMappedFile = pFile;
+      return Success();
+   }
+
+   void* pData = ::mmap(NULL, pFile->size_, PROT_READ, MAP_SHARED, fd, 0);
+   int mapErrno = errno;
+   ::close(fd);
+   if (pData == MAP_FAILED)
+   {
+      Error error = systemError(mapErrno, ERROR_LOCATION);
+      error.addProperty("path", filePath);
+      return error;
+   }
+
+   // prefetch (resources are generally read in their entirety)
+   ::madvise(pData, pFile->size_, MADV_WILLNEED);
+
+   pFile->pData_ = static_cast<const char*>(pData);
+#else
+   pFile->lastWriteTime_ = filePath.lastWriteTime();
+   Error error = readStringFromFile(filePath, &pFile->contents_);
+   if (error)
+      return error;
+   pFile->pData_ = pFile->contents_.data();
+   pFile->size_ = pFile->contents_.size();
+#endif
+
+   *pMappedFile = pFile;
+   return Success();
+}
+
+Error mappedResource(const FilePath& filePath,
+                     boost::shared_ptr<const MappedFile>* pMappedFile)
+{
+   // use the mapped file if the file hasn't changed since it was mapped
+   std::string key = filePath.absolutePath();
+   boost::shared_ptr<const MappedFile> pCached;
+   if (resourceCache().get(key, &pCached) &&
+       pCached->lastWriteTime() == filePath.lastWriteTime() &&
+       pCached->size() == filePath.size())
+   {
+      *pMappedFile = pCached;
+      return Success();
+   }
+
+   boost::shared_ptr<MappedFile> pFile;
+   Error error = MappedFile::open(filePath, &pFile);
+   if (error)
+   {
+      resourceCache().remove(key);
+      return error;
+   }
+
+   resourceCache().insert(key, pFile);
+   *pMappedFile = pFile;
+   return Success();
+}
+
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,194 @@
+/*
+ * MemoryAccounting.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/MemoryAccounting.hpp>
+
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
+#include <core/Error.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/Thread.hpp>
+
+namespace rstudio {
+namespace core {
+namespace memory_accounting {
+
+namespace {
+
+struct Subsystem
+{
+   Subsystem() : evictions(0) {}
+
+   UsageFunction usage;
+   EvictFunction evict;
+   std::size_t evictions;
+};
+
+boost::mutex s_mutex;
+std::map<std::string, Subsystem> s_subsystems;
+std::map<std::string, std::size_t> s_budgets;
+
+Error invalidBudget(const std::string& budget, const ErrorLocation& location)
+{
+   return systemError(boost::system::errc::invalid_argument,
+                      "Invalid memory budget '" + budget + "'",
+                      location);
+}
+
+bool parseSize(std::string size, std::size_t* pBytes)
+{
+   if (size.empty())
+      return false;
+
+   std::size_t multiplier = 1;
+   switch (size[size.size() - 1])
+   {
+   case 'K': case 'k':
+      multiplier = 1024;
+      break;
+   case 'M': case 'm':
+      multiplier = 1024 * 1024;
+      break;
+   case 'G': case 'g':
+      multiplier = 1024 * 1024 * 1024;
+      break;
+   }
+   if (multiplier != 1)
+      size.erase(size.size() - 1);
+
+   if (size.empty() || size.find_first_not_of("0123456789") != std::string::npos)
+      return false;
+
+   std::size_t value = safe_convert::stringTo<std::size_t>(size, 0);
+   if (value > static_cast<std::size_t>(-1) / multiplier)
+      return false;
+
+   *pBytes = value * multiplier;
+   return true;
+}
+
+} // anonymous namespace
+
+void registerSubsystem(const std::string& name,
+                       const UsageFunction& usage,
+                       const EvictFunction& evict)
+{
+   LOCK_MUTEX(s_mutex)
+   {
+      Subsystem& subsystem = s_subsystems[name];
+      subsystem.usage = usage;
+      subsystem.evict = evict;
+   }
+   END_LOCK_MUTEX
+}
+
+void setBudget(const std::string& name, std::size_t bytes)
+{
+   LOCK_MUTEX(s_mutex)
+   {
+      if (bytes == 0)
+         s_budgets.erase(name);
+      else
+         s_budgets[name] = bytes;
+   }
+   END_LOCK_MUTEX
+}
+
+Error parseBudgets(const std::string& budgets,
+                   std::map<std::string, std::size_t>* pBudgets)
+{
+   std::vector<std::string> entries;
+   boost::algorithm::split(entries, budgets, boost::algorithm::is_any_of(","));
+   BOOST_FOREACH(std::string entry, entries)
+   {
+      boost::algorithm::trim(entry);
+      if (entry.empty())
+         continue;
+
+      std::string::size_type equals = entry.find('=');
+      if (equals == std::string::npos)
+         return invalidBudget(entry, ERROR_LOCATION);
+
+      std::string name = boost::algorithm::trim_copy(entry.substr(0, equals));
+      std::size_t bytes = 0;
+      if (name.empty() ||
+          !parseSize(boost::algorithm::trim_copy(entry.substr(equals + 1)), &bytes))
+      {
+         return invalidBudget(entry, ERROR_LOCATION);
+      }
+
+      (*pBudgets)[name] = bytes;
+   }
+
+   return Success();
+}
+
+std::vector<SubsystemStats> collect()
+{
+   // copy the subsystems so that their functions are called without the
+   // lock held (they may take locks of their own)
+   std::map<std::string, Subsystem> subsystems;
+   std::map<std::string, std::size_t> budgets;
+   LOCK_MUTEX(s_mutex)
+   {
+      subsystems = s_subsystems;
+      budgets = s_budgets;
+   }
+   END_LOCK_MUTEX
+
+   std::vector<SubsystemStats> stats;
+   for (std::map<std::string, Subsystem>::const_iterator it = subsystems.begin();
+        it != subsystems.end();
+        ++it)
+   {
+      const Subsystem& subsystem = it->second;
+
+      SubsystemStats subsystemStats;
+      subsystemStats.name = it->first;
+      subsystemStats.evictable = !subsystem.evict.empty();
+      subsystemStats.evictions = subsystem.evictions;
+
+      std::map<std::string, std::size_t>::const_iterator budget =
+                                                   budgets.find(it->first);
+      if (budget != budgets.end())
+         subsystemStats.budget = budget->second;
+
+      subsystemStats.usage = subsystem.usage();
+      if (subsystemStats.evictable &&
+          subsystemStats.budget > 0 &&
+          subsystemStats.usage.bytes > subsystemStats.budget)
+      {
+         subsystem.evict(subsystemStats.budget);
+         subsystemStats.usage = subsystem.usage();
+         subsystemStats.evictions++;
+
+         LOCK_MUTEX(s_mutex)
+         {
+            s_subsystems[it->first].evictions++;
+         }
+         END_LOCK_MUTEX
+      }
+
+      stats.push_back(subsystemStats);
+   }
+
+   return stats;
+}
+
+} // namespace memory_accounting
+} // namespace core
+} // namespace rstudio
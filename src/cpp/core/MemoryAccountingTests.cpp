@@ -0,0 +1,105 @@
+/*
+ * MemoryAccountingTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/MemoryAccounting.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include <core/Error.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace memory_accounting {
+namespace tests {
+
+namespace {
+
+std::size_t s_cacheBytes = 0;
+
+Usage cacheUsage()
+{
+   return Usage(s_cacheBytes, s_cacheBytes / 100);
+}
+
+void evictCache(std::size_t bytes)
+{
+   s_cacheBytes = bytes / 2;
+}
+
+SubsystemStats statsFor(const std::string& name)
+{
+   BOOST_FOREACH(const SubsystemStats& stats, collect())
+   {
+      if (stats.name == name)
+         return stats;
+   }
+   return SubsystemStats();
+}
+
+} // anonymous namespace
+
+context("Memory accounting")
+{
+   test_that("Budgets are parsed")
+   {
+      std::map<std::string, std::size_t> budgets;
+      expect_false(parseBudgets("data-viewer=256M, clang=1G,history=100", &budgets));
+      expect_true(budgets.size() == 3);
+      expect_true(budgets["data-viewer"] == 256 * 1024 * 1024);
+      expect_true(budgets["clang"] == 1024 * 1024 * 1024);
+      expect_true(budgets["history"] == 100);
+
+      expect_false(parseBudgets("", &budgets));
+      expect_true(parseBudgets("clang", &budgets));
+      expect_true(parseBudgets("clang=", &budgets));
+      expect_true(parseBudgets("clang=12X", &budgets));
+      expect_true(parseBudgets("=12", &budgets));
+   }
+
+   test_that("Subsystems are measured and kept within budget")
+   {
+      s_cacheBytes = 10000;
+      registerSubsystem("test-cache", cacheUsage, evictCache);
+
+      SubsystemStats stats = statsFor("test-cache");
+      expect_true(stats.usage.bytes == 10000);
+      expect_true(stats.usage.entries == 100);
+      expect_true(stats.evictable);
+      expect_true(stats.evictions == 0);
+
+      setBudget("test-cache", 4000);
+      stats = statsFor("test-cache");
+      expect_true(stats.budget == 4000);
+      expect_true(stats.usage.bytes == 2000);
+      expect_true(stats.evictions == 1);
+
+      // within budget, so no further evictions
+      stats = statsFor("test-cache");
+      expect_true(stats.evictions == 1);
+
+      setBudget("test-cache", 0);
+      s_cacheBytes = 10000;
+      stats = statsFor("test-cache");
+      expect_true(stats.usage.bytes == 10000);
+   }
+}
+
+} // namespace tests
+} // namespace memory_accounting
+} // namespace core
+} // namespace rstudio
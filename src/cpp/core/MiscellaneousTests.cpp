@@ -208,6 +208,24 @@ context("LruCache")
       expect_true(cache.get(5000, &val));
       expect_false(cache.get(900, &val));
    }
+   test_that("Clearing the cache removes all entries")
+   {
+      LruCache<int, int> cache(10);
+      for (int i = 0; i < 10; ++i)
+      {
+         cache.insert(i, i);
+      }
+
+      cache.clear();
+      expect_true(cache.size() == 0);
+
+      int val;
+      expect_false(cache.get(5, &val));
+
+      cache.insert(5, 5);
+      expect_true(cache.get(5, &val));
+      expect_true(val == 5);
+   }
 }
 
 } // namespace unit_tests
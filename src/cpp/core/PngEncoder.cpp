@@ -0,0 +1,170 @@
+/*
+ * PngEncoder.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/PngEncoder.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <zlib.h>
+
+#include <core/Error.hpp>
+
+namespace rstudio {
+namespace core {
+namespace png {
+
+namespace {
+
+const unsigned char kSignature[] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+
+// png color types
+const char kColorTypeRgb = 2;
+const char kColorTypeRgba = 6;
+
+// png row filter which stores each byte as the difference from the byte
+// above it (cheap, and effective for plots)
+const unsigned char kFilterUp = 2;
+
+void appendUInt32(boost::uint32_t value, std::string* pOutput)
+{
+   pOutput->push_back(static_cast<char>((value >> 24) & 0xFF));
+   pOutput->push_back(static_cast<char>((value >> 16) & 0xFF));
+   pOutput->push_back(static_cast<char>((value >> 8) & 0xFF));
+   pOutput->push_back(static_cast<char>(value & 0xFF));
+}
+
+void appendChunk(const char* type,
+                 const void* data,
+                 std::size_t size,
+                 std::string* pOutput)
+{
+   appendUInt32(static_cast<boost::uint32_t>(size), pOutput);
+   pOutput->append(type, 4);
+   if (size > 0)
+      pOutput->append(static_cast<const char*>(data), size);
+
+   // the crc covers the type and the data
+   uLong crc = ::crc32(0L, Z_NULL, 0);
+   crc = ::crc32(crc, reinterpret_cast<const Bytef*>(type), 4);
+   crc = ::crc32(crc, static_cast<const Bytef*>(data), static_cast<uInt>(size));
+   appendUInt32(static_cast<boost::uint32_t>(crc), pOutput);
+}
+
+bool isOpaque(const boost::uint32_t* pixels, std::size_t count)
+{
+   for (std::size_t i = 0; i < count; i++)
+   {
+      if ((pixels[i] >> 24) != 0xFF)
+         return false;
+   }
+   return true;
+}
+
+// the filtered scanlines (each preceded by its filter type)
+void filterRows(const boost::uint32_t* pixels,
+                int width,
+                int height,
+                int bytesPerPixel,
+                std::vector<unsigned char>* pRows)
+{
+   std::size_t rowSize = 1 + static_cast<std::size_t>(width) * bytesPerPixel;
+   pRows->resize(rowSize * height);
+
+   std::vector<unsigned char> previous(rowSize - 1, 0);
+   std::vector<unsigned char> current(rowSize - 1);
+   for (int y = 0; y < height; y++)
+   {
+      const boost::uint32_t* row = pixels + static_cast<std::size_t>(y) * width;
+      unsigned char* pCurrent = &current[0];
+      for (int x = 0; x < width; x++)
+      {
+         boost::uint32_t pixel = row[x];
+         *pCurrent++ = static_cast<unsigned char>(pixel & 0xFF);
+         *pCurrent++ = static_cast<unsigned char>((pixel >> 8) & 0xFF);
+         *pCurrent++ = static_cast<unsigned char>((pixel >> 16) & 0xFF);
+         if (bytesPerPixel == 4)
+            *pCurrent++ = static_cast<unsigned char>(pixel >> 24);
+      }
+
+      unsigned char* pOutput = &(*pRows)[y * rowSize];
+      *pOutput++ = kFilterUp;
+      for (std::size_t i = 0; i < current.size(); i++)
+         pOutput[i] = static_cast<unsigned char>(current[i] - previous[i]);
+
+      previous.swap(current);
+   }
+}
+
+} // anonymous namespace
+
+Error encodeRgba(const boost::uint32_t* pixels,
+                 int width,
+                 int height,
+                 int compressionLevel,
+                 std::string* pPng)
+{
+   if (width <= 0 || height <= 0)
+      return systemError(boost::system::errc::invalid_argument, ERROR_LOCATION);
+
+   std::size_t count = static_cast<std::size_t>(width) * height;
+   bool opaque = isOpaque(pixels, count);
+   int bytesPerPixel = opaque ? 3 : 4;
+
+   std::vector<unsigned char> rows;
+   filterRows(pixels, width, height, bytesPerPixel, &rows);
+
+   // compress the scanlines (as a single zlib stream)
+   uLongf compressedSize = ::compressBound(static_cast<uLong>(rows.size()));
+   std::vector<unsigned char> compressed(compressedSize);
+   int result = ::compress2(&compressed[0],
+                            &compressedSize,
+                            &rows[0],
+                            static_cast<uLong>(rows.size()),
+                            std::min(std::max(compressionLevel, 0),
+                                     kBestCompression));
+   if (result != Z_OK)
+   {
+      Error error = systemError(result == Z_MEM_ERROR ?
+                                   boost::system::errc::not_enough_memory :
+                                   boost::system::errc::io_error,
+                                ERROR_LOCATION);
+      error.addProperty("zlib-result", result);
+      return error;
+   }
+
+   std::string header;
+   appendUInt32(static_cast<boost::uint32_t>(width), &header);
+   appendUInt32(static_cast<boost::uint32_t>(height), &header);
+   header.push_back(8); // bits per channel
+   header.push_back(opaque ? kColorTypeRgb : kColorTypeRgba);
+   header.push_back(0); // deflate compression
+   header.push_back(0); // adaptive filtering
+   header.push_back(0); // no interlacing
+
+   std::string png;
+   png.reserve(sizeof(kSignature) + header.size() + compressedSize + 64);
+   png.append(reinterpret_cast<const char*>(kSignature), sizeof(kSignature));
+   appendChunk("IHDR", header.data(), header.size(), &png);
+   appendChunk("IDAT", &compressed[0], compressedSize, &png);
+   appendChunk("IEND", NULL, 0, &png);
+
+   pPng->swap(png);
+   return Success();
+}
+
+} // namespace png
+} // namespace core
+} // namespace rstudio
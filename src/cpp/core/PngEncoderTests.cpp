@@ -0,0 +1,147 @@
+/*
+ * PngEncoderTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/PngEncoder.hpp>
+
+#include <vector>
+
+#include <zlib.h>
+
+#include <core/Error.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace png {
+namespace tests {
+
+namespace {
+
+boost::uint32_t readUInt32(const std::string& data, std::size_t offset)
+{
+   const unsigned char* bytes =
+         reinterpret_cast<const unsigned char*>(data.data() + offset);
+   return (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+struct DecodedPng
+{
+   int width;
+   int height;
+   int colorType;
+   std::vector<unsigned char> pixels;
+};
+
+// decode the output of encodeRgba (a single IDAT chunk, 'up' filtered rows)
+void decode(const std::string& png, DecodedPng* pDecoded)
+{
+   REQUIRE(png.substr(0, 8) == "\x89PNG\r\n\x1a\n");
+   REQUIRE(png.substr(12, 4) == "IHDR");
+   pDecoded->width = readUInt32(png, 16);
+   pDecoded->height = readUInt32(png, 20);
+   pDecoded->colorType = png[25];
+
+   std::size_t idat = 8 + 12 + 13;
+   REQUIRE(png.substr(idat + 4, 4) == "IDAT");
+   std::size_t idatSize = readUInt32(png, idat);
+   REQUIRE(png.substr(idat + 12 + idatSize + 4, 4) == "IEND");
+
+   // the chunk crc covers the type and data
+   uLong crc = ::crc32(0L, Z_NULL, 0);
+   crc = ::crc32(crc,
+                 reinterpret_cast<const Bytef*>(png.data() + idat + 4),
+                 static_cast<uInt>(idatSize + 4));
+   REQUIRE(crc == readUInt32(png, idat + 8 + idatSize));
+
+   int bytesPerPixel = pDecoded->colorType == 6 ? 4 : 3;
+   std::size_t rowSize = 1 + pDecoded->width * bytesPerPixel;
+   std::vector<unsigned char> rows(rowSize * pDecoded->height);
+   uLongf rowsSize = static_cast<uLongf>(rows.size());
+   REQUIRE(::uncompress(&rows[0],
+                        &rowsSize,
+                        reinterpret_cast<const Bytef*>(png.data() + idat + 8),
+                        static_cast<uLong>(idatSize)) == Z_OK);
+   REQUIRE(rowsSize == rows.size());
+
+   std::vector<unsigned char> previous(rowSize - 1, 0);
+   for (int y = 0; y < pDecoded->height; y++)
+   {
+      REQUIRE(rows[y * rowSize] == 2);
+      for (std::size_t i = 0; i < rowSize - 1; i++)
+      {
+         previous[i] = static_cast<unsigned char>(
+                  rows[y * rowSize + 1 + i] + previous[i]);
+         pDecoded->pixels.push_back(previous[i]);
+      }
+   }
+}
+
+} // anonymous namespace
+
+context("PngEncoder")
+{
+   test_that("Opaque images are encoded as RGB")
+   {
+      boost::uint32_t pixels[] = {
+         0xFF0000FF, 0xFF00FF00, 0xFFFF0000,
+         0xFFFFFFFF, 0xFF000000, 0xFF102030
+      };
+
+      std::string png;
+      REQUIRE_FALSE(encodeRgba(pixels, 3, 2, kFastestCompression, &png));
+
+      DecodedPng decoded;
+      decode(png, &decoded);
+      expect_true(decoded.width == 3);
+      expect_true(decoded.height == 2);
+      expect_true(decoded.colorType == 2);
+
+      unsigned char expected[] = {
+         255, 0, 0,   0, 255, 0,   0, 0, 255,
+         255, 255, 255,   0, 0, 0,   0x30, 0x20, 0x10
+      };
+      expect_true(decoded.pixels ==
+                  std::vector<unsigned char>(expected, expected + 18));
+   }
+
+   test_that("Transparent images are encoded as RGBA")
+   {
+      boost::uint32_t pixels[] = { 0x00FFFFFF, 0x80112233 };
+
+      std::string png;
+      REQUIRE_FALSE(encodeRgba(pixels, 1, 2, kBestCompression, &png));
+
+      DecodedPng decoded;
+      decode(png, &decoded);
+      expect_true(decoded.colorType == 6);
+
+      unsigned char expected[] = { 255, 255, 255, 0,   0x33, 0x22, 0x11, 0x80 };
+      expect_true(decoded.pixels ==
+                  std::vector<unsigned char>(expected, expected + 8));
+   }
+
+   test_that("Empty images can't be encoded")
+   {
+      boost::uint32_t pixel = 0;
+      std::string png;
+      expect_true(encodeRgba(&pixel, 0, 1, kFastestCompression, &png));
+   }
+}
+
+} // namespace tests
+} // namespace png
+} // namespace core
+} // namespace rstudio
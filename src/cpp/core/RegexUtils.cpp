@@ -26,11 +26,41 @@
 #include <boost/iostreams/filtering_stream.hpp>
 
 #include <core/StringUtils.hpp>
+#include <core/collection/LruCache.hpp>
 
 namespace rstudio {
 namespace core {
 namespace regex_utils {
 
+namespace {
+
+typedef std::pair<std::string, boost::regex::flag_type> RegexKey;
+
+// compiled regexes share their state when copied, so copies out of the
+// cache are cheap (and safe to use from any thread)
+collection::LruCache<RegexKey, boost::regex>& regexCache()
+{
+   static collection::LruCache<RegexKey, boost::regex>* pCache =
+         new collection::LruCache<RegexKey, boost::regex>(256);
+   return *pCache;
+}
+
+} // anonymous namespace
+
+boost::regex compiledRegex(const std::string& pattern,
+                           boost::regex::flag_type flags)
+{
+   RegexKey key = std::make_pair(pattern, flags);
+   boost::regex regex;
+   if (regexCache().get(key, &regex))
+      return regex;
+
+   // (throws if the pattern is invalid, as constructing the regex does)
+   regex = boost::regex(pattern, flags);
+   regexCache().insert(key, regex);
+   return regex;
+}
+
 boost::regex wildcardPatternToRegex(const std::string& pattern)
 {
    // split into componenents
@@ -48,7 +78,7 @@ boost::regex wildcardPatternToRegex(const std::string& pattern)
       regex.append(components.at(i));
       regex.append("\\E");
    }
-   return boost::regex(regex);
+   return compiledRegex(regex);
 }
 
 boost::regex regexIfWildcardPattern(const std::string& term)
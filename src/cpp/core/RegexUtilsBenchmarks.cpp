@@ -0,0 +1,92 @@
+/*
+ * RegexUtilsBenchmarks.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/RegexUtils.hpp>
+
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+
+#include <tests/Benchmark.hpp>
+
+namespace rstudio {
+namespace core {
+namespace regex_utils {
+
+namespace {
+
+const char * const kGccErrorPattern =
+      "(?:from (.+?):([0-9]+?).+?\\n)?"
+      "^(.+?):([0-9]+?):(?:([0-9]+?):)? (error|warning): (.+)$";
+
+// the output of a package build which succeeded (compiler command lines)
+const std::string& cleanBuildOutput()
+{
+   static std::string output;
+   if (output.empty())
+   {
+      for (int i = 0; i < 500; i++)
+      {
+         output += "g++ -std=gnu++11 -I/usr/share/R/include -DNDEBUG "
+                   "-I\"/usr/lib/R/site-library/Rcpp/include\" -fpic -g -O2 "
+                   "-c source_" + boost::lexical_cast<std::string>(i) +
+                   ".cpp -o source_" + boost::lexical_cast<std::string>(i) +
+                   ".o\n";
+      }
+   }
+   return output;
+}
+
+} // anonymous namespace
+
+BENCHMARK(RegexUtils, wildcard_compile)
+{
+   for (std::size_t i = 0; i < iterations; i++)
+      tests::benchmark::doNotOptimize(boost::regex("\\Qsession\\E.*\\QSearch\\E"));
+}
+
+BENCHMARK(RegexUtils, wildcard_compile_cached)
+{
+   for (std::size_t i = 0; i < iterations; i++)
+      tests::benchmark::doNotOptimize(wildcardPatternToRegex("session*Search"));
+}
+
+BENCHMARK(RegexUtils, gcc_errors_scan)
+{
+   static boost::regex re(kGccErrorPattern);
+   const std::string& output = cleanBuildOutput();
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      boost::sregex_iterator iter(output.begin(), output.end(), re,
+                                  boost::regex_constants::match_not_dot_newline);
+      tests::benchmark::doNotOptimize(iter == boost::sregex_iterator());
+   }
+}
+
+BENCHMARK(RegexUtils, gcc_errors_prefilter)
+{
+   // the check build error parsing makes before scanning with the regex
+   const std::string& output = cleanBuildOutput();
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      tests::benchmark::doNotOptimize(
+               output.find("error: ") == std::string::npos &&
+               output.find("warning: ") == std::string::npos);
+   }
+}
+
+} // namespace regex_utils
+} // namespace core
+} // namespace rstudio
@@ -15,26 +15,234 @@
 
 #include <core/Settings.hpp>
 
+#include <boost/thread.hpp>
+
 #include <core/Log.hpp>
 #include <core/FilePath.hpp>
 #include <core/SafeConvert.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/Thread.hpp>
+#include <core/system/System.hpp>
 
 namespace rstudio {
 namespace core {
 
+namespace {
+
+typedef std::map<std::string, std::string> SettingsMap;
+
+Error writeSettingsFile(const FilePath& settingsFile,
+                        const SettingsMap& settingsMap)
+{
+   // write to a temporary file and then rename it over the settings so that
+   // they are never seen (or left) partially written. symlinks are written
+   // through so they aren't replaced
+   if (!settingsFile.isSymlink())
+   {
+      FilePath tempFile = settingsFile.parent().complete(
+               "." + settingsFile.filename() + "-" +
+               safe_convert::numberToString(core::system::currentProcessId()) +
+               ".tmp");
+      Error error = core::writeStringMapToFile(tempFile, settingsMap);
+      if (!error)
+      {
+         error = tempFile.move(settingsFile, FilePath::MoveDirect);
+         if (!error)
+            return Success();
+
+         tempFile.removeIfExists();
+      }
+   }
+
+   // fall back to writing the file in place (e.g. we can't create files
+   // in its directory)
+   return core::writeStringMapToFile(settingsFile, settingsMap);
+}
+
+// writes the deferred changes of settings on a background thread
+class DeferredWriter : boost::noncopyable
+{
+public:
+   DeferredWriter() : started_(false) {}
+
+   void schedule(const FilePath& settingsFile,
+                 const SettingsMap& settingsMap,
+                 const boost::posix_time::time_duration& delay)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         // replace any pending write of the file (but keep its due time so
+         // that a steady stream of changes is still written)
+         PendingWrite& pending = pending_[settingsFile.absolutePath()];
+         if (pending.settingsFile.empty())
+         {
+            pending.settingsFile = settingsFile;
+            pending.due = boost::get_system_time() + delay;
+         }
+         pending.settingsMap = settingsMap;
+
+         if (!started_)
+         {
+            started_ = true;
+            core::thread::safeLaunchThread(
+                     boost::bind(&DeferredWriter::run, this));
+         }
+      }
+      END_LOCK_MUTEX
+
+      condition_.notify_all();
+   }
+
+   void flush(const FilePath& settingsFile)
+   {
+      // (writes are serialized so this waits for a write of the file which
+      // is already underway)
+      LOCK_MUTEX(writeMutex_)
+      {
+         PendingWrite pending;
+         if (take(settingsFile.absolutePath(), &pending))
+            write(pending);
+      }
+      END_LOCK_MUTEX
+   }
+
+   void flushAll()
+   {
+      LOCK_MUTEX(writeMutex_)
+      {
+         std::map<std::string, PendingWrite> pending;
+         LOCK_MUTEX(mutex_)
+         {
+            pending.swap(pending_);
+         }
+         END_LOCK_MUTEX
+
+         for (std::map<std::string, PendingWrite>::const_iterator it =
+                  pending.begin(); it != pending.end(); ++it)
+         {
+            write(it->second);
+         }
+      }
+      END_LOCK_MUTEX
+   }
+
+private:
+   struct PendingWrite
+   {
+      FilePath settingsFile;
+      SettingsMap settingsMap;
+      boost::system_time due;
+   };
+
+   bool take(const std::string& path, PendingWrite* pPending)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         std::map<std::string, PendingWrite>::iterator it =
+                                                      pending_.find(path);
+         if (it == pending_.end())
+            return false;
+
+         *pPending = it->second;
+         pending_.erase(it);
+         return true;
+      }
+      END_LOCK_MUTEX
+
+      return false;
+   }
+
+   void write(const PendingWrite& pending)
+   {
+      Error error = writeSettingsFile(pending.settingsFile,
+                                      pending.settingsMap);
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   void run()
+   {
+      try
+      {
+         while (true)
+         {
+            // wait for the next write to come due
+            std::string path;
+            {
+               boost::unique_lock<boost::mutex> lock(mutex_);
+               while (true)
+               {
+                  if (pending_.empty())
+                  {
+                     condition_.wait(lock);
+                     continue;
+                  }
+
+                  std::map<std::string, PendingWrite>::const_iterator next =
+                                                            pending_.begin();
+                  for (std::map<std::string, PendingWrite>::const_iterator it =
+                           pending_.begin(); it != pending_.end(); ++it)
+                  {
+                     if (it->second.due < next->second.due)
+                        next = it;
+                  }
+
+                  if (next->second.due <= boost::get_system_time())
+                  {
+                     path = next->first;
+                     break;
+                  }
+
+                  condition_.timed_wait(lock, next->second.due);
+               }
+            }
+
+            flush(FilePath(path));
+         }
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   boost::mutex mutex_;
+   boost::condition_variable condition_;
+   std::map<std::string, PendingWrite> pending_;
+   bool started_;
+
+   // held while writing
+   boost::mutex writeMutex_;
+};
+
+DeferredWriter& deferredWriter()
+{
+   // intentionally leaked so that writes can still be flushed during exit
+   static DeferredWriter* pWriter = new DeferredWriter();
+   return *pWriter;
+}
+
+} // anonymous namespace
+
 Settings::Settings()
    : updatePending_(false),
-     isDirty_(false)
+     isDirty_(false),
+     writeDelay_(boost::posix_time::not_a_date_time)
 {
 }
 
 Settings::~Settings()
 {
+   try
+   {
+      flush();
+   }
+   CATCH_UNEXPECTED_EXCEPTION
 }
 
 Error Settings::initialize(const FilePath& filePath) 
 {
+   // write any changes we haven't yet so they aren't lost (or later
+   // overwrite what we're reading)
+   flush();
+
    settingsFile_ = filePath ;
    settingsMap_.clear() ;
    Error error = core::readStringMapFromFile(settingsFile_, &settingsMap_) ;
@@ -146,10 +354,33 @@ void Settings::endUpdate()
       writeSettings();
 }
 
+void Settings::setWriteDelay(const boost::posix_time::time_duration& delay)
+{
+   writeDelay_ = delay;
+}
+
+void Settings::flush()
+{
+   if (!writeDelay_.is_not_a_date_time() && !settingsFile_.empty())
+      deferredWriter().flush(settingsFile_);
+}
+
+void Settings::flushAll()
+{
+   deferredWriter().flushAll();
+}
+
 void Settings::writeSettings() 
 {
    isDirty_ = false;
-   Error error = core::writeStringMapToFile(settingsFile_, settingsMap_) ; 
+
+   if (!writeDelay_.is_not_a_date_time())
+   {
+      deferredWriter().schedule(settingsFile_, settingsMap_, writeDelay_);
+      return;
+   }
+
+   Error error = writeSettingsFile(settingsFile_, settingsMap_) ;
    if (error)
      LOG_ERROR(error);
 }
@@ -0,0 +1,113 @@
+/*
+ * SettingsTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/Settings.hpp>
+
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+namespace {
+
+FilePath settingsFile()
+{
+   FilePath dir;
+   REQUIRE_FALSE(FilePath::tempFilePath(&dir));
+   REQUIRE_FALSE(dir.ensureDirectory());
+   return dir.complete("settings");
+}
+
+std::string readValue(const FilePath& file, const std::string& name)
+{
+   Settings settings;
+   REQUIRE_FALSE(settings.initialize(file));
+   return settings.get(name);
+}
+
+} // anonymous namespace
+
+context("Settings")
+{
+   test_that("Settings are written when changed")
+   {
+      FilePath file = settingsFile();
+      Settings settings;
+      REQUIRE_FALSE(settings.initialize(file));
+      settings.set("name", std::string("value"));
+
+      expect_true(readValue(file, "name") == "value");
+
+      // no temporary files are left behind
+      std::vector<FilePath> children;
+      REQUIRE_FALSE(file.parent().children(&children));
+      expect_true(children.size() == 1);
+   }
+
+   test_that("Deferred writes are written when flushed")
+   {
+      FilePath file = settingsFile();
+      Settings settings;
+      REQUIRE_FALSE(settings.initialize(file));
+      settings.setWriteDelay(boost::posix_time::hours(1));
+      settings.set("first", 1);
+      settings.set("second", 2);
+
+      expect_false(file.exists());
+
+      settings.flush();
+      expect_true(readValue(file, "first") == "1");
+      expect_true(readValue(file, "second") == "2");
+   }
+
+   test_that("Deferred writes are written in the background")
+   {
+      FilePath file = settingsFile();
+      Settings settings;
+      REQUIRE_FALSE(settings.initialize(file));
+      settings.setWriteDelay(boost::posix_time::milliseconds(10));
+      settings.set("name", std::string("value"));
+
+      for (int i = 0; i < 500 && !file.exists(); i++)
+         boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+
+      expect_true(readValue(file, "name") == "value");
+   }
+
+   test_that("All deferred writes can be flushed")
+   {
+      FilePath file = settingsFile();
+      Settings settings;
+      REQUIRE_FALSE(settings.initialize(file));
+      settings.setWriteDelay(boost::posix_time::hours(1));
+      settings.set("name", std::string("value"));
+
+      Settings::flushAll();
+      expect_true(readValue(file, "name") == "value");
+   }
+}
+
+} // namespace tests
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,226 @@
+/*
+ * StartupTrace.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/StartupTrace.hpp>
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Thread.hpp>
+#include <core/json/Json.hpp>
+#include <core/system/System.hpp>
+
+using namespace boost::posix_time;
+
+namespace rstudio {
+namespace core {
+namespace startup_trace {
+
+namespace {
+
+// steps are recorded from the main thread almost exclusively, but the
+// mutex makes the occasional background step safe
+boost::mutex s_mutex;
+bool s_enabled = false;
+ptime s_traceStart;
+std::vector<Step> s_steps;
+
+Error runTraced(const std::string& name,
+                const std::string& category,
+                const ExecBlock::Function& function)
+{
+   Scope scope(name, category);
+   return function();
+}
+
+bool isSlower(const Step& lhs, const Step& rhs)
+{
+   return lhs.wall > rhs.wall;
+}
+
+double toMicroseconds(const time_duration& duration)
+{
+   return static_cast<double>(duration.total_microseconds());
+}
+
+} // anonymous namespace
+
+void enable()
+{
+   LOCK_MUTEX(s_mutex)
+   {
+      s_enabled = true;
+      s_traceStart = microsec_clock::universal_time();
+      s_steps.clear();
+   }
+   END_LOCK_MUTEX
+}
+
+bool enabled()
+{
+   return s_enabled;
+}
+
+Timestamp now()
+{
+   Timestamp timestamp;
+   timestamp.wall = microsec_clock::universal_time();
+   timestamp.cpuSeconds = static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+   return timestamp;
+}
+
+void record(const std::string& name,
+            const std::string& category,
+            const Timestamp& start)
+{
+   if (!s_enabled)
+      return;
+
+   Timestamp end = now();
+
+   Step step;
+   step.name = name;
+   step.category = category;
+   step.start = start.wall;
+   step.wall = end.wall - start.wall;
+   step.cpuSeconds = end.cpuSeconds - start.cpuSeconds;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      if (s_enabled)
+         s_steps.push_back(step);
+   }
+   END_LOCK_MUTEX
+}
+
+Scope::Scope(const std::string& name, const std::string& category)
+   : enabled_(s_enabled)
+{
+   if (enabled_)
+   {
+      name_ = name;
+      category_ = category;
+      start_ = now();
+   }
+}
+
+Scope::~Scope()
+{
+   try
+   {
+      if (enabled_)
+         record(name_, category_, start_);
+   }
+   catch(...)
+   {
+   }
+}
+
+ExecBlock::Function traced(const std::string& name,
+                           const std::string& category,
+                           const ExecBlock::Function& function)
+{
+   if (!s_enabled)
+      return function;
+
+   return boost::bind(runTraced, name, category, function);
+}
+
+std::vector<Step> finish()
+{
+   std::vector<Step> steps;
+   LOCK_MUTEX(s_mutex)
+   {
+      s_enabled = false;
+      steps.swap(s_steps);
+   }
+   END_LOCK_MUTEX
+   return steps;
+}
+
+Error writeChromeTrace(const std::vector<Step>& steps, const FilePath& file)
+{
+   // timestamps are relative to the earliest step so the trace starts at 0
+   ptime origin = s_traceStart;
+   for (std::vector<Step>::const_iterator it = steps.begin();
+        it != steps.end();
+        ++it)
+   {
+      if (origin.is_not_a_date_time() || it->start < origin)
+         origin = it->start;
+   }
+
+   double pid = static_cast<double>(core::system::currentProcessId());
+
+   json::Array events;
+   for (std::vector<Step>::const_iterator it = steps.begin();
+        it != steps.end();
+        ++it)
+   {
+      json::Object args;
+      args["cpu_ms"] = it->cpuSeconds * 1000;
+
+      json::Object event;
+      event["name"] = it->name;
+      event["cat"] = it->category;
+      event["ph"] = "X";
+      event["ts"] = toMicroseconds(it->start - origin);
+      event["dur"] = toMicroseconds(it->wall);
+      event["pid"] = pid;
+      event["tid"] = 1;
+      event["args"] = args;
+      events.push_back(event);
+   }
+
+   json::Object trace;
+   trace["traceEvents"] = events;
+   trace["displayTimeUnit"] = "ms";
+
+   return writeStringToFile(file, json::write(trace));
+}
+
+std::string summary(const std::vector<Step>& steps, std::size_t maxSteps)
+{
+   std::vector<Step> sorted = steps;
+   std::stable_sort(sorted.begin(), sorted.end(), isSlower);
+   if (sorted.size() > maxSteps)
+      sorted.resize(maxSteps);
+
+   std::ostringstream ostr;
+   ostr << "Slowest startup steps (wall ms / cpu ms):";
+   for (std::vector<Step>::const_iterator it = sorted.begin();
+        it != sorted.end();
+        ++it)
+   {
+      ostr << std::endl << "   "
+           << std::fixed << std::setprecision(1)
+           << toMicroseconds(it->wall) / 1000 << " / "
+           << it->cpuSeconds * 1000 << "  "
+           << "[" << it->category << "] " << it->name;
+   }
+   return ostr.str();
+}
+
+} // namespace startup_trace
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,89 @@
+/*
+ * StartupTraceTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/StartupTrace.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/json/Json.hpp>
+#include <core/system/System.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace startup_trace {
+namespace tests {
+
+namespace {
+
+Error succeed()
+{
+   return Success();
+}
+
+} // anonymous namespace
+
+TEST_CASE("Startup Trace")
+{
+   SECTION("Nothing is recorded unless tracing is enabled")
+   {
+      {
+         Scope scope("untraced", "test");
+      }
+      CHECK(traced("untraced", "test", succeed)() == Success());
+      CHECK(finish().empty());
+   }
+
+   SECTION("Steps are recorded and written as trace events")
+   {
+      enable();
+      {
+         Scope scope("outer", "test");
+         CHECK(traced("inner", "init", succeed)() == Success());
+      }
+      std::vector<Step> steps = finish();
+      REQUIRE(steps.size() == 2);
+      CHECK(steps[0].name == "inner");
+      CHECK(steps[1].name == "outer");
+      CHECK(steps[1].wall >= steps[0].wall);
+      CHECK_FALSE(enabled());
+
+      FilePath traceFile;
+      REQUIRE_FALSE(FilePath::tempFilePath(&traceFile));
+      REQUIRE_FALSE(writeChromeTrace(steps, traceFile));
+
+      std::string contents;
+      REQUIRE_FALSE(readStringFromFile(traceFile, &contents));
+      json::Value trace;
+      REQUIRE(json::parse(contents, &trace));
+      REQUIRE(json::isType<json::Object>(trace));
+      json::Array events = trace.get_obj()["traceEvents"].get_array();
+      REQUIRE(events.size() == 2);
+      CHECK(events[0].get_obj()["name"].get_str() == "inner");
+      CHECK(events[0].get_obj()["ph"].get_str() == "X");
+
+      CHECK(summary(steps, 1).find("[test] outer") != std::string::npos);
+      CHECK(summary(steps, 1).find("inner") == std::string::npos);
+
+      traceFile.removeIfExists();
+   }
+}
+
+} // end namespace tests
+} // end namespace startup_trace
+} // end namespace core
+} // end namespace rstudio
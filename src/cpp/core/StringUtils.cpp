@@ -570,6 +570,131 @@ bool trimLeadingLines(int maxLines, std::string* pLines)
    return didTrim;
 }
 
+namespace {
+
+// number of bytes in the utf-8 sequence introduced by the given byte
+std::size_t utf8SequenceLength(unsigned char ch)
+{
+   if (ch < 0xC0)
+      return 1;
+   else if (ch < 0xE0)
+      return 2;
+   else if (ch < 0xF0)
+      return 3;
+   else
+      return 4;
+}
+
+// render the part of a line following a carriage return. cells are
+// overwritten from the start of the line, one per character (two for
+// characters outside the BMP, matching how the client counts them)
+void renderOverwrittenLine(std::string::const_iterator begin,
+                           std::string::const_iterator end,
+                           bool endsLine,
+                           std::string* pOutput)
+{
+   std::vector<std::string> cells;
+   std::size_t cursor = 0;
+   for (std::string::const_iterator it = begin; it != end; )
+   {
+      if (*it == '\r')
+      {
+         cursor = 0;
+         ++it;
+         continue;
+      }
+
+      std::size_t length = std::min<std::size_t>(
+               utf8SequenceLength(static_cast<unsigned char>(*it)), end - it);
+      std::string cell(it, it + length);
+      it += length;
+
+      std::size_t width = length == 4 ? 2 : 1;
+      if (cells.size() < cursor + width)
+         cells.resize(cursor + width);
+      cells[cursor] = cell;
+      if (width == 2)
+         cells[cursor + 1].clear();
+      cursor += width;
+   }
+
+   for (std::size_t i = 0; i < cells.size(); i++)
+      pOutput->append(cells[i]);
+
+   // if more output may follow on this line put the cursor back
+   if (!endsLine && cursor < cells.size())
+   {
+      pOutput->push_back('\r');
+      for (std::size_t i = 0; i < cursor; i++)
+         pOutput->append(cells[i]);
+   }
+}
+
+} // anonymous namespace
+
+bool collapseCarriageReturns(std::string* pOutput)
+{
+   if (pOutput->find('\r') == std::string::npos)
+      return false;
+
+   const std::string& output = *pOutput;
+   std::string collapsed;
+   collapsed.reserve(output.size());
+
+   bool didCollapse = false;
+   std::string::const_iterator lineBegin = output.begin();
+   while (lineBegin != output.end())
+   {
+      std::string::const_iterator lineEnd =
+                           std::find(lineBegin, output.end(), '\n');
+      bool endsLine = lineEnd != output.end();
+      bool firstLine = lineBegin == output.begin();
+
+      std::string::const_iterator firstReturn =
+                           std::find(lineBegin, lineEnd, '\r');
+
+      // a lone carriage return just before the newline changes nothing
+      // worth collapsing (and can't be overwritten text)
+      bool collapse = firstReturn != lineEnd &&
+                      firstReturn + 1 != lineEnd &&
+                      std::find(lineBegin, lineEnd, '\x1b') == lineEnd &&
+                      std::find(lineBegin, lineEnd, '\b') == lineEnd;
+
+      if (collapse)
+      {
+         // the start of the first line may continue an earlier line so
+         // keep it along with the return to the start of that line
+         std::string::const_iterator renderBegin = lineBegin;
+         if (firstLine)
+         {
+            collapsed.append(lineBegin, firstReturn + 1);
+            renderBegin = firstReturn + 1;
+         }
+
+         renderOverwrittenLine(renderBegin, lineEnd, endsLine, &collapsed);
+         didCollapse = true;
+      }
+      else
+      {
+         collapsed.append(lineBegin, lineEnd);
+      }
+
+      if (endsLine)
+      {
+         collapsed.push_back('\n');
+         lineBegin = lineEnd + 1;
+      }
+      else
+      {
+         lineBegin = lineEnd;
+      }
+   }
+
+   if (didCollapse)
+      pOutput->swap(collapsed);
+   return didCollapse;
+}
+
 std::string strippedOfBackQuotes(const std::string& string)
 {
    if (string.length() < 2)
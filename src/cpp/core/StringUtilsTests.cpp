@@ -104,6 +104,55 @@ context("isSubsequence")
    }
 }
 
+context("Carriage return collapsing")
+{
+   test_that("Overwritten progress is collapsed to its final state")
+   {
+      std::string output("start\n 10%\r 20%\r100%\ndone\n");
+      expect_true(collapseCarriageReturns(&output));
+      expect_true(output == "start\n100%\ndone\n");
+   }
+
+   test_that("Shorter text only overwrites the start of the line")
+   {
+      std::string output("x\nabcdef\rxy\n");
+      expect_true(collapseCarriageReturns(&output));
+      expect_true(output == "x\nxycdef\n");
+
+      // the cursor is left where the output left it
+      output = "x\nabcdef\rxy";
+      expect_true(collapseCarriageReturns(&output));
+      expect_true(output == "x\nxycdef\rxy");
+   }
+
+   test_that("The first line may continue earlier output")
+   {
+      std::string output("ab\rcd\ref\n");
+      expect_true(collapseCarriageReturns(&output));
+      expect_true(output == "ab\ref\n");
+   }
+
+   test_that("Characters are overwritten whole")
+   {
+      std::string output("x\n\xc3\xa9\xc3\xa9\ra\n");
+      expect_true(collapseCarriageReturns(&output));
+      expect_true(output == "x\na\xc3\xa9\n");
+   }
+
+   test_that("Other output is left alone")
+   {
+      std::string output("a\r\nb\r\n");
+      expect_false(collapseCarriageReturns(&output));
+      expect_true(output == "a\r\nb\r\n");
+
+      output = "x\n\x1b[31mred\rblue\n";
+      expect_false(collapseCarriageReturns(&output));
+
+      output = "no returns\n";
+      expect_false(collapseCarriageReturns(&output));
+   }
+}
+
 context("Comment extraction")
 {
    test_that("Comment headers can be extracted")
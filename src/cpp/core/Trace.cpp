@@ -16,11 +16,24 @@
 
 #include <core/Trace.hpp>
 
+#include <algorithm>
+#include <cstdlib>
 #include <map>
+#include <vector>
 
 #include <boost/utility.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/Thread.hpp>
+#include <core/json/Json.hpp>
+#include <core/system/System.hpp>
 
 #include <iostream>
 
@@ -28,10 +41,261 @@ namespace rstudio {
 namespace core {
 namespace trace {
 
+const char * const kTraceparentHeader = "traceparent";
+
+struct SpanData
+{
+   std::string traceId;
+   std::string spanId;
+   std::string name;
+   std::string parentSpanId;
+   SpanKind kind;
+   boost::posix_time::ptime startTime;
+   boost::posix_time::ptime endTime;
+   json::Array attributes;
+   std::string errorMessage;
+   bool error;
+};
+
 namespace {
 
 boost::mutex s_traceMutex ;
 
+// finished spans are handed over from a thread's buffer once the thread
+// leaves its outermost span (or has buffered this many)
+const std::size_t kMaxThreadSpans = 64;
+
+// and exported once this many have accumulated (or this much time has
+// passed since the last export)
+const std::size_t kMaxPendingSpans = 512;
+const boost::posix_time::time_duration kExportInterval =
+                                          boost::posix_time::seconds(5);
+
+// read without locking so that spans are free when tracing is disabled
+// (only written during initialization)
+bool s_enabled = false;
+double s_sampleRate = 0;
+std::string s_serviceName;
+FilePath s_exportFile;
+
+boost::mutex s_pendingMutex;
+std::vector<boost::shared_ptr<SpanData> > s_pendingSpans;
+boost::posix_time::ptime s_lastExportTime;
+
+boost::mutex s_exportMutex;
+
+struct ThreadState
+{
+   ~ThreadState()
+   {
+      handOver();
+   }
+
+   void handOver();
+
+   std::vector<const Span*> spans;
+   std::vector<boost::shared_ptr<SpanData> > finished;
+};
+
+boost::thread_specific_ptr<ThreadState> s_pThreadState;
+
+ThreadState& threadState()
+{
+   if (s_pThreadState.get() == NULL)
+      s_pThreadState.reset(new ThreadState());
+   return *s_pThreadState;
+}
+
+boost::posix_time::ptime now()
+{
+   return boost::posix_time::microsec_clock::universal_time();
+}
+
+std::string unixNanos(const boost::posix_time::ptime& time)
+{
+   static const boost::posix_time::ptime epoch(
+                                    boost::gregorian::date(1970, 1, 1));
+   return safe_convert::numberToString(
+            static_cast<long long>((time - epoch).total_microseconds()) * 1000);
+}
+
+bool isHex(const std::string& value, std::size_t length)
+{
+   if (value.size() != length)
+      return false;
+
+   for (std::size_t i = 0; i < value.size(); i++)
+   {
+      char ch = value[i];
+      if (!((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f')))
+         return false;
+   }
+
+   // all zero ids are invalid
+   return value.find_first_not_of('0') != std::string::npos;
+}
+
+std::string newTraceId()
+{
+   return core::system::generateUuid(false);
+}
+
+std::string newSpanId()
+{
+   return core::system::generateUuid(false).substr(0, 16);
+}
+
+// sample by the leading bits of the (random) trace id so that the decision
+// can be repeated from the trace id alone
+bool shouldSample(const std::string& traceId)
+{
+   unsigned long bits = std::strtoul(traceId.substr(0, 8).c_str(), NULL, 16);
+   return (bits / 4294967296.0) < s_sampleRate;
+}
+
+json::Object attribute(const std::string& key, const json::Object& value)
+{
+   json::Object attribute;
+   attribute["key"] = key;
+   attribute["value"] = value;
+   return attribute;
+}
+
+json::Object stringValue(const std::string& value)
+{
+   json::Object object;
+   object["stringValue"] = value;
+   return object;
+}
+
+json::Object spanAsJson(const SpanData& span)
+{
+   json::Object object;
+   object["traceId"] = span.traceId;
+   object["spanId"] = span.spanId;
+   if (!span.parentSpanId.empty())
+      object["parentSpanId"] = span.parentSpanId;
+   object["name"] = span.name;
+   object["kind"] = static_cast<int>(span.kind);
+   object["startTimeUnixNano"] = unixNanos(span.startTime);
+   object["endTimeUnixNano"] = unixNanos(span.endTime);
+   object["attributes"] = span.attributes;
+
+   json::Object status;
+   if (span.error)
+   {
+      status["code"] = 2;
+      status["message"] = span.errorMessage;
+   }
+   object["status"] = status;
+
+   return object;
+}
+
+void exportSpans(const std::vector<boost::shared_ptr<SpanData> >& spans)
+{
+   json::Array spansJson;
+   BOOST_FOREACH(const boost::shared_ptr<SpanData>& pSpan, spans)
+   {
+      spansJson.push_back(spanAsJson(*pSpan));
+   }
+
+   json::Array resourceAttributes;
+   resourceAttributes.push_back(attribute("service.name",
+                                          stringValue(s_serviceName)));
+   resourceAttributes.push_back(attribute("process.pid", stringValue(
+      safe_convert::numberToString(core::system::currentProcessId()))));
+   json::Object resource;
+   resource["attributes"] = resourceAttributes;
+
+   json::Object scope;
+   scope["name"] = "rstudio";
+   json::Object scopeSpans;
+   scopeSpans["scope"] = scope;
+   scopeSpans["spans"] = spansJson;
+   json::Array scopeSpansArray;
+   scopeSpansArray.push_back(scopeSpans);
+
+   json::Object resourceSpans;
+   resourceSpans["resource"] = resource;
+   resourceSpans["scopeSpans"] = scopeSpansArray;
+   json::Array resourceSpansArray;
+   resourceSpansArray.push_back(resourceSpans);
+
+   json::Object data;
+   data["resourceSpans"] = resourceSpansArray;
+
+   Error error = appendToFile(s_exportFile, json::write(data) + "\n");
+   if (error)
+      LOG_ERROR(error);
+}
+
+void exportPendingSpans(bool force)
+{
+   std::vector<boost::shared_ptr<SpanData> > spans;
+   LOCK_MUTEX(s_pendingMutex)
+   {
+      boost::posix_time::ptime time = now();
+      if (!force &&
+          s_pendingSpans.size() < kMaxPendingSpans &&
+          time - s_lastExportTime < kExportInterval)
+      {
+         return;
+      }
+
+      spans.swap(s_pendingSpans);
+      s_lastExportTime = time;
+   }
+   END_LOCK_MUTEX
+
+   if (spans.empty())
+      return;
+
+   // export outside of the pending lock so that other threads can
+   // continue to hand over spans
+   LOCK_MUTEX(s_exportMutex)
+   {
+      exportSpans(spans);
+   }
+   END_LOCK_MUTEX
+}
+
+void ThreadState::handOver()
+{
+   if (finished.empty())
+      return;
+
+   LOCK_MUTEX(s_pendingMutex)
+   {
+      s_pendingSpans.insert(s_pendingSpans.end(),
+                            finished.begin(),
+                            finished.end());
+   }
+   END_LOCK_MUTEX
+
+   finished.clear();
+}
+
+void finishSpan(boost::shared_ptr<SpanData> pData)
+{
+   ThreadState& state = threadState();
+   state.finished.push_back(pData);
+   if (state.spans.empty() || state.finished.size() >= kMaxThreadSpans)
+   {
+      state.handOver();
+      exportPendingSpans(false);
+   }
+}
+
+void flushAtExit()
+{
+   try
+   {
+      flush();
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
 } // anonymous namespace
 
 
@@ -44,6 +308,223 @@ void add(void* key, const std::string& functionName)
    END_LOCK_MUTEX
 }
 
+std::string SpanContext::traceparent() const
+{
+   if (empty())
+      return std::string();
+
+   return "00-" + traceId + "-" + spanId + (sampled ? "-01" : "-00");
+}
+
+SpanContext parseTraceparent(const std::string& traceparent)
+{
+   // version-traceid-spanid-flags (e.g. 00-<32 hex>-<16 hex>-01)
+   SpanContext context;
+   if (traceparent.size() < 55 ||
+       traceparent[2] != '-' || traceparent[35] != '-' ||
+       traceparent[52] != '-' || traceparent.compare(0, 2, "ff") == 0)
+   {
+      return context;
+   }
+
+   std::string traceId = traceparent.substr(3, 32);
+   std::string spanId = traceparent.substr(36, 16);
+   std::string flags = traceparent.substr(53, 2);
+   if (!isHex(traceId, 32) || !isHex(spanId, 16))
+      return context;
+
+   context.traceId = traceId;
+   context.spanId = spanId;
+   context.sampled = (std::strtoul(flags.c_str(), NULL, 16) & 0x01) != 0;
+   return context;
+}
+
+Error initialize(const std::string& serviceName,
+                 double sampleRate,
+                 const FilePath& exportDir)
+{
+   if (sampleRate <= 0 || exportDir.empty())
+      return Success();
+
+   Error error = exportDir.ensureDirectory();
+   if (error)
+      return error;
+
+   s_serviceName = serviceName;
+   s_sampleRate = std::min(sampleRate, 1.0);
+   s_exportFile = exportDir.childPath(
+            serviceName + "-" +
+            safe_convert::numberToString(core::system::currentProcessId()) +
+            ".json");
+   s_lastExportTime = now();
+   s_enabled = true;
+
+   std::atexit(flushAtExit);
+
+   return Success();
+}
+
+bool enabled()
+{
+   return s_enabled;
+}
+
+void flush()
+{
+   if (!s_enabled)
+      return;
+
+   if (s_pThreadState.get() != NULL)
+      s_pThreadState->handOver();
+   exportPendingSpans(true);
+}
+
+Span::Span(const char* name, const SpanContext& parent, SpanKind kind)
+{
+   start(name, parent, kind);
+}
+
+Span::Span()
+{
+}
+
+Span::~Span()
+{
+   try
+   {
+      end();
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
+void Span::start(const char* name, const SpanContext& parent, SpanKind kind)
+{
+   if (!s_enabled)
+      return;
+
+   if (parent.empty())
+   {
+      context_.traceId = newTraceId();
+      context_.sampled = shouldSample(context_.traceId);
+   }
+   else
+   {
+      context_.traceId = parent.traceId;
+      context_.sampled = parent.sampled;
+   }
+   context_.spanId = newSpanId();
+
+   if (!context_.sampled)
+      return;
+
+   pData_.reset(new SpanData());
+   pData_->name = name;
+   pData_->parentSpanId = parent.spanId;
+   pData_->kind = kind;
+   pData_->startTime = now();
+   pData_->error = false;
+}
+
+void Span::setName(const std::string& name)
+{
+   if (pData_)
+      pData_->name = name;
+}
+
+void Span::setAttribute(const std::string& key, const std::string& value)
+{
+   if (pData_)
+      pData_->attributes.push_back(attribute(key, stringValue(value)));
+}
+
+void Span::setAttribute(const std::string& key, int value)
+{
+   if (pData_)
+   {
+      // (64 bit integers are strings in OTLP/JSON)
+      json::Object intValue;
+      intValue["intValue"] = safe_convert::numberToString(value);
+      pData_->attributes.push_back(attribute(key, intValue));
+   }
+}
+
+void Span::setError(const std::string& message)
+{
+   if (pData_)
+   {
+      pData_->error = true;
+      pData_->errorMessage = message;
+   }
+}
+
+void Span::end()
+{
+   if (!pData_)
+      return;
+
+   pData_->traceId = context_.traceId;
+   pData_->spanId = context_.spanId;
+   pData_->endTime = now();
+   finishSpan(pData_);
+   pData_.reset();
+}
+
+ScopedSpan::ScopedSpan(const char* name)
+   : pushed_(false)
+{
+   if (!s_enabled)
+      return;
+
+   ThreadState& state = threadState();
+   if (state.spans.empty() || !state.spans.back()->spanContext().sampled)
+      return;
+
+   start(name, state.spans.back()->spanContext(), SpanKindInternal);
+   push();
+}
+
+ScopedSpan::ScopedSpan(const char* name,
+                       const SpanContext& parent,
+                       SpanKind kind)
+   : pushed_(false)
+{
+   if (!s_enabled)
+      return;
+
+   start(name, parent, kind);
+   push();
+}
+
+ScopedSpan::~ScopedSpan()
+{
+   try
+   {
+      // leave the thread's stack before ending so that the span is handed
+      // over if it was the outermost one
+      if (pushed_)
+         threadState().spans.pop_back();
+      end();
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
+void ScopedSpan::push()
+{
+   threadState().spans.push_back(this);
+   pushed_ = true;
+}
+
+SpanContext currentContext()
+{
+   if (!s_enabled || s_pThreadState.get() == NULL ||
+       s_pThreadState->spans.empty())
+   {
+      return SpanContext();
+   }
+
+   return s_pThreadState->spans.back()->spanContext();
+}
+
 } // namespace trace
 } // namespace core
 } // namespace rstudio
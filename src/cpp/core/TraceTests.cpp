@@ -0,0 +1,140 @@
+/*
+ * TraceTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/Trace.hpp>
+
+#include <string>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/system/System.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace trace {
+namespace tests {
+
+namespace {
+
+FilePath s_exportDir;
+
+FilePath exportFile()
+{
+   return s_exportDir.childPath(
+            "tests-" +
+            safe_convert::numberToString(core::system::currentProcessId()) +
+            ".json");
+}
+
+std::string exported()
+{
+   flush();
+
+   std::string contents;
+   readStringFromFile(exportFile(), &contents);
+   return contents;
+}
+
+} // anonymous namespace
+
+context("Trace")
+{
+   test_that("traceparent headers are parsed")
+   {
+      std::string traceparent =
+            "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01";
+      SpanContext parsed = parseTraceparent(traceparent);
+      expect_true(parsed.traceId == "0af7651916cd43dd8448eb211c80319c");
+      expect_true(parsed.spanId == "b7ad6b7169203331");
+      expect_true(parsed.sampled);
+      expect_true(parsed.traceparent() == traceparent);
+
+      parsed = parseTraceparent(
+            "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-00");
+      expect_false(parsed.sampled);
+
+      expect_true(parseTraceparent("").empty());
+      expect_true(parseTraceparent("00-xyz-b7ad6b7169203331-01").empty());
+      expect_true(parseTraceparent(
+            "00-00000000000000000000000000000000-b7ad6b7169203331-01").empty());
+      expect_true(parseTraceparent(
+            "ff-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01").empty());
+   }
+
+   test_that("spans are not recorded before tracing is enabled")
+   {
+      ScopedSpan span("root", SpanContext());
+      expect_false(span.recording());
+      expect_true(span.spanContext().empty());
+      expect_true(currentContext().empty());
+   }
+
+   test_that("child spans are recorded beneath their parent")
+   {
+      REQUIRE_FALSE(FilePath::tempFilePath(&s_exportDir));
+      REQUIRE_FALSE(initialize("tests", 1.0, s_exportDir));
+
+      std::string rootSpanId;
+      {
+         ScopedSpan root("root", SpanContext(), SpanKindServer);
+         expect_true(root.recording());
+         root.setAttribute("attribute", "value");
+         rootSpanId = root.spanContext().spanId;
+
+         ScopedSpan child("child");
+         expect_true(child.recording());
+         expect_true(child.spanContext().traceId == root.spanContext().traceId);
+         expect_true(currentContext().spanId == child.spanContext().spanId);
+      }
+      expect_true(currentContext().empty());
+
+      std::string contents = exported();
+      expect_true(contents.find("\"name\":\"root\"") != std::string::npos);
+      expect_true(contents.find("\"name\":\"child\"") != std::string::npos);
+      expect_true(contents.find("\"parentSpanId\":\"" + rootSpanId + "\"") !=
+                  std::string::npos);
+      expect_true(contents.find("\"stringValue\":\"value\"") !=
+                  std::string::npos);
+   }
+
+   test_that("child spans aren't started without a parent")
+   {
+      ScopedSpan span("orphan");
+      expect_false(span.recording());
+      expect_true(span.spanContext().empty());
+   }
+
+   test_that("unsampled traces are propagated but not recorded")
+   {
+      SpanContext parent = parseTraceparent(
+            "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-00");
+      ScopedSpan span("unsampled", parent);
+      expect_false(span.recording());
+      expect_true(span.spanContext().traceId == parent.traceId);
+      expect_false(span.spanContext().sampled);
+
+      ScopedSpan child("child");
+      expect_false(child.recording());
+   }
+}
+
+} // namespace tests
+} // namespace trace
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,138 @@
+/*
+ * WorkScheduler.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/WorkScheduler.hpp>
+
+#include <algorithm>
+#include <set>
+
+#include <boost/foreach.hpp>
+
+namespace rstudio {
+namespace core {
+
+namespace {
+
+boost::posix_time::ptime now()
+{
+   return boost::posix_time::microsec_clock::universal_time();
+}
+
+} // anonymous namespace
+
+void WorkScheduler::add(const boost::shared_ptr<ScheduledCommand>& pCommand,
+                        const std::string& name,
+                        WorkPriority priority,
+                        bool idleOnly)
+{
+   Task task;
+   task.pCommand = pCommand;
+   task.name = name;
+   task.idleOnly = idleOnly;
+   tasks_[priority].push_back(task);
+}
+
+void WorkScheduler::execute(const boost::posix_time::time_duration& budget,
+                            bool isIdle,
+                            const boost::function<bool()>& interrupt)
+{
+   if (executing_)
+      return;
+   executing_ = true;
+
+   using namespace boost::posix_time;
+   ptime deadline = now() + budget;
+   bool stopped = false;
+
+   for (int priority = 0; priority < kPriorities && !stopped; priority++)
+   {
+      // execute from a copy of the tasks (a command could run code which
+      // schedules more commands)
+      std::vector<Task> tasks = tasks_[priority];
+      std::set<ScheduledCommand*> executed;
+      BOOST_FOREACH(const Task& task, tasks)
+      {
+         if (task.idleOnly && !isIdle)
+            continue;
+
+         ptime start = now();
+         if (start >= deadline || (interrupt && interrupt()))
+         {
+            stopped = true;
+            break;
+         }
+
+         task.pCommand->execute(deadline);
+         executed.insert(task.pCommand.get());
+
+         time_duration elapsed = now() - start;
+         recordExecution(task.name, elapsed.total_microseconds() / 1000.0);
+      }
+
+      // the commands which executed take their next turn after those which
+      // didn't, and finished commands are removed
+      std::vector<Task> waiting, rotated;
+      BOOST_FOREACH(const Task& task, tasks_[priority])
+      {
+         if (task.pCommand->finished())
+            continue;
+
+         if (executed.count(task.pCommand.get()))
+            rotated.push_back(task);
+         else
+            waiting.push_back(task);
+      }
+      waiting.insert(waiting.end(), rotated.begin(), rotated.end());
+      tasks_[priority].swap(waiting);
+   }
+
+   executing_ = false;
+}
+
+bool WorkScheduler::empty() const
+{
+   for (int priority = 0; priority < kPriorities; priority++)
+   {
+      if (!tasks_[priority].empty())
+         return false;
+   }
+   return true;
+}
+
+std::map<std::string, WorkScheduler::TaskStats> WorkScheduler::collectStats()
+{
+   std::map<std::string, TaskStats> stats;
+   LOCK_MUTEX(statsMutex_)
+   {
+      stats.swap(stats_);
+   }
+   END_LOCK_MUTEX
+   return stats;
+}
+
+void WorkScheduler::recordExecution(const std::string& name, double ms)
+{
+   LOCK_MUTEX(statsMutex_)
+   {
+      TaskStats& stats = stats_[name];
+      stats.executions++;
+      stats.totalMs += ms;
+      stats.maxMs = std::max(stats.maxMs, ms);
+   }
+   END_LOCK_MUTEX
+}
+
+} // namespace core
+} // namespace rstudio
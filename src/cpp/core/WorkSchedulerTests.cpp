@@ -0,0 +1,190 @@
+/*
+ * WorkSchedulerTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/WorkScheduler.hpp>
+
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+
+#include <core/IncrementalCommand.hpp>
+
+#define RSTUDIO_NO_TESTTHAT_ALIASES
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+namespace {
+
+using namespace boost::posix_time;
+
+// records its name each time it's called, with the given number of calls
+// remaining until it has finished
+bool recordCall(const std::string& name,
+                int* pRemaining,
+                std::vector<std::string>* pCalls)
+{
+   pCalls->push_back(name);
+   return --(*pRemaining) > 0;
+}
+
+// a command which does a single unit of work each time it's executed
+class SingleStepCommand : public ScheduledCommand
+{
+public:
+   explicit SingleStepCommand(const boost::function<bool()>& execute)
+      : ScheduledCommand(execute)
+   {
+   }
+
+   using ScheduledCommand::execute;
+
+   virtual void execute()
+   {
+      finished_ = !execute_();
+   }
+};
+
+boost::shared_ptr<ScheduledCommand> singleStepCommand(
+                                       const std::string& name,
+                                       int* pRemaining,
+                                       std::vector<std::string>* pCalls)
+{
+   return boost::shared_ptr<ScheduledCommand>(new SingleStepCommand(
+            boost::bind(recordCall, name, pRemaining, pCalls)));
+}
+
+bool sleepBriefly()
+{
+   boost::this_thread::sleep(milliseconds(5));
+   return true;
+}
+
+bool always()
+{
+   return true;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Work scheduler")
+{
+   SECTION("Commands execute in priority order and finished ones are removed")
+   {
+      WorkScheduler scheduler;
+      std::vector<std::string> calls;
+      int low = 1, high = 1, normal = 2;
+      scheduler.add(singleStepCommand("low", &low, &calls), "low",
+                    WorkPriorityLow, false);
+      scheduler.add(singleStepCommand("high", &high, &calls), "high",
+                    WorkPriorityHigh, false);
+      scheduler.add(singleStepCommand("normal", &normal, &calls), "normal",
+                    WorkPriorityNormal, false);
+
+      scheduler.execute(seconds(10), true);
+      REQUIRE(calls.size() == 3);
+      CHECK(calls[0] == "high");
+      CHECK(calls[1] == "normal");
+      CHECK(calls[2] == "low");
+      CHECK_FALSE(scheduler.empty());
+
+      scheduler.execute(seconds(10), true);
+      CHECK(calls.size() == 4);
+      CHECK(scheduler.empty());
+   }
+
+   SECTION("Idle only commands wait for the session to be idle")
+   {
+      WorkScheduler scheduler;
+      std::vector<std::string> calls;
+      int idle = 1, busy = 1;
+      scheduler.add(singleStepCommand("idle", &idle, &calls), "idle",
+                    WorkPriorityNormal, true);
+      scheduler.add(singleStepCommand("busy", &busy, &calls), "busy",
+                    WorkPriorityNormal, false);
+
+      scheduler.execute(seconds(10), false);
+      REQUIRE(calls.size() == 1);
+      CHECK(calls[0] == "busy");
+
+      scheduler.execute(seconds(10), true);
+      REQUIRE(calls.size() == 2);
+      CHECK(calls[1] == "idle");
+   }
+
+   SECTION("Commands left waiting by the budget go first next time")
+   {
+      WorkScheduler scheduler;
+      std::vector<std::string> calls;
+      int first = 10, second = 10;
+      scheduler.add(boost::shared_ptr<ScheduledCommand>(
+                       new IncrementalCommand(milliseconds(20), sleepBriefly)),
+                    "sleeper", WorkPriorityNormal, false);
+      scheduler.add(singleStepCommand("first", &first, &calls), "first",
+                    WorkPriorityNormal, false);
+      scheduler.add(singleStepCommand("second", &second, &calls), "second",
+                    WorkPriorityNormal, false);
+
+      // the sleeper spends the whole budget
+      scheduler.execute(milliseconds(1), true);
+      CHECK(calls.empty());
+
+      scheduler.execute(seconds(10), true);
+      REQUIRE(calls.size() == 2);
+      CHECK(calls[0] == "first");
+      CHECK(calls[1] == "second");
+   }
+
+   SECTION("Execution stops when interrupted")
+   {
+      WorkScheduler scheduler;
+      std::vector<std::string> calls;
+      int remaining = 1;
+      scheduler.add(singleStepCommand("command", &remaining, &calls),
+                    "command", WorkPriorityNormal, false);
+
+      scheduler.execute(seconds(10), true, always);
+      CHECK(calls.empty());
+      CHECK_FALSE(scheduler.empty());
+   }
+
+   SECTION("Time spent is recorded per command")
+   {
+      WorkScheduler scheduler;
+      std::vector<std::string> calls;
+      int remaining = 2;
+      scheduler.add(singleStepCommand("command", &remaining, &calls),
+                    "indexer", WorkPriorityNormal, false);
+
+      scheduler.execute(seconds(10), true);
+      scheduler.execute(seconds(10), true);
+
+      std::map<std::string, WorkScheduler::TaskStats> stats =
+                                                   scheduler.collectStats();
+      REQUIRE(stats.count("indexer"));
+      CHECK(stats["indexer"].executions == 2);
+      CHECK(stats["indexer"].totalMs >= stats["indexer"].maxMs);
+
+      // collecting resets the stats
+      CHECK(scheduler.collectStats().empty());
+   }
+}
+
+} // end namespace tests
+} // end namespace core
+} // end namespace rstudio
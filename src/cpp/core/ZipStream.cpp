@@ -0,0 +1,706 @@
+/*
+ * ZipStream.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/ZipStream.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+#include <zlib.h>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread.hpp>
+
+// Entries are written as (local header, data, [data descriptor]), followed
+// by the central directory listing them all and the end of central
+// directory record (see PKWARE's APPNOTE.TXT). Entries deflated as they're
+// written have a data descriptor following their data, since their sizes
+// and crc aren't known until then. Zip64 extensions are used for entries
+// (and archives) whose sizes or offsets don't fit in 32 bits.
+
+namespace rstudio {
+namespace core {
+
+namespace {
+
+const boost::uint32_t kLocalHeaderSignature = 0x04034b50;
+const boost::uint32_t kDataDescriptorSignature = 0x08074b50;
+const boost::uint32_t kCentralHeaderSignature = 0x02014b50;
+const boost::uint32_t kZip64EndSignature = 0x06064b50;
+const boost::uint32_t kZip64LocatorSignature = 0x07064b50;
+const boost::uint32_t kEndSignature = 0x06054b50;
+
+const boost::uint16_t kVersion = 20;
+const boost::uint16_t kVersionZip64 = 45;
+const boost::uint16_t kVersionMadeBy = (3 << 8) | kVersionZip64; // unix
+
+const boost::uint16_t kFlagDataDescriptor = 0x0008;
+const boost::uint16_t kFlagUtf8 = 0x0800;
+
+const boost::uint16_t kMethodStore = 0;
+const boost::uint16_t kMethodDeflate = 8;
+
+const boost::uint16_t kExtraZip64 = 0x0001;
+const boost::uint16_t kExtraTimestamp = 0x5455;
+
+const boost::uint32_t kMax32 = 0xFFFFFFFF;
+const boost::uint16_t kMax16 = 0xFFFF;
+
+// files which are deflated as they're written use zip64 sizes if they might
+// not fit in 32 bits once deflated (which can grow incompressible data)
+const uintmax_t kZip64Threshold = 0xF0000000;
+
+// small files are deflated ahead, in parallel, in batches of (at most)
+// kMaxBatchSize bytes
+const uintmax_t kMaxBufferedEntrySize = 1024 * 1024;
+const uintmax_t kMaxBatchSize = 16 * 1024 * 1024;
+const std::size_t kMaxBatchEntries = 256;
+const int kMaxThreads = 4;
+
+const std::size_t kReadBlockSize = 64 * 1024;
+
+const char * const kCompressedExtensions[] = {
+   ".7z", ".bz2", ".docx", ".flac", ".gif", ".gz", ".jpeg", ".jpg", ".lz",
+   ".m4a", ".mkv", ".mov", ".mp3", ".mp4", ".ogg", ".png", ".pptx", ".rar",
+   ".rda", ".rdata", ".rds", ".tgz", ".webm", ".webp", ".woff", ".woff2",
+   ".xlsx", ".xz", ".zip", ".zst"
+};
+
+void put16(std::string* pData, boost::uint16_t value)
+{
+   pData->push_back(static_cast<char>(value & 0xFF));
+   pData->push_back(static_cast<char>((value >> 8) & 0xFF));
+}
+
+void put32(std::string* pData, boost::uint32_t value)
+{
+   put16(pData, static_cast<boost::uint16_t>(value & 0xFFFF));
+   put16(pData, static_cast<boost::uint16_t>(value >> 16));
+}
+
+void put64(std::string* pData, boost::uint64_t value)
+{
+   put32(pData, static_cast<boost::uint32_t>(value & 0xFFFFFFFF));
+   put32(pData, static_cast<boost::uint32_t>(value >> 32));
+}
+
+boost::uint32_t clamp32(boost::uint64_t value)
+{
+   return value >= kMax32 ? kMax32 : static_cast<boost::uint32_t>(value);
+}
+
+// the time and date of a file in ms-dos format (in UTC; the extended
+// timestamp field records the time for tools which read it)
+void dosDateTime(std::time_t time,
+                 boost::uint16_t* pDosTime,
+                 boost::uint16_t* pDosDate)
+{
+   std::tm tm = boost::posix_time::to_tm(
+            boost::posix_time::from_time_t(std::max<std::time_t>(time, 0)));
+   if (tm.tm_year < 80)
+   {
+      *pDosTime = 0;
+      *pDosDate = (1 << 5) | 1;
+      return;
+   }
+
+   *pDosTime = static_cast<boost::uint16_t>(
+            (tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+   *pDosDate = static_cast<boost::uint16_t>(
+            ((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+}
+
+std::string timestampExtra(std::time_t time)
+{
+   std::string extra;
+   put16(&extra, kExtraTimestamp);
+   put16(&extra, 5);
+   extra.push_back(1); // modification time present
+   put32(&extra, static_cast<boost::uint32_t>(std::max<std::time_t>(time, 0)));
+   return extra;
+}
+
+Error zlibError(int result, const ErrorLocation& location)
+{
+   Error error = systemError(boost::system::errc::io_error, location);
+   error.addProperty("zlib-result", result);
+   return error;
+}
+
+Error readError(const FilePath& filePath, const ErrorLocation& location)
+{
+   Error error = systemError(boost::system::errc::io_error, location);
+   error.addProperty("path", filePath.absolutePath());
+   return error;
+}
+
+// read (at most) size bytes of the stream, returning the number read
+std::size_t readBlock(std::istream& is, char* buffer, std::size_t size)
+{
+   is.read(buffer, size);
+   return static_cast<std::size_t>(is.gcount());
+}
+
+} // anonymous namespace
+
+struct ZipStream::Deflater
+{
+   Deflater() : initialized(false) {}
+
+   ~Deflater()
+   {
+      if (initialized)
+         ::deflateEnd(&stream);
+   }
+
+   Error initialize()
+   {
+      stream.zalloc = Z_NULL;
+      stream.zfree = Z_NULL;
+      stream.opaque = Z_NULL;
+
+      // raw deflate (zip entries have no zlib header)
+      int result = ::deflateInit2(&stream,
+                                  Z_DEFAULT_COMPRESSION,
+                                  Z_DEFLATED,
+                                  -MAX_WBITS,
+                                  8,
+                                  Z_DEFAULT_STRATEGY);
+      if (result != Z_OK)
+         return zlibError(result, ERROR_LOCATION);
+
+      initialized = true;
+      return Success();
+   }
+
+   // deflate the input, appending the output to pOutput
+   Error deflate(const char* data,
+                 std::size_t size,
+                 bool finish,
+                 std::string* pOutput)
+   {
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+      stream.avail_in = static_cast<uInt>(size);
+
+      char buffer[kReadBlockSize];
+      int result;
+      do
+      {
+         stream.next_out = reinterpret_cast<Bytef*>(buffer);
+         stream.avail_out = sizeof(buffer);
+         result = ::deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+         if (result == Z_STREAM_ERROR)
+            return zlibError(result, ERROR_LOCATION);
+         pOutput->append(buffer, sizeof(buffer) - stream.avail_out);
+      }
+      while (stream.avail_out == 0 || (finish && result != Z_STREAM_END));
+
+      return Success();
+   }
+
+   z_stream stream;
+   bool initialized;
+};
+
+Error ZipStream::create(const FilePath& parentPath,
+                        const std::vector<std::string>& files,
+                        int threads,
+                        boost::shared_ptr<ZipStream>* pStream)
+{
+   if (threads <= 0)
+   {
+      threads = std::min<int>(
+               kMaxThreads,
+               std::max<int>(1, boost::thread::hardware_concurrency()));
+   }
+
+   boost::shared_ptr<ZipStream> pZip(new ZipStream(threads));
+   for (std::vector<std::string>::const_iterator it = files.begin();
+        it != files.end();
+        ++it)
+   {
+      FilePath filePath = parentPath.complete(*it);
+      if (!filePath.exists())
+         return fileNotFoundError(filePath, ERROR_LOCATION);
+
+      addEntry(parentPath, filePath, &pZip->entries_);
+      if (filePath.isDirectory())
+      {
+         Error error = filePath.childrenRecursive(
+                  boost::bind(addEntry, parentPath, _2, &pZip->entries_));
+         if (error)
+            return error;
+      }
+   }
+
+   *pStream = pZip;
+   return Success();
+}
+
+ZipStream::ZipStream(int threads)
+   : state_(NextEntry), threads_(threads), index_(0), written_(0)
+{
+}
+
+ZipStream::~ZipStream()
+{
+}
+
+bool ZipStream::isCompressedFile(const FilePath& filePath)
+{
+   std::string extension = filePath.extensionLowerCase();
+   const char * const * end = kCompressedExtensions +
+         sizeof(kCompressedExtensions) / sizeof(kCompressedExtensions[0]);
+   for (const char * const * it = kCompressedExtensions; it != end; ++it)
+   {
+      if (extension == *it)
+         return true;
+   }
+   return false;
+}
+
+bool ZipStream::addEntry(const FilePath& parentPath,
+                         const FilePath& path,
+                         std::vector<Entry>* pEntries)
+{
+   Entry entry;
+   entry.path = path;
+   entry.name = path.relativePath(parentPath);
+   entry.directory = path.isDirectory();
+   entry.modified = path.lastWriteTime();
+   if (entry.directory)
+   {
+      entry.name += "/";
+      entry.store = true;
+   }
+   else
+   {
+      entry.size = path.size();
+      entry.store = isCompressedFile(path);
+   }
+
+   pEntries->push_back(entry);
+   return true;
+}
+
+Error ZipStream::read(std::size_t maxBytes, std::string* pData)
+{
+   pData->clear();
+
+   while (pending_.size() < maxBytes && state_ != Finished)
+   {
+      Error error = writeNext();
+      if (error)
+         return error;
+   }
+
+   std::size_t size = std::min(maxBytes, pending_.size());
+   pData->assign(pending_, 0, size);
+   pending_.erase(0, size);
+   return Success();
+}
+
+Error ZipStream::writeNext()
+{
+   switch (state_)
+   {
+   case NextEntry:
+      if (index_ == entries_.size())
+      {
+         writeCentralDirectory();
+         state_ = Finished;
+         return Success();
+      }
+      return beginEntry();
+
+   case EntryData:
+      return writeEntryData();
+
+   case Finished:
+   default:
+      return Success();
+   }
+}
+
+Error ZipStream::beginEntry()
+{
+   Entry& entry = entries_[index_];
+   entry.offset = written_;
+
+   if (entry.directory)
+   {
+      writeLocalHeader(entry);
+      index_++;
+      return Success();
+   }
+
+   if (entry.size <= kMaxBufferedEntrySize && !entry.buffered)
+      bufferEntriesFrom(index_);
+
+   if (entry.buffered)
+   {
+      if (entry.error)
+         return entry.error;
+
+      writeLocalHeader(entry);
+      write(entry.data);
+      std::string().swap(entry.data);
+      index_++;
+      return Success();
+   }
+
+   // deflate the file as it's written
+   Error error = entry.path.open_r(&pFile_);
+   if (error)
+      return error;
+
+   if (!entry.store)
+   {
+      pDeflater_.reset(new Deflater());
+      error = pDeflater_->initialize();
+      if (error)
+         return error;
+   }
+
+   entry.hasDescriptor = true;
+   entry.zip64 = entry.size >= kZip64Threshold;
+   entry.crc = ::crc32(0L, Z_NULL, 0);
+   writeLocalHeader(entry);
+
+   state_ = EntryData;
+   return Success();
+}
+
+Error ZipStream::writeEntryData()
+{
+   Entry& entry = entries_[index_];
+
+   char buffer[kReadBlockSize];
+   std::size_t size = readBlock(*pFile_, buffer, sizeof(buffer));
+   if (pFile_->bad())
+      return readError(entry.path, ERROR_LOCATION);
+   bool finished = pFile_->eof();
+
+   entry.crc = ::crc32(entry.crc,
+                       reinterpret_cast<const Bytef*>(buffer),
+                       static_cast<uInt>(size));
+   entry.uncompressedSize += size;
+
+   if (entry.store)
+   {
+      write(buffer, size);
+      entry.compressedSize += size;
+   }
+   else
+   {
+      std::string output;
+      Error error = pDeflater_->deflate(buffer, size, finished, &output);
+      if (error)
+         return error;
+      write(output);
+      entry.compressedSize += output.size();
+   }
+
+   if (!finished)
+      return Success();
+
+   // the file grew past the size it was expected to have
+   if (!entry.zip64 &&
+       (entry.compressedSize >= kMax32 || entry.uncompressedSize >= kMax32))
+   {
+      return readError(entry.path, ERROR_LOCATION);
+   }
+
+   writeDataDescriptor(entry);
+   pFile_.reset();
+   pDeflater_.reset();
+   index_++;
+   state_ = NextEntry;
+   return Success();
+}
+
+void ZipStream::bufferEntry(Entry* pEntry)
+{
+   std::string contents;
+   boost::shared_ptr<std::istream> pFile;
+   Error error = pEntry->path.open_r(&pFile);
+   if (error)
+   {
+      pEntry->error = error;
+      pEntry->buffered = true;
+      return;
+   }
+
+   char buffer[kReadBlockSize];
+   while (pFile->good())
+      contents.append(buffer, readBlock(*pFile, buffer, sizeof(buffer)));
+   if (pFile->bad())
+   {
+      pEntry->error = readError(pEntry->path, ERROR_LOCATION);
+      pEntry->buffered = true;
+      return;
+   }
+
+   pEntry->crc = ::crc32(::crc32(0L, Z_NULL, 0),
+                         reinterpret_cast<const Bytef*>(contents.data()),
+                         static_cast<uInt>(contents.size()));
+   pEntry->uncompressedSize = contents.size();
+
+   if (!pEntry->store)
+   {
+      Deflater deflater;
+      error = deflater.initialize();
+      if (!error)
+      {
+         error = deflater.deflate(contents.data(),
+                                  contents.size(),
+                                  true,
+                                  &pEntry->data);
+      }
+      if (error)
+      {
+         pEntry->error = error;
+         pEntry->buffered = true;
+         return;
+      }
+
+      // store contents which don't compress
+      if (pEntry->data.size() >= contents.size())
+         pEntry->store = true;
+   }
+
+   if (pEntry->store)
+      pEntry->data.swap(contents);
+
+   pEntry->compressedSize = pEntry->data.size();
+   pEntry->buffered = true;
+}
+
+void ZipStream::bufferEntries(std::vector<Entry*> entries,
+                              std::size_t first,
+                              std::size_t step)
+{
+   for (std::size_t i = first; i < entries.size(); i += step)
+      bufferEntry(entries[i]);
+}
+
+void ZipStream::bufferEntriesFrom(std::size_t index)
+{
+   // gather the run of small files starting at index
+   std::vector<Entry*> batch;
+   uintmax_t batchSize = 0;
+   for (std::size_t i = index;
+        i < entries_.size() && batch.size() < kMaxBatchEntries;
+        i++)
+   {
+      Entry& entry = entries_[i];
+      if (entry.directory)
+         continue;
+      if (entry.size > kMaxBufferedEntrySize ||
+          batchSize + entry.size > kMaxBatchSize)
+         break;
+
+      batch.push_back(&entry);
+      batchSize += entry.size;
+   }
+
+   // deflate them across the threads (the first on this thread)
+   std::size_t threads = std::min<std::size_t>(threads_, batch.size());
+   boost::thread_group group;
+   for (std::size_t i = 1; i < threads; i++)
+      group.create_thread(boost::bind(bufferEntries, batch, i, threads));
+
+   bufferEntries(batch, 0, std::max<std::size_t>(threads, 1));
+   group.join_all();
+}
+
+void ZipStream::writeLocalHeader(const Entry& entry)
+{
+   boost::uint16_t dosTime, dosDate;
+   dosDateTime(entry.modified, &dosTime, &dosDate);
+
+   std::string extra = timestampExtra(entry.modified);
+   if (entry.zip64)
+   {
+      // sizes (which follow in the data descriptor)
+      put16(&extra, kExtraZip64);
+      put16(&extra, 16);
+      put64(&extra, 0);
+      put64(&extra, 0);
+   }
+
+   std::string header;
+   put32(&header, kLocalHeaderSignature);
+   put16(&header, entry.zip64 ? kVersionZip64 : kVersion);
+   put16(&header, kFlagUtf8 | (entry.hasDescriptor ? kFlagDataDescriptor : 0));
+   put16(&header, entry.store ? kMethodStore : kMethodDeflate);
+   put16(&header, dosTime);
+   put16(&header, dosDate);
+   if (entry.hasDescriptor)
+   {
+      put32(&header, 0);
+      put32(&header, entry.zip64 ? kMax32 : 0);
+      put32(&header, entry.zip64 ? kMax32 : 0);
+   }
+   else
+   {
+      put32(&header, entry.crc);
+      put32(&header, clamp32(entry.compressedSize));
+      put32(&header, clamp32(entry.uncompressedSize));
+   }
+   put16(&header, static_cast<boost::uint16_t>(entry.name.size()));
+   put16(&header, static_cast<boost::uint16_t>(extra.size()));
+   header.append(entry.name);
+   header.append(extra);
+
+   write(header);
+}
+
+void ZipStream::writeDataDescriptor(const Entry& entry)
+{
+   std::string descriptor;
+   put32(&descriptor, kDataDescriptorSignature);
+   put32(&descriptor, entry.crc);
+   if (entry.zip64)
+   {
+      put64(&descriptor, entry.compressedSize);
+      put64(&descriptor, entry.uncompressedSize);
+   }
+   else
+   {
+      put32(&descriptor, static_cast<boost::uint32_t>(entry.compressedSize));
+      put32(&descriptor, static_cast<boost::uint32_t>(entry.uncompressedSize));
+   }
+
+   write(descriptor);
+}
+
+void ZipStream::writeCentralDirectory()
+{
+   boost::uint64_t directoryOffset = written_;
+
+   for (std::vector<Entry>::const_iterator it = entries_.begin();
+        it != entries_.end();
+        ++it)
+   {
+      const Entry& entry = *it;
+
+      boost::uint16_t dosTime, dosDate;
+      dosDateTime(entry.modified, &dosTime, &dosDate);
+
+      // zip64 fields for the values which don't fit in 32 bits
+      std::string zip64;
+      if (entry.uncompressedSize >= kMax32)
+         put64(&zip64, entry.uncompressedSize);
+      if (entry.compressedSize >= kMax32)
+         put64(&zip64, entry.compressedSize);
+      if (entry.offset >= kMax32)
+         put64(&zip64, entry.offset);
+
+      std::string extra = timestampExtra(entry.modified);
+      if (!zip64.empty())
+      {
+         put16(&extra, kExtraZip64);
+         put16(&extra, static_cast<boost::uint16_t>(zip64.size()));
+         extra.append(zip64);
+      }
+
+      // unix permissions (and the ms-dos directory attribute)
+      boost::uint32_t attributes = entry.directory ?
+               (040755u << 16) | 0x10 :
+               (0100644u << 16);
+
+      bool isZip64 = entry.zip64 || !zip64.empty();
+
+      std::string header;
+      put32(&header, kCentralHeaderSignature);
+      put16(&header, kVersionMadeBy);
+      put16(&header, isZip64 ? kVersionZip64 : kVersion);
+      put16(&header,
+            kFlagUtf8 | (entry.hasDescriptor ? kFlagDataDescriptor : 0));
+      put16(&header, entry.store ? kMethodStore : kMethodDeflate);
+      put16(&header, dosTime);
+      put16(&header, dosDate);
+      put32(&header, entry.crc);
+      put32(&header, clamp32(entry.compressedSize));
+      put32(&header, clamp32(entry.uncompressedSize));
+      put16(&header, static_cast<boost::uint16_t>(entry.name.size()));
+      put16(&header, static_cast<boost::uint16_t>(extra.size()));
+      put16(&header, 0); // comment length
+      put16(&header, 0); // disk number
+      put16(&header, 0); // internal attributes
+      put32(&header, attributes);
+      put32(&header, clamp32(entry.offset));
+      header.append(entry.name);
+      header.append(extra);
+
+      write(header);
+   }
+
+   boost::uint64_t directorySize = written_ - directoryOffset;
+   boost::uint64_t entries = entries_.size();
+
+   std::string end;
+   if (entries >= kMax16 ||
+       directorySize >= kMax32 ||
+       directoryOffset >= kMax32)
+   {
+      boost::uint64_t zip64EndOffset = written_;
+
+      put32(&end, kZip64EndSignature);
+      put64(&end, 44); // size of the remainder of the record
+      put16(&end, kVersionMadeBy);
+      put16(&end, kVersionZip64);
+      put32(&end, 0); // disk number
+      put32(&end, 0); // disk with the central directory
+      put64(&end, entries);
+      put64(&end, entries);
+      put64(&end, directorySize);
+      put64(&end, directoryOffset);
+
+      put32(&end, kZip64LocatorSignature);
+      put32(&end, 0); // disk with the zip64 end record
+      put64(&end, zip64EndOffset);
+      put32(&end, 1); // number of disks
+   }
+
+   put32(&end, kEndSignature);
+   put16(&end, 0); // disk number
+   put16(&end, 0); // disk with the central directory
+   boost::uint16_t entries16 = entries >= kMax16 ?
+            kMax16 : static_cast<boost::uint16_t>(entries);
+   put16(&end, entries16);
+   put16(&end, entries16);
+   put32(&end, clamp32(directorySize));
+   put32(&end, clamp32(directoryOffset));
+   put16(&end, 0); // comment length
+
+   write(end);
+}
+
+void ZipStream::write(const std::string& data)
+{
+   write(data.data(), data.size());
+}
+
+void ZipStream::write(const char* data, std::size_t size)
+{
+   pending_.append(data, size);
+   written_ += size;
+}
+
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,225 @@
+/*
+ * ZipStreamTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/ZipStream.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include <core/FileSerializer.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+namespace {
+
+struct ZipContents
+{
+   std::map<std::string, std::string> files;
+   std::map<std::string, int> methods;
+};
+
+boost::uint64_t get(const std::string& zip, std::size_t offset, int bytes)
+{
+   boost::uint64_t value = 0;
+   for (int i = bytes - 1; i >= 0; i--)
+      value = (value << 8) | static_cast<unsigned char>(zip[offset + i]);
+   return value;
+}
+
+std::string inflateRaw(const std::string& data, std::size_t size)
+{
+   std::string output(size, '\0');
+   z_stream stream = z_stream();
+   REQUIRE(::inflateInit2(&stream, -MAX_WBITS) == Z_OK);
+   stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+   stream.avail_in = static_cast<uInt>(data.size());
+   stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+   stream.avail_out = static_cast<uInt>(output.size());
+   CHECK(::inflate(&stream, Z_FINISH) == Z_STREAM_END);
+   ::inflateEnd(&stream);
+   return output;
+}
+
+// read the entries listed in the central directory (as unzip would)
+void readZip(const std::string& zip, ZipContents* pContents)
+{
+   REQUIRE(zip.size() >= 22);
+   std::size_t end = zip.size() - 22;
+   REQUIRE(get(zip, end, 4) == 0x06054b50);
+   std::size_t entries = get(zip, end + 10, 2);
+   std::size_t offset = get(zip, end + 16, 4);
+
+   for (std::size_t i = 0; i < entries; i++)
+   {
+      REQUIRE(get(zip, offset, 4) == 0x02014b50);
+      int method = static_cast<int>(get(zip, offset + 10, 2));
+      boost::uint32_t crc =
+            static_cast<boost::uint32_t>(get(zip, offset + 16, 4));
+      std::size_t compressedSize = get(zip, offset + 20, 4);
+      std::size_t size = get(zip, offset + 24, 4);
+      std::size_t nameLength = get(zip, offset + 28, 2);
+      std::size_t extraLength = get(zip, offset + 30, 2);
+      std::size_t commentLength = get(zip, offset + 32, 2);
+      std::size_t localOffset = get(zip, offset + 42, 4);
+      std::string name = zip.substr(offset + 46, nameLength);
+      offset += 46 + nameLength + extraLength + commentLength;
+
+      REQUIRE(get(zip, localOffset, 4) == 0x04034b50);
+      CHECK(zip.substr(localOffset + 30, nameLength) == name);
+      std::size_t dataOffset = localOffset + 30 +
+            get(zip, localOffset + 26, 2) + get(zip, localOffset + 28, 2);
+      std::string data = zip.substr(dataOffset, compressedSize);
+
+      std::string contents = method == 0 ? data : inflateRaw(data, size);
+      CHECK(contents.size() == size);
+      CHECK(::crc32(0L,
+                    reinterpret_cast<const Bytef*>(contents.data()),
+                    static_cast<uInt>(contents.size())) == crc);
+
+      pContents->files[name] = contents;
+      pContents->methods[name] = method;
+   }
+}
+
+std::string readAll(ZipStream* pStream, std::size_t maxBytes)
+{
+   std::string zip, data;
+   do
+   {
+      REQUIRE_FALSE(pStream->read(maxBytes, &data));
+      CHECK(data.size() <= maxBytes);
+      zip.append(data);
+   }
+   while (!data.empty());
+   return zip;
+}
+
+std::string pseudoRandom(std::size_t size)
+{
+   std::string data(size, '\0');
+   boost::uint32_t state = 42;
+   for (std::size_t i = 0; i < size; i++)
+   {
+      state = state * 1103515245 + 12345;
+      data[i] = static_cast<char>(state >> 24);
+   }
+   return data;
+}
+
+class ZipFixture
+{
+public:
+   ZipFixture()
+   {
+      FilePath::tempFilePath(&dir_);
+      dir_.ensureDirectory();
+      dir_.complete("data/nested").ensureDirectory();
+
+      add("a.R", "x <- 1\n");
+      add("empty.txt", "");
+      add("data/b.csv", std::string(10000, 'b'));
+      add("data/nested/c.txt", "c");
+      add("data/plot.png", pseudoRandom(5000));
+      add("large.txt", std::string(3 * 1024 * 1024, 'l') + "end");
+   }
+
+   ~ZipFixture()
+   {
+      dir_.removeIfExists();
+   }
+
+   void add(const std::string& name, const std::string& contents)
+   {
+      writeStringToFile(dir_.complete(name), contents);
+      files_[name] = contents;
+   }
+
+   FilePath dir_;
+   std::map<std::string, std::string> files_;
+};
+
+} // anonymous namespace
+
+context("ZipStream")
+{
+   test_that("Archives contain the files and directories requested")
+   {
+      ZipFixture fixture;
+      std::vector<std::string> files;
+      files.push_back("a.R");
+      files.push_back("empty.txt");
+      files.push_back("data");
+      files.push_back("large.txt");
+
+      boost::shared_ptr<ZipStream> pStream;
+      REQUIRE_FALSE(ZipStream::create(fixture.dir_, files, 4, &pStream));
+
+      ZipContents contents;
+      readZip(readAll(pStream.get(), 8192), &contents);
+
+      CHECK(contents.files.size() == fixture.files_.size() + 2);
+      CHECK(contents.files.count("data/") == 1);
+      CHECK(contents.files.count("data/nested/") == 1);
+      for (std::map<std::string, std::string>::const_iterator it =
+              fixture.files_.begin();
+           it != fixture.files_.end();
+           ++it)
+      {
+         INFO(it->first);
+         CHECK(contents.files[it->first] == it->second);
+      }
+
+      // compressed files are stored, others deflated
+      CHECK(contents.methods["data/plot.png"] == 0);
+      CHECK(contents.methods["data/b.csv"] == 8);
+      CHECK(contents.methods["large.txt"] == 8);
+   }
+
+   test_that("Archives are the same however they are read or deflated")
+   {
+      ZipFixture fixture;
+      std::vector<std::string> files;
+      files.push_back("data");
+      files.push_back("large.txt");
+      files.push_back("a.R");
+
+      boost::shared_ptr<ZipStream> pSerial, pParallel;
+      REQUIRE_FALSE(ZipStream::create(fixture.dir_, files, 1, &pSerial));
+      REQUIRE_FALSE(ZipStream::create(fixture.dir_, files, 3, &pParallel));
+
+      CHECK(readAll(pSerial.get(), 100) == readAll(pParallel.get(), 65536));
+   }
+
+   test_that("Missing files are reported")
+   {
+      ZipFixture fixture;
+      std::vector<std::string> files;
+      files.push_back("missing.txt");
+
+      boost::shared_ptr<ZipStream> pStream;
+      CHECK(ZipStream::create(fixture.dir_, files, 0, &pStream));
+   }
+}
+
+} // namespace tests
+} // namespace core
+} // namespace rstudio
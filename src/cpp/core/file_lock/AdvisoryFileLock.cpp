@@ -13,10 +13,17 @@
  *
  */
 
+#include <cstring>
 #include <sstream>
 
 #include <core/FileLock.hpp>
 
+#ifndef _WIN32
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
 #include <boost/scope_exit.hpp>
 
 #include <core/Error.hpp>
@@ -27,6 +34,8 @@
 
 #include <core/BoostErrors.hpp>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 #define LOG(__X__)                                                             \
    do                                                                          \
    {                                                                           \
@@ -50,21 +59,165 @@ namespace rstudio {
 namespace core {
 
 namespace {
+
 typedef boost::interprocess::file_lock BoostFileLock;
+
+// OFD locks are available on Linux 3.15 and later; we fall back to boost's
+// (process associated) record locks if the kernel rejects them
+#ifdef F_OFD_SETLK
+bool s_ofdLockingAvailable = true;
+#else
+bool s_ofdLockingAvailable = false;
+#endif
+
+#ifdef F_OFD_SETLK
+
+struct flock wholeFileLock(short type)
+{
+   struct flock lock;
+   std::memset(&lock, 0, sizeof(lock));
+   lock.l_type = type;
+   lock.l_whence = SEEK_SET;
+   lock.l_start = 0;
+   lock.l_len = 0;
+   lock.l_pid = 0;
+   return lock;
+}
+
+void disableOfdLocking(int errorNumber)
+{
+   if (errorNumber == EINVAL && s_ofdLockingAvailable)
+   {
+      LOG("OFD locks not supported; falling back to POSIX record locks");
+      s_ofdLockingAvailable = false;
+   }
+}
+
+// returns -1 if the lock is held and the descriptor (to be closed to
+// release it) if it was acquired; errors are reported in 'pError'
+int acquireOfdLock(const FilePath& lockFilePath, Error* pError)
+{
+   int fd = ::open(string_utils::utf8ToSystem(lockFilePath.absolutePath()).c_str(),
+                   O_RDWR | O_CLOEXEC);
+   if (fd == -1)
+   {
+      *pError = systemError(errno, ERROR_LOCATION);
+      pError->addProperty("lock-file", lockFilePath);
+      return -1;
+   }
+
+   struct flock lock = wholeFileLock(F_WRLCK);
+   if (::fcntl(fd, F_OFD_SETLK, &lock) == -1)
+   {
+      int errorNumber = errno;
+      ::close(fd);
+
+      if (errorNumber == EAGAIN || errorNumber == EACCES)
+         return -1;
+
+      disableOfdLocking(errorNumber);
+      *pError = systemError(errorNumber, ERROR_LOCATION);
+      pError->addProperty("lock-file", lockFilePath);
+      return -1;
+   }
+
+   return fd;
 }
 
+// tests for a conflicting lock without taking one (so, unlike the boost
+// locks, this can't release a lock held by this process)
+bool isOfdLocked(const FilePath& lockFilePath, Error* pError)
+{
+   int fd = ::open(string_utils::utf8ToSystem(lockFilePath.absolutePath()).c_str(),
+                   O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+   {
+      *pError = systemError(errno, ERROR_LOCATION);
+      pError->addProperty("lock-file", lockFilePath);
+      return false;
+   }
+
+   struct flock lock = wholeFileLock(F_WRLCK);
+   int result = ::fcntl(fd, F_OFD_GETLK, &lock);
+   int errorNumber = errno;
+   ::close(fd);
+
+   if (result == -1)
+   {
+      disableOfdLocking(errorNumber);
+      *pError = systemError(errorNumber, ERROR_LOCATION);
+      pError->addProperty("lock-file", lockFilePath);
+      return false;
+   }
+
+   return lock.l_type != F_UNLCK;
+}
+
+#endif
+
+} // anonymous namespace
+
 struct AdvisoryFileLock::Impl
 {
+   Impl() : fd(-1) {}
+
+   ~Impl()
+   {
+      try
+      {
+         closeDescriptor();
+      }
+      catch(...)
+      {
+      }
+   }
+
+   void closeDescriptor()
+   {
+#ifndef _WIN32
+      if (fd != -1)
+      {
+         ::close(fd);
+         fd = -1;
+      }
+#endif
+   }
+
    FilePath lockFilePath;
    BoostFileLock lock;
+
+   // descriptor holding our OFD lock (if any)
+   int fd;
 };
 
+bool AdvisoryFileLock::isOfdLockingAvailable()
+{
+   return s_ofdLockingAvailable;
+}
+
 bool AdvisoryFileLock::isLocked(const FilePath& lockFilePath) const
 {
    // if the lock file doesn't exist then it's not locked
    if (!lockFilePath.exists())
       return false;
 
+#ifdef F_OFD_SETLK
+   if (s_ofdLockingAvailable)
+   {
+      Error error;
+      bool locked = isOfdLocked(lockFilePath, &error);
+      if (!error)
+         return locked;
+      
+      // fall back to record locks if OFD locks aren't supported
+      if (s_ofdLockingAvailable)
+      {
+         LOG_ERROR(error);
+         return false;
+      }
+   }
+#endif
+
    // check if it is locked
    try
    {
@@ -100,6 +253,21 @@ AdvisoryFileLock::~AdvisoryFileLock()
 }
 
 Error AdvisoryFileLock::acquire(const FilePath& lockFilePath)
+{
+   boost::posix_time::ptime start =
+         boost::posix_time::microsec_clock::universal_time();
+
+   Error error = acquireLock(lockFilePath);
+
+   FileLock::recordAcquisition(
+            lockFilePath,
+            !error,
+            boost::posix_time::microsec_clock::universal_time() - start);
+
+   return error;
+}
+
+Error AdvisoryFileLock::acquireLock(const FilePath& lockFilePath)
 {
    using namespace boost::system;
    using namespace boost::interprocess;
@@ -112,6 +280,39 @@ Error AdvisoryFileLock::acquire(const FilePath& lockFilePath)
          return error;
    }
 
+#ifdef F_OFD_SETLK
+   if (s_ofdLockingAvailable)
+   {
+      // we already hold this lock
+      if (pImpl_->fd != -1 && pImpl_->lockFilePath == lockFilePath)
+         return Success();
+
+      Error error;
+      int fd = acquireOfdLock(lockFilePath, &error);
+      if (fd != -1)
+      {
+         LOG("Acquired lock: " << lockFilePath.absolutePath());
+         pImpl_->closeDescriptor();
+         pImpl_->lockFilePath = lockFilePath;
+         pImpl_->fd = fd;
+         return Success();
+      }
+      else if (!error)
+      {
+         LOG("Failed to acquire lock: " << lockFilePath.absolutePath());
+         Error error = systemError(errc::no_lock_available, ERROR_LOCATION);
+         error.addProperty("lock-file", lockFilePath);
+         return error;
+      }
+      else if (s_ofdLockingAvailable)
+      {
+         return error;
+      }
+      
+      // OFD locks aren't supported; fall back to record locks
+   }
+#endif
+
    // try to acquire the lock
    try
    {
@@ -152,6 +353,7 @@ Error AdvisoryFileLock::release()
    // make sure the lock file exists
    if (!pImpl_->lockFilePath.exists())
    {
+      pImpl_->closeDescriptor();
       Error error = systemError(errc::no_lock_available, ERROR_LOCATION);
       error.addProperty("lock-file", pImpl_->lockFilePath);
       return error;
@@ -167,6 +369,15 @@ Error AdvisoryFileLock::release()
    }
    BOOST_SCOPE_EXIT_END
 
+   // closing our descriptor releases an OFD lock
+   if (pImpl_->fd != -1)
+   {
+      pImpl_->closeDescriptor();
+      LOG("Released lock: " << pImpl_->lockFilePath.absolutePath());
+      pImpl_->lockFilePath = FilePath();
+      return Success();
+   }
+
    // try to unlock it
    try
    {
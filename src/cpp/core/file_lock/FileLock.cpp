@@ -22,6 +22,7 @@
 #include <core/Error.hpp>
 #include <core/Log.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/Thread.hpp>
 #include <core/http/SocketUtils.hpp>
 #include <core/system/Environment.hpp>
 
@@ -49,6 +50,9 @@ const char * const kLocksConfPath    = "/etc/rstudio/file-locks";
 const double kDefaultRefreshRate     = 20.0;
 const double kDefaultTimeoutInterval = 30.0;
 
+// acquisitions slower than this are logged
+const boost::posix_time::milliseconds kSlowAcquisitionThreshold(500);
+
 std::string lockTypeToString(FileLock::LockType type)
 {
    switch (type)
@@ -90,6 +94,9 @@ double getFieldPositive(const Settings& settings,
 
 bool s_isInitialized = false;
 
+boost::mutex s_statsMutex;
+FileLock::AcquisitionStats s_acquisitionStats;
+
 } // end anonymous namespace
 
 bool FileLock::verifyInitialized()
@@ -143,6 +150,12 @@ void FileLock::initialize(const Settings& settings)
    bool loggingEnabled = settings.getBool("enable-logging", false);
    FileLock::s_loggingEnabled = loggingEnabled;
    
+   // lease renewal from a dedicated thread
+   FileLock::s_backgroundRefresh = settings.getBool("background-refresh", true);
+
+   // OFD advisory locks for link-based lock files on local filesystems
+   FileLock::s_localAdvisoryLocks = settings.getBool("local-advisory-locks", false);
+
    // logfile
    std::string logFile = settings.get("log-file");
    FileLock::s_logFile = FilePath(logFile);
@@ -155,6 +168,8 @@ void FileLock::initialize(const Settings& settings)
          << "lock-type=" << lockTypeToString(FileLock::s_defaultType) << ", "
          << "timeout-interval=" << FileLock::s_timeoutInterval.total_seconds() << "s, "
          << "refresh-rate=" << FileLock::s_refreshRate.total_seconds() << "s, "
+         << "background-refresh=" << FileLock::s_backgroundRefresh << ", "
+         << "local-advisory-locks=" << FileLock::s_localAdvisoryLocks << ", "
          << "log-file=" << logFile << ")"
          << std::endl;
       FileLock::log(ss.str());
@@ -210,12 +225,56 @@ void FileLock::log(const std::string& message)
    }
 }
 
+void FileLock::recordAcquisition(const FilePath& lockFilePath,
+                                 bool acquired,
+                                 const boost::posix_time::time_duration& elapsed)
+{
+   double ms = elapsed.total_microseconds() / 1000.0;
+
+   LOCK_MUTEX(s_statsMutex)
+   {
+      if (acquired)
+         s_acquisitionStats.acquired++;
+      else
+         s_acquisitionStats.failed++;
+      s_acquisitionStats.totalMs += ms;
+      s_acquisitionStats.maxMs = std::max(s_acquisitionStats.maxMs, ms);
+   }
+   END_LOCK_MUTEX
+
+   if (elapsed >= kSlowAcquisitionThreshold && isLoggingEnabled())
+   {
+      std::stringstream ss;
+      ss << "(PID " << ::getpid() << "): Slow lock acquisition ("
+         << ms << "ms, " << (acquired ? "acquired" : "not acquired") << "): "
+         << lockFilePath.absolutePath()
+         << std::endl;
+      FileLock::log(ss.str());
+   }
+}
+
+FileLock::AcquisitionStats FileLock::collectAcquisitionStats()
+{
+   AcquisitionStats stats;
+
+   LOCK_MUTEX(s_statsMutex)
+   {
+      stats = s_acquisitionStats;
+      s_acquisitionStats = AcquisitionStats();
+   }
+   END_LOCK_MUTEX
+
+   return stats;
+}
+
 // default values for static members
 FileLock::LockType FileLock::s_defaultType(FileLock::LOCKTYPE_LINKBASED);
 boost::posix_time::seconds FileLock::s_timeoutInterval(static_cast<long>(kDefaultTimeoutInterval));
 boost::posix_time::seconds FileLock::s_refreshRate(static_cast<long>(kDefaultRefreshRate));
 bool FileLock::s_loggingEnabled(false);
 bool FileLock::s_isLoadBalanced(false);
+bool FileLock::s_backgroundRefresh(true);
+bool FileLock::s_localAdvisoryLocks(false);
 FilePath FileLock::s_logFile;
 
 boost::shared_ptr<FileLock> FileLock::create(LockType type)
@@ -307,6 +366,10 @@ void FileLock::refreshPeriodically(boost::asio::io_service& service,
    s_isRefreshing = true;
    
    verifyInitialized();
+
+   // locks are already refreshed by the refresh thread
+   if (s_backgroundRefresh)
+      return;
    
    static boost::asio::deadline_timer timer(service, interval);
    timer.async_wait(boost::bind(
@@ -317,5 +380,42 @@ void FileLock::refreshPeriodically(boost::asio::io_service& service,
                        FileLock::refresh));
 }
 
+namespace {
+
+void refreshThreadMain()
+{
+   try
+   {
+      while (true)
+      {
+         boost::this_thread::sleep(FileLock::getRefreshRate());
+         FileLock::refresh();
+      }
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
+} // end anonymous namespace
+
+void FileLock::startRefreshThread()
+{
+   // a zero refresh rate disables refreshing
+   if (s_refreshRate.total_seconds() <= 0)
+      return;
+
+   static boost::mutex s_mutex;
+   static bool s_started = false;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      if (s_started)
+         return;
+      s_started = true;
+
+      core::thread::safeLaunchThread(refreshThreadMain);
+   }
+   END_LOCK_MUTEX
+}
+
 } // end namespace core
 } // end namespace rstudio
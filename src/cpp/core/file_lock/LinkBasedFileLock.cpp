@@ -27,6 +27,11 @@
 # include <unistd.h>
 #endif
 
+#ifdef __linux__
+# include <sys/vfs.h>
+#endif
+
+#include <map>
 #include <set>
 #include <vector>
 
@@ -41,7 +46,9 @@
 #include <core/system/System.hpp>
 
 #include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/system/error_code.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #define LOG(__X__)                                                             \
    do                                                                          \
@@ -98,6 +105,43 @@ bool isLockFileStale(const FilePath& lockFilePath)
    return LinkBasedFileLock::isLockFileStale(lockFilePath);
 }
 
+// is the directory on a filesystem local to this machine? (conservatively
+// false for network and FUSE filesystems, and if we can't tell)
+bool isLocalFileSystem(const FilePath& dir)
+{
+#ifdef __linux__
+   struct statfs info;
+   if (::statfs(dir.absolutePathNative().c_str(), &info) == -1)
+      return false;
+
+   switch (static_cast<unsigned long>(info.f_type))
+   {
+   case 0x6969UL:      // NFS
+   case 0x517BUL:      // SMB
+   case 0xFE534D42UL:  // SMB2
+   case 0xFF534D42UL:  // CIFS
+   case 0x73757245UL:  // CODA
+   case 0x5346414FUL:  // AFS
+   case 0x65735546UL:  // FUSE
+   case 0x47504653UL:  // GPFS
+   case 0x0BD00BD0UL:  // Lustre
+   case 0x00C36400UL:  // Ceph
+      return false;
+   default:
+      return true;
+   }
+#else
+   return false;
+#endif
+}
+
+bool useAdvisoryLock(const FilePath& lockFilePath)
+{
+   return FileLock::isLocalAdvisoryLockingEnabled() &&
+          AdvisoryFileLock::isOfdLockingAvailable() &&
+          isLocalFileSystem(lockFilePath.parent());
+}
+
 bool isLockFileOrphaned(const FilePath& lockFilePath)
 {
 #ifndef _WIN32
@@ -196,6 +240,31 @@ class LockRegistration : boost::noncopyable
 {
 public:
    
+   // scanning a directory is slow on network filesystems, and lockfiles
+   // can only become stale once they've outlived the timeout interval, so
+   // scan each directory at most once per interval
+   bool shouldCleanDirectory(const FilePath& dir)
+   {
+      using namespace boost::posix_time;
+      ptime now = second_clock::universal_time();
+
+      LOCK_MUTEX(mutex_)
+      {
+         std::map<std::string, ptime>::iterator it =
+               lastCleaned_.find(dir.absolutePath());
+         if (it != lastCleaned_.end() &&
+             now - it->second < FileLock::getTimeoutInterval())
+         {
+            return false;
+         }
+
+         lastCleaned_[dir.absolutePath()] = now;
+      }
+      END_LOCK_MUTEX
+
+      return true;
+   }
+   
    void registerLock(const FilePath& lockFilePath)
    {
       LOCK_MUTEX(mutex_)
@@ -247,6 +316,7 @@ private:
    
    boost::mutex mutex_;
    std::set<FilePath> registration_;
+   std::map<std::string, boost::posix_time::ptime> lastCleaned_;
 };
 
 LockRegistration& lockRegistration()
@@ -381,6 +451,9 @@ Error writeLockFile(const FilePath& lockFilePath)
 struct LinkBasedFileLock::Impl
 {
    FilePath lockFilePath;
+
+   // set when the lock is held with an advisory lock instead
+   boost::scoped_ptr<AdvisoryFileLock> pAdvisoryLock;
 };
 
 LinkBasedFileLock::LinkBasedFileLock()
@@ -402,13 +475,56 @@ bool LinkBasedFileLock::isLocked(const FilePath& lockFilePath) const
    if (!lockFilePath.exists())
       return false;
    
+   if (useAdvisoryLock(lockFilePath))
+      return AdvisoryFileLock().isLocked(lockFilePath);
+
    return !isLockFileStale(lockFilePath);
 }
 
 Error LinkBasedFileLock::acquire(const FilePath& lockFilePath)
+{
+   boost::posix_time::ptime start =
+         boost::posix_time::microsec_clock::universal_time();
+
+   Error error = acquireLock(lockFilePath);
+
+   // the advisory lock records its own timing
+   if (!pImpl_->pAdvisoryLock)
+   {
+      FileLock::recordAcquisition(
+               lockFilePath,
+               !error,
+               boost::posix_time::microsec_clock::universal_time() - start);
+   }
+
+   return error;
+}
+
+Error LinkBasedFileLock::acquireLock(const FilePath& lockFilePath)
 {
    using namespace boost::system;
    
+   pImpl_->pAdvisoryLock.reset();
+
+   // fast path: take an advisory lock on local filesystems
+   if (isLocalAdvisoryLockingEnabled())
+   {
+      Error error = lockFilePath.parent().ensureDirectory();
+      if (error)
+         return error;
+
+      if (useAdvisoryLock(lockFilePath))
+      {
+         pImpl_->pAdvisoryLock.reset(new AdvisoryFileLock());
+         error = pImpl_->pAdvisoryLock->acquire(lockFilePath);
+         if (error)
+            return error;
+
+         pImpl_->lockFilePath = lockFilePath;
+         return Success();
+      }
+   }
+   
    // if the lock file exists...
    if (lockFilePath.exists())
    {
@@ -454,17 +570,31 @@ Error LinkBasedFileLock::acquire(const FilePath& lockFilePath)
    }
 
    // clean any other stale lockfiles in that directory
-   cleanStaleLockfiles(lockFilePath.parent());
+   if (lockRegistration().shouldCleanDirectory(lockFilePath.parent()))
+      cleanStaleLockfiles(lockFilePath.parent());
    
    // register our lock (for refresh)
    pImpl_->lockFilePath = lockFilePath;
    lockRegistration().registerLock(lockFilePath);
    LOG("Acquired lock: " << lockFilePath.absolutePath());
+
+   // renew our lease on the lock from the refresh thread
+   if (isBackgroundRefreshEnabled())
+      FileLock::startRefreshThread();
+
    return Success();
 }
 
 Error LinkBasedFileLock::release()
 {
+   if (pImpl_->pAdvisoryLock)
+   {
+      Error error = pImpl_->pAdvisoryLock->release();
+      pImpl_->pAdvisoryLock.reset();
+      pImpl_->lockFilePath = FilePath();
+      return error;
+   }
+
    const FilePath& lockFilePath = pImpl_->lockFilePath;
    LOG("Released lock: " << lockFilePath.absolutePath());
    
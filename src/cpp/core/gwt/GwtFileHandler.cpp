@@ -104,7 +104,7 @@ void handleFileRequest(const std::string& wwwLocalPath,
    if (regex_utils::match(uri, boost::regex(".*\\.cache\\..*")))
    {
       pResponse->setCacheForeverHeaders();
-      pResponse->setFile(filePath, request);
+      pResponse->setStaticFile(filePath, request);
    }
    
    // case: files designated to never be cached 
@@ -145,7 +145,7 @@ void handleFileRequest(const std::string& wwwLocalPath,
    {
       // since these are application components we force revalidation
       pResponse->setCacheWithRevalidationHeaders();
-      pResponse->setCacheableFile(filePath, request);
+      pResponse->setStaticFile(filePath, request);
    }
   
 }
@@ -0,0 +1,83 @@
+/*
+ * ChunkParserBenchmarks.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/ChunkParser.hpp>
+
+#include <ios>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <tests/Benchmark.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+// a chunked body of a few hundred chunks of varying size
+const std::string& chunkedPayload()
+{
+   static std::string payload;
+   if (payload.empty())
+   {
+      std::stringstream ostr;
+      for (int i = 0; i < 200; i++)
+      {
+         std::string chunk((i % 16 + 1) * 64, 'x');
+         ostr << std::hex << chunk.size() << "\r\n" << chunk << "\r\n";
+      }
+      ostr << "0\r\n\r\n";
+      payload = ostr.str();
+   }
+   return payload;
+}
+
+} // anonymous namespace
+
+BENCHMARK(ChunkParser, parse_body)
+{
+   const std::string& payload = chunkedPayload();
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      ChunkParser parser;
+      std::vector<std::string> chunks;
+      tests::benchmark::doNotOptimize(
+               parser.parse(payload.c_str(), payload.size(), &chunks));
+   }
+}
+
+BENCHMARK(ChunkParser, parse_in_pieces)
+{
+   // as read from a socket (the parser keeps its state between pieces)
+   const std::string& payload = chunkedPayload();
+   const std::size_t kPieceSize = 1024;
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      ChunkParser parser;
+      std::vector<std::string> chunks;
+      for (std::size_t offset = 0; offset < payload.size(); offset += kPieceSize)
+      {
+         std::size_t size = std::min(kPieceSize, payload.size() - offset);
+         parser.parse(payload.c_str() + offset, size, &chunks);
+      }
+      tests::benchmark::doNotOptimize(chunks.size());
+   }
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,300 @@
+/*
+ * ContentEncoding.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/ContentEncoding.hpp>
+
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <core/Error.hpp>
+#include <core/SafeConvert.hpp>
+
+#include <core/http/Message.hpp>
+
+#ifndef _WIN32
+#include "config.h"
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#endif
+
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+const int kDefaultCompressionLevel = 6;
+
+namespace {
+
+int s_compressionLevel = kDefaultCompressionLevel;
+bool s_compressionEnabled = true;
+
+std::vector<std::string> defaultUncompressedContentTypes()
+{
+   std::vector<std::string> types;
+   types.push_back("image/png");
+   types.push_back("image/jpeg");
+   types.push_back("image/gif");
+   types.push_back("image/webp");
+   types.push_back("application/pdf");
+   types.push_back("application/zip");
+   types.push_back("application/gzip");
+   types.push_back("application/x-gzip");
+   types.push_back("application/x-bzip2");
+   types.push_back("application/x-xz");
+   types.push_back("application/x-7z-compressed");
+   types.push_back("application/font-woff");
+   types.push_back("font/woff");
+   types.push_back("font/woff2");
+   types.push_back("audio/");
+   types.push_back("video/");
+   return types;
+}
+
+std::vector<std::string>& uncompressedContentTypes()
+{
+   static std::vector<std::string> types = defaultUncompressedContentTypes();
+   return types;
+}
+
+// supported encodings in order of preference
+std::vector<std::string> supportedEncodings()
+{
+   std::vector<std::string> encodings;
+#ifdef HAVE_BROTLI
+   encodings.push_back(kBrotliEncoding);
+#endif
+#ifdef HAVE_ZSTD
+   encodings.push_back(kZstdEncoding);
+#endif
+#ifndef _WIN32
+   encodings.push_back(kGzipEncoding);
+#endif
+   return encodings;
+}
+
+// strip parameters (e.g. charset) and normalize case
+std::string normalizeContentType(const std::string& contentType)
+{
+   std::string type = contentType.substr(0, contentType.find(';'));
+   boost::algorithm::trim(type);
+   return boost::algorithm::to_lower_copy(type);
+}
+
+} // anonymous namespace
+
+void setCompressionLevel(int level)
+{
+   s_compressionLevel = std::min(std::max(level, 1), 9);
+}
+
+int compressionLevel()
+{
+   return s_compressionLevel;
+}
+
+void setCompressionEnabled(bool enabled)
+{
+   s_compressionEnabled = enabled;
+}
+
+bool compressionEnabled()
+{
+   return s_compressionEnabled;
+}
+
+void addUncompressedContentType(const std::string& contentType)
+{
+   uncompressedContentTypes().push_back(normalizeContentType(contentType));
+}
+
+bool isCompressibleContentType(const std::string& contentType)
+{
+   if (!s_compressionEnabled)
+      return false;
+
+   std::string type = normalizeContentType(contentType);
+   BOOST_FOREACH(const std::string& uncompressed, uncompressedContentTypes())
+   {
+      if (boost::algorithm::ends_with(uncompressed, "/"))
+      {
+         if (boost::algorithm::starts_with(type, uncompressed))
+            return false;
+      }
+      else if (type == uncompressed)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+bool isSupportedEncoding(const std::string& encoding)
+{
+   std::vector<std::string> encodings = supportedEncodings();
+   return std::find(encodings.begin(), encodings.end(), encoding) !=
+                                                            encodings.end();
+}
+
+double encodingQuality(const std::string& acceptEncoding,
+                       const std::string& encoding)
+{
+   // quality of the wildcard (if specified) applies to any encoding
+   // which isn't listed explicitly
+   double wildcardQuality = 0;
+
+   std::vector<std::string> entries;
+   boost::algorithm::split(entries, acceptEncoding,
+                           boost::algorithm::is_any_of(","));
+   BOOST_FOREACH(const std::string& entry, entries)
+   {
+      std::vector<std::string> parts;
+      boost::algorithm::split(parts, entry, boost::algorithm::is_any_of(";"));
+
+      std::string name = boost::algorithm::to_lower_copy(
+                                    boost::algorithm::trim_copy(parts[0]));
+      if (name.empty())
+         continue;
+
+      double quality = 1;
+      for (std::size_t i = 1; i < parts.size(); ++i)
+      {
+         std::string param = boost::algorithm::trim_copy(parts[i]);
+         if (boost::algorithm::istarts_with(param, "q="))
+            quality = safe_convert::stringTo<double>(param.substr(2), 0);
+      }
+
+      if (name == encoding)
+         return quality;
+      else if (name == "*")
+         wildcardQuality = quality;
+   }
+
+   return wildcardQuality;
+}
+
+std::string preferredEncoding(const std::string& acceptEncoding)
+{
+   std::string preferred;
+   double preferredQuality = 0;
+   BOOST_FOREACH(const std::string& encoding, supportedEncodings())
+   {
+      double quality = encodingQuality(acceptEncoding, encoding);
+      if (quality > preferredQuality)
+      {
+         preferred = encoding;
+         preferredQuality = quality;
+      }
+   }
+   return preferred;
+}
+
+Error compressContent(const std::string& encoding,
+                      const std::string& content,
+                      std::string* pCompressed)
+{
+   std::string compressed;
+
+#ifndef _WIN32
+   if (encoding == kGzipEncoding)
+   {
+      try
+      {
+         using namespace boost::iostreams;
+         filtering_ostream gzipStream;
+         gzipStream.push(gzip_compressor(gzip_params(compressionLevel())));
+         gzipStream.push(boost::iostreams::back_inserter(compressed));
+         gzipStream.write(content.data(), content.size());
+         gzipStream.reset();
+      }
+      catch(const std::exception& e)
+      {
+         Error error = systemError(boost::system::errc::io_error,
+                                   ERROR_LOCATION);
+         error.addProperty("what", e.what());
+         return error;
+      }
+
+      pCompressed->swap(compressed);
+      return Success();
+   }
+#endif
+
+#ifdef HAVE_BROTLI
+   if (encoding == kBrotliEncoding)
+   {
+      std::size_t size = ::BrotliEncoderMaxCompressedSize(content.size());
+      compressed.resize(std::max<std::size_t>(size, 16));
+      size = compressed.size();
+      if (!::BrotliEncoderCompress(
+                compressionLevel(),
+                BROTLI_DEFAULT_WINDOW,
+                BROTLI_MODE_GENERIC,
+                content.size(),
+                reinterpret_cast<const uint8_t*>(content.data()),
+                &size,
+                reinterpret_cast<uint8_t*>(&compressed[0])))
+      {
+         return systemError(boost::system::errc::io_error, ERROR_LOCATION);
+      }
+
+      compressed.resize(size);
+      pCompressed->swap(compressed);
+      return Success();
+   }
+#endif
+
+#ifdef HAVE_ZSTD
+   if (encoding == kZstdEncoding)
+   {
+      compressed.resize(::ZSTD_compressBound(content.size()));
+      std::size_t size = ::ZSTD_compress(&compressed[0],
+                                         compressed.size(),
+                                         content.data(),
+                                         content.size(),
+                                         compressionLevel());
+      if (::ZSTD_isError(size))
+      {
+         Error error = systemError(boost::system::errc::io_error,
+                                   ERROR_LOCATION);
+         error.addProperty("what", ::ZSTD_getErrorName(size));
+         return error;
+      }
+
+      compressed.resize(size);
+      pCompressed->swap(compressed);
+      return Success();
+   }
+#endif
+
+   Error error = systemError(boost::system::errc::operation_not_supported,
+                             ERROR_LOCATION);
+   error.addProperty("encoding", encoding);
+   return error;
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,127 @@
+/*
+ * ContentEncodingTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <string>
+
+#include <core/http/ContentEncoding.hpp>
+#include <core/http/Message.hpp>
+#include <core/http/Request.hpp>
+#include <core/http/Response.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+context("ContentEncodingTests")
+{
+   test_that("Accept-Encoding quality values are respected")
+   {
+      std::string accept = "gzip;q=0.5, br, zstd;q=0, *;q=0.1";
+
+      CHECK(encodingQuality(accept, "br") == 1);
+      CHECK(encodingQuality(accept, "gzip") == 0.5);
+      CHECK(encodingQuality(accept, "zstd") == 0);
+      CHECK(encodingQuality(accept, "deflate") == 0.1);
+      CHECK(encodingQuality("gzip, deflate", "deflate") == 1);
+      CHECK(encodingQuality("", "gzip") == 0);
+   }
+
+   test_that("Request accepts encodings listed after the first")
+   {
+      Request request;
+      request.setHeader("Accept-Encoding", "deflate, gzip");
+      CHECK(request.acceptsEncoding(kGzipEncoding));
+
+      request.setHeader("Accept-Encoding", "gzip;q=0");
+      CHECK_FALSE(request.acceptsEncoding(kGzipEncoding));
+   }
+
+   test_that("Already compressed content types are not compressible")
+   {
+      CHECK_FALSE(isCompressibleContentType("image/png"));
+      CHECK_FALSE(isCompressibleContentType("application/pdf"));
+      CHECK_FALSE(isCompressibleContentType("video/mp4"));
+      CHECK(isCompressibleContentType("text/html; charset=UTF-8"));
+      CHECK(isCompressibleContentType("image/svg+xml"));
+      CHECK(isCompressibleContentType(""));
+   }
+
+   test_that("Responses with compressed content types are not re-encoded")
+   {
+      Request request;
+      request.setHeader("Accept-Encoding", "gzip");
+
+      Response response;
+      response.setContentType("image/png");
+      response.negotiateContentEncoding(request);
+      CHECK(response.contentEncoding().empty());
+
+      // content type is also checked when the body is set
+      Response lateResponse;
+      lateResponse.negotiateContentEncoding(request);
+      lateResponse.setContentType("application/pdf");
+      lateResponse.setBody(std::string("%PDF-1.4"));
+      CHECK(lateResponse.contentEncoding().empty());
+      CHECK(lateResponse.body() == "%PDF-1.4");
+   }
+
+#ifndef _WIN32
+   test_that("Gzip is negotiated when it is the only accepted encoding")
+   {
+      CHECK(preferredEncoding("gzip, deflate") == kGzipEncoding);
+      CHECK(preferredEncoding("identity").empty());
+
+      Request request;
+      request.setHeader("Accept-Encoding", "gzip");
+
+      Response response;
+      response.setContentType("text/plain");
+      response.negotiateContentEncoding(request);
+      CHECK(response.contentEncoding() == kGzipEncoding);
+
+      std::string content(4096, 'a');
+      response.setBody(content);
+      CHECK(response.body().size() < content.size());
+   }
+#endif
+
+   test_that("Nothing is compressed when compression is disabled")
+   {
+      Request request;
+      request.setHeader("Accept-Encoding", "gzip, br, zstd");
+
+      setCompressionEnabled(false);
+
+      Response response;
+      response.setContentType("text/plain");
+      response.negotiateContentEncoding(request);
+      CHECK(response.contentEncoding().empty());
+
+      std::string content(4096, 'a');
+      response.setBody(content);
+      CHECK(response.body() == content);
+
+      setCompressionEnabled(true);
+      CHECK(isCompressibleContentType("text/plain"));
+   }
+}
+
+} // end namespace tests
+} // end namespace http
+} // end namespace core
+} // end namespace rstudio
@@ -30,6 +30,8 @@ namespace http {
   
 // encodings
 const char * const kGzipEncoding = "gzip";
+const char * const kBrotliEncoding = "br";
+const char * const kZstdEncoding = "zstd";
 
 // transfer encodings
 const char * const kTransferEncoding = "Transfer-Encoding";
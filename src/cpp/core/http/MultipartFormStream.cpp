@@ -0,0 +1,355 @@
+/*
+ * MultipartFormStream.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/MultipartFormStream.hpp>
+
+#include <iostream>
+#include <sstream>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/regex.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/Log.hpp>
+#include <core/RegexUtils.hpp>
+#include <core/http/Header.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+// limits on what's held in memory: the headers of a part, and the value of
+// a field which isn't a file
+const std::size_t kMaxPartHeadersSize = 64 * 1024;
+const std::size_t kMaxFieldSize = 1024 * 1024;
+
+Error formError(const std::string& description, const ErrorLocation& location)
+{
+   Error error = systemError(boost::system::errc::invalid_argument, location);
+   error.addProperty("description", description);
+   return error;
+}
+
+void removeFile(const std::string& path)
+{
+   Error error = FilePath(path).removeIfExists();
+   if (error)
+      LOG_ERROR(error);
+}
+
+} // anonymous namespace
+
+MultipartFormStream::MultipartFormStream(
+                              const std::string& contentType,
+                              const boost::function<FilePath()>& filePath,
+                              uintmax_t maxFileSize)
+   : state_(Preamble),
+     filePath_(filePath),
+     maxFileSize_(maxFileSize),
+     partIsFile_(false),
+     filesReleased_(false)
+{
+   // get the boundary token (as parseMultipartForm does)
+   std::string boundaryPrefix("boundary=");
+   size_t prefixLoc = contentType.find(boundaryPrefix);
+   if (prefixLoc != std::string::npos)
+   {
+      boundary_ = contentType.substr(prefixLoc + boundaryPrefix.size());
+      boundary_ = "--" + boundary_;
+      boost::algorithm::trim(boundary_);
+   }
+}
+
+MultipartFormStream::~MultipartFormStream()
+{
+   try
+   {
+      if (filesReleased_)
+         return;
+
+      pPartStream_.reset();
+      if (partIsFile_ && !partFile_.path.empty())
+         removeFile(partFile_.path);
+
+      for (Files::const_iterator it = files_.begin(); it != files_.end(); ++it)
+      {
+         if (!it->second.path.empty())
+            removeFile(it->second.path);
+      }
+   }
+   catch(...)
+   {
+   }
+}
+
+Error MultipartFormStream::write(const char* data, std::size_t size)
+{
+   // ignore anything following the closing boundary
+   if (state_ == Complete)
+      return Success();
+
+   if (boundary_.size() <= 2)
+      return formError("No multipart boundary", ERROR_LOCATION);
+
+   buffer_.append(data, size);
+
+   bool more = true;
+   while (more)
+   {
+      Error error = parseBuffer(&more);
+      if (error)
+         return error;
+   }
+   return Success();
+}
+
+Error MultipartFormStream::parseBuffer(bool* pMore)
+{
+   *pMore = false;
+
+   switch (state_)
+   {
+   case Preamble:
+   {
+      std::string::size_type pos = buffer_.find(boundary_);
+      if (pos == std::string::npos)
+      {
+         // keep what could be the start of the boundary
+         if (buffer_.size() >= boundary_.size())
+            buffer_.erase(0, buffer_.size() - boundary_.size() + 1);
+         return Success();
+      }
+
+      buffer_.erase(0, pos + boundary_.size());
+      state_ = BoundaryEnd;
+      *pMore = true;
+      return Success();
+   }
+
+   case BoundaryEnd:
+   {
+      if (buffer_.size() < 2)
+         return Success();
+
+      if (boost::algorithm::starts_with(buffer_, "--"))
+      {
+         state_ = Complete;
+         buffer_.clear();
+         return Success();
+      }
+      else if (boost::algorithm::starts_with(buffer_, "\r\n"))
+      {
+         buffer_.erase(0, 2);
+         state_ = PartHeaders;
+         *pMore = true;
+         return Success();
+      }
+
+      return formError("Invalid multipart boundary", ERROR_LOCATION);
+   }
+
+   case PartHeaders:
+   {
+      Headers headers;
+      if (boost::algorithm::starts_with(buffer_, "\r\n"))
+      {
+         // a part without headers
+         buffer_.erase(0, 2);
+      }
+      else
+      {
+         std::string::size_type pos = buffer_.find("\r\n\r\n");
+         if (pos == std::string::npos)
+         {
+            if (buffer_.size() > kMaxPartHeadersSize)
+               return formError("Multipart headers too large", ERROR_LOCATION);
+            return Success();
+         }
+
+         std::istringstream headerStream(buffer_.substr(0, pos + 4));
+         http::parseHeaders(headerStream, &headers);
+         buffer_.erase(0, pos + 4);
+      }
+
+      Error error = beginPart(headers);
+      if (error)
+         return error;
+
+      state_ = PartBody;
+      *pMore = true;
+      return Success();
+   }
+
+   case PartBody:
+   {
+      std::string delimiter = "\r\n" + boundary_;
+      std::string::size_type pos = buffer_.find(delimiter);
+      if (pos == std::string::npos)
+      {
+         // write all but what could be the start of the delimiter
+         if (buffer_.size() >= delimiter.size())
+         {
+            std::size_t size = buffer_.size() - delimiter.size() + 1;
+            Error error = writePartData(buffer_.data(), size);
+            if (error)
+               return error;
+            buffer_.erase(0, size);
+         }
+         return Success();
+      }
+
+      Error error = writePartData(buffer_.data(), pos);
+      if (error)
+         return error;
+      buffer_.erase(0, pos + delimiter.size());
+
+      error = endPart();
+      if (error)
+         return error;
+
+      state_ = BoundaryEnd;
+      *pMore = true;
+      return Success();
+   }
+
+   case Complete:
+   default:
+      return Success();
+   }
+}
+
+Error MultipartFormStream::beginPart(const Headers& headers)
+{
+   partName_.clear();
+   partIsFile_ = false;
+   partFile_ = File();
+   partValue_.clear();
+
+   // parts without a name are ignored (as parseMultipartForm does)
+   std::string cDisp = http::headerValue(headers, "Content-Disposition");
+   std::string nameRegex("form-data; name=\"(.*)\"");
+   boost::smatch nameMatch;
+   if (cDisp.empty() ||
+       !regex_utils::match(cDisp, nameMatch, boost::regex(nameRegex)))
+   {
+      return Success();
+   }
+
+   std::string filenameRegex(nameRegex + "; filename=\"(.*)\"");
+   boost::smatch fileMatch;
+   if (!regex_utils::match(cDisp, fileMatch, boost::regex(filenameRegex)))
+   {
+      partName_ = nameMatch[1];
+      return Success();
+   }
+
+   partName_ = fileMatch[1];
+   partIsFile_ = true;
+   partFile_.name = fileMatch[2];
+   partFile_.contentType = http::headerValue(headers, "Content-Type");
+   if (partFile_.contentType.empty())
+      partFile_.contentType = "application/octet-stream";
+
+   FilePath path = filePath_();
+   Error error = path.open_w(&pPartStream_);
+   if (error)
+      return error;
+   partFile_.path = path.absolutePath();
+
+   return Success();
+}
+
+Error MultipartFormStream::writePartData(const char* data, std::size_t size)
+{
+   if (partName_.empty())
+      return Success();
+
+   if (!partIsFile_)
+   {
+      partValue_.append(data, size);
+      if (partValue_.size() > kMaxFieldSize)
+         return formError("Form field too large", ERROR_LOCATION);
+      return Success();
+   }
+
+   partFile_.size += size;
+
+   // discard files which are too large (but continue counting their size)
+   if (maxFileSize_ > 0 && partFile_.size > maxFileSize_)
+   {
+      if (pPartStream_)
+      {
+         pPartStream_.reset();
+         removeFile(partFile_.path);
+         partFile_.path.clear();
+      }
+      return Success();
+   }
+
+   pPartStream_->write(data, size);
+   if (pPartStream_->fail())
+   {
+      Error error = systemError(boost::system::errc::io_error, ERROR_LOCATION);
+      error.addProperty("path", partFile_.path);
+      return error;
+   }
+
+   return Success();
+}
+
+Error MultipartFormStream::endPart()
+{
+   if (partName_.empty())
+      return Success();
+
+   if (!partIsFile_)
+   {
+      boost::algorithm::trim(partValue_);
+      fields_.push_back(std::make_pair(partName_, partValue_));
+      return Success();
+   }
+
+   if (pPartStream_)
+   {
+      pPartStream_->flush();
+      bool failed = pPartStream_->fail();
+      pPartStream_.reset();
+      if (failed)
+      {
+         Error error = systemError(boost::system::errc::io_error,
+                                   ERROR_LOCATION);
+         error.addProperty("path", partFile_.path);
+         return error;
+      }
+   }
+
+   // the first file of a given name is kept (as parseMultipartForm does)
+   if (!files_.insert(std::make_pair(partName_, partFile_)).second &&
+       !partFile_.path.empty())
+   {
+      removeFile(partFile_.path);
+   }
+
+   partIsFile_ = false;
+   return Success();
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,163 @@
+/*
+ * MultipartFormStreamTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/MultipartFormStream.hpp>
+
+#include <string>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+namespace {
+
+const char * const kContentType =
+      "multipart/form-data; boundary=----FormBoundary7MA4YWxk";
+
+FilePath tempFile()
+{
+   FilePath filePath;
+   Error error = FilePath::tempFilePath(&filePath);
+   REQUIRE_FALSE(error);
+   return filePath;
+}
+
+std::string formBody(const std::string& fileContents)
+{
+   return "preamble\r\n"
+          "------FormBoundary7MA4YWxk\r\n"
+          "Content-Disposition: form-data; name=\"dir\"\r\n"
+          "\r\n"
+          "~/projects \r\n"
+          "------FormBoundary7MA4YWxk\r\n"
+          "Content-Disposition: form-data; name=\"file\"; filename=\"a.bin\"\r\n"
+          "Content-Type: application/x-data\r\n"
+          "\r\n" +
+          fileContents +
+          "\r\n------FormBoundary7MA4YWxk--\r\n"
+          "epilogue";
+}
+
+// writes the body in pieces of the given size
+Error writeInPieces(MultipartFormStream* pStream,
+                    const std::string& body,
+                    std::size_t pieceSize)
+{
+   for (std::size_t i = 0; i < body.size(); i += pieceSize)
+   {
+      std::size_t size = std::min(pieceSize, body.size() - i);
+      Error error = pStream->write(body.data() + i, size);
+      if (error)
+         return error;
+   }
+   return Success();
+}
+
+} // anonymous namespace
+
+context("MultipartFormStream")
+{
+   test_that("Streamed forms are parsed as parseMultipartForm parses them")
+   {
+      // file contents which resemble the boundary
+      std::string contents("line\r\n------FormBoundary\r\n--\r\n\0x", 34);
+      std::string body = formBody(contents);
+
+      Fields expectedFields;
+      Files expectedFiles;
+      util::parseMultipartForm(kContentType, body,
+                               &expectedFields, &expectedFiles);
+
+      for (std::size_t pieceSize = 1; pieceSize <= body.size(); pieceSize++)
+      {
+         INFO("piece size " << pieceSize);
+
+         MultipartFormStream stream(kContentType, tempFile);
+         REQUIRE_FALSE(writeInPieces(&stream, body, pieceSize));
+         CHECK(stream.complete());
+         CHECK(stream.fields() == expectedFields);
+
+         REQUIRE(stream.files().size() == 1);
+         const File& file = stream.files().find("file")->second;
+         const File& expectedFile = expectedFiles.find("file")->second;
+         CHECK(file.name == expectedFile.name);
+         CHECK(file.contentType == expectedFile.contentType);
+         CHECK(file.contents.empty());
+         CHECK(file.size == expectedFile.contents.size());
+
+         std::string written;
+         REQUIRE_FALSE(readStringFromFile(FilePath(file.path), &written));
+         CHECK(written == expectedFile.contents);
+      }
+   }
+
+   test_that("Files are removed unless they are released")
+   {
+      std::string body = formBody("contents");
+      FilePath removedPath, releasedPath;
+      {
+         MultipartFormStream stream(kContentType, tempFile);
+         REQUIRE_FALSE(stream.write(body.data(), body.size()));
+         removedPath = FilePath(stream.files().begin()->second.path);
+         CHECK(removedPath.exists());
+      }
+      {
+         MultipartFormStream stream(kContentType, tempFile);
+         REQUIRE_FALSE(stream.write(body.data(), body.size()));
+         releasedPath = FilePath(stream.files().begin()->second.path);
+         stream.releaseFiles();
+      }
+
+      CHECK_FALSE(removedPath.exists());
+      CHECK(releasedPath.exists());
+      releasedPath.removeIfExists();
+   }
+
+   test_that("Files larger than the maximum size aren't kept")
+   {
+      std::string body = formBody(std::string(1000, 'x'));
+      MultipartFormStream stream(kContentType, tempFile, 999);
+      REQUIRE_FALSE(writeInPieces(&stream, body, 100));
+      CHECK(stream.complete());
+
+      const File& file = stream.files().begin()->second;
+      CHECK(file.path.empty());
+      CHECK(file.size == 1000);
+   }
+
+   test_that("Malformed forms are rejected")
+   {
+      std::string body = formBody("contents");
+
+      MultipartFormStream noBoundary("multipart/form-data", tempFile);
+      CHECK(noBoundary.write(body.data(), body.size()));
+
+      std::string badBoundary("------FormBoundary7MA4YWxkXX\r\n");
+      MultipartFormStream stream(kContentType, tempFile);
+      CHECK(stream.write(badBoundary.data(), badBoundary.size()));
+   }
+}
+
+} // namespace tests
+} // namespace http
+} // namespace core
+} // namespace rstudio
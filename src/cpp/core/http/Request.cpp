@@ -15,13 +15,14 @@
 
 #include <core/http/Request.hpp>
 
-#include <boost/tokenizer.hpp>
 #include <boost/asio/buffer.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
 #include <core/Log.hpp>
 #include <core/Thread.hpp>
 
+#include <core/http/ContentEncoding.hpp>
+
 namespace rstudio {
 namespace core {
 namespace http {
@@ -55,12 +56,7 @@ bool Request::acceptsContentType(const std::string& contentType) const
 
 bool Request::acceptsEncoding(const std::string& encoding) const
 {
-   // read , separated fields
-   using namespace boost ;
-   char_separator<char> comma(",");
-   std::string accepted = acceptEncoding();
-   tokenizer<char_separator<char>> tokens(accepted, comma);
-   return std::find(tokens.begin(), tokens.end(), encoding) != tokens.end();
+   return encodingQuality(acceptEncoding(), encoding) > 0;
 }
    
 boost::posix_time::ptime Request::ifModifiedSince() const
@@ -183,6 +179,13 @@ std::string Request::queryParamValue(const std::string& name) const
    return util::fieldValue(queryParams(), name);
 }
    
+void Request::setFormFields(const Fields& fields, const Files& files)
+{
+   formFields_ = fields;
+   files_ = files;
+   parsedFormFields_ = true;
+}
+   
 void Request::setBody(const std::string& body)
 {
    body_ = body;
@@ -207,6 +210,7 @@ void Request::resetMembers()
    cookies_.clear() ;
    parsedFormFields_ = false ;
    formFields_.clear() ;
+   files_.clear() ;
    parsedQueryParams_ = false;
    queryParams_.clear();
 }
@@ -0,0 +1,194 @@
+/*
+ * RequestMetrics.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/RequestMetrics.hpp>
+
+#include <algorithm>
+#include <map>
+
+#include <core/Thread.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace request_metrics {
+
+namespace {
+
+// bound the number of distinct prefixes we track (uris which don't
+// correspond to a handler could otherwise grow the map without limit)
+const std::size_t kMaxPrefixes = 64;
+const char * const kOtherPrefix = "other";
+
+bool s_enabled = false;
+
+boost::mutex s_mutex;
+std::map<std::string, PrefixStats> s_stats;
+
+std::vector<double> makeLatencyBuckets()
+{
+   const double buckets[] = { 5, 10, 25, 50, 100, 250, 500,
+                              1000, 2500, 5000, 10000, 30000 };
+   return std::vector<double>(buckets,
+                              buckets + sizeof(buckets) / sizeof(double));
+}
+
+// find (or create) the stats for a uri -- must be called with s_mutex held
+PrefixStats& statsFor(const std::string& uri)
+{
+   std::string prefix = uriPrefix(uri);
+   std::map<std::string, PrefixStats>::iterator it = s_stats.find(prefix);
+   if (it != s_stats.end())
+      return it->second;
+
+   if (s_stats.size() >= kMaxPrefixes)
+      prefix = kOtherPrefix;
+
+   PrefixStats& stats = s_stats[prefix];
+   stats.prefix = prefix;
+   return stats;
+}
+
+} // anonymous namespace
+
+const std::vector<double>& latencyBucketsMs()
+{
+   static const std::vector<double> buckets = makeLatencyBuckets();
+   return buckets;
+}
+
+PrefixStats::PrefixStats()
+   : requests(0),
+     aborted(0),
+     bytesIn(0),
+     bytesOut(0),
+     totalLatencyMs(0),
+     maxLatencyMs(0),
+     latencyCounts(latencyBucketsMs().size() + 1, 0),
+     inFlight(0)
+{
+}
+
+void setEnabled(bool enabled)
+{
+   s_enabled = enabled;
+}
+
+bool enabled()
+{
+   return s_enabled;
+}
+
+std::string uriPrefix(const std::string& uri)
+{
+   std::string path = uri.substr(0, uri.find_first_of("?#"));
+   if (path.empty() || path[0] != '/')
+      return "/";
+
+   std::string::size_type end = path.find('/', 1);
+   return path.substr(0, end);
+}
+
+void requestStarted(const std::string& uri, std::size_t bytesIn)
+{
+   if (!s_enabled)
+      return;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      PrefixStats& stats = statsFor(uri);
+      stats.inFlight++;
+      stats.bytesIn += bytesIn;
+   }
+   END_LOCK_MUTEX
+}
+
+void requestFinished(const std::string& uri,
+                     const boost::posix_time::time_duration& latency,
+                     std::size_t bytesOut)
+{
+   if (!s_enabled)
+      return;
+
+   double latencyMs = static_cast<double>(latency.total_microseconds()) / 1000;
+   const std::vector<double>& buckets = latencyBucketsMs();
+   std::size_t bucket = std::lower_bound(buckets.begin(),
+                                         buckets.end(),
+                                         latencyMs) - buckets.begin();
+
+   LOCK_MUTEX(s_mutex)
+   {
+      PrefixStats& stats = statsFor(uri);
+      if (stats.inFlight > 0)
+         stats.inFlight--;
+      stats.requests++;
+      stats.bytesOut += bytesOut;
+      stats.totalLatencyMs += latencyMs;
+      stats.maxLatencyMs = std::max(stats.maxLatencyMs, latencyMs);
+      stats.latencyCounts[bucket]++;
+   }
+   END_LOCK_MUTEX
+}
+
+void requestAborted(const std::string& uri)
+{
+   if (!s_enabled)
+      return;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      PrefixStats& stats = statsFor(uri);
+      if (stats.inFlight > 0)
+         stats.inFlight--;
+      stats.aborted++;
+   }
+   END_LOCK_MUTEX
+}
+
+std::vector<PrefixStats> collect()
+{
+   std::vector<PrefixStats> collected;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      for (std::map<std::string, PrefixStats>::iterator it = s_stats.begin();
+           it != s_stats.end();)
+      {
+         collected.push_back(it->second);
+
+         // reset the interval counts (dropping prefixes which are idle)
+         if (it->second.inFlight == 0)
+         {
+            s_stats.erase(it++);
+         }
+         else
+         {
+            PrefixStats reset;
+            reset.prefix = it->second.prefix;
+            reset.inFlight = it->second.inFlight;
+            it->second = reset;
+            ++it;
+         }
+      }
+   }
+   END_LOCK_MUTEX
+
+   return collected;
+}
+
+} // namespace request_metrics
+} // namespace http
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,80 @@
+/*
+ * RequestMetricsTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <algorithm>
+
+#include <core/http/RequestMetrics.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+using namespace request_metrics;
+
+context("RequestMetricsTests")
+{
+   test_that("Uris are aggregated by their first path component")
+   {
+      CHECK(uriPrefix("/rpc/console_input") == "/rpc");
+      CHECK(uriPrefix("/events/get_events?foo=bar") == "/events");
+      CHECK(uriPrefix("/index.htm") == "/index.htm");
+      CHECK(uriPrefix("/") == "/");
+      CHECK(uriPrefix("") == "/");
+   }
+
+   test_that("Completed and in flight requests are collected")
+   {
+      setEnabled(true);
+      collect();
+
+      requestStarted("/rpc/one", 10);
+      requestStarted("/rpc/two", 20);
+      requestFinished("/rpc/one", boost::posix_time::milliseconds(30), 100);
+
+      std::vector<PrefixStats> stats = collect();
+      REQUIRE(stats.size() == 1);
+      CHECK(stats[0].prefix == "/rpc");
+      CHECK(stats[0].requests == 1);
+      CHECK(stats[0].inFlight == 1);
+      CHECK(stats[0].bytesIn == 30);
+      CHECK(stats[0].bytesOut == 100);
+      CHECK(stats[0].maxLatencyMs == 30);
+
+      // 30ms falls in the (25, 50] bucket
+      const std::vector<double>& buckets = latencyBucketsMs();
+      std::size_t bucket = std::find(buckets.begin(), buckets.end(), 50) -
+                                                            buckets.begin();
+      CHECK(stats[0].latencyCounts[bucket] == 1);
+
+      // in flight requests carry over to the next collection
+      requestAborted("/rpc/two");
+      stats = collect();
+      REQUIRE(stats.size() == 1);
+      CHECK(stats[0].requests == 0);
+      CHECK(stats[0].aborted == 1);
+      CHECK(stats[0].inFlight == 0);
+
+      CHECK(collect().empty());
+      setEnabled(false);
+   }
+}
+
+} // end namespace tests
+} // end namespace http
+} // end namespace core
+} // end namespace rstudio
@@ -27,7 +27,8 @@ RequestParser::RequestParser()
   : state_(method_start), 
     content_length_(0), 
     parsing_content_length_(false), 
-    parsing_body_(false)
+    parsing_body_(false),
+    body_received_(0)
 {
 }
 
@@ -37,6 +38,8 @@ void RequestParser::reset()
   content_length_ = 0 ;
   parsing_content_length_ = false ;
   parsing_body_ = false ;
+  body_received_ = 0 ;
+  bodyHandler_.clear();
 }
 
 RequestParser::status RequestParser::consume(Request& req, char input)
@@ -289,7 +292,18 @@ RequestParser::status RequestParser::consume(Request& req, char input)
       // if this header was Content-Length then save it
       if (parsing_content_length_)
       {
-         content_length_ = boost::lexical_cast<int>(req.headers_.back().value);
+         int contentLength = -1;
+         try
+         {
+            contentLength = boost::lexical_cast<int>(req.headers_.back().value);
+         }
+         catch(const boost::bad_lexical_cast&)
+         {
+         }
+         if (contentLength < 0)
+            return error;
+
+         content_length_ = contentLength;
          parsing_content_length_ = false ;
       }
 
@@ -357,6 +371,34 @@ bool RequestParser::is_digit(int c)
   return c >= '0' && c <= '9';
 }
 
+const unsigned char* RequestParser::char_classes()
+{
+  struct Classes
+  {
+    Classes()
+    {
+      for (int i = 0; i < 256; i++)
+      {
+        // bytes above 127 are negative as chars (as consume sees them)
+        int c = static_cast<char>(i);
+        unsigned char classes = 0;
+        if (is_char(c) && !is_ctl(c) && !is_tspecial(c))
+          classes |= token_class;
+        if (!is_ctl(c) && c != ' ')
+          classes |= uri_class;
+        if (!is_ctl(c))
+          classes |= value_class;
+        values[i] = classes;
+      }
+    }
+
+    unsigned char values[256];
+  };
+
+  static const Classes classes;
+  return classes.values;
+}
+
 } // namespace http
 } // namespace core
 } // namespace rstudio
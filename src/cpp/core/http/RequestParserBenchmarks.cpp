@@ -0,0 +1,60 @@
+/*
+ * RequestParserBenchmarks.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/Request.hpp>
+#include <core/http/RequestParser.hpp>
+
+#include <string>
+
+#include <tests/Benchmark.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+const char * const kRpcRequest =
+   "POST /rpc/get_environment_state HTTP/1.1\r\n"
+   "Host: localhost:8787\r\n"
+   "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+   "Accept: application/json, text/plain, */*\r\n"
+   "Accept-Encoding: gzip, deflate, br\r\n"
+   "Accept-Language: en-US,en;q=0.9\r\n"
+   "Cookie: user-id=someone|Mon%2C%2001%20Jan%202018|abcdef0123456789; "
+           "csrf-token=0123456789abcdef\r\n"
+   "Content-Type: application/json\r\n"
+   "Content-Length: 26\r\n"
+   "\r\n"
+   "{\"method\":\"get\",\"p\":[1,2]}";
+
+} // anonymous namespace
+
+BENCHMARK(RequestParser, parse_rpc_request)
+{
+   static const std::string payload = kRpcRequest;
+   RequestParser parser;
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      Request request;
+      parser.reset();
+      tests::benchmark::doNotOptimize(
+               parser.parse(request, payload.begin(), payload.end()));
+   }
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,345 @@
+/*
+ * RequestParserTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/http/Request.hpp>
+#include <core/http/RequestParser.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+namespace {
+
+const char * const kRpcRequest =
+   "POST /rpc/get_environment_state HTTP/1.1\r\n"
+   "Host: localhost:8787\r\n"
+   "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+   "Accept: application/json, text/plain, */*\r\n"
+   "Content-Type: application/json\r\n"
+   "X-Long-Header: first line\r\n"
+   "  continued\r\n"
+   "Content-Length: 26\r\n"
+   "\r\n"
+   "{\"method\":\"get\",\"p\":[1,2]}";
+
+struct ParseResult
+{
+   RequestParser::status status;
+   std::size_t consumed;
+   Request request;
+};
+
+// parse the payload, presenting it to the parser in pieces of the given size
+void parseInPieces(const std::string& payload,
+                   std::size_t pieceSize,
+                   ParseResult* pResult)
+{
+   pResult->status = RequestParser::incomplete;
+
+   RequestParser parser;
+   std::string::const_iterator it = payload.begin();
+   while (it != payload.end() && pResult->status == RequestParser::incomplete)
+   {
+      std::size_t size = std::min<std::size_t>(pieceSize, payload.end() - it);
+      std::string::const_iterator next;
+      pResult->status = parser.parse(pResult->request, it, it + size, &next);
+      it = next;
+   }
+   pResult->consumed = it - payload.begin();
+}
+
+RequestParser::status parseStatus(const std::string& payload)
+{
+   ParseResult result;
+   parseInPieces(payload, payload.size(), &result);
+   return result.status;
+}
+
+bool operator==(const ParseResult& a, const ParseResult& b)
+{
+   if (a.status != b.status || a.consumed != b.consumed)
+      return false;
+
+   // the state of the request is unspecified after an error
+   if (a.status == RequestParser::error)
+      return true;
+
+   const Request& x = a.request;
+   const Request& y = b.request;
+   if (x.method() != y.method() ||
+       x.uri() != y.uri() ||
+       x.httpVersionMajor() != y.httpVersionMajor() ||
+       x.httpVersionMinor() != y.httpVersionMinor() ||
+       x.body() != y.body() ||
+       x.headers().size() != y.headers().size())
+   {
+      return false;
+   }
+
+   for (std::size_t i = 0; i < x.headers().size(); i++)
+   {
+      if (x.headers()[i].name != y.headers()[i].name ||
+          x.headers()[i].value != y.headers()[i].value)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+// replace a few characters of the payload, favoring those significant to
+// the parser
+std::string mutate(const std::string& payload)
+{
+   const char significant[] = { '\r', '\n', ' ', ':', '\t', '/', '\x7f', '\xe9' };
+
+   std::string mutated = payload;
+   int count = 1 + std::rand() % 3;
+   for (int i = 0; i < count; i++)
+   {
+      std::size_t pos = std::rand() % mutated.size();
+      mutated[pos] = std::rand() % 2 == 0 ?
+               significant[std::rand() % sizeof(significant)] :
+               static_cast<char>(std::rand() % 256);
+   }
+   return mutated;
+}
+
+bool appendChunk(std::string* pBody,
+                 std::size_t maxSize,
+                 const std::string& chunk)
+{
+   pBody->append(chunk);
+   return pBody->size() <= maxSize;
+}
+
+RequestParser::BodyHandler bodyHandler(std::string* pBody,
+                                       std::size_t maxSize,
+                                       Request&)
+{
+   return boost::bind(appendChunk, pBody, maxSize, _1);
+}
+
+} // anonymous namespace
+
+context("RequestParserTests")
+{
+   test_that("Can parse a simple request")
+   {
+      std::string payload = "GET /index.htm HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+      RequestParser parser;
+      Request request;
+      RequestParser::status status = parser.parse(request,
+                                                  payload.begin(),
+                                                  payload.end());
+
+      CHECK(status == RequestParser::complete);
+      CHECK(request.method() == "GET");
+      CHECK(request.uri() == "/index.htm");
+      CHECK(request.host() == "localhost");
+   }
+
+   test_that("Reports position following a complete request")
+   {
+      std::string first = "POST /rpc HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello";
+      std::string second = "GET /events HTTP/1.1\r\n\r\n";
+      std::string payload = first + second;
+
+      RequestParser parser;
+      Request request;
+      std::string::iterator next = payload.end();
+      RequestParser::status status = parser.parse(request,
+                                                  payload.begin(),
+                                                  payload.end(),
+                                                  &next);
+
+      CHECK(status == RequestParser::complete);
+      CHECK(request.body() == "hello");
+      CHECK(std::string(next, payload.end()) == second);
+
+      // the pipelined request can then be parsed after a reset
+      parser.reset();
+      Request secondRequest;
+      status = parser.parse(secondRequest, next, payload.end(), &next);
+
+      CHECK(status == RequestParser::complete);
+      CHECK(secondRequest.uri() == "/events");
+      CHECK(next == payload.end());
+   }
+
+   test_that("Incomplete requests consume all input")
+   {
+      std::string payload = "GET /index.htm HTTP/1.1\r\nHost: loc";
+
+      RequestParser parser;
+      Request request;
+      std::string::iterator next = payload.begin();
+      RequestParser::status status = parser.parse(request,
+                                                  payload.begin(),
+                                                  payload.end(),
+                                                  &next);
+
+      CHECK(status == RequestParser::incomplete);
+      CHECK(next == payload.end());
+   }
+
+   test_that("Headers and bodies are parsed whole however input is split")
+   {
+      std::string payload = kRpcRequest;
+      ParseResult whole;
+      parseInPieces(payload, payload.size(), &whole);
+
+      REQUIRE(whole.status == RequestParser::complete);
+      CHECK(whole.consumed == payload.size());
+      CHECK(whole.request.method() == "POST");
+      CHECK(whole.request.uri() == "/rpc/get_environment_state");
+      CHECK(whole.request.headerValue("User-Agent") ==
+            "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36");
+      CHECK(whole.request.headerValue("X-Long-Header") == "first linecontinued");
+      CHECK(whole.request.body() == "{\"method\":\"get\",\"p\":[1,2]}");
+
+      for (std::size_t pieceSize = 1; pieceSize < 40; pieceSize++)
+      {
+         ParseResult pieces;
+         parseInPieces(payload, pieceSize, &pieces);
+         CHECK(pieces == whole);
+      }
+   }
+
+   test_that("Bodies can be parsed from non random access iterators")
+   {
+      std::string payload = kRpcRequest;
+      std::list<char> chars(payload.begin(), payload.end());
+
+      RequestParser parser;
+      Request request;
+      CHECK(parser.parse(request, chars.begin(), chars.end()) ==
+            RequestParser::complete);
+      CHECK(request.body() == "{\"method\":\"get\",\"p\":[1,2]}");
+   }
+
+   test_that("Bodies can be consumed by a body handler")
+   {
+      std::string payload = kRpcRequest;
+      for (std::size_t pieceSize = 1; pieceSize <= payload.size(); pieceSize++)
+      {
+         std::string body;
+         RequestParser parser;
+         parser.setBodyHandlerFactory(
+                  boost::bind(bodyHandler, &body, payload.size(), _1));
+
+         Request request;
+         RequestParser::status status = RequestParser::incomplete;
+         for (std::size_t i = 0;
+              i < payload.size() && status == RequestParser::incomplete;
+              i += pieceSize)
+         {
+            std::size_t end = std::min(payload.size(), i + pieceSize);
+            status = parser.parse(request,
+                                  payload.begin() + i,
+                                  payload.begin() + end);
+         }
+
+         CHECK(status == RequestParser::complete);
+         CHECK(request.body().empty());
+         CHECK(body == "{\"method\":\"get\",\"p\":[1,2]}");
+      }
+
+      // bodies rejected by the handler are errors
+      std::string body;
+      RequestParser parser;
+      parser.setBodyHandlerFactory(boost::bind(bodyHandler, &body, 10, _1));
+      Request request;
+      CHECK(parser.parse(request, payload.begin(), payload.end()) ==
+            RequestParser::error);
+   }
+
+   test_that("Invalid content lengths are rejected")
+   {
+      std::string payload = "POST /rpc HTTP/1.1\r\nContent-Length: x\r\n\r\n";
+      CHECK(parseStatus(payload) == RequestParser::error);
+
+      payload = "POST /rpc HTTP/1.1\r\nContent-Length: -1\r\n\r\n";
+      CHECK(parseStatus(payload) == RequestParser::error);
+   }
+
+   test_that("Mutated requests parse the same whether split or whole")
+   {
+      std::srand(42);
+      std::string payload = kRpcRequest;
+      for (int i = 0; i < 2000; i++)
+      {
+         std::string mutated = mutate(payload);
+         ParseResult whole, bytes, pieces;
+         parseInPieces(mutated, mutated.size(), &whole);
+         parseInPieces(mutated, 1, &bytes);
+         parseInPieces(mutated, 1 + std::rand() % 16, &pieces);
+
+         INFO(mutated);
+         CHECK(bytes == whole);
+         CHECK(pieces == whole);
+      }
+   }
+}
+
+// run with: rstudio-tests "[benchmark]"
+TEST_CASE("Request Parsing Benchmark", "[.][benchmark]")
+{
+   using namespace boost::posix_time;
+
+   std::string payload = kRpcRequest;
+   std::string upload = "POST /upload HTTP/1.1\r\nContent-Length: 8388608\r\n\r\n" +
+                        std::string(8388608, 'x');
+   const int kIterations = 100000;
+
+   ptime start = microsec_clock::universal_time();
+   for (int i = 0; i < kIterations; i++)
+   {
+      RequestParser parser;
+      Request request;
+      parser.parse(request, payload.begin(), payload.end());
+   }
+   time_duration rpc = microsec_clock::universal_time() - start;
+
+   start = microsec_clock::universal_time();
+   for (int i = 0; i < 10; i++)
+   {
+      // uploads arrive in pieces the size of the connection's buffer
+      ParseResult result;
+      parseInPieces(upload, 8192, &result);
+   }
+   time_duration uploads = microsec_clock::universal_time() - start;
+
+   std::cout << "Request parsing: " << kIterations << " RPC requests in "
+             << rpc.total_milliseconds() << "ms; 10 8MB uploads in "
+             << uploads.total_milliseconds() << "ms" << std::endl;
+}
+
+} // end namespace tests
+} // end namespace http
+} // end namespace core
+} // end namespace rstudio
@@ -16,6 +16,7 @@
 #include <core/http/Response.hpp>
 
 #include <algorithm>
+#include <map>
 
 #include <boost/regex.hpp>
 #include <boost/format.hpp>
@@ -23,12 +24,16 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
 
 #include <core/http/URL.hpp>
 #include <core/http/Util.hpp>
 #include <core/http/Cookie.hpp>
 #include <core/Hash.hpp>
+#include <core/MappedFile.hpp>
 #include <core/RegexUtils.hpp>
+#include <core/Thread.hpp>
 
 #include <core/FileSerializer.hpp>
 
@@ -36,6 +41,172 @@ namespace rstudio {
 namespace core {
 namespace http {
 
+const uintmax_t Response::kStreamFileThreshold = 4 * 1024 * 1024;
+
+namespace {
+
+// index of static files we have served (keyed by absolute path). entries
+// are invalidated when the file's size or modification time changes
+struct StaticFileInfo
+{
+   StaticFileInfo() : lastWriteTime(0), size(0) {}
+
+   std::time_t lastWriteTime;
+   uintmax_t size;
+   std::string eTag;
+
+   // precompressed sibling (empty if there isn't an up to date one)
+   FilePath gzipPath;
+};
+
+boost::mutex s_staticFileMutex;
+std::map<std::string, StaticFileInfo> s_staticFileIndex;
+
+// parse the value of a Range header for content of the given length. only
+// single byte ranges ("bytes=<first>-[<last>]" or "bytes=-<suffix length>")
+// are supported; other values return false and should be ignored (i.e. the
+// whole content returned). pSatisfiable indicates whether the range
+// overlaps the content (pBegin and pEnd are only set if it does)
+bool parseByteRange(const std::string& range,
+                    uintmax_t length,
+                    uintmax_t* pBegin,
+                    uintmax_t* pEnd,
+                    bool* pSatisfiable)
+{
+   boost::regex re("bytes=(\\d*)\\-(\\d*)");
+   boost::smatch match;
+   if (!regex_utils::match(range, match, re))
+      return false;
+
+   std::string first = match[1];
+   std::string last = match[2];
+   if (first.empty() && last.empty())
+      return false;
+
+   uintmax_t begin, end;
+   try
+   {
+      if (first.empty())
+      {
+         // the last <last> bytes
+         uintmax_t suffix = boost::lexical_cast<uintmax_t>(last);
+         begin = suffix < length ? length - suffix : 0;
+         *pSatisfiable = suffix > 0 && length > 0;
+         end = length - 1;
+      }
+      else
+      {
+         begin = boost::lexical_cast<uintmax_t>(first);
+         end = last.empty() ? length - 1 : boost::lexical_cast<uintmax_t>(last);
+         if (end < begin)
+            return false;
+
+         *pSatisfiable = begin < length;
+         end = std::min(end, length - 1);
+      }
+   }
+   catch(const boost::bad_lexical_cast&)
+   {
+      return false;
+   }
+
+   if (*pSatisfiable)
+   {
+      *pBegin = begin;
+      *pEnd = end;
+   }
+   return true;
+}
+
+std::string contentRange(uintmax_t begin, uintmax_t end, uintmax_t length)
+{
+   boost::format fmt("bytes %1%-%2%/%3%");
+   return boost::str(fmt % begin % end % length);
+}
+
+Error readFileRange(const FilePath& filePath,
+                    uintmax_t offset,
+                    uintmax_t count,
+                    std::string* pContents)
+{
+   boost::shared_ptr<std::istream> pIfs;
+   Error error = filePath.open_r(&pIfs);
+   if (error)
+      return error;
+
+   try
+   {
+      pContents->resize(static_cast<std::size_t>(count));
+      pIfs->seekg(static_cast<std::streamoff>(offset));
+      if (count > 0)
+         pIfs->read(&(*pContents)[0], static_cast<std::streamsize>(count));
+      if (pIfs->bad())
+         return systemError(boost::system::errc::io_error, ERROR_LOCATION);
+      pContents->resize(static_cast<std::size_t>(pIfs->gcount()));
+   }
+   catch(const std::exception& e)
+   {
+      Error error = systemError(boost::system::errc::io_error,
+                                ERROR_LOCATION);
+      error.addProperty("what", e.what());
+      error.addProperty("path", filePath.absolutePath());
+      return error;
+   }
+
+   return Success();
+}
+
+Error staticFileInfo(const FilePath& filePath, StaticFileInfo* pInfo)
+{
+   std::string path = filePath.absolutePath();
+   std::time_t lastWriteTime = filePath.lastWriteTime();
+   uintmax_t size = filePath.size();
+
+   bool indexed = false;
+   LOCK_MUTEX(s_staticFileMutex)
+   {
+      std::map<std::string, StaticFileInfo>::const_iterator it =
+                                                s_staticFileIndex.find(path);
+      if (it != s_staticFileIndex.end() &&
+          it->second.lastWriteTime == lastWriteTime &&
+          it->second.size == size)
+      {
+         *pInfo = it->second;
+         indexed = true;
+      }
+   }
+   END_LOCK_MUTEX
+
+   if (indexed)
+      return Success();
+
+   // (re)index the file
+   std::string content;
+   Error error = core::readStringFromFile(filePath, &content);
+   if (error)
+      return error;
+
+   StaticFileInfo info;
+   info.lastWriteTime = lastWriteTime;
+   info.size = size;
+   info.eTag = core::hash::crc32Hash(content);
+
+   FilePath gzipPath(path + ".gz");
+   if (gzipPath.exists() && gzipPath.lastWriteTime() >= lastWriteTime)
+      info.gzipPath = gzipPath;
+
+   LOCK_MUTEX(s_staticFileMutex)
+   {
+      s_staticFileIndex[path] = info;
+   }
+   END_LOCK_MUTEX
+
+   *pInfo = info;
+   return Success();
+}
+
+} // anonymous namespace
+
 Response::Response() 
    : Message(), statusCode_(status::Ok) 
 {
@@ -62,6 +233,19 @@ void Response::setContentEncoding(const std::string& encoding)
    setHeader("Content-Encoding", encoding);
 }
 
+void Response::negotiateContentEncoding(const Request& request)
+{
+   setHeader("Vary", "Accept-Encoding");
+
+   std::string type = contentType();
+   if (!type.empty() && !isCompressibleContentType(type))
+      return;
+
+   std::string encoding = preferredEncoding(request.acceptEncoding());
+   if (!encoding.empty())
+      setContentEncoding(encoding);
+}
+
 void Response::setCacheWithRevalidationHeaders()
 {
    setHeader("Expires", http::util::httpDate());
@@ -163,6 +347,83 @@ Error Response::setBody(const std::string& content)
    return setBody(is);
 }
 
+Error Response::setBodyFromWriter(
+                     const boost::function<void(std::ostream&)>& writer)
+{
+   try
+   {
+      boost::iostreams::filtering_ostream filteringStream;
+      std::string encoding = pushContentEncoding(&filteringStream, 4096);
+
+      std::ostringstream bodyStream;
+      filteringStream.push(bodyStream, 4096);
+
+      filteringStream.exceptions(std::ostream::failbit | std::ostream::badbit);
+      writer(filteringStream);
+
+      // closing the chain flushes the compressor
+      filteringStream.reset();
+
+      body_ = bodyStream.str();
+      return finishBody(encoding, false);
+   }
+   catch(const std::exception& e)
+   {
+      Error error = systemError(boost::system::errc::io_error,
+                                ERROR_LOCATION);
+      error.addProperty("what", e.what());
+      return error;
+   }
+}
+
+std::string Response::pushContentEncoding(
+                           boost::iostreams::filtering_ostream* pStream,
+                           std::streamsize buffSize)
+{
+   // don't compress content which is already compressed
+   std::string encoding = contentEncoding();
+   if (isSupportedEncoding(encoding) &&
+       !isCompressibleContentType(contentType()))
+   {
+      removeHeader("Content-Encoding");
+      encoding.clear();
+   }
+
+   // handle gzip
+   if (encoding == kGzipEncoding)
+#ifdef _WIN32
+      // never gzip on win32
+      removeHeader("Content-Encoding");
+#else
+      // add gzip compressor on posix
+      pStream->push(boost::iostreams::gzip_compressor(
+               boost::iostreams::gzip_params(compressionLevel())),
+                    buffSize);
+#endif
+
+   return encoding;
+}
+
+Error Response::finishBody(const std::string& encoding, bool padding)
+{
+   // other encodings compress the whole body at once
+   if (encoding != kGzipEncoding && isSupportedEncoding(encoding))
+   {
+      Error error = compressContent(encoding, body_, &body_);
+      if (error)
+         return error;
+   }
+
+   if (padding && body_.length() < 1024)
+   {
+      body_ = body_ + std::string(1024 - body_.length(), ' ');
+   }
+
+   setContentLength(static_cast<int>(body_.length()));
+
+   return Success();
+}
+
 Error Response::setCacheableBody(const FilePath& filePath,
                                  const Request& request)
 {
@@ -181,84 +442,322 @@ void Response::setDynamicHtml(const std::string& html,
    setContentType("text/html");
    setNoCacheHeaders();
 
-   // gzip if possible
-   if (request.acceptsEncoding(kGzipEncoding))
-      setContentEncoding(kGzipEncoding);
+   // compress if possible
+   negotiateContentEncoding(request);
 
    // set body
    setBody(html);
 }
 
-void Response::setRangeableFile(const FilePath& filePath,
-                                const Request& request)
+void Response::setStreamFile(const FilePath& filePath,
+                             const Request& request,
+                             std::size_t chunkSize)
 {
-   // read the file in from disk
-   std::string contents;
-   Error error = core::readStringFromFile(filePath, &contents);
+   if (!filePath.exists())
+   {
+      setNotFoundError(request);
+      return;
+   }
+
+   setContentType(filePath.mimeContentType());
+
+   // streamed bodies are always gzipped (compressed chunk by chunk)
+   bool gzip = request.acceptsEncoding(kGzipEncoding) &&
+               isCompressibleContentType(filePath.mimeContentType());
+
+   boost::shared_ptr<StreamResponse> pStream;
+   Error error = StreamResponse::createFromFile(filePath,
+                                                gzip,
+                                                chunkSize,
+                                                &pStream);
+   if (error)
+   {
+      setError(status::InternalServerError, error.code().message());
+      return;
+   }
+
+   setStreamResponse(pStream);
+}
+
+void Response::setStreamBody(const StreamResponse::Generator& generator,
+                             const Request& request,
+                             std::size_t chunkSize)
+{
+   bool gzip = request.acceptsEncoding(kGzipEncoding) &&
+               isCompressibleContentType(contentType());
+
+   setStreamResponse(boost::shared_ptr<StreamResponse>(
+         new StreamResponse(generator, gzip, chunkSize)));
+}
+
+void Response::setStreamResponse(boost::shared_ptr<StreamResponse> pStream)
+{
+   streamResponse_ = pStream;
+   sendFilePath_ = FilePath();
+
+   // the body is written separately (as chunks) by the connection
+   body_.clear();
+   removeHeader("Content-Length");
+   setHeader(kTransferEncoding, kChunkedTransferEncoding);
+
+   if (pStream->gzip())
+      setContentEncoding(kGzipEncoding);
+   else
+      removeHeader("Content-Encoding");
+}
+
+void Response::setStaticFile(const FilePath& filePath,
+                             const Request& request)
+{
+   if (!filePath.exists())
+   {
+      setNotFoundError(request);
+      return;
+   }
+
+   StaticFileInfo info;
+   Error error = staticFileInfo(filePath, &info);
    if (error)
    {
       setError(error);
       return;
    }
 
-   setRangeableFile(contents, filePath.mimeContentType(), request);
+   // serve the precompressed sibling if there is one (the install step
+   // writes these for the client assets); otherwise compress the file as it
+   // is sent (as setFile would)
+   setContentType(filePath.mimeContentType());
+   removeHeader("Content-Encoding");
+   bool precompressed = !info.gzipPath.empty() &&
+                        request.acceptsEncoding(kGzipEncoding);
+   if (precompressed)
+      setContentEncoding(kGzipEncoding);
+   else if (info.gzipPath.empty())
+      negotiateContentEncoding(request);
+
+   // each encoded representation gets its own eTag
+   std::string encoding = contentEncoding();
+   std::string eTag = encoding.empty() ? info.eTag : info.eTag + "-" + encoding;
+
+   using namespace boost::posix_time;
+   ptime lastModifiedDate = from_time_t(info.lastWriteTime);
+   setHeader("Last-Modified", util::httpDate(lastModifiedDate));
+   setHeader("ETag", eTag);
+   setHeader("Vary", "Accept-Encoding");
+
+   if (eTag == request.headerValue("If-None-Match") ||
+       lastModifiedDate == request.ifModifiedSince())
+   {
+      removeHeader("Content-Type"); // upstream code may have set this
+      removeHeader("Content-Encoding");
+      setStatusCode(status::NotModified);
+      return;
+   }
+
+   if (precompressed)
+   {
+      setSendFile(info.gzipPath);
+   }
+   else if (encoding.empty())
+   {
+      setSendFile(filePath);
+   }
+   else
+   {
+      error = setBody(filePath);
+      if (error)
+         setError(status::InternalServerError, error.code().message());
+   }
 }
 
-void Response::setRangeableFile(const std::string& contents,
-                                const std::string& mimeType,
+void Response::setResourceFile(const FilePath& filePath,
+                               const Request& request)
+{
+   if (!filePath.exists())
+   {
+      setNotFoundError(request);
+      return;
+   }
+
+   boost::shared_ptr<const MappedFile> pResource;
+   Error error = mappedResource(filePath, &pResource);
+   if (error)
+   {
+      setError(status::InternalServerError, error.code().message());
+      return;
+   }
+
+   using namespace boost::posix_time;
+   ptime lastModifiedDate = from_time_t(pResource->lastWriteTime());
+   setHeader("Last-Modified", util::httpDate(lastModifiedDate));
+   if (lastModifiedDate == request.ifModifiedSince())
+   {
+      removeHeader("Content-Type"); // upstream code may have set this
+      setStatusCode(status::NotModified);
+      return;
+   }
+
+   setContentType(filePath.mimeContentType());
+   negotiateContentEncoding(request);
+
+   bool padding =
+       browser_utils::isQt(request.headerValue("User-Agent")) &&
+       filePath.mimeContentType() == "text/html";
+
+   // read the body straight from the mapping
+   boost::iostreams::stream<boost::iostreams::array_source> resourceStream(
+                                    pResource->data(), pResource->size());
+   NullOutputFilter nullFilter;
+   error = setBody(resourceStream, nullFilter, 4096, padding);
+   if (error)
+      setError(status::InternalServerError, error.code().message());
+}
+
+void Response::setSendFile(const FilePath& filePath)
+{
+   sendFilePath_ = filePath;
+   streamResponse_.reset();
+   body_.clear();
+   removeHeader(kTransferEncoding);
+   setContentLength(static_cast<int>(filePath.size()));
+}
+
+Error Response::loadSendFile()
+{
+   if (sendFilePath_.empty())
+      return Success();
+
+   std::string content;
+   Error error = core::readStringFromFile(sendFilePath_, &content);
+   if (error)
+      return error;
+
+   // the content is already encoded as described by our headers
+   sendFilePath_ = FilePath();
+   body_.swap(content);
+   setContentLength(static_cast<int>(body_.length()));
+   return Success();
+}
+
+void Response::setRangeableFile(const FilePath& filePath,
                                 const Request& request)
 {
-   // set content type
-   setContentType(mimeType);
+   if (!filePath.exists())
+   {
+      setNotFoundError(request);
+      return;
+   }
 
-   // parse the range field
-   std::string range = request.headerValue("Range");
-   boost::regex re("bytes=(\\d*)\\-(\\d*)");
-   boost::smatch match;
-   if (regex_utils::match(range, match, re))
+   // indicate that we accept byte range requests
+   setHeader("Accept-Ranges", "bytes");
+
+   // requests without a (single) range get the whole file
+   uintmax_t length = filePath.size();
+   uintmax_t begin, end;
+   bool satisfiable;
+   if (!parseByteRange(request.headerValue("Range"),
+                       length,
+                       &begin,
+                       &end,
+                       &satisfiable))
    {
-      // specify partial content
-      setStatusCode(http::status::PartialContent);
+      setFile(filePath, request);
+      return;
+   }
 
-      // determine the byte range
-      const size_t kNone = -1;
-      size_t begin = safe_convert::stringTo<size_t>(match[1], kNone);
-      size_t end = safe_convert::stringTo<size_t>(match[2], kNone);
-      size_t total = contents.length();
+   setContentType(filePath.mimeContentType());
+   if (!satisfiable)
+   {
+      setRangeNotSatisfiable(length);
+      return;
+   }
+
+   setStatusCode(http::status::PartialContent);
+   setHeader("Content-Range", contentRange(begin, end, length));
 
-      if (end == kNone)
+   // ranges are always sent as-is (the range refers to the unencoded file)
+   removeHeader("Content-Encoding");
+   uintmax_t count = end - begin + 1;
+   if (count > kStreamFileThreshold)
+   {
+      boost::shared_ptr<StreamResponse> pStream;
+      Error error = StreamResponse::createFromFileRange(
+                                                filePath,
+                                                begin,
+                                                count,
+                                                StreamResponse::kDefaultChunkSize,
+                                                &pStream);
+      if (error)
       {
-         end = total-1;
+         setError(error);
+         return;
       }
-      if (begin == kNone)
+
+      setStreamResponse(pStream);
+   }
+   else
+   {
+      std::string contents;
+      Error error = readFileRange(filePath, begin, count, &contents);
+      if (error)
       {
-         begin = total - end;
-         end = total-1;
+         setError(error);
+         return;
       }
 
-      // set the byte range
-      addHeader("Accept-Ranges", "bytes");
-      boost::format fmt("bytes %1%-%2%/%3%");
-      std::string range = boost::str(fmt % begin % end % contents.length());
-      addHeader("Content-Range", range);
+      setBody(contents);
+   }
+}
 
-      // always attempt gzip
-      if (request.acceptsEncoding(http::kGzipEncoding))
-         setContentEncoding(http::kGzipEncoding);
+void Response::setRangeableFile(const std::string& contents,
+                                const std::string& mimeType,
+                                const Request& request)
+{
+   // set content type
+   setContentType(mimeType);
 
-      // set body
-      if (begin == 0 && end == (contents.length()-1))
-         setBody(contents);
-      else
-         setBody(contents.substr(begin, end-begin+1));
+   // indicate that we accept byte range requests
+   setHeader("Accept-Ranges", "bytes");
+
+   // requests without a (single) range get all of the contents
+   uintmax_t begin, end;
+   bool satisfiable;
+   if (!parseByteRange(request.headerValue("Range"),
+                       contents.length(),
+                       &begin,
+                       &end,
+                       &satisfiable))
+   {
+      negotiateContentEncoding(request);
+      setBody(contents);
+      return;
    }
-   else
+
+   if (!satisfiable)
    {
-      setStatusCode(http::status::RangeNotSatisfiable);
-      boost::format fmt("bytes */%1%");
-      std::string range = boost::str(fmt % contents.length());
-      addHeader("Content-Range", range);
+      setRangeNotSatisfiable(contents.length());
+      return;
    }
+
+   // specify partial content
+   setStatusCode(http::status::PartialContent);
+   setHeader("Content-Range", contentRange(begin, end, contents.length()));
+
+   // set body (as-is, since the range refers to the unencoded contents)
+   removeHeader("Content-Encoding");
+   if (begin == 0 && end == (contents.length()-1))
+      setBody(contents);
+   else
+      setBody(contents.substr(static_cast<std::size_t>(begin),
+                              static_cast<std::size_t>(end - begin + 1)));
+}
+
+void Response::setRangeNotSatisfiable(uintmax_t length)
+{
+   setStatusCode(http::status::RangeNotSatisfiable);
+   boost::format fmt("bytes */%1%");
+   setHeader("Content-Range", boost::str(fmt % length));
+   setBodyUnencoded("");
 }
    
 void Response::setBodyUnencoded(const std::string& body)
@@ -271,6 +770,11 @@ void Response::setBodyUnencoded(const std::string& body)
    
 void Response::setError(int statusCode, const std::string& message)
 {
+   // errors replace any streamed or send file body
+   streamResponse_.reset();
+   sendFilePath_ = FilePath();
+   removeHeader(kTransferEncoding);
+
    setStatusCode(statusCode);
    removeCachingHeaders();
    setContentType("text/html");
@@ -341,6 +845,8 @@ void Response::resetMembers()
 	statusCode_ = status::Ok ;
 	statusCodeStr_.clear() ;
 	statusMessage_.clear() ;
+	streamResponse_.reset();
+	sendFilePath_ = FilePath();
 }
    
 void Response::removeCachingHeaders()
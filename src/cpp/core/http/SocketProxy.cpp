@@ -27,10 +27,18 @@
 
 #include <iostream>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#endif
+
 #include <boost/bind.hpp>
 
 #include <boost/asio/placeholders.hpp>
 
+#include <boost/foreach.hpp>
+
 #include <core/Error.hpp>
 #include <core/Log.hpp>
 
@@ -42,6 +50,302 @@ namespace rstudio {
 namespace core {
 namespace http {
 
+#ifdef __linux__
+
+namespace {
+
+// proxies between two sockets by splicing data from each socket into a
+// pipe and from the pipe into the other socket. each direction keeps at
+// most one pipe's worth of data in flight and waits for the destination
+// to become writable (rather than reading more) when it can't keep up
+class SpliceProxy : public boost::enable_shared_from_this<SpliceProxy>
+{
+private:
+   struct Direction
+   {
+      explicit Direction(boost::asio::io_service& ioService)
+         : source(ioService), destination(ioService), pending(0)
+      {
+         pipeFds[0] = pipeFds[1] = -1;
+      }
+
+      // dups of the proxied sockets' descriptors (used only to wait
+      // for readiness -- the data is moved by splice)
+      boost::asio::posix::stream_descriptor source;
+      boost::asio::posix::stream_descriptor destination;
+      int pipeFds[2];
+
+      // bytes currently in the pipe
+      std::size_t pending;
+   };
+
+public:
+   static Error create(boost::asio::io_service& ioService,
+                       boost::shared_ptr<Socket> ptrClient,
+                       boost::shared_ptr<Socket> ptrServer,
+                       std::size_t bufferSize)
+   {
+      boost::shared_ptr<SpliceProxy> pProxy(
+         new SpliceProxy(ioService, ptrClient, ptrServer, bufferSize));
+
+      Error error = pProxy->init(pProxy->toServer_,
+                                 ptrClient->nativeHandle(),
+                                 ptrServer->nativeHandle());
+      if (!error)
+         error = pProxy->init(pProxy->toClient_,
+                              ptrServer->nativeHandle(),
+                              ptrClient->nativeHandle());
+      if (error)
+      {
+         // leave the sockets open so the caller can fall back
+         pProxy->closeDescriptors();
+         return error;
+      }
+
+      pProxy->pump(&pProxy->toServer_);
+      pProxy->pump(&pProxy->toClient_);
+      return Success();
+   }
+
+   ~SpliceProxy()
+   {
+      try
+      {
+         closeDescriptors();
+      }
+      catch(...)
+      {
+      }
+   }
+
+private:
+   SpliceProxy(boost::asio::io_service& ioService,
+               boost::shared_ptr<Socket> ptrClient,
+               boost::shared_ptr<Socket> ptrServer,
+               std::size_t bufferSize)
+      : ptrClient_(ptrClient),
+        ptrServer_(ptrServer),
+        bufferSize_(bufferSize),
+        toServer_(ioService),
+        toClient_(ioService),
+        closed_(false)
+   {
+   }
+
+   Error init(Direction& direction, int sourceFd, int destinationFd)
+   {
+      if (::pipe2(direction.pipeFds, O_NONBLOCK | O_CLOEXEC) == -1)
+         return systemError(errno, ERROR_LOCATION);
+
+      // size the pipe to the requested buffer (the kernel may round it
+      // up, and failing to resize it just leaves the default in place)
+      ::fcntl(direction.pipeFds[1], F_SETPIPE_SZ, static_cast<int>(bufferSize_));
+
+      boost::system::error_code ec;
+      direction.source.assign(::dup(sourceFd), ec);
+      if (!ec)
+         direction.destination.assign(::dup(destinationFd), ec);
+
+      // SPLICE_F_NONBLOCK only applies to the pipe, so the sockets must be
+      // non-blocking themselves for splice never to block the io_service
+      // thread (rather than relying on earlier async operations on them
+      // having set O_NONBLOCK)
+      if (!ec)
+         direction.source.native_non_blocking(true, ec);
+      if (!ec)
+         direction.destination.native_non_blocking(true, ec);
+      if (ec)
+         return Error(ec, ERROR_LOCATION);
+
+      return Success();
+   }
+
+   // move as much data as we can without blocking, then wait for
+   // whichever end is holding us up
+   void pump(Direction* pDirection)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         if (closed_)
+            return;
+
+         while (true)
+         {
+            // fill the pipe from the source
+            if (pDirection->pending == 0)
+            {
+               ssize_t n = ::splice(pDirection->source.native_handle(), NULL,
+                                    pDirection->pipeFds[1], NULL,
+                                    bufferSize_,
+                                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+               if (n == 0)
+               {
+                  // end of stream
+                  close();
+                  return;
+               }
+               else if (n < 0)
+               {
+                  if (errno == EAGAIN || errno == EWOULDBLOCK)
+                  {
+                     pDirection->source.async_read_some(
+                        boost::asio::null_buffers(),
+                        boost::bind(&SpliceProxy::handleReady,
+                                    shared_from_this(),
+                                    pDirection,
+                                    boost::asio::placeholders::error));
+                  }
+                  else
+                  {
+                     handleError(errno, ERROR_LOCATION);
+                  }
+                  return;
+               }
+
+               pDirection->pending = static_cast<std::size_t>(n);
+            }
+
+            // drain the pipe into the destination
+            while (pDirection->pending > 0)
+            {
+               ssize_t n = ::splice(pDirection->pipeFds[0], NULL,
+                                    pDirection->destination.native_handle(),
+                                    NULL,
+                                    pDirection->pending,
+                                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+               if (n < 0)
+               {
+                  if (errno == EAGAIN || errno == EWOULDBLOCK)
+                  {
+                     // backpressure: nothing more is read from the source
+                     // until the destination accepts what we have
+                     pDirection->destination.async_write_some(
+                        boost::asio::null_buffers(),
+                        boost::bind(&SpliceProxy::handleReady,
+                                    shared_from_this(),
+                                    pDirection,
+                                    boost::asio::placeholders::error));
+                  }
+                  else
+                  {
+                     handleError(errno, ERROR_LOCATION);
+                  }
+                  return;
+               }
+
+               pDirection->pending -= static_cast<std::size_t>(n);
+            }
+         }
+      }
+      END_LOCK_MUTEX
+   }
+
+   void handleReady(Direction* pDirection, const boost::system::error_code& ec)
+   {
+      try
+      {
+         if (ec)
+         {
+            if (ec != boost::asio::error::operation_aborted)
+            {
+               LOCK_MUTEX(mutex_)
+               {
+                  handleError(ec.value(), ERROR_LOCATION);
+               }
+               END_LOCK_MUTEX
+            }
+            return;
+         }
+
+         pump(pDirection);
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   // must be called with mutex_ held
+   void handleError(int errorNumber, const ErrorLocation& location)
+   {
+      Error error = systemError(errorNumber, location);
+      if (!http::isConnectionTerminatedError(error) &&
+          errorNumber != EBADF)
+      {
+         LOG_ERROR(error);
+      }
+
+      close();
+   }
+
+   // must be called with mutex_ held
+   void close()
+   {
+      if (closed_)
+         return;
+      closed_ = true;
+
+      closeDescriptors();
+      ptrClient_->close();
+      ptrServer_->close();
+   }
+
+   void closeDescriptors()
+   {
+      Direction* directions[] = { &toServer_, &toClient_ };
+      BOOST_FOREACH(Direction* pDirection, directions)
+      {
+         boost::system::error_code ec;
+         pDirection->source.close(ec);
+         pDirection->destination.close(ec);
+         for (int i = 0; i < 2; ++i)
+         {
+            if (pDirection->pipeFds[i] != -1)
+            {
+               ::close(pDirection->pipeFds[i]);
+               pDirection->pipeFds[i] = -1;
+            }
+         }
+      }
+   }
+
+private:
+   boost::shared_ptr<Socket> ptrClient_;
+   boost::shared_ptr<Socket> ptrServer_;
+   std::size_t bufferSize_;
+   Direction toServer_;
+   Direction toClient_;
+   boost::mutex mutex_;
+   bool closed_;
+};
+
+} // anonymous namespace
+
+#endif
+
+void SocketProxy::create(boost::asio::io_service& ioService,
+                         boost::shared_ptr<core::http::Socket> ptrClient,
+                         boost::shared_ptr<core::http::Socket> ptrServer,
+                         const SocketProxyOptions& options)
+{
+#ifdef __linux__
+   if (options.useSplice &&
+       ptrClient->nativeHandle() != -1 &&
+       ptrServer->nativeHandle() != -1)
+   {
+      Error error = SpliceProxy::create(ioService,
+                                        ptrClient,
+                                        ptrServer,
+                                        std::max<std::size_t>(
+                                                options.bufferSize, 1));
+      if (!error)
+         return;
+
+      // not fatal: fall back to copying through our own buffers
+      LOG_ERROR(error);
+   }
+#endif
+
+   create(ptrClient, ptrServer, options);
+}
+
 void SocketProxy::readClient()
 {
    ptrClient_->asyncReadSome(
@@ -0,0 +1,91 @@
+/*
+ * SslSessionCache.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/SslSessionCache.hpp>
+
+#include <map>
+
+#include <core/Thread.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace ssl_session_cache {
+
+namespace {
+
+// sessions are small, but bound the cache for processes which connect to
+// many servers
+const std::size_t kMaxSessions = 64;
+
+// heap based so they are never destructed (clients may still be running as
+// the process exits)
+boost::mutex* s_pMutex = new boost::mutex();
+std::map<std::string, SSL_SESSION*>* s_pSessions =
+                                       new std::map<std::string, SSL_SESSION*>();
+
+} // anonymous namespace
+
+void resumeSession(const std::string& server, SSL* pSsl)
+{
+   LOCK_MUTEX(*s_pMutex)
+   {
+      std::map<std::string, SSL_SESSION*>::const_iterator it =
+                                                   s_pSessions->find(server);
+
+      // (the ssl takes its own reference to the session)
+      if (it != s_pSessions->end())
+         ::SSL_set_session(pSsl, it->second);
+   }
+   END_LOCK_MUTEX
+}
+
+void saveSession(const std::string& server, SSL* pSsl)
+{
+   SSL_SESSION* pSession = ::SSL_get1_session(pSsl);
+   if (pSession == NULL)
+      return;
+
+   LOCK_MUTEX(*s_pMutex)
+   {
+      std::map<std::string, SSL_SESSION*>::iterator it =
+                                                   s_pSessions->find(server);
+      if (it != s_pSessions->end())
+      {
+         ::SSL_SESSION_free(it->second);
+         it->second = pSession;
+         return;
+      }
+
+      // make room by forgetting an arbitrary server
+      if (s_pSessions->size() >= kMaxSessions)
+      {
+         ::SSL_SESSION_free(s_pSessions->begin()->second);
+         s_pSessions->erase(s_pSessions->begin());
+      }
+
+      (*s_pSessions)[server] = pSession;
+      return;
+   }
+   END_LOCK_MUTEX
+
+   // mutex related error
+   ::SSL_SESSION_free(pSession);
+}
+
+} // namespace ssl_session_cache
+} // namespace http
+} // namespace core
+} // namespace rstudio
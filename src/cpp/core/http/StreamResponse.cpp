@@ -0,0 +1,263 @@
+/*
+ * StreamResponse.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/StreamResponse.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+#ifndef _WIN32
+#include <boost/iostreams/filter/gzip.hpp>
+#endif
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+
+#include <core/http/ContentEncoding.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+Error readFromStream(boost::shared_ptr<std::istream> pStream,
+                     std::size_t maxBytes,
+                     std::string* pData)
+{
+   pData->clear();
+   if (pStream->eof())
+      return Success();
+
+   try
+   {
+      std::vector<char> buffer(maxBytes);
+      pStream->read(&buffer[0], maxBytes);
+      if (pStream->bad())
+         return systemError(boost::system::errc::io_error, ERROR_LOCATION);
+
+      pData->assign(&buffer[0], static_cast<std::size_t>(pStream->gcount()));
+      return Success();
+   }
+   catch(const std::exception& e)
+   {
+      Error error = systemError(boost::system::errc::io_error,
+                                ERROR_LOCATION);
+      error.addProperty("what", e.what());
+      return error;
+   }
+}
+
+// read (at most) the remaining bytes of a range of the stream
+Error readRangeFromStream(boost::shared_ptr<std::istream> pStream,
+                          boost::shared_ptr<uintmax_t> pRemaining,
+                          std::size_t maxBytes,
+                          std::string* pData)
+{
+   if (*pRemaining == 0)
+   {
+      pData->clear();
+      return Success();
+   }
+
+   if (*pRemaining < maxBytes)
+      maxBytes = static_cast<std::size_t>(*pRemaining);
+
+   Error error = readFromStream(pStream, maxBytes, pData);
+   if (error)
+      return error;
+
+   // stop at the end of the file even if the range ran past it
+   *pRemaining = pData->empty() ? 0 : *pRemaining - pData->size();
+   return Success();
+}
+
+} // anonymous namespace
+
+const std::size_t StreamResponse::kDefaultChunkSize = 65536;
+
+StreamResponse::StreamResponse(const Generator& generator,
+                               bool gzip,
+                               std::size_t chunkSize)
+   : generator_(generator),
+     gzip_(gzip),
+     chunkSize_(chunkSize > 0 ? chunkSize : kDefaultChunkSize),
+     complete_(false)
+{
+#ifdef _WIN32
+   // never gzip on win32
+   gzip_ = false;
+#else
+   if (gzip_)
+   {
+      pCompressor_.reset(new boost::iostreams::filtering_ostream());
+      pCompressor_->push(boost::iostreams::gzip_compressor(
+                     boost::iostreams::gzip_params(compressionLevel())));
+      pCompressor_->push(boost::iostreams::back_inserter(compressed_));
+   }
+#endif
+}
+
+StreamResponse::~StreamResponse()
+{
+   try
+   {
+      // make sure the compressor doesn't attempt to flush into a
+      // destroyed buffer
+      if (pCompressor_)
+      {
+         pCompressor_->reset();
+         pCompressor_.reset();
+      }
+   }
+   catch(...)
+   {
+   }
+}
+
+Error StreamResponse::createFromFile(const FilePath& filePath,
+                                     bool gzip,
+                                     std::size_t chunkSize,
+                                     boost::shared_ptr<StreamResponse>* pStream)
+{
+   boost::shared_ptr<std::istream> pIfs;
+   Error error = filePath.open_r(&pIfs);
+   if (error)
+      return error;
+
+   pStream->reset(new StreamResponse(boost::bind(readFromStream, pIfs, _1, _2),
+                                     gzip,
+                                     chunkSize));
+   return Success();
+}
+
+Error StreamResponse::createFromFileRange(
+                              const FilePath& filePath,
+                              uintmax_t offset,
+                              uintmax_t length,
+                              std::size_t chunkSize,
+                              boost::shared_ptr<StreamResponse>* pStream)
+{
+   boost::shared_ptr<std::istream> pIfs;
+   Error error = filePath.open_r(&pIfs);
+   if (error)
+      return error;
+
+   try
+   {
+      pIfs->seekg(static_cast<std::streamoff>(offset));
+      if (pIfs->fail())
+         return systemError(boost::system::errc::io_error, ERROR_LOCATION);
+   }
+   catch(const std::exception& e)
+   {
+      Error error = systemError(boost::system::errc::io_error,
+                                ERROR_LOCATION);
+      error.addProperty("what", e.what());
+      error.addProperty("path", filePath.absolutePath());
+      return error;
+   }
+
+   boost::shared_ptr<uintmax_t> pRemaining(new uintmax_t(length));
+   pStream->reset(new StreamResponse(
+                     boost::bind(readRangeFromStream, pIfs, pRemaining, _1, _2),
+                     false,
+                     chunkSize));
+   return Success();
+}
+
+Error StreamResponse::nextBlock(std::string* pData)
+{
+   pData->clear();
+
+   if (!pCompressor_)
+   {
+      // if we were compressing then the compressor has been flushed
+      // and whatever remains is the final block
+      if (gzip_)
+      {
+         pData->swap(compressed_);
+         return Success();
+      }
+
+      return generator_(chunkSize_, pData);
+   }
+
+   // feed the compressor until it produces some output (or we run out
+   // of input, at which point we flush it)
+   while (compressed_.empty() && pCompressor_)
+   {
+      std::string input;
+      Error error = generator_(chunkSize_, &input);
+      if (error)
+         return error;
+
+      try
+      {
+         if (input.empty())
+         {
+            pCompressor_->reset();
+            pCompressor_.reset();
+         }
+         else
+         {
+            pCompressor_->write(input.data(), input.size());
+         }
+      }
+      catch(const std::exception& e)
+      {
+         Error error = systemError(boost::system::errc::io_error,
+                                   ERROR_LOCATION);
+         error.addProperty("what", e.what());
+         return error;
+      }
+   }
+
+   pData->swap(compressed_);
+   return Success();
+}
+
+Error StreamResponse::nextChunk(std::string* pChunk)
+{
+   pChunk->clear();
+   if (complete_)
+      return Success();
+
+   std::string data;
+   Error error = nextBlock(&data);
+   if (error)
+      return error;
+
+   if (data.empty())
+      complete_ = true;
+
+   *pChunk = formatChunk(data);
+   return Success();
+}
+
+std::string formatChunk(const std::string& data)
+{
+   std::ostringstream ostr;
+   ostr << std::hex << data.size() << "\r\n" << data << "\r\n";
+   return ostr.str();
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
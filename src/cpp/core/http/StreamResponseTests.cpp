@@ -0,0 +1,171 @@
+/*
+ * StreamResponseTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/http/ChunkParser.hpp>
+#include <core/http/StreamResponse.hpp>
+
+#ifndef _WIN32
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#endif
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+namespace {
+
+Error generateFrom(std::string* pSource, std::size_t maxBytes, std::string* pData)
+{
+   std::size_t n = std::min(maxBytes, pSource->size());
+   pData->assign(*pSource, 0, n);
+   pSource->erase(0, n);
+   return Success();
+}
+
+// write all chunks of the stream through a chunk parser, returning
+// the reassembled body
+std::string readStream(StreamResponse* pStream, std::size_t* pChunkCount)
+{
+   ChunkParser parser;
+   std::vector<std::string> chunks;
+   bool complete = false;
+   while (!pStream->complete())
+   {
+      std::string chunk;
+      Error error = pStream->nextChunk(&chunk);
+      REQUIRE(!error);
+      complete = parser.parse(chunk.data(), chunk.size(), &chunks);
+   }
+
+   CHECK(complete);
+
+   *pChunkCount = chunks.size();
+   std::string body;
+   for (std::size_t i = 0; i < chunks.size(); i++)
+      body.append(chunks[i]);
+   return body;
+}
+
+std::string makeContent(std::size_t size)
+{
+   std::string content;
+   for (std::size_t i = 0; i < size; i++)
+      content.push_back(static_cast<char>('a' + (i % 26)));
+   return content;
+}
+
+} // anonymous namespace
+
+context("StreamResponseTests")
+{
+   test_that("Chunks reassemble to the original content")
+   {
+      std::string content = makeContent(10000);
+      std::string source = content;
+      StreamResponse stream(boost::bind(generateFrom, &source, _1, _2),
+                            false,
+                            1024);
+
+      std::size_t chunkCount = 0;
+      CHECK(readStream(&stream, &chunkCount) == content);
+      CHECK(chunkCount == 10);
+   }
+
+   test_that("Empty content yields only the terminating chunk")
+   {
+      std::string source;
+      StreamResponse stream(boost::bind(generateFrom, &source, _1, _2), false);
+
+      std::string chunk;
+      REQUIRE(!stream.nextChunk(&chunk));
+      CHECK(chunk == "0\r\n\r\n");
+      CHECK(stream.complete());
+   }
+
+   test_that("File ranges stream only the requested bytes")
+   {
+      std::string content = makeContent(10000);
+      FilePath filePath;
+      REQUIRE(!FilePath::tempFilePath(&filePath));
+      REQUIRE(!writeStringToFile(filePath, content));
+
+      boost::shared_ptr<StreamResponse> pStream;
+      REQUIRE(!StreamResponse::createFromFileRange(filePath,
+                                                   1000,
+                                                   5000,
+                                                   1024,
+                                                   &pStream));
+      CHECK_FALSE(pStream->gzip());
+
+      std::size_t chunkCount = 0;
+      CHECK(readStream(pStream.get(), &chunkCount) == content.substr(1000, 5000));
+      CHECK(chunkCount == 5);
+
+      // ranges running past the end of the file stop at the end
+      REQUIRE(!StreamResponse::createFromFileRange(filePath,
+                                                   9000,
+                                                   5000,
+                                                   1024,
+                                                   &pStream));
+      CHECK(readStream(pStream.get(), &chunkCount) == content.substr(9000));
+
+      filePath.removeIfExists();
+   }
+
+#ifndef _WIN32
+   test_that("Gzipped chunks decompress to the original content")
+   {
+      std::string content = makeContent(200000);
+      std::string source = content;
+      StreamResponse stream(boost::bind(generateFrom, &source, _1, _2),
+                            true,
+                            4096);
+      CHECK(stream.gzip());
+
+      std::size_t chunkCount = 0;
+      std::string compressed = readStream(&stream, &chunkCount);
+      CHECK(compressed.size() < content.size());
+
+      std::string decompressed;
+      boost::iostreams::filtering_istream in;
+      in.push(boost::iostreams::gzip_decompressor());
+      in.push(boost::iostreams::array_source(compressed.data(),
+                                             compressed.size()));
+      boost::iostreams::copy(in,
+                             boost::iostreams::back_inserter(decompressed));
+      CHECK(decompressed == content);
+   }
+#endif
+}
+
+} // end namespace tests
+} // end namespace http
+} // end namespace core
+} // end namespace rstudio
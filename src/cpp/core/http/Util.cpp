@@ -198,6 +198,7 @@ void parseMultipartForm(const std::string& contentType,
                   uploadedFile.contentType = "application/octet-stream";
                
                uploadedFile.contents = valueStream.str();
+               uploadedFile.size = uploadedFile.contents.size();
                pFiles->insert(std::make_pair(name, uploadedFile));
             }
             // else process regular form field
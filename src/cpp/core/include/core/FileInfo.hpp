@@ -24,6 +24,7 @@
 #include <iosfwd>
 
 #include <core/FilePath.hpp>
+#include <core/InternedString.hpp>
 
 // TODO: satisfy outselves that it is safe to query for symlink status
 // in all cases and eliminate its "optional" semantics
@@ -31,14 +32,18 @@
 namespace rstudio {
 namespace core {
 
+// Attributes of a file, as captured when it was listed. Trees of these are
+// kept for every file in a monitored project, so they're stored compactly:
+// the directory part of the path is interned (and so held once for all of
+// the files within a directory) leaving each file with just its name.
 class FileInfo
 {
 public:
    FileInfo()
-      : absolutePath_(), 
-        isDirectory_(false), 
-        size_(0), 
-        lastWriteTime_(0)
+      : size_(0),
+        lastWriteTime_(0),
+        isDirectory_(false),
+        isSymlink_(false)
    {
    }
    
@@ -63,21 +68,18 @@ public:
             uintmax_t size,
             std::time_t lastWriteTime,
             bool isSymlink = false);
-   
-   virtual ~FileInfo()
-   {
-   }
 
    // COPYING: via compliler (copyable members)
 
 public:
-   bool empty() const { return absolutePath_.empty(); }
+   bool empty() const { return directory_.empty() && name_.empty(); }
    
    // NOTE: because symlink status is optional, it is NOT taken
    // into account for equality tests
    bool operator==(const FileInfo& other) const
    {
-      return absolutePath_ == other.absolutePath_ &&
+      return directory_ == other.directory_ &&
+             name_ == other.name_ &&
              isDirectory_ == other.isDirectory_ &&
              size_ == other.size_ &&
              lastWriteTime_ == other.lastWriteTime_;
@@ -89,23 +91,31 @@ public:
    }
    
 public:
-   std::string absolutePath() const { return absolutePath_.c_str(); }
+   std::string absolutePath() const { return directory_.str() + name_; }
    bool isDirectory() const { return isDirectory_; }
    uintmax_t size() const { return size_; }
    std::time_t lastWriteTime() const { return lastWriteTime_; }
    bool isSymlink() const { return isSymlink_; }
-   
+
+   // compare paths as strcmp would (without building them)
+   int comparePath(const FileInfo& other) const;
+
 private:
-   std::string absolutePath_;
-   bool isDirectory_;
+   void setPath(const std::string& absolutePath);
+
+   // the path up to and including the last separator, and the rest of it
+   InternedString directory_;
+   std::string name_;
+
    uintmax_t size_;
    std::time_t lastWriteTime_;
+   bool isDirectory_;
    bool isSymlink_;
 };
    
 inline int fileInfoPathCompare(const FileInfo& a, const FileInfo& b)
 {
-   int result = ::strcmp(a.absolutePath().c_str(), b.absolutePath().c_str());
+   int result = a.comparePath(b);
 
    if (result != 0)
       return result;
@@ -56,6 +56,11 @@ public:
    static void refresh();
    static void refreshPeriodically(boost::asio::io_service& service,
                                    boost::posix_time::seconds interval = s_refreshRate);
+
+   // refreshes all FileLock implementations from a dedicated thread (does
+   // nothing if the thread is already running). when 'background-refresh' is
+   // enabled this is started automatically once a link-based lock is acquired
+   static void startRefreshThread();
    
    // sub-classes implement locking semantics
    virtual Error acquire(const FilePath& lockFilePath) = 0;
@@ -79,6 +84,25 @@ public:
    
 public:
    static void log(const std::string& message);
+
+   // timing of lock acquisition attempts (since the last collection)
+   struct AcquisitionStats
+   {
+      AcquisitionStats()
+         : acquired(0), failed(0), totalMs(0), maxMs(0)
+      {
+      }
+
+      std::size_t acquired;
+      std::size_t failed;
+      double totalMs;
+      double maxMs;
+   };
+
+   static void recordAcquisition(const FilePath& lockFilePath,
+                                 bool acquired,
+                                 const boost::posix_time::time_duration& elapsed);
+   static AcquisitionStats collectAcquisitionStats();
    
    static boost::posix_time::seconds getTimeoutInterval() { return s_timeoutInterval; }
    static void setTimeoutInterval(boost::posix_time::seconds interval) { s_timeoutInterval = interval; }
@@ -88,6 +112,8 @@ public:
    static boost::posix_time::seconds getRefreshRate() { return s_refreshRate; }
    static bool isLoggingEnabled() { return s_loggingEnabled; }
    static bool isLoadBalanced() { return s_isLoadBalanced; }
+   static bool isBackgroundRefreshEnabled() { return s_backgroundRefresh; }
+   static bool isLocalAdvisoryLockingEnabled() { return s_localAdvisoryLocks; }
    static bool isNoLockAvailable(const Error& error)
    {
       return error.code() == boost::system::errc::no_lock_available;
@@ -99,12 +125,20 @@ protected:
    static boost::posix_time::seconds s_refreshRate;
    static bool s_loggingEnabled;
    static bool s_isLoadBalanced;
+   static bool s_backgroundRefresh;
+   static bool s_localAdvisoryLocks;
    static FilePath s_logFile;
 };
 
 class AdvisoryFileLock : public FileLock
 {
 public:
+   // are locks taken with open file description (OFD) locks? these belong to
+   // the lock rather than the process, so unlike classic POSIX record locks
+   // they conflict with other locks in the same process and aren't dropped
+   // when another descriptor for the file is closed
+   static bool isOfdLockingAvailable();
+
    static void refresh();
    static void cleanUp();
    
@@ -117,10 +151,16 @@ public:
    ~AdvisoryFileLock();
    
 private:
+   Error acquireLock(const FilePath& lockFilePath);
+
    struct Impl;
    boost::scoped_ptr<Impl> pImpl_;
 };
 
+// NOTE: when 'local-advisory-locks' is enabled, lock files on local
+// filesystems are locked with OFD advisory locks instead (which are much
+// cheaper to acquire and need no refreshing). all processes sharing the lock
+// files must use the same setting
 class LinkBasedFileLock : public FileLock
 {
 public:
@@ -137,6 +177,8 @@ public:
    ~LinkBasedFileLock();
    
 private:
+   Error acquireLock(const FilePath& lockFilePath);
+
    struct Impl;
    boost::scoped_ptr<Impl> pImpl_;
 };
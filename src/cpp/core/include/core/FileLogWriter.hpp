@@ -16,7 +16,7 @@
 #ifndef FILE_LOG_WRITER_HPP
 #define FILE_LOG_WRITER_HPP
 
-#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <core/FilePath.hpp>
 #include <core/LogWriter.hpp>
@@ -24,6 +24,11 @@
 namespace rstudio {
 namespace core {
 
+// Log entries are queued (without blocking) and written in batches by a
+// background thread, which opens the log file for each batch. Errors are
+// written before log() returns. If entries are logged faster than they can
+// be written, entries which don't fit in the queue are dropped (and the
+// number dropped is logged)
 class FileLogWriter : public LogWriter
 {
 public:
@@ -38,15 +43,22 @@ public:
                      core::system::LogLevel level,
                      const std::string& message);
 
+    // write all queued entries to the log file
+    void flush();
 
 private:
     bool rotateLogFile();
+    void startWriterThread();
+    void writerThreadMain();
+    void writeEntries(const std::string& entries);
 
     std::string programIdentity_;
     int logLevel_;
     FilePath logFile_;
     FilePath rotatedLogFile_;
-    boost::mutex mutex_;
+
+    struct Impl;
+    boost::shared_ptr<Impl> pImpl_;
 };
 
 } // namespace core
@@ -63,6 +63,23 @@ public:
    static bool isRootPath(const std::string& path);
 
    static Error tempFilePath(FilePath* pFilePath);
+
+   // counts of the filesystem operations made through FilePath (since the
+   // last collection)
+   struct OperationStats
+   {
+      OperationStats()
+         : queries(0), listings(0), opens(0), changes(0)
+      {
+      }
+
+      std::size_t queries;  // existence, type, size and time checks
+      std::size_t listings; // directory listings
+      std::size_t opens;    // files opened for reading or writing
+      std::size_t changes;  // creations, moves, copies and removals
+   };
+
+   static OperationStats collectOperationStats();
    
 public:
    FilePath() ;
@@ -88,6 +105,9 @@ public:
 
    // size of file in bytes
    uintmax_t size() const;
+
+   // number of hard links to the file (0 if it is not a regular file)
+   uintmax_t hardLinkCount() const;
   
    // filename only
    std::string filename() const ;
@@ -157,6 +177,9 @@ public:
    // copy to path
    Error copy(const FilePath& targetPath) const;
 
+   // create a hard link to this file at the target path
+   Error link(const FilePath& targetPath) const;
+
    // is this a hidden file?
    bool isHidden() const ;
 
@@ -296,6 +296,18 @@ Error writeStringToFile(const core::FilePath& filePath,
                         string_utils::LineEnding lineEnding=string_utils::LineEndingPassthrough,
                         bool truncate = true);
 
+// write a string to a file such that readers see either the old or the new
+// contents (never a partial write), and such that the new contents are on
+// disk when this returns: the string is written to a temporary file alongside
+// the target, synced, and renamed over it. the target's permissions are kept.
+// symlinks, files with multiple hard links, and files we can't replace (e.g.
+// owned by another user or in a directory we can't write to) are written in
+// place (and synced). on windows this is equivalent to writeStringToFile
+Error writeStringToFileAtomically(
+                  const core::FilePath& filePath,
+                  const std::string& str,
+                  string_utils::LineEnding lineEnding=string_utils::LineEndingPassthrough);
+
 // lineEnding is the type of line ending you want the resulting string to have
 Error readStringFromFile(const core::FilePath& filePath,
                          std::string* pStr,
@@ -0,0 +1,102 @@
+/*
+ * FuzzyMatch.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_FUZZY_MATCH_HPP
+#define CORE_FUZZY_MATCH_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+namespace rstudio {
+namespace core {
+namespace fuzzy_match {
+
+// A bitmask of the (classes of) characters which appear in text. A query
+// can only be a subsequence of a candidate if every bit in the query's mask
+// is also set in the candidate's mask, which rules out most candidates
+// without scanning them.
+boost::uint64_t characterMask(const char* begin,
+                              const char* end,
+                              bool caseInsensitive);
+
+inline boost::uint64_t characterMask(const std::string& text,
+                                     bool caseInsensitive)
+{
+   return characterMask(text.data(), text.data() + text.size(),
+                        caseInsensitive);
+}
+
+// A query to match (as a subsequence) against candidates
+class Query
+{
+public:
+   explicit Query(const std::string& query, bool caseInsensitive = false);
+
+   // COPYING: via compiler
+
+   const std::string& query() const { return query_; }
+   bool caseInsensitive() const { return caseInsensitive_; }
+
+   // whether a candidate with the given character mask could match
+   bool mayMatch(boost::uint64_t candidateMask) const
+   {
+      return (mask_ & ~candidateMask) == 0;
+   }
+
+   bool isSubsequenceOf(const char* begin, const char* end) const;
+
+   bool isSubsequenceOf(const std::string& candidate) const
+   {
+      return isSubsequenceOf(candidate.data(),
+                             candidate.data() + candidate.size());
+   }
+
+private:
+   std::string query_;
+   bool caseInsensitive_;
+   boost::uint64_t mask_;
+};
+
+// determine which of the candidates contain the query as a subsequence
+void filterSubsequences(const std::vector<std::string>& candidates,
+                        const Query& query,
+                        std::vector<bool>* pMatches);
+
+// NOTE: When modifying this code, you should ensure that corresponding
+// changes are made to the client side scoreMatch function as well
+// (See: CodeSearchOracle.java)
+//
+// score a suggestion for a query (lower scores are better matches)
+int scoreMatch(const char* begin,
+               const char* end,
+               const std::string& query,
+               bool isFile);
+
+int scoreMatch(const std::string& suggestion,
+               const std::string& query,
+               bool isFile);
+
+void scoreMatches(const std::vector<std::string>& suggestions,
+                  const std::string& query,
+                  bool isFile,
+                  std::vector<int>* pScores);
+
+} // namespace fuzzy_match
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_FUZZY_MATCH_HPP
@@ -16,16 +16,48 @@
 #ifndef CORE_HASH_HPP
 #define CORE_HASH_HPP
 
+#include <cstddef>
 #include <string>
 
+#include <boost/cstdint.hpp>
+
 namespace rstudio {
 namespace core {
+
+class Error;
+class FilePath;
+
 namespace hash {
    
 std::string crc32Hash(const std::string& content);
 
 std::string crc32HexHash(const std::string& content);
 
+// CRC-32C (Castagnoli), computed with the SSE 4.2 / ARMv8 CRC instructions
+// where available. Much faster than crc32Hash, so prefer it for detecting
+// changes to content (it is not suitable for anything security related)
+class Crc32c
+{
+public:
+   Crc32c() : crc_(0xFFFFFFFF) {}
+
+   void update(const void* data, std::size_t size);
+   void update(const std::string& data) { update(data.data(), data.size()); }
+
+   boost::uint32_t checksum() const { return crc_ ^ 0xFFFFFFFF; }
+
+   // 8 uppercase hex digits
+   std::string hexChecksum() const;
+
+private:
+   boost::uint32_t crc_;
+};
+
+std::string crc32cHexHash(const std::string& content);
+
+// hash a file's contents (without reading it all into memory)
+Error crc32cHexHash(const FilePath& filePath, std::string* pHash);
+
 } // namespace hash
 } // namespace core 
 } // namespace rstudio
@@ -18,6 +18,8 @@
 #define CORE_INCREMENTAL_COMMAND_HPP
 
 
+#include <algorithm>
+
 #include <core/ScheduledCommand.hpp>
 
 namespace rstudio {
@@ -52,6 +54,11 @@ public:
       executeUntil(now() + incrementalDuration_);
    }
 
+   virtual void execute(const boost::posix_time::ptime& deadline)
+   {
+      executeUntil(std::min(now() + incrementalDuration_, deadline));
+   }
+
 private:
    void executeUntil(const boost::posix_time::ptime& time)
    {
@@ -0,0 +1,76 @@
+/*
+ * InitGraph.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_INIT_GRAPH_HPP
+#define CORE_INIT_GRAPH_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <core/Exec.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+
+// Initialization steps with declared dependencies. Main steps run on the
+// calling thread in the order they were added (so they may touch state
+// which isn't thread safe, e.g. R); background steps run on worker threads
+// as soon as their dependencies have finished, concurrently with each other
+// and with the main steps. Dependencies must be added before the steps
+// which depend on them, which also rules out cycles.
+class InitGraph : boost::noncopyable
+{
+public:
+   typedef ExecBlock::Function Function;
+
+public:
+   InitGraph();
+   ~InitGraph();
+
+   InitGraph& addMain(const std::string& name,
+                      const Function& function,
+                      const std::vector<std::string>& dependencies =
+                                             std::vector<std::string>());
+
+   InitGraph& addBackground(const std::string& name,
+                            const Function& function,
+                            const std::vector<std::string>& dependencies =
+                                             std::vector<std::string>());
+
+   // run all of the steps, returning the error of the first step (in the
+   // order added) which failed. steps whose dependencies failed are not run
+   // and main steps after a failed main step are not run; execute always
+   // waits for the background steps before returning.
+   Error execute();
+
+private:
+   InitGraph& add(const std::string& name,
+                  const Function& function,
+                  const std::vector<std::string>& dependencies,
+                  bool background);
+
+   struct Impl;
+   boost::shared_ptr<Impl> pImpl_;
+};
+
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_INIT_GRAPH_HPP
@@ -0,0 +1,108 @@
+/*
+ * InternedString.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_INTERNED_STRING_HPP
+#define CORE_INTERNED_STRING_HPP
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace rstudio {
+namespace core {
+
+// stable identifier of a string within the process-wide string pool
+typedef boost::uint32_t StringId;
+
+// An immutable string held once in a process-wide pool. Indexes which
+// hold the same identifiers many times over (symbol names, package names,
+// USRs) store these rather than their own copies; each is the size of a
+// pointer, copying is free, and equality is an identity comparison.
+// Pooled strings live for the lifetime of the process.
+class InternedString
+{
+public:
+   struct Entry
+   {
+      std::string value;
+      StringId id;
+   };
+
+public:
+   // the empty string (which always has id 0)
+   InternedString();
+
+   explicit InternedString(const std::string& value);
+   explicit InternedString(const char* value);
+
+   // COPYING: via compiler (refers to the pooled entry)
+
+   // find an already pooled string without adding it to the pool. returns
+   // false if the value has never been interned (in which case it can't
+   // be a member of any container of interned strings)
+   static bool find(const std::string& value, InternedString* pInterned);
+
+   StringId id() const { return pEntry_->id; }
+   const std::string& str() const { return pEntry_->value; }
+   bool empty() const { return pEntry_->value.empty(); }
+   std::size_t size() const { return pEntry_->value.size(); }
+
+   bool operator==(const InternedString& other) const
+   {
+      return pEntry_ == other.pEntry_;
+   }
+
+   bool operator!=(const InternedString& other) const
+   {
+      return pEntry_ != other.pEntry_;
+   }
+
+   // ordered by value, so sorted containers iterate alphabetically
+   bool operator<(const InternedString& other) const
+   {
+      return pEntry_ != other.pEntry_ && pEntry_->value < other.pEntry_->value;
+   }
+
+private:
+   explicit InternedString(const Entry* pEntry) : pEntry_(pEntry) {}
+
+   const Entry* pEntry_;
+};
+
+inline std::size_t hash_value(const InternedString& string)
+{
+   return string.id();
+}
+
+std::ostream& operator<<(std::ostream& os, const InternedString& string);
+
+// membership tests hash and compare ids only
+typedef boost::unordered_set<InternedString> InternedStringSet;
+
+namespace string_pool {
+
+// the number of distinct strings pooled, and the bytes of text they hold
+std::size_t size();
+std::size_t bytes();
+
+} // namespace string_pool
+
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_INTERNED_STRING_HPP
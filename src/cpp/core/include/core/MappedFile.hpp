@@ -0,0 +1,74 @@
+/*
+ * MappedFile.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_MAPPED_FILE_HPP
+#define CORE_MAPPED_FILE_HPP
+
+#include <ctime>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+
+// A read-only file mapped into memory (and prefetched), so that its pages
+// are those of the page cache and are shared by every process which maps
+// the file. On Windows the file is read into memory instead.
+class MappedFile : boost::noncopyable
+{
+public:
+   static Error open(const FilePath& filePath,
+                     boost::shared_ptr<MappedFile>* pMappedFile);
+
+   ~MappedFile();
+
+   // COPYING: boost::noncopyable
+
+   const FilePath& filePath() const { return filePath_; }
+   std::time_t lastWriteTime() const { return lastWriteTime_; }
+
+   const char* data() const { return pData_; }
+   std::size_t size() const { return size_; }
+   std::string contents() const { return std::string(pData_, size_); }
+
+private:
+   MappedFile();
+
+   FilePath filePath_;
+   std::time_t lastWriteTime_;
+   const char* pData_;
+   std::size_t size_;
+   std::string contents_;
+};
+
+// Get a static resource (e.g. a template, theme or MathJax file) as a mapped
+// file. Resources are mapped once per process and shared by all callers
+// until the file changes. Only use this for installed resources, which are
+// replaced rather than rewritten when they're updated: a mapping remains
+// that of the file which was mapped, but a file truncated in place while
+// it's mapped can't be read.
+Error mappedResource(const FilePath& filePath,
+                     boost::shared_ptr<const MappedFile>* pMappedFile);
+
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_MAPPED_FILE_HPP
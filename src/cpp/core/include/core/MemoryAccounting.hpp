@@ -0,0 +1,92 @@
+/*
+ * MemoryAccounting.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_MEMORY_ACCOUNTING_HPP
+#define CORE_MEMORY_ACCOUNTING_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+
+namespace memory_accounting {
+
+// the (approximate) memory held by a subsystem's caches
+struct Usage
+{
+   Usage() : bytes(0), entries(0) {}
+   Usage(std::size_t bytes, std::size_t entries)
+      : bytes(bytes), entries(entries)
+   {
+   }
+
+   std::size_t bytes;
+   std::size_t entries;
+};
+
+// measures a subsystem's current usage
+typedef boost::function<Usage()> UsageFunction;
+
+// releases cached data until the subsystem holds no more than the passed
+// number of bytes (or as close to it as it can get)
+typedef boost::function<void(std::size_t)> EvictFunction;
+
+// register a subsystem's caches under the passed name. subsystems which can
+// release cached data (i.e. which provide an evict function) can be given
+// a byte budget. usage and evict functions are only called from collect,
+// so subsystems whose caches are owned by one thread need only make sure
+// that collect is called from that thread
+void registerSubsystem(const std::string& name,
+                       const UsageFunction& usage,
+                       const EvictFunction& evict = EvictFunction());
+
+// set the byte budget for a subsystem (zero for no budget). budgets may be
+// set before the subsystem is registered
+void setBudget(const std::string& name, std::size_t bytes);
+
+// parse budgets of the form "name=size[,name=size...]" where sizes are in
+// bytes or have a K, M or G suffix (e.g. "data-viewer=256M,clang=1G")
+Error parseBudgets(const std::string& budgets,
+                   std::map<std::string, std::size_t>* pBudgets);
+
+struct SubsystemStats
+{
+   SubsystemStats() : budget(0), evictable(false), evictions(0) {}
+
+   std::string name;
+   Usage usage;
+   std::size_t budget;
+   bool evictable;
+
+   // times the subsystem has been asked to evict to stay within budget
+   std::size_t evictions;
+};
+
+// measure every registered subsystem, first evicting from any which are
+// over their budget
+std::vector<SubsystemStats> collect();
+
+} // namespace memory_accounting
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_MEMORY_ACCOUNTING_HPP
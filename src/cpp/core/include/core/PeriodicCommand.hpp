@@ -43,6 +43,9 @@ public:
    // COPYING: boost::noncopyable
 
 public:
+   // (a periodic command runs to completion when it's due)
+   using ScheduledCommand::execute;
+
    virtual void execute()
    {
       if (now() > nextExecutionTime_)
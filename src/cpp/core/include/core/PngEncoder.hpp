@@ -0,0 +1,48 @@
+/*
+ * PngEncoder.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_PNG_ENCODER_HPP
+#define CORE_PNG_ENCODER_HPP
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+
+namespace png {
+
+// compression levels as for zlib; low levels are several times faster than
+// the default and (as plots are mostly flat color) not much larger
+const int kFastestCompression = 1;
+const int kBestCompression = 9;
+
+// Encode an image as png. The pixels are rows of 32-bit RGBA values with red
+// in the least significant byte (R's representation of colors). Images which
+// are entirely opaque are encoded without an alpha channel.
+Error encodeRgba(const boost::uint32_t* pixels,
+                 int width,
+                 int height,
+                 int compressionLevel,
+                 std::string* pPng);
+
+} // namespace png
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_PNG_ENCODER_HPP
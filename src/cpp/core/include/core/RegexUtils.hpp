@@ -32,6 +32,12 @@ class Error;
 class FilePath;
 
 namespace regex_utils {
+
+// returns the compiled regex for the pattern, compiling it only if it isn't
+// among those recently used (for patterns which are built at runtime, e.g.
+// from a search term, and so can't be compiled once up front)
+boost::regex compiledRegex(const std::string& pattern,
+                           boost::regex::flag_type flags = boost::regex::normal);
    
 // convert a pattern which includes wildcard (i.e. '*') characters
 // into a regulard expression
@@ -43,6 +43,14 @@ public:
 public:
    virtual void execute() = 0;
 
+   // execute, finishing by the deadline if possible (commands which work in
+   // increments stop at whichever comes first of the deadline and the end of
+   // their increment)
+   virtual void execute(const boost::posix_time::ptime& deadline)
+   {
+      execute();
+   }
+
    bool finished() const { return finished_; }
 
 protected:
@@ -21,6 +21,7 @@
 
 #include <boost/utility.hpp>
 #include <boost/function.hpp>
+#include <boost/date_time/posix_time/posix_time_duration.hpp>
 
 #include <core/FilePath.hpp>
 
@@ -57,6 +58,16 @@ public:
    void beginUpdate();
    void endUpdate();
 
+   // defer writes by the given delay so that changes made in quick
+   // succession are written together (on a background thread)
+   void setWriteDelay(const boost::posix_time::time_duration& delay);
+
+   // write any deferred changes now
+   void flush();
+
+   // write the deferred changes of all settings (e.g. prior to exiting)
+   static void flushAll();
+
 private:
    void writeSettings() ;
 
@@ -65,6 +76,7 @@ private:
    std::map<std::string, std::string> settingsMap_ ;
    bool updatePending_ ;
    bool isDirty_;
+   boost::posix_time::time_duration writeDelay_;
 };
 
 }
@@ -0,0 +1,99 @@
+/*
+ * StartupTrace.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_STARTUP_TRACE_HPP
+#define CORE_STARTUP_TRACE_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/Exec.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+// Opt-in timeline of the steps taken while a process starts up. Steps are
+// recorded (with their wall and cpu time) only while tracing is enabled,
+// so the functions below are cheap no-ops otherwise.
+namespace startup_trace {
+
+struct Timestamp
+{
+   boost::posix_time::ptime wall;
+   double cpuSeconds;
+};
+
+struct Step
+{
+   std::string name;
+   std::string category;
+   boost::posix_time::ptime start;
+   boost::posix_time::time_duration wall;
+   double cpuSeconds;
+};
+
+void enable();
+bool enabled();
+
+Timestamp now();
+
+// record a step which started at the given time and ends now
+void record(const std::string& name,
+            const std::string& category,
+            const Timestamp& start);
+
+// records a step covering its own lifetime
+class Scope : boost::noncopyable
+{
+public:
+   Scope(const std::string& name, const std::string& category);
+   ~Scope();
+
+private:
+   std::string name_;
+   std::string category_;
+   bool enabled_;
+   Timestamp start_;
+};
+
+// wrap an ExecBlock function so that it's recorded as a step
+ExecBlock::Function traced(const std::string& name,
+                           const std::string& category,
+                           const ExecBlock::Function& function);
+
+// stop recording and return the steps recorded
+std::vector<Step> finish();
+
+// write steps in the Chrome trace event format (viewable with
+// chrome://tracing or Perfetto)
+Error writeChromeTrace(const std::vector<Step>& steps, const FilePath& file);
+
+// human readable summary of the slowest steps
+std::string summary(const std::vector<Step>& steps, std::size_t maxSteps);
+
+} // namespace startup_trace
+} // namespace core
+} // namespace rstudio
+
+#define STARTUP_STEP(function) \
+   ::rstudio::core::startup_trace::traced(#function, "init", function)
+
+#endif // CORE_STARTUP_TRACE_HPP
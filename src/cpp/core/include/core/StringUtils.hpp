@@ -225,6 +225,13 @@ inline bool stringNotEmpty(const std::string& str)
 
 bool trimLeadingLines(int maxLines, std::string* pLines);
 
+// Replace each run of carriage-return-overwritten text (e.g. a progress
+// bar) with what it finally looks like, leaving the cursor where it would
+// have been. Text before the first carriage return is kept as is since it
+// may continue a line written earlier. Lines involving escapes or
+// backspaces are left alone. Returns true if anything was collapsed.
+bool collapseCarriageReturns(std::string* pOutput);
+
 void stripQuotes(std::string* pStr);
 std::string strippedOfQuotes(const std::string& str);
 
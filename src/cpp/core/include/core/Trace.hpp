@@ -20,15 +20,128 @@
 #include <string>
 
 #include <boost/current_function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace rstudio {
-namespace core { 
+namespace core {
+
+class Error;
+class FilePath;
+
 namespace trace {
 
 void add(void* key, const std::string& functionName);
 
+// Spans time the handling of a request (or a part of it). They are sampled
+// per trace: when a trace is started a sampling decision is made (at the
+// configured rate) which is inherited by all of its spans, including those
+// in other processes (via the W3C traceparent header). Only sampled spans
+// are recorded; they are buffered per thread and periodically exported as
+// OTLP/JSON lines (as read by the OpenTelemetry collector's otlpjsonfile
+// receiver). When tracing is disabled spans cost a single flag check.
+
+// header used to propagate the trace context between processes
+extern const char * const kTraceparentHeader;
+
+enum SpanKind
+{
+   SpanKindInternal = 1,
+   SpanKindServer = 2,
+   SpanKindClient = 3
+};
+
+struct SpanContext
+{
+   SpanContext() : sampled(false) {}
+
+   bool empty() const { return traceId.empty(); }
+
+   // value for the traceparent header (empty if there is no context)
+   std::string traceparent() const;
+
+   std::string traceId;    // 32 hex digits
+   std::string spanId;     // 16 hex digits
+   bool sampled;
+};
+
+// returns an empty context if the value isn't a valid traceparent
+SpanContext parseTraceparent(const std::string& traceparent);
+
+// spans are exported to <exportDir>/<serviceName>-<pid>.json. a sample
+// rate of 0 (the default) disables tracing
+Error initialize(const std::string& serviceName,
+                 double sampleRate,
+                 const FilePath& exportDir);
+
+bool enabled();
+
+// export all finished spans (called automatically as spans finish and at
+// exit)
+void flush();
+
+struct SpanData;
+
+class Span : boost::noncopyable
+{
+public:
+   // start a span beneath the (possibly remote) parent; if the parent is
+   // empty a new trace is started
+   Span(const char* name,
+        const SpanContext& parent,
+        SpanKind kind = SpanKindInternal);
+   virtual ~Span();
+
+   // is the span sampled? (attributes of spans which aren't are ignored so
+   // callers can avoid computing them)
+   bool recording() const { return pData_.get() != NULL; }
+
+   const SpanContext& spanContext() const { return context_; }
+
+   void setName(const std::string& name);
+   void setAttribute(const std::string& key, const std::string& value);
+   void setAttribute(const std::string& key, int value);
+   void setError(const std::string& message);
+
+   // end the span (otherwise it ends when it is destroyed)
+   void end();
+
+protected:
+   Span();
+   void start(const char* name, const SpanContext& parent, SpanKind kind);
+
+private:
+   SpanContext context_;
+   boost::shared_ptr<SpanData> pData_;
+};
+
+// A span which is the current span of the thread while it exists, so that
+// spans started within its scope become its children. Must be destroyed on
+// the thread which created it.
+class ScopedSpan : public Span
+{
+public:
+   // start a span beneath the current span of the thread (does nothing if
+   // there isn't one)
+   explicit ScopedSpan(const char* name);
+
+   ScopedSpan(const char* name,
+              const SpanContext& parent,
+              SpanKind kind = SpanKindInternal);
+
+   virtual ~ScopedSpan();
+
+private:
+   void push();
+
+   bool pushed_;
+};
+
+// context of the current span of the thread (empty if there isn't one)
+SpanContext currentContext();
+
 } // namespace trace
-} // namespace core 
+} // namespace core
 } // namespace rstudio
 
 #define TRACE_CURRENT_METHOD \
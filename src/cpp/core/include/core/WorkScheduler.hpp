@@ -0,0 +1,113 @@
+/*
+ * WorkScheduler.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_WORK_SCHEDULER_HPP
+#define CORE_WORK_SCHEDULER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/ScheduledCommand.hpp>
+#include <core/Thread.hpp>
+
+namespace rstudio {
+namespace core {
+
+enum WorkPriority
+{
+   WorkPriorityHigh = 0,
+   WorkPriorityNormal = 1,
+   WorkPriorityLow = 2
+};
+
+// Executes scheduled commands in turn within a budget shared by all of them,
+// so that however many commands are pending together they don't take more
+// than the budget from each tick of the event loop. Commands of a higher
+// priority go first; those of the same priority take turns, each tick
+// starting after the command which went last. A command which would exceed
+// what remains of the budget is cut short (for commands which work in
+// increments) and the remaining commands wait for the next tick.
+class WorkScheduler : boost::noncopyable
+{
+public:
+   struct TaskStats
+   {
+      TaskStats()
+         : executions(0), totalMs(0), maxMs(0)
+      {
+      }
+
+      std::size_t executions;
+      double totalMs;
+      double maxMs;
+   };
+
+   WorkScheduler() : executing_(false) {}
+
+   // COPYING: boost::noncopyable
+
+   // add a command, whose time is accounted for under the given name. idle
+   // only commands are executed only when the session is idle
+   void add(const boost::shared_ptr<ScheduledCommand>& pCommand,
+            const std::string& name,
+            WorkPriority priority,
+            bool idleOnly);
+
+   // execute pending commands until they've each had a turn, the budget is
+   // spent, or interrupt returns true (e.g. because the client is waiting
+   // on a request). finished commands are removed. a command which executes
+   // this again (e.g. by running code which processes events) does so to no
+   // effect, as the pending commands are already being executed
+   void execute(const boost::posix_time::time_duration& budget,
+                bool isIdle,
+                const boost::function<bool()>& interrupt =
+                                             boost::function<bool()>());
+
+   bool empty() const;
+
+   // the time spent in the commands (keyed by name) since the statistics
+   // were last collected. collecting resets them (may be called from any
+   // thread)
+   std::map<std::string, TaskStats> collectStats();
+
+private:
+   struct Task
+   {
+      boost::shared_ptr<ScheduledCommand> pCommand;
+      std::string name;
+      bool idleOnly;
+   };
+
+   void recordExecution(const std::string& name, double ms);
+
+   static const int kPriorities = WorkPriorityLow + 1;
+   std::vector<Task> tasks_[kPriorities];
+   bool executing_;
+
+   boost::mutex statsMutex_;
+   std::map<std::string, TaskStats> stats_;
+};
+
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_WORK_SCHEDULER_HPP
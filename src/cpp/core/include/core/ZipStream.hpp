@@ -0,0 +1,140 @@
+/*
+ * ZipStream.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_ZIP_STREAM_HPP
+#define CORE_ZIP_STREAM_HPP
+
+#include <ctime>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+
+// Produces a zip archive of a set of files incrementally, as it is read
+// (e.g. as the generator of an http::StreamResponse), so that the archive
+// is never built on disk or held in memory. Files are deflated as they are
+// read, other than runs of small files, which are deflated in parallel
+// ahead of being read; files which are already compressed (e.g. images or
+// other archives) are stored as they are.
+class ZipStream : boost::noncopyable
+{
+public:
+   // the files are paths relative to parentPath (which are also the names
+   // of their entries); directories are added along with their contents.
+   // threads is the number of threads used to deflate small files (0 to
+   // choose based on the number of cores)
+   static Error create(const FilePath& parentPath,
+                       const std::vector<std::string>& files,
+                       int threads,
+                       boost::shared_ptr<ZipStream>* pStream);
+
+   ~ZipStream();
+
+   // sets pData to (at most) maxBytes of the next part of the archive. an
+   // empty part indicates the end of the archive
+   Error read(std::size_t maxBytes, std::string* pData);
+
+   // whether the file's contents are already compressed (so aren't worth
+   // deflating)
+   static bool isCompressedFile(const FilePath& filePath);
+
+private:
+   struct Entry
+   {
+      Entry()
+         : directory(false), store(false), size(0), modified(0),
+           zip64(false), hasDescriptor(false), crc(0),
+           compressedSize(0), uncompressedSize(0), offset(0), buffered(false)
+      {
+      }
+
+      FilePath path;
+      std::string name;
+      bool directory;
+      bool store;
+      uintmax_t size;
+      std::time_t modified;
+
+      // as written
+      bool zip64;
+      bool hasDescriptor;
+      boost::uint32_t crc;
+      boost::uint64_t compressedSize;
+      boost::uint64_t uncompressedSize;
+      boost::uint64_t offset;
+
+      // contents deflated ahead of being written
+      bool buffered;
+      std::string data;
+      Error error;
+   };
+
+   // deflates the contents of the entry being written
+   struct Deflater;
+
+   explicit ZipStream(int threads);
+
+   static bool addEntry(const FilePath& parentPath,
+                        const FilePath& path,
+                        std::vector<Entry>* pEntries);
+   static void bufferEntry(Entry* pEntry);
+   static void bufferEntries(std::vector<Entry*> entries,
+                             std::size_t first,
+                             std::size_t step);
+
+   Error writeNext();
+   Error beginEntry();
+   Error writeEntryData();
+   void bufferEntriesFrom(std::size_t index);
+   void writeLocalHeader(const Entry& entry);
+   void writeDataDescriptor(const Entry& entry);
+   void writeCentralDirectory();
+   void write(const std::string& data);
+   void write(const char* data, std::size_t size);
+
+   enum State
+   {
+      NextEntry,     // before the header of the next entry
+      EntryData,     // writing the data of an entry as it's deflated
+      Finished       // after the end of the central directory
+   } state_;
+
+   int threads_;
+   std::vector<Entry> entries_;
+   std::size_t index_;
+
+   // the file being read and its deflater (for entries which aren't
+   // buffered)
+   boost::shared_ptr<std::istream> pFile_;
+   boost::shared_ptr<Deflater> pDeflater_;
+
+   // data written but not yet read, and the offset following it
+   std::string pending_;
+   boost::uint64_t written_;
+};
+
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_ZIP_STREAM_HPP
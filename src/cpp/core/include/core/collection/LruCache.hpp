@@ -16,8 +16,9 @@
 #ifndef CORE_COLLECTION_LRU_CACHE_HPP
 #define CORE_COLLECTION_LRU_CACHE_HPP
 
+#include <list>
 #include <map>
-#include <deque>
+#include <utility>
 
 #include <core/Error.hpp>
 #include <core/Thread.hpp>
@@ -38,29 +39,29 @@ public:
    {
       LOCK_MUTEX(mutex_)
       {
-         if (map_.count(key) > 0)
+         typename CollectionType::iterator iter = map_.find(key);
+         if (iter != map_.end())
          {
             // key already exists - we are updating the value instead of inserting it
-            // we need to remove any existing entries in the queue for that key
-            // so that this entry's LRU "time" is effectively updated
-            removeKey(key);
+            // move its entry to the back of the queue so that its LRU "time"
+            // is effectively updated
+            iter->second.first = value;
+            touch(iter);
+            return;
          }
          else if (map_.size() >= maxSize_)
          {
             // the cache has reached maximum size
-            // remove the oldest key from the cache which is at the front of the deque
+            // remove the oldest key from the cache which is at the front of the queue
             // new items are added to the back, meaning the front always contains the oldest items
-            KeyType expiredKey = keyQueue_.front();
+            map_.erase(keyQueue_.front());
             keyQueue_.pop_front();
-
-            map_.erase(expiredKey);
          }
 
-         // add new key to the back
+         // add new key to the back and store value
          keyQueue_.push_back(key);
-
-         // store value
-         map_[key] = value;
+         map_.insert(std::make_pair(key,
+                                    std::make_pair(value, --keyQueue_.end())));
       }
       END_LOCK_MUTEX
    }
@@ -74,11 +75,10 @@ public:
          if (iter == map_.end())
             return false;
 
-         *pValue = iter->second;
+         *pValue = iter->second.first;
 
-         // remove key from queue and add new entry to update its LRU "time"
-         removeKey(key);
-         keyQueue_.push_back(key);
+         // move key to the back of the queue to update its LRU "time"
+         touch(iter);
 
          return true;
       }
@@ -91,8 +91,22 @@ public:
    {
       LOCK_MUTEX(mutex_)
       {
-         removeKey(key);
-         map_.erase(key);
+         typename CollectionType::iterator iter = map_.find(key);
+         if (iter == map_.end())
+            return;
+
+         keyQueue_.erase(iter->second.second);
+         map_.erase(iter);
+      }
+      END_LOCK_MUTEX
+   }
+
+   void clear()
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         map_.clear();
+         keyQueue_.clear();
       }
       END_LOCK_MUTEX
    }
@@ -110,23 +124,19 @@ public:
 
 private:
 
-   void removeKey(const KeyType& key)
+   typedef std::list<KeyType> QueueType;
+   typedef std::map<KeyType, std::pair<ValueType, typename QueueType::iterator> >
+                                                               CollectionType;
+
+   void touch(typename CollectionType::iterator iter)
    {
-      for (size_t i = 0; i < keyQueue_.size(); ++i)
-      {
-         if (keyQueue_.at(i) == key)
-         {
-            keyQueue_.erase(keyQueue_.begin() + i);
-            return;
-         }
-      }
+      keyQueue_.splice(keyQueue_.end(), keyQueue_, iter->second.second);
    }
 
    unsigned int maxSize_;
 
-   typedef std::map<KeyType, ValueType> CollectionType;
    CollectionType map_;
-   std::deque<KeyType> keyQueue_;
+   QueueType keyQueue_;
 
    boost::mutex mutex_;
 };
@@ -57,6 +57,8 @@
 #include <algorithm>
 #include <cstddef>
 
+#include <boost/pool/pool_alloc.hpp>
+
 
 /// A node in the tree, combining links to other nodes as well as the actual data.
 template<class T>
@@ -83,7 +85,13 @@ tree_node_<T>::tree_node_(const T& val)
 	{
 	}
 
-template <class T, class tree_node_allocator = std::allocator<tree_node_<T> > >
+// RStudio: nodes are allocated from a (process-wide, thread-safe) pool
+// rather than individually. trees of files can hold hundreds of thousands
+// of nodes, and pooling them avoids per-allocation overhead and keeps
+// nodes which are created together close together. memory freed by one
+// tree is reused by the next rather than returned to the system.
+template <class T, class tree_node_allocator =
+             boost::fast_pool_allocator<tree_node_<T> > >
 class tree {
 	protected:
 		typedef tree_node_<T> tree_node;
@@ -94,6 +94,7 @@ public:
         connectionRetryContext_(ioService),
         logToStderr_(logToStderr),
         chunkedEncoding_(false),
+        requestBytesWritten_(0),
         closed_(false)
    {
    }
@@ -105,6 +106,10 @@ public:
    // populate the request before calling execute
    virtual http::Request& request() { return request_; }
 
+   // the number of bytes of the request written to the server (if this is
+   // zero when the request fails the server can't have acted on it)
+   std::size_t requestBytesWritten() const { return requestBytesWritten_; }
+
    // set (optional) connection retry profile. must do this prior
    // to calling execute
    virtual void setConnectionRetryProfile(
@@ -204,11 +209,15 @@ protected:
    void writeRequest()
    {
       // specify closing of the connection after the request unless this is
-      // an attempt to upgrade to websockets
+      // an attempt to upgrade to websockets (or the subclass wants to keep
+      // the connection open for subsequent requests)
       Header overrideHeader;
       if (!util::isWSUpgradeRequest(request_))
       {
-         overrideHeader = Header::connectionClose();
+         if (requestKeepAlive())
+            overrideHeader = Header::connectionKeepAlive();
+         else
+            overrideHeader = Header::connectionClose();
       }
 
       // write
@@ -218,7 +227,8 @@ protected:
           boost::bind(
                &AsyncClient<SocketService>::handleWrite,
                AsyncClient<SocketService>::shared_from_this(),
-               boost::asio::placeholders::error)
+               boost::asio::placeholders::error,
+               boost::asio::placeholders::bytes_transferred)
       );
    }
 
@@ -354,10 +364,13 @@ private:
       CATCH_UNEXPECTED_ASYNC_CLIENT_EXCEPTION
    }
 
-   void handleWrite(const boost::system::error_code& ec)
+   void handleWrite(const boost::system::error_code& ec,
+                    std::size_t bytesTransferred)
    {
       try
       {
+         requestBytesWritten_ += bytesTransferred;
+
          if (!ec)
          {
             // initiate async read of the first line of the response
@@ -444,6 +457,14 @@ private:
       return false;
    }
 
+   // ask the server not to close the connection after responding. subclasses
+   // that return true must also use stopReadingAndRespond to detect the end
+   // of the response (as the server will not signal it with an eof)
+   virtual bool requestKeepAlive()
+   {
+      return false;
+   }
+
    void handleReadHeaders(const boost::system::error_code& ec)
    {
       try
@@ -579,6 +600,14 @@ private:
       if (!keepConnectionAlive())
          close();
 
+      // chunks were accumulated into the body so the response is no
+      // longer chunk encoded
+      if (chunkedEncoding_ && !chunkHandler_)
+      {
+         response_.removeHeader(kTransferEncoding);
+         response_.setContentLength(static_cast<int>(response_.body().size()));
+      }
+
       if (responseHandler_ && (!chunkedEncoding_ || !chunkHandler_))
          responseHandler_(response_);
       else if (chunkHandler_)
@@ -626,6 +655,7 @@ private:
    boost::shared_ptr<ChunkParser> chunkParser_;
    ChunkHandler chunkHandler_;
    bool chunkedEncoding_;
+   std::size_t requestBytesWritten_;
 
    boost::mutex socketMutex_;
    bool closed_;
@@ -18,6 +18,7 @@
 
 #include <boost/shared_ptr.hpp>
 #include <boost/asio/io_service.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include <core/http/Response.hpp>
 #include <core/http/Socket.hpp>
@@ -42,6 +43,33 @@ typedef boost::function<void(boost::asio::io_service&,
 
 typedef boost::function<void(const std::string&,Response*)> ResponseFilter;
 
+// persistent connection (keep-alive) settings. when enabled, connections
+// are reused for subsequent (and pipelined) requests after a response is
+// written, until either the idle timeout elapses while waiting for the next
+// request or the maximum number of requests for the connection is reached
+struct KeepAliveOptions
+{
+   KeepAliveOptions()
+      : maxRequests(0), idleTimeout(boost::posix_time::seconds(15))
+   {
+   }
+
+   KeepAliveOptions(std::size_t maxRequests,
+                    const boost::posix_time::time_duration& idleTimeout)
+      : maxRequests(maxRequests), idleTimeout(idleTimeout)
+   {
+   }
+
+   bool enabled() const { return maxRequests > 1; }
+
+   // maximum number of requests served over a single connection
+   // (0 or 1 disables keep-alive)
+   std::size_t maxRequests;
+
+   // time to wait for the next request before closing the connection
+   boost::posix_time::time_duration idleTimeout;
+};
+
 // abstract base (insulate clients from knowledge of protocol-specifics)
 class AsyncConnection : public Socket
 {
@@ -54,7 +82,11 @@ public:
    // request
    virtual const http::Request& request() const = 0;
 
-   // populate or set response then call writeResponse when done
+   // populate or set response then call writeResponse when done. when
+   // close is true the connection is closed after the write unless it is
+   // eligible for keep-alive (in which case it is reused for the next
+   // request). when close is false the socket is left open and untouched
+   // (e.g. for protocol upgrades)
    virtual http::Response& response() = 0;
    virtual void writeResponse(bool close = true) = 0;
 
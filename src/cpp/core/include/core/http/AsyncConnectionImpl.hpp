@@ -16,26 +16,37 @@
 #ifndef CORE_HTTP_ASYNC_CONNECTION_IMPL_HPP
 #define CORE_HTTP_ASYNC_CONNECTION_IMPL_HPP
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#endif
+
 #include <boost/array.hpp>
 #include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <boost/asio/write.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
 #include <core/Error.hpp>
 #include <core/Log.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/Thread.hpp>
 
 #include <core/http/Request.hpp>
 #include <core/http/Response.hpp>
 #include <core/http/SocketUtils.hpp>
+#include <core/http/StreamResponse.hpp>
 #include <core/http/RequestParser.hpp>
+#include <core/http/RequestMetrics.hpp>
 #include <core/http/AsyncConnection.hpp>
 
 namespace rstudio {
@@ -96,11 +107,20 @@ public:
                        boost::shared_ptr<boost::asio::ssl::context> sslContext,
                        const Handler& handler,
                        const RequestFilter& requestFilter = RequestFilter(),
-                       const ResponseFilter& responseFilter = ResponseFilter())
+                       const ResponseFilter& responseFilter = ResponseFilter(),
+                       const KeepAliveOptions& keepAliveOptions = KeepAliveOptions())
       : ioService_(ioService),
         handler_(handler),
         requestFilter_(requestFilter),
         responseFilter_(responseFilter),
+        keepAliveOptions_(keepAliveOptions),
+        idleTimer_(ioService),
+        requestCount_(0),
+        requestComplete_(false),
+        awaitingRequest_(false),
+        sendFileFd_(-1),
+        sendFileOffset_(0),
+        requestInFlight_(false),
         closed_(false)
         
    {
@@ -121,6 +141,21 @@ public:
       }
    }
 
+   virtual ~AsyncConnectionImpl()
+   {
+      try
+      {
+         closeSendFile();
+
+         // the connection went away before a response was written
+         if (requestInFlight_)
+            request_metrics::requestAborted(request_.uri());
+      }
+      catch(...)
+      {
+      }
+   }
+
    SocketType& socket()
    {
       return *socket_;
@@ -162,19 +197,70 @@ public:
       // add extra response headers
       if (!response_.containsHeader("Date"))
          response_.setHeader("Date", util::httpDate());
-      if (close)
-         response_.setHeader("Connection", "close");
+
+      // read the body into memory if we can't write it directly from disk
+      if (response_.isSendFile() && !canSendFile())
+      {
+         Error error = response_.loadSendFile();
+         if (error)
+         {
+            LOG_ERROR(error);
+            response_.setError(error);
+         }
+      }
 
       // make sure that if no body and content-length were specified,
       // we send 0 for Content-Length
       // otherwise, this response will be invalid
-      if (response_.body().empty() && response_.headerValue("Content-Length").empty())
+      // (streamed responses are framed using chunked encoding instead)
+      if (!response_.isStreamResponse() &&
+          response_.body().empty() &&
+          response_.headerValue("Content-Length").empty())
           response_.setContentLength(0);
 
       // call the response filter if we have one
       if (responseFilter_)
          responseFilter_(originalUri_, &response_);
 
+      recordRequestFinished();
+
+      // determine whether we can reuse this connection for another request
+      bool keepAlive = close && canKeepAlive();
+      if (keepAlive)
+         response_.setHeader("Connection", "keep-alive");
+      else if (close)
+         response_.setHeader("Connection", "close");
+
+      // streamed responses write their headers and then each chunk in turn
+      if (response_.isStreamResponse())
+      {
+         socketOperations_->asyncWrite(
+             response_.headerBuffers(),
+             boost::bind(
+                  &AsyncConnectionImpl<SocketType>::handleStreamWrite,
+                  AsyncConnectionImpl<SocketType>::shared_from_this(),
+                  boost::asio::placeholders::error,
+                  close,
+                  keepAlive));
+         return;
+      }
+
+#ifdef __linux__
+      // send file responses write their headers and then the file
+      if (response_.isSendFile())
+      {
+         socketOperations_->asyncWrite(
+             response_.headerBuffers(),
+             boost::bind(
+                  &AsyncConnectionImpl<SocketType>::beginSendFile,
+                  AsyncConnectionImpl<SocketType>::shared_from_this(),
+                  boost::asio::placeholders::error,
+                  close,
+                  keepAlive));
+         return;
+      }
+#endif
+
       // write
       socketOperations_->asyncWrite(
           response_.toBuffers(),
@@ -182,7 +268,8 @@ public:
                &AsyncConnectionImpl<SocketType>::handleWrite,
                AsyncConnectionImpl<SocketType>::shared_from_this(),
                boost::asio::placeholders::error,
-               close)
+               close,
+               keepAlive)
       );
    }
 
@@ -197,6 +284,8 @@ public:
       if (!response_.containsHeader("Date"))
          response_.setHeader("Date", util::httpDate());
 
+      recordRequestFinished();
+
       // write only the header buffers
       socketOperations_->asyncWrite(response_.headerBuffers(), handler);
    }
@@ -225,6 +314,14 @@ public:
       socketOperations_->asyncWrite(buffers, handler);
    }
 
+#ifndef _WIN32
+   virtual int nativeHandle()
+   {
+      // ssl connections can only be read and written through the stream
+      return sslStream_ ? -1 : socket_->native_handle();
+   }
+#endif
+
    virtual void close()
    {
       // ensure the socket is only closed once - boost considers
@@ -233,6 +330,9 @@ public:
       {
          if (!closed_)
          {
+            boost::system::error_code ec;
+            idleTimer_.cancel(ec);
+
             Error error = closeSocket(*socket_);
             if (error && !core::http::isConnectionTerminatedError(error))
                LOG_ERROR(error);
@@ -252,51 +352,15 @@ private:
       {
          if (!e)
          {
-            // parse next chunk
-            RequestParser::status status = requestParser_.parse(
-                                             request_,
-                                             buffer_.data(), 
-                                             buffer_.data() + bytesTransferred);
-            
-            // error - return bad request
-            if (status == RequestParser::error)
-            {
-               response_.setStatusCode(http::status::BadRequest);
-               writeResponse();
-            }
-            
-            // incomplete -- keep reading
-            else if (status == RequestParser::incomplete)
+            // data has arrived so we are no longer idle
+            if (awaitingRequest_)
             {
-               readSome();
-            }
-            
-            // got valid request -- handle it 
-            else
-            {
-               // record the original uri
-               originalUri_ = request_.absoluteUri();
-
-               // call the request filter if we have one
-               if (requestFilter_)
-               {
-                  // call the filter (passing a continuation to be invoked
-                  // once the filter is completed)
-                  requestFilter_(
-                     ioService(),
-                     &request_,
-                     boost::bind(
-                        &AsyncConnectionImpl<SocketType>::requestFilterContinuation,
-                        AsyncConnectionImpl<SocketType>::shared_from_this(),
-                        _1
-                     ));
-               }
-               else
-               {
-                  // call the handler directly
-                  callHandler();
-               }
+               awaitingRequest_ = false;
+               boost::system::error_code ec;
+               idleTimer_.cancel(ec);
             }
+
+            handleInput(buffer_.data(), buffer_.data() + bytesTransferred);
          }
          else // error reading
          {
@@ -317,6 +381,175 @@ private:
       CATCH_UNEXPECTED_EXCEPTION
    }
    
+   void handleInput(const char* begin, const char* end)
+   {
+      // parse next chunk
+      const char* next = end;
+      RequestParser::status status = requestParser_.parse(request_,
+                                                          begin,
+                                                          end,
+                                                          &next);
+
+      // error - return bad request
+      if (status == RequestParser::error)
+      {
+         response_.setStatusCode(http::status::BadRequest);
+         writeResponse();
+      }
+
+      // incomplete -- keep reading
+      else if (status == RequestParser::incomplete)
+      {
+         readSome();
+      }
+
+      // got valid request -- handle it
+      else
+      {
+         requestComplete_ = true;
+         ++requestCount_;
+
+         // hold on to any pipelined data that follows this request
+         // (it will be processed once the response has been written)
+         if (keepAliveOptions_.enabled())
+            pendingInput_.assign(next, end);
+
+         // record the original uri
+         originalUri_ = request_.absoluteUri();
+
+         // start timing the request
+         if (request_metrics::enabled())
+         {
+            requestStartTime_ =
+                  boost::posix_time::microsec_clock::universal_time();
+            requestInFlight_ = true;
+            request_metrics::requestStarted(request_.uri(),
+                                            request_.body().size());
+         }
+
+         // call the request filter if we have one
+         if (requestFilter_)
+         {
+            // call the filter (passing a continuation to be invoked
+            // once the filter is completed)
+            requestFilter_(
+               ioService(),
+               &request_,
+               boost::bind(
+                  &AsyncConnectionImpl<SocketType>::requestFilterContinuation,
+                  AsyncConnectionImpl<SocketType>::shared_from_this(),
+                  _1
+               ));
+         }
+         else
+         {
+            // call the handler directly
+            callHandler();
+         }
+      }
+   }
+
+   void recordRequestFinished()
+   {
+      if (!requestInFlight_)
+         return;
+
+      requestInFlight_ = false;
+
+      // send file bodies aren't read into memory so use their length
+      std::size_t bytesOut = response_.body().size();
+      if (response_.isSendFile())
+      {
+         bytesOut = safe_convert::stringTo<std::size_t>(
+                        response_.headerValue("Content-Length"), 0);
+      }
+
+      request_metrics::requestFinished(
+            request_.uri(),
+            boost::posix_time::microsec_clock::universal_time() -
+                                                         requestStartTime_,
+            bytesOut);
+   }
+
+   bool canKeepAlive() const
+   {
+      if (!keepAliveOptions_.enabled() || !requestComplete_)
+         return false;
+
+      if (requestCount_ >= keepAliveOptions_.maxRequests)
+         return false;
+
+      // the client has to be able to determine where the response ends
+      if (response_.headerValue("Content-Length").empty() &&
+          !response_.isStreamResponse())
+         return false;
+
+      // respect the client's wishes (http/1.0 defaults to close)
+      std::string connection = request_.headerValue("Connection");
+      if (request_.isHttp10())
+         return boost::algorithm::iequals(connection, "keep-alive");
+      else
+         return !boost::algorithm::iequals(connection, "close");
+   }
+
+   void readNextRequest()
+   {
+      // reset state for the next request
+      request_.reset();
+      response_.reset();
+      requestParser_.reset();
+      originalUri_.clear();
+      requestComplete_ = false;
+
+      if (!pendingInput_.empty())
+      {
+         // process pipelined request data we already have on hand
+         std::string input;
+         input.swap(pendingInput_);
+         handleInput(input.data(), input.data() + input.size());
+      }
+      else
+      {
+         waitForIdleTimer();
+         readSome();
+      }
+   }
+
+   void waitForIdleTimer()
+   {
+      boost::system::error_code ec;
+      idleTimer_.expires_from_now(keepAliveOptions_.idleTimeout, ec);
+      if (ec)
+      {
+         LOG_ERROR(Error(ec, ERROR_LOCATION));
+         return;
+      }
+
+      awaitingRequest_ = true;
+      idleTimer_.async_wait(
+               boost::bind(&AsyncConnectionImpl<SocketType>::handleIdleTimeout,
+                           AsyncConnectionImpl<SocketType>::shared_from_this(),
+                           boost::asio::placeholders::error));
+   }
+
+   void handleIdleTimeout(const boost::system::error_code& ec)
+   {
+      try
+      {
+         if (ec == boost::asio::error::operation_aborted)
+            return;
+
+         if (ec)
+            LOG_ERROR(Error(ec, ERROR_LOCATION));
+
+         // no new request arrived in time - close the connection
+         // (the pending read will then complete with an error)
+         if (awaitingRequest_)
+            close();
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
    void requestFilterContinuation(boost::shared_ptr<http::Response> response)
    {
       if (response)
@@ -336,7 +569,9 @@ private:
                &request_);
    }
 
-   void handleWrite(const boost::system::error_code& e, bool closeSocket)
+   void handleWrite(const boost::system::error_code& e,
+                    bool closeSocket,
+                    bool keepAlive)
    {
       try
       {
@@ -348,8 +583,14 @@ private:
                LOG_ERROR(error);
          }
          
-         // close the socket
-         if (closeSocket)
+         // reuse the connection for the next request if we can
+         if (keepAlive && !e)
+         {
+            readNextRequest();
+         }
+
+         // otherwise close the socket
+         else if (closeSocket)
          {
             close();
          }
@@ -362,6 +603,157 @@ private:
       CATCH_UNEXPECTED_EXCEPTION
    }
    
+   void handleStreamWrite(const boost::system::error_code& e,
+                          bool closeSocket,
+                          bool keepAlive)
+   {
+      try
+      {
+         boost::shared_ptr<StreamResponse> pStream = response_.streamResponse();
+         if (e || pStream->complete())
+         {
+            streamChunk_.clear();
+            handleWrite(e, closeSocket, keepAlive);
+            return;
+         }
+
+         // write the next chunk -- if we can't then there is no way to
+         // signal the error to the client mid-response so just close
+         Error error = pStream->nextChunk(&streamChunk_);
+         if (error)
+         {
+            LOG_ERROR(error);
+            streamChunk_.clear();
+            close();
+            return;
+         }
+
+         std::vector<boost::asio::const_buffer> buffers;
+         buffers.push_back(boost::asio::buffer(streamChunk_));
+         socketOperations_->asyncWrite(
+             buffers,
+             boost::bind(
+                  &AsyncConnectionImpl<SocketType>::handleStreamWrite,
+                  AsyncConnectionImpl<SocketType>::shared_from_this(),
+                  boost::asio::placeholders::error,
+                  closeSocket,
+                  keepAlive));
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   bool canSendFile() const
+   {
+#ifdef __linux__
+      // the file would bypass encryption
+      return !sslStream_;
+#else
+      return false;
+#endif
+   }
+
+#ifdef __linux__
+   void beginSendFile(const boost::system::error_code& e,
+                      bool closeSocket,
+                      bool keepAlive)
+   {
+      try
+      {
+         if (e)
+         {
+            handleWrite(e, closeSocket, keepAlive);
+            return;
+         }
+
+         std::string path = response_.sendFilePath().absolutePath();
+         sendFileFd_ = ::open(path.c_str(), O_RDONLY);
+         if (sendFileFd_ == -1)
+         {
+            // headers are already written so all we can do is close
+            Error error = systemError(errno, ERROR_LOCATION);
+            error.addProperty("path", path);
+            LOG_ERROR(error);
+            close();
+            return;
+         }
+         sendFileOffset_ = 0;
+
+         // sendfile is invoked directly on the socket so it needs to be in
+         // non-blocking mode (we wait for it to become writable using asio)
+         boost::system::error_code ec;
+         if (!socket_->native_non_blocking())
+            socket_->native_non_blocking(true, ec);
+
+         continueSendFile(ec, closeSocket, keepAlive);
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   void continueSendFile(const boost::system::error_code& e,
+                         bool closeSocket,
+                         bool keepAlive)
+   {
+      try
+      {
+         boost::system::error_code ec = e;
+         off_t size = response_.contentLength();
+         while (!ec && sendFileOffset_ < size)
+         {
+            ssize_t bytes = ::sendfile(socket_->native_handle(),
+                                       sendFileFd_,
+                                       &sendFileOffset_,
+                                       size - sendFileOffset_);
+            if (bytes > 0)
+               continue;
+
+            if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+               // wait for the socket to become writable again
+               socket_->async_write_some(
+                  boost::asio::null_buffers(),
+                  boost::bind(
+                     &AsyncConnectionImpl<SocketType>::continueSendFile,
+                     AsyncConnectionImpl<SocketType>::shared_from_this(),
+                     boost::asio::placeholders::error,
+                     closeSocket,
+                     keepAlive));
+               return;
+            }
+            else if (bytes == -1 && errno == EINTR)
+            {
+               continue;
+            }
+
+            // the file was truncated underneath us or the write failed
+            if (bytes == 0)
+               ec = boost::asio::error::eof;
+            else
+               ec = boost::system::error_code(errno,
+                                              boost::system::system_category());
+         }
+
+         closeSendFile();
+
+         // a partially written body can't be recovered from so always
+         // close the socket on error
+         if (ec)
+            handleWrite(ec, true, false);
+         else
+            handleWrite(ec, closeSocket, keepAlive);
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+#endif
+
+   void closeSendFile()
+   {
+      if (sendFileFd_ != -1)
+      {
+         ::close(sendFileFd_);
+         sendFileFd_ = -1;
+      }
+   }
+
    void readSome()
    {
       socketOperations_->asyncReadSome(boost::asio::buffer(buffer_),
@@ -409,6 +801,25 @@ private:
    http::Request request_;
    http::Response response_;
 
+   // keep-alive state
+   KeepAliveOptions keepAliveOptions_;
+   boost::asio::deadline_timer idleTimer_;
+   std::size_t requestCount_;
+   bool requestComplete_;
+   bool awaitingRequest_;
+   std::string pendingInput_;
+
+   // chunk currently being written for a streamed response
+   std::string streamChunk_;
+
+   // file currently being written for a send file response
+   int sendFileFd_;
+   off_t sendFileOffset_;
+
+   // request metrics state
+   boost::posix_time::ptime requestStartTime_;
+   bool requestInFlight_;
+
    boost::mutex socketMutex_;
    bool closed_ = false;
 };
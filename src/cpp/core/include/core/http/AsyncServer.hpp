@@ -27,6 +27,7 @@
 #include <core/http/UriHandler.hpp>
 #include <core/http/AsyncUriHandler.hpp>
 #include <core/http/Response.hpp>
+#include <core/http/AsyncConnection.hpp>
 
 namespace rstudio {
 namespace core {
@@ -66,6 +67,16 @@ public:
    virtual void setRequestFilter(RequestFilter requestFilter) = 0;
    virtual void setResponseFilter(ResponseFilter responseFilter) = 0;
 
+   // enable reuse of connections across requests (disabled by default)
+   virtual void setKeepAliveOptions(const KeepAliveOptions& options) = 0;
+
+   // give each thread of the pool (of the given size) its own io_service and
+   // acceptor rather than sharing one io_service between all of them. must
+   // be called before the server is initialized, which is when all of the
+   // acceptors are opened (i.e. while the process may still be privileged)
+   virtual void setIoServicePerThread(bool ioServicePerThread,
+                                      std::size_t threadPoolSize) = 0;
+
    virtual Error runSingleThreaded() = 0;
 
    virtual Error run(std::size_t threadPoolSize = 1) = 0;
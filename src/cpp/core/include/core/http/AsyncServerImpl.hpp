@@ -20,6 +20,7 @@
 
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/function.hpp>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string.hpp>
@@ -62,8 +63,13 @@ public:
         acceptorService_(),
         scheduledCommandInterval_(boost::posix_time::seconds(3)),
         scheduledCommandTimer_(acceptorService_.ioService()),
+        ioServicePerThread_(false),
+        ioServiceThreadPoolSize_(1),
         running_(false)
    {
+      // the primary acceptor is always the first shard
+      acceptorShards_.push_back(boost::shared_ptr<AcceptorShard>(
+                                      new AcceptorShard(acceptorService_)));
    }
    
    virtual ~AsyncServerImpl()
@@ -142,6 +148,20 @@ public:
       responseFilter_ = responseFilter;
    }
 
+   virtual void setKeepAliveOptions(const KeepAliveOptions& options)
+   {
+      BOOST_ASSERT(!running_);
+      keepAliveOptions_ = options;
+   }
+
+   virtual void setIoServicePerThread(bool ioServicePerThread,
+                                      std::size_t threadPoolSize)
+   {
+      BOOST_ASSERT(!running_);
+      ioServicePerThread_ = ioServicePerThread;
+      ioServiceThreadPoolSize_ = threadPoolSize;
+   }
+
    virtual Error runSingleThreaded()
    {
 
@@ -149,14 +169,14 @@ public:
       running_ = true;
 
       // get ready for next connection
-      acceptNextConnection();
+      acceptNextConnection(acceptorShards_.front().get());
 
       // initialize scheduled command timer
       waitForScheduledCommandTimer();
 
 
       // run
-      runServiceThread();
+      runServiceThread(&acceptorService_.ioService());
 
 
       return Success();
@@ -172,8 +192,12 @@ public:
          // update state
          running_ = true;
 
-         // get ready for next connection
-         acceptNextConnection();
+         // get ready for next connection on each acceptor
+         BOOST_FOREACH(const boost::shared_ptr<AcceptorShard>& pShard,
+                       acceptorShards_)
+         {
+            acceptNextConnection(pShard.get());
+         }
 
          // initialize scheduled command timer
          waitForScheduledCommandTimer();
@@ -185,13 +209,18 @@ public:
          if (error)
             return error ;
       
-         // create the threads
+         // create the threads (if there are fewer acceptors than threads
+         // then the threads share their io_services round-robin)
          for (std::size_t i=0; i < threadPoolSize; ++i)
          {
+            AcceptorShard* pShard =
+                        acceptorShards_[i % acceptorShards_.size()].get();
+
             // run the thread
             boost::shared_ptr<boost::thread> pThread(new boost::thread(
                               &AsyncServerImpl<ProtocolType>::runServiceThread,
-                              this));
+                              this,
+                              &pShard->acceptorService.ioService()));
             
             // add to list of threads
             threads_.push_back(pThread);            
@@ -208,14 +237,22 @@ public:
    
    virtual void stop()
    {
-      // close acceptor so we free up the main port immediately
-      boost::system::error_code closeEc;
-      acceptorService_.closeAcceptor(closeEc);
-      if (closeEc)
-         LOG_ERROR(Error(closeEc, ERROR_LOCATION));
+      // close acceptors so we free up the main port immediately
+      BOOST_FOREACH(const boost::shared_ptr<AcceptorShard>& pShard,
+                    acceptorShards_)
+      {
+         boost::system::error_code closeEc;
+         pShard->acceptorService.closeAcceptor(closeEc);
+         if (closeEc)
+            LOG_ERROR(Error(closeEc, ERROR_LOCATION));
+      }
       
       // stop the server 
-      acceptorService_.ioService().stop();
+      BOOST_FOREACH(const boost::shared_ptr<AcceptorShard>& pShard,
+                    acceptorShards_)
+      {
+         pShard->acceptorService.ioService().stop();
+      }
 
       // update state
       running_ = false;
@@ -245,25 +282,66 @@ public:
    
 private:
 
-   void runServiceThread()
+   // an acceptor along with the io_service which runs it and the connections
+   // it accepts. by default there is only the primary acceptor (shared by
+   // all threads); when running an io_service per thread each additional
+   // thread gets its own acceptor listening on the same endpoint
+   struct AcceptorShard : boost::noncopyable
+   {
+      AcceptorShard()
+         : pOwnedAcceptorService(new SocketAcceptorService<ProtocolType>()),
+           acceptorService(*pOwnedAcceptorService)
+      {
+      }
+
+      explicit AcceptorShard(SocketAcceptorService<ProtocolType>& service)
+         : acceptorService(service)
+      {
+      }
+
+      boost::scoped_ptr<SocketAcceptorService<ProtocolType> > pOwnedAcceptorService;
+      SocketAcceptorService<ProtocolType>& acceptorService;
+      boost::shared_ptr<AsyncConnectionImpl<typename ProtocolType::socket> > ptrNextConnection;
+   };
+
+   void addAcceptorShards(std::size_t count)
+   {
+      while (acceptorShards_.size() < count)
+      {
+         boost::shared_ptr<AcceptorShard> pShard(new AcceptorShard());
+         Error error = initAdditionalAcceptor(pShard->acceptorService);
+         if (error)
+         {
+            // not fatal: remaining threads will share the existing acceptors
+            error.addProperty("description",
+                              "Unable to create io_service for each thread");
+            LOG_ERROR(error);
+            return;
+         }
+
+         acceptorShards_.push_back(pShard);
+      }
+   }
+
+   void runServiceThread(boost::asio::io_service* pIoService)
    {
       try
       {
          boost::system::error_code ec;
-         acceptorService_.ioService().run(ec);
+         pIoService->run(ec);
          if (ec)
             LOG_ERROR(Error(ec, ERROR_LOCATION));
       }
       CATCH_UNEXPECTED_EXCEPTION
    }
 
-   void acceptNextConnection()
+   void acceptNextConnection(AcceptorShard* pShard)
    {
-      ptrNextConnection_.reset(
+      pShard->ptrNextConnection.reset(
                new AsyncConnectionImpl<typename ProtocolType::socket> (
 
          // controlling io_service
-         acceptorService_.ioService(),
+         pShard->acceptorService.ioService(),
 
          // optional ssl context - only used for SSL connections
          sslContext_,
@@ -278,25 +356,30 @@ private:
 
          // response filter
          boost::bind(&AsyncServerImpl<ProtocolType>::connectionResponseFilter,
-                     this, _1, _2)
+                     this, _1, _2),
+
+         // persistent connection settings
+         keepAliveOptions_
       ));
 
       // wait for next connection
-      acceptorService_.asyncAccept(
-         ptrNextConnection_->socket(),
+      pShard->acceptorService.asyncAccept(
+         pShard->ptrNextConnection->socket(),
          boost::bind(&AsyncServerImpl<ProtocolType>::handleAccept,
                      this,
+                     pShard,
                      boost::asio::placeholders::error)
       );
    }
    
-   void handleAccept(const boost::system::error_code& ec)
+   void handleAccept(AcceptorShard* pShard,
+                     const boost::system::error_code& ec)
    {
       try
       {
          if (!ec) 
          {
-            ptrNextConnection_->startReading();
+            pShard->ptrNextConnection->startReading();
          }
          else
          {
@@ -327,7 +410,7 @@ private:
       // ALWAYS accept next connection
       try
       {
-         acceptNextConnection() ;
+         acceptNextConnection(pShard) ;
       }
       CATCH_UNEXPECTED_EXCEPTION
    }
@@ -479,6 +562,31 @@ protected:
       return acceptorService_;
    }
 
+   bool ioServicePerThread() const
+   {
+      return ioServicePerThread_;
+   }
+
+   // once the primary acceptor is open, open an acceptor (and io_service)
+   // for each of the other threads if requested. servers call this from
+   // their init, since the endpoint may only be bound by a privileged
+   // process (and privileges are dropped before the server is run)
+   void initAcceptorShards()
+   {
+      if (ioServicePerThread_)
+         addAcceptorShards(ioServiceThreadPoolSize_);
+   }
+
+   // open an additional acceptor on the endpoint of the primary acceptor
+   // (required to run an io_service per thread, so servers whose protocol
+   // allows an endpoint to be shared between acceptors override this)
+   virtual Error initAdditionalAcceptor(
+                        SocketAcceptorService<ProtocolType>& acceptorService)
+   {
+      return systemError(boost::system::errc::operation_not_supported,
+                         ERROR_LOCATION);
+   }
+
    void setSslContext(boost::shared_ptr<boost::asio::ssl::context> context)
    {
       // sets ssl context, enabling the usage of ssl for incoming connections
@@ -548,17 +656,20 @@ private:
    std::string serverName_;
    std::string baseUri_;
    boost::shared_ptr<boost::asio::ssl::context> sslContext_;
-   boost::shared_ptr<AsyncConnectionImpl<typename ProtocolType::socket> > ptrNextConnection_;
    AsyncUriHandlers uriHandlers_ ;
    AsyncUriHandlerFunction defaultHandler_;
    std::vector<boost::shared_ptr<boost::thread> > threads_;
    SocketAcceptorService<ProtocolType> acceptorService_;
+   std::vector<boost::shared_ptr<AcceptorShard> > acceptorShards_;
    boost::posix_time::time_duration scheduledCommandInterval_;
    boost::asio::deadline_timer scheduledCommandTimer_;
    std::vector<boost::shared_ptr<ScheduledCommand> > scheduledCommands_;
    RequestFilter requestFilter_;
    ResponseFilter responseFilter_;
    NotFoundHandler notFoundHandler_;
+   KeepAliveOptions keepAliveOptions_;
+   bool ioServicePerThread_;
+   std::size_t ioServiceThreadPoolSize_;
    bool running_;
 };
 
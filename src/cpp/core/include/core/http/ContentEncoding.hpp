@@ -0,0 +1,72 @@
+/*
+ * ContentEncoding.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_CONTENT_ENCODING_HPP
+#define CORE_HTTP_CONTENT_ENCODING_HPP
+
+#include <string>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+
+namespace http {
+
+// negotiation of the compression (Content-Encoding) applied to response
+// bodies. gzip is available on all posix platforms; brotli and zstd are
+// available when rstudio is built against their libraries
+
+extern const int kDefaultCompressionLevel;
+
+// compression level applied to all encodings (1-9, higher levels produce
+// smaller output at the cost of more cpu)
+void setCompressionLevel(int level);
+int compressionLevel();
+
+// compression can be disabled altogether (e.g. for a server reached only
+// over the loopback interface, where it costs more than it saves)
+void setCompressionEnabled(bool enabled);
+bool compressionEnabled();
+
+// content types which are already compressed (e.g. png, pdf, zip) are
+// not worth compressing again. a type ending in "/" excludes all of
+// its subtypes (and no type is compressible when compression is disabled)
+void addUncompressedContentType(const std::string& contentType);
+bool isCompressibleContentType(const std::string& contentType);
+
+// is this an encoding we know how to produce
+bool isSupportedEncoding(const std::string& encoding);
+
+// quality (from 0 to 1) assigned to the encoding by an Accept-Encoding
+// header (0 if the encoding is not acceptable)
+double encodingQuality(const std::string& acceptEncoding,
+                       const std::string& encoding);
+
+// the supported encoding most preferred by an Accept-Encoding header
+// (empty if there isn't one). ties are broken in favor of the encoding
+// which compresses best
+std::string preferredEncoding(const std::string& acceptEncoding);
+
+// compress content using the given (supported) encoding
+Error compressContent(const std::string& encoding,
+                      const std::string& content,
+                      std::string* pCompressed);
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_CONTENT_ENCODING_HPP
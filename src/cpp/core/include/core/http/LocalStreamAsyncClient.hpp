@@ -20,6 +20,7 @@
 
 #include <boost/function.hpp>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <boost/asio/local/stream_protocol.hpp>
 
@@ -47,24 +48,121 @@ public:
                                                 http::ConnectionRetryProfile())
      : AsyncClient<boost::asio::local::stream_protocol::socket>(ioService,
                                                                 logToStderr),
-       socket_(ioService),
+       socket_(new boost::asio::local::stream_protocol::socket(ioService)),
        localStreamPath_(localStreamPath),
-       validateUid_(validateUid)
+       validateUid_(validateUid),
+       persistent_(false),
+       connected_(false),
+       reusable_(false)
    {
       setConnectionRetryProfile(retryProfile);
    }
 
+   typedef boost::shared_ptr<boost::asio::local::stream_protocol::socket>
+                                                         PersistentSocket;
+
+   // keep the connection open after the response so that it can be reused
+   // for subsequent requests. if an already connected socket is provided
+   // (e.g. from a connection pool) it is used instead of connecting anew.
+   // must be called prior to execute
+   void setPersistentConnection(const PersistentSocket& pSocket = PersistentSocket())
+   {
+      persistent_ = true;
+      if (pSocket && pSocket->is_open())
+      {
+         socket_ = pSocket;
+         connected_ = true;
+      }
+   }
+
+   // was this request executed over a previously established connection
+   bool reusedConnection() const
+   {
+      return connected_;
+   }
+
+   // take ownership of the underlying socket once the response has been
+   // received. returns an empty pointer if the connection cannot be reused
+   // (e.g. the server indicated it would close the connection)
+   PersistentSocket releaseConnection()
+   {
+      if (!reusable_)
+         return PersistentSocket();
+
+      // leave an unopened socket in place so that subsequent
+      // operations on this client are harmless no-ops
+      PersistentSocket pSocket = socket_;
+      socket_.reset(new boost::asio::local::stream_protocol::socket(ioService()));
+      reusable_ = false;
+      return pSocket;
+   }
+
+   virtual int nativeHandle()
+   {
+      return socket_->native_handle();
+   }
+
 protected:
 
    virtual boost::asio::local::stream_protocol::socket& socket()
    {
-      return socket_;
+      return *socket_;
    }
 
 private:
 
+   virtual bool requestKeepAlive()
+   {
+      return persistent_;
+   }
+
+   virtual bool stopReadingAndRespond()
+   {
+      if (!persistent_)
+         return false;
+
+      // with a persistent connection the server won't close the socket
+      // to signal the end of the response, so rely on the content length
+      // (which for a response without a body describes the body the
+      // request would otherwise have had)
+      if (!hasNoBody())
+      {
+         if (response_.headerValue("Content-Length").empty())
+            return false;
+
+         if (response_.body().length() < response_.contentLength())
+            return false;
+      }
+
+      reusable_ = !boost::algorithm::iequals(
+                     response_.headerValue("Connection"), "close");
+      return true;
+   }
+
+   virtual bool keepConnectionAlive()
+   {
+      return reusable_;
+   }
+
+   // responses which never carry a body, whatever their headers say
+   bool hasNoBody()
+   {
+      int status = response_.statusCode();
+      return request().method() == "HEAD" ||
+             (status >= 100 && status < 200) ||
+             status == http::status::NoContent ||
+             status == http::status::NotModified;
+   }
+
    virtual void connectAndWriteRequest()
    {
+      // write directly on an already established connection
+      if (connected_)
+      {
+         writeRequest();
+         return;
+      }
+
       // validate if requested
       if (validateUid_.is_initialized() && localStreamPath_.exists())
       {
@@ -132,9 +230,12 @@ private:
    }
 
 private:
-   boost::asio::local::stream_protocol::socket socket_;
+   PersistentSocket socket_;
    core::FilePath localStreamPath_;
    boost::optional<UidType> validateUid_;
+   bool persistent_;
+   bool connected_;
+   bool reusable_;
 };
    
    
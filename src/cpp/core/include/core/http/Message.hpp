@@ -41,6 +41,8 @@ namespace http {
 
 // encodings
 extern const char * const kGzipEncoding;         
+extern const char * const kBrotliEncoding;
+extern const char * const kZstdEncoding;
 extern const char * const kTransferEncoding;
 extern const char * const kChunkedTransferEncoding;
 
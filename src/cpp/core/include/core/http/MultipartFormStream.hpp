@@ -0,0 +1,110 @@
+/*
+ * MultipartFormStream.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_MULTIPART_FORM_STREAM_HPP
+#define CORE_HTTP_MULTIPART_FORM_STREAM_HPP
+
+#include <iosfwd>
+#include <string>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <core/http/Header.hpp>
+#include <core/http/Util.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+namespace http {
+
+/// Parser for a multipart/form-data body (as parseMultipartForm) which is
+/// fed the body as it arrives, and writes the contents of uploaded files to
+/// disk rather than holding them in memory. The files' paths and sizes are
+/// recorded in their File entries (their contents are empty).
+class MultipartFormStream : boost::noncopyable
+{
+public:
+   /// Construct for a body of the given content type. Uploaded files are
+   /// written to the paths returned by filePath; those larger than
+   /// maxFileSize bytes (if it is non-zero) aren't kept, although their size
+   /// is still counted (and their path is then empty).
+   MultipartFormStream(const std::string& contentType,
+                       const boost::function<FilePath()>& filePath,
+                       uintmax_t maxFileSize = 0);
+
+   /// Removes the files written unless they were released.
+   ~MultipartFormStream();
+
+   /// Parses the next piece of the body. Returns an error if the body is
+   /// malformed or a file can't be written.
+   Error write(const char* data, std::size_t size);
+
+   /// Whether the closing boundary of the body has been parsed.
+   bool complete() const { return state_ == Complete; }
+
+   const Fields& fields() const { return fields_; }
+   const Files& files() const { return files_; }
+
+   /// Keep the files written after this stream is destroyed (their removal
+   /// is then up to the consumer of the files).
+   void releaseFiles() { filesReleased_ = true; }
+
+private:
+   Error parseBuffer(bool* pMore);
+   Error beginPart(const Headers& headers);
+   Error writePartData(const char* data, std::size_t size);
+   Error endPart();
+
+   enum State
+   {
+      Preamble,       // before the first boundary
+      BoundaryEnd,    // after a boundary (either CRLF or "--")
+      PartHeaders,    // reading the headers of a part
+      PartBody,       // reading the body of a part
+      Complete        // after the closing boundary
+   } state_;
+
+   // "--<boundary>"
+   std::string boundary_;
+
+   const boost::function<FilePath()> filePath_;
+   const uintmax_t maxFileSize_;
+
+   // unparsed input
+   std::string buffer_;
+
+   // the part being parsed: its name, and either the file it's written to
+   // or its value
+   std::string partName_;
+   bool partIsFile_;
+   File partFile_;
+   boost::shared_ptr<std::ostream> pPartStream_;
+   std::string partValue_;
+
+   Fields fields_;
+   Files files_;
+   bool filesReleased_;
+};
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_MULTIPART_FORM_STREAM_HPP
@@ -117,6 +117,10 @@ public:
    
    const File& uploadedFile(const std::string& name) const;
    
+   // set the form fields and files of a body which was parsed as it was
+   // received (see MultipartFormStream) rather than on demand
+   void setFormFields(const Fields& fields, const Files& files);
+   
    void setBody(const std::string& body);
    
    void debugPrintUri(const std::string& caption) const;
@@ -0,0 +1,82 @@
+/*
+ * RequestMetrics.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_REQUEST_METRICS_HPP
+#define CORE_HTTP_REQUEST_METRICS_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace request_metrics {
+
+// process wide request latency, in-flight, and byte counts aggregated by
+// uri prefix (the first component of the uri path). collection is
+// disabled by default -- processes which periodically collect() the
+// metrics should enable it
+
+// upper bounds (in milliseconds) of the latency histogram buckets. the
+// histogram has one additional bucket for requests slower than all of them
+const std::vector<double>& latencyBucketsMs();
+
+struct PrefixStats
+{
+   PrefixStats();
+
+   std::string prefix;
+
+   // requests completed since the last collection
+   std::size_t requests;
+   std::size_t aborted;
+   boost::uintmax_t bytesIn;
+   boost::uintmax_t bytesOut;
+   double totalLatencyMs;
+   double maxLatencyMs;
+   std::vector<std::size_t> latencyCounts;
+
+   // requests currently being handled
+   std::size_t inFlight;
+};
+
+void setEnabled(bool enabled);
+bool enabled();
+
+// the prefix requests for the uri are aggregated under
+std::string uriPrefix(const std::string& uri);
+
+void requestStarted(const std::string& uri, std::size_t bytesIn);
+
+void requestFinished(const std::string& uri,
+                     const boost::posix_time::time_duration& latency,
+                     std::size_t bytesOut);
+
+// the connection was closed before a response was written
+void requestAborted(const std::string& uri);
+
+// stats for each prefix accumulated since the last collection. completed
+// request counts are reset by collecting whereas in-flight counts carry over
+std::vector<PrefixStats> collect();
+
+} // namespace request_metrics
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_REQUEST_METRICS_HPP
@@ -17,6 +17,11 @@
 #ifndef CORE_HTTP_REQUEST_PARSER_HPP
 #define CORE_HTTP_REQUEST_PARSER_HPP
 
+#include <iterator>
+#include <string>
+
+#include <boost/function.hpp>
+
 #include <core/http/Request.hpp>
 
 namespace rstudio {
@@ -33,6 +38,21 @@ public:
   /// Reset to initial parser state.
   void reset();
 
+  /// Consumer of a request body as it's parsed (e.g. to write an upload to
+  /// disk rather than buffering it in the request). Returns false if the
+  /// body should be rejected, which ends parsing with an error.
+  typedef boost::function<bool(const std::string&)> BodyHandler;
+
+  /// Called when the headers of a request with a body have been parsed;
+  /// returns a handler for its body, or an empty handler to leave the body
+  /// in the request.
+  typedef boost::function<BodyHandler(Request&)> BodyHandlerFactory;
+
+  void setBodyHandlerFactory(const BodyHandlerFactory& factory)
+  {
+     bodyHandlerFactory_ = factory;
+  }
+
   // enum for parse results
   enum status
   {
@@ -44,45 +64,174 @@ public:
   template <typename InputIterator>
   status parse(Request& req, InputIterator begin, InputIterator end)
   {
+    return parse(req, begin, end, &begin);
+  }
+
+  // parse, returning the position just past the last consumed character
+  // in pNext (allows callers to detect pipelined requests which follow
+  // a complete request within the same buffer)
+  template <typename InputIterator>
+  status parse(Request& req,
+               InputIterator begin,
+               InputIterator end,
+               InputIterator* pNext)
+  {
+    status st = incomplete;
     while (begin != end)
     {
        // header parsing
       if (!parsing_body_)
       {
-         status st = consume(req, *begin++);
+         // runs of ordinary characters (e.g. the uri or a header value) are
+         // taken in bulk; the state machine handles the character ending them
+         begin = consumeSpan(req, begin, end);
+         if (begin == end)
+            break;
+
+         st = consume(req, *begin++);
          if ( st == error )
          {
-            return st ;
+            break ;
          }
          else if ( st == complete  )
          {
             // if we have a body then continue parsing it
             if (content_length_ > 0)
             {
+               if (bodyHandlerFactory_)
+                  bodyHandler_ = bodyHandlerFactory_(req);
                parsing_body_ = true ;
+               st = incomplete ;
                continue ;
             }
             else
             {
-               return st ;
+               break ;
             }
          }
       }
       // body parsing
       else
       {
-         req.body_.push_back(*begin++) ;
-         if (req.body_.size() == content_length_)
-            return complete ;
+         InputIterator last = advanceAtMost(
+                  begin, end, content_length_ - body_received_);
+         if (bodyHandler_)
+         {
+            std::string chunk(begin, last);
+            body_received_ += chunk.size();
+            if (!bodyHandler_(chunk))
+            {
+               st = error ;
+               break ;
+            }
+         }
+         else
+         {
+            std::size_t previousSize = req.body_.size();
+            req.body_.append(begin, last);
+            body_received_ += req.body_.size() - previousSize;
+         }
+         begin = last;
+         if (body_received_ == content_length_)
+         {
+            st = complete ;
+            break ;
+         }
       }
     }
-    return incomplete ;
+
+    *pNext = begin;
+    return st ;
   }
 
 private:
   /// Handle the next character of input.
   status consume(Request& req, char input);
 
+  /// Append the characters which can't change the parser's state (e.g. the
+  /// characters of a header value other than the CR which ends it) to the
+  /// part of the request being parsed. Returns the first character not
+  /// consumed.
+  template <typename InputIterator>
+  InputIterator consumeSpan(Request& req,
+                            InputIterator begin,
+                            InputIterator end)
+  {
+    std::string* pTarget;
+    unsigned char spanClass;
+    switch (state_)
+    {
+    case method:
+      pTarget = &req.method_;
+      spanClass = token_class;
+      break;
+    case uri:
+      pTarget = &req.uri_;
+      spanClass = uri_class;
+      break;
+    case header_name:
+      pTarget = &req.headers_.back().name;
+      spanClass = token_class;
+      break;
+    case header_value:
+      pTarget = &req.headers_.back().value;
+      spanClass = value_class;
+      break;
+    default:
+      return begin;
+    }
+
+    const unsigned char* classes = char_classes();
+    InputIterator last = begin;
+    while (last != end && (classes[static_cast<unsigned char>(*last)] & spanClass))
+      ++last;
+    pTarget->append(begin, last);
+    return last;
+  }
+
+  /// Advance by n characters, or to the end if there are fewer.
+  template <typename InputIterator>
+  static InputIterator advanceAtMost(InputIterator begin,
+                                     InputIterator end,
+                                     std::size_t n)
+  {
+    return advanceAtMost(
+          begin, end, n,
+          typename std::iterator_traits<InputIterator>::iterator_category());
+  }
+
+  template <typename InputIterator>
+  static InputIterator advanceAtMost(InputIterator begin,
+                                     InputIterator end,
+                                     std::size_t n,
+                                     std::random_access_iterator_tag)
+  {
+    std::size_t available = end - begin;
+    return begin + (n < available ? n : available);
+  }
+
+  template <typename InputIterator, typename Category>
+  static InputIterator advanceAtMost(InputIterator begin,
+                                     InputIterator end,
+                                     std::size_t n,
+                                     Category)
+  {
+    for (; n > 0 && begin != end; n--)
+      ++begin;
+    return begin;
+  }
+
+  /// Classes of characters which may continue a span (see consumeSpan).
+  enum char_class
+  {
+    token_class = 1,   // method and header name characters
+    uri_class   = 2,   // uri characters
+    value_class = 4    // header value characters
+  };
+
+  /// The classes of each byte, indexed by its unsigned value.
+  static const unsigned char* char_classes();
+
   /// Check if a byte is an HTTP character.
   static bool is_char(int c);
 
@@ -124,6 +273,10 @@ private:
   std::size_t content_length_ ;
   bool parsing_content_length_ ;
   bool parsing_body_ ;
+  std::size_t body_received_ ;
+
+  BodyHandlerFactory bodyHandlerFactory_;
+  BodyHandler bodyHandler_;
 };
 
 } // namespace http
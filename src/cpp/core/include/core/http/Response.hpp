@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <boost/function.hpp>
 #include <boost/type_traits/is_same.hpp>
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/concepts.hpp>
@@ -32,8 +33,10 @@
 #include <core/FilePath.hpp>
 #include <core/FileUtils.hpp>
 
+#include "ContentEncoding.hpp"
 #include "Message.hpp"
 #include "Request.hpp"
+#include "StreamResponse.hpp"
 #include "Util.hpp"
 
 namespace rstudio {
@@ -53,6 +56,7 @@ enum Code {
    SwitchingProtocols = 101,
    Ok = 200,
    Created = 201,
+   NoContent = 204,
    PartialContent = 206,
    MovedPermanently = 301,
    MovedTemporarily = 302,
@@ -101,6 +105,8 @@ public:
       statusCode_ = response.statusCode_;
       statusCodeStr_ = response.statusCodeStr_;
       statusMessage_ = response.statusMessage_;
+      streamResponse_ = response.streamResponse_;
+      sendFilePath_ = response.sendFilePath_;
    }
 
 public:   
@@ -112,6 +118,11 @@ public:
       
    std::string contentEncoding() const;
    void setContentEncoding(const std::string& encoding);
+
+   // compress the body using the best encoding the request accepts (the
+   // encoding is dropped when the body is set if its content type is
+   // already compressed)
+   void negotiateContentEncoding(const Request& request);
    
    void setCacheWithRevalidationHeaders();
    void setCacheForeverHeaders();
@@ -189,15 +200,8 @@ public:
          if ( !boost::is_same<Filter, NullOutputFilter>::value )
             filteringStream.push(filter, buffSize);
 
-         // handle gzip
-         if (contentEncoding() == kGzipEncoding)
-#ifdef _WIN32
-            // never gzip on win32
-            removeHeader("Content-Encoding");
-#else
-            // add gzip compressor on posix
-            filteringStream.push(boost::iostreams::gzip_compressor(), buffSize);
-#endif
+         // compress per the content encoding
+         std::string encoding = pushContentEncoding(&filteringStream, buffSize);
 
          // buffer to write to
          std::ostringstream bodyStream;
@@ -208,16 +212,7 @@ public:
          
          // set body 
          body_ = bodyStream.str();
-
-         if (padding && body_.length() < 1024)
-         {
-            body_ = body_ + std::string(1024 - body_.length(), ' ');
-         }
-
-         setContentLength(static_cast<int>(body_.length()));
-         
-         // return success
-         return Success();
+         return finishBody(encoding, padding);
       }
       catch(const std::exception& e)
       {
@@ -228,6 +223,11 @@ public:
       }
    }   
 
+   // set the body from a function which writes it to a stream (as it is
+   // produced, rather than building it as a string first). the output is
+   // compressed as it is written if a content encoding has been negotiated
+   Error setBodyFromWriter(const boost::function<void(std::ostream&)>& writer);
+
    Error setBody(const FilePath& filePath, std::streamsize buffSize = 512)
    {
       NullOutputFilter nullFilter;
@@ -280,13 +280,20 @@ public:
          setNotFoundError(request);
          return;
       }
+
+      // stream large unfiltered files rather than reading them into memory
+      if (boost::is_same<Filter, NullOutputFilter>::value &&
+          filePath.size() > kStreamFileThreshold)
+      {
+         setStreamFile(filePath, request);
+         return;
+      }
       
       // set content type
       setContentType(filePath.mimeContentType());
       
-      // gzip if possible
-      if (request.acceptsEncoding(kGzipEncoding))
-         setContentEncoding(kGzipEncoding);
+      // compress if possible
+      negotiateContentEncoding(request);
 
       bool padding =
           browser_utils::isQt(request.headerValue("User-Agent")) &&
@@ -332,8 +339,60 @@ public:
       }
    }
 
+   // serve a file which can be requested by (single) byte ranges (e.g.
+   // media which is seeked or pdfs which are read page by page). ranges are
+   // read from disk (and streamed if they are large) rather than the whole
+   // file being read into memory; requests without a range get the file as
+   // setFile would return it
    void setRangeableFile(const FilePath& filePath, const Request& request);
 
+   // stream the body of the response in fixed size chunks (using chunked
+   // transfer encoding) rather than buffering it all in memory. note that
+   // setFile does this automatically for files larger than
+   // kStreamFileThreshold
+   void setStreamFile(const FilePath& filePath,
+                      const Request& request,
+                      std::size_t chunkSize = StreamResponse::kDefaultChunkSize);
+
+   void setStreamBody(const StreamResponse::Generator& generator,
+                      const Request& request,
+                      std::size_t chunkSize = StreamResponse::kDefaultChunkSize);
+
+   void setStreamResponse(boost::shared_ptr<StreamResponse> pStream);
+
+   bool isStreamResponse() const { return !!streamResponse_; }
+   boost::shared_ptr<StreamResponse> streamResponse() const
+   {
+      return streamResponse_;
+   }
+
+   static const uintmax_t kStreamFileThreshold;
+
+   // serve a static asset (e.g. part of the client bundle). if the client
+   // accepts gzip and there is an up to date precompressed .gz sibling of
+   // the file then that is served as-is (written directly from disk by the
+   // connection, see setSendFile); without a sibling the file is compressed
+   // as negotiated with the client. ETags are maintained in an in-memory
+   // index so that revalidation doesn't require reading the file
+   void setStaticFile(const FilePath& filePath, const Request& request);
+
+   // serve an installed resource (e.g. MathJax or a theme) as
+   // setCacheableFile would, but from a mapping of the file which is shared
+   // by all requests for it (see core::mappedResource)
+   void setResourceFile(const FilePath& filePath, const Request& request);
+
+   // the body of the response is the (unencoded) contents of this file,
+   // which the connection writes directly from disk (using sendfile where
+   // it is available) rather than it being read into memory
+   void setSendFile(const FilePath& filePath);
+
+   bool isSendFile() const { return !sendFilePath_.empty(); }
+   const FilePath& sendFilePath() const { return sendFilePath_; }
+
+   // read the send file into the body (for connections which are unable
+   // to write it directly)
+   Error loadSendFile();
+
    void setRangeableFile(const std::string& contents,
                          const std::string& mimeType,
                          const Request& request);
@@ -369,6 +428,14 @@ private:
    void removeCachingHeaders();
    void setCacheForeverHeaders(bool publicAccessiblity);
    std::string eTagForContent(const std::string& content);
+   void setRangeNotSatisfiable(uintmax_t length);
+
+   // used by setBody to add the compressor for the content encoding (if any)
+   // to the body's stream and then apply whole-body encodings and padding
+   std::string pushContentEncoding(
+         boost::iostreams::filtering_ostream* pStream,
+         std::streamsize buffSize);
+   Error finishBody(const std::string& encoding, bool padding);
   
 private:
 
@@ -383,6 +450,12 @@ private:
    mutable std::string statusCodeStr_ ;
 
    NotFoundHandler notFoundHandler_;
+
+   // source of body data for streamed responses
+   boost::shared_ptr<StreamResponse> streamResponse_;
+
+   // file to write as the body for send file responses
+   FilePath sendFilePath_;
 };
 
 std::ostream& operator << (std::ostream& stream, const Response& r) ;
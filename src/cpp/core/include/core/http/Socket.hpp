@@ -42,6 +42,11 @@ public:
                      Handler Handler) = 0;
 
    virtual void close() = 0;
+
+   // the native descriptor of the underlying socket if data can be moved
+   // to and from it directly (-1 for sockets layered on another protocol
+   // e.g. ssl, or when this isn't supported on the platform)
+   virtual int nativeHandle() { return -1; }
 };
 
 } // namespace http
@@ -17,9 +17,11 @@
 #define CORE_HTTP_SOCKET_PROXY_HPP
 
 #include <string>
+#include <vector>
+#include <algorithm>
 
-#include <boost/array.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/asio/io_service.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
 #include <core/Thread.hpp>
@@ -30,22 +32,56 @@ namespace rstudio {
 namespace core {
 namespace http {
 
+struct SocketProxyOptions
+{
+   SocketProxyOptions()
+      : bufferSize(kDefaultBufferSize), useSplice(false)
+   {
+   }
+
+   static const std::size_t kDefaultBufferSize = 65536;
+
+   // bytes buffered in each direction. a direction doesn't read more
+   // from its source until everything buffered has been written to its
+   // destination, so a slow reader throttles the writer at the other end
+   // rather than causing data to pile up in the proxy
+   std::size_t bufferSize;
+
+   // move data between the sockets with splice(2) (linux only) so that
+   // it never has to be copied into user space. sockets without a native
+   // handle (e.g. ssl) always use buffered copying
+   bool useSplice;
+};
+
 class SocketProxy : public boost::enable_shared_from_this<SocketProxy>
 {
 public:
    static void create(boost::shared_ptr<core::http::Socket> ptrClient,
-                      boost::shared_ptr<core::http::Socket> ptrServer)
+                      boost::shared_ptr<core::http::Socket> ptrServer,
+                      const SocketProxyOptions& options = SocketProxyOptions())
    {
       boost::shared_ptr<SocketProxy> pProxy(new SocketProxy(ptrClient,
-                                                            ptrServer));
+                                                            ptrServer,
+                                                            options));
       pProxy->readClient();
       pProxy->readServer();
    }
 
+   // as above, but splices between the sockets if requested in options
+   // (the io_service is used to wait for the sockets to become ready)
+   static void create(boost::asio::io_service& ioService,
+                      boost::shared_ptr<core::http::Socket> ptrClient,
+                      boost::shared_ptr<core::http::Socket> ptrServer,
+                      const SocketProxyOptions& options);
+
 private:
    SocketProxy(boost::shared_ptr<core::http::Socket> ptrClient,
-               boost::shared_ptr<core::http::Socket> ptrServer)
-      : ptrClient_(ptrClient), ptrServer_(ptrServer)
+               boost::shared_ptr<core::http::Socket> ptrServer,
+               const SocketProxyOptions& options)
+      : ptrClient_(ptrClient),
+        ptrServer_(ptrServer),
+        clientBuffer_(std::max<std::size_t>(options.bufferSize, 1)),
+        serverBuffer_(std::max<std::size_t>(options.bufferSize, 1))
    {
    }
 
@@ -68,8 +104,8 @@ private:
 private:
    boost::shared_ptr<core::http::Socket> ptrClient_;
    boost::shared_ptr<core::http::Socket> ptrServer_;
-   boost::array<char, 8192> clientBuffer_;
-   boost::array<char, 8192> serverBuffer_;
+   std::vector<char> clientBuffer_;
+   std::vector<char> serverBuffer_;
    boost::mutex socketMutex_;
 };
 
@@ -32,9 +32,11 @@ class SslAsyncServer : public AsyncServerImpl<boost::asio::ip::tcp>
 public:
 
    SslAsyncServer(const std::string& serverName,
-                  const std::string& baseUri = std::string())
+                  const std::string& baseUri = std::string(),
+                  const KeepAliveOptions& keepAliveOptions = KeepAliveOptions())
       : AsyncServerImpl(serverName, baseUri)
    {
+      setKeepAliveOptions(keepAliveOptions);
    }
    
    Error init(const std::string& address,
@@ -73,7 +75,23 @@ public:
 
       setSslContext(context);
 
-      return initTcpIpAcceptor(acceptorService(), address, port);
+      Error error = initTcpIpAcceptor(acceptorService(),
+                                      address,
+                                      port,
+                                      ioServicePerThread());
+      if (error)
+         return error;
+
+      initAcceptorShards();
+      return Success();
+   }
+
+protected:
+   virtual Error initAdditionalAcceptor(
+            SocketAcceptorService<boost::asio::ip::tcp>& acceptorService)
+   {
+      // bind to the endpoint the primary acceptor resolved to
+      return initTcpIpAcceptor(acceptorService, localEndpoint(), true);
    }
 };
 
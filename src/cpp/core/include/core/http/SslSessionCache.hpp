@@ -0,0 +1,45 @@
+/*
+ * SslSessionCache.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_SSL_SESSION_CACHE_HPP
+#define CORE_HTTP_SSL_SESSION_CACHE_HPP
+
+#include <string>
+
+#include <openssl/ssl.h>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace ssl_session_cache {
+
+// The TLS sessions most recently established with each server (keyed by
+// "host:port"), shared by all clients in the process so that a connection
+// to a server which has been connected to before can resume its session
+// rather than performing a full handshake.
+
+// offer to resume the session last established with the server (if any);
+// call before the handshake
+void resumeSession(const std::string& server, SSL* pSsl);
+
+// remember the session established by the handshake for later connections
+void saveSession(const std::string& server, SSL* pSsl);
+
+} // namespace ssl_session_cache
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_SSL_SESSION_CACHE_HPP
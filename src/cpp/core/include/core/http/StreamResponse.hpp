@@ -0,0 +1,97 @@
+/*
+ * StreamResponse.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_STREAM_RESPONSE_HPP
+#define CORE_HTTP_STREAM_RESPONSE_HPP
+
+#include <stdint.h>
+#include <string>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+namespace http {
+
+// Produces the body of a response incrementally so that large content can
+// be written without buffering all of it in memory. The body is read from
+// a generator in fixed size chunks, optionally gzipped as it goes, and
+// framed using chunked transfer encoding (see ChunkParser).
+class StreamResponse : boost::noncopyable
+{
+public:
+   // sets pData to (at most) maxBytes of the next block of body data.
+   // an empty block indicates the end of the stream
+   typedef boost::function<Error(std::size_t maxBytes, std::string* pData)>
+                                                                  Generator;
+
+   static const std::size_t kDefaultChunkSize;
+
+   StreamResponse(const Generator& generator,
+                  bool gzip,
+                  std::size_t chunkSize = kDefaultChunkSize);
+
+   virtual ~StreamResponse();
+
+   static Error createFromFile(const FilePath& filePath,
+                               bool gzip,
+                               std::size_t chunkSize,
+                               boost::shared_ptr<StreamResponse>* pStream);
+
+   // stream length bytes of the file starting at offset (uncompressed,
+   // since byte ranges refer to the unencoded content)
+   static Error createFromFileRange(const FilePath& filePath,
+                                    uintmax_t offset,
+                                    uintmax_t length,
+                                    std::size_t chunkSize,
+                                    boost::shared_ptr<StreamResponse>* pStream);
+
+   // get the next chunk to write. once the generator is exhausted the
+   // terminating chunk is returned and complete() becomes true
+   Error nextChunk(std::string* pChunk);
+
+   bool complete() const { return complete_; }
+
+   bool gzip() const { return gzip_; }
+
+private:
+   Error nextBlock(std::string* pData);
+
+   Generator generator_;
+   bool gzip_;
+   std::size_t chunkSize_;
+   bool complete_;
+
+   // gzip compressor (writes into compressed_)
+   boost::shared_ptr<boost::iostreams::filtering_ostream> pCompressor_;
+   std::string compressed_;
+};
+
+// frame a block of data as a single chunk (an empty block yields
+// the terminating chunk)
+std::string formatChunk(const std::string& data);
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_STREAM_RESPONSE_HPP
@@ -48,6 +48,13 @@ public:
    {
    }
 
+#ifndef _WIN32
+   virtual int nativeHandle()
+   {
+      return socket_.native_handle();
+   }
+#endif
+
 protected:
 
    virtual boost::asio::ip::tcp::socket& socket()
@@ -20,13 +20,16 @@
 #error TcpIpAsyncClientSsl is not supported on Windows
 #endif
 
+#include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <boost/asio/ip/tcp.hpp>
 
 #include "BoostAsioSsl.hpp"
 
 #include <core/http/AsyncClient.hpp>
+#include <core/http/SslSessionCache.hpp>
 #include <core/http/TcpIpAsyncConnector.hpp>
 
 namespace rstudio {
@@ -37,6 +40,35 @@ class TcpIpAsyncClientSsl
    : public AsyncClient<boost::asio::ssl::stream<boost::asio::ip::tcp::socket> >
 {
 public:
+   // an ssl stream along with the context it was created with (which must
+   // outlive it), so that connections can be handed between clients
+   struct SslConnection : boost::noncopyable
+   {
+      SslConnection(boost::asio::io_service& ioService, bool verify)
+         : context(ioService, boost::asio::ssl::context::sslv23_client)
+      {
+         if (verify)
+         {
+            context.set_default_verify_paths();
+            context.set_verify_mode(boost::asio::ssl::context::verify_peer);
+         }
+         else
+         {
+            context.set_verify_mode(boost::asio::ssl::context::verify_none);
+         }
+
+         // use scoped ptr so we can call the constructor after we've
+         // configured the ssl::context (immediately above)
+         ptrStream.reset(new boost::asio::ssl::stream<boost::asio::ip::tcp::socket>(
+                                                         ioService, context));
+      }
+
+      boost::asio::ssl::context context;
+      boost::scoped_ptr<boost::asio::ssl::stream<boost::asio::ip::tcp::socket> > ptrStream;
+   };
+
+   typedef boost::shared_ptr<SslConnection> PersistentConnection;
+
    TcpIpAsyncClientSsl(boost::asio::io_service& ioService,
                        const std::string& address,
                        const std::string& port,
@@ -44,40 +76,78 @@ public:
                        const boost::posix_time::time_duration& connectionTimeout =
                           boost::posix_time::time_duration(boost::posix_time::pos_infin))
      : AsyncClient<boost::asio::ssl::stream<boost::asio::ip::tcp::socket> >(ioService),
-       sslContext_(ioService, boost::asio::ssl::context::sslv23_client),
+       pConnection_(new SslConnection(ioService, verify)),
        address_(address),
        port_(port),
        verify_(verify),
-       connectionTimeout_(connectionTimeout)
+       connectionTimeout_(connectionTimeout),
+       persistent_(false),
+       connected_(false),
+       reusable_(false)
    {
-      if (verify_)
-      {
-         sslContext_.set_default_verify_paths();
-         sslContext_.set_verify_mode(boost::asio::ssl::context::verify_peer);
-      }
-      else
+   }
+
+   // keep the connection open after the response so that it can be reused
+   // for subsequent requests to the same server. if an already established
+   // connection is provided (e.g. from a connection pool) it is used instead
+   // of connecting and handshaking anew. must be called prior to execute
+   void setPersistentConnection(
+                  const PersistentConnection& pConnection = PersistentConnection())
+   {
+      persistent_ = true;
+      if (pConnection && pConnection->ptrStream->lowest_layer().is_open())
       {
-         sslContext_.set_verify_mode(boost::asio::ssl::context::verify_none);
+         pConnection_ = pConnection;
+         connected_ = true;
       }
+   }
 
-      // use scoped ptr so we can call the constructor after we've configured
-      // the ssl::context (immediately above)
-      ptrSslStream_.reset(new boost::asio::ssl::stream<boost::asio::ip::tcp::socket>(ioService, sslContext_));
+   // was this request executed over a previously established connection
+   bool reusedConnection() const
+   {
+      return connected_;
    }
 
+   // take ownership of the underlying connection once the response has been
+   // received. returns an empty pointer if the connection cannot be reused
+   // (e.g. the server indicated it would close the connection)
+   PersistentConnection releaseConnection()
+   {
+      if (!reusable_)
+         return PersistentConnection();
+
+      // sessions may be issued after the handshake (as with tls 1.3) so
+      // remember the session again now that the exchange is complete
+      ssl_session_cache::saveSession(server(),
+                                     pConnection_->ptrStream->native_handle());
+
+      // leave an unopened connection in place so that subsequent
+      // operations on this client are harmless no-ops
+      PersistentConnection pConnection = pConnection_;
+      pConnection_.reset(new SslConnection(ioService(), verify_));
+      reusable_ = false;
+      return pConnection;
+   }
 
 protected:
 
    virtual boost::asio::ssl::stream<boost::asio::ip::tcp::socket>& socket()
    {
-      return *(ptrSslStream_);
+      return *(pConnection_->ptrStream);
    }
 
    virtual void connectAndWriteRequest()
    {
+      // write directly on an already established connection
+      if (connected_)
+      {
+         writeRequest();
+         return;
+      }
+
       boost::shared_ptr<TcpIpAsyncConnector> pAsyncConnector(
                   new TcpIpAsyncConnector(ioService(),
-                                          &(ptrSslStream_->next_layer())));
+                                          &(pConnection_->ptrStream->next_layer())));
 
       pAsyncConnector->connect(
             address_,
@@ -93,14 +163,63 @@ protected:
 
 private:
 
+   std::string server() const
+   {
+      return address_ + ":" + port_;
+   }
+
+   virtual bool requestKeepAlive()
+   {
+      return persistent_;
+   }
+
+   virtual bool stopReadingAndRespond()
+   {
+      if (!persistent_)
+         return false;
+
+      // with a persistent connection the server won't close the socket to
+      // signal the end of the response, so rely on the content length (or
+      // on the response being one which never has a body)
+      int status = response_.statusCode();
+      bool noBody = request().method() == "HEAD" ||
+                    status == status::NoContent ||
+                    status == status::NotModified ||
+                    (status >= 100 && status < 200);
+      if (!noBody)
+      {
+         if (response_.headerValue("Content-Length").empty())
+            return false;
+
+         if (response_.body().length() < response_.contentLength())
+            return false;
+      }
+
+      reusable_ = !boost::algorithm::iequals(
+                     response_.headerValue("Connection"), "close");
+      return true;
+   }
+
+   virtual bool keepConnectionAlive()
+   {
+      return reusable_;
+   }
+
    void performHandshake()
    {
+      boost::asio::ssl::stream<boost::asio::ip::tcp::socket>& stream =
+                                                      *(pConnection_->ptrStream);
       if (verify_)
       {
-         ptrSslStream_->set_verify_callback(
+         stream.set_verify_callback(
                             boost::asio::ssl::rfc2818_verification(address_));
       }
-      ptrSslStream_->async_handshake(
+
+      // offer the session from an earlier connection to the server so that
+      // the server can skip the full handshake
+      ssl_session_cache::resumeSession(server(), stream.native_handle());
+
+      stream.async_handshake(
             boost::asio::ssl::stream_base::client,
             boost::bind(&TcpIpAsyncClientSsl::handleHandshake,
                         sharedFromThis(),
@@ -114,6 +233,8 @@ private:
          if (!ec)
          {
             // finished handshake, commence with request
+            ssl_session_cache::saveSession(
+                        server(), pConnection_->ptrStream->native_handle());
             writeRequest();
          }
          else
@@ -138,12 +259,14 @@ private:
    }
 
 private:
-   boost::asio::ssl::context sslContext_;
-   boost::scoped_ptr<boost::asio::ssl::stream<boost::asio::ip::tcp::socket> > ptrSslStream_;
+   PersistentConnection pConnection_;
    std::string address_;
    std::string port_;
    bool verify_;
    boost::posix_time::time_duration connectionTimeout_;
+   bool persistent_;
+   bool connected_;
+   bool reusable_;
 };
    
 
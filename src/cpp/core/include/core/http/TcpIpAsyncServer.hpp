@@ -29,15 +29,33 @@ class TcpIpAsyncServer : public AsyncServerImpl<boost::asio::ip::tcp>
 {
 public:
    TcpIpAsyncServer(const std::string& serverName,
-                    const std::string& baseUri = std::string())
+                    const std::string& baseUri = std::string(),
+                    const KeepAliveOptions& keepAliveOptions = KeepAliveOptions())
       : AsyncServerImpl<boost::asio::ip::tcp>(serverName, baseUri)
    {
+      setKeepAliveOptions(keepAliveOptions);
    }
    
 public:
    Error init(const std::string& address, const std::string& port)
    {
-      return initTcpIpAcceptor(acceptorService(), address, port);
+      Error error = initTcpIpAcceptor(acceptorService(),
+                                      address,
+                                      port,
+                                      ioServicePerThread());
+      if (error)
+         return error;
+
+      initAcceptorShards();
+      return Success();
+   }
+
+protected:
+   virtual Error initAdditionalAcceptor(
+            SocketAcceptorService<boost::asio::ip::tcp>& acceptorService)
+   {
+      // bind to the endpoint the primary acceptor resolved to
+      return initTcpIpAcceptor(acceptorService, localEndpoint(), true);
    }
 };
 
@@ -69,23 +69,18 @@ Error connect(boost::asio::io_service& ioService,
 }
                      
 
+// open, bind, and listen on the given endpoint. pass reusePort to allow
+// other acceptors to bind to the same endpoint (the kernel then balances
+// incoming connections between them)
 inline Error initTcpIpAcceptor(
             SocketAcceptorService<boost::asio::ip::tcp>& acceptorService,
-            const std::string& address,
-            const std::string& port)
+            const boost::asio::ip::tcp::endpoint& endpoint,
+            bool reusePort = false)
 {
    using boost::asio::ip::tcp;
-   
-   tcp::resolver resolver(acceptorService.ioService()) ;
-   tcp::resolver::query query(address, port) ;
-   
+
    boost::system::error_code ec ;
-   tcp::resolver::iterator entries = resolver.resolve(query,ec) ;
-   if (ec)
-      return Error(ec, ERROR_LOCATION) ;
-   
    tcp::acceptor& acceptor = acceptorService.acceptor();
-   const tcp::endpoint& endpoint = *entries ;
    acceptor.open(endpoint.protocol(), ec) ;
    if (ec)
       return Error(ec, ERROR_LOCATION) ;
@@ -93,6 +88,21 @@ inline Error initTcpIpAcceptor(
    acceptor.set_option(tcp::acceptor::reuse_address(true), ec) ;
    if (ec)
       return Error(ec, ERROR_LOCATION) ;
+
+   if (reusePort)
+   {
+#ifdef SO_REUSEPORT
+      typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET,
+                                                          SO_REUSEPORT>
+                                                          reuse_port;
+      acceptor.set_option(reuse_port(true), ec) ;
+      if (ec)
+         return Error(ec, ERROR_LOCATION) ;
+#else
+      return systemError(boost::system::errc::operation_not_supported,
+                         ERROR_LOCATION);
+#endif
+   }
    
    acceptor.set_option(tcp::no_delay(true), ec) ;
    if (ec)
@@ -108,6 +118,25 @@ inline Error initTcpIpAcceptor(
    
    return Success() ;
 }
+
+inline Error initTcpIpAcceptor(
+            SocketAcceptorService<boost::asio::ip::tcp>& acceptorService,
+            const std::string& address,
+            const std::string& port,
+            bool reusePort = false)
+{
+   using boost::asio::ip::tcp;
+   
+   tcp::resolver resolver(acceptorService.ioService()) ;
+   tcp::resolver::query query(address, port) ;
+   
+   boost::system::error_code ec ;
+   tcp::resolver::iterator entries = resolver.resolve(query,ec) ;
+   if (ec)
+      return Error(ec, ERROR_LOCATION) ;
+   
+   return initTcpIpAcceptor(acceptorService, *entries, reusePort);
+}
    
 } // namespace http
 } // namespace core
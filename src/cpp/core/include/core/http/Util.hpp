@@ -16,6 +16,7 @@
 #ifndef CORE_HTTP_UTIL_HPP
 #define CORE_HTTP_UTIL_HPP
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <map>
@@ -56,10 +57,16 @@ private:
    
 struct File
 {
+   File() : size(0) {}
    bool empty() const { return name.empty(); }
    std::string name;
    std::string contentType;
    std::string contents;   
+
+   // files streamed to disk (see MultipartFormStream) have an empty contents
+   // and the path they were written to (empty if they weren't kept)
+   std::string path;
+   uintmax_t size;
 };
 
 typedef std::map<std::string,File> Files;
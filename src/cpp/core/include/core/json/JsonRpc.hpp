@@ -1129,8 +1129,14 @@ public:
       setField(kRpcResult, result);
    }
 
+   // set the result from JSON text produced with a json::Writer (for
+   // results too large to want to build as a json::Value). the text is
+   // written into the response as is.
+   void setResultJson(const std::string& json);
+
    json::Value& result()
    {
+      parseResultJson();
       return response_[kRpcResult];
    }
 
@@ -1153,6 +1159,8 @@ public:
 
    void setField(const std::string& name, const json::Value& value) 
    { 
+      if (name == kRpcResult)
+         resultJson_.clear();
       response_[name] = value;
    }             
                 
@@ -1173,6 +1181,7 @@ public:
    void setResponse(const json::Object& response)
    {
       response_ = response;
+      resultJson_.clear();
    }
    
    // specify a function to run after the response
@@ -1196,8 +1205,12 @@ public:
    static bool parse(const json::Value& value,
                      JsonRpcResponse* pResponse);
    
+private:
+   void parseResultJson();
+
 private:
    json::Object response_;
+   std::string resultJson_;
    boost::function<void()> afterResponse_ ;
    bool suppressDetectChanges_;
 };
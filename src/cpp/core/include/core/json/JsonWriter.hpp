@@ -0,0 +1,118 @@
+/*
+ * JsonWriter.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_JSON_WRITER_HPP
+#define CORE_JSON_WRITER_HPP
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+
+#include <core/json/Json.hpp>
+
+namespace rstudio {
+namespace core {
+namespace json {
+
+// Writes a JSON document as it is produced, for results too large to want
+// to build as a json::Value first. Containers are opened and closed with
+// explicit calls and the separators between their elements are written as
+// needed, e.g.
+//
+//    writer.startObject();
+//    writer.key("files");
+//    writer.startArray();
+//    ... writer.value(...) for each file
+//    writer.endArray();
+//    writer.endObject();
+//
+// Callers are responsible for balancing the calls and for giving each
+// object member a key. The output is compact, formatted as json::write
+// would format the same document.
+class Writer : boost::noncopyable
+{
+public:
+   // write into the string (appending to it)
+   explicit Writer(std::string* pOutput);
+
+   // write to the stream (buffered; flushed in blocks, on flush, and when
+   // the writer is destroyed)
+   explicit Writer(std::ostream& os);
+
+   ~Writer();
+
+public:
+   void startObject();
+   void endObject();
+   void startArray();
+   void endArray();
+
+   // the name of the next object member
+   void key(const std::string& name);
+
+   void null();
+   void value(bool value);
+   void value(int value);
+   void value(unsigned int value);
+   void value(boost::int64_t value);
+   void value(boost::uint64_t value);
+   void value(double value);
+   void value(const char* value);
+   void value(const std::string& value);
+
+   // a value (of any size) built the usual way
+   void value(const Value& value);
+
+   // a complete JSON text produced elsewhere (e.g. by another writer)
+   void rawValue(const std::string& json);
+
+   // convenience for an object member
+   template <typename T>
+   void member(const std::string& name, const T& memberValue)
+   {
+      key(name);
+      value(memberValue);
+   }
+
+   // whether every container opened has been closed
+   bool complete() const { return containers_.empty(); }
+
+   void flush();
+
+private:
+   void beforeValue();
+   void afterValue();
+
+   void startContainer(char open);
+   void endContainer(char close);
+
+private:
+   std::string* pOutput_;
+   std::ostream* pStream_;
+   std::string buffer_;
+
+   // for each open container, whether an element has been written to it
+   std::vector<bool> containers_;
+   bool afterKey_;
+};
+
+} // namespace json
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_JSON_WRITER_HPP
@@ -56,6 +56,10 @@ namespace json_spirit
 
         Value_impl& operator=( const Value_impl& lhs );
 
+        // exchange contents without copying (e.g. to place a value built
+        // elsewhere into a container)
+        void swap( Value_impl& other );
+
         Value_type type() const;
 
         bool is_uint64() const;
@@ -308,6 +312,14 @@ namespace json_spirit
         return *this;
     }
 
+    template< class Config >
+    void Value_impl< Config >::swap( Value_impl& other )
+    {
+        std::swap( type_, other.type_ );
+        v_.swap( other.v_ );
+        std::swap( is_uint64_, other.is_uint64_ );
+    }
+
     template< class Config >
     bool Value_impl< Config >::operator==( const Value_impl& lhs ) const
     {
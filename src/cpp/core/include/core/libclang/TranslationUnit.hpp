@@ -82,6 +82,9 @@ public:
                                       unsigned line,
                                       unsigned column) const;
 
+   // bytes of memory libclang holds for the translation unit
+   std::size_t memoryUsage() const;
+
    void printResourceUsage(std::ostream& ostr, bool detailed = false) const;
 
 private:
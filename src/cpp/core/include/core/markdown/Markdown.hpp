@@ -16,8 +16,11 @@
 #ifndef CORE_MARKDOWN_MARKDOWN_HPP
 #define CORE_MARKDOWN_MARKDOWN_HPP
 
+#include <map>
 #include <string>
 
+#include <boost/noncopyable.hpp>
+
 namespace rstudio {
 namespace core {
 
@@ -83,6 +86,39 @@ struct HTMLOptions
    bool escape;
 };
 
+// HTML rendered for each of the top-level blocks (paragraphs, lists, code
+// blocks, etc.) of a document, so that re-rendering the document after an
+// edit only renders the blocks which changed. The cache holds the blocks of
+// the most recent render only.
+class BlockCache : boost::noncopyable
+{
+public:
+   BlockCache() : renderedCount_(0) {}
+
+   // COPYING: prohibited
+
+   // the number of blocks in the cache
+   std::size_t size() const { return blocks_.size(); }
+
+   // the number of blocks the last render had to render (rather than reuse)
+   std::size_t renderedCount() const { return renderedCount_; }
+
+   void clear();
+
+   // used by markdownToHTML: blocks which aren't looked up or added between
+   // startRender and finishRender are dropped when it finishes
+   void startRender(const std::string& optionsKey);
+   bool lookup(const std::string& block, std::string* pHTML);
+   void add(const std::string& block, const std::string& html);
+   void finishRender();
+
+private:
+   std::string optionsKey_;
+   std::map<std::string, std::string> blocks_;
+   std::map<std::string, std::string> currentBlocks_;
+   std::size_t renderedCount_;
+};
+
 // render markdown to HTML -- assumes UTF-8 encoding
 Error markdownToHTML(const FilePath& markdownFile,
                      const Extensions& extensions,
@@ -101,6 +137,16 @@ Error markdownToHTML(const std::string& markdownInput,
                      const HTMLOptions& htmlOptions,
                      std::string* pHTMLOutput);
 
+// render markdown to HTML, reusing the HTML of blocks which are unchanged
+// since the last render with the cache. documents whose blocks can't be
+// rendered independently (those with a table of contents, link reference
+// definitions or raw HTML blocks) are rendered as a whole.
+Error markdownToHTML(const std::string& markdownInput,
+                     const Extensions& extensions,
+                     const HTMLOptions& htmlOptions,
+                     BlockCache* pCache,
+                     std::string* pHTMLOutput);
+
 
 bool isMathJaxRequired(const std::string& htmlOutput);
 
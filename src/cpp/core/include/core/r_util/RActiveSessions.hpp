@@ -17,6 +17,8 @@
 #ifndef CORE_R_UTIL_ACTIVE_SESSIONS_HPP
 #define CORE_R_UTIL_ACTIVE_SESSIONS_HPP
 
+#include <map>
+
 #include <boost/noncopyable.hpp>
 
 #include <core/Error.hpp>
@@ -37,14 +39,15 @@ class ActiveSession : boost::noncopyable
 {
 private:
    friend class ActiveSessions;
-   ActiveSession() {}
+   ActiveSession() : hasSnapshot_(false) {}
 
-   explicit ActiveSession(const std::string& id) : id_(id) 
+   explicit ActiveSession(const std::string& id)
+      : id_(id), hasSnapshot_(false)
    {
    }
 
    explicit ActiveSession(const std::string& id, const FilePath& scratchPath)
-      : id_(id), scratchPath_(scratchPath)
+      : id_(id), scratchPath_(scratchPath), hasSnapshot_(false)
    {
       core::Error error = scratchPath_.ensureDirectory();
       if (error)
@@ -340,10 +343,21 @@ private:
    void writeProperty(const std::string& name, const std::string& value) const;
    std::string readProperty(const std::string& name) const;
 
+   // snapshot the properties (e.g. from the session index) so that they're
+   // read at most once; used for the sessions returned by ActiveSessions::list
+   void setSnapshot(const std::map<std::string,std::string>& properties) const;
+   const std::map<std::string,std::string>& snapshot() const
+   {
+      return snapshot_;
+   }
+
 private:
    std::string id_;
    FilePath scratchPath_;
    FilePath propertiesPath_;
+
+   mutable bool hasSnapshot_;
+   mutable std::map<std::string,std::string> snapshot_;
 };
 
 
@@ -41,6 +41,8 @@ public:
    // COPYING: via compiler
 
 public:
+   // read the package's DESCRIPTION file (the fields read are cached, and
+   // shared by all readers, until the file changes)
    Error read(const FilePath& packageDir);
 
    bool empty() const { return name().empty(); }
@@ -57,6 +59,7 @@ public:
    std::string sourcePackageFilename() const;
 
 private:
+   Error readDescription(const FilePath& descFilePath);
    std::string packageFilename(const std::string& extension) const;
 
 private:
@@ -28,6 +28,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 
 #include <core/Algorithm.hpp>
+#include <core/InternedString.hpp>
 #include <core/SafeConvert.hpp>
 #include <core/StringUtils.hpp>
 #include <core/RegexUtils.hpp>
@@ -54,12 +55,12 @@ public:
 
    // COPYING: via compiler / concrete-type
 
-   const std::string& name() const { return name_; }
-   const std::string& type() const { return type_; }
+   const std::string& name() const { return name_.str(); }
+   const std::string& type() const { return type_.str(); }
 
 private:
-   std::string name_;
-   std::string type_;
+   InternedString name_;
+   InternedString type_;
 };
 
 
@@ -100,9 +101,9 @@ public:
    // COPYING: via compiler (copyable members)
 
 private:
-   RSourceItem(const std::string& context,
+   RSourceItem(const InternedString& context,
                int type,
-               const std::string& name,
+               const InternedString& name,
                const std::vector<RS4MethodParam>& signature,
                int braceLevel,
                std::size_t line,
@@ -124,8 +125,9 @@ public:
    bool isMethod() const { return type_ == Method; }
    bool isClass() const { return type_ == Class; }
    bool isVariable() const { return type_ == Variable; }
-   const std::string& context() const { return context_; }
-   const std::string& name() const { return name_; }
+   const std::string& context() const { return context_.str(); }
+   const std::string& name() const { return name_.str(); }
+   const InternedString& internedName() const { return name_; }
    const std::vector<RS4MethodParam>& signature() const { return signature_; }
    const int braceLevel() const { return braceLevel_; }
    int line() const { return core::safe_convert::numberTo<std::size_t, int>(line_,0); }
@@ -136,32 +138,32 @@ public:
    bool nameStartsWith(const std::string& term, bool caseSensitive) const
    {
       if (caseSensitive)
-         return boost::algorithm::starts_with(name_, term);
+         return boost::algorithm::starts_with(name_.str(), term);
       else
-         return boost::algorithm::istarts_with(name_, term);
+         return boost::algorithm::istarts_with(name_.str(), term);
    }
 
    bool nameIsSubsequence(const std::string& term, bool caseSensitive) const
    {
-      return string_utils::isSubsequence(name_, term, !caseSensitive);
+      return string_utils::isSubsequence(name_.str(), term, !caseSensitive);
    }
 
    bool nameContains(const std::string& term, bool caseSensitive) const
    {
       if (caseSensitive)
-         return boost::algorithm::contains(name_, term);
+         return boost::algorithm::contains(name_.str(), term);
       else
-         return boost::algorithm::icontains(name_, term);
+         return boost::algorithm::icontains(name_.str(), term);
    }
 
    bool nameMatches(const boost::regex& regex,
                     bool prefixOnly,
                     bool caseSensitive) const
    {
-      return regex_utils::textMatches(name_, regex, prefixOnly, caseSensitive);
+      return regex_utils::textMatches(name_.str(), regex, prefixOnly, caseSensitive);
    }
 
-   RSourceItem withContext(const std::string& context) const
+   RSourceItem withContext(const InternedString& context) const
    {
       return RSourceItem(context,
                          type_,
@@ -173,9 +175,9 @@ public:
    }
 
 private:
-   std::string context_;
+   InternedString context_;
    int type_;
-   std::string name_;
+   InternedString name_;
    std::vector<RS4MethodParam> signature_;
    int braceLevel_;
    std::size_t line_;
@@ -196,7 +198,14 @@ public:
    RSourceIndex(const std::string& context,
                 const std::string& code);
 
-   const std::string& context() const { return context_; }
+   // create an empty index (e.g. to be populated from a cache)
+   explicit RSourceIndex(const std::string& context)
+      : context_(context)
+   {
+   }
+
+   const std::string& context() const { return context_.str(); }
+   const InternedString& internedContext() const { return context_; }
 
    template <typename OutputIterator>
    OutputIterator search(
@@ -210,7 +219,9 @@ public:
                 items_.end(),
                 out,
                 predicate,
-                boost::bind(&RSourceItem::withContext, _1, newContext));
+                boost::bind(&RSourceItem::withContext,
+                            _1,
+                            InternedString(newContext)));
 
       // return the output iterator
       return out;
@@ -221,7 +232,7 @@ public:
                   const boost::function<bool(const RSourceItem&)> predicate,
                   OutputIterator out) const
    {
-      return search(context_, predicate, out);
+      return search(context_.str(), predicate, out);
    }
 
    template <typename OutputIterator>
@@ -266,7 +277,7 @@ public:
                          bool caseSensitive,
                          OutputIterator out) const
    {
-      return search(term, context_, prefixOnly, caseSensitive, out);
+      return search(term, context_.str(), prefixOnly, caseSensitive, out);
    }
    
 private:
@@ -416,8 +427,25 @@ public:
       return items_;
    }
 
+   // approximate bytes held by the index (not including the interned names
+   // of its items, which are held by the string pool)
+   std::size_t memoryUsage() const
+   {
+      std::size_t bytes = sizeof(RSourceIndex) +
+                          items_.capacity() * sizeof(RSourceItem);
+      BOOST_FOREACH(const RSourceItem& item, items_)
+      {
+         bytes += item.signature().capacity() * sizeof(RS4MethodParam);
+      }
+      BOOST_FOREACH(const std::string& pkgName, inferredPkgNames_)
+      {
+         bytes += sizeof(std::string) + pkgName.capacity();
+      }
+      return bytes;
+   }
+
 private:
-   std::string context_;
+   InternedString context_;
    std::vector<RSourceItem> items_;
    
    // private fields related to the current set of library completions
@@ -0,0 +1,85 @@
+/*
+ * RSourceIndexCache.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_R_UTIL_R_SOURCE_INDEX_CACHE_HPP
+#define CORE_R_UTIL_R_SOURCE_INDEX_CACHE_HPP
+
+#include <ctime>
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+namespace r_util {
+
+class RSourceIndex;
+
+// Source indexes keyed by the path, modification time and size of the file
+// they were built from, which can be written to disk so that indexes for
+// unchanged files needn't be rebuilt in a new session. The content hash
+// (hash::crc32cHexHash) of each file is recorded too, so that files whose
+// modification time changed without their contents changing (e.g. after a
+// checkout) needn't be re-indexed either.
+class RSourceIndexCache
+{
+public:
+   void add(const std::string& path,
+            std::time_t lastWriteTime,
+            boost::uintmax_t size,
+            const std::string& hash,
+            boost::shared_ptr<RSourceIndex> pIndex);
+
+   // get the index for a file if it is current (otherwise returns null). if
+   // only the modification time differs the file is hashed to check its
+   // contents. the recorded hash is returned in pHash
+   boost::shared_ptr<RSourceIndex> get(const std::string& path,
+                                       std::time_t lastWriteTime,
+                                       boost::uintmax_t size,
+                                       std::string* pHash = NULL) const;
+
+   bool empty() const { return entries_.empty(); }
+   std::size_t size() const { return entries_.size(); }
+   void clear() { entries_.clear(); }
+
+   core::Error writeToFile(const core::FilePath& filePath) const;
+
+   // read a cache written by writeToFile (returns an error, leaving the
+   // cache empty, if it is missing or invalid)
+   core::Error readFromFile(const core::FilePath& filePath);
+
+private:
+   struct Entry
+   {
+      std::time_t lastWriteTime;
+      boost::uintmax_t size;
+      std::string hash;
+      boost::shared_ptr<RSourceIndex> pIndex;
+   };
+
+   boost::unordered_map<std::string, Entry> entries_;
+};
+
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_R_UTIL_R_SOURCE_INDEX_CACHE_HPP
@@ -0,0 +1,93 @@
+/*
+ * RSourceSymbolIndex.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_R_UTIL_R_SOURCE_SYMBOL_INDEX_HPP
+#define CORE_R_UTIL_R_SOURCE_SYMBOL_INDEX_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <core/r_util/RSourceIndex.hpp>
+
+namespace rstudio {
+namespace core {
+namespace r_util {
+
+// Symbols from a set of source indexes (one per file), indexed by name for
+// exact lookups and by lower case name for prefix (completion) searches.
+class RSourceSymbolIndex : boost::noncopyable
+{
+public:
+   struct Symbol
+   {
+      Symbol(boost::shared_ptr<RSourceIndex> pIndex, std::size_t item)
+         : pIndex(pIndex), item(item)
+      {
+      }
+
+      const RSourceItem& sourceItem() const { return pIndex->items()[item]; }
+      const std::string& context() const { return pIndex->context(); }
+      const InternedString& internedContext() const
+      {
+         return pIndex->internedContext();
+      }
+
+      boost::shared_ptr<RSourceIndex> pIndex;
+      std::size_t item;
+   };
+
+   typedef boost::function<bool(const Symbol&)> SymbolVisitor;
+
+public:
+   RSourceSymbolIndex() {}
+
+   // add the symbols for a file (replacing any previously added for it)
+   void add(const std::string& path, boost::shared_ptr<RSourceIndex> pIndex);
+
+   // remove the symbols for a file (or for all files within a directory)
+   void remove(const std::string& path);
+
+   void clear();
+
+   bool empty() const { return indexes_.empty(); }
+
+   // symbols named exactly name
+   const std::vector<Symbol>& find(const std::string& name) const;
+
+   // visit symbols whose names start with prefix (ignoring case) in order
+   // of name, stopping when the visitor returns false
+   void visitPrefix(const std::string& prefix,
+                    const SymbolVisitor& visitor) const;
+
+private:
+   void removeSymbols(boost::shared_ptr<RSourceIndex> pIndex);
+
+private:
+   std::map<std::string, boost::shared_ptr<RSourceIndex> > indexes_;
+   boost::unordered_map<InternedString, std::vector<Symbol> > symbolsByName_;
+   std::multimap<std::string, Symbol> symbolsByLowerName_;
+};
+
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_R_UTIL_R_SOURCE_SYMBOL_INDEX_HPP
@@ -27,6 +27,7 @@
 #include <core/StringUtils.hpp>
 #include <core/collection/Position.hpp>
 
+#include <boost/cstdint.hpp>
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/regex.hpp>
@@ -77,6 +78,36 @@ public:
       COMMENT
    };
 
+   // The operators and keywords which the token_utils predicates test for,
+   // identified when tokenizing so the predicates needn't compare content
+   enum TokenSubtype {
+      NO_SUBTYPE,
+
+      // OPER
+      ASSIGN_EQUALS,        // =
+      ASSIGN_LEFT,          // <-
+      ASSIGN_LEFT_PARENT,   // <<-
+      ASSIGN_COLON_EQUALS,  // :=
+      ASSIGN_RIGHT,         // ->
+      ASSIGN_RIGHT_PARENT,  // ->>
+      DOLLAR,               // $
+      AT,                   // @
+      NAMESPACE_EXPORTS,    // ::
+      NAMESPACE_ALL,        // :::
+      NOT,                  // !
+      MINUS,                // -
+      PLUS,                 // +
+      HELP,                 // ?
+      FORMULA,              // ~
+
+      // UOPER
+      PIPE,                 // e.g. %>%, %<>%, %T>%
+
+      // ID
+      KEYWORD_FUNCTION,     // function
+      KEYWORD_NA            // NA, NA_character_, NA_complex_, ...
+   };
+
 public:
 
    RToken() = default;
@@ -86,14 +117,16 @@ public:
           std::wstring::const_iterator end,
           std::size_t offset,
           std::size_t row,
-          std::size_t column)
-      : type_(type), begin_(begin), end_(end),
+          std::size_t column,
+          TokenSubtype subtype = NO_SUBTYPE)
+      : type_(type), subtype_(subtype), begin_(begin), end_(end),
         offset_(offset), row_(row), column_(column)
    {
    }
    
    // accessors
    TokenType type() const { return type_; }
+   TokenSubtype subtype() const { return subtype_; }
    std::wstring content() const { return std::wstring(begin_, end_); }
    const std::string& contentAsUtf8() const;
    std::size_t offset() const { return offset_; }
@@ -177,15 +210,54 @@ public:
    }
 
 private:
-   std::wstring emptyToken_;
+   // null tokens refer to a shared empty string rather than holding one
+   static const std::wstring& emptyToken();
+
    TokenType type_ = TokenType::ERR;
-   std::wstring::const_iterator begin_ = emptyToken_.cbegin();
-   std::wstring::const_iterator end_ = emptyToken_.cend();
+   TokenSubtype subtype_ = TokenSubtype::NO_SUBTYPE;
+   std::wstring::const_iterator begin_ = emptyToken().cbegin();
+   std::wstring::const_iterator end_ = emptyToken().cend();
    std::size_t offset_ = -1;
    std::size_t row_ = 0;
    std::size_t column_ = 0;
 };
 
+// A token as produced by RUtf8Tokenizer. Rather than iterators into the
+// source, it records where the token lies in the code: the offset and length
+// are in bytes of the UTF-8 source, while the row and column (as for RToken)
+// count characters.
+struct RCompactToken
+{
+   RToken::TokenType type;
+   RToken::TokenSubtype subtype;
+   boost::uint32_t offset;
+   boost::uint32_t length;
+   boost::uint32_t row;
+   boost::uint32_t column;
+
+   bool isType(RToken::TokenType tokenType) const
+   {
+      return type == tokenType;
+   }
+
+   core::collection::Position position() const
+   {
+      return core::collection::Position(row, column);
+   }
+};
+
+// The position of a tokenizer within its source (offset is in code units,
+// i.e. wide characters or UTF-8 bytes)
+struct RTokenizerState
+{
+   RTokenizerState() : offset(0), row(0), column(0) {}
+
+   std::size_t offset;
+   std::size_t row;
+   std::size_t column;
+   std::vector<char> braceStack; // needed for tokenization of `[[`, `[`
+};
+
 // Tokenize R code. Note that the RToken instances which are returned are
 // valid only during the lifetime of the RTokenizer which yielded them
 // (because they store iterators into their content rather than making a copy
@@ -194,12 +266,7 @@ class RTokenizer : boost::noncopyable
 {
 public:
    explicit RTokenizer(const std::wstring& data)
-      : data_(data),
-        begin_(data_.begin()),
-        end_(data_.end()),
-        pos_(data_.begin()),
-        row_(0),
-        column_(0)
+      : data_(data)
    {
    }
 
@@ -209,33 +276,41 @@ public:
 
    RToken nextToken();
 
-private:
-   RToken matchWhitespace();
-   RToken matchStringLiteral();
-   RToken matchNumber();
-   RToken matchIdentifier();
-   RToken matchQuotedIdentifier();
-   RToken matchComment();
-   RToken matchUserOperator();
-   RToken matchOperator();
-   bool eol();
-   wchar_t peek();
-   wchar_t peek(std::size_t lookahead);
-   wchar_t eat();
-   std::size_t tokenLength(const boost::wregex& regex);
-   void eatUntil(const boost::wregex& regex);
-   RToken consumeToken(RToken::TokenType tokenType, std::size_t length);
-   
 private:
    std::wstring data_;
-   std::wstring::const_iterator begin_;
-   std::wstring::const_iterator end_;
-   std::wstring::const_iterator pos_;
-   std::size_t row_;
-   std::size_t column_;
-   std::vector<char> braceStack_; // needed for tokenization of `[[`, `[`
+   RTokenizerState state_;
 };
 
+// Tokenize UTF-8 encoded R code, without first converting it to a wide
+// string. Tokens are the same as those RTokenizer gives for the equivalent
+// wide string, but are returned as RCompactTokens.
+class RUtf8Tokenizer : boost::noncopyable
+{
+public:
+   explicit RUtf8Tokenizer(const std::string& code)
+      : code_(code)
+   {
+   }
+
+   // COPYING: boost::noncopyable
+
+   // returns false when there are no more tokens
+   bool nextToken(RCompactToken* pToken);
+
+   // replace the code, resuming tokenization from the given state
+   void reset(const std::string& code, const RTokenizerState& state)
+   {
+      code_ = code;
+      state_ = state;
+   }
+
+   const std::string& code() const { return code_; }
+   const RTokenizerState& state() const { return state_; }
+
+private:
+   std::string code_;
+   RTokenizerState state_;
+};
 
 // Set of RTokens. Note that the RTokens returned from the set
 // are conceptually iterators so are only valid for the lifetime of
@@ -309,11 +384,68 @@ private:
     RToken dummyToken_;
 };
 
+// Set of RCompactTokens tokenized from UTF-8 code; the tokens are stored
+// contiguously and refer to the code (owned by the set) by offset.
+class RCompactTokens
+{
+   typedef std::vector<RCompactToken> Tokens;
+
+public:
+
+   explicit RCompactTokens(const std::string& code,
+                           int flags = RTokens::None)
+      : tokenizer_(code),
+        flags_(flags)
+   {
+      tokenize();
+   }
+
+   // Update the tokens for edited code. Tokens before the edit are kept, and
+   // the code is tokenized again from the start of the last line (outside
+   // of any brackets) which begins before the edit.
+   void update(const std::string& code);
+
+   std::size_t size() const { return tokens_.size(); }
+   bool empty() const { return tokens_.empty(); }
+
+   const RCompactToken& at(std::size_t offset) const
+   {
+      return tokens_.at(offset);
+   }
+
+   typedef Tokens::const_iterator const_iterator;
+   const_iterator begin() const { return tokens_.begin(); }
+   const_iterator end() const { return tokens_.end(); }
+
+   const std::string& code() const { return tokenizer_.code(); }
+
+   std::string content(const RCompactToken& token) const
+   {
+      return code().substr(token.offset, token.length);
+   }
+
+   bool contentEquals(const RCompactToken& token, const std::string& text) const
+   {
+      return token.length == text.size() &&
+             code().compare(token.offset, token.length, text) == 0;
+   }
+
+private:
+   void tokenize();
+
+   RUtf8Tokenizer tokenizer_;
+   int flags_;
+   Tokens tokens_;
+
+   // indices of the tokens from which tokenization can resume
+   std::vector<std::size_t> resumePoints_;
+};
+
 namespace token_utils {
 
 inline bool isBinaryOp(const RToken& token)
 {
-   if (token.contentEquals(L'!'))
+   if (token.subtype() == RToken::NOT)
       return false;
    
    return token.isType(RToken::OPER) ||
@@ -322,43 +454,35 @@ inline bool isBinaryOp(const RToken& token)
 
 inline bool isLocalLeftAssign(const RToken& token)
 {
-   return token.isType(RToken::OPER) && (
-            token.contentEquals(L"=") ||
-            token.contentEquals(L"<-") ||
-            token.contentEquals(L":="));
+   RToken::TokenSubtype subtype = token.subtype();
+   return subtype == RToken::ASSIGN_EQUALS ||
+          subtype == RToken::ASSIGN_LEFT ||
+          subtype == RToken::ASSIGN_COLON_EQUALS;
 }
 
 inline bool isLocalRightAssign(const RToken& token)
 {
-   return token.isType(RToken::OPER) && token.contentEquals(L"->");
+   return token.subtype() == RToken::ASSIGN_RIGHT;
 }
 
 inline bool isParentLeftAssign(const RToken& token)
 {
-   return token.isType(RToken::OPER) &&
-          token.contentEquals(L"<<-");
+   return token.subtype() == RToken::ASSIGN_LEFT_PARENT;
 }
 
 inline bool isParentRightAssign(const RToken& token)
 {
-   return token.isType(RToken::OPER) &&
-          token.contentEquals(L"->>");
+   return token.subtype() == RToken::ASSIGN_RIGHT_PARENT;
 }
 
 inline bool isLeftAssign(const RToken& token)
 {
-   return token.isType(RToken::OPER) && (
-            token.contentEquals(L"=") ||
-            token.contentEquals(L"<-") ||
-            token.contentEquals(L"<<-") ||
-            token.contentEquals(L":="));
+   return isLocalLeftAssign(token) || isParentLeftAssign(token);
 }
 
 inline bool isRightAssign(const RToken& token)
 {
-   return token.isType(RToken::OPER) && (
-            token.contentEquals(L"->") ||
-            token.contentEquals(L"->>"));
+   return isLocalRightAssign(token) || isParentRightAssign(token);
 }
 
 inline bool isRightBracket(const RToken& rToken)
@@ -379,14 +503,12 @@ inline bool isLeftBracket(const RToken& rToken)
 
 inline bool isDollar(const RToken& rToken)
 {
-   return rToken.isType(RToken::OPER) &&
-          rToken.contentEquals(L"$");
+   return rToken.subtype() == RToken::DOLLAR;
 }
 
 inline bool isAt(const RToken& rToken)
 {
-   return rToken.isType(RToken::OPER) &&
-          rToken.contentEquals(L"@");
+   return rToken.subtype() == RToken::AT;
 }
 
 inline bool isId(const RToken& rToken)
@@ -396,15 +518,13 @@ inline bool isId(const RToken& rToken)
 
 inline bool isNamespaceExtractionOperator(const RToken& rToken)
 {
-   return rToken.isType(RToken::OPER) && (
-            rToken.contentEquals(L"::") ||
-            rToken.contentEquals(L":::"));
+   return rToken.subtype() == RToken::NAMESPACE_EXPORTS ||
+          rToken.subtype() == RToken::NAMESPACE_ALL;
 }
 
 inline bool isFunction(const RToken& rToken)
 {
-   return rToken.isType(RToken::ID) &&
-          rToken.contentEquals(L"function");
+   return rToken.subtype() == RToken::KEYWORD_FUNCTION;
 }
 
 inline bool isString(const RToken& rToken)
@@ -443,11 +563,17 @@ inline bool hasNewline(const RToken& rToken)
 
 inline bool isValidAsUnaryOperator(const RToken& rToken)
 {
-   return rToken.contentEquals(L"-") ||
-          rToken.contentEquals(L"+") ||
-          rToken.contentEquals(L"!") ||
-          rToken.contentEquals(L"?") ||
-          rToken.contentEquals(L"~");
+   switch (rToken.subtype())
+   {
+   case RToken::MINUS:
+   case RToken::PLUS:
+   case RToken::NOT:
+   case RToken::HELP:
+   case RToken::FORMULA:
+      return true;
+   default:
+      return false;
+   }
 }
 
 inline bool canStartExpression(const RToken& rToken)
@@ -566,37 +692,12 @@ inline bool canFollowBinaryOperator(const RToken& rToken)
 
 inline bool isPipeOperator(const RToken& rToken)
 {
-   static const boost::wregex rePipe(L"^%[^>]*>+[^>]*%$");
-   return regex_utils::match(rToken.begin(), rToken.end(), rePipe);
+   return rToken.subtype() == RToken::PIPE;
 }
 
-namespace {
-
-std::vector<std::wstring> makeNaKeywords()
-{
-   std::vector<std::wstring> keywords;
-   
-   keywords.push_back(L"NA");
-   keywords.push_back(L"NA_character_");
-   keywords.push_back(L"NA_complex_");
-   keywords.push_back(L"NA_integer_");
-   keywords.push_back(L"NA_real_");
-   
-   return keywords;
-}
-
-} // anonymous namespace
-
 inline bool isNaKeyword(const RToken& rToken)
 {
-   if (!rToken.isType(RToken::ID))
-      return false;
-   
-   static const std::vector<std::wstring> naKeywords = makeNaKeywords();
-   for (const auto& naKeyword : naKeywords)
-      if (rToken.contentEquals(naKeyword))
-         return true;
-   return false;
+   return rToken.subtype() == RToken::KEYWORD_NA;
 }
 
 } // end namespace token_utils
@@ -22,6 +22,9 @@
 #define kRStudioInitialEnvironment     "RS_INITIAL_ENV"
 #define kRStudioInitialProject         "RS_INITIAL_PROJECT"
 
+// written (as a line) to stdout by desktop sessions once they're listening
+#define kRStudioSessionReady           "RS_SESSION_READY"
+
 namespace rstudio {
 namespace core {
 namespace r_util {
@@ -21,6 +21,8 @@
 #include <vector>
 #include <iosfwd>
 
+#include <boost/function.hpp>
+
 #include <core/FilePath.hpp>
 
 #include <core/json/Json.hpp>
@@ -125,6 +127,23 @@ std::vector<RVersion> enumerateRVersions(
                               const FilePath& ldPathsScript,
                               const std::string& ldLibraryPath);
 
+// detects the version and environment of the R at rScriptPath (running its
+// prelaunch script, if any, first) as detectREnvironment does
+typedef boost::function<bool(const FilePath& rScriptPath,
+                             const std::string& prelaunchScript,
+                             std::string* pVersion,
+                             core::system::Options* pEnvironment,
+                             std::string* pErrMsg)> REnvironmentDetector;
+
+// enumerate versions using the given detector (e.g. to cache detection)
+std::vector<RVersion> enumerateRVersions(
+                              std::vector<FilePath> rHomePaths,
+                              std::vector<r_util::RVersion> rEntries,
+                              bool scanForOtherVersions,
+                              const FilePath& ldPathsScript,
+                              const std::string& ldLibraryPath,
+                              const REnvironmentDetector& detector);
+
 RVersion selectVersion(const std::string& number,
                        const std::string& rHomeDir,
                        std::vector<RVersion> versions);
@@ -91,6 +91,10 @@ public:
 
    const HunspellCustomDictionaries& custom() const;
 
+   // dictionaries with their .dic_delta words merged in, built on first use
+   // and shared by all of the user's sessions
+   core::FilePath compiledDictionariesDir() const;
+
 private:
    core::FilePath allLanguagesDir() const;
    core::FilePath userLanguagesDir() const;
@@ -218,6 +218,18 @@ public:
    // has it exited?
    virtual bool exited();
 
+   // descriptors of the output pipes still being read, which can be waited
+   // on for output (or the exit of the child, which closes them). empty if
+   // the process hasn't been polled yet or on Windows
+   std::vector<int> outputDescriptors() const;
+
+#ifdef _WIN32
+   // handles which are signaled when output is ready to be read or the
+   // child exits. empty if the process hasn't been polled yet or its
+   // output can't be waited on (only pseudoterminal output can be)
+   std::vector<HANDLE> waitHandles() const;
+#endif
+
    // override of terminate (allow special handling for unix pty termination)
    virtual Error terminate();
 
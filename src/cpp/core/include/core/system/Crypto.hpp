@@ -37,6 +37,15 @@ core::Error HMAC_SHA2(const std::string& data,
                       const std::vector<unsigned char>& key,
                       std::vector<unsigned char>* pHMAC);
 
+// hashes the data in place (no copies are made of the data or the key).
+// each thread keeps its HMAC context along with the last key it used, so
+// repeatedly hashing with the same key skips the key setup
+core::Error HMAC_SHA2(const char* pData,
+                      std::size_t dataLen,
+                      const char* pKey,
+                      std::size_t keyLen,
+                      std::vector<unsigned char>* pHMAC);
+
 core::Error sha256(const std::string& message,
                    std::string* pHash);
 
@@ -56,6 +65,8 @@ core::Error rsaSign(const std::string& message,
                     const std::string& pemPrivateKey,
                     std::string* pOutSignature);
 
+// the parsed public key is kept per thread, so verifying a series of
+// messages against the same key only reads the PEM once
 core::Error rsaVerify(const std::string& message,
                       const std::string& signature,
                       const std::string& pemPublicKey);
@@ -70,6 +81,13 @@ void rsaPublicKey(std::string* pExponent, std::string* pModulo);
 
 core::Error rsaPrivateDecrypt(const std::string& pCipherText, std::string* pPlainText);
 
+// encrypt (to base64) with a public key given as hex encoded exponent and
+// modulo (e.g. as sent to clients by rsaPublicKey)
+core::Error rsaPublicEncrypt(const std::string& plainText,
+                             const std::string& exponent,
+                             const std::string& modulo,
+                             std::string* pCipherText);
+
 Error random(uint32_t numBytes, std::vector<unsigned char>* pOut);
 
 Error aesEncrypt(const std::vector<unsigned char>& data,
@@ -0,0 +1,78 @@
+/*
+ * FileChangeBatch.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_SYSTEM_FILE_CHANGE_BATCH_HPP
+#define CORE_SYSTEM_FILE_CHANGE_BATCH_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include <core/FileInfo.hpp>
+#include <core/system/FileChangeEvent.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+
+// Collects file changes, collapsing successive changes to the same path into
+// their net effect. For example a file which is added, modified and then
+// removed yields no change at all, and one which is removed and then added
+// back (as many editors and version control operations do) yields a single
+// modification.
+class FileChangeBatch
+{
+public:
+   void add(const FileChangeEvent& event);
+   void add(const std::vector<FileChangeEvent>& events);
+
+   bool empty() const { return paths_.empty(); }
+
+   // number of distinct paths changed
+   std::size_t size() const { return paths_.size(); }
+
+   // take the net changes (ordered by when each path first changed),
+   // leaving the batch empty
+   void take(std::vector<FileChangeEvent>* pEvents);
+
+   void clear();
+
+private:
+   struct PathChange
+   {
+      PathChange()
+         : existedBefore(false), lastType(FileChangeEvent::None)
+      {
+      }
+
+      // state of the path before the first change in the batch
+      bool existedBefore;
+      FileInfo before;
+
+      // most recent change
+      FileChangeEvent::Type lastType;
+      FileInfo last;
+   };
+
+   std::vector<std::string> paths_;
+   boost::unordered_map<std::string, PathChange> changes_;
+};
+
+} // namespace system
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_SYSTEM_FILE_CHANGE_BATCH_HPP
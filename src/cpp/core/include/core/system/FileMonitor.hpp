@@ -48,6 +48,20 @@ void initialize();
 // active file monitoring handles)
 void stop();
 
+// limit the number of directories each monitor watches for changes (0, the
+// default, for no limit). directories beyond the limit, or which can't be
+// watched because the system limit has been reached, are instead polled for
+// changes once per poll interval. directories found to have changed take
+// over the watches of those with the least recent activity. these should be
+// set prior to calling initialize (currently only used on linux)
+void setMaxWatches(std::size_t maxWatches);
+void setPollInterval(const boost::posix_time::time_duration& interval);
+
+// monitor recursively using a single fanotify mark on the filesystem rather
+// than a watch per directory where possible (requires linux 5.9 or later
+// and CAP_SYS_ADMIN, otherwise inotify is used). defaults to true
+void setUseFanotify(bool useFanotify);
+
 
 // opaque handle to a registration (used to unregister). the id field
 // is included so that handles have additional uniqueness beyond the
@@ -17,6 +17,8 @@
 #ifndef CORE_SYSTEM_FILE_SCANNER_HPP
 #define CORE_SYSTEM_FILE_SCANNER_HPP
 
+#include <vector>
+
 #include <boost/function.hpp>
 
 #include <core/Error.hpp>
@@ -39,12 +41,20 @@ namespace system {
 struct FileScannerOptions
 {
    FileScannerOptions()
-      : recursive(false), yield(false)
+      : recursive(false), yield(false), threads(1)
    {
    }
 
    bool recursive;
    bool yield;
+
+   // for recursive scans, the number of threads to list directories with.
+   // with more than one, directories are listed concurrently (which helps
+   // most on network filesystems) while the filter and onBeforeScanDir are
+   // still only called on the scanning thread (though in breadth first
+   // rather than depth first order). ignored on windows
+   int threads;
+
    boost::function<bool(const FileInfo&)> filter;
    boost::function<Error(const FileInfo&)> onBeforeScanDir;
 };
@@ -60,6 +70,18 @@ inline Error scanFiles(const FileInfo& fromRoot,
    return scanFiles(pTree->set_head(fromRoot), options, pTree);
 }
 
+// list the immediate children of a directory along with their attributes
+// (sorted by path). on posix the directory is read in bulk and each entry is
+// stat-ed relative to it (directories not reached through a symlink aren't
+// stat-ed at all), which is far cheaper than querying each FilePath
+// separately on network filesystems. if followSymlinks is true then links
+// report the attributes of their targets (as FileInfo(FilePath) would) and
+// broken links are skipped; otherwise links to directories are reported as
+// files. entries which are removed during the scan are skipped.
+Error scanDirectory(const FilePath& dirPath,
+                    bool followSymlinks,
+                    std::vector<FileInfo>* pFiles);
+
 
 } // namespace system
 } // namespace core
@@ -0,0 +1,90 @@
+/*
+ * PosixCgroups.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_SYSTEM_POSIX_CGROUPS_HPP
+#define CORE_SYSTEM_POSIX_CGROUPS_HPP
+
+#include <string>
+
+#include <sys/types.h>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+namespace system {
+namespace cgroups {
+
+// placement of a process in its own cgroup (v2) beneath a parent cgroup;
+// zero or empty limits are left at the kernel defaults
+struct CgroupLimits
+{
+   CgroupLimits()
+      : cpuWeight(0),
+        memoryHighBytes(0)
+   {
+   }
+
+   bool empty() const { return parentPath.empty(); }
+
+   std::string parentPath;      // e.g. /sys/fs/cgroup/rstudio
+   int cpuWeight;               // cpu.weight (1-10000, default 100)
+   long long memoryHighBytes;   // memory.high (throttled and reclaimed above)
+   std::string ioMax;           // ';' separated io.max lines
+};
+
+// the cgroup a process placed with the limits lives in
+FilePath processCgroupPath(const std::string& parentPath, pid_t pid);
+
+// move the calling process into a new cgroup for it (requires privilege to
+// write to the parent). empty cgroups left by exited processes are removed
+// at the same time.
+Error joinProcessCgroup(const CgroupLimits& limits);
+
+struct CgroupUsage
+{
+   CgroupUsage()
+      : cpuUsec(0),
+        memoryBytes(0),
+        ioReadBytes(0),
+        ioWriteBytes(0)
+   {
+   }
+
+   long long cpuUsec;
+   long long memoryBytes;
+   long long ioReadBytes;
+   long long ioWriteBytes;
+};
+
+// read the accumulated usage of a cgroup (cpu.stat, memory.current, io.stat)
+Error readCgroupUsage(const FilePath& cgroupPath, CgroupUsage* pUsage);
+
+// the number of cpus a cgroup's cpu.max quota allows (e.g. 1.5 for
+// "150000 100000"); zero if its cpu time isn't limited
+double readCgroupCpuQuota(const FilePath& cgroupPath);
+
+// the number of cpus the calling process can use: the cpu count capped by
+// the quotas of its cgroup and that cgroup's ancestors (always at least 1)
+int availableCpuCount();
+
+} // namespace cgroups
+} // namespace system
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_SYSTEM_POSIX_CGROUPS_HPP
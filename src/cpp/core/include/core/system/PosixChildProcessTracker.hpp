@@ -20,6 +20,9 @@
 
 #include <boost/noncopyable.hpp>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
 
 #include <core/Thread.hpp>
 #include <core/system/System.hpp>
@@ -32,6 +35,11 @@ class FilePath;
 
 namespace system {
 
+// Reaps tracked child processes and calls their exit handlers. Processes
+// are either reaped when notifySIGCHILD is called (which checks each of them)
+// or, when added with an io service and the system supports process file
+// descriptors (Linux 5.3+), reaped on the io service as they exit, so that
+// the work done per exit doesn't grow with the number of children tracked.
 class ChildProcessTracker : boost::noncopyable
 {
 public:
@@ -40,10 +48,21 @@ public:
 
   void addProcess(PidType pid, ExitHandler exitHandler = ExitHandler());
 
+  void addProcess(PidType pid,
+                  boost::asio::io_service& ioService,
+                  ExitHandler exitHandler = ExitHandler());
+
   void notifySIGCHILD();
 
 private:
-  void attemptToReapProcess(const std::pair<PidType,ExitHandler>& process);
+  typedef boost::shared_ptr<boost::asio::posix::stream_descriptor> PidFd;
+
+  bool attemptToReapProcess(const std::pair<PidType,ExitHandler>& process);
+  void watchPidFd(PidType pid, PidFd pPidFd, ExitHandler exitHandler);
+  void onPidFdReadable(PidType pid,
+                       PidFd pPidFd,
+                       ExitHandler exitHandler,
+                       const boost::system::error_code& ec);
   void removeProcess(PidType pid);
   std::map<PidType,ExitHandler> activeProcesses();
 
@@ -0,0 +1,52 @@
+/*
+ * PosixSamplingProfiler.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_SYSTEM_POSIX_SAMPLING_PROFILER_HPP
+#define CORE_SYSTEM_POSIX_SAMPLING_PROFILER_HPP
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+namespace system {
+
+// Profiler for the process's own (native) code. While running, SIGPROF is
+// delivered at the given frequency of consumed cpu time to whichever thread
+// is using it, and the handler records that thread's stack. Stacks are
+// symbolized only when the profile is written. SIGPROF is shared with R's
+// Rprof, so only one of the two can run at a time.
+namespace sampling_profiler {
+
+core::Error start(int frequencyHz = 100);
+bool running();
+
+// stop sampling and write the profile as folded stacks: one line per
+// distinct stack, from the thread name down to the sampled function and
+// followed by its sample count (the input format of flame graph tools)
+core::Error stop(const core::FilePath& outputPath);
+
+// start profiling on the first delivery of the signal and stop (writing a
+// profile into the directory) on the next. the work happens on a thread of
+// its own, so a profile can be taken while the main thread is stuck.
+core::Error registerToggleSignal(int signal, const core::FilePath& outputDir);
+
+} // namespace sampling_profiler
+} // namespace system
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_SYSTEM_POSIX_SAMPLING_PROFILER_HPP
@@ -20,6 +20,7 @@
 
 #include <core/system/System.hpp>
 
+#include <core/system/PosixCgroups.hpp>
 #include <core/system/PosixSched.hpp>
 
 // typedefs (in case we need indirection on these for porting)
@@ -92,6 +93,12 @@ struct SysInfo
 
 core::Error systemInformation(SysInfo* pSysInfo);
 
+// physical memory available to new allocations without swapping (linux only)
+core::Error availableMemoryKb(long* pKb);
+
+// resident set size of a process (linux only)
+core::Error processResidentMemoryKb(PidType pid, long* pKb);
+
 core::Error pidof(const std::string& process, std::vector<PidType>* pPids);
 
 struct ProcessInfo
@@ -170,6 +177,7 @@ struct ProcessLimits
    RLimitType cpuLimit;
    RLimitType niceLimit;
    RLimitType filesLimit;
+   cgroups::CgroupLimits cgroup;
 };
 
 void setProcessLimits(ProcessLimits limits);
@@ -263,6 +271,13 @@ std::vector<SubprocInfo> getSubprocessesViaPgrep(PidType pid);
 std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid);
 #endif // !__APPLE__
 
+// Detect subprocesses via the /proc/<pid>/task/<tid>/children files;
+// returns false if they aren't supported by the kernel
+#ifndef __APPLE__
+bool getSubprocessesViaProcChildren(PidType pid,
+                                    std::vector<SubprocInfo>* pSubprocs);
+#endif // !__APPLE__
+
 // Determine current working directory of a given process by shelling out
 // to lsof; used on systems without procfs.
 FilePath currentWorkingDirViaLsof(PidType pid);
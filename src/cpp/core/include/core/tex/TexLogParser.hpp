@@ -19,6 +19,9 @@
 #include <string>
 #include <vector>
 
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
 #include <core/FilePath.hpp>
 
 namespace rstudio {
@@ -75,6 +78,33 @@ private:
 
 typedef std::vector<LogEntry> LogEntries;
 
+// Parses a LaTeX log as it is written (e.g. from the output of the compiler
+// while it runs), so that its issues can be reported before it completes.
+// An entry is available once the lines which complete it have been added
+class LatexLogParser : boost::noncopyable
+{
+public:
+   // entries refer to the log at logFilePath, and the files it names are
+   // resolved relative to its directory
+   explicit LatexLogParser(const FilePath& logFilePath);
+   ~LatexLogParser();
+
+   // COPYING: boost::noncopyable
+
+   // add output (which needn't end with a complete line)
+   void addOutput(const std::string& output);
+
+   // parse whatever remains (the last line, if it wasn't ended, and any
+   // entry whose lines were cut short)
+   void finish();
+
+   const LogEntries& logEntries() const;
+
+private:
+   struct Impl;
+   boost::scoped_ptr<Impl> pImpl_;
+};
+
 Error parseLatexLog(const FilePath& logFilePath, LogEntries* pLogEntries);
 
 Error parseBibtexLog(const FilePath& logFilePath, LogEntries* pLogEntries);
@@ -127,6 +127,7 @@ public:
 
 private:
    std::string synctexNameForInputFile(const FilePath& inputFile);
+   std::string findSynctexNameForInputFile(const FilePath& inputFile);
 
 private:
    struct Impl;
@@ -16,7 +16,9 @@
 #ifndef ANSI_CODE_PARSER_HPP
 #define ANSI_CODE_PARSER_HPP
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 namespace rstudio {
 namespace core {
@@ -28,6 +30,30 @@ enum AnsiCodeMode {
    AnsiColorStrip = 2 // strip out ANSI escape sequences but don't apply styles
 };
 
+enum AnsiSpanType {
+   AnsiSpanText = 0,     // plain text
+   AnsiSpanCsi = 1,      // control sequence (ESC [ ... final), e.g. colors
+   AnsiSpanString = 2,   // string sequence (ESC ] ... BEL/ST), e.g. titles and links
+   AnsiSpanEscape = 3    // any other escape sequence (ESC ... final)
+};
+
+// A run of plain text or a single escape sequence within a string
+struct AnsiSpan
+{
+   AnsiSpan(AnsiSpanType type, std::size_t offset, std::size_t length)
+      : type(type), offset(offset), length(length)
+   {
+   }
+
+   AnsiSpanType type;
+   std::size_t offset;
+   std::size_t length;
+};
+
+// Split a string into runs of plain text and escape sequences. An ESC which
+// doesn't begin a complete, well-formed sequence is treated as text.
+void parseAnsiCodes(const std::string& str, std::vector<AnsiSpan>* pSpans);
+
 // Strip Ansi codes from a string
 void stripAnsiCodes(std::string* pStr);
 
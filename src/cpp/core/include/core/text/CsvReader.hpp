@@ -0,0 +1,103 @@
+/*
+ * CsvReader.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_TEXT_CSV_READER_HPP
+#define CORE_TEXT_CSV_READER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+namespace text {
+
+/*
+Reads delimited files into columns without going through R (e.g. for data
+import previews).
+
+Files are memory mapped and, when all rows are wanted, split into chunks
+which are parsed in parallel. Chunks are split at record boundaries found
+from the parity of the quotes preceding them, so quoted fields may contain
+delimiters and line breaks. As with parseCsvLine a quote toggles quoting
+wherever it appears (and "" within a quoted field is a literal quote),
+'\r' outside quotes is ignored, and empty lines are skipped.
+*/
+
+enum CsvColumnType
+{
+   CsvColumnLogical = 0,
+   CsvColumnInteger = 1,
+   CsvColumnDouble = 2,
+   CsvColumnCharacter = 3
+};
+
+std::string csvColumnTypeName(CsvColumnType type);
+
+struct CsvColumn
+{
+   CsvColumn() : type(CsvColumnCharacter) {}
+
+   std::string name;
+   CsvColumnType type;
+
+   // one value per row (rows with fewer fields are padded with empty values)
+   std::vector<std::string> values;
+};
+
+struct CsvReadOptions
+{
+   CsvReadOptions()
+      : delimiter(','), header(true), maxRows(-1), threads(0)
+   {
+   }
+
+   char delimiter;
+
+   // is the first row a header? (otherwise columns are named V1, V2, ...)
+   bool header;
+
+   // the number of rows (not including the header) to read; -1 for all.
+   // a limited read is parsed on the calling thread and stops as soon as it
+   // has read enough rows
+   int maxRows;
+
+   // threads to parse with; 0 to use one per core
+   int threads;
+};
+
+// guess the narrowest type which can hold all of the values (empty values and
+// "NA" are treated as missing; a column with only missing values is logical)
+CsvColumnType guessCsvColumnType(const std::vector<std::string>& values);
+
+// parse delimited text (column types are guessed)
+void parseCsv(const char* begin,
+              const char* end,
+              const CsvReadOptions& options,
+              std::vector<CsvColumn>* pColumns);
+
+Error readCsvFile(const FilePath& filePath,
+                  const CsvReadOptions& options,
+                  std::vector<CsvColumn>* pColumns);
+
+} // namespace text
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_TEXT_CSV_READER_HPP
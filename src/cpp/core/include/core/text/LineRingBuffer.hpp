@@ -0,0 +1,86 @@
+/*
+ * LineRingBuffer.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_TEXT_LINE_RING_BUFFER_HPP
+#define CORE_TEXT_LINE_RING_BUFFER_HPP
+
+#include <deque>
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+
+// Text buffer which keeps track of where its newlines are, so that it can be
+// kept to its most recent lines without rescanning the text. As with
+// string_utils::trimLeadingLines, trimming keeps the newline preceding the
+// last maxLines lines and drops everything before it.
+class LineRingBuffer
+{
+public:
+   // a maxLines of zero means the buffer is never trimmed
+   explicit LineRingBuffer(int maxLines = 0);
+
+   void setMaxLines(int maxLines);
+   int maxLines() const { return maxLines_; }
+
+   // append text, trimming the leading lines if that takes the buffer past
+   // its maximum. returns true if anything was trimmed
+   bool append(const std::string& text);
+
+   bool assign(const std::string& text);
+   void clear();
+
+   bool empty() const { return size() == 0; }
+   std::size_t size() const;
+
+   // bytes of storage held (which includes trimmed text not yet discarded)
+   std::size_t memoryUsage() const
+   {
+      return data_.capacity() + newlines_.size() * sizeof(boost::uint64_t);
+   }
+
+   // number of lines including any partial line at the end (so text ending
+   // in a newline has an empty last line)
+   std::size_t lineCount() const { return newlines_.size() + 1; }
+
+   std::string str() const;
+
+   // text starting at pos (which must be no greater than size())
+   std::string substr(std::size_t pos, std::size_t length) const;
+
+private:
+   bool trim();
+
+   int maxLines_;
+
+   // the text; the buffer's contents begin at start_ (text before that has
+   // been trimmed and is discarded once it makes up half of the storage)
+   std::string data_;
+
+   // positions in the stream of all text appended (which don't change as
+   // storage is discarded, so trimming needn't renumber the newlines)
+   boost::uint64_t dataOffset_;
+   boost::uint64_t start_;
+   std::deque<boost::uint64_t> newlines_;
+};
+
+} // namespace text
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_TEXT_LINE_RING_BUFFER_HPP
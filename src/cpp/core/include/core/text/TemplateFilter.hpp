@@ -20,9 +20,11 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <boost/iostreams/filter/regex.hpp>
 
@@ -39,6 +41,13 @@ namespace http {
 
 namespace text {
 
+// the value substituted for a template variable (escaped as indicated by
+// the prefix, if any, of its name)
+std::string templateVariableValue(
+                  const std::map<std::string, std::string>& variables,
+                  const std::string& prefix,
+                  const std::string& name);
+
 // Add variables to templates using #foo# syntax. All values will be
 // HTML-escaped automatically unless prepended with !, e.g. #!foo# will
 // use the raw value of foo. Alternatively, you can prepend with ' and JS
@@ -59,27 +68,46 @@ public:
 private:
    std::string substitute(const boost::cmatch& match)
    {
-      std::map<std::string, std::string>::const_iterator valPos = 
-                                                   variables_.find(match[2]);
-      if (valPos != variables_.end())
-      {
-         if (match[1] == "!")
-            return valPos->second;
-         else if (match[1] == "'")
-            return string_utils::jsLiteralEscape(valPos->second);
-         else
-            return string_utils::htmlEscape(valPos->second, true);
-         return valPos->second;
-      }
-      else
-         return "MISSING VALUE";
+      return templateVariableValue(variables_, match[1], match[2]);
    }
 
 private:
    std::map<std::string, std::string> variables_;
 };
 
+// A template (with the syntax of TemplateFilter) which is parsed once into
+// its text and variables, so that rendering it doesn't re-scan the text
+class CompiledTemplate
+{
+public:
+   CompiledTemplate() : textSize_(0) {}
+   CompiledTemplate(const char* begin, const char* end);
+   explicit CompiledTemplate(const std::string& text);
+
+   // COPYING: via compiler
+
+   std::string render(const std::map<std::string, std::string>& variables) const;
 
+private:
+   void compile(const char* begin, const char* end);
+
+   struct Segment
+   {
+      std::string text;
+
+      // variables have a name (in text) and an escaping prefix
+      bool variable;
+      std::string prefix;
+   };
+   std::vector<Segment> segments_;
+   std::size_t textSize_;
+};
+
+// Get the compiled template for a template file. Templates are compiled
+// (from the mapped file, see core::mappedResource) once per process and
+// recompiled when the file changes.
+core::Error compiledTemplate(const core::FilePath& templateFile,
+                             boost::shared_ptr<const CompiledTemplate>* pTemplate);
 
 void handleTemplateRequest(const FilePath& templatePath,
                            const http::Request& request,
@@ -90,6 +118,12 @@ void handleSecureTemplateRequest(const std::string& username,
                                  const http::Request& request,
                                  http::Response* pResponse);
 
+// serve a template file rendered with the given variables
+void setTemplateResponse(const FilePath& templatePath,
+                         const std::map<std::string, std::string>& variables,
+                         const http::Request& request,
+                         http::Response* pResponse);
+
 core::Error renderTemplate(const core::FilePath& templateFile,
                            const std::map<std::string, std::string> &vars,
                            std::ostream& os);
@@ -0,0 +1,129 @@
+/*
+ * TrigramIndex.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_TEXT_TRIGRAM_INDEX_HPP
+#define CORE_TEXT_TRIGRAM_INDEX_HPP
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+namespace text {
+
+// Index of the (ASCII case folded) byte trigrams contained in a set of
+// files. The index is used to narrow the set of files which could possibly
+// contain a search term -- it never excludes a file that might match, but
+// may include files that don't (so matching must still be done on the
+// candidates). Files which are removed or updated are tombstoned and their
+// postings are dropped the next time the index is compacted.
+class TrigramIndex : boost::noncopyable
+{
+public:
+   // files larger than this are not indexed (and are always candidates)
+   static const std::size_t kMaxIndexedFileSize;
+
+   TrigramIndex();
+
+   // add or replace the contents of a file
+   void update(const std::string& path,
+               std::time_t lastWriteTime,
+               const std::string& contents);
+
+   // add or replace a file whose contents weren't indexed (e.g. because
+   // it was too large to read). such files are always candidates
+   void updateUnindexed(const std::string& path, std::time_t lastWriteTime);
+
+   void remove(const std::string& path);
+
+   void clear();
+
+   // is the file indexed as of the given write time
+   bool isCurrent(const std::string& path, std::time_t lastWriteTime) const;
+
+   // all of the paths in the index
+   void paths(std::vector<std::string>* pPaths) const;
+
+   std::size_t size() const { return ids_.size(); }
+
+   // get the files which may contain all of the passed literals. returns
+   // false if the literals can't be used to narrow the search (i.e. none
+   // of them are long enough to contain a trigram)
+   bool candidates(const std::vector<std::string>& literals,
+                   std::vector<std::string>* pPaths) const;
+
+   // drop postings for removed files (done automatically once they make up
+   // a large enough share of the index)
+   void compact();
+
+   Error writeToFile(const FilePath& filePath) const;
+   Error readFromFile(const FilePath& filePath);
+
+private:
+   typedef boost::uint32_t FileId;
+   typedef boost::uint32_t Trigram;
+
+   struct FileEntry
+   {
+      FileEntry(const std::string& path,
+                std::time_t lastWriteTime,
+                bool indexed)
+         : path(path), lastWriteTime(lastWriteTime),
+           indexed(indexed), live(true)
+      {
+      }
+
+      std::string path;
+      std::time_t lastWriteTime;
+      bool indexed;
+      bool live;
+   };
+
+   FileId addEntry(const std::string& path,
+                   std::time_t lastWriteTime,
+                   bool indexed);
+   void maybeCompact();
+
+   std::vector<FileEntry> files_;
+   std::map<std::string, FileId> ids_;
+   boost::unordered_map<Trigram, std::vector<FileId> > postings_;
+   std::size_t deadCount_;
+};
+
+// extract literal strings which must appear in any text matched by the
+// search term. returns false if the term can't be reduced to required
+// literals (e.g. it contains alternation). regular expressions are
+// interpreted conservatively so that either basic or extended syntax
+// yields a safe result
+bool requiredLiterals(const std::string& term,
+                      bool asRegex,
+                      bool ignoreCase,
+                      std::vector<std::string>* pLiterals);
+
+} // namespace text
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_TEXT_TRIGRAM_INDEX_HPP
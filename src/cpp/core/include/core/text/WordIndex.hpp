@@ -0,0 +1,128 @@
+/*
+ * WordIndex.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_TEXT_WORD_INDEX_HPP
+#define CORE_TEXT_WORD_INDEX_HPP
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+
+// Inverted index of the (ASCII case folded) words contained in a set of
+// documents. Each document belongs to a group (e.g. the package it came
+// from) so that groups can be replaced or removed as a whole, and is made
+// up of weighted fields. A search returns the documents which contain all
+// of the words in the query (the last of which may be a prefix), ranked by
+// the weights of the fields they were found in. Removed documents are
+// tombstoned and their postings are dropped the next time the index is
+// compacted.
+class WordIndex : boost::noncopyable
+{
+public:
+   // a field's text and the weight given to words found in it
+   typedef std::pair<std::string, int> Field;
+
+   struct Match
+   {
+      Match(const std::string& group, const std::string& key, int score)
+         : group(group), key(key), score(score)
+      {
+      }
+
+      std::string group;
+      std::string key;
+      int score;
+   };
+
+   WordIndex();
+
+   void add(const std::string& group,
+            const std::string& key,
+            const std::vector<Field>& fields);
+
+   void removeGroup(const std::string& group);
+
+   bool hasGroup(const std::string& group) const;
+
+   // all of the groups in the index
+   void groups(std::vector<std::string>* pGroups) const;
+
+   void clear();
+
+   // the number of (live) documents in the index
+   std::size_t size() const { return docs_.size() - deadCount_; }
+
+   // get up to maxMatches of the best matches for the query (in order of
+   // descending score)
+   void search(const std::string& query,
+               std::size_t maxMatches,
+               std::vector<Match>* pMatches) const;
+
+   // drop postings for removed documents (done automatically once they
+   // make up a large enough share of the index)
+   void compact();
+
+private:
+   typedef boost::uint32_t DocId;
+
+   struct Document
+   {
+      Document(const std::string& group, const std::string& key)
+         : group(group), key(key), live(true)
+      {
+      }
+
+      std::string group;
+      std::string key;
+      bool live;
+   };
+
+   struct Posting
+   {
+      Posting(DocId doc, int weight) : doc(doc), weight(weight) {}
+
+      DocId doc;
+      int weight;
+   };
+
+   typedef std::map<std::string, std::vector<Posting> > Postings;
+
+   void maybeCompact();
+
+   std::vector<Document> docs_;
+   std::map<std::string, std::vector<DocId> > groups_;
+   Postings postings_;
+   std::size_t deadCount_;
+};
+
+// split text into the (case folded) words indexed by WordIndex. words are
+// runs of letters, digits, '.' and '_'; words containing '.' or '_' are
+// also split into their parts (so "read.csv" yields "read.csv", "read" and
+// "csv")
+void indexWords(const std::string& text, std::vector<std::string>* pWords);
+
+} // namespace text
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_TEXT_WORD_INDEX_HPP
@@ -27,6 +27,7 @@
 #include <core/Thread.hpp>
 
 #include "spirit/json_spirit.h"
+#include "JsonEngine.hpp"
 
 namespace rstudio {
 namespace core {
@@ -131,6 +132,7 @@ bool fillMap(const Object& object, std::map< std::string, std::vector<std::strin
 
 bool parse(const std::string& input, Value* pValue)
 {
+#ifdef RSTUDIO_JSON_SPIRIT
    // two threads simultaneously using the json parser has been observed
    // to crash the process. protect it globally with a mutex. note this was
    // probably a result of not defining BOOST_SPIRIT_THREADSAFE (which we
@@ -147,26 +149,49 @@ bool parse(const std::string& input, Value* pValue)
    
    // mutex related error
    return false;
+#else
+   return engine::read(input, pValue);
+#endif
 }
 
 void write(const Value& value, std::ostream& os)
 {
+#ifdef RSTUDIO_JSON_SPIRIT
    json_spirit::write(value, os);
+#else
+   os << json::write(value);
+#endif
 }
 
 void writeFormatted(const Value& value, std::ostream& os)
 {
+#ifdef RSTUDIO_JSON_SPIRIT
    json_spirit::write_formatted(value, os);
+#else
+   os << json::writeFormatted(value);
+#endif
 }
 
 std::string write(const Value& value)
 {
+#ifdef RSTUDIO_JSON_SPIRIT
    return json_spirit::write(value);
+#else
+   std::string output;
+   engine::write(value, false, &output);
+   return output;
+#endif
 }
 
 std::string writeFormatted(const Value& value)
 {
+#ifdef RSTUDIO_JSON_SPIRIT
    return json_spirit::write_formatted(value);
+#else
+   std::string output;
+   engine::write(value, true, &output);
+   return output;
+#endif
 }
 
 } // namespace json
@@ -0,0 +1,81 @@
+/*
+ * JsonBenchmarks.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/json/Json.hpp>
+
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+
+#include <tests/Benchmark.hpp>
+
+namespace rstudio {
+namespace core {
+namespace json {
+
+namespace {
+
+// a document shaped like a typical RPC result (a list of objects, each
+// with strings, numbers and a nested array)
+const Value& document()
+{
+   static Value value;
+   if (value.is_null())
+   {
+      Array items;
+      for (int i = 0; i < 1000; i++)
+      {
+         std::string index = boost::lexical_cast<std::string>(i);
+
+         Array tags;
+         tags.push_back("tag-" + index);
+         tags.push_back(i % 2 == 0);
+         tags.push_back(i * 0.5);
+
+         Object item;
+         item["name"] = "object_" + index;
+         item["type"] = "data.frame";
+         item["description"] = "1000 obs. of 12 variables \"quoted\"\n";
+         item["size"] = i * 1024;
+         item["is_data"] = true;
+         item["tags"] = tags;
+         items.push_back(item);
+      }
+      value = items;
+   }
+   return value;
+}
+
+} // anonymous namespace
+
+BENCHMARK(json, write)
+{
+   for (std::size_t i = 0; i < iterations; i++)
+      tests::benchmark::doNotOptimize(json::write(document()));
+}
+
+BENCHMARK(json, parse)
+{
+   static const std::string text = json::write(document());
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      Value value;
+      tests::benchmark::doNotOptimize(json::parse(text, &value));
+   }
+}
+
+} // namespace json
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,763 @@
+/*
+ * JsonEngine.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "JsonEngine.hpp"
+
+#include <algorithm>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+#include <boost/cstdint.hpp>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+# define RSTUDIO_JSON_SSE2
+#endif
+
+namespace rstudio {
+namespace core {
+namespace json {
+namespace engine {
+
+namespace {
+
+// deeper documents are rejected rather than risk the stack
+const int kMaxDepth = 1000;
+
+inline bool isSpace(char ch)
+{
+   return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' ||
+          ch == '\v' || ch == '\f';
+}
+
+inline bool isDigit(char ch)
+{
+   return ch >= '0' && ch <= '9';
+}
+
+inline int hexValue(char ch)
+{
+   if (ch >= '0' && ch <= '9')
+      return ch - '0';
+   if (ch >= 'a' && ch <= 'f')
+      return ch - 'a' + 10;
+   if (ch >= 'A' && ch <= 'F')
+      return ch - 'A' + 10;
+   return -1;
+}
+
+// the first quote or backslash at or after pos
+inline const char* findStringEnd(const char* pos, const char* end)
+{
+#ifdef RSTUDIO_JSON_SSE2
+   const __m128i quote = _mm_set1_epi8('"');
+   const __m128i backslash = _mm_set1_epi8('\\');
+   while (end - pos >= 16)
+   {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+      int mask = _mm_movemask_epi8(
+               _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                            _mm_cmpeq_epi8(chunk, backslash)));
+      if (mask != 0)
+         return pos + __builtin_ctz(mask);
+      pos += 16;
+   }
+#endif
+
+   while (pos != end && *pos != '"' && *pos != '\\')
+      ++pos;
+   return pos;
+}
+
+// the first character at or after pos which must be escaped on output
+inline const char* findEscape(const char* pos, const char* end)
+{
+#ifdef RSTUDIO_JSON_SSE2
+   const __m128i quote = _mm_set1_epi8('"');
+   const __m128i backslash = _mm_set1_epi8('\\');
+   const __m128i lastControl = _mm_set1_epi8(0x1F);
+   while (end - pos >= 16)
+   {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+
+      // (unsigned) min(chunk, 0x1F) == chunk only for control characters
+      __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, lastControl), chunk);
+      int mask = _mm_movemask_epi8(
+               _mm_or_si128(control,
+                            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                         _mm_cmpeq_epi8(chunk, backslash))));
+      if (mask != 0)
+         return pos + __builtin_ctz(mask);
+      pos += 16;
+   }
+#endif
+
+   while (pos != end)
+   {
+      unsigned char ch = static_cast<unsigned char>(*pos);
+      if (ch == '"' || ch == '\\' || ch < 0x20)
+         break;
+      ++pos;
+   }
+   return pos;
+}
+
+void appendUtf8(unsigned int codePoint, std::string* pOutput)
+{
+   if (codePoint < 0x80)
+   {
+      pOutput->push_back(static_cast<char>(codePoint));
+   }
+   else if (codePoint < 0x800)
+   {
+      pOutput->push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+      pOutput->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+   }
+   else if (codePoint < 0x10000)
+   {
+      pOutput->push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+      pOutput->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+      pOutput->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+   }
+   else
+   {
+      pOutput->push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+      pOutput->push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+      pOutput->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+      pOutput->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+   }
+}
+
+// use the locale's decimal point when converting reals (R normally keeps
+// LC_NUMERIC as "C", but we can't rely on that in every process)
+char localeDecimalPoint()
+{
+   const char* point = std::localeconv()->decimal_point;
+   return (point != NULL && point[0] != '\0') ? point[0] : '.';
+}
+
+class Reader
+{
+public:
+   Reader(const char* begin, const char* end)
+      : pos_(begin), end_(end)
+   {
+   }
+
+   bool readValue(Value* pValue, int depth)
+   {
+      skipSpace();
+      if (pos_ == end_)
+         return false;
+
+      switch (*pos_)
+      {
+      case '{':
+         return readObject(pValue, depth);
+      case '[':
+         return readArray(pValue, depth);
+      case '"':
+      {
+         std::string str;
+         if (!readString(&str))
+            return false;
+         Value value(str);
+         pValue->swap(value);
+         return true;
+      }
+      case 't':
+         return readLiteral("true", Value(true), pValue);
+      case 'f':
+         return readLiteral("false", Value(false), pValue);
+      case 'n':
+         return readLiteral("null", Value(), pValue);
+      default:
+         return readNumber(pValue);
+      }
+   }
+
+private:
+   void skipSpace()
+   {
+      while (pos_ != end_ && isSpace(*pos_))
+         ++pos_;
+   }
+
+   bool readLiteral(const char* literal, const Value& value, Value* pValue)
+   {
+      for (const char* ch = literal; *ch != '\0'; ++ch, ++pos_)
+      {
+         if (pos_ == end_ || *pos_ != *ch)
+            return false;
+      }
+
+      *pValue = value;
+      return true;
+   }
+
+   bool readObject(Value* pValue, int depth)
+   {
+      if (depth >= kMaxDepth)
+         return false;
+
+      ++pos_;
+      *pValue = Value(Object());
+      Object& object = pValue->get_obj();
+
+      skipSpace();
+      if (pos_ != end_ && *pos_ == '}')
+      {
+         ++pos_;
+         return true;
+      }
+
+      std::string name;
+      while (true)
+      {
+         skipSpace();
+         if (pos_ == end_ || *pos_ != '"')
+            return false;
+
+         name.clear();
+         if (!readString(&name))
+            return false;
+
+         skipSpace();
+         if (pos_ == end_ || *pos_ != ':')
+            return false;
+         ++pos_;
+
+         // members we write come sorted, so hinting at the end makes the
+         // insert constant time; a repeated name keeps the last value
+         Value& member = object.emplace_hint(object.end(), name, Value())->second;
+         if (!readValue(&member, depth + 1))
+            return false;
+
+         skipSpace();
+         if (pos_ == end_)
+            return false;
+
+         if (*pos_ == ',')
+         {
+            ++pos_;
+         }
+         else if (*pos_ == '}')
+         {
+            ++pos_;
+            return true;
+         }
+         else
+         {
+            return false;
+         }
+      }
+   }
+
+   bool readArray(Value* pValue, int depth)
+   {
+      if (depth >= kMaxDepth)
+         return false;
+
+      ++pos_;
+      *pValue = Value(Array());
+      Array& array = pValue->get_array();
+
+      skipSpace();
+      if (pos_ != end_ && *pos_ == ']')
+      {
+         ++pos_;
+         return true;
+      }
+
+      while (true)
+      {
+         // grow by swapping elements into the larger array, since values
+         // can't be moved and copying them would copy their children
+         if (array.size() == array.capacity())
+         {
+            Array grown;
+            grown.reserve(std::max<std::size_t>(8, array.size() * 2));
+            grown.resize(array.size());
+            for (std::size_t i = 0; i < array.size(); i++)
+               grown[i].swap(array[i]);
+            array.swap(grown);
+         }
+
+         array.push_back(Value());
+         if (!readValue(&array.back(), depth + 1))
+            return false;
+
+         skipSpace();
+         if (pos_ == end_)
+            return false;
+
+         if (*pos_ == ',')
+         {
+            ++pos_;
+         }
+         else if (*pos_ == ']')
+         {
+            ++pos_;
+            return true;
+         }
+         else
+         {
+            return false;
+         }
+      }
+   }
+
+   bool readHex(int digits, unsigned int* pValue)
+   {
+      if (end_ - pos_ < digits)
+         return false;
+
+      unsigned int value = 0;
+      for (int i = 0; i < digits; i++)
+      {
+         int digit = hexValue(*pos_++);
+         if (digit < 0)
+            return false;
+         value = (value << 4) | digit;
+      }
+
+      *pValue = value;
+      return true;
+   }
+
+   bool readUnicodeEscape(std::string* pStr)
+   {
+      unsigned int codePoint;
+      if (!readHex(4, &codePoint))
+         return false;
+
+      // combine surrogate pairs; unpaired surrogates can't be encoded
+      if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+      {
+         unsigned int low;
+         if (end_ - pos_ >= 6 && pos_[0] == '\\' && pos_[1] == 'u')
+         {
+            const char* escape = pos_;
+            pos_ += 2;
+            if (readHex(4, &low) && low >= 0xDC00 && low <= 0xDFFF)
+            {
+               appendUtf8(0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00),
+                          pStr);
+               return true;
+            }
+            pos_ = escape;
+         }
+         codePoint = 0xFFFD;
+      }
+      else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+      {
+         codePoint = 0xFFFD;
+      }
+
+      appendUtf8(codePoint, pStr);
+      return true;
+   }
+
+   bool readString(std::string* pStr)
+   {
+      ++pos_;
+      while (true)
+      {
+         const char* special = findStringEnd(pos_, end_);
+         pStr->append(pos_, special);
+         pos_ = special;
+
+         if (pos_ == end_)
+            return false;
+
+         if (*pos_ == '"')
+         {
+            ++pos_;
+            return true;
+         }
+
+         // escape
+         ++pos_;
+         if (pos_ == end_)
+            return false;
+
+         char escape = *pos_++;
+         switch (escape)
+         {
+         case '"':  pStr->push_back('"');  break;
+         case '\\': pStr->push_back('\\'); break;
+         case '/':  pStr->push_back('/');  break;
+         case 'b':  pStr->push_back('\b'); break;
+         case 'f':  pStr->push_back('\f'); break;
+         case 'n':  pStr->push_back('\n'); break;
+         case 'r':  pStr->push_back('\r'); break;
+         case 't':  pStr->push_back('\t'); break;
+         case 'u':
+            if (!readUnicodeEscape(pStr))
+               return false;
+            break;
+         case 'x':
+         {
+            unsigned int ch;
+            if (!readHex(2, &ch))
+               return false;
+            pStr->push_back(static_cast<char>(ch));
+            break;
+         }
+         default:
+            // json_spirit drops unknown escapes; so do we
+            break;
+         }
+      }
+   }
+
+   bool readNumber(Value* pValue)
+   {
+      const char* begin = pos_;
+      const char* pos = pos_;
+
+      bool negative = false;
+      if (pos != end_ && (*pos == '-' || *pos == '+'))
+      {
+         negative = *pos == '-';
+         ++pos;
+      }
+
+      const char* digitsBegin = pos;
+      while (pos != end_ && isDigit(*pos))
+         ++pos;
+      const char* digitsEnd = pos;
+      std::size_t digits = digitsEnd - digitsBegin;
+
+      bool real = false;
+      if (pos != end_ && *pos == '.')
+      {
+         real = true;
+         ++pos;
+         const char* fraction = pos;
+         while (pos != end_ && isDigit(*pos))
+            ++pos;
+         digits += pos - fraction;
+      }
+
+      if (digits == 0)
+         return false;
+
+      if (pos != end_ && (*pos == 'e' || *pos == 'E'))
+      {
+         const char* exponent = pos + 1;
+         if (exponent != end_ && (*exponent == '+' || *exponent == '-'))
+            ++exponent;
+         if (exponent != end_ && isDigit(*exponent))
+         {
+            real = true;
+            pos = exponent;
+            while (pos != end_ && isDigit(*pos))
+               ++pos;
+         }
+      }
+
+      pos_ = pos;
+
+      if (real)
+      {
+         std::string number(begin, pos);
+         char point = localeDecimalPoint();
+         if (point != '.')
+            std::replace(number.begin(), number.end(), '.', point);
+         *pValue = Value(std::strtod(number.c_str(), NULL));
+         return true;
+      }
+
+      // integers which don't fit an int64 are read as uint64 (positive) or
+      // rejected
+      boost::uint64_t magnitude = 0;
+      const boost::uint64_t max = std::numeric_limits<boost::uint64_t>::max();
+      for (const char* digit = digitsBegin; digit != digitsEnd; ++digit)
+      {
+         unsigned int value = *digit - '0';
+         if (magnitude > (max - value) / 10)
+            return false;
+         magnitude = magnitude * 10 + value;
+      }
+
+      const boost::uint64_t maxInt64 = std::numeric_limits<boost::int64_t>::max();
+      if (negative)
+      {
+         if (magnitude > maxInt64 + 1)
+            return false;
+         *pValue = Value(static_cast<boost::int64_t>(0 - magnitude));
+      }
+      else if (magnitude > maxInt64)
+      {
+         *pValue = Value(magnitude);
+      }
+      else
+      {
+         *pValue = Value(static_cast<boost::int64_t>(magnitude));
+      }
+
+      return true;
+   }
+
+private:
+   const char* pos_;
+   const char* end_;
+};
+
+void writeMagnitude(boost::uint64_t magnitude, bool negative, std::string* pOutput)
+{
+   char buffer[24];
+   char* pos = buffer + sizeof(buffer);
+   do
+   {
+      *--pos = static_cast<char>('0' + magnitude % 10);
+      magnitude /= 10;
+   } while (magnitude != 0);
+
+   if (negative)
+      *--pos = '-';
+
+   pOutput->append(pos, buffer + sizeof(buffer));
+}
+
+} // anonymous namespace
+
+void writeString(const char* str, std::size_t length, std::string* pOutput)
+{
+   pOutput->push_back('"');
+
+   const char* pos = str;
+   const char* end = pos + length;
+   while (true)
+   {
+      const char* escape = findEscape(pos, end);
+      pOutput->append(pos, escape);
+      if (escape == end)
+         break;
+
+      switch (*escape)
+      {
+      case '"':  pOutput->append("\\\""); break;
+      case '\\': pOutput->append("\\\\"); break;
+      case '\b': pOutput->append("\\b");  break;
+      case '\f': pOutput->append("\\f");  break;
+      case '\n': pOutput->append("\\n");  break;
+      case '\r': pOutput->append("\\r");  break;
+      case '\t': pOutput->append("\\t");  break;
+      default:
+      {
+         char buffer[8];
+         std::snprintf(buffer, sizeof(buffer), "\\u%04X",
+                       static_cast<unsigned char>(*escape));
+         pOutput->append(buffer);
+         break;
+      }
+      }
+
+      pos = escape + 1;
+   }
+
+   pOutput->push_back('"');
+}
+
+void writeString(const std::string& str, std::string* pOutput)
+{
+   writeString(str.data(), str.size(), pOutput);
+}
+
+void writeInteger(boost::int64_t value, std::string* pOutput)
+{
+   if (value < 0)
+      writeMagnitude(0 - static_cast<boost::uint64_t>(value), true, pOutput);
+   else
+      writeMagnitude(static_cast<boost::uint64_t>(value), false, pOutput);
+}
+
+void writeInteger(boost::uint64_t value, std::string* pOutput)
+{
+   writeMagnitude(value, false, pOutput);
+}
+
+void writeReal(double value, std::string* pOutput)
+{
+   // integral values (most numbers in R data) are converted directly, to
+   // the digits the general conversion would produce, padded with zeros to
+   // sixteen significant digits
+   if (std::fabs(value) < 1e15 &&
+       value == static_cast<double>(static_cast<boost::int64_t>(value)) &&
+       !(value == 0 && std::signbit(value)))
+   {
+      std::size_t start = pOutput->size();
+      writeInteger(static_cast<boost::int64_t>(value), pOutput);
+      std::size_t digits = pOutput->size() - start - (value < 0 ? 1 : 0);
+      pOutput->push_back('.');
+      pOutput->append(16 - digits, '0');
+      return;
+   }
+
+   // the same conversion json_spirit's stream makes (showpoint and a
+   // precision of 16)
+   char buffer[32];
+   int length = std::snprintf(buffer, sizeof(buffer), "%#.16g", value);
+   if (length <= 0 || length >= static_cast<int>(sizeof(buffer)))
+      return;
+
+   char point = localeDecimalPoint();
+   if (point != '.')
+      std::replace(buffer, buffer + length, point, '.');
+
+   pOutput->append(buffer, length);
+}
+
+namespace {
+
+class Writer
+{
+public:
+   Writer(bool pretty, std::string* pOutput)
+      : pretty_(pretty), indent_(0), output_(*pOutput)
+   {
+   }
+
+   void writeValue(const Value& value)
+   {
+      switch (value.type())
+      {
+      case json_spirit::obj_type:
+         writeObject(value.get_obj());
+         break;
+      case json_spirit::array_type:
+         writeArray(value.get_array());
+         break;
+      case json_spirit::str_type:
+         writeString(value.get_str(), &output_);
+         break;
+      case json_spirit::bool_type:
+         output_.append(value.get_bool() ? "true" : "false");
+         break;
+      case json_spirit::int_type:
+         if (value.is_uint64())
+            writeInteger(value.get_uint64(), &output_);
+         else
+            writeInteger(value.get_int64(), &output_);
+         break;
+      case json_spirit::real_type:
+         writeReal(value.get_real(), &output_);
+         break;
+      case json_spirit::null_type:
+         output_.append("null");
+         break;
+      }
+   }
+
+private:
+   void writeObject(const Object& object)
+   {
+      output_.push_back('{');
+      newLine();
+      ++indent_;
+
+      for (Object::const_iterator it = object.begin(); it != object.end(); )
+      {
+         indent();
+         writeString(it->first, &output_);
+         space();
+         output_.push_back(':');
+         space();
+         writeValue(it->second);
+
+         if (++it != object.end())
+            output_.push_back(',');
+         newLine();
+      }
+
+      --indent_;
+      indent();
+      output_.push_back('}');
+   }
+
+   void writeArray(const Array& array)
+   {
+      output_.push_back('[');
+      newLine();
+      ++indent_;
+
+      for (Array::const_iterator it = array.begin(); it != array.end(); )
+      {
+         indent();
+         writeValue(*it);
+
+         if (++it != array.end())
+            output_.push_back(',');
+         newLine();
+      }
+
+      --indent_;
+      indent();
+      output_.push_back(']');
+   }
+
+   void indent()
+   {
+      if (pretty_)
+         output_.append(4 * indent_, ' ');
+   }
+
+   void space()
+   {
+      if (pretty_)
+         output_.push_back(' ');
+   }
+
+   void newLine()
+   {
+      if (pretty_)
+         output_.push_back('\n');
+   }
+
+private:
+   bool pretty_;
+   int indent_;
+   std::string& output_;
+};
+
+} // anonymous namespace
+
+bool read(const std::string& input, Value* pValue)
+{
+   Reader reader(input.data(), input.data() + input.size());
+
+   Value value;
+   if (!reader.readValue(&value, 0))
+      return false;
+
+   pValue->swap(value);
+   return true;
+}
+
+void write(const Value& value, bool pretty, std::string* pOutput)
+{
+   Writer writer(pretty, pOutput);
+   writer.writeValue(value);
+}
+
+} // namespace engine
+} // namespace json
+} // namespace core
+} // namespace rstudio
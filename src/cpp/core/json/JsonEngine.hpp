@@ -0,0 +1,56 @@
+/*
+ * JsonEngine.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_JSON_ENGINE_HPP
+#define CORE_JSON_ENGINE_HPP
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+#include <core/json/Json.hpp>
+
+namespace rstudio {
+namespace core {
+namespace json {
+
+// Reader and writer for json::Value used by json::parse and json::write
+// (unless built with RSTUDIO_JSON_SPIRIT). They accept and produce the same
+// documents as json_spirit's, but scan strings a block at a time, build
+// values in place, and need no global lock. Where they differ is noted
+// in JsonEngineTests.cpp.
+namespace engine {
+
+// parse the first value in the input (trailing input is ignored, as with
+// json_spirit). on failure pValue is left unchanged.
+bool read(const std::string& input, Value* pValue);
+
+// append the value to the output; pretty output matches json_spirit's
+// write_formatted
+void write(const Value& value, bool pretty, std::string* pOutput);
+
+// append a single scalar, formatted as write would
+void writeString(const std::string& str, std::string* pOutput);
+void writeString(const char* str, std::size_t length, std::string* pOutput);
+void writeInteger(boost::int64_t value, std::string* pOutput);
+void writeInteger(boost::uint64_t value, std::string* pOutput);
+void writeReal(double value, std::string* pOutput);
+
+} // namespace engine
+} // namespace json
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_JSON_ENGINE_HPP
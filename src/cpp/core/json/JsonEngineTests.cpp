@@ -0,0 +1,316 @@
+/*
+ * JsonEngineTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "JsonEngine.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <tests/TestThat.hpp>
+
+#include "spirit/json_spirit.h"
+
+namespace rstudio {
+namespace core {
+namespace json {
+namespace tests {
+
+namespace {
+
+std::string engineWrite(const Value& value, bool pretty = false)
+{
+   std::string output;
+   engine::write(value, pretty, &output);
+   return output;
+}
+
+// both readers accept the input, produce the same value, and the writers
+// then produce the same text
+void checkConforms(const std::string& input)
+{
+   INFO(input);
+
+   Value spiritValue, engineValue;
+   REQUIRE(json_spirit::read(input, spiritValue));
+   REQUIRE(engine::read(input, &engineValue));
+   CHECK(spiritValue == engineValue);
+
+   CHECK(json_spirit::write(spiritValue) == engineWrite(engineValue));
+   CHECK(json_spirit::write_formatted(spiritValue) == engineWrite(engineValue, true));
+}
+
+void checkRejected(const std::string& input)
+{
+   INFO(input);
+
+   Value spiritValue, engineValue;
+   CHECK_FALSE(json_spirit::read(input, spiritValue));
+   CHECK_FALSE(engine::read(input, &engineValue));
+}
+
+// random documents (without the characters we write differently)
+Value randomValue(int depth)
+{
+   int kind = std::rand() % (depth > 4 ? 6 : 8);
+   switch (kind)
+   {
+   case 0: return Value();
+   case 1: return Value(std::rand() % 2 == 0);
+   case 2: return Value(static_cast<boost::int64_t>(std::rand()) - RAND_MAX / 2);
+   case 3: return Value((std::rand() - RAND_MAX / 2) / 977.0);
+   case 4:
+   case 5:
+   {
+      const char chars[] = "abc XYZ 0189 \"\\/\n\r\t\b\f \xC3\xA9 \xE2\x82\xAC";
+      std::string str;
+      int length = std::rand() % 40;
+      for (int i = 0; i < length; i++)
+         str.push_back(chars[std::rand() % (sizeof(chars) - 1)]);
+      return Value(str);
+   }
+   case 6:
+   {
+      Array array;
+      int length = std::rand() % 6;
+      for (int i = 0; i < length; i++)
+         array.push_back(randomValue(depth + 1));
+      return Value(array);
+   }
+   default:
+   {
+      Object object;
+      int length = std::rand() % 6;
+      for (int i = 0; i < length; i++)
+         object["key" + std::string(1, 'a' + std::rand() % 26)] = randomValue(depth + 1);
+      return Value(object);
+   }
+   }
+}
+
+Value benchmarkDocument()
+{
+   // shaped like a large rpc response: an array of records of strings,
+   // numbers and nested arrays
+   Array rows;
+   for (int i = 0; i < 5000; i++)
+   {
+      Object row;
+      row["id"] = i;
+      row["name"] = "file_" + std::string(20, 'a' + i % 26) + ".R";
+      row["path"] = "~/projects/analysis/src/with some spaces/and \"quotes\"";
+      row["size"] = i * 1024.5;
+      row["dirty"] = i % 3 == 0;
+      Array tokens;
+      for (int j = 0; j < 10; j++)
+         tokens.push_back(j * i);
+      row["tokens"] = tokens;
+      rows.push_back(row);
+   }
+
+   Object document;
+   document["result"] = rows;
+   return document;
+}
+
+} // anonymous namespace
+
+TEST_CASE("JSON Engine")
+{
+   SECTION("Scalars conform")
+   {
+      checkConforms("null");
+      checkConforms("true");
+      checkConforms("false");
+      checkConforms("0");
+      checkConforms("-0");
+      checkConforms("42");
+      checkConforms("-9223372036854775808");
+      checkConforms("9223372036854775807");
+      checkConforms("9223372036854775808");
+      checkConforms("18446744073709551615");
+      checkConforms("1.5");
+      checkConforms("-0.25");
+      checkConforms("1e10");
+      checkConforms("1.5E-7");
+      checkConforms("0.1");
+      checkConforms("\"\"");
+      checkConforms("\"hello world\"");
+   }
+
+   SECTION("Strings conform")
+   {
+      checkConforms("\"escapes \\\" \\\\ \\/ \\b \\f \\n \\r \\t\"");
+      checkConforms("\"ascii \\u0041\\u007a\"");
+      checkConforms("\"utf-8 passes through: \xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\"");
+      checkConforms("\"a long string which spans more than one sixteen byte block "
+                    "with an escape \\n far from its start\"");
+      checkConforms("\"0123456789abcde\\\"0123456789abcdef\\\\\"");
+   }
+
+   SECTION("Containers conform")
+   {
+      checkConforms("[]");
+      checkConforms("{}");
+      checkConforms("[1,2,3]");
+      checkConforms(" [ 1 , [ 2 , [ 3 ] ] , { } ] ");
+      checkConforms("{\"b\":1,\"a\":[true,false,null],\"c\":{\"d\":\"e\"}}");
+      checkConforms("\n\t{ \"spaced\" :\r\n [ 1.0 ] }");
+      checkConforms("{\"a\":1,\"a\":2}");
+   }
+
+   SECTION("Trailing input is ignored")
+   {
+      checkConforms("[1] trailing");
+      checkConforms("true false");
+      checkConforms("12abc");
+   }
+
+   SECTION("Malformed documents are rejected")
+   {
+      checkRejected("");
+      checkRejected("   ");
+      checkRejected("[");
+      checkRejected("[1,]");
+      checkRejected("[1 2]");
+      checkRejected("{\"a\"}");
+      checkRejected("{\"a\":}");
+      checkRejected("{\"a\":1,}");
+      checkRejected("{a:1}");
+      checkRejected("\"unterminated");
+      checkRejected("[tru]");
+      checkRejected("-");
+      checkRejected("18446744073709551616");
+   }
+
+   SECTION("Integral reals are written as the general conversion would")
+   {
+      double values[] = { 0, 1, -1, 7, 10, 100, 12345, -98765, 1e14,
+                          999999999999999.0, -999999999999999.0, 1e15, 1e16,
+                          4503599627370496.0, -0.0, 0.5, 1e-300, 1e300 };
+      for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+      {
+         INFO(values[i]);
+         CHECK(engineWrite(Value(values[i])) == json_spirit::write(Value(values[i])));
+      }
+   }
+
+   SECTION("Random documents conform")
+   {
+      std::srand(42);
+      for (int i = 0; i < 500; i++)
+      {
+         Value value = randomValue(0);
+         std::string text = json_spirit::write(value);
+         CHECK(text == engineWrite(value));
+         checkConforms(text);
+      }
+   }
+
+   SECTION("Failed reads leave the value alone")
+   {
+      Value value(42);
+      CHECK_FALSE(engine::read("[1, 2", &value));
+      CHECK(value == Value(42));
+   }
+
+   // deliberate differences from json_spirit
+
+   SECTION("Unicode escapes are decoded to UTF-8")
+   {
+      // json_spirit truncates each escape to a single char
+      Value value;
+      REQUIRE(engine::read("\"\\u00e9\\u20AC\\ud83d\\ude00\"", &value));
+      CHECK(value.get_str() == "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+
+      REQUIRE(engine::read("\"\\ud83d lone\"", &value));
+      CHECK(value.get_str() == "\xEF\xBF\xBD lone");
+
+      CHECK_FALSE(engine::read("\"\\u12\"", &value));
+   }
+
+   SECTION("Reals are rounded correctly")
+   {
+      // json_spirit accumulates the exponent, which can be off by an ulp
+      Value value;
+      REQUIRE(engine::read("6.02214076e+23", &value));
+      CHECK(value.get_real() == std::strtod("6.02214076e+23", NULL));
+      CHECK(engineWrite(value) == "6.022140760000000e+23");
+   }
+
+   SECTION("Control characters are written escaped")
+   {
+      // json_spirit writes them raw, which browsers' JSON.parse rejects
+      CHECK(engineWrite(Value(std::string("a\x01z"))) == "\"a\\u0001z\"");
+
+      Value value;
+      REQUIRE(engine::read(engineWrite(Value(std::string("a\x01z"))), &value));
+      CHECK(value.get_str() == "a\x01z");
+   }
+
+   SECTION("Absurdly deep documents are rejected")
+   {
+      Value value;
+      CHECK_FALSE(engine::read(std::string(100000, '['), &value));
+   }
+}
+
+// run with: rstudio-tests "[benchmark]"
+TEST_CASE("JSON Engine Benchmark", "[.][benchmark]")
+{
+   using namespace boost::posix_time;
+
+   Value document = benchmarkDocument();
+   std::string text = json_spirit::write(document);
+   const int kIterations = 20;
+
+   Value value;
+   ptime start = microsec_clock::universal_time();
+   for (int i = 0; i < kIterations; i++)
+      json_spirit::read(text, value);
+   time_duration spiritRead = microsec_clock::universal_time() - start;
+
+   start = microsec_clock::universal_time();
+   for (int i = 0; i < kIterations; i++)
+      engine::read(text, &value);
+   time_duration engineRead = microsec_clock::universal_time() - start;
+
+   start = microsec_clock::universal_time();
+   for (int i = 0; i < kIterations; i++)
+      json_spirit::write(document);
+   time_duration spiritWrite = microsec_clock::universal_time() - start;
+
+   start = microsec_clock::universal_time();
+   for (int i = 0; i < kIterations; i++)
+      engineWrite(document);
+   time_duration engineWrite = microsec_clock::universal_time() - start;
+
+   std::cout << "JSON benchmark (" << text.size() / 1024 << " KB document, "
+             << kIterations << " iterations)" << std::endl
+             << "  read:  json_spirit " << spiritRead.total_milliseconds()
+             << " ms, engine " << engineRead.total_milliseconds() << " ms" << std::endl
+             << "  write: json_spirit " << spiritWrite.total_milliseconds()
+             << " ms, engine " << engineWrite.total_milliseconds() << " ms" << std::endl;
+
+   CHECK(value == document);
+}
+
+} // end namespace tests
+} // end namespace json
+} // end namespace core
+} // end namespace rstudio
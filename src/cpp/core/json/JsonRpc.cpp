@@ -17,8 +17,11 @@
 
 #include <sstream>
 
+#include <boost/bind.hpp>
+
 #include <core/Log.hpp>
 #include <core/http/Response.hpp>
+#include <core/json/JsonWriter.hpp>
 
 
 namespace rstudio {
@@ -176,14 +179,53 @@ void JsonRpcResponse::runAfterResponse()
       afterResponse_();
 }
    
+void JsonRpcResponse::setResultJson(const std::string& json)
+{
+   response_[kRpcResult] = json::Value();
+   resultJson_ = json;
+}
+
+void JsonRpcResponse::parseResultJson()
+{
+   // callers which need the result as a value (rather than just writing
+   // it) get it parsed back
+   if (!resultJson_.empty())
+   {
+      json::Value result;
+      if (!json::parse(resultJson_, &result))
+         LOG_ERROR_MESSAGE("Invalid JSON rpc result");
+      response_[kRpcResult] = result;
+      resultJson_.clear();
+   }
+}
+
 json::Object JsonRpcResponse::getRawResponse()
 {
+   parseResultJson();
    return response_;
 }
    
 void JsonRpcResponse::write(std::ostream& os) const
 {
-   json::write(response_, os);
+   if (resultJson_.empty())
+   {
+      json::write(response_, os);
+      return;
+   }
+
+   json::Writer writer(os);
+   writer.startObject();
+   for (json::Object::const_iterator it = response_.begin();
+        it != response_.end();
+        ++it)
+   {
+      writer.key(it->first);
+      if (it->first == kRpcResult)
+         writer.rawValue(resultJson_);
+      else
+         writer.value(it->second);
+   }
+   writer.endObject();
 }
    
 void JsonRpcResponse::setError(const Error& error, const json::Value& clientInfo)
@@ -191,6 +233,7 @@ void JsonRpcResponse::setError(const Error& error, const json::Value& clientInfo
    // remove result
    response_.erase(kRpcResult);
    response_.erase(kRpcAsyncHandle);
+   resultJson_.clear();
 
    const boost::system::error_code& ec = error.code();
    
@@ -242,6 +285,7 @@ void JsonRpcResponse::setError(const boost::system::error_code& ec,
    // remove result
    response_.erase(kRpcResult);
    response_.erase(kRpcAsyncHandle);
+   resultJson_.clear();
 
    // error from error code
    json::Object error ;
@@ -278,6 +322,7 @@ void JsonRpcResponse::setAsyncHandle(const std::string& handle)
 {
    response_.erase(kRpcResult);
    response_.erase(kRpcError);
+   resultJson_.clear();
 
    setField(kRpcAsyncHandle, handle);
 }
@@ -295,10 +340,9 @@ void setJsonRpcResponse(const core::json::JsonRpcResponse& jsonRpcResponse,
    if (pResponse->contentType().empty())
        pResponse->setContentType(kJsonContentType) ; 
    
-   // set body 
-   std::stringstream responseStream ;
-   jsonRpcResponse.write(responseStream);
-   Error error = pResponse->setBody(responseStream);
+   // set body (written straight into it)
+   Error error = pResponse->setBodyFromWriter(
+         boost::bind(&JsonRpcResponse::write, &jsonRpcResponse, _1));
    
    // report error to client if one occurred
    if (error)
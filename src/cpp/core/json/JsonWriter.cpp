@@ -0,0 +1,209 @@
+/*
+ * JsonWriter.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/json/JsonWriter.hpp>
+
+#include <cstring>
+#include <ostream>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+
+#include "JsonEngine.hpp"
+
+namespace rstudio {
+namespace core {
+namespace json {
+
+namespace {
+
+// how much streamed output we buffer before writing it to the stream
+const std::size_t kStreamBlockSize = 64 * 1024;
+
+} // anonymous namespace
+
+Writer::Writer(std::string* pOutput)
+   : pOutput_(pOutput), pStream_(NULL), afterKey_(false)
+{
+}
+
+Writer::Writer(std::ostream& os)
+   : pOutput_(&buffer_), pStream_(&os), afterKey_(false)
+{
+   buffer_.reserve(kStreamBlockSize + 4096);
+}
+
+Writer::~Writer()
+{
+   try
+   {
+      flush();
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
+void Writer::startObject()
+{
+   startContainer('{');
+}
+
+void Writer::endObject()
+{
+   endContainer('}');
+}
+
+void Writer::startArray()
+{
+   startContainer('[');
+}
+
+void Writer::endArray()
+{
+   endContainer(']');
+}
+
+void Writer::key(const std::string& name)
+{
+   beforeValue();
+   engine::writeString(name, pOutput_);
+   pOutput_->push_back(':');
+   afterKey_ = true;
+}
+
+void Writer::null()
+{
+   beforeValue();
+   pOutput_->append("null");
+   afterValue();
+}
+
+void Writer::value(bool value)
+{
+   beforeValue();
+   pOutput_->append(value ? "true" : "false");
+   afterValue();
+}
+
+void Writer::value(int value)
+{
+   this->value(static_cast<boost::int64_t>(value));
+}
+
+void Writer::value(unsigned int value)
+{
+   this->value(static_cast<boost::int64_t>(value));
+}
+
+void Writer::value(boost::int64_t value)
+{
+   beforeValue();
+   engine::writeInteger(value, pOutput_);
+   afterValue();
+}
+
+void Writer::value(boost::uint64_t value)
+{
+   beforeValue();
+   engine::writeInteger(value, pOutput_);
+   afterValue();
+}
+
+void Writer::value(double value)
+{
+   beforeValue();
+   engine::writeReal(value, pOutput_);
+   afterValue();
+}
+
+void Writer::value(const char* value)
+{
+   beforeValue();
+   engine::writeString(value, std::strlen(value), pOutput_);
+   afterValue();
+}
+
+void Writer::value(const std::string& value)
+{
+   beforeValue();
+   engine::writeString(value, pOutput_);
+   afterValue();
+}
+
+void Writer::value(const Value& value)
+{
+   beforeValue();
+   engine::write(value, false, pOutput_);
+   afterValue();
+}
+
+void Writer::rawValue(const std::string& json)
+{
+   beforeValue();
+   pOutput_->append(json);
+   afterValue();
+}
+
+void Writer::flush()
+{
+   if (pStream_ != NULL && !buffer_.empty())
+   {
+      pStream_->write(buffer_.data(), buffer_.size());
+      buffer_.clear();
+   }
+}
+
+void Writer::beforeValue()
+{
+   // a member's value directly follows its key; otherwise elements after
+   // the first are separated
+   if (afterKey_)
+   {
+      afterKey_ = false;
+      return;
+   }
+
+   if (!containers_.empty())
+   {
+      if (containers_.back())
+         pOutput_->push_back(',');
+      else
+         containers_.back() = true;
+   }
+}
+
+void Writer::afterValue()
+{
+   if (pStream_ != NULL && buffer_.size() >= kStreamBlockSize)
+      flush();
+}
+
+void Writer::startContainer(char open)
+{
+   beforeValue();
+   pOutput_->push_back(open);
+   containers_.push_back(false);
+}
+
+void Writer::endContainer(char close)
+{
+   if (!containers_.empty())
+      containers_.pop_back();
+   pOutput_->push_back(close);
+   afterValue();
+}
+
+} // namespace json
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,143 @@
+/*
+ * JsonWriterTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/json/JsonWriter.hpp>
+
+#include <sstream>
+
+#include <core/http/Response.hpp>
+#include <core/json/JsonRpc.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace json {
+namespace tests {
+
+TEST_CASE("JSON Writer")
+{
+   SECTION("Output matches json::write")
+   {
+      Object nested;
+      nested["x"] = 1.5;
+      nested["y"] = json::Value();
+
+      Array items;
+      items.push_back(1);
+      items.push_back("two \"quoted\"\n");
+      items.push_back(nested);
+
+      Object expected;
+      expected["a"] = true;
+      expected["b"] = items;
+      expected["c"] = Array();
+      expected["d"] = static_cast<boost::int64_t>(-9000000000LL);
+
+      std::string output;
+      Writer writer(&output);
+      writer.startObject();
+      writer.member("a", true);
+      writer.key("b");
+      writer.startArray();
+      writer.value(1);
+      writer.value("two \"quoted\"\n");
+      writer.startObject();
+      writer.member("x", 1.5);
+      writer.key("y");
+      writer.null();
+      writer.endObject();
+      writer.endArray();
+      writer.key("c");
+      writer.startArray();
+      writer.endArray();
+      writer.member("d", static_cast<boost::int64_t>(-9000000000LL));
+      writer.endObject();
+
+      CHECK(writer.complete());
+      CHECK(output == json::write(expected));
+   }
+
+   SECTION("Values and raw text can be embedded")
+   {
+      std::string output;
+      Writer writer(&output);
+      writer.startArray();
+      writer.value(Value(Array()));
+      writer.rawValue("{\"pre\":1}");
+      writer.value(std::string("s"));
+      writer.endArray();
+
+      CHECK(output == "[[],{\"pre\":1},\"s\"]");
+   }
+
+   SECTION("Streamed output is complete once flushed")
+   {
+      std::ostringstream os;
+      {
+         Writer writer(os);
+         writer.startArray();
+         for (int i = 0; i < 50000; i++)
+            writer.value(i);
+         writer.endArray();
+      }
+
+      Value value;
+      REQUIRE(json::parse(os.str(), &value));
+      REQUIRE(value.type() == ArrayType);
+      CHECK(value.get_array().size() == 50000);
+      CHECK(value.get_array().back().get_int() == 49999);
+   }
+
+   SECTION("Rpc responses can carry a written result")
+   {
+      std::string result;
+      Writer writer(&result);
+      writer.startArray();
+      writer.value("a");
+      writer.value(2);
+      writer.endArray();
+
+      JsonRpcResponse response;
+      response.setResultJson(result);
+      response.setField("ev", 7);
+
+      std::ostringstream os;
+      response.write(os);
+      CHECK(os.str() == "{\"ev\":7,\"result\":[\"a\",2]}");
+
+      http::Response httpResponse;
+      setJsonRpcResponse(response, &httpResponse);
+      CHECK(httpResponse.body() == os.str());
+
+      // the result is parsed back when asked for as a value
+      CHECK(response.result().get_array().size() == 2);
+      CHECK(response.getRawResponse()["ev"].get_int() == 7);
+
+      // and dropped if an error replaces it
+      JsonRpcResponse errorResponse;
+      errorResponse.setResultJson(result);
+      errorResponse.setError(systemError(boost::system::errc::io_error,
+                                         ERROR_LOCATION));
+      os.str("");
+      errorResponse.write(os);
+      CHECK(os.str().find("result") == std::string::npos);
+   }
+}
+
+} // end namespace tests
+} // end namespace json
+} // end namespace core
+} // end namespace rstudio
@@ -23,6 +23,7 @@
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
 
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
@@ -308,8 +309,156 @@ void stripMetadata(std::string* pInput)
    }
 }
 
+// a key identifying the options a document was rendered with
+std::string renderOptionsKey(const Extensions& extensions,
+                             const HTMLOptions& options)
+{
+   bool flags[] = { extensions.noIntraEmphasis, extensions.tables,
+                    extensions.fencedCode, extensions.autolink,
+                    extensions.laxSpacing, extensions.spaceHeaders,
+                    extensions.strikethrough, extensions.superscript,
+                    extensions.ignoreMath, extensions.stripMetadata,
+                    extensions.htmlPreserve,
+                    options.useXHTML, options.hardWrap, options.smartypants,
+                    options.safelink, options.toc, options.skipHTML,
+                    options.skipStyle, options.skipImages, options.skipLinks,
+                    options.escape };
+
+   std::string key;
+   for (std::size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++)
+      key.push_back(flags[i] ? '1' : '0');
+   return key;
+}
+
+// can a block of the document start with this line (i.e. will a line like
+// it following a blank line never continue the previous block)
+bool canStartBlock(const std::string& line)
+{
+   static const boost::regex listItemRegex("^([*+-]|[0-9]+\\.)[ \\t]");
+
+   if (line.empty())
+      return false;
+
+   // indented lines may continue a list or an indented code block, and
+   // blockquotes may continue over blank lines
+   if (line[0] == ' ' || line[0] == '\t' || line[0] == '>')
+      return false;
+
+   // list items may continue a (loose) list
+   return !regex_utils::search(line, listItemRegex);
+}
+
+// split a document into blocks which sundown renders the same on their
+// own as it does as part of the whole document. returns false if there are
+// constructs which span blocks
+bool splitBlocks(const std::string& input, std::vector<std::string>* pBlocks)
+{
+   static const boost::regex refDefRegex("^ {0,3}\\[[^\\]]+\\]:");
+   static const boost::regex htmlBlockRegex("^ {0,3}<[A-Za-z!/?]");
+   static const boost::regex fenceRegex("^ {0,3}(`{3,}|~{3,})");
+
+   std::vector<std::string> lines;
+   boost::algorithm::split(lines, input, boost::algorithm::is_any_of("\n"));
+
+   std::string block;
+   char fenceChar = '\0';
+   bool inMath = false;
+   bool afterBlank = false;
+   for (std::size_t i = 0; i < lines.size(); i++)
+   {
+      const std::string& line = lines[i];
+      bool inFence = fenceChar != '\0';
+      if (!inFence &&
+          (regex_utils::search(line, refDefRegex) ||
+           regex_utils::search(line, htmlBlockRegex)))
+      {
+         return false;
+      }
+
+      if (!inFence && !inMath && afterBlank && !block.empty() &&
+          canStartBlock(line))
+      {
+         pBlocks->push_back(block);
+         block.clear();
+      }
+
+      block.append(line);
+      if (i < lines.size() - 1)
+         block.push_back('\n');
+
+      boost::smatch match;
+      if (regex_utils::search(line, match, fenceRegex))
+      {
+         if (!inFence)
+            fenceChar = match[1].str()[0];
+         else if (match[1].str()[0] == fenceChar)
+            fenceChar = '\0';
+      }
+      else if (!inFence)
+      {
+         // display math may contain blank lines
+         std::size_t count = 0, pos = 0;
+         while ((pos = line.find("$$", pos)) != std::string::npos)
+         {
+            count++;
+            pos += 2;
+         }
+         if (count % 2 == 1)
+            inMath = !inMath;
+      }
+
+      afterBlank = !inFence && boost::algorithm::trim_copy(line).empty();
+   }
+
+   if (!block.empty())
+      pBlocks->push_back(block);
+
+   return true;
+}
+
 } // anonymous namespace
 
+void BlockCache::clear()
+{
+   blocks_.clear();
+   currentBlocks_.clear();
+   renderedCount_ = 0;
+}
+
+void BlockCache::startRender(const std::string& optionsKey)
+{
+   if (optionsKey != optionsKey_)
+   {
+      blocks_.clear();
+      optionsKey_ = optionsKey;
+   }
+   currentBlocks_.clear();
+   renderedCount_ = 0;
+}
+
+bool BlockCache::lookup(const std::string& block, std::string* pHTML)
+{
+   std::map<std::string, std::string>::const_iterator it = blocks_.find(block);
+   if (it == blocks_.end())
+      return false;
+
+   *pHTML = it->second;
+   currentBlocks_[block] = it->second;
+   return true;
+}
+
+void BlockCache::add(const std::string& block, const std::string& html)
+{
+   currentBlocks_[block] = html;
+   renderedCount_++;
+}
+
+void BlockCache::finishRender()
+{
+   blocks_.swap(currentBlocks_);
+   currentBlocks_.clear();
+}
+
 // render markdown to HTML -- assumes UTF-8 encoding
 Error markdownToHTML(const FilePath& markdownFile,
                      const Extensions& extensions,
@@ -462,6 +611,53 @@ Error markdownToHTML(const std::string& markdownInput,
    return Success();
 }
 
+// render markdown to HTML using a block cache -- assumes UTF-8 encoding
+Error markdownToHTML(const std::string& markdownInput,
+                     const Extensions& extensions,
+                     const HTMLOptions& options,
+                     BlockCache* pCache,
+                     std::string* pHTMLOutput)
+{
+   // strip metadata up front (it isn't part of any block)
+   std::string input = markdownInput;
+   if (extensions.stripMetadata)
+      stripMetadata(&input);
+
+   std::vector<std::string> blocks;
+   if (options.toc || extensions.htmlPreserve || !splitBlocks(input, &blocks))
+   {
+      pCache->clear();
+      return markdownToHTML(markdownInput, extensions, options, pHTMLOutput);
+   }
+
+   Extensions blockExtensions = extensions;
+   blockExtensions.stripMetadata = false;
+
+   pCache->startRender(renderOptionsKey(extensions, options));
+   BOOST_FOREACH(const std::string& block, blocks)
+   {
+      std::string html;
+      if (!pCache->lookup(block, &html))
+      {
+         Error error = markdownToHTML(block, blockExtensions, options, &html);
+         if (error)
+         {
+            pCache->clear();
+            return error;
+         }
+         pCache->add(block, html);
+      }
+
+      // sundown separates the blocks it renders with a newline
+      if (!pHTMLOutput->empty() && !boost::algorithm::starts_with(html, "\n"))
+         pHTMLOutput->push_back('\n');
+      pHTMLOutput->append(html);
+   }
+   pCache->finishRender();
+
+   return Success();
+}
+
 bool isMathJaxRequired(const std::string& htmlOutput)
 {
    return requiresMathjax(htmlOutput);
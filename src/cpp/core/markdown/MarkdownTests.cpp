@@ -0,0 +1,116 @@
+/*
+ * MarkdownTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <string>
+
+#include <core/Error.hpp>
+#include <core/markdown/Markdown.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace markdown {
+namespace tests {
+
+namespace {
+
+const char * const kDocument =
+   "---\n"
+   "title: Example\n"
+   "---\n"
+   "\n"
+   "# Heading\n"
+   "\n"
+   "Some *text* with \"quotes\".\n"
+   "\n"
+   "- one\n"
+   "\n"
+   "- two\n"
+   "\n"
+   "A paragraph\n"
+   "over two lines\n"
+   "\n"
+   "```r\n"
+   "x <- 1\n"
+   "\n"
+   "y <- 2\n"
+   "```\n"
+   "\n"
+   "    indented\n"
+   "\n"
+   "    code\n"
+   "\n"
+   "The end.\n";
+
+std::string renderWhole(const std::string& input)
+{
+   std::string html;
+   Error error = markdownToHTML(input, Extensions(), HTMLOptions(), &html);
+   expect_true(!error);
+   return html;
+}
+
+std::string renderCached(const std::string& input, BlockCache* pCache)
+{
+   std::string html;
+   Error error = markdownToHTML(input, Extensions(), HTMLOptions(), pCache,
+                                &html);
+   expect_true(!error);
+   return html;
+}
+
+} // anonymous namespace
+
+context("MarkdownBlockCache")
+{
+   test_that("Rendering by block matches rendering the whole document")
+   {
+      BlockCache cache;
+      std::string document(kDocument);
+      expect_true(renderCached(document, &cache) == renderWhole(document));
+      expect_true(cache.renderedCount() == cache.size());
+   }
+
+   test_that("Only changed blocks are re-rendered")
+   {
+      BlockCache cache;
+      std::string document(kDocument);
+      renderCached(document, &cache);
+
+      expect_true(renderCached(document, &cache) == renderWhole(document));
+      expect_true(cache.renderedCount() == 0);
+
+      std::string edited = document;
+      edited.replace(edited.find("A paragraph"), 11, "An edited paragraph");
+      expect_true(renderCached(edited, &cache) == renderWhole(edited));
+      expect_true(cache.renderedCount() == 1);
+   }
+
+   test_that("Documents with link references are rendered whole")
+   {
+      BlockCache cache;
+      std::string document = "See [the docs][docs].\n"
+                             "\n"
+                             "[docs]: https://www.rstudio.com\n";
+      expect_true(renderCached(document, &cache) == renderWhole(document));
+      expect_true(cache.size() == 0);
+   }
+}
+
+} // namespace tests
+} // namespace markdown
+} // namespace core
+} // namespace rstudio
@@ -15,12 +15,15 @@
 
 #include <core/r_util/RActiveSessions.hpp>
 
+#include <ctime>
+
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
 #include <core/StringUtils.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/json/JsonRpc.hpp>
 
 #include <core/system/System.hpp>
 #include <core/system/FileMonitor.hpp>
@@ -35,6 +38,124 @@ namespace r_util {
 
 namespace {
 
+// index of the properties of all of a user's sessions, so that listing
+// sessions needn't read every property file of every session (which is
+// slow on network file systems). an entry is used only while the session's
+// properties directory is unchanged (property writes rename a new file into
+// place, which updates the directory's modification time) and only if it
+// was read well after that modification time, since mtimes have a
+// granularity of one second and the file server's clock may differ from
+// ours.
+const char * const kSessionIndexFile = ".session-index.json";
+const std::time_t kIndexSettleSeconds = 10;
+
+const char * const kIndexedProperties[] = {
+   "project", "working-dir", "initial", "last-used", "executing",
+   "save_prompt_required", "running", "r-version", "r-version-home",
+   "r-version-label", "label"
+};
+
+struct IndexEntry
+{
+   IndexEntry() : modified(0), read(0) {}
+
+   bool usable(std::time_t propertiesModified) const
+   {
+      return modified == propertiesModified &&
+             read > modified + kIndexSettleSeconds;
+   }
+
+   std::time_t modified;
+   std::time_t read;
+   std::map<std::string,std::string> properties;
+};
+
+typedef std::map<std::string,IndexEntry> SessionIndex;
+
+void readSessionIndex(const FilePath& indexPath, SessionIndex* pIndex)
+{
+   if (!indexPath.exists())
+      return;
+
+   std::string contents;
+   Error error = core::readStringFromFile(indexPath, &contents);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   // the index is only a cache, so anything unexpected just means we don't
+   // use it
+   json::Value indexJson;
+   if (!json::parse(contents, &indexJson) ||
+       !json::isType<json::Object>(indexJson))
+      return;
+
+   BOOST_FOREACH(const json::Member& member, indexJson.get_obj())
+   {
+      if (!json::isType<json::Object>(member.second))
+         continue;
+
+      const json::Object& entryJson = member.second.get_obj();
+      json::Object propertiesJson;
+      double modified, read;
+      Error error = json::readObject(entryJson,
+                                     "modified", &modified,
+                                     "read", &read,
+                                     "properties", &propertiesJson);
+      if (error)
+         continue;
+
+      IndexEntry entry;
+      entry.modified = static_cast<std::time_t>(modified);
+      entry.read = static_cast<std::time_t>(read);
+      BOOST_FOREACH(const json::Member& property, propertiesJson)
+      {
+         if (json::isType<std::string>(property.second))
+            entry.properties[property.first] = property.second.get_str();
+      }
+      (*pIndex)[member.first] = entry;
+   }
+}
+
+void writeSessionIndex(const FilePath& indexPath, const SessionIndex& index)
+{
+   json::Object indexJson;
+   BOOST_FOREACH(const SessionIndex::value_type& session, index)
+   {
+      json::Object propertiesJson;
+      typedef std::map<std::string,std::string>::value_type Property;
+      BOOST_FOREACH(const Property& property, session.second.properties)
+      {
+         propertiesJson[property.first] = property.second;
+      }
+
+      json::Object entryJson;
+      entryJson["modified"] = static_cast<double>(session.second.modified);
+      entryJson["read"] = static_cast<double>(session.second.read);
+      entryJson["properties"] = propertiesJson;
+      indexJson[session.first] = entryJson;
+   }
+
+   // write then rename, so concurrent readers see the old or new index
+   FilePath tempPath = indexPath.parent().childPath(
+            indexPath.filename() + "." + core::system::generateShortenedUuid());
+   Error error = core::writeStringToFile(tempPath, json::write(indexJson));
+   if (!error)
+      error = tempPath.move(indexPath);
+   if (error)
+   {
+      LOG_ERROR(error);
+      tempPath.removeIfExists();
+   }
+}
+
+bool isSessionDir(const FileInfo& fileInfo)
+{
+   return boost::algorithm::starts_with(
+            FilePath(fileInfo.absolutePath()).filename(), kSessionDirPrefix);
+}
 
 } // anonymous namespace
 
@@ -42,31 +163,54 @@ namespace {
 void ActiveSession::writeProperty(const std::string& name,
                                  const std::string& value) const
 {
+   // write then rename, so readers never see a partial value and the
+   // properties directory's modification time moves (see the session index)
    FilePath propertyFile = propertiesPath_.childPath(name);
-   Error error = core::writeStringToFile(propertyFile, value);
+   FilePath tempFile = propertiesPath_.childPath(name + ".new");
+   Error error = core::writeStringToFile(tempFile, value);
+   if (!error)
+      error = tempFile.move(propertyFile);
    if (error)
       LOG_ERROR(error);
+
+   if (hasSnapshot_)
+      snapshot_[name] = boost::algorithm::trim_copy(value);
 }
 
 std::string ActiveSession::readProperty(const std::string& name) const
 {
-   using namespace rstudio::core;
+   if (hasSnapshot_)
+   {
+      std::map<std::string,std::string>::const_iterator it =
+                                                      snapshot_.find(name);
+      if (it != snapshot_.end())
+         return it->second;
+   }
+
+   std::string value;
    FilePath readPath = propertiesPath_.childPath(name);
    if (readPath.exists())
    {
-      std::string value;
       Error error = core::readStringFromFile(readPath, &value);
       if (error)
       {
          LOG_ERROR(error);
          return std::string();
       }
-      return boost::algorithm::trim_copy(value);
-   }
-   else
-   {
-      return std::string();
+      boost::algorithm::trim(value);
    }
+
+   if (hasSnapshot_)
+      snapshot_[name] = value;
+
+   return value;
+}
+
+void ActiveSession::setSnapshot(
+               const std::map<std::string,std::string>& properties) const
+{
+   snapshot_ = properties;
+   hasSnapshot_ = true;
 }
 
 Error ActiveSessions::create(const std::string& project,
@@ -149,6 +293,15 @@ std::vector<boost::shared_ptr<ActiveSession> > ActiveSessions::list(
       LOG_ERROR(error);
       return sessions;
    }
+
+   // read the index of session properties
+   FilePath indexPath = storagePath_.childPath(kSessionIndexFile);
+   SessionIndex index;
+   readSessionIndex(indexPath, &index);
+   SessionIndex updatedIndex;
+   bool indexChanged = false;
+   std::time_t now = ::time(NULL);
+
    std::string prefix = kSessionDirPrefix;
    BOOST_FOREACH(const FilePath& child, children)
    {
@@ -158,9 +311,40 @@ std::vector<boost::shared_ptr<ActiveSession> > ActiveSessions::list(
          boost::shared_ptr<ActiveSession> pSession = get(id);
          if (!pSession->empty())
          {
+            // use the indexed properties if they're still current and
+            // otherwise read (and index) them
+            IndexEntry entry;
+            entry.modified = pSession->propertiesPath_.lastWriteTime();
+            SessionIndex::const_iterator it = index.find(id);
+            if (it != index.end() && it->second.usable(entry.modified))
+            {
+               entry = it->second;
+               pSession->setSnapshot(entry.properties);
+            }
+            else
+            {
+               pSession->setSnapshot(std::map<std::string,std::string>());
+               BOOST_FOREACH(const char* property, kIndexedProperties)
+               {
+                  pSession->readProperty(property);
+               }
+               entry.read = now;
+               entry.properties = pSession->snapshot();
+
+               // rewrite the index if the properties changed or if the
+               // entry will now be usable
+               if (it == index.end() ||
+                   it->second.properties != entry.properties ||
+                   entry.usable(entry.modified))
+               {
+                  indexChanged = true;
+               }
+            }
+
             if (pSession->validate(userHomePath, projectSharingEnabled))
             {
                sessions.push_back(pSession);
+               updatedIndex[id] = entry;
             }
             else
             {
@@ -177,6 +361,10 @@ std::vector<boost::shared_ptr<ActiveSession> > ActiveSessions::list(
 
    }
 
+   // persist the index if it changed (including sessions going away)
+   if (indexChanged || updatedIndex.size() != index.size())
+      writeSessionIndex(indexPath, updatedIndex);
+
    // sort by activity level (most active sessions first)
    std::sort(sessions.begin(), sessions.end(), compareActivityLevel);
 
@@ -278,10 +466,11 @@ void trackActiveSessionCount(const FilePath& rootStoragePath,
                                    onCountChanged);
    cb.onRegistrationError = boost::bind(log::logError, _1, ERROR_LOCATION);
 
+   // (only session directories -- not e.g. the session index)
    core::system::file_monitor::registerMonitor(
                    pSessions->storagePath(),
                    false,
-                   boost::function<bool(const FileInfo&)>(),
+                   isSessionDir,
                    cb);
 }
 
@@ -0,0 +1,72 @@
+/*
+ * RActiveSessionsTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/r_util/RActiveSessions.hpp>
+
+#include <core/FilePath.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace r_util {
+namespace tests {
+
+TEST_CASE("Active Sessions")
+{
+   FilePath storagePath;
+   REQUIRE_FALSE(FilePath::tempFilePath(&storagePath));
+   FilePath homePath = storagePath.childPath("home");
+   REQUIRE_FALSE(homePath.ensureDirectory());
+
+   ActiveSessions activeSessions(storagePath);
+
+   SECTION("Sessions are listed from their properties and the index")
+   {
+      std::string first, second;
+      REQUIRE_FALSE(activeSessions.create(kProjectNone, "~", &first));
+      REQUIRE_FALSE(activeSessions.create(kProjectNone, "~/work", &second));
+      activeSessions.get(second)->setExecuting(true);
+
+      std::vector<boost::shared_ptr<ActiveSession> > sessions =
+            activeSessions.list(homePath, false);
+      REQUIRE(sessions.size() == 2);
+      CHECK(sessions[0]->id() == second);
+      CHECK(sessions[0]->workingDir() == "~/work");
+      CHECK(activeSessions.storagePath().childPath(
+               ".session-index.json").exists());
+
+      // changes made after the index was written are seen
+      activeSessions.get(first)->setWorkingDir("~/other");
+      activeSessions.get(second)->setExecuting(false);
+      activeSessions.get(first)->setExecuting(true);
+
+      sessions = activeSessions.list(homePath, false);
+      REQUIRE(sessions.size() == 2);
+      CHECK(sessions[0]->id() == first);
+      CHECK(sessions[0]->workingDir() == "~/other");
+
+      // removed sessions drop out
+      REQUIRE_FALSE(activeSessions.get(first)->destroy());
+      CHECK(activeSessions.count(homePath, false) == 1);
+   }
+
+   storagePath.removeIfExists();
+}
+
+} // end namespace tests
+} // end namespace r_util
+} // end namespace core
+} // end namespace rstudio
@@ -19,6 +19,7 @@
 
 #include <core/Error.hpp>
 
+#include <core/collection/LruCache.hpp>
 #include <core/text/DcfParser.hpp>
 
 namespace rstudio {
@@ -67,15 +68,63 @@ void readField(const Container& container,
       *pField = defaultValue;
 }
 
+// package info as last read from a DESCRIPTION file (many consumers read the
+// same DESCRIPTION files repeatedly, so these are shared by all of them while
+// the file is unchanged)
+struct CachedPackageInfo
+{
+   CachedPackageInfo() : lastWriteTime(0), size(0) {}
+   std::time_t lastWriteTime;
+   uintmax_t size;
+   RPackageInfo packageInfo;
+};
+
+collection::LruCache<std::string, CachedPackageInfo>& packageInfoCache()
+{
+   // (allocated so that it's never destroyed, as it may be used at exit)
+   static collection::LruCache<std::string, CachedPackageInfo>* pCache =
+         new collection::LruCache<std::string, CachedPackageInfo>(100);
+   return *pCache;
+}
+
 } // anonymous namespace
 
 
 Error RPackageInfo::read(const FilePath& packageDir)
 {
-   // parse DCF file
    FilePath descFilePath = packageDir.childPath("DESCRIPTION");
    if (!descFilePath.exists())
       return core::fileNotFoundError(descFilePath, ERROR_LOCATION);
+
+   // use the cached info if the file hasn't changed since it was read
+   CachedPackageInfo cached;
+   std::time_t lastWriteTime = descFilePath.lastWriteTime();
+   uintmax_t size = descFilePath.size();
+   if (packageInfoCache().get(descFilePath.absolutePath(), &cached) &&
+       cached.lastWriteTime == lastWriteTime && cached.size == size)
+   {
+      *this = cached.packageInfo;
+      return Success();
+   }
+
+   // (read into a fresh object so no fields are left over from before)
+   RPackageInfo packageInfo;
+   Error error = packageInfo.readDescription(descFilePath);
+   if (error)
+      return error;
+   *this = packageInfo;
+
+   cached.lastWriteTime = lastWriteTime;
+   cached.size = size;
+   cached.packageInfo = packageInfo;
+   packageInfoCache().insert(descFilePath.absolutePath(), cached);
+
+   return Success();
+}
+
+Error RPackageInfo::readDescription(const FilePath& descFilePath)
+{
+   // parse DCF file
    std::string errMsg;
    std::map<std::string,std::string> fields;
    Error error = text::parseDcfFile(descFilePath, true, &fields, &errMsg);
@@ -0,0 +1,298 @@
+/*
+ * RSourceIndexCache.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/r_util/RSourceIndexCache.hpp>
+
+#include <cstring>
+#include <iostream>
+
+#include <boost/foreach.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/Hash.hpp>
+#include <core/r_util/RSourceIndex.hpp>
+
+namespace rstudio {
+namespace core {
+namespace r_util {
+
+namespace {
+
+const char * const kCacheFileHeader = "RSTUDIO-SOURCE-INDEX-2\n";
+
+// guard against allocating absurd amounts of memory for a corrupt cache
+const boost::uint32_t kMaxStringLength = 1024 * 1024;
+
+template <typename T>
+void writeValue(std::ostream& os, T value)
+{
+   os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& is, T* pValue)
+{
+   is.read(reinterpret_cast<char*>(pValue), sizeof(T));
+   return is.good();
+}
+
+void writeString(std::ostream& os, const std::string& value)
+{
+   writeValue<boost::uint32_t>(os, static_cast<boost::uint32_t>(value.size()));
+   os.write(value.data(), value.size());
+}
+
+bool readString(std::istream& is, std::string* pValue)
+{
+   boost::uint32_t length = 0;
+   if (!readValue(is, &length) || length > kMaxStringLength)
+      return false;
+
+   pValue->resize(length);
+   if (length > 0)
+      is.read(&(*pValue)[0], length);
+   return is.good();
+}
+
+void writeIndex(std::ostream& os, boost::shared_ptr<RSourceIndex> pIndex)
+{
+   writeString(os, pIndex->context());
+
+   const std::vector<std::string>& packages = pIndex->getInferredPackages();
+   writeValue<boost::uint32_t>(os, static_cast<boost::uint32_t>(
+                                                      packages.size()));
+   BOOST_FOREACH(const std::string& package, packages)
+   {
+      writeString(os, package);
+   }
+
+   const std::vector<RSourceItem>& items = pIndex->items();
+   writeValue<boost::uint32_t>(os, static_cast<boost::uint32_t>(items.size()));
+   BOOST_FOREACH(const RSourceItem& item, items)
+   {
+      writeValue<boost::int32_t>(os, item.type());
+      writeString(os, item.name());
+      writeValue<boost::uint32_t>(os, static_cast<boost::uint32_t>(
+                                                   item.signature().size()));
+      BOOST_FOREACH(const RS4MethodParam& param, item.signature())
+      {
+         writeString(os, param.name());
+         writeString(os, param.type());
+      }
+      writeValue<boost::int32_t>(os, item.braceLevel());
+      writeValue<boost::int32_t>(os, item.line());
+      writeValue<boost::int32_t>(os, item.column());
+   }
+}
+
+bool readIndex(std::istream& is, boost::shared_ptr<RSourceIndex>* pIndex)
+{
+   std::string context;
+   if (!readString(is, &context))
+      return false;
+
+   boost::shared_ptr<RSourceIndex> pReadIndex(new RSourceIndex(context));
+
+   boost::uint32_t packageCount = 0;
+   if (!readValue(is, &packageCount))
+      return false;
+   for (boost::uint32_t i = 0; i < packageCount; i++)
+   {
+      std::string package;
+      if (!readString(is, &package))
+         return false;
+      pReadIndex->addInferredPackage(package);
+   }
+
+   boost::uint32_t itemCount = 0;
+   if (!readValue(is, &itemCount))
+      return false;
+   for (boost::uint32_t i = 0; i < itemCount; i++)
+   {
+      boost::int32_t type = 0;
+      std::string name;
+      boost::uint32_t paramCount = 0;
+      if (!readValue(is, &type) ||
+          !readString(is, &name) ||
+          !readValue(is, &paramCount))
+      {
+         return false;
+      }
+
+      std::vector<RS4MethodParam> signature;
+      for (boost::uint32_t j = 0; j < paramCount; j++)
+      {
+         std::string paramName, paramType;
+         if (!readString(is, &paramName) || !readString(is, &paramType))
+            return false;
+         signature.push_back(RS4MethodParam(paramName, paramType));
+      }
+
+      boost::int32_t braceLevel = 0, line = 0, column = 0;
+      if (!readValue(is, &braceLevel) ||
+          !readValue(is, &line) ||
+          !readValue(is, &column))
+      {
+         return false;
+      }
+
+      pReadIndex->addSourceItem(RSourceItem(type,
+                                            name,
+                                            signature,
+                                            braceLevel,
+                                            line,
+                                            column));
+   }
+
+   *pIndex = pReadIndex;
+   return true;
+}
+
+Error cacheFileError(const std::string& description,
+                     const FilePath& filePath,
+                     const ErrorLocation& location)
+{
+   Error error = systemError(boost::system::errc::io_error, location);
+   error.addProperty("description", description);
+   error.addProperty("path", filePath.absolutePath());
+   return error;
+}
+
+} // anonymous namespace
+
+void RSourceIndexCache::add(const std::string& path,
+                            std::time_t lastWriteTime,
+                            boost::uintmax_t size,
+                            const std::string& hash,
+                            boost::shared_ptr<RSourceIndex> pIndex)
+{
+   Entry entry;
+   entry.lastWriteTime = lastWriteTime;
+   entry.size = size;
+   entry.hash = hash;
+   entry.pIndex = pIndex;
+   entries_[path] = entry;
+}
+
+boost::shared_ptr<RSourceIndex> RSourceIndexCache::get(
+                                          const std::string& path,
+                                          std::time_t lastWriteTime,
+                                          boost::uintmax_t size,
+                                          std::string* pHash) const
+{
+   boost::unordered_map<std::string, Entry>::const_iterator it =
+                                                         entries_.find(path);
+   if (it == entries_.end() || it->second.size != size)
+      return boost::shared_ptr<RSourceIndex>();
+
+   const Entry& entry = it->second;
+   if (entry.lastWriteTime != lastWriteTime)
+   {
+      if (entry.hash.empty())
+         return boost::shared_ptr<RSourceIndex>();
+
+      std::string contentHash;
+      Error error = hash::crc32cHexHash(FilePath(path), &contentHash);
+      if (error || contentHash != entry.hash)
+         return boost::shared_ptr<RSourceIndex>();
+   }
+
+   if (pHash)
+      *pHash = entry.hash;
+   return entry.pIndex;
+}
+
+Error RSourceIndexCache::writeToFile(const FilePath& filePath) const
+{
+   boost::shared_ptr<std::ostream> pStream;
+   Error error = filePath.open_w(&pStream);
+   if (error)
+      return error;
+
+   std::ostream& os = *pStream;
+   os.write(kCacheFileHeader, std::strlen(kCacheFileHeader));
+
+   writeValue<boost::uint32_t>(os, static_cast<boost::uint32_t>(
+                                                      entries_.size()));
+   for (boost::unordered_map<std::string, Entry>::const_iterator it =
+           entries_.begin(); it != entries_.end(); ++it)
+   {
+      writeString(os, it->first);
+      writeValue<boost::int64_t>(os, static_cast<boost::int64_t>(
+                                                   it->second.lastWriteTime));
+      writeValue<boost::uint64_t>(os, static_cast<boost::uint64_t>(
+                                                   it->second.size));
+      writeString(os, it->second.hash);
+      writeIndex(os, it->second.pIndex);
+   }
+
+   os.flush();
+   if (!os.good())
+      return cacheFileError("Error writing cache", filePath, ERROR_LOCATION);
+
+   return Success();
+}
+
+Error RSourceIndexCache::readFromFile(const FilePath& filePath)
+{
+   clear();
+
+   boost::shared_ptr<std::istream> pStream;
+   Error error = filePath.open_r(&pStream);
+   if (error)
+      return error;
+
+   std::istream& is = *pStream;
+
+   std::string header(std::strlen(kCacheFileHeader), '\0');
+   is.read(&header[0], header.size());
+   if (!is.good() || header != kCacheFileHeader)
+      return cacheFileError("Invalid cache header", filePath, ERROR_LOCATION);
+
+   boost::uint32_t count = 0;
+   if (!readValue(is, &count))
+      return cacheFileError("Invalid cache", filePath, ERROR_LOCATION);
+
+   for (boost::uint32_t i = 0; i < count; i++)
+   {
+      std::string path;
+      boost::int64_t lastWriteTime = 0;
+      boost::uint64_t size = 0;
+      std::string hash;
+      boost::shared_ptr<RSourceIndex> pIndex;
+      if (!readString(is, &path) ||
+          !readValue(is, &lastWriteTime) ||
+          !readValue(is, &size) ||
+          !readString(is, &hash) ||
+          !readIndex(is, &pIndex))
+      {
+         clear();
+         return cacheFileError("Invalid cache entry", filePath, ERROR_LOCATION);
+      }
+
+      add(path,
+          static_cast<std::time_t>(lastWriteTime),
+          static_cast<boost::uintmax_t>(size),
+          hash,
+          pIndex);
+   }
+
+   return Success();
+}
+
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
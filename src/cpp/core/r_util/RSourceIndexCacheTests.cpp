@@ -0,0 +1,124 @@
+/*
+ * RSourceIndexCacheTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/r_util/RSourceIndexCache.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/r_util/RSourceIndex.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace r_util {
+namespace tests {
+
+context("RSourceIndexCacheTests")
+{
+   test_that("Indexes are read back as written")
+   {
+      boost::shared_ptr<RSourceIndex> pIndex(new RSourceIndex("R/foo.R"));
+      pIndex->addInferredPackage("utils");
+      pIndex->addSourceItem(RSourceItem(RSourceItem::Function,
+                                        "foo",
+                                        std::vector<RS4MethodParam>(),
+                                        0, 3, 1));
+      std::vector<RS4MethodParam> signature;
+      signature.push_back(RS4MethodParam("x", "numeric"));
+      pIndex->addSourceItem(RSourceItem(RSourceItem::Method,
+                                        "bar",
+                                        signature,
+                                        1, 10, 5));
+
+      RSourceIndexCache cache;
+      cache.add("/project/R/foo.R", 1000, 42, "E3069283", pIndex);
+
+      FilePath cachePath;
+      REQUIRE(!FilePath::tempFilePath(&cachePath));
+      REQUIRE(!cache.writeToFile(cachePath));
+
+      RSourceIndexCache readCache;
+      REQUIRE(!readCache.readFromFile(cachePath));
+      cachePath.remove();
+
+      REQUIRE(readCache.size() == 1);
+      std::string hash;
+      boost::shared_ptr<RSourceIndex> pReadIndex =
+                        readCache.get("/project/R/foo.R", 1000, 42, &hash);
+      REQUIRE(pReadIndex);
+      expect_true(hash == "E3069283");
+      REQUIRE(pReadIndex->getInferredPackages().size() == 1);
+      expect_true(pReadIndex->getInferredPackages()[0] == "utils");
+
+      const std::vector<RSourceItem>& items = pReadIndex->items();
+      REQUIRE(items.size() == 2);
+      expect_true(items[0].isFunction());
+      expect_true(items[0].name() == "foo");
+      expect_true(items[0].line() == 3);
+      expect_true(items[1].isMethod());
+      expect_true(items[1].braceLevel() == 1);
+      expect_true(items[1].column() == 5);
+      REQUIRE(items[1].signature().size() == 1);
+      expect_true(items[1].signature()[0].name() == "x");
+      expect_true(items[1].signature()[0].type() == "numeric");
+   }
+
+   test_that("Stale entries are not returned")
+   {
+      RSourceIndexCache cache;
+      cache.add("/project/R/foo.R", 1000, 42, "",
+                boost::shared_ptr<RSourceIndex>(new RSourceIndex("R/foo.R")));
+
+      expect_true(cache.get("/project/R/foo.R", 1000, 42));
+      expect_false(cache.get("/project/R/foo.R", 1001, 42));
+      expect_false(cache.get("/project/R/foo.R", 1000, 43));
+      expect_false(cache.get("/project/R/bar.R", 1000, 42));
+   }
+
+   test_that("Entries for touched but unchanged files are returned")
+   {
+      FilePath filePath;
+      REQUIRE(!FilePath::tempFilePath(&filePath));
+      REQUIRE(!writeStringToFile(filePath, "123456789"));
+
+      RSourceIndexCache cache;
+      cache.add(filePath.absolutePath(), 1000, 9, "E3069283",
+                boost::shared_ptr<RSourceIndex>(new RSourceIndex("R/foo.R")));
+      expect_true(cache.get(filePath.absolutePath(), 1001, 9));
+
+      REQUIRE(!writeStringToFile(filePath, "987654321"));
+      expect_false(cache.get(filePath.absolutePath(), 1001, 9));
+      filePath.remove();
+   }
+
+   test_that("Invalid cache files are rejected")
+   {
+      FilePath cachePath;
+      REQUIRE(!FilePath::tempFilePath(&cachePath));
+      REQUIRE(!writeStringToFile(cachePath, "not a cache"));
+
+      RSourceIndexCache cache;
+      expect_true(cache.readFromFile(cachePath));
+      expect_true(cache.empty());
+      cachePath.remove();
+   }
+}
+
+} // namespace tests
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,167 @@
+/*
+ * RSourceSymbolIndex.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/r_util/RSourceSymbolIndex.hpp>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <core/StringUtils.hpp>
+
+namespace rstudio {
+namespace core {
+namespace r_util {
+
+namespace {
+
+bool isSymbolFrom(const RSourceSymbolIndex::Symbol& symbol,
+                  boost::shared_ptr<RSourceIndex> pIndex)
+{
+   return symbol.pIndex == pIndex;
+}
+
+} // anonymous namespace
+
+void RSourceSymbolIndex::add(const std::string& path,
+                             boost::shared_ptr<RSourceIndex> pIndex)
+{
+   std::map<std::string, boost::shared_ptr<RSourceIndex> >::iterator it =
+                                                         indexes_.find(path);
+   if (it != indexes_.end())
+   {
+      removeSymbols(it->second);
+      indexes_.erase(it);
+   }
+
+   if (!pIndex)
+      return;
+
+   indexes_[path] = pIndex;
+
+   const std::vector<RSourceItem>& items = pIndex->items();
+   for (std::size_t i = 0; i < items.size(); i++)
+   {
+      const InternedString& name = items[i].internedName();
+      Symbol symbol(pIndex, i);
+      symbolsByName_[name].push_back(symbol);
+      symbolsByLowerName_.insert(
+               std::make_pair(string_utils::toLower(name.str()), symbol));
+   }
+}
+
+void RSourceSymbolIndex::remove(const std::string& path)
+{
+   typedef std::map<std::string, boost::shared_ptr<RSourceIndex> >::iterator
+                                                                  iterator;
+
+   iterator it = indexes_.find(path);
+   if (it != indexes_.end())
+   {
+      removeSymbols(it->second);
+      indexes_.erase(it);
+   }
+
+   // files within the path (if it was a directory) sort contiguously
+   std::string dirPrefix = path + "/";
+   it = indexes_.lower_bound(dirPrefix);
+   while (it != indexes_.end() &&
+          boost::algorithm::starts_with(it->first, dirPrefix))
+   {
+      removeSymbols(it->second);
+      indexes_.erase(it++);
+   }
+}
+
+void RSourceSymbolIndex::clear()
+{
+   indexes_.clear();
+   symbolsByName_.clear();
+   symbolsByLowerName_.clear();
+}
+
+const std::vector<RSourceSymbolIndex::Symbol>& RSourceSymbolIndex::find(
+                                             const std::string& name) const
+{
+   static const std::vector<Symbol> kNoSymbols;
+
+   // a name which was never interned can't be the name of any symbol
+   InternedString interned;
+   if (!InternedString::find(name, &interned))
+      return kNoSymbols;
+
+   boost::unordered_map<InternedString, std::vector<Symbol> >::const_iterator
+                                       it = symbolsByName_.find(interned);
+   if (it == symbolsByName_.end())
+      return kNoSymbols;
+   return it->second;
+}
+
+void RSourceSymbolIndex::visitPrefix(const std::string& prefix,
+                                     const SymbolVisitor& visitor) const
+{
+   std::string lowerPrefix = string_utils::toLower(prefix);
+   for (std::multimap<std::string, Symbol>::const_iterator it =
+           symbolsByLowerName_.lower_bound(lowerPrefix);
+        it != symbolsByLowerName_.end() &&
+           boost::algorithm::starts_with(it->first, lowerPrefix);
+        ++it)
+   {
+      if (!visitor(it->second))
+         return;
+   }
+}
+
+void RSourceSymbolIndex::removeSymbols(boost::shared_ptr<RSourceIndex> pIndex)
+{
+   const std::vector<RSourceItem>& items = pIndex->items();
+   for (std::size_t i = 0; i < items.size(); i++)
+   {
+      // remove all the file's symbols for the name at once (the name may
+      // already be gone if it appeared more than once in the file)
+      const InternedString& name = items[i].internedName();
+      boost::unordered_map<InternedString, std::vector<Symbol> >::iterator
+                                          nameIt = symbolsByName_.find(name);
+      if (nameIt == symbolsByName_.end())
+         continue;
+
+      std::vector<Symbol>& symbols = nameIt->second;
+      std::vector<Symbol>::iterator removed =
+            std::remove_if(symbols.begin(),
+                           symbols.end(),
+                           boost::bind(isSymbolFrom, _1, pIndex));
+      if (removed == symbols.end())
+         continue;
+      symbols.erase(removed, symbols.end());
+      if (symbols.empty())
+         symbolsByName_.erase(nameIt);
+
+      typedef std::multimap<std::string, Symbol>::iterator iterator;
+      std::pair<iterator, iterator> range =
+            symbolsByLowerName_.equal_range(string_utils::toLower(name.str()));
+      for (iterator it = range.first; it != range.second; )
+      {
+         if (isSymbolFrom(it->second, pIndex))
+            symbolsByLowerName_.erase(it++);
+         else
+            ++it;
+      }
+   }
+}
+
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
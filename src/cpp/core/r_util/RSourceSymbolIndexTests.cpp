@@ -0,0 +1,126 @@
+/*
+ * RSourceSymbolIndexTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/r_util/RSourceSymbolIndex.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace r_util {
+namespace tests {
+
+namespace {
+
+boost::shared_ptr<RSourceIndex> makeIndex(const std::string& path,
+                                          const std::vector<std::string>& names)
+{
+   boost::shared_ptr<RSourceIndex> pIndex(new RSourceIndex(path));
+   for (std::size_t i = 0; i < names.size(); i++)
+   {
+      pIndex->addSourceItem(RSourceItem(RSourceItem::Function,
+                                        names[i],
+                                        std::vector<RS4MethodParam>(),
+                                        0,
+                                        static_cast<int>(i + 1),
+                                        1));
+   }
+   return pIndex;
+}
+
+bool collectName(std::vector<std::string>* pNames,
+                 const RSourceSymbolIndex::Symbol& symbol)
+{
+   pNames->push_back(symbol.sourceItem().name());
+   return true;
+}
+
+std::vector<std::string> prefixNames(const RSourceSymbolIndex& index,
+                                     const std::string& prefix)
+{
+   std::vector<std::string> names;
+   index.visitPrefix(prefix, boost::bind(collectName, &names, _1));
+   return names;
+}
+
+} // anonymous namespace
+
+context("RSourceSymbolIndexTests")
+{
+   std::vector<std::string> fooNames;
+   fooNames.push_back("plotData");
+   fooNames.push_back("readData");
+   fooNames.push_back("plotAll");
+
+   std::vector<std::string> barNames;
+   barNames.push_back("PlotBar");
+   barNames.push_back("readData");
+
+   test_that("Symbols are found by name")
+   {
+      RSourceSymbolIndex index;
+      index.add("/p/R/foo.R", makeIndex("R/foo.R", fooNames));
+      index.add("/p/R/bar.R", makeIndex("R/bar.R", barNames));
+
+      expect_true(index.find("readData").size() == 2);
+      REQUIRE(index.find("plotAll").size() == 1);
+      expect_true(index.find("plotAll")[0].sourceItem().line() == 3);
+      expect_true(index.find("plotall").empty());
+      expect_true(index.find("missing").empty());
+   }
+
+   test_that("Prefix searches ignore case and are ordered by name")
+   {
+      RSourceSymbolIndex index;
+      index.add("/p/R/foo.R", makeIndex("R/foo.R", fooNames));
+      index.add("/p/R/bar.R", makeIndex("R/bar.R", barNames));
+
+      std::vector<std::string> names = prefixNames(index, "plot");
+      REQUIRE(names.size() == 3);
+      expect_true(names[0] == "plotAll");
+      expect_true(names[1] == "PlotBar");
+      expect_true(names[2] == "plotData");
+
+      expect_true(prefixNames(index, "READ").size() == 2);
+      expect_true(prefixNames(index, "x").empty());
+   }
+
+   test_that("Replaced and removed files no longer contribute symbols")
+   {
+      RSourceSymbolIndex index;
+      index.add("/p/R/foo.R", makeIndex("R/foo.R", fooNames));
+      index.add("/p/R/bar.R", makeIndex("R/bar.R", barNames));
+
+      index.add("/p/R/foo.R", makeIndex("R/foo.R", barNames));
+      expect_true(index.find("plotAll").empty());
+      expect_true(index.find("PlotBar").size() == 2);
+      expect_true(prefixNames(index, "plot").size() == 2);
+
+      index.remove("/p/R/bar.R");
+      expect_true(index.find("PlotBar").size() == 1);
+
+      // removing a directory removes the files within it
+      index.add("/p/R2/baz.R", makeIndex("R2/baz.R", fooNames));
+      index.remove("/p/R");
+      expect_true(index.find("PlotBar").empty());
+      expect_true(index.find("plotAll").size() == 1);
+      expect_true(prefixNames(index, "").size() == 3);
+   }
+}
+
+} // namespace tests
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
@@ -13,24 +13,9 @@
  *
  */
 
-// A very low level assertion (line 595 of cpp_regex_traits.hpp) is firing
-// on WindowsXP when we create a boost::wregex within R session. This code
-// is part of boost attempting to detect the sort syntax, and the assertion
-// is that there are no nulls in a buffer after a call to locale->transform.
-// Within the same method there are workarounds for both borland c++ and
-// dinkumware c++ std library to strip embedded nulls, so it seems as if
-// there is some variation in whether nulls come out of the call to transforn.
-// Note also that boost has a macro titled BOOST_REGEX_NO_WIN32 which we are
-// not using, which means that boost regex does call into native windows APIs
-// for locale oriented functions (thus explaining a difference in runtime
-// behavior across platforms). Tokenization appears to continue to work
-// correctly in the presence of the assertion (with the annoying side effect
-// of logging an assertion every time the product starts up)
-
 #include <core/r_util/RTokenizer.hpp>
 
-#include <boost/regex.hpp>
-
+#include <cwctype>
 #include <iostream>
 #include <sstream>
 
@@ -45,419 +30,706 @@ namespace r_util {
 
 namespace {
 
-class TokenPatterns
+// Character classes of the ASCII characters; other characters are
+// classified by their code point (see RTokenScanner)
+enum CharClass
 {
-private:
-   friend TokenPatterns& tokenPatterns();
-   TokenPatterns()
-      : NUMBER(L"[0-9]*(\\.[0-9]*)?([eE][+-]?[0-9]*)?[Li]?"),
-        HEX_NUMBER(L"0x[0-9a-fA-F]*L?"),
-        USER_OPERATOR(L"%[^%]*%"),
-        QUOTED_IDENTIFIER(L"`[^`]*`"),
-        UNTIL_END_QUOTE(L"[\\\\\'\"]"),
-        WHITESPACE(L"[\\s\x00A0\x3000]+"),
-        COMMENT(L"#[^\\n]*$")
+   kCharDigit      = 1 << 0,
+   kCharHexDigit   = 1 << 1,
+   kCharAlpha      = 1 << 2,
+   kCharWhitespace = 1 << 3
+};
+
+class CharClassTable
+{
+public:
+   CharClassTable()
    {
+      for (int c = 0; c < 128; c++)
+      {
+         unsigned char flags = 0;
+         if (c >= '0' && c <= '9')
+            flags |= kCharDigit | kCharHexDigit;
+         if ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+            flags |= kCharHexDigit;
+         if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+            flags |= kCharAlpha;
+         if (c == ' ' || (c >= '\t' && c <= '\r'))
+            flags |= kCharWhitespace;
+         table_[c] = flags;
+      }
    }
 
-public:
-   const boost::wregex NUMBER;
-   const boost::wregex HEX_NUMBER;
-   const boost::wregex USER_OPERATOR;
-   const boost::wregex QUOTED_IDENTIFIER;
-   const boost::wregex UNTIL_END_QUOTE;
-   const boost::wregex WHITESPACE;
-   const boost::wregex COMMENT;
+   bool is(unsigned long c, unsigned char flags) const
+   {
+      return c < 128 && (table_[c] & flags);
+   }
+
+private:
+   unsigned char table_[128];
 };
 
-TokenPatterns& tokenPatterns()
+const CharClassTable& charClasses()
 {
-   static TokenPatterns instance;
+   static CharClassTable instance;
    return instance;
 }
 
-void updatePosition(std::wstring::const_iterator pos,
-                    std::size_t length,
-                    std::size_t* pRow,
-                    std::size_t* pColumn)
+// The operators and identifiers which have subtypes
+struct SubtypeEntry
 {
-   std::size_t newlineCount;
-   std::wstring::const_iterator it =
-         string_utils::countNewlines(pos, pos + length, &newlineCount);
-   
-   if (newlineCount == 0)
+   const char* text;
+   std::size_t length;
+   RToken::TokenSubtype subtype;
+};
+
+constexpr SubtypeEntry kOperatorSubtypes[] = {
+   { "=",   1, RToken::ASSIGN_EQUALS },
+   { "<-",  2, RToken::ASSIGN_LEFT },
+   { "<<-", 3, RToken::ASSIGN_LEFT_PARENT },
+   { ":=",  2, RToken::ASSIGN_COLON_EQUALS },
+   { "->",  2, RToken::ASSIGN_RIGHT },
+   { "->>", 3, RToken::ASSIGN_RIGHT_PARENT },
+   { "$",   1, RToken::DOLLAR },
+   { "@",   1, RToken::AT },
+   { "::",  2, RToken::NAMESPACE_EXPORTS },
+   { ":::", 3, RToken::NAMESPACE_ALL },
+   { "!",   1, RToken::NOT },
+   { "-",   1, RToken::MINUS },
+   { "+",   1, RToken::PLUS },
+   { "?",   1, RToken::HELP },
+   { "~",   1, RToken::FORMULA }
+};
+
+constexpr SubtypeEntry kIdentifierSubtypes[] = {
+   { "function",      8,  RToken::KEYWORD_FUNCTION },
+   { "NA",            2,  RToken::KEYWORD_NA },
+   { "NA_character_", 13, RToken::KEYWORD_NA },
+   { "NA_complex_",   11, RToken::KEYWORD_NA },
+   { "NA_integer_",   11, RToken::KEYWORD_NA },
+   { "NA_real_",      8,  RToken::KEYWORD_NA }
+};
+
+// Code unit handling for the tokenizers: wide strings have a character per
+// code unit, UTF-8 encodes characters as sequences of one to four bytes
+template <typename CharT>
+struct CodeUnits;
+
+template <>
+struct CodeUnits<wchar_t>
+{
+   static unsigned long unit(wchar_t c)
    {
-      *pColumn += length;
+      return static_cast<unsigned long>(c);
    }
-   else
+
+   static std::size_t width(const wchar_t*, const wchar_t*)
    {
-      *pRow += newlineCount;
-      
-      // The column is now the token length, minus the
-      // index of the last newline.
-      *pColumn = length - (it - pos) - 1;
+      return 1;
    }
-}
 
-} // anonymous namespace
+   static unsigned long decode(const wchar_t* pos, const wchar_t*)
+   {
+      return unit(*pos);
+   }
 
-RToken RTokenizer::nextToken()
+   static bool startsCharacter(wchar_t)
+   {
+      return true;
+   }
+};
+
+template <>
+struct CodeUnits<char>
 {
-  if (eol())
-     return RToken() ;
-
-  wchar_t c = peek() ;
-
-  switch (c)
-  {
-  case L'(':
-     return consumeToken(RToken::LPAREN, 1);
-  case L')':
-     return consumeToken(RToken::RPAREN, 1);
-  case L'{':
-     return consumeToken(RToken::LBRACE, 1);
-  case L'}':
-     return consumeToken(RToken::RBRACE, 1);
-  case L';':
-     return consumeToken(RToken::SEMI, 1);
-  case L',':
-     return consumeToken(RToken::COMMA, 1);
-     
-  case L'[':
-  {
-     RToken token;
-     if (peek(1) == L'[')
-     {
-        braceStack_.push_back(RToken::LDBRACKET);
-        token = consumeToken(RToken::LDBRACKET, 2);
-     }
-     else
-     {
-        braceStack_.push_back(RToken::LBRACKET);
-        token = consumeToken(RToken::LBRACKET, 1);
-     }
-     return token;
-  }
-     
-  case L']':
-  {
-     if (braceStack_.empty()) // TODO: warn?
-     {
-        if (peek(1) == L']')
-           return consumeToken(RToken::RDBRACKET, 2) ;
-        else
-           return consumeToken(RToken::RBRACKET, 1);
-     }
-     else
-     {
-        RToken token;
-        if (peek(1) == L']')
-        {
-           wchar_t top = braceStack_[braceStack_.size() - 1];
-           if (top == RToken::LDBRACKET)
-              token = consumeToken(RToken::RDBRACKET, 2);
-           else
-              token = consumeToken(RToken::RBRACKET, 1);
-        }
-        else
-           token = consumeToken(RToken::RBRACKET, 1);
-        
-        braceStack_.pop_back();
-        return token;
-     }
-  }
-  case L'"':
-  case L'\'':
-     return matchStringLiteral() ;
-  case L'`':
-     return matchQuotedIdentifier();
-  case L'#':
-     return matchComment();
-  case L'%':
-     return matchUserOperator();
-  case L' ': case L'\t': case L'\r': case L'\n':
-  case L'\x00A0': case L'\x3000':
-     return matchWhitespace() ;
-  }
-
-  wchar_t cNext = peek(1) ;
-
-  if ((c >= L'0' && c <= L'9')
-        || (c == L'.' && cNext >= L'0' && cNext <= L'9'))
-  {
-     RToken numberToken = matchNumber() ;
-     if (numberToken.length() > 0)
-        return numberToken ;
-  }
-
-  if (string_utils::isalnum(c) || c == L'.')
-  {
-     // From Section 10.3.2, identifiers must not start with
-     // a digit, nor may they start with a period followed by
-     // a digit.
-     //
-     // Since we're not checking for either condition, we must
-     // match on identifiers AFTER we have already tried to
-     // match on number.
-     return matchIdentifier() ;
-  }
-
-  RToken oper = matchOperator() ;
-  if (oper)
-     return oper ;
-
-  // Error!!
-  return consumeToken(RToken::ERR, 1) ;
-}
+   static unsigned long unit(char c)
+   {
+      return static_cast<unsigned char>(c);
+   }
 
+   static std::size_t width(const char* pos, const char* end)
+   {
+      unsigned long lead = unit(*pos);
+      std::size_t width = 1;
+      if (lead >= 0xF0 && lead < 0xF8)
+         width = 4;
+      else if (lead >= 0xE0)
+         width = 3;
+      else if (lead >= 0xC0)
+         width = 2;
+
+      // don't run past a truncated sequence
+      std::size_t available = end - pos;
+      return std::min(width, available);
+   }
 
+   static unsigned long decode(const char* pos, const char* end)
+   {
+      std::size_t n = width(pos, end);
+      unsigned long lead = unit(*pos);
+      if (n == 1)
+         return lead;
 
-RToken RTokenizer::matchWhitespace()
-{
-   return consumeToken(RToken::WHITESPACE, tokenLength(tokenPatterns().WHITESPACE));
-}
+      unsigned long c = lead & (0xFF >> (n + 1));
+      for (std::size_t i = 1; i < n; i++)
+      {
+         unsigned long next = unit(pos[i]);
+         if ((next & 0xC0) != 0x80)
+            return 0xFFFD;
+         c = (c << 6) | (next & 0x3F);
+      }
+      return c;
+   }
 
-RToken RTokenizer::matchStringLiteral()
+   static bool startsCharacter(char c)
+   {
+      return (unit(c) & 0xC0) != 0x80;
+   }
+};
+
+// The tokenizer proper, shared by RTokenizer and RUtf8Tokenizer. Scans code
+// units from [begin, end), resuming from (and updating) the given state.
+template <typename CharT>
+class RTokenScanner
 {
-   std::wstring::const_iterator start = pos_ ;
-   wchar_t quot = eat() ;
+   typedef CodeUnits<CharT> Units;
 
-   while (!eol())
+public:
+   RTokenScanner(const CharT* begin,
+                 const CharT* end,
+                 RTokenizerState* pState)
+      : begin_(begin),
+        end_(end),
+        pos_(begin + pState->offset),
+        state_(*pState)
    {
-      eatUntil(tokenPatterns().UNTIL_END_QUOTE);
+   }
 
+   // scans the next token (returns false at the end of the code)
+   bool nextToken(RCompactToken* pToken)
+   {
+      bool result = scanToken(pToken);
+      state_.offset = pos_ - begin_;
+      return result;
+   }
+
+private:
+   bool scanToken(RCompactToken* pToken)
+   {
       if (eol())
-         break ;
+         return false;
+
+      unsigned long c = current();
 
-      wchar_t c = eat() ;
-      if (c == quot)
+      switch (c)
+      {
+      case '(':
+         return consumeToken(RToken::LPAREN, 1, pToken);
+      case ')':
+         return consumeToken(RToken::RPAREN, 1, pToken);
+      case '{':
+         return consumeToken(RToken::LBRACE, 1, pToken);
+      case '}':
+         return consumeToken(RToken::RBRACE, 1, pToken);
+      case ';':
+         return consumeToken(RToken::SEMI, 1, pToken);
+      case ',':
+         return consumeToken(RToken::COMMA, 1, pToken);
+
+      case '[':
       {
-         // NOTE: this is where we used to set wellFormed = true
-         break ;
+         if (peek(1) == '[')
+         {
+            state_.braceStack.push_back(RToken::LDBRACKET);
+            return consumeToken(RToken::LDBRACKET, 2, pToken);
+         }
+         else
+         {
+            state_.braceStack.push_back(RToken::LBRACKET);
+            return consumeToken(RToken::LBRACKET, 1, pToken);
+         }
       }
 
-      if (c == L'\\')
+      case ']':
       {
-         if (!eol())
-            eat() ;
+         if (state_.braceStack.empty()) // TODO: warn?
+         {
+            if (peek(1) == ']')
+               return consumeToken(RToken::RDBRACKET, 2, pToken);
+            else
+               return consumeToken(RToken::RBRACKET, 1, pToken);
+         }
+         else
+         {
+            bool result;
+            if (peek(1) == ']' &&
+                state_.braceStack.back() == RToken::LDBRACKET)
+               result = consumeToken(RToken::RDBRACKET, 2, pToken);
+            else
+               result = consumeToken(RToken::RBRACKET, 1, pToken);
+
+            state_.braceStack.pop_back();
+            return result;
+         }
+      }
+      case '"':
+      case '\'':
+         return matchStringLiteral(pToken);
+      case '`':
+         return matchDelimited(RToken::ID, '`', pToken);
+      case '#':
+         return matchComment(pToken);
+      case '%':
+         return matchDelimited(RToken::UOPER, '%', pToken);
+      case ' ': case '\t': case '\r': case '\n':
+      case 0x00A0: case 0x3000:
+         return matchWhitespace(pToken);
+      }
+
+      unsigned long cNext = peek(1);
+
+      if (isDigit(c) || (c == '.' && isDigit(cNext)))
+      {
+         std::size_t length = numberLength();
+         if (length > 0)
+            return consumeToken(RToken::NUMBER, length, pToken);
+      }
+
+      if (isAlnum(c) || c == '.')
+      {
+         // From Section 10.3.2, identifiers must not start with
+         // a digit, nor may they start with a period followed by
+         // a digit.
+         //
+         // Since we're not checking for either condition, we must
+         // match on identifiers AFTER we have already tried to
+         // match on number.
+         return matchIdentifier(pToken);
+      }
+
+      std::size_t length = operatorLength();
+      if (length > 0)
+         return consumeToken(RToken::OPER, length, pToken);
+
+      // Error!!
+      return consumeToken(RToken::ERR, Units::width(pos_, end_), pToken);
+   }
+
+   bool matchWhitespace(RCompactToken* pToken)
+   {
+      const CharT* it = pos_;
+      while (it < end_ && isWhitespace(Units::decode(it, end_)))
+         it += Units::width(it, end_);
+      return consumeToken(RToken::WHITESPACE, it - pos_, pToken);
+   }
+
+   bool matchStringLiteral(RCompactToken* pToken)
+   {
+      const CharT* it = pos_;
+      unsigned long quot = Units::unit(*it++);
+
+      while (it < end_)
+      {
+         // skip to the next quote or escape
+         while (it < end_)
+         {
+            unsigned long c = Units::unit(*it);
+            if (c == '\\' || c == '\'' || c == '"')
+               break;
+            it++;
+         }
+
+         if (it >= end_)
+            break;
+
+         unsigned long c = Units::unit(*it++);
+         if (c == quot)
+            break;
 
          // Actually the escape expression can be longer than
          // just the backslash plus one character--but we don't
          // need to distinguish escape expressions from other
          // literal text other than for the purposes of breaking
          // out of the string
+         if (c == '\\' && it < end_)
+            it++;
       }
+
+      return consumeToken(RToken::STRING, it - pos_, pToken);
    }
-   
-   std::size_t row = row_;
-   std::size_t column = column_;
-   updatePosition(start, pos_ - start, &row_, &column_); 
-
-   // NOTE: the Java version of the tokenizer returns a special RStringToken
-   // subclass which includes the wellFormed flag as an attribute. Our
-   // implementation of RToken is stack based so doesn't support subclasses
-   // (because they will be sliced when copied). If we need the well
-   // formed flag we can just add it onto RToken.
-   return RToken(RToken::STRING,
-                 start,
-                 pos_,
-                 start - data_.begin(),
-                 row,
-                 column);
-}
 
-RToken RTokenizer::matchNumber()
-{
-   std::size_t length = tokenLength(tokenPatterns().HEX_NUMBER);
-   if (length == 0)
-      length = tokenLength(tokenPatterns().NUMBER);
+   bool matchIdentifier(RCompactToken* pToken)
+   {
+      const CharT* it = pos_ + Units::width(pos_, end_);
+      while (it < end_)
+      {
+         unsigned long c = Units::decode(it, end_);
+         if (!isAlnum(c) && c != '.' && c != '_')
+            break;
+         it += Units::width(it, end_);
+      }
+      return consumeToken(RToken::ID, it - pos_, pToken);
+   }
 
-   return consumeToken(RToken::NUMBER, length);
-}
+   // `quoted identifiers` and %user operators%
+   bool matchDelimited(RToken::TokenType tokenType,
+                       unsigned long delimiter,
+                       RCompactToken* pToken)
+   {
+      for (const CharT* it = pos_ + 1; it < end_; it++)
+      {
+         if (Units::unit(*it) == delimiter)
+            return consumeToken(tokenType, it - pos_ + 1, pToken);
+      }
+      return consumeToken(RToken::ERR, 1, pToken);
+   }
 
-RToken RTokenizer::matchIdentifier()
-{
-   std::wstring::const_iterator start = pos_ ;
-   eat();
-   while (string_utils::isalnum(peek()) || peek() == L'.' || peek() == L'_')
-      eat();
-   
-   std::size_t row = row_;
-   std::size_t column = column_;
-   updatePosition(start, pos_ - start, &row_, &column_);
-   
-   return RToken(RToken::ID,
-                 start,
-                 pos_,
-                 start - data_.begin(),
-                 row,
-                 column);
-}
+   bool matchComment(RCompactToken* pToken)
+   {
+      const CharT* it = pos_;
+      while (it < end_ && Units::unit(*it) != '\n')
+         it++;
 
-RToken RTokenizer::matchQuotedIdentifier()
-{
-   std::size_t length = tokenLength(tokenPatterns().QUOTED_IDENTIFIER);
-   if (length == 0)
-      return consumeToken(RToken::ERR, 1);
-   else
-      return consumeToken(RToken::ID, length);
-}
+      // comments don't include the \r of a \r\n line ending
+      if (it < end_ && it - pos_ > 1 && Units::unit(*(it - 1)) == '\r')
+         it--;
 
-RToken RTokenizer::matchComment()
-{
-   return consumeToken(RToken::COMMENT, tokenLength(tokenPatterns().COMMENT));
-}
+      return consumeToken(RToken::COMMENT, it - pos_, pToken);
+   }
 
-RToken RTokenizer::matchUserOperator()
-{
-   std::size_t length = tokenLength(tokenPatterns().USER_OPERATOR);
-   if (length == 0)
-      return consumeToken(RToken::ERR, 1);
-   else
-      return consumeToken(RToken::UOPER, length);
-}
+   std::size_t numberLength()
+   {
+      std::size_t length = 0;
 
+      // hexadecimal: 0x[0-9a-fA-F]*L?
+      if (peek(0) == '0' && peek(1) == 'x')
+      {
+         length = 2;
+         while (charClasses().is(peek(length), kCharHexDigit))
+            length++;
+         if (peek(length) == 'L')
+            length++;
+         return length;
+      }
 
-RToken RTokenizer::matchOperator()
-{
-   wchar_t cNext = peek(1) ;
-   wchar_t cNextNext = peek(2);
-
-   switch (peek())
-   {
-   case L':': // :::, ::, :=
-   {
-      if (cNext == L'=')
-         return consumeToken(RToken::OPER, 2);
-      else
-         return consumeToken(RToken::OPER, 1 + (cNext == L':') + (cNextNext == L':'));
-   }
-      
-   case L'|':
-      return consumeToken(RToken::OPER, cNext == L'|' ? 2 : 1);
-      
-   case L'&':
-      return consumeToken(RToken::OPER, cNext == L'&' ? 2 : 1);
-      
-   case L'<': // <=, <-, <<-
-      
-      if (cNext == L'=' || cNext == L'-') // <=, <-
-         return consumeToken(RToken::OPER, 2);
-      else if (cNext == L'<')
+      // decimal: [0-9]*(\.[0-9]*)?([eE][+-]?[0-9]*)?[Li]?
+      while (isDigit(peek(length)))
+         length++;
+      if (peek(length) == '.')
+      {
+         length++;
+         while (isDigit(peek(length)))
+            length++;
+      }
+      if (peek(length) == 'e' || peek(length) == 'E')
       {
-         if (cNextNext == L'-') // <<-
-            return consumeToken(RToken::OPER, 3); 
+         length++;
+         if (peek(length) == '+' || peek(length) == '-')
+            length++;
+         while (isDigit(peek(length)))
+            length++;
       }
-      else // plain old <
-         return consumeToken(RToken::OPER, 1);
-      
-   case L'-': // also -> and ->>
-      if (cNext == L'>')
-         return consumeToken(RToken::OPER, cNextNext == L'>' ? 3 : 2);
-      else
-         return consumeToken(RToken::OPER, 1);
-      
-   case L'*': // '*' and '**' (which R's parser converts to '^')
-      return consumeToken(RToken::OPER, cNext == L'*' ? 2 : 1);
-      
-   case L'+': case L'/': case L'?':
-   case L'^': case L'~': case L'$': case L'@':
-      // single-character operators
-      return consumeToken(RToken::OPER, 1) ;
-      
-   case L'>': // also >=
-      return consumeToken(RToken::OPER, cNext == L'=' ? 2 : 1) ;
-      
-   case L'=': // also ==
-      return consumeToken(RToken::OPER, cNext == L'=' ? 2 : 1) ;
-   case L'!': // also !=
-      return consumeToken(RToken::OPER, cNext == L'=' ? 2 : 1) ;
-   default:
-      return RToken() ;
+      if (peek(length) == 'L' || peek(length) == 'i')
+         length++;
+
+      return length;
    }
-}
 
-bool RTokenizer::eol()
-{
-   return pos_ >= data_.end();
-}
+   std::size_t operatorLength()
+   {
+      unsigned long cNext = peek(1);
+      unsigned long cNextNext = peek(2);
 
-wchar_t RTokenizer::peek()
-{
-   return peek(0) ;
-}
+      switch (peek(0))
+      {
+      case ':': // :::, ::, :=
+         if (cNext == '=')
+            return 2;
+         return 1 + (cNext == ':') + (cNextNext == ':');
+
+      case '|':
+         return cNext == '|' ? 2 : 1;
+
+      case '&':
+         return cNext == '&' ? 2 : 1;
+
+      case '<': // <=, <-, <<-
+         if (cNext == '=' || cNext == '-')
+            return 2;
+         else if (cNext == '<' && cNextNext == '-')
+            return 3;
+         return 1;
+
+      case '-': // also -> and ->>
+         if (cNext == '>')
+            return cNextNext == '>' ? 3 : 2;
+         return 1;
+
+      case '*': // '*' and '**' (which R's parser converts to '^')
+         return cNext == '*' ? 2 : 1;
+
+      case '+': case '/': case '?':
+      case '^': case '~': case '$': case '@':
+         // single-character operators
+         return 1;
+
+      case '>': // also >=
+      case '=': // also ==
+      case '!': // also !=
+         return cNext == '=' ? 2 : 1;
+
+      default:
+         return 0;
+      }
+   }
 
-wchar_t RTokenizer::peek(std::size_t lookahead)
-{
-   if ((pos_ + lookahead) >= data_.end())
-      return 0 ;
-   else
-      return *(pos_ + lookahead) ;
-}
+   template <std::size_t N>
+   RToken::TokenSubtype lookupSubtype(const SubtypeEntry (&entries)[N],
+                                      std::size_t length) const
+   {
+      for (std::size_t i = 0; i < N; i++)
+      {
+         const SubtypeEntry& entry = entries[i];
+         if (entry.length != length)
+            continue;
+
+         std::size_t j = 0;
+         while (j < length &&
+                Units::unit(pos_[j]) ==
+                   static_cast<unsigned char>(entry.text[j]))
+            j++;
+         if (j == length)
+            return entry.subtype;
+      }
+      return RToken::NO_SUBTYPE;
+   }
 
-wchar_t RTokenizer::eat()
-{
-   wchar_t result = *pos_;
-   pos_++ ;
-   return result ;
-}
+   // a %user operator% is a pipe if it has a single run of '>' (as do %>%,
+   // %<>%, %T>% and %$>%)
+   bool isPipe(std::size_t length) const
+   {
+      if (length < 3 || Units::unit(pos_[length - 1]) != '%')
+         return false;
+
+      std::size_t i = 1;
+      while (i < length - 1 && Units::unit(pos_[i]) != '>')
+         i++;
+      if (i == length - 1)
+         return false;
+      while (i < length - 1 && Units::unit(pos_[i]) == '>')
+         i++;
+      while (i < length - 1 && Units::unit(pos_[i]) != '>')
+         i++;
+      return i == length - 1;
+   }
 
-std::size_t RTokenizer::tokenLength(const boost::wregex& regex)
-{
-   boost::wsmatch match;
-   std::wstring::const_iterator end = data_.end();
-   boost::match_flag_type flg = boost::match_default | boost::match_continuous;
-   if (regex_utils::search(pos_, end, match, regex, flg))
-      return match.length();
-   else
-      return 0;
-}
+   RToken::TokenSubtype subtype(RToken::TokenType tokenType,
+                                std::size_t length) const
+   {
+      switch (tokenType)
+      {
+      case RToken::OPER:
+         return lookupSubtype(kOperatorSubtypes, length);
+      case RToken::UOPER:
+         return isPipe(length) ? RToken::PIPE : RToken::NO_SUBTYPE;
+      case RToken::ID:
+      {
+         // (all the keywords start with 'f' or 'N')
+         unsigned long first = Units::unit(*pos_);
+         if (first != 'f' && first != 'N')
+            return RToken::NO_SUBTYPE;
+         return lookupSubtype(kIdentifierSubtypes, length);
+      }
+      default:
+         return RToken::NO_SUBTYPE;
+      }
+   }
 
-void RTokenizer::eatUntil(const boost::wregex& regex)
-{
-   boost::wsmatch match;
-   std::wstring::const_iterator end = data_.end();
-   if (regex_utils::search(pos_, end, match, regex))
+   bool consumeToken(RToken::TokenType tokenType,
+                     std::size_t length,
+                     RCompactToken* pToken)
    {
-      pos_ = match[0].first;
+      if (length == 0)
+      {
+         LOG_WARNING_MESSAGE("Can't create zero-length token");
+         return false;
+      }
+      else if (length > static_cast<std::size_t>(end_ - pos_))
+      {
+         LOG_WARNING_MESSAGE("Premature EOF");
+         return false;
+      }
+
+      pToken->type = tokenType;
+      pToken->subtype = subtype(tokenType, length);
+      pToken->offset = static_cast<boost::uint32_t>(pos_ - begin_);
+      pToken->length = static_cast<boost::uint32_t>(length);
+      pToken->row = static_cast<boost::uint32_t>(state_.row);
+      pToken->column = static_cast<boost::uint32_t>(state_.column);
+
+      // update the row, column for the next token; columns count characters
+      for (const CharT* it = pos_; it < pos_ + length; it++)
+      {
+         if (Units::unit(*it) == '\n')
+         {
+            state_.row++;
+            state_.column = 0;
+         }
+         else if (Units::startsCharacter(*it))
+         {
+            state_.column++;
+         }
+      }
+
+      pos_ += length;
+      return true;
    }
-   else
+
+   bool eol() const
    {
-      // eat all on failure to match
-      pos_ = data_.end();
+      return pos_ >= end_;
    }
+
+   unsigned long current() const
+   {
+      return Units::decode(pos_, end_);
+   }
+
+   // the code unit at the given lookahead (0 past the end)
+   unsigned long peek(std::size_t lookahead) const
+   {
+      if (lookahead >= static_cast<std::size_t>(end_ - pos_))
+         return 0;
+      return Units::unit(*(pos_ + lookahead));
+   }
+
+   static bool isDigit(unsigned long c)
+   {
+      return charClasses().is(c, kCharDigit);
+   }
+
+   static bool isAlnum(unsigned long c)
+   {
+      if (c < 128)
+         return charClasses().is(c, kCharDigit | kCharAlpha);
+      return c < 0xFFFF && string_utils::isalnum(static_cast<wchar_t>(c));
+   }
+
+   static bool isWhitespace(unsigned long c)
+   {
+      if (c < 128)
+         return charClasses().is(c, kCharWhitespace);
+      if (c == 0x00A0 || c == 0x3000)
+         return true;
+      return c < 0xFFFF && std::iswspace(static_cast<wint_t>(c));
+   }
+
+private:
+   const CharT* begin_;
+   const CharT* end_;
+   const CharT* pos_;
+   RTokenizerState& state_;
+};
+
+} // anonymous namespace
+
+RToken RTokenizer::nextToken()
+{
+   const wchar_t* begin = data_.data();
+   RTokenScanner<wchar_t> scanner(begin, begin + data_.size(), &state_);
+
+   RCompactToken token;
+   if (!scanner.nextToken(&token))
+      return RToken();
+
+   std::wstring::const_iterator start = data_.begin() + token.offset;
+   return RToken(token.type,
+                 start,
+                 start + token.length,
+                 token.offset,
+                 token.row,
+                 token.column,
+                 token.subtype);
 }
 
+bool RUtf8Tokenizer::nextToken(RCompactToken* pToken)
+{
+   const char* begin = code_.data();
+   RTokenScanner<char> scanner(begin, begin + code_.size(), &state_);
+   return scanner.nextToken(pToken);
+}
 
-RToken RTokenizer::consumeToken(RToken::TokenType tokenType,
-                                std::size_t length)
+void RCompactTokens::tokenize()
 {
-   if (length == 0)
+   // tokenization can resume from a token which starts a line, so long as
+   // no '[' or '[[' is open there, and no earlier token is an error (since
+   // an unterminated '%' or '`' is scanned for to the end of the code, and
+   // so would be affected by any later edit)
+   bool error = false;
+   RCompactToken token;
+   for (;;)
    {
-      LOG_WARNING_MESSAGE("Can't create zero-length token");
-      return RToken();
+      bool resumable = !error && tokenizer_.state().braceStack.empty();
+      if (!tokenizer_.nextToken(&token))
+         break;
+
+      if (token.type == RToken::ERR)
+         error = true;
+
+      if ((flags_ & RTokens::StripWhitespace) &&
+          token.type == RToken::WHITESPACE)
+         continue;
+
+      if ((flags_ & RTokens::StripComments) &&
+          token.type == RToken::COMMENT)
+         continue;
+
+      if (resumable && token.column == 0)
+         resumePoints_.push_back(tokens_.size());
+      tokens_.push_back(token);
    }
-   else if ((pos_ + length) > data_.end())
+}
+
+void RCompactTokens::update(const std::string& code)
+{
+   const std::string& previous = tokenizer_.code();
+   std::size_t common = std::min(previous.size(), code.size());
+   std::size_t changed = std::mismatch(previous.begin(),
+                                       previous.begin() + common,
+                                       code.begin()).first - previous.begin();
+   if (changed == common && previous.size() == code.size())
+      return;
+
+   // the tokens before the resume point are unaffected by the edit (the
+   // token there starts at least one unchanged character before it)
+   RTokenizerState state;
+   std::size_t count = 0;
+   while (!resumePoints_.empty())
    {
-      LOG_WARNING_MESSAGE("Premature EOF");
-      return RToken();
+      const RCompactToken& token = tokens_[resumePoints_.back()];
+      if (token.offset < changed)
+      {
+         count = resumePoints_.back();
+         state.offset = token.offset;
+         state.row = token.row;
+         break;
+      }
+      resumePoints_.pop_back();
    }
-   
-   // Get the row, column for this token
-   std::size_t row = row_;
-   std::size_t column = column_;
-   
-   // Update the row, column for the next token.
-   updatePosition(pos_, length, &row_, &column_);
-   
-   std::wstring::const_iterator start = pos_ ;
-   pos_ += length ;
-   return RToken(tokenType,
-                 start,
-                 pos_,
-                 start - data_.begin(),
-                 row,
-                 column);
+
+   // (the resume point is tokenized again, and so recorded again)
+   if (!resumePoints_.empty())
+      resumePoints_.pop_back();
+
+   tokens_.resize(count);
+   tokenizer_.reset(code, state);
+   tokenize();
+}
+
+const std::wstring& RToken::emptyToken()
+{
+   static const std::wstring instance;
+   return instance;
 }
 
 class ConversionCache
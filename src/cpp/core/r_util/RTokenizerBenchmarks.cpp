@@ -0,0 +1,96 @@
+/*
+ * RTokenizerBenchmarks.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/r_util/RTokenizer.hpp>
+
+#include <string>
+
+#include <core/StringUtils.hpp>
+
+#include <tests/Benchmark.hpp>
+
+namespace rstudio {
+namespace core {
+namespace r_util {
+
+namespace {
+
+// a few hundred lines of typical R code
+const std::string& rCode()
+{
+   static std::string code;
+   if (code.empty())
+   {
+      const char* const kFunction =
+         "summarize_groups <- function(data, by = \"group\", ...) {\n"
+         "   # split the data and summarize each piece\n"
+         "   pieces <- split(data, data[[by]])\n"
+         "   result <- lapply(pieces, function(piece) {\n"
+         "      c(n = nrow(piece), mean = mean(piece$value, na.rm = TRUE),\n"
+         "        label = sprintf('%s (%d)', piece$name[1], 42L))\n"
+         "   })\n"
+         "   if (length(result) > 0 && !is.null(result[[1]]))\n"
+         "      do.call(rbind, result) %>% as.data.frame()\n"
+         "   else\n"
+         "      NULL\n"
+         "}\n\n";
+      for (int i = 0; i < 50; i++)
+         code += kFunction;
+   }
+   return code;
+}
+
+} // anonymous namespace
+
+BENCHMARK(RTokenizer, tokenize_wide)
+{
+   static const std::wstring code = string_utils::utf8ToWide(rCode());
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      RTokens tokens(code);
+      tests::benchmark::doNotOptimize(tokens.size());
+   }
+}
+
+BENCHMARK(RTokenizer, tokenize_utf8)
+{
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      RCompactTokens tokens(rCode());
+      tests::benchmark::doNotOptimize(tokens.size());
+   }
+}
+
+BENCHMARK(RTokenizer, classify_tokens)
+{
+   // the predicates the linter applies to each token
+   using namespace token_utils;
+   static const std::wstring code = string_utils::utf8ToWide(rCode());
+   static const RTokens tokens(code);
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      std::size_t count = 0;
+      for (RTokens::const_iterator it = tokens.begin(); it != tokens.end(); ++it)
+      {
+         count += isBinaryOp(*it) + isLeftAssign(*it) + isPipeOperator(*it) +
+                  canStartExpression(*it) + isNaKeyword(*it) + isFunction(*it);
+      }
+      tests::benchmark::doNotOptimize(count);
+   }
+}
+
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
@@ -269,6 +269,108 @@ context("RTokenizer")
       expect_true(rTokens.at(2).isType(RToken::OPER));
       expect_true(rTokens.at(2).contentEquals(L"**"));
    }
+
+   test_that("UTF-8 tokens match those of the wide tokenizer")
+   {
+      std::wstring code =
+            L"x <- function(a = 1e-3L, ...) {\n"
+            L"   b[[\"\x00E9t\x00E9\"]] %in% `\x00C1 b` # \x00FC\n"
+            L"   \x00C1qc1\x3000<<- 0xFFL; y <- '\\''\n"
+            L"}\n";
+
+      RTokens wide(code);
+      RCompactTokens compact(string_utils::wideToUtf8(code));
+      expect_true(compact.size() == wide.size());
+
+      for (std::size_t i = 0; i < wide.size() && i < compact.size(); i++)
+      {
+         const RToken& expected = wide.at(i);
+         const RCompactToken& token = compact.at(i);
+         expect_true(token.type == expected.type());
+         expect_true(token.subtype == expected.subtype());
+         expect_true(token.row == expected.row());
+         expect_true(token.column == expected.column());
+         expect_true(compact.content(token) == expected.contentAsUtf8());
+      }
+   }
+
+   test_that("Operators and keywords are given subtypes")
+   {
+      using namespace token_utils;
+
+      RTokens rTokens(L"x <<- NA_real_ %>% f(function(y) !y) %in% z$a", RTokens::StripWhitespace);
+      expect_true(rTokens.size() == 17);
+      expect_true(isParentLeftAssign(rTokens.at(1)));
+      expect_true(isLeftAssign(rTokens.at(1)));
+      expect_false(isLocalLeftAssign(rTokens.at(1)));
+      expect_true(isNaKeyword(rTokens.at(2)));
+      expect_true(isPipeOperator(rTokens.at(3)));
+      expect_true(isBinaryOp(rTokens.at(3)));
+      expect_true(isFunction(rTokens.at(6)));
+      expect_true(isValidAsUnaryOperator(rTokens.at(10)));
+      expect_false(isBinaryOp(rTokens.at(10)));
+      expect_false(isPipeOperator(rTokens.at(13)));
+      expect_true(isDollar(rTokens.at(15)));
+      expect_false(isNaKeyword(rTokens.at(0)));
+
+      // subtypes depend on the whole of the token's content
+      RTokens others(L"NAME `function` %>>% %>a>% ::: ->>", RTokens::StripWhitespace);
+      expect_true(others.size() == 6);
+      expect_false(isNaKeyword(others.at(0)));
+      expect_false(isFunction(others.at(1)));
+      expect_true(isPipeOperator(others.at(2)));
+      expect_false(isPipeOperator(others.at(3)));
+      expect_true(isNamespaceExtractionOperator(others.at(4)));
+      expect_false(isRightAssign(others.at(4)));
+      expect_true(isRightAssign(others.at(5)));
+   }
+
+   test_that("UTF-8 token offsets are in bytes")
+   {
+      RCompactTokens tokens("\xC3\xA9 <- 1", RTokens::StripWhitespace);
+      expect_true(tokens.size() == 3);
+      expect_true(tokens.at(0).isType(RToken::ID));
+      expect_true(tokens.at(0).length == 2);
+      expect_true(tokens.at(1).offset == 3);
+      expect_true(tokens.at(1).column == 2);
+      expect_true(tokens.contentEquals(tokens.at(1), "<-"));
+   }
+
+   test_that("Updated tokens match those of the edited code")
+   {
+      std::string code =
+            "f <- function(x) {\n"
+            "   x[[1]]\n"
+            "}\n"
+            "g <- 'a\n"
+            "b'\n"
+            "h <- 1\n";
+
+      const char* edited[] = {
+         "f <- function(x) {\n   x[[1]]\n}\ng <- 'a\nb'\nh <- 12\n",
+         "f <- function(x) {\n   x[[1]]\n}\ng <- 'a\nb\nh <- 12\n",
+         "f <- function(x) {\n   x[[1\n}\ng <- 'a\nb\nh <- 12\n",
+         " f <- function(x) {\n   x[[1\n}\ng <- 'a\nb\nh <- 12\n",
+         "",
+         "y\n"
+      };
+
+      RCompactTokens tokens(code);
+      for (std::size_t i = 0; i < sizeof(edited) / sizeof(edited[0]); i++)
+      {
+         tokens.update(edited[i]);
+         RCompactTokens expected(edited[i]);
+         expect_true(tokens.size() == expected.size());
+         for (std::size_t j = 0; j < expected.size() && j < tokens.size(); j++)
+         {
+            expect_true(tokens.at(j).type == expected.at(j).type);
+            expect_true(tokens.at(j).offset == expected.at(j).offset);
+            expect_true(tokens.at(j).length == expected.at(j).length);
+            expect_true(tokens.at(j).row == expected.at(j).row);
+            expect_true(tokens.at(j).column == expected.at(j).column);
+         }
+      }
+   }
 }
 
 } // namespace r_util
@@ -104,12 +104,54 @@ std::ostream& operator<<(std::ostream& os, const RVersion& version)
    return os;
 }
 
+namespace {
+
+bool detectEnvironment(const FilePath& ldPathsScript,
+                       const std::string& ldLibraryPath,
+                       const FilePath& rScriptPath,
+                       const std::string& prelaunchScript,
+                       std::string* pVersion,
+                       core::system::Options* pEnvironment,
+                       std::string* pErrMsg)
+{
+   std::string rDiscoveredScriptPath;
+   return detectREnvironment(rScriptPath,
+                             ldPathsScript,
+                             ldLibraryPath,
+                             &rDiscoveredScriptPath,
+                             pVersion,
+                             pEnvironment,
+                             pErrMsg,
+                             prelaunchScript);
+}
+
+} // anonymous namespace
+
 std::vector<RVersion> enumerateRVersions(
                               std::vector<FilePath> rHomePaths,
                               std::vector<r_util::RVersion> rEntries,
                               bool scanForOtherVersions,
                               const FilePath& ldPathsScript,
                               const std::string& ldLibraryPath)
+{
+   return enumerateRVersions(rHomePaths,
+                             rEntries,
+                             scanForOtherVersions,
+                             ldPathsScript,
+                             ldLibraryPath,
+                             boost::bind(detectEnvironment,
+                                         ldPathsScript,
+                                         ldLibraryPath,
+                                         _1, _2, _3, _4, _5));
+}
+
+std::vector<RVersion> enumerateRVersions(
+                              std::vector<FilePath> rHomePaths,
+                              std::vector<r_util::RVersion> rEntries,
+                              bool scanForOtherVersions,
+                              const FilePath& ldPathsScript,
+                              const std::string& ldLibraryPath,
+                              const REnvironmentDetector& detector)
 {
    std::vector<RVersion> rVersions;
 
@@ -155,16 +197,9 @@ std::vector<RVersion> enumerateRVersions(
          prelaunchScript = "";
       }
 
-      std::string rDiscoveredScriptPath, rVersion, errMsg;
+      std::string rVersion, errMsg;
       core::system::Options env;
-      if (detectREnvironment(rScriptPath,
-                             ldPathsScript,
-                             ldLibraryPath,
-                             &rDiscoveredScriptPath,
-                             &rVersion,
-                             &env,
-                             &errMsg,
-                             prelaunchScript))
+      if (detector(rScriptPath, prelaunchScript, &rVersion, &env, &errMsg))
       {
          // merge the found environment with the existing user-overridden environment
          // we ensure that the user overrides overwrite whatever environment we established automatically
@@ -210,15 +245,9 @@ std::vector<RVersion> enumerateRVersions(
       if (!rScriptPath.exists())
          continue;
 
-      std::string rDiscoveredScriptPath, rVersion, errMsg;
+      std::string rVersion, errMsg;
       core::system::Options env;
-      if (detectREnvironment(rScriptPath,
-                             ldPathsScript,
-                             ldLibraryPath,
-                             &rDiscoveredScriptPath,
-                             &rVersion,
-                             &env,
-                             &errMsg))
+      if (detector(rScriptPath, std::string(), &rVersion, &env, &errMsg))
       {
          RVersion version(rVersion, env);
          rVersions.push_back(version);
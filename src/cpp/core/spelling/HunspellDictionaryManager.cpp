@@ -191,6 +191,11 @@ const HunspellCustomDictionaries&  HunspellDictionaryManager::custom() const
    return customDicts_;
 }
 
+FilePath HunspellDictionaryManager::compiledDictionariesDir() const
+{
+   return userDir_.childPath("languages-compiled");
+}
+
 FilePath HunspellDictionaryManager::allLanguagesDir() const
 {
    return userDir_.childPath("languages-system");
@@ -22,6 +22,9 @@
 #include <core/FilePath.hpp>
 #include <core/StringUtils.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
+
+#include <core/system/System.hpp>
 
 #include <core/spelling/HunspellDictionaryManager.hpp>
 
@@ -107,6 +110,141 @@ std::string exampleWordForEnglishAffix(const std::string& affix)
       return std::string();
 }
 
+// the encoding of a dictionary's .dic file (given by the SET line of its
+// .aff file, which defaults to ISO8859-1)
+std::string dictionaryEncoding(const FilePath& affPath)
+{
+   std::vector<std::string> lines;
+   Error error = core::readStringVectorFromFile(affPath, &lines);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return "ISO8859-1";
+   }
+
+   BOOST_FOREACH(const std::string& line, lines)
+   {
+      if (boost::algorithm::starts_with(line, "SET "))
+         return boost::algorithm::trim_copy(line.substr(4));
+   }
+
+   return "ISO8859-1";
+}
+
+// the affix flags of a word in the lines of a .dic file
+std::string dictionaryWordFlags(const std::vector<std::string>& dicLines,
+                                const std::string& word)
+{
+   std::string prefix = word + "/";
+   BOOST_FOREACH(const std::string& line, dicLines)
+   {
+      if (boost::algorithm::starts_with(line, prefix))
+      {
+         std::string flags = line.substr(prefix.size());
+         std::size_t endPos = flags.find_first_of(" \t\r");
+         return flags.substr(0, endPos);
+      }
+   }
+
+   return std::string();
+}
+
+// write a copy of the dictionary's .dic file with the words from its
+// .dic_delta file appended (the result of adding them to hunspell one at a
+// time, as sessions used to do when loading the dictionary). words added
+// with an affix take the flags of the example word for that affix.
+Error compileDictionary(const HunspellDictionary& dictionary,
+                        const FilePath& dicDeltaPath,
+                        const IconvstrFunction& iconvstrFunc,
+                        const FilePath& compiledDicPath)
+{
+   std::string encoding = dictionaryEncoding(dictionary.affPath());
+
+   // read the dictionary (in its own encoding)
+   std::string dicContents;
+   Error error = core::readStringFromFile(dictionary.dicPath(), &dicContents);
+   if (error)
+      return error;
+   std::vector<std::string> dicLines;
+   boost::algorithm::split(dicLines,
+                           dicContents,
+                           boost::algorithm::is_any_of("\n"));
+   if (dicLines.empty())
+      return systemError(boost::system::errc::invalid_argument, ERROR_LOCATION);
+
+   // read the delta (in utf-8)
+   std::string deltaContents;
+   error = core::readStringFromFile(dicDeltaPath, &deltaContents);
+   if (error)
+      return error;
+   core::stripBOM(&deltaContents);
+   std::vector<std::string> deltaLines;
+   boost::algorithm::split(deltaLines,
+                           deltaContents,
+                           boost::algorithm::is_any_of("\n"));
+
+   // see mergeDicDeltaFile (below) for why affixes are english only
+   bool addAffixes = boost::algorithm::starts_with(dicDeltaPath.stem(), "en_");
+
+   std::vector<std::string> words;
+   std::string word, affix;
+   BOOST_FOREACH(const std::string& line, deltaLines)
+   {
+      if (!parseDicDeltaLine(line, &word, &affix))
+         continue;
+
+      std::string encoded;
+      Error error = iconvstrFunc(word, "UTF-8", encoding, false, &encoded);
+      if (error)
+      {
+         LOG_ERROR(error);
+         continue;
+      }
+      boost::algorithm::replace_all(encoded, "/", "\\/");
+
+      std::string example = exampleWordForEnglishAffix(affix);
+      std::string flags = addAffixes && !example.empty() ?
+                                 dictionaryWordFlags(dicLines, example) :
+                                 std::string();
+      words.push_back(flags.empty() ? encoded : encoded + "/" + flags);
+   }
+
+   // the first line of a .dic file is its (approximate) word count
+   int count = safe_convert::stringTo<int>(
+                     boost::algorithm::trim_copy(dicLines[0]), 0);
+   std::string compiled = safe_convert::numberToString(
+                     count + static_cast<int>(words.size())) + "\n";
+   for (std::size_t i = 1; i < dicLines.size(); i++)
+   {
+      if (!dicLines[i].empty())
+         compiled += dicLines[i] + "\n";
+   }
+   BOOST_FOREACH(const std::string& word, words)
+   {
+      compiled += word + "\n";
+   }
+
+   // write to a temporary file first so that other sessions never see a
+   // partially written dictionary
+   error = compiledDicPath.parent().ensureDirectory();
+   if (error)
+      return error;
+   FilePath tempPath = compiledDicPath.parent().childPath(
+            compiledDicPath.filename() + "." + core::system::generateShortenedUuid());
+   error = core::writeStringToFile(tempPath, compiled);
+   if (error)
+      return error;
+
+   error = tempPath.move(compiledDicPath);
+   if (error)
+   {
+      Error removeError = tempPath.removeIfExists();
+      if (removeError)
+         LOG_ERROR(removeError);
+   }
+   return error;
+}
+
 class SpellChecker : boost::noncopyable
 {
 public:
@@ -157,6 +295,7 @@ public:
    }
 
    Error initialize(const HunspellDictionary& dictionary,
+                    const FilePath& compiledDictionariesDir,
                     const IconvstrFunction& iconvstrFunc)
    {
       // validate that dictionaries exist
@@ -165,11 +304,43 @@ public:
       if (!dictionary.dicPath().exists())
          return core::fileNotFoundError(dictionary.dicPath(), ERROR_LOCATION);
 
+      // words from dic_delta (if available) are merged into a compiled copy
+      // of the dictionary, so they needn't be added one at a time
+      FilePath dicPath = dictionary.dicPath();
+      FilePath dicDeltaPath = dicPath.parent().childPath(
+                                                dicPath.stem() + ".dic_delta");
+      bool mergeDicDelta = dicDeltaPath.exists();
+      if (mergeDicDelta)
+      {
+         FilePath compiledDicPath = compiledDictionariesDir.childPath(
+                                                            dicPath.filename());
+         Error error;
+         if (!compiledDicPath.exists() ||
+             compiledDicPath.lastWriteTime() < dicPath.lastWriteTime() ||
+             compiledDicPath.lastWriteTime() < dicDeltaPath.lastWriteTime())
+         {
+            error = compileDictionary(dictionary,
+                                      dicDeltaPath,
+                                      iconvstrFunc,
+                                      compiledDicPath);
+         }
+
+         if (!error)
+         {
+            dicPath = compiledDicPath;
+            mergeDicDelta = false;
+         }
+         else
+         {
+            LOG_ERROR(error);
+         }
+      }
+
       // convert paths to system encoding before sending to external API
       std::string systemAffPath = string_utils::utf8ToSystem(
                                     dictionary.affPath().absolutePath());
       std::string systemDicPath = string_utils::utf8ToSystem(
-                                    dictionary.dicPath().absolutePath());
+                                    dicPath.absolutePath());
 
       // initialize hunspell, iconvstrFunc_, and encoding_
       pHunspell_.reset(new Hunspell(systemAffPath.c_str(),
@@ -177,11 +348,8 @@ public:
       iconvstrFunc_ = iconvstrFunc;
       encoding_ = pHunspell_->get_dic_encoding();
 
-      // add words from dic_delta if available
-      FilePath dicPath = dictionary.dicPath();
-      FilePath dicDeltaPath = dicPath.parent().childPath(
-                                                dicPath.stem() + ".dic_delta");
-      if (dicDeltaPath.exists())
+      // add words from dic_delta if we couldn't compile them in
+      if (mergeDicDelta)
       {
          Error error = mergeDicDeltaFile(dicDeltaPath);
          if (error)
@@ -412,7 +580,10 @@ private:
          HunspellSpellChecker* pHunspell = new HunspellSpellChecker();
          pSpellChecker_.reset(pHunspell);
 
-         Error error = pHunspell->initialize(dict, iconvstrFunction_);
+         Error error = pHunspell->initialize(
+                                       dict,
+                                       dictManager_.compiledDictionariesDir(),
+                                       iconvstrFunction_);
          if (!error)
          {
             currentLangId_ = langId;
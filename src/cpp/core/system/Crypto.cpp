@@ -35,6 +35,7 @@
 #include <stdio.h>
 
 #include <boost/utility.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <core/Log.hpp>
 #include <core/Error.hpp>
@@ -89,6 +90,101 @@ Error lastCryptoError(const ErrorLocation& location)
                       location);
 } 
    
+// HMAC context reused by all hashing on a thread. the context remembers
+// the last key it was initialized with, so only a change of key requires
+// the (comparatively expensive) full initialization
+class HMACContext : boost::noncopyable
+{
+public:
+   HMACContext()
+      : keyed_(false)
+   {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+      pCtx_ = &ctx_;
+      ::HMAC_CTX_init(pCtx_);
+#else
+      pCtx_ = ::HMAC_CTX_new();
+#endif
+   }
+
+   ~HMACContext()
+   {
+      try
+      {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+         ::HMAC_CTX_cleanup(pCtx_);
+#else
+         ::HMAC_CTX_free(pCtx_);
+#endif
+      }
+      catch(...)
+      {
+      }
+   }
+
+   Error hash(const char* pData,
+              std::size_t dataLen,
+              const char* pKey,
+              std::size_t keyLen,
+              std::vector<unsigned char>* pHMAC)
+   {
+      if (pCtx_ == NULL)
+         return systemError(boost::system::errc::not_enough_memory, ERROR_LOCATION);
+
+      // passing a NULL key has openssl reuse the one the context holds
+      bool sameKey = keyed_ && key_.size() == keyLen &&
+                     std::equal(pKey, pKey + keyLen, key_.begin());
+      int ret = sameKey ?
+               ::HMAC_Init_ex(pCtx_, NULL, 0, NULL, NULL) :
+               ::HMAC_Init_ex(pCtx_, pKey, static_cast<int>(keyLen),
+                              EVP_sha256(), NULL);
+      if (ret != 1)
+      {
+         keyed_ = false;
+         return lastCryptoError(ERROR_LOCATION);
+      }
+
+      if (!sameKey)
+      {
+         key_.assign(pKey, keyLen);
+         keyed_ = true;
+      }
+
+      unsigned int mdLen = 0;
+      pHMAC->resize(EVP_MAX_MD_SIZE);
+      if (::HMAC_Update(pCtx_,
+                        reinterpret_cast<const unsigned char*>(pData),
+                        dataLen) != 1 ||
+          ::HMAC_Final(pCtx_, &(pHMAC->operator[](0)), &mdLen) != 1)
+      {
+         keyed_ = false;
+         return lastCryptoError(ERROR_LOCATION);
+      }
+
+      pHMAC->resize(mdLen);
+      return Success();
+   }
+
+private:
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+   HMAC_CTX ctx_;
+#endif
+   HMAC_CTX* pCtx_;
+   bool keyed_;
+   std::string key_;
+};
+
+boost::thread_specific_ptr<HMACContext> s_pHMACContext;
+
+// public key most recently used for verification on a thread
+struct RSAPublicKey
+{
+   std::string pem;
+   std::shared_ptr<RSA> pRsa;
+};
+
+boost::thread_specific_ptr<RSAPublicKey> s_pRSAPublicKey;
+
 class BIOFreeAllScope : boost::noncopyable
 {
 public:
@@ -123,41 +219,30 @@ Error HMAC_SHA2(const std::string& data,
                 const std::string& key,
                 std::vector<unsigned char>* pHMAC)
 {
-   // copy data into vector
-   std::vector<unsigned char> keyVector;
-   std::copy(key.begin(), key.end(), std::back_inserter(keyVector));  
-   
-   // call core
-   return HMAC_SHA2(data, keyVector, pHMAC);
+   return HMAC_SHA2(data.data(), data.size(), key.data(), key.size(), pHMAC);
 }
    
 Error HMAC_SHA2(const std::string& data,
                 const std::vector<unsigned char>& key,
                 std::vector<unsigned char>* pHMAC)
 {
-   // copy data into data vector
-   std::vector<unsigned char> dataVector;
-   std::copy(data.begin(), data.end(), std::back_inserter(dataVector));
-   
-   // perform the hash
-   unsigned int md_len = 0;
-   pHMAC->resize(EVP_MAX_MD_SIZE);
-   unsigned char* pResult = ::HMAC(EVP_sha256(),
-                                   &(key[0]),
-                                   static_cast<int>(key.size()),
-                                   &(dataVector[0]),
-                                   dataVector.size(),
-                                   &(pHMAC->operator[](0)),
-                                   &md_len);
-   if (pResult != NULL)
-   {
-      pHMAC->resize(md_len);
-      return Success();
-   }
-   else
-   {
-      return lastCryptoError(ERROR_LOCATION);
-   }
+   return HMAC_SHA2(data.data(),
+                    data.size(),
+                    reinterpret_cast<const char*>(key.data()),
+                    key.size(),
+                    pHMAC);
+}
+
+Error HMAC_SHA2(const char* pData,
+                std::size_t dataLen,
+                const char* pKey,
+                std::size_t keyLen,
+                std::vector<unsigned char>* pHMAC)
+{
+   if (s_pHMACContext.get() == NULL)
+      s_pHMACContext.reset(new HMACContext());
+
+   return s_pHMACContext->hash(pData, dataLen, pKey, keyLen, pHMAC);
 }
 
 Error sha256(const std::string& message,
@@ -421,22 +506,32 @@ Error rsaVerify(const std::string& message,
    if (error)
       return error;
 
-   // convert the key into an RSA structure
-   std::unique_ptr<BIO, decltype(&BIO_free)> pKeyBuff(
-            BIO_new_mem_buf(const_cast<char*>(pemPublicKey.c_str()),
-            static_cast<int>(pemPublicKey.size())),
-            BIO_free);
-   if (!pKeyBuff)
-      return systemError(boost::system::errc::not_enough_memory, ERROR_LOCATION);
-
-   std::unique_ptr<RSA, decltype(&RSA_free)> pRsa(PEM_read_bio_RSA_PUBKEY(pKeyBuff.get(), NULL, NULL, NULL),
-                                                  RSA_free);
-   if (!pRsa)
-      return systemError(boost::system::errc::not_enough_memory, ERROR_LOCATION);
+   // convert the key into an RSA structure (unless it's the one we used last)
+   RSAPublicKey* pPublicKey = s_pRSAPublicKey.get();
+   if (pPublicKey == NULL || pPublicKey->pem != pemPublicKey)
+   {
+      std::unique_ptr<BIO, decltype(&BIO_free)> pKeyBuff(
+               BIO_new_mem_buf(const_cast<char*>(pemPublicKey.c_str()),
+               static_cast<int>(pemPublicKey.size())),
+               BIO_free);
+      if (!pKeyBuff)
+         return systemError(boost::system::errc::not_enough_memory, ERROR_LOCATION);
+
+      std::shared_ptr<RSA> pRsa(PEM_read_bio_RSA_PUBKEY(pKeyBuff.get(), NULL, NULL, NULL),
+                                RSA_free);
+      if (!pRsa)
+         return systemError(boost::system::errc::not_enough_memory, ERROR_LOCATION);
+
+      pPublicKey = new RSAPublicKey();
+      pPublicKey->pem = pemPublicKey;
+      pPublicKey->pRsa = pRsa;
+      s_pRSAPublicKey.reset(pPublicKey);
+   }
+   RSA* pRsa = pPublicKey->pRsa.get();
 
    // verify the message hash
    int ret = RSA_verify(NID_sha256, (const unsigned char*)hash.c_str(), static_cast<unsigned int>(hash.size()),
-                       (const unsigned char*)signature.c_str(), static_cast<unsigned int>(signature.size()), pRsa.get());
+                       (const unsigned char*)signature.c_str(), static_cast<unsigned int>(signature.size()), pRsa);
    if (ret != 1)
       return lastCryptoError(ERROR_LOCATION);
 
@@ -624,6 +719,45 @@ core::Error rsaPrivateDecrypt(const std::string& cipherText, std::string* pPlain
    return Success();
 }
 
+core::Error rsaPublicEncrypt(const std::string& plainText,
+                             const std::string& exponent,
+                             const std::string& modulo,
+                             std::string* pCipherText)
+{
+   // build the key from its hex encoded parts (as served by rsaPublicKey)
+   BIGNUM* bn_n = NULL;
+   BIGNUM* bn_e = NULL;
+   if (!BN_hex2bn(&bn_n, modulo.c_str()) || !BN_hex2bn(&bn_e, exponent.c_str()))
+   {
+      BN_free(bn_n);
+      BN_free(bn_e);
+      return systemError(boost::system::errc::invalid_argument,
+                         "Invalid RSA public key",
+                         ERROR_LOCATION);
+   }
+
+   RSA* pRSA = RSA_new();
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+   pRSA->n = bn_n;
+   pRSA->e = bn_e;
+#else
+   RSA_set0_key(pRSA, bn_n, bn_e, NULL);
+#endif
+   std::shared_ptr<RSA> pKey(pRSA, RSA_free);
+
+   std::vector<unsigned char> cipherTextBytes(RSA_size(pRSA));
+   int bytesWritten = RSA_public_encrypt(
+            static_cast<int>(plainText.size()),
+            reinterpret_cast<const unsigned char*>(plainText.c_str()),
+            &cipherTextBytes[0],
+            pRSA,
+            RSA_PKCS1_PADDING);
+   if (bytesWritten == -1)
+      return lastCryptoError(ERROR_LOCATION);
+
+   return base64Encode(&cipherTextBytes[0], bytesWritten, pCipherText);
+}
+
 Error encryptDataAsBase64EncodedString(const std::string& input,
                                        const std::string& keyStr,
                                        std::string* pIv,
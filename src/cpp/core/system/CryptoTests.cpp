@@ -56,6 +56,81 @@ context("CryptoTests")
       std::copy(decryptedData.begin(), decryptedData.end(), std::back_inserter(decryptedPayload));
       REQUIRE(payload == decryptedPayload);
    }
+
+   test_that("HMAC matches the RFC 4231 test vectors")
+   {
+      std::vector<unsigned char> hmac;
+
+      // test case 2
+      Error error = crypto::HMAC_SHA2("what do ya want for nothing?", "Jefe", &hmac);
+      REQUIRE_FALSE(error);
+      REQUIRE(hmac.size() == 32);
+      CHECK(hmac[0] == 0x5b);
+      CHECK(hmac[1] == 0xdc);
+      CHECK(hmac[31] == 0x43);
+      std::vector<unsigned char> expected = hmac;
+
+      // hashing with the same key again reuses the thread's context
+      error = crypto::HMAC_SHA2("what do ya want for nothing?", "Jefe", &hmac);
+      REQUIRE_FALSE(error);
+      CHECK(hmac == expected);
+
+      // test case 1 (a different key)
+      std::string key(20, '\x0b');
+      std::string data = "Hi There";
+      error = crypto::HMAC_SHA2(data.data(), data.size(), key.data(), key.size(), &hmac);
+      REQUIRE_FALSE(error);
+      REQUIRE(hmac.size() == 32);
+      CHECK(hmac[0] == 0xb0);
+      CHECK(hmac[1] == 0x34);
+      CHECK(hmac[31] == 0xf7);
+
+      // and back to the first key
+      std::vector<unsigned char> keyVector;
+      keyVector.push_back('J');
+      keyVector.push_back('e');
+      keyVector.push_back('f');
+      keyVector.push_back('e');
+      error = crypto::HMAC_SHA2("what do ya want for nothing?", keyVector, &hmac);
+      REQUIRE_FALSE(error);
+      CHECK(hmac == expected);
+   }
+
+   test_that("Can RSA sign and verify")
+   {
+      std::string publicKey, privateKey;
+      Error error = crypto::generateRsaKeyPair(&publicKey, &privateKey);
+      REQUIRE_FALSE(error);
+
+      std::string signature;
+      error = crypto::rsaSign("message", privateKey, &signature);
+      REQUIRE_FALSE(error);
+
+      // the second verification uses the thread's already parsed key
+      CHECK_FALSE(crypto::rsaVerify("message", signature, publicKey));
+      CHECK_FALSE(crypto::rsaVerify("message", signature, publicKey));
+      CHECK(crypto::rsaVerify("massage", signature, publicKey));
+   }
+
+   test_that("Can RSA encrypt with the public key and decrypt")
+   {
+      REQUIRE_FALSE(crypto::rsaInit());
+
+      std::string exponent, modulo;
+      crypto::rsaPublicKey(&exponent, &modulo);
+
+      std::string cipherText;
+      Error error = crypto::rsaPublicEncrypt("user\npassword", exponent, modulo,
+                                            &cipherText);
+      REQUIRE_FALSE(error);
+
+      std::string plainText;
+      error = crypto::rsaPrivateDecrypt(cipherText, &plainText);
+      REQUIRE_FALSE(error);
+      CHECK(plainText == "user\npassword");
+
+      CHECK(crypto::rsaPublicEncrypt("user", exponent, "not hex", &cipherText));
+   }
 }
 
 } // end namespace tests
@@ -0,0 +1,104 @@
+/*
+ * FileChangeBatch.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/system/FileChangeBatch.hpp>
+
+#include <boost/foreach.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+
+void FileChangeBatch::add(const FileChangeEvent& event)
+{
+   if (event.type() == FileChangeEvent::None)
+      return;
+
+   std::string path = event.fileInfo().absolutePath();
+   boost::unordered_map<std::string, PathChange>::iterator it =
+                                                         changes_.find(path);
+   if (it == changes_.end())
+   {
+      // the first change tells us whether the path existed beforehand
+      PathChange change;
+      change.existedBefore = event.type() != FileChangeEvent::FileAdded;
+      change.before = event.fileInfo();
+      it = changes_.insert(std::make_pair(path, change)).first;
+      paths_.push_back(path);
+   }
+
+   it->second.lastType = event.type();
+   it->second.last = event.fileInfo();
+}
+
+void FileChangeBatch::add(const std::vector<FileChangeEvent>& events)
+{
+   BOOST_FOREACH(const FileChangeEvent& event, events)
+   {
+      add(event);
+   }
+}
+
+void FileChangeBatch::take(std::vector<FileChangeEvent>* pEvents)
+{
+   pEvents->clear();
+   pEvents->reserve(paths_.size());
+
+   BOOST_FOREACH(const std::string& path, paths_)
+   {
+      const PathChange& change = changes_[path];
+      bool existsNow = change.lastType != FileChangeEvent::FileRemoved;
+
+      if (change.existedBefore && !existsNow)
+      {
+         pEvents->push_back(FileChangeEvent(FileChangeEvent::FileRemoved,
+                                            change.last));
+      }
+      else if (change.existedBefore)
+      {
+         // replacing a file with a directory (or vice versa) isn't a
+         // modification as far as subscribers are concerned
+         if (change.before.isDirectory() != change.last.isDirectory())
+         {
+            pEvents->push_back(FileChangeEvent(FileChangeEvent::FileRemoved,
+                                               change.before));
+            pEvents->push_back(FileChangeEvent(FileChangeEvent::FileAdded,
+                                               change.last));
+         }
+         else
+         {
+            pEvents->push_back(FileChangeEvent(FileChangeEvent::FileModified,
+                                               change.last));
+         }
+      }
+      else if (existsNow)
+      {
+         pEvents->push_back(FileChangeEvent(FileChangeEvent::FileAdded,
+                                            change.last));
+      }
+   }
+
+   clear();
+}
+
+void FileChangeBatch::clear()
+{
+   paths_.clear();
+   changes_.clear();
+}
+
+} // namespace system
+} // namespace core
+} // namespace rstudio
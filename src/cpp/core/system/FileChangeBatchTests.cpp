@@ -0,0 +1,88 @@
+/*
+ * FileChangeBatchTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/system/FileChangeBatch.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace tests {
+
+namespace {
+
+FileChangeEvent event(FileChangeEvent::Type type,
+                      const std::string& path,
+                      bool isDirectory = false)
+{
+   return FileChangeEvent(type, FileInfo(path, isDirectory));
+}
+
+} // anonymous namespace
+
+context("FileChangeBatchTests")
+{
+   test_that("Successive changes to a path are collapsed")
+   {
+      FileChangeBatch batch;
+      batch.add(event(FileChangeEvent::FileAdded, "/a.R"));
+      batch.add(event(FileChangeEvent::FileModified, "/a.R"));
+      batch.add(event(FileChangeEvent::FileModified, "/b.R"));
+      batch.add(event(FileChangeEvent::FileModified, "/b.R"));
+      batch.add(event(FileChangeEvent::FileAdded, "/c.R"));
+      batch.add(event(FileChangeEvent::FileRemoved, "/c.R"));
+      batch.add(event(FileChangeEvent::FileModified, "/d.R"));
+      batch.add(event(FileChangeEvent::FileRemoved, "/d.R"));
+      CHECK(batch.size() == 4);
+
+      std::vector<FileChangeEvent> events;
+      batch.take(&events);
+      CHECK(batch.empty());
+
+      REQUIRE(events.size() == 3);
+      CHECK(events[0].type() == FileChangeEvent::FileAdded);
+      CHECK(events[0].fileInfo().absolutePath() == "/a.R");
+      CHECK(events[1].type() == FileChangeEvent::FileModified);
+      CHECK(events[1].fileInfo().absolutePath() == "/b.R");
+      CHECK(events[2].type() == FileChangeEvent::FileRemoved);
+      CHECK(events[2].fileInfo().absolutePath() == "/d.R");
+   }
+
+   test_that("Replaced files are reported as modified")
+   {
+      FileChangeBatch batch;
+      batch.add(event(FileChangeEvent::FileRemoved, "/a.R"));
+      batch.add(event(FileChangeEvent::FileAdded, "/a.R"));
+
+      // unless a file is replaced by a directory
+      batch.add(event(FileChangeEvent::FileRemoved, "/b"));
+      batch.add(event(FileChangeEvent::FileAdded, "/b", true));
+
+      std::vector<FileChangeEvent> events;
+      batch.take(&events);
+      REQUIRE(events.size() == 3);
+      CHECK(events[0].type() == FileChangeEvent::FileModified);
+      CHECK(events[1].type() == FileChangeEvent::FileRemoved);
+      CHECK_FALSE(events[1].fileInfo().isDirectory());
+      CHECK(events[2].type() == FileChangeEvent::FileAdded);
+      CHECK(events[2].fileInfo().isDirectory());
+   }
+}
+
+} // end namespace tests
+} // end namespace system
+} // end namespace core
+} // end namespace rstudio
@@ -0,0 +1,165 @@
+/*
+ * FileScannerTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/system/FileScanner.hpp>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include <boost/bind.hpp>
+
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace tests {
+
+namespace {
+
+FilePath createTestDir()
+{
+   FilePath dir;
+   REQUIRE_FALSE(FilePath::tempFilePath(&dir));
+   REQUIRE_FALSE(dir.ensureDirectory());
+   REQUIRE_FALSE(writeStringToFile(dir.complete("b.R"), "x <- 1\n"));
+   REQUIRE_FALSE(writeStringToFile(dir.complete("a.R"), ""));
+   REQUIRE_FALSE(dir.complete("c").ensureDirectory());
+   return dir;
+}
+
+// a tree of nested directories, each with a few files
+void createTestTree(const FilePath& dir, int depth)
+{
+   REQUIRE_FALSE(dir.ensureDirectory());
+   REQUIRE_FALSE(writeStringToFile(dir.complete("file.R"), ""));
+   REQUIRE_FALSE(writeStringToFile(dir.complete("file.txt"), ""));
+   if (depth == 0)
+      return;
+
+   createTestTree(dir.complete("a"), depth - 1);
+   createTestTree(dir.complete("b"), depth - 1);
+   createTestTree(dir.complete("ignored"), depth - 1);
+}
+
+bool notIgnored(const FileInfo& fileInfo)
+{
+   return FilePath(fileInfo.absolutePath()).filename() != "ignored";
+}
+
+Error countScannedDir(const FileInfo& fileInfo, int* pCount)
+{
+   ++*pCount;
+   return Success();
+}
+
+std::vector<std::string> treePaths(const tree<FileInfo>& fileTree)
+{
+   std::vector<std::string> paths;
+   for (tree<FileInfo>::iterator it = fileTree.begin();
+        it != fileTree.end();
+        ++it)
+   {
+      paths.push_back(it->absolutePath());
+   }
+   return paths;
+}
+
+} // anonymous namespace
+
+context("FileScanner")
+{
+   test_that("Directory scans match the attributes of each FilePath")
+   {
+      FilePath dir = createTestDir();
+
+      std::vector<FileInfo> files;
+      REQUIRE_FALSE(scanDirectory(dir, false, &files));
+      REQUIRE(files.size() == 3);
+      CHECK(files[0] == FileInfo(dir.complete("a.R")));
+      CHECK(files[1] == FileInfo(dir.complete("b.R")));
+      CHECK(files[1].size() == 7);
+      CHECK(files[2] == FileInfo(dir.complete("c")));
+      CHECK(files[2].isDirectory());
+
+      REQUIRE_FALSE(dir.remove());
+      CHECK(scanDirectory(dir, false, &files));
+   }
+
+   test_that("Parallel scans produce the same tree as serial scans")
+   {
+      FilePath dir;
+      REQUIRE_FALSE(FilePath::tempFilePath(&dir));
+      createTestTree(dir, 4);
+
+      FileScannerOptions options;
+      options.recursive = true;
+      options.filter = notIgnored;
+
+      int serialDirs = 0;
+      options.onBeforeScanDir = boost::bind(countScannedDir, _1, &serialDirs);
+      tree<FileInfo> serialTree;
+      REQUIRE_FALSE(scanFiles(FileInfo(dir), options, &serialTree));
+
+      int parallelDirs = 0;
+      options.onBeforeScanDir = boost::bind(countScannedDir, _1, &parallelDirs);
+      options.threads = 4;
+      tree<FileInfo> parallelTree;
+      REQUIRE_FALSE(scanFiles(FileInfo(dir), options, &parallelTree));
+
+      // the root and 2 + 4 + 8 + 16 subdirectories, each with two files
+      CHECK(serialDirs == 31);
+      CHECK(parallelDirs == 31);
+      CHECK(serialTree.size() == 31 + 62);
+      CHECK(treePaths(parallelTree) == treePaths(serialTree));
+
+      REQUIRE_FALSE(dir.remove());
+      tree<FileInfo> missingTree;
+      CHECK(scanFiles(FileInfo(dir), options, &missingTree));
+   }
+
+#ifndef _WIN32
+   test_that("Symlinks are only followed when requested")
+   {
+      FilePath dir = createTestDir();
+      std::string path = dir.absolutePath();
+      REQUIRE(::symlink((path + "/c").c_str(), (path + "/d").c_str()) == 0);
+      REQUIRE(::symlink((path + "/missing").c_str(), (path + "/e").c_str()) == 0);
+
+      std::vector<FileInfo> files;
+      REQUIRE_FALSE(scanDirectory(dir, true, &files));
+      REQUIRE(files.size() == 4);
+      CHECK(files[3].isDirectory());
+      CHECK(files[3].isSymlink());
+
+      REQUIRE_FALSE(scanDirectory(dir, false, &files));
+      REQUIRE(files.size() == 5);
+      CHECK_FALSE(files[3].isDirectory());
+      CHECK(files[3].isSymlink());
+      CHECK(files[4].isSymlink());
+
+      REQUIRE_FALSE(dir.remove());
+   }
+#endif
+}
+
+} // namespace tests
+} // namespace system
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,287 @@
+/*
+ * PosixCgroups.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/system/PosixCgroups.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/system/PosixSched.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace cgroups {
+
+namespace {
+
+const char * const kProcessCgroupPrefix = "rsession-";
+const char * const kCgroupMountPath = "/sys/fs/cgroup";
+
+// cgroup control files report invalid values from write(2), which a
+// buffered stream would only surface (if at all) when closed
+Error writeControlFile(const FilePath& filePath, const std::string& value)
+{
+   int fd = ::open(filePath.absolutePath().c_str(), O_WRONLY);
+   if (fd == -1)
+   {
+      Error error = systemError(errno, ERROR_LOCATION);
+      error.addProperty("path", filePath);
+      return error;
+   }
+
+   ssize_t written = ::write(fd, value.c_str(), value.size());
+   int writeErrno = errno;
+   ::close(fd);
+
+   if (written == -1)
+   {
+      Error error = systemError(writeErrno, ERROR_LOCATION);
+      error.addProperty("path", filePath);
+      error.addProperty("value", value);
+      return error;
+   }
+
+   return Success();
+}
+
+long long readNumber(const std::string& value)
+{
+   return safe_convert::stringTo<long long>(boost::algorithm::trim_copy(value),
+                                            0);
+}
+
+// sum the values of a key across the lines of a flat keyed (cpu.stat) or
+// nested keyed (io.stat) file
+long long sumKey(const std::string& contents, const std::string& key)
+{
+   long long total = 0;
+   std::vector<std::string> fields;
+   boost::algorithm::split(fields, contents, boost::algorithm::is_space(),
+                           boost::algorithm::token_compress_on);
+
+   for (std::size_t i = 0; i < fields.size(); i++)
+   {
+      const std::string& field = fields[i];
+      if (field == key && i + 1 < fields.size())
+         total += readNumber(fields[i + 1]);
+      else if (boost::algorithm::starts_with(field, key + "="))
+         total += readNumber(field.substr(key.size() + 1));
+   }
+
+   return total;
+}
+
+void removeEmptyProcessCgroups(const FilePath& parentPath)
+{
+   std::vector<FilePath> children;
+   Error error = parentPath.children(&children);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   // cgroups which still have processes fail with EBUSY and are kept
+   BOOST_FOREACH(const FilePath& child, children)
+   {
+      if (child.isDirectory() &&
+          boost::algorithm::starts_with(child.filename(), kProcessCgroupPrefix))
+      {
+         ::rmdir(child.absolutePath().c_str());
+      }
+   }
+}
+
+} // anonymous namespace
+
+FilePath processCgroupPath(const std::string& parentPath, pid_t pid)
+{
+   return FilePath(parentPath).childPath(
+            kProcessCgroupPrefix + safe_convert::numberToString(pid));
+}
+
+Error joinProcessCgroup(const CgroupLimits& limits)
+{
+   FilePath parentPath(limits.parentPath);
+   if (!parentPath.exists())
+      return core::pathNotFoundError(limits.parentPath, ERROR_LOCATION);
+
+   // make the controllers we set limits with available to our cgroup; one
+   // at a time so a controller the parent doesn't offer spoils only its own
+   // limits (whose writes then report the problem)
+   FilePath subtreeControl = parentPath.childPath("cgroup.subtree_control");
+   writeControlFile(subtreeControl, "+cpu");
+   writeControlFile(subtreeControl, "+memory");
+   writeControlFile(subtreeControl, "+io");
+
+   removeEmptyProcessCgroups(parentPath);
+
+   FilePath cgroupPath = processCgroupPath(limits.parentPath, ::getpid());
+   if (::mkdir(cgroupPath.absolutePath().c_str(), 0755) == -1 && errno != EEXIST)
+   {
+      Error error = systemError(errno, ERROR_LOCATION);
+      error.addProperty("path", cgroupPath);
+      return error;
+   }
+
+   // a limit we can't apply shouldn't keep the process out of the cgroup
+   // (its usage is still accounted)
+   if (limits.cpuWeight > 0)
+   {
+      Error error = writeControlFile(
+               cgroupPath.childPath("cpu.weight"),
+               safe_convert::numberToString(limits.cpuWeight));
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   if (limits.memoryHighBytes > 0)
+   {
+      Error error = writeControlFile(
+               cgroupPath.childPath("memory.high"),
+               safe_convert::numberToString(limits.memoryHighBytes));
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   if (!limits.ioMax.empty())
+   {
+      std::vector<std::string> lines;
+      boost::algorithm::split(lines, limits.ioMax, boost::algorithm::is_any_of(";"));
+      BOOST_FOREACH(std::string line, lines)
+      {
+         boost::algorithm::trim(line);
+         if (line.empty())
+            continue;
+
+         Error error = writeControlFile(cgroupPath.childPath("io.max"), line);
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+
+   return writeControlFile(cgroupPath.childPath("cgroup.procs"),
+                           safe_convert::numberToString(::getpid()));
+}
+
+Error readCgroupUsage(const FilePath& cgroupPath, CgroupUsage* pUsage)
+{
+   *pUsage = CgroupUsage();
+
+   std::string contents;
+   Error error = readStringFromFile(cgroupPath.childPath("cpu.stat"), &contents);
+   if (error)
+      return error;
+   pUsage->cpuUsec = sumKey(contents, "usage_usec");
+
+   // memory and io accounting depend on their controllers being enabled
+   error = readStringFromFile(cgroupPath.childPath("memory.current"), &contents);
+   if (!error)
+      pUsage->memoryBytes = readNumber(contents);
+
+   error = readStringFromFile(cgroupPath.childPath("io.stat"), &contents);
+   if (!error)
+   {
+      pUsage->ioReadBytes = sumKey(contents, "rbytes");
+      pUsage->ioWriteBytes = sumKey(contents, "wbytes");
+   }
+
+   return Success();
+}
+
+double readCgroupCpuQuota(const FilePath& cgroupPath)
+{
+   // cpu.max holds "$MAX $PERIOD" where $MAX is "max" when unlimited
+   std::string contents;
+   Error error = readStringFromFile(cgroupPath.childPath("cpu.max"), &contents);
+   if (error)
+      return 0;
+
+   std::vector<std::string> fields;
+   boost::algorithm::trim(contents);
+   boost::algorithm::split(fields, contents, boost::algorithm::is_space(),
+                           boost::algorithm::token_compress_on);
+   if (fields.size() != 2 || fields[0] == "max")
+      return 0;
+
+   long long quota = readNumber(fields[0]);
+   long long period = readNumber(fields[1]);
+   if (quota <= 0 || period <= 0)
+      return 0;
+
+   return static_cast<double>(quota) / static_cast<double>(period);
+}
+
+int availableCpuCount()
+{
+   int cpus = std::max(cpuCount(), 1);
+
+   // find our (v2) cgroup, listed as "0::/path"
+   std::string contents;
+   Error error = readStringFromFile(FilePath("/proc/self/cgroup"), &contents);
+   if (error)
+      return cpus;
+
+   std::string cgroup;
+   std::vector<std::string> lines;
+   boost::algorithm::split(lines, contents, boost::algorithm::is_any_of("\n"));
+   BOOST_FOREACH(const std::string& line, lines)
+   {
+      if (boost::algorithm::starts_with(line, "0::"))
+      {
+         cgroup = boost::algorithm::trim_copy(line.substr(3));
+         break;
+      }
+   }
+   if (cgroup.empty())
+      return cpus;
+
+   // the effective quota is the tightest one on the way up to the root
+   FilePath rootPath(kCgroupMountPath);
+   FilePath cgroupPath = rootPath.complete(
+            boost::algorithm::trim_left_copy_if(cgroup,
+                                                boost::algorithm::is_any_of("/")));
+   while (cgroupPath.isWithin(rootPath))
+   {
+      double quota = readCgroupCpuQuota(cgroupPath);
+      if (quota > 0)
+         cpus = std::min(cpus, static_cast<int>(std::ceil(quota)));
+
+      if (cgroupPath == rootPath)
+         break;
+      cgroupPath = cgroupPath.parent();
+   }
+
+   return std::max(cpus, 1);
+}
+
+} // namespace cgroups
+} // namespace system
+} // namespace core
+} // namespace rstudio
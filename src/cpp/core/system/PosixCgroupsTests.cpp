@@ -0,0 +1,107 @@
+/*
+ * PosixCgroupsTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <core/system/PosixCgroups.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace tests {
+
+context("PosixCgroupsTests")
+{
+   test_that("Cgroup usage is read from the accounting files")
+   {
+      FilePath cgroupPath;
+      expect_false(FilePath::tempFilePath(&cgroupPath));
+      expect_false(cgroupPath.ensureDirectory());
+
+      writeStringToFile(cgroupPath.childPath("cpu.stat"),
+                        "usage_usec 1500\nuser_usec 1000\nsystem_usec 500\n");
+      writeStringToFile(cgroupPath.childPath("memory.current"), "4096\n");
+      writeStringToFile(cgroupPath.childPath("io.stat"),
+                        "8:0 rbytes=100 wbytes=20 rios=1 wios=1\n"
+                        "8:16 rbytes=5 wbytes=7 rios=1 wios=1\n");
+
+      cgroups::CgroupUsage usage;
+      expect_false(cgroups::readCgroupUsage(cgroupPath, &usage));
+      expect_true(usage.cpuUsec == 1500);
+      expect_true(usage.memoryBytes == 4096);
+      expect_true(usage.ioReadBytes == 105);
+      expect_true(usage.ioWriteBytes == 27);
+
+      cgroupPath.remove();
+   }
+
+   test_that("Memory and io accounting are optional")
+   {
+      FilePath cgroupPath;
+      expect_false(FilePath::tempFilePath(&cgroupPath));
+      expect_false(cgroupPath.ensureDirectory());
+      writeStringToFile(cgroupPath.childPath("cpu.stat"), "usage_usec 42\n");
+
+      cgroups::CgroupUsage usage;
+      expect_false(cgroups::readCgroupUsage(cgroupPath, &usage));
+      expect_true(usage.cpuUsec == 42);
+      expect_true(usage.memoryBytes == 0);
+
+      cgroupPath.remove();
+      expect_true(cgroups::readCgroupUsage(cgroupPath, &usage));
+   }
+
+   test_that("Cpu quotas are read from cpu.max")
+   {
+      FilePath cgroupPath;
+      expect_false(FilePath::tempFilePath(&cgroupPath));
+      expect_false(cgroupPath.ensureDirectory());
+
+      // no cpu controller
+      expect_true(cgroups::readCgroupCpuQuota(cgroupPath) == 0);
+
+      writeStringToFile(cgroupPath.childPath("cpu.max"), "max 100000\n");
+      expect_true(cgroups::readCgroupCpuQuota(cgroupPath) == 0);
+
+      writeStringToFile(cgroupPath.childPath("cpu.max"), "150000 100000\n");
+      expect_true(cgroups::readCgroupCpuQuota(cgroupPath) == 1.5);
+
+      cgroupPath.remove();
+   }
+
+   test_that("The available cpu count is at least one")
+   {
+      expect_true(cgroups::availableCpuCount() >= 1);
+   }
+
+   test_that("Process cgroups are named for the process")
+   {
+      expect_true(cgroups::processCgroupPath("/sys/fs/cgroup/rstudio", 42)
+                     .absolutePath() == "/sys/fs/cgroup/rstudio/rsession-42");
+   }
+}
+
+} // end namespace tests
+} // end namespace system
+} // end namespace core
+} // end namespace rstudio
+
+#endif // _WIN32
@@ -29,6 +29,7 @@
 #include <asm/ioctls.h>
 #endif
 
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <sys/types.h>
 
@@ -150,6 +151,95 @@ Error readPipe(int pipeFd, std::string* pOutput, bool *pEOF = NULL)
    return Success();
 }
 
+// whether close_range(2) is available for closing the descriptors a
+// vfork'ed child inherits; probed once by closing a descriptor that can
+// never be open (the call fails with ENOSYS on kernels that lack it)
+bool closeRangeSupported()
+{
+#ifdef SYS_close_range
+   static const bool supported =
+         ::syscall(SYS_close_range, ~0U, ~0U, 0) == 0;
+   return supported;
+#else
+   return false;
+#endif
+}
+
+// vfork and exec a child with its standard streams wired to the given pipes.
+// the child shares our address space until it calls exec so it may only make
+// async signal-safe calls, touch no memory other than its own locals, and
+// must exec or _exit from this frame. exec failures are reported back
+// through pExecErrno (which the child can write as it shares our memory)
+PidType vforkExec(const std::string& exe,
+                  char* const* args,
+                  char* const* env,
+                  const ProcessOptions& options,
+                  const char* workingDir,
+                  int* fdInput,
+                  int* fdOutput,
+                  int* fdError,
+                  volatile int* pExecErrno)
+{
+   // block signals while the child runs on our stack so that none of
+   // our handlers can run in the child before it resets them
+   sigset_t blockAllMask, oldMask;
+   ::sigfillset(&blockAllMask);
+   ::pthread_sigmask(SIG_SETMASK, &blockAllMask, &oldMask);
+
+   PidType pid = ::vfork();
+   if (pid == 0)
+   {
+      // reset handled signals to their defaults (exec would do this anyway)
+      // so unblocking below cannot invoke a parent handler in the child
+      for (int sig = 1; sig < NSIG; ++sig)
+      {
+         struct sigaction action;
+         if (::sigaction(sig, NULL, &action) == 0 &&
+             action.sa_handler != SIG_DFL &&
+             action.sa_handler != SIG_IGN)
+         {
+            action.sa_handler = SIG_DFL;
+            ::sigaction(sig, &action, NULL);
+         }
+      }
+
+      if (options.detachSession)
+         ::setsid();
+      else if (options.terminateChildren)
+         ::setpgid(0, 0);
+
+      ::dup2(fdInput[READ], STDIN_FILENO);
+      ::dup2(fdOutput[WRITE], STDOUT_FILENO);
+      ::dup2(options.redirectStdErrToStdOut ? fdOutput[WRITE] : fdError[WRITE],
+             STDERR_FILENO);
+
+      // closes the pipes too, as they all live above stderr
+#ifdef SYS_close_range
+      ::syscall(SYS_close_range, STDERR_FILENO + 1, ~0U, 0);
+#endif
+
+      if (workingDir)
+         ::chdir(workingDir);
+
+      sigset_t blockNoneMask;
+      ::sigemptyset(&blockNoneMask);
+      ::sigprocmask(SIG_SETMASK, &blockNoneMask, NULL);
+
+      if (env)
+         ::execve(exe.c_str(), args, env);
+      else
+         ::execv(exe.c_str(), args);
+
+      *pExecErrno = errno;
+      ::_exit(EXIT_FAILURE);
+   }
+
+   int forkErrno = errno;
+   ::pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+   errno = forkErrno;
+   return pid;
+}
+
 } // anonymous namespace
 
 
@@ -519,6 +609,51 @@ Error ChildProcess::run()
          return error;
       }
 
+      // the common case (no user switch or post-fork hook) can skip copying
+      // our page tables: vfork and exec with only async signal-safe calls in
+      // the child, provided the kernel can close inherited descriptors in
+      // one call. anything else takes the conventional fork path below
+      if (options_.runAsUser.empty() && !options_.onAfterFork &&
+          closeRangeSupported())
+      {
+         std::string workingDir = options_.workingDir.absolutePath();
+         volatile int execErrno = 0;
+         pid = vforkExec(exe_,
+                         pProcessArgs->args(),
+                         pEnvironment ? pEnvironment->args() : NULL,
+                         options_,
+                         workingDir.empty() ? NULL : workingDir.c_str(),
+                         fdInput,
+                         fdOutput,
+                         fdError,
+                         &execErrno);
+         if (pid == -1)
+         {
+            Error error = systemError(errno, ERROR_LOCATION);
+            closePipe(fdInput, ERROR_LOCATION);
+            closePipe(fdOutput, ERROR_LOCATION);
+            closePipe(fdError, ERROR_LOCATION);
+            delete pProcessArgs;
+            return error;
+         }
+
+         // the child has exec'd or exited by now, so it is safe to clean up;
+         // a failed exec shows up as the child exiting with a failure status
+         if (execErrno != 0)
+         {
+            Error error = systemError(execErrno, ERROR_LOCATION);
+            error.addProperty("exe", exe_);
+            LOG_ERROR(error);
+         }
+
+         closePipe(fdInput[READ], ERROR_LOCATION);
+         closePipe(fdOutput[WRITE], ERROR_LOCATION);
+         closePipe(fdError[WRITE], ERROR_LOCATION);
+         pImpl_->init(pid, fdInput[WRITE], fdOutput[READ], fdError[READ]);
+         delete pProcessArgs;
+         return Success();
+      }
+
       // close fd communication channel - only used in threadsafe mode
       if (options_.threadSafe)
       {
@@ -957,6 +1092,19 @@ bool AsyncChildProcess::hasRecentOutput() const
       return true;
 }
 
+std::vector<int> AsyncChildProcess::outputDescriptors() const
+{
+   std::vector<int> fds;
+   if (!pAsyncImpl_->calledOnStarted_ || pAsyncImpl_->exited_)
+      return fds;
+
+   if (!pAsyncImpl_->finishedStdout_)
+      fds.push_back(pImpl_->fdStdout);
+   if (!pAsyncImpl_->finishedStderr_)
+      fds.push_back(pImpl_->fdStderr);
+   return fds;
+}
+
 void AsyncChildProcess::poll()
 {
    // call onStarted if we haven't yet
@@ -15,9 +15,16 @@
 
 #include <core/system/PosixChildProcessTracker.hpp>
 
+#include <unistd.h>
 #include <sys/wait.h>
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
+#include <boost/asio/placeholders.hpp>
 
 namespace rstudio {
 namespace core {
@@ -37,6 +44,20 @@ int waitPid(PidType pid, int* pStatus)
    }
 }
 
+// open a file descriptor which becomes readable when the process exits
+// (returns -1 where process file descriptors aren't supported)
+int openPidFd(PidType pid)
+{
+#ifdef __linux__
+# ifndef SYS_pidfd_open
+#  define SYS_pidfd_open 434
+# endif
+   return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#else
+   return -1;
+#endif
+}
+
 } // anonymous namespace
 
 
@@ -49,6 +70,78 @@ void ChildProcessTracker::addProcess(PidType pid, ExitHandler exitHandler)
    END_LOCK_MUTEX
 }
 
+void ChildProcessTracker::addProcess(PidType pid,
+                                     boost::asio::io_service& ioService,
+                                     ExitHandler exitHandler)
+{
+   // fall back to reaping on SIGCHLD without process file descriptors
+   int fd = openPidFd(pid);
+   if (fd == -1)
+   {
+      addProcess(pid, exitHandler);
+      return;
+   }
+
+   PidFd pPidFd(new boost::asio::posix::stream_descriptor(ioService));
+   boost::system::error_code ec;
+   pPidFd->assign(fd, ec);
+   if (ec)
+   {
+      LOG_ERROR(Error(ec, ERROR_LOCATION));
+      ::close(fd);
+      addProcess(pid, exitHandler);
+      return;
+   }
+
+   watchPidFd(pid, pPidFd, exitHandler);
+}
+
+void ChildProcessTracker::watchPidFd(PidType pid,
+                                     PidFd pPidFd,
+                                     ExitHandler exitHandler)
+{
+   pPidFd->async_read_some(
+            boost::asio::null_buffers(),
+            boost::bind(&ChildProcessTracker::onPidFdReadable,
+                        this,
+                        pid,
+                        pPidFd,
+                        exitHandler,
+                        boost::asio::placeholders::error));
+}
+
+void ChildProcessTracker::onPidFdReadable(PidType pid,
+                                          PidFd pPidFd,
+                                          ExitHandler exitHandler,
+                                          const boost::system::error_code& ec)
+{
+   if (ec == boost::asio::error::operation_aborted)
+      return;
+
+   if (ec)
+   {
+      // we can no longer watch the process so leave it to SIGCHLD
+      LOG_ERROR(Error(ec, ERROR_LOCATION));
+      boost::system::error_code closeEc;
+      pPidFd->close(closeEc);
+      addProcess(pid, exitHandler);
+      notifySIGCHILD();
+      return;
+   }
+
+   // the descriptor is readable once the process has exited; keep waiting
+   // if it somehow couldn't be reaped
+   if (attemptToReapProcess(std::make_pair(pid, exitHandler)))
+   {
+      boost::system::error_code closeEc;
+      pPidFd->close(closeEc);
+   }
+   else
+   {
+      watchPidFd(pid, pPidFd, exitHandler);
+   }
+}
+
 void ChildProcessTracker::notifySIGCHILD()
 {
    // We make a copy of hte active pids so that we can do the reaping
@@ -63,7 +156,7 @@ void ChildProcessTracker::notifySIGCHILD()
                              this, _1));
 }
 
-void ChildProcessTracker::attemptToReapProcess(
+bool ChildProcessTracker::attemptToReapProcess(
                               const std::pair<PidType,ExitHandler>& process)
 {
    // non-blocking wait for the child
@@ -97,6 +190,8 @@ void ChildProcessTracker::attemptToReapProcess(
          ExitHandler exitHandler = process.second;
          if (exitHandler)
             exitHandler(pid, status);
+
+         return true;
       }
       else
       {
@@ -111,7 +206,12 @@ void ChildProcessTracker::attemptToReapProcess(
       Error error = systemError(errno, ERROR_LOCATION);
       error.addProperty("pid", pid);
       LOG_ERROR(error);
+
+      // (e.g. ECHILD) there is nothing left to wait for
+      return true;
    }
+
+   return false;
 }
 
 void ChildProcessTracker::removeProcess(PidType pid)
@@ -0,0 +1,162 @@
+/*
+ * PosixChildProcessTrackerTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <core/system/PosixChildProcessTracker.hpp>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <boost/bind.hpp>
+#include <boost/asio/io_service.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace tests {
+
+namespace {
+
+PidType forkExiting(int status)
+{
+   PidType pid = ::fork();
+   if (pid == 0)
+      ::_exit(status);
+   return pid;
+}
+
+void onExit(PidType* pExitedPid, int* pStatus, PidType pid, int status)
+{
+   *pExitedPid = pid;
+   *pStatus = status;
+}
+
+} // anonymous namespace
+
+context("PosixChildProcessTrackerTests")
+{
+   test_that("Processes are reaped on SIGCHLD")
+   {
+      ChildProcessTracker tracker;
+      PidType exitedPid = -1;
+      int status = -1;
+
+      PidType pid = forkExiting(3);
+      expect_true(pid > 0);
+      tracker.addProcess(pid, boost::bind(onExit, &exitedPid, &status, _1, _2));
+
+      // (poll until the child has exited)
+      while (exitedPid == -1)
+      {
+         tracker.notifySIGCHILD();
+         ::usleep(1000);
+      }
+
+      expect_true(exitedPid == pid);
+      expect_true(status == 3);
+   }
+
+   test_that("Processes are reaped on the io service as they exit")
+   {
+      ChildProcessTracker tracker;
+      boost::asio::io_service ioService;
+      PidType exitedPid = -1;
+      int status = -1;
+
+      PidType pid = forkExiting(5);
+      expect_true(pid > 0);
+      tracker.addProcess(pid,
+                         ioService,
+                         boost::bind(onExit, &exitedPid, &status, _1, _2));
+
+      // without process file descriptors the tracker falls back to SIGCHLD
+      ioService.run();
+      while (exitedPid == -1)
+      {
+         tracker.notifySIGCHILD();
+         ::usleep(1000);
+      }
+
+      expect_true(exitedPid == pid);
+      expect_true(status == 5);
+
+      // the child is gone
+      int waitStatus;
+      expect_true(::waitpid(pid, &waitStatus, WNOHANG) == -1);
+   }
+
+   test_that("Only the children which exited are reaped")
+   {
+      ChildProcessTracker tracker;
+      boost::asio::io_service ioService;
+      PidType exitedPid = -1;
+      int status = -1;
+
+      // a child which waits for us to close its pipe
+      int fds[2];
+      expect_true(::pipe(fds) == 0);
+      PidType waitingPid = ::fork();
+      if (waitingPid == 0)
+      {
+         char c;
+         ::close(fds[1]);
+         ssize_t n = ::read(fds[0], &c, 1);
+         ::_exit(n == 0 ? 0 : 1);
+      }
+      ::close(fds[0]);
+
+      PidType waitingExitedPid = -1;
+      int waitingStatus = -1;
+      tracker.addProcess(waitingPid,
+                         ioService,
+                         boost::bind(onExit, &waitingExitedPid, &waitingStatus,
+                                     _1, _2));
+
+      PidType pid = forkExiting(7);
+      tracker.addProcess(pid,
+                         ioService,
+                         boost::bind(onExit, &exitedPid, &status, _1, _2));
+
+      while (exitedPid == -1)
+      {
+         ioService.poll();
+         tracker.notifySIGCHILD();
+         ::usleep(1000);
+      }
+      expect_true(status == 7);
+      expect_true(waitingExitedPid == -1);
+
+      // let the other child go
+      ::close(fds[1]);
+      while (waitingExitedPid == -1)
+      {
+         ioService.poll();
+         tracker.notifySIGCHILD();
+         ::usleep(1000);
+      }
+      expect_true(waitingExitedPid == waitingPid);
+      expect_true(waitingStatus == 0);
+   }
+}
+
+} // namespace tests
+} // namespace system
+} // namespace core
+} // namespace rstudio
+
+#endif // _WIN32
@@ -15,17 +15,25 @@
 
 #include <core/system/FileScanner.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
 
 #include <core/Error.hpp>
 #include <core/Log.hpp>
 #include <core/FilePath.hpp>
 #include <core/BoostThread.hpp>
-
-#include "config.h"
+#include <core/Thread.hpp>
 
 namespace rstudio {
 namespace core {
@@ -33,67 +41,324 @@ namespace system {
 
 namespace {
 
-#if defined(__APPLE__) && !defined(HAVE_SCANDIR_POSIX)
-int entryFilter(struct dirent *entry)
-#else
-int entryFilter(const struct dirent *entry)
-#endif
+bool isDotEntry(const char* name)
 {
-   if (::strcmp(entry->d_name, ".") == 0 || ::strcmp(entry->d_name, "..") == 0)
-      return 0;
-   else
-      return 1;
+   return ::strcmp(name, ".") == 0 || ::strcmp(name, "..") == 0;
 }
 
-// note: because R may change LC_COLLATE, we cannot
-// use strcoll (otherwise we run into race issues where
-// the file monitor attempts to access LC_COLLATE just as
-// R is replacing it). to avoid this, we use strcmp and
-// don't sort according to locale.
-#if !defined(HAVE_SCANDIR_POSIX)
-int alphasort(const void* voidlhs, const void* voidrhs)
+std::time_t lastWriteTime(const struct stat& st)
 {
-   const dirent** lhs = (const dirent**)voidlhs;
-   const dirent** rhs = (const dirent**)voidrhs;
+#ifdef __APPLE__
+   return st.st_mtimespec.tv_sec;
 #else
-int alphasort(const dirent** lhs, const dirent** rhs)
-{
+   return st.st_mtime;
 #endif
-   return strcmp((*lhs)->d_name, (*rhs)->d_name);
 }
 
-// wrapper for scandir api
-Error scanDir(const std::string& dirPath, std::vector<std::string>* pNames)
+// read the attributes of a directory entry (returns false if the entry
+// can no longer be read)
+bool readFileInfo(int dirFd,
+                  const struct dirent* pEntry,
+                  const std::string& path,
+                  bool followSymlinks,
+                  FileInfo* pFileInfo)
+{
+   // the listing tells us which entries are directories, and that's all
+   // we need to know about them
+   if (pEntry->d_type == DT_DIR)
+   {
+      *pFileInfo = FileInfo(path, true, false);
+      return true;
+   }
+
+   struct stat st;
+   int res = ::fstatat(dirFd,
+                       pEntry->d_name,
+                       &st,
+                       followSymlinks ? 0 : AT_SYMLINK_NOFOLLOW);
+   if (res == -1)
+   {
+      if (errno != ENOENT && errno != EACCES)
+      {
+         Error error = systemError(errno, ERROR_LOCATION);
+         error.addProperty("path", path);
+         LOG_ERROR(error);
+      }
+      return false;
+   }
+
+   bool isSymlink = S_ISLNK(st.st_mode) || pEntry->d_type == DT_LNK;
+   if (S_ISDIR(st.st_mode))
+   {
+      *pFileInfo = FileInfo(path, true, isSymlink);
+   }
+   else
+   {
+      *pFileInfo = FileInfo(path,
+                            false,
+                            st.st_size,
+                            lastWriteTime(st),
+                            isSymlink);
+   }
+   return true;
+}
+
+} // anonymous namespace
+
+Error scanDirectory(const FilePath& dirPath,
+                    bool followSymlinks,
+                    std::vector<FileInfo>* pFiles)
 {
-   // read directory contents into namelist
-   struct dirent **namelist;
-   int entries = ::scandir(dirPath.c_str(),
-                           &namelist,
-                           entryFilter,
-                           alphasort);
-   if (entries == -1)
+   pFiles->clear();
+
+   std::string path = dirPath.absolutePath();
+   int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+   if (fd == -1)
    {
       Error error = systemError(errno, ERROR_LOCATION);
-      error.addProperty("path", dirPath);
+      error.addProperty("path", path);
       return error;
    }
 
-   // extract the namelist then free it
-   for(int i=0; i<entries; i++)
+   // the directory stream owns the descriptor once opened
+   DIR* pDir = ::fdopendir(fd);
+   if (pDir == NULL)
    {
-      // get the name (then free it)
-      std::string name(namelist[i]->d_name,
-#ifdef __APPLE__
-                       namelist[i]->d_namlen);
-#else
-                       namelist[i]->d_reclen);
-#endif
-      ::free(namelist[i]);
+      Error error = systemError(errno, ERROR_LOCATION);
+      error.addProperty("path", path);
+      ::close(fd);
+      return error;
+   }
+
+   std::string prefix = path;
+   if (prefix.empty() || prefix[prefix.size() - 1] != '/')
+      prefix.push_back('/');
+
+   // readdir reads many entries per call (via getdents on linux), so
+   // this is one round trip for the listing plus one per non-directory
+   int readErrno = 0;
+   while (true)
+   {
+      errno = 0;
+      struct dirent* pEntry = ::readdir(pDir);
+      if (pEntry == NULL)
+      {
+         readErrno = errno;
+         break;
+      }
+
+      if (isDotEntry(pEntry->d_name))
+         continue;
+
+      FileInfo fileInfo;
+      if (readFileInfo(::dirfd(pDir),
+                       pEntry,
+                       prefix + pEntry->d_name,
+                       followSymlinks,
+                       &fileInfo))
+      {
+         pFiles->push_back(fileInfo);
+      }
+   }
+
+   ::closedir(pDir);
 
-      // add to the vector
-      pNames->push_back(name);
+   if (readErrno != 0)
+   {
+      Error error = systemError(readErrno, ERROR_LOCATION);
+      error.addProperty("path", path);
+      return error;
+   }
+
+   // note: because R may change LC_COLLATE, we cannot use strcoll (otherwise
+   // we run into race issues where the file monitor attempts to access
+   // LC_COLLATE just as R is replacing it). to avoid this, we sort with
+   // strcmp and don't sort according to locale.
+   std::sort(pFiles->begin(), pFiles->end(), fileInfoPathLessThan);
+
+   return Success();
+}
+
+namespace {
+
+struct DirectoryListing
+{
+   tree<FileInfo>::iterator_base node;
+   std::string path;
+   Error error;
+   std::vector<FileInfo> files;
+};
+
+// reads directory listings on a pool of threads. everything else (the
+// hooks, filtering and building the tree) is left to the scanning thread
+// so that callers needn't make those thread-safe
+class DirectoryLister : boost::noncopyable
+{
+public:
+   explicit DirectoryLister(int threads)
+      : pending_(0), stopped_(false)
+   {
+      for (int i = 0; i < threads; i++)
+         threads_.create_thread(boost::bind(&DirectoryLister::run, this));
+   }
+
+   ~DirectoryLister()
+   {
+      try
+      {
+         LOCK_MUTEX(mutex_)
+         {
+            stopped_ = true;
+         }
+         END_LOCK_MUTEX
+
+         requestsCondition_.notify_all();
+         threads_.join_all();
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   void list(const tree<FileInfo>::iterator_base& node)
+   {
+      boost::shared_ptr<DirectoryListing> pListing(new DirectoryListing());
+      pListing->node = node;
+      pListing->path = node->absolutePath();
+
+      LOCK_MUTEX(mutex_)
+      {
+         requests_.push_back(pListing);
+      }
+      END_LOCK_MUTEX
+
+      ++pending_;
+      requestsCondition_.notify_one();
+   }
+
+   // are there listings which haven't been taken yet?
+   bool pending() const
+   {
+      return pending_ > 0;
+   }
+
+   // wait for the next listing (in order of completion)
+   boost::shared_ptr<DirectoryListing> take()
+   {
+      boost::shared_ptr<DirectoryListing> pListing;
+
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (results_.empty())
+         resultsCondition_.wait(lock);
+      pListing = results_.front();
+      results_.pop_front();
+
+      --pending_;
+      return pListing;
+   }
+
+private:
+   void run()
+   {
+      try
+      {
+         while (true)
+         {
+            boost::shared_ptr<DirectoryListing> pListing;
+            {
+               boost::unique_lock<boost::mutex> lock(mutex_);
+               while (requests_.empty() && !stopped_)
+                  requestsCondition_.wait(lock);
+               if (stopped_)
+                  return;
+               pListing = requests_.front();
+               requests_.pop_front();
+            }
+
+            pListing->error = scanDirectory(FilePath(pListing->path),
+                                            false,
+                                            &pListing->files);
+
+            LOCK_MUTEX(mutex_)
+            {
+               results_.push_back(pListing);
+            }
+            END_LOCK_MUTEX
+
+            resultsCondition_.notify_one();
+         }
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   // only used by the scanning thread
+   std::size_t pending_;
+
+   boost::mutex mutex_;
+   boost::condition_variable requestsCondition_;
+   boost::condition_variable resultsCondition_;
+   std::deque<boost::shared_ptr<DirectoryListing> > requests_;
+   std::deque<boost::shared_ptr<DirectoryListing> > results_;
+   bool stopped_;
+
+   boost::thread_group threads_;
+};
+
+// scan a tree breadth first, listing several directories at a time. the
+// resulting tree is the same as that of a serial scan (each directory's
+// children are added together, in order) though it's built in a different
+// order (as are the calls to onBeforeScanDir)
+Error scanFilesParallel(const tree<FileInfo>::iterator_base& fromNode,
+                        const FileScannerOptions& options,
+                        tree<FileInfo>* pTree)
+{
+   if (options.onBeforeScanDir)
+   {
+      Error error = options.onBeforeScanDir(*fromNode);
+      if (error)
+         return error;
+   }
+
+   DirectoryLister lister(options.threads);
+   lister.list(fromNode);
+
+   while (lister.pending())
+   {
+      boost::shared_ptr<DirectoryListing> pListing = lister.take();
+      if (pListing->error)
+      {
+         // as with serial scans, a failure to list a subdirectory leaves
+         // it empty rather than failing the scan
+         if (&*pListing->node == &*fromNode)
+            return pListing->error;
+
+         LOG_ERROR(pListing->error);
+         continue;
+      }
+
+      BOOST_FOREACH(const FileInfo& fileInfo, pListing->files)
+      {
+         if (options.filter && !options.filter(fileInfo))
+            continue;
+
+         tree<FileInfo>::iterator_base child =
+                              pTree->append_child(pListing->node, fileInfo);
+
+         // don't descend into links
+         if (!fileInfo.isDirectory() || fileInfo.isSymlink())
+            continue;
+
+         if (options.onBeforeScanDir)
+         {
+            Error error = options.onBeforeScanDir(fileInfo);
+            if (error)
+            {
+               LOG_ERROR(error);
+               continue;
+            }
+         }
+
+         lister.list(child);
+      }
    }
-   ::free(namelist);
 
    return Success();
 }
@@ -107,6 +372,9 @@ Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
    // clear all existing
    pTree->erase_children(fromNode);
 
+   if (options.recursive && options.threads > 1)
+      return scanFilesParallel(fromNode, options, pTree);
+
    // create FilePath for root
    FilePath rootPath(fromNode->absolutePath());
 
@@ -123,51 +391,14 @@ Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
    }
 
    // read directory contents
-   std::vector<std::string> names;
-   Error error = scanDir(fromNode->absolutePath(), &names);
+   std::vector<FileInfo> files;
+   Error error = scanDirectory(rootPath, false, &files);
    if (error)
       return error;
 
-   // iterate over the names
-   BOOST_FOREACH(const std::string& name, names)
+   // iterate over the files
+   BOOST_FOREACH(const FileInfo& fileInfo, files)
    {
-      // compute the path
-      std::string path = rootPath.childPath(name).absolutePath();
-
-      // get the attributes
-      struct stat st;
-      int res = ::lstat(path.c_str(), &st);
-      if (res == -1)
-      {
-         if (errno != ENOENT && errno != EACCES)
-         {
-            Error error = systemError(errno, ERROR_LOCATION);
-            error.addProperty("path", path);
-            LOG_ERROR(error);
-         }
-         continue;
-      }
-
-      // create the FileInfo
-      FileInfo fileInfo;
-      bool isSymlink = S_ISLNK(st.st_mode);
-      if (S_ISDIR(st.st_mode))
-      {
-         fileInfo = FileInfo(path, true, isSymlink);
-      }
-      else
-      {
-         fileInfo = FileInfo(path,
-                             false,
-                             st.st_size,
-#ifdef __APPLE__
-                             st.st_mtimespec.tv_sec,
-#else
-                             st.st_mtime,
-#endif
-                             isSymlink);
-      }
-
       // apply the filter (if any)
       if (!options.filter || options.filter(fileInfo))
       {
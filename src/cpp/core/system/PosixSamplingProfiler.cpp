@@ -0,0 +1,371 @@
+/*
+ * PosixSamplingProfiler.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/system/PosixSamplingProfiler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/Backtrace.hpp>
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/Thread.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace sampling_profiler {
+
+namespace {
+
+const int kMaxDepth = 64;
+
+// the handler and signal trampoline
+const int kSkippedFrames = 2;
+
+// about three minutes of one busy thread at the default frequency
+const int kMaxSamples = 20000;
+
+struct Sample
+{
+   long threadId;
+   int depth;
+   void* frames[kMaxDepth];
+};
+
+// written by the signal handler (on any thread), so only touched through
+// atomics while sampling
+std::atomic<Sample*> s_pSamples(NULL);
+std::atomic<int> s_sampleCount(0);
+
+struct sigaction s_previousAction;
+
+long currentThreadId()
+{
+#ifdef __linux__
+   return ::syscall(SYS_gettid);
+#else
+   return 0;
+#endif
+}
+
+void onProfileSignal(int)
+{
+   int savedErrno = errno;
+
+   Sample* pSamples = s_pSamples.load();
+   if (pSamples != NULL)
+   {
+      int index = s_sampleCount.fetch_add(1);
+      if (index < kMaxSamples)
+      {
+         Sample& sample = pSamples[index];
+         sample.threadId = currentThreadId();
+
+         // depth is set last; a sample still being taken when we stop is
+         // left with a depth of zero and skipped
+         sample.depth = ::backtrace(sample.frames, kMaxDepth);
+      }
+   }
+
+   errno = savedErrno;
+}
+
+Error setTimer(int frequencyHz)
+{
+   struct itimerval timer;
+   timer.it_interval.tv_sec = 0;
+   timer.it_interval.tv_usec = frequencyHz > 0 ? 1000000 / frequencyHz : 0;
+   timer.it_value = timer.it_interval;
+   if (::setitimer(ITIMER_PROF, &timer, NULL) == -1)
+      return systemError(errno, ERROR_LOCATION);
+   return Success();
+}
+
+std::string threadName(long threadId)
+{
+   if (threadId == ::getpid())
+      return "main";
+
+   std::string name;
+   FilePath commPath("/proc/self/task/" +
+                     safe_convert::numberToString(threadId) + "/comm");
+   if (!readStringFromFile(commPath, &name))
+      boost::algorithm::trim(name);
+
+   // threads may have exited (or share the process's name)
+   return "thread-" + safe_convert::numberToString(threadId) +
+          (name.empty() ? std::string() : " (" + name + ")");
+}
+
+std::string symbolize(void* address)
+{
+   Dl_info info;
+   if (::dladdr(address, &info) != 0)
+   {
+      if (info.dli_sname != NULL)
+         return backtrace::demangle(info.dli_sname);
+
+      // functions the dynamic symbol table doesn't export can be resolved
+      // offline (e.g. with addr2line) from their module offset
+      if (info.dli_fname != NULL)
+      {
+         std::size_t offset = static_cast<char*>(address) -
+                              static_cast<char*>(info.dli_fbase);
+         return FilePath(info.dli_fname).filename() +
+                boost::str(boost::format("+0x%x") % offset);
+      }
+   }
+
+   return boost::str(boost::format("%p") % address);
+}
+
+std::string foldedStacks(const Sample* pSamples, int count)
+{
+   std::map<void*, std::string> symbols;
+   std::map<long, std::string> threadNames;
+   std::map<std::string, int> stacks;
+
+   for (int i = 0; i < count; i++)
+   {
+      const Sample& sample = pSamples[i];
+      if (sample.depth <= kSkippedFrames)
+         continue;
+
+      if (threadNames.find(sample.threadId) == threadNames.end())
+         threadNames[sample.threadId] = threadName(sample.threadId);
+      std::string stack = threadNames[sample.threadId];
+
+      // frames are innermost first; all but the interrupted one are return
+      // addresses, which we look up one byte back so a call at the very end
+      // of a function isn't attributed to the next
+      for (int frame = sample.depth - 1; frame >= kSkippedFrames; frame--)
+      {
+         void* address = sample.frames[frame];
+         if (frame != kSkippedFrames)
+            address = static_cast<char*>(address) - 1;
+
+         std::map<void*, std::string>::const_iterator it = symbols.find(address);
+         if (it == symbols.end())
+         {
+            std::string symbol = symbolize(address);
+            boost::algorithm::replace_all(symbol, ";", ":");
+            it = symbols.insert(std::make_pair(address, symbol)).first;
+         }
+
+         stack += ";" + it->second;
+      }
+
+      stacks[stack]++;
+   }
+
+   std::string folded;
+   for (std::map<std::string, int>::const_iterator it = stacks.begin();
+        it != stacks.end();
+        ++it)
+   {
+      folded += it->first + " " + safe_convert::numberToString(it->second) + "\n";
+   }
+   return folded;
+}
+
+// toggle signal state
+volatile sig_atomic_t s_toggleRequested = 0;
+FilePath s_outputDir;
+boost::thread s_toggleThread;
+
+void onToggleSignal(int)
+{
+   s_toggleRequested = 1;
+}
+
+void toggleThreadMain()
+{
+   try
+   {
+      while (true)
+      {
+         boost::this_thread::sleep(boost::posix_time::milliseconds(250));
+         if (!s_toggleRequested)
+            continue;
+         s_toggleRequested = 0;
+
+         if (!running())
+         {
+            Error error = start();
+            if (error)
+               LOG_ERROR(error);
+            else
+               LOG_INFO_MESSAGE("Sampling profiler started");
+            continue;
+         }
+
+         std::string time = boost::posix_time::to_iso_string(
+                  boost::posix_time::second_clock::local_time());
+         FilePath outputPath = s_outputDir.childPath(
+                  "profile-" + safe_convert::numberToString(::getpid()) +
+                  "-" + time + ".folded");
+
+         Error error = s_outputDir.ensureDirectory();
+         if (!error)
+            error = stop(outputPath);
+         if (error)
+            LOG_ERROR(error);
+         else
+            LOG_INFO_MESSAGE("Sampling profile written to " +
+                             outputPath.absolutePath());
+      }
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
+} // anonymous namespace
+
+Error start(int frequencyHz)
+{
+   if (running())
+      return systemError(boost::system::errc::operation_in_progress,
+                         ERROR_LOCATION);
+
+   // don't take SIGPROF from someone else (e.g. Rprof)
+   struct sigaction current;
+   if (::sigaction(SIGPROF, NULL, &current) == -1)
+      return systemError(errno, ERROR_LOCATION);
+   if (current.sa_handler != SIG_DFL && current.sa_handler != SIG_IGN)
+   {
+      return systemError(boost::system::errc::device_or_resource_busy,
+                         "SIGPROF is in use (is Rprof running?)",
+                         ERROR_LOCATION);
+   }
+
+   // the first backtrace loads the unwinder, which isn't safe to do within
+   // the signal handler
+   void* frames[1];
+   ::backtrace(frames, 1);
+
+   s_sampleCount = 0;
+   s_pSamples = new Sample[kMaxSamples]();
+
+   struct sigaction action;
+   ::memset(&action, 0, sizeof(action));
+   action.sa_handler = onProfileSignal;
+   action.sa_flags = SA_RESTART;
+   ::sigemptyset(&action.sa_mask);
+   if (::sigaction(SIGPROF, &action, &s_previousAction) == -1)
+   {
+      Error error = systemError(errno, ERROR_LOCATION);
+      delete [] s_pSamples.exchange(NULL);
+      return error;
+   }
+
+   Error error = setTimer(frequencyHz);
+   if (error)
+   {
+      ::sigaction(SIGPROF, &s_previousAction, NULL);
+      delete [] s_pSamples.exchange(NULL);
+      return error;
+   }
+
+   return Success();
+}
+
+bool running()
+{
+   return s_pSamples.load() != NULL;
+}
+
+Error stop(const FilePath& outputPath)
+{
+   if (!running())
+      return systemError(boost::system::errc::operation_not_permitted,
+                         "The sampling profiler is not running",
+                         ERROR_LOCATION);
+
+   Error error = setTimer(0);
+   if (error)
+      LOG_ERROR(error);
+
+   // let handlers already running on other threads finish their sample
+   boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+
+   Sample* pSamples = s_pSamples.exchange(NULL);
+   if (::sigaction(SIGPROF, &s_previousAction, NULL) == -1)
+      LOG_ERROR(systemError(errno, ERROR_LOCATION));
+
+   int count = std::min(s_sampleCount.load(), kMaxSamples);
+   if (s_sampleCount.load() > kMaxSamples)
+   {
+      LOG_WARNING_MESSAGE("Sampling profile truncated to " +
+                          safe_convert::numberToString(kMaxSamples) +
+                          " samples");
+   }
+
+   std::string folded = foldedStacks(pSamples, count);
+   delete [] pSamples;
+
+   return writeStringToFile(outputPath, folded);
+}
+
+Error registerToggleSignal(int signal, const FilePath& outputDir)
+{
+   s_outputDir = outputDir;
+
+   struct sigaction action;
+   ::memset(&action, 0, sizeof(action));
+   action.sa_handler = onToggleSignal;
+   action.sa_flags = SA_RESTART;
+   ::sigemptyset(&action.sa_mask);
+   if (::sigaction(signal, &action, NULL) == -1)
+      return systemError(errno, ERROR_LOCATION);
+
+   if (!s_toggleThread.joinable())
+   {
+      core::thread::safeLaunchThread(toggleThreadMain, &s_toggleThread);
+      if (!s_toggleThread.joinable())
+         return systemError(boost::system::errc::resource_unavailable_try_again,
+                            "Unable to start the sampling profiler thread",
+                            ERROR_LOCATION);
+   }
+
+   return Success();
+}
+
+} // namespace sampling_profiler
+} // namespace system
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,85 @@
+/*
+ * PosixSamplingProfilerTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <core/system/PosixSamplingProfiler.hpp>
+
+#include <ctime>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace tests {
+
+namespace {
+
+volatile double s_sink = 0;
+
+void spin(double seconds)
+{
+   std::clock_t start = std::clock();
+   while (std::clock() - start < seconds * CLOCKS_PER_SEC)
+      s_sink = s_sink + 1;
+}
+
+} // anonymous namespace
+
+context("PosixSamplingProfilerTests")
+{
+   test_that("Busy main thread time is sampled into folded stacks")
+   {
+      FilePath profilePath;
+      expect_false(FilePath::tempFilePath(&profilePath));
+
+      expect_false(sampling_profiler::start(200));
+      expect_true(sampling_profiler::running());
+      expect_true(sampling_profiler::start(200));
+
+      spin(0.5);
+
+      expect_false(sampling_profiler::stop(profilePath));
+      expect_false(sampling_profiler::running());
+
+      std::string folded;
+      expect_false(readStringFromFile(profilePath, &folded));
+      expect_true(boost::algorithm::starts_with(folded, "main;"));
+
+      profilePath.remove();
+   }
+
+   test_that("Stopping without starting is an error")
+   {
+      FilePath profilePath;
+      expect_false(FilePath::tempFilePath(&profilePath));
+      expect_true(sampling_profiler::stop(profilePath));
+      expect_false(profilePath.exists());
+   }
+}
+
+} // end namespace tests
+} // end namespace system
+} // end namespace core
+} // end namespace rstudio
+
+#endif // _WIN32
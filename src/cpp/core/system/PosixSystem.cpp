@@ -18,6 +18,7 @@
 #include <stdio.h>
 
 #include <iostream>
+#include <map>
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
@@ -74,6 +75,7 @@
 #include <core/StringUtils.hpp>
 #include <core/SafeConvert.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/Thread.hpp>
 
 #include <core/system/ProcessArgs.hpp>
 #include <core/system/Environment.hpp>
@@ -358,9 +360,12 @@ Error SignalBlocker::block(SignalType signal)
 
 Error SignalBlocker::blockAll()
 {
-   // create mask to block all signals
+   // create mask to block all signals (other than SIGPROF, so sampling
+   // profilers see every thread's cpu use -- both Rprof and ours handle
+   // it from any thread)
    sigset_t blockMask;
    sigfillset(&blockMask);
+   sigdelset(&blockMask, SIGPROF);
    
    // block
    return pImpl_->block(&blockMask);
@@ -1052,16 +1057,11 @@ std::vector<SubprocInfo> getSubprocessesMac(PidType pid)
 
 #else
 
-std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid)
-{
-   std::vector<SubprocInfo> subprocs;
-
-   core::FilePath procFsPath("/proc");
-   if (!procFsPath.exists())
-   {
-      return getSubprocessesViaPgrep(pid);
-   }
+namespace {
 
+// Read the parent pid and info of every process in procfs
+void readProcFsProcesses(std::vector<std::pair<PidType, SubprocInfo> >* pProcesses)
+{
    // We iterate all /proc/###/stat files, where ### is a process id.
    //
    // The parent pid is the fourth field (whitespace separated) in the
@@ -1079,12 +1079,13 @@ std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid)
    // An example:
    //    4075 (My )(great Program) S 4074 ....
 
+   core::FilePath procFsPath("/proc");
    std::vector<FilePath> children;
    Error error = procFsPath.children(&children);
    if (error)
    {
       LOG_ERROR(error);
-      return subprocs;
+      return;
    }
 
    BOOST_FOREACH(const FilePath& child, children)
@@ -1141,11 +1142,6 @@ std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid)
          LOG_ERROR_MESSAGE("unrecognized parent process id");
          continue;
       }
-      if (ppid != pid)
-      {
-         continue;
-      }
-
       size_t openParen = contents.find_first_of('(');
       if (openParen == std::string::npos)
       {
@@ -1171,11 +1167,148 @@ std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid)
          LOG_ERROR_MESSAGE("unrecognized child process id");
          continue;
       }
-      subprocs.push_back(info);
+      pProcesses->push_back(std::make_pair(ppid, info));
+   }
+}
+
+// A snapshot of the process table, shared by all callers and refreshed at
+// most once per interval (scanning procfs gets expensive when e.g. many
+// terminals are each checking for subprocesses)
+class ProcessTableSnapshot : boost::noncopyable
+{
+public:
+   std::vector<SubprocInfo> children(PidType pid)
+   {
+      std::vector<SubprocInfo> subprocs;
+
+      LOCK_MUTEX(mutex_)
+      {
+         boost::posix_time::ptime now =
+               boost::posix_time::microsec_clock::universal_time();
+         if (refreshed_.is_not_a_date_time() ||
+             now - refreshed_ > boost::posix_time::milliseconds(200))
+         {
+            std::vector<std::pair<PidType, SubprocInfo> > processes;
+            readProcFsProcesses(&processes);
+
+            byParent_.clear();
+            byParent_.insert(processes.begin(), processes.end());
+            refreshed_ = now;
+         }
+
+         typedef std::multimap<PidType, SubprocInfo>::const_iterator Iterator;
+         std::pair<Iterator, Iterator> range = byParent_.equal_range(pid);
+         for (Iterator it = range.first; it != range.second; ++it)
+            subprocs.push_back(it->second);
+      }
+      END_LOCK_MUTEX
+
+      return subprocs;
+   }
+
+private:
+   boost::mutex mutex_;
+   boost::posix_time::ptime refreshed_;
+   std::multimap<PidType, SubprocInfo> byParent_;
+};
+
+ProcessTableSnapshot& processTableSnapshot()
+{
+   static ProcessTableSnapshot instance;
+   return instance;
+}
+
+} // anonymous namespace
+
+std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid)
+{
+   std::vector<SubprocInfo> subprocs;
+
+   core::FilePath procFsPath("/proc");
+   if (!procFsPath.exists())
+   {
+      return getSubprocessesViaPgrep(pid);
+   }
+
+   std::vector<std::pair<PidType, SubprocInfo> > processes;
+   readProcFsProcesses(&processes);
+
+   typedef std::pair<PidType, SubprocInfo> Process;
+   BOOST_FOREACH(const Process& process, processes)
+   {
+      if (process.first == pid)
+         subprocs.push_back(process.second);
    }
 
    return subprocs;
 }
+
+bool getSubprocessesViaProcChildren(PidType pid,
+                                    std::vector<SubprocInfo>* pSubprocs)
+{
+   // the children files aren't available on all kernels (they need
+   // CONFIG_PROC_CHILDREN); remember if we find they're missing
+   static bool s_unsupported = false;
+   if (s_unsupported)
+      return false;
+
+   FilePath procPath("/proc/" + safe_convert::numberToString(pid));
+   if (!procPath.exists())
+      return true; // no such process (so no subprocesses)
+
+   FilePath taskPath = procPath.complete("task");
+   FilePath mainTaskChildren = taskPath.complete(
+            safe_convert::numberToString(pid) + "/children");
+   if (!mainTaskChildren.exists())
+   {
+      if (procPath.exists())
+         s_unsupported = true;
+      return false;
+   }
+
+   // each thread of the process lists the children it created
+   std::vector<FilePath> tasks;
+   Error error = taskPath.children(&tasks);
+   if (error)
+      return false;
+
+   BOOST_FOREACH(const FilePath& task, tasks)
+   {
+      std::string contents;
+      Error error = rstudio::core::readStringFromFile(task.complete("children"),
+                                                      &contents);
+      if (error)
+         continue;
+
+      std::vector<std::string> pids;
+      boost::algorithm::split(pids,
+                              contents,
+                              boost::algorithm::is_space(),
+                              boost::algorithm::token_compress_on);
+      BOOST_FOREACH(const std::string& childPid, pids)
+      {
+         if (childPid.empty())
+            continue;
+
+         SubprocInfo info;
+         info.pid = safe_convert::stringTo<PidType>(childPid, -1);
+         if (info.pid == -1)
+            continue;
+
+         // the child may have exited since we read the children file
+         Error error = rstudio::core::readStringFromFile(
+                  FilePath("/proc/" + childPid + "/comm"),
+                  &info.exe);
+         if (error)
+            continue;
+
+         boost::algorithm::trim_right(info.exe);
+         pSubprocs->push_back(info);
+      }
+   }
+
+   return true;
+}
 #endif // !__APPLE__
 
 std::vector<SubprocInfo> getSubprocesses(PidType pid)
@@ -1183,7 +1316,14 @@ std::vector<SubprocInfo> getSubprocesses(PidType pid)
 #ifdef __APPLE__
    return getSubprocessesMac(pid);
 #else // Linux
-   return getSubprocessesViaProcFs(pid);
+   std::vector<SubprocInfo> subprocs;
+   if (getSubprocessesViaProcChildren(pid, &subprocs))
+      return subprocs;
+
+   if (!FilePath("/proc").exists())
+      return getSubprocessesViaPgrep(pid);
+
+   return processTableSnapshot().children(pid);
 #endif
 }
 
@@ -1426,6 +1566,59 @@ Error systemInformation(SysInfo* pSysInfo)
    return Success();
 }
 
+Error availableMemoryKb(long* pKb)
+{
+#ifndef __APPLE__
+   std::string meminfo;
+   Error error = readStringFromFile(FilePath("/proc/meminfo"), &meminfo);
+   if (error)
+      return error;
+
+   // MemAvailable is only reported by linux 3.14 and later; MemFree
+   // underestimates (it doesn't count reclaimable caches) but is safe
+   boost::smatch match;
+   if (regex_utils::search(meminfo, match, boost::regex("MemAvailable:\\s+(\\d+)")) ||
+       regex_utils::search(meminfo, match, boost::regex("MemFree:\\s+(\\d+)")))
+   {
+      *pKb = safe_convert::stringTo<long>(std::string(match[1]), 0);
+      return Success();
+   }
+
+   return systemError(boost::system::errc::protocol_error,
+                      "Available memory not reported in /proc/meminfo",
+                      ERROR_LOCATION);
+#else
+   return systemError(boost::system::errc::not_supported, ERROR_LOCATION);
+#endif
+}
+
+Error processResidentMemoryKb(PidType pid, long* pKb)
+{
+#ifndef __APPLE__
+   // statm reports (in pages) total program size then resident set size
+   FilePath statmPath("/proc/" + safe_convert::numberToString(pid) + "/statm");
+   std::string statm;
+   Error error = readStringFromFile(statmPath, &statm);
+   if (error)
+      return error;
+
+   std::vector<std::string> fields;
+   boost::algorithm::split(fields, statm, boost::algorithm::is_space());
+   if (fields.size() < 2)
+   {
+      return systemError(boost::system::errc::protocol_error,
+                         "Unexpected contents in " + statmPath.absolutePath(),
+                         ERROR_LOCATION);
+   }
+
+   long pages = safe_convert::stringTo<long>(fields[1], 0);
+   *pKb = pages * (::sysconf(_SC_PAGESIZE) / 1024);
+   return Success();
+#else
+   return systemError(boost::system::errc::not_supported, ERROR_LOCATION);
+#endif
+}
+
 namespace  {
 
 void toPids(const std::vector<std::string>& lines, std::vector<PidType>* pPids)
@@ -1961,6 +2154,14 @@ void setProcessLimits(ProcessLimits limits)
          LOG_ERROR(error);
    }
 #endif
+
+   // cgroup
+   if (!limits.cgroup.empty())
+   {
+      Error error = cgroups::joinProcessCgroup(limits.cgroup);
+      if (error)
+         LOG_ERROR(error);
+   }
 }
 
 
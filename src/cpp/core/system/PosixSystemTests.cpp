@@ -218,6 +218,45 @@ context("PosixSystemTests")
          ::waitpid(pid, NULL, 0);
       }
    }
+
+   test_that("Subprocess detected correctly with procfs children method")
+   {
+      std::vector<SubprocInfo> ignored;
+      if (!getSubprocessesViaProcChildren(getpid(), &ignored))
+         return; // not supported by this kernel
+
+      pid_t pid = fork();
+      expect_false(pid == -1);
+      std::string exe = "sleep";
+
+      if (pid == 0)
+      {
+         execlp(exe.c_str(), exe.c_str(), "10000", NULL);
+         expect_true(false); // shouldn't get here!
+      }
+      else
+      {
+         // we now have a subprocess (which itself has none)
+         ::sleep(1);
+         std::vector<SubprocInfo> children;
+         expect_true(getSubprocessesViaProcChildren(getpid(), &children));
+
+         bool found = false;
+         BOOST_FOREACH(SubprocInfo info, children)
+         {
+            if (info.pid == pid && info.exe == exe)
+               found = true;
+         }
+         expect_true(found);
+
+         std::vector<SubprocInfo> grandchildren;
+         expect_true(getSubprocessesViaProcChildren(pid, &grandchildren));
+         expect_true(grandchildren.empty());
+
+         ::kill(pid, SIGKILL);
+         ::waitpid(pid, NULL, 0);
+      }
+   }
 #endif // !__APPLE__
 
    test_that("Empty list of subprocesses returned correctly with generic method")
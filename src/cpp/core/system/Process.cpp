@@ -17,6 +17,10 @@
 
 #include <iostream>
 
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
 #include <boost/algorithm/cxx11/any_of.hpp>
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
@@ -355,6 +359,73 @@ void ProcessSupervisor::terminateAll()
    }
 }
 
+namespace {
+
+// wait for up to the polling interval for output from the children (or for
+// any of them to exit). we can only block on the children's pipes if all
+// of them have pipes to wait on, otherwise we sleep for the whole interval
+void waitForChildren(
+      const std::vector<boost::shared_ptr<AsyncChildProcess> >& children,
+      const boost::posix_time::time_duration& pollingInterval)
+{
+#ifndef _WIN32
+   std::vector<struct pollfd> pollFds;
+   BOOST_FOREACH(const boost::shared_ptr<AsyncChildProcess>& pChild, children)
+   {
+      std::vector<int> fds = pChild->outputDescriptors();
+      if (fds.empty())
+      {
+         pollFds.clear();
+         break;
+      }
+
+      BOOST_FOREACH(int fd, fds)
+      {
+         struct pollfd pollFd;
+         pollFd.fd = fd;
+         pollFd.events = POLLIN;
+         pollFd.revents = 0;
+         pollFds.push_back(pollFd);
+      }
+   }
+
+   if (!pollFds.empty())
+   {
+      // an interruption (EINTR) just results in an early poll
+      ::poll(&pollFds[0],
+             pollFds.size(),
+             static_cast<int>(pollingInterval.total_milliseconds()));
+      return;
+   }
+#else
+   std::vector<HANDLE> handles;
+   BOOST_FOREACH(const boost::shared_ptr<AsyncChildProcess>& pChild, children)
+   {
+      std::vector<HANDLE> childHandles = pChild->waitHandles();
+      if (childHandles.empty())
+      {
+         handles.clear();
+         break;
+      }
+      handles.insert(handles.end(), childHandles.begin(), childHandles.end());
+   }
+
+   if (!handles.empty() && handles.size() <= MAXIMUM_WAIT_OBJECTS)
+   {
+      ::WaitForMultipleObjects(
+               static_cast<DWORD>(handles.size()),
+               &handles[0],
+               FALSE /*bWaitAll*/,
+               static_cast<DWORD>(pollingInterval.total_milliseconds()));
+      return;
+   }
+#endif
+
+   boost::this_thread::sleep(pollingInterval);
+}
+
+} // anonymous namespace
+
 bool ProcessSupervisor::wait(
       const boost::posix_time::time_duration& pollingInterval,
       const boost::posix_time::time_duration& maxWait)
@@ -365,8 +436,8 @@ bool ProcessSupervisor::wait(
 
    while (poll())
    {
-      // wait the specified polling interval
-      boost::this_thread::sleep(pollingInterval);
+      // wait (at most) the specified polling interval
+      waitForChildren(pImpl_->children, pollingInterval);
 
       // check for timeout if appropriate
       if (!timeoutTime.is_not_a_date_time())
@@ -144,6 +144,111 @@ Error readPipeUntilDone(HANDLE hPipe, std::string* pOutput)
    return Success();
 }
 
+// size of the reads kept pending on pseudoterminal pipes
+const DWORD kPendingReadSize = 65536;
+
+// most output collected from a pipe in one poll (so a child writing without
+// pause can't keep us from attending to the others)
+const std::size_t kMaxOutputPerPoll = 1024 * 1024;
+
+// keeps a read pending on a pipe opened for overlapped I/O (as pseudoterminal
+// pipes are), so that its event is signaled as soon as output arrives
+class PendingPipeRead : boost::noncopyable
+{
+public:
+   explicit PendingPipeRead(HANDLE hPipe)
+      : hPipe_(hPipe),
+        pending_(false),
+        closed_(false),
+        buffer_(kPendingReadSize)
+   {
+      ::ZeroMemory(&overlapped_, sizeof(overlapped_));
+      overlapped_.hEvent = ::CreateEventW(NULL, TRUE, FALSE, NULL);
+      if (!overlapped_.hEvent)
+      {
+         LOG_ERROR(LAST_SYSTEM_ERROR());
+         closed_ = true;
+      }
+   }
+
+   ~PendingPipeRead()
+   {
+      try
+      {
+         // the read must be finished before the buffer goes away
+         if (pending_)
+         {
+            DWORD bytesRead;
+            ::CancelIoEx(hPipe_, &overlapped_);
+            ::GetOverlappedResult(hPipe_, &overlapped_, &bytesRead, TRUE);
+         }
+
+         if (overlapped_.hEvent)
+            ::CloseHandle(overlapped_.hEvent);
+      }
+      catch(...)
+      {
+      }
+   }
+
+   // the event to wait on for output (or NULL once the pipe is closed)
+   HANDLE event() const
+   {
+      return closed_ ? NULL : overlapped_.hEvent;
+   }
+
+   // collect the output of completed reads and start the next read
+   Error read(std::string* pOutput)
+   {
+      while (!closed_ && pOutput->size() < kMaxOutputPerPoll)
+      {
+         if (pending_)
+         {
+            DWORD bytesRead = 0;
+            if (!::GetOverlappedResult(hPipe_, &overlapped_, &bytesRead, FALSE))
+            {
+               DWORD lastErr = ::GetLastError();
+               if (lastErr == ERROR_IO_INCOMPLETE)
+                  return Success();
+
+               pending_ = false;
+               return readFailed(lastErr);
+            }
+
+            pending_ = false;
+            pOutput->append(&buffer_[0], bytesRead);
+         }
+
+         // (a read which completes at once is collected on the next pass)
+         if (!::ReadFile(hPipe_, &buffer_[0], kPendingReadSize, NULL, &overlapped_))
+         {
+            DWORD lastErr = ::GetLastError();
+            if (lastErr != ERROR_IO_PENDING)
+               return readFailed(lastErr);
+         }
+         pending_ = true;
+      }
+
+      return Success();
+   }
+
+private:
+   Error readFailed(DWORD lastErr)
+   {
+      closed_ = true;
+      if (lastErr == ERROR_BROKEN_PIPE || lastErr == ERROR_HANDLE_EOF)
+         return Success();
+      else
+         return systemError(lastErr, ERROR_LOCATION);
+   }
+
+   HANDLE hPipe_;
+   OVERLAPPED overlapped_;
+   bool pending_;
+   bool closed_;
+   std::vector<CHAR> buffer_;
+};
+
 } // anonymous namespace
 
 struct ChildProcess::Impl
@@ -613,6 +718,10 @@ struct AsyncChildProcess::AsyncImpl
    bool calledOnStarted_;
    bool exited_;
    boost::scoped_ptr<ChildProcessSubprocPoll> pSubprocPoll_;
+
+   // pending reads on the output pipes (pseudoterminals only)
+   boost::scoped_ptr<PendingPipeRead> pStdOutRead_;
+   boost::scoped_ptr<PendingPipeRead> pStdErrRead_;
  };
 
 AsyncChildProcess::AsyncChildProcess(const std::string& exe,
@@ -678,6 +787,27 @@ bool AsyncChildProcess::hasRecentOutput() const
       return true;
 }
 
+std::vector<int> AsyncChildProcess::outputDescriptors() const
+{
+   return std::vector<int>();
+}
+
+std::vector<HANDLE> AsyncChildProcess::waitHandles() const
+{
+   std::vector<HANDLE> handles;
+
+   // only the output of pseudoterminals is read with pending reads
+   if (!pAsyncImpl_->pStdOutRead_ || pImpl_->hProcess == NULL)
+      return handles;
+
+   handles.push_back(pImpl_->hProcess);
+   if (pAsyncImpl_->pStdOutRead_->event())
+      handles.push_back(pAsyncImpl_->pStdOutRead_->event());
+   if (pAsyncImpl_->pStdErrRead_ && pAsyncImpl_->pStdErrRead_->event())
+      handles.push_back(pAsyncImpl_->pStdErrRead_->event());
+   return handles;
+}
+
 void AsyncChildProcess::poll()
 {
    // call onStarted if we haven't yet
@@ -691,6 +821,17 @@ void AsyncChildProcess::poll()
          options().subprocWhitelist,
          options().trackCwd ? core::system::currentWorkingDir : NULL));
 
+      // keep reads pending on the pseudoterminal's (overlapped) pipes
+      if (options().pseudoterminal)
+      {
+         if (pImpl_->hStdOutRead)
+            pAsyncImpl_->pStdOutRead_.reset(
+                     new PendingPipeRead(pImpl_->hStdOutRead));
+         if (pImpl_->hStdErrRead)
+            pAsyncImpl_->pStdErrRead_.reset(
+                     new PendingPipeRead(pImpl_->hStdErrRead));
+      }
+
       if (callbacks_.onStarted)
          callbacks_.onStarted(*this);
       pAsyncImpl_->calledOnStarted_ = true;
@@ -713,7 +854,9 @@ void AsyncChildProcess::poll()
 
    // check stdout
    std::string stdOut;
-   Error error = WinPty::readFromPty(pImpl_->hStdOutRead, &stdOut);
+   Error error = pAsyncImpl_->pStdOutRead_ ?
+            pAsyncImpl_->pStdOutRead_->read(&stdOut) :
+            WinPty::readFromPty(pImpl_->hStdOutRead, &stdOut);
    if (error)
       reportError(error);
    if (!stdOut.empty() && callbacks_.onStdout)
@@ -724,7 +867,9 @@ void AsyncChildProcess::poll()
    if (pImpl_->hStdErrRead)
    {
       std::string stdErr;
-      error = WinPty::readFromPty(pImpl_->hStdErrRead, &stdErr);
+      error = pAsyncImpl_->pStdErrRead_ ?
+               pAsyncImpl_->pStdErrRead_->read(&stdErr) :
+               WinPty::readFromPty(pImpl_->hStdErrRead, &stdErr);
       if (error)
          reportError(error);
       if (!stdErr.empty() && callbacks_.onStderr)
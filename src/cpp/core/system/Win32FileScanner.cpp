@@ -62,6 +62,30 @@ FileInfo convertToFileInfo(const FilePath& filePath, bool yield, int *pCount)
 } // anonymous namespace
 
 
+// symlinks are always followed here (as FilePath does)
+Error scanDirectory(const FilePath& dirPath,
+                    bool followSymlinks,
+                    std::vector<FileInfo>* pFiles)
+{
+   pFiles->clear();
+
+   std::vector<FilePath> children;
+   Error error = dirPath.children(&children);
+   if (error)
+      return error;
+
+   int count = 0;
+   BOOST_FOREACH(const FilePath& child, children)
+   {
+      if (child.exists())
+         pFiles->push_back(convertToFileInfo(child, false, &count));
+   }
+
+   std::sort(pFiles->begin(), pFiles->end(), fileInfoPathLessThan);
+
+   return Success();
+}
+
 // NOTE: we bail with an error if the top level directory can't be
 // enumerated however we merely log errors for children. this reflects
 // the notion that a top-level failure will report major problems
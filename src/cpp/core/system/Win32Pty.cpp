@@ -138,6 +138,138 @@ Error tryLoad(const core::FilePath& libraryPath)
    return Success();
 }
 
+// The ConPTY functions are looked up at run-time (they are only present in
+// Windows 10 1809 and later).
+
+#define kProcThreadAttributePseudoConsole 0x00020016
+
+// buffer size for the pseudoconsole's pipes
+#define kConPtyPipeBufferSize 65536
+
+HRESULT (WINAPI *create_pseudo_console)(COORD, HANDLE, HANDLE, DWORD, void**) = nullptr;
+HRESULT (WINAPI *resize_pseudo_console)(void*, COORD) = nullptr;
+void (WINAPI *close_pseudo_console)(void*) = nullptr;
+
+bool loadConPty()
+{
+   static bool s_loaded = false;
+   static bool s_available = false;
+   if (s_loaded)
+      return s_available;
+   s_loaded = true;
+
+   HMODULE hKernel = ::GetModuleHandleW(L"kernel32.dll");
+   if (!hKernel)
+      return false;
+
+   create_pseudo_console = reinterpret_cast<HRESULT (WINAPI *)(COORD, HANDLE, HANDLE, DWORD, void**)>(
+            ::GetProcAddress(hKernel, "CreatePseudoConsole"));
+   resize_pseudo_console = reinterpret_cast<HRESULT (WINAPI *)(void*, COORD)>(
+            ::GetProcAddress(hKernel, "ResizePseudoConsole"));
+   close_pseudo_console = reinterpret_cast<void (WINAPI *)(void*)>(
+            ::GetProcAddress(hKernel, "ClosePseudoConsole"));
+
+   s_available = create_pseudo_console &&
+                 resize_pseudo_console &&
+                 close_pseudo_console;
+   return s_available;
+}
+
+COORD consoleSize(int cols, int rows)
+{
+   COORD size;
+   size.X = static_cast<SHORT>(cols < 1 ? 80 : cols);
+   size.Y = static_cast<SHORT>(rows < 1 ? 25 : rows);
+   return size;
+}
+
+// Create a pipe for the pseudoconsole. Our end (the server end of a named
+// pipe) supports overlapped I/O; the pseudoconsole's end is an ordinary
+// synchronous handle.
+Error createConPtyPipe(bool inbound, HANDLE* pOurEnd, HANDLE* pConPtyEnd)
+{
+   static LONG s_pipeCount = 0;
+   std::wstring name = L"\\\\.\\pipe\\rstudio-conpty-" +
+         std::to_wstring(::GetCurrentProcessId()) + L"-" +
+         std::to_wstring(::InterlockedIncrement(&s_pipeCount));
+
+   HANDLE hServer = ::CreateNamedPipeW(
+            name.c_str(),
+            (inbound ? PIPE_ACCESS_INBOUND : PIPE_ACCESS_OUTBOUND) |
+               FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+               PIPE_REJECT_REMOTE_CLIENTS,
+            1 /*nMaxInstances*/,
+            kConPtyPipeBufferSize,
+            kConPtyPipeBufferSize,
+            0 /*nDefaultTimeOut*/,
+            nullptr /*lpSecurityAttributes*/);
+   if (hServer == INVALID_HANDLE_VALUE)
+      return LAST_SYSTEM_ERROR();
+
+   HANDLE hClient = ::CreateFileW(name.c_str(),
+                                  inbound ? GENERIC_WRITE : GENERIC_READ,
+                                  0 /*dwShareMode*/,
+                                  nullptr /*lpSecurityAttributes*/,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  nullptr /*hTemplateFile*/);
+   if (hClient == INVALID_HANDLE_VALUE)
+   {
+      Error error = LAST_SYSTEM_ERROR();
+      ::CloseHandle(hServer);
+      return error;
+   }
+
+   *pOurEnd = hServer;
+   *pConPtyEnd = hClient;
+   return Success();
+}
+
+// Build a wchar_t environment block (empty if the environment is inherited)
+std::vector<wchar_t> environmentBlock(const ProcessOptions& options)
+{
+   std::vector<wchar_t> envBlock;
+   if (options.environment)
+   {
+      const Options& env = options.environment.get();
+      BOOST_FOREACH(const Option& envVar, env)
+      {
+         std::wstring key = string_utils::utf8ToWide(envVar.first);
+         std::wstring value = string_utils::utf8ToWide(envVar.second);
+         std::copy(key.begin(), key.end(), std::back_inserter(envBlock));
+         envBlock.push_back(L'=');
+         std::copy(value.begin(), value.end(), std::back_inserter(envBlock));
+         envBlock.push_back(L'\0');
+      }
+      envBlock.push_back(L'\0');
+   }
+   return envBlock;
+}
+
+// process command line arguments (copy of approach done by non-pseudoterm
+// code path in ChildProcess::run for Win32)
+std::string commandLineArgs(const std::vector<std::string>& args)
+{
+   std::string cmdLine;
+   BOOST_FOREACH(const std::string& arg, args)
+   {
+      cmdLine.push_back(' ');
+
+      // This is kind of gross. Ideally we would be more deterministic
+      // than this.
+      bool quot = std::string::npos != arg.find(' ')
+            && std::string::npos == arg.find('"');
+
+      if (quot)
+         cmdLine.push_back('"');
+      std::copy(arg.begin(), arg.end(), std::back_inserter(cmdLine));
+      if (quot)
+         cmdLine.push_back('"');
+   }
+   return cmdLine;
+}
+
 // Obtain text description of winpty error (can return empty string)
 std::string winptyErrorMsg(winpty_error_ptr_t pErr)
 {
@@ -262,23 +394,8 @@ public:
       : pSpawnConfig_(nullptr)
    {
       // Build wchar_t environment
-      LPCWSTR lpEnv = nullptr;
-      std::vector<wchar_t> envBlock;
-      if (options.environment)
-      {
-         const Options& env = options.environment.get();
-         BOOST_FOREACH(const Option& envVar, env)
-         {
-            std::wstring key = string_utils::utf8ToWide(envVar.first);
-            std::wstring value = string_utils::utf8ToWide(envVar.second);
-            std::copy(key.begin(), key.end(), std::back_inserter(envBlock));
-            envBlock.push_back(L'=');
-            std::copy(value.begin(), value.end(), std::back_inserter(envBlock));
-            envBlock.push_back(L'\0');
-         }
-         envBlock.push_back(L'\0');
-         lpEnv = &envBlock[0];
-      }
+      std::vector<wchar_t> envBlock = environmentBlock(options);
+      LPCWSTR lpEnv = envBlock.empty() ? nullptr : &envBlock[0];
 
       std::wstring workingDir(options.workingDir.absolutePathW());
 
@@ -339,6 +456,35 @@ Error WinPty::start(const std::string& exe,
    CloseHandleOnExitScope closeStdErrRead(pStdErrRead, ERROR_LOCATION);
    CloseHandleOnExitScope closeProcessHandle(pProcess, ERROR_LOCATION);
 
+   // Use the system pseudoconsole where we can (falling back to winpty if
+   // it can't be created)
+   if (options_.pseudoterminal &&
+       !options_.pseudoterminal.get().plainText &&
+       !options_.pseudoterminal.get().conerr &&
+       conPtyAvailable())
+   {
+      if (pStdErrRead)
+         *pStdErrRead = nullptr;
+
+      Error err = startConPty(pStdInWrite, pStdOutRead);
+      if (!err)
+      {
+         err = runConPtyProcess(pProcess);
+         if (err)
+         {
+            stopPty();
+            return err;
+         }
+
+         closeStdInWrite.detach();
+         closeStdOutRead.detach();
+         closeStdErrRead.detach();
+         closeProcessHandle.detach();
+         return Success();
+      }
+      LOG_ERROR(err);
+   }
+
    // Startup the pty agent process
    Error err = startPty(pStdInWrite, pStdOutRead, pStdErrRead);
    if (err)
@@ -504,24 +650,7 @@ Error WinPty::runProcess(HANDLE* pProcess)
                          ERROR_LOCATION);
    }
 
-   // process command line arguments (copy of approach done by non-pseudoterm
-   // code path in ChildProcess::run for Win32)
-   std::string cmdLine;
-   BOOST_FOREACH(std::string& arg, args_)
-   {
-      cmdLine.push_back(' ');
-
-      // This is kind of gross. Ideally we would be more deterministic
-      // than this.
-      bool quot = std::string::npos != arg.find(' ')
-            && std::string::npos == arg.find('"');
-
-      if (quot)
-         cmdLine.push_back('"');
-      std::copy(arg.begin(), arg.end(), std::back_inserter(cmdLine));
-      if (quot)
-         cmdLine.push_back('"');
-   }
+   std::string cmdLine = commandLineArgs(args_);
    cmdLine.push_back('\0');
 
    WinPtySpawnConfig spawnConfig(
@@ -560,18 +689,155 @@ Error WinPty::runProcess(HANDLE* pProcess)
    return Success();
 }
 
+Error WinPty::startConPty(HANDLE* pStdInWrite, HANDLE* pStdOutRead)
+{
+   CloseHandleOnExitScope closeStdInWrite(pStdInWrite, ERROR_LOCATION);
+   CloseHandleOnExitScope closeStdOutRead(pStdOutRead, ERROR_LOCATION);
+
+   if (pStdInWrite)
+      *pStdInWrite = nullptr;
+   if (pStdOutRead)
+      *pStdOutRead = nullptr;
+
+   if (!pStdInWrite || !pStdOutRead)
+   {
+      return systemError(boost::system::errc::invalid_argument,
+                         "Pseudoconsole requires input and output pipes",
+                         ERROR_LOCATION);
+   }
+
+   if (ptyRunning())
+      return systemError(boost::system::errc::already_connected,
+                         "WinPty already running",
+                         ERROR_LOCATION);
+
+   // the pseudoconsole duplicates its ends of the pipes, so we close ours
+   // once it has been created
+   HANDLE hInRead = nullptr;
+   HANDLE hOutWrite = nullptr;
+   CloseHandleOnExitScope closeInRead(&hInRead, ERROR_LOCATION);
+   CloseHandleOnExitScope closeOutWrite(&hOutWrite, ERROR_LOCATION);
+
+   Error err = createConPtyPipe(false /*inbound*/, pStdInWrite, &hInRead);
+   if (err)
+      return err;
+   err = createConPtyPipe(true /*inbound*/, pStdOutRead, &hOutWrite);
+   if (err)
+      return err;
+
+   HRESULT hr = create_pseudo_console(
+            consoleSize(options_.pseudoterminal.get().cols,
+                        options_.pseudoterminal.get().rows),
+            hInRead,
+            hOutWrite,
+            0 /*dwFlags*/,
+            &pPseudoConsole_);
+   if (FAILED(hr))
+   {
+      pPseudoConsole_ = nullptr;
+      return systemError(HRESULT_CODE(hr),
+                         "Failed to create pseudoconsole",
+                         ERROR_LOCATION);
+   }
+
+   closeStdInWrite.detach();
+   closeStdOutRead.detach();
+   return Success();
+}
+
+Error WinPty::runConPtyProcess(HANDLE* pProcess)
+{
+   if (pProcess)
+      *pProcess = nullptr;
+
+   SIZE_T attrListSize = 0;
+   ::InitializeProcThreadAttributeList(nullptr, 1, 0, &attrListSize);
+   std::vector<BYTE> attrListBuffer(attrListSize);
+   LPPROC_THREAD_ATTRIBUTE_LIST pAttrList =
+         reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(&attrListBuffer[0]);
+   if (!::InitializeProcThreadAttributeList(pAttrList, 1, 0, &attrListSize))
+      return LAST_SYSTEM_ERROR();
+
+   if (!::UpdateProcThreadAttribute(pAttrList,
+                                    0,
+                                    kProcThreadAttributePseudoConsole,
+                                    pPseudoConsole_,
+                                    sizeof(pPseudoConsole_),
+                                    nullptr,
+                                    nullptr))
+   {
+      Error err = LAST_SYSTEM_ERROR();
+      ::DeleteProcThreadAttributeList(pAttrList);
+      return err;
+   }
+
+   STARTUPINFOEXW si;
+   ::ZeroMemory(&si, sizeof(si));
+   si.StartupInfo.cb = sizeof(STARTUPINFOEXW);
+   si.lpAttributeList = pAttrList;
+
+   // without this the child would inherit our (redirected) standard
+   // handles rather than using the pseudoconsole
+   si.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+
+   std::wstring exe = string_utils::utf8ToWide(exe_, "WinPty::exe");
+   std::wstring cmdLine = string_utils::utf8ToWide(
+            "\"" + exe_ + "\"" + commandLineArgs(args_), "WinPty::cmdLine");
+   std::vector<wchar_t> cmdLineBuffer(cmdLine.begin(), cmdLine.end());
+   cmdLineBuffer.push_back(L'\0');
+
+   std::vector<wchar_t> envBlock = environmentBlock(options_);
+   std::wstring workingDir(options_.workingDir.absolutePathW());
+
+   PROCESS_INFORMATION pi;
+   ::ZeroMemory(&pi, sizeof(pi));
+   BOOL success = ::CreateProcessW(
+            exe.c_str(),
+            &cmdLineBuffer[0],
+            nullptr /*lpProcessAttributes*/,
+            nullptr /*lpThreadAttributes*/,
+            FALSE /*bInheritHandles*/,
+            EXTENDED_STARTUPINFO_PRESENT | CREATE_UNICODE_ENVIRONMENT,
+            envBlock.empty() ? nullptr : &envBlock[0],
+            workingDir.empty() ? nullptr : workingDir.c_str(),
+            &si.StartupInfo,
+            &pi);
+   Error err = success ? Success() : LAST_SYSTEM_ERROR();
+   ::DeleteProcThreadAttributeList(pAttrList);
+   if (err)
+      return err;
+
+   ::CloseHandle(pi.hThread);
+   if (pProcess)
+      *pProcess = pi.hProcess;
+   else
+      ::CloseHandle(pi.hProcess);
+
+   return Success();
+}
+
 void WinPty::stopPty()
 {
    if (!ptyRunning())
       return;
-   if (free)
+   if (pPseudoConsole_)
+   {
+      close_pseudo_console(pPseudoConsole_);
+      pPseudoConsole_ = nullptr;
+   }
+   if (pPty_ && free)
       free(pPty_);
    pPty_ = nullptr;
 }
 
 bool WinPty::ptyRunning() const
 {
-   return pPty_ != nullptr;
+   return pPty_ != nullptr || pPseudoConsole_ != nullptr;
+}
+
+bool WinPty::conPtyAvailable()
+{
+   return loadConPty();
 }
 
 Error WinPty::setSize(int cols, int rows)
@@ -590,6 +856,19 @@ Error WinPty::setSize(int cols, int rows)
                          ERROR_LOCATION);
    }
 
+   if (pPseudoConsole_)
+   {
+      HRESULT hr = resize_pseudo_console(pPseudoConsole_,
+                                         consoleSize(cols, rows));
+      if (FAILED(hr))
+      {
+         return systemError(HRESULT_CODE(hr),
+                            "Failed to resize pseudoconsole",
+                            ERROR_LOCATION);
+      }
+      return Success();
+   }
+
    WinPtyError err;
    if (!set_size || !set_size(pPty_, cols, rows, err.ppErr()))
    {
@@ -33,11 +33,17 @@ namespace system {
 // Wrapper class for winpty library (https://github.com/rprichard/winpty)
 // "A windows software package providing an interface similar to a Unix
 // pty-master for communicating with Windows console programs."
+//
+// On Windows 10 1809 and later the system pseudoconsole (ConPTY) is used
+// instead, unless plain text output or a separate conerr pipe is requested
+// (ConPTY always emits escape sequences, and merges stderr into stdout).
+// Either way the returned pipe handles support overlapped I/O.
 class WinPty : boost::noncopyable
 {
 public:
    WinPty()
-      : pPty_(nullptr)
+      : pPty_(nullptr),
+        pPseudoConsole_(nullptr)
    {}
 
    virtual ~WinPty();
@@ -65,13 +71,19 @@ public:
    static Error writeToPty(HANDLE hPipe, const std::string& input);
    static Error readFromPty(HANDLE hPipe, std::string* pOutput);
 
+   // Is the system pseudoconsole (ConPTY) available?
+   static bool conPtyAvailable();
+
 private:
    Error startPty(HANDLE* pStdInWrite, HANDLE* pStdOutRead, HANDLE* pStdErrRead);
    Error runProcess(HANDLE* pProcess);
+   Error startConPty(HANDLE* pStdInWrite, HANDLE* pStdOutRead);
+   Error runConPtyProcess(HANDLE* pProcess);
    void stopPty();
 
 private:
    winpty_t *pPty_;
+   void *pPseudoConsole_;
    std::string exe_;
    std::vector<std::string> args_;
    ProcessOptions options_;
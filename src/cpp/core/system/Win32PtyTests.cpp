@@ -195,6 +195,47 @@ TEST_CASE("Win32PtyTests")
       CHECK(::CloseHandle(hOutRead));
    }
 
+   SECTION("Capture output of a process in a pseudoconsole")
+   {
+      // (only on Windows 10 1809 and later; winpty is used elsewhere)
+      if (WinPty::conPtyAvailable())
+      {
+         HANDLE hInWrite;
+         HANDLE hOutRead;
+         HANDLE hErrRead;
+         HANDLE hProcess;
+         std::vector<std::string> args;
+
+         args.push_back("/S");
+         args.push_back("/C");
+         args.push_back("\"echo Hello!\"");
+
+         Error err = pty.start(cmdExe, args, options,
+                               &hInWrite, &hOutRead, &hErrRead, &hProcess);
+         CHECK(!err);
+         CHECK(hInWrite);
+         CHECK(hOutRead);
+         CHECK_FALSE(hErrRead);
+         CHECK(hProcess);
+
+         // output includes escape sequences, so just look for the text
+         std::string stdOut;
+         int tries = 10;
+         while (tries && stdOut.find("Hello!") == std::string::npos)
+         {
+            ::Sleep(100);
+            err = WinPty::readFromPty(hOutRead, &stdOut);
+            CHECK(!err);
+            tries--;
+         }
+
+         CHECK(stdOut.find("Hello!") != std::string::npos);
+         CHECK(::CloseHandle(hProcess));
+         CHECK(::CloseHandle(hInWrite));
+         CHECK(::CloseHandle(hOutRead));
+      }
+   }
+
    SECTION("Verify character-by-character send/receive")
    {
       HANDLE hInWrite;
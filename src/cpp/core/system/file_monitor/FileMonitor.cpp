@@ -52,6 +52,12 @@ namespace {
 // we don't want it to ever be destructed)
 std::list<Handle>* s_pActiveHandles;
 
+// watch limit and poll interval for directories beyond it (read by the
+// platform-specific file-monitor thread, so set prior to initialize)
+std::size_t s_maxWatches = 0;
+boost::posix_time::time_duration s_pollInterval = boost::posix_time::seconds(5);
+bool s_useFanotify = true;
+
 void addEvent(FileChangeEvent::Type type,
               const FileInfo& fileInfo,
               std::vector<FileChangeEvent>* pEvents)
@@ -269,6 +275,67 @@ void processFileRemoved(tree<FileInfo>::iterator parentIt,
    }
 }
 
+namespace {
+
+// apply changes between the children of a directory and a fresh
+// (non-recursive) scan of it
+void processChildChanges(
+               tree<FileInfo>::iterator it,
+               const tree<FileInfo>& scannedTree,
+               bool recursive,
+               const boost::function<bool(const FileInfo&)>& filter,
+               const boost::function<Error(const FileInfo&)>& onBeforeScanDir,
+               tree<FileInfo>* pTree,
+               std::vector<FileChangeEvent>* pFileChanges)
+{
+   std::vector<FileChangeEvent> childrenFileChanges;
+   collectFileChangeEvents(pTree->begin(it),
+                           pTree->end(it),
+                           scannedTree.begin(scannedTree.begin()),
+                           scannedTree.end(scannedTree.begin()),
+                           &childrenFileChanges);
+
+   // build up actual file changes and mutate the tree as appropriate
+   BOOST_FOREACH(const FileChangeEvent& fileChange, childrenFileChanges)
+   {
+      switch(fileChange.type())
+      {
+      case FileChangeEvent::FileAdded:
+      {
+         Error error = processFileAdded(it,
+                                        fileChange,
+                                        recursive,
+                                        filter,
+                                        onBeforeScanDir,
+                                        pTree,
+                                        pFileChanges);
+         if (error)
+            LOG_ERROR(error);
+         break;
+      }
+      case FileChangeEvent::FileModified:
+      {
+         processFileModified(it, fileChange, pTree, pFileChanges);
+         break;
+      }
+      case FileChangeEvent::FileRemoved:
+      {
+         processFileRemoved(it,
+                            fileChange,
+                            recursive,
+                            pTree,
+                            pFileChanges);
+         break;
+      }
+      case FileChangeEvent::None:
+      default:
+         break;
+      }
+   }
+}
+
+} // anonymous namespace
+
 Error discoverAndProcessFileChanges(
    const FileInfo& fileInfo,
    bool recursive,
@@ -320,50 +387,14 @@ Error discoverAndProcessFileChanges(
    else
    {
       // scan for changes on just the children
-      std::vector<FileChangeEvent> childrenFileChanges;
-      collectFileChangeEvents(pTree->begin(it),
-                              pTree->end(it),
-                              subdirTree.begin(subdirTree.begin()),
-                              subdirTree.end(subdirTree.begin()),
-                              &childrenFileChanges);
-
-      // build up actual file changes and mutate the tree as appropriate
       std::vector<FileChangeEvent> fileChanges;
-      BOOST_FOREACH(const FileChangeEvent& fileChange, childrenFileChanges)
-      {
-         switch(fileChange.type())
-         {
-         case FileChangeEvent::FileAdded:
-         {
-            Error error = processFileAdded(it,
-                                           fileChange,
-                                           recursive,
-                                           filter,
-                                           pTree,
-                                           &fileChanges);
-            if (error)
-               LOG_ERROR(error);
-            break;
-         }
-         case FileChangeEvent::FileModified:
-         {
-            processFileModified(it, fileChange, pTree, &fileChanges);
-            break;
-         }
-         case FileChangeEvent::FileRemoved:
-         {
-            processFileRemoved(it,
-                               fileChange,
-                               recursive,
-                               pTree,
-                               &fileChanges);
-            break;
-         }
-         case FileChangeEvent::None:
-         default:
-            break;
-         }
-      }
+      processChildChanges(it,
+                          subdirTree,
+                          recursive,
+                          filter,
+                          onBeforeScanDir,
+                          pTree,
+                          &fileChanges);
 
       // fire events
       onFilesChanged(fileChanges);
@@ -372,6 +403,52 @@ Error discoverAndProcessFileChanges(
    return Success();
 }
 
+Error discoverAndProcessChildChanges(
+               tree<FileInfo>::iterator it,
+               bool recursive,
+               const boost::function<bool(const FileInfo&)>& filter,
+               const boost::function<Error(const FileInfo&)>& onBeforeScanDir,
+               tree<FileInfo>* pTree,
+               std::vector<FileChangeEvent>* pFileChanges)
+{
+   // scan just the immediate children of the directory
+   tree<FileInfo> subdirTree;
+   FileScannerOptions options;
+   options.recursive = false;
+   options.yield = true;
+   options.filter = filter;
+   Error error = scanFiles(FileInfo(FilePath(it->absolutePath())),
+                           options,
+                           &subdirTree);
+   if (error)
+      return error;
+
+   processChildChanges(it,
+                       subdirTree,
+                       recursive,
+                       filter,
+                       onBeforeScanDir,
+                       pTree,
+                       pFileChanges);
+
+   return Success();
+}
+
+std::size_t maxWatches()
+{
+   return s_maxWatches;
+}
+
+boost::posix_time::time_duration pollInterval()
+{
+   return s_pollInterval;
+}
+
+bool useFanotify()
+{
+   return s_useFanotify;
+}
+
 std::list<void*> activeEventContexts()
 {
    std::list<void*> contexts;
@@ -620,6 +697,21 @@ boost::thread s_fileMonitorThread;
 } // anonymous namespace
 
 
+void setMaxWatches(std::size_t maxWatches)
+{
+   s_maxWatches = maxWatches;
+}
+
+void setPollInterval(const boost::posix_time::time_duration& interval)
+{
+   s_pollInterval = interval;
+}
+
+void setUseFanotify(bool useFanotify)
+{
+   s_useFanotify = useFanotify;
+}
+
 void initialize()
 {
    s_pActiveHandles = new std::list<Handle>();
@@ -98,6 +98,16 @@ inline Error discoverAndProcessFileChanges(
                                  onFilesChanged);
 }
 
+// check the immediate children of a directory within the tree for changes
+// (e.g. for directories which are polled rather than watched)
+Error discoverAndProcessChildChanges(
+               tree<FileInfo>::iterator it,
+               bool recursive,
+               const boost::function<bool(const FileInfo&)>& filter,
+               const boost::function<Error(const FileInfo&)>& onBeforeScanDir,
+               tree<FileInfo>* pTree,
+               std::vector<FileChangeEvent>* pFileChanges);
+
 template <typename Iterator>
 Iterator findFile(Iterator begin, Iterator end, const std::string& path)
 {
@@ -114,6 +124,11 @@ Iterator findFile(Iterator begin, Iterator end, const FileInfo& fileInfo)
 
 std::list<void*> activeEventContexts();
 
+// per-monitor watch limit and poll interval for unwatched directories
+std::size_t maxWatches();
+boost::posix_time::time_duration pollInterval();
+bool useFanotify();
+
 
 } // namespace impl
 } // namespace file_monitor
@@ -21,6 +21,7 @@
 #include <sys/types.h>
 #include <sys/inotify.h>
 
+#include <map>
 #include <set>
 
 #include <boost/utility.hpp>
@@ -29,8 +30,11 @@
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 #include <core/Log.hpp>
 #include <core/Error.hpp>
 #include <core/FileInfo.hpp>
@@ -42,6 +46,10 @@
 
 #include "config.h"
 
+#ifdef HAVE_FANOTIFY
+#include <sys/fanotify.h>
+#endif
+
 namespace rstudio {
 namespace core {
 namespace system {
@@ -49,15 +57,19 @@ namespace file_monitor {
 
 namespace {
 
+// directories listed at once when registering (on network filesystems the
+// initial scan is otherwise dominated by the latency of each listing)
+const int kScanThreads = 4;
+
 struct Watch
 {
    Watch()
-      : wd(-1), path()
+      : wd(-1), path(), activity(0)
    {
    }
 
-   Watch(int wd, const std::string& path)
-      : wd(wd), path(path)
+   Watch(int wd, const std::string& path, boost::uint64_t activity)
+      : wd(wd), path(path), activity(activity)
    {
    }
 
@@ -66,6 +78,10 @@ struct Watch
    int wd;
    std::string path;
 
+   // when we last saw changes within the directory (a counter which
+   // increases with each change)
+   boost::uint64_t activity;
+
    bool operator < (const Watch& other) const
    {
       return this->wd < other.wd;
@@ -105,11 +121,36 @@ public:
          return Watch();
    }
 
+   void touch(const Watch& watch, boost::uint64_t activity)
+   {
+      WatchesByDescriptor& index = watches_.get<wd>();
+      WatchesByDescriptor::iterator it = index.find(watch.wd);
+      if (it != index.end())
+         index.modify(it, SetActivity(activity));
+   }
+
+   // the watch with the least recent activity (other than for the
+   // specified path)
+   Watch leastRecentlyActive(const std::string& exceptPath) const
+   {
+      BOOST_FOREACH(const Watch& watch, activityIndex())
+      {
+         if (watch.path != exceptPath)
+            return watch;
+      }
+      return Watch();
+   }
+
    void forEach(const boost::function<void(const Watch&)> op) const
    {
       std::for_each(descriptorIndex().begin(), descriptorIndex().end(), op);
    }
 
+   std::size_t size() const
+   {
+      return watches_.size();
+   }
+
    void clear()
    {
       watches_ = WatchesContainer();
@@ -119,6 +160,14 @@ private:
 
    struct wd {};
    struct path {};
+   struct activity {};
+
+   struct SetActivity
+   {
+      explicit SetActivity(boost::uint64_t activity) : activity(activity) {}
+      void operator()(Watch& watch) const { watch.activity = activity; }
+      boost::uint64_t activity;
+   };
 
    typedef boost::multi_index::multi_index_container<
 
@@ -138,12 +187,20 @@ private:
             boost::multi_index::member<Watch,
                                        std::string,
                                        &Watch::path>
+         >,
+
+         boost::multi_index::ordered_non_unique<
+            boost::multi_index::tag<activity>,
+            boost::multi_index::member<Watch,
+                                       boost::uint64_t,
+                                       &Watch::activity>
          >
       >
    > WatchesContainer;
 
    typedef WatchesContainer::index<wd>::type WatchesByDescriptor;
    typedef WatchesContainer::index<path>::type WatchesByPath;
+   typedef WatchesContainer::index<activity>::type WatchesByActivity;
 
    const WatchesByDescriptor& descriptorIndex() const
    {
@@ -155,6 +212,11 @@ private:
       return watches_.get<path>();
    }
 
+   const WatchesByActivity& activityIndex() const
+   {
+      return watches_.get<activity>();
+   }
+
    WatchesContainer watches_;
 };
 
@@ -164,7 +226,11 @@ class FileEventContext : boost::noncopyable
 public:
    FileEventContext()
       : fd(-1),
-        recursive(false)
+        recursive(false),
+        fanotify(false),
+        rootMountId(-1),
+        activity(0),
+        watchLimitReached(false)
    {
       handle = Handle((void*)this);
    }
@@ -177,6 +243,22 @@ public:
    boost::function<bool(const FileInfo&)> filter;
    tree<FileInfo> fileTree;
    Callbacks callbacks;
+
+   // when using fanotify fd is a fanotify group with a mark on the root's
+   // filesystem, and events are mapped back to directories by file handle
+   bool fanotify;
+   int rootMountId;
+   std::map<std::string, std::string> dirsByHandle;
+   std::map<std::string, std::string> handlesByDir;
+
+   // directories we couldn't (or chose not to) watch, which are instead
+   // polled in turn (continuing after the last one polled)
+   std::set<std::string> unwatchedDirs;
+   std::string lastPolledDir;
+   boost::posix_time::ptime lastPollTime;
+
+   boost::uint64_t activity;
+   bool watchLimitReached;
 };
 
 void terminateWithMonitoringError(FileEventContext* pContext,
@@ -189,11 +271,103 @@ void terminateWithMonitoringError(FileEventContext* pContext,
    file_monitor::unregisterMonitor(pContext->handle);
 }
 
-Error addWatch(const FileInfo& fileInfo,
-               const FilePath& rootPath,
-               bool allowRootSymlink,
-               int fd,
-               Watches* pWatches)
+#ifdef HAVE_FANOTIFY
+
+// file handles identify directories in fanotify events
+struct DirectoryHandle
+{
+   DirectoryHandle()
+   {
+      handle()->handle_bytes = MAX_HANDLE_SZ;
+   }
+
+   struct file_handle* handle()
+   {
+      return reinterpret_cast<struct file_handle*>(buffer);
+   }
+
+   std::string key()
+   {
+      return handleKey(handle());
+   }
+
+   static std::string handleKey(const struct file_handle* pHandle)
+   {
+      std::string key(reinterpret_cast<const char*>(&pHandle->handle_type),
+                      sizeof(pHandle->handle_type));
+      key.append(reinterpret_cast<const char*>(pHandle->f_handle),
+                 pHandle->handle_bytes);
+      return key;
+   }
+
+   // a file_handle followed by storage for its (variable length) contents
+   char buffer[sizeof(struct file_handle) + MAX_HANDLE_SZ]
+                                             __attribute__ ((aligned(8)));
+};
+
+Error getDirectoryHandle(const std::string& path,
+                         bool followSymlink,
+                         DirectoryHandle* pHandle,
+                         int* pMountId)
+{
+   int flags = followSymlink ? AT_SYMLINK_FOLLOW : 0;
+   if (::name_to_handle_at(AT_FDCWD,
+                           path.c_str(),
+                           pHandle->handle(),
+                           pMountId,
+                           flags) < 0)
+   {
+      Error error = systemError(errno, ERROR_LOCATION);
+      error.addProperty("path", path);
+      return error;
+   }
+
+   return Success();
+}
+
+Error addDirectoryHandle(FileEventContext* pContext,
+                         const std::string& path,
+                         bool followSymlink)
+{
+   DirectoryHandle handle;
+   int mountId = -1;
+   Error error = getDirectoryHandle(path, followSymlink, &handle, &mountId);
+
+   // directories which we can't identify from events, including those on
+   // other filesystems (which the mark doesn't cover), are polled instead
+   if ((error && error.code().value() == EOPNOTSUPP) ||
+       (!error && mountId != pContext->rootMountId))
+   {
+      pContext->unwatchedDirs.insert(path);
+      return Success();
+   }
+   else if (error)
+   {
+      return error;
+   }
+
+   std::string key = handle.key();
+   pContext->dirsByHandle[key] = path;
+   pContext->handlesByDir[path] = key;
+   return Success();
+}
+
+void removeDirectoryHandle(FileEventContext* pContext, const std::string& path)
+{
+   std::map<std::string, std::string>::iterator it =
+                                          pContext->handlesByDir.find(path);
+   if (it != pContext->handlesByDir.end())
+   {
+      pContext->dirsByHandle.erase(it->second);
+      pContext->handlesByDir.erase(it);
+   }
+}
+
+#endif
+
+Error addWatch(FileEventContext* pContext,
+               const FileInfo& fileInfo,
+               bool allowRootSymlink)
 {
    // NOTE: both inotify_add_watch and std::set::insert gracefully
    // handle duplicate additions, inotify_add_watch by modifying the
@@ -202,6 +376,25 @@ Error addWatch(const FileInfo& fileInfo,
    // checking to see if the watch exists and don't generally worry
    // about adding duplicate watches
 
+   std::string path = fileInfo.absolutePath();
+   bool isRoot = (path == pContext->rootPath.absolutePath());
+
+#ifdef HAVE_FANOTIFY
+   // fanotify marks cover the whole filesystem so we need only be able to
+   // recognize the directory in events
+   if (pContext->fanotify)
+      return addDirectoryHandle(pContext, path, allowRootSymlink && isRoot);
+#endif
+
+   // directories beyond the watch limit are polled instead (the root is
+   // always watched so that we can detect its removal)
+   std::size_t maxWatches = impl::maxWatches();
+   if (!isRoot && maxWatches > 0 && pContext->watches.size() >= maxWatches)
+   {
+      pContext->unwatchedDirs.insert(path);
+      return Success();
+   }
+
    // define watch mask
    uint32_t mask = 0 ;
    mask |= IN_CREATE;
@@ -213,23 +406,40 @@ Error addWatch(const FileInfo& fileInfo,
 
    // add IN_DONT_FOLLOW unless we are explicitly allowing root symlinks
    // and this is a watch for the root path
-   if (!allowRootSymlink ||
-       (fileInfo.absolutePath() != rootPath.absolutePath()))
+   if (!allowRootSymlink || !isRoot)
    {
       mask |= IN_DONT_FOLLOW;
    }
 
    // initialize watch
-   int wd = ::inotify_add_watch(fd, fileInfo.absolutePath().c_str(), mask);
+   int wd = ::inotify_add_watch(pContext->fd, path.c_str(), mask);
    if (wd < 0)
    {
+      // the system limit on watches (max_user_watches) is shared by all of
+      // the user's processes, so rather than failing when we run out we
+      // fall back to polling
+      if (errno == ENOSPC && !isRoot)
+      {
+         if (!pContext->watchLimitReached)
+         {
+            pContext->watchLimitReached = true;
+            LOG_WARNING_MESSAGE("Unable to watch all directories within " +
+                                pContext->rootPath.absolutePath() +
+                                " (inotify watch limit reached); "
+                                "polling the remainder for changes");
+         }
+         pContext->unwatchedDirs.insert(path);
+         return Success();
+      }
+
       Error error = systemError(errno, ERROR_LOCATION);
-      error.addProperty("path", fileInfo.absolutePath());
+      error.addProperty("path", path);
       return error;
    }
 
    // record it
-   pWatches->insert(Watch(wd, fileInfo.absolutePath()));
+   pContext->unwatchedDirs.erase(path);
+   pContext->watches.insert(Watch(wd, path, ++pContext->activity));
 
    // return success
    return Success();
@@ -239,12 +449,7 @@ boost::function<Error(const FileInfo&)> addWatchFunction(
                                            FileEventContext* pContext,
                                            bool allowRootSymlink = false)
 {
-   return boost::bind(addWatch,
-                        _1,
-                        pContext->rootPath,
-                        allowRootSymlink,
-                        pContext->fd,
-                        &pContext->watches);
+   return boost::bind(addWatch, pContext, _1, allowRootSymlink);
 }
 
 void removeWatch(int fd, const Watch& watch)
@@ -268,6 +473,175 @@ void removeAllWatches(FileEventContext* pContext)
                                           pContext->fd,
                                           _1));
    pContext->watches.clear();
+   pContext->unwatchedDirs.clear();
+   pContext->dirsByHandle.clear();
+   pContext->handlesByDir.clear();
+}
+
+// find a directory by descending the tree (rather than visiting every node)
+tree<FileInfo>::iterator findDirectory(FileEventContext* pContext,
+                                       const std::string& path)
+{
+   tree<FileInfo>& fileTree = pContext->fileTree;
+   tree<FileInfo>::iterator it = fileTree.begin();
+   while (it != fileTree.end())
+   {
+      if (it->absolutePath() == path)
+         return it;
+
+      tree<FileInfo>::sibling_iterator child = fileTree.begin(it);
+      for (; child != fileTree.end(it); ++child)
+      {
+         const std::string& childPath = child->absolutePath();
+         if (boost::algorithm::starts_with(path, childPath) &&
+             (path.size() == childPath.size() || path[childPath.size()] == '/'))
+         {
+            break;
+         }
+      }
+
+      if (child == fileTree.end(it))
+         return fileTree.end();
+
+      it = child;
+   }
+
+   return fileTree.end();
+}
+
+// stop watching (or polling) directories which have been removed
+void forgetRemovedDirectories(FileEventContext* pContext,
+                              const std::vector<FileChangeEvent>& events)
+{
+   BOOST_FOREACH(const FileChangeEvent& event, events)
+   {
+      if (event.type() != FileChangeEvent::FileRemoved ||
+          !event.fileInfo().isDirectory())
+      {
+         continue;
+      }
+
+      std::string path = event.fileInfo().absolutePath();
+      Watch watch = pContext->watches.find(path);
+      if (!watch.empty())
+      {
+         removeWatch(pContext->fd, watch);
+         pContext->watches.erase(watch);
+      }
+      pContext->unwatchedDirs.erase(path);
+#ifdef HAVE_FANOTIFY
+      removeDirectoryHandle(pContext, path);
+#endif
+   }
+}
+
+// start watching a polled directory in which we found changes, making room
+// if necessary by polling the watched directory with the least recent
+// activity instead
+void promoteDirectory(FileEventContext* pContext, const std::string& path)
+{
+   std::size_t maxWatches = impl::maxWatches();
+   if (maxWatches > 0 && pContext->watches.size() >= maxWatches)
+   {
+      Watch watch = pContext->watches.leastRecentlyActive(
+                                          pContext->rootPath.absolutePath());
+      if (watch.empty())
+         return;
+
+      removeWatch(pContext->fd, watch);
+      pContext->watches.erase(watch);
+      pContext->unwatchedDirs.insert(watch.path);
+   }
+
+   Error error = addWatch(pContext, FileInfo(FilePath(path)), false);
+   if (error &&
+       (error.code() != boost::system::errc::no_such_file_or_directory))
+   {
+      LOG_ERROR(error);
+   }
+}
+
+void pollDirectory(FileEventContext* pContext,
+                   const std::string& path,
+                   std::vector<FileChangeEvent>* pFileChanges)
+{
+   tree<FileInfo>::iterator it = findDirectory(pContext, path);
+   if (it == pContext->fileTree.end())
+   {
+      pContext->unwatchedDirs.erase(path);
+      return;
+   }
+
+   std::vector<FileChangeEvent> fileChanges;
+   Error error = impl::discoverAndProcessChildChanges(
+                                             it,
+                                             pContext->recursive,
+                                             pContext->filter,
+                                             addWatchFunction(pContext),
+                                             &pContext->fileTree,
+                                             &fileChanges);
+   if (error)
+   {
+      // a removed directory is dealt with when its parent is checked
+      if (error.code() != boost::system::errc::no_such_file_or_directory)
+         LOG_ERROR(error);
+      return;
+   }
+
+   if (fileChanges.empty())
+      return;
+
+   forgetRemovedDirectories(pContext, fileChanges);
+   promoteDirectory(pContext, path);
+
+   std::copy(fileChanges.begin(),
+             fileChanges.end(),
+             std::back_inserter(*pFileChanges));
+}
+
+// poll our share of the unwatched directories (such that each of them is
+// polled once per poll interval)
+void pollUnwatchedDirectories(FileEventContext* pContext,
+                              std::vector<FileChangeEvent>* pFileChanges)
+{
+   using namespace boost::posix_time;
+
+   std::set<std::string>& dirs = pContext->unwatchedDirs;
+   ptime now = microsec_clock::universal_time();
+   if (dirs.empty() || pContext->lastPollTime.is_not_a_date_time())
+   {
+      pContext->lastPollTime = now;
+      return;
+   }
+
+   boost::int64_t intervalMs = std::max<boost::int64_t>(
+                              impl::pollInterval().total_milliseconds(), 1);
+   boost::int64_t elapsedMs = (now - pContext->lastPollTime).total_milliseconds();
+   std::size_t count = static_cast<std::size_t>(
+                     (dirs.size() * std::max<boost::int64_t>(elapsedMs, 0)) /
+                     intervalMs);
+   if (count == 0)
+      return;
+   count = std::min(count, dirs.size());
+   pContext->lastPollTime = now;
+
+   // collect the directories first since polling modifies the set
+   std::vector<std::string> pollDirs;
+   std::set<std::string>::const_iterator it =
+                                    dirs.upper_bound(pContext->lastPolledDir);
+   while (pollDirs.size() < count)
+   {
+      if (it == dirs.end())
+         it = dirs.begin();
+      pollDirs.push_back(*it++);
+   }
+   pContext->lastPolledDir = pollDirs.back();
+
+   BOOST_FOREACH(const std::string& dir, pollDirs)
+   {
+      if (dirs.count(dir))
+         pollDirectory(pContext, dir, pFileChanges);
+   }
 }
 
 void closeContext(FileEventContext* pContext)
@@ -286,6 +660,102 @@ void closeContext(FileEventContext* pContext)
    }
 }
 
+// apply a change to a file within one of our directories
+Error processFileChange(FileEventContext* pContext,
+                        const std::string& dirPath,
+                        const std::string& name,
+                        FileChangeEvent::Type eventType,
+                        bool isDirectory,
+                        std::vector<FileChangeEvent>* pFileChanges)
+{
+   // get an iterator to the parent dir
+   tree<FileInfo>::iterator parentIt = findDirectory(pContext, dirPath);
+
+   // if we can't find a parent then return (this directory may have
+   // been excluded from scanning due to a filter)
+   if (parentIt == pContext->fileTree.end())
+      return Success();
+
+   // get file info
+   FilePath filePath = FilePath(parentIt->absolutePath()).complete(name);
+
+
+   // if the file exists then collect as many extended attributes
+   // as necessary -- otherwise just record path and dir status
+   FileInfo fileInfo;
+   if (filePath.exists())
+   {
+      fileInfo = FileInfo(filePath, filePath.isSymlink());
+   }
+   else
+   {
+      fileInfo = FileInfo(filePath.absolutePath(), isDirectory);
+   }
+
+   // if this doesn't meet the filter then ignore
+   if (pContext->filter && !pContext->filter(fileInfo))
+      return Success();
+
+   // handle the various types of actions
+   switch(eventType)
+   {
+      case FileChangeEvent::FileRemoved:
+      {
+         // generate events
+         FileChangeEvent event(FileChangeEvent::FileRemoved, fileInfo);
+         std::vector<FileChangeEvent> removeEvents;
+         impl::processFileRemoved(parentIt,
+                                  event,
+                                  pContext->recursive,
+                                  &pContext->fileTree,
+                                  &removeEvents);
+
+         // for each directory remove event remove any watches we have for it
+         forgetRemovedDirectories(pContext, removeEvents);
+
+         // copy to the target events
+         std::copy(removeEvents.begin(),
+                   removeEvents.end(),
+                   std::back_inserter(*pFileChanges));
+
+         break;
+      }
+      case FileChangeEvent::FileAdded:
+      {
+         FileChangeEvent event(FileChangeEvent::FileAdded, fileInfo);
+         Error error = impl::processFileAdded(parentIt,
+                                              event,
+                                              pContext->recursive,
+                                              pContext->filter,
+                                              addWatchFunction(pContext),
+                                              &pContext->fileTree,
+                                              pFileChanges);
+         // log the error if it wasn't no such file/dir (this can happen
+         // in the normal course of business if a file is deleted between
+         // the time the change is detected and we try to inspect it)
+         if (error &&
+            (error.code() != boost::system::errc::no_such_file_or_directory))
+         {
+            LOG_ERROR(error);
+         }
+         break;
+      }
+      case FileChangeEvent::FileModified:
+      {
+         FileChangeEvent event(FileChangeEvent::FileModified, fileInfo);
+         impl::processFileModified(parentIt,
+                                   event,
+                                   &pContext->fileTree,
+                                   pFileChanges);
+         break;
+      }
+      case FileChangeEvent::None:
+         break;
+   }
+
+   return Success();
+}
+
 Error processEvent(FileEventContext* pContext,
                    struct inotify_event* pEvent,
                    std::vector<FileChangeEvent>* pFileChanges)
@@ -312,113 +782,240 @@ Error processEvent(FileEventContext* pContext,
       if (watch.empty())
          return Success();
 
-      // get an iterator to the parent dir
-      tree<FileInfo>::iterator parentIt = impl::findFile(
-                                                   pContext->fileTree.begin(),
-                                                   pContext->fileTree.end(),
-                                                   watch.path);
+      // note activity (so we keep watching this directory in preference
+      // to quieter ones)
+      pContext->watches.touch(watch, ++pContext->activity);
 
-      // if we can't find a parent then return (this directory may have
-      // been excluded from scanning due to a filter)
-      if (parentIt == pContext->fileTree.end())
-         return Success();
+      return processFileChange(pContext,
+                               watch.path,
+                               pEvent->name,
+                               eventType,
+                               pEvent->mask & IN_ISDIR,
+                               pFileChanges);
+   }
+
+   return Success();
+}
 
-      // get file info
-      FilePath filePath = FilePath(parentIt->absolutePath()).complete(
-                                                                 pEvent->name);
+// rescan the tree after we've missed events
+void processOverflow(FileEventContext* pContext)
+{
+   // remove all watches
+   removeAllWatches(pContext);
 
+   // generate events based on scanning
+   Error error =impl::discoverAndProcessFileChanges(
+         FileInfo(pContext->rootPath),
+         pContext->recursive,
+         pContext->filter,
+         addWatchFunction(pContext, true),
+         &pContext->fileTree,
+         pContext->callbacks.onFilesChanged);
+   if (error)
+      terminateWithMonitoringError(pContext, error);
+}
 
-      // if the file exists then collect as many extended attributes
-      // as necessary -- otherwise just record path and dir status
-      FileInfo fileInfo;
-      if (filePath.exists())
-      {
-         fileInfo = FileInfo(filePath, filePath.isSymlink());
-      }
-      else
+Error processInotifyEvents(FileEventContext* pContext,
+                           char* eventBuffer,
+                           int len,
+                           std::vector<FileChangeEvent>* pFileChanges)
+{
+   // iterate through the events
+   const int kEventSize = sizeof(struct inotify_event);
+   int i = 0;
+   while (i < len)
+   {
+      // get the event
+      typedef struct inotify_event* EventPtr;
+      EventPtr pEvent = (EventPtr)&eventBuffer[i];
+
+      // buffer overflow is handled specially -- basically
+      // we start over because we missed events
+      if (pEvent->mask & IN_Q_OVERFLOW)
       {
-         fileInfo = FileInfo(filePath.absolutePath(), pEvent->mask & IN_ISDIR);
+         processOverflow(pContext);
+
+         // always break here -- we've generated events based on
+         // a fresh scan so any other events in the queue would
+         // be duplicates
+         break;
       }
 
-      // if this doesn't meet the filter then ignore
-      if (pContext->filter && !pContext->filter(fileInfo))
-         return Success();
+      // process the event
+      Error error = processEvent(pContext, pEvent, pFileChanges);
+      if (error)
+         return error;
 
-      // handle the various types of actions
-      switch(eventType)
-      {
-         case FileChangeEvent::FileRemoved:
-         {
-            // generate events
-            FileChangeEvent event(FileChangeEvent::FileRemoved, fileInfo);
-            std::vector<FileChangeEvent> removeEvents;
-            impl::processFileRemoved(parentIt,
-                                     event,
-                                     pContext->recursive,
-                                     &pContext->fileTree,
-                                     &removeEvents);
-
-            // for each directory remove event remove any watches we have for it
-            BOOST_FOREACH(const FileChangeEvent& event, removeEvents)
-            {
-               if (event.fileInfo().isDirectory())
-               {
-                  Watch watch = pContext->watches.find(
-                                             event.fileInfo().absolutePath());
-                  if (!watch.empty())
-                  {
-                     removeWatch(pContext->fd, watch);
-                     pContext->watches.erase(watch);
-                  }
-               }
-            }
+      // advance to next event
+      i += kEventSize + pEvent->len;
+   }
 
-            // copy to the target events
-            std::copy(removeEvents.begin(),
-                      removeEvents.end(),
-                      std::back_inserter(*pFileChanges));
+   return Success();
+}
 
-            break;
-         }
-         case FileChangeEvent::FileAdded:
-         {
-            FileChangeEvent event(FileChangeEvent::FileAdded, fileInfo);
-            Error error = impl::processFileAdded(parentIt,
-                                                 event,
-                                                 pContext->recursive,
-                                                 pContext->filter,
-                                                 addWatchFunction(pContext),
-                                                 &pContext->fileTree,
-                                                 pFileChanges);
-            // log the error if it wasn't no such file/dir (this can happen
-            // in the normal course of business if a file is deleted between
-            // the time the change is detected and we try to inspect it)
-            if (error &&
-               (error.code() != boost::system::errc::no_such_file_or_directory))
-            {
-               LOG_ERROR(error);
-            }
-            break;
-         }
-         case FileChangeEvent::FileModified:
-         {
-            FileChangeEvent event(FileChangeEvent::FileModified, fileInfo);
-            impl::processFileModified(parentIt,
-                                      event,
-                                      &pContext->fileTree,
-                                      pFileChanges);
-            break;
-         }
-         case FileChangeEvent::None:
-            break;
-      }
+#ifdef HAVE_FANOTIFY
+
+Error processFanotifyEvent(FileEventContext* pContext,
+                           struct fanotify_event_metadata* pEvent,
+                           std::vector<FileChangeEvent>* pFileChanges)
+{
+   // fid groups shouldn't receive file descriptors, but be sure not to
+   // leak any we are given
+   if (pEvent->fd >= 0)
+      ::close(pEvent->fd);
+
+   // find the parent directory and name (reported as the first record)
+   if (pEvent->event_len < pEvent->metadata_len +
+                           sizeof(struct fanotify_event_info_fid))
+   {
+      return Success();
+   }
+   struct fanotify_event_info_fid* pInfo =
+         (struct fanotify_event_info_fid*)((char*)pEvent + pEvent->metadata_len);
+   if (pInfo->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+      return Success();
+
+   // ignore events for directories we don't know about (the mark covers the
+   // whole filesystem, not just our tree)
+   struct file_handle* pHandle = (struct file_handle*)pInfo->handle;
+   std::map<std::string, std::string>::const_iterator it =
+      pContext->dirsByHandle.find(DirectoryHandle::handleKey(pHandle));
+   if (it == pContext->dirsByHandle.end())
+      return Success();
+
+   // changes to the directory itself are reported with a name of "."
+   std::string name((char*)(pHandle->f_handle + pHandle->handle_bytes));
+   if (name.empty() || name == ".")
+      return Success();
+
+   // events may be merged, in which case whether the file still exists
+   // tells us where things ended up
+   FileChangeEvent::Type eventType = FileChangeEvent::None;
+   bool added = pEvent->mask & (FAN_CREATE | FAN_MOVED_TO);
+   bool removed = pEvent->mask & (FAN_DELETE | FAN_MOVED_FROM);
+   if (added && removed)
+   {
+      FilePath filePath = FilePath(it->second).complete(name);
+      eventType = filePath.exists() ? FileChangeEvent::FileAdded
+                                    : FileChangeEvent::FileRemoved;
    }
+   else if (added)
+      eventType = FileChangeEvent::FileAdded;
+   else if (removed)
+      eventType = FileChangeEvent::FileRemoved;
+   else if (pEvent->mask & FAN_MODIFY)
+      eventType = FileChangeEvent::FileModified;
 
+   if (eventType == FileChangeEvent::None)
+      return Success();
 
+   return processFileChange(pContext,
+                            it->second,
+                            name,
+                            eventType,
+                            pEvent->mask & FAN_ONDIR,
+                            pFileChanges);
+}
+
+Error processFanotifyEvents(FileEventContext* pContext,
+                            char* eventBuffer,
+                            int len,
+                            std::vector<FileChangeEvent>* pFileChanges)
+{
+   struct fanotify_event_metadata* pEvent =
+                              (struct fanotify_event_metadata*)eventBuffer;
+   for (; FAN_EVENT_OK(pEvent, len); pEvent = FAN_EVENT_NEXT(pEvent, len))
+   {
+      if (pEvent->vers != FANOTIFY_METADATA_VERSION)
+         return systemError(boost::system::errc::protocol_error,
+                            ERROR_LOCATION);
+
+      // start over if we missed events (as for inotify)
+      if (pEvent->mask & FAN_Q_OVERFLOW)
+      {
+         processOverflow(pContext);
+         break;
+      }
+
+      Error error = processFanotifyEvent(pContext, pEvent, pFileChanges);
+      if (error)
+         return error;
+   }
 
    return Success();
 }
 
+// attempt to monitor using fanotify, which requires a kernel supporting
+// directory file handles and names (5.9) and CAP_SYS_ADMIN
+bool initializeFanotify(FileEventContext* pContext)
+{
+   int fd = ::fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME |
+                            FAN_NONBLOCK | FAN_CLOEXEC,
+                            O_RDONLY | O_LARGEFILE);
+   if (fd < 0)
+      return false;
+
+   std::string rootPath = pContext->rootPath.absolutePath();
+   uint64_t mask = FAN_CREATE | FAN_DELETE | FAN_MODIFY |
+                   FAN_MOVED_FROM | FAN_MOVED_TO | FAN_ONDIR;
+   if (::fanotify_mark(fd,
+                       FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+                       mask,
+                       AT_FDCWD,
+                       rootPath.c_str()) < 0)
+   {
+      ::close(fd);
+      return false;
+   }
+
+   DirectoryHandle handle;
+   Error error = getDirectoryHandle(rootPath,
+                                    true,
+                                    &handle,
+                                    &pContext->rootMountId);
+   if (error)
+   {
+      ::close(fd);
+      return false;
+   }
+
+   pContext->fd = fd;
+   pContext->fanotify = true;
+   return true;
+}
+
+#endif
+
+// returns an errno value on failure
+int initializeInotify(FileEventContext* pContext)
+{
+#ifdef HAVE_INOTIFY_INIT1
+   pContext->fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if (pContext->fd < 0)
+      return errno;
+#else
+   // init file descriptor
+   pContext->fd = ::inotify_init();
+   if (pContext->fd < 0)
+      return errno;
+
+   // set non-blocking
+   int flags = ::fcntl(pContext->fd, F_GETFL);
+   if (flags == -1)
+      return errno;
+   if (::fcntl(pContext->fd, F_SETFL, flags | O_NONBLOCK) == -1)
+      return errno;
+
+   // set close on exec
+   int fdFlags = ::fcntl(pContext->fd, F_GETFD);
+   if (fdFlags == -1)
+      return errno;
+   if (::fcntl(pContext->fd, F_SETFD, fdFlags | FD_CLOEXEC) == -1)
+      return errno;
+#endif
+
+   return 0;
+}
 
 Handle registrationFailure(int errorNumber,
                            FileEventContext* pContext,
@@ -449,36 +1046,29 @@ Handle registerMonitor(const core::FilePath& filePath,
    pContext->filter = filter;
    std::auto_ptr<FileEventContext> autoPtrContext(pContext);
 
-   // init file descriptor
-#ifdef HAVE_INOTIFY_INIT1
-   pContext->fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
-   if (pContext->fd < 0)
-      return registrationFailure(errno, pContext, callbacks, ERROR_LOCATION);
-#else
-   // init file descriptor
-   pContext->fd = ::inotify_init();
-   if (pContext->fd < 0)
-      return registrationFailure(errno, pContext, callbacks, ERROR_LOCATION);
-
-   // set non-blocking
-   int flags = ::fcntl(pContext->fd, F_GETFL);
-   if (flags == -1)
-      return registrationFailure(errno, pContext, callbacks, ERROR_LOCATION);
-   if (::fcntl(pContext->fd, F_SETFL, flags | O_NONBLOCK) == -1)
-      return registrationFailure(errno, pContext, callbacks, ERROR_LOCATION);
-
-   // set close on exec
-   int fdFlags = ::fcntl(pContext->fd, F_GETFD);
-   if (fdFlags == -1)
-      return registrationFailure(errno, pContext, callbacks, ERROR_LOCATION);
-   if (::fcntl(pContext->fd, F_SETFD, fdFlags | FD_CLOEXEC) == -1)
-      return registrationFailure(errno, pContext, callbacks, ERROR_LOCATION);
+#ifdef HAVE_FANOTIFY
+   // use fanotify for recursive monitors where we can (falling back to
+   // inotify if it's unsupported or we aren't privileged)
+   if (recursive && impl::useFanotify())
+      initializeFanotify(pContext);
 #endif
 
+   // otherwise init an inotify file descriptor
+   if (!pContext->fanotify)
+   {
+      int errorNumber = initializeInotify(pContext);
+      if (errorNumber != 0)
+         return registrationFailure(errorNumber,
+                                    pContext,
+                                    callbacks,
+                                    ERROR_LOCATION);
+   }
+
    // scan the files (use callback to setup watches)
    FileScannerOptions options;
    options.recursive = recursive;
    options.yield = true;
+   options.threads = kScanThreads;
    options.filter = filter;
    options.onBeforeScanDir = addWatchFunction(pContext, true);
    Error error = scanFiles(FileInfo(filePath), options, &pContext->fileTree);
@@ -530,7 +1120,8 @@ void run(const boost::function<void()>& checkForInput)
    const int kEventSize = sizeof(struct inotify_event);
    const int kFilenameSizeEstimate = 20;
    const int kEventBufferLength = 5000 * (kEventSize+kFilenameSizeEstimate);
-   char eventBuffer[kEventBufferLength];
+   // (aligned for both inotify and fanotify events)
+   char eventBuffer[kEventBufferLength] __attribute__ ((aligned(8)));
 
    while(true)
    {
@@ -577,51 +1168,27 @@ void run(const boost::function<void()>& checkForInput)
                break;
             }
 
-            // iterate through the events
-            int i = 0;
-            while (i < len)
+            // process the events
+#ifdef HAVE_FANOTIFY
+            Error error = pContext->fanotify ?
+               processFanotifyEvents(pContext, eventBuffer, len, &fileChanges) :
+               processInotifyEvents(pContext, eventBuffer, len, &fileChanges);
+#else
+            Error error = processInotifyEvents(pContext,
+                                               eventBuffer,
+                                               len,
+                                               &fileChanges);
+#endif
+            if (error)
             {
-               // get the event
-               typedef struct inotify_event* EventPtr;
-               EventPtr pEvent = (EventPtr)&eventBuffer[i];
-
-               // buffer overflow is handled specially -- basically
-               // we start over because we missed events
-               if (pEvent->mask & IN_Q_OVERFLOW)
-               {
-                  // remove all watches
-                  removeAllWatches(pContext);
-
-                  // generate events based on scanning
-                  Error error =impl::discoverAndProcessFileChanges(
-                        FileInfo(pContext->rootPath),
-                        pContext->recursive,
-                        pContext->filter,
-                        addWatchFunction(pContext, true),
-                        &pContext->fileTree,
-                        pContext->callbacks.onFilesChanged);
-                  if (error)
-                     terminateWithMonitoringError(pContext, error);
-
-                  // always break here -- we've generated events based on
-                  // a fresh scan so any other events in the queue would
-                  // be duplicates
-                  break;
-               }
-
-               // process the event
-               Error error = processEvent(pContext, pEvent, &fileChanges);
-               if (error)
-               {
-                  terminateWithMonitoringError(pContext, error);
-                  break;
-               }
-
-               // advance to next event
-               i += kEventSize + pEvent->len;
+               terminateWithMonitoringError(pContext, error);
+               break;
             }
          }
 
+         // check directories we aren't watching
+         pollUnwatchedDirectories(pContext, &fileChanges);
+
          // fire any events we got
          if (!fileChanges.empty())
             pContext->callbacks.onFilesChanged(fileChanges);
@@ -139,74 +139,6 @@ FilePath resolveFilename(const FilePath& rootDir,
       return FilePath();
 }
 
-// TeX wraps lines hard at 79 characters. We use heuristics as described in
-// Sublime Text's TeX plugin to determine where these breaks are.
-void unwrapLines(std::vector<std::string>* pLines,
-                 std::vector<size_t>* pLinesUnwrapped=NULL)
-{
-   static boost::regex regexLine("^l\\.(\\d+)\\s");
-   static boost::regex regexAssignment("^\\\\.*?=");
-
-   std::vector<std::string>::iterator pos = pLines->begin();
-
-   for ( ; pos != pLines->end(); pos++)
-   {
-      // The first line is always long, and not artificially wrapped
-      if (pos == pLines->begin())
-         continue;
-
-      if (pos->length() != 79)
-         continue;
-
-      // The **<filename> line may be long, but we don't care about it
-      if (beginsWith(*pos, "**"))
-         continue;
-
-      while (true)
-      {
-         std::vector<std::string>::iterator nextPos = pos + 1;
-         // No more lines to add
-         if (nextPos == pLines->end())
-            break;
-
-         if (nextPos->empty())
-            break;
-
-         // Underfull/Overfull terminator
-         if (*nextPos == " []")
-            break;
-
-         // Common prefixes
-         if (beginsWith(*nextPos, "File:", "Package:", "Document Class:"))
-            break;
-
-         // More prefixes
-         if (beginsWith(*nextPos, "LaTeX Warning:", "LaTeX Info:", "LaTeX2e <"))
-            break;
-
-         if (regex_utils::search(*nextPos, regexAssignment))
-            break;
-
-         if (regex_utils::search(*nextPos, regexLine))
-            break;
-
-         bool breakAfterAppend = nextPos->length() != 79;
-
-         pos->append(*nextPos);
-         // NOTE: Erase is a simple but inefficient way of handling this. Would
-         //    be way faster to maintain an output iterator that points to the
-         //    correct point in pLines, and when finished, truncate whatever
-         //    elements come after the final position of the output iterator.
-         pLines->erase(nextPos, nextPos+1);
-         if (pLinesUnwrapped)
-            pLinesUnwrapped->push_back(1 + (pos - pLines->begin()));
-
-         if (breakAfterAppend)
-            break;
-      }
-   }
-}
-
 class FileStack : public boost::noncopyable
 {
 public:
@@ -311,206 +243,342 @@ FilePath texFilePath(const std::string& logPath, const FilePath& compileDir)
    }
 }
 
-size_t calculateWrappedLine(const std::vector<size_t>& unwrappedLines,
-                               size_t unwrappedLineNum)
+// TeX wraps lines hard at 79 characters. We use heuristics as described in
+// Sublime Text's TeX plugin to determine where these breaks are: a line of
+// 79 characters is joined with those which follow it (up to and including
+// the first which isn't 79 characters) unless the one following looks like
+// the start of a new line
+bool isWrapContinuation(const std::string& line)
 {
-   for (std::vector<size_t>::const_iterator it = unwrappedLines.begin();
-        it != unwrappedLines.end();
-        it++)
+   static boost::regex regexLine("^l\\.(\\d+)\\s");
+   static boost::regex regexAssignment("^\\\\.*?=");
+
+   if (line.empty())
+      return false;
+
+   // Underfull/Overfull terminator
+   if (line == " []")
+      return false;
+
+   // Common prefixes
+   if (beginsWith(line, "File:", "Package:", "Document Class:"))
+      return false;
+
+   // More prefixes
+   if (beginsWith(line, "LaTeX Warning:", "LaTeX Info:", "LaTeX2e <"))
+      return false;
+
+   if (regex_utils::search(line, regexAssignment))
+      return false;
+
+   if (regex_utils::search(line, regexLine))
+      return false;
+
+   return true;
+}
+
+} // anonymous namespace
+
+struct LatexLogParser::Impl
+{
+   explicit Impl(const FilePath& logFilePath)
+      : logFilePath(logFilePath),
+        rootDir(logFilePath.parent()),
+        fileStack(rootDir),
+        physicalLines(0),
+        hasPending(false),
+        pendingStart(0),
+        pendingContinues(false),
+        state(StateNormal),
+        entryLogLine(0)
    {
-      if (*it >= unwrappedLineNum)
-      {
-         return unwrappedLineNum + (it - unwrappedLines.begin());
-      }
    }
 
-   return unwrappedLineNum + unwrappedLines.size();
+   void addPhysicalLine(const std::string& line);
+   void flushPending();
+   void processLine(const std::string& line, int logLine);
+   void completeWarning(const std::string& lastLine);
+   void finish();
+
+   FilePath logFilePath;
+   FilePath rootDir;
+   FileStack fileStack;
+
+   // output following the last complete line
+   std::string partialLine;
+
+   // the line being unwrapped (and the log line on which it starts)
+   int physicalLines;
+   bool hasPending;
+   std::string pending;
+   int pendingStart;
+   bool pendingContinues;
+
+   // the entry (if any) which continues over the lines which follow
+   enum State { StateNormal, StateBox, StateError, StateWarning };
+   State state;
+   int entryLogLine;
+   FilePath entryFilePath;
+   std::string entryMessage;
+
+   LogEntries logEntries;
+};
+
+void LatexLogParser::Impl::addPhysicalLine(const std::string& line)
+{
+   physicalLines++;
+
+   if (hasPending && pendingContinues && isWrapContinuation(line))
+   {
+      pending.append(line);
+      pendingContinues = line.length() == 79;
+      if (!pendingContinues)
+         flushPending();
+      return;
+   }
+
+   flushPending();
+
+   // The first line is always long, and not artificially wrapped; the
+   // **<filename> line may be long, but we don't care about it
+   hasPending = true;
+   pending = line;
+   pendingStart = physicalLines;
+   pendingContinues = physicalLines > 1 &&
+                      line.length() == 79 &&
+                      !beginsWith(line, "**");
+   if (!pendingContinues)
+      flushPending();
 }
 
-} // anonymous namespace
+void LatexLogParser::Impl::flushPending()
+{
+   if (!hasPending)
+      return;
 
-Error parseLatexLog(const FilePath& logFilePath, LogEntries* pLogEntries)
+   hasPending = false;
+   processLine(pending, pendingStart);
+}
+
+void LatexLogParser::Impl::processLine(const std::string& line, int logLine)
 {
    static boost::regex regexOverUnderfullLines(" at lines (\\d+)--(\\d+)\\s*(?:\\[])?$");
    static boost::regex regexWarning("^(?:.*?) Warning: (.+)");
-   static boost::regex regexWarningEnd(" input line (\\d+)\\.$");
    static boost::regex regexLnn("^l\\.(\\d+)\\s");
    static boost::regex regexCStyleError("^(.+):(\\d+):\\s(.+)$");
 
-   std::vector<std::string> lines;
-   Error error = readStringVectorFromFile(logFilePath, &lines, false);
-   if (error)
-      return error;
+   switch (state)
+   {
+   case StateBox:
+      // For multi-line case, we're looking for " []" on a line by itself
+      if (line == " []")
+         state = StateNormal;
+      return;
 
-   std::vector<size_t> linesUnwrapped;
-   unwrapLines(&lines, &linesUnwrapped);
+   case StateError:
+   {
+      // the error's line follows it (as l.<line>)
+      boost::smatch match;
+      if (regex_utils::search(line, match, regexLnn))
+      {
+         logEntries.push_back(LogEntry(logFilePath,
+                                       entryLogLine,
+                                       LogEntry::Error,
+                                       entryFilePath,
+                                       safe_convert::stringTo<int>(match[1], -1),
+                                       entryMessage));
+         state = StateNormal;
+      }
+      return;
+   }
 
-   FilePath rootDir = logFilePath.parent();
-   FileStack fileStack(rootDir);
+   case StateWarning:
+      entryMessage.append(line);
+      if (boost::algorithm::ends_with(entryMessage, "."))
+         completeWarning(line);
+      return;
 
-   for (std::vector<std::string>::const_iterator it = lines.begin();
-        it != lines.end();
-        it++)
-   {
-      const std::string& line = *it;
-      auto logLineNum = (it - lines.begin()) + 1;
+   case StateNormal:
+      break;
+   }
 
-      // We slurp overfull/underfull messages with no further processing
-      // (i.e. not manipulating the file stack)
+   // We slurp overfull/underfull messages with no further processing
+   // (i.e. not manipulating the file stack)
 
-      if (beginsWith(line, "Overfull ", "Underfull "))
+   if (beginsWith(line, "Overfull ", "Underfull "))
+   {
+      std::string msg = line;
+      int lineNum = -1;
+
+      // Parse lines, if present
+      boost::smatch overUnderfullLinesMatch;
+      if (regex_utils::search(line,
+                              overUnderfullLinesMatch,
+                              regexOverUnderfullLines))
       {
-         std::string msg = line;
-         int lineNum = -1;
-
-         // Parse lines, if present
-         boost::smatch overUnderfullLinesMatch;
-         if (regex_utils::search(line,
-                                 overUnderfullLinesMatch,
-                                 regexOverUnderfullLines))
-         {
-            lineNum = safe_convert::stringTo<int>(overUnderfullLinesMatch[1],
-                                                  -1);
-         }
+         lineNum = safe_convert::stringTo<int>(overUnderfullLinesMatch[1],
+                                               -1);
+      }
 
-         // Single line case
-         bool singleLine = boost::algorithm::ends_with(line, "[]");
+      // Single line case
+      bool singleLine = boost::algorithm::ends_with(line, "[]");
 
-         if (singleLine)
-         {
-            msg.erase(line.size()-2, 2);
-            boost::algorithm::trim_right(msg);
-         }
+      if (singleLine)
+      {
+         msg.erase(line.size()-2, 2);
+         boost::algorithm::trim_right(msg);
+      }
 
-         pLogEntries->push_back(LogEntry(logFilePath,
-                                         static_cast<int>(calculateWrappedLine(linesUnwrapped,
-                                                                               logLineNum)),
-                                         LogEntry::Box,
-                                         fileStack.currentFile(),
-                                         lineNum,
-                                         msg));
+      logEntries.push_back(LogEntry(logFilePath,
+                                    logLine,
+                                    LogEntry::Box,
+                                    fileStack.currentFile(),
+                                    lineNum,
+                                    msg));
 
-         if (singleLine)
-            continue;
+      if (!singleLine)
+         state = StateBox;
+      return;
+   }
 
-         for (; it != lines.end(); it++)
-         {
-            // For multi-line case, we're looking for " []" on a line by itself
-            if (*it == " []")
-               break;
-         }
+   fileStack.processLine(line);
 
-         // The iterator would be incremented by the outer for loop, must not
-         // let it go past the end! (If we did get to the end, it would
-         // mean the log file was malformed, but we still can't crash in this
-         // situation.)
-         if (it == lines.end())
-            break;
-         else
-            continue;
-      }
+   // Now see if it's an error or warning
 
-      fileStack.processLine(line);
+   if (beginsWith(line, "! "))
+   {
+      state = StateError;
+      entryLogLine = logLine;
+      entryFilePath = fileStack.currentFile();
+      entryMessage = line.substr(2);
+      return;
+   }
 
-      // Now see if it's an error or warning
+   boost::smatch warningMatch;
+   if (regex_utils::search(line, warningMatch, regexWarning))
+   {
+      state = StateWarning;
+      entryLogLine = logLine;
+      entryFilePath = fileStack.currentFile();
+      entryMessage = warningMatch[1];
+      if (boost::algorithm::ends_with(entryMessage, "."))
+         completeWarning(line);
+      return;
+   }
 
-      if (beginsWith(line, "! "))
+   boost::smatch cStyleErrorMatch;
+   if (regex_utils::search(line, cStyleErrorMatch, regexCStyleError))
+   {
+      FilePath cstyleFile = resolveFilename(rootDir, cStyleErrorMatch[1]);
+      if (cstyleFile.exists())
       {
-         std::string errorMsg = line.substr(2);
-         int lineNum = -1;
+         int lineNum = safe_convert::stringTo<int>(cStyleErrorMatch[2], -1);
+         logEntries.push_back(LogEntry(logFilePath,
+                                       logLine,
+                                       LogEntry::Error,
+                                       cstyleFile,
+                                       lineNum,
+                                       cStyleErrorMatch[3]));
+      }
+   }
+}
 
-         boost::smatch match;
-         for (it++; it != lines.end(); it++)
-         {
-            if (regex_utils::search(*it, match, regexLnn))
-            {
-               lineNum = safe_convert::stringTo<int>(match[1], -1);
-               break;
-            }
-         }
+void LatexLogParser::Impl::completeWarning(const std::string& lastLine)
+{
+   static boost::regex regexWarningEnd(" input line (\\d+)\\.$");
 
-         pLogEntries->push_back(LogEntry(logFilePath,
-                                         static_cast<int>(calculateWrappedLine(linesUnwrapped,
-                                                                               logLineNum)),
-                                         LogEntry::Error,
-                                         fileStack.currentFile(),
-                                         lineNum,
-                                         errorMsg));
-
-         // The iterator would be incremented by the outer for loop, must not
-         // let it go past the end! (If we did get to the end, it would
-         // mean the log file was malformed, but we still can't crash in this
-         // situation.)
-         if (it == lines.end())
-            break;
-         else
-            continue;
-      }
+   int lineNum = -1;
+   boost::smatch warningEndMatch;
+   if (regex_utils::search(lastLine, warningEndMatch, regexWarningEnd))
+      lineNum = safe_convert::stringTo<int>(warningEndMatch[1], -1);
+
+   logEntries.push_back(LogEntry(logFilePath,
+                                 entryLogLine,
+                                 LogEntry::Warning,
+                                 entryFilePath,
+                                 lineNum,
+                                 entryMessage));
+   state = StateNormal;
+}
 
-      boost::smatch warningMatch;
-      if (regex_utils::search(line, warningMatch, regexWarning))
-      {
-         std::string warningMsg = warningMatch[1];
-         int lineNum = -1;
-         while (true)
-         {
-            if (boost::algorithm::ends_with(warningMsg, "."))
-            {
-               boost::smatch warningEndMatch;
-               if (regex_utils::search(*it, warningEndMatch, regexWarningEnd))
-               {
-                  lineNum = safe_convert::stringTo<int>(warningEndMatch[1], -1);
-               }
-               break;
-            }
+void LatexLogParser::Impl::finish()
+{
+   if (!partialLine.empty())
+   {
+      addPhysicalLine(partialLine);
+      partialLine.clear();
+   }
+   flushPending();
 
-            if (++it == lines.end())
-               break;
-            warningMsg.append(*it);
-         }
+   // errors and warnings which the log ended before completing are
+   // reported without a line
+   if (state == StateError || state == StateWarning)
+   {
+      logEntries.push_back(LogEntry(logFilePath,
+                                    entryLogLine,
+                                    state == StateError ? LogEntry::Error :
+                                                          LogEntry::Warning,
+                                    entryFilePath,
+                                    -1,
+                                    entryMessage));
+   }
+   state = StateNormal;
+}
 
-         pLogEntries->push_back(LogEntry(logFilePath,
-                                         static_cast<int>(calculateWrappedLine(linesUnwrapped,
-                                                                               logLineNum)),
-                                         LogEntry::Warning,
-                                         fileStack.currentFile(),
-                                         lineNum,
-                                         warningMsg));
-
-         // The iterator would be incremented by the outer for loop, must not
-         // let it go past the end! (If we did get to the end, it would
-         // mean the log file was malformed, but we still can't crash in this
-         // situation.)
-         if (it == lines.end())
-            break;
-         else
-            continue;
-      }
+LatexLogParser::LatexLogParser(const FilePath& logFilePath)
+   : pImpl_(new Impl(logFilePath))
+{
+}
 
-      boost::smatch cStyleErrorMatch;
-      if (regex_utils::search(line, cStyleErrorMatch, regexCStyleError))
-      {
-         FilePath cstyleFile = resolveFilename(rootDir, cStyleErrorMatch[1]);
-         if (cstyleFile.exists())
-         {
-            int lineNum = safe_convert::stringTo<int>(cStyleErrorMatch[2], -1);
-            pLogEntries->push_back(LogEntry(logFilePath,
-                                            static_cast<int>(calculateWrappedLine(linesUnwrapped,
-                                                                                  logLineNum)),
-                                            LogEntry::Error,
-                                            cstyleFile,
-                                            lineNum,
-                                            cStyleErrorMatch[3]));
-         }
-      }
+LatexLogParser::~LatexLogParser()
+{
+}
+
+void LatexLogParser::addOutput(const std::string& output)
+{
+   std::string::size_type start = 0;
+   std::string::size_type newline;
+   while ((newline = output.find('\n', start)) != std::string::npos)
+   {
+      pImpl_->partialLine.append(output, start, newline - start);
+      pImpl_->addPhysicalLine(pImpl_->partialLine);
+      pImpl_->partialLine.clear();
+      start = newline + 1;
    }
+   pImpl_->partialLine.append(output, start, std::string::npos);
+}
+
+void LatexLogParser::finish()
+{
+   pImpl_->finish();
+}
+
+const LogEntries& LatexLogParser::logEntries() const
+{
+   return pImpl_->logEntries;
+}
+
+Error parseLatexLog(const FilePath& logFilePath, LogEntries* pLogEntries)
+{
+   std::string contents;
+   Error error = readStringFromFile(logFilePath, &contents);
+   if (error)
+      return error;
+
+   LatexLogParser parser(logFilePath);
+   parser.addOutput(contents);
+   parser.finish();
+
+   const LogEntries& logEntries = parser.logEntries();
+   std::copy(logEntries.begin(), logEntries.end(),
+             std::back_inserter(*pLogEntries));
 
    return Success();
 }
 
 Error parseBibtexLog(const FilePath& logFilePath, LogEntries* pLogEntries)
 {
-   boost::regex re("^(.*)---line ([0-9]+) of file (.*)$");
+   static boost::regex re("^(.*)---line ([0-9]+) of file (.*)$");
 
    // get the lines
    std::vector<std::string> lines;
@@ -0,0 +1,148 @@
+/*
+ * TexLogParserTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/tex/TexLogParser.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tex {
+namespace tests {
+
+namespace {
+
+const char * const kLog =
+   "This is pdfTeX, Version 3.14159265-2.6-1.40.18 (TeX Live 2017)\n"
+   "(./doc.tex\n"
+   "LaTeX2e <2017-04-15>\n"
+   "! Undefined control sequence.\n"
+   "l.12 \\foo\n"
+   "\n"
+   "LaTeX Warning: Reference `fig' on page 1 undefined on input line 20.\n"
+   "\n"
+   "Overfull \\hbox (1.5pt too wide) in paragraph at lines 30--31\n"
+   "[]\\OT1/cmr/m/n/10 text\n"
+   " []\n"
+   "\n"
+   "LaTeX Warning: Citation `ref' on page 2\n"
+   "undefined on input line 41.\n"
+   ") )\n";
+
+bool sameEntries(const LogEntries& entries1, const LogEntries& entries2)
+{
+   if (entries1.size() != entries2.size())
+      return false;
+
+   for (std::size_t i = 0; i < entries1.size(); i++)
+   {
+      if (entries1[i].type() != entries2[i].type() ||
+          entries1[i].logLine() != entries2[i].logLine() ||
+          entries1[i].filePath() != entries2[i].filePath() ||
+          entries1[i].line() != entries2[i].line() ||
+          entries1[i].message() != entries2[i].message())
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+} // anonymous namespace
+
+context("TexLogParserTests")
+{
+   FilePath dirPath;
+   FilePath::tempFilePath(&dirPath);
+   dirPath.ensureDirectory();
+   writeStringToFile(dirPath.complete("doc.tex"), "");
+   FilePath logPath = dirPath.complete("doc.log");
+   writeStringToFile(logPath, kLog);
+
+   test_that("Errors, warnings and bad boxes are parsed from the log")
+   {
+      LogEntries entries;
+      expect_false(parseLatexLog(logPath, &entries));
+      expect_true(entries.size() == 4);
+      if (entries.size() == 4)
+      {
+         expect_true(entries[0].type() == LogEntry::Error);
+         expect_true(entries[0].line() == 12);
+         expect_true(entries[0].logLine() == 4);
+         expect_true(entries[0].message() == "Undefined control sequence.");
+         expect_true(entries[0].filePath().filename() == "doc.tex");
+
+         expect_true(entries[1].type() == LogEntry::Warning);
+         expect_true(entries[1].line() == 20);
+
+         expect_true(entries[2].type() == LogEntry::Box);
+         expect_true(entries[2].line() == 30);
+
+         expect_true(entries[3].type() == LogEntry::Warning);
+         expect_true(entries[3].line() == 41);
+         expect_true(entries[3].logLine() == 13);
+      }
+   }
+
+   test_that("Errors are reported as soon as their lines are added")
+   {
+      LatexLogParser parser(logPath);
+      parser.addOutput("(./doc.tex\n! Undefined control sequence.\nl.1");
+      expect_true(parser.logEntries().empty());
+
+      parser.addOutput("2 \\foo\n");
+      expect_true(parser.logEntries().size() == 1);
+      if (!parser.logEntries().empty())
+         expect_true(parser.logEntries()[0].line() == 12);
+   }
+
+   test_that("Output added in pieces is parsed as a whole log is")
+   {
+      LogEntries entries;
+      expect_false(parseLatexLog(logPath, &entries));
+
+      std::string log(kLog);
+      LatexLogParser parser(logPath);
+      for (std::size_t i = 0; i < log.size(); i += 7)
+         parser.addOutput(log.substr(i, 7));
+      parser.finish();
+
+      expect_true(sameEntries(parser.logEntries(), entries));
+   }
+
+   test_that("Entries cut short are reported when finished")
+   {
+      LatexLogParser parser(logPath);
+      parser.addOutput("! Emergency stop.\n");
+      expect_true(parser.logEntries().empty());
+
+      parser.finish();
+      expect_true(parser.logEntries().size() == 1);
+      if (!parser.logEntries().empty())
+         expect_true(parser.logEntries()[0].line() == -1);
+   }
+
+   dirPath.remove();
+}
+
+} // namespace tests
+} // namespace tex
+} // namespace core
+} // namespace rstudio
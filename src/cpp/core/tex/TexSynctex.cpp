@@ -16,6 +16,7 @@
 #include <core/tex/TexSynctex.hpp>
 
 #include <iostream>
+#include <map>
 
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -73,6 +74,10 @@ struct Synctex::Impl
 
    FilePath pdfPath;
    synctex_scanner_t scanner;
+
+   // synctex names of the input files we've searched for (so repeated
+   // searches needn't walk the scanner's inputs and stat each of them)
+   std::map<std::string, std::string> inputNames;
 };
 
 
@@ -196,6 +201,18 @@ PdfLocation Synctex::topOfPageContent(int page)
 }
 
 std::string Synctex::synctexNameForInputFile(const FilePath& inputFile)
+{
+   std::map<std::string, std::string>::const_iterator it =
+                        pImpl_->inputNames.find(inputFile.absolutePath());
+   if (it != pImpl_->inputNames.end())
+      return it->second;
+
+   std::string name = findSynctexNameForInputFile(inputFile);
+   pImpl_->inputNames[inputFile.absolutePath()] = name;
+   return name;
+}
+
+std::string Synctex::findSynctexNameForInputFile(const FilePath& inputFile)
 {
    // get the base directory for the input file
    FilePath parentPath = inputFile.parent();
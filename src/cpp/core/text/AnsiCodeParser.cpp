@@ -15,7 +15,11 @@
 
 #include <core/text/AnsiCodeParser.hpp>
 
-#include <boost/regex.hpp>
+#include <cstring>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
 namespace rstudio {
 namespace core {
@@ -23,22 +27,185 @@ namespace text {
 
 namespace {
 
-// Match ANSI escape codes copied from https://github.com/chalk/ansi-regex
-const char* kAnsiMatch = "[\\x1b\\x9b][[()#;?]*(?:[0-9]{1,4}(?:;[0-9]{0,4})*)?[0-9A-PRZcf-nqry=><@]";
+// Escape sequences are recognized per ECMA-48 (rather than by regex, which
+// was far too slow for megabytes of colored build and test output):
+//
+//    CSI:     ESC [ <parameters 0x30-0x3F>* <intermediates 0x20-0x2F>* <final 0x40-0x7E>
+//    strings: ESC ] (or P, X, ^, _) <text> terminated by BEL or ESC \
+//    others:  ESC <intermediates 0x20-0x2F>* <final 0x30-0x7E>
+//
+// Only 7-bit ESC introduced sequences are recognized: output is UTF-8, in
+// which the single byte (8-bit) CSI is a continuation byte.
+
+const char kEscape = '\x1b';
+const char kBell = '\x07';
+
+inline bool inRange(char ch, unsigned char lower, unsigned char upper)
+{
+   unsigned char uch = static_cast<unsigned char>(ch);
+   return uch >= lower && uch <= upper;
+}
+
+// find the next ESC (memchr is vectorized by the C library)
+inline const char* findEscape(const char* begin, const char* end)
+{
+   return static_cast<const char*>(std::memchr(begin, kEscape, end - begin));
+}
+
+// find the next BEL or ESC (either of which can terminate a string sequence)
+const char* findTerminator(const char* begin, const char* end)
+{
+   const char* it = begin;
+
+#if defined(__SSE2__)
+   // compare 16 bytes at a time
+   const __m128i escape = _mm_set1_epi8(kEscape);
+   const __m128i bell = _mm_set1_epi8(kBell);
+   for (; end - it >= 16; it += 16)
+   {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+      __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, escape),
+                                     _mm_cmpeq_epi8(chunk, bell));
+      int bits = _mm_movemask_epi8(matches);
+      if (bits != 0)
+         return it + __builtin_ctz(bits);
+   }
+#endif
+
+   for (; it < end; ++it)
+   {
+      if (*it == kEscape || *it == kBell)
+         return it;
+   }
+
+   return NULL;
+}
+
+// length of the escape sequence beginning with the ESC at 'it' (0 if it
+// isn't a complete, well-formed sequence)
+std::size_t sequenceLength(const char* it, const char* end, AnsiSpanType* pType)
+{
+   const char* pos = it + 1;
+   if (pos == end)
+      return 0;
+
+   char ch = *pos++;
+   if (ch == '[')
+   {
+      while (pos < end && inRange(*pos, 0x30, 0x3F))
+         ++pos;
+      while (pos < end && inRange(*pos, 0x20, 0x2F))
+         ++pos;
+      if (pos == end || !inRange(*pos, 0x40, 0x7E))
+         return 0;
 
-// Match xterm title sequence (followed by text, ended by BEL)
-const char* kXTermTitleMatch = "\\x1b]0;.*?\\x07";
+      *pType = AnsiSpanCsi;
+      return pos + 1 - it;
+   }
+   else if (ch == ']' || ch == 'P' || ch == 'X' || ch == '^' || ch == '_')
+   {
+      pos = findTerminator(pos, end);
+      if (pos == NULL)
+         return 0;
+
+      *pType = AnsiSpanString;
+      if (*pos == kBell)
+         return pos + 1 - it;
+      else if (pos + 1 < end && *(pos + 1) == '\\')
+         return pos + 2 - it;
+      else
+         return 0;
+   }
+   else
+   {
+      --pos;
+      while (pos < end && inRange(*pos, 0x20, 0x2F))
+         ++pos;
+      if (pos == end || !inRange(*pos, 0x30, 0x7E))
+         return 0;
+
+      *pType = AnsiSpanEscape;
+      return pos + 1 - it;
+   }
+}
+
+// find the next escape sequence at or after 'it'
+bool findSequence(const char* it,
+                  const char* end,
+                  const char** pSequence,
+                  std::size_t* pLength,
+                  AnsiSpanType* pType)
+{
+   while ((it = findEscape(it, end)) != NULL)
+   {
+      std::size_t length = sequenceLength(it, end, pType);
+      if (length > 0)
+      {
+         *pSequence = it;
+         *pLength = length;
+         return true;
+      }
+
+      // a lone ESC is left as text
+      ++it;
+   }
+
+   return false;
+}
 
 } // anonymous namespace
 
+void parseAnsiCodes(const std::string& str, std::vector<AnsiSpan>* pSpans)
+{
+   const char* begin = str.data();
+   const char* end = begin + str.size();
+
+   const char* it = begin;
+   const char* sequence;
+   std::size_t length;
+   AnsiSpanType type;
+   while (findSequence(it, end, &sequence, &length, &type))
+   {
+      if (sequence > it)
+         pSpans->push_back(AnsiSpan(AnsiSpanText, it - begin, sequence - it));
+      pSpans->push_back(AnsiSpan(type, sequence - begin, length));
+      it = sequence + length;
+   }
+
+   if (it < end)
+      pSpans->push_back(AnsiSpan(AnsiSpanText, it - begin, end - it));
+}
+
 void stripAnsiCodes(std::string* pStr)
 {
-   if (!pStr)
+   if (!pStr || pStr->empty())
       return;
 
-   std::string replacement;
-   *pStr = boost::regex_replace(*pStr, boost::regex(kAnsiMatch), replacement);
-   *pStr = boost::regex_replace(*pStr, boost::regex(kXTermTitleMatch), replacement);
+   // (take the mutable pointer first; it may unshare the string)
+   char* output = &(*pStr)[0];
+   const char* begin = output;
+   const char* end = begin + pStr->size();
+
+   // nothing to do for most output
+   const char* sequence;
+   std::size_t length;
+   AnsiSpanType type;
+   if (!findSequence(begin, end, &sequence, &length, &type))
+      return;
+
+   // compact the remaining text in place
+   char* out = output + (sequence - begin);
+   const char* it = sequence + length;
+   while (findSequence(it, end, &sequence, &length, &type))
+   {
+      std::memmove(out, it, sequence - it);
+      out += sequence - it;
+      it = sequence + length;
+   }
+
+   std::memmove(out, it, end - it);
+   out += end - it;
+   pStr->resize(out - output);
 }
 
 } // namespace text
@@ -0,0 +1,69 @@
+/*
+ * AnsiCodeParserBenchmarks.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/text/AnsiCodeParser.hpp>
+
+#include <string>
+#include <vector>
+
+#include <tests/Benchmark.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+
+namespace {
+
+// console output as styled by e.g. testthat or cli (colors, bold, a link)
+const std::string& styledOutput()
+{
+   static std::string output;
+   if (output.empty())
+   {
+      const char* const kLine =
+         "\x1b[32m\xe2\x9c\x94\x1b[39m | \x1b[1m  12\x1b[22m       | "
+         "\x1b]8;;file:///tmp/test-parse.R\x07parse\x1b]8;;\x07 "
+         "\x1b[36m[0.2 s]\x1b[39m plain text after the styles\n";
+      for (int i = 0; i < 500; i++)
+         output += kLine;
+   }
+   return output;
+}
+
+} // anonymous namespace
+
+BENCHMARK(AnsiCodeParser, parse)
+{
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      std::vector<AnsiSpan> spans;
+      parseAnsiCodes(styledOutput(), &spans);
+      tests::benchmark::doNotOptimize(spans.size());
+   }
+}
+
+BENCHMARK(AnsiCodeParser, strip)
+{
+   for (std::size_t i = 0; i < iterations; i++)
+   {
+      std::string output = styledOutput();
+      stripAnsiCodes(&output);
+      tests::benchmark::doNotOptimize(output.size());
+   }
+}
+
+} // namespace text
+} // namespace core
+} // namespace rstudio
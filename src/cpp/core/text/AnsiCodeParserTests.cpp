@@ -15,6 +15,13 @@
 
 #include <core/text/AnsiCodeParser.hpp>
 
+#include <iostream>
+
+#include <boost/regex.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/text/TermBufferParser.hpp>
+
 #include <tests/TestThat.hpp>
 
 namespace rstudio {
@@ -22,6 +29,42 @@ namespace core {
 namespace text {
 namespace tests {
 
+namespace {
+
+// the regex based implementation stripAnsiCodes replaced (for comparison)
+void regexStripAnsiCodes(std::string* pStr)
+{
+   static const boost::regex ansiMatch(
+      "[\\x1b\\x9b][[()#;?]*(?:[0-9]{1,4}(?:;[0-9]{0,4})*)?[0-9A-PRZcf-nqry=><@]");
+   static const boost::regex xtermTitleMatch("\\x1b]0;.*?\\x07");
+
+   std::string replacement;
+   *pStr = boost::regex_replace(*pStr, ansiMatch, replacement);
+   *pStr = boost::regex_replace(*pStr, xtermTitleMatch, replacement);
+}
+
+// colored output shaped like that of testthat / cli
+std::string benchmarkOutput()
+{
+   std::string output;
+   for (int i = 0; i < 20000; i++)
+   {
+      output += "\x1b[32m\xe2\x9c\x94\x1b[39m | ";
+      output += "\x1b[1m" + std::string(10 + i % 20, 'a' + i % 26) + "\x1b[22m";
+      output += " [\x1b[33m" + std::string(1, '0' + i % 10) + "\x1b[39m] ";
+      output += std::string(40, 'x') + "\n";
+   }
+   return output;
+}
+
+std::string stripped(std::string str)
+{
+   stripAnsiCodes(&str);
+   return str;
+}
+
+} // anonymous namespace
+
 context("Ansi Code Parsing")
 {
    test_that("Ansi stripping doesn't modify plain text")
@@ -41,6 +84,103 @@ context("Ansi Code Parsing")
 
       expect_true(expect == hasAnsi);
    }
+
+   test_that("Ansi stripping handles other escape sequences")
+   {
+      // cursor movement, private modes and character sets
+      expect_true(stripped("a\x1b[2Kb\x1b[?25lc\x1b[1;31;40md\x1b(Be\x1b=f") == "abcdef");
+
+      // terminal titles and hyperlinks
+      expect_true(stripped("\x1b]0;title\x07text") == "text");
+      expect_true(stripped("\x1b]8;;https://rstudio.com\x1b\\link\x1b]8;;\x1b\\") == "link");
+   }
+
+   test_that("Ansi stripping leaves incomplete sequences")
+   {
+      expect_true(stripped("abc\x1b") == "abc\x1b");
+      expect_true(stripped("abc\x1b[31") == "abc\x1b[31");
+      expect_true(stripped("\x1b]0;title") == "\x1b]0;title");
+      expect_true(stripped("\x1b\x1b[31mred") == "\x1bred");
+   }
+
+   test_that("Ansi stripping doesn't modify UTF-8 text")
+   {
+      // contains 0x9b (the 8-bit CSI) as a continuation byte
+      std::string expect("\xc4\x9b\x63 \xe2\x80\x9b");
+      expect_true(stripped(expect) == expect);
+   }
+
+   test_that("Ansi stripping agrees with the previous implementation")
+   {
+      std::string output = benchmarkOutput();
+      output = output.substr(0, output.find('\n', 10000) + 1);
+      std::string expect = output;
+      regexStripAnsiCodes(&expect);
+      expect_true(stripped(output) == expect);
+   }
+
+   test_that("Ansi codes can be parsed into spans")
+   {
+      std::string str("abc\x1b[31mred\x1b]0;title\x07\x1b" "7");
+      std::vector<AnsiSpan> spans;
+      parseAnsiCodes(str, &spans);
+
+      expect_true(spans.size() == 5);
+      expect_true(spans[0].type == AnsiSpanText);
+      expect_true(str.substr(spans[0].offset, spans[0].length) == "abc");
+      expect_true(spans[1].type == AnsiSpanCsi);
+      expect_true(str.substr(spans[1].offset, spans[1].length) == "\x1b[31m");
+      expect_true(spans[2].type == AnsiSpanText);
+      expect_true(str.substr(spans[2].offset, spans[2].length) == "red");
+      expect_true(spans[3].type == AnsiSpanString);
+      expect_true(str.substr(spans[3].offset, spans[3].length) == "\x1b]0;title\x07");
+      expect_true(spans[4].type == AnsiSpanEscape);
+      expect_true(str.substr(spans[4].offset, spans[4].length) == "\x1b" "7");
+   }
+}
+
+// run with: rstudio-tests "[benchmark]"
+TEST_CASE("Ansi Code Parsing Benchmark", "[.][benchmark]")
+{
+   using namespace boost::posix_time;
+
+   std::string output = benchmarkOutput();
+   const int kIterations = 10;
+
+   std::string parserResult;
+   ptime start = microsec_clock::universal_time();
+   for (int i = 0; i < kIterations; i++)
+   {
+      parserResult = output;
+      stripAnsiCodes(&parserResult);
+   }
+   time_duration parser = microsec_clock::universal_time() - start;
+
+   std::string regexResult;
+   start = microsec_clock::universal_time();
+   for (int i = 0; i < kIterations; i++)
+   {
+      regexResult = output;
+      regexStripAnsiCodes(&regexResult);
+   }
+   time_duration regex = microsec_clock::universal_time() - start;
+
+   start = microsec_clock::universal_time();
+   for (int i = 0; i < kIterations; i++)
+   {
+      bool altModeActive = false;
+      stripSecondaryBuffer(output, &altModeActive);
+   }
+   time_duration termBuffer = microsec_clock::universal_time() - start;
+
+   std::cout << "Ansi benchmark (" << output.size() / 1024 << " KB output, "
+             << kIterations << " iterations)" << std::endl
+             << "  strip: parser " << parser.total_milliseconds()
+             << " ms, regex " << regex.total_milliseconds() << " ms" << std::endl
+             << "  stripSecondaryBuffer: " << termBuffer.total_milliseconds()
+             << " ms" << std::endl;
+
+   CHECK(parserResult == regexResult);
 }
 
 } // end namespace tests
@@ -0,0 +1,454 @@
+/*
+ * CsvReader.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/text/CsvReader.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/SafeConvert.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+
+namespace {
+
+// chunks smaller than this aren't worth a thread
+const std::size_t kMinChunkSize = 1024 * 1024;
+
+const int kMaxThreads = 8;
+
+// values by column and row, as parsed from one chunk
+struct Chunk
+{
+   Chunk() : begin(NULL), end(NULL), quotes(0), rows(0) {}
+
+   const char* begin;
+   const char* end;
+   std::size_t quotes;
+
+   std::vector<std::vector<std::string> > columns;
+   std::size_t rows;
+};
+
+// parse the record beginning at 'pos' into 'pFields' (which is left empty
+// for blank lines); returns the start of the next record
+const char* parseRecord(const char* pos,
+                        const char* end,
+                        char delimiter,
+                        std::vector<std::string>* pFields)
+{
+   pFields->clear();
+
+   std::string field;
+   bool inQuote = false;
+   bool haveField = false;
+   while (pos < end)
+   {
+      if (inQuote)
+      {
+         // copy up to the next quote
+         const char* quote = static_cast<const char*>(
+                  std::memchr(pos, '"', end - pos));
+         if (quote == NULL)
+         {
+            field.append(pos, end);
+            pos = end;
+            break;
+         }
+
+         field.append(pos, quote);
+         pos = quote + 1;
+
+         // "" within quotes is a literal quote
+         if (pos < end && *pos == '"')
+         {
+            field.push_back('"');
+            ++pos;
+         }
+         else
+         {
+            inQuote = false;
+         }
+
+         continue;
+      }
+
+      // copy up to the next special character
+      const char* run = pos;
+      while (pos < end &&
+             *pos != delimiter && *pos != '"' && *pos != '\r' && *pos != '\n')
+      {
+         ++pos;
+      }
+
+      if (pos > run)
+      {
+         field.append(run, pos);
+         haveField = true;
+      }
+
+      if (pos == end)
+         break;
+
+      char ch = *pos++;
+      if (ch == '"')
+      {
+         inQuote = true;
+         haveField = true;
+      }
+      else if (ch == delimiter)
+      {
+         pFields->push_back(field);
+         field.clear();
+         haveField = true;
+      }
+      else if (ch == '\n')
+      {
+         break;
+      }
+
+      // '\r' is ignored
+   }
+
+   if (haveField)
+      pFields->push_back(field);
+
+   return pos;
+}
+
+// add a row of fields, padding so that all columns have a value per row
+void appendRow(std::vector<std::string>* pFields,
+               std::vector<std::vector<std::string> >* pColumns,
+               std::size_t* pRows)
+{
+   std::vector<std::vector<std::string> >& columns = *pColumns;
+   for (std::size_t i = 0; i < pFields->size(); i++)
+   {
+      if (i >= columns.size())
+         columns.push_back(std::vector<std::string>(*pRows));
+      columns[i].push_back(std::string());
+      columns[i].back().swap((*pFields)[i]);
+   }
+
+   ++*pRows;
+
+   for (std::size_t i = pFields->size(); i < columns.size(); i++)
+      columns[i].push_back(std::string());
+}
+
+void parseChunk(Chunk* pChunk, char delimiter, int maxRows)
+{
+   std::vector<std::string> fields;
+   const char* pos = pChunk->begin;
+   while (pos < pChunk->end &&
+          (maxRows < 0 || pChunk->rows < static_cast<std::size_t>(maxRows)))
+   {
+      pos = parseRecord(pos, pChunk->end, delimiter, &fields);
+      if (!fields.empty())
+         appendRow(&fields, &pChunk->columns, &pChunk->rows);
+   }
+}
+
+void countQuotes(Chunk* pChunk)
+{
+   pChunk->quotes = std::count(pChunk->begin, pChunk->end, '"');
+}
+
+// start of the first record at or after 'pos', given whether 'pos' is
+// within a quoted field
+const char* nextRecordStart(const char* pos, const char* end, bool inQuote)
+{
+   for (; pos < end; ++pos)
+   {
+      if (*pos == '"')
+         inQuote = !inQuote;
+      else if (*pos == '\n' && !inQuote)
+         return pos + 1;
+   }
+
+   return end;
+}
+
+// run the function for each chunk (the first on this thread)
+void forEachChunk(std::vector<Chunk>* pChunks,
+                  const boost::function<void(Chunk*)>& function)
+{
+   boost::thread_group threads;
+   for (std::size_t i = 1; i < pChunks->size(); i++)
+      threads.create_thread(boost::bind(function, &(*pChunks)[i]));
+
+   function(&(*pChunks)[0]);
+   threads.join_all();
+}
+
+void splitChunks(const char* begin,
+                 const char* end,
+                 int threads,
+                 std::vector<Chunk>* pChunks)
+{
+   std::size_t size = end - begin;
+   std::size_t count = std::max<std::size_t>(
+            1, std::min<std::size_t>(threads, size / kMinChunkSize));
+
+   pChunks->resize(count);
+   for (std::size_t i = 0; i < count; i++)
+   {
+      (*pChunks)[i].begin = begin + i * (size / count);
+      (*pChunks)[i].end = (i + 1 == count) ? end : begin + (i + 1) * (size / count);
+   }
+
+   if (count == 1)
+      return;
+
+   // a chunk begins within a quoted field if an odd number of quotes
+   // precede it; knowing that, move its start to the next record
+   forEachChunk(pChunks, countQuotes);
+
+   std::size_t quotes = 0;
+   for (std::size_t i = 1; i < count; i++)
+   {
+      Chunk& chunk = (*pChunks)[i];
+      quotes += (*pChunks)[i - 1].quotes;
+      chunk.begin = nextRecordStart(chunk.begin, end, quotes % 2 == 1);
+      chunk.begin = std::max(chunk.begin, (*pChunks)[i - 1].begin);
+      (*pChunks)[i - 1].end = chunk.begin;
+   }
+}
+
+bool isMissing(const std::string& value)
+{
+   return value.empty() || value == "NA";
+}
+
+bool isLogical(const std::string& value)
+{
+   return value == "TRUE" || value == "FALSE" ||
+          value == "T" || value == "F" ||
+          value == "True" || value == "False" ||
+          value == "true" || value == "false";
+}
+
+bool isInteger(const std::string& value)
+{
+   std::size_t i = (value[0] == '-' || value[0] == '+') ? 1 : 0;
+   if (i == value.size() || value.size() - i > 10)
+      return false;
+
+   for (std::size_t j = i; j < value.size(); j++)
+   {
+      if (value[j] < '0' || value[j] > '9')
+         return false;
+   }
+
+   // must fit in an R integer (whose minimum is reserved for NA)
+   long long number = std::atoll(value.c_str());
+   return number > -2147483647LL - 1 && number <= 2147483647LL;
+}
+
+bool isDouble(const std::string& value)
+{
+   // strtod would also accept leading whitespace and hex
+   if (::isspace(static_cast<unsigned char>(value[0])) ||
+       value.find_first_of("xX") != std::string::npos)
+   {
+      return false;
+   }
+
+   const char* begin = value.c_str();
+   char* end;
+   errno = 0;
+   std::strtod(begin, &end);
+   return end == begin + value.size() && errno != ERANGE;
+}
+
+bool isType(const std::string& value, CsvColumnType type)
+{
+   switch (type)
+   {
+   case CsvColumnLogical:   return isLogical(value);
+   case CsvColumnInteger:   return isInteger(value);
+   case CsvColumnDouble:    return isDouble(value);
+   case CsvColumnCharacter: return true;
+   }
+
+   return true;
+}
+
+// move the chunks' values into columns
+void mergeChunks(std::vector<Chunk>* pChunks, std::vector<CsvColumn>* pColumns)
+{
+   std::size_t columnCount = pColumns->size();
+   std::size_t rows = 0;
+   for (std::size_t i = 0; i < pChunks->size(); i++)
+   {
+      columnCount = std::max(columnCount, (*pChunks)[i].columns.size());
+      rows += (*pChunks)[i].rows;
+   }
+
+   pColumns->resize(columnCount);
+   for (std::size_t col = 0; col < columnCount; col++)
+   {
+      std::vector<std::string>& values = (*pColumns)[col].values;
+      values.reserve(rows);
+      for (std::size_t i = 0; i < pChunks->size(); i++)
+      {
+         Chunk& chunk = (*pChunks)[i];
+         if (col < chunk.columns.size())
+         {
+            std::vector<std::string>& chunkValues = chunk.columns[col];
+            for (std::size_t row = 0; row < chunkValues.size(); row++)
+            {
+               values.push_back(std::string());
+               values.back().swap(chunkValues[row]);
+            }
+            std::vector<std::string>().swap(chunkValues);
+         }
+         else
+         {
+            values.resize(values.size() + chunk.rows);
+         }
+      }
+   }
+}
+
+} // anonymous namespace
+
+std::string csvColumnTypeName(CsvColumnType type)
+{
+   switch (type)
+   {
+   case CsvColumnLogical:   return "logical";
+   case CsvColumnInteger:   return "integer";
+   case CsvColumnDouble:    return "double";
+   case CsvColumnCharacter: return "character";
+   }
+
+   return "character";
+}
+
+CsvColumnType guessCsvColumnType(const std::vector<std::string>& values)
+{
+   int type = CsvColumnLogical;
+   for (std::size_t i = 0; i < values.size(); i++)
+   {
+      const std::string& value = values[i];
+      if (isMissing(value))
+         continue;
+
+      while (!isType(value, static_cast<CsvColumnType>(type)))
+         ++type;
+
+      if (type == CsvColumnCharacter)
+         break;
+   }
+
+   return static_cast<CsvColumnType>(type);
+}
+
+void parseCsv(const char* begin,
+              const char* end,
+              const CsvReadOptions& options,
+              std::vector<CsvColumn>* pColumns)
+{
+   pColumns->clear();
+
+   // read the header
+   std::vector<std::string> names;
+   if (options.header)
+   {
+      while (begin < end && names.empty())
+         begin = parseRecord(begin, end, options.delimiter, &names);
+   }
+
+   pColumns->resize(names.size());
+
+   // limited reads are parsed here as they'll typically only need the
+   // beginning of the file
+   std::vector<Chunk> chunks;
+   if (options.maxRows >= 0)
+   {
+      chunks.resize(1);
+      chunks[0].begin = begin;
+      chunks[0].end = end;
+      parseChunk(&chunks[0], options.delimiter, options.maxRows);
+   }
+   else
+   {
+      int threads = options.threads;
+      if (threads <= 0)
+         threads = static_cast<int>(boost::thread::hardware_concurrency());
+      threads = std::max(1, std::min(threads, kMaxThreads));
+
+      splitChunks(begin, end, threads, &chunks);
+      forEachChunk(&chunks, boost::bind(parseChunk, _1, options.delimiter, -1));
+   }
+
+   mergeChunks(&chunks, pColumns);
+
+   for (std::size_t i = 0; i < pColumns->size(); i++)
+   {
+      CsvColumn& column = (*pColumns)[i];
+      column.name = i < names.size() ?
+               names[i] : "V" + safe_convert::numberToString(i + 1);
+      column.type = guessCsvColumnType(column.values);
+   }
+}
+
+Error readCsvFile(const FilePath& filePath,
+                  const CsvReadOptions& options,
+                  std::vector<CsvColumn>* pColumns)
+{
+   pColumns->clear();
+
+   if (!filePath.exists())
+      return fileNotFoundError(filePath, ERROR_LOCATION);
+
+   // empty files can't be mapped
+   if (filePath.size() == 0)
+      return Success();
+
+   boost::iostreams::mapped_file_source file;
+   try
+   {
+      file.open(filePath.absolutePathNative());
+   }
+   catch(const std::exception& e)
+   {
+      Error error = systemError(boost::system::errc::io_error,
+                                e.what(),
+                                ERROR_LOCATION);
+      error.addProperty("path", filePath);
+      return error;
+   }
+
+   parseCsv(file.data(), file.data() + file.size(), options, pColumns);
+   return Success();
+}
+
+} // namespace text
+} // namespace core
+} // namespace rstudio
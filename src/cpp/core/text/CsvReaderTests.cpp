@@ -0,0 +1,165 @@
+/*
+ * CsvReaderTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/text/CsvReader.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+namespace tests {
+
+namespace {
+
+std::vector<CsvColumn> parse(const std::string& csv,
+                             const CsvReadOptions& options = CsvReadOptions())
+{
+   std::vector<CsvColumn> columns;
+   parseCsv(csv.data(), csv.data() + csv.size(), options, &columns);
+   return columns;
+}
+
+std::vector<std::string> values(const char* first,
+                                const char* second,
+                                const char* third = NULL)
+{
+   std::vector<std::string> result;
+   result.push_back(first);
+   result.push_back(second);
+   if (third)
+      result.push_back(third);
+   return result;
+}
+
+// several megabytes of rows with quoted delimiters, quotes and line breaks
+std::string largeCsv()
+{
+   std::string csv = "id,name,value\n";
+   for (int i = 0; i < 100000; i++)
+   {
+      std::string id = safe_convert::numberToString(i);
+      csv += id + ",\"name, \"\"" + id + "\"\"\nline two\"," + id + ".5\r\n";
+   }
+   return csv;
+}
+
+} // anonymous namespace
+
+context("CsvReader")
+{
+   test_that("Headers and values are read into columns")
+   {
+      std::vector<CsvColumn> columns = parse("a,b\n1,x\n2,y\n");
+      expect_true(columns.size() == 2);
+      expect_true(columns[0].name == "a");
+      expect_true(columns[0].values == values("1", "2"));
+      expect_true(columns[1].name == "b");
+      expect_true(columns[1].values == values("x", "y"));
+   }
+
+   test_that("Quoted fields, blank lines and CRLF are handled")
+   {
+      std::vector<CsvColumn> columns =
+            parse("a,b\r\n\"1,2\",\"say \"\"hi\"\"\"\r\n\r\n3,\"two\nlines\"");
+      expect_true(columns[0].values == values("1,2", "3"));
+      expect_true(columns[1].values == values("say \"hi\"", "two\nlines"));
+   }
+
+   test_that("Ragged rows are padded")
+   {
+      std::vector<CsvColumn> columns = parse("a\n1,x\n2\n");
+      expect_true(columns.size() == 2);
+      expect_true(columns[1].name == "V2");
+      expect_true(columns[1].values == values("x", ""));
+   }
+
+   test_that("Other delimiters and files without headers can be read")
+   {
+      CsvReadOptions options;
+      options.delimiter = '\t';
+      options.header = false;
+      std::vector<CsvColumn> columns = parse("1\tx\n2\ty\n", options);
+      expect_true(columns[0].name == "V1");
+      expect_true(columns[0].values == values("1", "2"));
+   }
+
+   test_that("Limited reads stop after enough rows")
+   {
+      CsvReadOptions options;
+      options.maxRows = 2;
+      std::vector<CsvColumn> columns = parse("a\n1\n2\n3\n", options);
+      expect_true(columns[0].values == values("1", "2"));
+   }
+
+   test_that("Column types are guessed")
+   {
+      expect_true(guessCsvColumnType(values("TRUE", "NA", "F")) == CsvColumnLogical);
+      expect_true(guessCsvColumnType(values("1", "", "-20")) == CsvColumnInteger);
+      expect_true(guessCsvColumnType(values("1", "2.5", "1e10")) == CsvColumnDouble);
+      expect_true(guessCsvColumnType(values("1", "3000000000")) == CsvColumnDouble);
+      expect_true(guessCsvColumnType(values("1", "0x10")) == CsvColumnCharacter);
+      expect_true(guessCsvColumnType(values("1.5", "TRUE")) == CsvColumnCharacter);
+      expect_true(guessCsvColumnType(values("", "NA")) == CsvColumnLogical);
+   }
+
+   test_that("Parsing in parallel gives the same result as sequentially")
+   {
+      std::string csv = largeCsv();
+
+      CsvReadOptions sequential;
+      sequential.threads = 1;
+      std::vector<CsvColumn> expected = parse(csv, sequential);
+
+      CsvReadOptions parallel;
+      parallel.threads = 4;
+      std::vector<CsvColumn> columns = parse(csv, parallel);
+
+      expect_true(columns.size() == 3);
+      expect_true(columns[0].values.size() == 100000);
+      expect_true(columns[0].values == expected[0].values);
+      expect_true(columns[1].values == expected[1].values);
+      expect_true(columns[2].values == expected[2].values);
+      expect_true(columns[1].values[99999] == "name, \"99999\"\nline two");
+      expect_true(columns[0].type == CsvColumnInteger);
+      expect_true(columns[1].type == CsvColumnCharacter);
+      expect_true(columns[2].type == CsvColumnDouble);
+   }
+
+   test_that("Files are read")
+   {
+      FilePath filePath;
+      REQUIRE_FALSE(FilePath::tempFilePath(&filePath));
+      REQUIRE_FALSE(writeStringToFile(filePath, "a,b\n1,2\n"));
+
+      std::vector<CsvColumn> columns;
+      expect_false(readCsvFile(filePath, CsvReadOptions(), &columns));
+      expect_true(columns.size() == 2);
+      expect_true(columns[1].values[0] == "2");
+
+      REQUIRE_FALSE(filePath.remove());
+      expect_true(readCsvFile(filePath, CsvReadOptions(), &columns));
+   }
+}
+
+} // namespace tests
+} // namespace text
+} // namespace core
+} // namespace rstudio
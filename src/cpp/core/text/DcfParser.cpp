@@ -25,13 +25,12 @@
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
 #include <boost/algorithm/string/trim.hpp>
-#include <boost/algorithm/string/split.hpp>
 #include <boost/regex.hpp>
 
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
 #include <core/FileSerializer.hpp>
-#include <core/RegexUtils.hpp>
+#include <core/StringUtils.hpp>
 
 
 namespace rstudio {
@@ -40,29 +39,87 @@ namespace text {
 
 const char * const kDcfFieldRegex = "([^\\s]+?)\\s*\\:\\s*(.*)$";
 
+namespace {
+
+// the characters matched by \s (in kDcfFieldRegex)
+inline bool isDcfSpace(char ch)
+{
+   return ch == ' ' || ch == '\t' || ch == '\n' ||
+          ch == '\v' || ch == '\f' || ch == '\r';
+}
+
+bool isBlankLine(const std::string& contents,
+                 std::size_t begin,
+                 std::size_t end)
+{
+   for (std::size_t i = begin; i < end; i++)
+   {
+      if (!isDcfSpace(contents[i]))
+         return false;
+   }
+   return true;
+}
+
+// equivalent to matching the line against kDcfFieldRegex: the key is the
+// shortest run of non-space characters followed by optional space and a
+// colon, and the value is what follows the colon (less leading space)
+bool matchKeyValue(const std::string& contents,
+                   std::size_t begin,
+                   std::size_t end,
+                   std::size_t* pKeyEnd,
+                   std::size_t* pValueBegin)
+{
+   for (std::size_t keyEnd = begin + 1; keyEnd <= end; keyEnd++)
+   {
+      if (isDcfSpace(contents[keyEnd - 1]))
+         return false;
+
+      std::size_t pos = keyEnd;
+      while (pos < end && isDcfSpace(contents[pos]))
+         pos++;
+
+      if (pos < end && contents[pos] == ':')
+      {
+         pos++;
+         while (pos < end && isDcfSpace(contents[pos]))
+            pos++;
+
+         *pKeyEnd = keyEnd;
+         *pValueBegin = pos;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+} // anonymous namespace
+
 Error parseDcfFile(const std::string& dcfFileContents,
                    bool preserveKeyCase,
                    DcfFieldRecorder recordField,
                    std::string* pUserErrMsg)
 {
-   // split into lines
-   std::vector<std::string> dcfLines;
-   boost::algorithm::split(dcfLines,
-                           dcfFileContents,
-                           boost::algorithm::is_any_of("\n"));
-
-   // iterate over lines
+   // scan the lines in place (rather than splitting the contents or matching
+   // regexes), copying out only keys and values
+   const std::string& contents = dcfFileContents;
    int lineNumber = 0;
    std::string currentKey;
    std::string currentValue;
-   for(std::vector<std::string>::const_iterator it = dcfLines.begin();
-       it != dcfLines.end();
-       ++it)
+   for (std::size_t lineBegin = 0; ; )
    {
       lineNumber++;
 
+      std::size_t lineEnd = contents.find('\n', lineBegin);
+      bool lastLine = lineEnd == std::string::npos;
+      if (lastLine)
+         lineEnd = contents.size();
+      std::size_t nextLineBegin = lineEnd + 1;
+
+      std::size_t keyEnd, valueBegin;
+
       // report blank lines (so clients can see record delimiters)
-      if (it->empty() || boost::algorithm::trim_copy(*it).empty())
+      if (isBlankLine(contents, lineBegin, lineEnd))
       {
          // if we have a pending key & value then resolve it
          if (!currentKey.empty())
@@ -76,21 +133,15 @@ Error parseDcfFile(const std::string& dcfFileContents,
 
          if (!recordField(std::make_pair(std::string(), std::string())))
             return Success();
-
-         continue;
       }
 
       // skip comment lines
-      if (it->at(0) == '#')
-         continue;
-
-      // define regexes
-      boost::regex keyValueRegx(kDcfFieldRegex);
-      boost::regex continuationRegex("[\t\\s](.*)");
+      else if (contents[lineBegin] == '#')
+      {
+      }
 
-       // look for a key-value pair line
-      boost::smatch keyValueMatch, continuationMatch;
-      if (regex_utils::match(*it, keyValueMatch, keyValueRegx))
+      // look for a key-value pair line
+      else if (matchKeyValue(contents, lineBegin, lineEnd, &keyEnd, &valueBegin))
       {
          // if we have a pending key & value then resolve it
          if (!currentKey.empty())
@@ -103,18 +154,17 @@ Error parseDcfFile(const std::string& dcfFileContents,
          }
 
          // update the current key and value
-         currentKey = preserveKeyCase ?
-                                 keyValueMatch[1] :
-                                 string_utils::toLower(keyValueMatch[1]);
-         currentValue = keyValueMatch[2];
+         currentKey.assign(contents, lineBegin, keyEnd - lineBegin);
+         if (!preserveKeyCase)
+            currentKey = string_utils::toLower(currentKey);
+         currentValue.assign(contents, valueBegin, lineEnd - valueBegin);
       }
 
       // look for a continuation
-      else if (!currentKey.empty() &&
-               regex_utils::match(*it, continuationMatch, continuationRegex))
+      else if (!currentKey.empty() && isDcfSpace(contents[lineBegin]))
       {
          currentValue.append("\n");
-         currentValue.append(continuationMatch[1]);
+         currentValue.append(contents, lineBegin + 1, lineEnd - lineBegin - 1);
       }
 
       // invalid line
@@ -125,9 +175,14 @@ Error parseDcfFile(const std::string& dcfFileContents,
          boost::format fmt("file line number %1% is invalid");
          *pUserErrMsg = boost::str(fmt % lineNumber);
          error.addProperty("parse-error", *pUserErrMsg);
-         error.addProperty("line-contents", *it);
+         error.addProperty("line-contents",
+                           contents.substr(lineBegin, lineEnd - lineBegin));
          return error;
       }
+
+      if (lastLine)
+         break;
+      lineBegin = nextLineBegin;
    }
 
    // resolve any pending key and value
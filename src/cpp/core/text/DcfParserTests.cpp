@@ -0,0 +1,97 @@
+/*
+ * DcfParserTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/text/DcfParser.hpp>
+
+#include <map>
+#include <string>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/r_util/RPackageInfo.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+namespace tests {
+
+context("DcfParserTests")
+{
+   test_that("Fields and continuations are parsed")
+   {
+      std::map<std::string, std::string> fields;
+      std::string errMsg;
+      Error error = parseDcfFile("Package: foo\n"
+                                 "# a comment\n"
+                                 "URL : http://example.com\n"
+                                 "Description: A package\n"
+                                 "    that does things.\n",
+                                 true, &fields, &errMsg);
+      expect_false(error);
+      expect_true(fields.size() == 3);
+      expect_true(fields["Package"] == "foo");
+      expect_true(fields["URL"] == "http://example.com");
+      expect_true(fields["Description"] == "A package\n   that does things.");
+   }
+
+   test_that("Keys are lower cased unless their case is preserved")
+   {
+      std::map<std::string, std::string> fields;
+      std::string errMsg;
+      expect_false(parseDcfFile("Version: 1.0\n", false, &fields, &errMsg));
+      expect_true(fields["version"] == "1.0");
+   }
+
+   test_that("Invalid lines are reported")
+   {
+      std::map<std::string, std::string> fields;
+      std::string errMsg;
+      Error error = parseDcfFile("Package: foo\nnot a field\n",
+                                 true, &fields, &errMsg);
+      expect_true(error);
+      expect_true(errMsg == "file line number 2 is invalid");
+   }
+
+   test_that("Package info is re-read when DESCRIPTION changes")
+   {
+      FilePath packageDir;
+      FilePath::tempFilePath(&packageDir);
+      packageDir.ensureDirectory();
+      FilePath descFile = packageDir.complete("DESCRIPTION");
+
+      expect_false(writeStringToFile(descFile,
+                                     "Package: foo\nVersion: 1.0\n"));
+      r_util::RPackageInfo info;
+      expect_false(info.read(packageDir));
+      expect_true(info.version() == "1.0");
+
+      // (a different size, as the modification time may be unchanged)
+      expect_false(writeStringToFile(descFile,
+                                     "Package: foo\nVersion: 1.0.1\n"));
+      r_util::RPackageInfo updatedInfo;
+      expect_false(updatedInfo.read(packageDir));
+      expect_true(updatedInfo.version() == "1.0.1");
+
+      packageDir.remove();
+   }
+}
+
+} // namespace tests
+} // namespace text
+} // namespace core
+} // namespace rstudio
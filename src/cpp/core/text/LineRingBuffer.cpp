@@ -0,0 +1,109 @@
+/*
+ * LineRingBuffer.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/text/LineRingBuffer.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+
+LineRingBuffer::LineRingBuffer(int maxLines)
+   : maxLines_(maxLines), dataOffset_(0), start_(0)
+{
+}
+
+void LineRingBuffer::setMaxLines(int maxLines)
+{
+   maxLines_ = maxLines;
+}
+
+bool LineRingBuffer::append(const std::string& text)
+{
+   boost::uint64_t end = dataOffset_ + data_.size();
+   for (std::size_t pos = text.find('\n');
+        pos != std::string::npos;
+        pos = text.find('\n', pos + 1))
+   {
+      newlines_.push_back(end + pos);
+   }
+   data_.append(text);
+
+   return trim();
+}
+
+bool LineRingBuffer::assign(const std::string& text)
+{
+   clear();
+   return append(text);
+}
+
+void LineRingBuffer::clear()
+{
+   // release the storage (not just the text) as a cleared buffer is
+   // often one which is no longer needed
+   std::string().swap(data_);
+   std::deque<boost::uint64_t>().swap(newlines_);
+   dataOffset_ = 0;
+   start_ = 0;
+}
+
+std::size_t LineRingBuffer::size() const
+{
+   return static_cast<std::size_t>(dataOffset_ + data_.size() - start_);
+}
+
+std::string LineRingBuffer::str() const
+{
+   return data_.substr(static_cast<std::size_t>(start_ - dataOffset_));
+}
+
+std::string LineRingBuffer::substr(std::size_t pos, std::size_t length) const
+{
+   return data_.substr(static_cast<std::size_t>(start_ - dataOffset_) + pos,
+                       length);
+}
+
+bool LineRingBuffer::trim()
+{
+   if (maxLines_ < 1)
+      return false;
+
+   std::size_t maxLines = static_cast<std::size_t>(maxLines_);
+   if (newlines_.size() <= maxLines)
+      return false;
+
+   // keep the newline preceding the last maxLines lines
+   std::size_t first = newlines_.size() - maxLines - 1;
+   if (newlines_[first] == start_)
+      return false;
+
+   start_ = newlines_[first];
+   newlines_.erase(newlines_.begin(), newlines_.begin() + first);
+
+   // discard trimmed text once it's half the storage, so each character is
+   // moved at most a constant number of times on average
+   std::size_t trimmed = static_cast<std::size_t>(start_ - dataOffset_);
+   if (trimmed > data_.size() / 2)
+   {
+      data_.erase(0, trimmed);
+      dataOffset_ = start_;
+   }
+
+   return true;
+}
+
+} // namespace text
+} // namespace core
+} // namespace rstudio
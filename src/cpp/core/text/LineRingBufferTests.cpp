@@ -0,0 +1,91 @@
+/*
+ * LineRingBufferTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+
+#include <core/StringUtils.hpp>
+#include <core/text/LineRingBuffer.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+namespace tests {
+
+TEST_CASE("Line Ring Buffer")
+{
+   SECTION("Untrimmed buffer keeps everything")
+   {
+      LineRingBuffer buffer;
+      CHECK(buffer.empty());
+      CHECK(buffer.lineCount() == 1);
+
+      CHECK_FALSE(buffer.append("one\ntwo"));
+      CHECK_FALSE(buffer.append("\nthree\n"));
+      CHECK(buffer.str() == "one\ntwo\nthree\n");
+      CHECK(buffer.lineCount() == 4);
+      CHECK(buffer.substr(4, 3) == "two");
+   }
+
+   SECTION("Trimming keeps the newline before the last lines")
+   {
+      LineRingBuffer buffer(2);
+      buffer.append("aaaa\nbbbb\ncccc\n");
+      CHECK(buffer.str() == "\nbbbb\ncccc\n");
+      CHECK(buffer.lineCount() == 4);
+
+      CHECK_FALSE(buffer.append("dddd"));
+      CHECK(buffer.append("\n"));
+      CHECK(buffer.str() == "\ncccc\ndddd\n");
+      CHECK(buffer.substr(1, 4) == "cccc");
+   }
+
+   SECTION("Trimming as text arrives matches trimming it all at once")
+   {
+      const int maxLines = 5;
+      LineRingBuffer buffer(maxLines);
+      std::string all;
+      for (int i = 0; i < 1000; i++)
+      {
+         std::string line = boost::lexical_cast<std::string>(i);
+         line += std::string(i % 40, 'x');
+         line += (i % 3 == 0) ? "" : "\n";
+         buffer.append(line);
+         all += line;
+      }
+
+      string_utils::trimLeadingLines(maxLines, &all);
+      CHECK(buffer.str() == all);
+      CHECK(buffer.lineCount() == string_utils::countNewlines(all) + 1);
+   }
+
+   SECTION("Cleared buffer starts over")
+   {
+      LineRingBuffer buffer(1);
+      buffer.append("a\nb\nc\n");
+      buffer.clear();
+      CHECK(buffer.empty());
+      CHECK_FALSE(buffer.assign("x\ny"));
+      CHECK(buffer.str() == "x\ny");
+   }
+}
+
+} // end namespace tests
+} // end namespace text
+} // end namespace core
+} // end namespace rstudio
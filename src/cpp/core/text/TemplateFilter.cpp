@@ -16,6 +16,8 @@
 #include <core/text/TemplateFilter.hpp>
 
 #include <core/FilePath.hpp>
+#include <core/MappedFile.hpp>
+#include <core/collection/LruCache.hpp>
 
 #include <core/http/Request.hpp>
 #include <core/http/Response.hpp>
@@ -24,6 +26,155 @@ namespace rstudio {
 namespace core {
 namespace text {
 
+namespace {
+
+inline bool isVariableNameChar(char ch)
+{
+   return (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') ||
+          (ch >= '0' && ch <= '9') || ch == '_' || ch == '-';
+}
+
+// the compiled templates (with the mapped files they were compiled from)
+struct CachedTemplate
+{
+   boost::shared_ptr<const MappedFile> pFile;
+   boost::shared_ptr<const CompiledTemplate> pTemplate;
+};
+
+collection::LruCache<std::string, CachedTemplate>& templateCache()
+{
+   // (allocated so that it's never destroyed, as it may be used at exit)
+   static collection::LruCache<std::string, CachedTemplate>* pCache =
+         new collection::LruCache<std::string, CachedTemplate>(100);
+   return *pCache;
+}
+
+} // anonymous namespace
+
+std::string templateVariableValue(
+                  const std::map<std::string, std::string>& variables,
+                  const std::string& prefix,
+                  const std::string& name)
+{
+   std::map<std::string, std::string>::const_iterator valPos =
+                                                   variables.find(name);
+   if (valPos != variables.end())
+   {
+      if (prefix == "!")
+         return valPos->second;
+      else if (prefix == "'")
+         return string_utils::jsLiteralEscape(valPos->second);
+      else
+         return string_utils::htmlEscape(valPos->second, true);
+   }
+   else
+      return "MISSING VALUE";
+}
+
+CompiledTemplate::CompiledTemplate(const char* begin, const char* end)
+   : textSize_(0)
+{
+   compile(begin, end);
+}
+
+CompiledTemplate::CompiledTemplate(const std::string& text)
+   : textSize_(0)
+{
+   compile(text.data(), text.data() + text.size());
+}
+
+void CompiledTemplate::compile(const char* begin, const char* end)
+{
+   // find each #name#, #!name# and #'name# (as TemplateFilter's regex does)
+   const char* textBegin = begin;
+   for (const char* pos = begin; pos < end; pos++)
+   {
+      if (*pos != '#')
+         continue;
+
+      const char* nameBegin = pos + 1;
+      if (nameBegin < end && (*nameBegin == '!' || *nameBegin == '\''))
+         nameBegin++;
+
+      const char* nameEnd = nameBegin;
+      while (nameEnd < end && isVariableNameChar(*nameEnd))
+         nameEnd++;
+
+      if (nameEnd == nameBegin || nameEnd == end || *nameEnd != '#')
+         continue;
+
+      if (textBegin < pos)
+      {
+         Segment text;
+         text.text.assign(textBegin, pos);
+         text.variable = false;
+         segments_.push_back(text);
+         textSize_ += text.text.size();
+      }
+
+      Segment variable;
+      variable.text.assign(nameBegin, nameEnd);
+      variable.variable = true;
+      variable.prefix.assign(pos + 1, nameBegin);
+      segments_.push_back(variable);
+
+      pos = nameEnd;
+      textBegin = nameEnd + 1;
+   }
+
+   if (textBegin < end)
+   {
+      Segment text;
+      text.text.assign(textBegin, end);
+      text.variable = false;
+      segments_.push_back(text);
+      textSize_ += text.text.size();
+   }
+}
+
+std::string CompiledTemplate::render(
+               const std::map<std::string, std::string>& variables) const
+{
+   std::string rendered;
+   rendered.reserve(textSize_);
+   for (std::vector<Segment>::const_iterator it = segments_.begin();
+        it != segments_.end();
+        ++it)
+   {
+      if (it->variable)
+         rendered.append(templateVariableValue(variables, it->prefix, it->text));
+      else
+         rendered.append(it->text);
+   }
+   return rendered;
+}
+
+Error compiledTemplate(const FilePath& templateFile,
+                       boost::shared_ptr<const CompiledTemplate>* pTemplate)
+{
+   boost::shared_ptr<const MappedFile> pFile;
+   Error error = mappedResource(templateFile, &pFile);
+   if (error)
+      return error;
+
+   // the template is current if it was compiled from the current mapping
+   std::string key = templateFile.absolutePath();
+   CachedTemplate cached;
+   if (templateCache().get(key, &cached) && cached.pFile == pFile)
+   {
+      *pTemplate = cached.pTemplate;
+      return Success();
+   }
+
+   cached.pFile = pFile;
+   cached.pTemplate.reset(new CompiledTemplate(pFile->data(),
+                                               pFile->data() + pFile->size()));
+   templateCache().insert(key, cached);
+
+   *pTemplate = cached.pTemplate;
+   return Success();
+}
+
 void handleTemplateRequest(const FilePath& templatePath,
                            const http::Request& request,
                            http::Response* pResponse)
@@ -40,37 +191,57 @@ void handleTemplateRequest(const FilePath& templatePath,
 
    // return browser page (processing template)
    pResponse->setNoCacheHeaders();
-   text::TemplateFilter templateFilter(variables);
-   pResponse->setFile(templatePath, request, templateFilter);
+   setTemplateResponse(templatePath, variables, request, pResponse);
+}
+
+void setTemplateResponse(const FilePath& templatePath,
+                         const std::map<std::string, std::string>& variables,
+                         const http::Request& request,
+                         http::Response* pResponse)
+{
+   if (!templatePath.exists())
+   {
+      pResponse->setNotFoundError(request);
+      return;
+   }
+
+   boost::shared_ptr<const CompiledTemplate> pTemplate;
+   Error error = compiledTemplate(templatePath, &pTemplate);
+   if (error)
+   {
+      pResponse->setError(http::status::InternalServerError,
+                          error.code().message());
+      return;
+   }
+
    pResponse->setContentType("text/html");
+   pResponse->negotiateContentEncoding(request);
 
+   bool padding = browser_utils::isQt(request.headerValue("User-Agent"));
+   std::istringstream is(pTemplate->render(variables));
+   http::NullOutputFilter nullFilter;
+   error = pResponse->setBody(is, nullFilter, 4096, padding);
+   if (error)
+      pResponse->setError(http::status::InternalServerError,
+                          error.code().message());
 }
 
 Error renderTemplate(const core::FilePath& templateFile,
                      const std::map<std::string, std::string> &vars,
                      std::ostream& os)
 {
-   // open input stream to template
-   boost::shared_ptr<std::istream> pIfs;
-   Error error = templateFile.open_r(&pIfs);
+   boost::shared_ptr<const CompiledTemplate> pTemplate;
+   Error error = compiledTemplate(templateFile, &pTemplate);
    if (error)
       return error;
 
    try
    {
-      // ensure that errors are reported with exceptions (compatible
-      // with behavior of boost::iostreams::copy)
-      pIfs->exceptions(std::istream::failbit | std::istream::badbit);
+      // ensure that errors are reported with exceptions (as they were
+      // when the template was copied through a TemplateFilter)
       os.exceptions(std::istream::failbit | std::istream::badbit);
 
-      // create a filtered stream w/ the template filter and std::ostream
-      boost::iostreams::filtering_ostream filteredStream ;
-      text::TemplateFilter templateFilter(vars);
-      filteredStream.push(templateFilter);
-      filteredStream.push(os);
-
-      // process the template
-      boost::iostreams::copy(*pIfs, filteredStream, 128);
+      os << pTemplate->render(vars);
    }
    catch(const std::exception& e)
    {
@@ -0,0 +1,100 @@
+/*
+ * TemplateFilterTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/text/TemplateFilter.hpp>
+
+#include <sstream>
+
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+namespace tests {
+
+namespace {
+
+std::string filter(const std::string& text,
+                   const std::map<std::string, std::string>& variables)
+{
+   std::istringstream is(text);
+   std::ostringstream os;
+   boost::iostreams::filtering_ostream filteredStream;
+   filteredStream.push(TemplateFilter(variables));
+   filteredStream.push(os);
+   boost::iostreams::copy(is, filteredStream);
+   return os.str();
+}
+
+} // anonymous namespace
+
+context("TemplateFilterTests")
+{
+   std::map<std::string, std::string> variables;
+   variables["title"] = "<R & me>";
+   variables["js-name"] = "it's";
+   variables["count_1"] = "3";
+
+   test_that("Compiled templates render as the template filter does")
+   {
+      const char* templates[] = {
+         "",
+         "no variables",
+         "<h1>#title#</h1>",
+         "#!title# and #'js-name# and #count_1#",
+         "#missing# #title",
+         "## # #x y# ##title## #!# #'#",
+         "#title##title#"
+      };
+
+      for (std::size_t i = 0; i < sizeof(templates) / sizeof(char*); i++)
+      {
+         std::string text(templates[i]);
+         expect_true(CompiledTemplate(text).render(variables) ==
+                     filter(text, variables));
+      }
+   }
+
+   test_that("Template files are recompiled when they change")
+   {
+      FilePath templatePath;
+      FilePath::tempFilePath(&templatePath);
+
+      expect_false(writeStringToFile(templatePath, "<p>#count_1#</p>"));
+      std::ostringstream os;
+      expect_false(renderTemplate(templatePath, variables, os));
+      expect_true(os.str() == "<p>3</p>");
+
+      // (a different size, as the modification time may be unchanged)
+      expect_false(writeStringToFile(templatePath, "<div>#count_1#</div>"));
+      std::ostringstream updatedOs;
+      expect_false(renderTemplate(templatePath, variables, updatedOs));
+      expect_true(updatedOs.str() == "<div>3</div>");
+
+      templatePath.remove();
+   }
+}
+
+} // namespace tests
+} // namespace text
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,711 @@
+/*
+ * TrigramIndex.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/text/TrigramIndex.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+
+namespace {
+
+const char * const kIndexFileHeader = "RSTUDIO-TRIGRAM-INDEX-1\n";
+
+// compact once tombstoned files outnumber live ones (and there are
+// enough of them to be worth the effort)
+const std::size_t kMinCompactCount = 1024;
+
+inline unsigned char foldCase(unsigned char ch)
+{
+   if (ch >= 'A' && ch <= 'Z')
+      return ch + ('a' - 'A');
+   return ch;
+}
+
+inline boost::uint32_t makeTrigram(unsigned char a,
+                                   unsigned char b,
+                                   unsigned char c)
+{
+   return (static_cast<boost::uint32_t>(foldCase(a)) << 16) |
+          (static_cast<boost::uint32_t>(foldCase(b)) << 8) |
+          static_cast<boost::uint32_t>(foldCase(c));
+}
+
+void extractTrigrams(const std::string& text,
+                     std::vector<boost::uint32_t>* pTrigrams)
+{
+   pTrigrams->clear();
+   if (text.size() < 3)
+      return;
+
+   pTrigrams->reserve(text.size() - 2);
+   for (std::size_t i = 0; i + 2 < text.size(); i++)
+   {
+      pTrigrams->push_back(makeTrigram(text[i], text[i + 1], text[i + 2]));
+   }
+
+   std::sort(pTrigrams->begin(), pTrigrams->end());
+   pTrigrams->erase(std::unique(pTrigrams->begin(), pTrigrams->end()),
+                    pTrigrams->end());
+}
+
+template <typename T>
+void writeValue(std::ostream& os, T value)
+{
+   os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& is, T* pValue)
+{
+   is.read(reinterpret_cast<char*>(pValue), sizeof(T));
+   return is.good();
+}
+
+void writeVarint(std::ostream& os, boost::uint32_t value)
+{
+   while (value >= 0x80)
+   {
+      os.put(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+   }
+   os.put(static_cast<char>(value));
+}
+
+bool readVarint(std::istream& is, boost::uint32_t* pValue)
+{
+   boost::uint32_t value = 0;
+   for (int shift = 0; shift < 35; shift += 7)
+   {
+      int ch = is.get();
+      if (ch == EOF)
+         return false;
+
+      value |= static_cast<boost::uint32_t>(ch & 0x7F) << shift;
+      if ((ch & 0x80) == 0)
+      {
+         *pValue = value;
+         return true;
+      }
+   }
+   return false;
+}
+
+bool shorterList(const std::vector<boost::uint32_t>* pLhs,
+                 const std::vector<boost::uint32_t>* pRhs)
+{
+   return pLhs->size() < pRhs->size();
+}
+
+Error indexFileError(const std::string& description,
+                     const FilePath& filePath,
+                     const ErrorLocation& location)
+{
+   Error error = systemError(boost::system::errc::io_error, location);
+   error.addProperty("description", description);
+   error.addProperty("path", filePath.absolutePath());
+   return error;
+}
+
+void appendLiteral(std::string* pCurrent, std::vector<std::string>* pLiterals)
+{
+   if (!pCurrent->empty())
+   {
+      pLiterals->push_back(*pCurrent);
+      pCurrent->clear();
+   }
+}
+
+void dropLastAndAppendLiteral(std::string* pCurrent,
+                              std::vector<std::string>* pLiterals)
+{
+   if (!pCurrent->empty())
+      pCurrent->erase(pCurrent->size() - 1);
+   appendLiteral(pCurrent, pLiterals);
+}
+
+bool regexLiterals(const std::string& pattern,
+                   std::vector<std::string>* pLiterals)
+{
+   std::string current;
+   int depth = 0;
+
+   for (std::size_t i = 0; i < pattern.size(); i++)
+   {
+      char ch = pattern[i];
+      switch (ch)
+      {
+      case '|':
+         return false;
+
+      case '\\':
+      {
+         if (i + 1 == pattern.size())
+         {
+            appendLiteral(&current, pLiterals);
+            break;
+         }
+
+         char next = pattern[++i];
+         if (next == '|')
+            return false;
+         else if (next == '(')
+         {
+            appendLiteral(&current, pLiterals);
+            depth++;
+         }
+         else if (next == ')')
+         {
+            appendLiteral(&current, pLiterals);
+            depth = std::max(depth - 1, 0);
+         }
+         else if (next == '?')
+         {
+            // optional quantifier in basic syntax
+            dropLastAndAppendLiteral(&current, pLiterals);
+         }
+         else if (next == '{')
+         {
+            // interval in basic syntax (we don't bother parsing it, so
+            // treat the preceding character as optional)
+            dropLastAndAppendLiteral(&current, pLiterals);
+            std::size_t pos = pattern.find("\\}", i);
+            if (pos != std::string::npos)
+               i = pos + 1;
+         }
+         else if (std::isalnum(static_cast<unsigned char>(next)) ||
+                  std::strchr("<>`'+}", next) != NULL)
+         {
+            // character classes, anchors, back references, etc.
+            appendLiteral(&current, pLiterals);
+         }
+         else if (depth == 0)
+         {
+            // escaped punctuation matches itself
+            current.push_back(next);
+         }
+         break;
+      }
+
+      case '[':
+      {
+         appendLiteral(&current, pLiterals);
+
+         // skip the bracket expression (a ']' immediately following the
+         // opening bracket or a negation is part of the set)
+         std::size_t pos = i + 1;
+         if (pos < pattern.size() && pattern[pos] == '^')
+            pos++;
+         if (pos < pattern.size() && pattern[pos] == ']')
+            pos++;
+         pos = pattern.find(']', pos);
+         if (pos == std::string::npos)
+            return false;
+         i = pos;
+         break;
+      }
+
+      case '*':
+      case '?':
+         dropLastAndAppendLiteral(&current, pLiterals);
+         break;
+
+      case '{':
+      {
+         dropLastAndAppendLiteral(&current, pLiterals);
+         std::size_t pos = pattern.find('}', i);
+         if (pos != std::string::npos)
+            i = pos;
+         break;
+      }
+
+      case '(':
+         appendLiteral(&current, pLiterals);
+         depth++;
+         break;
+
+      case ')':
+         appendLiteral(&current, pLiterals);
+         depth = std::max(depth - 1, 0);
+         break;
+
+      case '+':
+      case '.':
+      case '^':
+      case '$':
+         appendLiteral(&current, pLiterals);
+         break;
+
+      default:
+         // text within groups may be optional or repeated so we ignore it
+         if (depth == 0)
+            current.push_back(ch);
+         else
+            appendLiteral(&current, pLiterals);
+         break;
+      }
+   }
+
+   appendLiteral(&current, pLiterals);
+   return true;
+}
+
+} // anonymous namespace
+
+const std::size_t TrigramIndex::kMaxIndexedFileSize = 4 * 1024 * 1024;
+
+TrigramIndex::TrigramIndex()
+   : deadCount_(0)
+{
+}
+
+void TrigramIndex::update(const std::string& path,
+                          std::time_t lastWriteTime,
+                          const std::string& contents)
+{
+   if (contents.size() > kMaxIndexedFileSize)
+   {
+      updateUnindexed(path, lastWriteTime);
+      return;
+   }
+
+   FileId id = addEntry(path, lastWriteTime, true);
+
+   // binary files are never reported by our searches so they are
+   // recorded without any postings
+   if (contents.find('\0') != std::string::npos)
+      return;
+
+   // ids are allocated in increasing order so appending keeps the
+   // postings sorted
+   std::vector<Trigram> trigrams;
+   extractTrigrams(contents, &trigrams);
+   BOOST_FOREACH(Trigram trigram, trigrams)
+   {
+      postings_[trigram].push_back(id);
+   }
+}
+
+void TrigramIndex::updateUnindexed(const std::string& path,
+                                   std::time_t lastWriteTime)
+{
+   addEntry(path, lastWriteTime, false);
+}
+
+void TrigramIndex::remove(const std::string& path)
+{
+   std::map<std::string, FileId>::iterator it = ids_.find(path);
+   if (it == ids_.end())
+      return;
+
+   files_[it->second].live = false;
+   deadCount_++;
+   ids_.erase(it);
+
+   maybeCompact();
+}
+
+void TrigramIndex::clear()
+{
+   files_.clear();
+   ids_.clear();
+   postings_.clear();
+   deadCount_ = 0;
+}
+
+bool TrigramIndex::isCurrent(const std::string& path,
+                             std::time_t lastWriteTime) const
+{
+   std::map<std::string, FileId>::const_iterator it = ids_.find(path);
+   if (it == ids_.end())
+      return false;
+
+   return files_[it->second].lastWriteTime == lastWriteTime;
+}
+
+void TrigramIndex::paths(std::vector<std::string>* pPaths) const
+{
+   pPaths->clear();
+   pPaths->reserve(ids_.size());
+   for (std::map<std::string, FileId>::const_iterator it = ids_.begin();
+        it != ids_.end();
+        ++it)
+   {
+      pPaths->push_back(it->first);
+   }
+}
+
+bool TrigramIndex::candidates(const std::vector<std::string>& literals,
+                              std::vector<std::string>* pPaths) const
+{
+   pPaths->clear();
+
+   std::vector<Trigram> trigrams;
+   BOOST_FOREACH(const std::string& literal, literals)
+   {
+      std::vector<Trigram> literalTrigrams;
+      extractTrigrams(literal, &literalTrigrams);
+      trigrams.insert(trigrams.end(),
+                      literalTrigrams.begin(),
+                      literalTrigrams.end());
+   }
+
+   if (trigrams.empty())
+      return false;
+
+   std::sort(trigrams.begin(), trigrams.end());
+   trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                  trigrams.end());
+
+   // collect the posting lists, shortest first so that the intersection
+   // shrinks as quickly as possible
+   std::vector<const std::vector<FileId>*> lists;
+   BOOST_FOREACH(Trigram trigram, trigrams)
+   {
+      boost::unordered_map<Trigram, std::vector<FileId> >::const_iterator it =
+                                                      postings_.find(trigram);
+      if (it == postings_.end())
+      {
+         lists.clear();
+         break;
+      }
+      lists.push_back(&it->second);
+   }
+
+   std::vector<FileId> matches;
+   if (!lists.empty())
+   {
+      std::sort(lists.begin(), lists.end(), shorterList);
+
+      matches = *lists[0];
+      for (std::size_t i = 1; i < lists.size() && !matches.empty(); i++)
+      {
+         std::vector<FileId> intersection;
+         std::set_intersection(matches.begin(), matches.end(),
+                               lists[i]->begin(), lists[i]->end(),
+                               std::back_inserter(intersection));
+         matches.swap(intersection);
+      }
+   }
+
+   BOOST_FOREACH(FileId id, matches)
+   {
+      if (files_[id].live)
+         pPaths->push_back(files_[id].path);
+   }
+
+   // files we couldn't index may contain anything
+   BOOST_FOREACH(const FileEntry& entry, files_)
+   {
+      if (entry.live && !entry.indexed)
+         pPaths->push_back(entry.path);
+   }
+
+   return true;
+}
+
+void TrigramIndex::compact()
+{
+   if (deadCount_ == 0)
+      return;
+
+   // renumber the live files (preserving their order, so that the
+   // postings remain sorted)
+   const FileId kRemoved = static_cast<FileId>(-1);
+   std::vector<FileId> remap(files_.size(), kRemoved);
+   std::vector<FileEntry> files;
+   files.reserve(ids_.size());
+   for (std::size_t i = 0; i < files_.size(); i++)
+   {
+      if (files_[i].live)
+      {
+         remap[i] = static_cast<FileId>(files.size());
+         files.push_back(files_[i]);
+      }
+   }
+
+   boost::unordered_map<Trigram, std::vector<FileId> >::iterator it =
+                                                            postings_.begin();
+   while (it != postings_.end())
+   {
+      std::vector<FileId>& ids = it->second;
+      std::size_t count = 0;
+      for (std::size_t i = 0; i < ids.size(); i++)
+      {
+         FileId newId = remap[ids[i]];
+         if (newId != kRemoved)
+            ids[count++] = newId;
+      }
+      ids.resize(count);
+
+      if (ids.empty())
+         it = postings_.erase(it);
+      else
+         ++it;
+   }
+
+   for (std::map<std::string, FileId>::iterator idIt = ids_.begin();
+        idIt != ids_.end();
+        ++idIt)
+   {
+      idIt->second = remap[idIt->second];
+   }
+
+   files_.swap(files);
+   deadCount_ = 0;
+}
+
+Error TrigramIndex::writeToFile(const FilePath& filePath) const
+{
+   // renumber the live files as we write (as compact() would)
+   const FileId kRemoved = static_cast<FileId>(-1);
+   std::vector<FileId> remap(files_.size(), kRemoved);
+   FileId liveCount = 0;
+   for (std::size_t i = 0; i < files_.size(); i++)
+   {
+      if (files_[i].live)
+         remap[i] = liveCount++;
+   }
+
+   boost::shared_ptr<std::ostream> pStream;
+   Error error = filePath.open_w(&pStream);
+   if (error)
+      return error;
+
+   std::ostream& os = *pStream;
+   os.write(kIndexFileHeader, std::strlen(kIndexFileHeader));
+
+   writeValue<boost::uint32_t>(os, liveCount);
+   BOOST_FOREACH(const FileEntry& entry, files_)
+   {
+      if (!entry.live)
+         continue;
+
+      writeValue<boost::uint32_t>(os, static_cast<boost::uint32_t>(
+                                                      entry.path.size()));
+      os.write(entry.path.data(), entry.path.size());
+      writeValue<boost::int64_t>(os, static_cast<boost::int64_t>(
+                                                      entry.lastWriteTime));
+      writeValue<boost::uint8_t>(os, entry.indexed ? 1 : 0);
+   }
+
+   writeValue<boost::uint32_t>(os, static_cast<boost::uint32_t>(
+                                                      postings_.size()));
+   std::vector<FileId> ids;
+   for (boost::unordered_map<Trigram, std::vector<FileId> >::const_iterator
+           it = postings_.begin(); it != postings_.end(); ++it)
+   {
+      ids.clear();
+      BOOST_FOREACH(FileId id, it->second)
+      {
+         if (remap[id] != kRemoved)
+            ids.push_back(remap[id]);
+      }
+
+      writeValue<boost::uint32_t>(os, it->first);
+      writeVarint(os, static_cast<boost::uint32_t>(ids.size()));
+
+      // ids are sorted so we write the deltas
+      FileId previous = 0;
+      BOOST_FOREACH(FileId id, ids)
+      {
+         writeVarint(os, id - previous);
+         previous = id;
+      }
+   }
+
+   os.flush();
+   if (!os.good())
+      return indexFileError("Error writing index", filePath, ERROR_LOCATION);
+
+   return Success();
+}
+
+Error TrigramIndex::readFromFile(const FilePath& filePath)
+{
+   clear();
+
+   boost::shared_ptr<std::istream> pStream;
+   Error error = filePath.open_r(&pStream);
+   if (error)
+      return error;
+
+   std::istream& is = *pStream;
+
+   std::string header(std::strlen(kIndexFileHeader), '\0');
+   is.read(&header[0], header.size());
+   if (!is.good() || header != kIndexFileHeader)
+      return indexFileError("Invalid index header", filePath, ERROR_LOCATION);
+
+   boost::uint32_t fileCount = 0;
+   if (!readValue(is, &fileCount))
+      return indexFileError("Invalid index", filePath, ERROR_LOCATION);
+
+   for (boost::uint32_t i = 0; i < fileCount; i++)
+   {
+      boost::uint32_t pathSize = 0;
+      boost::int64_t lastWriteTime = 0;
+      boost::uint8_t indexed = 0;
+
+      if (!readValue(is, &pathSize) || pathSize > 65536)
+      {
+         clear();
+         return indexFileError("Invalid index entry", filePath, ERROR_LOCATION);
+      }
+
+      std::string path(pathSize, '\0');
+      if (pathSize > 0)
+         is.read(&path[0], pathSize);
+
+      if (!readValue(is, &lastWriteTime) || !readValue(is, &indexed))
+      {
+         clear();
+         return indexFileError("Invalid index entry", filePath, ERROR_LOCATION);
+      }
+
+      addEntry(path, static_cast<std::time_t>(lastWriteTime), indexed != 0);
+   }
+
+   boost::uint32_t postingsCount = 0;
+   if (!readValue(is, &postingsCount))
+   {
+      clear();
+      return indexFileError("Invalid index postings", filePath, ERROR_LOCATION);
+   }
+
+   for (boost::uint32_t i = 0; i < postingsCount; i++)
+   {
+      Trigram trigram = 0;
+      boost::uint32_t count = 0;
+      if (!readValue(is, &trigram) || !readVarint(is, &count) ||
+          count > files_.size())
+      {
+         clear();
+         return indexFileError("Invalid index postings",
+                               filePath,
+                               ERROR_LOCATION);
+      }
+
+      std::vector<FileId>& ids = postings_[trigram];
+      ids.reserve(count);
+      FileId id = 0;
+      for (boost::uint32_t j = 0; j < count; j++)
+      {
+         boost::uint32_t delta = 0;
+         if (!readVarint(is, &delta) || id + delta >= files_.size())
+         {
+            clear();
+            return indexFileError("Invalid index postings",
+                                  filePath,
+                                  ERROR_LOCATION);
+         }
+         id += delta;
+         ids.push_back(id);
+      }
+   }
+
+   return Success();
+}
+
+TrigramIndex::FileId TrigramIndex::addEntry(const std::string& path,
+                                            std::time_t lastWriteTime,
+                                            bool indexed)
+{
+   // tombstone any existing entry for the file
+   std::map<std::string, FileId>::iterator it = ids_.find(path);
+   if (it != ids_.end())
+   {
+      files_[it->second].live = false;
+      deadCount_++;
+   }
+
+   maybeCompact();
+
+   FileId id = static_cast<FileId>(files_.size());
+   files_.push_back(FileEntry(path, lastWriteTime, indexed));
+   ids_[path] = id;
+   return id;
+}
+
+void TrigramIndex::maybeCompact()
+{
+   if (deadCount_ >= kMinCompactCount && deadCount_ > ids_.size())
+      compact();
+}
+
+bool requiredLiterals(const std::string& term,
+                      bool asRegex,
+                      bool ignoreCase,
+                      std::vector<std::string>* pLiterals)
+{
+   pLiterals->clear();
+
+   // multiple lines are treated as multiple (alternative) patterns
+   if (term.empty() || term.find('\n') != std::string::npos)
+      return false;
+
+   std::vector<std::string> literals;
+   if (asRegex)
+   {
+      if (!regexLiterals(term, &literals))
+         return false;
+   }
+   else
+   {
+      literals.push_back(term);
+   }
+
+   BOOST_FOREACH(const std::string& literal, literals)
+   {
+      // case insensitive matching of non-ASCII text isn't something we
+      // can fold, so split those literals around such characters
+      std::string current;
+      for (std::size_t i = 0; i < literal.size(); i++)
+      {
+         unsigned char ch = literal[i];
+         if (ignoreCase && ch >= 0x80)
+         {
+            if (current.size() >= 3)
+               pLiterals->push_back(current);
+            current.clear();
+         }
+         else
+         {
+            current.push_back(ch);
+         }
+      }
+
+      if (current.size() >= 3)
+         pLiterals->push_back(current);
+   }
+
+   return !pLiterals->empty();
+}
+
+} // namespace text
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,164 @@
+/*
+ * TrigramIndexTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/text/TrigramIndex.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+namespace tests {
+
+namespace {
+
+std::vector<std::string> candidatesFor(const TrigramIndex& index,
+                                       const std::string& term,
+                                       bool asRegex = false,
+                                       bool ignoreCase = false)
+{
+   std::vector<std::string> literals;
+   std::vector<std::string> paths;
+   if (requiredLiterals(term, asRegex, ignoreCase, &literals))
+      index.candidates(literals, &paths);
+   std::sort(paths.begin(), paths.end());
+   return paths;
+}
+
+bool literalsFor(const std::string& pattern, std::vector<std::string>* pLiterals)
+{
+   return requiredLiterals(pattern, true, false, pLiterals);
+}
+
+} // anonymous namespace
+
+context("TrigramIndexTests")
+{
+   test_that("Candidates contain all literal trigrams")
+   {
+      TrigramIndex index;
+      index.update("/a.R", 1, "library(shiny)\nrunApp()");
+      index.update("/b.R", 1, "x <- SHINY");
+      index.update("/c.R", 1, "plot(x)");
+
+      std::vector<std::string> paths = candidatesFor(index, "shiny");
+      REQUIRE(paths.size() == 2);
+      CHECK(paths[0] == "/a.R");
+      CHECK(paths[1] == "/b.R");
+
+      CHECK(candidatesFor(index, "runApp").size() == 1);
+      CHECK(candidatesFor(index, "ggplot").empty());
+   }
+
+   test_that("Updated and removed files are reflected")
+   {
+      TrigramIndex index;
+      index.update("/a.R", 1, "alpha");
+      index.update("/b.R", 1, "alpha beta");
+
+      index.update("/a.R", 2, "gamma");
+      CHECK(index.isCurrent("/a.R", 2));
+      CHECK_FALSE(index.isCurrent("/a.R", 1));
+      CHECK(candidatesFor(index, "alpha").size() == 1);
+      CHECK(candidatesFor(index, "gamma").size() == 1);
+
+      index.remove("/b.R");
+      CHECK(index.size() == 1);
+      CHECK(candidatesFor(index, "alpha").empty());
+
+      index.compact();
+      CHECK(candidatesFor(index, "gamma").size() == 1);
+   }
+
+   test_that("Unindexed files are always candidates and binary files never are")
+   {
+      TrigramIndex index;
+      index.updateUnindexed("/big.csv", 1);
+      index.update("/data.rds", 1, std::string("needle\0", 7));
+
+      std::vector<std::string> paths = candidatesFor(index, "needle");
+      REQUIRE(paths.size() == 1);
+      CHECK(paths[0] == "/big.csv");
+   }
+
+   test_that("Required literals are extracted conservatively from regexes")
+   {
+      std::vector<std::string> literals;
+
+      CHECK(literalsFor("foo.*bar", &literals));
+      REQUIRE(literals.size() == 2);
+      CHECK(literals[0] == "foo");
+      CHECK(literals[1] == "bar");
+
+      // quantified characters are optional
+      CHECK(literalsFor("colou?r", &literals));
+      REQUIRE(literals.size() == 1);
+      CHECK(literals[0] == "colo");
+
+      // groups and bracket expressions are skipped
+      CHECK(literalsFor("read(_csv)?[0-9]+\\.table", &literals));
+      REQUIRE(literals.size() == 2);
+      CHECK(literals[0] == "read");
+      CHECK(literals[1] == ".table");
+
+      CHECK(literalsFor("abcd\\{10,20\\}", &literals));
+      REQUIRE(literals.size() == 1);
+      CHECK(literals[0] == "abc");
+
+      // alternation can't be narrowed
+      CHECK_FALSE(literalsFor("foo|bar", &literals));
+      CHECK_FALSE(literalsFor("foo\\|bar", &literals));
+      CHECK_FALSE(literalsFor("[a-z]*", &literals));
+   }
+
+   test_that("Index can be written and read back")
+   {
+      TrigramIndex index;
+      index.update("/a.R", 10, "library(dplyr)");
+      index.update("/b.R", 20, "library(tidyr)");
+      index.remove("/a.R");
+      index.update("/c.R", 30, "dplyr::filter");
+      index.updateUnindexed("/d.R", 40);
+
+      FilePath indexPath;
+      REQUIRE_FALSE(FilePath::tempFilePath(&indexPath));
+      REQUIRE_FALSE(index.writeToFile(indexPath));
+
+      TrigramIndex readIndex;
+      REQUIRE_FALSE(readIndex.readFromFile(indexPath));
+      indexPath.removeIfExists();
+
+      CHECK(readIndex.size() == 3);
+      CHECK(readIndex.isCurrent("/b.R", 20));
+      CHECK(readIndex.isCurrent("/c.R", 30));
+      CHECK_FALSE(readIndex.isCurrent("/a.R", 10));
+
+      std::vector<std::string> paths = candidatesFor(readIndex, "dplyr");
+      REQUIRE(paths.size() == 2);
+      CHECK(paths[0] == "/c.R");
+      CHECK(paths[1] == "/d.R");
+   }
+}
+
+} // end namespace tests
+} // end namespace text
+} // end namespace core
+} // end namespace rstudio
@@ -0,0 +1,369 @@
+/*
+ * WordIndex.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/text/WordIndex.hpp>
+
+#include <algorithm>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/foreach.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+
+namespace {
+
+// compact once tombstoned documents outnumber live ones (and there are
+// enough of them to be worth the effort)
+const std::size_t kMinCompactCount = 1024;
+
+// words matched exactly score higher than those matched by prefix
+const int kExactMatchFactor = 2;
+
+inline bool isWordChar(unsigned char ch)
+{
+   return (ch >= 'a' && ch <= 'z') ||
+          (ch >= 'A' && ch <= 'Z') ||
+          (ch >= '0' && ch <= '9') ||
+          ch == '.' || ch == '_' ||
+          ch >= 0x80; // treat (utf-8) non-ascii characters as letters
+}
+
+inline bool isPartSeparator(char ch)
+{
+   return ch == '.' || ch == '_';
+}
+
+inline char foldCase(char ch)
+{
+   if (ch >= 'A' && ch <= 'Z')
+      return ch + ('a' - 'A');
+   return ch;
+}
+
+struct Word
+{
+   Word(const std::string& text, bool atEnd) : text(text), atEnd(atEnd) {}
+
+   std::string text;
+
+   // does the word run up to the end of the text (i.e. could it be the
+   // prefix of a word the user is still typing)
+   bool atEnd;
+};
+
+void addWord(const std::string& word, bool atEnd, std::vector<Word>* pWords)
+{
+   if (!word.empty())
+      pWords->push_back(Word(word, atEnd));
+}
+
+void splitWords(const std::string& text, std::vector<Word>* pWords)
+{
+   std::size_t i = 0;
+   while (i < text.size())
+   {
+      if (!isWordChar(text[i]))
+      {
+         i++;
+         continue;
+      }
+
+      std::size_t begin = i;
+      while (i < text.size() && isWordChar(text[i]))
+         i++;
+      bool atEnd = i == text.size();
+
+      // trim leading and trailing separators (e.g. the full stop ending
+      // a sentence)
+      std::size_t end = i;
+      while (begin < end && isPartSeparator(text[begin]))
+         begin++;
+      while (end > begin && isPartSeparator(text[end - 1]))
+      {
+         end--;
+         atEnd = false;
+      }
+      if (begin == end)
+         continue;
+
+      std::string word;
+      word.reserve(end - begin);
+      for (std::size_t j = begin; j < end; j++)
+         word.push_back(foldCase(text[j]));
+      addWord(word, atEnd, pWords);
+
+      // add the parts of compound words
+      if (word.find_first_of("._") != std::string::npos)
+      {
+         std::string part;
+         for (std::size_t j = 0; j < word.size(); j++)
+         {
+            if (isPartSeparator(word[j]))
+            {
+               addWord(part, false, pWords);
+               part.clear();
+            }
+            else
+            {
+               part.push_back(word[j]);
+            }
+         }
+         addWord(part, atEnd, pWords);
+      }
+   }
+}
+
+bool compareMatches(const WordIndex::Match& a, const WordIndex::Match& b)
+{
+   if (a.score != b.score)
+      return a.score > b.score;
+   if (a.group != b.group)
+      return a.group < b.group;
+   return a.key < b.key;
+}
+
+} // anonymous namespace
+
+WordIndex::WordIndex()
+   : deadCount_(0)
+{
+}
+
+void WordIndex::add(const std::string& group,
+                    const std::string& key,
+                    const std::vector<Field>& fields)
+{
+   DocId id = static_cast<DocId>(docs_.size());
+   docs_.push_back(Document(group, key));
+   groups_[group].push_back(id);
+
+   std::vector<Word> words;
+   BOOST_FOREACH(const Field& field, fields)
+   {
+      words.clear();
+      splitWords(field.first, &words);
+      BOOST_FOREACH(const Word& word, words)
+      {
+         // documents are added in order so any existing posting for this
+         // document is the last one
+         std::vector<Posting>& postings = postings_[word.text];
+         if (!postings.empty() && postings.back().doc == id)
+            postings.back().weight = std::max(postings.back().weight,
+                                              field.second);
+         else
+            postings.push_back(Posting(id, field.second));
+      }
+   }
+}
+
+void WordIndex::removeGroup(const std::string& group)
+{
+   std::map<std::string, std::vector<DocId> >::iterator it =
+                                                   groups_.find(group);
+   if (it == groups_.end())
+      return;
+
+   BOOST_FOREACH(DocId id, it->second)
+   {
+      docs_[id].live = false;
+      deadCount_++;
+   }
+   groups_.erase(it);
+
+   maybeCompact();
+}
+
+bool WordIndex::hasGroup(const std::string& group) const
+{
+   return groups_.find(group) != groups_.end();
+}
+
+void WordIndex::groups(std::vector<std::string>* pGroups) const
+{
+   pGroups->clear();
+   for (std::map<std::string, std::vector<DocId> >::const_iterator it =
+            groups_.begin();
+        it != groups_.end();
+        ++it)
+   {
+      pGroups->push_back(it->first);
+   }
+}
+
+void WordIndex::clear()
+{
+   docs_.clear();
+   groups_.clear();
+   postings_.clear();
+   deadCount_ = 0;
+}
+
+void WordIndex::search(const std::string& query,
+                       std::size_t maxMatches,
+                       std::vector<Match>* pMatches) const
+{
+   pMatches->clear();
+
+   std::vector<Word> words;
+   splitWords(query, &words);
+   if (words.empty())
+      return;
+
+   // score each document by the best field each word was found in, keeping
+   // only the documents which contain every word
+   std::map<DocId, int> scores;
+   for (std::size_t i = 0; i < words.size(); i++)
+   {
+      const Word& word = words[i];
+      std::map<DocId, int> wordScores;
+
+      Postings::const_iterator it = postings_.lower_bound(word.text);
+      for (; it != postings_.end(); ++it)
+      {
+         bool exact = it->first == word.text;
+         if (!exact &&
+             (!word.atEnd || !boost::algorithm::starts_with(it->first, word.text)))
+         {
+            break;
+         }
+
+         int factor = exact ? kExactMatchFactor : 1;
+         BOOST_FOREACH(const Posting& posting, it->second)
+         {
+            if (!docs_[posting.doc].live)
+               continue;
+
+            int& score = wordScores[posting.doc];
+            score = std::max(score, posting.weight * factor);
+         }
+      }
+
+      if (i == 0)
+      {
+         scores.swap(wordScores);
+      }
+      else
+      {
+         std::map<DocId, int> intersection;
+         for (std::map<DocId, int>::const_iterator sit = scores.begin();
+              sit != scores.end();
+              ++sit)
+         {
+            std::map<DocId, int>::const_iterator wit =
+                                             wordScores.find(sit->first);
+            if (wit != wordScores.end())
+               intersection[sit->first] = sit->second + wit->second;
+         }
+         scores.swap(intersection);
+      }
+
+      if (scores.empty())
+         return;
+   }
+
+   pMatches->reserve(scores.size());
+   for (std::map<DocId, int>::const_iterator it = scores.begin();
+        it != scores.end();
+        ++it)
+   {
+      const Document& doc = docs_[it->first];
+      pMatches->push_back(Match(doc.group, doc.key, it->second));
+   }
+
+   std::size_t count = std::min(maxMatches, pMatches->size());
+   std::partial_sort(pMatches->begin(),
+                     pMatches->begin() + count,
+                     pMatches->end(),
+                     compareMatches);
+   pMatches->erase(pMatches->begin() + count, pMatches->end());
+}
+
+void WordIndex::compact()
+{
+   if (deadCount_ == 0)
+      return;
+
+   // renumber the live documents
+   std::vector<DocId> newIds(docs_.size());
+   std::vector<Document> docs;
+   docs.reserve(docs_.size() - deadCount_);
+   for (std::size_t i = 0; i < docs_.size(); i++)
+   {
+      if (!docs_[i].live)
+         continue;
+
+      newIds[i] = static_cast<DocId>(docs.size());
+      docs.push_back(docs_[i]);
+   }
+
+   for (std::map<std::string, std::vector<DocId> >::iterator it =
+            groups_.begin();
+        it != groups_.end();
+        ++it)
+   {
+      BOOST_FOREACH(DocId& id, it->second)
+      {
+         id = newIds[id];
+      }
+   }
+
+   Postings::iterator it = postings_.begin();
+   while (it != postings_.end())
+   {
+      std::vector<Posting> postings;
+      BOOST_FOREACH(const Posting& posting, it->second)
+      {
+         if (docs_[posting.doc].live)
+            postings.push_back(Posting(newIds[posting.doc], posting.weight));
+      }
+
+      if (postings.empty())
+      {
+         postings_.erase(it++);
+      }
+      else
+      {
+         it->second.swap(postings);
+         ++it;
+      }
+   }
+
+   docs_.swap(docs);
+   deadCount_ = 0;
+}
+
+void WordIndex::maybeCompact()
+{
+   if (deadCount_ >= kMinCompactCount && deadCount_ > docs_.size() / 2)
+      compact();
+}
+
+void indexWords(const std::string& text, std::vector<std::string>* pWords)
+{
+   std::vector<Word> words;
+   splitWords(text, &words);
+
+   pWords->clear();
+   BOOST_FOREACH(const Word& word, words)
+   {
+      pWords->push_back(word.text);
+   }
+}
+
+} // namespace text
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,165 @@
+/*
+ * WordIndexTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include <core/text/WordIndex.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace text {
+namespace tests {
+
+namespace {
+
+std::vector<WordIndex::Field> fields(const std::string& alias,
+                                     const std::string& title)
+{
+   std::vector<WordIndex::Field> fields;
+   fields.push_back(WordIndex::Field(alias, 8));
+   fields.push_back(WordIndex::Field(title, 4));
+   return fields;
+}
+
+std::vector<std::string> keysFor(const WordIndex& index,
+                                 const std::string& query,
+                                 std::size_t maxMatches = 100)
+{
+   std::vector<WordIndex::Match> matches;
+   index.search(query, maxMatches, &matches);
+
+   std::vector<std::string> keys;
+   for (std::size_t i = 0; i < matches.size(); i++)
+      keys.push_back(matches[i].group + "::" + matches[i].key);
+   return keys;
+}
+
+} // anonymous namespace
+
+context("WordIndexTests")
+{
+   test_that("Words are case folded and compound words are split")
+   {
+      std::vector<std::string> words;
+      indexWords("Read a CSV file: read.csv().", &words);
+
+      std::vector<std::string> expected;
+      expected.push_back("read");
+      expected.push_back("a");
+      expected.push_back("csv");
+      expected.push_back("file");
+      expected.push_back("read.csv");
+      expected.push_back("read");
+      expected.push_back("csv");
+      expect_true(words == expected);
+   }
+
+   test_that("Searches match documents containing every word")
+   {
+      WordIndex index;
+      index.add("utils", "read.table", fields("read.csv read.table",
+                                              "Data Input"));
+      index.add("base", "readLines", fields("readLines",
+                                            "Read Text Lines from a Connection"));
+      index.add("stats", "lm", fields("lm", "Fitting Linear Models"));
+
+      expect_true(keysFor(index, "linear models") ==
+                  std::vector<std::string>(1, "stats::lm"));
+      expect_true(keysFor(index, "LINEAR").size() == 1);
+      expect_true(keysFor(index, "linear data").empty());
+      expect_true(keysFor(index, "").empty());
+   }
+
+   test_that("The last word of a query matches by prefix")
+   {
+      WordIndex index;
+      index.add("utils", "read.table", fields("read.csv read.table",
+                                              "Data Input"));
+      index.add("base", "readLines", fields("readLines", "Read Text Lines"));
+
+      expect_true(keysFor(index, "read.cs") ==
+                  std::vector<std::string>(1, "utils::read.table"));
+      expect_true(keysFor(index, "readl") ==
+                  std::vector<std::string>(1, "base::readLines"));
+
+      // only the last word is a prefix
+      expect_true(keysFor(index, "rea lines").empty());
+      expect_true(keysFor(index, "readl ").empty());
+   }
+
+   test_that("Matches are ranked by field weight and exactness")
+   {
+      WordIndex index;
+      index.add("pkg", "title", fields("other", "plot"));
+      index.add("pkg", "alias", fields("plot", "other"));
+      index.add("pkg", "prefix", fields("plotly", "other"));
+
+      std::vector<std::string> keys = keysFor(index, "plot");
+      expect_true(keys.size() == 3);
+      expect_true(keys[0] == "pkg::alias");
+      expect_true(keys[1] == "pkg::prefix");
+      expect_true(keys[2] == "pkg::title");
+
+      expect_true(keysFor(index, "plot", 1) ==
+                  std::vector<std::string>(1, "pkg::alias"));
+   }
+
+   test_that("Removed groups are no longer matched")
+   {
+      WordIndex index;
+      index.add("a", "x", fields("shared", ""));
+      index.add("b", "y", fields("shared", ""));
+
+      index.removeGroup("a");
+      expect_false(index.hasGroup("a"));
+      expect_true(index.hasGroup("b"));
+      expect_true(index.size() == 1);
+      expect_true(keysFor(index, "shared") ==
+                  std::vector<std::string>(1, "b::y"));
+
+      // re-adding a group replaces its documents
+      index.add("a", "z", fields("shared", ""));
+      expect_true(keysFor(index, "shared").size() == 2);
+   }
+
+   test_that("Compaction preserves live documents")
+   {
+      WordIndex index;
+      for (int i = 0; i < 2000; i++)
+      {
+         std::string group = "g" + boost::lexical_cast<std::string>(i);
+         index.add(group, "doc", fields("common", group));
+      }
+      for (int i = 0; i < 1500; i++)
+         index.removeGroup("g" + boost::lexical_cast<std::string>(i));
+
+      index.compact();
+      expect_true(index.size() == 500);
+      expect_true(keysFor(index, "common", 1000).size() == 500);
+      expect_true(keysFor(index, "g1999") ==
+                  std::vector<std::string>(1, "g1999::doc"));
+      expect_true(keysFor(index, "g0").empty());
+   }
+}
+
+} // namespace tests
+} // namespace text
+} // namespace core
+} // namespace rstudio
@@ -17,6 +17,7 @@
 #include <QDebug>
 #include <QPushButton>
 #include <QQuickWindow>
+#include <QWebEnginePage>
 
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
@@ -526,6 +527,16 @@ int main(int argc, char* argv[])
       initializeWorkingDirectory(argc, argv, filename);
       initializeStartupEnvironment(&filename);
 
+      // start the web engine now (launching its processes takes a while) so
+      // that it's ready by the time the session is
+      if (!desktop::options().runDiagnostics())
+      {
+         auto* pWarmupPage = new QWebEnginePage(pApp.get());
+         QObject::connect(pWarmupPage, &QWebEnginePage::loadFinished,
+                          pWarmupPage, &QObject::deleteLater);
+         pWarmupPage->load(QUrl(QStringLiteral("about:blank")));
+      }
+
       Options& options = desktop::options();
       if (!prepareEnvironment(options))
          return 1;
@@ -314,6 +314,26 @@ void Options::setRBinDir(QString path)
 
 #endif
 
+#ifndef _WIN32
+QString Options::rEnvironmentKey() const
+{
+   return settings_.value(QStringLiteral("REnvironment/key")).toString();
+}
+
+QStringList Options::rEnvironment() const
+{
+   return settings_.value(QStringLiteral("REnvironment/vars"),
+                          QStringList()).toStringList();
+}
+
+void Options::setREnvironment(const QString& key,
+                              const QStringList& environment)
+{
+   settings_.setValue(QStringLiteral("REnvironment/key"), key);
+   settings_.setValue(QStringLiteral("REnvironment/vars"), environment);
+}
+#endif
+
 FilePath Options::scriptsPath() const
 {
    return scriptsPath_;
@@ -78,6 +78,14 @@ public:
    void setRBinDir(QString path);
 #endif
 
+#ifndef _WIN32
+   // the R environment found at the last launch, along with a key describing
+   // what it was found from (so it can be reused while that's unchanged)
+   QString rEnvironmentKey() const;
+   QStringList rEnvironment() const;
+   void setREnvironment(const QString& key, const QStringList& environment);
+#endif
+
    // Resolves to 'desktop' sub-directory in development builds.
    // Resolves to 'bin' directory in release builds.
    core::FilePath scriptsPath() const;
@@ -15,10 +15,14 @@
 
 #include "DesktopDetectRHome.hpp"
 
+#include <boost/bind.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
+#include <QEventLoop>
 #include <QMessageBox>
 
+#include <core/SafeConvert.hpp>
+#include <core/Thread.hpp>
 #include <core/system/System.hpp>
 #include <core/system/Environment.hpp>
 #include <core/r_util/REnvironment.hpp>
@@ -40,6 +44,103 @@ void showRNotFoundError(const std::string& msg)
                   QString::fromUtf8(msg.c_str()), QString());
 }
 
+// what the R environment is found from (other than the R script itself)
+QString rEnvironmentKey(const FilePath& rWhichRPath,
+                        const FilePath& rLdScriptPath)
+{
+   QStringList key;
+   key << QString::fromStdString(rWhichRPath.absolutePath())
+       << QString::fromStdString(rLdScriptPath.absolutePath())
+       << QString::fromStdString(core::system::getenv("PATH"))
+       << QString::fromStdString(core::system::getenv("LD_LIBRARY_PATH"))
+       << QString::fromStdString(
+                     core::system::getenv("DYLD_FALLBACK_LIBRARY_PATH"));
+   return key.join(QStringLiteral("\n"));
+}
+
+std::string scriptWriteTime(const std::string& rScriptPath)
+{
+   return safe_convert::numberToString(FilePath(rScriptPath).lastWriteTime());
+}
+
+// the cached environment is the R script path, its modification time (the
+// script is rewritten when R is reinstalled or upgraded) and then the
+// environment variables as NAME=value
+QStringList toCachedEnvironment(const std::string& rScriptPath,
+                                const r_util::EnvironmentVars& vars)
+{
+   QStringList cached;
+   cached << QString::fromStdString(rScriptPath)
+          << QString::fromStdString(scriptWriteTime(rScriptPath));
+   for (const auto& var : vars)
+   {
+      cached << QString::fromStdString(var.first + "=" + var.second);
+   }
+   return cached;
+}
+
+bool fromCachedEnvironment(const QStringList& cached,
+                           std::string* pRScriptPath,
+                           r_util::EnvironmentVars* pVars)
+{
+   if (cached.size() < 2)
+      return false;
+
+   std::string rScriptPath = cached[0].toStdString();
+   if (!FilePath(rScriptPath).exists() ||
+       scriptWriteTime(rScriptPath) != cached[1].toStdString())
+   {
+      return false;
+   }
+
+   r_util::EnvironmentVars vars;
+   for (int i = 2; i < cached.size(); i++)
+   {
+      std::string var = cached[i].toStdString();
+      std::string::size_type pos = var.find('=');
+      if (pos == std::string::npos)
+         return false;
+      vars.push_back(std::make_pair(var.substr(0, pos), var.substr(pos + 1)));
+   }
+
+   // R must still be where we found it
+   for (const auto& var : vars)
+   {
+      if (var.first == "R_HOME" && !FilePath(var.second).exists())
+         return false;
+   }
+
+   *pRScriptPath = rScriptPath;
+   *pVars = vars;
+   return true;
+}
+
+struct Detection
+{
+   Detection() : success(false) {}
+
+   bool success;
+   std::string rScriptPath;
+   std::string rVersion;
+   r_util::EnvironmentVars rEnvVars;
+   std::string errMsg;
+};
+
+void runDetection(const FilePath& rWhichRPath,
+                  const FilePath& rLdScriptPath,
+                  Detection* pDetection,
+                  QEventLoop* pLoop)
+{
+   pDetection->success = r_util::detectREnvironment(rWhichRPath,
+                                                    rLdScriptPath,
+                                                    std::string(),
+                                                    &pDetection->rScriptPath,
+                                                    &pDetection->rVersion,
+                                                    &pDetection->rEnvVars,
+                                                    &pDetection->errMsg);
+   QMetaObject::invokeMethod(pLoop, "quit", Qt::QueuedConnection);
+}
+
 } // anonymous namespace
 
 bool prepareEnvironment(Options& options)
@@ -67,20 +168,47 @@ bool prepareEnvironment(Options& options)
    if (!rLdScriptPath.exists())
       rLdScriptPath = supportingFilePath.complete("session/r-ldpath");
 #endif
-   // attempt to detect R environment
-   std::string rScriptPath, rVersion, errMsg;
+   // reuse the R environment we found last time if nothing it was found
+   // from has changed (finding it means running R)
+   QString key = rEnvironmentKey(rWhichRPath, rLdScriptPath);
+   std::string rScriptPath;
    r_util::EnvironmentVars rEnvVars;
-   bool success = r_util::detectREnvironment(rWhichRPath,
-                                             rLdScriptPath,
-                                             std::string(),
-                                             &rScriptPath,
-                                             &rVersion,
-                                             &rEnvVars,
-                                             &errMsg);
-   if (!success)
+   bool cached = key == options.rEnvironmentKey() &&
+                 fromCachedEnvironment(options.rEnvironment(),
+                                       &rScriptPath,
+                                       &rEnvVars);
+   if (!cached)
    {
-      showRNotFoundError(errMsg);
-      return false;
+      // attempt to detect R environment (on a thread, so that we keep
+      // processing events, e.g. for the web engine as it starts)
+      Detection detection;
+      QEventLoop loop;
+      boost::thread thread;
+      core::thread::safeLaunchThread(boost::bind(runDetection,
+                                                 rWhichRPath,
+                                                 rLdScriptPath,
+                                                 &detection,
+                                                 &loop),
+                                     &thread);
+      if (thread.joinable())
+      {
+         loop.exec();
+         thread.join();
+      }
+      else
+      {
+         runDetection(rWhichRPath, rLdScriptPath, &detection, &loop);
+      }
+
+      if (!detection.success)
+      {
+         showRNotFoundError(detection.errMsg);
+         return false;
+      }
+
+      rScriptPath = detection.rScriptPath;
+      rEnvVars = detection.rEnvVars;
+      options.setREnvironment(key, toCachedEnvironment(rScriptPath, rEnvVars));
    }
 
    if (desktop::options().runDiagnostics())
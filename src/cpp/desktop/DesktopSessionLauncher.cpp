@@ -19,11 +19,6 @@
 
 #include <boost/bind.hpp>
 
-#include <core/http/Request.hpp>
-#include <core/http/Response.hpp>
-#include <core/http/TcpIpBlockingClient.hpp>
-
-#include <core/WaitUtils.hpp>
 #include <core/FileSerializer.hpp>
 #include <core/system/Environment.hpp>
 #include <core/system/ParentProcessMonitor.hpp>
@@ -170,7 +165,7 @@ Error SessionLauncher::launchFirstSession()
       pMainWindow_->show();
       desktop::activation().setMainWindow(pMainWindow_);
       pAppLaunch_->activateWindow();
-      pMainWindow_->loadUrl(url);
+      loadUrlWhenReady(url);
    }
    qApp->setQuitOnLastWindowClosed(true);
    return Success();
@@ -261,27 +256,6 @@ void SessionLauncher::onRSessionExited(int, QProcess::ExitStatus)
    }
 }
 
-namespace {
-
-core::WaitResult serverReady(const std::string& host, const std::string& port)
-{
-   core::http::Request request;
-   request.setMethod("GET");
-   request.setHost("host");
-   request.setUri("/");
-   request.setHeader("Accept", "*/*");
-   request.setHeader("Connection", "close");
-   
-   core::http::Response response;
-   Error error = core::http::sendRequest(host, port, request, &response);
-   if (error)
-      return WaitResult(WaitContinue, Success());
-   else
-      return WaitResult(WaitSuccess, Success());
-}
-
-} // end anonymous namespace
-
 Error SessionLauncher::launchNextSession(bool reload)
 {
    // unset the initial project environment variable it this doesn't
@@ -321,24 +295,46 @@ Error SessionLauncher::launchNextSession(bool reload)
                          this, SLOT(onRSessionExited(int,QProcess::ExitStatus)));
 
    if (reload)
-   {
-      Error error = core::waitWithTimeout(
-               boost::bind(serverReady, host.toStdString(), port.toStdString()),
-               50,
-               25,
-               10);
-      if (error)
-         LOG_ERROR(error);
-      
-      nextSessionUrl_ = url;
-      QTimer::singleShot(0, this, SLOT(onReloadFrameForNextSession()));
-   }
+      loadUrlWhenReady(url);
 
    return Success();
 }
 
+void SessionLauncher::loadUrlWhenReady(const QUrl& url)
+{
+   // the session writes a line to stdout once it's listening; we give up
+   // waiting for it (and load anyway) after 10 seconds
+   nextSessionUrl_ = url;
+   connect(pRSessionProcess_, SIGNAL(readyReadStandardOutput()),
+           this, SLOT(onRSessionOutput()));
+   sessionReadyTimer_.start(10000);
+}
+
+void SessionLauncher::onRSessionOutput()
+{
+   auto* pProcess = qobject_cast<QProcess*>(sender());
+   if (pProcess == nullptr)
+      return;
+
+   while (pProcess->canReadLine())
+   {
+      QByteArray line = pProcess->readLine().trimmed();
+      if (line == kRStudioSessionReady)
+      {
+         pProcess->disconnect(SIGNAL(readyReadStandardOutput()),
+                              this, SLOT(onRSessionOutput()));
+         onReloadFrameForNextSession();
+         return;
+      }
+   }
+}
+
 void SessionLauncher::onReloadFrameForNextSession()
 {
+   sessionReadyTimer_.stop();
+   if (nextSessionUrl_.isEmpty())
+      return;
+
    pMainWindow_->loadUrl(nextSessionUrl_);
    nextSessionUrl_.clear();
 }
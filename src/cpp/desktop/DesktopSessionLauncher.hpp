@@ -20,6 +20,8 @@
 
 #include <boost/utility.hpp>
 
+#include <QTimer>
+
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
 
@@ -44,6 +46,9 @@ public:
         pRSessionProcess_(nullptr),
         filename_(filename)
 {
+   sessionReadyTimer_.setSingleShot(true);
+   connect(&sessionReadyTimer_, SIGNAL(timeout()),
+           this, SLOT(onReloadFrameForNextSession()));
 }
 
    void launchFirstSession(const core::FilePath& installPath,
@@ -57,6 +62,7 @@ public:
 public Q_SLOTS:
    void onRSessionExited(int exitCode, QProcess::ExitStatus exitStatus);
    void onReloadFrameForNextSession();
+   void onRSessionOutput();
    void onLaunchFirstSession();
    void onLaunchError(QString message);
 
@@ -67,6 +73,8 @@ private:
 
    void closeAllSatellites();
 
+   void loadUrlWhenReady(const QUrl& url);
+
    core::Error launchSession(const QStringList& argList,
                              QProcess** ppRSessionProcess);
 
@@ -83,6 +91,7 @@ private:
    MainWindow* pMainWindow_;
    QProcess* pRSessionProcess_;
    QUrl nextSessionUrl_;
+   QTimer sessionReadyTimer_;
    QString filename_;
 };
 
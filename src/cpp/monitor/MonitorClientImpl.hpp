@@ -18,6 +18,8 @@
 
 #include <monitor/MonitorClient.hpp>
 
+#include "MonitorTransport.hpp"
+
 namespace rstudio {
 namespace monitor {
 
@@ -26,7 +28,8 @@ class SyncClient : public Client
 public:
    SyncClient(const std::string& metricsSocket,
               const std::string& sharedSecret)
-      : Client(metricsSocket, sharedSecret)
+      : Client(metricsSocket, sharedSecret),
+        transport_(metricsSocket, sharedSecret)
    {
    }
 
@@ -41,6 +44,13 @@ public:
    void logEvent(const Event& event);
 
    void logConsoleAction(const audit::ConsoleAction& action);
+
+protected:
+   // batches messages to the monitor (so sending them never blocks)
+   BatchedTransport& transport() { return transport_; }
+
+private:
+   BatchedTransport transport_;
 };
 
 class AsyncClient : public Client
@@ -50,7 +60,8 @@ public:
                const std::string& sharedSecret,
                boost::asio::io_service& ioService)
       : Client(metricsSocket, sharedSecret),
-        ioService_(ioService)
+        ioService_(ioService),
+        transport_(metricsSocket, sharedSecret)
    {
    }
 
@@ -68,9 +79,11 @@ public:
 
 protected:
    boost::asio::io_service& ioService() { return ioService_; }
+   BatchedTransport& transport() { return transport_; }
 
 private:
    boost::asio::io_service& ioService_;
+   BatchedTransport transport_;
 };
 
 } // namespace monitor
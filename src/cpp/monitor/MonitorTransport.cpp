@@ -0,0 +1,297 @@
+/*
+ * MonitorTransport.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "MonitorTransport.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+#ifndef _WIN32
+#include <boost/asio/local/stream_protocol.hpp>
+#endif
+
+#include <core/Error.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/Thread.hpp>
+#include <core/http/Request.hpp>
+#include <core/http/Response.hpp>
+#include <core/http/ResponseParser.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace monitor {
+
+namespace {
+
+const char * const kBatchUri = "/batch";
+
+} // anonymous namespace
+
+struct BatchedTransport::Connection
+{
+#ifndef _WIN32
+   Connection() : socket(ioService), connected(false) {}
+
+   boost::asio::io_service ioService;
+   boost::asio::local::stream_protocol::socket socket;
+   boost::asio::streambuf responseBuffer;
+   bool connected;
+#endif
+};
+
+BatchedTransport::BatchedTransport(
+                  const std::string& metricsSocket,
+                  const std::string& sharedSecret,
+                  std::size_t maxQueued,
+                  std::size_t maxBatch,
+                  const boost::posix_time::time_duration& flushInterval)
+   : metricsSocket_(metricsSocket),
+     sharedSecret_(sharedSecret),
+     maxQueued_(maxQueued),
+     maxBatch_(maxBatch),
+     flushInterval_(flushInterval),
+     dropped_(0),
+     started_(false),
+     stopping_(false),
+     pConnection_(new Connection())
+{
+}
+
+BatchedTransport::~BatchedTransport()
+{
+   try
+   {
+      // deliver what's queued then stop
+      LOCK_MUTEX(mutex_)
+      {
+         stopping_ = true;
+      }
+      END_LOCK_MUTEX
+
+      condition_.notify_all();
+      if (thread_.joinable())
+         thread_.join();
+   }
+   catch(...)
+   {
+   }
+}
+
+bool BatchedTransport::enqueue(const std::string& type,
+                               const json::Value& message)
+{
+   json::Object entry;
+   entry["type"] = type;
+   entry["message"] = message;
+
+   bool notify = false;
+   LOCK_MUTEX(mutex_)
+   {
+      if (stopping_ || queue_.size() >= maxQueued_)
+      {
+         dropped_++;
+         return false;
+      }
+
+      if (!started_)
+      {
+         started_ = true;
+         core::thread::safeLaunchThread(
+                  boost::bind(&BatchedTransport::run, this),
+                  &thread_);
+      }
+
+      queue_.push_back(entry);
+
+      // wake the thread for the first message of a batch (to start its
+      // flush interval) and when a batch is full
+      notify = queue_.size() == 1 || queue_.size() == maxBatch_;
+   }
+   END_LOCK_MUTEX
+
+   if (notify)
+      condition_.notify_one();
+   return true;
+}
+
+std::size_t BatchedTransport::droppedCount()
+{
+   LOCK_MUTEX(mutex_)
+   {
+      return dropped_;
+   }
+   END_LOCK_MUTEX
+
+   return 0;
+}
+
+void BatchedTransport::run()
+{
+   json::Array batch;
+   while (waitForBatch(&batch))
+   {
+      Error error = sendBatch(batch);
+      if (error)
+      {
+         // the batch is dropped and we reconnect for the next; the error
+         // isn't logged since logs may themselves be sent to the monitor
+         disconnect();
+         LOCK_MUTEX(mutex_)
+         {
+            dropped_ += batch.size();
+         }
+         END_LOCK_MUTEX
+      }
+      batch.clear();
+   }
+
+   disconnect();
+}
+
+bool BatchedTransport::waitForBatch(json::Array* pBatch)
+{
+   boost::unique_lock<boost::mutex> lock(mutex_);
+
+   while (!stopping_ && queue_.empty())
+      condition_.wait(lock);
+
+   // give the batch until the flush interval to fill
+   boost::system_time flushTime = boost::get_system_time() + flushInterval_;
+   while (!stopping_ && queue_.size() < maxBatch_)
+   {
+      if (!condition_.timed_wait(lock, flushTime))
+         break;
+   }
+
+   // (only empty when stopping)
+   if (queue_.empty())
+      return false;
+
+   while (!queue_.empty() && pBatch->size() < maxBatch_)
+   {
+      pBatch->push_back(queue_.front());
+      queue_.pop_front();
+   }
+   return true;
+}
+
+Error BatchedTransport::sendBatch(const json::Array& batch)
+{
+#ifndef _WIN32
+   Error error = connect();
+   if (error)
+      return error;
+
+   json::Object body;
+   body["messages"] = batch;
+
+   http::Request request;
+   request.setMethod("POST");
+   request.setUri(kBatchUri);
+   request.setHost("localhost");
+   request.setHeader("Connection", "keep-alive");
+   request.setHeader("X-Shared-Secret", sharedSecret_);
+   request.setContentType("application/json");
+   request.setBody(json::write(body));
+
+   boost::asio::local::stream_protocol::socket& socket = pConnection_->socket;
+   boost::system::error_code ec;
+   boost::asio::write(socket, request.toBuffers(), ec);
+   if (ec)
+      return Error(ec, ERROR_LOCATION);
+
+   // read the response (leaving the connection open for the next batch)
+   boost::asio::streambuf& buffer = pConnection_->responseBuffer;
+   boost::asio::read_until(socket, buffer, "\r\n\r\n", ec);
+   if (ec)
+      return Error(ec, ERROR_LOCATION);
+
+   http::Response response;
+   error = http::ResponseParser::parseStatusLine(&buffer, &response);
+   if (error)
+      return error;
+   http::ResponseParser::parseHeaders(&buffer, &response);
+
+   std::size_t contentLength = safe_convert::stringTo<std::size_t>(
+                              response.headerValue("Content-Length"), 0);
+   if (buffer.size() < contentLength)
+   {
+      boost::asio::read(socket, buffer,
+                        boost::asio::transfer_exactly(
+                              contentLength - buffer.size()),
+                        ec);
+      if (ec)
+         return Error(ec, ERROR_LOCATION);
+   }
+   buffer.consume(contentLength);
+
+   if (response.headerValue("Connection") == "close")
+      disconnect();
+
+   if (response.statusCode() != http::status::Ok)
+   {
+      return systemError(boost::system::errc::protocol_error,
+                         response.statusMessage(),
+                         ERROR_LOCATION);
+   }
+
+   return Success();
+#else
+   return systemError(boost::system::errc::not_supported, ERROR_LOCATION);
+#endif
+}
+
+Error BatchedTransport::connect()
+{
+#ifndef _WIN32
+   if (pConnection_->connected)
+      return Success();
+
+   boost::system::error_code ec;
+   pConnection_->socket.connect(
+         boost::asio::local::stream_protocol::endpoint(metricsSocket_), ec);
+   if (ec)
+   {
+      pConnection_->socket.close(ec);
+      return Error(ec, ERROR_LOCATION);
+   }
+
+   pConnection_->connected = true;
+   return Success();
+#else
+   return systemError(boost::system::errc::not_supported, ERROR_LOCATION);
+#endif
+}
+
+void BatchedTransport::disconnect()
+{
+#ifndef _WIN32
+   if (!pConnection_->connected)
+      return;
+
+   boost::system::error_code ec;
+   pConnection_->socket.close(ec);
+   pConnection_->responseBuffer.consume(pConnection_->responseBuffer.size());
+   pConnection_->connected = false;
+#endif
+}
+
+} // namespace monitor
+} // namespace rstudio
@@ -0,0 +1,95 @@
+/*
+ * MonitorTransport.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef MONITOR_MONITOR_TRANSPORT_HPP
+#define MONITOR_MONITOR_TRANSPORT_HPP
+
+#include <deque>
+#include <string>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/json/Json.hpp>
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace monitor {
+
+// Delivers messages to the monitor in batches over a single persistent
+// connection to the metrics socket. Messages are queued (in memory, up to a
+// bound) and sent from a background thread when a batch fills or the flush
+// interval elapses, so that those sending them (e.g. console auditing) never
+// wait on the monitor. Messages which don't fit in the queue, or which can't
+// be delivered, are dropped and counted.
+class BatchedTransport : boost::noncopyable
+{
+public:
+   BatchedTransport(const std::string& metricsSocket,
+                    const std::string& sharedSecret,
+                    std::size_t maxQueued = 10000,
+                    std::size_t maxBatch = 500,
+                    const boost::posix_time::time_duration& flushInterval =
+                                          boost::posix_time::milliseconds(500));
+   ~BatchedTransport();
+
+   // COPYING: boost::noncopyable
+
+   // queue a message of the given type for delivery (the background thread
+   // is started with the first message); returns false if it was dropped
+   bool enqueue(const std::string& type, const core::json::Value& message);
+
+   // messages dropped (queue full or delivery failed) since construction
+   std::size_t droppedCount();
+
+private:
+   void run();
+   bool waitForBatch(core::json::Array* pBatch);
+   core::Error sendBatch(const core::json::Array& batch);
+   core::Error connect();
+   void disconnect();
+
+   std::string metricsSocket_;
+   std::string sharedSecret_;
+   std::size_t maxQueued_;
+   std::size_t maxBatch_;
+   boost::posix_time::time_duration flushInterval_;
+
+   boost::mutex mutex_;
+   boost::condition_variable condition_;
+   std::deque<core::json::Object> queue_;
+   std::size_t dropped_;
+   bool started_;
+   bool stopping_;
+   boost::thread thread_;
+
+   // the connection (used only by the background thread)
+   struct Connection;
+   boost::scoped_ptr<Connection> pConnection_;
+};
+
+} // namespace monitor
+} // namespace rstudio
+
+#endif // MONITOR_MONITOR_TRANSPORT_HPP
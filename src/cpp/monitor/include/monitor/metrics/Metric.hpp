@@ -23,6 +23,8 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <core/json/Json.hpp>
+#include <core/MemoryAccounting.hpp>
+#include <core/http/RequestMetrics.hpp>
 
 namespace rstudio {
 namespace core {
@@ -157,6 +159,20 @@ core::json::Object metricToJson(const MultiMetric& multiMetric);
 core::Error metricFromJson(const core::json::Object& multiMetricJson,
                            MultiMetric* pMultiMetric);
 
+// one multi metric per uri prefix for the stats collected by
+// core::http::request_metrics (with scope "<scope>.<prefix>")
+std::vector<MultiMetric> requestMetrics(
+      const std::string& scope,
+      int intervalSeconds,
+      const std::vector<core::http::request_metrics::PrefixStats>& stats);
+
+// one multi metric per subsystem for the stats collected by
+// core::memory_accounting (with scope "<scope>.<subsystem>")
+std::vector<MultiMetric> memoryMetrics(
+      const std::string& scope,
+      int intervalSeconds,
+      const std::vector<core::memory_accounting::SubsystemStats>& stats);
+
 
 } // namespace metrics
 } // namespace monitor
@@ -21,6 +21,7 @@
 
 #include <core/Error.hpp>
 #include <core/DateTime.hpp>
+#include <core/SafeConvert.hpp>
 
 #include <core/json/JsonRpc.hpp>
 
@@ -172,6 +173,70 @@ Error metricFromJson(const json::Object& multiMetricJson,
    return Success();
 }
 
+std::vector<MultiMetric> requestMetrics(
+      const std::string& scope,
+      int intervalSeconds,
+      const std::vector<core::http::request_metrics::PrefixStats>& stats)
+{
+   using namespace core::http::request_metrics;
+   const std::vector<double>& buckets = latencyBucketsMs();
+
+   std::vector<MultiMetric> metrics;
+   BOOST_FOREACH(const PrefixStats& prefixStats, stats)
+   {
+      std::vector<MetricData> data;
+      data.push_back(MetricData("requests", prefixStats.requests));
+      data.push_back(MetricData("aborted", prefixStats.aborted));
+      data.push_back(MetricData("in_flight", prefixStats.inFlight));
+      data.push_back(MetricData("bytes_in", prefixStats.bytesIn));
+      data.push_back(MetricData("bytes_out", prefixStats.bytesOut));
+
+      double averageMs = prefixStats.requests > 0 ?
+               prefixStats.totalLatencyMs / prefixStats.requests : 0;
+      data.push_back(MetricData("latency_avg_ms", averageMs));
+      data.push_back(MetricData("latency_max_ms", prefixStats.maxLatencyMs));
+
+      // histogram buckets (the last one counts requests slower than all
+      // of the bucket bounds)
+      for (std::size_t i = 0; i < prefixStats.latencyCounts.size(); ++i)
+      {
+         std::string name = i < buckets.size() ?
+            "latency_le_" + safe_convert::numberToString(buckets[i]) + "ms" :
+            "latency_gt_" + safe_convert::numberToString(buckets.back()) + "ms";
+         data.push_back(MetricData(name, prefixStats.latencyCounts[i]));
+      }
+
+      metrics.push_back(MultiMetric(scope + "." + prefixStats.prefix,
+                                    intervalSeconds,
+                                    data));
+   }
+
+   return metrics;
+}
+
+std::vector<MultiMetric> memoryMetrics(
+      const std::string& scope,
+      int intervalSeconds,
+      const std::vector<core::memory_accounting::SubsystemStats>& stats)
+{
+   using namespace core::memory_accounting;
+
+   std::vector<MultiMetric> metrics;
+   BOOST_FOREACH(const SubsystemStats& subsystemStats, stats)
+   {
+      std::vector<MetricData> data;
+      data.push_back(MetricData("bytes", subsystemStats.usage.bytes));
+      data.push_back(MetricData("entries", subsystemStats.usage.entries));
+      data.push_back(MetricData("budget", subsystemStats.budget));
+      data.push_back(MetricData("evictions", subsystemStats.evictions));
+
+      metrics.push_back(MultiMetric(scope + "." + subsystemStats.name,
+                                    intervalSeconds,
+                                    data));
+   }
+
+   return metrics;
+}
 
 } // namespace metrics
 } // namespace monitor
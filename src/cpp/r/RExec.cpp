@@ -16,8 +16,12 @@
 #define R_INTERNAL_FUNCTIONS
 #include <r/RExec.hpp>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
 #include <core/FilePath.hpp>
 #include <core/Log.hpp>
+#include <core/Trace.hpp>
 
 #include <r/RErrorCategory.hpp>
 #include <r/RSourceManager.hpp>
@@ -273,6 +277,10 @@ Error evaluateString(const std::string& str,
 {
    // refresh source if necessary (no-op in production)
    r::sourceManager().reloadIfNecessary();
+
+   core::trace::ScopedSpan span("r.eval");
+   if (span.recording())
+      span.setAttribute("code", str.substr(0, 200));
    
    // surrond the string with try in silent mode so we can capture error text
    std::string rCode = "base::try(" + str + ", TRUE)";
@@ -323,32 +331,117 @@ RFunction::~RFunction()
 {
 }
    
-void RFunction::commonInit(const std::string& functionName)
+FunctionHandle::FunctionHandle(const std::string& functionName)
+   : functionName_(functionName),
+     nameSEXP_(R_NilValue),
+     nsSEXP_(R_NilValue),
+     namespaceSEXP_(R_UnboundValue),
+     bindingSEXP_(R_UnboundValue),
+     functionSEXP_(R_UnboundValue)
 {
-   // refresh source if necessary (no-op in production)
-   r::sourceManager().reloadIfNecessary();
-   
-   // record functionName (used later for diagnostics)
-   functionName_ = functionName;
-   
-   // get name & ns
-   std::string name, ns;
-   
    // check for namespace qualifier
    std::string nsQual(":::");
    size_t pos = functionName_.find(nsQual);
    if (pos != std::string::npos)
    {
-      ns = functionName_.substr(0, pos);
-      name = functionName_.substr(pos + nsQual.size());
+      ns_ = functionName_.substr(0, pos);
+      name_ = functionName_.substr(pos + nsQual.size());
    }
    else
    {
-      name = functionName_; 
+      name_ = functionName_;
+   }
+}
+
+SEXP FunctionHandle::resolve()
+{
+   if (name_.empty())
+      return R_UnboundValue;
+
+   if (nameSEXP_ == R_NilValue)
+   {
+      nameSEXP_ = Rf_install(name_.c_str());
+      if (!ns_.empty())
+         nsSEXP_ = Rf_install(ns_.c_str());
+   }
+
+   if (ns_.empty())
+   {
+      // the common case of a function bound on the search path is answered
+      // by R's global cache (anything else takes the long way round)
+      SEXP functionSEXP = Rf_findVar(nameSEXP_, R_GlobalEnv);
+      if (Rf_isFunction(functionSEXP))
+         return functionSEXP;
+
+      return sexp::findFunction(name_);
+   }
+
+   // reuse the function found last time if its namespace hasn't been
+   // reloaded and its binding hasn't been replaced (e.g. by trace)
+   SEXP namespaceSEXP = Rf_findVarInFrame(R_NamespaceRegistry, nsSEXP_);
+   if (bindingSEXP_ != R_UnboundValue &&
+       namespaceSEXP == namespaceSEXP_ &&
+       Rf_findVarInFrame(namespaceSEXP, nameSEXP_) == bindingSEXP_)
+   {
+      return functionSEXP_;
    }
+
+   SEXP functionSEXP = sexp::findFunction(name_, ns_);
+   if (functionSEXP == R_UnboundValue)
+      return R_UnboundValue;
+
+   // remember functions defined within the namespace itself (which are
+   // either bound directly or, when lazy loaded, via a promise). functions
+   // found beyond it (e.g. in imports) are looked up each time
+   namespaceSEXP = Rf_findVarInFrame(R_NamespaceRegistry, nsSEXP_);
+   if (TYPEOF(namespaceSEXP) == ENVSXP)
+   {
+      SEXP bindingSEXP = Rf_findVarInFrame(namespaceSEXP, nameSEXP_);
+      if (bindingSEXP == functionSEXP ||
+          (TYPEOF(bindingSEXP) == PROMSXP && PRVALUE(bindingSEXP) == functionSEXP))
+      {
+         // the binding keeps the function alive
+         if (bindingSEXP_ != R_UnboundValue)
+            ::R_ReleaseObject(bindingSEXP_);
+         ::R_PreserveObject(bindingSEXP);
+
+         namespaceSEXP_ = namespaceSEXP;
+         bindingSEXP_ = bindingSEXP;
+         functionSEXP_ = functionSEXP;
+      }
+   }
+
+   return functionSEXP;
+}
+
+FunctionHandle& functionHandle(const std::string& functionName)
+{
+   // never freed (so that nothing is released after R has exited)
+   typedef boost::unordered_map<std::string, boost::shared_ptr<FunctionHandle> >
+           FunctionHandles;
+   static FunctionHandles* s_pHandles = new FunctionHandles();
+
+   boost::shared_ptr<FunctionHandle>& pHandle = (*s_pHandles)[functionName];
+   if (!pHandle)
+      pHandle.reset(new FunctionHandle(functionName));
+   return *pHandle;
+}
+
+void RFunction::commonInit(const std::string& functionName)
+{
+   commonInit(functionHandle(functionName));
+}
+
+void RFunction::commonInit(FunctionHandle& handle)
+{
+   // refresh source if necessary (no-op in production)
+   r::sourceManager().reloadIfNecessary();
+   
+   // record functionName (used later for diagnostics)
+   functionName_ = handle.functionName();
    
    // lookup function
-   functionSEXP_ = sexp::findFunction(name, ns);
+   functionSEXP_ = handle.resolve();
    if (functionSEXP_ != R_UnboundValue)
       preserver_.add(functionSEXP_);
 }
@@ -409,6 +502,9 @@ Error RFunction::call(SEXP evalNS, bool safely, SEXP* pResultSEXP,
    }
    
    // call the function
+   core::trace::ScopedSpan span("r.call");
+   if (span.recording())
+      span.setAttribute("function", functionName_);
    Error error = safely ?
             evaluateExpressions(callSEXP, evalNS, pResultSEXP, pProtect) :
             evaluateExpressionsUnsafe(callSEXP, evalNS, pResultSEXP, pProtect,
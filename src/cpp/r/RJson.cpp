@@ -53,6 +53,7 @@
 
 #include <core/Error.hpp>
 #include <core/StringUtils.hpp>
+#include <core/json/JsonWriter.hpp>
 
 #include <r/RSexp.hpp>
 #include <r/RErrorCategory.hpp>
@@ -319,6 +320,235 @@ Error jsonObjectArrayFromDataFrame(SEXP listSEXP, core::json::Value* pValue)
    return Success();
 }
 
+void writeComplex(const Rcomplex& value, core::json::Writer* pWriter)
+{
+   if (ISNAN(value.r) || ISNAN(value.i))
+   {
+      pWriter->null();
+      return;
+   }
+
+   pWriter->startObject();
+   pWriter->member("i", value.i);
+   pWriter->member("r", value.r);
+   pWriter->endObject();
+}
+
+Error writeVectorElement(SEXP vectorSEXP, int i, core::json::Writer* pWriter)
+{
+   // see jsonValueFromVectorElement for the conversions
+   switch(TYPEOF(vectorSEXP))
+   {
+      case NILSXP:
+      {
+         pWriter->null();
+         break;
+      }
+      case STRSXP:
+      {
+         SEXP stringSEXP = STRING_ELT(vectorSEXP, i);
+         if (stringSEXP != NA_STRING)
+            pWriter->value(Rf_translateCharUTF8(stringSEXP));
+         else
+            pWriter->null();
+         break;
+      }
+      case INTSXP:
+      {
+         int value = INTEGER(vectorSEXP)[i];
+         if (value != NA_INTEGER)
+            pWriter->value(value);
+         else
+            pWriter->null();
+         break;
+      }
+      case REALSXP:
+      {
+         double value = REAL(vectorSEXP)[i];
+         if (!ISNAN(value))
+            pWriter->value(value);
+         else
+            pWriter->null();
+         break;
+      }
+      case LGLSXP:
+      {
+         int value = LOGICAL(vectorSEXP)[i];
+         if (value != NA_LOGICAL)
+            pWriter->value(value == TRUE);
+         else
+            pWriter->null();
+         break;
+      }
+      case CPLXSXP:
+      {
+         writeComplex(COMPLEX(vectorSEXP)[i], pWriter);
+         break;
+      }
+      case ENVSXP:
+      {
+         pWriter->value("<environment>");
+         break;
+      }
+      default:
+      {
+         return Error(errc::UnexpectedDataTypeError, ERROR_LOCATION);
+      }
+   }
+
+   return Success();
+}
+
+Error writeVector(SEXP vectorSEXP, core::json::Writer* pWriter)
+{
+   int vectorLength = Rf_length(vectorSEXP);
+
+   if (Rf_inherits(vectorSEXP, "rs.scalar"))
+   {
+      if (vectorLength > 0)
+         return writeVectorElement(vectorSEXP, 0, pWriter);
+
+      pWriter->null();
+      return Success();
+   }
+
+   // loop over the vector's data directly for the atomic types
+   pWriter->startArray();
+   switch(TYPEOF(vectorSEXP))
+   {
+      case STRSXP:
+      {
+         for (int i = 0; i < vectorLength; i++)
+         {
+            SEXP stringSEXP = STRING_ELT(vectorSEXP, i);
+            if (stringSEXP != NA_STRING)
+               pWriter->value(Rf_translateCharUTF8(stringSEXP));
+            else
+               pWriter->null();
+         }
+         break;
+      }
+      case INTSXP:
+      {
+         const int* pData = INTEGER(vectorSEXP);
+         for (int i = 0; i < vectorLength; i++)
+         {
+            if (pData[i] != NA_INTEGER)
+               pWriter->value(pData[i]);
+            else
+               pWriter->null();
+         }
+         break;
+      }
+      case REALSXP:
+      {
+         const double* pData = REAL(vectorSEXP);
+         for (int i = 0; i < vectorLength; i++)
+         {
+            if (!ISNAN(pData[i]))
+               pWriter->value(pData[i]);
+            else
+               pWriter->null();
+         }
+         break;
+      }
+      case LGLSXP:
+      {
+         const int* pData = LOGICAL(vectorSEXP);
+         for (int i = 0; i < vectorLength; i++)
+         {
+            if (pData[i] != NA_LOGICAL)
+               pWriter->value(pData[i] == TRUE);
+            else
+               pWriter->null();
+         }
+         break;
+      }
+      case CPLXSXP:
+      {
+         const Rcomplex* pData = COMPLEX(vectorSEXP);
+         for (int i = 0; i < vectorLength; i++)
+            writeComplex(pData[i], pWriter);
+         break;
+      }
+      default:
+      {
+         for (int i = 0; i < vectorLength; i++)
+         {
+            Error error = writeVectorElement(vectorSEXP, i, pWriter);
+            if (error)
+               return error;
+         }
+         break;
+      }
+   }
+   pWriter->endArray();
+
+   return Success();
+}
+
+Error writeList(SEXP listSEXP, core::json::Writer* pWriter)
+{
+   int listLength = Rf_length(listSEXP);
+
+   // unnamed lists are arrays
+   if (!isNamedList(listSEXP))
+   {
+      pWriter->startArray();
+      for (int i = 0; i < listLength; i++)
+      {
+         Error error = writeJsonFromObject(VECTOR_ELT(listSEXP, i), pWriter);
+         if (error)
+            return error;
+      }
+      pWriter->endArray();
+      return Success();
+   }
+
+   std::vector<std::string> fieldNames;
+   Error error = sexp::getNames(listSEXP, &fieldNames);
+   if (error)
+      return error;
+
+   // named lists are objects
+   if (!Rf_inherits(listSEXP, "data.frame"))
+   {
+      pWriter->startObject();
+      for (int i = 0; i < listLength; i++)
+      {
+         pWriter->key(fieldNames[i]);
+         error = writeJsonFromObject(VECTOR_ELT(listSEXP, i), pWriter);
+         if (error)
+            return error;
+      }
+      pWriter->endObject();
+      return Success();
+   }
+
+   // and data frames are arrays of row objects
+   pWriter->startArray();
+   int rows = Rf_length(VECTOR_ELT(listSEXP, 0));
+   for (int row = 0; row < rows; row++)
+   {
+      pWriter->startObject();
+      for (int f = 0; f < listLength; f++)
+      {
+         SEXP fieldSEXP = VECTOR_ELT(listSEXP, f);
+         pWriter->key(fieldNames[f]);
+         if (TYPEOF(fieldSEXP) == VECSXP)
+            error = writeJsonFromObject(VECTOR_ELT(fieldSEXP, row), pWriter);
+         else
+            error = writeVectorElement(fieldSEXP, row, pWriter);
+         if (error)
+            return error;
+      }
+      pWriter->endObject();
+   }
+   pWriter->endArray();
+
+   return Success();
+}
+
 } // anonymous namespace
 
 Error jsonValueFromScalar(SEXP scalarSEXP, core::json::Value* pValue)
@@ -412,6 +642,32 @@ Error jsonValueFromObject(SEXP objectSEXP, core::json::Value* pValue)
       }
    }
 } 
+
+Error writeJsonFromObject(SEXP objectSEXP, core::json::Writer* pWriter)
+{
+   switch(TYPEOF(objectSEXP))
+   {
+      case NILSXP:
+      {
+         pWriter->null();
+         return Success();
+      }
+      case VECSXP:
+      {
+         return writeList(objectSEXP, pWriter);
+      }
+      case SYMSXP:
+      case LANGSXP:
+      {
+         pWriter->value(sexp::asString(objectSEXP));
+         return Success();
+      }
+      default:
+      {
+         return writeVector(objectSEXP, pWriter);
+      }
+   }
+}
    
 } // namespace json
 } // namespace r
@@ -51,6 +51,7 @@
 
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
+#include <core/json/JsonWriter.hpp>
 
 #include <r/RExec.hpp>
 #include <r/RSourceManager.hpp>
@@ -67,14 +68,15 @@ namespace {
          
 Error setJsonResult(SEXP resultSEXP, core::json::JsonRpcResponse* pResponse)
 {   
-   // get the result
-   core::json::Value resultValue ;
-   Error error = jsonValueFromObject(resultSEXP, &resultValue);
+   // write the result directly as JSON text
+   std::string result;
+   core::json::Writer writer(&result);
+   Error error = writeJsonFromObject(resultSEXP, &writer);
    if (error)
       return error ;
    
    // set the result and return success
-   pResponse->setResult(resultValue);
+   pResponse->setResultJson(result);
    return Success();
 }
 
@@ -0,0 +1,39 @@
+/*
+ * RSexpView.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#define R_INTERNAL_FUNCTIONS
+
+#include <r/RSexpView.hpp>
+
+#include <cstring>
+
+namespace rstudio {
+namespace r {
+namespace sexp {
+
+StringView asStringView(SEXP object)
+{
+   if (TYPEOF(object) != STRSXP || LENGTH(object) == 0)
+      return StringView();
+
+   // no copy is made unless the string needs translating, in which case
+   // the translation is allocated by R for the duration of the call
+   const char* begin = Rf_translateChar(STRING_ELT(object, 0));
+   return StringView(begin, begin + std::strlen(begin));
+}
+
+} // namespace sexp
+} // namespace r
+} // namespace rstudio
@@ -40,7 +40,7 @@ SourceManager& sourceManager()
    
 Error SourceManager::sourceTools(const core::FilePath& filePath)
 {
-   Error error = sourceLocal(filePath);
+   Error error = sourceToolsFile(filePath);
    if (error)
       return error;
 
@@ -88,10 +88,70 @@ void SourceManager::reloadIfNecessary()
 
 void SourceManager::reSourceTools(const core::FilePath& filePath)
 {
-   Error error = source(filePath, true);
+   Error error = sourceToolsFile(filePath);
    if (error)
       LOG_ERROR(error);
 }
+
+Error SourceManager::sourceToolsFile(const FilePath& filePath)
+{
+   // installs include byte-compiled copies of the tools files, which load
+   // without having to be parsed (and whose functions needn't be compiled
+   // by the JIT when first called)
+   FilePath compiledPath = compiledToolsFilePath(filePath);
+   if (!compiledPath.empty())
+      return loadCompiled(compiledPath);
+
+   return source(filePath, true);
+}
+
+FilePath SourceManager::compiledToolsFilePath(const FilePath& filePath)
+{
+   // always source files which may be reloaded
+   if (autoReload_)
+      return FilePath();
+
+   if (compiledDir_.empty())
+   {
+      std::string version;
+      Error error = r::exec::evaluateString(
+            "paste(R.version$major, "
+            "strsplit(R.version$minor, '.', fixed = TRUE)[[1]][[1]], "
+            "sep = '.')",
+            &version);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return FilePath();
+      }
+
+      compiledDir_ = "compiled/" + version;
+   }
+
+   FilePath compiledPath = filePath.parent().complete(
+            compiledDir_ + "/" + filePath.stem() + ".Rc");
+
+   // ignore compiled files which are missing or older than their sources
+   if (!compiledPath.exists() ||
+       compiledPath.lastWriteTime() < filePath.lastWriteTime())
+   {
+      return FilePath();
+   }
+
+   return compiledPath;
+}
+
+Error SourceManager::loadCompiled(const FilePath& compiledPath)
+{
+   std::string path = compiledPath.absolutePath();
+   boost::algorithm::replace_all(path, "\\", "\\\\");
+
+   // evaluate in a local environment, as source(local = TRUE) would
+   std::string rCode = "local(compiler::loadcmp(\"" + path + "\", "
+                       "envir = environment()))";
+
+   return r::exec::executeString(rCode);
+}
    
 Error SourceManager::source(const FilePath& filePath, bool local)
 {
@@ -98,6 +98,49 @@ core::Error evaluateString(const std::string& str, T* pValue)
    return sexp::extract(valueSEXP, pValue);
 }
    
+// A handle to an R function, looked up by name ("name" or "ns:::name").
+// Resolving a handle again is cheap: the name is parsed and its symbols
+// installed once, a function defined within a namespace is reused for as
+// long as the namespace is loaded and the function's binding is unchanged,
+// and other functions are found via R's global variable cache (which R
+// keeps current as packages are attached and detached, and as bindings
+// are added and removed). Handles live for the lifetime of the process.
+class FunctionHandle : boost::noncopyable
+{
+public:
+   explicit FunctionHandle(const std::string& functionName);
+
+   const std::string& functionName() const { return functionName_; }
+
+   // the function (or R_UnboundValue if it can't be found)
+   SEXP resolve();
+
+private:
+   std::string functionName_;
+   std::string name_;
+   std::string ns_;
+   SEXP nameSEXP_;
+   SEXP nsSEXP_;
+
+   // what was found when the (namespace qualified) name was last resolved
+   SEXP namespaceSEXP_;
+   SEXP bindingSEXP_;
+   SEXP functionSEXP_;
+};
+
+// get the (shared) handle for a function name; RFunction uses these for
+// all functions constructed by name
+FunctionHandle& functionHandle(const std::string& functionName);
+
+// declare a handle for code which calls the same function frequently, e.g.
+//
+//    RS_FUNCTION_HANDLE(s_describeCols, ".rs.describeCols");
+//    r::exec::RFunction describeCols(s_describeCols);
+//
+#define RS_FUNCTION_HANDLE(handle, functionName)                               \
+   static ::rstudio::r::exec::FunctionHandle& handle =                         \
+      ::rstudio::r::exec::functionHandle(functionName)
+
 // call R functions
 class RFunction : boost::noncopyable
 {
@@ -175,6 +218,12 @@ public:
       addParam(param5);
    }
    
+   explicit RFunction(FunctionHandle& handle)
+      : functionSEXP_(R_UnboundValue)
+   {
+      commonInit(handle);
+   }
+
    explicit RFunction(SEXP functionSEXP);
    
    virtual ~RFunction() ;
@@ -240,6 +289,7 @@ public:
    
 private:
    void commonInit(const std::string& functionName);
+   void commonInit(FunctionHandle& handle);
    
 private:
    // preserve SEXPs
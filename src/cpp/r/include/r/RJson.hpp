@@ -24,6 +24,9 @@ namespace rstudio {
 namespace core {
    class Error;
    class FilePath;
+   namespace json {
+      class Writer;
+   }
 }
 }
 
@@ -38,6 +41,11 @@ core::Error jsonValueFromScalar(SEXP scalarSEXP, core::json::Value* pValue);
 core::Error jsonValueFromVector(SEXP vectorSEXP, core::json::Value* pValue);
 core::Error jsonValueFromList(SEXP listSEXP, core::json::Value* pValue);
 core::Error jsonValueFromObject(SEXP objectSEXP, core::json::Value* pValue);
+
+// write the object as JSON text (converted as jsonValueFromObject would
+// convert it, but without building the value). on error the writer may
+// have been left with partial output.
+core::Error writeJsonFromObject(SEXP objectSEXP, core::json::Writer* pWriter);
    
 } // namespace json
 } // namespace r
@@ -0,0 +1,239 @@
+/*
+ * RSexpView.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef R_R_SEXP_VIEW_HPP
+#define R_R_SEXP_VIEW_HPP
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+#include <r/RInternal.hpp>
+#include <r/RRoutines.hpp>
+
+// Views read the contents of R vectors in place, without copying them into
+// std::string or std::vector (e.g. for .Call methods which are called on
+// every keystroke). A view is only valid while the object it views is
+// protected; arguments to .Call methods are protected for the duration of
+// the call.
+
+namespace rstudio {
+namespace r {
+namespace sexp {
+
+// the characters of a string (not null terminated in general)
+class StringView
+{
+public:
+   StringView() : begin_(""), end_(begin_) {}
+
+   StringView(const char* begin, const char* end)
+      : begin_(begin), end_(end)
+   {
+   }
+
+   explicit StringView(SEXP charSEXP)
+      : begin_(CHAR(charSEXP)), end_(begin_ + LENGTH(charSEXP))
+   {
+   }
+
+   // COPYING: via compiler
+
+   const char* begin() const { return begin_; }
+   const char* end() const { return end_; }
+   std::size_t size() const { return end_ - begin_; }
+   bool empty() const { return begin_ == end_; }
+
+   std::string str() const { return std::string(begin_, end_); }
+
+private:
+   const char* begin_;
+   const char* end_;
+};
+
+// the first element of a character vector, translated to the native
+// encoding as with asString (empty if the object isn't a character vector)
+StringView asStringView(SEXP object);
+
+// the elements of a character vector. as with fillVectorString the elements
+// aren't translated, and NA elements read as "NA"
+class StringVectorView
+{
+public:
+   explicit StringVectorView(SEXP object)
+      : object_(object), valid_(TYPEOF(object) == STRSXP)
+   {
+   }
+
+   // COPYING: via compiler
+
+   // false if the object isn't a character vector (the view is then empty)
+   bool valid() const { return valid_; }
+
+   std::size_t size() const
+   {
+      return valid_ ? static_cast<std::size_t>(LENGTH(object_)) : 0;
+   }
+
+   StringView operator[](std::size_t i) const
+   {
+      return StringView(STRING_ELT(object_, i));
+   }
+
+private:
+   SEXP object_;
+   bool valid_;
+};
+
+namespace internal {
+
+template <typename T> struct VectorViewTraits;
+
+template <> struct VectorViewTraits<int>
+{
+   static bool isType(SEXP object) { return TYPEOF(object) == INTSXP; }
+   static const int* data(SEXP object) { return INTEGER(object); }
+};
+
+template <> struct VectorViewTraits<double>
+{
+   static bool isType(SEXP object) { return TYPEOF(object) == REALSXP; }
+   static const double* data(SEXP object) { return REAL(object); }
+};
+
+} // namespace internal
+
+// the elements of an integer or numeric vector
+template <typename T>
+class VectorView
+{
+public:
+   explicit VectorView(SEXP object)
+      : begin_(NULL), end_(NULL)
+   {
+      if (internal::VectorViewTraits<T>::isType(object))
+      {
+         begin_ = internal::VectorViewTraits<T>::data(object);
+         end_ = begin_ + LENGTH(object);
+      }
+   }
+
+   // COPYING: via compiler
+
+   // false if the object isn't of the expected type (the view is then empty)
+   bool valid() const { return begin_ != NULL; }
+
+   const T* begin() const { return begin_; }
+   const T* end() const { return end_; }
+   std::size_t size() const { return end_ - begin_; }
+   const T& operator[](std::size_t i) const { return begin_[i]; }
+
+private:
+   const T* begin_;
+   const T* end_;
+};
+
+typedef VectorView<int> IntegerVectorView;
+typedef VectorView<double> RealVectorView;
+
+} // namespace sexp
+
+namespace routines {
+namespace internal {
+
+// conversion of .Call arguments to the parameter types of typed call methods
+template <typename T> struct CallArgument;
+
+template <> struct CallArgument<SEXP>
+{
+   static SEXP convert(SEXP object) { return object; }
+};
+
+template <> struct CallArgument<sexp::StringView>
+{
+   static sexp::StringView convert(SEXP object)
+   {
+      return sexp::asStringView(object);
+   }
+};
+
+template <> struct CallArgument<sexp::StringVectorView>
+{
+   static sexp::StringVectorView convert(SEXP object)
+   {
+      return sexp::StringVectorView(object);
+   }
+};
+
+template <typename T> struct CallArgument<sexp::VectorView<T> >
+{
+   static sexp::VectorView<T> convert(SEXP object)
+   {
+      return sexp::VectorView<T>(object);
+   }
+};
+
+template <typename T> struct SEXPParameter
+{
+   typedef SEXP type;
+};
+
+// wraps a function taking views in a .Call method taking SEXPs
+template <typename... ArgumentTypes>
+struct TypedCallMethod
+{
+   template <SEXP (*Function)(ArgumentTypes...)>
+   static SEXP call(typename SEXPParameter<ArgumentTypes>::type... args)
+   {
+      return Function(CallArgument<
+                         typename std::decay<ArgumentTypes>::type
+                      >::convert(args)...);
+   }
+};
+
+template <typename... ArgumentTypes>
+TypedCallMethod<ArgumentTypes...> typedCallMethod(SEXP (*)(ArgumentTypes...))
+{
+   return TypedCallMethod<ArgumentTypes...>();
+}
+
+} // namespace internal
+} // namespace routines
+
+} // namespace r
+} // namespace rstudio
+
+// Register a .Call method whose parameters are views (or SEXPs), e.g.
+//
+//    SEXP rs_countMatches(const r::sexp::StringVectorView& strings,
+//                         const r::sexp::StringView& query);
+//
+//    RS_REGISTER_TYPED_CALL_METHOD(rs_countMatches);
+//
+// The arguments are converted to views when the method is called.
+#define RS_REGISTER_TYPED_CALL_METHOD(__NAME__)                          \
+   do                                                                    \
+   {                                                                     \
+      R_CallMethodDef callMethodDef;                                     \
+      callMethodDef.name = #__NAME__;                                    \
+      callMethodDef.fun = (DL_FUNC) &decltype(                           \
+         ::rstudio::r::routines::internal::typedCallMethod(__NAME__)     \
+      )::call<__NAME__>;                                                 \
+      callMethodDef.numArgs =                                            \
+         ::rstudio::r::routines::internal::n_arguments(__NAME__);        \
+      ::rstudio::r::routines::addCallMethod(callMethodDef);              \
+   } while (false)
+
+#endif // R_R_SEXP_VIEW_HPP
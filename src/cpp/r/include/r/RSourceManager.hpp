@@ -75,6 +75,9 @@ private:
    
    // helper functions
    core::Error source(const core::FilePath& filePath, bool local);
+   core::Error sourceToolsFile(const core::FilePath& filePath);
+   core::FilePath compiledToolsFilePath(const core::FilePath& filePath);
+   core::Error loadCompiled(const core::FilePath& compiledPath);
    void reSourceTools(const core::FilePath& filePath);
    void recordSourcedFile(const core::FilePath& filePath, bool local);
    void reloadSourceIfNecessary(const SourcedFileMap::value_type& value);
@@ -83,6 +86,10 @@ private:
    bool autoReload_ ;
    SourcedFileMap sourcedFiles_ ;
    std::vector<core::FilePath> toolsFilePaths_;
+
+   // directory (relative to each tools file) of the byte-compiled tools
+   // files for this version of R
+   std::string compiledDir_;
 };
    
 } // namespace r
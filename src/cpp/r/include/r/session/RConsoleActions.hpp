@@ -63,16 +63,40 @@ public:
    // get actions in their wire-representation (two identically sized arrays, 
    // one for type and one for data)
    void asJson(core::json::Object* pActions) const;
+
+   // get the actions preceding the one numbered end (actions are numbered
+   // from the first added), going back only as far as needed to produce
+   // maxLines lines of console output. the number of the first action
+   // included is returned so that earlier actions can be asked for in turn
+   void asJson(std::size_t end,
+               std::size_t maxLines,
+               core::json::Object* pActions,
+               std::size_t* pStart) const;
    
    core::Error loadFromFile(const core::FilePath& filePath);
    core::Error saveToFile(const core::FilePath& filePath) const;
 
 private:
+   struct Action
+   {
+      Action(int type, const std::string& data) : type(type), data(data) {}
+
+      int type;
+      std::string data;
+   };
+
+   void pushAction(int type, const std::string& data);
+   core::Error loadFromJson(const std::string& actionsJson);
+
    // protect data using a mutex because background threads (e.g.
    // console output capture threads) can interact with console actions
    mutable boost::mutex mutex_;
-   boost::circular_buffer<core::json::Value> actionsType_;
-   boost::circular_buffer<core::json::Value> actionsData_;
+   boost::circular_buffer<Action> actions_;
+
+   // number of the first action in the buffer (those before it have been
+   // dropped or reset)
+   std::size_t firstAction_;
+
    std::vector<std::string> pendingInput_;
 };
 
@@ -12,11 +12,15 @@
  * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
  *
  */
-
 #include <r/session/RConsoleActions.hpp>
 
 #include <algorithm>
+#include <cstring>
+#include <limits>
 
+#include <boost/cstdint.hpp>
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/split.hpp>
 
 #include <core/Log.hpp>
@@ -36,6 +40,56 @@ namespace session {
 namespace {   
 const char * const kActionType = "type";
 const char * const kActionData = "data";
+
+// actions are saved as this header followed by each action as its type
+// (one byte), the length of its data (four bytes, big endian) and its data.
+// (actions were formerly saved as json, which is still read)
+const char * const kActionsFileHeader = "rstudio-console-actions 1\n";
+
+void writeAction(int type, const std::string& data, std::string* pOutput)
+{
+   boost::uint32_t length = static_cast<boost::uint32_t>(data.size());
+   pOutput->push_back(static_cast<char>(type));
+   pOutput->push_back(static_cast<char>((length >> 24) & 0xFF));
+   pOutput->push_back(static_cast<char>((length >> 16) & 0xFF));
+   pOutput->push_back(static_cast<char>((length >> 8) & 0xFF));
+   pOutput->push_back(static_cast<char>(length & 0xFF));
+   pOutput->append(data);
+}
+
+bool readAction(const std::string& input,
+                std::size_t* pPos,
+                int* pType,
+                std::string* pData)
+{
+   std::size_t pos = *pPos;
+   if (input.size() - pos < 5)
+      return false;
+
+   *pType = static_cast<unsigned char>(input[pos]);
+   boost::uint32_t length = 0;
+   for (std::size_t i = 1; i <= 4; i++)
+      length = (length << 8) | static_cast<unsigned char>(input[pos + i]);
+   pos += 5;
+
+   if (input.size() - pos < length)
+      return false;
+
+   pData->assign(input, pos, length);
+   *pPos = pos + length;
+   return true;
+}
+
+// the number of lines of console output an action produces (as the client
+// counts them)
+std::size_t actionLines(int type, const std::string& data)
+{
+   std::size_t lines = std::count(data.begin(), data.end(), '\n');
+   if (type == kConsoleActionInput)
+      lines++;
+   return lines;
+}
+
 }
    
 ConsoleActions& consoleActions()
@@ -45,6 +99,7 @@ ConsoleActions& consoleActions()
 }
    
 ConsoleActions::ConsoleActions()
+   : firstAction_(0)
 {
    setCapacity(1000);
 }
@@ -53,7 +108,7 @@ int ConsoleActions::capacity() const
 {
    LOCK_MUTEX(mutex_)
    {
-      return actionsType_.capacity();
+      return actions_.capacity();
    }
    END_LOCK_MUTEX
 
@@ -65,11 +120,23 @@ void ConsoleActions::setCapacity(int capacity)
 {
    LOCK_MUTEX(mutex_)
    {
-      actionsType_.set_capacity(capacity);
-      actionsData_.set_capacity(capacity);
+      // (shrinking drops the oldest actions)
+      if (static_cast<std::size_t>(capacity) < actions_.size())
+         firstAction_ += actions_.size() - capacity;
+      actions_.set_capacity(capacity);
    }
    END_LOCK_MUTEX
 }
+
+void ConsoleActions::pushAction(int type, const std::string& data)
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+
+   // when full the oldest action is dropped (in constant time)
+   if (actions_.full())
+      firstAction_++;
+   actions_.push_back(Action(type, data));
+}
    
 void ConsoleActions::add(int type, const std::string& data)
 {
@@ -97,16 +164,15 @@ void ConsoleActions::add(int type, const std::string& data)
       // didn't cap the size of combined output then the output actions could
       // grow to arbitrary size)
       if (type == kConsoleActionOutput &&
-          actionsType_.size() > 0      &&
-          actionsType_.back().get_value<int>() == kConsoleActionOutput &&
-          actionsData_.back().get_str().size() < 512)
+          actions_.size() > 0      &&
+          actions_.back().type == kConsoleActionOutput &&
+          actions_.back().data.size() < 512)
       {
-         actionsData_.back() = actionsData_.back().get_str() + data;
+         actions_.back().data.append(data);
       }
       else
       {
-         actionsType_.push_back(type);
-         actionsData_.push_back(data);
+         pushAction(type, data);
       }
    }
    END_LOCK_MUTEX
@@ -126,32 +192,55 @@ void ConsoleActions::reset()
    LOCK_MUTEX(mutex_)
    {
       // clear the existing actions
-      actionsType_.clear();
-      actionsData_.clear();
+      firstAction_ += actions_.size();
+      actions_.clear();
    }
    END_LOCK_MUTEX
 }
    
 void ConsoleActions::asJson(json::Object* pActions) const
+{
+   std::size_t start;
+   asJson(std::numeric_limits<std::size_t>::max(),
+          std::numeric_limits<std::size_t>::max(),
+          pActions,
+          &start);
+}
+
+void ConsoleActions::asJson(std::size_t end,
+                            std::size_t maxLines,
+                            json::Object* pActions,
+                            std::size_t* pStart) const
 {
    LOCK_MUTEX(mutex_)
    {
       // clear inbound
       pActions->clear();
 
-      // copy actions and insert into destination
-      json::Array actionsType;
-      std::copy(actionsType_.begin(),
-                actionsType_.end(),
-                std::back_inserter(actionsType));
-      pActions->operator[](kActionType) = actionsType;
+      // find the range of actions to include
+      std::size_t endIndex = std::min(
+               end > firstAction_ ? end - firstAction_ : 0,
+               actions_.size());
+      std::size_t startIndex = endIndex;
+      std::size_t lines = 0;
+      while (startIndex > 0 && lines <= maxLines)
+      {
+         const Action& action = actions_[startIndex - 1];
+         lines += actionLines(action.type, action.data);
+         startIndex--;
+      }
 
-      // copy data and insert into destination
+      // copy actions and data into destination
+      json::Array actionsType;
       json::Array actionsData;
-      std::copy(actionsData_.begin(),
-                actionsData_.end(),
-                std::back_inserter(actionsData));
+      for (std::size_t i = startIndex; i < endIndex; i++)
+      {
+         actionsType.push_back(actions_[i].type);
+         actionsData.push_back(actions_[i].data);
+      }
+      pActions->operator[](kActionType) = actionsType;
       pActions->operator[](kActionData) = actionsData;
+      *pStart = firstAction_ + startIndex;
    }
    END_LOCK_MUTEX
 }
@@ -160,76 +249,91 @@ Error ConsoleActions::loadFromFile(const FilePath& filePath)
 {
    LOCK_MUTEX(mutex_)
    {
-      actionsType_.clear();
-      actionsData_.clear();
+      firstAction_ = 0;
+      actions_.clear();
 
       if (filePath.exists())
       {
          // read from file
-         std::string actionsJson ;
-         Error error = readStringFromFile(filePath, &actionsJson);
+         std::string actions;
+         Error error = readStringFromFile(filePath, &actions);
          if (error)
             return error ;
 
-         // parse json and confirm it contains an object
-         json::Value value;
-         if ( json::parse(actionsJson, &value) &&
-              (value.type() == json::ObjectType) )
-         {
-            json::Object& actions = value.get_obj();
-
-            const json::Value& typeValue = actions[kActionType] ;
-            if (typeValue.type() == json::ArrayType)
-            {
-               const json::Array& actionsType = typeValue.get_array();
-               std::copy(actionsType.begin(),
-                         actionsType.end(),
-                         std::back_inserter(actionsType_));
-            }
-            else
-            {
-               LOG_WARNING_MESSAGE("unexpected json type in: " + actionsJson);
-            }
-
-            json::Value& dataValue = actions[kActionData] ;
-            if ( dataValue.type() == json::ArrayType )
-            {
-               const json::Array& actionsData = dataValue.get_array();
-               std::copy(actionsData.begin(),
-                         actionsData.end(),
-                         std::back_inserter(actionsData_));
-            }
-            else
-            {
-               LOG_WARNING_MESSAGE("unexpected json type in: " + actionsJson);
-            }
-         }
-         else
-         {
-            LOG_WARNING_MESSAGE("unexpected json type in: " + actionsJson);
-         }
+         if (!boost::algorithm::starts_with(actions, kActionsFileHeader))
+            return loadFromJson(actions);
+
+         int type;
+         std::string data;
+         std::size_t pos = std::strlen(kActionsFileHeader);
+         while (readAction(actions, &pos, &type, &data))
+            pushAction(type, data);
+
+         if (pos != actions.size())
+            LOG_WARNING_MESSAGE("truncated console actions in " +
+                                filePath.absolutePath());
       }
    }
    END_LOCK_MUTEX
    
    return Success();
 }
+
+Error ConsoleActions::loadFromJson(const std::string& actionsJson)
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+
+   // parse json and confirm it contains an object
+   json::Value value;
+   if (!json::parse(actionsJson, &value) || value.type() != json::ObjectType)
+   {
+      LOG_WARNING_MESSAGE("unexpected json type in: " + actionsJson);
+      return Success();
+   }
+
+   json::Object& actions = value.get_obj();
+   const json::Value& typeValue = actions[kActionType];
+   const json::Value& dataValue = actions[kActionData];
+   if (typeValue.type() != json::ArrayType ||
+       dataValue.type() != json::ArrayType)
+   {
+      LOG_WARNING_MESSAGE("unexpected json type in: " + actionsJson);
+      return Success();
+   }
+
+   const json::Array& actionsType = typeValue.get_array();
+   const json::Array& actionsData = dataValue.get_array();
+   for (std::size_t i = 0;
+        i < actionsType.size() && i < actionsData.size();
+        i++)
+   {
+      if (actionsType[i].type() == json::IntegerType &&
+          actionsData[i].type() == json::StringType)
+      {
+         pushAction(actionsType[i].get_int(), actionsData[i].get_str());
+      }
+   }
+
+   return Success();
+}
    
 Error ConsoleActions::saveToFile(const core::FilePath& filePath) const
 {
    // write actions
-   json::Object actionsObject;
-   asJson(&actionsObject);
-   std::ostringstream ostr ;
-   json::writeFormatted(actionsObject, ostr);
+   std::string actions(kActionsFileHeader);
+   LOCK_MUTEX(mutex_)
+   {
+      BOOST_FOREACH(const Action& action, actions_)
+      {
+         writeAction(action.type, action.data, &actions);
+      }
+   }
+   END_LOCK_MUTEX
    
    // write to file
-   return writeStringToFile(filePath, ostr.str());
+   return writeStringToFile(filePath, actions);
 }
    
 } // namespace session
 } // namespace r
 } // namespace rstudio
-
-
-
@@ -15,6 +15,7 @@
 
 #include <boost/bind.hpp>
 
+#include <core/StartupTrace.hpp>
 #include <core/system/Environment.hpp>
 
 #include <r/RExec.hpp>
@@ -225,6 +226,7 @@ Error initialize()
    r::session::consoleHistory().setCapacityFromRHistsize();
 
    // install R tools
+   core::startup_trace::Timestamp toolsStart = core::startup_trace::now();
    FilePath toolsFilePath = utils::rSourcePath().complete("Tools.R");
    Error error = r::sourceManager().sourceTools(toolsFilePath);
    if (error)
@@ -235,6 +237,7 @@ Error initialize()
    error = r::sourceManager().sourceTools(apiFilePath);
    if (error)
       return error;
+   core::startup_trace::record("R tools", "r", toolsStart);
 
    // initialize graphics device -- use a stable directory for server mode
    // and temp directory for desktop mode (so that we can support multiple
@@ -264,6 +267,7 @@ Error initialize()
       
    // restore suspended session if we have one
    bool wasResumed = false;
+   core::startup_trace::Timestamp restoreStart = core::startup_trace::now();
    
    // first check for a pending restart
    if (restartContext().hasSessionState())
@@ -305,6 +309,8 @@ Error initialize()
       s_deferredDeserializationAction = deferredRestoreNewSession;
    }
    
+   core::startup_trace::record("restore session", "r", restoreStart);
+
    // initialize client
    RInitInfo rInitInfo(wasResumed);
    error = rCallbacks().init(rInitInfo);
@@ -368,6 +374,7 @@ void ensureDeserialized()
    if (s_deferredDeserializationAction)
    {
       // do the deferred action
+      core::startup_trace::Scope scope("deferred restore", "deferred");
       s_deferredDeserializationAction();
       s_deferredDeserializationAction.clear();
    }
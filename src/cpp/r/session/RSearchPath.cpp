@@ -55,6 +55,7 @@ namespace search_path {
 namespace {   
 
 const char * const kEnvironmentFile = "environment";
+const char * const kEnvironmentDatabase = "environment_db";
 const char * const kSearchPathDir = "search_path";
    
 const char * const kSearchPathElementsDir = "search_path_elements";
@@ -80,16 +81,34 @@ void reportRestoreError(const std::string& context,
    REprintf(report.c_str());
 }   
    
-Error saveGlobalEnvironmentToFile(const FilePath& environmentFile)
+Error saveGlobalEnvironmentToDatabase(const FilePath& statePath)
 {
-   std::string envPath =
-            string_utils::utf8ToSystem(environmentFile.absolutePath());
-   return executeSafely(boost::bind(R_SaveGlobalEnvToFile, envPath.c_str()));
+   FilePath databaseBase = statePath.complete(kEnvironmentDatabase);
+   Error error = RFunction(".rs.saveGlobalEnvironmentDatabase",
+                           databaseBase.absolutePath()).call();
+   if (error)
+      return error;
+
+   // remove any environment saved in the format used by older versions
+   return statePath.complete(kEnvironmentFile).removeIfExists();
 }
    
-Error restoreGlobalEnvironment(const core::FilePath& environmentFile)
+Error restoreGlobalEnvironment(const FilePath& statePath)
 {
+   // bind the saved values lazily (so a large workspace doesn't hold up
+   // the restore); they're read from the session's own link to the
+   // database, as the state directory may be removed once restored
+   FilePath databaseBase = statePath.complete(kEnvironmentDatabase);
+   FilePath databaseIndex = statePath.complete(
+                                 std::string(kEnvironmentDatabase) + ".rdx");
+   if (databaseIndex.exists())
+   {
+      return RFunction(".rs.restoreGlobalEnvironmentDatabase",
+                       databaseBase.absolutePath()).call();
+   }
+
    // tolerate no environment saved
+   FilePath environmentFile = statePath.complete(kEnvironmentFile);
    if (!environmentFile.exists())
       return Success();
    
@@ -229,8 +248,7 @@ void attachEnvironmentData(const FilePath& dataFilePath,
 Error save(const FilePath& statePath)
 {
    // save the global environment
-   FilePath environmentFile = statePath.complete(kEnvironmentFile);
-   Error error = saveGlobalEnvironmentToFile(environmentFile);
+   Error error = saveGlobalEnvironmentToDatabase(statePath);
    if (error)
       return error;
    
@@ -322,8 +340,7 @@ Error save(const FilePath& statePath)
 
 Error saveGlobalEnvironment(const FilePath& statePath)
 {
-   FilePath environmentFile = statePath.complete(kEnvironmentFile);
-   return saveGlobalEnvironmentToFile(environmentFile);
+   return saveGlobalEnvironmentToDatabase(statePath);
 }
 
 Error restoreSearchPath(const FilePath& statePath)
@@ -402,8 +419,7 @@ Error restoreSearchPath(const FilePath& statePath)
 Error restore(const FilePath& statePath, bool isCompatibleSessionState)
 {
    // restore global environment
-   FilePath environmentFile = statePath.complete(kEnvironmentFile);
-   Error error = restoreGlobalEnvironment(environmentFile);
+   Error error = restoreGlobalEnvironment(statePath);
    if (error)
       return error;
    
@@ -1274,6 +1274,9 @@ SEXP cap(pDevDesc dd)
    int engineVersion = ::R_GE_getVersion();
    switch(engineVersion)
    {
+   case 5:
+      pCapFn = NULL;
+      break;
    case 6:
       pCapFn = ((DevDescVersion6*)dd)->cap;
       break;
@@ -1294,6 +1297,10 @@ SEXP cap(pDevDesc dd)
       break;
    }
 
+   // devices which can't capture their contents have no cap function
+   if (pCapFn == NULL)
+      return R_NilValue;
+
    // call it
    return pCapFn(dd);
 }
@@ -18,12 +18,14 @@
 #include <cstdlib>
 
 #include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
 #include <core/FileSerializer.hpp>
 
 #include <r/RExec.hpp>
+#include <r/ROptions.hpp>
 #include <r/RRoutines.hpp>
 #include <r/RErrorCategory.hpp>
 #include <r/RUtil.hpp>
@@ -74,6 +76,17 @@ boost::function<bool(double*,double*)> s_locatorFunction;
 int s_width = 0;
 int s_height = 0;   
 double s_devicePixelRatio = 1.0;
+
+// size requested by the client but not yet applied to the device. resizing
+// replays the display list, so rather than replaying on every request (e.g.
+// as the plots pane is dragged) we wait until the size has settled and then
+// replay once at the latest size
+const int kResizeDelayMs = 100;
+bool s_resizePending = false;
+int s_pendingWidth = 0;
+int s_pendingHeight = 0;
+double s_pendingDevicePixelRatio = 1.0;
+boost::posix_time::ptime s_resizeRequestTime;
    
 // provide GraphicsDeviceEvents for plot manager
 GraphicsDeviceEvents s_graphicsDeviceEvents;   
@@ -91,6 +104,12 @@ void GD_NewPage(const pGEcontext gc, pDevDesc dev)
    // fire event (pass previousPageSnapshot)
    SEXP previousPageSnapshot = s_pGEDevDesc->savedSnapshot;
    s_graphicsDeviceEvents.onNewPage(previousPageSnapshot);
+
+   // the plot manager has now written the previous page to disk (if it
+   // needed to), so release the graphics engine's copy of it rather than
+   // holding the previous page's entire display list in memory until the
+   // next new page (nothing else reads the saved snapshot of our device)
+   s_pGEDevDesc->savedSnapshot = R_NilValue;
 }
 
 Rboolean GD_NewFrameConfirm(pDevDesc dd)
@@ -425,6 +444,38 @@ void resizeGraphicsDevice()
    // notify listeners of resize
    s_graphicsDeviceEvents.onResized();
 }   
+
+bool hasPendingResize()
+{
+   return s_resizePending;
+}
+
+// apply the pending size, if any, once it has been stable for kResizeDelayMs
+// (or immediately if force is set). returns true if the size was applied
+bool applyPendingResize(bool force)
+{
+   if (!s_resizePending)
+      return false;
+
+   using namespace boost::posix_time;
+   if (!force &&
+       (s_resizeRequestTime + milliseconds(kResizeDelayMs) >
+        microsec_clock::universal_time()))
+   {
+      return false;
+   }
+
+   s_resizePending = false;
+   s_width = s_pendingWidth;
+   s_height = s_pendingHeight;
+   s_devicePixelRatio = s_pendingDevicePixelRatio;
+
+   // if there is a device active sync its size
+   if (s_pGEDevDesc != NULL)
+      resizeGraphicsDevice();
+
+   return true;
+}
    
 // routine which creates device  
 SEXP createGD()
@@ -449,6 +500,8 @@ SEXP createGD()
       return R_NilValue;
    }
 
+   // create the device at the latest requested size
+   applyPendingResize(true);
 
    R_CheckDeviceAvailable();
    
@@ -616,6 +669,43 @@ void deviceToNDC(double* x, double* y)
    *y = grconvertY(*y, "device", "ndc");
 }
 
+// plots are sent to the client as png by default. if options(rstudio.plots.svg
+// = TRUE) is set (and R has a cairo svg device) they are sent as svg instead,
+// which the client can rescale without another round trip and which is
+// usually much smaller than a high-dpi png
+bool useSvgImages()
+{
+   if (!r::options::getOption<bool>("rstudio.plots.svg", false, false))
+      return false;
+
+   static bool s_checkedSvg = false;
+   static bool s_hasSvg = false;
+   if (!s_checkedSvg)
+   {
+      s_checkedSvg = true;
+      Error error = r::exec::evaluateString("isTRUE(capabilities(\"cairo\"))",
+                                            &s_hasSvg);
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   return s_hasSvg;
+}
+
+Error writeToSVG(const core::FilePath& imageFile)
+{
+   // the svg device becomes active while we write, restore ours afterwards
+   RestorePreviousGraphicsDeviceScope restoreScope;
+
+   // svg dimensions are in inches
+   const double kPixelsPerInch = 96.0;
+   return r::exec::RFunction(".rs.saveGraphicsSvg",
+                             string_utils::utf8ToSystem(imageFile.absolutePath()),
+                             s_width / kPixelsPerInch,
+                             s_height / kPixelsPerInch,
+                             GEdeviceNumber(s_pGEDevDesc)).call();
+}
+
 Error saveSnapshot(const core::FilePath& snapshotFile,
                    const core::FilePath& imageFile)
 {
@@ -630,6 +720,10 @@ Error saveSnapshot(const core::FilePath& snapshotFile,
    if (error)
       return error;
 
+   // save svg file
+   if (imageFile.extensionLowerCase() == ".svg")
+      return writeToSVG(imageFile);
+
    // save png file
    DeviceContext* pDC = (DeviceContext*)s_pGEDevDesc->dev->deviceSpecific;
    return handler::writeToPNG(imageFile, pDC);
@@ -655,7 +749,7 @@ void copyToActiveDevice()
    
 std::string imageFileExtension()
 {
-   return "png";
+   return useSvgImages() ? "svg" : "png";
 }
 
 void onBeforeExecute()
@@ -705,6 +799,8 @@ Error initialize(
    graphicsDevice.imageFileExtension = imageFileExtension;
    graphicsDevice.close = close;
    graphicsDevice.onBeforeExecute = onBeforeExecute;
+   graphicsDevice.hasPendingResize = hasPendingResize;
+   graphicsDevice.applyPendingResize = applyPendingResize;
    Error error = plotManager().initialize(graphicsPath,
                                           graphicsDevice,
                                           &s_graphicsDeviceEvents);
@@ -750,18 +846,25 @@ Error initialize(
 
 void setSize(int width, int height, double devicePixelRatio)
 {
-   // only set if the values have changed (prevents unnecessary plot 
-   // invalidations from occuring)
-   if ( width != s_width || height != s_height || devicePixelRatio != s_devicePixelRatio)
+   // if the requested size is the current size then there is nothing to do
+   // (prevents unnecessary plot invalidations from occuring); this also
+   // cancels any pending resize to another size
+   if ( width == s_width && height == s_height && devicePixelRatio == s_devicePixelRatio)
    {
-      s_width = width;
-      s_height = height;
-      s_devicePixelRatio = devicePixelRatio;
-      
-      // if there is a device active sync its size
-      if (s_pGEDevDesc != NULL)
-         resizeGraphicsDevice();
+      s_resizePending = false;
+      return;
    }
+
+   // a newer size replaces any which is still pending
+   s_pendingWidth = width;
+   s_pendingHeight = height;
+   s_pendingDevicePixelRatio = devicePixelRatio;
+   s_resizeRequestTime = boost::posix_time::microsec_clock::universal_time();
+   s_resizePending = true;
+
+   // without a device there is nothing to replay, so apply immediately
+   if (s_pGEDevDesc == NULL)
+      applyPendingResize(true);
 }
    
 int getWidth()
@@ -18,9 +18,13 @@
 #include <iostream>
 
 #include <boost/format.hpp>
+#include <boost/unordered_map.hpp>
 
 #include <core/Error.hpp>
 #include <core/Log.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Hash.hpp>
+#include <core/SafeConvert.hpp>
 
 #include <core/system/System.hpp>
 #include <core/StringUtils.hpp>
@@ -34,6 +38,76 @@ namespace rstudio {
 namespace r {
 namespace session {
 namespace graphics {
+
+namespace {
+
+// plot files we have written, keyed by their contents (extension, size, and
+// checksum). identical plots (e.g. the same plot drawn twice, or a snapshot
+// which is unchanged by a resize) share a single copy of their files on disk
+typedef boost::unordered_map<std::string, FilePath> PlotFileIndex;
+PlotFileIndex s_plotFileIndex;
+
+// replace the given (newly written) plot file with a hard link to an existing
+// plot file with identical contents, if there is one. since each plot removes
+// only its own links, the shared contents remain until the last plot using
+// them is removed
+void shareIdenticalPlotFile(const FilePath& filePath)
+{
+   if (!filePath.exists())
+      return;
+
+   std::string checksum;
+   Error error = hash::crc32cHexHash(filePath, &checksum);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   std::string key = filePath.extension() + ":" +
+                     safe_convert::numberToString(filePath.size()) + ":" +
+                     checksum;
+
+   PlotFileIndex::iterator it = s_plotFileIndex.find(key);
+   if (it == s_plotFileIndex.end() ||
+       it->second == filePath ||
+       !it->second.exists())
+   {
+      s_plotFileIndex[key] = filePath;
+      return;
+   }
+
+   // confirm the match (the checksum is only a hint)
+   std::string contents, existingContents;
+   error = readStringFromFile(filePath, &contents);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+   error = readStringFromFile(it->second, &existingContents);
+   if (error || existingContents != contents)
+      return;
+
+   error = filePath.remove();
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   // if we can't link (e.g. the filesystem doesn't support it) then just
+   // write our own copy back
+   error = it->second.link(filePath);
+   if (error)
+   {
+      error = writeStringToFile(filePath, contents);
+      if (error)
+         LOG_ERROR(error);
+   }
+}
+
+} // anonymous namespace
       
 Plot::Plot(const GraphicsDeviceFunctions& graphicsDevice,
            const FilePath& baseDirPath,
@@ -137,6 +211,10 @@ Error Plot::renderFromDisplay()
                                               imageFilePath(storageUuid));
    if (error)
       return Error(errc::PlotRenderingError, error, ERROR_LOCATION);
+
+   // share storage with identical plots
+   shareIdenticalPlotFile(snapshotFilePath(storageUuid));
+   shareIdenticalPlotFile(imageFilePath(storageUuid));
    
    // save rendered size
    renderedSize_ = graphicsDevice_.displaySize();
@@ -174,6 +252,9 @@ Error Plot::renderFromDisplaySnapshot(SEXP snapshot)
    if (error)
       return error ;
 
+   // share storage with identical plots
+   shareIdenticalPlotFile(snapshotFile);
+
    //
    // we can't generate an image file at this point in the processing
    // because the GraphicsDevice has already moved on to the next page. this is
@@ -16,6 +16,7 @@
 #include "RGraphicsPlotManager.hpp"
 
 #include <algorithm>
+#include <set>
 
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
@@ -52,6 +53,23 @@ double pixelsToInches(int pixels)
    return (double)pixels / 96.0;
 }
 
+// default number of plots retained in the plot history
+const int kDefaultMaxPlots = 100;
+
+// the number of plots to retain, from options(rstudio.plots.max)
+int maxPlotsOption()
+{
+   SEXP maxPlotsSEXP = r::options::getOption("rstudio.plots.max");
+   if (maxPlotsSEXP == R_NilValue || r::sexp::length(maxPlotsSEXP) < 1)
+      return kDefaultMaxPlots;
+
+   int maxPlots = r::sexp::asInteger(maxPlotsSEXP);
+   if (maxPlots == NA_INTEGER || maxPlots < 1)
+      return kDefaultMaxPlots;
+
+   return maxPlots;
+}
+
 } // anonymous namespace
 
 const char * const kPngFormat = "png";
@@ -81,7 +99,7 @@ PlotManager::PlotManager()
       activePlot_(-1),
       plotInfoRegex_("([A-Za-z0-9\\-]+):([0-9]+),([0-9]+)")
 {
-   plots_.set_capacity(100);
+   plots_.set_capacity(kDefaultMaxPlots);
 }
       
 Error PlotManager::initialize(const FilePath& graphicsPath,
@@ -431,7 +449,8 @@ bool PlotManager::hasOutput() const
     
 bool PlotManager::hasChanges() const
 {
-   return displayHasChanges_ ;
+   // a pending resize will change the display once it is applied
+   return displayHasChanges_ || graphicsDevice_.hasPendingResize();
 }
 
 bool PlotManager::isActiveDevice() const
@@ -446,6 +465,12 @@ boost::posix_time::ptime PlotManager::lastChange() const
    
 void PlotManager::render(boost::function<void(DisplayState)> outputFunction)
 {
+   // if the device size is still changing then wait for it to settle before
+   // rendering (we'll be called again as part of background processing)
+   graphicsDevice_.applyPendingResize(false);
+   if (graphicsDevice_.hasPendingResize())
+      return;
+
    // make sure the graphics path exists (may have been blown away
    // by call to dev.off or other call to removeAllPlots)
    Error error = graphicsPath_.ensureDirectory();
@@ -560,6 +585,9 @@ void PlotManager::manipulatorPlotClicked(int x, int y)
 
 void PlotManager::onBeforeExecute()
 {
+   // make sure code which is about to run sees the current device size
+   graphicsDevice_.applyPendingResize(true);
+
    graphicsDevice_.onBeforeExecute();
 }
 
@@ -674,23 +702,59 @@ Error PlotManager::restorePlotsState()
 
 namespace {
 
-Error copyDirectory(const FilePath& srcDir, const FilePath& targetDir)
+// bring the target directory up to date with the source directory. plot
+// files are never modified once written (a re-rendered plot gets a new
+// storage uuid) so only files which are new (or whose size or modification
+// time differs) need to be copied, and files which are gone from the source
+// are removed from the target
+Error syncDirectory(const FilePath& srcDir, const FilePath& targetDir)
 {
-   Error error = targetDir.removeIfExists();
+   Error error = targetDir.ensureDirectory();
    if (error)
       return error;
 
-   error = targetDir.ensureDirectory();
+   std::vector<FilePath> srcFiles;
+   error = srcDir.children(&srcFiles);
    if (error)
       return error;
 
-   std::vector<FilePath> srcFiles;
-   error = srcDir.children(&srcFiles);
+   std::vector<FilePath> targetFiles;
+   error = targetDir.children(&targetFiles);
    if (error)
       return error;
+
+   std::set<std::string> srcFilenames;
+   BOOST_FOREACH(const FilePath& srcFile, srcFiles)
+   {
+      srcFilenames.insert(srcFile.filename());
+   }
+
+   BOOST_FOREACH(const FilePath& targetFile, targetFiles)
+   {
+      if (srcFilenames.find(targetFile.filename()) == srcFilenames.end())
+      {
+         Error error = targetFile.removeIfExists();
+         if (error)
+            return error;
+      }
+   }
+
    BOOST_FOREACH(const FilePath& srcFile, srcFiles)
    {
       FilePath targetFile = targetDir.complete(srcFile.filename());
+      if (targetFile.exists())
+      {
+         if (targetFile.size() == srcFile.size() &&
+             targetFile.lastWriteTime() >= srcFile.lastWriteTime())
+         {
+            continue;
+         }
+
+         Error error = targetFile.remove();
+         if (error)
+            return error;
+      }
+
       Error error = srcFile.copy(targetFile);
       if (error)
          return error;
@@ -708,14 +772,14 @@ Error PlotManager::serialize(const FilePath& saveToPath)
    if (error)
       return error;
 
-   // copy the plots dir to the save to path
-   return copyDirectory(graphicsPath_, saveToPath);
+   // bring the save to path up to date with the plots dir
+   return syncDirectory(graphicsPath_, saveToPath);
 }
 
 Error PlotManager::deserialize(const FilePath& restoreFromPath)
 {
-   // copy the restoreFromPath to the graphics path
-   Error error = copyDirectory(restoreFromPath, graphicsPath_);
+   // bring the graphics path up to date with the restoreFromPath
+   Error error = syncDirectory(restoreFromPath, graphicsPath_);
    if (error)
       return error;
 
@@ -772,6 +836,9 @@ void PlotManager::onDeviceNewPage(SEXP previousPageSnapshot)
                                graphicsPath_,
                                plotManipulatorManager().pendingManipulatorSEXP()));
 
+      // apply the current limit on the number of plots
+      applyMaxPlots(maxPlotsOption());
+
       // if we're full then remove the first plot's files before adding a new one
       if (plots_.full())
       {
@@ -792,6 +859,25 @@ void PlotManager::onDeviceNewPage(SEXP previousPageSnapshot)
    invalidateActivePlot();
 }
 
+void PlotManager::applyMaxPlots(int maxPlots)
+{
+   if (static_cast<int>(plots_.capacity()) == maxPlots)
+      return;
+
+   // drop the oldest plots beyond the new limit (shrinking the circular
+   // buffer itself would drop the newest)
+   while (static_cast<int>(plots_.size()) > maxPlots)
+   {
+      Error error = plots_.front()->removeFiles();
+      if (error)
+         LOG_ERROR(error);
+      plots_.pop_front();
+      activePlot_ = std::max(activePlot_ - 1, 0);
+   }
+
+   plots_.set_capacity(maxPlots);
+}
+
 void PlotManager::onDeviceDrawing()
 {
    if (suppressDeviceEvents_)
@@ -138,6 +138,9 @@ private:
    void onDeviceResized();
    void onDeviceClosed();
    
+   // limit the plot history to the given number of plots
+   void applyMaxPlots(int maxPlots);
+
    // active plot 
    Plot& activePlot() const;
    bool isValidPlotIndex(int index) const;
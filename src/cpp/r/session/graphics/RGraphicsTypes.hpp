@@ -73,6 +73,8 @@ struct GraphicsDeviceFunctions
    boost::function<std::string()> imageFileExtension;
    boost::function<void()> close;
    boost::function<void()> onBeforeExecute;
+   boost::function<bool()> hasPendingResize;
+   boost::function<bool(bool)> applyPendingResize;
 };  
 
 
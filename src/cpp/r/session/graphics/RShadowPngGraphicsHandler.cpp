@@ -18,10 +18,14 @@
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
 
+#include <core/FileSerializer.hpp>
+#include <core/PngEncoder.hpp>
 #include <core/system/System.hpp>
 #include <core/StringUtils.hpp>
 
 #include <r/RExec.hpp>
+#include <r/ROptions.hpp>
+#include <r/RSexp.hpp>
 #include <r/session/RSessionUtils.hpp>
 #include <r/session/RGraphics.hpp>
 
@@ -201,6 +205,75 @@ void shadowDevSync(DeviceContext* pDC)
    }
 }
 
+// capture the contents of the shadow device and encode them as png
+// ourselves, which spares closing the device to have it write a file (and
+// then re-creating it and replaying the display list onto it again). this
+// is also faster than the device's own png encoding as it compresses less
+// (see options(rstudio.plots.pngCompression)). returns false if the device
+// can't capture its contents
+bool captureToPNG(const FilePath& targetPath, DeviceContext* pDC)
+{
+   pDevDesc dev = NULL;
+   Error error = shadowDevDesc(pDC, &dev);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+
+   SEXP rasterSEXP = R_NilValue;
+   error = r::exec::executeSafely<SEXP>(boost::bind(dev_desc::cap, dev),
+                                        &rasterSEXP);
+   if (error)
+   {
+      if (!r::isCodeExecutionError(error))
+         LOG_ERROR(error);
+      return false;
+   }
+
+   if (TYPEOF(rasterSEXP) != INTSXP)
+      return false;
+   r::sexp::Protect rProtect(rasterSEXP);
+
+   // the raster is a matrix of colors with a row per row of pixels, which
+   // should match the size of the device
+   SEXP dimSEXP = r::sexp::getAttrib(rasterSEXP, R_DimSymbol);
+   if (TYPEOF(dimSEXP) != INTSXP || r::sexp::length(dimSEXP) != 2)
+      return false;
+
+   int height = INTEGER(dimSEXP)[0];
+   int width = INTEGER(dimSEXP)[1];
+   if (width != static_cast<int>(pDC->width * pDC->devicePixelRatio) ||
+       height != static_cast<int>(pDC->height * pDC->devicePixelRatio) ||
+       r::sexp::length(rasterSEXP) != width * height)
+   {
+      return false;
+   }
+
+   int compressionLevel = r::options::getOption<int>(
+            "rstudio.plots.pngCompression",
+            png::kFastestCompression,
+            false);
+
+   std::string png;
+   error = png::encodeRgba(
+            reinterpret_cast<const boost::uint32_t*>(INTEGER(rasterSEXP)),
+            width,
+            height,
+            compressionLevel,
+            &png);
+   if (!error)
+      error = writeStringToFile(targetPath, png);
+
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+
+   return true;
+}
+
 } // anonymous namespace
 
 
@@ -226,8 +299,12 @@ DeviceContext* allocate(pDevDesc dev)
 
 void destroy(DeviceContext* pDC)
 {
-   // nix the shadow device
+   // nix the shadow device (which writes its file, unless that was
+   // already done by writeToPNG)
    shadowDevOff(pDC);
+   Error error = pDC->targetPath.removeIfExists();
+   if (error)
+      LOG_ERROR(error);
 
    // delete pointers
    ShadowDeviceData* pDevData = (ShadowDeviceData*)pDC->pDeviceSpecific;
@@ -275,6 +352,9 @@ Error writeToPNG(const FilePath& targetPath, DeviceContext* pDC)
    // sync the shadow device to ensure we have the full playlist,
    shadowDevSync(pDC);
 
+   if (captureToPNG(targetPath, pDC))
+      return Success();
+
    // turn the shadow device off to write the file
    shadowDevOff(pDC);
 
@@ -17,6 +17,7 @@
 
 #include <core/Error.hpp>
 
+#include <core/http/ContentEncoding.hpp>
 #include <core/http/TcpIpAsyncServer.hpp>
 
 #include <server/ServerOptions.hpp>
@@ -28,7 +29,16 @@ namespace server {
 
 http::AsyncServer* httpServerCreate()
 {
-   return new http::TcpIpAsyncServer("RStudio");
+   Options& options = server::options();
+   http::setCompressionLevel(options.wwwCompressionLevel());
+
+   http::AsyncServer* pAsyncServer =
+                     new http::TcpIpAsyncServer("RStudio",
+                                                std::string(),
+                                                options.wwwKeepAliveOptions());
+   pAsyncServer->setIoServicePerThread(options.wwwIoServicePerThread(),
+                                       options.wwwThreadPoolSize());
+   return pAsyncServer;
 }
 
 Error httpServerInit(http::AsyncServer* pAsyncServer)
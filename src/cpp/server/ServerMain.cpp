@@ -21,6 +21,7 @@
 #include <core/LogWriter.hpp>
 #include <core/ProgramStatus.hpp>
 #include <core/ProgramOptions.hpp>
+#include <core/Trace.hpp>
 
 #include <core/text/TemplateFilter.hpp>
 
@@ -50,6 +51,8 @@
 #include <server/ServerSessionProxy.hpp>
 #include <server/ServerSessionManager.hpp>
 #include <server/ServerProcessSupervisor.hpp>
+#include <server/ServerSessionConnectionPool.hpp>
+#include <server/ServerRequestMetrics.hpp>
 
 #include "ServerAddins.hpp"
 #include "ServerBrowser.hpp"
@@ -478,6 +481,25 @@ int main(int argc, char * const argv[])
       if (error)
          return core::system::exitFailure(error, ERROR_LOCATION);
 
+      // initialize tracing (sessions export to the same directory so it is
+      // shared as /tmp is)
+      if (options.serverTraceSampleRate() > 0)
+      {
+         FilePath traceDir(options.serverTraceDir());
+         error = core::trace::initialize(kProgramIdentity,
+                                         options.serverTraceSampleRate(),
+                                         traceDir);
+         if (!error)
+         {
+            error = core::system::changeFileMode(
+                        traceDir,
+                        core::system::EveryoneReadWriteExecuteMode,
+                        true);
+         }
+         if (error)
+            LOG_ERROR(error);
+      }
+
       // initialize crypto utils
       core::system::crypto::initialize();
 
@@ -512,6 +534,21 @@ int main(int argc, char * const argv[])
       core::system::addLogWriter(
                 monitor::client().createLogWriter(kProgramIdentity));
 
+      // initialize session connection pool (reports metrics to the monitor)
+      error = session_connection_pool::initialize();
+      if (error)
+         return core::system::exitFailure(error, ERROR_LOCATION);
+
+      // initialize session launch admission (uses the scheduler)
+      error = sessionManager().initialize();
+      if (error)
+         return core::system::exitFailure(error, ERROR_LOCATION);
+
+      // initialize request metrics (also reported to the monitor)
+      error = request_metrics::initialize();
+      if (error)
+         return core::system::exitFailure(error, ERROR_LOCATION);
+
       // call overlay initialize
       error = overlay::initialize();
       if (error)
@@ -27,6 +27,8 @@
 #include <core/system/PosixUser.hpp>
 #include <core/system/PosixSystem.hpp>
 
+#include <core/http/ContentEncoding.hpp>
+
 #include <monitor/MonitorConstants.hpp>
 
 using namespace rstudio::core ;
@@ -197,7 +199,14 @@ ProgramStatus Options::read(int argc,
          "run program as daemon")
       ("server-set-umask",
          value<bool>(&serverSetUmask_)->default_value(1),
-         "set the umask to 022 on startup");
+         "set the umask to 022 on startup")
+      ("server-trace-sample-rate",
+         value<double>(&serverTraceSampleRate_)->default_value(0),
+         "fraction of requests traced through rserver and rsession (0 to disable)")
+      ("server-trace-dir",
+         value<std::string>(&serverTraceDir_)->default_value(
+                                                "/var/lib/rstudio-server/traces"),
+         "directory to which traces are exported (as OTLP/JSON)");
 
    // www - web server options
    options_description www("www") ;
@@ -221,6 +230,29 @@ ProgramStatus Options::read(int argc,
       ("www-thread-pool-size",
          value<int>(&wwwThreadPoolSize_)->default_value(2),
          "thread pool size")
+      ("www-io-service-per-thread",
+         value<bool>(&wwwIoServicePerThread_)->default_value(false),
+         "run each thread with its own io_service and listening socket")
+      ("www-compression-level",
+         value<int>(&wwwCompressionLevel_)->default_value(
+                                          http::kDefaultCompressionLevel),
+         "compression level for responses (1-9)")
+      ("www-proxy-buffer-size",
+         value<int>(&wwwProxyBufferSize_)->default_value(
+             static_cast<int>(core::http::SocketProxyOptions::kDefaultBufferSize)),
+         "bytes buffered in each direction of proxied websocket connections")
+      ("www-proxy-splice",
+         value<bool>(&wwwProxySplice_)->default_value(false),
+         "use splice to move data for proxied websocket connections")
+      ("www-proxy-asset-cache-mb",
+         value<int>(&wwwProxyAssetCacheMb_)->default_value(128),
+         "memory (mb) used to cache static assets of proxied local servers (0 to disable)")
+      ("www-keep-alive-max-requests",
+         value<int>(&wwwKeepAliveMaxRequests_)->default_value(100),
+         "maximum requests per persistent connection (0 to disable)")
+      ("www-keep-alive-timeout-secs",
+         value<int>(&wwwKeepAliveTimeoutSecs_)->default_value(15),
+         "idle timeout for persistent connections")
       ("www-proxy-localhost",
          value<bool>(&wwwProxyLocalhost_)->default_value(true),
          "proxy requests to localhost ports over main server port")
@@ -253,6 +285,42 @@ ProgramStatus Options::read(int argc,
       ("rsession-proxy-max-wait-secs",
         value<int>(&rsessionProxyMaxWaitSeconds_)->default_value(10),
          "max time to wait when proxying requests to rsession")
+      ("rsession-proxy-pool-size",
+        value<int>(&rsessionProxyPoolSize_)->default_value(4),
+         "max idle connections kept open to each rsession (0 to disable)")
+      ("rsession-prelaunch-on-sign-in",
+        value<bool>(&rsessionPrelaunchOnSignIn_)->default_value(false),
+         "start a user's rsession as soon as they sign in")
+      ("rsession-max-concurrent-launches",
+        value<int>(&rsessionMaxConcurrentLaunches_)->default_value(0),
+         "max rsessions starting at once; further launches queue (0 for no limit)")
+      ("rsession-launch-max-load",
+        value<double>(&rsessionLaunchMaxLoad_)->default_value(0),
+         "1 minute load average per core above which launches start one at a time (0 to disable)")
+      ("rsession-launch-min-free-mb",
+        value<int>(&rsessionLaunchMinFreeMb_)->default_value(0),
+         "available memory (mb) below which launches start one at a time (0 to disable)")
+      ("rsession-low-memory-mb",
+        value<int>(&rsessionLowMemoryMb_)->default_value(0),
+         "available memory (mb) below which rsessions release cached data (0 to disable)")
+      ("rsession-suspend-memory-mb",
+        value<int>(&rsessionSuspendMemoryMb_)->default_value(0),
+         "available memory (mb) below which idle rsessions are suspended (0 to disable)")
+      ("rsession-suspend-idle-minutes",
+        value<int>(&rsessionSuspendIdleMinutes_)->default_value(10),
+         "minutes without requests before an rsession may be suspended for memory")
+      ("rsession-cgroup-path",
+        value<std::string>(&rsessionCgroupPath_)->default_value(""),
+         "cgroup (v2) beneath which each rsession gets its own cgroup (empty to disable)")
+      ("rsession-cpu-weight",
+        value<int>(&rsessionCpuWeight_)->default_value(0),
+         "cpu.weight of each rsession cgroup (0 for the kernel default)")
+      ("rsession-memory-high-mb",
+        value<int>(&rsessionMemoryHighMb_)->default_value(0),
+         "memory.high (mb) of each rsession cgroup (0 for no limit)")
+      ("rsession-io-max",
+        value<std::string>(&rsessionIoMax_)->default_value(""),
+         "io.max of each rsession cgroup (';' separated 'MAJ:MIN rbps=... wbps=...' entries)")
       ("rsession-memory-limit-mb",
          value<int>(&dep.memoryLimitMb)->default_value(dep.memoryLimitMb),
          "rsession memory limit (mb) - DEPRECATED")
@@ -293,6 +361,9 @@ ProgramStatus Options::read(int argc,
       ("auth-pam-helper-path",
         value<std::string>(&authPamHelperPath_)->default_value("rserver-pam"),
        "path to PAM helper binary")
+      ("auth-pam-helper-pool-size",
+        value<int>(&authPamHelperPoolSize_)->default_value(4),
+        "max PAM helper processes kept running to authenticate sign ins (0 to disable)")
       ("auth-pam-requires-priv",
         value<bool>(&dep.authPamRequiresPriv)->default_value(
                                                    dep.authPamRequiresPriv),
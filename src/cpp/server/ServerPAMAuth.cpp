@@ -40,6 +40,7 @@
 #include <server/auth/ServerAuthHandler.hpp>
 
 #include <server/ServerOptions.hpp>
+#include <server/ServerPAMHelperPool.hpp>
 #include <server/ServerUriHandlers.hpp>
 #include <server/ServerSessionProxy.hpp>
 
@@ -366,6 +367,7 @@ void doSignIn(const http::Request& request,
    username = auth::handler::userIdentifierToLocalUsername(username);
 
    onUserUnauthenticated(username);
+   server::auth::invalidateUser(username);
 
    if ( pamLogin(username, password) && server::auth::validateUser(username))
    {
@@ -383,6 +385,9 @@ void doSignIn(const http::Request& request,
                               username));
 
       onUserAuthenticated(username, password);
+
+      // get R starting while the client loads
+      session_proxy::prelaunchSession(username);
    }
    else
    {
@@ -421,6 +426,7 @@ void signOut(const http::Request& request,
                               username));
 
       onUserUnauthenticated(username, true);
+      server::auth::invalidateUser(username);
    }
 
    core::http::secure_cookie::remove(request,
@@ -456,6 +462,27 @@ bool pamLogin(const std::string& username, const std::string& password)
       return false;
    }
 
+   // authenticate through a pooled helper when we can (falling back on
+   // running the helper for this login only if the pool couldn't get the
+   // request to a helper; once it has, a second attempt could count twice
+   // against the account, so an error is a failed login)
+   if (pam_helper_pool::enabled())
+   {
+      bool authenticated = false;
+      bool requestSent = false;
+      Error error = pam_helper_pool::login(username,
+                                           password,
+                                           assumeRootPriv,
+                                           &authenticated,
+                                           &requestSent);
+      if (!error)
+         return authenticated;
+
+      LOG_ERROR(error);
+      if (requestSent)
+         return false;
+   }
+
    // options (assume priv after fork)
    core::system::ProcessOptions options;
    options.onAfterFork = assumeRootPriv;
@@ -496,8 +523,13 @@ Error initialize()
    uri_handlers::addBlocking(kDoSignIn, doSignIn);
    uri_handlers::addBlocking(kPublicKey, publicKey);
 
+   // initialize pool of pam helpers
+   Error error = pam_helper_pool::initialize();
+   if (error)
+      return error;
+
    // initialize overlay
-   Error error = overlay::initialize();
+   error = overlay::initialize();
    if (error)
       return error;
 
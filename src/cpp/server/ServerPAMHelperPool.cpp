@@ -0,0 +1,551 @@
+/*
+ * ServerPAMHelperPool.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <server/ServerPAMHelperPool.hpp>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+#include <core/Thread.hpp>
+#include <core/PeriodicCommand.hpp>
+#include <core/system/System.hpp>
+#include <core/system/PosixSystem.hpp>
+
+#include <monitor/MonitorClient.hpp>
+
+#include <server/ServerOptions.hpp>
+#include <server/ServerScheduler.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace server {
+namespace pam_helper_pool {
+
+namespace {
+
+// argument which runs rserver-pam as a persistent helper (see PamMain.cpp)
+const char * const kBrokerArg = "--broker";
+
+// longest a helper may take to answer (PAM modules may consult remote
+// services, e.g. kerberos or ldap)
+const int kLoginTimeoutMs = 30 * 1000;
+
+// longest a login waits for a helper to become free
+const boost::posix_time::time_duration kAcquireTimeout =
+                                          boost::posix_time::seconds(30);
+
+// helpers idle for longer than this are exited
+const boost::posix_time::time_duration kMaxIdleTime =
+                                          boost::posix_time::minutes(10);
+
+// helpers are replaced after this many logins (bounding the effect of
+// anything leaked by PAM modules)
+const std::size_t kMaxLoginsPerHelper = 100;
+
+struct Helper
+{
+   Helper() : pid(-1), fdRequest(-1), fdResponse(-1), logins(0) {}
+
+   pid_t pid;
+   int fdRequest;
+   int fdResponse;
+   std::size_t logins;
+   boost::posix_time::ptime idleSince;
+};
+
+boost::mutex s_mutex;
+boost::condition s_helperReleased;
+
+// idle helpers (most recently released at the back) and the number of
+// helpers running, whether idle or busy
+std::vector<Helper> s_idle;
+std::size_t s_helpers = 0;
+
+Stats s_stats;
+
+boost::posix_time::ptime now()
+{
+   return boost::posix_time::microsec_clock::universal_time();
+}
+
+void exitHelper(const Helper& helper)
+{
+   ::close(helper.fdRequest);
+   ::close(helper.fdResponse);
+
+   // the helper may be stuck in a PAM module so don't wait on it to notice
+   // that its stdin has been closed
+   ::kill(helper.pid, SIGKILL);
+   while (::waitpid(helper.pid, NULL, 0) == -1 && errno == EINTR)
+   {
+   }
+}
+
+// an idle helper should have nothing to read -- if its stdout is readable
+// then it has exited
+bool isStale(const Helper& helper)
+{
+   struct pollfd pfd;
+   pfd.fd = helper.fdResponse;
+   pfd.events = POLLIN;
+   pfd.revents = 0;
+   return ::poll(&pfd, 1, 0) != 0;
+}
+
+Error launchHelper(const boost::function<void()>& onAfterFork,
+                   Helper* pHelper)
+{
+   // everything the child needs is prepared before the fork
+   std::string helperPath = options().authPamHelperPath();
+   char* args[] = { const_cast<char*>(helperPath.c_str()),
+                    const_cast<char*>(kBrokerArg),
+                    NULL };
+
+   RLimitType soft, hard;
+   Error error = core::system::getResourceLimit(core::system::FilesLimit,
+                                                &soft, &hard);
+   if (error)
+      return error;
+
+   int fdRequest[2], fdResponse[2];
+   if (::pipe(fdRequest) == -1)
+      return systemError(errno, ERROR_LOCATION);
+   if (::pipe(fdResponse) == -1)
+   {
+      Error error = systemError(errno, ERROR_LOCATION);
+      ::close(fdRequest[0]);
+      ::close(fdRequest[1]);
+      return error;
+   }
+
+   pid_t pid = ::fork();
+
+   // error
+   if (pid == -1)
+   {
+      Error error = systemError(errno, ERROR_LOCATION);
+      ::close(fdRequest[0]);
+      ::close(fdRequest[1]);
+      ::close(fdResponse[0]);
+      ::close(fdResponse[1]);
+      return error;
+   }
+
+   // child
+   else if (pid == 0)
+   {
+      if (onAfterFork)
+         onAfterFork();
+
+      if (::dup2(fdRequest[0], STDIN_FILENO) == -1 ||
+          ::dup2(fdResponse[1], STDOUT_FILENO) == -1)
+      {
+         ::_exit(EXIT_FAILURE);
+      }
+
+      core::system::signal_safe::closeNonStdFileDescriptors(hard);
+
+      Error error = core::system::clearSignalMask();
+      if (error)
+      {
+         LOG_ERROR(error);
+         // intentionally fail forward
+      }
+
+      ::execv(helperPath.c_str(), args);
+      ::_exit(EXIT_FAILURE);
+   }
+
+   // parent
+   ::close(fdRequest[0]);
+   ::close(fdResponse[1]);
+
+   // keep our ends from other children
+   ::fcntl(fdRequest[1], F_SETFD, FD_CLOEXEC);
+   ::fcntl(fdResponse[0], F_SETFD, FD_CLOEXEC);
+
+   pHelper->pid = pid;
+   pHelper->fdRequest = fdRequest[1];
+   pHelper->fdResponse = fdResponse[0];
+   return Success();
+}
+
+// take an idle helper (or launch one if the pool isn't yet full), waiting
+// for one to be released if need be
+Error acquire(const boost::function<void()>& onAfterFork,
+              Helper* pHelper,
+              bool* pLaunched)
+{
+   std::vector<Helper> stale;
+   bool acquired = false;
+   *pLaunched = false;
+
+   try
+   {
+      boost::unique_lock<boost::mutex> lock(s_mutex);
+      boost::system_time deadline = boost::get_system_time() + kAcquireTimeout;
+      while (!acquired && !*pLaunched)
+      {
+         while (!s_idle.empty())
+         {
+            Helper candidate = s_idle.back();
+            s_idle.pop_back();
+            if (isStale(candidate))
+            {
+               stale.push_back(candidate);
+               s_helpers--;
+               continue;
+            }
+
+            *pHelper = candidate;
+            acquired = true;
+            break;
+         }
+
+         if (acquired)
+            break;
+
+         if (s_helpers < options().authPamHelperPoolSize())
+         {
+            s_helpers++;
+            *pLaunched = true;
+            break;
+         }
+
+         if (!s_helperReleased.timed_wait(lock, deadline))
+            break;
+      }
+   }
+   catch(const boost::thread_resource_error& e)
+   {
+      return Error(boost::thread_error::ec_from_exception(e), ERROR_LOCATION);
+   }
+
+   // exit stale helpers outside of the lock
+   BOOST_FOREACH(const Helper& helper, stale)
+   {
+      exitHelper(helper);
+   }
+
+   if (acquired)
+      return Success();
+
+   if (!*pLaunched)
+      return systemError(boost::system::errc::timed_out, ERROR_LOCATION);
+
+   Error error = launchHelper(onAfterFork, pHelper);
+   LOCK_MUTEX(s_mutex)
+   {
+      if (error)
+      {
+         // give up the place we took in the pool
+         s_helpers--;
+         s_helperReleased.notify_one();
+      }
+      else
+      {
+         s_stats.launches++;
+      }
+   }
+   END_LOCK_MUTEX
+
+   return error;
+}
+
+// return a helper to the pool (exiting it instead if it can't be trusted
+// with another login)
+void release(Helper helper, bool healthy)
+{
+   bool exit = !healthy || helper.logins >= kMaxLoginsPerHelper;
+   if (exit)
+      exitHelper(helper);
+
+   LOCK_MUTEX(s_mutex)
+   {
+      if (exit)
+      {
+         s_helpers--;
+      }
+      else
+      {
+         helper.idleSince = now();
+         s_idle.push_back(helper);
+      }
+      s_helperReleased.notify_one();
+   }
+   END_LOCK_MUTEX
+}
+
+Error writeRequest(int fd, const std::string& request, std::size_t* pWritten)
+{
+   std::size_t& written = *pWritten;
+   written = 0;
+   while (written < request.size())
+   {
+      ssize_t result = ::write(fd,
+                               request.data() + written,
+                               request.size() - written);
+      if (result == -1)
+      {
+         if (errno == EINTR)
+            continue;
+         return systemError(errno, ERROR_LOCATION);
+      }
+      written += result;
+   }
+   return Success();
+}
+
+Error readAnswer(int fd, bool* pAuthenticated)
+{
+   using namespace boost::posix_time;
+   ptime deadline = now() + milliseconds(kLoginTimeoutMs);
+
+   std::string answer;
+   while (answer.empty() || answer[answer.size() - 1] != '\n')
+   {
+      long remainingMs = (deadline - now()).total_milliseconds();
+      if (remainingMs <= 0)
+         return systemError(boost::system::errc::timed_out, ERROR_LOCATION);
+
+      struct pollfd pfd;
+      pfd.fd = fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      int result = ::poll(&pfd, 1, static_cast<int>(remainingMs));
+      if (result == -1)
+      {
+         if (errno == EINTR)
+            continue;
+         return systemError(errno, ERROR_LOCATION);
+      }
+      else if (result == 0)
+      {
+         continue;
+      }
+
+      char buffer[16];
+      ssize_t read = ::read(fd, buffer, sizeof(buffer));
+      if (read == -1)
+      {
+         if (errno == EINTR)
+            continue;
+         return systemError(errno, ERROR_LOCATION);
+      }
+
+      // the helper exited
+      else if (read == 0)
+      {
+         return systemError(boost::system::errc::broken_pipe, ERROR_LOCATION);
+      }
+
+      answer.append(buffer, read);
+   }
+
+   if (answer == "1\n")
+      *pAuthenticated = true;
+   else if (answer == "0\n")
+      *pAuthenticated = false;
+   else
+      return systemError(boost::system::errc::protocol_error, ERROR_LOCATION);
+
+   return Success();
+}
+
+void recordLogin(const Error& error, bool authenticated, double ms)
+{
+   LOCK_MUTEX(s_mutex)
+   {
+      s_stats.logins++;
+      if (error)
+         s_stats.errors++;
+      else if (authenticated)
+         s_stats.authenticated++;
+      else
+         s_stats.rejected++;
+      s_stats.totalMs += ms;
+      s_stats.maxMs = std::max(s_stats.maxMs, ms);
+   }
+   END_LOCK_MUTEX
+}
+
+bool exitIdleHelpers()
+{
+   std::vector<Helper> expired;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      boost::posix_time::ptime current = now();
+      std::vector<Helper> idle;
+      BOOST_FOREACH(const Helper& helper, s_idle)
+      {
+         if ((current - helper.idleSince) > kMaxIdleTime)
+            expired.push_back(helper);
+         else
+            idle.push_back(helper);
+      }
+      s_idle.swap(idle);
+      s_helpers -= expired.size();
+   }
+   END_LOCK_MUTEX
+
+   BOOST_FOREACH(const Helper& helper, expired)
+   {
+      exitHelper(helper);
+   }
+
+   return true;
+}
+
+bool sendMetrics()
+{
+   Stats current = collectStats();
+   std::size_t helpers = 0;
+   LOCK_MUTEX(s_mutex)
+   {
+      helpers = s_helpers;
+   }
+   END_LOCK_MUTEX
+
+   using namespace monitor::metrics;
+   std::vector<MetricData> data;
+   data.push_back(MetricData("logins", current.logins));
+   data.push_back(MetricData("authenticated", current.authenticated));
+   data.push_back(MetricData("rejected", current.rejected));
+   data.push_back(MetricData("errors", current.errors));
+   data.push_back(MetricData("launches", current.launches));
+   data.push_back(MetricData("helpers", helpers));
+   data.push_back(MetricData("avg_ms", current.logins > 0 ?
+                                 current.totalMs / current.logins : 0));
+   data.push_back(MetricData("max_ms", current.maxMs));
+
+   std::vector<MultiMetric> metrics;
+   metrics.push_back(MultiMetric("rserver.pam-helper-pool",
+                                 options().monitorIntervalSeconds(),
+                                 data));
+   monitor::client().sendMultiMetrics(metrics);
+
+   return true;
+}
+
+} // anonymous namespace
+
+bool enabled()
+{
+   return options().authPamHelperPoolSize() > 0;
+}
+
+Error login(const std::string& username,
+            const std::string& password,
+            const boost::function<void()>& onAfterFork,
+            bool* pAuthenticated,
+            bool* pRequestSent)
+{
+   // requests are delimited by nulls so they can't appear in credentials
+   *pAuthenticated = false;
+   *pRequestSent = false;
+   if (username.find('\0') != std::string::npos ||
+       password.find('\0') != std::string::npos)
+   {
+      return Success();
+   }
+
+   boost::posix_time::ptime start = now();
+   std::string request = username + '\0' + password + '\0';
+
+   Error error;
+   for (int attempt = 0; attempt < 2; attempt++)
+   {
+      Helper helper;
+      bool launched = false;
+      error = acquire(onAfterFork, &helper, &launched);
+      if (error)
+         break;
+
+      helper.logins++;
+      std::size_t written = 0;
+      error = writeRequest(helper.fdRequest, request, &written);
+      if (written > 0)
+         *pRequestSent = true;
+      if (!error)
+         error = readAnswer(helper.fdResponse, pAuthenticated);
+      release(helper, !error);
+
+      // a helper which has been idle may have exited since it was checked
+      // so give a fresh helper a try, but only if none of the request
+      // reached it (otherwise the login may already have been attempted,
+      // and counted against the account)
+      if (!error || launched || *pRequestSent)
+         break;
+   }
+
+   recordLogin(error,
+               *pAuthenticated,
+               (now() - start).total_microseconds() / 1000.0);
+   return error;
+}
+
+Stats collectStats()
+{
+   Stats current;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      std::swap(current, s_stats);
+   }
+   END_LOCK_MUTEX
+
+   return current;
+}
+
+Error initialize()
+{
+   if (!enabled())
+      return Success();
+
+   scheduler::addCommand(
+      boost::shared_ptr<ScheduledCommand>(new PeriodicCommand(
+         boost::posix_time::minutes(1),
+         exitIdleHelpers,
+         false))
+   );
+
+   // periodically report pool statistics to the monitor
+   scheduler::addCommand(
+      boost::shared_ptr<ScheduledCommand>(new PeriodicCommand(
+         boost::posix_time::seconds(options().monitorIntervalSeconds()),
+         sendMetrics,
+         false))
+   );
+
+   return Success();
+}
+
+} // namespace pam_helper_pool
+} // namespace server
+} // namespace rstudio
@@ -0,0 +1,212 @@
+/*
+ * ServerProxyAssetCache.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <server/ServerProxyAssetCache.hpp>
+
+#include <map>
+
+#include <boost/regex.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+#include <core/RegexUtils.hpp>
+#include <core/Thread.hpp>
+
+#include <core/http/Request.hpp>
+#include <core/http/Response.hpp>
+#include <core/system/Crypto.hpp>
+
+#include <server/ServerOptions.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace server {
+namespace proxy_asset_cache {
+
+namespace {
+
+// larger assets are always proxied
+const std::size_t kMaxAssetSize = 8 * 1024 * 1024;
+
+struct Asset
+{
+   std::string contentType;
+   std::string body;
+};
+
+boost::mutex s_mutex;
+
+// key => content hash
+std::map<std::string, std::string> s_index;
+
+// content hash => asset
+std::map<std::string, Asset> s_assets;
+std::size_t s_totalBytes = 0;
+
+std::string hexEncode(const std::string& data)
+{
+   const char* const kHexDigits = "0123456789abcdef";
+   std::string hex;
+   hex.reserve(data.size() * 2);
+   for (std::size_t i = 0; i < data.size(); i++)
+   {
+      unsigned char ch = static_cast<unsigned char>(data[i]);
+      hex.push_back(kHexDigits[ch >> 4]);
+      hex.push_back(kHexDigits[ch & 0x0F]);
+   }
+   return hex;
+}
+
+bool isCacheableResponse(const http::Response& response)
+{
+   if (response.statusCode() != http::status::Ok)
+      return false;
+
+   // skip anything personalized, encoded or which asks not to be cached
+   if (!response.headerValue("Set-Cookie").empty() ||
+       !response.headerValue("Content-Encoding").empty() ||
+       !response.headerValue("Transfer-Encoding").empty())
+   {
+      return false;
+   }
+
+   std::string cacheControl = response.headerValue("Cache-Control");
+   if (boost::algorithm::icontains(cacheControl, "no-store") ||
+       boost::algorithm::icontains(cacheControl, "no-cache"))
+   {
+      return false;
+   }
+
+   return !response.body().empty() && response.body().size() <= kMaxAssetSize;
+}
+
+} // anonymous namespace
+
+bool isCacheableRequest(const std::string& username,
+                        const http::Request& request,
+                        std::string* pKey)
+{
+   if (options().wwwProxyAssetCacheBytes() == 0 || request.method() != "GET")
+      return false;
+
+   // range requests are left to the server
+   if (!request.headerValue("Range").empty())
+      return false;
+
+   // static assets within a versioned dependency directory (as written by
+   // htmltools), e.g. /jquery-1.12.4/jquery.min.js or
+   // /app/htmlwidgets-1.3/htmlwidgets.js (no query strings, which may
+   // make the response dynamic)
+   static const boost::regex reAsset(
+      "^/(?:[^?#]*/)?[A-Za-z][A-Za-z0-9._]*-[0-9]+(?:[.-][0-9]+)+/"
+      "[^?#]+\\.(?:js|css|map|woff2?|ttf|otf|eot|svg|png|gif|jpg)$");
+   boost::smatch match;
+   if (!regex_utils::match(request.uri(), match, reAsset))
+      return false;
+
+   *pKey = username + ":" + request.uri();
+   return true;
+}
+
+bool respond(const std::string& key,
+             const http::Request& request,
+             http::Response* pResponse)
+{
+   std::string hash, contentType, body;
+   LOCK_MUTEX(s_mutex)
+   {
+      std::map<std::string, std::string>::const_iterator it =
+                                                         s_index.find(key);
+      if (it == s_index.end())
+         return false;
+
+      const Asset& asset = s_assets[it->second];
+      hash = it->second;
+      contentType = asset.contentType;
+      body = asset.body;
+   }
+   END_LOCK_MUTEX
+
+   if (hash.empty())
+      return false;
+
+   std::string eTag = "\"" + hash + "\"";
+   pResponse->setPrivateCacheForeverHeaders();
+   pResponse->setHeader("ETag", eTag);
+   if (request.headerValue("If-None-Match") == eTag)
+   {
+      pResponse->setStatusCode(http::status::NotModified);
+      return true;
+   }
+
+   pResponse->setContentType(contentType);
+   pResponse->negotiateContentEncoding(request);
+   Error error = pResponse->setBody(body);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+
+   return true;
+}
+
+void add(const std::string& key, const http::Response& response)
+{
+   if (!isCacheableResponse(response))
+      return;
+
+   std::string digest;
+   Error error = core::system::crypto::sha256(response.body(), &digest);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+   std::string hash = hexEncode(digest);
+
+   LOCK_MUTEX(s_mutex)
+   {
+      if (s_index.find(key) != s_index.end())
+         return;
+
+      // start over once we're full (assets are cheap to re-fetch and the
+      // ones still in use are quickly cached again)
+      if (s_assets.find(hash) == s_assets.end())
+      {
+         std::size_t size = response.body().size();
+         if (s_totalBytes + size > options().wwwProxyAssetCacheBytes())
+         {
+            s_index.clear();
+            s_assets.clear();
+            s_totalBytes = 0;
+         }
+
+         Asset& asset = s_assets[hash];
+         asset.contentType = response.contentType();
+         asset.body = response.body();
+         s_totalBytes += size;
+      }
+
+      s_index[key] = hash;
+   }
+   END_LOCK_MUTEX
+}
+
+} // namespace proxy_asset_cache
+} // namespace server
+} // namespace rstudio
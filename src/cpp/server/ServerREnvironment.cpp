@@ -19,6 +19,7 @@
 #include <core/Log.hpp>
 #include <core/Thread.hpp>
 #include <core/r_util/REnvironment.hpp>
+#include <core/system/System.hpp>
 
 #include <server_core/RVersionsScanner.hpp>
 
@@ -33,6 +34,9 @@ namespace r_environment {
   
 namespace {
 
+const char * const kRVersionsCacheFile =
+      "/var/lib/rstudio-server/r-versions-cache.json";
+
 // R version detected during initialization (either the system
 // R version or the provided fallback)
 core::r_util::RVersion s_rVersion;
@@ -48,6 +52,11 @@ void initializeScanner()
                                  options().rsessionWhichR(),
                                  options().rldpathPath(),
                                  options().rsessionLdLibraryPath()));
+
+   // cache detected R environments across restarts (so that R needn't be
+   // run to detect them again)
+   if (core::system::effectiveUserIsRoot())
+      s_scanner->setCacheFile(FilePath(kRVersionsCacheFile));
 }
 
 bool initialize(std::string* pErrMsg)
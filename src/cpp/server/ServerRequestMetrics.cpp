@@ -0,0 +1,69 @@
+/*
+ * ServerRequestMetrics.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <server/ServerRequestMetrics.hpp>
+
+#include <core/Error.hpp>
+#include <core/PeriodicCommand.hpp>
+
+#include <core/http/RequestMetrics.hpp>
+
+#include <monitor/MonitorClient.hpp>
+
+#include <server/ServerOptions.hpp>
+#include <server/ServerScheduler.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace server {
+namespace request_metrics {
+
+namespace {
+
+bool sendMetrics()
+{
+   std::vector<http::request_metrics::PrefixStats> stats =
+                                       http::request_metrics::collect();
+   if (!stats.empty())
+   {
+      monitor::client().sendMultiMetrics(monitor::metrics::requestMetrics(
+                                          "rserver.requests",
+                                          options().monitorIntervalSeconds(),
+                                          stats));
+   }
+
+   return true;
+}
+
+} // anonymous namespace
+
+Error initialize()
+{
+   http::request_metrics::setEnabled(true);
+
+   scheduler::addCommand(
+      boost::shared_ptr<ScheduledCommand>(new PeriodicCommand(
+         boost::posix_time::seconds(options().monitorIntervalSeconds()),
+         sendMetrics,
+         false))
+   );
+
+   return Success();
+}
+
+} // namespace request_metrics
+} // namespace server
+} // namespace rstudio
@@ -0,0 +1,274 @@
+/*
+ * ServerSessionConnectionPool.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <server/ServerSessionConnectionPool.hpp>
+
+#include <sys/socket.h>
+#include <errno.h>
+
+#include <map>
+#include <deque>
+
+#include <boost/foreach.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+#include <core/Thread.hpp>
+#include <core/PeriodicCommand.hpp>
+
+#include <core/http/SocketUtils.hpp>
+
+#include <monitor/MonitorClient.hpp>
+
+#include <server/ServerOptions.hpp>
+#include <server/ServerScheduler.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace server {
+namespace session_connection_pool {
+
+namespace {
+
+// idle connections older than this are not reused (the session may
+// have been restarted or otherwise dropped the connection)
+const boost::posix_time::time_duration kMaxIdleTime =
+                                          boost::posix_time::seconds(60);
+
+struct IdleConnection
+{
+   IdleConnection(const Connection& connection)
+      : connection(connection),
+        idleSince(boost::posix_time::microsec_clock::universal_time())
+   {
+   }
+
+   Connection connection;
+   boost::posix_time::ptime idleSince;
+};
+
+// connections are kept per io_service as well as per session, as a socket
+// must only be used by the thread(s) running the io_service it was opened
+// on (with www-io-service-per-thread each thread has its own)
+typedef std::pair<boost::asio::io_service*, r_util::SessionContext> PoolKey;
+
+typedef std::map<PoolKey, std::deque<IdleConnection> > ConnectionMap;
+
+boost::mutex s_mutex;
+ConnectionMap s_connections;
+Stats s_stats;
+
+void closeConnection(const Connection& connection)
+{
+   Error error = http::closeSocket(*connection);
+   if (error && !http::isConnectionTerminatedError(error))
+      LOG_ERROR(error);
+}
+
+// an idle connection should have nothing to read. peeking at it without
+// blocking tells us if the session has closed its end (we read eof) or
+// sent something we didn't ask for -- either way it can't be reused
+bool isStale(const Connection& connection)
+{
+   if (!connection->is_open())
+      return true;
+
+   char byte;
+   ssize_t result = ::recv(connection->native_handle(),
+                           &byte,
+                           1,
+                           MSG_PEEK | MSG_DONTWAIT);
+   if (result == -1)
+      return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+
+   return true;
+}
+
+bool sendMetrics()
+{
+   Stats current = stats();
+
+   using namespace monitor::metrics;
+   std::vector<MetricData> data;
+   data.push_back(MetricData("hits", current.hits));
+   data.push_back(MetricData("misses", current.misses));
+   data.push_back(MetricData("evictions", current.evictions));
+   data.push_back(MetricData("idle", current.idle));
+
+   std::vector<MultiMetric> metrics;
+   metrics.push_back(MultiMetric("rserver.session-connection-pool",
+                                 options().monitorIntervalSeconds(),
+                                 data));
+   monitor::client().sendMultiMetrics(metrics);
+
+   return true;
+}
+
+} // anonymous namespace
+
+bool enabled()
+{
+   return options().rsessionProxyPoolSize() > 0;
+}
+
+Connection acquire(boost::asio::io_service& ioService,
+                   const r_util::SessionContext& context)
+{
+   std::vector<Connection> stale;
+   Connection connection;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      ConnectionMap::iterator it =
+                     s_connections.find(PoolKey(&ioService, context));
+      if (it != s_connections.end())
+      {
+         using namespace boost::posix_time;
+         ptime now = microsec_clock::universal_time();
+
+         // most recently released connections are at the back
+         std::deque<IdleConnection>& idle = it->second;
+         while (!idle.empty())
+         {
+            IdleConnection candidate = idle.back();
+            idle.pop_back();
+            s_stats.idle--;
+
+            if ((now - candidate.idleSince) > kMaxIdleTime ||
+                isStale(candidate.connection))
+            {
+               stale.push_back(candidate.connection);
+               continue;
+            }
+
+            connection = candidate.connection;
+            break;
+         }
+
+         if (idle.empty())
+            s_connections.erase(it);
+      }
+
+      if (connection)
+         s_stats.hits++;
+      else
+         s_stats.misses++;
+
+      s_stats.evictions += stale.size();
+   }
+   END_LOCK_MUTEX
+
+   // close stale connections outside of the lock
+   BOOST_FOREACH(const Connection& staleConnection, stale)
+   {
+      closeConnection(staleConnection);
+   }
+
+   return connection;
+}
+
+void release(boost::asio::io_service& ioService,
+             const r_util::SessionContext& context,
+             const Connection& connection)
+{
+   if (!connection)
+      return;
+
+   bool pooled = false;
+   std::size_t maxIdle = options().rsessionProxyPoolSize();
+
+   LOCK_MUTEX(s_mutex)
+   {
+      std::deque<IdleConnection>& idle =
+                              s_connections[PoolKey(&ioService, context)];
+      if (idle.size() < maxIdle)
+      {
+         idle.push_back(IdleConnection(connection));
+         s_stats.idle++;
+         pooled = true;
+      }
+   }
+   END_LOCK_MUTEX
+
+   // pool is full for this session
+   if (!pooled)
+      closeConnection(connection);
+}
+
+void evict(const r_util::SessionContext& context)
+{
+   std::deque<IdleConnection> idle;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      // (the session's connections may be spread over several io_services)
+      ConnectionMap::iterator it = s_connections.begin();
+      while (it != s_connections.end())
+      {
+         if (it->first.second == context)
+         {
+            idle.insert(idle.end(), it->second.begin(), it->second.end());
+            s_connections.erase(it++);
+         }
+         else
+         {
+            ++it;
+         }
+      }
+      s_stats.idle -= idle.size();
+      s_stats.evictions += idle.size();
+   }
+   END_LOCK_MUTEX
+
+   BOOST_FOREACH(const IdleConnection& connection, idle)
+   {
+      closeConnection(connection.connection);
+   }
+}
+
+Stats stats()
+{
+   Stats current;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      current = s_stats;
+   }
+   END_LOCK_MUTEX
+
+   return current;
+}
+
+Error initialize()
+{
+   if (!enabled())
+      return Success();
+
+   // periodically report pool statistics to the monitor
+   scheduler::addCommand(
+      boost::shared_ptr<ScheduledCommand>(new PeriodicCommand(
+         boost::posix_time::seconds(options().monitorIntervalSeconds()),
+         sendMetrics,
+         false))
+   );
+
+   return Success();
+}
+
+} // namespace session_connection_pool
+} // namespace server
+} // namespace rstudio
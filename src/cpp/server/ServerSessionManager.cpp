@@ -15,19 +15,29 @@
 
 #include <server/ServerSessionManager.hpp>
 
+#include <signal.h>
+
+#include <algorithm>
+
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
+#include <core/PeriodicCommand.hpp>
 #include <core/SafeConvert.hpp>
 #include <core/system/PosixUser.hpp>
 #include <core/system/Environment.hpp>
 
 #include <monitor/MonitorClient.hpp>
+#include <monitor/metrics/Metric.hpp>
 #include <session/SessionConstants.hpp>
 
 #include <server/ServerOptions.hpp>
+#include <server/ServerScheduler.hpp>
 
 #include <server/ServerErrorCategory.hpp>
+#include <server/ServerSessionConnectionPool.hpp>
 
 #include <server/auth/ServerValidateUser.hpp>
 
@@ -81,11 +91,39 @@ core::system::ProcessConfig sessionProcessConfig(
       s_launcherToken = core::system::generateShortenedUuid();
    args.push_back(std::make_pair("--launcher-token", s_launcherToken));
 
+   // report metrics to the monitor at the same interval we do
+   args.push_back(std::make_pair(
+                  "--" kMonitorIntervalSeconds,
+                  safe_convert::numberToString(options.monitorIntervalSeconds())));
+
+   // compress the session's responses as we compress our own
+   args.push_back(std::make_pair(
+                  "--" kWwwCompressionLevelSessionOption,
+                  safe_convert::numberToString(options.wwwCompressionLevel())));
+
    // allow session timeout to be overridden via environment variable
    std::string timeout = core::system::getenv("RSTUDIO_SESSION_TIMEOUT");
    if (!timeout.empty())
       args.push_back(std::make_pair("--" kTimeoutSessionOption, timeout));
 
+   // have the session release its caches when memory runs short
+   if (options.rsessionLowMemoryMb() > 0)
+   {
+      args.push_back(std::make_pair(
+                  "--" kLowMemorySessionOption,
+                  safe_convert::numberToString(options.rsessionLowMemoryMb())));
+   }
+
+   // trace the session's handling of the requests we trace
+   if (options.serverTraceSampleRate() > 0)
+   {
+      args.push_back(std::make_pair(
+                  "--" kTraceSampleRateSessionOption,
+                  safe_convert::numberToString(options.serverTraceSampleRate())));
+      args.push_back(std::make_pair("--" kTraceDirSessionOption,
+                                    options.serverTraceDir()));
+   }
+
    // pass our uid to instruct rsession to limit rpc clients to us and itself
    core::system::Options environment;
    uid_t uid = core::system::user::currentUserIdentity().userId;
@@ -150,11 +188,88 @@ core::system::ProcessConfig sessionProcessConfig(
    config.args = args;
    config.environment = environment;
    config.stdStreamBehavior = core::system::StdStreamInherit;
+
+   // give each session its own cgroup for accounting and limits
+   if (!options.rsessionCgroupPath().empty())
+   {
+      core::system::cgroups::CgroupLimits& cgroup = config.limits.cgroup;
+      cgroup.parentPath = options.rsessionCgroupPath();
+      cgroup.cpuWeight = options.rsessionCpuWeight();
+      cgroup.memoryHighBytes = options.rsessionMemoryHighMb() * 1024LL * 1024LL;
+      cgroup.ioMax = options.rsessionIoMax();
+   }
+
    return config;
 }
 
-void onProcessExit(const std::string& username, PidType pid)
+// how long we wait for a launched session to answer before assuming the
+// launch failed
+const boost::posix_time::time_duration kLaunchTimeout =
+                                          boost::posix_time::minutes(1);
+
+// queued launches start in this order
+enum
+{
+   kResumeLaunchPriority = 0,    // from a client which already has the IDE open
+   kNewLaunchPriority = 1,       // from a page load
+   kPrelaunchPriority = 2        // nobody waiting yet (e.g. at sign in)
+};
+
+int launchPriority(const http::Request& request)
+{
+   std::string uri = request.uri();
+   if (uri.empty())
+      return kPrelaunchPriority;
+   else if (boost::algorithm::starts_with(uri, "/rpc/") ||
+            boost::algorithm::starts_with(uri, "/events/"))
+      return kResumeLaunchPriority;
+   else
+      return kNewLaunchPriority;
+}
+
+bool isSystemBusy()
 {
+   server::Options& options = server::options();
+
+   double maxLoad = options.rsessionLaunchMaxLoad();
+   if (maxLoad > 0)
+   {
+      core::system::SysInfo info;
+      Error error = core::system::systemInformation(&info);
+      if (!error && info.cores > 0 && (info.load1 / info.cores) > maxLoad)
+         return true;
+   }
+
+   int minFreeMb = options.rsessionLaunchMinFreeMb();
+   if (minFreeMb > 0)
+   {
+      long availableKb;
+      Error error = core::system::availableMemoryKb(&availableKb);
+      if (!error && availableKb < minFreeMb * 1024L)
+         return true;
+   }
+
+   return false;
+}
+
+// how long a session which was asked to suspend has before we ask it again
+// (a busy session only suspends cooperatively once it is idle)
+const boost::posix_time::minutes kSuspendRetryInterval(5);
+
+struct SuspendCandidate
+{
+   PidType pid;
+   r_util::SessionContext context;
+   boost::posix_time::ptime lastActivity;
+   long residentKb;
+};
+
+// least recently used first; among equally idle sessions free the most
+bool suspendsBefore(const SuspendCandidate& lhs, const SuspendCandidate& rhs)
+{
+   if (lhs.lastActivity != rhs.lastActivity)
+      return lhs.lastActivity < rhs.lastActivity;
+   return lhs.residentKb > rhs.residentKb;
 }
 
 } // anonymous namespace
@@ -181,12 +296,16 @@ Error SessionManager::launchSession(boost::asio::io_service& ioService,
    using namespace boost::posix_time;
    LOCK_MUTEX(launchesMutex_)
    {
+      // a queued launch will happen when its turn comes
+      if (isQueued(context))
+         return Success();
+
       // check whether we already have a launch pending
       LaunchMap::const_iterator pos = pendingLaunches_.find(context);
       if (pos != pendingLaunches_.end())
       {
          // if the launch is less than one minute old then return success
-         if ( (pos->second + boost::posix_time::minutes(1))
+         if ( (pos->second + kLaunchTimeout)
                > microsec_clock::universal_time() )
          {
             return Success();
@@ -205,9 +324,36 @@ Error SessionManager::launchSession(boost::asio::io_service& ioService,
 
       // record the launch
       pendingLaunches_[context] =  microsec_clock::universal_time();
+
+      // queue it if too many sessions are already starting
+      if (!admitLaunch())
+      {
+         QueuedLaunch launch;
+         launch.pIoService = &ioService;
+         launch.context = context;
+         launch.pRequest = boost::make_shared<http::Request>();
+         launch.pRequest->assign(request);
+         launch.onLaunch = onLaunch;
+         launch.onError = onError;
+         launch.priority = launchPriority(request);
+         launch.queuedTime = microsec_clock::universal_time();
+         launchQueue_.push_back(launch);
+         return Success();
+      }
+
+      activeLaunches_[context] = microsec_clock::universal_time();
    }
    END_LOCK_MUTEX
 
+   return launchNow(ioService, context, request, onLaunch, onError);
+}
+
+Error SessionManager::launchNow(boost::asio::io_service& ioService,
+                                const r_util::SessionContext& context,
+                                const http::Request& request,
+                                const http::ResponseHandler& onLaunch,
+                                const http::ErrorHandler& onError)
+{
    // determine launch options
    r_util::SessionLaunchProfile profile;
    profile.context = context;
@@ -231,6 +377,270 @@ Error SessionManager::launchSession(boost::asio::io_service& ioService,
    return Success();
 }
 
+// requires launchesMutex_
+bool SessionManager::admitLaunch()
+{
+   using namespace boost::posix_time;
+   server::Options& options = server::options();
+
+   // forget launches which never answered
+   ptime now = microsec_clock::universal_time();
+   for (LaunchMap::iterator it = activeLaunches_.begin();
+        it != activeLaunches_.end(); )
+   {
+      if (it->second + kLaunchTimeout < now)
+         activeLaunches_.erase(it++);
+      else
+         ++it;
+   }
+
+   // always let one launch through so that nobody waits forever
+   if (activeLaunches_.empty())
+      return true;
+
+   std::size_t maxLaunches = options.rsessionMaxConcurrentLaunches();
+   if (maxLaunches > 0 && activeLaunches_.size() >= maxLaunches)
+      return false;
+
+   // a busy system starts sessions one at a time
+   return !isSystemBusy();
+}
+
+bool SessionManager::processLaunchQueue()
+{
+   std::vector<QueuedLaunch> launches;
+   LOCK_MUTEX(launchesMutex_)
+   {
+      while (!launchQueue_.empty() && admitLaunch())
+      {
+         std::vector<QueuedLaunch>::iterator next =
+               std::min_element(launchQueue_.begin(), launchQueue_.end(),
+                                launchesBefore);
+         launches.push_back(*next);
+         launchQueue_.erase(next);
+
+         // the wait for the session starts now
+         using namespace boost::posix_time;
+         ptime now = microsec_clock::universal_time();
+         pendingLaunches_[launches.back().context] = now;
+         activeLaunches_[launches.back().context] = now;
+      }
+   }
+   END_LOCK_MUTEX
+
+   BOOST_FOREACH(const QueuedLaunch& launch, launches)
+   {
+      Error error = launchNow(*launch.pIoService,
+                              launch.context,
+                              *launch.pRequest,
+                              launch.onLaunch,
+                              launch.onError);
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   return true;
+}
+
+bool SessionManager::isLaunchQueued(const r_util::SessionContext& context)
+{
+   LOCK_MUTEX(launchesMutex_)
+   {
+      return isQueued(context);
+   }
+   END_LOCK_MUTEX
+
+   return false;
+}
+
+Error SessionManager::initialize()
+{
+   // the queue also moves whenever a starting session answers; this
+   // catches sessions which never do and changes in system load
+   scheduler::addCommand(boost::shared_ptr<ScheduledCommand>(
+      new PeriodicCommand(boost::posix_time::seconds(3),
+                          boost::bind(&SessionManager::processLaunchQueue,
+                                      this),
+                          false)));
+
+   // suspend idle sessions when the node runs short of memory
+   if (server::options().rsessionSuspendMemoryMb() > 0)
+   {
+      scheduler::addCommand(boost::shared_ptr<ScheduledCommand>(
+         new PeriodicCommand(boost::posix_time::seconds(15),
+                             boost::bind(&SessionManager::suspendIdleSessions,
+                                         this),
+                             false)));
+   }
+
+   // report the usage of each session's cgroup
+   if (!server::options().rsessionCgroupPath().empty())
+   {
+      scheduler::addCommand(boost::shared_ptr<ScheduledCommand>(
+         new PeriodicCommand(
+            boost::posix_time::seconds(server::options().monitorIntervalSeconds()),
+            boost::bind(&SessionManager::sendUsageMetrics, this),
+            false)));
+   }
+
+   return Success();
+}
+
+bool SessionManager::sendUsageMetrics()
+{
+   std::map<PidType, r_util::SessionContext> sessionPids;
+   LOCK_MUTEX(sessionsMutex_)
+   {
+      sessionPids = sessionPids_;
+   }
+   END_LOCK_MUTEX
+
+   using namespace monitor::metrics;
+   std::string cgroupPath = server::options().rsessionCgroupPath();
+   std::vector<MultiMetric> metrics;
+   typedef std::map<PidType, r_util::SessionContext>::value_type PidEntry;
+   BOOST_FOREACH(const PidEntry& entry, sessionPids)
+   {
+      // sessions launched without root (and so outside a cgroup) have none
+      core::system::cgroups::CgroupUsage usage;
+      Error error = core::system::cgroups::readCgroupUsage(
+               core::system::cgroups::processCgroupPath(cgroupPath, entry.first),
+               &usage);
+      if (error)
+         continue;
+
+      const double kMb = 1024.0 * 1024.0;
+      std::vector<MetricData> data;
+      data.push_back(MetricData("cpu-seconds", usage.cpuUsec / 1000000.0));
+      data.push_back(MetricData("memory-mb", usage.memoryBytes / kMb));
+      data.push_back(MetricData("io-read-mb", usage.ioReadBytes / kMb));
+      data.push_back(MetricData("io-write-mb", usage.ioWriteBytes / kMb));
+
+      metrics.push_back(MultiMetric(
+               "rserver.session." + entry.second.username + "." +
+                  safe_convert::numberToString(entry.first),
+               server::options().monitorIntervalSeconds(),
+               data));
+   }
+
+   if (!metrics.empty())
+      monitor::client().sendMultiMetrics(metrics);
+
+   return true;
+}
+
+void SessionManager::noteSessionActivity(const r_util::SessionContext& context)
+{
+   LOCK_MUTEX(sessionsMutex_)
+   {
+      lastActivity_[context] = boost::posix_time::microsec_clock::universal_time();
+   }
+   END_LOCK_MUTEX
+}
+
+void SessionManager::onSessionExit(const r_util::SessionContext& context,
+                                   PidType pid)
+{
+   // connections to the session are no longer usable
+   session_connection_pool::evict(context);
+
+   LOCK_MUTEX(sessionsMutex_)
+   {
+      sessionPids_.erase(pid);
+      suspendRequested_.erase(pid);
+      lastActivity_.erase(context);
+   }
+   END_LOCK_MUTEX
+}
+
+bool SessionManager::suspendIdleSessions()
+{
+   using namespace boost::posix_time;
+
+   server::Options& options = server::options();
+   long thresholdKb = options.rsessionSuspendMemoryMb() * 1024L;
+
+   long availableKb = 0;
+   Error error = core::system::availableMemoryKb(&availableKb);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return true;
+   }
+   if (availableKb >= thresholdKb)
+      return true;
+
+   // collect sessions no client has used for a while
+   ptime now = microsec_clock::universal_time();
+   ptime idleSince = now - minutes(options.rsessionSuspendIdleMinutes());
+   std::vector<SuspendCandidate> candidates;
+   LOCK_MUTEX(sessionsMutex_)
+   {
+      typedef std::map<PidType, r_util::SessionContext>::value_type PidEntry;
+      BOOST_FOREACH(const PidEntry& entry, sessionPids_)
+      {
+         // activity is recorded at launch, so a session no client ever
+         // connected to is idle from the time it started
+         LaunchMap::const_iterator activity = lastActivity_.find(entry.second);
+         if (activity == lastActivity_.end() || activity->second > idleSince)
+            continue;
+
+         std::map<PidType, ptime>::const_iterator requested =
+                                       suspendRequested_.find(entry.first);
+         if (requested != suspendRequested_.end() &&
+             requested->second + kSuspendRetryInterval > now)
+            continue;
+
+         SuspendCandidate candidate;
+         candidate.pid = entry.first;
+         candidate.context = entry.second;
+         candidate.lastActivity = activity->second;
+         candidate.residentKb = 0;
+         candidates.push_back(candidate);
+      }
+   }
+   END_LOCK_MUTEX
+
+   BOOST_FOREACH(SuspendCandidate& candidate, candidates)
+   {
+      Error error = core::system::processResidentMemoryKb(
+                                       candidate.pid, &candidate.residentKb);
+      if (error)
+         LOG_ERROR(error);
+   }
+   std::sort(candidates.begin(), candidates.end(), suspendsBefore);
+
+   // ask sessions to suspend until we expect to be back over the threshold
+   long deficitKb = thresholdKb - availableKb;
+   long releasedKb = 0;
+   BOOST_FOREACH(const SuspendCandidate& candidate, candidates)
+   {
+      if (releasedKb >= deficitKb)
+         break;
+
+      if (::kill(candidate.pid, SIGUSR1) == -1)
+      {
+         LOG_ERROR(systemError(errno, ERROR_LOCATION));
+         continue;
+      }
+
+      LOG_INFO_MESSAGE("Suspending idle session " + candidate.context.username +
+                       " (" + candidate.context.scope.id() + ", " +
+                       safe_convert::numberToString(candidate.residentKb / 1024) +
+                       " MB) due to low memory");
+
+      LOCK_MUTEX(sessionsMutex_)
+      {
+         suspendRequested_[candidate.pid] = now;
+      }
+      END_LOCK_MUTEX
+
+      releasedKb += candidate.residentKb;
+   }
+
+   return true;
+}
+
 namespace {
 
 core::system::ProcessConfigFilter s_processConfigFilter;
@@ -246,7 +656,7 @@ void setProcessConfigFilter(const core::system::ProcessConfigFilter& filter)
 // default session launcher -- does the launch then tracks the pid
 // for later reaping
 Error SessionManager::launchAndTrackSession(
-                           boost::asio::io_service&,
+                           boost::asio::io_service& ioService,
                            const core::r_util::SessionLaunchProfile& profile)
 {
    // if we are root then assume the identity of the user
@@ -263,10 +673,24 @@ Error SessionManager::launchAndTrackSession(
    if (error)
       return error;
 
-   // track it for subsequent reaping
-   processTracker_.addProcess(pid, boost::bind(onProcessExit,
-                                               profile.context.username,
-                                               pid));
+   // track it for subsequent reaping (on the io service as it exits, where
+   // supported, rather than checking every session on each SIGCHLD)
+   processTracker_.addProcess(pid,
+                              ioService,
+                              boost::bind(&SessionManager::onSessionExit,
+                                          this,
+                                          profile.context,
+                                          pid));
+
+   // and so it can be suspended when memory runs short (a fresh session
+   // counts as just used)
+   LOCK_MUTEX(sessionsMutex_)
+   {
+      sessionPids_[pid] = profile.context;
+      lastActivity_[profile.context] =
+                  boost::posix_time::microsec_clock::universal_time();
+   }
+   END_LOCK_MUTEX
 
    // return success
    return Success();
@@ -286,11 +710,37 @@ void SessionManager::addSessionLaunchProfileFilter(
 
 void SessionManager::removePendingLaunch(const r_util::SessionContext& context)
 {
+   bool haveQueue = false;
    LOCK_MUTEX(launchesMutex_)
    {
       pendingLaunches_.erase(context);
+      activeLaunches_.erase(context);
+      haveQueue = !launchQueue_.empty();
    }
    END_LOCK_MUTEX
+
+   // a slot may have opened up for a queued launch
+   if (haveQueue)
+      processLaunchQueue();
+}
+
+// requires launchesMutex_
+bool SessionManager::isQueued(const r_util::SessionContext& context) const
+{
+   BOOST_FOREACH(const QueuedLaunch& launch, launchQueue_)
+   {
+      if (launch.context == context)
+         return true;
+   }
+   return false;
+}
+
+bool SessionManager::launchesBefore(const QueuedLaunch& lhs,
+                                    const QueuedLaunch& rhs)
+{
+   if (lhs.priority != rhs.priority)
+      return lhs.priority < rhs.priority;
+   return lhs.queuedTime < rhs.queuedTime;
 }
 
 void SessionManager::notifySIGCHLD()
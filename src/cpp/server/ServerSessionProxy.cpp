@@ -20,6 +20,7 @@
 #include <map>
 
 #include <boost/regex.hpp>
+#include <boost/weak_ptr.hpp>
 #include <boost/algorithm/string/join.hpp>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -34,6 +35,7 @@
 #include <core/BoostErrors.hpp>
 #include <core/Log.hpp>
 #include <core/Thread.hpp>
+#include <core/Trace.hpp>
 #include <core/WaitUtils.hpp>
 #include <core/RegexUtils.hpp>
 
@@ -59,10 +61,13 @@
 #include <server/auth/ServerValidateUser.hpp>
 #include <server/auth/ServerAuthHandler.hpp>
 
+#include <server/ServerObject.hpp>
 #include <server/ServerOptions.hpp>
 #include <server/ServerErrorCategory.hpp>
 
+#include <server/ServerProxyAssetCache.hpp>
 #include <server/ServerSessionManager.hpp>
+#include <server/ServerSessionConnectionPool.hpp>
 
 #include <server/ServerConstants.hpp>
 
@@ -181,15 +186,124 @@ bool sessionContextForRequest(
 void handleProxyResponse(
       boost::shared_ptr<core::http::AsyncConnection> ptrConnection,
       const r_util::SessionContext& context,
+      boost::weak_ptr<http::LocalStreamAsyncClient> weakClient,
+      boost::shared_ptr<core::trace::Span> pSpan,
       const http::Response& response)
 {
+   if (pSpan)
+   {
+      pSpan->setAttribute("http.status_code", response.statusCode());
+      pSpan->end();
+   }
+
    // if there was a launch pending then remove it
    sessionManager().removePendingLaunch(context);
 
+   // return the connection to the pool if it can be reused
+   boost::shared_ptr<http::LocalStreamAsyncClient> pClient = weakClient.lock();
+   if (pClient)
+      session_connection_pool::release(ptrConnection->ioService(),
+                                       context,
+                                       pClient->releaseConnection());
+
    // write the response
    ptrConnection->writeResponse(response);
 }
 
+void executeSessionRequest(
+      const r_util::SessionContext& context,
+      boost::shared_ptr<core::http::AsyncConnection> ptrConnection,
+      boost::shared_ptr<http::Request> pRequest,
+      const FilePath& streamPath,
+      boost::optional<UidType> validateUid,
+      const http::ErrorHandler& errorHandler,
+      const http::ConnectionRetryProfile& connectionRetryProfile,
+      bool usePool,
+      boost::shared_ptr<core::trace::Span> pSpan);
+
+void handleTracedProxyError(boost::shared_ptr<core::trace::Span> pSpan,
+                            const http::ErrorHandler& errorHandler,
+                            const Error& error)
+{
+   pSpan->setError(error.summary());
+   pSpan->end();
+
+   errorHandler(error);
+}
+
+void handleProxyError(
+      const r_util::SessionContext& context,
+      boost::shared_ptr<core::http::AsyncConnection> ptrConnection,
+      boost::shared_ptr<http::Request> pRequest,
+      const FilePath& streamPath,
+      boost::optional<UidType> validateUid,
+      const http::ErrorHandler& errorHandler,
+      const http::ConnectionRetryProfile& connectionRetryProfile,
+      boost::weak_ptr<http::LocalStreamAsyncClient> weakClient,
+      const Error& error)
+{
+   // a pooled connection may have been closed by the session since we last
+   // used it -- in that case retry once over a fresh connection. this is
+   // only safe if none of the request was written (otherwise the session
+   // may already have acted on a request that isn't idempotent)
+   boost::shared_ptr<http::LocalStreamAsyncClient> pClient = weakClient.lock();
+   if (pClient &&
+       pClient->reusedConnection() &&
+       pClient->requestBytesWritten() == 0 &&
+       http::isConnectionTerminatedError(error))
+   {
+      // (a traced request's span is bound to its error handler so it ends
+      // when the retry completes)
+      executeSessionRequest(context, ptrConnection, pRequest, streamPath,
+                            validateUid, errorHandler, connectionRetryProfile,
+                            false, boost::shared_ptr<core::trace::Span>());
+      return;
+   }
+
+   errorHandler(error);
+}
+
+void executeSessionRequest(
+      const r_util::SessionContext& context,
+      boost::shared_ptr<core::http::AsyncConnection> ptrConnection,
+      boost::shared_ptr<http::Request> pRequest,
+      const FilePath& streamPath,
+      boost::optional<UidType> validateUid,
+      const http::ErrorHandler& errorHandler,
+      const http::ConnectionRetryProfile& connectionRetryProfile,
+      bool usePool,
+      boost::shared_ptr<core::trace::Span> pSpan)
+{
+   // create client
+   // if the user is available on the system pass in the uid for validation to ensure
+   // that we only connect to the socket if it was created by the user
+   boost::shared_ptr<http::LocalStreamAsyncClient> pClient(new http::LocalStreamAsyncClient(
+                                                    ptrConnection->ioService(),
+                                                    streamPath, false, validateUid));
+
+   // reuse an idle connection to the session if we have one, and keep
+   // this connection open afterwards so it can be returned to the pool
+   if (usePool && session_connection_pool::enabled())
+      pClient->setPersistentConnection(session_connection_pool::acquire(
+                                          ptrConnection->ioService(), context));
+
+   // setup retry context
+   if (!connectionRetryProfile.empty())
+      pClient->setConnectionRetryProfile(connectionRetryProfile);
+
+   // assign request
+   pClient->request().assign(*pRequest);
+
+   // (bind a weak reference to the client to avoid a reference cycle
+   // between the client and its own response handler)
+   boost::weak_ptr<http::LocalStreamAsyncClient> weakClient(pClient);
+   pClient->execute(boost::bind(handleProxyResponse, ptrConnection, context,
+                                weakClient, pSpan, _1),
+                    boost::bind(handleProxyError, context, ptrConnection,
+                                pRequest, streamPath, validateUid, errorHandler,
+                                connectionRetryProfile, weakClient, _1));
+}
+
 void rewriteLocalhostAddressHeader(const std::string& headerName,
                                    const http::Request& originalRequest,
                                    const std::string& port,
@@ -282,7 +396,10 @@ void handleLocalhostResponse(
          boost::static_pointer_cast<http::Socket>(ptrLocalhost);
 
       // connect the sockets
-      http::SocketProxy::create(ptrClient, ptrServer);
+      http::SocketProxy::create(ptrConnection->ioService(),
+                                ptrClient,
+                                ptrServer,
+                                server::options().wwwProxyOptions());
    }
    // normal response, write and close (handle redirects if necessary)
    else
@@ -340,6 +457,24 @@ void handleLocalhostResponse(
    }
 }
 
+void handleCacheableLocalhostResponse(
+      const std::string& assetKey,
+      boost::shared_ptr<core::http::AsyncConnection> ptrConnection,
+      boost::shared_ptr<http::IAsyncClient> ptrLocalhost,
+      const std::string& port,
+      const std::string& baseAddress,
+      bool ipv6,
+      const http::Response& response)
+{
+   proxy_asset_cache::add(assetKey, response);
+   handleLocalhostResponse(ptrConnection,
+                           ptrLocalhost,
+                           port,
+                           baseAddress,
+                           ipv6,
+                           response);
+}
+
 void handleLocalhostError(
       boost::shared_ptr<core::http::AsyncConnection> ptrConnection,
       const Error& error)
@@ -369,11 +504,42 @@ void logIfNotConnectionTerminated(const Error& error,
    }
 }
 
+// the session's launch is still waiting its turn (see launch admission in
+// SessionManager) -- tell the client it's starting rather than failing
+bool writeSessionStarting(
+      boost::shared_ptr<core::http::AsyncConnection> ptrConnection,
+      const r_util::SessionContext& context,
+      bool rpc)
+{
+   if (!sessionManager().isLaunchQueued(context))
+      return false;
+
+   http::Response& response = ptrConnection->response();
+   response.setHeader("Retry-After", "5");
+   if (rpc)
+   {
+      json::setJsonRpcError(json::errc::Unavailable, &response);
+   }
+   else
+   {
+      response.setStatusCode(http::status::ServiceUnavailable);
+      response.setContentType("text/html");
+      response.setBody("<html><head><meta http-equiv=\"refresh\" content=\"5\">"
+                       "<title>RStudio</title></head>"
+                       "<body>Starting your R session...</body></html>");
+   }
+   ptrConnection->writeResponse();
+   return true;
+}
+
 void handleContentError(
       boost::shared_ptr<core::http::AsyncConnection> ptrConnection,
       const r_util::SessionContext& context,
       const Error& error)
 {   
+   if (writeSessionStarting(ptrConnection, context, false))
+      return;
+
    // if there was a launch pending then remove it
    sessionManager().removePendingLaunch(context);
 
@@ -432,6 +598,9 @@ void handleRpcError(
       const r_util::SessionContext& context,
       const Error& error)
 {
+   if (writeSessionStarting(ptrConnection, context, true))
+      return;
+
    // if there was a launch pending then remove it
    sessionManager().removePendingLaunch(context);
 
@@ -561,6 +730,11 @@ void proxyRequest(
    if (applyProxyFilter(ptrConnection, context))
       return;
 
+   // events are long polls which an open but unused tab keeps issuing, so
+   // only rpc and content requests count as the session being used
+   if (requestType != RequestType::Events)
+      sessionManager().noteSessionActivity(context);
+
    // modify request
    boost::shared_ptr<http::Request> pRequest(new http::Request());
    pRequest->assign(ptrConnection->request());
@@ -571,6 +745,34 @@ void proxyRequest(
    // call request filter if we have one
    invokeRequestFilter(pRequest.get());
 
+   // trace the request through to the session (but not events requests,
+   // which are long polls that mostly wait)
+   boost::shared_ptr<core::trace::Span> pSpan;
+   if (requestType != RequestType::Events && core::trace::enabled())
+   {
+      using namespace core::trace;
+      pSpan.reset(new Span("proxy",
+                           parseTraceparent(
+                              pRequest->headerValue(kTraceparentHeader)),
+                           SpanKindServer));
+      if (pSpan->recording())
+      {
+         pSpan->setName("proxy " + pRequest->path());
+         pSpan->setAttribute("http.target", pRequest->uri());
+         pSpan->setAttribute("enduser.id", context.username);
+      }
+      pRequest->setHeader(kTraceparentHeader,
+                          pSpan->spanContext().traceparent());
+   }
+
+   // (errors end the span before they are handled)
+   http::ErrorHandler proxyErrorHandler = errorHandler;
+   if (pSpan)
+   {
+      proxyErrorHandler = boost::bind(handleTracedProxyError, pSpan,
+                                      errorHandler, _1);
+   }
+
    // see if the request should be handled by the overlay
    if (overlay::proxyRequest(requestType, pRequest, context, ptrConnection,
                              errorHandler, connectionRetryProfile))
@@ -612,22 +814,10 @@ void proxyRequest(
       }
    }
 
-   // create client
-   // if the user is available on the system pass in the uid for validation to ensure
-   // that we only connect to the socket if it was created by the user
-    boost::shared_ptr<http::IAsyncClient> pClient(new http::LocalStreamAsyncClient(
-                                                     ptrConnection->ioService(),
-                                                     streamPath, false, validateUid));
-
-    // setup retry context
-    if (!connectionRetryProfile.empty())
-       pClient->setConnectionRetryProfile(connectionRetryProfile);
-
-    // assign request
-    pClient->request().assign(*pRequest);
-
-    pClient->execute(boost::bind(handleProxyResponse, ptrConnection, context, _1),
-                     errorHandler);
+   // send the request to the session
+   executeSessionRequest(context, ptrConnection, pRequest, streamPath,
+                         validateUid, proxyErrorHandler, connectionRetryProfile,
+                         true, pSpan);
 }
 
 // function used to periodically validate that the user is valid (has an
@@ -809,8 +999,26 @@ void proxyLocalhostRequest(
       request.setHeader("Connection", "close");
    }
 
+   // serve immutable dependency assets we've already seen (e.g. htmlwidgets
+   // and shiny libraries) without going back to the local server
+   std::string assetKey;
+   bool cacheable = proxy_asset_cache::isCacheableRequest(context.username,
+                                                          request,
+                                                          &assetKey);
+   if (cacheable &&
+       proxy_asset_cache::respond(assetKey, request, &(ptrConnection->response())))
+   {
+      ptrConnection->writeResponse();
+      return;
+   }
+
    LocalhostResponseHandler onResponse =
          boost::bind(handleLocalhostResponse, ptrConnection, _3, port, _2, ipv6, _1);
+   if (cacheable)
+   {
+      onResponse = boost::bind(handleCacheableLocalhostResponse, assetKey,
+                               ptrConnection, _3, port, _2, ipv6, _1);
+   }
    http::ErrorHandler onError = boost::bind(handleLocalhostError, ptrConnection, _1);
 
    // see if the request should be handled by the overlay
@@ -840,7 +1048,7 @@ void proxyLocalhostRequest(
 
    // execute request
    pClient->execute(
-            boost::bind(handleLocalhostResponse, ptrConnection, pClient, port, address, ipv6, _1),
+            boost::bind(onResponse, _1, address, pClient),
             onError);
 }
 
@@ -849,6 +1057,36 @@ bool requiresSession(const http::Request& request)
    return !request.headerValue(kRStudioSessionRequiredHeader).empty();
 }
 
+void prelaunchSession(const std::string& username)
+{
+   if (!server::options().rsessionPrelaunchOnSignIn())
+      return;
+
+   // a custom context source picks the session from the request, so we
+   // can't know which one the user's first request will want
+   if (s_sessionContextSource)
+      return;
+
+   r_util::SessionContext context(username);
+   if (session::collectInvalidScope(context) != core::r_util::ScopeValid)
+      return;
+
+   // the stream exists while the session is running (don't launch a second
+   // session over a live one)
+   std::string streamFile = r_util::sessionContextFile(context);
+   FilePath streamPath = server_core::sessions::local_streams::streamPath(streamFile);
+   if (streamPath.exists())
+      return;
+
+   // the launch is recorded as pending, so the user's first request waits
+   // for it rather than launching again
+   Error error = sessionManager().launchSession(server::server()->ioService(),
+                                                context,
+                                                http::Request());
+   if (error)
+      LOG_ERROR(error);
+}
+
 void setProxyFilter(ProxyFilter filter)
 {
    s_proxyFilter = filter;
@@ -15,13 +15,18 @@
 
 #include <server/auth/ServerValidateUser.hpp>
 
+#include <map>
+
 #include <boost/foreach.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/format.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <core/Error.hpp>
 #include <core/Log.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/StringUtils.hpp>
+#include <core/Thread.hpp>
 
 #include <core/system/PosixSystem.hpp>
 #include <core/system/PosixUser.hpp>
@@ -34,23 +39,97 @@ namespace rstudio {
 namespace server {
 namespace auth {
 
-bool validateUser(const std::string& username,
-                  const std::string& requiredGroup,
-                  unsigned int minimumUserId,
-                  bool failureWarning)
+namespace {
+
+// recent validation results. validating looks up the user and their groups,
+// which with network backed user databases (ldap, sssd, etc.) can take some
+// time, and users are validated on many requests. entries are keyed on the
+// username and the requirements they were validated against
+struct Validation
 {
-   // short circuit if we aren't validating users
-   if (!server::options().authValidateUsers())
+   bool valid;
+   boost::posix_time::ptime validUntil;
+};
+
+typedef std::map<std::pair<std::string, std::string>, Validation> Validations;
+
+const boost::posix_time::seconds kValidationLifetime(60);
+const std::size_t kMaxValidations = 1024;
+
+boost::mutex s_validationsMutex;
+Validations s_validations;
+
+Validations::key_type validationKey(const std::string& username,
+                                    const std::string& requiredGroup,
+                                    unsigned int minimumUserId)
+{
+   return std::make_pair(username,
+                         requiredGroup + "|" +
+                         safe_convert::numberToString(minimumUserId));
+}
+
+bool lookupValidation(const Validations::key_type& key, bool* pValid)
+{
+   using namespace boost::posix_time;
+   ptime now = second_clock::universal_time();
+
+   LOCK_MUTEX(s_validationsMutex)
+   {
+      Validations::iterator it = s_validations.find(key);
+      if (it == s_validations.end())
+         return false;
+
+      if (it->second.validUntil <= now)
+      {
+         s_validations.erase(it);
+         return false;
+      }
+
+      *pValid = it->second.valid;
       return true;
-   
+   }
+   END_LOCK_MUTEX
+
+   return false;
+}
+
+void rememberValidation(const Validations::key_type& key, bool valid)
+{
+   Validation validation;
+   validation.valid = valid;
+   validation.validUntil = boost::posix_time::second_clock::universal_time() +
+                           kValidationLifetime;
+
+   LOCK_MUTEX(s_validationsMutex)
+   {
+      // entries are short-lived, so rather than tracking use just start
+      // over once we've seen a lot of distinct users
+      if (s_validations.size() >= kMaxValidations)
+         s_validations.clear();
+
+      s_validations[key] = validation;
+   }
+   END_LOCK_MUTEX
+}
+
+bool validateUserUncached(const std::string& username,
+                          const std::string& requiredGroup,
+                          unsigned int minimumUserId,
+                          bool failureWarning,
+                          bool* pCacheable)
+{
    // get the user
    core::system::user::User user;
    Error error = userFromUsername(username, &user);
    if (error)
    {
-      // log the error only if it is unexpected
+      // log the error only if it is unexpected (and don't remember the
+      // result, as it may well be temporary)
       if (!core::system::isUserNotFoundError(error))
+      {
          LOG_ERROR(error);
+         *pCacheable = false;
+      }
 
       // not found either due to non-existence or an unexpected error
       return false;
@@ -88,7 +167,10 @@ bool validateUser(const std::string& username,
                                                         group,
                                                         &belongsToGroup);
          if (error)
+         {
             LOG_ERROR(error);
+            *pCacheable = false;
+         }
 
          // break if we found a match
          if (belongsToGroup)
@@ -115,6 +197,48 @@ bool validateUser(const std::string& username,
    }
 }
 
+} // anonymous namespace
+
+bool validateUser(const std::string& username,
+                  const std::string& requiredGroup,
+                  unsigned int minimumUserId,
+                  bool failureWarning)
+{
+   // short circuit if we aren't validating users
+   if (!server::options().authValidateUsers())
+      return true;
+
+   Validations::key_type key = validationKey(username,
+                                             requiredGroup,
+                                             minimumUserId);
+   bool valid = false;
+   if (lookupValidation(key, &valid))
+      return valid;
+
+   bool cacheable = true;
+   valid = validateUserUncached(username,
+                                requiredGroup,
+                                minimumUserId,
+                                failureWarning,
+                                &cacheable);
+   if (cacheable)
+      rememberValidation(key, valid);
+
+   return valid;
+}
+
+void invalidateUser(const std::string& username)
+{
+   LOCK_MUTEX(s_validationsMutex)
+   {
+      Validations::iterator it = s_validations.lower_bound(
+                                 std::make_pair(username, std::string()));
+      while (it != s_validations.end() && it->first.first == username)
+         s_validations.erase(it++);
+   }
+   END_LOCK_MUTEX
+}
+
 } // namespace auth
 } // namespace server
 } // namespace rstudio
@@ -19,6 +19,7 @@
 #include <string>
 #include <map>
 #include <iosfwd>
+#include <algorithm>
 
 #include <boost/utility.hpp>
 
@@ -26,6 +27,8 @@
 #include <core/ProgramOptions.hpp>
 #include <core/SafeConvert.hpp>
 #include <core/system/Types.hpp>
+#include <core/http/AsyncConnection.hpp>
+#include <core/http/SocketProxy.hpp>
 
 namespace rstudio {
 namespace core {
@@ -80,6 +83,13 @@ public:
 
    bool serverSetUmask() const { return serverSetUmask_; }
 
+   double serverTraceSampleRate() const { return serverTraceSampleRate_; }
+
+   std::string serverTraceDir() const
+   {
+      return std::string(serverTraceDir_.c_str());
+   }
+
    // www 
    std::string wwwAddress() const
    { 
@@ -126,6 +136,37 @@ public:
       return wwwThreadPoolSize_;
    }
 
+   bool wwwIoServicePerThread() const
+   {
+      return wwwIoServicePerThread_;
+   }
+
+   int wwwCompressionLevel() const
+   {
+      return wwwCompressionLevel_;
+   }
+
+   core::http::SocketProxyOptions wwwProxyOptions() const
+   {
+      core::http::SocketProxyOptions options;
+      options.bufferSize = std::max(wwwProxyBufferSize_, 1024);
+      options.useSplice = wwwProxySplice_;
+      return options;
+   }
+
+   std::size_t wwwProxyAssetCacheBytes() const
+   {
+      return static_cast<std::size_t>(std::max(wwwProxyAssetCacheMb_, 0)) *
+             1024 * 1024;
+   }
+
+   core::http::KeepAliveOptions wwwKeepAliveOptions() const
+   {
+      return core::http::KeepAliveOptions(
+               std::max(wwwKeepAliveMaxRequests_, 0),
+               boost::posix_time::seconds(std::max(wwwKeepAliveTimeoutSecs_, 1)));
+   }
+
    bool wwwProxyLocalhost() const
    {
       return wwwProxyLocalhost_;
@@ -177,6 +218,11 @@ public:
       return std::string(authPamHelperPath_.c_str());
    }
 
+   std::size_t authPamHelperPoolSize() const
+   {
+      return std::max(authPamHelperPoolSize_, 0);
+   }
+
    // rsession
    std::string rsessionWhichR() const
    {
@@ -208,6 +254,66 @@ public:
       return rsessionProxyMaxWaitSeconds_;
    }
 
+   std::size_t rsessionProxyPoolSize() const
+   {
+      return std::max(rsessionProxyPoolSize_, 0);
+   }
+
+   bool rsessionPrelaunchOnSignIn() const
+   {
+      return rsessionPrelaunchOnSignIn_;
+   }
+
+   int rsessionMaxConcurrentLaunches() const
+   {
+      return std::max(rsessionMaxConcurrentLaunches_, 0);
+   }
+
+   double rsessionLaunchMaxLoad() const
+   {
+      return rsessionLaunchMaxLoad_;
+   }
+
+   int rsessionLaunchMinFreeMb() const
+   {
+      return std::max(rsessionLaunchMinFreeMb_, 0);
+   }
+
+   int rsessionLowMemoryMb() const
+   {
+      return std::max(rsessionLowMemoryMb_, 0);
+   }
+
+   int rsessionSuspendMemoryMb() const
+   {
+      return std::max(rsessionSuspendMemoryMb_, 0);
+   }
+
+   int rsessionSuspendIdleMinutes() const
+   {
+      return std::max(rsessionSuspendIdleMinutes_, 1);
+   }
+
+   std::string rsessionCgroupPath() const
+   {
+      return std::string(rsessionCgroupPath_.c_str());
+   }
+
+   int rsessionCpuWeight() const
+   {
+      return std::max(rsessionCpuWeight_, 0);
+   }
+
+   int rsessionMemoryHighMb() const
+   {
+      return std::max(rsessionMemoryHighMb_, 0);
+   }
+
+   std::string rsessionIoMax() const
+   {
+      return std::string(rsessionIoMax_.c_str());
+   }
+
    std::string monitorSharedSecret() const
    {
       return std::string(monitorSharedSecret_.c_str());
@@ -264,6 +370,8 @@ private:
    bool serverDaemonize_;
    bool serverSetUmask_;
    bool serverOffline_;
+   double serverTraceSampleRate_;
+   std::string serverTraceDir_;
    std::string wwwAddress_ ;
    std::string wwwPort_ ;
    std::string wwwLocalPath_ ;
@@ -271,6 +379,13 @@ private:
    std::string wwwFrameOrigin_;
    bool wwwUseEmulatedStack_;
    int wwwThreadPoolSize_;
+   bool wwwIoServicePerThread_;
+   int wwwCompressionLevel_;
+   int wwwProxyBufferSize_;
+   bool wwwProxySplice_;
+   int wwwProxyAssetCacheMb_;
+   int wwwKeepAliveMaxRequests_;
+   int wwwKeepAliveTimeoutSecs_;
    bool wwwProxyLocalhost_;
    bool wwwVerifyUserAgent_;
    bool authNone_;
@@ -281,12 +396,25 @@ private:
    std::string authRequiredUserGroup_;
    unsigned int authMinimumUserId_;
    std::string authPamHelperPath_;
+   int authPamHelperPoolSize_;
    std::string rsessionWhichR_;
    std::string rsessionPath_;
    std::string rldpathPath_;
    std::string rsessionConfigFile_;
    std::string rsessionLdLibraryPath_;
    int rsessionProxyMaxWaitSeconds_;
+   int rsessionProxyPoolSize_;
+   bool rsessionPrelaunchOnSignIn_;
+   int rsessionMaxConcurrentLaunches_;
+   double rsessionLaunchMaxLoad_;
+   int rsessionLaunchMinFreeMb_;
+   int rsessionLowMemoryMb_;
+   int rsessionSuspendMemoryMb_;
+   int rsessionSuspendIdleMinutes_;
+   std::string rsessionCgroupPath_;
+   int rsessionCpuWeight_;
+   int rsessionMemoryHighMb_;
+   std::string rsessionIoMax_;
    std::string monitorSharedSecret_;
    int monitorIntervalSeconds_;
    std::map<std::string,std::string> overlayOptions_;
@@ -0,0 +1,81 @@
+/*
+ * ServerPAMHelperPool.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SERVER_PAM_HELPER_POOL_HPP
+#define SERVER_PAM_HELPER_POOL_HPP
+
+#include <string>
+
+#include <boost/function.hpp>
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace server {
+namespace pam_helper_pool {
+
+// pool of long-lived PAM helper processes (rserver-pam --broker), each of
+// which authenticates any number of logins (one at a time) over its
+// stdin/stdout. this saves launching a helper for every login. the pool
+// launches helpers as they're needed, up to its size, after which logins
+// wait their turn for a helper
+
+struct Stats
+{
+   Stats()
+      : logins(0), authenticated(0), rejected(0), errors(0), launches(0),
+        totalMs(0), maxMs(0)
+   {
+   }
+
+   std::size_t logins;
+   std::size_t authenticated;
+   std::size_t rejected;
+   std::size_t errors;
+   std::size_t launches;
+   double totalMs;
+   double maxMs;
+};
+
+// is the pool enabled
+bool enabled();
+
+// authenticate the user through one of the pool's helpers (onAfterFork is
+// called in the child of any helper launched for the purpose). an error
+// is returned if no helper could give an answer (e.g. it couldn't be
+// launched or timed out). pRequestSent is set once any of the credentials
+// have been written to a helper; only when they haven't should the caller
+// fall back to running the helper itself, as otherwise the login may
+// already have been attempted
+core::Error login(const std::string& username,
+                  const std::string& password,
+                  const boost::function<void()>& onAfterFork,
+                  bool* pAuthenticated,
+                  bool* pRequestSent);
+
+// statistics since they were last collected (collecting resets them)
+Stats collectStats();
+
+core::Error initialize();
+
+} // namespace pam_helper_pool
+} // namespace server
+} // namespace rstudio
+
+#endif // SERVER_PAM_HELPER_POOL_HPP
@@ -0,0 +1,65 @@
+/*
+ * ServerProxyAssetCache.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SERVER_PROXY_ASSET_CACHE_HPP
+#define SERVER_PROXY_ASSET_CACHE_HPP
+
+#include <string>
+
+namespace rstudio {
+namespace core {
+namespace http {
+   class Request;
+   class Response;
+}
+}
+}
+
+namespace rstudio {
+namespace server {
+namespace proxy_asset_cache {
+
+// cache of the static dependency assets (e.g. jquery, bootstrap and
+// htmlwidgets libraries) which shiny apps and other local web servers
+// serve from versioned directories ("<name>-<version>/..."). such assets
+// are immutable so once a user's server has returned one it is served
+// from here (with long lived cache headers) rather than being proxied to
+// the user's session again. entries are keyed by user (so one user's
+// servers can't supply the assets served to another) and the contents
+// are stored by content hash so the copies shared by many users are only
+// held once
+
+// is the (localhost proxied) request for a cacheable asset. pKey is set
+// to the key to look it up by. the request uri should have had its
+// port prefix removed
+bool isCacheableRequest(const std::string& username,
+                        const core::http::Request& request,
+                        std::string* pKey);
+
+// respond to the request from the cache (returns false if the asset
+// isn't cached)
+bool respond(const std::string& key,
+             const core::http::Request& request,
+             core::http::Response* pResponse);
+
+// add a response to the cache (responses which aren't plain, successful
+// and modestly sized are ignored)
+void add(const std::string& key, const core::http::Response& response);
+
+} // namespace proxy_asset_cache
+} // namespace server
+} // namespace rstudio
+
+#endif // SERVER_PROXY_ASSET_CACHE_HPP
@@ -0,0 +1,37 @@
+/*
+ * ServerRequestMetrics.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SERVER_REQUEST_METRICS_HPP
+#define SERVER_REQUEST_METRICS_HPP
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace server {
+namespace request_metrics {
+
+// collect latency, in-flight, and byte counts for requests to rserver
+// (by uri prefix) and periodically report them to the monitor
+core::Error initialize();
+
+} // namespace request_metrics
+} // namespace server
+} // namespace rstudio
+
+#endif // SERVER_REQUEST_METRICS_HPP
@@ -0,0 +1,77 @@
+/*
+ * ServerSessionConnectionPool.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SERVER_SESSION_CONNECTION_POOL_HPP
+#define SERVER_SESSION_CONNECTION_POOL_HPP
+
+#include <core/http/LocalStreamAsyncClient.hpp>
+
+#include <core/r_util/RSessionContext.hpp>
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace server {
+namespace session_connection_pool {
+
+// pool of idle persistent connections to rsession processes, keyed
+// by session context and the io_service the connection was opened on
+// (a connection is only handed to requests served by the same io_service).
+// connections are returned to the pool after a proxied request completes
+// and are evicted when the session exits
+
+typedef core::http::LocalStreamAsyncClient::PersistentSocket Connection;
+
+struct Stats
+{
+   Stats() : hits(0), misses(0), evictions(0), idle(0) {}
+
+   std::size_t hits;
+   std::size_t misses;
+   std::size_t evictions;
+   std::size_t idle;
+};
+
+// is connection pooling enabled
+bool enabled();
+
+// take an idle connection for the session opened on ioService (returns an
+// empty pointer if there are none, in which case the caller should connect
+// anew). connections the session has closed are evicted rather than returned
+Connection acquire(boost::asio::io_service& ioService,
+                   const core::r_util::SessionContext& context);
+
+// return a connection to the pool once its response has been received
+void release(boost::asio::io_service& ioService,
+             const core::r_util::SessionContext& context,
+             const Connection& connection);
+
+// close and remove all idle connections for the session
+void evict(const core::r_util::SessionContext& context);
+
+// current pool statistics
+Stats stats();
+
+core::Error initialize();
+
+} // namespace session_connection_pool
+} // namespace server
+} // namespace rstudio
+
+#endif // SERVER_SESSION_CONNECTION_POOL_HPP
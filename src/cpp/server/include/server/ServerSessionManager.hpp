@@ -67,6 +67,16 @@ public:
                              const core::http::ErrorHandler& onError = core::http::ErrorHandler());
    void removePendingLaunch(const core::r_util::SessionContext& context);
 
+   // launches beyond rsession-max-concurrent-launches (or started while the
+   // system is loaded) wait in a queue; resumes of open clients go first
+   bool isLaunchQueued(const core::r_util::SessionContext& context);
+   core::Error initialize();
+
+   // note client activity for a session; sessions which have been idle the
+   // longest are suspended first when memory runs short
+   // (rsession-suspend-memory-mb)
+   void noteSessionActivity(const core::r_util::SessionContext& context);
+
    // set a custom session launcher
    typedef boost::function<core::Error(
                            boost::asio::io_service&,
@@ -93,6 +103,33 @@ private:
                         boost::asio::io_service&,
                         const core::r_util::SessionLaunchProfile& profile);
 
+   // launch admission
+   struct QueuedLaunch
+   {
+      boost::asio::io_service* pIoService;
+      core::r_util::SessionContext context;
+      boost::shared_ptr<core::http::Request> pRequest;
+      core::http::ResponseHandler onLaunch;
+      core::http::ErrorHandler onError;
+      int priority;
+      boost::posix_time::ptime queuedTime;
+   };
+   bool admitLaunch();
+   bool isQueued(const core::r_util::SessionContext& context) const;
+   static bool launchesBefore(const QueuedLaunch& lhs, const QueuedLaunch& rhs);
+   core::Error launchNow(boost::asio::io_service& ioService,
+                         const core::r_util::SessionContext& context,
+                         const core::http::Request& request,
+                         const core::http::ResponseHandler& onLaunch,
+                         const core::http::ErrorHandler& onError);
+   bool processLaunchQueue();
+
+   // session processes and memory pressure
+   void onSessionExit(const core::r_util::SessionContext& context,
+                      PidType pid);
+   bool suspendIdleSessions();
+   bool sendUsageMetrics();
+
 private:
    // pending launches
    boost::mutex launchesMutex_;
@@ -100,6 +137,11 @@ private:
                     boost::posix_time::ptime> LaunchMap;
    LaunchMap pendingLaunches_;
 
+   // launches started but not yet answered, and those waiting to start
+   // (both guarded by launchesMutex_)
+   LaunchMap activeLaunches_;
+   std::vector<QueuedLaunch> launchQueue_;
+
    // session launch function
    SessionLaunchFunction sessionLaunchFunction_;
 
@@ -108,6 +150,13 @@ private:
 
    // child process tracker
    core::system::ChildProcessTracker processTracker_;
+
+   // running session processes, when clients last used them and when we
+   // last asked them to suspend (all guarded by sessionsMutex_)
+   boost::mutex sessionsMutex_;
+   std::map<PidType, core::r_util::SessionContext> sessionPids_;
+   LaunchMap lastActivity_;
+   std::map<PidType, boost::posix_time::ptime> suspendRequested_;
 };
 
 // set a process config filter
@@ -72,6 +72,10 @@ void proxyLocalhostRequest(
    
 bool requiresSession(const core::http::Request& request);
 
+// start the user's default session ahead of their first request (so R
+// starts up while the client loads) if it isn't already running
+void prelaunchSession(const std::string& username);
+
 typedef boost::function<bool(
     boost::shared_ptr<core::http::AsyncConnection>,
     const core::r_util::SessionContext&
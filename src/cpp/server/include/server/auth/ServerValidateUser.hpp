@@ -24,6 +24,9 @@ namespace rstudio {
 namespace server {
 namespace auth {
 
+// validate that the user has an account and meets the requirements given.
+// results are remembered briefly (as validation consults the system's user
+// database) unless invalidated
 bool validateUser(
   const std::string& username,
   const std::string& requiredGroup,
@@ -38,6 +41,9 @@ inline bool validateUser(const std::string& username)
                        true);
 }
 
+// forget the user's remembered validation results (e.g. as they sign in or
+// out) so that they are next validated afresh
+void invalidateUser(const std::string& username);
 
 } // namespace auth
 } // namespace server
@@ -48,6 +48,62 @@ int inappropriateUsage(const ErrorLocation& location)
    return EXIT_FAILURE;
 }
 
+// read a null terminated field from stdin (returns false at the end of
+// input or if the field exceeds the maximum length)
+bool readField(std::size_t maxLength, std::string* pField)
+{
+   pField->clear();
+   int ch = 0;
+   while ((ch = ::fgetc(stdin)) != EOF)
+   {
+      if (ch == '\0')
+         return true;
+
+      if (pField->size() >= maxLength)
+         return false;
+
+      pField->push_back(static_cast<char>(ch));
+   }
+   return false;
+}
+
+// authenticate any number of logins, each read from stdin as
+//
+//    <username>\0<password>\0
+//
+// and answered with a line of 1 (authenticated) or 0, until stdin is closed.
+// this lets rserver keep helpers running rather than launching one for
+// every login (see ServerPAMHelperPool.cpp)
+int runBroker(const std::string& service)
+{
+   const std::size_t MAXUSER = 256;
+   const std::size_t MAXPASS = 200;
+
+   std::string username, password;
+   while (readField(MAXUSER, &username))
+   {
+      if (!readField(MAXPASS, &password))
+      {
+         LOG_WARNING_MESSAGE("Password exceeded maximum length for "
+                             "user " + username);
+         return EXIT_FAILURE;
+      }
+
+      bool authenticated = false;
+      if (!password.empty())
+      {
+         core::system::PAM pam(service, false);
+         authenticated = pam.login(username, password) == PAM_SUCCESS;
+      }
+
+      std::cout << (authenticated ? "1" : "0") << std::endl;
+      if (!std::cout)
+         return EXIT_FAILURE;
+   }
+
+   return ::feof(stdin) && username.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 } // anonymous namespace
 
 
@@ -71,6 +127,10 @@ int main(int argc, char * const argv[])
       else if (argc != 2 && argc != 3)
          return inappropriateUsage(ERROR_LOCATION);
 
+      // run as a persistent helper (optionally for the given service)
+      if (std::string(argv[1]) == "--broker")
+         return runBroker(argc == 3 ? argv[2] : "rstudio");
+
       // read username from command line
       std::string username(argv[1]);
 
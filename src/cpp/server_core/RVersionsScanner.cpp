@@ -15,12 +15,19 @@
 
 #include <server_core/RVersionsScanner.hpp>
 
+#include <ctime>
+#include <map>
+
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
 #include <core/Error.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/Thread.hpp>
 #include <core/json/JsonRpc.hpp>
 #include <core/r_util/REnvironment.hpp>
 #include <core/r_util/RVersionsPosix.hpp>
@@ -28,7 +35,282 @@
 
 namespace rstudio {
 namespace core {
-  
+
+struct RVersionsScanner::DetectionCache
+   : boost::noncopyable,
+     boost::enable_shared_from_this<RVersionsScanner::DetectionCache>
+{
+   DetectionCache(const FilePath& cacheFile,
+                  const FilePath& ldPathsScript,
+                  const std::string& ldLibraryPath)
+      : cacheFile_(cacheFile),
+        ldPathsScript_(ldPathsScript),
+        ldLibraryPath_(ldLibraryPath)
+   {
+      Error error = readFromFile();
+      if (error && !isPathNotFoundError(error))
+         LOG_ERROR(error);
+   }
+
+   bool detect(const FilePath& rScriptPath,
+               const std::string& prelaunchScript,
+               std::string* pVersion,
+               core::system::Options* pEnvironment,
+               std::string* pErrMsg)
+   {
+      std::string key = entryKey(rScriptPath, prelaunchScript);
+      bool found = false, stale = false;
+      LOCK_MUTEX(mutex_)
+      {
+         std::map<std::string, Entry>::iterator it = entries_.find(key);
+         if (it != entries_.end())
+         {
+            Entry& entry = it->second;
+            *pVersion = entry.version;
+            *pEnvironment = entry.environment;
+            found = true;
+
+            // refresh entries for Rs which have changed (once at a time)
+            if (!entry.refreshing && !entry.current(rScriptPath))
+            {
+               entry.refreshing = true;
+               stale = true;
+            }
+         }
+      }
+      END_LOCK_MUTEX
+
+      if (found)
+      {
+         if (stale)
+         {
+            core::thread::safeLaunchThread(
+                     boost::bind(&DetectionCache::refresh,
+                                 shared_from_this(),
+                                 rScriptPath,
+                                 prelaunchScript));
+         }
+         return true;
+      }
+
+      // not yet detected, so detect it now
+      Entry entry;
+      if (!detectEntry(rScriptPath, prelaunchScript, &entry, pErrMsg))
+         return false;
+
+      *pVersion = entry.version;
+      *pEnvironment = entry.environment;
+      update(key, &entry);
+      return true;
+   }
+
+private:
+   struct Entry
+   {
+      Entry()
+         : scriptModified(0), binaryModified(0), refreshing(false)
+      {
+      }
+
+      static std::time_t modified(const FilePath& filePath)
+      {
+         return filePath.exists() ? filePath.lastWriteTime() : 0;
+      }
+
+      // R_HOME/bin/exec/R (as opposed to the R_HOME/bin/R script)
+      static FilePath binaryPath(const FilePath& rScriptPath)
+      {
+         return rScriptPath.parent().childPath("exec/R");
+      }
+
+      void stamp(const FilePath& rScriptPath)
+      {
+         scriptModified = modified(rScriptPath);
+         binaryModified = modified(binaryPath(rScriptPath));
+      }
+
+      bool current(const FilePath& rScriptPath) const
+      {
+         return scriptModified == modified(rScriptPath) &&
+                binaryModified == modified(binaryPath(rScriptPath));
+      }
+
+      std::time_t scriptModified;
+      std::time_t binaryModified;
+      std::string version;
+      core::system::Options environment;
+      bool refreshing;
+   };
+
+   static std::string entryKey(const FilePath& rScriptPath,
+                               const std::string& prelaunchScript)
+   {
+      return rScriptPath.absolutePath() + "\n" + prelaunchScript;
+   }
+
+   bool detectEntry(const FilePath& rScriptPath,
+                    const std::string& prelaunchScript,
+                    Entry* pEntry,
+                    std::string* pErrMsg)
+   {
+      // stamp the entry before detecting, so that a change made while R
+      // is running is picked up next time
+      pEntry->stamp(rScriptPath);
+
+      std::string rDetectedScriptPath;
+      return r_util::detectREnvironment(rScriptPath,
+                                        ldPathsScript_,
+                                        ldLibraryPath_,
+                                        &rDetectedScriptPath,
+                                        &pEntry->version,
+                                        &pEntry->environment,
+                                        pErrMsg,
+                                        prelaunchScript);
+   }
+
+   void refresh(const FilePath& rScriptPath,
+                const std::string& prelaunchScript)
+   {
+      std::string key = entryKey(rScriptPath, prelaunchScript);
+      Entry entry;
+      std::string errMsg;
+      if (detectEntry(rScriptPath, prelaunchScript, &entry, &errMsg))
+      {
+         update(key, &entry);
+      }
+      else
+      {
+         // the R can no longer be run, so forget it
+         LOG_ERROR_MESSAGE("Error scanning R version at " +
+                           rScriptPath.absolutePath() + ": " + errMsg);
+         update(key, NULL);
+      }
+   }
+
+   // set (or remove, if pEntry is NULL) an entry and persist the cache
+   void update(const std::string& key, const Entry* pEntry)
+   {
+      Error error;
+      LOCK_MUTEX(mutex_)
+      {
+         if (pEntry)
+            entries_[key] = *pEntry;
+         else
+            entries_.erase(key);
+
+         error = writeToFile();
+      }
+      END_LOCK_MUTEX
+
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   Error writeToFile() const
+   {
+      json::Array entriesJson;
+      for (std::map<std::string, Entry>::const_iterator it = entries_.begin();
+           it != entries_.end();
+           ++it)
+      {
+         std::string::size_type separator = it->first.find('\n');
+         const Entry& entry = it->second;
+
+         json::Object entryJson;
+         entryJson["script"] = it->first.substr(0, separator);
+         entryJson["prelaunchScript"] = it->first.substr(separator + 1);
+         entryJson["scriptModified"] =
+               static_cast<boost::int64_t>(entry.scriptModified);
+         entryJson["binaryModified"] =
+               static_cast<boost::int64_t>(entry.binaryModified);
+         entryJson["version"] = entry.version;
+         entryJson["environment"] = json::toJsonObject(entry.environment);
+         entriesJson.push_back(entryJson);
+      }
+
+      json::Object cacheJson;
+      cacheJson["ldPathsScript"] = ldPathsScript_.absolutePath();
+      cacheJson["ldLibraryPath"] = ldLibraryPath_;
+      cacheJson["entries"] = entriesJson;
+
+      Error error = cacheFile_.parent().ensureDirectory();
+      if (error)
+         return error;
+
+      std::ostringstream ostr;
+      json::write(cacheJson, ostr);
+      return writeStringToFile(cacheFile_, ostr.str());
+   }
+
+   Error readFromFile()
+   {
+      std::string contents;
+      Error error = readStringFromFile(cacheFile_, &contents);
+      if (error)
+         return error;
+
+      json::Value cacheJson;
+      if (!json::parse(contents, &cacheJson) ||
+          !json::isType<json::Object>(cacheJson))
+      {
+         error = systemError(boost::system::errc::bad_message, ERROR_LOCATION);
+         error.addProperty("path", cacheFile_.absolutePath());
+         return error;
+      }
+
+      std::string ldPathsScript, ldLibraryPath;
+      json::Array entriesJson;
+      error = json::readObject(cacheJson.get_obj(),
+                               "ldPathsScript", &ldPathsScript,
+                               "ldLibraryPath", &ldLibraryPath,
+                               "entries", &entriesJson);
+      if (error)
+         return error;
+
+      // environments detected with other library paths don't apply
+      if (ldPathsScript != ldPathsScript_.absolutePath() ||
+          ldLibraryPath != ldLibraryPath_)
+      {
+         return Success();
+      }
+
+      BOOST_FOREACH(const json::Value& entryJson, entriesJson)
+      {
+         if (!json::isType<json::Object>(entryJson))
+            return systemError(boost::system::errc::bad_message,
+                               ERROR_LOCATION);
+
+         std::string script, prelaunchScript;
+         boost::int64_t scriptModified = 0, binaryModified = 0;
+         Entry entry;
+         json::Object environmentJson;
+         error = json::readObject(entryJson.get_obj(),
+                                  "script", &script,
+                                  "prelaunchScript", &prelaunchScript,
+                                  "scriptModified", &scriptModified,
+                                  "binaryModified", &binaryModified,
+                                  "version", &entry.version,
+                                  "environment", &environmentJson);
+         if (error)
+            return error;
+
+         entry.scriptModified = static_cast<std::time_t>(scriptModified);
+         entry.binaryModified = static_cast<std::time_t>(binaryModified);
+         entry.environment = json::optionsFromJson(environmentJson);
+         entries_[entryKey(FilePath(script), prelaunchScript)] = entry;
+      }
+
+      return Success();
+   }
+
+   const FilePath cacheFile_;
+   const FilePath ldPathsScript_;
+   const std::string ldLibraryPath_;
+
+   boost::mutex mutex_;
+   std::map<std::string, Entry> entries_;
+};
+
 RVersionsScanner::RVersionsScanner() :
    checkCommonRLocations_(true),
    whichROverride_(""),
@@ -63,21 +345,51 @@ RVersionsScanner::RVersionsScanner(bool checkCommonRLocations,
 {
 }
 
+void RVersionsScanner::setCacheFile(const core::FilePath& cacheFile)
+{
+   pDetectionCache_.reset(
+            new DetectionCache(cacheFile, rLdScriptPath_, rLdLibraryPath_));
+}
+
+bool RVersionsScanner::detectREnvironment(const core::FilePath& rScriptPath,
+                                          const std::string& prelaunchScript,
+                                          std::string* pVersion,
+                                          core::system::Options* pEnvironment,
+                                          std::string* pErrMsg)
+{
+   // (an empty path is that of the R on the path, which can't be cached by
+   // its modification time)
+   if (pDetectionCache_ && rScriptPath.exists())
+   {
+      return pDetectionCache_->detect(rScriptPath,
+                                      prelaunchScript,
+                                      pVersion,
+                                      pEnvironment,
+                                      pErrMsg);
+   }
+
+   std::string rDetectedScriptPath;
+   return r_util::detectREnvironment(rScriptPath,
+                                     rLdScriptPath_,
+                                     rLdLibraryPath_,
+                                     &rDetectedScriptPath,
+                                     pVersion,
+                                     pEnvironment,
+                                     pErrMsg,
+                                     prelaunchScript);
+}
+
 bool RVersionsScanner::detectRVersion(const core::FilePath& rScriptPath,
                                       core::r_util::RVersion* pVersion,
                                       std::string* pErrMsg)
 {
-   std::string rDetectedScriptPath;
    std::string rVersion;
    core::r_util::EnvironmentVars environment;
-   bool result = r_util::detectREnvironment(
-                                     rScriptPath,
-                                     rLdScriptPath_,
-                                     rLdLibraryPath_,
-                                     &rDetectedScriptPath,
-                                     &rVersion,
-                                     &environment,
-                                     pErrMsg);
+   bool result = detectREnvironment(rScriptPath,
+                                    std::string(),
+                                    &rVersion,
+                                    &environment,
+                                    pErrMsg);
    if (result)
    {
       *pVersion = core::r_util::RVersion(rVersion, environment);
@@ -178,7 +490,9 @@ std::vector<r_util::RVersion> RVersionsScanner::getRVersions()
             rEntries,
             checkCommonRLocations_,
             rLdScriptPath_,
-            rLdLibraryPath_);
+            rLdLibraryPath_,
+            boost::bind(&RVersionsScanner::detectREnvironment,
+                        this, _1, _2, _3, _4, _5));
 
    // cache the versions that we just found
    cachedVersions_ = versions;
@@ -17,6 +17,9 @@
 
 #include <sys/stat.h>
 
+#include <cstring>
+#include <map>
+
 #include <boost/optional.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -25,6 +28,7 @@
 
 #include <core/Log.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/Thread.hpp>
 
 #include <core/http/URL.hpp>
 #include <core/http/Request.hpp>
@@ -53,6 +57,82 @@ const char * const kDelim = "|";
 // secure cookie key
 std::string s_secureCookieKey ;
 
+// signed cookie values which recently passed validation. the same cookie
+// arrives with every proxied request, so remembering it briefly saves
+// recomputing its hmac each time. a hit requires the entire signed value
+// (hmac included) to match, and the cookie's own expiration still applies
+struct ValidatedCookie
+{
+   std::string value;
+   boost::posix_time::ptime expires;
+   boost::posix_time::ptime validatedUntil;
+};
+
+const boost::posix_time::seconds kValidatedCookieLifetime(60);
+const std::size_t kMaxValidatedCookies = 1024;
+
+boost::mutex s_validatedCookiesMutex;
+std::map<std::string, ValidatedCookie> s_validatedCookies;
+
+bool lookupValidatedCookie(const std::string& signedCookieValue,
+                           std::string* pValue)
+{
+   using namespace boost::posix_time;
+   ptime now = second_clock::universal_time();
+
+   LOCK_MUTEX(s_validatedCookiesMutex)
+   {
+      std::map<std::string, ValidatedCookie>::iterator it =
+                                 s_validatedCookies.find(signedCookieValue);
+      if (it == s_validatedCookies.end())
+         return false;
+
+      if (it->second.expires <= now || it->second.validatedUntil <= now)
+      {
+         s_validatedCookies.erase(it);
+         return false;
+      }
+
+      *pValue = it->second.value;
+      return true;
+   }
+   END_LOCK_MUTEX
+
+   return false;
+}
+
+void rememberValidatedCookie(const std::string& signedCookieValue,
+                             const std::string& value,
+                             const boost::posix_time::ptime& expires)
+{
+   using namespace boost::posix_time;
+
+   ValidatedCookie validated;
+   validated.value = value;
+   validated.expires = expires;
+   validated.validatedUntil = second_clock::universal_time() +
+                              kValidatedCookieLifetime;
+
+   LOCK_MUTEX(s_validatedCookiesMutex)
+   {
+      // entries are short-lived, so rather than tracking use just start
+      // over once we've seen a lot of distinct cookies
+      if (s_validatedCookies.size() >= kMaxValidatedCookies)
+         s_validatedCookies.clear();
+
+      s_validatedCookies[signedCookieValue] = validated;
+   }
+   END_LOCK_MUTEX
+}
+
+void forgetValidatedCookie(const std::string& signedCookieValue)
+{
+   LOCK_MUTEX(s_validatedCookiesMutex)
+   {
+      s_validatedCookies.erase(signedCookieValue);
+   }
+   END_LOCK_MUTEX
+}
 
 Error base64HMAC(const std::string& value,
                  const std::string& expires,
@@ -73,7 +153,11 @@ Error hashWithSecureKey(const std::string& message, std::string* pHMAC)
 
    // compute hmac for the message
    std::vector<unsigned char> hmac;
-   Error error = core::system::crypto::HMAC_SHA2(message, cookieKey, &hmac);
+   Error error = core::system::crypto::HMAC_SHA2(message.data(),
+                                                 message.size(),
+                                                 cookieKey,
+                                                 std::strlen(cookieKey),
+                                                 &hmac);
    if (error)
       return error;
 
@@ -135,6 +219,11 @@ std::string readSecureCookie(const core::http::Request& request,
 
 std::string readSecureCookie(const std::string& signedCookieValue)
 {
+   // check for a recent validation of this exact cookie
+   std::string validatedValue;
+   if (lookupValidatedCookie(signedCookieValue, &validatedValue))
+      return validatedValue;
+
    // split it into its parts (url decode them as well)
    std::string value, expires, hmac;
    using namespace boost;
@@ -186,6 +275,7 @@ std::string readSecureCookie(const std::string& signedCookieValue)
       return std::string();
 
    // ok to return the value
+   rememberValidatedCookie(signedCookieValue, value, expiresTime);
    return value;
 }
 
@@ -237,6 +327,11 @@ void remove(const http::Request& request,
             const std::string& path,
             core::http::Response* pResponse)
 {
+   // the cookie being removed is no longer to be taken as validated
+   std::string signedCookieValue = request.cookieValue(name);
+   if (!signedCookieValue.empty())
+      forgetValidatedCookie(signedCookieValue);
+
    // create vanilla cookie (no need for secure cookie since we are removing)
    http::Cookie cookie(request, name, std::string(), path);
 
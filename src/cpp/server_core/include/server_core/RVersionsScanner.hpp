@@ -16,6 +16,8 @@
 #ifndef SERVER_CORE_R_VERSIONS_SCANNER_HPP
 #define SERVER_CORE_R_VERSIONS_SCANNER_HPP
 
+#include <boost/shared_ptr.hpp>
+
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
 #include <core/json/JsonRpc.hpp>
@@ -52,6 +54,13 @@ public:
    bool detectSystemRVersion(core::r_util::RVersion* pVersion,
                              std::string* pErrMsg);
 
+   // persist the versions and environments detected to the given file,
+   // keyed by the path and modification time of each R, so that R needn't
+   // be run again to detect them (even by a later process). entries for Rs
+   // which have since changed continue to be used until they're refreshed
+   // in the background
+   void setCacheFile(const core::FilePath& cacheFile);
+
 private:
    bool checkCommonRLocations_;
    std::string whichROverride_;
@@ -64,6 +73,16 @@ private:
    core::r_util::RVersion systemVersion_;
    std::vector<r_util::RVersion> cachedVersions_;
 
+   // detected environments (if they're being cached)
+   struct DetectionCache;
+   boost::shared_ptr<DetectionCache> pDetectionCache_;
+
+   bool detectREnvironment(const core::FilePath& rScriptPath,
+                           const std::string& prelaunchScript,
+                           std::string* pVersion,
+                           core::system::Options* pEnvironment,
+                           std::string* pErrMsg);
+
    void parseRVersionsFile(const std::string& contents,
                            std::vector<FilePath> *pRPaths,
                            std::vector<r_util::RVersion> *pREntries);
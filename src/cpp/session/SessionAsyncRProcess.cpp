@@ -13,13 +13,20 @@
  *
  */
 
+#include <algorithm>
+
 #include <boost/foreach.hpp>
+#include <boost/algorithm/string.hpp>
 
 #include <session/SessionUserSettings.hpp>
 #include <session/SessionConsoleProcess.hpp>
 #include <session/SessionModuleContext.hpp>
 
+#include <core/Algorithm.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/StringUtils.hpp>
 #include <core/system/Environment.hpp>
+#include <core/system/System.hpp>
 #include <core/system/Process.hpp>
 
 #include <r/session/RSessionUtils.hpp>
@@ -30,46 +37,16 @@ namespace rstudio {
 namespace session {
 namespace async_r {
 
-AsyncRProcess::AsyncRProcess():
-   isRunning_(false),
-   terminationRequested_(false)
-{
-}
+namespace {
 
-void AsyncRProcess::start(const char* rCommand,
-                          core::system::Options environment,
-                          const core::FilePath& workingDir,
-                          AsyncRProcessOptions rOptions,
-                          std::vector<core::FilePath> rSourceFiles,
-                          const std::string& input)
-{
-   // R binary
-   core::FilePath rProgramPath;
-   core::Error error = module_context::rScriptPath(&rProgramPath);
-   if (error)
-   {
-      LOG_ERROR(error);
-      onCompleted(EXIT_FAILURE);
-      return;
-   }
-   
-   // core R files for augmented async processes
-   if (rOptions & R_PROCESS_AUGMENTED)
-   {
-      // R files we wish to source to provide functionality to async process
-      const core::FilePath modulesPath =
-            session::options().modulesRSourcePath();
-      
-      const core::FilePath rPath =
-            session::options().coreRSourcePath();
-      
-      const core::FilePath rTools =  rPath.childPath("Tools.R");
-      
-      // insert at begin as Tools.R needs to be sourced first
-      rSourceFiles.insert(rSourceFiles.begin(), rTools);
-   }
+// at most this many pooled processes are kept, and each is replaced once it
+// has run this many tasks or uses this much memory
+const std::size_t kMaxWorkers = 2;
+const int kMaxWorkerTasks = 50;
+const double kMaxWorkerMemoryMb = 256;
 
-   // args
+std::vector<std::string> rArguments(AsyncRProcessOptions rOptions)
+{
    std::vector<std::string> args;
    args.push_back("--slave");
    if (rOptions & R_PROCESS_VANILLA)
@@ -86,8 +63,12 @@ void AsyncRProcess::start(const char* rCommand,
       args.push_back("--internet2");
 #endif
 
-   args.push_back("-e");
-   
+   return args;
+}
+
+std::string commandArgument(const std::string& sourceCommand,
+                            const std::string& rCommand)
+{
    bool needsQuote = false;
 
    // On Windows, we turn the vector of strings into a single
@@ -97,39 +78,404 @@ void AsyncRProcess::start(const char* rCommand,
    // than multiple arguments) to '-e'.
 
 #ifdef _WIN32
-   needsQuote = strlen(rCommand) > 0 && rCommand[0] != '"';
+   needsQuote = !rCommand.empty() && rCommand[0] != '"';
 #endif
 
-   std::stringstream command;
-   if (needsQuote)
-      command << "\"";
+   if (!needsQuote)
+      return sourceCommand + rCommand;
 
    std::string escapedCommand = rCommand;
+   boost::algorithm::replace_all(escapedCommand, "\"", "\\\"");
+   return "\"" + sourceCommand + escapedCommand + "\"";
+}
+
+std::string sourceCommand(const std::vector<core::FilePath>& rSourceFiles)
+{
+   std::stringstream command;
+   for (std::vector<core::FilePath>::const_iterator it = rSourceFiles.begin();
+        it != rSourceFiles.end();
+        ++it)
+   {
+      command << "source('" << it->absolutePath() << "');";
+   }
+   return command.str();
+}
+
+core::system::Options childEnvironment(
+                              const core::system::Options& environment)
+{
+   // forward R_LIBS so the child process has access to the same libraries
+   // we do
+   core::system::Options childEnv;
+   core::system::environment(&childEnv);
+   std::string libPaths = module_context::libPathsString();
+   if (!libPaths.empty())
+   {
+      core::system::setenv(&childEnv, "R_LIBS", libPaths);
+   }
+   // forward passed environment variables
+   BOOST_FOREACH(const core::system::Option& var, environment)
+   {
+      core::system::setenv(&childEnv, var.first, var.second);
+   }
+   return childEnv;
+}
+
+core::FilePath toolsPath()
+{
+   return session::options().coreRSourcePath().childPath("Tools.R");
+}
+
+std::string quotedString(const std::string& str)
+{
+   return "'" + core::string_utils::singleQuotedStrEscape(str) + "'";
+}
+
+// the request a pooled process is sent to run a task (see AsyncWorker.R)
+std::string taskRequest(const char* rCommand,
+                        const core::FilePath& workingDir,
+                        AsyncRProcessOptions rOptions,
+                        const std::vector<core::FilePath>& rSourceFiles)
+{
+   std::vector<std::string> sources;
+   BOOST_FOREACH(const core::FilePath& sourceFile, rSourceFiles)
+   {
+      sources.push_back(quotedString(sourceFile.absolutePath()));
+   }
 
-   if (needsQuote)
-      boost::algorithm::replace_all(escapedCommand, "\"", "\\\"");
-    
-   if (rSourceFiles.size())
+   std::string request =
+         ".rs.runAsyncTask(quote({\n" + std::string(rCommand) + "\n}), " +
+         "c(" + boost::algorithm::join(sources, ", ") + "), " +
+         quotedString(workingDir.empty() ? std::string() :
+                                           workingDir.absolutePath()) + ", " +
+         ((rOptions & R_PROCESS_REDIRECTSTDERR) ? "TRUE" : "FALSE") + ")\n";
+
+   std::size_t lines = std::count(request.begin(), request.end(), '\n');
+   return core::safe_convert::numberToString(lines) + "\n" + request;
+}
+
+} // anonymous namespace
+
+// A helper R process which runs tasks for AsyncRProcess instances started
+// with R_PROCESS_POOLED, one at a time, and stays running between them.
+// Tasks are written to its standard input; the output of a task is followed
+// by a marker line giving the task's exit status (see AsyncWorker.R).
+class AsyncRWorker :
+      boost::noncopyable,
+      public boost::enable_shared_from_this<AsyncRWorker>
+{
+public:
+   AsyncRWorker()
+      : marker_("#rs-async-task-" + core::system::generateShortenedUuid()),
+        libPaths_(module_context::libPathsString()),
+        tasks_(0),
+        retired_(false),
+        exited_(false)
+   {
+   }
+
+   core::Error start()
    {
-      // add in the r source files requested
-      for (std::vector<core::FilePath>::const_iterator it = rSourceFiles.begin();
-           it != rSourceFiles.end();
-           ++it)
+      core::FilePath rProgramPath;
+      core::Error error = module_context::rScriptPath(&rProgramPath);
+      if (error)
+         return error;
+
+      std::vector<core::FilePath> rSourceFiles;
+      rSourceFiles.push_back(toolsPath());
+      rSourceFiles.push_back(
+               session::options().coreRSourcePath().childPath("AsyncWorker.R"));
+
+      std::string command =
+            ".rs.runAsyncWorker(" + quotedString(marker_) + ", " +
+            quotedString(toolsPath().absolutePath()) + ")";
+
+      std::vector<std::string> args = rArguments(R_PROCESS_VANILLA);
+      args.push_back("-e");
+      args.push_back(commandArgument(sourceCommand(rSourceFiles), command));
+
+      core::system::ProcessOptions options;
+      options.terminateChildren = true;
+      options.environment = childEnvironment(core::system::Options());
+
+      core::system::ProcessCallbacks cb;
+      cb.onContinue = boost::bind(&AsyncRWorker::onContinue,
+                                  shared_from_this(), _1);
+      cb.onStdout = boost::bind(&AsyncRWorker::onStdout,
+                                shared_from_this(), _2);
+      cb.onStderr = boost::bind(&AsyncRWorker::onStderr,
+                                shared_from_this(), _2);
+      cb.onExit = boost::bind(&AsyncRWorker::onExit,
+                              shared_from_this(), _1);
+
+      return module_context::processSupervisor().runProgram(
+               rProgramPath.absolutePath(),
+               args,
+               options,
+               cb);
+   }
+
+   bool available() const
+   {
+      return !pTask_ && !retired_ && !exited_;
+   }
+
+   // processes started with other library paths are no longer used
+   bool stale() const
+   {
+      return libPaths_ != module_context::libPathsString();
+   }
+
+   void run(boost::shared_ptr<AsyncRProcess> pTask, const std::string& request)
+   {
+      pTask_ = pTask;
+      request_ = request;
+   }
+
+   // the process exits once it has finished any task it is running
+   void retire();
+
+private:
+   bool onContinue(core::system::ProcessOperations& operations)
+   {
+      if (!request_.empty())
       {
-         command << "source('" << it->absolutePath() << "');";
+         core::Error error = operations.writeToStdin(request_, false);
+         request_.clear();
+         if (error)
+         {
+            LOG_ERROR(error);
+            return false;
+         }
       }
-      
-      command << escapedCommand;
+
+      // (the task may ask to be terminated, which ends the process)
+      if (pTask_)
+         return pTask_->onContinue();
+
+      return !retired_;
    }
-   else
+
+   void onStdout(const std::string& output)
    {
-      command << escapedCommand;
+      output_.append(output);
+
+      std::string::size_type pos = output_.find("\n" + marker_ + " ");
+      if (pos == std::string::npos)
+      {
+         // hold back a trailing line which could be the start of the marker
+         std::string::size_type lineStart = output_.rfind('\n');
+         if (lineStart == std::string::npos ||
+             output_.size() - lineStart > marker_.size() + 1)
+         {
+            lineStart = output_.size();
+         }
+         deliverOutput(lineStart);
+         return;
+      }
+
+      // wait for the rest of the marker line
+      std::string::size_type end = output_.find('\n', pos + 1);
+      if (end == std::string::npos)
+      {
+         deliverOutput(pos);
+         return;
+      }
+
+      // read the status and memory used from the marker line
+      std::string markerLine = output_.substr(pos + 1, end - pos - 1);
+      deliverOutput(pos);
+      output_.clear();
+
+      std::vector<std::string> fields;
+      boost::algorithm::split(fields, markerLine, boost::is_any_of(" "));
+      int exitStatus = EXIT_FAILURE;
+      double memoryMb = 0;
+      if (fields.size() == 3)
+      {
+         exitStatus = core::safe_convert::stringTo<int>(fields[1], EXIT_FAILURE);
+         memoryMb = core::safe_convert::stringTo<double>(fields[2], 0);
+      }
+
+      if (++tasks_ >= kMaxWorkerTasks || memoryMb > kMaxWorkerMemoryMb)
+         retire();
+
+      completeTask(exitStatus);
    }
 
-   if (needsQuote)
-      command << "\"";
+   void onStderr(const std::string& output)
+   {
+      if (pTask_)
+         pTask_->onStderr(output);
+   }
+
+   void onExit(int exitStatus);
+
+   void deliverOutput(std::string::size_type length)
+   {
+      if (length == 0)
+         return;
+
+      std::string output = output_.substr(0, length);
+      output_.erase(0, length);
+      if (pTask_)
+         pTask_->onStdout(output);
+   }
+
+   void completeTask(int exitStatus)
+   {
+      // (the task may start another as it completes, which could be run
+      // by this process)
+      boost::shared_ptr<AsyncRProcess> pTask = pTask_;
+      pTask_.reset();
+      if (pTask)
+         pTask->onProcessCompleted(exitStatus);
+   }
+
+private:
+   std::string marker_;
+   std::string libPaths_;
+   int tasks_;
+   bool retired_;
+   bool exited_;
+   boost::shared_ptr<AsyncRProcess> pTask_;
+   std::string request_;
+   std::string output_;
+};
+
+namespace {
+
+std::vector<boost::shared_ptr<AsyncRWorker> > s_workers;
+
+void retireWorkers()
+{
+   std::vector<boost::shared_ptr<AsyncRWorker> > workers = s_workers;
+   BOOST_FOREACH(boost::shared_ptr<AsyncRWorker> pWorker, workers)
+   {
+      pWorker->retire();
+   }
+}
+
+// run the task in a pooled process; returns false if no process is free
+// (in which case the task should be run in a process of its own)
+bool runPooled(boost::shared_ptr<AsyncRProcess> pTask,
+               const std::string& request)
+{
+   // packages loaded by earlier tasks may since have been updated
+   static bool s_connected = false;
+   if (!s_connected)
+   {
+      module_context::events().onPackageLibraryMutated.connect(retireWorkers);
+      module_context::events().onLowMemory.connect(retireWorkers);
+      s_connected = true;
+   }
 
-   args.push_back(command.str());
+   // processes which are no longer used make way for new ones
+   std::vector<boost::shared_ptr<AsyncRWorker> > workers = s_workers;
+   BOOST_FOREACH(boost::shared_ptr<AsyncRWorker> pCandidate, workers)
+   {
+      if (pCandidate->stale())
+         pCandidate->retire();
+   }
+
+   boost::shared_ptr<AsyncRWorker> pWorker;
+   BOOST_FOREACH(boost::shared_ptr<AsyncRWorker> pCandidate, s_workers)
+   {
+      if (pCandidate->available())
+      {
+         pWorker = pCandidate;
+         break;
+      }
+   }
+
+   if (!pWorker)
+   {
+      if (s_workers.size() >= kMaxWorkers)
+         return false;
+
+      pWorker.reset(new AsyncRWorker());
+      core::Error error = pWorker->start();
+      if (error)
+      {
+         LOG_ERROR(error);
+         return false;
+      }
+      s_workers.push_back(pWorker);
+   }
+
+   pWorker->run(pTask, request);
+   return true;
+}
+
+} // anonymous namespace
+
+void AsyncRWorker::retire()
+{
+   retired_ = true;
+   core::algorithm::expel(s_workers, shared_from_this());
+}
+
+void AsyncRWorker::onExit(int exitStatus)
+{
+   exited_ = true;
+   core::algorithm::expel(s_workers, shared_from_this());
+
+   // a task which ends the process (by calling quit) completes with the
+   // process's exit status
+   output_.clear();
+   completeTask(exitStatus);
+}
+
+AsyncRProcess::AsyncRProcess():
+   isRunning_(false),
+   terminationRequested_(false),
+   hasPendingInput_(false)
+{
+}
+
+void AsyncRProcess::start(const char* rCommand,
+                          core::system::Options environment,
+                          const core::FilePath& workingDir,
+                          AsyncRProcessOptions rOptions,
+                          std::vector<core::FilePath> rSourceFiles,
+                          const std::string& input)
+{
+   // R binary
+   core::FilePath rProgramPath;
+   core::Error error = module_context::rScriptPath(&rProgramPath);
+   if (error)
+   {
+      LOG_ERROR(error);
+      onCompleted(EXIT_FAILURE);
+      return;
+   }
+   
+   // core R files for augmented async processes
+   if (rOptions & R_PROCESS_AUGMENTED)
+   {
+      // insert at begin as Tools.R needs to be sourced first
+      rSourceFiles.insert(rSourceFiles.begin(), toolsPath());
+   }
+
+   // run in a pooled process if requested (and one is free)
+   if ((rOptions & R_PROCESS_POOLED) &&
+       (rOptions & R_PROCESS_VANILLA) &&
+       environment.empty() &&
+       input.empty())
+   {
+      std::string request = taskRequest(rCommand, workingDir, rOptions,
+                                        rSourceFiles);
+      if (runPooled(shared_from_this(), request))
+      {
+         isRunning_ = true;
+         return;
+      }
+   }
+
+   // args
+   std::vector<std::string> args = rArguments(rOptions);
+   args.push_back("-e");
+   args.push_back(commandArgument(sourceCommand(rSourceFiles), rCommand));
 
    // options
    core::system::ProcessOptions options;
@@ -143,26 +489,13 @@ void AsyncRProcess::start(const char* rCommand,
       options.workingDir = workingDir;
    }
 
-   // forward R_LIBS so the child process has access to the same libraries
-   // we do
-   core::system::Options childEnv;
-   core::system::environment(&childEnv);
-   std::string libPaths = module_context::libPathsString();
-   if (!libPaths.empty())
-   {
-      core::system::setenv(&childEnv, "R_LIBS", libPaths);
-   }
-   // forward passed environment variables
-   BOOST_FOREACH(const core::system::Option& var, environment)
-   {
-      core::system::setenv(&childEnv, var.first, var.second);
-   }
-   options.environment = childEnv;
+   options.environment = childEnvironment(environment);
 
    core::system::ProcessCallbacks cb;
    using namespace module_context;
-   cb.onContinue = boost::bind(&AsyncRProcess::onContinue,
-                               AsyncRProcess::shared_from_this());
+   cb.onContinue = boost::bind(&AsyncRProcess::onProcessContinue,
+                               AsyncRProcess::shared_from_this(),
+                               _1);
    cb.onStdout = boost::bind(&AsyncRProcess::onStdout,
                              AsyncRProcess::shared_from_this(),
                              _2);
@@ -225,6 +558,29 @@ bool AsyncRProcess::onContinue()
    return !terminationRequested_;
 }
 
+bool AsyncRProcess::onProcessContinue(core::system::ProcessOperations& operations)
+{
+   if (hasPendingInput_)
+   {
+      hasPendingInput_ = false;
+      core::Error error = operations.writeToStdin(pendingInput_, true);
+      pendingInput_.clear();
+      if (error)
+      {
+         LOG_ERROR(error);
+         return false;
+      }
+   }
+
+   return onContinue();
+}
+
+void AsyncRProcess::writeInput(const std::string& input)
+{
+   pendingInput_ = input;
+   hasPendingInput_ = true;
+}
+
 bool AsyncRProcess::terminationRequested()
 {
    return terminationRequested_;
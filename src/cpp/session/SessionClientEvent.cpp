@@ -192,6 +192,8 @@ const int kDataOutputCompleted = 173;
 const int kNewDocumentWithCode = 174;
 const int kPlumberViewer = 175;
 const int kAvailablePackagesReady = 176;
+const int kConsoleWriteInputBatch = 177;
+const int kConsoleOutputSuppressed = 178;
 }
 
 void ClientEvent::init(int type, const json::Value& data)
@@ -531,6 +533,10 @@ std::string ClientEvent::typeName() const
          return "available_packages_ready";
       case client_events::kPlumberViewer:
          return "plumber_viewer";
+      case client_events::kConsoleWriteInputBatch:
+         return "console_write_input_batch";
+      case client_events::kConsoleOutputSuppressed:
+         return "console_output_suppressed";
       default:
          LOG_WARNING_MESSAGE("unexpected event type: " + 
                              safe_convert::numberToString(type_));
@@ -17,12 +17,15 @@
 
 #include "modules/SessionConsole.hpp"
 
+#include <algorithm>
+
 #include <boost/foreach.hpp>
 
 
 #include <core/BoostThread.hpp>
 #include <core/Thread.hpp>
 #include <core/json/Json.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/StringUtils.hpp>
 
 #include <r/session/RConsoleActions.hpp>
@@ -34,8 +37,288 @@ namespace session {
  
 namespace {
 ClientEventQueue* s_pClientEventQueue = NULL;
+
+// once this many events (or bytes of console output) are pending the batch
+// is sent immediately rather than waiting for more events to arrive
+const std::size_t kMaxBatchEvents = 500;
+const std::size_t kMaxBatchConsoleOutput = 64 * 1024;
+
+// by default, once more than this much console output has been sent in a
+// second only the tail of further output is sent (the rest is suppressed)
+// until the rate drops again. this keeps runaway output from flooding the
+// client (see setConsoleOutputRateLimit)
+const std::size_t kMaxConsoleOutputRate = 256 * 1024;
+const std::size_t kThrottledConsoleOutput = 4 * 1024;
+
+// the most suppressed output we keep around for retrieval
+const std::size_t kMaxSuppressedConsoleOutput = 8 * 1024 * 1024;
+
+// High frequency events are coalesced with events of the same type that
+// are still pending in the queue:
+//
+//   - LatestWins: the event describes the current state of something
+//     (identified by its key) so any pending event with the same key is
+//     superseded (the new event is added at the end of the queue)
+//   - Append: the event carries incremental output which is appended to
+//     the immediately preceding event if it has the same key
+//   - Merge: the event carries the changed fields of something; they are
+//     merged into any pending event with the same key (which is moved to
+//     the end of the queue)
+//
+enum CoalescePolicy
+{
+   CoalesceNone,
+   CoalesceLatestWins,
+   CoalesceAppend,
+   CoalesceMerge
+};
+
+typedef std::string (*CoalesceKeyFunction)(const json::Value&);
+
+// render a json value as a key component
+std::string keyComponent(const json::Value& value)
+{
+   if (value.type() == json::StringType)
+      return value.get_str();
+   else
+      return json::write(value);
+}
+
+std::string memberKey(const json::Value& value, const std::string& name)
+{
+   if (!json::isType<json::Object>(value))
+      return std::string();
+
+   const json::Object& object = value.get_obj();
+   json::Object::const_iterator it = object.find(name);
+   if (it == object.end())
+      return std::string();
+
+   return keyComponent(it->second);
+}
+
+std::string noKey(const json::Value&)
+{
+   return std::string();
+}
+
+// environment assigned (object with name) or removed (name)
+std::string environmentVariableKey(const json::Value& data)
+{
+   if (data.type() == json::StringType)
+      return data.get_str();
+   else
+      return memberKey(data, "name");
+}
+
+// change type and path of the file
+std::string fileChangedKey(const json::Value& data)
+{
+   std::string path;
+   if (json::isType<json::Object>(data))
+   {
+      json::Object::const_iterator it = data.get_obj().find("file");
+      if (it != data.get_obj().end())
+         path = memberKey(it->second, "path");
+   }
+
+   // don't coalesce if we can't identify the file
+   if (path.empty())
+      return std::string();
+
+   return memberKey(data, "type") + ":" + path;
 }
 
+// update type and job id
+std::string jobUpdatedKey(const json::Value& data)
+{
+   std::string id;
+   if (json::isType<json::Object>(data))
+   {
+      json::Object::const_iterator it = data.get_obj().find("job");
+      if (it != data.get_obj().end())
+         id = memberKey(it->second, "id");
+   }
+
+   if (id.empty())
+      return std::string();
+
+   return memberKey(data, "type") + ":" + id;
+}
+
+// job output is [id, type, output]
+std::string jobOutputKey(const json::Value& data)
+{
+   if (!json::isType<json::Array>(data) || data.get_array().size() != 3)
+      return std::string();
+
+   const json::Array& output = data.get_array();
+   return keyComponent(output[0]) + ":" + keyComponent(output[1]);
+}
+
+// build output is { type, output }
+std::string buildOutputKey(const json::Value& data)
+{
+   return memberKey(data, "type");
+}
+
+struct CoalesceRule
+{
+   CoalesceRule(CoalescePolicy policy = CoalesceNone,
+                CoalesceKeyFunction keyFunction = noKey,
+                int group = -1)
+      : policy(policy), keyFunction(keyFunction), group(group)
+   {
+   }
+
+   CoalescePolicy policy;
+   CoalesceKeyFunction keyFunction;
+
+   // events in the same group supersede each other (e.g. the removal of a
+   // variable supersedes its assignment); defaults to the event type
+   int group;
+};
+
+CoalesceRule coalesceRule(int type)
+{
+   using namespace client_events;
+
+   if (type == kEnvironmentAssigned || type == kEnvironmentRemoved)
+      return CoalesceRule(CoalesceLatestWins,
+                          environmentVariableKey,
+                          kEnvironmentAssigned);
+   else if (type == kEnvironmentRefresh)
+      return CoalesceRule(CoalesceLatestWins);
+   else if (type == kFileChanged)
+      return CoalesceRule(CoalesceLatestWins, fileChangedKey);
+   else if (type == kPlotsStateChanged)
+      return CoalesceRule(CoalesceLatestWins);
+   else if (type == kJobUpdated)
+      return CoalesceRule(CoalesceMerge, jobUpdatedKey);
+   else if (type == kJobOutput)
+      return CoalesceRule(CoalesceAppend, jobOutputKey);
+   else if (type == kBuildOutput)
+      return CoalesceRule(CoalesceAppend, buildOutputKey);
+   else
+      return CoalesceRule();
+}
+
+int coalesceGroup(const CoalesceRule& rule, int type)
+{
+   return rule.group != -1 ? rule.group : type;
+}
+
+// append the output of the next event to the previous one; returns false
+// if the events don't have the expected form
+bool appendOutput(const ClientEvent& previous,
+                  const ClientEvent& next,
+                  ClientEvent* pMerged)
+{
+   json::Value data = previous.data();
+   const json::Value& nextData = next.data();
+
+   if (json::isType<json::Array>(data) && json::isType<json::Array>(nextData))
+   {
+      json::Array& output = data.get_array();
+      const json::Array& nextOutput = nextData.get_array();
+      if (output.size() != 3 || nextOutput.size() != 3 ||
+          output[2].type() != json::StringType ||
+          nextOutput[2].type() != json::StringType)
+         return false;
+
+      output[2] = output[2].get_str() + nextOutput[2].get_str();
+   }
+   else if (json::isType<json::Object>(data) &&
+            json::isType<json::Object>(nextData))
+   {
+      json::Object& output = data.get_obj();
+      const json::Object& nextOutput = nextData.get_obj();
+      json::Object::iterator it = output.find("output");
+      json::Object::const_iterator nextIt = nextOutput.find("output");
+      if (it == output.end() || nextIt == nextOutput.end() ||
+          it->second.type() != json::StringType ||
+          nextIt->second.type() != json::StringType)
+         return false;
+
+      it->second = it->second.get_str() + nextIt->second.get_str();
+   }
+   else
+   {
+      return false;
+   }
+
+   *pMerged = ClientEvent(previous.type(), data);
+   return true;
+}
+
+// merge the fields of the job in the next (job updated) event into those
+// of the previous one; returns false if the events don't have the expected
+// form
+bool mergeUpdate(const ClientEvent& previous,
+                 const ClientEvent& next,
+                 ClientEvent* pMerged)
+{
+   json::Value data = previous.data();
+   const json::Value& nextData = next.data();
+   if (!json::isType<json::Object>(data) ||
+       !json::isType<json::Object>(nextData))
+      return false;
+
+   json::Object::iterator it = data.get_obj().find("job");
+   json::Object::const_iterator nextIt = nextData.get_obj().find("job");
+   if (it == data.get_obj().end() || nextIt == nextData.get_obj().end() ||
+       !json::isType<json::Object>(it->second) ||
+       !json::isType<json::Object>(nextIt->second))
+      return false;
+
+   json::Object& fields = it->second.get_obj();
+   const json::Object& nextFields = nextIt->second.get_obj();
+   for (json::Object::const_iterator field = nextFields.begin();
+        field != nextFields.end();
+        ++field)
+   {
+      fields[field->first] = field->second;
+   }
+
+   *pMerged = ClientEvent(previous.type(), data);
+   return true;
+}
+
+// offset at which the tail of the output that is to be kept starts: no
+// more than maxLines lines and (where possible) no more than maxBytes
+std::size_t consoleOutputTailStart(const std::string& output,
+                                   std::size_t maxLines,
+                                   std::size_t maxBytes)
+{
+   std::size_t start = 0;
+   if (output.size() > maxBytes)
+   {
+      // start at a line boundary if there is one
+      start = output.size() - maxBytes;
+      std::size_t newline = output.find('\n', start - 1);
+      if (newline != std::string::npos && newline + 1 < output.size())
+         start = newline + 1;
+   }
+
+   std::size_t lines = 0;
+   for (std::size_t i = output.size(); i > start; i--)
+   {
+      if (output[i - 1] == '\n' && i != output.size() && ++lines >= maxLines)
+         return i;
+   }
+
+   return start;
+}
+
+boost::int64_t microsecondsSinceEpoch(const boost::posix_time::ptime& time)
+{
+   using namespace boost::posix_time;
+   static const ptime epoch(boost::gregorian::date(1970, 1, 1));
+   return (time - epoch).total_microseconds();
+}
+
+} // anonymous namespace
+
 void initializeClientEventQueue()
 {
    BOOST_ASSERT(s_pClientEventQueue == NULL);
@@ -50,7 +333,10 @@ ClientEventQueue& clientEventQueue()
 ClientEventQueue::ClientEventQueue()
    :  pMutex_(new boost::mutex()),
       pWaitForEventCondition_(new boost::condition()),
-      lastEventAddTime_(boost::posix_time::not_a_date_time)
+      incomingEvents_(NULL),
+      consoleOutputRateLimit_(kMaxConsoleOutputRate),
+      consoleOutputWindowBytes_(0),
+      lastEventAddTime_(0)
 {
 }
 
@@ -59,9 +345,13 @@ bool ClientEventQueue::setActiveConsole(const std::string& console)
    bool changed = false;
    LOCK_MUTEX(*pMutex_)
    {
+      // events added before the switch belong to the previous console
+      drainIncomingEvents();
+
       if (activeConsole_ != console)
       {
          // flush events to the previous console
+         flushPendingConsoleEcho();
          flushPendingConsoleOutput();
          
          // switch to the new one
@@ -75,33 +365,20 @@ bool ClientEventQueue::setActiveConsole(const std::string& console)
 
 void ClientEventQueue::add(const ClientEvent& event)
 { 
-   LOCK_MUTEX(*pMutex_)
+   // push onto the incoming list; this never blocks, so producers (R's
+   // console output, background threads) don't contend with each other or
+   // with the thread sending events to the client
+   IncomingEvent* pIncoming = new IncomingEvent(event);
+   pIncoming->pNext = incomingEvents_.load(std::memory_order_relaxed);
+   while (!incomingEvents_.compare_exchange_weak(pIncoming->pNext,
+                                                 pIncoming,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed))
    {
-      // console output is batched up for compactness/efficiency.
-      if (event.type() == client_events::kConsoleWriteOutput)
-      {
-         if (event.data().type() == json::StringType)
-            pendingConsoleOutput_ += event.data().get_str();
-      }
-      else if (event.type() == client_events::kConsoleWriteError &&
-               event.data().type() == json::StringType)
-      {
-         flushPendingConsoleOutput();
-         enqueueClientOutputEvent(event.type(), event.data().get_str());
-      }
-      else
-      {
-         // flush existing console output prior to adding an 
-         // action of another type
-         flushPendingConsoleOutput() ;
-         
-         // add event to queue
-         pendingEvents_.push_back(event) ;
-      }
-      
-      lastEventAddTime_ = boost::posix_time::microsec_clock::universal_time();
    }
-   END_LOCK_MUTEX
+
+   lastEventAddTime_.store(microsecondsSinceEpoch(
+                     boost::posix_time::microsec_clock::universal_time()));
    
    // notify listeners that an event has been added
    pWaitForEventCondition_->notify_all();
@@ -111,7 +388,10 @@ bool ClientEventQueue::hasEvents()
 {
    LOCK_MUTEX(*pMutex_)
    {
-      return pendingEvents_.size() > 0 || pendingConsoleOutput_.length() > 0;
+      drainIncomingEvents();
+      return pendingEvents_.size() > 0 ||
+             pendingConsoleOutput_.length() > 0 ||
+             pendingConsoleEcho_.size() > 0;
    }
    END_LOCK_MUTEX
    
@@ -119,11 +399,27 @@ bool ClientEventQueue::hasEvents()
    return false ;
 }
   
+bool ClientEventQueue::batchFull()
+{
+   LOCK_MUTEX(*pMutex_)
+   {
+      drainIncomingEvents();
+      return pendingEvents_.size() >= kMaxBatchEvents ||
+             pendingConsoleOutput_.length() >= kMaxBatchConsoleOutput;
+   }
+   END_LOCK_MUTEX
+
+   // keep compiler happy
+   return false;
+}
+
 void ClientEventQueue::remove(std::vector<ClientEvent>* pEvents)
 {
    LOCK_MUTEX(*pMutex_)
    {
-      // flush any pending output
+      // take everything added so far then flush any pending output
+      drainIncomingEvents();
+      flushPendingConsoleEcho();
       flushPendingConsoleOutput();
       
       // copy the events to the caller
@@ -141,8 +437,11 @@ void ClientEventQueue::clear()
 {
    LOCK_MUTEX(*pMutex_)
    {
+      drainIncomingEvents();
       pendingConsoleOutput_.clear();
+      pendingConsoleEcho_.clear();
       pendingEvents_.clear();
+      suppressedConsoleOutput_.clear();
    }
    END_LOCK_MUTEX
 }
@@ -168,21 +467,110 @@ bool ClientEventQueue::waitForEvent(
 }
    
 
-bool ClientEventQueue::eventAddedSince(const boost::posix_time::ptime& time)
+void ClientEventQueue::setConsoleOutputRateLimit(std::size_t bytesPerSecond)
 {
    LOCK_MUTEX(*pMutex_)
    {
-      if (lastEventAddTime_.is_not_a_date_time())
-         return false;
-      else
-         return lastEventAddTime_ >= time;
+      consoleOutputRateLimit_ = bytesPerSecond;
    }
    END_LOCK_MUTEX
-   
+}
+
+std::string ClientEventQueue::suppressedConsoleOutput()
+{
+   LOCK_MUTEX(*pMutex_)
+   {
+      return suppressedConsoleOutput_;
+   }
+   END_LOCK_MUTEX
+
    // keep compiler happy
-   return false;
+   return std::string();
+}
+
+bool ClientEventQueue::eventAddedSince(const boost::posix_time::ptime& time)
+{
+   boost::int64_t lastEventAddTime = lastEventAddTime_.load();
+   if (lastEventAddTime == 0)
+      return false;
+   else
+      return lastEventAddTime >= microsecondsSinceEpoch(time);
 }
    
+void ClientEventQueue::drainIncomingEvents()
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+
+   // take the whole list at once (producers then start a new one)
+   IncomingEvent* pIncoming = incomingEvents_.exchange(
+                                          NULL, std::memory_order_acquire);
+   if (pIncoming == NULL)
+      return;
+
+   // reverse into the order the events were added
+   IncomingEvent* pOrdered = NULL;
+   while (pIncoming != NULL)
+   {
+      IncomingEvent* pNext = pIncoming->pNext;
+      pIncoming->pNext = pOrdered;
+      pOrdered = pIncoming;
+      pIncoming = pNext;
+   }
+
+   while (pOrdered != NULL)
+   {
+      IncomingEvent* pNext = pOrdered->pNext;
+      try
+      {
+         addPendingEvent(pOrdered->event);
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+      delete pOrdered;
+      pOrdered = pNext;
+   }
+}
+
+void ClientEventQueue::addPendingEvent(const ClientEvent& event)
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+
+   // console echo (the prompt and input of each line R reads) is batched
+   // up as well, as pasted or multi-line input can make for thousands of
+   // lines of it with no output between them
+   if (event.type() == client_events::kConsoleWritePrompt ||
+       event.type() == client_events::kConsoleWriteInput)
+   {
+      flushPendingConsoleOutput();
+      pendingConsoleEcho_.push_back(event);
+      return;
+   }
+
+   // anything else follows the echo
+   flushPendingConsoleEcho();
+
+   // console output is batched up for compactness/efficiency.
+   if (event.type() == client_events::kConsoleWriteOutput)
+   {
+      if (event.data().type() == json::StringType)
+         pendingConsoleOutput_ += event.data().get_str();
+   }
+   else if (event.type() == client_events::kConsoleWriteError &&
+            event.data().type() == json::StringType)
+   {
+      flushPendingConsoleOutput();
+      enqueueClientOutputEvent(event.type(), event.data().get_str());
+   }
+   else
+   {
+      // flush existing console output prior to adding an 
+      // action of another type
+      flushPendingConsoleOutput() ;
+      
+      // add event to queue (coalescing it with pending events if
+      // possible)
+      enqueueCoalescedEvent(event);
+   }
+}
 
 void ClientEventQueue::flushPendingConsoleOutput()
 {
@@ -190,18 +578,192 @@ void ClientEventQueue::flushPendingConsoleOutput()
    
    if ( !pendingConsoleOutput_.empty() )
    {
+      // progress bars and the like rewrite the current line over and over;
+      // only the final state of the line needs to be sent
+      string_utils::collapseCarriageReturns(&pendingConsoleOutput_);
+
+      // track how much output has been sent recently
+      using namespace boost::posix_time;
+      ptime now = microsec_clock::universal_time();
+      if (consoleOutputWindowStart_.is_not_a_date_time() ||
+          now - consoleOutputWindowStart_ >= seconds(1))
+      {
+         consoleOutputWindowStart_ = now;
+         consoleOutputWindowBytes_ = 0;
+      }
+      consoleOutputWindowBytes_ += pendingConsoleOutput_.size();
+
       // If there's more console output than the client can even show, then
-      // truncate it to the amount that the client can show. Too much output
-      // can overwhelm the client, causing it to become unresponsive.
-      int limit = r::session::consoleActions().capacity() + 1;
-      string_utils::trimLeadingLines(limit, &pendingConsoleOutput_);
+      // send only as much as the client can show. Too much output can
+      // overwhelm the client, causing it to become unresponsive. The same
+      // goes for output arriving faster than the client can render it.
+      std::size_t maxBytes = pendingConsoleOutput_.size();
+      if (consoleOutputRateLimit_ > 0 &&
+          consoleOutputWindowBytes_ > consoleOutputRateLimit_)
+      {
+         maxBytes = kThrottledConsoleOutput;
+      }
+      std::size_t limit = r::session::consoleActions().capacity() + 1;
+      std::size_t tailStart = consoleOutputTailStart(pendingConsoleOutput_,
+                                                     limit,
+                                                     maxBytes);
+      std::size_t suppressedLines = 0;
+      if (tailStart > 0)
+         suppressedLines = suppressConsoleOutput(tailStart);
 
       enqueueClientOutputEvent(client_events::kConsoleWriteOutput, 
             pendingConsoleOutput_);
+
+      // let the client offer the suppressed output (get_suppressed_console_output)
+      if (suppressedLines > 0)
+      {
+         json::Object suppressed;
+         suppressed["lines"] = static_cast<int>(suppressedLines);
+         suppressed[kConsoleId] = activeConsole_;
+         pendingEvents_.push_back(
+               ClientEvent(client_events::kConsoleOutputSuppressed, suppressed));
+      }
       pendingConsoleOutput_.clear() ;
    }
 }
 
+void ClientEventQueue::flushPendingConsoleEcho()
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+
+   // a lone prompt and input (as for a command typed at the console) are
+   // sent as they are; a longer run is sent as a single batch event which
+   // the client dispatches in turn
+   if (pendingConsoleEcho_.size() <= 2)
+   {
+      pendingEvents_.insert(pendingEvents_.end(),
+                            pendingConsoleEcho_.begin(),
+                            pendingConsoleEcho_.end());
+   }
+   else
+   {
+      json::Array batch;
+      BOOST_FOREACH(const ClientEvent& echo, pendingConsoleEcho_)
+      {
+         json::Object echoJson;
+         echoJson["type"] = echo.typeName();
+         echoJson["data"] = echo.data();
+         batch.push_back(echoJson);
+      }
+      pendingEvents_.push_back(
+               ClientEvent(client_events::kConsoleWriteInputBatch, batch));
+   }
+
+   pendingConsoleEcho_.clear();
+}
+
+std::size_t ClientEventQueue::suppressConsoleOutput(std::size_t length)
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+
+   std::size_t lines = std::count(pendingConsoleOutput_.begin(),
+                                  pendingConsoleOutput_.begin() + length,
+                                  '\n');
+   if (lines == 0)
+      lines = 1;
+
+   // keep what's suppressed (up to a point) so it can be retrieved
+   suppressedConsoleOutput_.append(pendingConsoleOutput_, 0, length);
+   if (suppressedConsoleOutput_.size() > kMaxSuppressedConsoleOutput)
+   {
+      suppressedConsoleOutput_.erase(
+            0, suppressedConsoleOutput_.size() - kMaxSuppressedConsoleOutput);
+   }
+
+   pendingConsoleOutput_.replace(
+         0,
+         length,
+         "[ " + safe_convert::numberToString(lines) + " lines suppressed ]\n");
+
+   return lines;
+}
+
+void ClientEventQueue::enqueueCoalescedEvent(const ClientEvent& event)
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+
+   CoalesceRule rule = coalesceRule(event.type());
+   if (rule.policy == CoalesceNone)
+   {
+      pendingEvents_.push_back(event);
+      return;
+   }
+
+   // events without a key (when the rule requires one) aren't coalesced
+   std::string key = rule.keyFunction(event.data());
+   if (key.empty() && rule.keyFunction != noKey)
+   {
+      pendingEvents_.push_back(event);
+      return;
+   }
+
+   if (rule.policy == CoalesceAppend)
+   {
+      // only append to the immediately preceding event so that ordering
+      // with respect to other events is preserved
+      if (!pendingEvents_.empty())
+      {
+         ClientEvent& previous = pendingEvents_.back();
+         if (previous.type() == event.type() &&
+             rule.keyFunction(previous.data()) == key)
+         {
+            ClientEvent merged = previous;
+            if (appendOutput(previous, event, &merged))
+            {
+               previous = merged;
+               return;
+            }
+         }
+      }
+   }
+   else if (rule.policy == CoalesceLatestWins)
+   {
+      // there is at most one pending event for a given key so remove the
+      // most recent one (if any)
+      int group = coalesceGroup(rule, event.type());
+      for (std::vector<ClientEvent>::iterator it = pendingEvents_.end();
+           it != pendingEvents_.begin(); )
+      {
+         --it;
+         CoalesceRule pendingRule = coalesceRule(it->type());
+         if (pendingRule.policy == CoalesceLatestWins &&
+             coalesceGroup(pendingRule, it->type()) == group &&
+             pendingRule.keyFunction(it->data()) == key)
+         {
+            pendingEvents_.erase(it);
+            break;
+         }
+      }
+   }
+   else if (rule.policy == CoalesceMerge)
+   {
+      // there is at most one pending event for a given key; fold it into
+      // this one and move it to the end of the queue
+      for (std::vector<ClientEvent>::iterator it = pendingEvents_.end();
+           it != pendingEvents_.begin(); )
+      {
+         --it;
+         if (it->type() == event.type() && rule.keyFunction(it->data()) == key)
+         {
+            ClientEvent merged = *it;
+            if (!mergeUpdate(*it, event, &merged))
+               break;
+
+            pendingEvents_.erase(it);
+            pendingEvents_.push_back(merged);
+            return;
+         }
+      }
+   }
+
+   pendingEvents_.push_back(event);
+}
+
 void ClientEventQueue::enqueueClientOutputEvent(
       int event, const std::string& text)
 {
@@ -16,9 +16,11 @@
 #ifndef SESSION_SESSION_CLIENT_EVENT_QUEUE_HPP
 #define SESSION_SESSION_CLIENT_EVENT_QUEUE_HPP
 
+#include <atomic>
 #include <string>
 #include <vector>
 
+#include <boost/cstdint.hpp>
 #include <boost/function.hpp>
 #include <boost/utility.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -54,6 +56,10 @@ public:
    
    // are there any events pending?
    bool hasEvents();
+
+   // have enough events accumulated that they should be sent without
+   // waiting for the batching window to elapse?
+   bool batchFull();
    
    // clear the event queue
    void clear();
@@ -67,11 +73,45 @@ public:
    // set the active console to be attached to console events; returns true if
    // the active console changed
    bool setActiveConsole(const std::string& console);
+
+   // once more than this many bytes of console output have been sent in a
+   // second, send only the tail of further output (0 for no limit)
+   void setConsoleOutputRateLimit(std::size_t bytesPerSecond);
+
+   // console output which was suppressed rather than sent to the client
+   // (most recent output only, up to a limit)
+   std::string suppressedConsoleOutput();
       
 private:   
+   // events added by producers, most recent first. producers only ever
+   // push onto this list (without locking); whoever next takes the mutex
+   // to read the queue moves them into the pending state, which is where
+   // console output is batched and events are coalesced
+   struct IncomingEvent
+   {
+      explicit IncomingEvent(const ClientEvent& event)
+         : event(event), pNext(NULL)
+      {
+      }
+
+      ClientEvent event;
+      IncomingEvent* pNext;
+   };
+
+   void drainIncomingEvents();
+
+   void addPendingEvent(const ClientEvent& event);
+
    void flushPendingConsoleOutput();
 
+   void flushPendingConsoleEcho();
+
+   // returns the number of lines suppressed
+   std::size_t suppressConsoleOutput(std::size_t length);
+
    void enqueueClientOutputEvent(int event, const std::string& text);
+
+   void enqueueCoalescedEvent(const ClientEvent& event);
  
 private:
    // synchronization objects. heap based so they are never destructed
@@ -83,11 +123,21 @@ private:
    boost::condition* pWaitForEventCondition_ ;
 
    // instance data
+   std::atomic<IncomingEvent*> incomingEvents_;
    std::string pendingConsoleOutput_ ;
+   std::vector<ClientEvent> pendingConsoleEcho_;
    std::string activeConsole_;
    std::vector<ClientEvent> pendingEvents_ ; 
-   boost::posix_time::ptime lastEventAddTime_;
-   
+   std::string suppressedConsoleOutput_;
+
+   // console output sent in the current one second window (and the most
+   // which may be sent before output is throttled)
+   std::size_t consoleOutputRateLimit_;
+   boost::posix_time::ptime consoleOutputWindowStart_;
+   std::size_t consoleOutputWindowBytes_;
+
+   // microseconds since the epoch (0 if no event has been added)
+   std::atomic<boost::int64_t> lastEventAddTime_;
 
 };
 
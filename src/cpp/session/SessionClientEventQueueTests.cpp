@@ -0,0 +1,305 @@
+/*
+ * SessionClientEventQueueTests.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionClientEventQueue.hpp"
+
+#include "modules/SessionConsole.hpp"
+
+#include <atomic>
+#include <iostream>
+
+#include <boost/thread.hpp>
+
+#include <core/json/Json.hpp>
+
+#define RSTUDIO_NO_TESTTHAT_ALIASES
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace session {
+namespace tests {
+
+using namespace rstudio::core;
+
+namespace {
+
+ClientEvent consoleOutput(const std::string& text)
+{
+   return ClientEvent(client_events::kConsoleWriteOutput, text);
+}
+
+ClientEvent environmentAssigned(const std::string& name, int value)
+{
+   json::Object data;
+   data["name"] = name;
+   data["value"] = value;
+   return ClientEvent(client_events::kEnvironmentAssigned, data);
+}
+
+ClientEvent jobUpdated(const std::string& id,
+                       const std::string& field,
+                       int value)
+{
+   json::Object job;
+   job["id"] = id;
+   job[field] = value;
+
+   json::Object data;
+   data["type"] = 1;
+   data["job"] = job;
+   return ClientEvent(client_events::kJobUpdated, data);
+}
+
+std::string consoleText(const ClientEvent& event)
+{
+   return event.data().get_obj().find(kConsoleText)->second.get_str();
+}
+
+// add console output and environment events from several threads while
+// another thread drains the queue; returns the total console text seen
+std::size_t stress(int producers,
+                   int eventsPerProducer,
+                   std::size_t* pOtherEvents)
+{
+   ClientEventQueue& queue = clientEventQueue();
+   queue.clear();
+
+   boost::thread_group threads;
+   for (int i = 0; i < producers; i++)
+   {
+      threads.create_thread([&queue, i, eventsPerProducer]()
+      {
+         for (int j = 0; j < eventsPerProducer; j++)
+         {
+            if (j % 100 == 0)
+               queue.add(ClientEvent(client_events::kBusy, true));
+            else
+               queue.add(consoleOutput("0123456789"));
+         }
+      });
+   }
+
+   std::size_t consoleBytes = 0;
+   std::size_t otherEvents = 0;
+   std::atomic<bool> done(false);
+   boost::thread consumer([&]()
+   {
+      while (true)
+      {
+         bool finished = done.load();
+         std::vector<ClientEvent> events;
+         queue.remove(&events);
+         for (const ClientEvent& event : events)
+         {
+            if (event.type() == client_events::kConsoleWriteOutput)
+               consoleBytes += consoleText(event).size();
+            else
+               otherEvents++;
+         }
+         if (finished)
+            break;
+      }
+   });
+
+   threads.join_all();
+   done.store(true);
+   consumer.join();
+
+   *pOtherEvents = otherEvents;
+   return consoleBytes;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Client event queue")
+{
+   ClientEventQueue& queue = clientEventQueue();
+
+   SECTION("Console output is batched between other events")
+   {
+      queue.clear();
+      queue.add(consoleOutput("a"));
+      queue.add(consoleOutput("b"));
+      queue.add(ClientEvent(client_events::kBusy, true));
+      queue.add(consoleOutput("c"));
+
+      CHECK(queue.hasEvents());
+
+      std::vector<ClientEvent> events;
+      queue.remove(&events);
+      REQUIRE(events.size() == 3);
+      CHECK(consoleText(events[0]) == "ab");
+      CHECK(events[1].type() == client_events::kBusy);
+      CHECK(consoleText(events[2]) == "c");
+      CHECK_FALSE(queue.hasEvents());
+   }
+
+   SECTION("Pending events are coalesced in the order they were added")
+   {
+      queue.clear();
+      queue.add(environmentAssigned("x", 1));
+      queue.add(environmentAssigned("y", 1));
+      queue.add(environmentAssigned("x", 2));
+
+      std::vector<ClientEvent> events;
+      queue.remove(&events);
+      REQUIRE(events.size() == 2);
+      CHECK(events[0].data().get_obj().find("name")->second.get_str() == "y");
+      CHECK(events[1].data().get_obj().find("value")->second.get_int() == 2);
+   }
+
+   SECTION("Job updates are merged")
+   {
+      queue.clear();
+      queue.add(jobUpdated("a", "progress", 1));
+      queue.add(jobUpdated("b", "progress", 1));
+      queue.add(jobUpdated("a", "state", 2));
+      queue.add(jobUpdated("a", "progress", 3));
+
+      std::vector<ClientEvent> events;
+      queue.remove(&events);
+      REQUIRE(events.size() == 2);
+
+      const json::Object& job =
+            events[1].data().get_obj().find("job")->second.get_obj();
+      CHECK(job.find("id")->second.get_str() == "a");
+      CHECK(job.find("state")->second.get_int() == 2);
+      CHECK(job.find("progress")->second.get_int() == 3);
+   }
+
+   SECTION("Adding an event is recorded")
+   {
+      queue.clear();
+      boost::posix_time::ptime before =
+                        boost::posix_time::microsec_clock::universal_time();
+      queue.add(consoleOutput("x"));
+      CHECK(queue.eventAddedSince(before));
+      queue.clear();
+      CHECK_FALSE(queue.hasEvents());
+   }
+
+   SECTION("Progress output is collapsed")
+   {
+      queue.clear();
+      queue.add(consoleOutput("x\n 10%\r"));
+      queue.add(consoleOutput(" 50%\r"));
+      queue.add(consoleOutput("100%\n"));
+
+      std::vector<ClientEvent> events;
+      queue.remove(&events);
+      REQUIRE(events.size() == 1);
+      CHECK(consoleText(events[0]) == "x\n100%\n");
+   }
+
+   SECTION("Runaway output is throttled")
+   {
+      queue.clear();
+
+      std::string line(99, 'x');
+      line += "\n";
+      std::string sent;
+      std::size_t total = 0;
+      int suppressedEvents = 0;
+      for (int i = 0; i < 50; i++)
+      {
+         for (int j = 0; j < 500; j++)
+         {
+            queue.add(consoleOutput(line));
+            total += line.size();
+         }
+
+         std::vector<ClientEvent> events;
+         queue.remove(&events);
+         REQUIRE(!events.empty());
+         REQUIRE(events[0].type() == client_events::kConsoleWriteOutput);
+         sent += consoleText(events[0]);
+         if (events.size() > 1)
+         {
+            REQUIRE(events.size() == 2);
+            CHECK(events[1].type() == client_events::kConsoleOutputSuppressed);
+            suppressedEvents++;
+         }
+      }
+
+      // only a fraction was sent, with the rest noted and kept (and the
+      // client told it can be retrieved)
+      CHECK(sent.size() < total / 2);
+      CHECK(sent.find(" lines suppressed ]\n") != std::string::npos);
+      CHECK(sent.substr(sent.size() - line.size()) == line);
+      CHECK(suppressedEvents > 0);
+
+      std::string suppressed = queue.suppressedConsoleOutput();
+      CHECK(suppressed.size() > total / 2);
+      CHECK(suppressed.substr(0, line.size()) == line);
+
+      queue.clear();
+      CHECK(queue.suppressedConsoleOutput().empty());
+   }
+
+   SECTION("Output throttling can be turned off")
+   {
+      queue.clear();
+      queue.setConsoleOutputRateLimit(0);
+
+      std::string line(99, 'x');
+      line += "\n";
+      std::size_t sent = 0;
+      for (int i = 0; i < 50; i++)
+      {
+         for (int j = 0; j < 500; j++)
+            queue.add(consoleOutput(line));
+
+         std::vector<ClientEvent> events;
+         queue.remove(&events);
+         REQUIRE(events.size() == 1);
+         sent += consoleText(events[0]).size();
+      }
+
+      CHECK(sent == 50 * 500 * line.size());
+      CHECK(queue.suppressedConsoleOutput().empty());
+
+      queue.setConsoleOutputRateLimit(256 * 1024);
+   }
+
+   SECTION("No events are lost with concurrent producers")
+   {
+      std::size_t otherEvents = 0;
+      std::size_t consoleBytes = stress(4, 2000, &otherEvents);
+      CHECK(otherEvents == 4 * 20);
+      CHECK(consoleBytes == 4 * 1980 * 10);
+   }
+}
+
+TEST_CASE("Client event queue benchmark", "[.][benchmark]")
+{
+   for (int producers = 1; producers <= 8; producers *= 2)
+   {
+      boost::posix_time::ptime start =
+                        boost::posix_time::microsec_clock::universal_time();
+
+      std::size_t otherEvents = 0;
+      stress(producers, 100000, &otherEvents);
+
+      boost::posix_time::time_duration elapsed =
+            boost::posix_time::microsec_clock::universal_time() - start;
+      std::cerr << producers << " producer(s): "
+                << elapsed.total_milliseconds() << "ms for "
+                << producers * 100000 << " events" << std::endl;
+   }
+}
+
+} // end namespace tests
+} // end namespace session
+} // end namespace rstudio
@@ -16,14 +16,17 @@
 #include <algorithm>
 
 #include <boost/function.hpp>
+#include <boost/foreach.hpp>
 
 #include <core/BoostThread.hpp>
 #include <core/Log.hpp>
 #include <core/Error.hpp>
 #include <core/BoostErrors.hpp>
 #include <core/Thread.hpp>
+#include <core/Trace.hpp>
 #include <core/system/System.hpp>
 #include <core/Macros.hpp>
+#include <core/SafeConvert.hpp>
 
 
 #include <core/http/Request.hpp>
@@ -31,6 +34,7 @@
 #include <session/SessionOptions.hpp>
 #include <session/SessionHttpConnectionListener.hpp>
 #include <session/SessionClientEventService.hpp>
+#include <session/SessionConsoleProcessSocket.hpp>
 
 #include "SessionClientEventQueue.hpp"
 
@@ -49,6 +53,23 @@ bool hasEventIdLessThanOrEqualTo(const json::Value& event, int targetId)
    int eventId = eventJSON.find("id")->second.get_int();
    return eventId <= targetId;
 }
+
+void waitForEventBatch(ClientEventQueue& clientEventQueue,
+                       const boost::posix_time::time_duration& batchDelay,
+                       const boost::posix_time::time_duration& maxTotalBatchDelay)
+{
+   // wait for additional events that occur in rapid succession
+   // but don't wait for more than the specified maximum seconds (or
+   // once enough events have accumulated to fill a batch)
+   boost::system_time maxBatchDelayTime =
+                  boost::get_system_time() + maxTotalBatchDelay;
+
+   while ( !clientEventQueue.batchFull() &&
+           clientEventQueue.waitForEvent(batchDelay) &&
+           (boost::get_system_time() < maxBatchDelayTime) )
+   {
+   }
+}
          
 } // anonymous namespace
 
@@ -62,6 +83,9 @@ Error ClientEventService::start(const std::string& clientId)
 {
    // set our clientid
    setClientId(clientId, false);
+
+   // start the WebSocket transport (if enabled)
+   startWebSocket();
    
    // block all signals for launch of background thread (will cause it
    // to never receive signals)
@@ -102,6 +126,9 @@ void ClientEventService::stop()
 
          serviceThread_.detach();
       }
+
+      if (pWebSocket_)
+         pWebSocket_->stopServer();
    }
    catch(const boost::thread_interrupted&)
    {
@@ -113,16 +140,28 @@ void ClientEventService::stop()
    
 void ClientEventService::setClientId(const std::string& clientId, bool clearEvents)
 {
+   std::string previousClientId;
    LOCK_MUTEX(mutex_)
    {
+      previousClientId = clientId_.c_str(); // avoid ref count
       clientId_ = clientId.c_str(); // avoid ref count
       if (clearEvents)
          clientEvents_.clear();
+
+      // a new client needs to establish its own WebSocket connection
+      if (previousClientId != clientId)
+      {
+         webSocketConnected_ = false;
+         webSocketReady_ = false;
+      }
    }
    END_LOCK_MUTEX
 
    if (clearEvents)
       clientEventQueue().clear();
+
+   if (pWebSocket_)
+      listenOnWebSocket(previousClientId, clientId);
 }
    
 std::string ClientEventService::clientId()
@@ -137,21 +176,195 @@ std::string ClientEventService::clientId()
    return std::string();
 }
 
+int ClientEventService::webSocketPort()
+{
+   return pWebSocket_ ? pWebSocket_->port() : 0;
+}
+
+void ClientEventService::startWebSocket()
+{
+   if (!options().webSocketClientEvents() || pWebSocket_)
+      return;
+
+   // bind to a random port (the terminal port, if specified, is reserved
+   // for terminals)
+   boost::shared_ptr<console_process::ConsoleProcessSocket> pWebSocket(
+                              new console_process::ConsoleProcessSocket(false));
+   Error error = pWebSocket->ensureServerRunning();
+   if (error)
+   {
+      // clients will continue to use long polling
+      LOG_ERROR(error);
+      return;
+   }
+
+   pWebSocket_ = pWebSocket;
+   listenOnWebSocket(std::string(), clientId());
+}
+
+void ClientEventService::listenOnWebSocket(const std::string& previousClientId,
+                                           const std::string& clientId)
+{
+   // connections are keyed by client id
+   if (!previousClientId.empty() && previousClientId != clientId)
+      pWebSocket_->stopListening(previousClientId);
+
+   if (clientId.empty())
+      return;
+
+   console_process::ConsoleProcessSocketConnectionCallbacks callbacks;
+   callbacks.onConnectionOpened =
+                  boost::bind(&ClientEventService::onWebSocketOpened, this);
+   callbacks.onConnectionClosed =
+                  boost::bind(&ClientEventService::onWebSocketClosed, this);
+   callbacks.onReceivedInput =
+                  boost::bind(&ClientEventService::onWebSocketInput, this, _1);
+
+   Error error = pWebSocket_->listen(clientId, callbacks);
+   if (error)
+      LOG_ERROR(error);
+}
+
+void ClientEventService::onWebSocketOpened()
+{
+   LOCK_MUTEX(mutex_)
+   {
+      // we don't push events until the client tells us where it is up to
+      webSocketConnected_ = true;
+      webSocketReady_ = false;
+   }
+   END_LOCK_MUTEX
+}
+
+void ClientEventService::onWebSocketClosed()
+{
+   // any unacknowledged events will be delivered by long polling
+   LOCK_MUTEX(mutex_)
+   {
+      webSocketConnected_ = false;
+      webSocketReady_ = false;
+   }
+   END_LOCK_MUTEX
+}
+
+void ClientEventService::onWebSocketInput(const std::string& input)
+{
+   // the client sends the id of the last event it has seen
+   boost::optional<int> lastEventIdSeen = safe_convert::stringTo<int>(input);
+   if (!lastEventIdSeen)
+      return;
+
+   LOCK_MUTEX(mutex_)
+   {
+      // the first id received after connecting tells us which events
+      // need to be resent
+      if (webSocketConnected_ && !webSocketReady_)
+      {
+         webSocketReady_ = true;
+         webSocketResync_ = true;
+      }
+      webSocketLastEventIdSeen_ = *lastEventIdSeen;
+
+      // erase the acknowledged events along with recording the id (so a
+      // resync can never pick up events the client has already seen)
+      eraseEventsSeen(*lastEventIdSeen);
+   }
+   END_LOCK_MUTEX
+}
+
+bool ClientEventService::webSocketReady(bool* pResyncPending)
+{
+   LOCK_MUTEX(mutex_)
+   {
+      *pResyncPending = webSocketResync_;
+      return webSocketConnected_ && webSocketReady_;
+   }
+   END_LOCK_MUTEX
+
+   // keep compiler happy
+   return false;
+}
+
+void ClientEventService::pushEvents(int* pNextEventId)
+{
+   bool resync = false;
+   int lastEventIdSeen = -1;
+   json::Array events;
+   LOCK_MUTEX(mutex_)
+   {
+      resync = webSocketResync_;
+      webSocketResync_ = false;
+      lastEventIdSeen = webSocketLastEventIdSeen_;
+
+      // resend any events the client hasn't acknowledged
+      if (resync)
+      {
+         BOOST_FOREACH(const json::Value& event, clientEvents_)
+         {
+            if (!hasEventIdLessThanOrEqualTo(event, lastEventIdSeen))
+               events.push_back(event);
+         }
+      }
+   }
+   END_LOCK_MUTEX
+
+   // sync next event id to client (see comment in run)
+   if (resync)
+      *pNextEventId = std::max(*pNextEventId, lastEventIdSeen + 1);
+
+   // deque the events and convert to json (retaining them until the
+   // client acknowledges receipt)
+   std::vector<ClientEvent> clientEvents;
+   clientEventQueue().remove(&clientEvents);
+   BOOST_FOREACH(const ClientEvent& clientEvent, clientEvents)
+   {
+      json::Object event;
+      clientEvent.asJsonObject((*pNextEventId)++, &event);
+      addClientEvent(event);
+      events.push_back(event);
+   }
+
+   if (events.empty())
+      return;
+
+   core::trace::ScopedSpan span("client_events_push", core::trace::SpanContext());
+   span.setAttribute("events.count", static_cast<int>(events.size()));
+
+   Error error = pWebSocket_->sendText(clientId(), json::write(events));
+   if (error)
+   {
+      // stop pushing; the client will fall back to long polling and
+      // receive the unacknowledged events then
+      LOG_ERROR(error);
+      LOCK_MUTEX(mutex_)
+      {
+         webSocketReady_ = false;
+      }
+      END_LOCK_MUTEX
+   }
+}
+
 void ClientEventService::erasePreviouslyDeliveredEvents(int lastClientEventIdSeen)
 {
    LOCK_MUTEX(mutex_)
    {
-      clientEvents_.erase(
-               std::remove_if(clientEvents_.begin(),
-                              clientEvents_.end(),
-                              boost::bind(hasEventIdLessThanOrEqualTo,
-                                          _1,
-                                          lastClientEventIdSeen)),
-               clientEvents_.end());
+      eraseEventsSeen(lastClientEventIdSeen);
    }
    END_LOCK_MUTEX
 }
 
+void ClientEventService::eraseEventsSeen(int lastClientEventIdSeen)
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+   clientEvents_.erase(
+            std::remove_if(clientEvents_.begin(),
+                           clientEvents_.end(),
+                           boost::bind(hasEventIdLessThanOrEqualTo,
+                                       _1,
+                                       lastClientEventIdSeen)),
+            clientEvents_.end());
+}
+
 bool ClientEventService::havePendingClientEvents()
 {
    LOCK_MUTEX(mutex_)
@@ -211,6 +424,34 @@ void ClientEventService::run()
       bool stopServer = false ;
       while (!stopServer || clientEventQueue.hasEvents())
       {
+         // if the client is connected to the WebSocket then push events
+         // to it as they arrive
+         bool resyncPending = false;
+         if (pWebSocket_ && webSocketReady(&resyncPending))
+         {
+            try
+            {
+               if (!stopServer &&
+                   (resyncPending || clientEventQueue.hasEvents() ||
+                    clientEventQueue.waitForEvent(boost::posix_time::seconds(1))))
+               {
+                  waitForEventBatch(clientEventQueue,
+                                    batchDelay,
+                                    maxTotalBatchDelay);
+               }
+
+               if (boost::this_thread::interruption_requested())
+                  throw boost::thread_interrupted();
+            }
+            catch(const boost::thread_interrupted&)
+            {
+               stopServer = true;
+            }
+
+            pushEvents(&nextEventId);
+            continue;
+         }
+
          boost::shared_ptr<HttpConnection> ptrConnection ;
          try
          {
@@ -292,16 +533,9 @@ void ClientEventService::run()
                 clientEventQueue.waitForEvent(maxRequestSec))
             {
                // ...got at least one event
-               
-               // wait for additional events that occur in rapid succession 
-               // but don't wait for more than the specified maximum seconds
-               boost::system_time maxBatchDelayTime = 
-                              boost::get_system_time() + maxTotalBatchDelay;
-               
-               while ( clientEventQueue.waitForEvent(batchDelay) &&
-                       (boost::get_system_time() < maxBatchDelayTime) )
-               {
-               }
+               waitForEventBatch(clientEventQueue,
+                                 batchDelay,
+                                 maxTotalBatchDelay);
            }
          }
          catch(const boost::thread_interrupted&)
@@ -320,9 +554,17 @@ void ClientEventService::run()
          // events on the next iteration of the accept loop
          if (request.clientId == clientId())
          {
+            core::trace::ScopedSpan span(
+                     "client_events",
+                     core::trace::parseTraceparent(
+                        ptrConnection->request().headerValue(
+                                       core::trace::kTraceparentHeader)),
+                     core::trace::SpanKindServer);
+
             // deque the events
             std::vector<ClientEvent> events;
             clientEventQueue.remove(&events);
+            span.setAttribute("events.count", static_cast<int>(events.size()));
             
             // convert to json and add event id
             for (std::vector<ClientEvent>::const_iterator 
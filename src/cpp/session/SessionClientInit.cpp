@@ -41,12 +41,15 @@
 #include "modules/environment/SessionEnvironment.hpp"
 #include "modules/presentation/SessionPresentation.hpp"
 
+#include <limits>
+
 #include <r/session/RSession.hpp>
 #include <r/session/RClientState.hpp>
 #include <r/session/RConsoleActions.hpp>
 #include <r/session/RConsoleHistory.hpp>
 #include <r/ROptions.hpp>
 
+#include <core/StartupTrace.hpp>
 #include <core/json/Json.hpp>
 #include <core/json/JsonRpc.hpp>
 #include <core/http/Request.hpp>
@@ -78,6 +81,8 @@ namespace client_init {
 void handleClientInit(const boost::function<void()>& initFunction,
                       boost::shared_ptr<HttpConnection> ptrConnection)
 {
+   core::startup_trace::Scope traceScope("client init", "client");
+
    // alias options
    Options& options = session::options();
    
@@ -169,10 +174,16 @@ void handleClientInit(const boost::function<void()>& initFunction,
    sessionInfo["resumed"] = resumed; 
    if (resumed)
    {
-      // console actions
+      // console actions (just those which produce the lines the client will
+      // show; earlier ones can be had from get_console_actions)
       json::Object actionsObject;
-      consoleActions.asJson(&actionsObject);
+      std::size_t actionsStart;
+      consoleActions.asJson(std::numeric_limits<std::size_t>::max(),
+                            consoleActions.capacity(),
+                            &actionsObject,
+                            &actionsStart);
       sessionInfo["console_actions"] = actionsObject;
+      sessionInfo["console_actions_start"] = static_cast<int>(actionsStart);
    }
 
    sessionInfo["rnw_weave_types"] = modules::authoring::supportedRnwWeaveTypes();
@@ -342,6 +353,8 @@ void handleClientInit(const boost::function<void()>& initFunction,
    sessionInfo["allow_full_ui"] = options.allowFullUI();
    sessionInfo["websocket_ping_interval"] = options.webSocketPingInterval();
    sessionInfo["websocket_connect_timeout"] = options.webSocketConnectTimeout();
+   sessionInfo["client_events_websocket_port"] =
+                                 clientEventService().webSocketPort();
 
    // publishing may be disabled globally or just for external services, and
    // via configuration options or environment variables
@@ -144,6 +144,13 @@ Error extractConsoleInput(const json::JsonRpcRequest& request)
    }
 }
 
+// whether there is input buffered (e.g. the rest of a multi-line paste) which
+// R will read without prompting
+bool inputPending()
+{
+   return !s_consoleInputBuffer.empty();
+}
+
 bool executing()
 {
    return s_rProcessingInput;
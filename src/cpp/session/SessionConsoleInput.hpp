@@ -29,6 +29,7 @@ namespace session {
 namespace console_input {
 
 void clearConsoleInputBuffer();
+bool inputPending();
 bool executing();
 core::Error extractConsoleInput(const core::json::JsonRpcRequest& request);
 void reissueLastConsolePrompt();
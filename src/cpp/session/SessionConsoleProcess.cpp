@@ -539,7 +539,7 @@ void ConsoleProcess::enqueOutputEvent(const std::string &output)
 
    if (procInfo_->getChannelMode() == Websocket)
    {
-      s_terminalSocket.sendText(procInfo_->getHandle(), output);
+      s_terminalSocket.enqueText(procInfo_->getHandle(), output);
       return;
    }
 
@@ -554,6 +554,8 @@ void ConsoleProcess::enqueOutputEvent(const std::string &output)
 void ConsoleProcess::onStdout(core::system::ProcessOperations& ops,
                               const std::string& output)
 {
+   onOutput_(output);
+
    if (options_.smartTerminal)
    {
       LOCK_MUTEX(inputOutputQueueMutex_)
@@ -102,7 +102,14 @@ void ConsoleProcessInfo::appendToOutputBuffer(const std::string &str)
    std::string mainBufferStr =
          core::text::stripSecondaryBuffer(str, &altBufferActive_);
 
-   console_persist::appendToOutputBuffer(handle_, mainBufferStr);
+   console_persist::appendToOutputBuffer(handle_, mainBufferStr, maxOutputLines_);
+
+   if (savedBufferLoaded_)
+   {
+      savedBufferFileSize_ += mainBufferStr.size();
+      if (savedBuffer_.append(mainBufferStr))
+         savedBufferTrimmed_ = true;
+   }
 }
 
 void ConsoleProcessInfo::appendToOutputBuffer(char ch)
@@ -110,29 +117,61 @@ void ConsoleProcessInfo::appendToOutputBuffer(char ch)
    outputBuffer_.push_back(ch);
 }
 
+void ConsoleProcessInfo::setMaxOutputLines(int maxOutputLines)
+{
+   maxOutputLines_ = maxOutputLines;
+   invalidateSavedBuffer();
+}
+
+const core::text::LineRingBuffer& ConsoleProcessInfo::savedBuffer() const
+{
+   // (re)load the buffer if it's not been read yet or the file was changed
+   // by something other than our own appends
+   uintmax_t fileSize = console_persist::getSavedBufferSize(handle_);
+   if (!savedBufferLoaded_ || fileSize != savedBufferFileSize_)
+   {
+      savedBuffer_.setMaxLines(maxOutputLines_);
+      savedBufferTrimmed_ =
+            savedBuffer_.assign(console_persist::getSavedBuffer(handle_, 0));
+      savedBufferFileSize_ = fileSize;
+      savedBufferLoaded_ = true;
+   }
+
+   // Persist the trimmed buffer. Otherwise the file can grow without bound
+   // until the terminal is closed or cleared.
+   if (savedBufferTrimmed_)
+   {
+      console_persist::saveOutputBuffer(handle_, savedBuffer_.str());
+      savedBufferFileSize_ = console_persist::getSavedBufferSize(handle_);
+      savedBufferTrimmed_ = false;
+   }
+
+   return savedBuffer_;
+}
+
+void ConsoleProcessInfo::invalidateSavedBuffer() const
+{
+   savedBuffer_.clear();
+   savedBufferLoaded_ = false;
+   savedBufferTrimmed_ = false;
+   savedBufferFileSize_ = 0;
+}
+
 std::string ConsoleProcessInfo::getSavedBufferChunk(
       int requestedChunk, bool* pMoreAvailable) const
 {
-   // We read the entire buffer into memory to return a given chunk. This is
-   // ok for our current usage pattern, where the buffer-size is bounded
-   // to a certain number of lines and is infrequently reloaded (only upon
-   // browser refresh or reloading a session). If this pattern becomes
-   // more frequent and/or we support much larger buffers, we'd want to
-   // reconsider this implementation.
-
-   // Read buffer (trims to maxOutputLines_ when chunk zero is requested)
-   std::string buffer = console_persist::getSavedBuffer(
-            handle_,
-            requestedChunk == 0 ? maxOutputLines_ : 0);
+   // The buffer is kept in memory, trimmed to maxOutputLines_ as output is
+   // appended, so returning a chunk doesn't re-read the saved file.
+   const core::text::LineRingBuffer& buffer = savedBuffer();
 
    *pMoreAvailable = false;
 
    // Common case, entire buffer fits in chunk zero
-   if (requestedChunk == 0 && (buffer.length() <= kOutputBufferSize))
-      return buffer;
+   if (requestedChunk == 0 && (buffer.size() <= kOutputBufferSize))
+      return buffer.str();
 
    // Chunk requested past end of buffer?
-   if (requestedChunk * kOutputBufferSize >= buffer.length())
+   if (requestedChunk * kOutputBufferSize >= buffer.size())
       return std::string();
 
    // Otherwise return substring for the chunk (substr doesn't mind if you ask
@@ -140,21 +179,25 @@ std::string ConsoleProcessInfo::getSavedBufferChunk(
    // starting position is within the string)
    std::string chunk = buffer.substr(
             requestedChunk * kOutputBufferSize, kOutputBufferSize);
-   if (requestedChunk * kOutputBufferSize + chunk.length() < buffer.length())
+   if (requestedChunk * kOutputBufferSize + chunk.length() < buffer.size())
       *pMoreAvailable = true;
 
    return chunk;
 }
 
+std::size_t ConsoleProcessInfo::memoryUsage() const
+{
+   return outputBuffer_.capacity() + savedBuffer_.memoryUsage();
+}
+
 std::string ConsoleProcessInfo::getFullSavedBuffer() const
 {
-   // Read buffer (trims to maxOutputLines_)
-   return console_persist::getSavedBuffer(handle_, maxOutputLines_);
+   return savedBuffer().str();
 }
 
 int ConsoleProcessInfo::getBufferLineCount() const
 {
-   return console_persist::getSavedBufferLineCount(handle_, maxOutputLines_);
+   return static_cast<int>(savedBuffer().lineCount());
 }
 
 std::string ConsoleProcessInfo::bufferedOutput() const
@@ -173,6 +216,7 @@ std::string ConsoleProcessInfo::bufferedOutput() const
 void ConsoleProcessInfo::deleteLogFile(bool lastLineOnly) const
 {
    console_persist::deleteLogFile(handle_, lastLineOnly);
+   invalidateSavedBuffer();
 }
 
 void ConsoleProcessInfo::deleteEnvFile() const
@@ -15,10 +15,17 @@
 
 #include <session/SessionConsoleProcessPersist.hpp>
 
+#include <map>
+
 #include <boost/foreach.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <core/FileSerializer.hpp>
+#include <core/StringUtils.hpp>
+#include <core/Thread.hpp>
 
+#include <session/SessionLocalScratch.hpp>
 #include <session/SessionModuleContext.hpp>
 #include <session/SessionOptions.hpp>
 
@@ -66,7 +73,9 @@ void initialize()
    if (session::options().multiSession() &&
        session::options().programMode() == kSessionProgramModeServer)
    {
-      s_consoleProcPath = module_context::sessionScratchPath().complete(kConsoleDir);
+      // (terminal buffers are written as output arrives)
+      s_consoleProcPath = local_scratch::localPath(
+               module_context::sessionScratchPath().complete(kConsoleDir));
    }
    else
    {
@@ -123,6 +132,162 @@ Error getEnvFilePath(const std::string& handle, FilePath* pFile)
    return Success();
 }
 
+// once this much output has been appended to a buffer file, the writer
+// trims it to its terminal's maximum number of lines
+const uintmax_t kCompactionBytes = 1024 * 1024;
+
+// Appends terminal output to the buffer files on a background thread, so
+// heavy output doesn't hold up the session on slow (e.g. network) storage.
+// Anything which reads or replaces a buffer file flushes the writer first.
+class OutputWriter : boost::noncopyable
+{
+public:
+   OutputWriter()
+      : started_(false), failed_(false), writing_(false)
+   {
+   }
+
+   void append(const FilePath& log, const std::string& output, int maxLines)
+   {
+      bool writeNow = false;
+      LOCK_MUTEX(mutex_)
+      {
+         if (!started_)
+         {
+            // if the thread can't be started we fall back to writing on
+            // the caller's thread
+            started_ = true;
+            core::thread::safeLaunchThread(
+                     boost::bind(&OutputWriter::run, this), &thread_);
+            failed_ = !thread_.joinable();
+         }
+
+         if (failed_)
+         {
+            writeNow = true;
+         }
+         else
+         {
+            PendingOutput& pending = pending_[log.absolutePath()];
+            pending.log = log;
+            pending.output.append(output);
+            pending.maxLines = maxLines;
+         }
+      }
+      END_LOCK_MUTEX
+
+      if (writeNow)
+      {
+         Error error = core::appendToFile(log, output);
+         if (error)
+            LOG_ERROR(error);
+         return;
+      }
+
+      workSignal_.notify_one();
+   }
+
+   // wait until all output appended so far has been written
+   void flush()
+   {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (!pending_.empty() || writing_)
+         idleSignal_.wait(lock);
+   }
+
+private:
+   struct PendingOutput
+   {
+      PendingOutput() : maxLines(0) {}
+      FilePath log;
+      std::string output;
+      int maxLines;
+   };
+
+   void run()
+   {
+      while (true)
+      {
+         std::map<std::string, PendingOutput> pending;
+         {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while (pending_.empty())
+               workSignal_.wait(lock);
+            pending.swap(pending_);
+            writing_ = true;
+         }
+
+         try
+         {
+            for (std::map<std::string, PendingOutput>::const_iterator it = pending.begin();
+                 it != pending.end();
+                 ++it)
+            {
+               write(it->second);
+            }
+         }
+         CATCH_UNEXPECTED_EXCEPTION
+
+         {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            writing_ = false;
+         }
+         idleSignal_.notify_all();
+      }
+   }
+
+   void write(const PendingOutput& pending)
+   {
+      Error error = core::appendToFile(pending.log, pending.output);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+
+      // periodically trim the file so it doesn't grow without bound while
+      // nothing is reading it back (only the writer thread uses this map)
+      uintmax_t& appended = appendedBytes_[pending.log.absolutePath()];
+      appended += pending.output.size();
+      if (appended < kCompactionBytes || pending.maxLines < 1)
+         return;
+      appended = 0;
+
+      std::string content;
+      error = core::readStringFromFile(pending.log, &content);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+
+      if (string_utils::trimLeadingLines(pending.maxLines, &content))
+      {
+         error = core::writeStringToFile(pending.log, content);
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+
+   boost::mutex mutex_;
+   boost::condition_variable workSignal_;
+   boost::condition_variable idleSignal_;
+   std::map<std::string, PendingOutput> pending_;
+   bool started_;
+   bool failed_;
+   bool writing_;
+   boost::thread thread_;
+
+   std::map<std::string, uintmax_t> appendedBytes_;
+};
+
+OutputWriter& outputWriter()
+{
+   // never destroyed, as its thread may still be waiting for work at exit
+   static OutputWriter* pWriter = new OutputWriter();
+   return *pWriter;
+}
+
 } // anonymous namespace
 
 std::string loadConsoleProcessMetadata()
@@ -156,6 +321,8 @@ void saveConsoleProcesses(const std::string& metadata)
 
 std::string getSavedBuffer(const std::string& handle, int maxLines)
 {
+   flushOutputBuffers();
+
    std::string content;
    FilePath log;
 
@@ -202,7 +369,9 @@ int getSavedBufferLineCount(const std::string& handle, int maxLines)
    return static_cast<int>(string_utils::countNewlines(buffer) + 1);
 }
 
-void appendToOutputBuffer(const std::string& handle, const std::string& buffer)
+void appendToOutputBuffer(const std::string& handle,
+                          const std::string& buffer,
+                          int maxLines)
 {
    FilePath log;
    Error error = getLogFilePath(handle, &log);
@@ -212,15 +381,55 @@ void appendToOutputBuffer(const std::string& handle, const std::string& buffer)
       return;
    }
 
-   error = rstudio::core::appendToFile(log, buffer);
+   outputWriter().append(log, buffer, maxLines);
+}
+
+void flushOutputBuffers()
+{
+   outputWriter().flush();
+}
+
+void saveOutputBuffer(const std::string& handle, const std::string& buffer)
+{
+   flushOutputBuffers();
+
+   FilePath log;
+   Error error = getLogFilePath(handle, &log);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   error = core::writeStringToFile(log, buffer);
    if (error)
    {
       LOG_ERROR(error);
    }
 }
 
+uintmax_t getSavedBufferSize(const std::string& handle)
+{
+   flushOutputBuffers();
+
+   FilePath log;
+   Error error = getLogFilePath(handle, &log);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return 0;
+   }
+
+   if (!log.exists())
+      return 0;
+
+   return log.size();
+}
+
 void deleteLogFile(const std::string &handle, bool lastLineOnly)
 {
+   flushOutputBuffers();
+
    FilePath log;
    Error error = getLogFilePath(handle, &log);
    if (error)
@@ -277,6 +486,8 @@ void deleteOrphanedLogs(bool (*validHandle)(const std::string&))
    if (!validHandle)
       return;
 
+   flushOutputBuffers();
+
    // Delete orphaned buffer files
    std::vector<FilePath> children;
    Error error = getConsoleProcPath().children(&children);
@@ -37,13 +37,20 @@ namespace {
 // returned by rand; only an issue for unit tests, really
 bool s_didSeedRand = false;
 
+// how long queued output waits for more output to join it, and how much
+// output we'll queue for a terminal before sending it regardless
+const long kFlushDelayMs = 5;
+const std::size_t kMaxQueuedTextSize = 64 * 1024;
+
 } // anonymous namespace
 
-ConsoleProcessSocket::ConsoleProcessSocket()
+ConsoleProcessSocket::ConsoleProcessSocket(bool useTerminalPort)
    :
      port_(0),
+     useTerminalPort_(useTerminalPort),
      serverRunning_(false),
-     activeConnections_(0)
+     activeConnections_(0),
+     flushScheduled_(false)
 {
 }
 
@@ -71,7 +78,9 @@ Error ConsoleProcessSocket::ensureServerRunning()
       s_didSeedRand = true;
    }
 
-   std::string portStr = session::options().terminalPort();
+   std::string portStr;
+   if (useTerminalPort_)
+      portStr = session::options().terminalPort();
    if (portStr.empty())
    {
       // no user-specified port; pick a random port
@@ -190,6 +199,14 @@ void ConsoleProcessSocket::stopServer()
 
          pwsServer_->stop();
          serverRunning_ = false;
+
+         LOCK_MUTEX(queuedTextMutex_)
+         {
+            queuedText_.clear();
+            flushScheduled_ = false;
+         }
+         END_LOCK_MUTEX
+
          port_ = 0;
          websocketThread_.join();
          pwsServer_.reset();
@@ -270,6 +287,91 @@ Error ConsoleProcessSocket::sendText(const std::string& terminalHandle,
    return sendRawText(terminalHandle, ConsoleProcessSocketPacket::textPacket(message));
 }
 
+Error ConsoleProcessSocket::enqueText(const std::string& terminalHandle,
+                                      const std::string& message)
+{
+   if (!serverRunning_)
+   {
+      return systemError(boost::system::errc::not_connected,
+                         terminalHandle,
+                         ERROR_LOCATION);
+   }
+
+   bool flushNow = false;
+   bool scheduleFlush = false;
+   LOCK_MUTEX(queuedTextMutex_)
+   {
+      std::string& queued = queuedText_[terminalHandle];
+      queued.append(message);
+      flushNow = queued.size() >= kMaxQueuedTextSize;
+      scheduleFlush = !flushNow && !flushScheduled_;
+      if (scheduleFlush)
+         flushScheduled_ = true;
+   }
+   END_LOCK_MUTEX
+
+   if (flushNow)
+   {
+      flushQueuedText();
+   }
+   else if (scheduleFlush)
+   {
+      try
+      {
+         pwsServer_->set_timer(
+                  kFlushDelayMs,
+                  boost::bind(&ConsoleProcessSocket::onFlushTimer, this, _1));
+      }
+      catch (websocketpp::exception const& e)
+      {
+         // couldn't schedule the flush, so send what we have now
+         LOG_ERROR_MESSAGE(e.what());
+         flushQueuedText();
+      }
+   }
+
+   return Success();
+}
+
+void ConsoleProcessSocket::flushQueuedText()
+{
+   LOCK_MUTEX(flushMutex_)
+   {
+      std::map<std::string, std::string> queuedText;
+      LOCK_MUTEX(queuedTextMutex_)
+      {
+         queuedText.swap(queuedText_);
+         flushScheduled_ = false;
+      }
+      END_LOCK_MUTEX
+
+      for (std::map<std::string, std::string>::const_iterator it = queuedText.begin();
+           it != queuedText.end();
+           ++it)
+      {
+         // errors are expected here when a terminal's connection closed while
+         // its output was queued, and are ignored just as the senders would
+         sendText(it->first, it->second);
+      }
+   }
+   END_LOCK_MUTEX
+}
+
+void ConsoleProcessSocket::onFlushTimer(const websocketpp::lib::error_code& ec)
+{
+   if (ec)
+   {
+      LOCK_MUTEX(queuedTextMutex_)
+      {
+         flushScheduled_ = false;
+      }
+      END_LOCK_MUTEX
+      return;
+   }
+
+   flushQueuedText();
+}
+
 Error ConsoleProcessSocket::sendPong(const std::string& terminalHandle)
 {
    return sendRawText(terminalHandle, ConsoleProcessSocketPacket::keepAlivePacket());
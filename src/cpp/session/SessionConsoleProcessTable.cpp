@@ -15,11 +15,15 @@
 
 #include "SessionConsoleProcessTable.hpp"
 
+#include <algorithm>
+
 #include <boost/foreach.hpp>
 #include <boost/range/adaptor/map.hpp>
 
+#include <core/MemoryAccounting.hpp>
 #include <core/SafeConvert.hpp>
 
+#include <session/SessionConsoleProcessPersist.hpp>
 #include <session/SessionModuleContext.hpp>
 
 #include "SessionConsoleProcessApi.hpp"
@@ -93,6 +97,7 @@ bool isKnownProcHandle(const std::string& handle)
 
 void onSuspend(core::Settings* /*pSettings*/)
 {
+   console_persist::flushOutputBuffers();
    serializeConsoleProcs();
    s_visibleTerminalHandle.clear();
 }
@@ -110,6 +115,45 @@ void loadConsoleProcesses()
    ConsoleProcessInfo::deleteOrphanedLogs(isKnownProcHandle);
 }
 
+bool largerMemoryUsage(const ConsoleProcessPtr& lhs, const ConsoleProcessPtr& rhs)
+{
+   return lhs->memoryUsage() > rhs->memoryUsage();
+}
+
+memory_accounting::Usage terminalsUsage()
+{
+   memory_accounting::Usage usage;
+   BOOST_FOREACH(const ConsoleProcessPtr& proc, s_procs | boost::adaptors::map_values)
+   {
+      usage.bytes += proc->memoryUsage();
+      usage.entries++;
+   }
+   return usage;
+}
+
+void evictTerminalBuffers(std::size_t budget)
+{
+   // saved buffers are persisted, so dropping the in-memory copies (largest
+   // first) just means they're re-read when next requested
+   std::vector<ConsoleProcessPtr> procs;
+   BOOST_FOREACH(const ConsoleProcessPtr& proc, s_procs | boost::adaptors::map_values)
+   {
+      procs.push_back(proc);
+   }
+   std::sort(procs.begin(), procs.end(), largerMemoryUsage);
+
+   std::size_t bytes = terminalsUsage().bytes;
+   BOOST_FOREACH(const ConsoleProcessPtr& proc, procs)
+   {
+      if (bytes <= budget)
+         break;
+
+      std::size_t before = proc->memoryUsage();
+      proc->releaseSavedBuffer();
+      bytes -= before - std::min(before, proc->memoryUsage());
+   }
+}
+
 } // anonymous namespace--------------
 
 ConsoleProcessPtr findProcByHandle(const std::string& handle)
@@ -178,6 +222,8 @@ void saveConsoleProcesses()
 
 void saveConsoleProcessesAtShutdown(bool terminatedNormally)
 {
+   console_persist::flushOutputBuffers();
+
    if (!terminatedNormally)
       return;
 
@@ -242,6 +288,10 @@ Error internalInitialize()
 
    loadConsoleProcesses();
 
+   memory_accounting::registerSubsystem("terminals",
+                                        terminalsUsage,
+                                        evictTerminalBuffers);
+
    return initializeApi();
 }
 
@@ -50,6 +50,7 @@
 #include <session/SessionOptions.hpp>
 #include <session/SessionPersistentState.hpp>
 #include <session/SessionScopes.hpp>
+#include <session/http/SessionPostbackChannel.hpp>
 #include <session/projects/SessionProjects.hpp>
 
 #ifdef RSTUDIO_SERVER
@@ -184,6 +185,12 @@ Error startHttpConnectionListener()
       core::system::setenv(kRSessionStandalonePortNumber, safe_convert::numberToString(endpoint.port()));
    }
 
+   // start the postback channel (postbacks fall back on rpostback if it
+   // can't be started, so this needn't be fatal)
+   error = session::http::startPostbackChannel();
+   if (error)
+      LOG_ERROR(error);
+
    return Success();
 }
 
@@ -476,8 +483,9 @@ bool waitForMethod(const std::string& method,
                                             connectionQueueTimeout);
 
 
-      // perform background processing (true for isIdle)
-      module_context::onBackgroundProcessing(true);
+      // perform background processing (true for isIdle), deferring
+      // scheduled work if there's a request to respond to
+      module_context::onBackgroundProcessing(true, ptrConnection != NULL);
 
       // process pending events
       processEvents();
@@ -485,7 +493,8 @@ bool waitForMethod(const std::string& method,
       if (ptrConnection)
       {
          // ensure request signature is valid
-         if (!verifyRequestSignature(ptrConnection->request()))
+         if (!ptrConnection->preauthenticated() &&
+             !verifyRequestSignature(ptrConnection->request()))
          {
             core::http::Response response;
             response.setError(http::status::Unauthorized, "Invalid message signature");
@@ -0,0 +1,223 @@
+/*
+ * SessionLocalScratch.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <session/SessionLocalScratch.hpp>
+
+#include <map>
+#include <set>
+
+#include <boost/foreach.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/Hash.hpp>
+#include <core/Log.hpp>
+#include <core/Thread.hpp>
+#include <core/system/System.hpp>
+
+#ifndef _WIN32
+#include <core/system/FileMode.hpp>
+#endif
+
+#include <session/SessionOptions.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace local_scratch {
+
+namespace {
+
+boost::mutex s_mutex;
+
+// local copies, by the scratch directory they stand in for
+std::map<std::string, FilePath> s_localPaths;
+
+bool s_writtenBack = false;
+
+// make the target directory a copy of the source; files are copied only
+// when their size or modification time differ, so this is cheap when the
+// directories are mostly the same
+Error syncDirectory(const FilePath& source, const FilePath& target)
+{
+   Error error = target.ensureDirectory();
+   if (error)
+      return error;
+
+   std::vector<FilePath> sourceChildren;
+   error = source.children(&sourceChildren);
+   if (error)
+      return error;
+
+   std::vector<FilePath> targetChildren;
+   error = target.children(&targetChildren);
+   if (error)
+      return error;
+
+   // remove what is no longer in the source
+   std::set<std::string> names;
+   BOOST_FOREACH(const FilePath& child, sourceChildren)
+   {
+      names.insert(child.filename());
+   }
+   BOOST_FOREACH(const FilePath& child, targetChildren)
+   {
+      if (names.count(child.filename()) == 0)
+      {
+         error = child.remove();
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+
+   BOOST_FOREACH(const FilePath& child, sourceChildren)
+   {
+      FilePath targetChild = target.complete(child.filename());
+      if (child.isDirectory())
+      {
+         if (targetChild.exists() && !targetChild.isDirectory())
+            error = targetChild.remove();
+         if (!error)
+            error = syncDirectory(child, targetChild);
+      }
+      else
+      {
+         std::time_t lastWriteTime = child.lastWriteTime();
+         if (targetChild.exists() &&
+             !targetChild.isDirectory() &&
+             targetChild.size() == child.size() &&
+             targetChild.lastWriteTime() == lastWriteTime)
+         {
+            continue;
+         }
+
+         error = targetChild.removeIfExists();
+         if (!error)
+            error = child.copy(targetChild);
+         if (!error)
+            targetChild.setLastWriteTime(lastWriteTime);
+      }
+
+      if (error)
+      {
+         LOG_ERROR(error);
+         error = Success();
+      }
+   }
+
+   return Success();
+}
+
+Error createLocalPath(const FilePath& scratchPath, FilePath* pLocalPath)
+{
+   // local copies are kept in a folder of the user's (since the local
+   // scratch directory may be shared by all users of the machine)
+   FilePath userPath = options().localScratchDir().complete(
+                                                   core::system::username());
+   Error error = userPath.ensureDirectory();
+   if (error)
+      return error;
+
+#ifndef _WIN32
+   error = core::system::changeFileMode(userPath,
+                                       core::system::UserReadWriteExecuteMode);
+   if (error)
+      return error;
+#endif
+
+   FilePath local = userPath.complete(
+                  core::hash::crc32HexHash(scratchPath.absolutePath()));
+
+   // bring the local copy up to date (it may be left from an earlier
+   // session which used the same scratch directory)
+   if (scratchPath.exists())
+      error = syncDirectory(scratchPath, local);
+   else
+      error = local.resetDirectory();
+   if (error)
+      return error;
+
+   *pLocalPath = local;
+   return Success();
+}
+
+} // anonymous namespace
+
+FilePath localPath(const FilePath& scratchPath)
+{
+   if (options().localScratchDir().empty())
+      return scratchPath;
+
+   LOCK_MUTEX(s_mutex)
+   {
+      if (s_writtenBack)
+         return scratchPath;
+
+      std::map<std::string, FilePath>::const_iterator it =
+                                 s_localPaths.find(scratchPath.absolutePath());
+      if (it != s_localPaths.end())
+         return it->second;
+
+      FilePath local;
+      Error error = createLocalPath(scratchPath, &local);
+      if (error)
+      {
+         // (use the scratch directory itself from now on)
+         LOG_ERROR(error);
+         local = scratchPath;
+      }
+
+      s_localPaths[scratchPath.absolutePath()] = local;
+      return local;
+   }
+   END_LOCK_MUTEX
+
+   return scratchPath;
+}
+
+void writeBack()
+{
+   LOCK_MUTEX(s_mutex)
+   {
+      s_writtenBack = true;
+
+      for (std::map<std::string, FilePath>::const_iterator it =
+              s_localPaths.begin();
+           it != s_localPaths.end();
+           ++it)
+      {
+         FilePath scratchPath(it->first);
+         const FilePath& local = it->second;
+         if (local == scratchPath)
+            continue;
+
+         // (the local copy is kept should it fail to be written back)
+         Error error = syncDirectory(local, scratchPath);
+         if (!error)
+            error = local.remove();
+         if (error)
+            LOG_ERROR(error);
+      }
+
+      s_localPaths.clear();
+   }
+   END_LOCK_MUTEX
+}
+
+} // namespace local_scratch
+} // namespace session
+} // namespace rstudio
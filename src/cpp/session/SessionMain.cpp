@@ -46,12 +46,16 @@
 #include <core/Exec.hpp>
 #include <core/Scope.hpp>
 #include <core/Settings.hpp>
+#include <core/StartupTrace.hpp>
+#include <core/Trace.hpp>
 #include <core/Thread.hpp>
 #include <core/Log.hpp>
 #include <core/LogWriter.hpp>
 #include <core/system/System.hpp>
 #include <core/ProgramStatus.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/InitGraph.hpp>
+#include <core/http/ContentEncoding.hpp>
 #include <core/http/URL.hpp>
 #include <core/http/Request.hpp>
 #include <core/http/Response.hpp>
@@ -63,9 +67,13 @@
 #include <core/system/ParentProcessMonitor.hpp>
 
 #include <core/system/FileMonitor.hpp>
+#ifndef _WIN32
+#include <core/system/PosixSamplingProfiler.hpp>
+#endif
 #include <core/text/TemplateFilter.hpp>
 #include <core/r_util/RSessionContext.hpp>
 #include <core/r_util/REnvironment.hpp>
+#include <core/r_util/RUserData.hpp>
 #include <core/WaitUtils.hpp>
 
 #include <r/RJsonRpc.hpp>
@@ -83,12 +91,14 @@
 #include <r/RUtil.hpp>
 
 #include <monitor/MonitorClient.hpp>
+#include <monitor/metrics/Metric.hpp>
 
 #include <session/SessionConstants.hpp>
 #include <session/SessionOptions.hpp>
 #include <session/SessionUserSettings.hpp>
 #include <session/SessionSourceDatabase.hpp>
 #include <session/SessionPersistentState.hpp>
+#include <session/SessionLocalScratch.hpp>
 #include <session/SessionContentUrls.hpp>
 #include <session/SessionScopes.hpp>
 #include <session/SessionClientEventService.hpp>
@@ -150,6 +160,7 @@
 #include "modules/SessionHistory.hpp"
 #include "modules/SessionLimits.hpp"
 #include "modules/SessionLists.hpp"
+#include "modules/SessionMemory.hpp"
 #include "modules/build/SessionBuild.hpp"
 #include "modules/clang/SessionClang.hpp"
 #include "modules/connections/SessionConnections.hpp"
@@ -189,6 +200,7 @@
 #include "workers/SessionWebRequestWorker.hpp"
 
 #include <session/SessionHttpConnectionListener.hpp>
+#include <session/SessionRequestMetrics.hpp>
 
 #include "session-config.h"
 
@@ -332,23 +344,31 @@ Error registerSignalHandlers()
    using namespace rstudio::core::system;
 
    // USR1 and USR2: perform suspend in server mode
+   ExecBlock registerBlock ;
    if (rsession::options().programMode() == kSessionProgramModeServer)
    {
-      ExecBlock registerBlock ;
       registerBlock.addFunctions()
          (bind(handleSignal, SigUsr1, suspend::handleUSR1))
          (bind(handleSignal, SigUsr2, suspend::handleUSR2));
-      return registerBlock.execute();
    }
    // USR1 and USR2: ignore in desktop mode
    else
    {
-      ExecBlock registerBlock ;
       registerBlock.addFunctions()
          (bind(ignoreSignal, SigUsr1))
          (bind(ignoreSignal, SigUsr2));
-      return registerBlock.execute();
    }
+
+#ifdef SIGRTMIN
+   // RTMIN+1: start/stop the native sampling profiler (kill -s RTMIN+1),
+   // which writes its profiles to the log directory
+   registerBlock.addFunctions()
+      (bind(sampling_profiler::registerToggleSignal,
+            SIGRTMIN + 1,
+            rsession::options().userLogPath()));
+#endif
+
+   return registerBlock.execute();
 }
 
 
@@ -396,8 +416,14 @@ void exitEarly(int status)
    ::exit(status);
 }
       
+// when R was started (for the startup trace)
+core::startup_trace::Timestamp s_rStartTime;
+
 Error rInit(const rstudio::r::session::RInitInfo& rInitInfo) 
 {
+   // R's own startup (including site and user profiles) runs up to here
+   core::startup_trace::record("R startup", "r", s_rStartTime);
+
    // save state we need to reference later
    suspend::setSessionResumed(rInitInfo.resumed);
    
@@ -417,126 +443,143 @@ Error rInit(const rstudio::r::session::RInitInfo& rInitInfo)
    initialize.addFunctions()
    
       // client event service
-      (startClientEventService)
+      (STARTUP_STEP(startClientEventService))
       
       // rpc methods
-      (rpc::initialize)
+      (STARTUP_STEP(rpc::initialize))
 
       // json-rpc listeners
-      (bind(registerRpcMethod, kConsoleInput, bufferConsoleInput))
-      (bind(registerRpcMethod, "suspend_for_restart", suspendForRestart))
-      (bind(registerRpcMethod, "ping", ping))
+      (STARTUP_STEP(bind(registerRpcMethod, kConsoleInput, bufferConsoleInput)))
+      (STARTUP_STEP(bind(registerRpcMethod, "suspend_for_restart", suspendForRestart)))
+      (STARTUP_STEP(bind(registerRpcMethod, "ping", ping)))
 
       // signal handlers
-      (registerSignalHandlers)
+      (STARTUP_STEP(registerSignalHandlers))
 
       // main module context
-      (module_context::initialize)
+      (STARTUP_STEP(module_context::initialize))
 
       // projects (early project init required -- module inits below
       // can then depend on e.g. computed defaultEncoding)
-      (projects::initialize)
+      (STARTUP_STEP(projects::initialize))
 
       // source database
-      (source_database::initialize)
+      (STARTUP_STEP(source_database::initialize))
 
       // content urls
-      (content_urls::initialize)
+      (STARTUP_STEP(content_urls::initialize))
 
       // overlay R
-      (bind(sourceModuleRFile, "SessionOverlay.R"))
+      (STARTUP_STEP(bind(sourceModuleRFile, "SessionOverlay.R")))
    
       // addins
-      (addins::initialize)
+      (STARTUP_STEP(addins::initialize))
 
       // console processes
-      (console_process::initialize)
+      (STARTUP_STEP(console_process::initialize))
          
       // r utils
-      (r_utils::initialize)
+      (STARTUP_STEP(r_utils::initialize))
+
+      // low memory monitoring
+      (STARTUP_STEP(suspend::initialize))
+   ;
+
+   ExecBlock initializeModules;
+   initializeModules.addFunctions()
 
       // modules with c++ implementations
-      (modules::spelling::initialize)
-      (modules::lists::initialize)
-      (modules::path::initialize)
-      (modules::limits::initialize)
-      (modules::ppe::initialize)
-      (modules::ask_pass::initialize)
-      (modules::agreement::initialize)
-      (modules::console::initialize)
+      (STARTUP_STEP(modules::spelling::initialize))
+      (STARTUP_STEP(modules::lists::initialize))
+      (STARTUP_STEP(modules::path::initialize))
+      (STARTUP_STEP(modules::limits::initialize))
+      (STARTUP_STEP(modules::memory::initialize))
+      (STARTUP_STEP(modules::ppe::initialize))
+      (STARTUP_STEP(modules::ask_pass::initialize))
+      (STARTUP_STEP(modules::agreement::initialize))
+      (STARTUP_STEP(modules::console::initialize))
 #ifdef RSTUDIO_SERVER
-      (modules::crypto::initialize)
+      (STARTUP_STEP(modules::crypto::initialize))
 #endif
-      (modules::code_search::initialize)
-      (modules::clang::initialize)
-      (modules::connections::initialize)
-      (modules::files::initialize)
-      (modules::find::initialize)
-      (modules::environment::initialize)
-      (modules::dependencies::initialize)
-      (modules::dirty::initialize)
-      (modules::workbench::initialize)
-      (modules::data::initialize)
-      (modules::help::initialize)
-      (modules::presentation::initialize)
-      (modules::preview::initialize)
-      (modules::plots::initialize)
-      (modules::packages::initialize)
-      (modules::profiler::initialize)
-      (modules::viewer::initialize)
-      (modules::rmarkdown::initialize)
-      (modules::rmarkdown::notebook::initialize)
-      (modules::rmarkdown::templates::initialize)
-      (modules::rpubs::initialize)
-      (modules::shiny::initialize)
-      (modules::plumber::initialize)
-      (modules::source::initialize)
-      (modules::source_control::initialize)
-      (modules::authoring::initialize)
-      (modules::html_preview::initialize)
-      (modules::history::initialize)
-      (modules::build::initialize)
-      (modules::overlay::initialize)
-      (modules::breakpoints::initialize)
-      (modules::errors::initialize)
-      (modules::updates::initialize)
-      (modules::about::initialize)
-      (modules::shiny_viewer::initialize)
-      (modules::plumber_viewer::initialize)
-      (modules::rsconnect::initialize)
-      (modules::packrat::initialize)
-      (modules::rhooks::initialize)
-      (modules::r_packages::initialize)
-      (modules::diagnostics::initialize)
-      (modules::markers::initialize)
-      (modules::snippets::initialize)
-      (modules::user_commands::initialize)
-      (modules::r_addins::initialize)
-      (modules::projects::templates::initialize)
-      (modules::mathjax::initialize)
-      (modules::rstudioapi::initialize)
-      (modules::libpaths::initialize)
-      (modules::explorer::initialize)
-      (modules::ask_secret::initialize)
-      (modules::reticulate::initialize)
-      (modules::tests::initialize)
-      (modules::jobs::initialize)
-      (modules::themes::initialize)
+      (STARTUP_STEP(modules::code_search::initialize))
+      (STARTUP_STEP(modules::clang::initialize))
+      (STARTUP_STEP(modules::connections::initialize))
+      (STARTUP_STEP(modules::files::initialize))
+      (STARTUP_STEP(modules::find::initialize))
+      (STARTUP_STEP(modules::environment::initialize))
+      (STARTUP_STEP(modules::dependencies::initialize))
+      (STARTUP_STEP(modules::dirty::initialize))
+      (STARTUP_STEP(modules::workbench::initialize))
+      (STARTUP_STEP(modules::data::initialize))
+      (STARTUP_STEP(modules::help::initialize))
+      (STARTUP_STEP(modules::presentation::initialize))
+      (STARTUP_STEP(modules::preview::initialize))
+      (STARTUP_STEP(modules::plots::initialize))
+      (STARTUP_STEP(modules::packages::initialize))
+      (STARTUP_STEP(modules::profiler::initialize))
+      (STARTUP_STEP(modules::viewer::initialize))
+      (STARTUP_STEP(modules::rmarkdown::initialize))
+      (STARTUP_STEP(modules::rmarkdown::notebook::initialize))
+      (STARTUP_STEP(modules::rmarkdown::templates::initialize))
+      (STARTUP_STEP(modules::rpubs::initialize))
+      (STARTUP_STEP(modules::shiny::initialize))
+      (STARTUP_STEP(modules::plumber::initialize))
+      (STARTUP_STEP(modules::source::initialize))
+      (STARTUP_STEP(modules::source_control::initialize))
+      (STARTUP_STEP(modules::authoring::initialize))
+      (STARTUP_STEP(modules::html_preview::initialize))
+      (STARTUP_STEP(modules::history::initialize))
+      (STARTUP_STEP(modules::build::initialize))
+      (STARTUP_STEP(modules::overlay::initialize))
+      (STARTUP_STEP(modules::breakpoints::initialize))
+      (STARTUP_STEP(modules::errors::initialize))
+      (STARTUP_STEP(modules::updates::initialize))
+      (STARTUP_STEP(modules::about::initialize))
+      (STARTUP_STEP(modules::shiny_viewer::initialize))
+      (STARTUP_STEP(modules::plumber_viewer::initialize))
+      (STARTUP_STEP(modules::rsconnect::initialize))
+      (STARTUP_STEP(modules::packrat::initialize))
+      (STARTUP_STEP(modules::rhooks::initialize))
+      (STARTUP_STEP(modules::r_packages::initialize))
+      (STARTUP_STEP(modules::diagnostics::initialize))
+      (STARTUP_STEP(modules::markers::initialize))
+      (STARTUP_STEP(modules::snippets::initialize))
+      (STARTUP_STEP(modules::user_commands::initialize))
+      (STARTUP_STEP(modules::r_addins::initialize))
+      (STARTUP_STEP(modules::projects::templates::initialize))
+      (STARTUP_STEP(modules::mathjax::initialize))
+      (STARTUP_STEP(modules::rstudioapi::initialize))
+      (STARTUP_STEP(modules::libpaths::initialize))
+      (STARTUP_STEP(modules::explorer::initialize))
+      (STARTUP_STEP(modules::ask_secret::initialize))
+      (STARTUP_STEP(modules::reticulate::initialize))
+      (STARTUP_STEP(modules::tests::initialize))
+      (STARTUP_STEP(modules::jobs::initialize))
+      (STARTUP_STEP(modules::themes::initialize))
 
       // workers
-      (workers::web_request::initialize)
+      (STARTUP_STEP(workers::web_request::initialize))
 
       // R code
-      (bind(sourceModuleRFile, "SessionCodeTools.R"))
-      (bind(sourceModuleRFile, "SessionCompletionHooks.R"))
-      (bind(sourceModuleRFile, "SessionPatches.R"))
+      (STARTUP_STEP(bind(sourceModuleRFile, "SessionCodeTools.R")))
+      (STARTUP_STEP(bind(sourceModuleRFile, "SessionCompletionHooks.R")))
+      (STARTUP_STEP(bind(sourceModuleRFile, "SessionPatches.R")))
    
       // unsupported functions
-      (bind(rstudio::r::function_hook::registerUnsupported, "bug.report", "utils"))
-      (bind(rstudio::r::function_hook::registerUnsupported, "help.request", "utils"))
+      (STARTUP_STEP(bind(rstudio::r::function_hook::registerUnsupported, "bug.report", "utils")))
+      (STARTUP_STEP(bind(rstudio::r::function_hook::registerUnsupported, "help.request", "utils")))
    ;
 
-   Error error = initialize.execute();
+   // file reads which don't touch R overlap the (serialized) R-touching
+   // initialization; modules which consume them wait for them to finish
+   InitGraph initGraph;
+   initGraph
+      .addBackground("load addin registry", modules::r_addins::loadAddinRegistry)
+      .addMain("initialize core", initialize)
+      .addMain("initialize modules", initializeModules,
+               std::vector<std::string>(1, "load addin registry"));
+
+   Error error = initGraph.execute();
    if (error)
       return error;
    
@@ -652,13 +695,60 @@ void notifyIfRVersionChanged()
    }
 }
 
+// startup is complete once the session init hook has run; write out the
+// startup trace (if one was requested) and summarize it
+void finishStartupTrace()
+{
+   using namespace core::startup_trace;
+   if (!enabled())
+      return;
+
+   std::vector<Step> steps = finish();
+
+   FilePath traceFile = rsession::options().startupTraceFile();
+   Error error = writeChromeTrace(steps, traceFile);
+   if (error)
+      LOG_ERROR(error);
+
+   // tracing is opt-in, so log the summary at a level that's shown by default
+   LOG_WARNING_MESSAGE("Startup trace written to " + traceFile.absolutePath() +
+                       "\n" + summary(steps, 10));
+
+   // report the time spent in each category of step
+   std::map<std::string, double> categoryMs;
+   BOOST_FOREACH(const Step& step, steps)
+   {
+      categoryMs[step.category] += step.wall.total_microseconds() / 1000.0;
+   }
+
+   std::vector<monitor::metrics::MetricData> data;
+   typedef std::pair<const std::string, double> CategoryTime;
+   BOOST_FOREACH(const CategoryTime& time, categoryMs)
+   {
+      data.push_back(monitor::metrics::MetricData(time.first + "_ms", time.second));
+   }
+
+   std::vector<monitor::metrics::MultiMetric> metrics;
+   metrics.push_back(monitor::metrics::MultiMetric(
+                        "rsession.startup",
+                        rsession::options().monitorIntervalSeconds(),
+                        data));
+   monitor::client().sendMultiMetrics(metrics);
+}
+
 void rSessionInitHook(bool newSession)
 {
    // allow any packages listening to complete initialization
-   modules::rhooks::invokeHook(kSessionInitHook, newSession);
+   {
+      core::startup_trace::Scope scope(kSessionInitHook, "deferred");
+      modules::rhooks::invokeHook(kSessionInitHook, newSession);
+   }
 
    // finish off initialization
-   module_context::events().afterSessionInitHook(newSession);
+   {
+      core::startup_trace::Scope scope("afterSessionInitHook", "deferred");
+      module_context::events().afterSessionInitHook(newSession);
+   }
    
    // notify the user if the R version has changed
    notifyIfRVersionChanged();
@@ -666,11 +756,16 @@ void rSessionInitHook(bool newSession)
    // fire an event to the client
    ClientEvent event(client_events::kDeferredInitCompleted);
    module_context::enqueClientEvent(event);
+
+   finishStartupTrace();
 }
 
 void rDeferredInit(bool newSession)
 {
-   module_context::events().onDeferredInit(newSession);
+   {
+      core::startup_trace::Scope scope("onDeferredInit", "deferred");
+      module_context::events().onDeferredInit(newSession);
+   }
    
    // schedule execution of the session init hook
    module_context::scheduleDelayedWork(
@@ -973,6 +1068,12 @@ void rSuspended(const rstudio::r::session::RSuspendOptions& options)
 
    // fire event
    module_context::onSuspended(options, &(persistentState().settings()));
+
+   // write any settings changes which are still pending
+   core::Settings::flushAll();
+
+   // write caches kept on local disk back to the scratch path
+   local_scratch::writeBack();
 }
    
 void rResumed()
@@ -1106,6 +1207,12 @@ void rCleanup(bool terminatedNormally)
          // fire destroy event to modules
          module_context::events().onDestroyed();
       }
+
+      // write any settings changes which are still pending
+      core::Settings::flushAll();
+
+      // write caches kept on local disk back to the scratch path
+      local_scratch::writeBack();
       
       // clean up locks
       FileLock::cleanUp();
@@ -1583,6 +1690,17 @@ int main (int argc, char * const argv[])
       // reflect stderr logging
       core::system::setLogToStderr(options.logStderr());
 
+      // start tracing startup if requested
+      if (!options.startupTraceFile().empty())
+         core::startup_trace::enable();
+
+      // trace requests if requested
+      error = core::trace::initialize(options.programIdentity(),
+                                      options.traceSampleRate(),
+                                      options.traceDir());
+      if (error)
+         LOG_ERROR(error);
+
       // initialize monitor
       monitor::initializeMonitorClient(kMonitorSocketPath,
                                        options.monitorSharedSecret());
@@ -1601,6 +1719,13 @@ int main (int argc, char * const argv[])
       bool desktopMode = options.programMode() == kSessionProgramModeDesktop;
       bool serverMode = options.programMode() == kSessionProgramModeServer;
 
+      // desktop sessions are reached only over the loopback interface (or a
+      // local pipe), where compressing responses (e.g. large data grid pages
+      // and console output) costs more time than it saves
+      if (desktopMode)
+         http::setCompressionEnabled(false);
+      http::setCompressionLevel(options.wwwCompressionLevel());
+
       // re-initialize log for desktop mode
       if (desktopMode)
       {
@@ -1681,17 +1806,33 @@ int main (int argc, char * const argv[])
 #endif
 
       // start the file monitor
+      core::system::file_monitor::setMaxWatches(
+                                 options.fileMonitorMaxWatches());
+      core::system::file_monitor::setPollInterval(
+               boost::posix_time::seconds(options.fileMonitorPollSeconds()));
+      core::system::file_monitor::setUseFanotify(
+                                 options.fileMonitorFanotify());
       core::system::file_monitor::initialize();
 
       // initialize client event queue. this must be done very early
       // in main so that any other code which needs to enque an event
       // has access to the queue
       rsession::initializeClientEventQueue();
+      rsession::clientEventQueue().setConsoleOutputRateLimit(
+            std::max(options.limitConsoleOutputKb(), 0) * 1024);
 
       // detect parent termination
       if (desktopMode)
          core::thread::safeLaunchThread(detectParentTermination);
 
+      // report request metrics to the monitor
+      if (serverMode)
+      {
+         error = session::request_metrics::initialize();
+         if (error)
+            LOG_ERROR(error);
+      }
+
       // set the rpostback absolute path
       FilePath rpostback = options.rpostbackPath()
                            .parent().parent()
@@ -1783,6 +1924,11 @@ int main (int argc, char * const argv[])
       if (error)
          return sessionExitFailure(error, ERROR_LOCATION);
 
+      // let the desktop know it can load the session (rather than it having
+      // to poll for the listener)
+      if (desktopMode && !options.verifyInstallation())
+         std::cout << kRStudioSessionReady << std::endl;
+
       // run optional preflight script -- needs to be after the http listeners
       // so the proxy server sees that we have startup up
       error = runPreflightScript();
@@ -1917,6 +2063,7 @@ int main (int argc, char * const argv[])
       rCallbacks.serialization = rSerialization;
 
       // run r (does not return, terminates process using exit)
+      s_rStartTime = core::startup_trace::now();
       error = rstudio::r::session::run(rOptions, rCallbacks) ;
       if (error)
       {
@@ -67,6 +67,7 @@
 #include <session/SessionClientEventService.hpp>
 
 #include <session/http/SessionRequest.hpp>
+#include <session/SessionHttpConnectionListener.hpp>
 
 #include "SessionClientEventQueue.hpp"
 
@@ -693,78 +694,73 @@ void onResumed(const Settings& persistentState)
 
 namespace {
 
-typedef std::vector<boost::shared_ptr<ScheduledCommand> >
-                                                      ScheduledCommands;
-ScheduledCommands s_scheduledCommands;
-ScheduledCommands s_idleScheduledCommands;
+// the time scheduled work may take from each period of background processing
+// (all scheduled work together, so that many indexers running at once don't
+// take more from the session's responsiveness than one would)
+const boost::posix_time::time_duration kScheduledWorkBudget =
+                                          boost::posix_time::milliseconds(30);
 
-void addScheduledCommand(boost::shared_ptr<ScheduledCommand> pCommand,
-                         bool idleOnly)
+WorkScheduler s_workScheduler;
+
+bool isClientInputPending()
 {
-   if (idleOnly)
-      s_idleScheduledCommands.push_back(pCommand);
-   else
-      s_scheduledCommands.push_back(pCommand);
+   return !httpConnectionListener().mainConnectionQueue()
+                                             .peekNextConnectionUri().empty();
 }
 
-void executeScheduledCommands(ScheduledCommands* pCommands)
+bool alwaysPending()
 {
-   // make a copy of scheduled commands before executing them
-   // (this is because a scheduled command could result in
-   // R code executing which in turn could cause the list of
-   // scheduled commands to be mutated and these iterators
-   // invalidated)
-   ScheduledCommands commands = *pCommands;
-
-   // execute all commands
-   std::for_each(commands.begin(),
-                 commands.end(),
-                 boost::bind(&ScheduledCommand::execute, _1));
-
-   // remove any commands which are finished
-   pCommands->erase(
-                 std::remove_if(
-                    pCommands->begin(),
-                    pCommands->end(),
-                    boost::bind(&ScheduledCommand::finished, _1)),
-                 pCommands->end());
+   return true;
 }
 
-
 } // anonymous namespace
 
 void scheduleIncrementalWork(
          const boost::posix_time::time_duration& incrementalDuration,
          const boost::function<bool()>& execute,
-         bool idleOnly)
-{
-   addScheduledCommand(boost::shared_ptr<ScheduledCommand>(
-                           new IncrementalCommand(incrementalDuration,
-                                                  execute)),
-                         idleOnly);
+         bool idleOnly,
+         WorkPriority priority,
+         const std::string& name)
+{
+   s_workScheduler.add(boost::shared_ptr<ScheduledCommand>(
+                          new IncrementalCommand(incrementalDuration,
+                                                 execute)),
+                       name,
+                       priority,
+                       idleOnly);
 }
 
 void scheduleIncrementalWork(
          const boost::posix_time::time_duration& initialDuration,
          const boost::posix_time::time_duration& incrementalDuration,
          const boost::function<bool()>& execute,
-         bool idleOnly)
-{
-   addScheduledCommand(boost::shared_ptr<ScheduledCommand>(
-                           new IncrementalCommand(initialDuration,
-                                                  incrementalDuration,
-                                                  execute)),
-                           idleOnly);
+         bool idleOnly,
+         WorkPriority priority,
+         const std::string& name)
+{
+   s_workScheduler.add(boost::shared_ptr<ScheduledCommand>(
+                          new IncrementalCommand(initialDuration,
+                                                 incrementalDuration,
+                                                 execute)),
+                       name,
+                       priority,
+                       idleOnly);
 }
 
+std::map<std::string, WorkScheduler::TaskStats> collectScheduledWorkStats()
+{
+   return s_workScheduler.collectStats();
+}
 
 void schedulePeriodicWork(const boost::posix_time::time_duration& period,
                           const boost::function<bool()> &execute,
                           bool idleOnly,
                           bool immediate)
 {
-   addScheduledCommand(boost::shared_ptr<ScheduledCommand>(
-                           new PeriodicCommand(period, execute, immediate)),
+   s_workScheduler.add(boost::shared_ptr<ScheduledCommand>(
+                          new PeriodicCommand(period, execute, immediate)),
+                       "periodic",
+                       WorkPriorityNormal,
                        idleOnly);
 }
 
@@ -845,7 +841,7 @@ void scheduleDelayedWork(const boost::posix_time::time_duration& period,
 }
 
 
-void onBackgroundProcessing(bool isIdle)
+void onBackgroundProcessing(bool isIdle, bool inputPending)
 {
    // allow process supervisor to poll for events
    processSupervisor().poll();
@@ -856,10 +852,16 @@ void onBackgroundProcessing(bool isIdle)
    // fire event
    events().onBackgroundProcessing(isIdle);
 
-   // execute incremental commands
-   executeScheduledCommands(&s_scheduledCommands);
-   if (isIdle)
-      executeScheduledCommands(&s_idleScheduledCommands);
+   // execute scheduled commands, yielding to the client when it's waiting
+   // on a request. (while R is busy connections are handled between
+   // periods of background processing, and some are deliberately left
+   // queued, so only the caller's word is taken for pending input)
+   boost::function<bool()> interrupt;
+   if (inputPending)
+      interrupt = alwaysPending;
+   else if (isIdle)
+      interrupt = isClientInputPending;
+   s_workScheduler.execute(kScheduledWorkBudget, isIdle, interrupt);
 }
 
 
@@ -1769,6 +1771,30 @@ SEXP rs_isRScriptInPackageBuildTarget(SEXP filePathSEXP)
    return r::sexp::create(isRScriptInPackageBuildTarget(filePath), &protect);
 }
 
+bool isIgnoredProjectDirectory(const core::FilePath& dirPath,
+                               const std::string& websiteOutputDir)
+{
+   std::string name = dirPath.filename();
+
+   // node_modules
+   if (name == "node_modules")
+      return true;
+
+   // websites
+   if (name == websiteOutputDir)
+      return true;
+
+   // packrat
+   if (name == "packrat" && dirPath.childPath("packrat.lock").exists())
+      return true;
+
+   // cmake build directory
+   if (dirPath.childPath("cmake_install.cmake").exists())
+      return true;
+
+   return false;
+}
+
 bool fileListingFilter(const core::FileInfo& fileInfo)
 {
    // check extension for special file types which are always visible
@@ -1933,6 +1959,11 @@ void consoleWriteError(const std::string& message)
                                     message);
 }
 
+std::string suppressedConsoleOutput()
+{
+   return session::clientEventQueue().suppressedConsoleOutput();
+}
+
 void showErrorMessage(const std::string& title, const std::string& message)
 {
    session::clientEventQueue().add(showErrorMessageEvent(title, message));
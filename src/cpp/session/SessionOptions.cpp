@@ -31,6 +31,8 @@
 #include <core/Error.hpp>
 #include <core/Log.hpp>
 
+#include <core/http/ContentEncoding.hpp>
+
 #include <core/r_util/RProjectFile.hpp>
 #include <core/r_util/RUserData.hpp>
 #include <core/r_util/RSessionContext.hpp>
@@ -144,7 +146,10 @@ core::ProgramStatus Options::read(int argc, char * const argv[], std::ostream& o
    log.add_options()
       ("log-stderr",
       value<bool>(&logStderr_)->default_value(false),
-      "write log entries to stderr");
+      "write log entries to stderr")
+      ("startup-trace-file",
+      value<std::string>(&startupTraceFile_)->default_value(""),
+      "write a timeline of session startup (in Chrome trace format) to this file");
 
    // agreement
    options_description agreement("agreement");
@@ -176,12 +181,19 @@ core::ProgramStatus Options::read(int argc, char * const argv[], std::ostream& o
       (kWwwAddressSessionOption,
          value<std::string>(&wwwAddress_)->default_value("127.0.0.1"),
          "address to listen on")
+      (kWwwCompressionLevelSessionOption,
+         value<int>(&wwwCompressionLevel_)->default_value(
+                                          http::kDefaultCompressionLevel),
+         "compression level for responses (1-9)")
       (kStandaloneSessionOption,
          value<bool>(&standalone_)->default_value(false),
          "run standalone")
       (kVerifySignaturesSessionOption,
          value<bool>(&verifySignatures_)->default_value(false),
-         "verify signatures on incoming requests");
+         "verify signatures on incoming requests")
+      (kMonitorIntervalSeconds,
+         value<int>(&monitorIntervalSeconds_)->default_value(300),
+         "interval at which metrics are reported to the monitor");
 
    // session options
    std::string saveActionDefault;
@@ -196,6 +208,18 @@ core::ProgramStatus Options::read(int argc, char * const argv[], std::ostream& o
       (kDisconnectedTimeoutSessionOption,
          value<int>(&disconnectedTimeoutMinutes_)->default_value(0),
          "session disconnected timeout (minutes)" )
+      (kLowMemorySessionOption,
+         value<int>(&lowMemoryMb_)->default_value(0),
+         "available system memory (mb) below which cached data is released")
+      (kTraceSampleRateSessionOption,
+         value<double>(&traceSampleRate_)->default_value(0),
+         "fraction of requests traced (0 to disable)")
+      (kTraceDirSessionOption,
+         value<std::string>(&traceDir_)->default_value(""),
+         "directory to which traces are exported (as OTLP/JSON)")
+      (kLocalScratchDirSessionOption,
+         value<std::string>(&localScratchDir_)->default_value(""),
+         "local directory for session caches (when home directories are on network storage)")
       ("session-preflight-script",
          value<std::string>(&preflightScript_)->default_value(""),
          "session preflight script")
@@ -220,6 +244,12 @@ core::ProgramStatus Options::read(int argc, char * const argv[], std::ostream& o
       ("show-help-home",
        value<bool>(&showHelpHome_)->default_value(false),
          "show help home page at startup")
+      ("help-cache-dir",
+       value<std::string>(&helpCacheDir_)->default_value(""),
+         "site-level directory in which rendered help pages are shared")
+      ("help-prerender",
+       value<bool>(&helpPrerender_)->default_value(false),
+         "render the help of installed packages into the help cache when idle")
       ("session-default-console-term",
        value<std::string>(&defaultConsoleTerm_)->default_value("xterm-256color"),
        "default TERM setting for R console")
@@ -229,6 +259,27 @@ core::ProgramStatus Options::read(int argc, char * const argv[], std::ostream& o
       ("session-quit-child-processes-on-exit",
        value<bool>(&quitChildProcessesOnExit_)->default_value(false),
        "quit child processes on session exit")
+      ("session-find-threads",
+       value<int>(&findThreads_)->default_value(0),
+       "threads used to search files for find in files (0 to use one per core)")
+      ("session-max-concurrent-jobs",
+       value<int>(&maxConcurrentJobs_)->default_value(0),
+       "script jobs run at once; others are queued (0 to use one per core)")
+      ("session-find-external-grep",
+       value<bool>(&findExternalGrep_)->default_value(false),
+       "use an external grep process for find in files")
+      ("session-file-monitor-max-watches",
+       value<int>(&fileMonitorMaxWatches_)->default_value(0),
+       "directories watched per file monitor (0 for no limit, others are polled)")
+      ("session-file-monitor-poll-seconds",
+       value<int>(&fileMonitorPollSeconds_)->default_value(5),
+       "seconds between polls of directories which aren't watched")
+      ("session-file-monitor-fanotify",
+       value<bool>(&fileMonitorFanotify_)->default_value(true),
+       "use fanotify to monitor projects where supported")
+      ("session-package-symbol-cache-dir",
+       value<std::string>(&packageSymbolCacheDir_)->default_value(""),
+       "directory of package symbols shared (read only) by sessions")
       ("session-first-project-template-path",
        value<std::string>(&firstProjectTemplatePath_)->default_value(""),
        "first project template path")
@@ -244,6 +295,9 @@ core::ProgramStatus Options::read(int argc, char * const argv[], std::ostream& o
       (kWebSocketConnectTimeout,
        value<int>(&webSocketConnectTimeout_)->default_value(3),
        "WebSocket initial connection timeout (seconds)")
+      (kWebSocketClientEvents,
+       value<bool>(&webSocketClientEvents_)->default_value(false),
+       "push client events over a WebSocket rather than long polling")
       (kPackageOutputInPackageFolder,
          value<bool>(&packageOutputToPackageFolder_)->default_value(false),
          "devtools check and devtools build output to package project folder");
@@ -354,7 +408,13 @@ core::ProgramStatus Options::read(int argc, char * const argv[], std::ostream& o
        "limit on time of top level computations")
       ("limit-xfs-disk-quota",
        value<bool>(&limitXfsDiskQuota_)->default_value(false),
-       "limit xfs disk quota");
+       "limit xfs disk quota")
+      ("limit-cache-memory",
+       value<std::string>(&limitCacheMemory_)->default_value(""),
+       "byte budgets for session caches (e.g. data-viewer=256M,clang=1G)")
+      ("limit-console-output-kb",
+       value<int>(&limitConsoleOutputKb_)->default_value(256),
+       "console output sent per second before the rest is suppressed (0 for no limit)");
    
    // external options
    options_description external("external");
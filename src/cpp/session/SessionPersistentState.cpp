@@ -32,6 +32,11 @@ namespace session {
 namespace {
 const char * const kActiveClientId = "active-client-id";
 const char * const kAbend = "abend";
+
+// changes are written shortly after they are made (so that several changes
+// in a row are written together)
+const boost::posix_time::time_duration kWriteDelay =
+                                    boost::posix_time::milliseconds(500);
 }
    
 PersistentState& persistentState()
@@ -55,11 +60,17 @@ Error PersistentState::initialize()
    Error error = settings_.initialize(statePath);
    if (error)
       return error;
+   settings_.setWriteDelay(kWriteDelay);
 
    // session settings
    scratchPath = module_context::sessionScratchPath();
    statePath = scratchPath.complete("session-persistent-state");
-   return sessionSettings_.initialize(statePath);
+   error = sessionSettings_.initialize(statePath);
+   if (error)
+      return error;
+   sessionSettings_.setWriteDelay(kWriteDelay);
+
+   return Success();
 }
 
 std::string PersistentState::activeClientId()
@@ -110,7 +121,9 @@ void PersistentState::setAbend(bool abend)
 { 
    if (serverMode_)
    {
+      // (written immediately since we may be about to crash or exit)
       sessionSettings_.set(kAbend, abend);
+      sessionSettings_.flush();
    }
 }
 
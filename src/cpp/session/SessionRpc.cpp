@@ -13,8 +13,12 @@
  *
  */
 
+#include <deque>
+#include <set>
 #include <string>
 
+#include <boost/noncopyable.hpp>
+
 #include "SessionRpc.hpp"
 #include "SessionHttpMethods.hpp"
 #include "SessionClientEventQueue.hpp"
@@ -23,6 +27,8 @@
 #include <core/json/JsonRpc.hpp>
 #include <core/Exec.hpp>
 #include <core/Log.hpp>
+#include <core/Thread.hpp>
+#include <core/Trace.hpp>
 
 #include <r/RExec.hpp>
 #include <r/RSexp.hpp>
@@ -38,7 +44,74 @@ namespace {
 
 // json rpc methods
 core::json::JsonRpcAsyncMethods* s_pJsonRpcMethods = NULL;
-   
+
+// methods whose handlers run on the worker pool (they're also in the map
+// above so they can still be invoked synchronously, e.g. by rs_invokeRpc)
+std::set<std::string>* s_pWorkerSafeMethods = NULL;
+
+// number of threads serving worker-safe methods
+const std::size_t kRpcWorkerThreads = 4;
+
+// fixed size pool of threads which run queued tasks in order; the threads
+// are started when the first task is posted
+class RpcWorkerPool : boost::noncopyable
+{
+public:
+   RpcWorkerPool() : started_(false) {}
+
+   void post(const boost::function<void()>& task)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         if (!started_)
+         {
+            for (std::size_t i = 0; i < kRpcWorkerThreads; i++)
+               core::thread::safeLaunchThread(
+                                 boost::bind(&RpcWorkerPool::run, this));
+            started_ = true;
+         }
+         tasks_.push_back(task);
+      }
+      END_LOCK_MUTEX
+
+      condition_.notify_one();
+   }
+
+private:
+   void run()
+   {
+      try
+      {
+         while (true)
+         {
+            boost::function<void()> task;
+            {
+               boost::unique_lock<boost::mutex> lock(mutex_);
+               while (tasks_.empty())
+                  condition_.wait(lock);
+               task = tasks_.front();
+               tasks_.pop_front();
+            }
+
+            try
+            {
+               task();
+            }
+            CATCH_UNEXPECTED_EXCEPTION
+         }
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+private:
+   boost::mutex mutex_;
+   boost::condition condition_;
+   std::deque<boost::function<void()> > tasks_;
+   bool started_;
+};
+
+RpcWorkerPool* s_pRpcWorkerPool = NULL;
+
 void endHandleRpcRequestDirect(boost::shared_ptr<HttpConnection> ptrConnection,
                          boost::posix_time::ptime executeStartTime,
                          const core::Error& executeError,
@@ -82,6 +155,53 @@ void endHandleRpcRequestDirect(boost::shared_ptr<HttpConnection> ptrConnection,
    }
 }
 
+void endHandleRpcRequestWorker(boost::shared_ptr<HttpConnection> ptrConnection,
+                               boost::posix_time::ptime executeStartTime,
+                               const core::Error& executeError,
+                               json::JsonRpcResponse* pJsonRpcResponse)
+{
+   // change detection belongs to the main thread (and worker-safe methods
+   // can't have changed anything it looks at)
+   BOOST_ASSERT(!pJsonRpcResponse->hasAfterResponse());
+   pJsonRpcResponse->setSuppressDetectChanges(true);
+
+   endHandleRpcRequestDirect(ptrConnection,
+                             executeStartTime,
+                             executeError,
+                             pJsonRpcResponse);
+}
+
+// run a worker-safe method on a worker thread. if the method throws then
+// an error is returned (the method won't have called its continuation so
+// otherwise the client would never get a response)
+void invokeWorkerSafeMethod(const json::JsonRpcAsyncFunction& handlerFunction,
+                            const json::JsonRpcRequest& request,
+                            const json::JsonRpcFunctionContinuation& continuation)
+{
+   std::string what;
+   try
+   {
+      handlerFunction(request, continuation);
+      return;
+   }
+   catch(const std::exception& e)
+   {
+      what = e.what();
+   }
+   catch(...)
+   {
+      what = "unknown exception";
+   }
+
+   Error error(json::errc::ExecutionError, ERROR_LOCATION);
+   error.addProperty("method", request.method);
+   error.addProperty("what", what);
+   LOG_ERROR(error);
+
+   json::JsonRpcResponse response;
+   continuation(error, &response);
+}
+
 void endHandleRpcRequestIndirect(
       const std::string& asyncHandle,
       const core::Error& executeError,
@@ -260,6 +380,16 @@ void handleRpcRequest(const core::json::JsonRpcRequest& request,
    // (so we can determine if any events were added during execution)
    using namespace boost::posix_time; 
    ptime executeStartTime = microsec_clock::universal_time();
+
+   // trace the method (beneath the proxied request when it was traced).
+   // methods which complete asynchronously are traced until they return
+   core::trace::ScopedSpan span(
+            "rpc",
+            core::trace::parseTraceparent(ptrConnection->request().headerValue(
+                                       core::trace::kTraceparentHeader)),
+            core::trace::SpanKindServer);
+   if (span.recording())
+      span.setName("rpc " + request.method);
    
    // execute the method
    auto it = s_pJsonRpcMethods->find(request.method);
@@ -268,7 +398,21 @@ void handleRpcRequest(const core::json::JsonRpcRequest& request,
       std::pair<bool, json::JsonRpcAsyncFunction> reg = it->second;
       json::JsonRpcAsyncFunction handlerFunction = reg.second;
 
-      if (reg.first)
+      if (reg.first && s_pWorkerSafeMethods->count(request.method))
+      {
+         // direct return from the worker pool
+         json::JsonRpcFunctionContinuation continuation =
+               boost::bind(endHandleRpcRequestWorker,
+                           ptrConnection,
+                           executeStartTime,
+                           _1,
+                           _2);
+         s_pRpcWorkerPool->post(boost::bind(invokeWorkerSafeMethod,
+                                            handlerFunction,
+                                            request,
+                                            continuation));
+      }
+      else if (reg.first)
       {
          // direct return
          handlerFunction(request,
@@ -307,6 +451,17 @@ void handleRpcRequest(const core::json::JsonRpcRequest& request,
    }
 }
 
+Error registerWorkerSafeRpcMethod(const std::string& name,
+                                  const core::json::JsonRpcFunction& function)
+{
+   Error error = module_context::registerRpcMethod(name, function);
+   if (error)
+      return error;
+
+   s_pWorkerSafeMethods->insert(name);
+   return Success();
+}
+
 Error initialize()
 {
    // intentionally allocate methods on the heap and let them leak
@@ -315,6 +470,8 @@ Error initialize()
    // this map pegging the processor at 100%; avoid this by allowing
    // the OS to clean up memory itself after the process is gone)
    s_pJsonRpcMethods = new core::json::JsonRpcAsyncMethods;
+   s_pWorkerSafeMethods = new std::set<std::string>;
+   s_pRpcWorkerPool = new RpcWorkerPool;
 
    r::routines::registerCallMethod(
             "rs_invokeRpc",
@@ -37,6 +37,12 @@ void handleRpcRequest(const core::json::JsonRpcRequest& request,
                       boost::shared_ptr<HttpConnection> ptrConnection,
                       http_methods::ConnectionType connectionType);
 
+// register a method whose handler is run on the rpc worker pool rather
+// than the main thread (see worker_context::registerWorkerSafeRpcMethod)
+core::Error registerWorkerSafeRpcMethod(
+                                 const std::string& name,
+                                 const core::json::JsonRpcFunction& function);
+
 core::Error initialize();
 
 } // namespace rpc
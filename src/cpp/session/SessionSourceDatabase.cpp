@@ -15,12 +15,18 @@
 
 #include <session/SessionSourceDatabase.hpp>
 
+#include <deque>
 #include <string>
+#include <sstream>
 #include <vector>
 #include <algorithm>
 
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/utility.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/regex.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
@@ -29,10 +35,12 @@
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
 #include <core/Hash.hpp>
+#include <core/MemoryAccounting.hpp>
 #include <core/FileSerializer.hpp>
 #include <core/FileUtils.hpp>
 #include <core/RegexUtils.hpp>
 #include <core/DateTime.hpp>
+#include <core/Thread.hpp>
 
 #include <core/system/System.hpp>
 
@@ -49,6 +57,7 @@
 #include "SessionSourceDatabaseSupervisor.hpp"
 
 #define kContentsSuffix "-contents"
+#define kChangesSuffix "-changes"
 
 // NOTE: if a file is deleted then its properties database entry is not
 // deleted. this has two implications:
@@ -81,6 +90,121 @@ namespace {
 // lookup)
 std::map<std::string, std::string> s_idToPath;
 
+// the change log for a document's contents is compacted (by rewriting the
+// contents) once it reaches a quarter of the size of the contents
+const uintmax_t kMinChangesCompactSize = 64 * 1024;
+
+// Writes to the database are made (in order) by a background thread, so that
+// saving a document needn't wait on them; everything else which touches the
+// database first waits for those pending. Once stopped (at quit or suspend)
+// writes are made synchronously.
+class DatabaseWriter : boost::noncopyable
+{
+public:
+   DatabaseWriter() : writing_(false), started_(false), stopped_(false) {}
+
+   ~DatabaseWriter()
+   {
+      try
+      {
+         stop();
+      }
+      catch(...)
+      {
+      }
+   }
+
+   // COPYING: boost::noncopyable
+
+   void enqueue(const boost::function<Error()>& write)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         if (!started_ && !stopped_)
+         {
+            started_ = true;
+            core::thread::safeLaunchThread(
+                     boost::bind(&DatabaseWriter::run, this), &thread_);
+            stopped_ = !thread_.joinable();
+         }
+
+         if (!stopped_)
+         {
+            pending_.push_back(write);
+            condition_.notify_all();
+            return;
+         }
+      }
+      END_LOCK_MUTEX
+
+      Error error = write();
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   void waitForPending()
+   {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (writing_ || !pending_.empty())
+         condition_.wait(lock);
+   }
+
+   // make the writes pending then stop the thread
+   void stop()
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         stopped_ = true;
+      }
+      END_LOCK_MUTEX
+
+      condition_.notify_all();
+      if (thread_.joinable())
+         thread_.join();
+   }
+
+private:
+   void run()
+   {
+      while (true)
+      {
+         boost::function<Error()> write;
+         {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while (pending_.empty() && !stopped_)
+               condition_.wait(lock);
+            if (pending_.empty())
+               return;
+
+            write = pending_.front();
+            pending_.pop_front();
+            writing_ = true;
+         }
+
+         Error error = write();
+         if (error)
+            LOG_ERROR(error);
+
+         LOCK_MUTEX(mutex_)
+         {
+            writing_ = false;
+         }
+         END_LOCK_MUTEX
+         condition_.notify_all();
+      }
+   }
+
+   boost::mutex mutex_;
+   boost::condition_variable condition_;
+   std::deque<boost::function<Error()> > pending_;
+   bool writing_;
+   bool started_;
+   bool stopped_;
+   boost::thread thread_;
+};
+
+DatabaseWriter s_databaseWriter;
+
 struct PropertiesDatabase
 {
    FilePath path;
@@ -88,9 +212,15 @@ struct PropertiesDatabase
    std::map<std::string,std::string> index;
 };
 
-Error getPropertiesDatabase(PropertiesDatabase* pDatabase)
+FilePath propertiesDatabasePath()
+{
+   return module_context::scopedScratchPath().complete(kSessionSourceDatabasePrefix "/prop");
+}
+
+Error getPropertiesDatabase(const FilePath& databasePath,
+                            PropertiesDatabase* pDatabase)
 {
-   pDatabase->path = module_context::scopedScratchPath().complete(kSessionSourceDatabasePrefix "/prop");
+   pDatabase->path = databasePath;
    Error error = pDatabase->path.ensureDirectory();
    if (error)
       return error;
@@ -103,14 +233,17 @@ Error getPropertiesDatabase(PropertiesDatabase* pDatabase)
       return Success();
 }
 
-Error putProperties(const std::string& path, const json::Object& properties)
+// (called by the database writer)
+Error putProperties(const FilePath& databasePath,
+                    const std::string& path,
+                    const json::Object& properties)
 {
    // url escape path (so we can use key=value persistence)
    std::string escapedPath = http::util::urlEncode(path);
 
    // get properties database
    PropertiesDatabase propertiesDB;
-   Error error = getPropertiesDatabase(&propertiesDB);
+   Error error = getPropertiesDatabase(databasePath, &propertiesDB);
    if (error)
       return error;
 
@@ -146,8 +279,9 @@ Error getProperties(const std::string& path, json::Object* pProperties)
    std::string escapedPath = http::util::urlEncode(path);
 
    // get properties database
+   s_databaseWriter.waitForPending();
    PropertiesDatabase propertiesDB;
-   Error error = getPropertiesDatabase(&propertiesDB);
+   Error error = getPropertiesDatabase(propertiesDatabasePath(), &propertiesDB);
    if (error)
       return error;
 
@@ -245,6 +379,115 @@ Error attemptContentsMigration(json::Object& propertiesJson,
    return writeStringToFile(contentsPath, contents);
 }
 
+// The change log for a document records edits made since its contents were
+// last written. It starts with the hash of the contents it applies to and
+// is followed by records of the form:
+//
+//    <offset> <length> <size>\n<replacement>
+//
+// each of which replaces [offset, offset + length) bytes of the contents
+// with the size bytes of replacement that follow.
+Error applyContentsChanges(const FilePath& changesPath,
+                           std::string* pContents,
+                           bool* pComplete)
+{
+   *pComplete = true;
+
+   std::string changes;
+   Error error = readStringFromFile(changesPath, &changes);
+   if (error)
+      return error;
+
+   // ignore the log if the contents have since been rewritten
+   std::string::size_type pos = changes.find('\n');
+   if (pos == std::string::npos ||
+       changes.substr(0, pos) != hash::crc32Hash(*pContents))
+   {
+      *pComplete = false;
+      return Success();
+   }
+   ++pos;
+
+   std::string contents = *pContents;
+   while (pos < changes.size())
+   {
+      // stop at a partially written record (its change wasn't acknowledged
+      // so the client will resend the contents)
+      std::string::size_type headerEnd = changes.find('\n', pos);
+      if (headerEnd == std::string::npos)
+      {
+         *pComplete = false;
+         break;
+      }
+
+      std::istringstream header(changes.substr(pos, headerEnd - pos));
+      std::size_t offset = 0, length = 0, size = 0;
+      header >> offset >> length >> size;
+      std::string::size_type dataBegin = headerEnd + 1;
+      if (header.fail() ||
+          offset > contents.size() ||
+          length > contents.size() - offset)
+      {
+         Error error = systemError(boost::system::errc::invalid_argument,
+                                   ERROR_LOCATION);
+         error.addProperty("path", changesPath.absolutePath());
+         return error;
+      }
+
+      if (size > changes.size() - dataBegin)
+      {
+         *pComplete = false;
+         break;
+      }
+
+      contents.replace(offset, length, changes, dataBegin, size);
+      pos = dataBegin + size;
+   }
+
+   pContents->swap(contents);
+   return Success();
+}
+
+// read a document's contents from its sidecar file (applying any logged
+// changes). errors are logged since the contents are read on a best effort
+// basis (e.g. a missing sidecar just means empty contents)
+void readContents(const FilePath& propertiesPath, std::string* pContents)
+{
+   std::string contents;
+   FilePath contentsPath(propertiesPath.absolutePath() + kContentsSuffix);
+   if (contentsPath.exists())
+   {
+      Error error = readStringFromFile(contentsPath,
+                                       &contents,
+                                       options().sourceLineEnding());
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   // apply changes made since the contents were written
+   FilePath changesPath(propertiesPath.absolutePath() + kChangesSuffix);
+   if (changesPath.exists())
+   {
+      bool complete = true;
+      Error error = applyContentsChanges(changesPath, &contents, &complete);
+      if (error)
+         LOG_ERROR(error);
+
+      // if the log was unusable (e.g. a write was interrupted) then
+      // rewrite the contents so that new changes can be logged
+      if (error || !complete)
+      {
+         error = writeStringToFile(contentsPath, contents);
+         if (!error)
+            error = changesPath.remove();
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+
+   pContents->swap(contents);
+}
+
 bool isIntendedAsReadOnly(const std::string& contents,
                           std::vector<std::string>* pAlternatives)
 {
@@ -295,6 +538,7 @@ bool isIntendedAsReadOnly(const std::string& contents,
 }  // anonymous namespace
 
 SourceDocument::SourceDocument(const std::string& type)
+   : contentsPending_(false)
 {
    FilePath srcDBPath = source_database::path();
    FilePath docPath = file_utils::uniqueFilePath(srcDBPath);
@@ -334,11 +578,27 @@ bool SourceDocument::isUntitled() const
 // set contents from string
 void SourceDocument::setContents(const std::string& contents)
 {
+   contentsPending_ = false;
    contents_ = contents;
    hash_ = hash::crc32Hash(contents_);
    lastContentUpdate_ = static_cast<std::time_t>(date_time::millisecondsSinceEpoch());
 }
 
+void SourceDocument::deferContents(const std::string& hash)
+{
+   contentsPending_ = true;
+   contents_.clear();
+   hash_ = hash;
+}
+
+void SourceDocument::loadContents() const
+{
+   contentsPending_ = false;
+
+   readContents(source_database::path().complete(id_), &contents_);
+   hash_ = hash::crc32Hash(contents_);
+}
+
 // set contents from file
 Error SourceDocument::setPathAndContents(const std::string& path,
                                          bool allowSubstChars)
@@ -365,6 +625,13 @@ Error SourceDocument::setPathAndContents(const std::string& path,
    return Success();
 }
 
+void SourceDocument::setSavedPath(const std::string& path)
+{
+   path_ = path;
+   updateLastKnownWriteTime();
+   lastContentUpdate_ = lastKnownWriteTime_;
+}
+
 Error SourceDocument::contentsMatchDisk(bool *pMatches)
 {
    *pMatches = false;
@@ -379,8 +646,8 @@ Error SourceDocument::contentsMatchDisk(bool *pMatches)
       if (error)
          return error;
 
-      *pMatches = contents_.length() == contents.length() && 
-                  hash_ == hash::crc32Hash(contents);
+      // comparing directly is cheaper than hashing the contents
+      *pMatches = this->contents() == contents;
    }
 
    return Success();
@@ -390,7 +657,7 @@ Error SourceDocument::updateDirty()
 {
    if (path().empty())
    {
-      dirty_ = !contents_.empty();
+      dirty_ = !contents().empty();
    }
    else if (dirty_)
    {
@@ -537,7 +804,9 @@ void SourceDocument::writeToJson(json::Object* pDocJson, bool includeContents) c
    jsonDoc["path"] = !path().empty() ? path_ : json::Value();
    jsonDoc["project_path"] = pathToProjectPath(path_);
    jsonDoc["type"] = !type().empty() ? type_ : json::Value();
-   jsonDoc["hash"] = hash();
+   // (don't read deferred contents if we don't need them)
+   bool pending = contentsPending_ && !includeContents;
+   jsonDoc["hash"] = pending ? hash_ : hash();
    jsonDoc["contents"] = includeContents ? contents() : std::string();
    jsonDoc["dirty"] = dirty();
    jsonDoc["created"] = created();
@@ -554,7 +823,9 @@ void SourceDocument::writeToJson(json::Object* pDocJson, bool includeContents) c
          static_cast<boost::int64_t>(lastContentUpdate_));
    
    std::vector<std::string> alternatives;
-   jsonDoc["read_only"] = isIntendedAsReadOnly(contents(), &alternatives);
+   jsonDoc["read_only"] = isIntendedAsReadOnly(pending ? std::string() :
+                                                         contents(),
+                                               &alternatives);
    jsonDoc["read_only_alternatives"] = json::toJsonArray(alternatives);
 }
 
@@ -565,7 +836,11 @@ SEXP SourceDocument::toRObject(r::sexp::Protect* pProtect, bool includeContents)
    return r::sexp::create(object, pProtect);
 }
 
-Error SourceDocument::writeToFile(const FilePath& filePath, bool writeContents) const
+namespace {
+
+Error writeDocumentFiles(const FilePath& filePath,
+                         const std::string* pContents,
+                         const std::string& properties)
 {
    // NOTE: in a previous implementation, the document properties and
    // document contents were encoded together in the same file -- we
@@ -573,25 +848,69 @@ Error SourceDocument::writeToFile(const FilePath& filePath, bool writeContents)
    // compatibility), and write the contents to '<id>-contents'. this
    // allows newer versions of RStudio to remain backwards-compatible
    // with older formats for the source database
-   
+
    // write contents to file
-   if (writeContents)
+   if (pContents)
    {
       FilePath contentsPath(filePath.absolutePath() + kContentsSuffix);
-      Error error = writeStringToFile(contentsPath, contents_);
+      Error error = writeStringToFile(contentsPath, *pContents);
       if (error)
          return error;
+
+      // the contents now include any logged changes
+      error = FilePath(filePath.absolutePath() + kChangesSuffix)
+                                                         .removeIfExists();
+      if (error)
+         LOG_ERROR(error);
    }
-   
-   // get document properties as json
+
+   // write properties to file
+   return writeStringToFile(filePath, properties);
+}
+
+// (called by the database writer)
+Error writeDocument(const FilePath& filePath,
+                    bool writeContents,
+                    const std::string& contents,
+                    const std::string& properties,
+                    const FilePath& durableDatabasePath,
+                    const std::string& durablePath,
+                    const json::Object& durableProperties)
+{
+   Error error = writeDocumentFiles(filePath,
+                                    writeContents ? &contents : NULL,
+                                    properties);
+   if (error)
+      return error;
+
+   // write properties to durable storage (if there is a path)
+   if (!durablePath.empty())
+   {
+      error = putProperties(durableDatabasePath, durablePath, durableProperties);
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   return Success();
+}
+
+} // anonymous namespace
+
+std::string SourceDocument::propertiesFileContents() const
+{
    json::Object jsonProperties;
    writeToJson(&jsonProperties, false);
-   
-   // write properties to file
+
    std::ostringstream oss;
    json::writeFormatted(jsonProperties, oss);
-   Error error = writeStringToFile(filePath, oss.str());
-   return error;
+   return oss.str();
+}
+
+Error SourceDocument::writeToFile(const FilePath& filePath, bool writeContents) const
+{
+   return writeDocumentFiles(filePath,
+                             writeContents ? &contents() : NULL,
+                             propertiesFileContents());
 }
 
 void SourceDocument::editProperty(const json::Object::value_type& property)
@@ -640,22 +959,14 @@ Error get(const std::string& id, boost::shared_ptr<SourceDocument> pDoc)
    
 Error get(const std::string& id, bool includeContents, boost::shared_ptr<SourceDocument> pDoc)
 {
+   s_databaseWriter.waitForPending();
+
    FilePath propertiesPath = source_database::path().complete(id);
    
    // attempt to read file contents from sidecar file if available
    std::string contents;
    if (includeContents)
-   {
-      FilePath contentsPath(propertiesPath.absolutePath() + kContentsSuffix);
-      if (contentsPath.exists())
-      {
-         Error error = readStringFromFile(contentsPath,
-                                          &contents,
-                                          options().sourceLineEnding());
-         if (error)
-            LOG_ERROR(error);
-      }
-   }
+      readContents(propertiesPath, &contents);
    
    if (propertiesPath.exists())
    {
@@ -690,7 +1001,21 @@ Error get(const std::string& id, bool includeContents, boost::shared_ptr<SourceD
       if (!jsonDoc.count("contents"))
          jsonDoc["contents"] = std::string();
       
-      return pDoc->readFromJson(&jsonDoc);
+      error = pDoc->readFromJson(&jsonDoc);
+      if (error)
+         return error;
+
+      // if we weren't asked for the contents then read them if and when
+      // they are accessed
+      FilePath contentsPath(propertiesPath.absolutePath() + kContentsSuffix);
+      if (!includeContents && contentsPath.exists())
+      {
+         json::Value hashJson = jsonDoc["hash"];
+         pDoc->deferContents(json::isType<std::string>(hashJson) ?
+                                hashJson.get_str() : std::string());
+      }
+
+      return Success();
    }
    else
    {
@@ -714,7 +1039,8 @@ bool isSourceDocument(const FilePath& filePath)
        filename == "lock_file" ||
        filename == "suspend_file" ||
        filename == "restart_file" ||
-       boost::algorithm::ends_with(filename, kContentsSuffix))
+       boost::algorithm::ends_with(filename, kContentsSuffix) ||
+       boost::algorithm::ends_with(filename, kChangesSuffix))
    {
       return false;
    }
@@ -741,7 +1067,8 @@ bool hasNullByteSequence(const std::string& contents)
 }
 
 bool isSafeSourceDocument(const FilePath& docDbPath,
-                          boost::shared_ptr<SourceDocument> pDoc)
+                          boost::shared_ptr<SourceDocument> pDoc,
+                          bool checkContents)
 {
    // get a filepath and use it for filtering if we can
    FilePath filePath;
@@ -776,7 +1103,7 @@ bool isSafeSourceDocument(const FilePath& docDbPath,
    }
 
    // if it has a sequence of 2 null bytes then drop it
-   else if (hasNullByteSequence(pDoc->contents()))
+   else if (checkContents && hasNullByteSequence(pDoc->contents()))
    {
       logUnsafeSourceDocument(filePath,
                               "File is binary (has null byte sequence)");
@@ -790,8 +1117,11 @@ bool isSafeSourceDocument(const FilePath& docDbPath,
 }
 
 
-Error list(std::vector<boost::shared_ptr<SourceDocument> >* pDocs)
+Error list(std::vector<boost::shared_ptr<SourceDocument> >* pDocs,
+           bool includeContents)
 {
+   s_databaseWriter.waitForPending();
+
    std::vector<FilePath> files ;
    Error error = source_database::path().children(&files);
    if (error)
@@ -803,11 +1133,13 @@ Error list(std::vector<boost::shared_ptr<SourceDocument> >* pDocs)
       {
          // get the source doc
          boost::shared_ptr<SourceDocument> pDoc(new SourceDocument()) ;
-         Error error = source_database::get(filePath.filename(), pDoc);
+         Error error = source_database::get(filePath.filename(),
+                                            includeContents,
+                                            pDoc);
          if (!error)
          {
             // safety filter
-            if (isSafeSourceDocument(filePath, pDoc))
+            if (isSafeSourceDocument(filePath, pDoc, includeContents))
                pDocs->push_back(pDoc);
          }
          else
@@ -820,6 +1152,8 @@ Error list(std::vector<boost::shared_ptr<SourceDocument> >* pDocs)
 
 Error list(std::vector<FilePath>* pPaths)
 {
+   s_databaseWriter.waitForPending();
+
    // list children
    std::vector<FilePath> children;
    Error error = source_database::path().children(&children);
@@ -838,30 +1172,77 @@ Error list(std::vector<FilePath>* pPaths)
    
 Error put(boost::shared_ptr<SourceDocument> pDoc, bool writeContents)
 {   
-   // write to file
+   // serialize the document now and leave writing it to the writer
    FilePath filePath = source_database::path().complete(pDoc->id());
-   Error error = pDoc->writeToFile(filePath, writeContents);
-   if (error)
-      return error ;
+   std::string contents = writeContents ? pDoc->contents() : std::string();
+   FilePath durableDatabasePath = !pDoc->path().empty() ?
+                                     propertiesDatabasePath() : FilePath();
+   s_databaseWriter.enqueue(boost::bind(writeDocument,
+                                        filePath,
+                                        writeContents,
+                                        contents,
+                                        pDoc->propertiesFileContents(),
+                                        durableDatabasePath,
+                                        pDoc->path(),
+                                        pDoc->properties()));
 
-   // write properties to durable storage (if there is a path)
-   if (!pDoc->path().empty())
+   return Success();
+}
+   
+Error putChange(boost::shared_ptr<SourceDocument> pDoc,
+                const std::string& previousHash,
+                std::size_t offset,
+                std::size_t length,
+                const std::string& replacement)
+{
+   // (the log may be pending removal, with the contents pending rewrite)
+   s_databaseWriter.waitForPending();
+
+   FilePath filePath = source_database::path().complete(pDoc->id());
+   FilePath changesPath(filePath.absolutePath() + kChangesSuffix);
+
+   // compact the log if it's getting large relative to the contents
+   uintmax_t changesSize = changesPath.exists() ? changesPath.size() : 0;
+   uintmax_t compactSize = std::max(kMinChangesCompactSize,
+                                    uintmax_t(pDoc->contents().size() / 4));
+   if (changesSize + replacement.size() > compactSize)
+      return put(pDoc, true);
+
+   // a new log applies to the contents as last written
+   std::ostringstream ostr;
+   if (changesSize == 0)
+      ostr << previousHash << "\n";
+   ostr << offset << " " << length << " " << replacement.size() << "\n";
+   ostr << replacement;
+
+   Error error = appendToFile(changesPath, ostr.str());
+   if (error)
    {
-      error = putProperties(pDoc->path(), pDoc->properties());
-      if (error)
-         LOG_ERROR(error);
+      LOG_ERROR(error);
+      return put(pDoc, true);
    }
 
-   return Success();
+   // write the properties
+   return put(pDoc, false);
 }
-   
+
 Error remove(const std::string& id)
 {
-   return source_database::path().complete(id).removeIfExists();
+   s_databaseWriter.waitForPending();
+
+   FilePath filePath = source_database::path().complete(id);
+   Error error = FilePath(filePath.absolutePath() + kChangesSuffix)
+                                                         .removeIfExists();
+   if (error)
+      LOG_ERROR(error);
+
+   return filePath.removeIfExists();
 }
    
 Error removeAll()
 {
+   s_databaseWriter.waitForPending();
+
    std::vector<FilePath> files ;
    Error error = source_database::path().children(&files);
    if (error)
@@ -959,6 +1340,8 @@ namespace {
 
 void onQuit()
 {
+   s_databaseWriter.stop();
+
    Error error = supervisor::saveMostRecentDocuments();
    if (error)
       LOG_ERROR(error);
@@ -968,8 +1351,14 @@ void onQuit()
       LOG_ERROR(error);
 }
 
+void onDeferredInit(bool)
+{
+   supervisor::collectStaleSessionDirs();
+}
+
 void onSuspend(const r::session::RSuspendOptions& options, core::Settings*)
 {
+   s_databaseWriter.stop();
    supervisor::suspendSourceDatabase(options.status);
 }
 
@@ -1028,6 +1417,19 @@ SEXP rs_getDocumentProperties(SEXP pathSEXP, SEXP includeContentsSEXP)
    return object;
 }
 
+core::memory_accounting::Usage pathCacheUsage()
+{
+   // document contents live on disk; only the id to path mapping is cached
+   std::size_t bytes = 0;
+   for (std::map<std::string, std::string>::const_iterator it = s_idToPath.begin();
+        it != s_idToPath.end();
+        ++it)
+   {
+      bytes += sizeof(*it) + it->first.capacity() + it->second.capacity();
+   }
+   return core::memory_accounting::Usage(bytes, s_idToPath.size());
+}
+
 } // anonymous namespace
 
 Events& events()
@@ -1051,10 +1453,13 @@ Error initialize()
    events().onRemoveAll.connect(onRemoveAll);
 
    // signup for session end/suspend events
+   module_context::events().onDeferredInit.connect(onDeferredInit);
    module_context::events().onQuit.connect(onQuit);
    module_context::addSuspendHandler(
          module_context::SuspendHandler(onSuspend, onResume));
 
+   core::memory_accounting::registerSubsystem("source-database", pathCacheUsage);
+
    return Success();
 }
 
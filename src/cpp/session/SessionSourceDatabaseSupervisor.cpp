@@ -21,8 +21,11 @@
 # include <windows.h>
 #endif
 
+#include <set>
+#include <map>
 #include <vector>
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/scope_exit.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -32,12 +35,18 @@
 #include <core/FileSerializer.hpp>
 #include <core/FileLock.hpp>
 #include <core/FileUtils.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/BoostErrors.hpp>
 
 #include <r/session/RSession.hpp>
 
 #include <core/system/System.hpp>
 
+#ifndef _WIN32
+#include <unistd.h>
+#include <core/system/PosixSystem.hpp>
+#endif
+
 #include <session/SessionOptions.hpp>
 #include <session/SessionModuleContext.hpp>
 #include "session/SessionSourceDatabase.hpp"
@@ -53,6 +62,10 @@ namespace {
 
 const char * const kSessionDirPrefix = "s-";
 
+// entries in the session registry are named <session dir>@<host>@<pid>
+const char * const kSessionRegistryDir = "registry";
+const char kRegistrySeparator = '@';
+
 FilePath sdbSourceDatabaseRoot()
 {
    return module_context::scopedScratchPath().complete("sdb");
@@ -168,6 +181,123 @@ Error removeSessionDir(const FilePath& sessionDir)
    return sessionDir.remove();
 }
 
+// the session registry records the process owning each session dir, so that
+// orphaned dirs can be told from live ones without trying each one's lock.
+// each entry is an empty file (created and removed atomically, so no
+// coordination between sessions is needed) and one listing reads them all
+
+FilePath sessionRegistryPath()
+{
+   return sourceDatabaseRoot().complete(kSessionRegistryDir);
+}
+
+std::string hostName()
+{
+#ifndef _WIN32
+   char buffer[256];
+   if (::gethostname(buffer, 255) == 0)
+      return std::string(buffer);
+#endif
+   return std::string();
+}
+
+typedef std::map<std::string, std::vector<std::string> > SessionRegistry;
+
+// read the registry as a map from session dir name to its entries
+SessionRegistry readSessionRegistry()
+{
+   SessionRegistry registry;
+
+   std::vector<FilePath> entries;
+   Error error = sessionRegistryPath().children(&entries);
+   if (error)
+      return registry;
+
+   BOOST_FOREACH(const FilePath& entry, entries)
+   {
+      std::string name = entry.filename();
+      std::string::size_type pos = name.find(kRegistrySeparator);
+      if (pos != std::string::npos)
+         registry[name.substr(0, pos)].push_back(name);
+   }
+
+   return registry;
+}
+
+void unregisterSessionDir(const std::string& sessionDirName,
+                          const SessionRegistry& registry)
+{
+   SessionRegistry::const_iterator it = registry.find(sessionDirName);
+   if (it == registry.end())
+      return;
+
+   BOOST_FOREACH(const std::string& entry, it->second)
+   {
+      Error error = sessionRegistryPath().complete(entry).removeIfExists();
+      if (error)
+         LOG_ERROR(error);
+   }
+}
+
+// record this process as the owner of the session dir (replacing the entries
+// of any previous owner)
+void registerSessionDir()
+{
+   std::string sessionDirName = sessionDirPath().filename();
+   unregisterSessionDir(sessionDirName, readSessionRegistry());
+
+   Error error = sessionRegistryPath().ensureDirectory();
+   if (!error)
+   {
+      std::string entry = sessionDirName +
+            kRegistrySeparator + hostName() +
+            kRegistrySeparator + safe_convert::numberToString(
+                                    (long) core::system::currentProcessId());
+      error = sessionRegistryPath().complete(entry).ensureFile();
+   }
+   if (error)
+      LOG_ERROR(error);
+}
+
+enum SessionDirOwner
+{
+   SessionDirOwnerRunning,    // the owning process is running
+   SessionDirOwnerExited,     // the owning process has exited
+   SessionDirOwnerUnknown     // not registered, or owned from another host
+};
+
+SessionDirOwner sessionDirOwner(const FilePath& sessionDir,
+                                const SessionRegistry& registry)
+{
+   SessionRegistry::const_iterator it = registry.find(sessionDir.filename());
+   if (it == registry.end())
+      return SessionDirOwnerUnknown;
+
+#ifndef _WIN32
+   std::string host = hostName();
+   bool exited = false;
+   BOOST_FOREACH(const std::string& entry, it->second)
+   {
+      // split <session dir>@<host>@<pid>
+      std::string::size_type hostPos = entry.find(kRegistrySeparator) + 1;
+      std::string::size_type pidPos = entry.rfind(kRegistrySeparator);
+      if (pidPos < hostPos || entry.substr(hostPos, pidPos - hostPos) != host)
+         return SessionDirOwnerUnknown;
+
+      pid_t pid = safe_convert::stringTo<pid_t>(entry.substr(pidPos + 1), 0);
+      if (pid == 0)
+         return SessionDirOwnerUnknown;
+
+      if (core::system::isProcessRunning(pid))
+         return SessionDirOwnerRunning;
+      exited = true;
+   }
+   return exited ? SessionDirOwnerExited : SessionDirOwnerUnknown;
+#else
+   return SessionDirOwnerUnknown;
+#endif
+}
+
 bool isNotSessionDir(const FilePath& filePath)
 {
    return !filePath.isDirectory() || !boost::algorithm::starts_with(
@@ -201,6 +331,18 @@ void attemptToMoveSourceDbFiles(const FilePath& fromPath,
    if (error)
       LOG_ERROR(error);
 
+   // note the files already in the target path (in one listing rather than
+   // checking for each file moved)
+   std::vector<FilePath> targetChildren;
+   error = toPath.children(&targetChildren);
+   if (error)
+      LOG_ERROR(error);
+   std::set<std::string> targetNames;
+   BOOST_FOREACH(const FilePath& filePath, targetChildren)
+   {
+      targetNames.insert(filePath.filename());
+   }
+
    // move the files
    BOOST_FOREACH(const FilePath& filePath, children)
    {
@@ -219,7 +361,7 @@ void attemptToMoveSourceDbFiles(const FilePath& fromPath,
       // close to zero (collision probability of uniqueFilePath)
       // so it's no big deal to punt here.
       FilePath targetPath = toPath.complete(filePath.filename());
-      if (targetPath.exists())
+      if (!targetNames.insert(filePath.filename()).second)
       {
          LOG_WARNING_MESSAGE("Skipping source db move from: " +
                              filePath.absolutePath() + " to " +
@@ -232,6 +374,7 @@ void attemptToMoveSourceDbFiles(const FilePath& fromPath,
          continue;
       }
 
+      // (a rename, since the stores share the scratch path's volume)
       Error error = filePath.move(targetPath);
       if (error)
          LOG_ERROR(error);
@@ -255,6 +398,8 @@ Error createSessionDir()
    if (error)
       LOG_ERROR(error);
 
+   registerSessionDir();
+
    return Success();
 }
 
@@ -327,6 +472,8 @@ bool reclaimOrphanedSession()
       return false;
    }
 
+   SessionRegistry registry = readSessionRegistry();
+
    BOOST_FOREACH(const FilePath& sessionDir, sessionDirs)
    {
       // if the suspend file exists, this session is only sleeping, not dead
@@ -354,6 +501,11 @@ bool reclaimOrphanedSession()
          }
       }
 
+      // dirs whose owner is known to be running are skipped without
+      // checking their locks; the lock remains the test for the rest
+      if (sessionDirOwner(sessionDir, registry) == SessionDirOwnerRunning)
+         continue;
+
       FilePath lockFilePath = sessionLockFilePath(sessionDir);
       if (!sessionDirLock().isLocked(lockFilePath))
       {
@@ -363,10 +515,13 @@ bool reclaimOrphanedSession()
             LOG_ERROR(error);
          else
          {
+            unregisterSessionDir(sessionDir.filename(), registry);
+
             error = sessionDirLock().acquire(
                   sessionLockFilePath(sessionDirPath()));
             if (!error)
             {
+               registerSessionDir();
                return true;
             }
             else
@@ -389,6 +544,105 @@ Error removeAndRecreate(const FilePath& dir)
    return dir.ensureDirectory();
 }
 
+bool isSessionDirDocument(const FilePath& filePath)
+{
+   // (lock files, including those of link-based locks, aren't documents)
+   std::string name = filePath.filename();
+   return !boost::algorithm::starts_with(name, ".") &&
+          name != sessionLockFilePath(filePath.parent()).filename() &&
+          name != sessionSuspendFilePath(filePath.parent()).filename() &&
+          name != sessionRestartFilePath(filePath.parent()).filename();
+}
+
+// removes the session dirs left by crashed sessions which hold no documents
+// (those that do are kept for a future session to reclaim), along with
+// registry entries for session dirs that no longer exist. runs in idle time,
+// one session dir per call
+class StaleSessionDirCollector : boost::noncopyable
+{
+public:
+   StaleSessionDirCollector() : started_(false), index_(0) {}
+
+   bool work()
+   {
+      if (!started_)
+      {
+         started_ = true;
+         return start();
+      }
+
+      if (index_ < sessionDirs_.size())
+         collect(sessionDirs_[index_++]);
+      return index_ < sessionDirs_.size();
+   }
+
+private:
+   bool start()
+   {
+      Error error = enumerateSessionDirs(&sessionDirs_);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return false;
+      }
+      registry_ = readSessionRegistry();
+
+      std::set<std::string> sessionDirNames;
+      BOOST_FOREACH(const FilePath& sessionDir, sessionDirs_)
+      {
+         sessionDirNames.insert(sessionDir.filename());
+      }
+
+      for (SessionRegistry::const_iterator it = registry_.begin();
+           it != registry_.end();
+           ++it)
+      {
+         if (sessionDirNames.count(it->first) == 0)
+            unregisterSessionDir(it->first, registry_);
+      }
+
+      return !sessionDirs_.empty();
+   }
+
+   void collect(const FilePath& sessionDir)
+   {
+      if (sessionDir == sessionDirPath() ||
+          sessionSuspendFilePath(sessionDir).exists() ||
+          sessionRestartFilePath(sessionDir).exists())
+      {
+         return;
+      }
+
+      // only dirs whose owner is known to have exited are collected
+      if (sessionDirOwner(sessionDir, registry_) != SessionDirOwnerExited)
+         return;
+
+      std::vector<FilePath> children;
+      Error error = sessionDir.children(&children);
+      if (error)
+         return;
+      if (std::find_if(children.begin(),
+                       children.end(),
+                       isSessionDirDocument) != children.end())
+      {
+         return;
+      }
+
+      if (sessionDirLock().isLocked(sessionLockFilePath(sessionDir)))
+         return;
+
+      error = removeSessionDir(sessionDir);
+      if (error)
+         LOG_ERROR(error);
+      unregisterSessionDir(sessionDir.filename(), registry_);
+   }
+
+   bool started_;
+   std::vector<FilePath> sessionDirs_;
+   std::size_t index_;
+   SessionRegistry registry_;
+};
+
 } // anonymous namespace
 
 
@@ -432,6 +686,7 @@ Error attachToSourceDatabase()
       }
       else
       {
+         registerSessionDir();
          return Success();
       }
    }
@@ -561,6 +816,7 @@ Error detachFromSourceDatabase()
    FilePath sessionDir = sessionDirLock().lockFilePath().parent();
 
    // give up our lock
+   unregisterSessionDir(sessionDir.filename(), readSessionRegistry());
    error = sessionDirLock().release();
    if (error)
       LOG_ERROR(error);
@@ -575,6 +831,18 @@ FilePath sessionDirPath()
          module_context::activeSession().id());
 }
 
+void collectStaleSessionDirs()
+{
+   boost::shared_ptr<StaleSessionDirCollector> pCollector(
+                                          new StaleSessionDirCollector());
+   module_context::scheduleIncrementalWork(
+            boost::posix_time::milliseconds(20),
+            boost::bind(&StaleSessionDirCollector::work, pCollector),
+            true,
+            WorkPriorityLow,
+            "source_database_gc");
+}
+
 void suspendSourceDatabase(int status)
 {
    // write a sentinel so we can differentiate between a sdb that's orphaned
@@ -36,6 +36,9 @@ core::Error saveMostRecentDocuments();
 
 core::Error detachFromSourceDatabase();
 
+// remove stale session dirs (in idle time, once the session is interactive)
+void collectStaleSessionDirs();
+
 void suspendSourceDatabase(int status);
 
 void resumeSourceDatabase();
@@ -19,7 +19,14 @@
 #include "SessionSuspend.hpp"
 #include "SessionConsoleInput.hpp"
 
+#include <boost/bind.hpp>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+#include <core/system/PosixSystem.hpp>
+
 #include <session/SessionConstants.hpp>
+#include <session/SessionModuleContext.hpp>
 #include <session/SessionOptions.hpp>
 
 #include <r/session/RSession.hpp>
@@ -40,6 +47,34 @@ bool s_suspendedFromTimeout = false;
 // was the underlying r session resumed
 bool s_rSessionResumed = false;
 
+// are we currently below the low memory threshold
+bool s_lowMemory = false;
+
+bool checkMemory()
+{
+   long availableKb = 0;
+   core::Error error = core::system::availableMemoryKb(&availableKb);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return true;
+   }
+
+   // release caches once per crossing rather than on every check
+   bool lowMemory = availableKb < options().lowMemoryMb() * 1024L;
+   if (lowMemory && !s_lowMemory)
+   {
+      module_context::events().onLowMemory();
+
+      // return what was released to the allocator
+      error = rstudio::r::exec::RFunction("gc").call();
+      if (error)
+         LOG_ERROR(error);
+   }
+   s_lowMemory = lowMemory;
+   return true;
+}
+
 } // anonymous namespace
 
 // convenience function for disallowing suspend (note still doesn't override
@@ -146,6 +181,21 @@ void handleUSR2(int unused)
    s_forceSuspend = 1;
 }
 
+core::Error initialize()
+{
+   // memory only becomes short in server mode and when asked to watch it
+   if (options().programMode() != kSessionProgramModeServer ||
+       options().lowMemoryMb() <= 0)
+      return core::Success();
+
+   // before suspending idle sessions the server lets them release what
+   // they can rebuild; checking while idle keeps this off R's busy path
+   module_context::schedulePeriodicWork(boost::posix_time::seconds(30),
+                                        checkMemory,
+                                        true);
+   return core::Success();
+}
+
 } // namespace suspend
 } // namespace session
 } // namespace rstudio
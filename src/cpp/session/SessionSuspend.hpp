@@ -15,6 +15,12 @@
 
 #include <boost/function.hpp>
 
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
 namespace rstudio {
 namespace session {
 namespace suspend {
@@ -29,6 +35,9 @@ void setSuspendedFromTimeout(bool suspended);
 bool sessionResumed();
 void setSessionResumed(bool resumed);
 
+// watch for the system running short of memory (--session-low-memory-mb)
+core::Error initialize();
+
 } // namespace suspend
 } // namespace session
 } // namespace rstudio
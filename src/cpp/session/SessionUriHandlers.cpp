@@ -15,7 +15,17 @@
 
 #include "SessionUriHandlers.hpp"
 
+#include <utility>
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <core/Thread.hpp>
+#include <core/http/Request.hpp>
+#include <core/http/Response.hpp>
+
 #include <session/SessionConstants.hpp>
+#include <session/SessionModuleContext.hpp>
 
 using namespace rstudio::core;
 
@@ -29,6 +39,58 @@ http::UriHandlers& handlers()
    return instance;
 }
 
+namespace {
+
+typedef std::vector<std::pair<std::string,
+                    module_context::BackgroundUriHandlerFunction> >
+                                                         BackgroundHandlers;
+
+boost::mutex s_backgroundHandlersMutex;
+
+BackgroundHandlers& backgroundHandlers()
+{
+   static BackgroundHandlers instance;
+   return instance;
+}
+
+void addBackgroundHandler(
+            const std::string& name,
+            const module_context::BackgroundUriHandlerFunction& handlerFunction)
+{
+   LOCK_MUTEX(s_backgroundHandlersMutex)
+   {
+      backgroundHandlers().push_back(std::make_pair(name, handlerFunction));
+   }
+   END_LOCK_MUTEX
+}
+
+} // anonymous namespace
+
+bool handleInBackground(const http::Request& request,
+                        http::Response* pResponse)
+{
+   std::vector<module_context::BackgroundUriHandlerFunction> matching;
+   LOCK_MUTEX(s_backgroundHandlersMutex)
+   {
+      for (BackgroundHandlers::const_iterator it = backgroundHandlers().begin();
+           it != backgroundHandlers().end();
+           ++it)
+      {
+         if (boost::algorithm::starts_with(request.uri(), it->first))
+            matching.push_back(it->second);
+      }
+   }
+   END_LOCK_MUTEX
+
+   for (std::size_t i = 0; i < matching.size(); i++)
+   {
+      if (matching[i](request, pResponse))
+         return true;
+   }
+
+   return false;
+}
+
 } // namespace uri_handlers
 
 namespace module_context {
@@ -50,6 +112,14 @@ Error registerUriHandler(const std::string& name,
    return Success();
 }
 
+Error registerBackgroundUriHandler(
+                        const std::string& name,
+                        const BackgroundUriHandlerFunction& handlerFunction)
+{
+   uri_handlers::addBackgroundHandler(name, handlerFunction);
+   return Success();
+}
+
 
 Error registerAsyncLocalUriHandler(
                          const std::string& name,
@@ -15,12 +15,27 @@
 
 #include <core/http/UriHandler.hpp>
 
+namespace rstudio {
+namespace core {
+namespace http {
+   class Request;
+   class Response;
+}
+}
+}
+
 namespace rstudio {
 namespace session { 
 namespace uri_handlers {
 
 core::http::UriHandlers& handlers();
 
+// give the background handlers registered for the request's uri a chance
+// to respond to it (returns false if none did). called from the connection
+// listener thread
+bool handleInBackground(const core::http::Request& request,
+                        core::http::Response* pResponse);
+
 } // namespace uri_handlers
 } // namespace session
 } // namespace rstudio
@@ -17,6 +17,7 @@
 
 #include <iostream>
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
@@ -55,9 +56,9 @@ namespace {
 const char * const kContextId = kContextIdentifier;
 const char * const kAgreementHash = kAgreementPrefix "agreedToHash";
 const char * const kAutoCreatedProfile = "autoCreatedProfile";
-const char * const kUiPrefs = "uiPrefs";
+const char * const kUiPrefs = kUserSettingsUiPrefs;
 const char * const kRProfileOnResume = "rprofileOnResume";
-const char * const kSaveAction = "saveAction";
+const char * const kSaveAction = kUserSettingsSaveAction;
 const char * const kLoadRData = "loadRData";
 const char * const kInitialWorkingDirectory = "initialWorkingDirectory";
 const char * const kCRANMirrorName = "cranMirrorName";
@@ -76,6 +77,57 @@ const char * const kDefaultTerminalShell = "defaultTerminalShell";
 const char * const kCustomShellCommand = "customShellCommand";
 const char * const kCustomShellOptions = "customShellOptions";
 
+// ui prefs keys (in change notifications) are their names with this prefix
+#define kUiPrefKeyPrefix kUserSettingsUiPrefs "."
+
+void addValue(std::map<std::string, std::string>* pValues,
+              const std::string& name,
+              const std::string& value)
+{
+   (*pValues)[name] = value;
+}
+
+// the ui prefs (each written as json) as they are in the settings value
+std::map<std::string, std::string> uiPrefsValues(
+                           const std::map<std::string, std::string>& values)
+{
+   std::map<std::string, std::string> prefsValues;
+
+   std::map<std::string, std::string>::const_iterator it = values.find(kUiPrefs);
+   json::Value prefs;
+   if (it == values.end() ||
+       !json::parse(it->second, &prefs) ||
+       !json::isType<json::Object>(prefs))
+   {
+      return prefsValues;
+   }
+
+   BOOST_FOREACH(const json::Member& member, prefs.get_obj())
+   {
+      prefsValues[member.first] = json::write(member.second);
+   }
+   return prefsValues;
+}
+
+void addChangedKeys(const std::map<std::string, std::string>& previous,
+                    const std::map<std::string, std::string>& current,
+                    const std::string& prefix,
+                    std::set<std::string>* pKeys)
+{
+   typedef std::map<std::string, std::string>::const_iterator iterator;
+   for (iterator it = previous.begin(); it != previous.end(); ++it)
+   {
+      iterator currentIt = current.find(it->first);
+      if (currentIt == current.end() || currentIt->second != it->second)
+         pKeys->insert(prefix + it->first);
+   }
+   for (iterator it = current.begin(); it != current.end(); ++it)
+   {
+      if (previous.find(it->first) == previous.end())
+         pKeys->insert(prefix + it->first);
+   }
+}
+
 template <typename T>
 T readPref(const json::Object& prefs,
            const std::string& name,
@@ -244,10 +296,12 @@ Error UserSettings::initialize()
          oldSettingsPath.move(settingsFilePath_);
    }
 
-   // read the settings
+   // read the settings (changes are written shortly after they are made
+   // so that several changes in a row are written together)
    Error error = settings_.initialize(settingsFilePath_);
    if (error)
       return error;
+   settings_.setWriteDelay(boost::posix_time::milliseconds(500));
 
    // register routines for reading/writing UI prefs from R code
    RS_REGISTER_CALL_METHOD(rs_readUiPref, 1);
@@ -258,9 +312,56 @@ Error UserSettings::initialize()
    if (contextId().empty())
       setContextId(core::system::generateShortenedUuid());
 
+   notifiedValues_ = settingsValues();
+
    return Success();
 }
 
+void UserSettings::onKeysChanged(const std::vector<std::string>& keys,
+                                 const ChangeHandler& handler)
+{
+   keyHandlers_.push_back(std::make_pair(
+         std::set<std::string>(keys.begin(), keys.end()), handler));
+}
+
+void UserSettings::onKeyChanged(const std::string& key,
+                                const ChangeHandler& handler)
+{
+   onKeysChanged(std::vector<std::string>(1, key), handler);
+}
+
+std::string UserSettings::uiPrefKey(const std::string& prefName)
+{
+   return kUiPrefKeyPrefix + prefName;
+}
+
+std::map<std::string, std::string> UserSettings::settingsValues() const
+{
+   std::map<std::string, std::string> values;
+   settings_.forEach(boost::bind(addValue, &values, _1, _2));
+   return values;
+}
+
+// the keys of the settings (and ui prefs) changed since the last change
+// notification
+std::set<std::string> UserSettings::changedKeys()
+{
+   std::map<std::string, std::string> values = settingsValues();
+
+   std::set<std::string> keys;
+   addChangedKeys(notifiedValues_, values, std::string(), &keys);
+   if (keys.count(kUiPrefs))
+   {
+      addChangedKeys(uiPrefsValues(notifiedValues_),
+                     uiPrefsValues(values),
+                     kUiPrefKeyPrefix,
+                     &keys);
+   }
+
+   notifiedValues_.swap(values);
+   return keys;
+}
+
 void UserSettings::onSettingsFileChanged(
                      const core::system::FileChangeEvent& changeEvent)
 {
@@ -294,8 +395,29 @@ void UserSettings::onSettingsFileChanged(
    using namespace rstudio::r::session;
    consoleHistory().setRemoveDuplicates(removeHistoryDuplicates());
 
+   // nothing more to do if the file was rewritten without changes
+   std::set<std::string> keys = changedKeys();
+   if (keys.empty())
+      return;
+
    // fire event so others can react appropriately
    onChanged();
+
+   // then notify those interested in the particular settings changed (note
+   // that handlers may add handlers, so we iterate a copy)
+   typedef std::pair<std::set<std::string>, ChangeHandler> KeyHandler;
+   std::vector<KeyHandler> handlers = keyHandlers_;
+   BOOST_FOREACH(const KeyHandler& keyHandler, handlers)
+   {
+      BOOST_FOREACH(const std::string& key, keyHandler.first)
+      {
+         if (keys.count(key))
+         {
+            keyHandler.second();
+            break;
+         }
+      }
+   }
 }
 
 
@@ -432,6 +554,9 @@ void UserSettings::updatePrefsCache(const json::Object& prefs) const
    bool showRmdRenderCommand = readPref<bool>(prefs, "show_rmd_render_command", false);
    pShowRmdRenderCommand_.reset(new bool(showRmdRenderCommand));
 
+   bool rmdRenderCache = readPref<bool>(prefs, "rmd_render_cache", false);
+   pRmdRenderCache_.reset(new bool(rmdRenderCache));
+
    bool showPublishDiagnostics = readPref<bool>(prefs, "show_publish_diagnostics", false);
    pShowPublishDiagnostics_.reset(new bool(showPublishDiagnostics));
 
@@ -694,6 +819,11 @@ bool UserSettings::showRmdRenderCommand() const
    return readUiPref<bool>(pShowRmdRenderCommand_);
 }
 
+bool UserSettings::rmdRenderCache() const
+{
+   return readUiPref<bool>(pRmdRenderCache_);
+}
+
 bool UserSettings::showPublishDiagnostics() const
 {
    return readUiPref<bool>(pShowPublishDiagnostics_);
@@ -872,7 +1002,7 @@ void UserSettings::setVcsEnabled(bool enabled)
 
 FilePath UserSettings::gitExePath() const
 {
-   std::string dir = settings_.get("vcsGitExePath");
+   std::string dir = settings_.get(kUserSettingsGitExePath);
    if (!dir.empty())
       return module_context::resolveAliasedPath(dir);
    else
@@ -881,12 +1011,12 @@ FilePath UserSettings::gitExePath() const
 
 void UserSettings::setGitExePath(const FilePath& gitExePath)
 {
-   settings_.set("vcsGitExePath", gitExePath.absolutePath());
+   settings_.set(kUserSettingsGitExePath, gitExePath.absolutePath());
 }
 
 FilePath UserSettings::svnExePath() const
 {
-   std::string dir = settings_.get("vcsSvnExePath");
+   std::string dir = settings_.get(kUserSettingsSvnExePath);
    if (!dir.empty())
       return module_context::resolveAliasedPath(dir);
    else
@@ -895,7 +1025,7 @@ FilePath UserSettings::svnExePath() const
 
 void UserSettings::setSvnExePath(const FilePath& svnExePath)
 {
-   settings_.set("vcsSvnExePath", svnExePath.absolutePath());
+   settings_.set(kUserSettingsSvnExePath, svnExePath.absolutePath());
 }
 
 FilePath UserSettings::vcsTerminalPath() const
@@ -972,6 +1102,26 @@ void UserSettings::setHideObjectFiles(bool hide)
    settings_.set("hideObjectFiles", hide);
 }
 
+bool UserSettings::useCompileCache() const
+{
+   return settings_.getBool("useCompileCache", false);
+}
+
+void UserSettings::setUseCompileCache(bool useCache)
+{
+   settings_.set("useCompileCache", useCache);
+}
+
+bool UserSettings::useParallelTests() const
+{
+   return settings_.getBool("useParallelTests", false);
+}
+
+void UserSettings::setUseParallelTests(bool useParallel)
+{
+   settings_.set("useParallelTests", useParallel);
+}
+
 bool UserSettings::alwaysSaveHistory() const
 {
    return settings_.getBool(kAlwaysSaveHistory, true);
@@ -22,6 +22,8 @@
 #include <session/SessionClientEvent.hpp>
 #include <session/SessionModuleContext.hpp>
 
+#include "SessionRpc.hpp"
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -41,6 +43,12 @@ Error registerWorkerRpcMethod(const std::string& name,
                                                         _2));
 }
 
+Error registerWorkerSafeRpcMethod(const std::string& name,
+                                  const json::JsonRpcFunction& function)
+{
+   return rpc::registerWorkerSafeRpcMethod(name, function);
+}
+
 } // namespace worker_context
 } // namespace session
 } // namespace rstudio
@@ -24,6 +24,7 @@
 #include <boost/asio/write.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <core/Error.hpp>
 #include <core/Log.hpp>
@@ -32,6 +33,7 @@
 #include <core/http/Request.hpp>
 #include <core/http/Response.hpp>
 #include <core/http/RequestParser.hpp>
+#include <core/http/RequestMetrics.hpp>
 #include <core/http/SocketUtils.hpp>
 
 #include <core/json/JsonRpc.hpp>
@@ -57,8 +59,13 @@ public:
 public:
    HttpConnectionImpl(boost::asio::io_service& ioService,
                       const Handler& handler)
-      : socket_(ioService), handler_(handler)
+      : ioService_(ioService),
+        socket_(ioService),
+        handler_(handler),
+        requestInFlight_(false)
    {
+      // stream file uploads to disk rather than buffering them
+      requestParser_.setBodyHandlerFactory(connection::uploadBodyHandler);
    }
 
    virtual ~HttpConnectionImpl()
@@ -67,6 +74,10 @@ public:
       try
       {
          close();
+
+         // the connection went away before a response was sent
+         if (requestInFlight_)
+            core::http::request_metrics::requestAborted(request_.uri());
       }
       catch(...)
       {
@@ -80,12 +91,88 @@ public:
 
    virtual void sendResponse(const core::http::Response &response)
    {
+      recordRequestFinished(response);
+
+#ifndef __linux__
+      // send file responses are written from memory here (on linux they
+      // are written directly from disk using sendfile)
+      if (response.isSendFile())
+      {
+         core::http::Response loaded;
+         loaded.assign(response);
+         core::Error error = loaded.loadSendFile();
+         if (error)
+         {
+            LOG_ERROR(error);
+            loaded.setError(error);
+         }
+         sendResponse(loaded);
+         return;
+      }
+#endif
+
+      // keep the connection open for another request if the client asked
+      // us to (rserver keeps a pool of persistent connections to sessions)
+      bool keepAlive = canKeepAlive(response);
+      bool written = false;
+
       try
       {
-         // write the response
-         boost::asio::write(socket_,
-                            response.toBuffers(
-                                  core::http::Header::connectionClose()));
+         core::http::Header connectionHeader = keepAlive ?
+                                 core::http::Header::connectionKeepAlive() :
+                                 core::http::Header::connectionClose();
+
+         boost::shared_ptr<core::http::StreamResponse> pStream =
+                                                response.streamResponse();
+         if (pStream)
+         {
+            // write the headers and then each chunk of the body in turn
+            boost::asio::write(socket_,
+                               response.headerBuffers(connectionHeader));
+            while (!pStream->complete())
+            {
+               std::string chunk;
+               core::Error error = pStream->nextChunk(&chunk);
+               if (error)
+               {
+                  error.addProperty("request-uri", request_.uri());
+                  LOG_ERROR(error);
+                  break;
+               }
+               boost::asio::write(socket_, boost::asio::buffer(chunk));
+            }
+            written = pStream->complete();
+         }
+#ifdef __linux__
+         else if (response.isSendFile())
+         {
+            // write the headers and then the file (e.g. a plot) straight
+            // from disk to the socket
+            boost::asio::write(socket_,
+                               response.headerBuffers(connectionHeader));
+            core::Error error = connection::sendFile(
+                                          socket_.native_handle(),
+                                          response.sendFilePath(),
+                                          response.contentLength());
+            if (error)
+            {
+               // (the connection is closed since the headers are written)
+               error.addProperty("request-uri", request_.uri());
+               if (!core::http::isConnectionTerminatedError(error))
+                  LOG_ERROR(error);
+            }
+            else
+            {
+               written = true;
+            }
+         }
+#endif
+         else
+         {
+            // write the response
+            boost::asio::write(socket_, response.toBuffers(connectionHeader));
+            written = true;
+         }
       }
       catch(const boost::system::system_error& e)
       {
@@ -99,7 +186,18 @@ public:
       }
       CATCH_UNEXPECTED_EXCEPTION
 
-      // always close connection
+      // hand the socket off to a new connection which reads the next request
+      if (keepAlive && written)
+      {
+         try
+         {
+            readNextRequest();
+            return;
+         }
+         CATCH_UNEXPECTED_EXCEPTION
+      }
+
+      // otherwise close connection
       try
       {
          close();
@@ -133,6 +231,50 @@ public:
 
 private:
 
+   void recordRequestFinished(const core::http::Response& response)
+   {
+      if (!requestInFlight_)
+         return;
+
+      requestInFlight_ = false;
+
+      // send file bodies aren't loaded yet so use their length
+      std::size_t bytesOut = response.body().size();
+      if (response.isSendFile())
+      {
+         bytesOut = core::safe_convert::stringTo<std::size_t>(
+                         response.headerValue("Content-Length"), 0);
+      }
+
+      core::http::request_metrics::requestFinished(
+            request_.uri(),
+            boost::posix_time::microsec_clock::universal_time() -
+                                                         requestStartTime_,
+            bytesOut);
+   }
+
+   bool canKeepAlive(const core::http::Response& response) const
+   {
+      if (!boost::algorithm::iequals(request_.headerValue("Connection"),
+                                     "keep-alive"))
+         return false;
+
+      // the client needs a content length to know the response is complete
+      return !response.headerValue("Content-Length").empty() &&
+             response.headerValue(core::http::kTransferEncoding).empty();
+   }
+
+   void readNextRequest()
+   {
+      // we use a new connection object for the next request (rather than
+      // resetting this one) since handlers may still hold a reference to
+      // this connection and its request
+      boost::shared_ptr<HttpConnectionImpl<ProtocolType> > ptrNext(
+               new HttpConnectionImpl<ProtocolType>(ioService_, handler_));
+      ptrNext->socket_ = std::move(socket_);
+      ptrNext->startReading();
+   }
+
    // async request reading interface
    void readSome()
    {
@@ -187,6 +329,17 @@ private:
                // establish request id
                requestId_ = connection::rstudioRequestIdFromRequest(request_);
 
+               // start timing the request (this includes any time it spends
+               // queued waiting for R to become available)
+               if (core::http::request_metrics::enabled())
+               {
+                  requestStartTime_ =
+                        boost::posix_time::microsec_clock::universal_time();
+                  requestInFlight_ = true;
+                  core::http::request_metrics::requestStarted(
+                                       request_.uri(), request_.body().size());
+               }
+
                // call handler
                handler_(HttpConnectionImpl<ProtocolType>::shared_from_this());
 
@@ -214,12 +367,17 @@ private:
    }
 
 private:
+   boost::asio::io_service& ioService_;
    typename ProtocolType::socket socket_;
    boost::array<char, 8192> buffer_ ;
    core::http::RequestParser requestParser_ ;
    core::http::Request request_;
    std::string requestId_;
    Handler handler_;
+
+   // request metrics state
+   boost::posix_time::ptime requestStartTime_;
+   bool requestInFlight_;
 };
 
 } // namespace session
@@ -271,6 +271,11 @@ private:
       if (connection::checkForSuspend(ptrHttpConnection))
          return;
 
+      // respond directly if the request can be served without the main
+      // thread (e.g. a cached help page while R is busy)
+      if (connection::checkForBackgroundResponse(ptrHttpConnection))
+         return;
+
       // place the connection on the correct queue
       if (connection::isGetEvents(ptrHttpConnection))
          eventsConnectionQueue_.enqueConnection(ptrHttpConnection);
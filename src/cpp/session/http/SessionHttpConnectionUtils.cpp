@@ -16,7 +16,16 @@
 
 #include "SessionHttpConnectionUtils.hpp"
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#endif
+
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <core/FilePath.hpp>
 #include <core/Log.hpp>
@@ -24,6 +33,7 @@
 #include <core/FileSerializer.hpp>
 
 
+#include <core/http/MultipartFormStream.hpp>
 #include <core/http/Response.hpp>
 #include <core/http/Request.hpp>
 
@@ -35,6 +45,8 @@
 #include <session/SessionOptions.hpp>
 #include <session/projects/ProjectsSettings.hpp>
 
+#include "../SessionUriHandlers.hpp"
+
 namespace rstudio {
 namespace session {
 
@@ -57,9 +69,8 @@ void HttpConnection::sendJsonRpcResponse(
    // setup response
    core::http::Response response ;
 
-   // automagic gzip support
-   if (request().acceptsEncoding(core::http::kGzipEncoding))
-      response.setContentEncoding(core::http::kGzipEncoding);
+   // automagic compression support
+   response.negotiateContentEncoding(request());
 
    // set response
    core::json::setJsonRpcResponse(jsonRpcResponse, &response);
@@ -72,6 +83,43 @@ void HttpConnection::sendJsonRpcResponse(
 
 namespace connection {
 
+namespace {
+
+// uploads are parsed on the listener thread, so are written to the system
+// temp directory (rather than R's, which would require calling R)
+core::FilePath uploadFilePath()
+{
+   core::FilePath filePath;
+   core::Error error = core::FilePath::tempFilePath(&filePath);
+   if (error)
+      LOG_ERROR(error);
+   return filePath;
+}
+
+bool writeUploadChunk(boost::shared_ptr<core::http::MultipartFormStream> pForm,
+                      core::http::Request* pRequest,
+                      const std::string& chunk)
+{
+   core::Error error = pForm->write(chunk.data(), chunk.size());
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+
+   // once the form is complete its files belong to the request (and are
+   // removed by the upload handler once they've been used)
+   if (pForm->complete())
+   {
+      pRequest->setFormFields(pForm->fields(), pForm->files());
+      pForm->releaseFiles();
+   }
+
+   return true;
+}
+
+} // anonymous namespace
+
 std::string rstudioRequestIdFromRequest(const core::http::Request& request)
 {
    return request.headerValue("X-RS-RID");
@@ -212,6 +260,47 @@ bool checkForSuspend(boost::shared_ptr<HttpConnection> ptrConnection)
 }
 #endif
 
+bool checkForBackgroundResponse(boost::shared_ptr<HttpConnection> ptrConnection)
+{
+   const core::http::Request& request = ptrConnection->request();
+   if (request.method() != "GET")
+      return false;
+
+   core::http::Response response;
+   if (!uri_handlers::handleInBackground(request, &response))
+      return false;
+
+   ptrConnection->sendResponse(response);
+   return true;
+}
+
+core::http::RequestParser::BodyHandler uploadBodyHandler(
+                                          core::http::Request& request)
+{
+   if (request.method() != "POST" ||
+       !boost::algorithm::starts_with(request.uri(), "/upload"))
+   {
+      return core::http::RequestParser::BodyHandler();
+   }
+
+   std::string contentType = request.headerValue("Content-Type");
+   if (contentType.find("multipart/form-data") != 0)
+      return core::http::RequestParser::BodyHandler();
+
+   // files over the upload limit are discarded as they're received (the
+   // upload handler then reports them as too large)
+   uintmax_t maxFileSize = 0;
+   int mbLimit = session::options().limitFileUploadSizeMb();
+   if (mbLimit > 0)
+      maxFileSize = static_cast<uintmax_t>(mbLimit) * 1024 * 1024;
+
+   boost::shared_ptr<core::http::MultipartFormStream> pForm(
+            new core::http::MultipartFormStream(contentType,
+                                                uploadFilePath,
+                                                maxFileSize));
+   return boost::bind(writeUploadChunk, pForm, &request, _1);
+}
+
 bool authenticate(boost::shared_ptr<HttpConnection> ptrConnection,
                   const std::string& secret)
 {
@@ -223,6 +312,52 @@ bool authenticate(boost::shared_ptr<HttpConnection> ptrConnection,
    return secret == ptrConnection->request().headerValue("X-Shared-Secret");
 }
 
+#ifdef __linux__
+core::Error sendFile(int socket, const core::FilePath& filePath, off_t size)
+{
+   int fd = ::open(filePath.absolutePath().c_str(), O_RDONLY);
+   if (fd == -1)
+   {
+      core::Error error = core::systemError(errno, ERROR_LOCATION);
+      error.addProperty("path", filePath.absolutePath());
+      return error;
+   }
+
+   core::Error error;
+   off_t offset = 0;
+   while (offset < size)
+   {
+      ssize_t bytes = ::sendfile(socket, fd, &offset, size - offset);
+      if (bytes > 0)
+         continue;
+
+      if (bytes == -1 && errno == EINTR)
+         continue;
+
+      // (the socket may be in non-blocking mode if it was read
+      // asynchronously; wait for it to become writable)
+      if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      {
+         struct pollfd pfd;
+         pfd.fd = socket;
+         pfd.events = POLLOUT;
+         if (::poll(&pfd, 1, -1) != -1 || errno == EINTR)
+            continue;
+      }
+
+      // the file was truncated (bytes is 0) or the write failed
+      error = (bytes == 0) ?
+               core::systemError(boost::system::errc::io_error, ERROR_LOCATION) :
+               core::systemError(errno, ERROR_LOCATION);
+      error.addProperty("path", filePath.absolutePath());
+      break;
+   }
+
+   ::close(fd);
+   return error;
+}
+#endif
+
 } // namespace connection
 } // namespace session
 } // namespace rstudio
@@ -22,13 +22,7 @@
 
 #include <boost/function.hpp>
 
-namespace rstudio {
-namespace core {
-namespace http {
-   class Request;
-}
-}
-}
+#include <core/http/RequestParser.hpp>
 
 namespace rstudio {
 namespace session {
@@ -50,9 +44,24 @@ bool checkForAbort(boost::shared_ptr<HttpConnection> ptrConnection,
 
 bool checkForSuspend(boost::shared_ptr<HttpConnection> ptrConnection);
 
+// respond to the request from the listener thread if a background uri
+// handler can (e.g. from a cache) rather than queueing it for the main thread
+bool checkForBackgroundResponse(boost::shared_ptr<HttpConnection> ptrConnection);
+
+// handler which parses the body of a file upload as it's received, writing
+// the uploaded file to disk (empty for other requests)
+core::http::RequestParser::BodyHandler uploadBodyHandler(
+                                          core::http::Request& request);
+
 bool authenticate(boost::shared_ptr<HttpConnection> ptrConnection,
                   const std::string& secret);
 
+#ifdef __linux__
+// write the (first size bytes of the) file to the socket directly from
+// disk, using sendfile; blocks until the file has been written
+core::Error sendFile(int socket, const core::FilePath& filePath, off_t size);
+#endif
+
 
 } // namespace connection
 } // namespace session
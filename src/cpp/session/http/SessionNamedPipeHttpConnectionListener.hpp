@@ -19,7 +19,9 @@
 #include <winsock2.h>
 
 #include <string>
+#include <vector>
 
+#include <boost/function.hpp>
 #include <boost/utility.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -54,18 +56,46 @@
 
 using namespace rstudio::core ;
 
-#define kReadBufferSize 4096
+// size of reads and of the pipe's buffers (larger than a typical request
+// so that most are read in one go, and large enough for responses to be
+// written without waiting on the client)
+#define kPipeBufferSize 65536
+
+// pipe instances kept waiting for clients (so that clients connecting while
+// the listener is busy with another connection don't find the pipe busy)
+#define kPipeInstances 4
+
+// wait for an overlapped operation on the pipe to complete
+inline BOOL waitForPipeIo(HANDLE hPipe,
+                          BOOL result,
+                          OVERLAPPED* pOverlapped,
+                          DWORD* pBytesTransferred)
+{
+   if (!result && ::GetLastError() != ERROR_IO_PENDING)
+      return FALSE;
+
+   return ::GetOverlappedResult(hPipe, pOverlapped, pBytesTransferred, TRUE);
+}
 
 namespace rstudio {
 namespace session {
 
+// note that the pipe is opened for overlapped io, so all reads and writes
+// specify an OVERLAPPED (and wait for it to complete)
 class NamedPipeHttpConnection : public HttpConnection,
                                 boost::noncopyable
 {
 public:
-   explicit NamedPipeHttpConnection(HANDLE hPipe)
-      : hPipe_(hPipe)
+   // the pipe is passed to onDisconnected (to be reused for another
+   // connection) once the connection is closed
+   NamedPipeHttpConnection(HANDLE hPipe,
+                           const boost::function<void(HANDLE)>& onDisconnected)
+      : hPipe_(hPipe), onDisconnected_(onDisconnected)
    {
+      ZeroMemory(&overlapped_, sizeof(overlapped_));
+      overlapped_.hEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+      if (overlapped_.hEvent == NULL)
+         LOG_ERROR(LAST_SYSTEM_ERROR());
    }
 
    virtual ~NamedPipeHttpConnection()
@@ -73,6 +103,9 @@ public:
       try
       {
          close();
+
+         if (overlapped_.hEvent != NULL)
+            ::CloseHandle(overlapped_.hEvent);
       }
       CATCH_UNEXPECTED_EXCEPTION
    }
@@ -80,13 +113,18 @@ public:
    bool readRequest()
    {
       core::http::RequestParser parser;
-      CHAR buff[kReadBufferSize];
+      std::vector<CHAR> buffer(kPipeBufferSize);
+      CHAR* buff = &buffer[0];
       DWORD bytesRead;
 
       while(TRUE)
       {
          // read from pipe
-         BOOL result = ::ReadFile(hPipe_, buff, kReadBufferSize, &bytesRead, NULL);
+         BOOL result = waitForPipeIo(
+                  hPipe_,
+                  ::ReadFile(hPipe_, buff, kPipeBufferSize, NULL, &overlapped_),
+                  &overlapped_,
+                  &bytesRead);
 
          // check for error
          if (!result)
@@ -155,36 +193,50 @@ public:
 
    virtual void sendResponse(const core::http::Response &response)
    {
-      // get the buffers
-      std::vector<boost::asio::const_buffer> buffers =response.toBuffers(
-                                        core::http::Header::connectionClose());
+      // send file responses are written from memory here
+      if (response.isSendFile())
+      {
+         core::http::Response loaded;
+         loaded.assign(response);
+         Error error = loaded.loadSendFile();
+         if (error)
+         {
+            LOG_ERROR(error);
+            loaded.setError(error);
+         }
+         sendResponse(loaded);
+         return;
+      }
 
-      // write them
-      DWORD bytesWritten;
-      for (std::size_t i=0; i<buffers.size(); i++)
+      boost::shared_ptr<core::http::StreamResponse> pStream =
+                                                response.streamResponse();
+      if (!pStream)
       {
-         DWORD bytesToWrite = boost::asio::buffer_size(buffers[i]);
-         BOOL success = ::WriteFile(
-                  hPipe_,
-                  boost::asio::buffer_cast<const unsigned char*>(buffers[i]),
-                  bytesToWrite,
-                  &bytesWritten,
-                  NULL);
+         writeBuffers(response.toBuffers(core::http::Header::connectionClose()));
+         return;
+      }
 
-         if (!success || (bytesWritten != bytesToWrite))
+      // streamed response: write the headers and then each chunk in turn
+      if (!writeBuffers(response.headerBuffers(
+                                    core::http::Header::connectionClose())))
+         return;
+
+      while (!pStream->complete())
+      {
+         std::string chunk;
+         Error error = pStream->nextChunk(&chunk);
+         if (error)
          {
-            // establish error
-            Error error = LAST_SYSTEM_ERROR();
             error.addProperty("request-uri", request_.uri());
-
-            // log the error if it wasn't connection terminated
-            if (!core::http::isConnectionTerminatedError(error))
-               LOG_ERROR(error);
-
-            // close and terminate
+            LOG_ERROR(error);
             close();
-            break;
+            return;
          }
+
+         std::vector<boost::asio::const_buffer> buffers;
+         buffers.push_back(boost::asio::buffer(chunk));
+         if (!writeBuffers(buffers))
+            return;
       }
    }
 
@@ -199,12 +251,18 @@ public:
             LOG_ERROR(LAST_SYSTEM_ERROR());
          }
 
-         if (!::DisconnectNamedPipe(hPipe_))
+         // the pipe can be reused once disconnected (otherwise close it)
+         bool disconnected = ::DisconnectNamedPipe(hPipe_);
+         if (!disconnected)
          {
             LOG_ERROR(LAST_SYSTEM_ERROR());
          }
 
-         if (!::CloseHandle(hPipe_))
+         if (disconnected && onDisconnected_)
+         {
+            onDisconnected_(hPipe_);
+         }
+         else if (!::CloseHandle(hPipe_))
          {
             LOG_ERROR(LAST_SYSTEM_ERROR());
          }
@@ -218,7 +276,45 @@ public:
 
 
 private:
+   bool writeBuffers(const std::vector<boost::asio::const_buffer>& buffers)
+   {
+      DWORD bytesWritten;
+      for (std::size_t i=0; i<buffers.size(); i++)
+      {
+         DWORD bytesToWrite = boost::asio::buffer_size(buffers[i]);
+         BOOL success = waitForPipeIo(
+                  hPipe_,
+                  ::WriteFile(
+                     hPipe_,
+                     boost::asio::buffer_cast<const unsigned char*>(buffers[i]),
+                     bytesToWrite,
+                     NULL,
+                     &overlapped_),
+                  &overlapped_,
+                  &bytesWritten);
+
+         if (!success || (bytesWritten != bytesToWrite))
+         {
+            // establish error
+            Error error = LAST_SYSTEM_ERROR();
+            error.addProperty("request-uri", request_.uri());
+
+            // log the error if it wasn't connection terminated
+            if (!core::http::isConnectionTerminatedError(error))
+               LOG_ERROR(error);
+
+            // close and terminate
+            close();
+            return false;
+         }
+      }
+
+      return true;
+   }
+
    HANDLE hPipe_;
+   boost::function<void(HANDLE)> onDisconnected_;
+   OVERLAPPED overlapped_;
    core::http::Request request_;
    std::string requestId_;
 };
@@ -263,79 +359,207 @@ public:
 
 
 private:
+   // a pipe instance waiting for a client to connect
+   struct PipeInstance
+   {
+      HANDLE hPipe;
+      OVERLAPPED overlapped;
+
+      // the client connected before we started waiting for it
+      bool connected;
+   };
+
    void listenerThread()
    {
       try
       {
+         // keep a pool of instances waiting for clients
+         std::vector<PipeInstance> instances(kPipeInstances);
+         std::vector<HANDLE> events;
+         for (std::size_t i = 0; i < instances.size(); i++)
+         {
+            ZeroMemory(&instances[i].overlapped, sizeof(OVERLAPPED));
+            instances[i].hPipe = INVALID_HANDLE_VALUE;
+            instances[i].connected = false;
+            instances[i].overlapped.hEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+            if (instances[i].overlapped.hEvent == NULL)
+            {
+               LOG_ERROR(LAST_SYSTEM_ERROR());
+               return;
+            }
+            events.push_back(instances[i].overlapped.hEvent);
+
+            listen(&instances[i]);
+         }
+
          while (true)
          {
-            // create security attributes
-            PSECURITY_ATTRIBUTES pSA = NULL;
-            SECURITY_ATTRIBUTES sa;
-            ZeroMemory(&sa, sizeof(sa));
-            sa.nLength = sizeof(sa);
-            sa.lpSecurityDescriptor = NULL;
-            sa.bInheritHandle = FALSE;
-
-            // get login session only descriptor -- proceed without one
-            // if we fail since we don't have 100% assurance this will
-            // work in all configurations and the world ends if we don't
-            // proceed with creating the pipe
-            sa.lpSecurityDescriptor = pipeServerSecurityDescriptor();
-            if (sa.lpSecurityDescriptor)
-               pSA = &sa;
-
-            // set pipe mode, specify rejection of remote clients
-            DWORD dwPipeMode = PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS;
-
-            // create pipe
-            HANDLE hPipe = ::CreateNamedPipeA(pipeName_.c_str(),
-                                              PIPE_ACCESS_DUPLEX,
-                                              dwPipeMode,
-                                              PIPE_UNLIMITED_INSTANCES,
-                                              kReadBufferSize,
-                                              kReadBufferSize,
-                                              0,
-                                              pSA);
-            auto lastError = ::GetLastError(); // capture err before LocalFree
-
-            // free security descriptor if we used one
-            if (pSA)
-               ::LocalFree(pSA->lpSecurityDescriptor);
-
-            // check for error
-            if (hPipe == INVALID_HANDLE_VALUE)
+            // wait for a client to connect to one of the instances
+            DWORD result = ::WaitForMultipleObjects(
+                                 static_cast<DWORD>(events.size()),
+                                 &events[0],
+                                 FALSE,
+                                 INFINITE);
+            if (result >= WAIT_OBJECT_0 + events.size())
             {
-               LOG_ERROR(systemError(lastError, ERROR_LOCATION));
+               LOG_ERROR(LAST_SYSTEM_ERROR());
                continue;
             }
-
-            // attempt to connect
-            BOOL connected = ::ConnectNamedPipe(hPipe, NULL);
-            lastError = ::GetLastError();
-            if (!connected)
+            PipeInstance& instance = instances[result - WAIT_OBJECT_0];
+
+            // take the connected pipe and put another instance in its place
+            HANDLE hPipe = instance.hPipe;
+            DWORD bytes;
+            BOOL connected = hPipe != INVALID_HANDLE_VALUE &&
+                             (instance.connected ||
+                              ::GetOverlappedResult(hPipe,
+                                                    &instance.overlapped,
+                                                    &bytes,
+                                                    FALSE));
+            if (!connected && hPipe != INVALID_HANDLE_VALUE)
             {
-               connected = (lastError == ERROR_PIPE_CONNECTED);
+               LOG_ERROR(LAST_SYSTEM_ERROR());
+               ::CloseHandle(hPipe);
             }
+            instance.hPipe = INVALID_HANDLE_VALUE;
+            listen(&instance);
+
             if (connected)
             {
                // create connection
                boost::shared_ptr<NamedPipeHttpConnection> ptrPipeConnection(
-                                         new NamedPipeHttpConnection(hPipe));
+                  new NamedPipeHttpConnection(
+                     hPipe,
+                     boost::bind(&NamedPipeHttpConnectionListener::reusePipe,
+                                 this,
+                                 _1)));
 
                // if we can successfully read a request then enque it
                if (ptrPipeConnection->readRequest())
                   enqueConnection(ptrPipeConnection);
             }
-            else
-            {
-               LOG_ERROR(systemError(lastError, ERROR_LOCATION));
-            }
          }
       }
       CATCH_UNEXPECTED_EXCEPTION
    }
 
+   // start an instance listening for a client (reusing a disconnected pipe
+   // if there is one); if this fails the instance's event is left signaled
+   // (with no pipe) so that it's retried from the listener's loop
+   void listen(PipeInstance* pInstance)
+   {
+      HANDLE hPipe = INVALID_HANDLE_VALUE;
+      LOCK_MUTEX(mutex_)
+      {
+         if (!disconnectedPipes_.empty())
+         {
+            hPipe = disconnectedPipes_.back();
+            disconnectedPipes_.pop_back();
+         }
+      }
+      END_LOCK_MUTEX
+
+      if (hPipe == INVALID_HANDLE_VALUE)
+         hPipe = createPipe();
+      if (hPipe == INVALID_HANDLE_VALUE)
+      {
+         // (back off so that we don't spin when we can't create pipes)
+         ::Sleep(100);
+         ::SetEvent(pInstance->overlapped.hEvent);
+         return;
+      }
+
+      // (the OVERLAPPED must be cleared for each operation)
+      HANDLE hEvent = pInstance->overlapped.hEvent;
+      ZeroMemory(&pInstance->overlapped, sizeof(OVERLAPPED));
+      pInstance->overlapped.hEvent = hEvent;
+      ::ResetEvent(hEvent);
+
+      pInstance->hPipe = hPipe;
+      pInstance->connected = false;
+      if (!::ConnectNamedPipe(hPipe, &pInstance->overlapped))
+      {
+         DWORD lastError = ::GetLastError();
+         if (lastError == ERROR_PIPE_CONNECTED)
+         {
+            // client connected before we called ConnectNamedPipe
+            pInstance->connected = true;
+            ::SetEvent(hEvent);
+         }
+         else if (lastError != ERROR_IO_PENDING)
+         {
+            LOG_ERROR(systemError(lastError, ERROR_LOCATION));
+            ::CloseHandle(hPipe);
+            pInstance->hPipe = INVALID_HANDLE_VALUE;
+            ::Sleep(100);
+            ::SetEvent(hEvent);
+         }
+      }
+   }
+
+   HANDLE createPipe()
+   {
+      // create security attributes
+      PSECURITY_ATTRIBUTES pSA = NULL;
+      SECURITY_ATTRIBUTES sa;
+      ZeroMemory(&sa, sizeof(sa));
+      sa.nLength = sizeof(sa);
+      sa.lpSecurityDescriptor = NULL;
+      sa.bInheritHandle = FALSE;
+
+      // get login session only descriptor -- proceed without one
+      // if we fail since we don't have 100% assurance this will
+      // work in all configurations and the world ends if we don't
+      // proceed with creating the pipe
+      sa.lpSecurityDescriptor = pipeServerSecurityDescriptor();
+      if (sa.lpSecurityDescriptor)
+         pSA = &sa;
+
+      // set pipe mode, specify rejection of remote clients
+      DWORD dwPipeMode = PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS;
+
+      // create pipe (for overlapped io, so that we can wait for clients
+      // on several instances at once)
+      HANDLE hPipe = ::CreateNamedPipeA(pipeName_.c_str(),
+                                        PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+                                        dwPipeMode,
+                                        PIPE_UNLIMITED_INSTANCES,
+                                        kPipeBufferSize,
+                                        kPipeBufferSize,
+                                        0,
+                                        pSA);
+      auto lastError = ::GetLastError(); // capture err before LocalFree
+
+      // free security descriptor if we used one
+      if (pSA)
+         ::LocalFree(pSA->lpSecurityDescriptor);
+
+      // check for error
+      if (hPipe == INVALID_HANDLE_VALUE)
+         LOG_ERROR(systemError(lastError, ERROR_LOCATION));
+
+      return hPipe;
+   }
+
+   // called (on the thread which closed the connection) with a pipe which
+   // has been disconnected and can be used for another connection
+   void reusePipe(HANDLE hPipe)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         // (we keep no more than we'd use to refill the pool)
+         if (disconnectedPipes_.size() < kPipeInstances)
+         {
+            disconnectedPipes_.push_back(hPipe);
+            return;
+         }
+      }
+      END_LOCK_MUTEX
+
+      if (!::CloseHandle(hPipe))
+         LOG_ERROR(LAST_SYSTEM_ERROR());
+   }
+
    // NOTE: this logic is duplicated btw here and HttpConnectionListenerImpl
 
    void enqueConnection(
@@ -372,6 +596,11 @@ private:
       if (connection::checkForSuspend(ptrHttpConnection))
          return;
 
+      // respond directly if the request can be served without the main
+      // thread (e.g. a cached help page while R is busy)
+      if (connection::checkForBackgroundResponse(ptrHttpConnection))
+         return;
+
       // place the connection on the correct queue
       if (connection::isGetEvents(ptrHttpConnection))
          eventsConnectionQueue_.enqueConnection(ptrHttpConnection);
@@ -494,6 +723,8 @@ private:
 private:
    std::string pipeName_;
    std::string secret_;
+   boost::mutex mutex_;
+   std::vector<HANDLE> disconnectedPipes_;
    HttpConnectionQueue mainConnectionQueue_;
    HttpConnectionQueue eventsConnectionQueue_;
 };
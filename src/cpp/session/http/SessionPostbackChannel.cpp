@@ -0,0 +1,252 @@
+/*
+ * SessionPostbackChannel.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <session/http/SessionPostbackChannel.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <core/Log.hpp>
+#include <core/Thread.hpp>
+
+#include <core/http/Request.hpp>
+#include <core/http/Response.hpp>
+#include <core/http/SocketUtils.hpp>
+
+#include <core/system/System.hpp>
+
+#include <session/SessionHttpConnection.hpp>
+#include <session/SessionHttpConnectionListener.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace http {
+
+namespace {
+
+// postbacks are small, so cap their size so that a misbehaving client
+// can't exhaust the session's memory
+const std::size_t kMaxRequestSize = 1024 * 1024;
+
+std::string s_token;
+
+// the result of a postback, which the handler of the postback delivers to
+// the thread of the channel connection it arrived on
+class PostbackResult : boost::noncopyable
+{
+public:
+   PostbackResult()
+      : complete_(false), exitCode_(EXIT_FAILURE)
+   {
+   }
+
+   void complete(int exitCode, const std::string& output)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         if (complete_)
+            return;
+
+         complete_ = true;
+         exitCode_ = exitCode;
+         output_ = output;
+      }
+      END_LOCK_MUTEX
+
+      completed_.notify_all();
+   }
+
+   void wait(int* pExitCode, std::string* pOutput)
+   {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (!complete_)
+         completed_.wait(lock);
+
+      *pExitCode = exitCode_;
+      pOutput->swap(output_);
+   }
+
+private:
+   boost::mutex mutex_;
+   boost::condition completed_;
+   bool complete_;
+   int exitCode_;
+   std::string output_;
+};
+
+// a postback as a connection on the main connection queue, so that it's
+// handled exactly as those sent by rpostback are
+class PostbackConnection : public HttpConnection
+{
+public:
+   PostbackConnection(const std::string& command,
+                      const std::string& argument,
+                      const boost::shared_ptr<PostbackResult>& pResult)
+      : pResult_(pResult)
+   {
+      request_.setMethod("POST");
+      request_.setUri(kLocalUriLocationPrefix kPostbackUriScope + command);
+      request_.setHeader("X-Session-Postback", "1");
+      request_.setBody(argument);
+   }
+
+   virtual ~PostbackConnection()
+   {
+      // if the postback was dropped without a response then it failed
+      pResult_->complete(EXIT_FAILURE, std::string());
+   }
+
+   virtual const core::http::Request& request() { return request_; }
+
+   virtual void sendResponse(const core::http::Response& response)
+   {
+      std::string exitCode = response.headerValue(kPostbackExitCodeHeader);
+      pResult_->complete(safe_convert::stringTo<int>(exitCode, EXIT_FAILURE),
+                         response.body());
+   }
+
+   virtual void close()
+   {
+      pResult_->complete(EXIT_FAILURE, std::string());
+   }
+
+   virtual std::string requestId() const { return std::string(); }
+
+   virtual bool preauthenticated() const { return true; }
+
+private:
+   core::http::Request request_;
+   boost::shared_ptr<PostbackResult> pResult_;
+};
+
+// read the next (null terminated) field of a postback. returns false when
+// the client has closed the connection (or broken the protocol)
+bool readField(boost::asio::ip::tcp::socket& socket,
+               boost::asio::streambuf* pBuffer,
+               std::string* pField)
+{
+   boost::system::error_code ec;
+   boost::asio::read_until(socket, *pBuffer, '\0', ec);
+   if (ec)
+   {
+      if (ec != boost::asio::error::eof)
+         LOG_ERROR(Error(ec, ERROR_LOCATION));
+      return false;
+   }
+
+   std::istream bufferStream(pBuffer);
+   std::getline(bufferStream, *pField, '\0');
+   return true;
+}
+
+void handleConnection(boost::shared_ptr<boost::asio::ip::tcp::socket> pSocket)
+{
+   boost::asio::streambuf buffer(kMaxRequestSize);
+   std::string token, command, argument;
+   while (readField(*pSocket, &buffer, &token) &&
+          readField(*pSocket, &buffer, &command) &&
+          readField(*pSocket, &buffer, &argument))
+   {
+      if (token != s_token)
+      {
+         LOG_WARNING_MESSAGE("Postback with an invalid token");
+         return;
+      }
+
+      // queue the postback and wait for its handler to complete
+      boost::shared_ptr<PostbackResult> pResult(new PostbackResult());
+      httpConnectionListener().mainConnectionQueue().enqueConnection(
+         boost::shared_ptr<HttpConnection>(
+                  new PostbackConnection(command, argument, pResult)));
+
+      int exitCode;
+      std::string output;
+      pResult->wait(&exitCode, &output);
+
+      std::string response = safe_convert::numberToString(exitCode) + '\0' +
+                              safe_convert::numberToString(output.size()) +
+                              '\0' + output;
+      boost::system::error_code ec;
+      boost::asio::write(*pSocket, boost::asio::buffer(response), ec);
+      if (ec)
+      {
+         if (!core::http::isConnectionTerminatedError(Error(ec, ERROR_LOCATION)))
+            LOG_ERROR(Error(ec, ERROR_LOCATION));
+         return;
+      }
+   }
+}
+
+void acceptConnections(
+         boost::shared_ptr<boost::asio::io_service> pIoService,
+         boost::shared_ptr<boost::asio::ip::tcp::acceptor> pAcceptor)
+{
+   while (true)
+   {
+      boost::shared_ptr<boost::asio::ip::tcp::socket> pSocket(
+                  new boost::asio::ip::tcp::socket(*pIoService));
+
+      boost::system::error_code ec;
+      pAcceptor->accept(*pSocket, ec);
+      if (ec)
+      {
+         // stop accepting (postbacks then fall back on rpostback)
+         LOG_ERROR(Error(ec, ERROR_LOCATION));
+         return;
+      }
+
+      core::thread::safeLaunchThread(boost::bind(handleConnection, pSocket));
+   }
+}
+
+} // anonymous namespace
+
+Error startPostbackChannel()
+{
+   using namespace boost::asio;
+
+   boost::shared_ptr<io_service> pIoService(new io_service());
+   boost::shared_ptr<ip::tcp::acceptor> pAcceptor(
+                                       new ip::tcp::acceptor(*pIoService));
+   try
+   {
+      ip::tcp::endpoint endpoint(ip::address_v4::loopback(), 0);
+      pAcceptor->open(endpoint.protocol());
+      pAcceptor->bind(endpoint);
+      pAcceptor->listen();
+      endpoint = pAcceptor->local_endpoint();
+
+      s_token = core::system::generateUuid(false);
+      core::system::setenv(kPostbackChannelPortEnvVar,
+                           safe_convert::numberToString(endpoint.port()));
+      core::system::setenv(kPostbackChannelTokenEnvVar, s_token);
+   }
+   catch (const boost::system::system_error& e)
+   {
+      return Error(e.code(), ERROR_LOCATION);
+   }
+
+   core::thread::safeLaunchThread(
+            boost::bind(acceptConnections, pIoService, pAcceptor));
+
+   return Success();
+}
+
+} // namespace http
+} // namespace session
+} // namespace rstudio
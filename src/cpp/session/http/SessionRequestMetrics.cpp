@@ -0,0 +1,117 @@
+/*
+ * SessionRequestMetrics.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <session/SessionRequestMetrics.hpp>
+
+#include <core/Error.hpp>
+#include <core/FileLock.hpp>
+#include <core/FilePath.hpp>
+#include <core/Log.hpp>
+#include <core/Thread.hpp>
+
+#include <core/http/RequestMetrics.hpp>
+
+#include <monitor/MonitorClient.hpp>
+
+#include <session/SessionModuleContext.hpp>
+#include <session/SessionOptions.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace request_metrics {
+
+namespace {
+
+void reportMetrics()
+{
+   int intervalSeconds = std::max(options().monitorIntervalSeconds(), 1);
+   while (true)
+   {
+      boost::this_thread::sleep(boost::posix_time::seconds(intervalSeconds));
+
+      std::vector<http::request_metrics::PrefixStats> stats =
+                                          http::request_metrics::collect();
+      if (!stats.empty())
+      {
+         monitor::client().sendMultiMetrics(monitor::metrics::requestMetrics(
+                                                      "rsession.requests",
+                                                      intervalSeconds,
+                                                      stats));
+      }
+
+      FileLock::AcquisitionStats lockStats = FileLock::collectAcquisitionStats();
+      std::size_t attempts = lockStats.acquired + lockStats.failed;
+      if (attempts > 0)
+      {
+         using namespace monitor::metrics;
+         std::vector<MetricData> data;
+         data.push_back(MetricData("acquired", lockStats.acquired));
+         data.push_back(MetricData("failed", lockStats.failed));
+         data.push_back(MetricData("mean_ms", lockStats.totalMs / attempts));
+         data.push_back(MetricData("max_ms", lockStats.maxMs));
+         monitor::client().sendMultiMetrics(std::vector<MultiMetric>(
+                  1, MultiMetric("rsession.file_locks", intervalSeconds, data)));
+      }
+
+      // filesystem operations (for sessions whose home and scratch
+      // directories are on network filesystems, each is a round trip)
+      FilePath::OperationStats fileStats = FilePath::collectOperationStats();
+      {
+         using namespace monitor::metrics;
+         std::vector<MetricData> data;
+         data.push_back(MetricData("queries", fileStats.queries));
+         data.push_back(MetricData("listings", fileStats.listings));
+         data.push_back(MetricData("opens", fileStats.opens));
+         data.push_back(MetricData("changes", fileStats.changes));
+         monitor::client().sendMultiMetrics(std::vector<MultiMetric>(
+                  1, MultiMetric("rsession.file_operations", intervalSeconds, data)));
+      }
+
+      // time spent in scheduled (idle) work, by task
+      typedef std::map<std::string, WorkScheduler::TaskStats> WorkStats;
+      WorkStats workStats = module_context::collectScheduledWorkStats();
+      if (!workStats.empty())
+      {
+         using namespace monitor::metrics;
+         std::vector<MetricData> data;
+         for (WorkStats::const_iterator it = workStats.begin();
+              it != workStats.end();
+              ++it)
+         {
+            data.push_back(MetricData(it->first + "_executions",
+                                      it->second.executions));
+            data.push_back(MetricData(it->first + "_ms", it->second.totalMs));
+            data.push_back(MetricData(it->first + "_max_ms", it->second.maxMs));
+         }
+         monitor::client().sendMultiMetrics(std::vector<MultiMetric>(
+                  1, MultiMetric("rsession.scheduled_work", intervalSeconds, data)));
+      }
+   }
+}
+
+} // anonymous namespace
+
+Error initialize()
+{
+   http::request_metrics::setEnabled(true);
+   core::thread::safeLaunchThread(reportMetrics);
+   return Success();
+}
+
+} // namespace request_metrics
+} // namespace session
+} // namespace rstudio
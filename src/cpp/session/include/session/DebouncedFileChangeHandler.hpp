@@ -0,0 +1,174 @@
+/*
+ * DebouncedFileChangeHandler.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_DEBOUNCED_FILE_CHANGE_HANDLER_HPP
+#define SESSION_DEBOUNCED_FILE_CHANGE_HANDLER_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/system/FileChangeEvent.hpp>
+#include <core/system/FileChangeBatch.hpp>
+
+#include <session/SessionModuleContext.hpp>
+
+namespace rstudio {
+namespace session {
+
+// Collects file changes from a file monitor and delivers them as a single
+// collapsed batch once changes have stopped arriving for the quiet period
+// (or the batch has been pending for the maximum delay). This keeps bulk
+// operations like a git checkout from turning into a long series of small
+// batches, each of which every subscriber reacts to separately.
+class DebouncedFileChangeHandler
+   : boost::noncopyable,
+     public boost::enable_shared_from_this<DebouncedFileChangeHandler>
+{
+public:
+   typedef boost::function<void(
+         const std::vector<core::system::FileChangeEvent>&)> Handler;
+
+   static boost::shared_ptr<DebouncedFileChangeHandler> create(
+         Handler handler,
+         boost::posix_time::time_duration quietPeriod =
+                                    boost::posix_time::milliseconds(250),
+         boost::posix_time::time_duration maxDelay =
+                                    boost::posix_time::seconds(2))
+   {
+      return boost::shared_ptr<DebouncedFileChangeHandler>(
+               new DebouncedFileChangeHandler(handler, quietPeriod, maxDelay));
+   }
+
+   virtual ~DebouncedFileChangeHandler()
+   {
+   }
+
+   // COPYING: prohibited
+
+   void enqueFileChanges(
+                  const std::vector<core::system::FileChangeEvent>& events)
+   {
+      if (events.empty())
+         return;
+
+      batch_.add(events);
+
+      boost::posix_time::ptime now = currentTime();
+      lastChangeTime_ = now;
+      if (firstChangeTime_.is_not_a_date_time())
+         firstChangeTime_ = now;
+
+      if (!scheduled_)
+         scheduleCheck(quietPeriod_);
+   }
+
+   // deliver any pending changes now
+   void flush()
+   {
+      firstChangeTime_ = boost::posix_time::ptime();
+      if (batch_.empty())
+         return;
+
+      std::vector<core::system::FileChangeEvent> events;
+      batch_.take(&events);
+      if (!events.empty())
+         handler_(events);
+   }
+
+   // discard any pending changes
+   void clear()
+   {
+      batch_.clear();
+      firstChangeTime_ = boost::posix_time::ptime();
+   }
+
+private:
+   DebouncedFileChangeHandler(Handler handler,
+                              boost::posix_time::time_duration quietPeriod,
+                              boost::posix_time::time_duration maxDelay)
+      : handler_(handler),
+        quietPeriod_(quietPeriod),
+        maxDelay_(maxDelay),
+        scheduled_(false)
+   {
+   }
+
+   static boost::posix_time::ptime currentTime()
+   {
+      return boost::posix_time::microsec_clock::universal_time();
+   }
+
+   void scheduleCheck(boost::posix_time::time_duration period)
+   {
+      // we may be discarded while the check is pending
+      scheduled_ = true;
+      boost::weak_ptr<DebouncedFileChangeHandler> pWeak = shared_from_this();
+      module_context::scheduleDelayedWork(
+            period,
+            boost::bind(&DebouncedFileChangeHandler::checkPendingIfAlive, pWeak),
+            false);
+   }
+
+   static void checkPendingIfAlive(
+         boost::weak_ptr<DebouncedFileChangeHandler> pWeak)
+   {
+      boost::shared_ptr<DebouncedFileChangeHandler> pHandler = pWeak.lock();
+      if (pHandler)
+         pHandler->checkPending();
+   }
+
+   void checkPending()
+   {
+      scheduled_ = false;
+      if (batch_.empty())
+         return;
+
+      // wait for things to settle down (but not indefinitely)
+      boost::posix_time::ptime now = currentTime();
+      boost::posix_time::time_duration quiet = now - lastChangeTime_;
+      boost::posix_time::time_duration pending = now - firstChangeTime_;
+      if (quiet < quietPeriod_ && pending < maxDelay_)
+      {
+         scheduleCheck(std::min(quietPeriod_ - quiet, maxDelay_ - pending));
+         return;
+      }
+
+      flush();
+   }
+
+private:
+   Handler handler_;
+   boost::posix_time::time_duration quietPeriod_;
+   boost::posix_time::time_duration maxDelay_;
+
+   core::system::FileChangeBatch batch_;
+   boost::posix_time::ptime firstChangeTime_;
+   boost::posix_time::ptime lastChangeTime_;
+   bool scheduled_;
+};
+
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_DEBOUNCED_FILE_CHANGE_HANDLER_HPP
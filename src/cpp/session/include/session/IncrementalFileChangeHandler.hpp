@@ -112,6 +112,12 @@ public:
       queue_ = std::queue<core::system::FileChangeEvent>();
    }
 
+   // are there queued changes which haven't yet been processed
+   bool hasPendingWork() const
+   {
+      return !queue_.empty();
+   }
+
 private:
 
    void scheduleProcessing(boost::posix_time::time_duration delayPeriod)
@@ -37,7 +37,16 @@ enum AsyncRProcessOptions
    R_PROCESS_REDIRECTSTDERR = 1 << 1,
    R_PROCESS_VANILLA        = 1 << 2,
    R_PROCESS_AUGMENTED      = 1 << 3,
-   R_PROCESS_NO_RDATA       = 1 << 4
+   R_PROCESS_NO_RDATA       = 1 << 4,
+
+   // run in one of a small pool of helper R processes which are kept
+   // running between tasks, when one is free (rather than starting R for
+   // the task). the process is shared with earlier tasks (packages they
+   // loaded stay loaded), so only tasks which don't depend on a fresh
+   // process should ask for this. it's only honored for vanilla processes
+   // which are given no environment or input, and onStarted isn't called
+   // for tasks run this way
+   R_PROCESS_POOLED         = 1 << 5
 };
 
 inline AsyncRProcessOptions operator | (AsyncRProcessOptions lhs,
@@ -47,6 +56,8 @@ inline AsyncRProcessOptions operator | (AsyncRProcessOptions lhs,
             static_cast<int>(lhs) | static_cast<int>(rhs));
 }
 
+class AsyncRWorker;
+
 class AsyncRProcess :
       boost::noncopyable,
       public boost::enable_shared_from_this<AsyncRProcess>
@@ -74,6 +85,10 @@ public:
                  std::vector<core::FilePath>(),
               const std::string& input = std::string());
 
+   // write input to a running process (and close its standard input); the
+   // input is written the next time the process is polled
+   void writeInput(const std::string& input);
+
    bool isRunning();
    void terminate();
    void markCompleted();
@@ -88,10 +103,15 @@ protected:
    virtual void onCompleted(int exitStatus) = 0;
 
 private:
+   friend class AsyncRWorker;
+
    void onProcessCompleted(int exitStatus);
+   bool onProcessContinue(core::system::ProcessOperations& operations);
    bool isRunning_;
    bool terminationRequested_;
    std::string input_;
+   std::string pendingInput_;
+   bool hasPendingInput_;
 };
 
 } // namespace async_r
@@ -19,6 +19,7 @@
 #include <string>
 
 #include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <core/BoostThread.hpp>
 
@@ -34,6 +35,29 @@ namespace core {
 namespace rstudio {
 namespace session {
 
+namespace console_process {
+   class ConsoleProcessSocket;
+}
+
+// Client events are ordinarily delivered by long polling (the client makes
+// a get_events request which we hold open until events are available). If
+// the session-websocket-client-events option is enabled the events can
+// instead be pushed over a WebSocket as soon as they are enqueued:
+//
+//   - the client connects to <port>/events/<client-id>/ (where port is
+//     published as client_events_websocket_port in the session info)
+//   - once connected the client sends a text packet containing the id of
+//     the last event it has seen; we reply with any undelivered events
+//     and from then on push each batch of events as a json array (in the
+//     same format as the get_events result)
+//   - the client acknowledges receipt by sending the id of the last event
+//     it has processed
+//
+// Unacknowledged events are retained so that if the WebSocket closes the
+// client can fall back to long polling without losing any events (the
+// client ignores any event it has already seen, since an event can be sent
+// by both transports around a switch between them).
+
 // singleton
 class ClientEventService;
 ClientEventService& clientEventService();
@@ -41,7 +65,13 @@ ClientEventService& clientEventService();
 class ClientEventService : boost::noncopyable
 {
 private:
-   ClientEventService() {}
+   ClientEventService()
+      : webSocketConnected_(false),
+        webSocketReady_(false),
+        webSocketResync_(false),
+        webSocketLastEventIdSeen_(-1)
+   {
+   }
    friend ClientEventService& clientEventService();
 
 public:
@@ -54,10 +84,24 @@ public:
 
    std::string clientId();
 
+   // port of the WebSocket over which events are pushed to the client
+   // (0 if events are delivered only via long polling)
+   int webSocketPort();
+
 private:
    void run();
 
+   void startWebSocket();
+   void listenOnWebSocket(const std::string& previousClientId,
+                          const std::string& clientId);
+   void onWebSocketOpened();
+   void onWebSocketClosed();
+   void onWebSocketInput(const std::string& input);
+   bool webSocketReady(bool* pResyncPending);
+   void pushEvents(int* pNextEventId);
+
    void erasePreviouslyDeliveredEvents(int lastClientEventIdSeen);
+   void eraseEventsSeen(int lastClientEventIdSeen);
    bool havePendingClientEvents();
    void addClientEvent(const core::json::Object& eventObject);
    void setClientEventResult(core::json::JsonRpcResponse* pResponse);
@@ -69,6 +113,13 @@ private:
 
    std::string clientId_ ;
    core::json::Array clientEvents_ ;
+
+   // WebSocket transport
+   boost::shared_ptr<console_process::ConsoleProcessSocket> pWebSocket_;
+   bool webSocketConnected_;
+   bool webSocketReady_;
+   bool webSocketResync_;
+   int webSocketLastEventIdSeen_;
 };
    
   
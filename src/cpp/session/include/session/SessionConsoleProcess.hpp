@@ -148,6 +148,9 @@ public:
 
    boost::signal<void(int)>& onExit() { return onExit_; }
 
+   // output as it arrives from the process (not split into lines)
+   boost::signal<void(const std::string&)>& onOutput() { return onOutput_; }
+
    std::string handle() const { return procInfo_->getHandle(); }
    InteractionMode interactionMode() const { return procInfo_->getInteractionMode(); }
 
@@ -173,6 +176,8 @@ public:
    std::string getChannelMode() const;
    int getTerminalSequence() const { return procInfo_->getTerminalSequence(); }
    int getBufferLineCount() const { return procInfo_->getBufferLineCount(); }
+   std::size_t memoryUsage() const { return procInfo_->memoryUsage(); }
+   void releaseSavedBuffer() const { procInfo_->releaseSavedBuffer(); }
    int getCols() const { return procInfo_->getCols(); }
    int getRows() const { return procInfo_->getRows(); }
    PidType getPid() const { return pid_; }
@@ -265,6 +270,7 @@ private:
 
    boost::function<bool(const std::string&, Input*)> onPrompt_;
    boost::signal<void(int)> onExit_;
+   boost::signal<void(const std::string&)> onOutput_;
 
    // regex for prompt detection
    boost::regex controlCharsPattern_;
@@ -22,6 +22,7 @@
 #include <core/json/Json.hpp>
 #include <core/system/Process.hpp>
 #include <core/system/Types.hpp>
+#include <core/text/LineRingBuffer.hpp>
 
 #include <session/SessionTerminalShell.hpp>
 
@@ -117,7 +118,7 @@ public:
    void setInteractionMode(InteractionMode mode) { interactionMode_ = mode; }
    InteractionMode getInteractionMode() const { return interactionMode_; }
 
-   void setMaxOutputLines(int maxOutputLines) { maxOutputLines_ = maxOutputLines; }
+   void setMaxOutputLines(int maxOutputLines);
    int getMaxOutputLines() const { return maxOutputLines_; }
 
    void setShowOnOutput(bool showOnOutput) { showOnOutput_ = showOnOutput; }
@@ -131,6 +132,13 @@ public:
    std::string getSavedBufferChunk(int chunk, bool* pMoreAvailable) const;
    std::string getFullSavedBuffer() const;
    int getBufferLineCount() const;
+
+   // bytes held in memory for the output and saved buffers
+   std::size_t memoryUsage() const;
+
+   // drop the in-memory copy of the saved buffer (it's reloaded from disk
+   // when next needed)
+   void releaseSavedBuffer() const { invalidateSavedBuffer(); }
    void deleteLogFile(bool lastLineOnly = false) const;
    void deleteEnvFile() const;
    void saveConsoleEnvironment(const core::system::Options& environment);
@@ -198,6 +206,11 @@ public:
    static void saveConsoleProcesses(const std::string& metadata);
    static void loadConsoleEnvironment(const std::string& handle, core::system::Options* pEnv);
 
+private:
+   // terminal buffer as saved to disk, trimmed to maxOutputLines_
+   const core::text::LineRingBuffer& savedBuffer() const;
+   void invalidateSavedBuffer() const;
+
 private:
    std::string caption_;
    std::string title_;
@@ -221,6 +234,13 @@ private:
    AutoCloseMode autoClose_ = DefaultAutoClose;
    bool zombie_ = false;
    bool trackEnv_ = false;
+
+   // in-memory copy of the saved terminal buffer, loaded on first use; the
+   // file size is checked on each read so changes made elsewhere are noticed
+   mutable core::text::LineRingBuffer savedBuffer_;
+   mutable bool savedBufferLoaded_ = false;
+   mutable bool savedBufferTrimmed_ = false;
+   mutable uintmax_t savedBufferFileSize_ = 0;
 };
 
 } // namespace console_process
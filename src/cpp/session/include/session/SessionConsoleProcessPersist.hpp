@@ -15,6 +15,8 @@
 #ifndef SESSION_CONSOLE_PROCESS_PERSIST_HPP
 #define SESSION_CONSOLE_PROCESS_PERSIST_HPP
 
+#include <stdint.h>
+
 #include <string>
 
 #include <core/system/Types.hpp>
@@ -47,8 +49,23 @@ std::string getSavedBuffer(const std::string& handle, int maxLines);
 // buffer will be trimmed to max number of lines and rewritten.
 int getSavedBufferLineCount(const std::string& handle, int maxLines);
 
-// Add to the saved buffer for the given ConsoleProcess
-void appendToOutputBuffer(const std::string& handle, const std::string& buffer);
+// Add to the saved buffer for the given ConsoleProcess. The write happens
+// on a background thread, which also trims the file to maxLines (if
+// greater than zero) from time to time; the functions below which read or
+// replace a saved buffer wait for pending writes first.
+void appendToOutputBuffer(const std::string& handle,
+                          const std::string& buffer,
+                          int maxLines = 0);
+
+// Wait for all pending writes to saved buffers to complete
+void flushOutputBuffers();
+
+// Replace the saved buffer for the given ConsoleProcess
+void saveOutputBuffer(const std::string& handle, const std::string& buffer);
+
+// Size in bytes of the saved buffer for the given ConsoleProcess (zero if
+// nothing has been saved)
+uintmax_t getSavedBufferSize(const std::string& handle);
 
 // Delete the persisted saved buffer for the given ConsoleProcess
 void deleteLogFile(const std::string& handle, bool lastLineOnly = false);
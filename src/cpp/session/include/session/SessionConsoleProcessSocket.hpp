@@ -15,6 +15,7 @@
 #ifndef SESSION_CONSOLE_PROCESS_SOCKET_HPP
 #define SESSION_CONSOLE_PROCESS_SOCKET_HPP
 
+#include <map>
 #include <string>
 
 #ifdef _WIN32
@@ -80,7 +81,10 @@ struct ConsoleProcessSocketConnectionDetails
 class ConsoleProcessSocket : boost::noncopyable
 {
 public:
-   ConsoleProcessSocket();
+   // useTerminalPort indicates whether to bind to the user-specified
+   // terminal port (if any); other users of the socket (e.g. the client
+   // event service) always bind to a random port
+   explicit ConsoleProcessSocket(bool useTerminalPort = true);
    ~ConsoleProcessSocket();
 
    // start the websocket servicing thread
@@ -105,6 +109,12 @@ public:
    core::Error sendText(const std::string& terminalHandle,
                         const std::string& message);
 
+   // queue text to be sent to client in a text packet; output queued for a
+   // terminal in quick succession is coalesced into a single packet, which
+   // is sent after a short delay (or at once if the queue grows large)
+   core::Error enqueText(const std::string& terminalHandle,
+                         const std::string& message);
+
    // send keepalive response to client; we're not using low-level WebSocket
    // ping/pong as that isn't accessible from JavaScript apps; so we're just doing a
    // simple message exchange to keep proxies from killing an idle terminal
@@ -126,15 +136,26 @@ private:
 
    void onServerTimeout(boost::system::error_code ec);
 
+   void flushQueuedText();
+   void onFlushTimer(const websocketpp::lib::error_code& ec);
+
 private:
    core::thread::ThreadsafeMap<std::string, ConsoleProcessSocketConnectionDetails> connections_;
 
    int port_;
+   bool useTerminalPort_;
    boost::thread websocketThread_;
    bool serverRunning_;
    boost::shared_ptr<terminalServer> pwsServer_;
 
    int activeConnections_;
+
+   // text queued by enqueText, by terminal handle; flushes are serialized
+   // so a terminal's output can't be sent out of order
+   boost::mutex flushMutex_;
+   boost::mutex queuedTextMutex_;
+   std::map<std::string, std::string> queuedText_;
+   bool flushScheduled_;
 };
 
 } // namespace console_process
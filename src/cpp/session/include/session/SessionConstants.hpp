@@ -62,15 +62,21 @@
 #define kTimeoutSessionOption             "session-timeout-minutes"
 #define kTimeoutSuspendSessionOption      "session-timeout-suspend"
 #define kDisconnectedTimeoutSessionOption "session-disconnected-timeout-minutes"
+#define kLowMemorySessionOption           "session-low-memory-mb"
+#define kTraceSampleRateSessionOption     "session-trace-sample-rate"
+#define kTraceDirSessionOption            "session-trace-dir"
+#define kLocalScratchDirSessionOption     "session-local-scratch-dir"
 
 #define kVerifySignaturesSessionOption    "verify-signatures"
 #define kStandaloneSessionOption          "standalone"
 #define kWwwAddressSessionOption          "www-address"
 #define kWwwPortSessionOption             "www-port"
+#define kWwwCompressionLevelSessionOption "www-compression-level"
 #define kTerminalPortOption               "terminal-port"
 
 #define kWebSocketPingInterval            "websocket-ping-seconds"
 #define kWebSocketConnectTimeout          "websocket-connect-timeout"
+#define kWebSocketClientEvents            "websocket-client-events"
 
 #define kPackageOutputInPackageFolder     "package-output-to-package-folder"
 
@@ -80,6 +86,10 @@
 #define kPostbackUriScope                 "postback/"
 #define kPostbackExitCodeHeader           "X-Postback-ExitCode"
 
+// the session's postback channel (see SessionPostbackChannel.hpp)
+#define kPostbackChannelPortEnvVar        "RS_POSTBACK_PORT"
+#define kPostbackChannelTokenEnvVar       "RS_POSTBACK_TOKEN"
+
 #define kMonitoredPath      "monitored"
 #define kListsPath          "lists"
 #define kProjectMruList     "project_mru"
@@ -74,6 +74,10 @@ public:
 
    // other useful introspection methods
    virtual std::string requestId() const = 0;
+
+   // whether the request was authenticated by the channel it arrived on
+   // (so needn't be signed)
+   virtual bool preauthenticated() const { return false; }
 };
 
 
@@ -0,0 +1,50 @@
+/*
+ * SessionLocalScratch.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_LOCAL_SCRATCH_HPP
+#define SESSION_LOCAL_SCRATCH_HPP
+
+namespace rstudio {
+namespace core {
+   class FilePath;
+}
+}
+
+namespace rstudio {
+namespace session {
+namespace local_scratch {
+
+// Scratch directories which are written often (caches of the session) can
+// be kept on local disk rather than in the user's scratch path, which is
+// frequently on network storage. When a local scratch directory is
+// configured (see kLocalScratchDirSessionOption) the scratch directory is
+// copied there when first used, and the copy is written back when the
+// session suspends or exits. Returns the directory to use in place of the
+// scratch directory (which is the scratch directory itself when no local
+// scratch directory is configured).
+//
+// Only directories used by this session alone should be placed on local
+// disk, and only data which can be lost should the session crash.
+core::FilePath localPath(const core::FilePath& scratchPath);
+
+// write local copies back to their scratch directories (and remove them);
+// directories requested after this are no longer placed on local disk
+void writeBack();
+
+} // namespace local_scratch
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_LOCAL_SCRATCH_HPP
@@ -17,6 +17,7 @@
 #ifndef SESSION_MODULE_CONTEXT_HPP
 #define SESSION_MODULE_CONTEXT_HPP
 
+#include <map>
 #include <string>
 
 #include <boost/utility.hpp>
@@ -33,6 +34,7 @@
 #include <core/r_util/RToolsInfo.hpp>
 #include <core/r_util/RActiveSessions.hpp>
 #include <core/Thread.hpp>
+#include <core/WorkScheduler.hpp>
 
 #include <session/SessionOptions.hpp>
 #include <session/SessionClientEvent.hpp>
@@ -189,6 +191,18 @@ core::Error registerUriHandler(
                         const std::string& name,
                         const core::http::UriHandlerFunction& handlerFunction);
 
+// register a handler which may respond to requests for the uri from the
+// connection listener thread, so that it can do so even while R is busy.
+// it returns false to leave the request to the handler registered with
+// registerUriHandler. it must not call R or use state owned by the main
+// thread
+typedef boost::function<bool(const core::http::Request&,
+                             core::http::Response*)>
+                                          BackgroundUriHandlerFunction;
+core::Error registerBackgroundUriHandler(
+                     const std::string& name,
+                     const BackgroundUriHandlerFunction& handlerFunction);
+
 // register a local uri handler (scoped by a special prefix which indicates
 // a local scope)
 core::Error registerAsyncLocalUriHandler(
@@ -343,6 +357,7 @@ struct Events : boost::noncopyable
    boost::signal<void (const std::string&)>  onPackageLoaded;
    boost::signal<void ()>                    onPackageLibraryMutated;
    boost::signal<void ()>                    onPreferencesSaved;
+   boost::signal<void ()>                    onLowMemory;
    boost::signal<void (const server_core::DistributedEvent&)>
                                              onDistributedEvent;
    boost::signal<void (core::FilePath)>      onPermissionsChanged;
@@ -367,11 +382,15 @@ core::system::ProcessSupervisor& processSupervisor();
 // and then bind one of its members as the execute parameter. passing
 // true as the idleOnly parameter (the default) means that the execute
 // function will only be called back during idle time (when the session
-// is waiting for user input)
+// is waiting for user input). all scheduled work shares a single budget
+// per period (see core::WorkScheduler): higher priority work goes first,
+// and the time spent is reported under the given name
 void scheduleIncrementalWork(
          const boost::posix_time::time_duration& incrementalDuration,
          const boost::function<bool()>& execute,
-         bool idleOnly = true);
+         bool idleOnly = true,
+         core::WorkPriority priority = core::WorkPriorityNormal,
+         const std::string& name = "incremental");
 
 // variation of scheduleIncrementalWork which performs a configurable
 // amount of work immediately. this work occurs synchronously with the
@@ -381,7 +400,13 @@ void scheduleIncrementalWork(
          const boost::posix_time::time_duration& initialDuration,
          const boost::posix_time::time_duration& incrementalDuration,
          const boost::function<bool()>& execute,
-         bool idleOnly = true);
+         bool idleOnly = true,
+         core::WorkPriority priority = core::WorkPriorityNormal,
+         const std::string& name = "incremental");
+
+// the time spent in scheduled work (by name) since last collected (may be
+// called from any thread)
+std::map<std::string, core::WorkScheduler::TaskStats> collectScheduledWorkStats();
 
 
 // schedule work to done every time the specified period elapses.
@@ -430,6 +455,11 @@ bool isRScriptInPackageBuildTarget(const core::FilePath& filePath);
 // convenience method for filtering out file listing and changes
 bool fileListingFilter(const core::FileInfo& fileInfo);
 
+// is the contents of the project directory ignored when indexing and
+// searching (e.g. node_modules, packrat libraries, build output)
+bool isIgnoredProjectDirectory(const core::FilePath& dirPath,
+                               const std::string& websiteOutputDir);
+
 // enque file changed events
 void enqueFileChangedEvent(const core::system::FileChangeEvent& event);
 void enqueFileChangedEvents(const core::FilePath& vcsStatusRoot,
@@ -451,6 +481,10 @@ void consoleWriteOutput(const std::string& output);
 // write an error to the console (convenience wrapper for enquing a 
 // kConsoleWriteOutput event)
 void consoleWriteError(const std::string& message);
+
+// console output that was not sent to the client because there was too
+// much of it (the most recent such output, up to a limit)
+std::string suppressedConsoleOutput();
    
 // show an error dialog (convenience wrapper for enquing kShowErrorMessage)
 void showErrorMessage(const std::string& title, const std::string& message);
@@ -485,6 +519,16 @@ bool addRtoolsToPathIfNecessary(std::string* pPath,
 bool addRtoolsToPathIfNecessary(core::system::Options* pEnvironment,
                                 std::string* pWarningMessage);
 
+// compile package sources through ccache, keeping objects in cachePath (a
+// per-project directory). returns false if ccache isn't installed
+bool addCompileCacheToEnvironment(const core::FilePath& cachePath,
+                                  const core::FilePath& packagePath,
+                                  core::system::Options* pEnvironment);
+
+// describe the use made of the compile cache since it was added to an
+// environment (empty if nothing was compiled)
+std::string compileCacheSummary(const core::FilePath& cachePath);
+
 #ifdef __APPLE__
 bool isOSXMavericks();
 bool hasOSXMavericksDeveloperTools();
@@ -850,7 +894,9 @@ std::string websiteOutputDir();
 core::FilePath extractOutputFileCreated(const core::FilePath& inputFile,
                                         const std::string& output);
 
-void onBackgroundProcessing(bool isIdle);
+// perform background processing. scheduled work is cut short if the client
+// is waiting on a request (as it is when inputPending)
+void onBackgroundProcessing(bool isIdle, bool inputPending = false);
 
 } // namespace module_context
 } // namespace session
@@ -16,6 +16,7 @@
 #ifndef SESSION_SESSION_OPTIONS_HPP
 #define SESSION_SESSION_OPTIONS_HPP
 
+#include <algorithm>
 #include <string>
 
 #include <boost/utility.hpp>
@@ -99,6 +100,11 @@ public:
    {
       return logStderr_;
    }
+
+   core::FilePath startupTraceFile() const
+   {
+      return core::FilePath(startupTraceFile_);
+   }
    
    // agreement
    core::FilePath agreementFilePath() const
@@ -136,6 +142,11 @@ public:
       return std::string(wwwAddress_.c_str());
    }
 
+   int wwwCompressionLevel() const
+   {
+      return wwwCompressionLevel_;
+   }
+
    std::string sharedSecret() const
    {
       return std::string(secret_.c_str());
@@ -152,6 +163,20 @@ public:
 
    int disconnectedTimeoutMinutes() { return disconnectedTimeoutMinutes_; }
 
+   int lowMemoryMb() const { return lowMemoryMb_; }
+
+   double traceSampleRate() const { return traceSampleRate_; }
+
+   core::FilePath traceDir() const
+   {
+      return core::FilePath(traceDir_.c_str());
+   }
+
+   core::FilePath localScratchDir() const
+   {
+      return core::FilePath(localScratchDir_.c_str());
+   }
+
    bool createProfile() const { return createProfile_; }
 
    bool createPublicFolder() const { return createPublicFolder_; }
@@ -169,6 +194,8 @@ public:
    std::string defaultProjectDir() const { return defaultProjectDir_.c_str(); }
 
    bool showHelpHome() const { return showHelpHome_; }
+   std::string helpCacheDir() const { return helpCacheDir_; }
+   bool helpPrerender() const { return helpPrerender_; }
 
    bool showUserHomePage() const { return showUserHomePage_; }
    
@@ -260,6 +287,10 @@ public:
    int limitRpcClientUid() const { return limitRpcClientUid_; }
 
    bool limitXfsDiskQuota() const { return limitXfsDiskQuota_; }
+
+   std::string limitCacheMemory() const { return limitCacheMemory_; }
+
+   int limitConsoleOutputKb() const { return limitConsoleOutputKb_; }
    
    // external
    core::FilePath rpostbackPath() const
@@ -518,6 +549,11 @@ public:
       return monitorSharedSecret_.c_str();
    }
 
+   int monitorIntervalSeconds() const
+   {
+      return monitorIntervalSeconds_;
+   }
+
    bool standalone() const
    {
       return standalone_;
@@ -542,6 +578,11 @@ public:
    {
       return webSocketConnectTimeout_;
    }
+
+   bool webSocketClientEvents() const
+   {
+      return webSocketClientEvents_;
+   }
    
    bool packageOutputInPackageFolder() const
    {
@@ -560,6 +601,41 @@ public:
       return quitChildProcessesOnExit_;
    }
 
+   int findThreads() const
+   {
+      return findThreads_;
+   }
+
+   bool findExternalGrep() const
+   {
+      return findExternalGrep_;
+   }
+
+   int maxConcurrentJobs() const
+   {
+      return maxConcurrentJobs_;
+   }
+
+   int fileMonitorMaxWatches() const
+   {
+      return std::max(fileMonitorMaxWatches_, 0);
+   }
+
+   int fileMonitorPollSeconds() const
+   {
+      return std::max(fileMonitorPollSeconds_, 1);
+   }
+
+   bool fileMonitorFanotify() const
+   {
+      return fileMonitorFanotify_;
+   }
+
+   core::FilePath packageSymbolCacheDir() const
+   {
+      return core::FilePath(packageSymbolCacheDir_.c_str());
+   }
+
    std::string firstProjectTemplatePath() const
    {
       return firstProjectTemplatePath_;
@@ -615,6 +691,7 @@ private:
 
    // log
    bool logStderr_;
+   std::string startupTraceFile_;
 
    // agreement
    std::string agreementFilePath_;
@@ -627,6 +704,7 @@ private:
    std::string wwwSymbolMapsPath_;
    std::string wwwPort_;
    std::string wwwAddress_;
+   int wwwCompressionLevel_;
 
    // session
    std::string secret_;
@@ -634,6 +712,10 @@ private:
    int timeoutMinutes_;
    bool timeoutSuspend_;
    int disconnectedTimeoutMinutes_;
+   int lowMemoryMb_;
+   double traceSampleRate_;
+   std::string traceDir_;
+   std::string localScratchDir_;
    bool createProfile_;
    bool createPublicFolder_;
    bool rProfileOnResumeDefault_;
@@ -644,15 +726,25 @@ private:
    std::string defaultWorkingDir_;
    std::string defaultProjectDir_;
    bool showHelpHome_;
+   std::string helpCacheDir_;
+   bool helpPrerender_;
    bool showUserHomePage_;
    std::string defaultConsoleTerm_;
    bool defaultCliColorForce_;
    bool quitChildProcessesOnExit_;
+   int findThreads_;
+   bool findExternalGrep_;
+   int maxConcurrentJobs_;
+   int fileMonitorMaxWatches_;
+   int fileMonitorPollSeconds_;
+   bool fileMonitorFanotify_;
+   std::string packageSymbolCacheDir_;
    std::string firstProjectTemplatePath_;
    std::string signingKey_;
    bool verifySignatures_;
    int webSocketPingSeconds_;
    int webSocketConnectTimeout_;
+   bool webSocketClientEvents_;
    bool packageOutputToPackageFolder_;
    std::string terminalPort_;
 
@@ -679,6 +771,8 @@ private:
    int limitCpuTimeMinutes_;
    int limitRpcClientUid_;
    bool limitXfsDiskQuota_;
+   std::string limitCacheMemory_;
+   int limitConsoleOutputKb_;
    
    // external
    std::string rpostbackPath_;
@@ -737,6 +831,7 @@ private:
 
    // monitor
    std::string monitorSharedSecret_;
+   int monitorIntervalSeconds_;
 
    // connect
    std::string defaultRSConnectServer_;
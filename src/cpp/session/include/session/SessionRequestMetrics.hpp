@@ -0,0 +1,40 @@
+/*
+ * SessionRequestMetrics.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_REQUEST_METRICS_HPP
+#define SESSION_REQUEST_METRICS_HPP
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace session {
+namespace request_metrics {
+
+// collect latency, in-flight, and byte counts for requests handled by
+// the session (by uri prefix) and report them to the monitor from a
+// background thread (so they are reported even while R is busy). file
+// lock acquisition timings and filesystem operation counts are reported
+// alongside them
+core::Error initialize();
+
+} // namespace request_metrics
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_REQUEST_METRICS_HPP
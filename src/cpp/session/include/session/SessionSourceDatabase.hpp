@@ -50,8 +50,18 @@ public:
    const std::string& id() const { return id_; }
    const std::string& path() const { return path_; }
    const std::string& type() const { return type_; }
-   const std::string& contents() const { return contents_; }
-   const std::string& hash() const { return hash_; }
+   const std::string& contents() const
+   {
+      if (contentsPending_)
+         loadContents();
+      return contents_;
+   }
+   const std::string& hash() const
+   {
+      if (contentsPending_)
+         loadContents();
+      return hash_;
+   }
    const std::string& encoding() const { return encoding_; }
    bool dirty() const { return dirty_; }
    double created() const { return created_; }
@@ -70,10 +80,18 @@ public:
    // set contents from string
    void setContents(const std::string& contents);
 
+   // defer reading contents from the source database until they are first
+   // accessed (hash is the hash recorded with the document's properties)
+   void deferContents(const std::string& hash);
+
    // set contents from file
    core::Error setPathAndContents(const std::string& path,
                                   bool allowSubstChars = true);
 
+   // set the path of a document just saved from its contents (so there is
+   // no need to read them back)
+   void setSavedPath(const std::string& path);
+
    core::Error updateDirty();
    core::Error contentsMatchDisk(bool* pMatches);
 
@@ -152,17 +170,22 @@ public:
 
    core::Error writeToFile(const core::FilePath& filePath, bool writeContents = true) const;
 
+   // the document's properties as written to its file in the database
+   std::string propertiesFileContents() const;
+
    SEXP toRObject(r::sexp::Protect* pProtect, bool includeContents = true) const;
 
 private:
    void editProperty(const core::json::Object::value_type& property);
+   void loadContents() const;
 
 private:
    std::string id_;
    std::string path_;
    std::string type_;
-   std::string contents_;
-   std::string hash_;
+   mutable std::string contents_;
+   mutable std::string hash_;
+   mutable bool contentsPending_;
    std::string encoding_;
    std::string folds_;
    std::time_t lastKnownWriteTime_;
@@ -198,9 +221,23 @@ core::Error get(const std::string& id, boost::shared_ptr<SourceDocument> pDoc);
 core::Error get(const std::string& id, bool includeContents, boost::shared_ptr<SourceDocument> pDoc);
 core::Error getDurableProperties(const std::string& path,
                                  core::json::Object* pProperties);
-core::Error list(std::vector<boost::shared_ptr<SourceDocument> >* pDocs);
+core::Error list(std::vector<boost::shared_ptr<SourceDocument> >* pDocs,
+                 bool includeContents = true);
 core::Error list(std::vector<core::FilePath>* pPaths);
+
+// put a document. it is serialized before this returns but written to disk
+// afterwards (in the background); reading the database waits for the write,
+// and errors writing it are logged
 core::Error put(boost::shared_ptr<SourceDocument> pDoc, bool writeContents = true);
+
+// put a document whose contents were changed by replacing the bytes
+// [offset, offset + length) of its previous contents (with the given hash).
+// the change is appended to a log rather than rewriting the contents
+core::Error putChange(boost::shared_ptr<SourceDocument> pDoc,
+                      const std::string& previousHash,
+                      std::size_t offset,
+                      std::size_t length,
+                      const std::string& replacement);
 core::Error remove(const std::string& id);
 core::Error removeAll();
 core::Error getPath(const std::string& id, std::string* pPath);
@@ -16,9 +16,13 @@
 #ifndef SESSION_USER_SETTINGS_HPP
 #define SESSION_USER_SETTINGS_HPP
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <boost/utility.hpp>
+#include <boost/function.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/signal.hpp>
 
@@ -34,6 +38,12 @@
 
 #include <session/SessionTerminalShell.hpp>
 
+// names of settings (for change notifications)
+#define kUserSettingsUiPrefs       "uiPrefs"
+#define kUserSettingsSaveAction    "saveAction"
+#define kUserSettingsGitExePath    "vcsGitExePath"
+#define kUserSettingsSvnExePath    "vcsSvnExePath"
+
 namespace rstudio {
 namespace session {
 
@@ -64,8 +74,21 @@ private:
    friend UserSettings& userSettings();
 
 public:
+   // fired when the settings change (whether changed by another session or
+   // by this one, once its changes are written)
    boost::signal<void()> onChanged;
 
+   // call the handler (after onChanged) only when one of the given settings
+   // changes. keys are the names of settings, or of ui prefs (see uiPrefKey)
+   typedef boost::function<void()> ChangeHandler;
+   void onKeysChanged(const std::vector<std::string>& keys,
+                      const ChangeHandler& handler);
+   void onKeyChanged(const std::string& key, const ChangeHandler& handler);
+
+   // the key of the named ui pref (the ui prefs as a whole are changed, as
+   // kUserSettingsUiPrefs, when any one is)
+   static std::string uiPrefKey(const std::string& prefName);
+
 public:
    // COPYING: boost::noncopyable
    
@@ -114,6 +137,7 @@ public:
    core::system::busy_detection::Mode terminalBusyMode() const;
    std::vector<std::string> terminalBusyWhitelist() const;
    bool showRmdRenderCommand() const;
+   bool rmdRenderCache() const;
 
    bool rProfileOnResume() const;
    void setRprofileOnResume(bool rProfileOnResume);
@@ -195,6 +219,12 @@ public:
    bool hideObjectFiles() const;
    void setHideObjectFiles(bool hide);
 
+   bool useCompileCache() const;
+   void setUseCompileCache(bool useCache);
+
+   bool useParallelTests() const;
+   void setUseParallelTests(bool useParallel);
+
    bool viewDirAfterRCmdCheck() const;
    void setViewDirAfterRCmdCheck(bool viewDir);
 
@@ -250,6 +280,9 @@ private:
    void onSettingsFileChanged(
                         const core::system::FileChangeEvent& changeEvent);
 
+   std::map<std::string, std::string> settingsValues() const;
+   std::set<std::string> changedKeys();
+
    core::FilePath getWorkingDirectoryValue(const std::string& key) const;
    void setWorkingDirectoryValue(const std::string& key,
                                  const core::FilePath& filePath) ;
@@ -269,6 +302,11 @@ private:
    core::FilePath settingsFilePath_;
    core::Settings settings_;
 
+   // the values of the settings as of the last change notification (so
+   // changes can be told apart from rewrites of the same values)
+   std::map<std::string, std::string> notifiedValues_;
+   std::vector<std::pair<std::set<std::string>, ChangeHandler> > keyHandlers_;
+
    // cached prefs values
    mutable boost::scoped_ptr<bool> pUseSpacesForTab_;
    mutable boost::scoped_ptr<int> pNumSpacesForTab_;
@@ -291,6 +329,7 @@ private:
    mutable boost::scoped_ptr<int> pTerminalBusyMode_;
    mutable boost::scoped_ptr<core::json::Array> pTerminalBusyWhitelist_;
    mutable boost::scoped_ptr<bool> pShowRmdRenderCommand_;
+   mutable boost::scoped_ptr<bool> pRmdRenderCache_;
    mutable boost::scoped_ptr<bool> pShowPublishDiagnostics_;
    mutable boost::scoped_ptr<bool> pPublishCheckSslCerts_;
    mutable boost::scoped_ptr<bool> pPublishUseCABundle_;
@@ -0,0 +1,121 @@
+/*
+ * SessionPostbackChannel.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_POSTBACK_CHANNEL_HPP
+#define SESSION_POSTBACK_CHANNEL_HPP
+
+#include <cstdlib>
+#include <istream>
+#include <string>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+#include <core/Error.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/system/Environment.hpp>
+
+#include <session/SessionConstants.hpp>
+
+/*
+ The postback channel is a persistent loopback connection into the session
+ for postbacks (see SessionPostback.cpp) from its child processes, which
+ avoids both launching rpostback and the http framing and request signing
+ of a session request for each postback. Any number of postbacks can be
+ sent (one after another) over a connection; each is
+
+    <token>\0<command>\0<argument>\0
+
+ (where the token is that advertised in kPostbackChannelTokenEnvVar) and is
+ answered with
+
+    <exit code>\0<length of output>\0<output>
+
+ The rpostback-* scripts speak this directly (via bash's /dev/tcp), falling
+ back on rpostback when the channel isn't available.
+*/
+
+namespace rstudio {
+namespace session {
+namespace http {
+
+// start the channel (in the session), advertising it to child processes
+// through the environment
+core::Error startPostbackChannel();
+
+// whether the session has advertised a postback channel
+inline bool postbackChannelAvailable()
+{
+   return !core::system::getenv(kPostbackChannelPortEnvVar).empty();
+}
+
+// send a postback over the session's postback channel; it's inlined so that
+// it can be used from the postback executable (as is sendSessionRequest)
+inline core::Error sendPostbackChannelRequest(const std::string& command,
+                                              const std::string& argument,
+                                              int* pExitCode,
+                                              std::string* pOutput)
+{
+   using namespace boost::asio;
+
+   unsigned short port = core::safe_convert::stringTo<unsigned short>(
+            core::system::getenv(kPostbackChannelPortEnvVar), 0);
+   std::string token = core::system::getenv(kPostbackChannelTokenEnvVar);
+
+   try
+   {
+      io_service ioService;
+      ip::tcp::socket socket(ioService);
+      socket.connect(ip::tcp::endpoint(ip::address_v4::loopback(), port));
+
+      std::string request = token + '\0' + command + '\0' + argument + '\0';
+      write(socket, buffer(request));
+
+      // read the exit code and length of the output
+      streambuf response;
+      std::istream responseStream(&response);
+      std::string exitCode, length;
+      read_until(socket, response, '\0');
+      std::getline(responseStream, exitCode, '\0');
+      read_until(socket, response, '\0');
+      std::getline(responseStream, length, '\0');
+
+      // then the output itself
+      std::size_t size = core::safe_convert::stringTo<std::size_t>(length, 0);
+      if (response.size() < size)
+         read(socket, response, transfer_exactly(size - response.size()));
+      pOutput->assign(buffers_begin(response.data()),
+                      buffers_begin(response.data()) + size);
+
+      *pExitCode = core::safe_convert::stringTo<int>(exitCode, EXIT_FAILURE);
+      return core::Success();
+   }
+   catch (const boost::system::system_error& e)
+   {
+      return core::Error(e.code(), ERROR_LOCATION);
+   }
+}
+
+} // namespace http
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_POSTBACK_CHANNEL_HPP
@@ -41,6 +41,9 @@
 
 namespace rstudio {
 namespace session {
+
+class DebouncedFileChangeHandler;
+
 namespace projects {
 
 
@@ -50,6 +53,11 @@ struct FileMonitorCallbacks
    boost::function<void(const tree<core::FileInfo>&)> onMonitoringEnabled;
    boost::function<void(
          const std::vector<core::system::FileChangeEvent>&)> onFilesChanged;
+   // as onFilesChanged, but also including changes to the files that the
+   // file listing filter hides (hidden files and object files)
+   boost::function<void(
+         const std::vector<core::system::FileChangeEvent>&)>
+                                                   onUnfilteredFilesChanged;
    boost::function<void()> onMonitoringDisabled;
 };
 
@@ -175,6 +183,11 @@ public:
    void subscribeToFileMonitor(const std::string& featureName,
                                const FileMonitorCallbacks& cb);
 
+   // deliver file changes that are still waiting out the debounce period
+   // (for subscribers that are about to answer from state kept up to date
+   // by those changes)
+   void flushFileChanges();
+
    // can this project be shared with other users?
    bool supportsSharing();
 
@@ -197,6 +210,9 @@ private:
    void fileMonitorFilesChanged(
                    const std::vector<core::system::FileChangeEvent>& events);
    void fileMonitorTermination(const core::Error& error);
+   void notifyFilesChanged(
+                   const std::vector<core::system::FileChangeEvent>& events);
+   bool isListedFile(const core::FileInfo& fileInfo) const;
 
    core::FilePath vcsOptionsFilePath() const;
    core::Error buildOptionsFile(core::Settings* pOptionsFile) const;
@@ -219,10 +235,13 @@ private:
    core::r_util::RPackageInfo packageInfo_;
 
    bool hasFileMonitor_;
+   boost::shared_ptr<DebouncedFileChangeHandler> pFileChangeHandler_;
    std::vector<std::string> monitorSubscribers_;
    boost::signal<void(const tree<core::FileInfo>&)> onMonitoringEnabled_;
    boost::signal<void(const std::vector<core::system::FileChangeEvent>&)>
                                                             onFilesChanged_;
+   boost::signal<void(const std::vector<core::system::FileChangeEvent>&)>
+                                                  onUnfilteredFilesChanged_;
    boost::signal<void()> onMonitoringDisabled_;
 };
 
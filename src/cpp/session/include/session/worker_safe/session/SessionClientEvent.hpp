@@ -193,6 +193,8 @@ extern const int kDataOutputCompleted;
 extern const int kNewDocumentWithCode;
 extern const int kPlumberViewer;
 extern const int kAvailablePackagesReady;
+extern const int kConsoleWriteInputBatch;
+extern const int kConsoleOutputSuppressed;
 }
    
 class ClientEvent
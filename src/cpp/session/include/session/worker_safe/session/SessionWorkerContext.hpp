@@ -30,6 +30,13 @@ namespace worker_context {
 core::Error registerWorkerRpcMethod(const std::string& name,
                                     const core::json::JsonRpcFunction& function);
 
+// register a worker-safe method. the handler runs on the rpc worker thread
+// pool and its response is sent directly on the originating connection, so
+// it never waits behind (or holds up) the main thread. it must not touch R
+// or any other state owned by the main thread.
+core::Error registerWorkerSafeRpcMethod(
+                                 const std::string& name,
+                                 const core::json::JsonRpcFunction& function);
 
 // enque client event
 void enqueClientEvent(const ClientEvent& event);
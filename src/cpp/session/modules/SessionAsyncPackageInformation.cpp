@@ -23,14 +23,22 @@
 #include <sstream>
 
 #include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Hash.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/json/Json.hpp>
 #include <core/json/JsonRpc.hpp>
 #include <core/Error.hpp>
+#include <core/system/System.hpp>
 
+#include <boost/foreach.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <r/RExec.hpp>
+
 #include <session/SessionModuleContext.hpp>
+#include <session/SessionOptions.hpp>
 
 #include <core/Macros.hpp>
 
@@ -142,6 +150,248 @@ bool fillFunctionInfo(const json::Object& functionObjectJson,
    
 }
 
+bool readPackageInformation(const json::Value& value,
+                            PackageInformation* pInfo)
+{
+   // Ensure that this parsed as an Object -- this might have parsed as
+   // something else if e.g. we got malformed output on load of a package
+   if (!json::isType<json::Object>(value))
+      return false;
+   
+   json::Array exportsJson;
+   json::Array typesJson;
+   json::Object functionInfoJson;
+   json::Array datasetsJson;
+   
+   Error error = json::readObject(value.get_obj(),
+                                  "package", &pInfo->package,
+                                  "exports", &exportsJson,
+                                  "types", &typesJson,
+                                  "function_info", &functionInfoJson,
+                                  "datasets", &datasetsJson);
+
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+
+   if (!json::fillVectorString(exportsJson, &(pInfo->exports)))
+      LOG_ERROR_MESSAGE("Failed to read JSON 'objects' array to vector");
+
+   if (!json::fillVectorInt(typesJson, &(pInfo->types)))
+      LOG_ERROR_MESSAGE("Failed to read JSON 'types' array to vector");
+
+   if (!fillFunctionInfo(functionInfoJson, pInfo->package, &(pInfo->functionInfo)))
+      LOG_ERROR_MESSAGE("Failed to read JSON 'functions' object to map");
+   
+   if (!json::fillVectorString(datasetsJson, &(pInfo->datasets)))
+      LOG_ERROR_MESSAGE("Failed to read JSON 'data' array to vector");
+   
+   return true;
+}
+
+// Package information is cached on disk so that sessions don't each start
+// an R process to compute it again. Entries are keyed by the installed path
+// of the package and the modification time of its DESCRIPTION (so they are
+// replaced when the package is reinstalled), and are versioned by format.
+// Each user has their own cache; an administrator can also configure a
+// directory shared by all sessions, which is read first and written only if
+// the session can write to it. Entries are written by renaming a complete
+// file into place, so a reader never sees a partially written entry.
+#define kPackageCacheVersion "v1"
+#define kPackageCacheExt     ".json"
+
+FilePath userPackageCacheDir()
+{
+   return module_context::userScratchPath()
+         .complete("package-symbols")
+         .complete(kPackageCacheVersion);
+}
+
+FilePath sharedPackageCacheDir()
+{
+   FilePath sharedDir = session::options().packageSymbolCacheDir();
+   if (sharedDir.empty())
+      return FilePath();
+   
+   return sharedDir.complete(kPackageCacheVersion);
+}
+
+// cache entries for a package installed at a given path share a prefix
+std::string packageCacheEntryPrefix(const std::string& pkgName,
+                                    const FilePath& pkgPath)
+{
+   return pkgName + "-" + core::hash::crc32HexHash(pkgPath.absolutePath()) + "-";
+}
+
+std::string packageCacheEntryName(const std::string& pkgName,
+                                  const FilePath& pkgPath)
+{
+   FilePath descriptionPath = pkgPath.complete("DESCRIPTION");
+   if (!descriptionPath.exists())
+      return std::string();
+   
+   return packageCacheEntryPrefix(pkgName, pkgPath) +
+         safe_convert::numberToString(descriptionPath.lastWriteTime()) +
+         kPackageCacheExt;
+}
+
+bool readPackageCacheEntry(const FilePath& cacheDir,
+                           const std::string& entryName,
+                           PackageInformation* pInfo)
+{
+   if (cacheDir.empty())
+      return false;
+   
+   FilePath entryPath = cacheDir.complete(entryName);
+   if (!entryPath.exists())
+      return false;
+   
+   std::string contents;
+   Error error = core::readStringFromFile(entryPath, &contents);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+   
+   json::Value value;
+   if (!json::parse(contents, &value))
+   {
+      LOG_ERROR_MESSAGE("Failed to parse package cache entry: " +
+                        entryPath.absolutePath());
+      return false;
+   }
+   
+   return readPackageInformation(value, pInfo);
+}
+
+Error writePackageCacheEntry(const FilePath& cacheDir,
+                             const std::string& entryName,
+                             const std::string& contents)
+{
+   Error error = cacheDir.ensureDirectory();
+   if (error)
+      return error;
+   
+   FilePath tempPath = cacheDir.complete(
+            "." + entryName + "-" + core::system::generateShortenedUuid());
+   
+   error = core::writeStringToFile(tempPath, contents);
+   if (error)
+   {
+      tempPath.removeIfExists();
+      return error;
+   }
+   
+   error = tempPath.move(cacheDir.complete(entryName), FilePath::MoveDirect);
+   if (error)
+   {
+      tempPath.removeIfExists();
+      return error;
+   }
+   
+   // remove the entries for earlier installations of the package
+   std::string prefix = entryName.substr(0, entryName.rfind('-') + 1);
+   std::vector<FilePath> children;
+   error = cacheDir.children(&children);
+   if (error)
+      return error;
+   
+   BOOST_FOREACH(const FilePath& child, children)
+   {
+      std::string name = child.filename();
+      if (name != entryName && boost::algorithm::starts_with(name, prefix))
+         child.removeIfExists();
+   }
+   
+   return Success();
+}
+
+void writePackageCacheEntry(const std::string& entryName,
+                            const std::string& contents)
+{
+   FilePath sharedDir = sharedPackageCacheDir();
+   if (!sharedDir.empty() &&
+       !writePackageCacheEntry(sharedDir, entryName, contents))
+   {
+      return;
+   }
+   
+   // the shared cache is typically read only, so only failures to write
+   // to the user's cache are reported
+   Error error = writePackageCacheEntry(userPackageCacheDir(), entryName, contents);
+   if (error)
+      LOG_ERROR(error);
+}
+
+// the install paths of the given packages (those which are installed)
+std::map<std::string, FilePath> packagePaths(const std::vector<std::string>& pkgs)
+{
+   std::map<std::string, FilePath> paths;
+   
+   std::vector<std::string> pathStrings;
+   r::exec::RFunction findPackage("find.package");
+   findPackage.addParam(pkgs);
+   findPackage.addParam("quiet", true);
+   Error error = findPackage.call(&pathStrings);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return paths;
+   }
+   
+   BOOST_FOREACH(const std::string& pathString, pathStrings)
+   {
+      FilePath path(pathString);
+      paths[path.filename()] = path;
+   }
+   
+   return paths;
+}
+
+// Add the information for packages in the cache to the index, removing them
+// from the list of packages to look up, and get the names of the cache
+// entries to write for the others
+void readCachedPackageInformation(std::vector<std::string>* pPkgs,
+                                  std::map<std::string, std::string>* pEntries)
+{
+   std::map<std::string, FilePath> paths = packagePaths(*pPkgs);
+   FilePath sharedDir = sharedPackageCacheDir();
+   FilePath userDir = userPackageCacheDir();
+   
+   std::vector<std::string> uncachedPkgs;
+   BOOST_FOREACH(const std::string& pkg, *pPkgs)
+   {
+      std::map<std::string, FilePath>::const_iterator it = paths.find(pkg);
+      std::string entryName = it == paths.end() ?
+               std::string() :
+               packageCacheEntryName(pkg, it->second);
+      
+      if (entryName.empty())
+      {
+         uncachedPkgs.push_back(pkg);
+         continue;
+      }
+      
+      PackageInformation pkgInfo;
+      if (readPackageCacheEntry(sharedDir, entryName, &pkgInfo) ||
+          readPackageCacheEntry(userDir, entryName, &pkgInfo))
+      {
+         DEBUG("Read cached entry for package: '" << pkg << "'");
+         RSourceIndex::addPackageInformation(pkg, pkgInfo);
+      }
+      else
+      {
+         (*pEntries)[pkg] = entryName;
+         uncachedPkgs.push_back(pkg);
+      }
+   }
+   
+   pPkgs->swap(uncachedPkgs);
+}
+
 } // anonymous namespace
 
 void AsyncPackageInformationProcess::onCompleted(int exitStatus)
@@ -178,11 +428,6 @@ void AsyncPackageInformationProcess::onCompleted(int exitStatus)
    // }
    for (std::size_t i = 0; i < n; ++i)
    {
-      json::Array exportsJson;
-      json::Array typesJson;
-      json::Object functionInfoJson;
-      json::Array datasetsJson;
-      
       core::r_util::PackageInformation pkgInfo;
 
       if (splat[i].empty())
@@ -208,37 +453,17 @@ void AsyncPackageInformationProcess::onCompleted(int exitStatus)
          continue;
       }
       
-      // Ensure that this parsed as an Object -- this might have parsed as
-      // something else if e.g. we got malformed output on load of a package
-      if (!json::isType<json::Object>(value))
-         continue;
-      
-      Error error = json::readObject(value.get_obj(),
-                                     "package", &pkgInfo.package,
-                                     "exports", &exportsJson,
-                                     "types", &typesJson,
-                                     "function_info", &functionInfoJson,
-                                     "datasets", &datasetsJson);
-
-      if (error)
-      {
-         LOG_ERROR(error);
+      if (!readPackageInformation(value, &pkgInfo))
          continue;
-      }
 
       DEBUG("Adding entry for package: '" << pkgInfo.package << "'");
-
-      if (!json::fillVectorString(exportsJson, &(pkgInfo.exports)))
-         LOG_ERROR_MESSAGE("Failed to read JSON 'objects' array to vector");
-
-      if (!json::fillVectorInt(typesJson, &(pkgInfo.types)))
-         LOG_ERROR_MESSAGE("Failed to read JSON 'types' array to vector");
-
-      if (!fillFunctionInfo(functionInfoJson, pkgInfo.package, &(pkgInfo.functionInfo)))
-         LOG_ERROR_MESSAGE("Failed to read JSON 'functions' object to map");
       
-      if (!json::fillVectorString(datasetsJson, &(pkgInfo.datasets)))
-         LOG_ERROR_MESSAGE("Failed to read JSON 'data' array to vector");
+      // Cache the information (packages which failed to load have no
+      // exports, and are looked up again next time)
+      std::map<std::string, std::string>::const_iterator it =
+            cacheEntries_.find(pkgInfo.package);
+      if (it != cacheEntries_.end() && !pkgInfo.exports.empty())
+         writePackageCacheEntry(it->second, line);
       
       // Update the index
       core::r_util::RSourceIndex::addPackageInformation(pkgInfo.package, pkgInfo);
@@ -260,6 +485,11 @@ void AsyncPackageInformationProcess::update()
    s_pkgsToUpdate_ =
       RSourceIndex::getAllUnindexedPackages();
    
+   // packages in the on-disk cache needn't be looked up
+   std::map<std::string, std::string> cacheEntries;
+   if (!s_pkgsToUpdate_.empty())
+      readCachedPackageInformation(&s_pkgsToUpdate_, &cacheEntries);
+   
    // alias for readability
    const std::vector<std::string>& pkgs = s_pkgsToUpdate_;
    
@@ -307,6 +537,7 @@ void AsyncPackageInformationProcess::update()
    
    boost::shared_ptr<AsyncPackageInformationProcess> pProcess(
          new AsyncPackageInformationProcess());
+   pProcess->cacheEntries_ = cacheEntries;
 
    std::vector<core::FilePath> sources;
    FilePath modulesPath = session::options().modulesRSourcePath();
@@ -316,7 +547,8 @@ void AsyncPackageInformationProcess::update()
    pProcess->start(
             finalCmd.c_str(),
             core::FilePath(),
-            async_r::R_PROCESS_VANILLA | async_r::R_PROCESS_AUGMENTED,
+            async_r::R_PROCESS_VANILLA | async_r::R_PROCESS_AUGMENTED |
+            async_r::R_PROCESS_POOLED,
             sources);
    
 }
@@ -16,6 +16,9 @@
 #ifndef SESSION_ASYNC_PACKAGE_INFORMATION_HPP
 #define SESSION_ASYNC_PACKAGE_INFORMATION_HPP
 
+#include <map>
+#include <string>
+
 #include <core/r_util/RSourceIndex.hpp>
 #include <session/SessionAsyncRProcess.hpp>
 
@@ -53,6 +56,10 @@ private:
 
    std::stringstream stdOut_;
 
+   // the names of the on-disk cache entries to write for the packages
+   // being looked up
+   std::map<std::string, std::string> cacheEntries_;
+
 };
 
 } // end namespace r_completions
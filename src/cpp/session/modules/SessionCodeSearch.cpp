@@ -34,17 +34,22 @@
 #include <core/Exec.hpp>
 #include <core/FilePath.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/FuzzyMatch.hpp>
+#include <core/Hash.hpp>
+#include <core/MemoryAccounting.hpp>
 #include <core/SafeConvert.hpp>
 #include <core/collection/Tree.hpp>
 
 #include <core/r_util/RSourceIndex.hpp>
+#include <core/r_util/RSourceIndexCache.hpp>
+#include <core/r_util/RSourceSymbolIndex.hpp>
 
 #include <core/system/FileChangeEvent.hpp>
 #include <core/system/FileMonitor.hpp>
 
 #include <r/RRoutines.hpp>
 #include <r/RExec.hpp>
-#include <r/RRoutines.hpp>
+#include <r/RSexpView.hpp>
 
 #include <session/SessionUserSettings.hpp>
 #include <session/SessionModuleContext.hpp>
@@ -98,27 +103,11 @@ bool isWithinIgnoredDirectory(const FilePath& filePath)
         !parentPath.empty() && parentPath != projDir;
         parentPath = parentPath.parent())
    {
-      std::string parentName = parentPath.filename();
-      
-      // node_modules
-      if (parentName == "node_modules")
-         return true;
-      
-      // websites
-      if (parentName == websiteDir)
-         return true;
-      
-      // packrat
-      if (parentName == "packrat" &&
-          parentPath.childPath("packrat.lock").exists())
-         return true;
-      
-      // cmake build directory
-      if (parentPath.childPath("cmake_install.cmake").exists())
+      if (module_context::isIgnoredProjectDirectory(parentPath, websiteDir))
          return true;
 
       // revdep sub-directories
-      if (isPackageProject && parentName == "revdep")
+      if (isPackageProject && parentPath.filename() == "revdep")
          return true;
    }
    
@@ -168,13 +157,17 @@ struct Entry
    }
    
    Entry(const FileInfo& fileInfo,
-         boost::shared_ptr<core::r_util::RSourceIndex> pIndex)
-      : fileInfo(fileInfo), pIndex(pIndex)
+         boost::shared_ptr<core::r_util::RSourceIndex> pIndex,
+         const std::string& hash = std::string())
+      : fileInfo(fileInfo), pIndex(pIndex), hash(hash)
    {
    }
    
    FileInfo fileInfo;
    boost::shared_ptr<core::r_util::RSourceIndex> pIndex;
+
+   // content hash of the indexed file (for the source index cache)
+   std::string hash;
    
    bool hasIndex() const { return pIndex.get() != NULL; }
    
@@ -450,7 +443,7 @@ class SourceFileIndex : boost::noncopyable
 {
 public:
    SourceFileIndex()
-      : pEntries_(new EntryTree()), indexing_(false)
+      : pEntries_(new EntryTree()), indexing_(false), loadingCache_(false)
    {
    }
 
@@ -495,7 +488,9 @@ public:
                            boost::posix_time::milliseconds(200),
                            boost::posix_time::milliseconds(20),
                            boost::bind(&SourceFileIndex::dequeAndIndex, this),
-                           false /* allow indexing even when non-idle */);
+                           false /* allow indexing even when non-idle */,
+                           WorkPriorityNormal,
+                           "code_search");
       }
    }
 
@@ -515,7 +510,9 @@ public:
          module_context::scheduleIncrementalWork(
                            boost::posix_time::milliseconds(20),
                            boost::bind(&SourceFileIndex::dequeAndIndex, this),
-                           false /* allow indexing even when non-idle */);
+                           false /* allow indexing even when non-idle */,
+                           WorkPriorityNormal,
+                           "code_search");
       }
    }
 
@@ -523,30 +520,18 @@ public:
                            const std::set<std::string>& excludeContexts,
                            r_util::RSourceItem* pFunctionItem)
    {
-      std::vector<r_util::RSourceItem> sourceItems;
-      BOOST_FOREACH(const Entry& entry, *pEntries_)
+      typedef r_util::RSourceSymbolIndex::Symbol Symbol;
+      BOOST_FOREACH(const Symbol& symbol, symbols_.find(functionName))
       {
-         // bail if there is no index
-         if (!entry.hasIndex())
-            continue;
-
          // bail if this is an exluded context
-         if (excludeContexts.find(entry.pIndex->context()) !=
-             excludeContexts.end())
-         {
+         if (excludeContexts.find(symbol.context()) != excludeContexts.end())
             continue;
-         }
-
-         // scan the next index
-         sourceItems.clear();
-         entry.pIndex->search(
-                  boost::bind(isGlobalFunctionNamed, _1, functionName),
-                  std::back_inserter(sourceItems));
 
          // return if we got a hit
-         if (sourceItems.size() > 0)
+         const r_util::RSourceItem& sourceItem = symbol.sourceItem();
+         if (isGlobalFunctionNamed(sourceItem, functionName))
          {
-            *pFunctionItem = sourceItems[0];
+            *pFunctionItem = sourceItem.withContext(symbol.internedContext());
             return true;
          }
       }
@@ -561,6 +546,21 @@ public:
                      const std::set<std::string>& excludeContexts,
                      std::vector<r_util::RSourceItem>* pItems)
    {
+      // prefix searches (e.g. for completions) can use the symbol index
+      if (prefixOnly && term.find('*') == std::string::npos)
+      {
+         if (pItems->size() < maxResults)
+         {
+            symbols_.visitPrefix(term,
+                                 boost::bind(addSourceItem,
+                                             boost::cref(excludeContexts),
+                                             maxResults,
+                                             pItems,
+                                             _1));
+         }
+         return;
+      }
+
       BOOST_FOREACH(const Entry& entry, *pEntries_)
       {
          // skip if it has no index
@@ -604,6 +604,11 @@ public:
 
       // create wildcard pattern if the search has a '*'
       boost::regex pattern = regex_utils::regexIfWildcardPattern(term);
+
+      // We allow the user to submit queries of the form e.g.
+      // <query>:<row><column>; make sure we only take items
+      // on the query up to ':'
+      fuzzy_match::Query query(term.substr(0, term.find(":")), true);
       
       // get the start and end iterators -- default to all leaves
       EntryTree::leaf_iterator it = pEntries_->begin_leaf();
@@ -655,19 +660,7 @@ public:
             if (prefixOnly)
                matches = boost::algorithm::istarts_with(name, term);
             else
-            {
-               // We allow the user to submit queries of the form e.g.
-               // <query>:<row><column>; make sure we only take items
-               // on the query up to ':'
-               std::string::size_type queryEnd = term.find(":");
-               if (queryEnd == std::string::npos)
-                  queryEnd = term.length();
-
-               matches = string_utils::isSubsequence(name,
-                                                     term,
-                                                     queryEnd,
-                                                     true);
-            }
+               matches = query.isSubsequenceOf(name);
          }
 
          // add the file if we found a match
@@ -791,11 +784,66 @@ public:
       }
    }
    
+   memory_accounting::Usage memoryUsage() const
+   {
+      memory_accounting::Usage usage;
+      BOOST_FOREACH(const Entry& entry, *pEntries_)
+      {
+         if (!entry.hasIndex())
+            continue;
+
+         usage.bytes += entry.pIndex->memoryUsage();
+         usage.entries++;
+      }
+      return usage;
+   }
+
    void clear()
    {
       indexing_ = false;
       indexingQueue_ = std::queue<core::system::FileChangeEvent>();
       pEntries_->clear();
+      symbols_.clear();
+      cache_.clear();
+      loadingCache_ = false;
+   }
+
+   // load indexes written by a previous session. these are used in place
+   // of parsing files which haven't changed as the initial set of files
+   // is indexed (after which the cache is discarded)
+   void loadCache(const FilePath& cachePath)
+   {
+      if (!cachePath.exists())
+         return;
+
+      Error error = cache_.readFromFile(cachePath);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+
+      loadingCache_ = !cache_.empty();
+   }
+
+   void saveCache(const FilePath& cachePath)
+   {
+      r_util::RSourceIndexCache cache;
+      BOOST_FOREACH(const Entry& entry, *pEntries_)
+      {
+         if (!entry.hasIndex())
+            continue;
+
+         cache.add(entry.fileInfo.absolutePath(),
+                   entry.fileInfo.lastWriteTime(),
+                   entry.fileInfo.size(),
+                   entry.hash,
+                   entry.pIndex);
+      }
+
+      Error error = cache.writeToFile(cachePath);
+      if (error)
+         LOG_ERROR(error);
    }
 
 private:
@@ -834,6 +882,14 @@ private:
 
       // return status
       indexing_ = !indexingQueue_.empty();
+
+      // the cache is only good for the initial set of files
+      if (!indexing_ && loadingCache_)
+      {
+         cache_.clear();
+         loadingCache_ = false;
+      }
+
       return indexing_;
    }
 
@@ -849,7 +905,17 @@ private:
       if (isWithinIgnoredDirectory(filePath))
          return;
 
-      if (isIndexableSourceFile(fileInfo))
+      // use the index from the previous session if the file is unchanged
+      std::string contentHash;
+      if (loadingCache_)
+      {
+         pIndex = cache_.get(fileInfo.absolutePath(),
+                             fileInfo.lastWriteTime(),
+                             fileInfo.size(),
+                             &contentHash);
+      }
+
+      if (!pIndex && isIndexableSourceFile(fileInfo))
       {
          std::string code;
          Error error = module_context::readAndDecodeFile(
@@ -872,11 +938,18 @@ private:
          // add index entry
          std::string context = module_context::createAliasedPath(filePath);
          pIndex.reset(new r_util::RSourceIndex(context, code));
+
+         // hash the contents so that the index can be reused by the next
+         // session even if the modification time changes
+         error = hash::crc32cHexHash(filePath, &contentHash);
+         if (error)
+            contentHash.clear();
       }
 
       // attempt to add the entry
-      Entry entry(fileInfo, pIndex);
+      Entry entry(fileInfo, pIndex, contentHash);
       pEntries_->insertEntry(entry);
+      symbols_.add(fileInfo.absolutePath(), pIndex);
 
       // kick off an update
       r_packages::AsyncPackageInformationProcess::update();
@@ -889,7 +962,10 @@ private:
 
       EntryTree::iterator it = pEntries_->find(entry);
       if (it != pEntries_->end())
+      {
          pEntries_->erase(it);
+         symbols_.remove(fileInfo.absolutePath());
+      }
       else
       {
          DEBUG("Failed to remove index entry for file: '" << fileInfo.absolutePath() << "'");
@@ -897,6 +973,19 @@ private:
       }
    }
 
+   static bool addSourceItem(const std::set<std::string>& excludeContexts,
+                             std::size_t maxResults,
+                             std::vector<r_util::RSourceItem>* pItems,
+                             const r_util::RSourceSymbolIndex::Symbol& symbol)
+   {
+      if (excludeContexts.find(symbol.context()) == excludeContexts.end())
+         pItems->push_back(
+               symbol.sourceItem().withContext(symbol.internedContext()));
+
+      // keep going until we have enough results
+      return pItems->size() < maxResults;
+   }
+
    static bool isSourceFile(const FileInfo& fileInfo)
    {
       FilePath filePath(fileInfo.absolutePath());
@@ -957,9 +1046,16 @@ private:
    // index entries
    boost::shared_ptr<EntryTree> pEntries_;
 
+   // symbols from the entries' indexes
+   r_util::RSourceSymbolIndex symbols_;
+
    // indexing queue
    bool indexing_;
    std::queue<core::system::FileChangeEvent> indexingQueue_;
+
+   // indexes from the previous session
+   r_util::RSourceIndexCache cache_;
+   bool loadingCache_;
 };
 
 } // anonymous namespace
@@ -1278,64 +1374,6 @@ void searchFiles(const std::string& term,
    }
 }
 
-// NOTE: When modifying this code, you should ensure that corresponding
-// changes are made to the client side scoreMatch function as well
-// (See: CodeSearchOracle.java)
-int scoreMatch(std::string const& suggestion,
-               std::string const& query,
-               bool isFile)
-{
-   // No penalty for perfect matches
-   if (suggestion == query)
-      return 0;
-   
-   std::vector<int> matches =
-         string_utils::subsequenceIndices(suggestion, query);
-   
-   int totalPenalty = 0;
-
-   // Loop over the matches and assign a score
-   for (int j = 0, n = static_cast<int>(matches.size()); j < n; j++)
-   {
-      int matchPos = matches[j];
-      int penalty = matchPos;
-
-      // Less penalty if character follows special delim
-      if (matchPos >= 1)
-      {
-         char prevChar = suggestion[matchPos - 1];
-         if (prevChar == '_' || prevChar == '-' || (!isFile && prevChar == '.'))
-         {
-            penalty = j + 1;
-         }
-      }
-
-      // Less penalty for perfect match (ie, reward case-sensitive match)
-      penalty -= suggestion[matchPos] == query[j];
-      
-      // More penalty for 'uninteresting' files
-      if (suggestion == "RcppExports.R" ||
-          suggestion == "RcppExports.cpp")
-         penalty += 6;
-      
-      // More penalty for 'uninteresting' extensions (e.g. .Rd)
-      std::string extension = string_utils::getExtension(suggestion);
-      if (boost::algorithm::to_lower_copy(extension) == ".rd")
-         penalty += 6;
-
-      totalPenalty += penalty;
-   }
-   
-   // Penalize files
-   if (isFile)
-      ++totalPenalty;
-   
-   // Penalize unmatched characters
-   totalPenalty += static_cast<int>((query.size() - matches.size()) * query.size());
-
-   return totalPenalty;
-}
-
 struct ScorePairComparator
 {
    inline bool operator()(const std::pair<int, int> lhs,
@@ -1532,8 +1570,8 @@ SourceItem fromCppDefinition(const clang::CppDefinition& cppDefinition)
    // return source item
    return SourceItem(
       type,
-      cppDefinition.name,
-      cppDefinition.parentName,
+      cppDefinition.name.str(),
+      cppDefinition.parentName.str(),
       "",
       module_context::createAliasedPath(cppDefinition.location.filePath),
       safe_convert::numberTo<int>(cppDefinition.location.line, 1),
@@ -1603,10 +1641,12 @@ Error searchCode(const json::JsonRpcRequest& request,
    typedef std::pair<int, int> PairIntInt;
 
    // score matches -- returned as a pair, mapping index to score
+   std::vector<int> nameScores;
+   fuzzy_match::scoreMatches(names, term, true, &nameScores);
    std::vector<PairIntInt> fileScores;
    for (std::size_t i = 0; i < paths.size(); ++i)
    {
-      fileScores.push_back(std::make_pair(i, scoreMatch(names[i], term, true)));
+      fileScores.push_back(std::make_pair(i, nameScores[i]));
    }
 
    // sort by score (lower is better)
@@ -1623,7 +1663,7 @@ Error searchCode(const json::JsonRpcRequest& request,
           boost::algorithm::ends_with(context, "RcppExports.cpp"))
          continue;
          
-      int score = scoreMatch(item.name(), term, false);
+      int score = fuzzy_match::scoreMatch(item.name(), term, false);
       srcItemScores.push_back(std::make_pair(i, score));
    }
    std::sort(srcItemScores.begin(), srcItemScores.end(), ScorePairComparator());
@@ -2308,8 +2348,14 @@ Error findFunctionInSearchPath(const json::JsonRpcRequest& request,
    return Success();
 }
 
+FilePath sourceIndexCachePath()
+{
+   return module_context::scopedScratchPath().childPath("r-source-index");
+}
+
 void onFileMonitorEnabled(const tree<core::FileInfo>& files)
 {
+   s_projectIndex.loadCache(sourceIndexCachePath());
    s_projectIndex.enqueFiles(files.begin_leaf(), files.end_leaf());
 }
 
@@ -2327,21 +2373,30 @@ void onFileMonitorDisabled()
    s_projectIndex.clear();
 }
 
-SEXP rs_scoreMatches(SEXP suggestionsSEXP,
-                     SEXP querySEXP)
+void onShutdown(bool terminatedNormally)
+{
+   if (terminatedNormally && projects::projectContext().hasFileMonitor())
+      s_projectIndex.saveCache(sourceIndexCachePath());
+}
+
+SEXP rs_scoreMatches(const r::sexp::StringVectorView& suggestions,
+                     const r::sexp::StringView& query)
 {
-   std::string query = r::sexp::asString(querySEXP);
-   std::vector<std::string> suggestions;
-   if (!r::sexp::fillVectorString(suggestionsSEXP, &suggestions))
+   if (!suggestions.valid())
       return R_NilValue;
-   
-   int n = static_cast<int>(suggestions.size());
-   std::vector<int> scores;
-   scores.reserve(n);
-   
-   for (int i = 0; i < n; i++)
-      scores.push_back(scoreMatch(suggestions[i], query, false));
-   
+
+   // score the suggestions in place (this is called as completions are typed)
+   std::string queryString = query.str();
+   std::vector<int> scores(suggestions.size());
+   for (std::size_t i = 0; i < suggestions.size(); i++)
+   {
+      r::sexp::StringView suggestion = suggestions[i];
+      scores[i] = fuzzy_match::scoreMatch(suggestion.begin(),
+                                          suggestion.end(),
+                                          queryString,
+                                          false);
+   }
+
    r::sexp::Protect protect;
    return r::sexp::create(scores, &protect);
 }
@@ -2451,10 +2506,26 @@ SEXP rs_viewFunction(SEXP functionSEXP, SEXP nameSEXP, SEXP namespaceSEXP)
    return R_NilValue;
 }
 
+// the indexes of project files and of open source documents (the names
+// they hold are interned, and so are accounted for by the string pool)
+memory_accounting::Usage indexesMemoryUsage()
+{
+   memory_accounting::Usage usage = s_projectIndex.memoryUsage();
+   BOOST_FOREACH(const RSourceIndexes::IDMap::value_type& index,
+                 rSourceIndex().indexMap())
+   {
+      usage.bytes += index.second->memoryUsage();
+      usage.entries++;
+   }
+   return usage;
+}
+
 } // anonymous namespace
    
 Error initialize()
 {
+   memory_accounting::registerSubsystem("code-search", indexesMemoryUsage);
+
    // subscribe to project context file monitoring state changes
    // (note that if there is no project this will no-op)
    session::projects::FileMonitorCallbacks cb;
@@ -2463,6 +2534,9 @@ Error initialize()
    cb.onMonitoringDisabled = onFileMonitorDisabled;
    projects::projectContext().subscribeToFileMonitor("R source file indexing",
                                                      cb);
+
+   // save the index at shutdown so the next session can start from it
+   module_context::events().onShutdown.connect(onShutdown);
    
    // register viewFunction method
    R_CallMethodDef methodDef ;
@@ -2472,11 +2546,8 @@ Error initialize()
    r::routines::addCallMethod(methodDef);
 
    // register call methods
-   r::routines::registerCallMethod(
-            "rs_scoreMatches",
-            (DL_FUNC) rs_scoreMatches,
-            2);
-   
+   RS_REGISTER_TYPED_CALL_METHOD(rs_scoreMatches);
+
    r::routines::registerCallMethod(
             "rs_listIndexedFiles",
             (DL_FUNC) rs_listIndexedFiles,
@@ -2511,7 +2582,7 @@ Error initialize()
 namespace callbacks {
 
 void addAllProjectSymbols(const Entry& entry,
-                          std::set<std::string>* pSymbols)
+                          InternedStringSet* pSymbols)
 {
    if (!entry.hasIndex())
       return;
@@ -2519,13 +2590,18 @@ void addAllProjectSymbols(const Entry& entry,
    const std::vector<r_util::RSourceItem>& items = entry.pIndex->items();
    BOOST_FOREACH(const r_util::RSourceItem& item, items)
    {
-      pSymbols->insert(string_utils::strippedOfQuotes(item.name()));
+      const std::string& name = item.name();
+      std::string stripped = string_utils::strippedOfQuotes(name);
+      if (stripped.size() == name.size())
+         pSymbols->insert(item.internedName());
+      else
+         pSymbols->insert(InternedString(stripped));
    } 
 }
 
 } // namespace callbacks
 
-void addAllProjectSymbols(std::set<std::string>* pSymbols)
+void addAllProjectSymbols(InternedStringSet* pSymbols)
 {
    FilePath buildTarget = projects::projectContext().buildTargetPath();
    
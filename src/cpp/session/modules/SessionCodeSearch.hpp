@@ -16,6 +16,7 @@
 #ifndef SESSION_CODE_SEARCH_HPP
 #define SESSION_CODE_SEARCH_HPP
 
+#include <core/InternedString.hpp>
 #include <core/r_util/RSourceIndex.hpp>
 #include <session/SessionSourceDatabase.hpp>
 #include <boost/foreach.hpp>
@@ -109,7 +110,7 @@ void searchSource(const std::string& term,
                   std::vector<core::r_util::RSourceItem>* pItems,
                   bool* pMoreAvailable);
 
-void addAllProjectSymbols(std::set<std::string>* pSymbols);
+void addAllProjectSymbols(core::InternedStringSet* pSymbols);
 
 core::Error initialize();
    
@@ -17,6 +17,8 @@
 #include "SessionConsole.hpp"
 #include "rmarkdown/SessionRmdNotebook.hpp"
 
+#include <algorithm>
+
 #include <boost/algorithm/string/predicate.hpp>
 
 #include <core/Error.hpp>
@@ -141,6 +143,37 @@ Error resetConsoleActions(const json::JsonRpcRequest& request,
    return Success();
 }
 
+Error getConsoleActions(const json::JsonRpcRequest& request,
+                        json::JsonRpcResponse* pResponse)
+{
+   // actions before the given one (as numbered by the start of a previous
+   // set of actions), enough for the given number of lines of output
+   int end, maxLines;
+   Error error = json::readParams(request.params, &end, &maxLines);
+   if (error)
+      return error;
+
+   json::Object actionsObject;
+   std::size_t start;
+   r::session::consoleActions().asJson(std::max(end, 0),
+                                       std::max(maxLines, 0),
+                                       &actionsObject,
+                                       &start);
+
+   json::Object resultJson;
+   resultJson["actions"] = actionsObject;
+   resultJson["start"] = static_cast<int>(start);
+   pResponse->setResult(resultJson);
+   return Success();
+}
+
+Error getSuppressedConsoleOutput(const json::JsonRpcRequest& request,
+                                 json::JsonRpcResponse* pResponse)
+{
+   pResponse->setResult(module_context::suppressedConsoleOutput());
+   return Success();
+}
+
 SEXP rs_getPendingInput()
 {
    r::sexp::Protect rProtect;
@@ -184,7 +217,9 @@ Error initialize()
    ExecBlock initBlock ;
    initBlock.addFunctions()
       (bind(sourceModuleRFile, "SessionConsole.R"))
-      (bind(registerRpcMethod, "reset_console_actions", resetConsoleActions));
+      (bind(registerRpcMethod, "reset_console_actions", resetConsoleActions))
+      (bind(registerRpcMethod, "get_console_actions", getConsoleActions))
+      (bind(registerRpcMethod, "get_suppressed_console_output", getSuppressedConsoleOutput));
 
    return initBlock.execute();
 }
@@ -15,14 +15,25 @@
 
 #include "SessionDependencies.hpp"
 
+#include <algorithm>
+
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/regex.hpp>
+#include <boost/thread.hpp>
 #include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <core/Error.hpp>
 #include <core/Exec.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/StringUtils.hpp>
 #include <core/system/Environment.hpp>
 
+#ifndef _WIN32
+#include <core/system/PosixCgroups.hpp>
+#endif
+
 #include <core/json/JsonRpc.hpp>
 
 #include <r/RExec.hpp>
@@ -33,6 +44,8 @@
 #include <session/SessionConsoleProcess.hpp>
 #include <session/projects/SessionProjects.hpp>
 
+#include "jobs/JobsApi.hpp"
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -289,6 +302,91 @@ Error unsatisfiedDependencies(const json::JsonRpcRequest& request,
    return Success();
 }
 
+// the number of packages to build at once
+int installCpuCount()
+{
+#ifndef _WIN32
+   return core::system::cgroups::availableCpuCount();
+#else
+   return std::max(static_cast<int>(boost::thread::hardware_concurrency()), 1);
+#endif
+}
+
+// follows the output of the installer (see InstallDependencies.R) to keep a
+// job up to date with its progress
+class InstallProgress : boost::noncopyable
+{
+public:
+   explicit InstallProgress(int archiveCount)
+      : archiveCount_(archiveCount),
+        installed_(0)
+   {
+      pJob_ = jobs::addJob("Installing Packages",
+                           "Resolving dependencies",
+                           "",
+                           archiveCount_,
+                           jobs::JobRunning,
+                           false,
+                           R_NilValue,
+                           false);
+   }
+
+   void onOutput(const std::string& output)
+   {
+      pending_.append(output);
+
+      std::size_t pos;
+      while ((pos = pending_.find('\n')) != std::string::npos)
+      {
+         onLine(pending_.substr(0, pos));
+         pending_.erase(0, pos + 1);
+      }
+   }
+
+   void onExit(int exitCode)
+   {
+      if (!pending_.empty())
+         onLine(pending_);
+
+      jobs::setJobStatus(pJob_, "");
+      jobs::setJobState(pJob_, exitCode == 0 ? jobs::JobSucceeded :
+                                               jobs::JobFailed);
+   }
+
+private:
+   void onLine(const std::string& line)
+   {
+      static const boost::regex reResolved("^Resolved (\\d+) packages? to install");
+      static const boost::regex reInstalling(
+            "^(?:begin installing|\\* installing \\*source\\*) package "
+            "[^[:alnum:]]*([[:alnum:].]+)");
+
+      pJob_->addOutput(line + "\n", false);
+
+      boost::smatch match;
+      if (boost::regex_search(line, match, reResolved))
+      {
+         int count = safe_convert::stringTo<int>(match[1].str(), 0);
+         jobs::setJobProgressMax(pJob_, count + archiveCount_);
+         jobs::setJobStatus(pJob_, "Downloading " + match[1].str() + " packages");
+      }
+      else if (boost::regex_search(line, match, reInstalling))
+      {
+         jobs::setJobProgress(pJob_, ++installed_);
+         jobs::setJobStatus(pJob_, "Installing " + match[1].str());
+      }
+      else if (boost::algorithm::contains(line, "successfully unpacked"))
+      {
+         jobs::setJobProgress(pJob_, ++installed_);
+      }
+   }
+
+   boost::shared_ptr<jobs::Job> pJob_;
+   int archiveCount_;
+   int installed_;
+   std::string pending_;
+};
+
 Error installDependencies(const json::JsonRpcRequest& request,
                           json::JsonRpcResponse* pResponse)
 {
@@ -344,27 +442,25 @@ Error installDependencies(const json::JsonRpcRequest& request,
       }
    }
 
-   // build install command
-   std::string cmd("{ " + module_context::CRANDownloadOptions() + "; ");
-   if (!cranPackages.empty())
-   {
-      std::string pkgList = boost::algorithm::join(cranPackages, ",");
-      cmd += "utils::install.packages(c(" + pkgList + "), " +
-             "repos = '"+ module_context::CRANReposURL() + "'";
-      cmd += ");";
-   }
-   if (!cranSourcePackages.empty())
-   {
-      std::string pkgList = boost::algorithm::join(cranSourcePackages, ",");
-      cmd += "utils::install.packages(c(" + pkgList + "), " +
-             "repos = '"+ module_context::CRANReposURL() + "', ";
-      cmd += "type = 'source');";
-   }
+   // build install command; the installer resolves and downloads all of
+   // the packages up front and builds as many at once as we have cpus for
+   std::vector<std::string> archives;
    BOOST_FOREACH(const std::string& pkg, embeddedPackages)
    {
-      cmd += "utils::install.packages('" + pkg + "', "
-                                      "repos = NULL, type = 'source');";
+      archives.push_back("'" + pkg + "'");
    }
+   std::string installerPath = string_utils::utf8ToSystem(
+         string_utils::singleQuotedStrEscape(
+            session::options().modulesRSourcePath()
+                              .complete("InstallDependencies.R").absolutePath()));
+   std::string cmd("{ " + module_context::CRANDownloadOptions() + "; ");
+   cmd += "source('" + installerPath + "'); ";
+   cmd += "installDependencies("
+          "packages = c(" + boost::algorithm::join(cranPackages, ",") + "), "
+          "sourcePackages = c(" + boost::algorithm::join(cranSourcePackages, ",") + "), "
+          "archives = c(" + boost::algorithm::join(archives, ",") + "), "
+          "repos = '" + module_context::CRANReposURL() + "', "
+          "ncpus = " + safe_convert::numberToString(installCpuCount()) + "L);";
    cmd += "}";
 
    // build args
@@ -410,6 +506,12 @@ Error installDependencies(const json::JsonRpcRequest& request,
             options,
             pCPI);
 
+   // report progress in the jobs pane as well as the install dialog
+   boost::shared_ptr<InstallProgress> pProgress = boost::make_shared<InstallProgress>(
+            static_cast<int>(embeddedPackages.size()));
+   pCP->onOutput().connect(boost::bind(&InstallProgress::onOutput, pProgress, _1));
+   pCP->onExit().connect(boost::bind(&InstallProgress::onExit, pProgress, _1));
+
    // return console process
    pResponse->setResult(pCP->toJson());
    return Success();
@@ -24,12 +24,16 @@
 #include "SessionAsyncPackageInformation.hpp"
 #include "SessionRParser.hpp"
 
+#include <deque>
 #include <set>
 
 #include <core/Debug.hpp>
 #include <core/Exec.hpp>
 #include <core/Error.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/Hash.hpp>
+#include <core/InternedString.hpp>
+#include <core/Thread.hpp>
 #include <core/YamlUtil.hpp>
 
 #include <session/SessionRUtil.hpp>
@@ -41,8 +45,12 @@
 #include "shiny/SessionShiny.hpp"
 
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/range/adaptor/map.hpp>
 
 #include <r/RSexp.hpp>
@@ -69,6 +77,15 @@ using namespace rparser;
 
 namespace {
 
+template <typename Strings>
+void insertInterned(const Strings& strings, InternedStringSet* pSymbols)
+{
+   BOOST_FOREACH(const std::string& string, strings)
+   {
+      pSymbols->insert(InternedString(string));
+   }
+}
+
 void addUnreferencedSymbol(const ParseItem& item,
                            LintItems& lint)
 {
@@ -135,7 +152,7 @@ void checkDefinedButNotUsed(ParseResults& results)
 
 void addInferredSymbols(const FilePath& filePath,
                         const std::string& documentId,
-                        std::set<std::string>* pSymbols)
+                        InternedStringSet* pSymbols)
 {
    using namespace code_search;
    using namespace source_database;
@@ -157,37 +174,37 @@ void addInferredSymbols(const FilePath& filePath,
       const PackageInformation& completions =
             pIndex->getPackageInformation(package);
       
-      core::algorithm::append(pSymbols, completions.exports);
-      core::algorithm::append(pSymbols, completions.datasets);
+      insertInterned(completions.exports, pSymbols);
+      insertInterned(completions.datasets, pSymbols);
    }
    
    // make 'shiny' implicitly available in shiny documents
    if (modules::shiny::getShinyFileType(filePath) != modules::shiny::ShinyNone)
    {
       const PackageInformation& completions = pIndex->getPackageInformation("shiny");
-      pSymbols->insert(completions.exports.begin(), completions.exports.end());
+      insertInterned(completions.exports, pSymbols);
    }
    
    // make 'params' implicitly available if we have a YAML header
    if (yaml::hasYamlHeader(filePath))
-      pSymbols->insert("params");
+      pSymbols->insert(InternedString("params"));
    
    // make 'input', 'output' implicitly available in Shiny documents
    if (modules::shiny::isShinyRMarkdownDocument(filePath))
    {
-      pSymbols->insert("input");
-      pSymbols->insert("output");
+      pSymbols->insert(InternedString("input"));
+      pSymbols->insert(InternedString("output"));
    }
 }
 
-void addNamespaceSymbols(std::set<std::string>* pSymbols)
+void addNamespaceSymbols(InternedStringSet* pSymbols)
 {
    // Add symbols specifically mentioned as 'importFrom'
    // directives in the NAMESPACE.
    BOOST_FOREACH(const std::set<std::string>& symbolNames,
                  RSourceIndex::getImportFromDirectives() | boost::adaptors::map_values)
    {
-      pSymbols->insert(symbolNames.begin(), symbolNames.end());
+      insertInterned(symbolNames, pSymbols);
    }
    
    // Make all (exported) symbols published by packages
@@ -200,8 +217,8 @@ void addNamespaceSymbols(std::set<std::string>* pSymbols)
             RSourceIndex::getPackageInformation(package);
       
       DEBUG("--- Adding " << pkgInfo.exports.size() << " symbols");
-      core::algorithm::append(pSymbols, pkgInfo.exports);
-      core::algorithm::append(pSymbols, pkgInfo.datasets);
+      insertInterned(pkgInfo.exports, pSymbols);
+      insertInterned(pkgInfo.datasets, pSymbols);
    }
 }
 
@@ -209,10 +226,12 @@ class PackageSymbolRegistry : boost::noncopyable
 {
 public:
    
-   typedef std::map<std::string, std::vector<std::string> > Registry;
+   // symbols are interned once, when first registered, so filling a
+   // document's symbol set doesn't copy or rehash any text
+   typedef std::map<std::string, std::vector<InternedString> > Registry;
    
    void fillPackageSymbols(const std::string& pkgName,
-                           std::set<std::string>* pOutput)
+                           InternedStringSet* pOutput)
    {
       if (!registry_.count(pkgName))
       {
@@ -220,45 +239,73 @@ public:
          if (envSEXP == R_EmptyEnv)
             return;
          
-         Error error = r::sexp::objects(envSEXP, true, &registry_[pkgName]);
+         std::vector<std::string> symbols;
+         Error error = r::sexp::objects(envSEXP, true, &symbols);
          if (error) LOG_ERROR(error);
+         setSymbols(pkgName, symbols);
       }
       
-      const std::vector<std::string>& symbols = registry_[pkgName];
+      const std::vector<InternedString>& symbols = registry_[pkgName];
       pOutput->insert(
                symbols.begin(),
                symbols.end());
    }
    
    void fillNamespaceSymbols(const std::string& pkgName,
-                             std::set<std::string>* pOutput,
+                             InternedStringSet* pOutput,
                              bool exportsOnly = true)
    {
+      if (!registry_.count(pkgName))
+      {
+         // exports are known without loading the namespace if the package
+         // information has been indexed (see AsyncPackageInformationProcess)
+         if (exportsOnly && RSourceIndex::hasInformation(pkgName))
+         {
+            const PackageInformation& info = RSourceIndex::getPackageInformation(pkgName);
+            if (!info.exports.empty())
+               setSymbols(pkgName, info.exports);
+         }
+      }
+      
       if (!registry_.count(pkgName))
       {
          SEXP envSEXP = r::sexp::asNamespace(pkgName);
          if (envSEXP == R_EmptyEnv)
             return;
 
+         std::vector<std::string> symbols;
          if (exportsOnly)
          {
-            Error error = r::sexp::getNamespaceExports(envSEXP, &registry_[pkgName]);
+            Error error = r::sexp::getNamespaceExports(envSEXP, &symbols);
             if (error) LOG_ERROR(error);
          }
          else
          {
-            Error error = r::sexp::objects(envSEXP, true, &registry_[pkgName]);
+            Error error = r::sexp::objects(envSEXP, true, &symbols);
             if (error) LOG_ERROR(error);
          }
+         setSymbols(pkgName, symbols);
       }
       
-      const std::vector<std::string>& symbols = registry_[pkgName];
+      const std::vector<InternedString>& symbols = registry_[pkgName];
       pOutput->insert(
                symbols.begin(),
                symbols.end());
    }
    
 private:
+   void setSymbols(const std::string& pkgName,
+                   const std::vector<std::string>& symbols)
+   {
+      std::vector<InternedString>& interned = registry_[pkgName];
+      interned.clear();
+      interned.reserve(symbols.size());
+      BOOST_FOREACH(const std::string& symbol, symbols)
+      {
+         interned.push_back(InternedString(symbol));
+      }
+   }
+   
    Registry registry_;
 };
 
@@ -268,7 +315,7 @@ PackageSymbolRegistry& packageSymbolRegistry()
    return instance;
 }
 
-void addBaseSymbols(std::set<std::string>* pSymbols)
+void addBaseSymbols(InternedStringSet* pSymbols)
 {
    PackageSymbolRegistry& registry = packageSymbolRegistry();
    registry.fillPackageSymbols("base", pSymbols);
@@ -282,7 +329,7 @@ void addBaseSymbols(std::set<std::string>* pSymbols)
 
 void addRcppExportedSymbols(const FilePath& filePath,
                             const std::string& documentId,
-                            std::set<std::string>* pSymbols)
+                            InternedStringSet* pSymbols)
 {
    if (!(filePath.hasExtensionLowerCase(".cpp") || filePath.hasExtensionLowerCase(".cc")))
       return;
@@ -313,7 +360,7 @@ void addRcppExportedSymbols(const FilePath& filePath,
             continue;
          
          std::string fnName = string_utils::substring(start, lastSpace + 1);
-         pSymbols->insert(fnName);
+         pSymbols->insert(InternedString(fnName));
       }
    }
 }
@@ -329,7 +376,7 @@ void addRcppExportedSymbols(const FilePath& filePath,
 // since they would not get properly resolved at runtime.
 Error getAvailableSymbolsForPackage(const FilePath& filePath,
                                     const std::string& documentId,
-                                    std::set<std::string>* pSymbols)
+                                    InternedStringSet* pSymbols)
 {
    // Add project symbols (ie, top-level symbols within an R package)
    code_search::addAllProjectSymbols(pSymbols);
@@ -362,12 +409,14 @@ Error getAvailableSymbolsForPackage(const FilePath& filePath,
 // the current search path.
 Error getAvailableSymbolsForProject(const FilePath& filePath,
                                     const std::string& documentId,
-                                    std::set<std::string>* pSymbols)
+                                    InternedStringSet* pSymbols)
 {
    // Get all available symbols on the search path.
-   Error error = r::exec::RFunction(".rs.availableRSymbols").call(pSymbols);
+   std::vector<std::string> symbols;
+   Error error = r::exec::RFunction(".rs.availableRSymbols").call(&symbols);
    if (error)
       return error;
+   insertInterned(symbols, pSymbols);
    
    // Add in symbols that would be made available by `// [[Rcpp::export]]`
    addRcppExportedSymbols(filePath, documentId, pSymbols);
@@ -379,7 +428,7 @@ Error getAvailableSymbolsForProject(const FilePath& filePath,
    return Success();
 }
 
-void addTestPackageSymbols(std::set<std::string>* pSymbols)
+void addTestPackageSymbols(InternedStringSet* pSymbols)
 {
    if (!projects::projectContext().isPackageProject())
       return;
@@ -405,8 +454,7 @@ void addTestPackageSymbols(std::set<std::string>* pSymbols)
 
 Error getAllAvailableRSymbols(const FilePath& filePath,
                               const std::string& documentId,
-                              const ParseResults& results,
-                              std::set<std::string>* pSymbols)
+                              InternedStringSet* pSymbols)
 {
    // If this file lies within the current project, then
    // we want to pull symbols from specific places -- specifically,
@@ -459,14 +507,13 @@ Error getAllAvailableRSymbols(const FilePath& filePath,
       registry.fillNamespaceSymbols("shiny", pSymbols, false);
    }
    
-   pSymbols->insert(results.globals().begin(), results.globals().end());
-   
    return error;
       
 }
 
-void checkNoDefinitionInScope(const FilePath& origin,
-                              const std::string& documentId,
+// the available symbols are those on the search path, or symbols that would
+// otherwise be made available at runtime (e.g. package imports)
+void checkNoDefinitionInScope(const InternedStringSet& availableSymbols,
                               ParseResults& results)
 {
    ParseNode* pRoot = results.parseTree();
@@ -474,24 +521,20 @@ void checkNoDefinitionInScope(const FilePath& origin,
    std::vector<ParseItem> unresolvedItems;
    pRoot->findAllUnresolvedSymbols(&unresolvedItems);
    
-   // Now, find all available R symbols -- that is, objects on the search path,
-   // or symbols that would otherwise be made available at runtime (e.g.
-   // package imports)
-   std::set<std::string> objects;
-   Error error = getAllAvailableRSymbols(origin, documentId, results, &objects);
-   if (error)
-   {
-      LOG_ERROR(error);
-      return;
-   }
-   
    // For each unresolved symbol, add it to the lint if it's not on the search
    // path.
+   const std::set<std::string>& globals = results.globals();
    BOOST_FOREACH(const ParseItem& item, unresolvedItems)
    {
+      // a symbol that was never interned can't be available
+      std::string symbol = string_utils::strippedOfBackQuotes(item.symbol);
+      InternedString interned;
+      bool available = InternedString::find(symbol, &interned) &&
+                       availableSymbols.count(interned);
       if (!r::util::isRKeyword(item.symbol) &&
           !r::util::isWindowsOnlyFunction(item.symbol) &&
-          objects.count(string_utils::strippedOfBackQuotes(item.symbol)) == 0)
+          !available &&
+          globals.count(symbol) == 0)
       {
          addUnreferencedSymbol(item, results.lint());
       }
@@ -544,7 +587,7 @@ void parseLintOption(const std::string& text, FileLocalLintOptions* pOptions)
 {
    using namespace core::text;
    
-   boost::regex reGlobals("^\\s*suppress\\s*=");
+   static boost::regex reGlobals("^\\s*suppress\\s*=");
    if (regex_utils::search(text, reGlobals))
       return parseLintOptionGlobals(text, pOptions);
    
@@ -606,12 +649,16 @@ void setFileLocalParseOptions(const std::wstring& rCode,
    using namespace string_utils;
    
    // Extract all of the lint commands.
-   boost::regex reLintComments(kLintComment);
+   static boost::regex reLintComments(kLintComment);
    std::vector<std::string> lintCommands;
    boost::wsmatch match;
    
+   // most documents have no lint comments, so only search those which
+   // might (rather than running the regex over the whole document)
    std::wstring::const_iterator start = rCode.begin();
    std::wstring::const_iterator end = rCode.end();
+   if (rCode.find(L"!diagnostics") == std::wstring::npos)
+      start = end;
    while (regex_utils::search(start, end, match, reLintComments))
    {
       std::wstring::const_iterator matchBegin = match[0].second;
@@ -632,14 +679,10 @@ void setFileLocalParseOptions(const std::wstring& rCode,
    applyOptions(options, pOptions);
 }
 
-} // end anonymous namespace
-
-ParseResults parse(const std::wstring& rCode,
-                   const FilePath& origin,
-                   const std::string& documentId = std::string(),
-                   bool isExplicit = false)
+ParseOptions documentParseOptions(const std::wstring& rCode,
+                                  bool isExplicit,
+                                  bool* pNoLint)
 {
-   ParseResults results;
    ParseOptions options;
    
    options.setLintRFunctions(
@@ -657,8 +700,56 @@ ParseResults parse(const std::wstring& rCode,
    options.setRecordStyleLint(
             userSettings().enableStyleDiagnostics());
    
+   setFileLocalParseOptions(rCode, &options, pNoLint);
+   return options;
+}
+
+// run the checks which need the parse tree of the whole document. the
+// symbol check is skipped if the available symbols aren't known
+void checkParseResults(const ParseOptions& options,
+                       const InternedStringSet* pAvailableSymbols,
+                       ParseResults& results)
+{
+   if (options.warnIfNoSuchVariableInScope() && pAvailableSymbols)
+      checkNoDefinitionInScope(*pAvailableSymbols, results);
+   
+   if (options.warnIfVariableIsDefinedButNotUsed())
+      checkDefinedButNotUsed(results);
+}
+
+// get the symbols available to a document (on the main thread) if the
+// parse options call for them
+boost::shared_ptr<InternedStringSet> availableSymbolsIfNeeded(
+      const FilePath& origin,
+      const std::string& documentId,
+      const ParseOptions& options)
+{
+   boost::shared_ptr<InternedStringSet> pSymbols;
+   if (!options.warnIfNoSuchVariableInScope())
+      return pSymbols;
+   
+   pSymbols.reset(new InternedStringSet());
+   Error error = getAllAvailableRSymbols(origin, documentId, pSymbols.get());
+   if (error)
+   {
+      LOG_ERROR(error);
+      pSymbols.reset();
+   }
+   
+   return pSymbols;
+}
+
+} // anonymous namespace
+
+ParseResults parse(const std::wstring& rCode,
+                   const FilePath& origin,
+                   const std::string& documentId = std::string(),
+                   bool isExplicit = false)
+{
+   ParseResults results;
+   
    bool noLint = false;
-   setFileLocalParseOptions(rCode, &options, &noLint);
+   ParseOptions options = documentParseOptions(rCode, isExplicit, &noLint);
    if (noLint)
       return ParseResults();
    
@@ -681,12 +772,9 @@ ParseResults parse(const std::wstring& rCode,
       return ParseResults();
    }
    
-   if (options.warnIfNoSuchVariableInScope())
-      checkNoDefinitionInScope(origin, documentId, results);
-   
-   if (options.warnIfVariableIsDefinedButNotUsed())
-      checkDefinedButNotUsed(results);
-   
+   boost::shared_ptr<InternedStringSet> pSymbols =
+         availableSymbolsIfNeeded(origin, documentId, options);
+   checkParseResults(options, pSymbols.get(), results);
    return results;
 }
 
@@ -699,6 +787,370 @@ ParseResults parse(const std::string& rCode,
 
 namespace {
 
+// Incremental linting of source documents. A document is split into its
+// top-level expressions, and the parse tree and lint of each expression are
+// cached; when the document is linted again only the expressions which have
+// changed are parsed. Since calls are checked against functions defined
+// earlier in the document, an expression is parsed together with (and its
+// cached results depend upon) the earlier expressions defining the top-level
+// functions it refers to.
+struct TopLevelExpression
+{
+   TopLevelExpression()
+      : offset(0), row(0), endRow(std::string::npos) {}
+   
+   std::size_t offset; // in bytes
+   std::string code;
+   std::size_t row;
+   std::size_t endRow; // the row at which the next expression starts
+   std::set<std::string> definedFunctions;
+   std::set<std::string> identifiers;
+};
+
+struct CachedExpression
+{
+   std::size_t row;
+   std::string dependencies;
+   boost::shared_ptr<ParseNode> pNode;
+   std::vector<LintItem> lint;
+};
+
+// documents are linted on a background thread (see lintRSourceDocument), so
+// each cache is locked while in use, and the map of caches while looking one
+// up or removing one
+struct DocumentParseCache : boost::noncopyable
+{
+   boost::mutex mutex;
+   std::string optionsKey;
+   std::map<std::string, std::vector<CachedExpression> > expressions;
+   
+   // the document's tokens, updated (rather than tokenized afresh) as the
+   // document is edited
+   boost::scoped_ptr<RCompactTokens> pTokens;
+};
+
+boost::mutex s_documentParseCachesMutex;
+std::map<std::string, boost::shared_ptr<DocumentParseCache> > s_documentParseCaches;
+
+boost::shared_ptr<DocumentParseCache> documentParseCache(const std::string& documentId)
+{
+   boost::shared_ptr<DocumentParseCache> pCache;
+   LOCK_MUTEX(s_documentParseCachesMutex)
+   {
+      pCache = s_documentParseCaches[documentId];
+      if (!pCache)
+      {
+         pCache.reset(new DocumentParseCache());
+         s_documentParseCaches[documentId] = pCache;
+      }
+   }
+   END_LOCK_MUTEX
+   
+   return pCache;
+}
+
+bool isKeywordPrecedingBody(const std::string& content)
+{
+   return content == "function" || content == "if" || content == "for" ||
+          content == "while" || content == "repeat" || content == "else";
+}
+
+std::string compactSymbolName(const RCompactTokens& tokens,
+                              const RCompactToken& token)
+{
+   std::string content = tokens.content(token);
+   if (token.isType(RToken::STRING) ||
+       (token.isType(RToken::ID) && !content.empty() && content[0] == '`'))
+   {
+      if (content.size() < 2)
+         return std::string();
+      return content.substr(1, content.size() - 2);
+   }
+   return content;
+}
+
+void findTopLevelExpressions(const RCompactTokens& tokens,
+                             std::vector<TopLevelExpression>* pExpressions)
+{
+   const std::string& code = tokens.code();
+   
+   TopLevelExpression current;
+   std::size_t depth = 0;
+   bool newline = false;
+   
+   // the previous two significant tokens
+   const RCompactToken* pPrev = NULL;
+   const RCompactToken* pPrevPrev = NULL;
+   
+   // whether the last ')' closed the condition of an 'if', 'for', etc.
+   // (and so must be followed by a body)
+   bool inHeader = false;
+   bool closedHeader = false;
+   
+   for (RCompactTokens::const_iterator it = tokens.begin();
+        it != tokens.end();
+        ++it)
+   {
+      const RCompactToken& token = *it;
+      if (token.isType(RToken::WHITESPACE))
+      {
+         if (tokens.content(token).find('\n') != std::string::npos)
+            newline = true;
+         continue;
+      }
+      
+      if (token.isType(RToken::COMMENT))
+         continue;
+      
+      std::string content = tokens.content(token);
+      
+      // a new expression starts on a line of its own, at the top level,
+      // once the previous expression cannot continue
+      if (pPrev && depth == 0 && newline && token.column == 0 &&
+          content != "else")
+      {
+         bool continues =
+               pPrev->isType(RToken::OPER) ||
+               pPrev->isType(RToken::UOPER) ||
+               pPrev->isType(RToken::COMMA) ||
+               (pPrev->isType(RToken::ID) &&
+                isKeywordPrecedingBody(tokens.content(*pPrev))) ||
+               (pPrev->isType(RToken::RPAREN) && closedHeader);
+         
+         if (!continues)
+         {
+            current.code = code.substr(current.offset, token.offset - current.offset);
+            current.endRow = token.row;
+            pExpressions->push_back(current);
+            
+            current = TopLevelExpression();
+            current.offset = token.offset;
+            current.row = token.row;
+         }
+      }
+      newline = false;
+      
+      if (token.isType(RToken::LPAREN) || token.isType(RToken::LBRACE) ||
+          token.isType(RToken::LBRACKET) || token.isType(RToken::LDBRACKET))
+      {
+         if (depth == 0 && token.isType(RToken::LPAREN) && pPrev &&
+             pPrev->isType(RToken::ID) &&
+             isKeywordPrecedingBody(tokens.content(*pPrev)))
+            inHeader = true;
+         ++depth;
+      }
+      else if (token.isType(RToken::RPAREN) || token.isType(RToken::RBRACE) ||
+               token.isType(RToken::RBRACKET) || token.isType(RToken::RDBRACKET))
+      {
+         if (depth > 0)
+            --depth;
+      }
+      
+      closedHeader = false;
+      if (depth == 0 && inHeader && token.isType(RToken::RPAREN))
+      {
+         inHeader = false;
+         closedHeader = true;
+      }
+      
+      if (token.isType(RToken::ID))
+         current.identifiers.insert(compactSymbolName(tokens, token));
+      
+      // top-level function definitions, e.g. 'f <- function'
+      if (depth == 0 && content == "function" && pPrev && pPrevPrev &&
+          pPrev->isType(RToken::OPER) &&
+          (tokens.contentEquals(*pPrev, "<-") ||
+           tokens.contentEquals(*pPrev, "<<-") ||
+           tokens.contentEquals(*pPrev, "=")) &&
+          (pPrevPrev->isType(RToken::ID) || pPrevPrev->isType(RToken::STRING)))
+      {
+         current.definedFunctions.insert(compactSymbolName(tokens, *pPrevPrev));
+      }
+      
+      pPrevPrev = pPrev;
+      pPrev = &token;
+   }
+   
+   current.code = code.substr(current.offset);
+   pExpressions->push_back(current);
+}
+
+std::string parseOptionsKey(const ParseOptions& options)
+{
+   std::ostringstream oss;
+   oss << options.lintRFunctions()
+       << options.checkArgumentsToRFunctionCalls()
+       << options.warnIfNoSuchVariableInScope()
+       << options.warnIfVariableIsDefinedButNotUsed()
+       << options.recordStyleLint();
+   BOOST_FOREACH(const std::string& global, options.globals())
+      oss << ";" << global;
+   return oss.str();
+}
+
+CachedExpression parseExpression(
+      const std::vector<TopLevelExpression>& expressions,
+      std::size_t index,
+      const std::vector<std::size_t>& dependencies,
+      const FilePath& origin,
+      const ParseOptions& options)
+{
+   const TopLevelExpression& expression = expressions[index];
+   
+   // place the expression (after those it depends upon) at its position in
+   // the document, so the parse reports the document's rows
+   std::string code;
+   std::size_t row = 0;
+   std::vector<std::size_t> parts(dependencies);
+   parts.push_back(index);
+   BOOST_FOREACH(std::size_t part, parts)
+   {
+      const TopLevelExpression& partExpression = expressions[part];
+      if (partExpression.row > row)
+         code.append(partExpression.row - row, '\n');
+      code.append(partExpression.code);
+      row = partExpression.row +
+            std::count(partExpression.code.begin(), partExpression.code.end(), '\n');
+   }
+   
+   ParseResults results = rparser::parse(
+            origin, string_utils::utf8ToWide(code), options);
+   
+   CachedExpression cached;
+   cached.row = expression.row;
+   cached.pNode = ParseNode::createRootNode();
+   if (results.parseTree())
+   {
+      cached.pNode->addContentsInRows(
+               *results.parseTree(), expression.row, expression.endRow);
+   }
+   
+   const LintItems& lint = results.lint();
+   BOOST_FOREACH(const LintItem& item, lint)
+   {
+      std::size_t startRow = item.startRow;
+      if (startRow >= expression.row && startRow < expression.endRow)
+         cached.lint.push_back(item);
+   }
+   
+   return cached;
+}
+
+// Lint the document using its parse cache, which must be locked by the
+// caller (the parse tree of the results shares nodes with the cache)
+ParseResults parseIncrementally(const std::string& code,
+                                const FilePath& origin,
+                                const ParseOptions& options,
+                                const InternedStringSet* pAvailableSymbols,
+                                DocumentParseCache& cache)
+{
+   std::string optionsKey = parseOptionsKey(options);
+   if (cache.optionsKey != optionsKey)
+   {
+      cache.expressions.clear();
+      cache.optionsKey = optionsKey;
+   }
+   
+   // expressions no longer in the document are dropped from the cache
+   std::map<std::string, std::vector<CachedExpression> > previous;
+   previous.swap(cache.expressions);
+   
+   if (cache.pTokens)
+      cache.pTokens->update(code);
+   else
+      cache.pTokens.reset(new RCompactTokens(code));
+   
+   std::vector<TopLevelExpression> expressions;
+   findTopLevelExpressions(*cache.pTokens, &expressions);
+   
+   boost::shared_ptr<ParseNode> pRoot = ParseNode::createRootNode();
+   LintItems lint(options);
+   
+   // expressions defining each top-level function, in order
+   std::map<std::string, std::vector<std::size_t> > definitions;
+   
+   for (std::size_t i = 0, n = expressions.size(); i < n; ++i)
+   {
+      const TopLevelExpression& expression = expressions[i];
+      
+      std::set<std::size_t> dependencySet;
+      BOOST_FOREACH(const std::string& identifier, expression.identifiers)
+      {
+         std::map<std::string, std::vector<std::size_t> >::const_iterator it =
+               definitions.find(identifier);
+         if (it != definitions.end())
+            dependencySet.insert(it->second.begin(), it->second.end());
+      }
+      
+      std::vector<std::size_t> dependencies(dependencySet.begin(), dependencySet.end());
+      std::string dependencyKey;
+      BOOST_FOREACH(std::size_t dependency, dependencies)
+         dependencyKey += core::hash::crc32HexHash(expressions[dependency].code) + ";";
+      
+      std::vector<CachedExpression>& candidates = previous[expression.code];
+      std::vector<CachedExpression>::iterator match = candidates.begin();
+      while (match != candidates.end() && match->dependencies != dependencyKey)
+         ++match;
+      
+      CachedExpression cached;
+      if (match != candidates.end())
+      {
+         cached = *match;
+         candidates.erase(match);
+         
+         // the expression may have moved since it was parsed
+         if (cached.row != expression.row)
+         {
+            int delta = static_cast<int>(expression.row) - static_cast<int>(cached.row);
+            cached.pNode->shiftRows(delta);
+            BOOST_FOREACH(LintItem& item, cached.lint)
+            {
+               item.startRow += delta;
+               item.endRow += delta;
+            }
+            cached.row = expression.row;
+         }
+      }
+      else
+      {
+         cached = parseExpression(expressions, i, dependencies, origin, options);
+         cached.dependencies = dependencyKey;
+      }
+      
+      pRoot->addContentsInRows(*cached.pNode, 0, std::string::npos);
+      
+      BOOST_FOREACH(const LintItem& item, cached.lint)
+         lint.push_back(item);
+      
+      BOOST_FOREACH(const std::string& name, expression.definedFunctions)
+         definitions[name].push_back(i);
+      
+      cache.expressions[expression.code].push_back(cached);
+   }
+   
+   ParseResults results(pRoot, lint, options.globals());
+   checkParseResults(options, pAvailableSymbols, results);
+   return results;
+}
+
+void onDocRemoved(const std::string& id, const std::string&)
+{
+   LOCK_MUTEX(s_documentParseCachesMutex)
+   {
+      s_documentParseCaches.erase(id);
+   }
+   END_LOCK_MUTEX
+}
+
+void onRemoveAll()
+{
+   LOCK_MUTEX(s_documentParseCachesMutex)
+   {
+      s_documentParseCaches.clear();
+   }
+   END_LOCK_MUTEX
+}
+
 json::Array lintAsJson(const LintItems& items)
 {
    json::Array jsonArray;
@@ -767,13 +1219,55 @@ module_context::SourceMarkerSet asSourceMarkerSet(
    return SourceMarkerSet("Diagnostics", markers);
 }
 
-Error lintRSourceDocument(const json::JsonRpcRequest& request,
-                          json::JsonRpcResponse* pResponse)
+// Source documents are linted in two steps, so that linting a large document
+// never holds up the console: the lookups into R the parser makes (and the
+// symbols available to the document) are snapshotted on the main thread, then
+// the document is parsed and linted on a background thread, with the lint
+// delivered to the client through the event queue.
+struct LintRequest
 {
-   using namespace source_database;
+   LintRequest() : noLint(false), showMarkersTab(false) {}
    
-   // Ensure response is always at least an array, even on 'failure'
-   pResponse->setResult(json::Array());
+   FilePath origin;
+   FilePath markersPath;
+   std::string documentId;
+   std::string code;
+   bool noLint;
+   ParseOptions options;
+   boost::shared_ptr<InternedStringSet> pAvailableSymbols;
+   bool showMarkersTab;
+};
+
+// snapshot what linting the code needs from R
+void prepareLintRequest(const std::string& code,
+                        const FilePath& origin,
+                        const std::string& documentId,
+                        bool isExplicit,
+                        LintRequest* pLint)
+{
+   std::wstring wideCode = string_utils::utf8ToWide(code);
+   ParseOptions options = documentParseOptions(wideCode, isExplicit, &pLint->noLint);
+   if (pLint->noLint)
+      return;
+   
+   boost::shared_ptr<RSnapshot> pSnapshot(new RSnapshot());
+   collectRSnapshot(origin, wideCode, options, pSnapshot.get());
+   options.setRSnapshot(pSnapshot);
+   
+   pLint->origin = origin;
+   pLint->documentId = documentId;
+   pLint->code = code;
+   pLint->options = options;
+   pLint->pAvailableSymbols = availableSymbolsIfNeeded(origin, documentId, options);
+}
+
+// markers are shown on the main thread (see onBackgroundProcessing)
+core::thread::ThreadsafeQueue<module_context::SourceMarkerSet> s_pendingMarkers;
+
+Error initLintRSourceDocument(const json::JsonRpcRequest& request,
+                              LintRequest* pLint)
+{
+   using namespace source_database;
    
    std::string documentId;
    std::string documentPath;
@@ -805,7 +1299,10 @@ Error lintRSourceDocument(const json::JsonRpcRequest& request,
    
    // Don't lint files that belong to unmonitored projects
    if (module_context::isUnmonitoredPackageSourceFile(origin))
+   {
+      pLint->noLint = true;
       return Success();
+   }
    
    // Extract R code from various R-code-containing filetypes.
    std::string content;
@@ -813,25 +1310,50 @@ Error lintRSourceDocument(const json::JsonRpcRequest& request,
    if (error)
       return error;
    
-   ParseResults results = diagnostics::parse(
-            string_utils::utf8ToWide(content),
-            origin,
-            documentId,
-            isExplicit);
-   
-   pResponse->setResult(lintAsJson(results.lint()));
+   prepareLintRequest(content, origin, documentId, isExplicit, pLint);
+   pLint->markersPath = FilePath(pDoc->path());
+   pLint->showMarkersTab = showMarkersTab;
+   return Success();
+}
+
+// NOTE: runs on a background thread
+Error lintRSourceDocument(const json::JsonRpcRequest& request,
+                          const LintRequest& lint,
+                          json::JsonRpcResponse* pResponse)
+{
+   // Ensure response is always at least an array, even on 'failure'
+   pResponse->setResult(json::Array());
+   if (lint.noLint)
+      return Success();
    
-   if (showMarkersTab)
+   boost::shared_ptr<DocumentParseCache> pCache = documentParseCache(lint.documentId);
+   LOCK_MUTEX(pCache->mutex)
    {
-      using namespace module_context;
-      SourceMarkerSet markers = asSourceMarkerSet(results.lint(),
-                                                  core::FilePath(pDoc->path()));
-      showSourceMarkers(markers, MarkerAutoSelectNone);
+      ParseResults results = parseIncrementally(
+               lint.code,
+               lint.origin,
+               lint.options,
+               lint.pAvailableSymbols.get(),
+               *pCache);
+      
+      pResponse->setResult(lintAsJson(results.lint()));
+      
+      if (lint.showMarkersTab)
+         s_pendingMarkers.enque(asSourceMarkerSet(results.lint(), lint.markersPath));
    }
+   END_LOCK_MUTEX
    
    return Success();
 }
 
+void onBackgroundProcessing(bool)
+{
+   using namespace module_context;
+   SourceMarkerSet markers;
+   while (s_pendingMarkers.deque(&markers))
+      showSourceMarkers(markers, MarkerAutoSelectNone);
+}
+
 SEXP rs_lintRFile(SEXP filePathSEXP)
 {
    using namespace r::sexp;
@@ -970,35 +1492,250 @@ void afterSessionInitHook(bool newSession)
    }
 }
 
-bool collectLint(int depth,
-                 const FilePath& path,
-                 std::map<FilePath, LintItems>* pLint)
+// NOTE: runs on a background thread
+ParseResults lintFile(const LintRequest& lint)
 {
-   if (path.extensionLowerCase() != ".r")
-      return true;
+   if (lint.noLint)
+      return ParseResults();
    
-   std::string contents;
-   Error error = core::readStringFromFile(
-            path,
-            &contents,
-            string_utils::LineEndingPosix);
+   ParseResults results = rparser::parse(
+            lint.origin,
+            string_utils::utf8ToWide(lint.code),
+            lint.options);
    
-   if (error)
+   if (!results.parseTree())
+      return ParseResults();
+   
+   checkParseResults(lint.options, lint.pAvailableSymbols.get(), results);
+   return results;
+}
+
+const int kMaxLintThreads = 8;
+
+// Lints the R files within a directory. Files are read, and what linting
+// them needs from R is snapshotted, on the main thread (as incremental work
+// during idle time), while a pool of background threads parses and lints
+// them. The Markers pane is updated with the lint found so far as files
+// complete.
+class DirectoryLint : boost::noncopyable,
+                      public boost::enable_shared_from_this<DirectoryLint>
+{
+public:
+   
+   explicit DirectoryLint(const std::vector<FilePath>& files)
+      : files_(files),
+        next_(0),
+        prepared_(false),
+        stopped_(false),
+        activeThreads_(0)
    {
-      LOG_ERROR(error);
+   }
+   
+   void start()
+   {
+      int threads = static_cast<int>(boost::thread::hardware_concurrency());
+      threads = std::max(1, std::min(threads, kMaxLintThreads));
+      
+      LOCK_MUTEX(mutex_)
+      {
+         activeThreads_ = threads;
+      }
+      END_LOCK_MUTEX
+      
+      // threads keep us alive until they exit
+      for (int i = 0; i < threads; i++)
+      {
+         core::thread::safeLaunchThread(
+                  boost::bind(&DirectoryLint::lintFiles, shared_from_this()));
+      }
+      
+      module_context::scheduleIncrementalWork(
+               boost::posix_time::milliseconds(20),
+               boost::bind(&DirectoryLint::prepareFile, shared_from_this()),
+               true,
+               WorkPriorityNormal,
+               "directory_lint");
+      
+      module_context::schedulePeriodicWork(
+               boost::posix_time::milliseconds(250),
+               boost::bind(&DirectoryLint::showLint, shared_from_this()),
+               false,
+               false);
+   }
+   
+   void stop()
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         stopped_ = true;
+         pending_.clear();
+      }
+      END_LOCK_MUTEX
+      
+      condition_.notify_all();
+   }
+   
+private:
+   
+   bool stopped()
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         return stopped_;
+      }
+      END_LOCK_MUTEX
+      
+      return true;
+   }
+   
+   // prepare the next file to be linted; returns false once all the files
+   // have been prepared
+   bool prepareFile()
+   {
+      if (stopped() || next_ == files_.size())
+      {
+         LOCK_MUTEX(mutex_)
+         {
+            prepared_ = true;
+         }
+         END_LOCK_MUTEX
+         
+         condition_.notify_all();
+         return false;
+      }
+      
+      const FilePath& path = files_[next_++];
+      
+      std::string contents;
+      Error error = core::readStringFromFile(
+               path,
+               &contents,
+               string_utils::LineEndingPosix);
+      
+      if (error)
+      {
+         LOG_ERROR(error);
+         return true;
+      }
+      
+      LintRequest lint;
+      prepareLintRequest(contents, path, std::string(), true, &lint);
+      lint.origin = path;
+      
+      LOCK_MUTEX(mutex_)
+      {
+         pending_.push_back(lint);
+      }
+      END_LOCK_MUTEX
+      
+      condition_.notify_one();
       return true;
    }
    
-   ParseResults results = diagnostics::parse(
-            string_utils::utf8ToWide(contents),
-            path,
-            std::string(),
-            true);
+   // NOTE: runs on a background thread
+   void lintFiles()
+   {
+      try
+      {
+         while (true)
+         {
+            // wait for a file (or the last file to be prepared)
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while (pending_.empty() && !prepared_ && !stopped_)
+               condition_.wait(lock);
+            
+            if (stopped_ || pending_.empty())
+               break;
+            
+            LintRequest lint = pending_.front();
+            pending_.pop_front();
+            lock.unlock();
+            
+            ParseResults results = lintFile(lint);
+            
+            LOCK_MUTEX(mutex_)
+            {
+               completed_.push_back(std::make_pair(lint.origin, results.lint()));
+            }
+            END_LOCK_MUTEX
+         }
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+      
+      LOCK_MUTEX(mutex_)
+      {
+         activeThreads_--;
+      }
+      END_LOCK_MUTEX
+   }
+   
+   // show the lint found so far; returns false once every file is linted
+   bool showLint()
+   {
+      std::vector<std::pair<FilePath, LintItems> > completed;
+      bool finished = false;
+      bool stopped = false;
+      LOCK_MUTEX(mutex_)
+      {
+         completed.swap(completed_);
+         stopped = stopped_;
+         finished = prepared_ && pending_.empty() && activeThreads_ == 0;
+      }
+      END_LOCK_MUTEX
+      
+      if (stopped)
+         return false;
+      
+      typedef std::pair<FilePath, LintItems> FileLint;
+      BOOST_FOREACH(const FileLint& fileLint, completed)
+      {
+         lint_[fileLint.first] = fileLint.second;
+      }
+      
+      if (!completed.empty() || finished)
+      {
+         using namespace module_context;
+         showSourceMarkers(asSourceMarkerSet(lint_), MarkerAutoSelectNone);
+      }
+      
+      return !finished;
+   }
+   
+   // main thread only
+   std::vector<FilePath> files_;
+   std::size_t next_;
+   std::map<FilePath, LintItems> lint_;
+   
+   boost::mutex mutex_;
+   boost::condition condition_;
+   std::deque<LintRequest> pending_;
+   std::vector<std::pair<FilePath, LintItems> > completed_;
+   bool prepared_;
+   bool stopped_;
+   int activeThreads_;
+};
+
+boost::shared_ptr<DirectoryLint> s_pDirectoryLint;
+
+bool collectRFile(int depth,
+                  const FilePath& path,
+                  std::vector<FilePath>* pFiles)
+{
+   if (path.extensionLowerCase() == ".r")
+      pFiles->push_back(path);
    
-   (*pLint)[path] = results.lint();
    return true;
 }
 
+void cancelDirectoryLint()
+{
+   if (s_pDirectoryLint)
+   {
+      s_pDirectoryLint->stop();
+      s_pDirectoryLint.reset();
+   }
+}
+
 SEXP rs_lintDirectory(SEXP directorySEXP)
 {
    std::string directory = r::sexp::asString(directorySEXP);
@@ -1006,18 +1743,26 @@ SEXP rs_lintDirectory(SEXP directorySEXP)
    if (!dirPath.exists())
       return R_NilValue;
    
-   std::map<FilePath, LintItems> lint;
+   std::vector<FilePath> files;
    Error error = dirPath.childrenRecursive(
-            boost::bind(collectLint, _1, _2, &lint));
+            boost::bind(collectRFile, _1, _2, &files));
    if (error)
    {
       LOG_ERROR(error);
       return R_NilValue;
    }
    
-   using namespace module_context;
-   SourceMarkerSet markers = asSourceMarkerSet(lint);
-   showSourceMarkers(markers, MarkerAutoSelectNone);
+   // only one directory is linted at a time
+   cancelDirectoryLint();
+   
+   s_pDirectoryLint.reset(new DirectoryLint(files));
+   s_pDirectoryLint->start();
+   return R_NilValue;
+}
+
+SEXP rs_cancelLintDirectory()
+{
+   cancelDirectoryLint();
    return R_NilValue;
 }
 
@@ -1030,6 +1775,9 @@ core::Error initialize()
    using namespace module_context;
    
    events().afterSessionInitHook.connect(afterSessionInitHook);
+   events().onBackgroundProcessing.connect(onBackgroundProcessing);
+   source_database::events().onDocRemoved.connect(onDocRemoved);
+   source_database::events().onRemoveAll.connect(onRemoveAll);
    
    session::projects::FileMonitorCallbacks cb;
    cb.onFilesChanged = onFilesChanged;
@@ -1037,11 +1785,15 @@ core::Error initialize()
    
    RS_REGISTER_CALL_METHOD(rs_lintRFile, 1);
    RS_REGISTER_CALL_METHOD(rs_lintDirectory, 1);
+   RS_REGISTER_CALL_METHOD(rs_cancelLintDirectory, 0);
    
    ExecBlock initBlock;
    initBlock.addFunctions()
          (bind(sourceModuleRFile, "SessionDiagnostics.R"))
-         (bind(registerRpcMethod, "lint_r_source_document", lintRSourceDocument));
+         (bind(registerRpcAsyncCoupleMethod<LintRequest>,
+               "lint_r_source_document",
+               initLintRSourceDocument,
+               lintRSourceDocument));
    
    return initBlock.execute();
 
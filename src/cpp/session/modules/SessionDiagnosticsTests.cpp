@@ -25,6 +25,7 @@
 #include <core/FileUtils.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 
@@ -114,6 +115,38 @@ void lintRFilesInSubdirectory(const FilePath& path)
    }
 }
 
+// Build a tree of 'n' function scopes, each holding a few symbols, with
+// nodes from the arena (or allocated individually when there is none)
+boost::shared_ptr<ParseNode> buildParseTree(std::size_t n, bool useArena)
+{
+   boost::shared_ptr<ParseNodeArena> pArena = ParseNodeArena::create();
+   boost::shared_ptr<ParseNode> pRoot = useArena ?
+            pArena->createRootNode() :
+            ParseNode::createRootNode();
+   
+   for (std::size_t i = 0; i < n; ++i)
+   {
+      boost::shared_ptr<ParseNode> pChild = useArena ?
+               pArena->createNode("fn") :
+               ParseNode::createNode("fn");
+      
+      pChild->addDefinedSymbol(i, 0, "x");
+      pChild->addReferencedSymbol(i, 4, "y");
+      pRoot->addChild(pChild, Position(i, 0));
+   }
+   
+   return pRoot;
+}
+
+long parseTreeMicroseconds(std::size_t trees, bool useArena)
+{
+   using namespace boost::posix_time;
+   ptime start = microsec_clock::universal_time();
+   for (std::size_t i = 0; i < trees; ++i)
+      buildParseTree(1000, useArena);
+   return (microsec_clock::universal_time() - start).total_microseconds();
+}
+
 void lintRStudioRFiles()
 {
    lintRFilesInSubdirectory(options().coreRSourcePath());
@@ -276,9 +309,51 @@ context("Diagnostics")
       EXPECT_NO_LINT("function() { i <- 1; function() { data[i] } }");
    }
    
+   test_that("parse nodes are freed with the last reference to their arena")
+   {
+      boost::weak_ptr<ParseNodeArena> pWeakArena;
+      boost::shared_ptr<ParseNode> pChild;
+      {
+         boost::shared_ptr<ParseNodeArena> pArena = ParseNodeArena::create();
+         pWeakArena = pArena;
+         
+         boost::shared_ptr<ParseNode> pRoot = pArena->createRootNode();
+         for (std::size_t i = 0; i < 100; ++i)
+         {
+            pChild = pArena->createNode("fn");
+            pRoot->addChild(pChild, Position(i, 0));
+         }
+         
+         expect_true(pArena->size() == 101);
+         expect_true(pRoot->getChildren().size() == 100);
+      }
+      
+      // a node shared into another tree keeps the arena alive
+      expect_false(pWeakArena.expired());
+      expect_true(pChild->getName() == "fn");
+      
+      pChild.reset();
+      expect_true(pWeakArena.expired());
+   }
+   
+   test_that("parse trees can be built in an arena")
+   {
+      expect_true(buildParseTree(10, true)->getChildren().size() == 10);
+   }
+   
    lintRStudioRFiles();
 }
 
+// reports the cost of building trees with nodes allocated individually and
+// in an arena
+TEST_CASE("Parse tree allocation benchmark", "[.][benchmark]")
+{
+   long heap = parseTreeMicroseconds(100, false);
+   long arena = parseTreeMicroseconds(100, true);
+   std::cerr << "parse tree allocation: " << heap << "us (heap), "
+             << arena << "us (arena)" << std::endl;
+}
+
 } // namespace linter
 } // namespace modules
 } // namespace session
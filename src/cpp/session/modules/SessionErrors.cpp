@@ -205,9 +205,9 @@ Error initialize()
                                          pErrorHandler, false));
    events().onDeferredInit.connect(bind(detectHandlerChange,
                                         pErrorHandler, true));
-   userSettings().onChanged.connect(bind(onUserSettingsChanged,
-                                         pErrorHandler,
-                                         pHandleUserErrorsOnly));
+   userSettings().onKeyChanged(
+            UserSettings::uiPrefKey("handle_errors_in_user_code_only"),
+            bind(onUserSettingsChanged, pErrorHandler, pHandleUserErrorsOnly));
 
    json::JsonRpcFunction setErrMgmt =
          bind(setErrHandlerType, pErrorHandler, _1, _2);
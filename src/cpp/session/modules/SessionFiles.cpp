@@ -36,12 +36,14 @@
 #include <core/Settings.hpp>
 #include <core/Exec.hpp>
 #include <core/DateTime.hpp>
+#include <core/ZipStream.hpp>
 
 #include <core/http/Util.hpp>
 #include <core/http/Request.hpp>
 #include <core/http/Response.hpp>
 
 #include <core/json/Json.hpp>
+#include <core/json/JsonWriter.hpp>
 
 #include <core/system/ShellUtils.hpp>
 #include <core/system/Process.hpp>
@@ -56,6 +58,7 @@
 #include <r/RErrorCategory.hpp>
 
 #include <session/SessionClientEvent.hpp>
+#include <session/SessionWorkerContext.hpp>
 #include <session/SessionModuleContext.hpp>
 #include <session/SessionOptions.hpp>
 #include <session/SessionSourceDatabase.hpp>
@@ -107,8 +110,7 @@ void onResume(const Settings& settings)
                                             module_context::userHomePath());
 
       // start monitoriing
-      json::Array jsonFiles;
-      s_filesListingMonitor.start(resolvedPath, false, &jsonFiles);
+      s_filesListingMonitor.start(resolvedPath, false, NULL);
    }
 
    quotas::checkQuotaStatus();
@@ -203,10 +205,14 @@ Error listFiles(const json::JsonRpcRequest& request, json::JsonRpcResponse* pRes
       return error;
    FilePath targetPath = module_context::resolveAliasedPath(path) ;
 
-   json::Object result;
+   // the listing can be large, so it's written as it's produced rather
+   // than built as a json::Array
+   std::string result;
+   json::Writer writer(&result);
+   writer.startObject();
+   writer.key("files");
    
    // if this includes a request for monitoring
-   core::json::Array jsonFiles;
    if (monitor)
    {
       // always stop existing if we have one
@@ -215,26 +221,24 @@ Error listFiles(const json::JsonRpcRequest& request, json::JsonRpcResponse* pRes
       // install a monitor only if we aren't already covered by the project monitor
       if (!session::projects::projectContext().isMonitoringDirectory(targetPath))
       {
-         error = s_filesListingMonitor.start(targetPath, includeHidden, &jsonFiles);
+         error = s_filesListingMonitor.start(targetPath, includeHidden, &writer);
          if (error)
             return error;
       }
       else
       {
-         error = FilesListingMonitor::listFiles(targetPath, includeHidden, &jsonFiles);
+         error = FilesListingMonitor::listFiles(targetPath, includeHidden, &writer);
          if (error)
             return error;
       }
    }
    else
    {
-      error = FilesListingMonitor::listFiles(targetPath, includeHidden, &jsonFiles);
+      error = FilesListingMonitor::listFiles(targetPath, includeHidden, &writer);
       if (error)
          return error;
    }
 
-   result["files"] = jsonFiles;
-
    bool browseable = true;
 
 #ifndef _WIN32
@@ -244,9 +248,10 @@ Error listFiles(const json::JsonRpcRequest& request, json::JsonRpcResponse* pRes
       LOG_ERROR(error);
 #endif
 
-   result["is_parent_browseable"] = browseable;
+   writer.member("is_parent_browseable", browseable);
+   writer.endObject();
 
-   pResponse->setResult(result);
+   pResponse->setResultJson(result);
    return Success();
 }
 
@@ -507,7 +512,7 @@ void handleFilesRequest(const http::Request& request,
    }
 
    pResponse->setNoCacheHeaders();
-   pResponse->setFile(filePath, request);
+   pResponse->setRangeableFile(filePath, request);
 }
    
 const char * const kUploadFilename = "filename";
@@ -634,7 +639,7 @@ bool validateUploadedFile(const http::File& file, http::Response* pResponse)
    size_t byteLimit = mbLimit * 1024 * 1024;
    
    // compare to file size
-   if (file.contents.size() > byteLimit)
+   if (file.size > byteLimit)
    {
       Error fileTooLargeError = systemError(boost::system::errc::file_too_large,
                                             ERROR_LOCATION);
@@ -660,16 +665,26 @@ void handleFileUploadRequest(const http::Request& request,
    const http::File& file = request.uploadedFile("file");
    std::string targetDirectory = request.formFieldValue("targetDirectory");
    
+   // files streamed to disk as they were received (see uploadBodyHandler)
+   // are moved to the temp file below, and must otherwise be removed here
+   FilePath streamedFilePath;
+   if (!file.path.empty())
+      streamedFilePath = FilePath(file.path);
+   
    // first validate that we got the required fields
    if (file.name.empty() || targetDirectory.empty())
    {
+      streamedFilePath.removeIfExists();
       json::setJsonRpcError(json::errc::ParamInvalid, pResponse);
       return;
    }
    
    // now validate the file
    if ( !validateUploadedFile(file, pResponse) )
+   {
+      streamedFilePath.removeIfExists();
       return ;
+   }
    
    // form destination path
    FilePath destDir = module_context::resolveAliasedPath(targetDirectory);
@@ -681,7 +696,17 @@ void handleFileUploadRequest(const http::Request& request,
                                                     isZip ? "zip" : "bin");
    
    // attempt to write the temp file
-   Error saveError = core::writeStringToFile(tempFilePath, file.contents);
+   Error saveError;
+   if (!streamedFilePath.empty())
+   {
+      saveError = streamedFilePath.move(tempFilePath);
+      if (saveError)
+         streamedFilePath.removeIfExists();
+   }
+   else
+   {
+      saveError = core::writeStringToFile(tempFilePath, file.contents);
+   }
    if (saveError)
    {
       LOG_ERROR(saveError);
@@ -720,10 +745,9 @@ void handleFileUploadRequest(const http::Request& request,
    json::setJsonRpcResult(uploadJson, pResponse);   
 }
    
-void setAttachmentResponse(const http::Request& request,
-                           const std::string& filename,
-                           const FilePath& attachmentPath,
-                           http::Response* pResponse)
+void setAttachmentHeaders(const http::Request& request,
+                          const std::string& filename,
+                          http::Response* pResponse)
 {
    if (request.headerValue("User-Agent").find("MSIE") == std::string::npos)
    {
@@ -743,6 +767,14 @@ void setAttachmentResponse(const http::Request& request,
                         "attachment; filename*=UTF-8''"
                         + http::util::urlEncode(filename, false));
    pResponse->setHeader("Content-Type", "application/octet-stream");
+}
+
+void setAttachmentResponse(const http::Request& request,
+                           const std::string& filename,
+                           const FilePath& attachmentPath,
+                           http::Response* pResponse)
+{
+   setAttachmentHeaders(request, filename, pResponse);
    pResponse->setBody(attachmentPath);
 }
    
@@ -794,12 +826,9 @@ void handleMultipleFileExportRequest(const http::Request& request,
       files.push_back(file);
    }
    
-   // create the zip file
-   FilePath tempZipFilePath = module_context::tempFile("export", "zip");
-   Error error = r::exec::RFunction(".rs.createZipFile",
-                                    tempZipFilePath.absolutePath(),
-                                    parentPath.absolutePath(),
-                                    files).call();
+   // stream the zip file as it's created (rather than creating it first)
+   boost::shared_ptr<ZipStream> pZip;
+   Error error = ZipStream::create(parentPath, files, 0, &pZip);
    if (error)
    {
       LOG_ERROR(error);
@@ -808,7 +837,9 @@ void handleMultipleFileExportRequest(const http::Request& request,
    }
    
    // return attachment
-   setAttachmentResponse(request, name, tempZipFilePath, pResponse);
+   setAttachmentHeaders(request, name, pResponse);
+   pResponse->setStreamBody(boost::bind(&ZipStream::read, pZip, _1, _2),
+                            request);
 }
    
 void handleFileExportRequest(const http::Request& request, 
@@ -1027,10 +1058,11 @@ Error initialize()
 
    // install handlers
    using boost::bind;
+   using namespace worker_context;
    ExecBlock initBlock ;
    initBlock.addFunctions()
-      (bind(registerRpcMethod, "stat", stat))
-      (bind(registerRpcMethod, "is_text_file", isTextFile))
+      (bind(registerWorkerSafeRpcMethod, "stat", stat))
+      (bind(registerWorkerSafeRpcMethod, "is_text_file", isTextFile))
       (bind(registerRpcMethod, "get_file_contents", getFileContents))
       (bind(registerRpcMethod, "list_files", listFiles))
       (bind(registerRpcMethod, "create_folder", createFolder))
@@ -24,12 +24,15 @@
 #include <core/Log.hpp>
 #include <core/FileInfo.hpp>
 #include <core/FilePath.hpp>
+#include <core/StringUtils.hpp>
 
 #include <core/json/JsonRpc.hpp>
 
 #include <core/system/FileMonitor.hpp>
 #include <core/system/FileChangeEvent.hpp>
+#include <core/system/FileScanner.hpp>
 
+#include <session/DebouncedFileChangeHandler.hpp>
 #include <session/SessionModuleContext.hpp>
 
 #include "SessionVCS.hpp"
@@ -48,7 +51,7 @@ bool acceptAllFiles(const FileInfo&)
 }
 
 Error FilesListingMonitor::start(const FilePath& filePath, bool includeHidden, 
-      json::Array* pJsonFiles)
+      json::Writer* pWriter)
 {
    // always stop existing
    stop();
@@ -56,26 +59,25 @@ Error FilesListingMonitor::start(const FilePath& filePath, bool includeHidden,
    // save include hidden setting
    includeHidden_ = includeHidden;
 
-   // scan the directory (populates pJsonFiles out parameter)
-   std::vector<FilePath> files;
-   Error error = listFiles(filePath, &files, includeHidden, pJsonFiles);
+   // scan the directory (writing the listing to pWriter); the listing is
+   // kept so that it can be compared with the initial scan of the file
+   // monitor for changes
+   std::vector<FileInfo> prevFiles;
+   Error error = listFiles(filePath, &prevFiles, includeHidden, pWriter);
    if (error)
       return error;
 
-   // copy the file listing into a vector of FileInfo which we will order so that it can
-   // be compared with the initial scan of the file montor for changes
-   std::vector<FileInfo> prevFiles;
-   std::transform(files.begin(),
-                  files.end(),
-                  std::back_inserter(prevFiles),
-                  core::toFileInfo);
+   // collapse bursts of changes into a single batch for the client
+   pFileChangeHandler_ = DebouncedFileChangeHandler::create(
+         boost::bind(module_context::enqueFileChangedEvents, filePath, _1));
 
    // kickoff new monitor
    core::system::file_monitor::Callbacks cb;
    cb.onRegistered = boost::bind(&FilesListingMonitor::onRegistered,
                                     this, _1, filePath, prevFiles, _2);
    cb.onRegistrationError =  boost::bind(core::log::logError, _1, ERROR_LOCATION);
-   cb.onFilesChanged = boost::bind(module_context::enqueFileChangedEvents, filePath, _1);
+   cb.onFilesChanged = boost::bind(&DebouncedFileChangeHandler::enqueFileChanges,
+                                   pFileChangeHandler_, _1);
    cb.onMonitoringError = boost::bind(core::log::logError, _1, ERROR_LOCATION);
    cb.onUnregistered = boost::bind(&FilesListingMonitor::onUnregistered, this, _1);
    core::system::file_monitor::registerMonitor(filePath,
@@ -97,6 +99,13 @@ void FilesListingMonitor::stop()
       core::system::file_monitor::unregisterMonitor(currentHandle_);
       currentHandle_ = core::system::file_monitor::Handle();
    }
+
+   // deliver any changes we've held back
+   if (pFileChangeHandler_)
+   {
+      pFileChangeHandler_->flush();
+      pFileChangeHandler_.reset();
+   }
 }
 
 const FilePath& FilesListingMonitor::currentMonitoredPath() const
@@ -129,8 +138,18 @@ namespace {
 //     but just want to note that other fixes were not considered and
 //     might be superior)
 //
+bool compareFileInfoPathNoCase(const FileInfo& file1, const FileInfo& file2)
+{
+   return string_utils::toLower(file1.absolutePath()) <
+          string_utils::toLower(file2.absolutePath());
+}
+
 FileInfo normalizeFileScannerPath(const FileInfo& fileInfo)
 {
+   // other files are already reported just as the listing reports them
+   if (!fileInfo.isSymlink())
+      return fileInfo;
+
    FilePath filePath(fileInfo.absolutePath());
    return FileInfo(filePath);
 }
@@ -184,36 +203,41 @@ void FilesListingMonitor::onUnregistered(core::system::file_monitor::Handle hand
 }
 
 Error FilesListingMonitor::listFiles(const FilePath& rootPath,
-                                     std::vector<FilePath>* pFiles,
+                                     std::vector<FileInfo>* pFiles,
                                      bool includeHidden,
-                                     json::Array* pJsonFiles)
+                                     json::Writer* pWriter)
 {
-   // enumerate the files
-   pFiles->clear();
-   core::Error error = rootPath.children(pFiles);
+   // enumerate the files (along with their attributes, so that they needn't
+   // be queried one at a time)
+   core::Error error = core::system::scanDirectory(rootPath, true, pFiles);
    if (error)
       return error;
 
+   // sort the files by name
+   std::sort(pFiles->begin(), pFiles->end(), compareFileInfoPathNoCase);
+
+   // no listing wanted (just the files for the monitor)
+   if (pWriter == NULL)
+      return Success();
+
    using namespace source_control;
    boost::shared_ptr<FileDecorationContext> pCtx =
                   source_control::fileDecorationContext(rootPath);
 
-   // sort the files by name
-   std::sort(pFiles->begin(), pFiles->end(), core::compareAbsolutePathNoCase);
-
-   // produce json listing
-   BOOST_FOREACH( core::FilePath& filePath, *pFiles)
+   // write the json listing one file at a time
+   pWriter->startArray();
+   BOOST_FOREACH(const core::FileInfo& fileInfo, *pFiles)
    {
-      // files which may have been deleted after the listing or which
-      // are not end-user visible
-      if (filePath.exists() && 
-            (includeHidden || module_context::fileListingFilter(core::FileInfo(filePath))))
+      // skip files which are not end-user visible
+      if (includeHidden || module_context::fileListingFilter(fileInfo))
       {
-         core::json::Object fileObject = module_context::createFileSystemItem(filePath);
-         pCtx->decorateFile(filePath, &fileObject);
-         pJsonFiles->push_back(fileObject) ;
+         core::json::Object fileObject =
+                           module_context::createFileSystemItem(fileInfo);
+         pCtx->decorateFile(FilePath(fileInfo.absolutePath()), &fileObject);
+         pWriter->value(fileObject);
       }
    }
+   pWriter->endArray();
 
    return Success();
 }
@@ -20,10 +20,12 @@
 #include <vector>
 
 #include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <core/collection/Tree.hpp>
 
 #include <core/json/Json.hpp>
+#include <core/json/JsonWriter.hpp>
 #include <core/system/FileMonitor.hpp>
 
 namespace rstudio {
@@ -39,6 +41,9 @@ namespace core {
 
 namespace rstudio {
 namespace session {
+
+class DebouncedFileChangeHandler;
+
 namespace modules {
 
    namespace git {
@@ -50,9 +55,10 @@ namespace files {
 class FilesListingMonitor : boost::noncopyable
 {
 public:
-   // kickoff monitoring
+   // kickoff monitoring (writing the initial listing as an array, if a
+   // writer is given)
    core::Error start(const core::FilePath& filePath, 
-         bool includeHidden, core::json::Array* pJsonFiles);
+         bool includeHidden, core::json::Writer* pWriter);
 
    void stop();
 
@@ -63,10 +69,10 @@ public:
    // don't specify monitoring (e.g. file dialog listing)
    static core::Error listFiles(const core::FilePath& rootPath,
                                 bool includeHidden,
-                                core::json::Array* pJsonFiles)
+                                core::json::Writer* pWriter)
    {
-      std::vector<core::FilePath> files;
-      return listFiles(rootPath, &files, includeHidden, pJsonFiles);
+      std::vector<core::FileInfo> files;
+      return listFiles(rootPath, &files, includeHidden, pWriter);
    }
 
 private:
@@ -80,14 +86,15 @@ private:
 
    // helpers
    static core::Error listFiles(const core::FilePath& rootPath,
-                                std::vector<core::FilePath>* pFiles,
+                                std::vector<core::FileInfo>* pFiles,
                                 bool includeHidden, 
-                                core::json::Array* pJsonFiles);
+                                core::json::Writer* pWriter);
 
 private:
    core::FilePath currentPath_;
    bool includeHidden_;
    core::system::file_monitor::Handle currentHandle_;
+   boost::shared_ptr<DebouncedFileChangeHandler> pFileChangeHandler_;
 };
 
 
@@ -14,8 +14,11 @@
  */
 
 #include "SessionFind.hpp"
+#include "SessionFindIndex.hpp"
+#include "SessionFindSearch.hpp"
 
 #include <algorithm>
+#include <cctype>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/bind.hpp>
@@ -193,7 +196,159 @@ FindInFilesState& findResults()
    return *s_pFindResults;
 }
 
-class GrepOperation : public boost::enable_shared_from_this<GrepOperation>
+// Result handling shared by the grep and in-process searches
+class FindOperation : boost::noncopyable
+{
+protected:
+   explicit FindOperation(const std::string& encoding)
+      : firstDecodeError_(true), encoding_(encoding)
+   {
+      handle_ = core::system::generateUuid(false);
+   }
+
+public:
+   virtual ~FindOperation()
+   {
+   }
+
+   std::string handle() const
+   {
+      return handle_;
+   }
+
+protected:
+   bool isActive() const
+   {
+      return findResults().isRunning() && findResults().handle() == handle();
+   }
+
+   // number of results we can still report
+   int remainingResults() const
+   {
+      int remaining = MAX_COUNT + 1 - findResults().resultCount();
+      return std::max(remaining, 0);
+   }
+
+   std::string decode(const std::string& encoded)
+   {
+      if (encoded.empty())
+         return encoded;
+
+      std::string decoded;
+      Error error = r::util::iconvstr(encoded, encoding_, "UTF-8", true,
+                                      &decoded);
+
+      // Log error, but only once per find operation
+      if (error && firstDecodeError_)
+      {
+         firstDecodeError_ = false;
+         LOG_ERROR(error);
+      }
+
+      return decoded;
+   }
+
+   // decode and append, returning the number of UTF-8 characters appended
+   std::size_t appendDecoded(const std::string& encoded, std::string* pLine)
+   {
+      std::string decoded = decode(encoded);
+      pLine->append(decoded);
+
+      std::size_t charSize;
+      Error error = string_utils::utf8Distance(decoded.begin(),
+                                               decoded.end(),
+                                               &charSize);
+      if (error)
+         charSize = decoded.size();
+      return charSize;
+   }
+
+   static void truncateLine(std::string* pLine)
+   {
+      if (pLine->size() > 300)
+      {
+         pLine->erase(300);
+         pLine->append("...");
+      }
+   }
+
+   // results within these paths are never reported
+   static bool isExcludedFile(const std::string& file,
+                              const std::string& websiteOutputDir)
+   {
+      if (file.find("/.Rproj.user/") != std::string::npos)
+         return true;
+      if (file.find("/.git/") != std::string::npos)
+         return true;
+      if (file.find("/.svn/") != std::string::npos)
+         return true;
+      if (file.find("/packrat/lib/") != std::string::npos)
+         return true;
+      if (file.find("/packrat/src/") != std::string::npos)
+         return true;
+      if (file.find("/.Rhistory") != std::string::npos)
+         return true;
+
+      if (!websiteOutputDir.empty() &&
+          file.find(websiteOutputDir) != std::string::npos)
+         return true;
+
+      return false;
+   }
+
+   static std::string websiteOutputDir()
+   {
+      std::string websiteOutputDir = module_context::websiteOutputDir();
+      if (!websiteOutputDir.empty())
+         websiteOutputDir = "/" + websiteOutputDir + "/";
+      return websiteOutputDir;
+   }
+
+   void addResults(const json::Array& files,
+                   const json::Array& lineNums,
+                   const json::Array& contents,
+                   const json::Array& matchOns,
+                   const json::Array& matchOffs)
+   {
+      if (files.size() == 0)
+         return;
+
+      json::Object result;
+      result["handle"] = handle();
+      json::Object results;
+      results["file"] = files;
+      results["line"] = lineNums;
+      results["lineValue"] = contents;
+      results["matchOn"] = matchOns;
+      results["matchOff"] = matchOffs;
+      result["results"] = results;
+
+      findResults().addResult(handle(),
+                              files,
+                              lineNums,
+                              contents,
+                              matchOns,
+                              matchOffs);
+
+      module_context::enqueClientEvent(
+               ClientEvent(client_events::kFindResult, result));
+   }
+
+   void onFindOperationEnded()
+   {
+      findResults().onFindEnd(handle());
+      module_context::enqueClientEvent(
+            ClientEvent(client_events::kFindOperationEnded, handle()));
+   }
+
+private:
+   bool firstDecodeError_;
+   std::string encoding_;
+   std::string handle_;
+};
+
+class GrepOperation : public FindOperation,
+                      public boost::enable_shared_from_this<GrepOperation>
 {
 public:
    static boost::shared_ptr<GrepOperation> create(const std::string& encoding,
@@ -206,17 +361,11 @@ public:
 private:
    GrepOperation(const std::string& encoding,
                  const FilePath& tempFile)
-      : firstDecodeError_(true), encoding_(encoding), tempFile_(tempFile)
+      : FindOperation(encoding), tempFile_(tempFile)
    {
-      handle_ = core::system::generateUuid(false);
    }
 
 public:
-   std::string handle() const
-   {
-      return handle_;
-   }
-
    core::system::ProcessCallbacks createProcessCallbacks()
    {
       core::system::ProcessCallbacks callbacks;
@@ -238,26 +387,7 @@ public:
 private:
    bool onContinue(const core::system::ProcessOperations& ops) const
    {
-      return findResults().isRunning() && findResults().handle() == handle();
-   }
-
-   std::string decode(const std::string& encoded)
-   {
-      if (encoded.empty())
-         return encoded;
-
-      std::string decoded;
-      Error error = r::util::iconvstr(encoded, encoding_, "UTF-8", true,
-                                      &decoded);
-
-      // Log error, but only once per grep operation
-      if (error && firstDecodeError_)
-      {
-         firstDecodeError_ = false;
-         LOG_ERROR(error);
-      }
-
-      return decoded;
+      return isActive();
    }
 
    void processContents(std::string* pContent,
@@ -276,20 +406,9 @@ private:
       {
          // decode the current match, and append it
          std::string matchedString(inputPos, inputPos + match.position());
-         std::string decoded = decode(matchedString);
-         
-         // append and update
-         decodedLine.append(decoded);
+         nUtf8CharactersProcessed += appendDecoded(matchedString,
+                                                   &decodedLine);
          inputPos += match.position() + match.length();
-         
-         // count the number of UTF-8 characters processed
-         std::size_t charSize;
-         Error error = string_utils::utf8Distance(decoded.begin(),
-                                                  decoded.end(),
-                                                  &charSize);
-         if (error)
-            charSize = decoded.size();
-         nUtf8CharactersProcessed += charSize;
 
          // update the match state
          if (match[1] == "01")
@@ -301,11 +420,7 @@ private:
       if (inputPos != end)
          decodedLine.append(decode(std::string(inputPos, end)));
 
-      if (decodedLine.size() > 300)
-      {
-         decodedLine = decodedLine.erase(300);
-         decodedLine.append("...");
-      }
+      truncateLine(&decodedLine);
 
       *pContent = decodedLine;
    }
@@ -318,13 +433,9 @@ private:
       json::Array matchOns;
       json::Array matchOffs;
 
-      int recordsToProcess = MAX_COUNT + 1 - findResults().resultCount();
-      if (recordsToProcess < 0)
-         recordsToProcess = 0;
+      int recordsToProcess = remainingResults();
 
-      std::string websiteOutputDir = module_context::websiteOutputDir();
-      if (!websiteOutputDir.empty())
-         websiteOutputDir = "/" + websiteOutputDir + "/";
+      std::string excludedWebsiteDir = websiteOutputDir();
 
       stdOutBuf_.append(data);
       size_t nextLineStart = 0;
@@ -341,21 +452,7 @@ private:
             std::string file = module_context::createAliasedPath(
                   FilePath(string_utils::systemToUtf8(match[1])));
 
-            if (file.find("/.Rproj.user/") != std::string::npos)
-               continue;
-            if (file.find("/.git/") != std::string::npos)
-               continue;
-            if (file.find("/.svn/") != std::string::npos)
-               continue;
-            if (file.find("/packrat/lib/") != std::string::npos)
-               continue;
-            if (file.find("/packrat/src/") != std::string::npos)
-               continue;
-            if (file.find("/.Rhistory") != std::string::npos)
-               continue;
-
-            if (!websiteOutputDir.empty() &&
-                file.find(websiteOutputDir) != std::string::npos)
+            if (isExcludedFile(file, excludedWebsiteDir))
                continue;
 
             int lineNum = safe_convert::stringTo<int>(std::string(match[2]), -1);
@@ -379,28 +476,7 @@ private:
          stdOutBuf_.erase(0, nextLineStart);
       }
 
-      if (files.size() > 0)
-      {
-         json::Object result;
-         result["handle"] = handle();
-         json::Object results;
-         results["file"] = files;
-         results["line"] = lineNums;
-         results["lineValue"] = contents;
-         results["matchOn"] = matchOns;
-         results["matchOff"] = matchOffs;
-         result["results"] = results;
-
-         findResults().addResult(handle(),
-                                 files,
-                                 lineNums,
-                                 contents,
-                                 matchOns,
-                                 matchOffs);
-
-         module_context::enqueClientEvent(
-                  ClientEvent(client_events::kFindResult, result));
-      }
+      addResults(files, lineNums, contents, matchOns, matchOffs);
 
       if (recordsToProcess <= 0)
          findResults().onFindEnd(handle());
@@ -413,39 +489,190 @@ private:
 
    void onExit(int exitCode)
    {
-      findResults().onFindEnd(handle());
-      module_context::enqueClientEvent(
-            ClientEvent(client_events::kFindOperationEnded, handle()));
+      onFindOperationEnded();
       if (!tempFile_.empty())
          tempFile_.removeIfExists();
    }
 
-   bool firstDecodeError_;
-   std::string encoding_;
    FilePath tempFile_;
    std::string stdOutBuf_;
-   std::string handle_;
 };
 
-} // namespace
+// searches files on background threads (see FileSearch), polling for
+// matches from the main thread so they can be decoded and reported
+class SearchOperation : public FindOperation,
+                        public boost::enable_shared_from_this<SearchOperation>
+{
+public:
+   static boost::shared_ptr<SearchOperation> create(
+                                    const std::string& encoding,
+                                    boost::shared_ptr<FileSearch> pSearch)
+   {
+      return boost::shared_ptr<SearchOperation>(new SearchOperation(encoding,
+                                                                    pSearch));
+   }
 
-core::Error beginFind(const json::JsonRpcRequest& request,
-                      json::JsonRpcResponse* pResponse)
+private:
+   SearchOperation(const std::string& encoding,
+                   boost::shared_ptr<FileSearch> pSearch)
+      : FindOperation(encoding), pSearch_(pSearch)
+   {
+   }
+
+public:
+   void start()
+   {
+      pSearch_->start();
+      schedulePoll();
+   }
+
+private:
+   void schedulePoll()
+   {
+      module_context::scheduleDelayedWork(
+               boost::posix_time::milliseconds(50),
+               boost::bind(&SearchOperation::poll, shared_from_this()),
+               false);
+   }
+
+   void poll()
+   {
+      // the search was stopped or superseded
+      if (!isActive())
+      {
+         pSearch_->stop();
+         onFindOperationEnded();
+         return;
+      }
+
+      std::vector<SearchMatch> matches;
+      bool more = pSearch_->takeMatches(&matches);
+
+      int recordsToProcess = remainingResults();
+      std::string excludedWebsiteDir = websiteOutputDir();
+
+      json::Array files;
+      json::Array lineNums;
+      json::Array contents;
+      json::Array matchOns;
+      json::Array matchOffs;
+      BOOST_FOREACH(const SearchMatch& match, matches)
+      {
+         if (recordsToProcess <= 0)
+            break;
+
+         std::string file = module_context::createAliasedPath(
+                  FilePath(string_utils::systemToUtf8(match.file)));
+         if (isExcludedFile(file, excludedWebsiteDir))
+            continue;
+
+         json::Array matchOn, matchOff;
+         files.push_back(file);
+         lineNums.push_back(match.line);
+         contents.push_back(processContents(match, &matchOn, &matchOff));
+         matchOns.push_back(matchOn);
+         matchOffs.push_back(matchOff);
+
+         recordsToProcess--;
+      }
+
+      addResults(files, lineNums, contents, matchOns, matchOffs);
+
+      if (recordsToProcess <= 0 || !more)
+      {
+         pSearch_->stop();
+         onFindOperationEnded();
+         return;
+      }
+
+      schedulePoll();
+   }
+
+   std::string processContents(const SearchMatch& match,
+                               json::Array* pMatchOn,
+                               json::Array* pMatchOff)
+   {
+      const std::string& contents = match.contents;
+
+      // trim whitespace (as we do for grep output)
+      std::size_t begin = 0;
+      std::size_t end = contents.size();
+      while (begin < end && std::isspace(static_cast<unsigned char>(contents[begin])))
+         begin++;
+      while (end > begin && std::isspace(static_cast<unsigned char>(contents[end - 1])))
+         end--;
+
+      std::string decodedLine;
+      std::size_t nUtf8CharactersProcessed = 0;
+      std::size_t pos = begin;
+
+      typedef std::pair<std::size_t, std::size_t> Range;
+      BOOST_FOREACH(const Range& range, match.ranges)
+      {
+         std::size_t matchBegin = std::min(std::max(range.first, begin), end);
+         std::size_t matchEnd = std::min(std::max(range.second, matchBegin), end);
+
+         nUtf8CharactersProcessed += appendDecoded(
+                  contents.substr(pos, matchBegin - pos), &decodedLine);
+         pMatchOn->push_back(static_cast<int>(nUtf8CharactersProcessed));
+
+         nUtf8CharactersProcessed += appendDecoded(
+                  contents.substr(matchBegin, matchEnd - matchBegin),
+                  &decodedLine);
+         pMatchOff->push_back(static_cast<int>(nUtf8CharactersProcessed));
+
+         pos = matchEnd;
+      }
+
+      if (pos < end)
+         decodedLine.append(decode(contents.substr(pos, end - pos)));
+
+      truncateLine(&decodedLine);
+      return decodedLine;
+   }
+
+   boost::shared_ptr<FileSearch> pSearch_;
+};
+
+// directories the in-process search skips (snapshotted on the main thread
+// since the search runs in the background)
+bool skipSearchDirectory(const FilePath& dirPath,
+                         const FilePath& projectDir,
+                         const std::string& websiteOutputDir,
+                         bool isPackageProject)
 {
-   std::string searchString;
-   bool asRegex, ignoreCase;
-   std::string directory;
-   json::Array filePatterns;
+   std::string name = dirPath.filename();
+   if (name == ".Rproj.user" || name == ".git" || name == ".svn")
+      return true;
 
-   Error error = json::readParams(request.params,
-                                  &searchString,
-                                  &asRegex,
-                                  &ignoreCase,
-                                  &directory,
-                                  &filePatterns);
-   if (error)
-      return error;
+   std::string parentName = dirPath.parent().filename();
+   if (parentName == "packrat" && (name == "lib" || name == "src"))
+      return true;
 
+   // the rules used for indexing apply within the project
+   if (!projectDir.empty() && dirPath.isWithin(projectDir))
+   {
+      if (module_context::isIgnoredProjectDirectory(dirPath, websiteOutputDir))
+         return true;
+
+      // revdep sub-directories
+      if (isPackageProject && parentName == "revdep")
+         return true;
+   }
+
+   return false;
+}
+
+Error beginGrepFind(const std::string& encodedString,
+                    const std::string& encoding,
+                    bool asRegex,
+                    bool ignoreCase,
+                    const FilePath& dirPath,
+                    const json::Array& filePatterns,
+                    bool useCandidates,
+                    const std::vector<std::string>& candidates,
+                    std::string* pHandle)
+{
    core::system::ProcessOptions options;
 
    core::system::Options childEnv;
@@ -463,23 +690,9 @@ core::Error beginFind(const json::JsonRpcRequest& request,
    // Put the grep pattern in a file
    FilePath tempFile = module_context::tempFile("rs_grep", "txt");
    boost::shared_ptr<std::ostream> pStream;
-   error = tempFile.open_w(&pStream);
+   Error error = tempFile.open_w(&pStream);
    if (error)
       return error;
-   std::string encoding = projects::projectContext().hasProject() ?
-                          projects::projectContext().defaultEncoding() :
-                          userSettings().defaultEncoding();
-   std::string encodedString;
-   error = r::util::iconvstr(searchString,
-                             "UTF-8",
-                             encoding,
-                             false,
-                             &encodedString);
-   if (error)
-   {
-      LOG_ERROR(error);
-      encodedString = searchString;
-   }
 
    *pStream << encodedString << std::endl;
    pStream.reset(); // release file handle
@@ -515,26 +728,163 @@ core::Error beginFind(const json::JsonRpcRequest& request,
    }
 
    cmd << shell_utils::EscapeFilesOnly << "--" << shell_utils::EscapeAll;
-   
+
+   // when the project index can rule out files we only search the
+   // candidates it gives us (rather than the whole directory)
+   if (useCandidates)
+   {
+      BOOST_FOREACH(const std::string& candidate, candidates)
+      {
+         cmd << string_utils::utf8ToSystem(candidate);
+      }
+
+      // make sure grep doesn't fall back to reading stdin
+      if (candidates.empty())
+      {
+#ifdef _WIN32
+         cmd << "NUL";
+#else
+         cmd << "/dev/null";
+#endif
+      }
+   }
+   else
+   {
+      cmd << string_utils::utf8ToSystem(dirPath.absolutePath());
+   }
+
+   error = module_context::processSupervisor().runCommand(cmd,
+                                                          options,
+                                                          callbacks);
+   if (error)
+      return error;
+
+   *pHandle = ptrGrepOp->handle();
+   return Success();
+}
+
+Error beginInProcessFind(const std::string& encodedString,
+                         const std::string& encoding,
+                         bool asRegex,
+                         bool ignoreCase,
+                         const FilePath& dirPath,
+                         const json::Array& filePatterns,
+                         bool useCandidates,
+                         const std::vector<std::string>& candidates,
+                         std::string* pHandle)
+{
+   SearchOptions options;
+   options.term = encodedString;
+   options.asRegex = asRegex;
+   options.ignoreCase = ignoreCase;
+   options.directory = FilePath(string_utils::utf8ToSystem(
+                                                   dirPath.absolutePath()));
+   options.searchFiles = useCandidates;
+   BOOST_FOREACH(const std::string& candidate, candidates)
+   {
+      options.files.push_back(string_utils::utf8ToSystem(candidate));
+   }
+   BOOST_FOREACH(json::Value filePattern, filePatterns)
+   {
+      options.includePatterns.push_back(filePattern.get_str());
+   }
+
+   FilePath projectDir;
+   bool isPackageProject = false;
+   if (projects::projectContext().hasProject())
+   {
+      projectDir = projects::projectContext().directory();
+      isPackageProject = projects::projectContext().isPackageProject();
+   }
+   options.skipDirectory = boost::bind(skipSearchDirectory,
+                                       _1,
+                                       projectDir,
+                                       module_context::websiteOutputDir(),
+                                       isPackageProject);
+
+   options.maxMatches = MAX_COUNT + 1;
+   options.threads = session::options().findThreads();
+
+   boost::shared_ptr<FileSearch> pSearch;
+   Error error = FileSearch::create(options, &pSearch);
+   if (error)
+      return error;
+
+   boost::shared_ptr<SearchOperation> ptrSearchOp =
+                                 SearchOperation::create(encoding, pSearch);
+   ptrSearchOp->start();
+
+   *pHandle = ptrSearchOp->handle();
+   return Success();
+}
+
+} // namespace
+
+core::Error beginFind(const json::JsonRpcRequest& request,
+                      json::JsonRpcResponse* pResponse)
+{
+   std::string searchString;
+   bool asRegex, ignoreCase;
+   std::string directory;
+   json::Array filePatterns;
+
+   Error error = json::readParams(request.params,
+                                  &searchString,
+                                  &asRegex,
+                                  &ignoreCase,
+                                  &directory,
+                                  &filePatterns);
+   if (error)
+      return error;
+
+   std::string encoding = projects::projectContext().hasProject() ?
+                          projects::projectContext().defaultEncoding() :
+                          userSettings().defaultEncoding();
+   std::string encodedString;
+   error = r::util::iconvstr(searchString,
+                             "UTF-8",
+                             encoding,
+                             false,
+                             &encodedString);
+   if (error)
+   {
+      LOG_ERROR(error);
+      encodedString = searchString;
+   }
+
    // Filepaths received from the client will be UTF-8 encoded;
-   // convert to system encoding here.
+   // they're converted to system encoding when searching
    FilePath dirPath = module_context::resolveAliasedPath(directory);
-   cmd << string_utils::utf8ToSystem(dirPath.absolutePath());
+
+   // see if the project index can rule out files
+   std::vector<std::string> candidates;
+   bool useCandidates = searchCandidates(encodedString, asRegex, ignoreCase,
+                                         dirPath, &candidates);
 
    // Clear existing results
    findResults().clear();
 
-   error = module_context::processSupervisor().runCommand(cmd,
-                                                          options,
-                                                          callbacks);
+   std::string handle;
+   if (session::options().findExternalGrep())
+   {
+      error = beginGrepFind(encodedString, encoding, asRegex, ignoreCase,
+                            dirPath, filePatterns, useCandidates, candidates,
+                            &handle);
+   }
+   else
+   {
+      error = beginInProcessFind(encodedString, encoding, asRegex, ignoreCase,
+                                 dirPath, filePatterns, useCandidates,
+                                 candidates, &handle);
+   }
    if (error)
       return error;
 
-   findResults().onFindBegin(ptrGrepOp->handle(),
+   findResults().onFindBegin(handle,
                              searchString,
                              directory,
                              asRegex);
-   pResponse->setResult(ptrGrepOp->handle());
+   pResponse->setResult(handle);
 
    return Success();
 }
@@ -597,6 +947,11 @@ core::Error initialize()
    // register suspend handler
    addSuspendHandler(SuspendHandler(bind(onSuspend, _2), onResume));
 
+   // index project files so searches can skip files which can't match
+   Error error = initializeFindIndex();
+   if (error)
+      LOG_ERROR(error);
+
    // install handlers
    ExecBlock initBlock ;
    initBlock.addFunctions()
@@ -0,0 +1,317 @@
+/*
+ * SessionFindIndex.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionFindIndex.hpp"
+
+#include <set>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/Error.hpp>
+#include <core/FileInfo.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+#include <core/system/FileChangeEvent.hpp>
+#include <core/text/TrigramIndex.hpp>
+
+#include <session/IncrementalFileChangeHandler.hpp>
+#include <session/SessionModuleContext.hpp>
+#include <session/projects/SessionProjects.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace find {
+
+namespace {
+
+// don't bother narrowing the search if the candidates won't comfortably
+// fit on the grep command line
+const std::size_t kMaxCandidateBytes = 256 * 1024;
+
+// write the index after initial indexing completes (and then periodically
+// as files change) so that it survives sessions which don't shut down
+// normally
+const boost::posix_time::time_duration kSaveInterval =
+                                          boost::posix_time::minutes(10);
+
+text::TrigramIndex s_index;
+IncrementalFileChangeHandler* s_pFileChangeHandler = NULL;
+bool s_monitoring = false;
+bool s_dirty = false;
+boost::posix_time::ptime s_lastSaveTime;
+
+FilePath findIndexFilePath()
+{
+   return module_context::scopedScratchPath().childPath("find-index");
+}
+
+void loadFindIndex()
+{
+   FilePath indexFilePath = findIndexFilePath();
+   if (!indexFilePath.exists())
+      return;
+
+   // a stale or corrupt index is simply rebuilt
+   Error error = s_index.readFromFile(indexFilePath);
+   if (error)
+   {
+      LOG_ERROR(error);
+      s_index.clear();
+   }
+}
+
+void saveFindIndex()
+{
+   if (!s_dirty)
+      return;
+
+   s_index.compact();
+   Error error = s_index.writeToFile(findIndexFilePath());
+   if (error)
+      LOG_ERROR(error);
+
+   s_dirty = false;
+   s_lastSaveTime = boost::posix_time::second_clock::universal_time();
+}
+
+void removeDirectory(const std::string& directory)
+{
+   std::string prefix = directory + "/";
+   std::vector<std::string> paths;
+   s_index.paths(&paths);
+   BOOST_FOREACH(const std::string& path, paths)
+   {
+      if (boost::algorithm::starts_with(path, prefix))
+         s_index.remove(path);
+   }
+}
+
+void indexFile(const FileInfo& fileInfo)
+{
+   std::string path = fileInfo.absolutePath();
+   if (fileInfo.size() > text::TrigramIndex::kMaxIndexedFileSize)
+   {
+      s_index.updateUnindexed(path, fileInfo.lastWriteTime());
+      return;
+   }
+
+   std::string contents;
+   Error error = readStringFromFile(FilePath(path), &contents);
+   if (error)
+   {
+      // the file may have been removed since the event was queued;
+      // otherwise make sure it is always searched
+      if (FilePath(path).exists())
+         s_index.updateUnindexed(path, fileInfo.lastWriteTime());
+      else
+         s_index.remove(path);
+      return;
+   }
+
+   s_index.update(path, fileInfo.lastWriteTime(), contents);
+}
+
+void fileChangeHandler(const core::system::FileChangeEvent& event)
+{
+   using namespace core::system;
+
+   const FileInfo& fileInfo = event.fileInfo();
+   switch (event.type())
+   {
+   case FileChangeEvent::FileAdded:
+   case FileChangeEvent::FileModified:
+      if (!fileInfo.isDirectory() &&
+          !s_index.isCurrent(fileInfo.absolutePath(), fileInfo.lastWriteTime()))
+      {
+         indexFile(fileInfo);
+         s_dirty = true;
+      }
+      break;
+
+   case FileChangeEvent::FileRemoved:
+      if (fileInfo.isDirectory())
+         removeDirectory(fileInfo.absolutePath());
+      else
+         s_index.remove(fileInfo.absolutePath());
+      s_dirty = true;
+      break;
+
+   default:
+      break;
+   }
+
+   // save once the queue drains (but not too often)
+   if (s_dirty && !s_pFileChangeHandler->hasPendingWork())
+   {
+      boost::posix_time::ptime now =
+                           boost::posix_time::second_clock::universal_time();
+      if (s_lastSaveTime.is_not_a_date_time() ||
+          (now - s_lastSaveTime) > kSaveInterval)
+      {
+         saveFindIndex();
+      }
+   }
+}
+
+bool isIndexableFile(const FileInfo& fileInfo)
+{
+   // directories are only of interest when they're removed (which the
+   // handler takes care of)
+   return !fileInfo.empty();
+}
+
+void onMonitoringEnabled(const tree<FileInfo>& files)
+{
+   // drop files which were removed while we weren't running, and queue the
+   // ones which changed (or are new) for indexing
+   std::set<std::string> paths;
+   std::vector<FileInfo> staleFiles;
+   for (tree<FileInfo>::leaf_iterator it = files.begin_leaf();
+        it != files.end_leaf();
+        ++it)
+   {
+      if (it->isDirectory())
+         continue;
+
+      paths.insert(it->absolutePath());
+      if (!s_index.isCurrent(it->absolutePath(), it->lastWriteTime()))
+         staleFiles.push_back(*it);
+   }
+
+   std::vector<std::string> indexedPaths;
+   s_index.paths(&indexedPaths);
+   BOOST_FOREACH(const std::string& path, indexedPaths)
+   {
+      if (paths.find(path) == paths.end())
+      {
+         s_index.remove(path);
+         s_dirty = true;
+      }
+   }
+
+   s_pFileChangeHandler->enqueFiles(staleFiles.begin(), staleFiles.end());
+   s_monitoring = true;
+}
+
+void onFilesChanged(const std::vector<core::system::FileChangeEvent>& events)
+{
+   BOOST_FOREACH(const core::system::FileChangeEvent& event, events)
+   {
+      s_pFileChangeHandler->enqueFileChange(event);
+   }
+}
+
+void onMonitoringDisabled()
+{
+   // we can no longer keep the index current
+   s_monitoring = false;
+   s_pFileChangeHandler->clear();
+   s_index.clear();
+   s_dirty = false;
+   findIndexFilePath().removeIfExists();
+}
+
+void onShutdown(bool terminatedNormally)
+{
+   if (terminatedNormally && s_monitoring)
+      saveFindIndex();
+}
+
+} // anonymous namespace
+
+bool searchCandidates(const std::string& term,
+                      bool asRegex,
+                      bool ignoreCase,
+                      const FilePath& directory,
+                      std::vector<std::string>* pFiles)
+{
+   pFiles->clear();
+
+   // the index must be complete and current for the directory
+   if (!s_monitoring || s_pFileChangeHandler->hasPendingWork())
+      return false;
+   if (!projects::projectContext().isMonitoringDirectory(directory))
+      return false;
+
+   std::vector<std::string> literals;
+   if (!text::requiredLiterals(term, asRegex, ignoreCase, &literals))
+      return false;
+
+   std::vector<std::string> candidates;
+   if (!s_index.candidates(literals, &candidates))
+      return false;
+
+   std::string prefix = directory.absolutePath() + "/";
+   std::size_t totalBytes = 0;
+   BOOST_FOREACH(const std::string& candidate, candidates)
+   {
+      if (!boost::algorithm::starts_with(candidate, prefix))
+         continue;
+
+      totalBytes += candidate.size() + 1;
+      if (totalBytes > kMaxCandidateBytes)
+      {
+         pFiles->clear();
+         return false;
+      }
+
+      pFiles->push_back(candidate);
+   }
+
+   return true;
+}
+
+Error initializeFindIndex()
+{
+   if (!projects::projectContext().hasProject())
+      return Success();
+
+   // read in any index saved on disk
+   loadFindIndex();
+
+   // create an incremental file change handler (on the heap so that it
+   // survives the call to this function and is never deleted)
+   s_pFileChangeHandler = new IncrementalFileChangeHandler(
+                                 isIndexableFile,
+                                 fileChangeHandler,
+                                 boost::posix_time::seconds(3),
+                                 boost::posix_time::milliseconds(500),
+                                 true);
+
+   // subscribe directly (rather than via the handler) so that we can
+   // reconcile the saved index with the files found at startup
+   projects::FileMonitorCallbacks cb;
+   cb.onMonitoringEnabled = onMonitoringEnabled;
+   cb.onFilesChanged = onFilesChanged;
+   cb.onMonitoringDisabled = onMonitoringDisabled;
+   projects::projectContext().subscribeToFileMonitor("Find in Files", cb);
+
+   // setup handler to save index at shutdown
+   module_context::events().onShutdown.connect(onShutdown);
+
+   return Success();
+}
+
+} // namespace find
+} // namespace modules
+} // namespace session
+} // namespace rstudio
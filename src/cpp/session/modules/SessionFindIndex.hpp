@@ -0,0 +1,50 @@
+/*
+ * SessionFindIndex.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_FIND_INDEX_HPP
+#define SESSION_FIND_INDEX_HPP
+
+#include <string>
+#include <vector>
+
+namespace rstudio {
+namespace core {
+   class Error;
+   class FilePath;
+}
+}
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace find {
+
+// get the files within the directory which may contain matches for the
+// (already encoded) search term. returns false if the index can't be used
+// to narrow the search, in which case the whole directory should be searched
+bool searchCandidates(const std::string& term,
+                      bool asRegex,
+                      bool ignoreCase,
+                      const core::FilePath& directory,
+                      std::vector<std::string>* pFiles);
+
+core::Error initializeFindIndex();
+
+} // namespace find
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_FIND_INDEX_HPP
@@ -0,0 +1,443 @@
+/*
+ * SessionFindSearch.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionFindSearch.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+#include <core/RegexUtils.hpp>
+#include <core/Thread.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace find {
+
+namespace {
+
+// files with a NUL byte near the start are treated as binary and skipped
+// (as grep does with --binary-files=without-match)
+const std::size_t kBinaryCheckBytes = 32768;
+
+// the size of the chunks files are read in (at least kBinaryCheckBytes)
+const std::size_t kReadChunkBytes = 65536;
+
+const int kMaxSearchThreads = 8;
+
+bool isBinary(const char* data, std::size_t size)
+{
+   return std::memchr(data, '\0', std::min(size, kBinaryCheckBytes)) != NULL;
+}
+
+// find the matches within a line, returning true if the line matches (a
+// line can match without any ranges if the pattern matches empty text)
+bool matchLine(const boost::regex& regex,
+               const char* begin,
+               const char* end,
+               std::vector<std::pair<std::size_t, std::size_t> >* pRanges)
+{
+   bool matched = false;
+   boost::cmatch match;
+   boost::match_flag_type flags = boost::match_default |
+                                  boost::match_not_dot_newline;
+
+   const char* pos = begin;
+   while (pos <= end && regex_utils::search(pos, end, match, regex, flags))
+   {
+      matched = true;
+
+      const char* matchBegin = match[0].first;
+      const char* matchEnd = match[0].second;
+      if (matchBegin == matchEnd)
+      {
+         // skip past empty matches
+         pos = matchEnd + 1;
+      }
+      else
+      {
+         pRanges->push_back(std::make_pair(
+                               static_cast<std::size_t>(matchBegin - begin),
+                               static_cast<std::size_t>(matchEnd - begin)));
+         pos = matchEnd;
+      }
+
+      flags |= boost::match_prev_avail;
+   }
+
+   return matched;
+}
+
+} // anonymous namespace
+
+Error FileSearch::create(const SearchOptions& options,
+                         boost::shared_ptr<FileSearch>* pSearch)
+{
+   // match the syntax of the grep command we used to invoke (basic regular
+   // expressions, where newlines separate alternatives)
+   boost::regex::flag_type flags = options.asRegex ? boost::regex::grep
+                                                   : boost::regex::literal;
+   if (options.ignoreCase)
+      flags |= boost::regex::icase;
+
+   boost::regex regex;
+   try
+   {
+      regex.assign(options.term, flags);
+   }
+   catch(const std::exception& e)
+   {
+      Error error = systemError(boost::system::errc::invalid_argument,
+                                ERROR_LOCATION);
+      error.addProperty("term", options.term);
+      error.addProperty("what", e.what());
+      return error;
+   }
+
+   pSearch->reset(new FileSearch(options, regex));
+   return Success();
+}
+
+FileSearch::FileSearch(const SearchOptions& options, const boost::regex& regex)
+   : options_(options),
+     regex_(regex),
+     matchCount_(0),
+     activeThreads_(0),
+     walkComplete_(false),
+     stopped_(false)
+{
+   BOOST_FOREACH(const std::string& pattern, options_.includePatterns)
+   {
+      includeRegexes_.push_back(regex_utils::wildcardPatternToRegex(pattern));
+   }
+}
+
+FileSearch::~FileSearch()
+{
+}
+
+void FileSearch::start()
+{
+   int threads = options_.threads;
+   if (threads <= 0)
+      threads = static_cast<int>(boost::thread::hardware_concurrency());
+   threads = std::max(1, std::min(threads, kMaxSearchThreads));
+
+   LOCK_MUTEX(mutex_)
+   {
+      activeThreads_ = threads;
+   }
+   END_LOCK_MUTEX
+
+   // threads keep us alive until they exit
+   core::thread::safeLaunchThread(
+            boost::bind(&FileSearch::walkFiles, shared_from_this()));
+   for (int i = 0; i < threads; i++)
+   {
+      core::thread::safeLaunchThread(
+               boost::bind(&FileSearch::searchFiles, shared_from_this()));
+   }
+}
+
+void FileSearch::stop()
+{
+   LOCK_MUTEX(mutex_)
+   {
+      stopped_ = true;
+      pendingFiles_.clear();
+   }
+   END_LOCK_MUTEX
+
+   condition_.notify_all();
+}
+
+bool FileSearch::takeMatches(std::vector<SearchMatch>* pMatches)
+{
+   pMatches->clear();
+
+   bool more = true;
+   LOCK_MUTEX(mutex_)
+   {
+      pMatches->swap(matches_);
+      more = !pMatches->empty() || !walkComplete_ || activeThreads_ > 0;
+   }
+   END_LOCK_MUTEX
+
+   return more;
+}
+
+void FileSearch::walkFiles()
+{
+   try
+   {
+      if (options_.searchFiles)
+      {
+         BOOST_FOREACH(const std::string& file, options_.files)
+         {
+            enqueFile(FilePath(file));
+         }
+      }
+      else
+      {
+         walkDirectory(options_.directory);
+      }
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+
+   LOCK_MUTEX(mutex_)
+   {
+      walkComplete_ = true;
+   }
+   END_LOCK_MUTEX
+
+   condition_.notify_all();
+}
+
+void FileSearch::walkDirectory(const FilePath& directory)
+{
+   std::vector<FilePath> directories(1, directory);
+   while (!directories.empty() && !stopped())
+   {
+      FilePath dir = directories.back();
+      directories.pop_back();
+
+      // unreadable directories are skipped (as grep would)
+      std::vector<FilePath> children;
+      Error error = dir.children(&children);
+      if (error)
+         continue;
+
+      // visit in order (directories are taken from the back)
+      std::reverse(children.begin(), children.end());
+      BOOST_FOREACH(const FilePath& child, children)
+      {
+         // symlinks found while recursing aren't followed by grep -r
+         if (child.isSymlink())
+            continue;
+
+         if (child.isDirectory())
+         {
+            if (!options_.skipDirectory || !options_.skipDirectory(child))
+               directories.push_back(child);
+         }
+         else
+         {
+            enqueFile(child);
+         }
+      }
+   }
+}
+
+void FileSearch::enqueFile(const FilePath& filePath)
+{
+   if (!isIncluded(filePath))
+      return;
+
+   LOCK_MUTEX(mutex_)
+   {
+      if (!stopped_)
+         pendingFiles_.push_back(filePath.absolutePath());
+   }
+   END_LOCK_MUTEX
+
+   condition_.notify_one();
+}
+
+bool FileSearch::isIncluded(const FilePath& filePath) const
+{
+   if (includeRegexes_.empty())
+      return true;
+
+   std::string filename = filePath.filename();
+   BOOST_FOREACH(const boost::regex& includeRegex, includeRegexes_)
+   {
+      if (regex_utils::match(filename, includeRegex))
+         return true;
+   }
+   return false;
+}
+
+void FileSearch::searchFiles()
+{
+   try
+   {
+      while (true)
+      {
+         std::string path;
+
+         // wait for a file (or the end of the walk)
+         boost::unique_lock<boost::mutex> lock(mutex_);
+         while (pendingFiles_.empty() && !walkComplete_ && !stopped_)
+            condition_.wait(lock);
+
+         if (stopped_ || pendingFiles_.empty())
+            break;
+
+         path = pendingFiles_.front();
+         pendingFiles_.pop_front();
+         lock.unlock();
+
+         searchFile(path);
+      }
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+
+   LOCK_MUTEX(mutex_)
+   {
+      activeThreads_--;
+   }
+   END_LOCK_MUTEX
+}
+
+void FileSearch::searchFile(const std::string& path)
+{
+   FilePath filePath(path);
+   std::string nativePath = filePath.absolutePathNative();
+
+   // skip devices, fifos, etc. (which we'd otherwise block on)
+   boost::system::error_code ec;
+   if (!boost::filesystem::is_regular_file(nativePath, ec) || ec)
+      return;
+
+   // the file is read in chunks rather than mapped, as a mapped file that's
+   // truncated while we search it faults (SIGBUS) when we touch the pages
+   // that are gone
+   boost::shared_ptr<std::istream> pStream;
+   Error error = filePath.open_r(&pStream);
+   if (error)
+   {
+      // unreadable files are skipped (as grep would)
+      return;
+   }
+
+   std::vector<SearchMatch> matches;
+   std::vector<char> chunk(kReadChunkBytes);
+   std::string buffer;
+   int lineNumber = 0;
+   bool firstChunk = true;
+   bool done = false;
+   while (!done)
+   {
+      pStream->read(&chunk[0], chunk.size());
+      std::size_t bytesRead = static_cast<std::size_t>(pStream->gcount());
+      bool atEnd = bytesRead < chunk.size();
+
+      // (the first chunk holds at least the bytes we check)
+      if (firstChunk && isBinary(&chunk[0], bytesRead))
+         return;
+      firstChunk = false;
+
+      // search the complete lines read so far, keeping a partial line at
+      // the end of the chunk until the rest of it is read
+      buffer.append(&chunk[0], bytesRead);
+      const char* data = buffer.data();
+      const char* end = data + buffer.size();
+      const char* lineBegin = data;
+      while (lineBegin < end)
+      {
+         const char* lineEnd = static_cast<const char*>(
+                           std::memchr(lineBegin, '\n', end - lineBegin));
+         if (lineEnd == NULL)
+         {
+            if (!atEnd)
+               break;
+            lineEnd = end;
+         }
+
+         lineNumber++;
+
+         std::vector<std::pair<std::size_t, std::size_t> > ranges;
+         if (matchLine(regex_, lineBegin, lineEnd, &ranges))
+         {
+            SearchMatch match;
+            match.file = path;
+            match.line = lineNumber;
+            match.contents.assign(lineBegin, lineEnd);
+            match.ranges.swap(ranges);
+            matches.push_back(match);
+
+            if (options_.maxMatches > 0 &&
+                matches.size() >= options_.maxMatches)
+            {
+               done = true;
+               break;
+            }
+         }
+
+         lineBegin = lineEnd + 1;
+
+         // check periodically for cancellation within large files
+         if ((lineNumber % 10000) == 0 && stopped())
+            return;
+      }
+
+      if (atEnd)
+         break;
+
+      buffer.erase(0, lineBegin - data);
+   }
+
+   if (matches.empty())
+      return;
+
+   bool reachedMax = false;
+   LOCK_MUTEX(mutex_)
+   {
+      if (!stopped_)
+      {
+         if (options_.maxMatches > 0 &&
+             matchCount_ + matches.size() > options_.maxMatches)
+         {
+            matches.resize(options_.maxMatches - matchCount_);
+         }
+
+         matches_.insert(matches_.end(), matches.begin(), matches.end());
+         matchCount_ += matches.size();
+
+         reachedMax = options_.maxMatches > 0 &&
+                      matchCount_ >= options_.maxMatches;
+      }
+   }
+   END_LOCK_MUTEX
+
+   // no need to keep looking once we have all the matches we can use
+   if (reachedMax)
+      stop();
+}
+
+bool FileSearch::stopped()
+{
+   LOCK_MUTEX(mutex_)
+   {
+      return stopped_;
+   }
+   END_LOCK_MUTEX
+
+   return true;
+}
+
+} // namespace find
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -0,0 +1,143 @@
+/*
+ * SessionFindSearch.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_FIND_SEARCH_HPP
+#define SESSION_FIND_SEARCH_HPP
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/regex.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace find {
+
+// a line containing one or more matches. contents are as read from the
+// file (i.e. in the file's encoding) and match ranges are byte offsets
+struct SearchMatch
+{
+   std::string file;
+   int line;
+   std::string contents;
+   std::vector<std::pair<std::size_t, std::size_t> > ranges;
+};
+
+struct SearchOptions
+{
+   SearchOptions()
+      : asRegex(false), ignoreCase(false), searchFiles(false),
+        maxMatches(0), threads(0)
+   {
+   }
+
+   // term (in the encoding of the files being searched)
+   std::string term;
+   bool asRegex;
+   bool ignoreCase;
+
+   // directory to search recursively, or the files to search if
+   // searchFiles is set (e.g. candidates from the find index)
+   core::FilePath directory;
+   std::vector<std::string> files;
+   bool searchFiles;
+
+   // file name patterns (e.g. *.R) -- if empty all files are searched
+   std::vector<std::string> includePatterns;
+
+   // directories to skip entirely. this is called from search threads so
+   // must not touch session state
+   boost::function<bool(const core::FilePath&)> skipDirectory;
+
+   // stop once this many matching lines are found (0 for no limit)
+   std::size_t maxMatches;
+
+   // number of search threads (0 for one per core)
+   int threads;
+};
+
+// Search for matches within files using a pool of background threads. Files
+// are read in chunks and lines are matched in place within them; matches are
+// collected for the caller to take as they are found.
+class FileSearch : boost::noncopyable,
+                   public boost::enable_shared_from_this<FileSearch>
+{
+public:
+   // returns an error if the term is not a valid regular expression
+   static core::Error create(const SearchOptions& options,
+                             boost::shared_ptr<FileSearch>* pSearch);
+
+   virtual ~FileSearch();
+
+   void start();
+
+   // ask search threads to stop (they finish the file they're on)
+   void stop();
+
+   // take the matches found so far. returns false once the search is
+   // complete and there are no more matches to take
+   bool takeMatches(std::vector<SearchMatch>* pMatches);
+
+private:
+   FileSearch(const SearchOptions& options, const boost::regex& regex);
+
+   void walkFiles();
+   void walkDirectory(const core::FilePath& directory);
+   void enqueFile(const core::FilePath& filePath);
+   bool isIncluded(const core::FilePath& filePath) const;
+
+   void searchFiles();
+   void searchFile(const std::string& path);
+
+   bool stopped();
+
+private:
+   SearchOptions options_;
+   boost::regex regex_;
+   std::vector<boost::regex> includeRegexes_;
+
+   boost::mutex mutex_;
+   boost::condition condition_;
+   std::deque<std::string> pendingFiles_;
+   std::vector<SearchMatch> matches_;
+   std::size_t matchCount_;
+   int activeThreads_;
+   bool walkComplete_;
+   bool stopped_;
+};
+
+} // namespace find
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_FIND_SEARCH_HPP
@@ -0,0 +1,304 @@
+/*
+ * SessionFindSearchTests.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionFindSearch.hpp"
+
+#include <algorithm>
+
+#include <boost/thread/thread.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+#include <core/SafeConvert.hpp>
+
+#define RSTUDIO_NO_TESTTHAT_ALIASES
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace find {
+namespace tests {
+
+using namespace rstudio::core;
+
+namespace {
+
+typedef std::vector<std::pair<std::size_t, std::size_t> > Ranges;
+
+bool compareMatches(const SearchMatch& a, const SearchMatch& b)
+{
+   if (a.file != b.file)
+      return a.file < b.file;
+   return a.line < b.line;
+}
+
+// run the search to completion, returning the matches ordered by file and
+// line (search threads report them in whatever order they finish)
+std::vector<SearchMatch> search(const SearchOptions& options)
+{
+   boost::shared_ptr<FileSearch> pSearch;
+   Error error = FileSearch::create(options, &pSearch);
+   REQUIRE_FALSE(error);
+
+   pSearch->start();
+
+   std::vector<SearchMatch> matches;
+   std::vector<SearchMatch> taken;
+   while (pSearch->takeMatches(&taken))
+   {
+      matches.insert(matches.end(), taken.begin(), taken.end());
+      boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+   }
+
+   std::sort(matches.begin(), matches.end(), compareMatches);
+   return matches;
+}
+
+std::vector<SearchMatch> searchFile(const FilePath& filePath,
+                                    const std::string& term,
+                                    bool asRegex = false,
+                                    bool ignoreCase = false)
+{
+   SearchOptions options;
+   options.term = term;
+   options.asRegex = asRegex;
+   options.ignoreCase = ignoreCase;
+   options.files.push_back(filePath.absolutePath());
+   options.searchFiles = true;
+   return search(options);
+}
+
+Ranges ranges(std::size_t begin, std::size_t end)
+{
+   return Ranges(1, std::make_pair(begin, end));
+}
+
+class TempDir
+{
+public:
+   TempDir()
+   {
+      REQUIRE_FALSE(FilePath::tempFilePath(&path_));
+      REQUIRE_FALSE(path_.ensureDirectory());
+   }
+
+   ~TempDir()
+   {
+      Error error = path_.remove();
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   FilePath write(const std::string& name, const std::string& contents)
+   {
+      FilePath filePath = path_.complete(name);
+      REQUIRE_FALSE(writeStringToFile(filePath, contents));
+      return filePath;
+   }
+
+   const FilePath& path() const { return path_; }
+
+private:
+   FilePath path_;
+};
+
+} // anonymous namespace
+
+TEST_CASE("FileSearch")
+{
+   TempDir dir;
+
+   SECTION("Every match within a line is reported")
+   {
+      FilePath filePath = dir.write("a.R", "x <- 1\nfoo(foo)\nbar\n");
+      std::vector<SearchMatch> matches = searchFile(filePath, "foo");
+
+      REQUIRE(matches.size() == 1);
+      CHECK(matches[0].file == filePath.absolutePath());
+      CHECK(matches[0].line == 2);
+      CHECK(matches[0].contents == "foo(foo)");
+
+      Ranges expected;
+      expected.push_back(std::make_pair(0, 3));
+      expected.push_back(std::make_pair(4, 7));
+      CHECK(matches[0].ranges == expected);
+   }
+
+   SECTION("Empty matches match the line without adding ranges")
+   {
+      FilePath filePath = dir.write("a.R", "abc\naxxb\n");
+      std::vector<SearchMatch> matches = searchFile(filePath, "x*", true);
+
+      REQUIRE(matches.size() == 2);
+      CHECK(matches[0].line == 1);
+      CHECK(matches[0].ranges.empty());
+      CHECK(matches[1].line == 2);
+      CHECK(matches[1].ranges == ranges(1, 3));
+   }
+
+   SECTION("Regular expressions use grep's basic syntax")
+   {
+      FilePath filePath = dir.write("a.R", "xabbx\nab\na+b\n");
+
+      // \( \) group and \{ \} repeat
+      std::vector<SearchMatch> matches =
+            searchFile(filePath, "a\\(b\\)\\{2\\}", true);
+      REQUIRE(matches.size() == 1);
+      CHECK(matches[0].line == 1);
+      CHECK(matches[0].ranges == ranges(1, 4));
+
+      // + is an ordinary character
+      matches = searchFile(filePath, "a+b", true);
+      REQUIRE(matches.size() == 1);
+      CHECK(matches[0].line == 3);
+      CHECK(matches[0].ranges == ranges(0, 3));
+   }
+
+   SECTION("Literal terms don't treat regex characters specially")
+   {
+      FilePath filePath = dir.write("a.R", "a.b\naxb\n");
+      std::vector<SearchMatch> matches = searchFile(filePath, "a.b");
+
+      REQUIRE(matches.size() == 1);
+      CHECK(matches[0].line == 1);
+   }
+
+   SECTION("Case is ignored when asked")
+   {
+      FilePath filePath = dir.write("a.R", "foo Foo FOO\n");
+
+      CHECK(searchFile(filePath, "FOO").size() == 1);
+      CHECK(searchFile(filePath, "FOO")[0].ranges == ranges(8, 11));
+
+      std::vector<SearchMatch> matches =
+            searchFile(filePath, "FOO", false, true);
+      REQUIRE(matches.size() == 1);
+      CHECK(matches[0].ranges.size() == 3);
+
+      matches = searchFile(filePath, "f\\(o\\)*", true, true);
+      REQUIRE(matches.size() == 1);
+      CHECK(matches[0].ranges.size() == 3);
+   }
+
+   SECTION("Binary files are skipped")
+   {
+      std::string binary("foo\n");
+      binary.push_back('\0');
+      binary.append("foo\n");
+      FilePath filePath = dir.write("a.bin", binary);
+      CHECK(searchFile(filePath, "foo").empty());
+
+      // only the start of the file is checked
+      std::string text(40000, 'x');
+      text.append("\nfoo\n");
+      text.push_back('\0');
+      filePath = dir.write("b.bin", text);
+      std::vector<SearchMatch> matches = searchFile(filePath, "foo");
+      REQUIRE(matches.size() == 1);
+      CHECK(matches[0].line == 2);
+   }
+
+   SECTION("Lines that straddle read chunks are matched whole")
+   {
+      // files are read 64KB at a time; put a match across the boundary
+      std::string contents(65530, 'a');
+      contents.append("\nbbbbfoobbb\n");
+      contents.append(std::string(100000, 'c'));
+      contents.append("foo\nfoo\n");
+      FilePath filePath = dir.write("a.R", contents);
+
+      std::vector<SearchMatch> matches = searchFile(filePath, "foo");
+      REQUIRE(matches.size() == 3);
+
+      CHECK(matches[0].line == 2);
+      CHECK(matches[0].contents == "bbbbfoobbb");
+      CHECK(matches[0].ranges == ranges(4, 7));
+
+      // a line longer than a chunk
+      CHECK(matches[1].line == 3);
+      CHECK(matches[1].contents.size() == 100003);
+      CHECK(matches[1].ranges == ranges(100000, 100003));
+
+      CHECK(matches[2].line == 4);
+   }
+
+   SECTION("The last line is matched without a trailing newline")
+   {
+      FilePath filePath = dir.write("a.R", "bar\nfoo");
+      std::vector<SearchMatch> matches = searchFile(filePath, "foo");
+
+      REQUIRE(matches.size() == 1);
+      CHECK(matches[0].line == 2);
+      CHECK(matches[0].contents == "foo");
+   }
+
+   SECTION("Directories are searched recursively for included files")
+   {
+      dir.write("a.R", "foo\n");
+      dir.write("b.txt", "foo\n");
+      FilePath sub = dir.path().complete("sub");
+      REQUIRE_FALSE(sub.ensureDirectory());
+      REQUIRE_FALSE(writeStringToFile(sub.complete("c.R"), "foo\n"));
+
+      SearchOptions options;
+      options.term = "foo";
+      options.directory = dir.path();
+      options.includePatterns.push_back("*.R");
+      std::vector<SearchMatch> matches = search(options);
+
+      REQUIRE(matches.size() == 2);
+      CHECK(matches[0].file == dir.path().complete("a.R").absolutePath());
+      CHECK(matches[1].file == sub.complete("c.R").absolutePath());
+   }
+
+   SECTION("No more than the maximum matches are reported across threads")
+   {
+      std::string contents;
+      for (int i = 0; i < 10; i++)
+         contents.append("foo\n");
+
+      SearchOptions options;
+      options.term = "foo";
+      options.searchFiles = true;
+      options.threads = 4;
+      for (int i = 0; i < 20; i++)
+      {
+         std::string name = "f" + safe_convert::numberToString(i) + ".R";
+         options.files.push_back(dir.write(name, contents).absolutePath());
+      }
+
+      options.maxMatches = 15;
+      CHECK(search(options).size() == 15);
+
+      // and within a single file
+      options.files.resize(1);
+      options.maxMatches = 5;
+      CHECK(search(options).size() == 5);
+
+      // without a maximum every match is reported
+      options.files.resize(2);
+      options.maxMatches = 0;
+      CHECK(search(options).size() == 20);
+   }
+}
+
+} // namespace tests
+} // namespace find
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -14,6 +14,8 @@
  */
 #include "SessionGit.hpp"
 
+#include <set>
+
 #include <signal.h>
 #include <sys/stat.h>
 
@@ -46,6 +48,7 @@
 #include <core/system/System.hpp>
 #include <core/system/Process.hpp>
 #include <core/system/Environment.hpp>
+#include <core/system/FileChangeEvent.hpp>
 #include <core/Exec.hpp>
 #include <core/FileSerializer.hpp>
 #include <core/GitGraph.hpp>
@@ -65,6 +68,7 @@
 
 #include "SessionVCS.hpp"
 
+#include "vcs/SessionGitObjectReader.hpp"
 #include "vcs/SessionVCSCore.hpp"
 #include "vcs/SessionVCSUtils.hpp"
 
@@ -191,6 +195,9 @@ class Git;
 
 std::vector<PidType> s_pidsToTerminate_;
 
+// serves file contents at a revision without starting git for each request
+GitObjectReader s_gitObjectReader_;
+
 ShellCommand git()
 {
    if (!s_gitExePath.empty())
@@ -365,10 +372,274 @@ bool isUntracked(const source_control::StatusResult& statusResult,
    return statusResult.getStatus(filePath).status() == "??";
 }
 
+// the file system changes we'll bring the status cache up to date with by
+// querying status for just the changed paths; past this we rescan the tree
+const std::size_t kMaxIncrementalStatusPaths = 200;
+
+bool isWithinPath(const std::string& path, const std::string& scope)
+{
+   return path == scope ||
+          (boost::algorithm::starts_with(path, scope) &&
+           path.length() > scope.length() &&
+           path[scope.length()] == '/');
+}
+
+// Status of the working tree, kept up to date from the project's file
+// monitor so that a change to a few files only needs a status query limited
+// to those files rather than a rescan of the whole tree. This uses the
+// monitor's unfiltered changes, as git tracks files the file listing hides
+// (hidden files, object files). Changes git makes to the index or HEAD
+// (commits, staging, checkouts, whether from here or elsewhere) aren't
+// visible to the monitor, so the cache also records a stamp of those files
+// and is rebuilt when it changes.
+class StatusCache : boost::noncopyable
+{
+public:
+   StatusCache() : valid_(false), renames_(0) {}
+
+   bool valid() const { return valid_; }
+   const std::string& stamp() const { return stamp_; }
+
+   void invalidate()
+   {
+      valid_ = false;
+      files_.clear();
+      pendingPaths_.clear();
+      renames_ = 0;
+   }
+
+   void reset(const std::string& stamp,
+              const std::vector<FileWithStatus>& files)
+   {
+      invalidate();
+      BOOST_FOREACH(const FileWithStatus& file, files)
+      {
+         add(file);
+      }
+      stamp_ = stamp;
+      valid_ = true;
+   }
+
+   void onFilesChanged(const std::vector<core::system::FileChangeEvent>& events)
+   {
+      if (!valid_)
+         return;
+
+      BOOST_FOREACH(const core::system::FileChangeEvent& event, events)
+      {
+         FilePath path(event.fileInfo().absolutePath());
+
+         // ignore rules can change the status of any number of files
+         if (path.filename() == ".gitignore")
+         {
+            invalidate();
+            return;
+         }
+
+         pendingPaths_.insert(path.absolutePath());
+      }
+
+      if (pendingPaths_.size() > kMaxIncrementalStatusPaths)
+         invalidate();
+   }
+
+   // the paths to re-query status for, or false if the cache needs to be
+   // rebuilt instead. a change within an untracked directory re-queries the
+   // whole directory (as git reports it collapsed), and renames are
+   // reported as pairs that a path-limited query can't reproduce
+   bool takePendingPaths(const FilePath& root, std::vector<FilePath>* pPaths)
+   {
+      if (!pendingPaths_.empty() && renames_ > 0)
+         return false;
+
+      std::set<std::string> paths;
+      BOOST_FOREACH(const std::string& pendingPath, pendingPaths_)
+      {
+         std::string path = pendingPath;
+         if (!isWithinPath(path, root.absolutePath()) ||
+             path == root.absolutePath())
+         {
+            continue;
+         }
+
+         FilePath parent = FilePath(pendingPath).parent();
+         while (parent != root && isWithinPath(parent.absolutePath(),
+                                               root.absolutePath()))
+         {
+            std::map<std::string, FileWithStatus>::const_iterator it =
+                  files_.find(parent.absolutePath());
+            if (it != files_.end() && it->second.status.status() == "??")
+               path = parent.absolutePath();
+            parent = parent.parent();
+         }
+
+         paths.insert(path);
+      }
+      pendingPaths_.clear();
+
+      // drop paths within others we're already querying
+      std::string previous;
+      BOOST_FOREACH(const std::string& path, paths)
+      {
+         if (!previous.empty() && isWithinPath(path, previous))
+            continue;
+         pPaths->push_back(FilePath(path));
+         previous = path;
+      }
+
+      return true;
+   }
+
+   // replace what we know about the given paths with fresh status for them
+   void update(const std::string& stamp,
+               const std::vector<FilePath>& paths,
+               const std::vector<FileWithStatus>& files)
+   {
+      BOOST_FOREACH(const FilePath& path, paths)
+      {
+         std::string scope = path.absolutePath();
+         files_.erase(scope);
+         std::map<std::string, FileWithStatus>::iterator it =
+               files_.lower_bound(scope + "/");
+         while (it != files_.end() && isWithinPath(it->first, scope))
+            files_.erase(it++);
+      }
+
+      BOOST_FOREACH(const FileWithStatus& file, files)
+      {
+         // a file in an untracked directory is reported on its own when
+         // queried by path, but the directory already accounts for it
+         if (file.status.status() != "??" || !hasUntrackedParent(file.path))
+            add(file);
+      }
+
+      stamp_ = stamp;
+   }
+
+   // status of the files within dir, along with the directories containing
+   // it (as a status query for dir would report an untracked parent)
+   StatusResult statusResult(const FilePath& dir) const
+   {
+      std::vector<FileWithStatus> files;
+
+      std::string scope = dir.absolutePath();
+      std::map<std::string, FileWithStatus>::const_iterator it =
+            files_.lower_bound(scope);
+      for (; it != files_.end() && isWithinPath(it->first, scope); ++it)
+         files.push_back(it->second);
+
+      std::string parent = scope;
+      std::size_t slash;
+      while ((slash = parent.rfind('/')) != std::string::npos && slash > 0)
+      {
+         parent = parent.substr(0, slash);
+         it = files_.find(parent);
+         if (it != files_.end())
+            files.push_back(it->second);
+      }
+
+      return StatusResult(files);
+   }
+
+private:
+   void add(const FileWithStatus& file)
+   {
+      std::string status = file.status.status();
+      if (status == "R " || status == "C ")
+         ++renames_;
+      files_[file.path.absolutePath()] = file;
+   }
+
+   bool hasUntrackedParent(const FilePath& path) const
+   {
+      std::string parent = path.absolutePath();
+      std::size_t slash;
+      while ((slash = parent.rfind('/')) != std::string::npos && slash > 0)
+      {
+         parent = parent.substr(0, slash);
+         std::map<std::string, FileWithStatus>::const_iterator it =
+               files_.find(parent);
+         if (it != files_.end() && it->second.status.status() == "??")
+            return true;
+      }
+      return false;
+   }
+
+private:
+   bool valid_;
+   std::string stamp_;
+   std::map<std::string, FileWithStatus> files_;
+   std::set<std::string> pendingPaths_;
+   std::size_t renames_;
+};
+
+// The history graph built so far for a revision. Pages of history are
+// requested in order as the history viewer scrolls (and repeatedly as it
+// refreshes), so rather than rebuild the graph from the tip for every page we
+// keep the graph state and the lines produced so far, extending them with
+// just the commits a page needs.
+struct HistoryGraph
+{
+   HistoryGraph() : complete(false) {}
+
+   void reset(const std::string& newKey)
+   {
+      key = newKey;
+      pGraph.reset(new gitgraph::GitGraph());
+      lines.clear();
+      complete = false;
+   }
+
+   // the revision along with the commit(s) it resolved to
+   std::string key;
+
+   boost::shared_ptr<gitgraph::GitGraph> pGraph;
+   std::vector<std::string> lines;
+
+   // have we reached the root commit(s)?
+   bool complete;
+};
+
+// git commands which don't change the index, HEAD or working tree (and so
+// leave the status cache valid)
+bool isReadOnlyCommand(const ShellArgs& args)
+{
+   static const char* const kReadOnlyCommands[] = {
+      "status", "log", "show", "diff", "rev-parse", "rev-list", "config",
+      "branch", "remote", "cat-file", "ls-files", "for-each-ref"
+   };
+
+   // the first argument after any global options is the command
+   const std::vector<std::string>& arguments = args.args();
+   for (std::size_t i = 0; i < arguments.size(); i++)
+   {
+      if (arguments[i] == "-c")
+      {
+         i++;
+         continue;
+      }
+
+      if (boost::algorithm::starts_with(arguments[i], "-"))
+         continue;
+
+      BOOST_FOREACH(const char* command, kReadOnlyCommands)
+      {
+         if (arguments[i] == command)
+            return true;
+      }
+      return false;
+   }
+
+   return false;
+}
+
 class Git : public boost::noncopyable
 {
 private:
    FilePath root_;
+   bool cacheStatus_;
+   StatusCache statusCache_;
+   HistoryGraph historyGraph_;
 
 protected:
    core::Error runGit(const ShellArgs& args,
@@ -378,6 +649,9 @@ protected:
    {
       using namespace rstudio::core::system;
 
+      if (!isReadOnlyCommand(args))
+         statusCache_.invalidate();
+
       ProcessResult result;
       Error error = gitExec(args, root_, &result);
       if (error)
@@ -406,6 +680,8 @@ protected:
    {
       using namespace session::console_process;
 
+      statusCache_.invalidate();
+
       core::system::ProcessOptions options = procOptions();
 #ifdef _WIN32
       options.detachProcess = true;
@@ -464,11 +740,11 @@ protected:
 
 public:
 
-   Git() : root_(FilePath())
+   Git() : root_(FilePath()), cacheStatus_(false)
    {
    }
 
-   Git(const FilePath& root) : root_(root)
+   Git(const FilePath& root) : root_(root), cacheStatus_(false)
    {
    }
 
@@ -482,20 +758,117 @@ public:
    void setRoot(const FilePath& path)
    {
       root_ = path;
+      statusCache_.invalidate();
    }
 
    core::Error status(const FilePath& dir,
                       StatusResult* pStatusResult)
+   {
+      if (!useStatusCache(dir))
+      {
+         std::vector<FileWithStatus> files;
+         Error error = status(std::vector<FilePath>(1, dir), &files);
+         if (error)
+            return error;
+
+         *pStatusResult = StatusResult(files);
+         return Success();
+      }
+
+      // pick up changes the file monitor has seen but not yet delivered
+      projects::projectContext().flushFileChanges();
+
+      std::vector<FilePath> paths;
+      if (!statusCache_.valid() ||
+          statusCache_.stamp() != repositoryStamp() ||
+          !statusCache_.takePendingPaths(root_, &paths))
+      {
+         std::vector<FileWithStatus> files;
+         Error error = status(std::vector<FilePath>(1, root_), &files);
+         if (error)
+            return error;
+
+         statusCache_.reset(repositoryStamp(), files);
+      }
+      else if (!paths.empty())
+      {
+         std::vector<FileWithStatus> files;
+         Error error = status(paths, &files);
+         if (error)
+         {
+            statusCache_.invalidate();
+            return error;
+         }
+
+         // note that the stamp is taken after running status, as git may
+         // take the opportunity to refresh the index
+         statusCache_.update(repositoryStamp(), paths, files);
+      }
+
+      *pStatusResult = statusCache_.statusResult(dir);
+      return Success();
+   }
+
+   void enableStatusCache()
+   {
+      if (cacheStatus_)
+         return;
+      cacheStatus_ = true;
+
+      projects::FileMonitorCallbacks cb;
+      cb.onUnfilteredFilesChanged = boost::bind(&StatusCache::onFilesChanged,
+                                                &statusCache_, _1);
+      cb.onMonitoringDisabled = boost::bind(&StatusCache::invalidate,
+                                            &statusCache_);
+      projects::projectContext().subscribeToFileMonitor("", cb);
+   }
+
+private:
+   // the cache is only kept when the project's file monitor covers the
+   // whole repository (and there's an index to watch for changes)
+   bool useStatusCache(const FilePath& dir)
+   {
+      if (!cacheStatus_ || root_.empty() ||
+          !isWithinPath(dir.absolutePath(), root_.absolutePath()))
+      {
+         return false;
+      }
+
+      if (!projects::projectContext().isMonitoringDirectory(root_) ||
+          !root_.childPath(".git/index").exists())
+      {
+         statusCache_.invalidate();
+         return false;
+      }
+
+      return true;
+   }
+
+   std::string repositoryStamp()
+   {
+      std::string stamp;
+      const char* files[] = { ".git/index", ".git/HEAD" };
+      BOOST_FOREACH(const char* file, files)
+      {
+         FilePath path = root_.childPath(file);
+         stamp += safe_convert::numberToString(path.lastWriteTime()) + ":" +
+                  safe_convert::numberToString(path.size()) + ";";
+      }
+      return stamp;
+   }
+
+   core::Error status(const std::vector<FilePath>& paths,
+                      std::vector<FileWithStatus>* pFiles)
    {
       using namespace boost;
 
       // objects to be populated from git's output
-      std::vector<FileWithStatus> files;
+      std::vector<FileWithStatus>& files = *pFiles;
       
       // build shell arguments
       ShellArgs arguments = gitArgs();
       
-      arguments << "status" << "-z" << "--porcelain" << "--" << dir;
+      arguments << "status" << "-z" << "--porcelain" << "--" << paths;
       
       std::string output;
       Error error = runGit(arguments, &output);
@@ -534,11 +907,11 @@ public:
          files.push_back(file);
       }
 
-      *pStatusResult = StatusResult(files);
-
       return Success();
    }
 
+public:
+
    core::Error add(const std::vector<FilePath>& filePaths)
    {
       return runGit(gitArgs() << "add" << "--" << filePaths);
@@ -1150,6 +1523,76 @@ public:
       }
    }
 
+   // the graph lines for count commits (all if negative) of the history of
+   // rev, starting skip commits in
+   core::Error historyGraphLines(const std::string& rev,
+                                 int skip,
+                                 int count,
+                                 std::vector<std::string>* pLines)
+   {
+      std::string revision = rev.empty() ? std::string("HEAD") : rev;
+
+      // the graph is only good for as long as the revision resolves to
+      // the same commit(s)
+      std::string resolved;
+      Error error = runGit(gitArgs() << "rev-parse" << revision, &resolved);
+      if (error)
+         return error;
+
+      std::string key = revision + "\n" + resolved;
+      if (key != historyGraph_.key || !historyGraph_.pGraph)
+         historyGraph_.reset(key);
+
+      std::size_t begin = skip > 0 ? skip : 0;
+      std::size_t end = count >= 0 ? begin + count :
+                                     std::numeric_limits<std::size_t>::max();
+
+      std::vector<std::string>& lines = historyGraph_.lines;
+      if (!historyGraph_.complete && lines.size() < end)
+      {
+         // commits come in the same order each time, so we can pick up
+         // where the graph left off
+         ShellArgs args = gitArgs() << "rev-list" << "--date-order" << "--parents";
+         if (!lines.empty())
+            args << "--skip=" + safe_convert::numberToString(lines.size());
+         if (count >= 0)
+            args << "--max-count=" + safe_convert::numberToString(end - lines.size());
+         args << revision;
+
+         std::string output;
+         error = runGit(args, &output);
+         if (error)
+            return error;
+
+         std::vector<std::string> revOutLines = split(output);
+         output.clear();
+
+         for (size_t i = 0; i < revOutLines.size(); i++)
+         {
+            typedef std::vector<std::string> find_vector_type;
+            find_vector_type parents;
+            boost::algorithm::split(parents, revOutLines[i],
+                                    boost::algorithm::is_any_of(" "));
+            if (parents.size() < 1 || parents.front().empty())
+               continue;
+
+            std::string commit = parents.front();
+            parents.erase(parents.begin());
+
+            gitgraph::Line line = historyGraph_.pGraph->addCommit(commit, parents);
+            lines.push_back(line.string());
+         }
+
+         if (count < 0 || lines.size() < end)
+            historyGraph_.complete = true;
+      }
+
+      for (std::size_t i = begin; i < end && i < lines.size(); i++)
+         pLines->push_back(lines[i]);
+
+      return Success();
+   }
+
    core::Error logLength(const std::string &rev,
                          const FilePath& fileFilter,
                          const std::string &searchText,
@@ -1195,14 +1638,11 @@ public:
                        << "--pretty=raw" << "--decorate=full"
                        << "--date-order";
 
-      ShellArgs revListArgs = gitArgs() << "rev-list" << "--date-order" << "--parents";
-      int revListSkip = skip;
+      int graphSkip = skip;
+      int graphCount = maxentries;
 
       if (!fileFilter.empty())
-      {
          args << "--" << fileFilter;
-         revListArgs << "--" << fileFilter;
-      }
 
       if (searchText.empty() && fileFilter.empty())
       {
@@ -1217,21 +1657,11 @@ public:
          {
             args << "--max-count=" + safe_convert::numberToString(maxentries);
             maxentries = -1;
-
-            revListArgs << "--max-count=" + safe_convert::numberToString(
-                  (skip < 0 ? 0 : skip) + maxentries);
          }
       }
 
       if (!rev.empty())
-      {
          args << rev;
-         revListArgs << rev;
-      }
-      else
-      {
-         revListArgs << "HEAD";
-      }
 
       if (maxentries < 0)
          maxentries = std::numeric_limits<int>::max();
@@ -1247,31 +1677,9 @@ public:
       std::vector<std::string> graphLines;
       if (searchText.empty() && fileFilter.empty())
       {
-         std::vector<std::string> revOutLines;
-         std::string revOutput;
-         error = runGit(revListArgs, &revOutput);
+         error = historyGraphLines(rev, graphSkip, graphCount, &graphLines);
          if (error)
             return error;
-         revOutLines = split(revOutput);
-         revOutput.clear();
-
-         gitgraph::GitGraph graph;
-         for (size_t i = 0; i < revOutLines.size(); i++)
-         {
-            typedef std::vector<std::string> find_vector_type;
-            find_vector_type parents;
-            boost::algorithm::split(parents, revOutLines[i],
-                                    boost::algorithm::is_any_of(" "));
-            if (parents.size() < 1)
-               break;
-
-            std::string commit = parents.front();
-            parents.erase(parents.begin());
-
-            gitgraph::Line line = graph.addCommit(commit, parents);
-            if (revListSkip <= 0 || static_cast<int>(i) >= revListSkip)
-               graphLines.push_back(line.string());
-         }
       }
 
       boost::function<bool(CommitInfo)> filter = createSearchTextPredicate(searchText);
@@ -1409,8 +1817,19 @@ public:
                                 std::string* pOutput)
    {
       boost::format fmt("%1%:%2%");
-      ShellArgs args =
-            gitArgs() << "show" << boost::str(fmt % rev % filename);
+      std::string object = boost::str(fmt % rev % filename);
+
+#ifndef _WIN32
+      // prefer the long-lived cat-file batch; fall back to 'git show' for
+      // anything it can't answer
+      core::system::ProcessOptions options = procOptions();
+      options.workingDir = root_;
+      ShellCommand catFile = git() << "cat-file" << "--batch";
+      if (s_gitObjectReader_.readBlob(catFile, options, object, pOutput))
+         return Success();
+#endif
+
+      ShellArgs args = gitArgs() << "show" << object;
 
       return runGit(args, pOutput);
    }
@@ -2923,6 +3342,8 @@ void onShutdown(bool)
    std::for_each(s_pidsToTerminate_.begin(), s_pidsToTerminate_.end(),
                  &core::system::terminateProcess);
    s_pidsToTerminate_.clear();
+
+   s_gitObjectReader_.stop();
 }
 
 Error addFilesToGitIgnore(const FilePath& gitIgnoreFile,
@@ -3045,6 +3466,17 @@ Error augmentGitIgnore(const FilePath& gitIgnoreFile)
    }
 }
 
+void onDeferredInitAugmentGitIgnore(bool)
+{
+   if (s_git_.root().empty())
+      return;
+
+   FilePath gitIgnore = s_git_.root().childPath(".gitignore");
+   Error error = augmentGitIgnore(gitIgnore);
+   if (error)
+      LOG_ERROR(error);
+}
+
 FilePath whichGitExe()
 {
    // find git
@@ -3242,6 +3674,11 @@ bool isGitDirectory(const core::FilePath& workingDir)
    return !detectGitDir(workingDir).empty();
 }
 
+FilePath detectGitRoot(const core::FilePath& workingDir)
+{
+   return detectGitDir(workingDir);
+}
+
 
 std::string remoteOriginUrl(const FilePath& workingDir)
 {
@@ -3276,14 +3713,20 @@ bool isGithubRepository()
 
 core::Error initializeGit(const core::FilePath& workingDir)
 {
-   s_git_.setRoot(detectGitDir(workingDir));
+   return initializeGitRoot(detectGitDir(workingDir));
+}
+
+core::Error initializeGitRoot(const core::FilePath& gitRoot)
+{
+   s_git_.setRoot(gitRoot);
 
    if (!s_git_.root().empty())
    {
-      FilePath gitIgnore = s_git_.root().childPath(".gitignore");
-      Error error = augmentGitIgnore(gitIgnore);
-      if (error)
-         LOG_ERROR(error);
+      s_git_.enableStatusCache();
+
+      // augmenting .gitignore can wait until the session is up
+      module_context::events().onDeferredInit.connect(
+                                          onDeferredInitAugmentGitIgnore);
    }
 
    return Success();
@@ -3354,7 +3797,7 @@ core::Error initialize()
    addSuspendHandler(SuspendHandler(boost::bind(onSuspend, _2), onResume));
 
    // add settings changed handler
-   userSettings().onChanged.connect(onUserSettingsChanged);
+   userSettings().onKeyChanged(kUserSettingsGitExePath, onUserSettingsChanged);
 
    // install rpc methods
    using boost::bind;
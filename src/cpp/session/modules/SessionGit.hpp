@@ -58,12 +58,19 @@ bool isWithinGitRoot(const core::FilePath& filePath);
 
 bool isGitDirectory(const core::FilePath& workingDir);
 
+// the top level directory of the repository containing workingDir (empty if
+// it isn't within a repository)
+core::FilePath detectGitRoot(const core::FilePath& workingDir);
+
 std::string remoteOriginUrl(const core::FilePath& workingDir);
 
 bool isGithubRepository();
 
 core::Error initializeGit(const core::FilePath& workingDir);
 
+// as initializeGit, given the root of the repository (from detectGitRoot)
+core::Error initializeGitRoot(const core::FilePath& gitRoot);
+
 core::FilePath detectedGitExePath();
 
 std::string nonPathGitBinDir();
@@ -93,6 +93,10 @@ void enqueHTMLPreviewSucceeded(const std::string& title,
    module_context::enqueClientEvent(event);
 }
 
+// html for the blocks of the last markdown document previewed (so that
+// refreshing the preview of an edited document only renders what changed)
+markdown::BlockCache s_markdownBlockCache;
+
 class HTMLPreview : public async_r::AsyncRProcess
 {
 public:
@@ -376,6 +380,7 @@ private:
                                             content,
                                             markdown::Extensions(),
                                             markdown::HTMLOptions(),
+                                            &s_markdownBlockCache,
                                             &htmlContent);
             if (error)
             {
@@ -16,9 +16,14 @@
 #include "SessionHelp.hpp"
 
 #include <algorithm>
+#include <deque>
+#include <sstream>
 
 #include <boost/regex.hpp>
+#include <boost/foreach.hpp>
 #include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/format.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <boost/algorithm/string/replace.hpp>
@@ -28,6 +33,7 @@
 #include <core/Error.hpp>
 #include <core/Exec.hpp>
 #include <core/Log.hpp>
+#include <core/StringUtils.hpp>
 
 #include <core/http/Request.hpp>
 #include <core/http/Response.hpp>
@@ -52,6 +58,8 @@
 #include "presentation/SlideRequestHandler.hpp"
 
 #include "SessionHelpHome.hpp"
+#include "SessionHelpCache.hpp"
+#include "SessionHelpIndex.hpp"
 
 // protect R against windows TRUE/FALSE defines
 #undef TRUE
@@ -72,6 +80,9 @@ const char * const kPythonLocation = "/python";
 const char * const kCustomLocation = "/custom";
 const char * const kSessionLocation = "/session";
 
+// maximum number of help search results to show
+const std::size_t kMaxSearchMatches = 500;
+
 // flag indicating whether we should send headers to custom handlers
 // (only do this for 2.13 or higher)
 bool s_provideHeaders = false;
@@ -282,9 +293,8 @@ void setDynamicContentResponse(const std::string& content,
                                const Filter& filter,
                                http::Response* pResponse)
 {
-   // always attempt gzip
-   if (request.acceptsEncoding(http::kGzipEncoding))
-      pResponse->setContentEncoding(http::kGzipEncoding);
+   // always attempt compression
+   pResponse->negotiateContentEncoding(request);
    
    // if the response doesn't already have Cache-Control then send an eTag back
    // and force revalidation (not for desktop mode since it doesn't handle
@@ -541,6 +551,9 @@ SEXP headersBuffer(const http::Request& request, r::sexp::Protect* pProtect)
 
 typedef boost::function<SEXP(const std::string&)> HandlerSource;
 
+// called with the html of pages rendered by httpd (before filtering)
+typedef boost::function<void(const std::string&)> RenderedHtmlHandler;
+
 
 // NOTE: this emulates the calling portion of process_request in Rhttpd.c,
 // to do this it uses low-level R functions and therefore must be wrapped
@@ -600,6 +613,44 @@ SEXP callHandler(const std::string& path,
    return resultSEXP;
 }
 
+// the html of a page dynamically rendered by httpd (file and non-html
+// payloads, redirects and errors aren't pages we can cache)
+bool httpdRenderedHtml(SEXP httpdSEXP, std::string* pHtml)
+{
+   if (TYPEOF(httpdSEXP) != VECSXP || LENGTH(httpdSEXP) == 0)
+      return false;
+
+   if (LENGTH(httpdSEXP) > 1)
+   {
+      SEXP ctSEXP = VECTOR_ELT(httpdSEXP, 1);
+      if (TYPEOF(ctSEXP) == STRSXP && LENGTH(ctSEXP) > 0 &&
+          std::strcmp(CHAR(STRING_ELT(ctSEXP, 0)), "text/html") != 0)
+      {
+         return false;
+      }
+   }
+
+   if (LENGTH(httpdSEXP) > 3 &&
+       r::sexp::asInteger(VECTOR_ELT(httpdSEXP, 3)) != http::status::Ok)
+   {
+      return false;
+   }
+
+   SEXP payloadSEXP = VECTOR_ELT(httpdSEXP, 0);
+   if (TYPEOF(payloadSEXP) != STRSXP || LENGTH(payloadSEXP) != 1)
+      return false;
+
+   SEXP namesSEXP = r::sexp::getNames(httpdSEXP);
+   if (TYPEOF(namesSEXP) == STRSXP && LENGTH(namesSEXP) > 0 &&
+       !std::strcmp(CHAR(STRING_ELT(namesSEXP, 0)), "file"))
+   {
+      return false;
+   }
+
+   *pHtml = r::sexp::asString(STRING_ELT(payloadSEXP, 0));
+   return true;
+}
+
 r_util::RPackageInfo packageInfoForRd(const FilePath& rdFilePath)
 {
    FilePath packageDir = rdFilePath.parent().parent();
@@ -685,7 +736,9 @@ void handleHttpdRequest(const std::string& location,
                         const HandlerSource& handlerSource,
                         const http::Request& request, 
                         const Filter& filter,
-                        http::Response* pResponse)
+                        http::Response* pResponse,
+                        const RenderedHtmlHandler& onRendered =
+                                                      RenderedHtmlHandler())
 {
    // get the requested path
    std::string path = http::util::pathAfterPrefix(request, location);
@@ -772,6 +825,10 @@ void handleHttpdRequest(const std::string& location,
    // content returned from httpd
    else if (TYPEOF(httpdSEXP) == VECSXP && LENGTH(httpdSEXP) > 0)
    {
+      std::string html;
+      if (onRendered && httpdRenderedHtml(httpdSEXP, &html))
+         onRendered(html);
+
       handleHttpdResult(httpdSEXP, request, filter, pResponse);
    }
    
@@ -856,14 +913,15 @@ void handleSessionRequest(const http::Request& request, http::Response* pRespons
    // form a path to the temporary file
    FilePath tempFilePath = r::session::utils::tempDir().childPath(uri);
 
-   // return the file
+   // return the file (media shown in the viewer is seeked by range)
    pResponse->setCacheWithRevalidationHeaders();
-   if (tempFilePath.mimeContentType() == "text/html")
+   if (!request.headerValue("Range").empty())
    {
-      pResponse->setCacheableFile(tempFilePath, request);
+      pResponse->setRangeableFile(tempFilePath, request);
    }
    else
    {
+      pResponse->addHeader("Accept-Ranges", "bytes");
       pResponse->setCacheableFile(tempFilePath, request);
    }
 }
@@ -899,16 +957,230 @@ void handlePythonHelpRequest(const http::Request& request,
    
 }
 
+// the ShowHelp event will result in the Help pane requesting the specified
+// help url. we handle this request directly by calling the R httpd function
+// to dynamically form the correct http response
+SEXP httpdHandler(const std::string&)
+{
+   return r::sexp::findFunction("httpd", "tools");
+}
+
+// record the installed version of a package so its pages can be cached
+// (returns false if the package isn't installed)
+bool ensureCachePackage(const std::string& package)
+{
+   if (cache::hasPackage(package))
+      return true;
+
+   std::string packageDir;
+   Error error = r::exec::RFunction("find.package")
+         .addParam(package)
+         .addParam("quiet", true)
+         .call(&packageDir);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+   if (packageDir.empty())
+      return false;
+
+   cache::setPackage(package, FilePath(packageDir));
+   return true;
+}
+
+void setCachedPageResponse(const std::string& html,
+                           const http::Request& request,
+                           http::Response* pResponse)
+{
+   pResponse->setContentType("text/html");
+   setDynamicContentResponse(html,
+                             request,
+                             HelpContentsFilter(request),
+                             pResponse);
+}
+
+// serve help pages which are already cached from the connection listener
+// thread, so they display even while R is busy
+bool handleCachedHelpRequest(const http::Request& request,
+                             http::Response* pResponse)
+{
+   std::string package, topic, html;
+   std::string path = http::util::pathAfterPrefix(request, kHelpLocation);
+   if (!cache::parseTopicPath(path, &package, &topic) ||
+       !cache::lookup(package, topic, &html))
+   {
+      return false;
+   }
+
+   setCachedPageResponse(html, request, pResponse);
+   return true;
+}
+
+// render the results of a search of the help index (mirroring the page
+// produced by R's help.search)
+void handleHelpSearchRequest(const http::Request& request,
+                             http::Response* pResponse)
+{
+   std::string pattern = request.queryParamValue("pattern");
+
+   std::vector<HelpTopicMatch> matches;
+   searchHelpIndex(pattern, kMaxSearchMatches, &matches);
+
+   std::ostringstream ostr;
+   ostr << "<!DOCTYPE html PUBLIC \"-//W3C//DTD HTML 4.01 Transitional//EN\">\n"
+        << "<html><head><title>R: Search Results</title>\n"
+        << "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\">\n"
+        << "<link rel=\"stylesheet\" type=\"text/css\" href=\"/doc/html/R.css\">\n"
+        << "</head><body>\n"
+        << "<h1>Search Results</h1>\n"
+        << "<p>The search string was <b>\""
+        << string_utils::htmlEscape(pattern) << "\"</b></p>\n"
+        << "<hr>\n";
+
+   if (matches.empty())
+   {
+      ostr << "<p>No results found</p>\n";
+   }
+   else
+   {
+      ostr << "<dl>\n";
+      BOOST_FOREACH(const HelpTopicMatch& match, matches)
+      {
+         std::string href = "/library/" +
+                            http::util::urlEncode(match.package) +
+                            "/html/" +
+                            http::util::urlEncode(match.topic) +
+                            ".html";
+         ostr << "<dt><a href=\""
+              << string_utils::htmlEscape(href, true) << "\">"
+              << string_utils::htmlEscape(match.package + "::" + match.topic)
+              << "</a></dt>\n"
+              << "<dd>" << string_utils::htmlEscape(match.title) << "</dd>\n";
+      }
+      ostr << "</dl>\n";
+   }
+   ostr << "</body></html>\n";
+
+   pResponse->setContentType("text/html");
+   pResponse->setNoCacheHeaders();
+   pResponse->setBody(ostr.str(), HelpContentsFilter(request));
+}
+
 // the ShowHelp event will result in the Help pane requesting the specified
 // help url. we handle this request directly by calling the R httpd function
 // to dynamically form the correct http response
 void handleHelpRequest(const http::Request& request, http::Response* pResponse)
 {
+   // searches of the help index are answered natively
+   std::string path = http::util::pathAfterPrefix(request, kHelpLocation);
+   if (path == "/search")
+   {
+      handleHelpSearchRequest(request, pResponse);
+      return;
+   }
+
+   // topic pages are served from (and rendered into) the help cache
+   RenderedHtmlHandler onRendered;
+   std::string package, topic;
+   if (cache::parseTopicPath(path, &package, &topic) &&
+       ensureCachePackage(package))
+   {
+      std::string html;
+      if (cache::lookup(package, topic, &html))
+      {
+         setCachedPageResponse(html, request, pResponse);
+         return;
+      }
+
+      onRendered = boost::bind(cache::store, package, topic, _1);
+   }
+
    handleHttpdRequest(kHelpLocation,
-                      boost::bind(r::sexp::findFunction, "httpd", "tools"),
+                      httpdHandler,
                       request,
                       HelpContentsFilter(request),
-                      pResponse);
+                      pResponse,
+                      onRendered);
+}
+
+// renders the help of installed packages into the site cache when idle
+class Prerenderer : boost::noncopyable
+{
+public:
+   Prerenderer()
+   {
+      std::vector<std::string> packages;
+      Error error = r::exec::RFunction(".packages")
+            .addParam("all.available", true)
+            .call(&packages);
+      if (error)
+         LOG_ERROR(error);
+      packages_.assign(packages.begin(), packages.end());
+   }
+
+   bool work()
+   {
+      while (topics_.empty())
+      {
+         if (packages_.empty())
+            return false;
+
+         package_ = packages_.front();
+         packages_.pop_front();
+         if (!ensureCachePackage(package_))
+            continue;
+
+         std::vector<std::string> topics;
+         Error error = r::exec::RFunction(".rs.helpTopicsForPackage")
+               .addParam(package_)
+               .call(&topics);
+         if (error)
+            LOG_ERROR(error);
+         topics_.assign(topics.begin(), topics.end());
+      }
+
+      std::string topic = topics_.front();
+      topics_.pop_front();
+
+      std::string html;
+      if (cache::lookup(package_, topic, &html))
+         return true;
+
+      std::string path = "/library/" + package_ + "/html/" + topic + ".html";
+      http::Request request;
+      r::sexp::Protect rp;
+      SEXP httpdSEXP;
+      Error error = r::exec::executeSafely<SEXP>(
+            boost::bind(callHandler,
+                        path,
+                        boost::cref(request),
+                        httpdHandler,
+                        &rp),
+            &httpdSEXP);
+      if (error)
+         LOG_ERROR(error);
+      else if (httpdRenderedHtml(httpdSEXP, &html))
+         cache::store(package_, topic, html);
+
+      return true;
+   }
+
+private:
+   std::deque<std::string> packages_;
+   std::string package_;
+   std::deque<std::string> topics_;
+};
+
+void prerenderHelp()
+{
+   boost::shared_ptr<Prerenderer> pPrerenderer(new Prerenderer());
+   module_context::scheduleIncrementalWork(
+            boost::posix_time::milliseconds(20),
+            boost::bind(&Prerenderer::work, pPrerenderer),
+            true,
+            WorkPriorityLow,
+            "help_prerender");
 }
 
 SEXP rs_previewRd(SEXP rdFileSEXP)
@@ -931,6 +1203,12 @@ SEXP rs_showPythonHelp(SEXP codeSEXP)
    return R_NilValue;
 }
 
+SEXP rs_helpIndexReady()
+{
+   r::sexp::Protect rProtect;
+   return r::sexp::create(helpIndexReady(), &rProtect);
+}
+
 } // anonymous namespace
    
 Error initialize()
@@ -940,6 +1218,7 @@ Error initialize()
 
    RS_REGISTER_CALL_METHOD(rs_previewRd, 1);
    RS_REGISTER_CALL_METHOD(rs_showPythonHelp, 1);
+   RS_REGISTER_CALL_METHOD(rs_helpIndexReady, 0);
 
    using boost::bind;
    using core::http::UriHandler;
@@ -950,8 +1229,11 @@ Error initialize()
       (bind(registerRBrowseUrlHandler, handleLocalHttpUrl))
       (bind(registerRBrowseFileHandler, handleRShowDocFile))
       (bind(registerUriHandler, kHelpLocation, handleHelpRequest))
+      (bind(registerBackgroundUriHandler, kHelpLocation, handleCachedHelpRequest))
       (bind(registerUriHandler, kPythonLocation, handlePythonHelpRequest))
-      (bind(sourceModuleRFile, "SessionHelp.R"));
+      (bind(sourceModuleRFile, "SessionHelp.R"))
+      (cache::initialize)
+      (initializeHelpIndex);
    Error error = initBlock.execute();
    if (error)
       return error;
@@ -964,6 +1246,10 @@ Error initialize()
    if (error)
       LOG_ERROR(error);
 
+   // render the help of installed packages into the site cache
+   if (options().helpPrerender() && !cache::siteCacheDir().empty())
+      prerenderHelp();
+
    // handle /custom and /session urls internally if necessary (always in
    // server mode, in desktop mode if the internal http server can't
    // bind to a port)
@@ -0,0 +1,291 @@
+/*
+ * SessionHelpCache.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionHelpCache.hpp"
+
+#include <ctime>
+#include <map>
+
+#include <boost/regex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+#include <core/MemoryAccounting.hpp>
+#include <core/RegexUtils.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/Thread.hpp>
+#include <core/system/System.hpp>
+#include <core/r_util/RPackageInfo.hpp>
+
+#include <session/SessionOptions.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules { 
+namespace help {
+namespace cache {
+
+namespace {
+
+struct PackageEntry
+{
+   PackageEntry() : descriptionWriteTime(0) {}
+
+   std::string version;
+   FilePath descriptionPath;
+   std::time_t descriptionWriteTime;
+};
+
+boost::mutex s_mutex;
+std::map<std::string, PackageEntry> s_packages;
+boost::unordered_map<std::string, std::string> s_pages;
+std::size_t s_pageBytes = 0;
+FilePath s_siteCacheDir;
+
+std::string pageKey(const std::string& package,
+                    const std::string& version,
+                    const std::string& topic)
+{
+   return package + "/" + version + "/" + topic;
+}
+
+FilePath sitePagePath(const std::string& package,
+                      const std::string& version,
+                      const std::string& topic)
+{
+   return s_siteCacheDir.complete(pageKey(package, version, topic) + ".html");
+}
+
+// the version of the package if it's still the one installed
+bool currentVersion(const std::string& package, std::string* pVersion)
+{
+   PackageEntry entry;
+   LOCK_MUTEX(s_mutex)
+   {
+      std::map<std::string, PackageEntry>::const_iterator it =
+                                                   s_packages.find(package);
+      if (it == s_packages.end())
+         return false;
+      entry = it->second;
+   }
+   END_LOCK_MUTEX
+
+   // a reinstalled (or removed) package has a new (or no) DESCRIPTION
+   if (!entry.descriptionPath.exists() ||
+       entry.descriptionPath.lastWriteTime() != entry.descriptionWriteTime)
+   {
+      return false;
+   }
+
+   *pVersion = entry.version;
+   return true;
+}
+
+void addPage(const std::string& key, const std::string& html)
+{
+   LOCK_MUTEX(s_mutex)
+   {
+      std::string& page = s_pages[key];
+      s_pageBytes -= page.size();
+      page = html;
+      s_pageBytes += page.size();
+   }
+   END_LOCK_MUTEX
+}
+
+Error writeSitePage(const FilePath& pagePath, const std::string& html)
+{
+   Error error = pagePath.parent().ensureDirectory();
+   if (error)
+      return error;
+
+   // write to a temporary file and move it into place so other sessions
+   // never see a partially written page
+   FilePath tempPath = pagePath.parent().complete(
+                     "." + pagePath.filename() + "." +
+                     safe_convert::numberToString(core::system::currentProcessId()));
+   error = writeStringToFile(tempPath, html);
+   if (error)
+      return error;
+
+   error = tempPath.move(pagePath);
+   if (error)
+      tempPath.removeIfExists();
+   return error;
+}
+
+memory_accounting::Usage cacheUsage()
+{
+   LOCK_MUTEX(s_mutex)
+   {
+      return memory_accounting::Usage(s_pageBytes, s_pages.size());
+   }
+   END_LOCK_MUTEX
+
+   return memory_accounting::Usage();
+}
+
+void evictPages(std::size_t /*budget*/)
+{
+   // pages are cheap to re-read from the site cache (or re-render), so
+   // rather than tracking recency just start over
+   LOCK_MUTEX(s_mutex)
+   {
+      boost::unordered_map<std::string, std::string>().swap(s_pages);
+      s_pageBytes = 0;
+   }
+   END_LOCK_MUTEX
+}
+
+} // anonymous namespace
+
+bool parseTopicPath(const std::string& path,
+                    std::string* pPackage,
+                    std::string* pTopic)
+{
+   // package and topic are used within file paths so restrict them to the
+   // characters used by package names and Rd file names
+   static const boost::regex reTopic(
+            "^/library/([A-Za-z][A-Za-z0-9.]*)/html/([A-Za-z0-9_+.-]+)\\.html$");
+   boost::smatch match;
+   if (!regex_utils::match(path, match, reTopic))
+      return false;
+
+   *pPackage = match[1];
+   *pTopic = match[2];
+   return true;
+}
+
+bool hasPackage(const std::string& package)
+{
+   std::string version;
+   return currentVersion(package, &version);
+}
+
+void setPackage(const std::string& package, const FilePath& packageDir)
+{
+   r_util::RPackageInfo pkgInfo;
+   Error error = pkgInfo.read(packageDir);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   PackageEntry entry;
+   entry.version = pkgInfo.version();
+   entry.descriptionPath = packageDir.childPath("DESCRIPTION");
+   entry.descriptionWriteTime = entry.descriptionPath.lastWriteTime();
+
+   LOCK_MUTEX(s_mutex)
+   {
+      s_packages[package] = entry;
+   }
+   END_LOCK_MUTEX
+}
+
+bool lookup(const std::string& package,
+            const std::string& topic,
+            std::string* pHtml)
+{
+   std::string version;
+   if (!currentVersion(package, &version))
+      return false;
+
+   std::string key = pageKey(package, version, topic);
+   LOCK_MUTEX(s_mutex)
+   {
+      boost::unordered_map<std::string, std::string>::const_iterator it =
+                                                         s_pages.find(key);
+      if (it != s_pages.end())
+      {
+         *pHtml = it->second;
+         return true;
+      }
+   }
+   END_LOCK_MUTEX
+
+   if (s_siteCacheDir.empty())
+      return false;
+
+   FilePath pagePath = sitePagePath(package, version, topic);
+   if (!pagePath.exists())
+      return false;
+
+   Error error = readStringFromFile(pagePath, pHtml);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+
+   addPage(key, *pHtml);
+   return true;
+}
+
+void store(const std::string& package,
+           const std::string& topic,
+           const std::string& html)
+{
+   std::string version;
+   if (!currentVersion(package, &version))
+      return;
+
+   addPage(pageKey(package, version, topic), html);
+
+   if (!s_siteCacheDir.empty())
+   {
+      FilePath pagePath = sitePagePath(package, version, topic);
+      if (!pagePath.exists())
+      {
+         Error error = writeSitePage(pagePath, html);
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+}
+
+FilePath siteCacheDir()
+{
+   return s_siteCacheDir;
+}
+
+Error initialize()
+{
+   if (!session::options().helpCacheDir().empty())
+   {
+      s_siteCacheDir = FilePath(session::options().helpCacheDir());
+      Error error = s_siteCacheDir.ensureDirectory();
+      if (error)
+      {
+         LOG_ERROR(error);
+         s_siteCacheDir = FilePath();
+      }
+   }
+
+   memory_accounting::registerSubsystem("help", cacheUsage, evictPages);
+   return Success();
+}
+
+} // namespace cache
+} // namespace help
+} // namespace modules
+} // namespace session
+} // namespace rstudio
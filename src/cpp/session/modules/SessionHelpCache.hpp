@@ -0,0 +1,69 @@
+/*
+ * SessionHelpCache.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_SESSION_HELP_CACHE_HPP
+#define SESSION_SESSION_HELP_CACHE_HPP
+
+#include <string>
+
+namespace rstudio {
+
+namespace core {
+   class Error;
+   class FilePath;
+}
+
+namespace session {
+namespace modules {      
+namespace help {
+namespace cache {
+
+// Rendered help pages, keyed by package, package version and topic. Pages
+// are held in memory and, if a site-level cache directory is configured,
+// on disk where they are shared by every session. All functions are thread
+// safe (pages may be served from the connection listener thread).
+
+// the package and topic of a help page path (e.g. /library/stats/html/lm.html)
+bool parseTopicPath(const std::string& path,
+                    std::string* pPackage,
+                    std::string* pTopic);
+
+// is the installed version of the package known (and still installed)
+bool hasPackage(const std::string& package);
+
+// record the installed version of a package (read from its DESCRIPTION)
+void setPackage(const std::string& package, const core::FilePath& packageDir);
+
+bool lookup(const std::string& package,
+            const std::string& topic,
+            std::string* pHtml);
+
+// store a page for a package whose version has been recorded with setPackage
+void store(const std::string& package,
+           const std::string& topic,
+           const std::string& html);
+
+// the site-level cache directory (empty if there isn't one)
+core::FilePath siteCacheDir();
+
+core::Error initialize();
+   
+} // namespace cache
+} // namespace help
+} // namepace handlers
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_SESSION_HELP_CACHE_HPP
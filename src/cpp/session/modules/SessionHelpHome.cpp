@@ -47,18 +47,18 @@ void handleHelpHomeRequest(const core::http::Request& request,
 
       std::map<std::string,std::string> variables;
       variables["js_callbacks"] = jsCallbacks;
-      text::TemplateFilter templateFilter(variables);
       pResponse->setNoCacheHeaders();
-      pResponse->setFile(helpResPath.childPath("index.htm"),
-                         request,
-                         templateFilter);
+      text::setTemplateResponse(helpResPath.childPath("index.htm"),
+                                variables,
+                                request,
+                                pResponse);
 
    }
    // otherwise it's just a file reference
    else
    {
       FilePath filePath = helpResPath.complete(path);
-      pResponse->setCacheableFile(filePath, request);
+      pResponse->setResourceFile(filePath, request);
    }
 }
 
@@ -0,0 +1,228 @@
+/*
+ * SessionHelpIndex.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionHelpIndex.hpp"
+
+#include <ctime>
+#include <map>
+#include <set>
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/Log.hpp>
+#include <core/text/WordIndex.hpp>
+
+#include <r/RExec.hpp>
+#include <r/RSexp.hpp>
+
+#include <session/SessionPackageProvidedExtension.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace help {
+
+namespace {
+
+// weights of the fields of help topics
+const int kAliasWeight = 8;
+const int kTitleWeight = 4;
+const int kKeywordWeight = 2;
+const int kDescriptionWeight = 1;
+
+struct PackageEntry
+{
+   PackageEntry() : writeTime(0) {}
+
+   FilePath indexPath;
+   std::time_t writeTime;
+   std::map<std::string, std::string> titles;
+};
+
+text::WordIndex s_index;
+std::map<std::string, PackageEntry> s_packages;
+bool s_ready = false;
+
+Error readPackageTopics(const FilePath& packageDir,
+                        std::vector<std::string>* pTopics,
+                        std::vector<std::vector<text::WordIndex::Field> >* pFields)
+{
+   r::sexp::Protect rp;
+   SEXP topicsSEXP;
+   Error error = r::exec::RFunction(".rs.helpIndexEntries")
+         .addParam(packageDir.absolutePath())
+         .call(&topicsSEXP, &rp);
+   if (error)
+      return error;
+
+   std::vector<std::string> titles, aliases, keywords, descriptions;
+   error = r::sexp::getNamedListElement(topicsSEXP, "topic", pTopics);
+   if (!error)
+      error = r::sexp::getNamedListElement(topicsSEXP, "title", &titles);
+   if (!error)
+      error = r::sexp::getNamedListElement(topicsSEXP, "aliases", &aliases);
+   if (!error)
+      error = r::sexp::getNamedListElement(topicsSEXP, "keywords", &keywords);
+   if (!error)
+      error = r::sexp::getNamedListElement(topicsSEXP,
+                                           "description",
+                                           &descriptions);
+   if (error)
+      return error;
+
+   std::size_t n = pTopics->size();
+   if (titles.size() != n || aliases.size() != n ||
+       keywords.size() != n || descriptions.size() != n)
+   {
+      return systemError(boost::system::errc::invalid_argument,
+                         ERROR_LOCATION);
+   }
+
+   pFields->resize(n);
+   for (std::size_t i = 0; i < n; i++)
+   {
+      std::vector<text::WordIndex::Field>& fields = (*pFields)[i];
+      fields.push_back(text::WordIndex::Field(aliases[i], kAliasWeight));
+      fields.push_back(text::WordIndex::Field(titles[i], kTitleWeight));
+      fields.push_back(text::WordIndex::Field(keywords[i], kKeywordWeight));
+      fields.push_back(text::WordIndex::Field(descriptions[i],
+                                              kDescriptionWeight));
+   }
+
+   return Success();
+}
+
+class Worker : public ppe::Worker
+{
+public:
+   Worker() : ppe::Worker("Meta/Rd.rds") {}
+
+private:
+   void onIndexingStarted()
+   {
+      indexed_.clear();
+   }
+
+   void onWork(const std::string& pkgName, const FilePath& resourcePath)
+   {
+      // packages found earlier on the library paths mask later ones
+      if (!indexed_.insert(pkgName).second)
+         return;
+
+      // packages which haven't been reinstalled needn't be indexed again
+      std::time_t writeTime = resourcePath.lastWriteTime();
+      std::map<std::string, PackageEntry>::const_iterator it =
+                                                   s_packages.find(pkgName);
+      if (it != s_packages.end() &&
+          it->second.indexPath == resourcePath &&
+          it->second.writeTime == writeTime)
+      {
+         return;
+      }
+
+      s_index.removeGroup(pkgName);
+      s_packages.erase(pkgName);
+
+      std::vector<std::string> topics;
+      std::vector<std::vector<text::WordIndex::Field> > fields;
+      Error error = readPackageTopics(resourcePath.parent().parent(),
+                                      &topics,
+                                      &fields);
+      if (error)
+      {
+         error.addProperty("package", pkgName);
+         LOG_ERROR(error);
+         return;
+      }
+
+      PackageEntry& entry = s_packages[pkgName];
+      entry.indexPath = resourcePath;
+      entry.writeTime = writeTime;
+      for (std::size_t i = 0; i < topics.size(); i++)
+      {
+         entry.titles[topics[i]] = fields[i][1].first;
+         s_index.add(pkgName, topics[i], fields[i]);
+      }
+   }
+
+   void onIndexingCompleted(json::Object* pPayload)
+   {
+      // drop packages which have been removed
+      std::map<std::string, PackageEntry>::iterator it = s_packages.begin();
+      while (it != s_packages.end())
+      {
+         if (indexed_.count(it->first))
+         {
+            ++it;
+         }
+         else
+         {
+            s_index.removeGroup(it->first);
+            s_packages.erase(it++);
+         }
+      }
+
+      s_ready = true;
+   }
+
+   std::set<std::string> indexed_;
+};
+
+boost::shared_ptr<Worker>& worker()
+{
+   static boost::shared_ptr<Worker> instance(new Worker);
+   return instance;
+}
+
+} // anonymous namespace
+
+bool helpIndexReady()
+{
+   return s_ready;
+}
+
+void searchHelpIndex(const std::string& query,
+                     std::size_t maxMatches,
+                     std::vector<HelpTopicMatch>* pMatches)
+{
+   pMatches->clear();
+
+   std::vector<text::WordIndex::Match> matches;
+   s_index.search(query, maxMatches, &matches);
+   BOOST_FOREACH(const text::WordIndex::Match& match, matches)
+   {
+      HelpTopicMatch topicMatch;
+      topicMatch.package = match.group;
+      topicMatch.topic = match.key;
+      topicMatch.title = s_packages[match.group].titles[match.key];
+      pMatches->push_back(topicMatch);
+   }
+}
+
+Error initializeHelpIndex()
+{
+   ppe::indexer().addWorker(worker());
+   return Success();
+}
+
+} // namespace help
+} // namespace modules
+} // namespace session
+} // namespace rstudio
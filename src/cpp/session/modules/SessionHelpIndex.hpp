@@ -0,0 +1,58 @@
+/*
+ * SessionHelpIndex.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_SESSION_HELP_INDEX_HPP
+#define SESSION_SESSION_HELP_INDEX_HPP
+
+#include <string>
+#include <vector>
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace help {
+
+struct HelpTopicMatch
+{
+   std::string package;
+   std::string topic;
+   std::string title;
+};
+
+// has the help of the installed packages been indexed (the index is built
+// along with the other package provided extension indexes, and refreshed
+// as packages are installed and removed)
+bool helpIndexReady();
+
+// search the titles, aliases, keywords, concepts and descriptions of the
+// installed packages' help topics
+void searchHelpIndex(const std::string& query,
+                     std::size_t maxMatches,
+                     std::vector<HelpTopicMatch>* pMatches);
+
+core::Error initializeHelpIndex();
+
+} // namespace help
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_SESSION_HELP_INDEX_HPP
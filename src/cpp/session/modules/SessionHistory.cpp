@@ -20,6 +20,7 @@
 #include <vector>
 #include <algorithm>
 
+#include <boost/foreach.hpp>
 #include <boost/utility.hpp>
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
@@ -32,6 +33,7 @@
 #include <core/Exec.hpp>
 #include <core/FilePath.hpp>
 #include <core/DateTime.hpp>
+#include <core/MemoryAccounting.hpp>
 
 #include <core/json/JsonRpc.hpp>
 
@@ -42,6 +44,7 @@
 #include <session/SessionModuleContext.hpp>
 
 #include "SessionHistoryArchive.hpp"
+#include "../SessionConsoleInput.hpp"
 
 using namespace rstudio::core;
 
@@ -102,6 +105,13 @@ Error setJsonResultFromHistory(int startIndex,
    return Success();
 }
    
+void allPositions(std::size_t count, std::vector<std::size_t>* pPositions)
+{
+   pPositions->reserve(count);
+   for (std::size_t i = 0; i < count; i++)
+      pPositions->push_back(i);
+}
+
 bool matches(const HistoryEntry& entry,
              const std::vector<std::string>& searchTerms)
 {   
@@ -318,12 +328,16 @@ Error searchHistoryArchive(const json::JsonRpcRequest& request,
    boost::tokenizer<boost::char_separator<char> > tok(query, sep);
    std::copy(tok.begin(), tok.end(), std::back_inserter(searchTerms));
    
-   // examine the items in the history for matches
+   // examine the items in the history which could match (most recent first)
    const std::vector<HistoryEntry>& allEntries = historyArchive().entries();
+   std::vector<std::size_t> candidates;
+   if (!historyArchive().candidates(searchTerms, &candidates))
+      allPositions(allEntries.size(), &candidates);
+
    std::vector<HistoryEntry> matchingEntries;
-   for (std::vector<HistoryEntry>::const_reverse_iterator 
-            it = allEntries.rbegin();
-            it != allEntries.rend();
+   for (std::vector<std::size_t>::const_reverse_iterator
+            it = candidates.rbegin();
+            it != candidates.rend();
             ++it)
    {
       // check limit
@@ -331,10 +345,11 @@ Error searchHistoryArchive(const json::JsonRpcRequest& request,
          break;
 
       // look for match
-      if (matches(*it, searchTerms))
+      const HistoryEntry& entry = allEntries[*it];
+      if (matches(entry, searchTerms))
       {
          // add entry
-         matchingEntries.push_back(*it);
+         matchingEntries.push_back(entry);
       }
    }
 
@@ -360,13 +375,20 @@ Error searchHistoryArchiveByPrefix(const json::JsonRpcRequest& request,
    // trim the prefix
    boost::algorithm::trim(prefix);
    
-   // examine the items in the history for matches
+   // examine the items in the history which could match (most recent first)
    const std::vector<HistoryEntry>& allEntries = historyArchive().entries();
+   std::vector<std::size_t> candidates;
+   if (!historyArchive().candidates(std::vector<std::string>(1, prefix),
+                                    &candidates))
+   {
+      allPositions(allEntries.size(), &candidates);
+   }
+
    std::set<std::string> matchedCommands;
    std::vector<HistoryEntry> matchingEntries;
-   for (std::vector<HistoryEntry>::const_reverse_iterator 
-        it = allEntries.rbegin();
-        it != allEntries.rend();
+   for (std::vector<std::size_t>::const_reverse_iterator
+        it = candidates.rbegin();
+        it != candidates.rend();
         ++it)
    {
       // check limit
@@ -374,12 +396,13 @@ Error searchHistoryArchiveByPrefix(const json::JsonRpcRequest& request,
          break;
       
       // look for match 
-      if (boost::algorithm::starts_with(it->command, prefix))
+      const HistoryEntry& entry = allEntries[*it];
+      if (boost::algorithm::starts_with(entry.command, prefix))
       {
-         if (!uniqueOnly || (matchedCommands.count(it->command) == 0))
+         if (!uniqueOnly || (matchedCommands.count(entry.command) == 0))
          {
-            matchingEntries.push_back(*it);
-            matchedCommands.insert(it->command);
+            matchingEntries.push_back(entry);
+            matchedCommands.insert(entry.command);
          }
       }
    }
@@ -391,21 +414,55 @@ Error searchHistoryArchiveByPrefix(const json::JsonRpcRequest& request,
    return Success();
 }
 
-void onHistoryAdd(const std::string& command)
-{   
-   // add command to history archive
-   Error error = historyArchive().add(command);
+// commands added to the history which are yet to be archived and sent to
+// the client. commands are held while more console input is pending (e.g.
+// for the rest of a multi-line paste) so that a run of them is archived and
+// sent together
+std::vector<std::string> s_pendingCommands;
+
+void flushPendingCommands()
+{
+   if (s_pendingCommands.empty())
+      return;
+
+   // add commands to history archive
+   Error error = historyArchive().add(s_pendingCommands);
    if (error)
       LOG_ERROR(error);
 
-   // fire event
-   int entryIndex = r::session::consoleHistory().size() - 1;
+   // fire event (the commands are the last in the history)
+   int historySize = r::session::consoleHistory().size();
+   int entryIndex = std::max(
+            historySize - static_cast<int>(s_pendingCommands.size()), 0);
    std::vector<HistoryEntry> entries;
-   entries.push_back(HistoryEntry(entryIndex, 0, command));
+   BOOST_FOREACH(const std::string& command, s_pendingCommands)
+   {
+      entries.push_back(HistoryEntry(entryIndex++, 0, command));
+   }
    json::Object entriesJson;
    historyEntriesAsJson(entries, &entriesJson);
    ClientEvent event(client_events::kHistoryEntriesAdded, entriesJson);
    module_context::enqueClientEvent(event);
+
+   s_pendingCommands.clear();
+}
+
+void onHistoryAdd(const std::string& command)
+{   
+   s_pendingCommands.push_back(command);
+   if (!console_input::inputPending())
+      flushPendingCommands();
+}
+
+void onConsolePrompt(const std::string&)
+{
+   // input which was pending may have been discarded (e.g. on interrupt)
+   flushPendingCommands();
+}
+
+void onShutdown(bool)
+{
+   flushPendingCommands();
 }
 
 SEXP rs_timestamp(SEXP stampSEXP) {
@@ -415,6 +472,17 @@ SEXP rs_timestamp(SEXP stampSEXP) {
    return R_NilValue;
 }
 
+core::memory_accounting::Usage archiveUsage()
+{
+   return core::memory_accounting::Usage(historyArchive().memoryUsage(),
+                                         historyArchive().cachedEntryCount());
+}
+
+void evictArchive(std::size_t /*budget*/)
+{
+   historyArchive().releaseCache();
+}
+
 } // anonymous namespace
    
    
@@ -425,6 +493,8 @@ Error initialize()
    
    // connect to console history add event
    r::session::consoleHistory().connectOnAdd(onHistoryAdd);
+   module_context::events().onConsolePrompt.connect(onConsolePrompt);
+   module_context::events().onShutdown.connect(onShutdown);
 
    // register timestamp function
    R_CallMethodDef methodDef;
@@ -433,6 +503,11 @@ Error initialize()
    methodDef.numArgs = 1;
    r::routines::addCallMethod(methodDef);   
 
+   // account for the in-memory copy of the history archive
+   core::memory_accounting::registerSubsystem("history",
+                                              archiveUsage,
+                                              evictArchive);
+
    // install handlers
    using boost::bind;
    using namespace session::module_context;
@@ -15,8 +15,13 @@
 
 #include "SessionHistoryArchive.hpp"
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
 #include <core/Error.hpp>
 #include <core/Log.hpp>
 #include <core/FilePath.hpp>
@@ -50,7 +55,13 @@ FilePath historyDatabaseRotatedFilePath()
    return module_context::userScratchPath().complete(kHistoryDatabase ".1");
 }
 
-void rotateHistoryDatabase()
+uintmax_t fileSize(const FilePath& filePath)
+{
+   return filePath.exists() ? filePath.size() : 0;
+}
+
+// returns true if the database was rotated
+bool rotateHistoryDatabase()
 {
    FilePath historyDB = historyDatabaseFilePath();
    if (historyDB.exists() && (historyDB.size() > kHistoryMaxBytes))
@@ -61,8 +72,57 @@ void rotateHistoryDatabase()
       rotatedHistoryDB.removeIfExists();
 
       // now rotate the file
-      historyDB.move(rotatedHistoryDB);
+      Error error = historyDB.move(rotatedHistoryDB);
+      return !error;
+   }
+
+   return false;
+}
+
+// read the complete lines of a history file which follow the passed offset,
+// advancing the offset past them. a trailing line without a newline (i.e.
+// one which may still be being written) is left for the next read
+Error readHistoryLines(const FilePath& filePath,
+                       uintmax_t* pOffset,
+                       std::vector<std::string>* pLines)
+{
+   if (!filePath.exists())
+      return Success();
+
+   boost::shared_ptr<std::istream> pIfs;
+   Error error = filePath.open_r(&pIfs);
+   if (error)
+      return error;
+
+   std::string contents;
+   try
+   {
+      pIfs->seekg(*pOffset);
+      contents.assign(std::istreambuf_iterator<char>(*pIfs),
+                      std::istreambuf_iterator<char>());
+   }
+   catch(const std::exception& e)
+   {
+      Error error = systemError(boost::system::errc::io_error,
+                                ERROR_LOCATION);
+      error.addProperty("what", e.what());
+      error.addProperty("path", filePath.absolutePath());
+      return error;
    }
+
+   std::string::size_type begin = 0;
+   std::string::size_type end;
+   while ((end = contents.find('\n', begin)) != std::string::npos)
+   {
+      std::string line = boost::algorithm::trim_copy(
+                                          contents.substr(begin, end - begin));
+      if (!line.empty())
+         pLines->push_back(line);
+      begin = end + 1;
+   }
+
+   *pOffset += begin;
+   return Success();
 }
 
 void writeEntry(double timestamp, const std::string& command, std::ostream* pOS)
@@ -119,6 +179,28 @@ ReadCollectionAction readHistoryEntry(const std::string& line,
    }
 }
 
+bool smallerPostings(const std::vector<boost::uint32_t>* pLhs,
+                     const std::vector<boost::uint32_t>* pRhs)
+{
+   return pLhs->size() < pRhs->size();
+}
+
+// the distinct byte trigrams in the passed text
+template <typename Trigram>
+void trigrams(const std::string& text, std::vector<Trigram>* pTrigrams)
+{
+   for (std::size_t i = 2; i < text.size(); i++)
+   {
+      pTrigrams->push_back(
+               (static_cast<Trigram>(static_cast<unsigned char>(text[i - 2])) << 16) |
+               (static_cast<Trigram>(static_cast<unsigned char>(text[i - 1])) << 8) |
+               static_cast<Trigram>(static_cast<unsigned char>(text[i])));
+   }
+   std::sort(pTrigrams->begin(), pTrigrams->end());
+   pTrigrams->erase(std::unique(pTrigrams->begin(), pTrigrams->end()),
+                    pTrigrams->end());
+}
+
 } // anonymous namespace
 
 HistoryArchive& historyArchive()
@@ -129,78 +211,212 @@ HistoryArchive& historyArchive()
 
 Error HistoryArchive::add(const std::string& command)
 {
-   // reset the cache (since this write will invalidate the current one,
-   // no sense in keeping our cache around in memory)
-   entries_.clear();
-   entryCacheLastWriteTime_ = -1;
+   return add(std::vector<std::string>(1, command));
+}
+
+Error HistoryArchive::add(const std::vector<std::string>& commands)
+{
+   if (commands.empty())
+      return Success();
+
+   // bring the cache up to date so that a rotation can be applied to it
+   // (rather than re-reading the database afterwards)
+   if (loaded_)
+      sync();
 
    // rotate if necessary
-   rotateHistoryDatabase();
+   if (rotateHistoryDatabase() && loaded_)
+      onRotated();
 
-   // write the entry to the file
+   // write the entries to the file (they're read back into the cache, along
+   // with any entries written by other sessions, the next time entries are
+   // needed)
    std::ostringstream ostrEntry ;
    double currentTime = core::date_time::millisecondsSinceEpoch();
-   writeEntry(currentTime, command, &ostrEntry);
-   ostrEntry << std::endl;
+   BOOST_FOREACH(const std::string& command, commands)
+   {
+      writeEntry(currentTime, command, &ostrEntry);
+      ostrEntry << std::endl;
+   }
    return appendToFile(historyDatabaseFilePath(), ostrEntry.str());
 }
 
+std::size_t HistoryArchive::memoryUsage() const
+{
+   std::size_t bytes = entries_.capacity() * sizeof(HistoryEntry);
+   BOOST_FOREACH(const HistoryEntry& entry, entries_)
+   {
+      bytes += entry.command.capacity();
+   }
+
+   typedef boost::unordered_map<Trigram, std::vector<boost::uint32_t> > Postings;
+   for (Postings::const_iterator it = postings_.begin(); it != postings_.end(); ++it)
+   {
+      bytes += sizeof(*it) + it->second.capacity() * sizeof(boost::uint32_t);
+   }
+   return bytes;
+}
+
+void HistoryArchive::releaseCache() const
+{
+   std::vector<HistoryEntry>().swap(entries_);
+   boost::unordered_map<Trigram, std::vector<boost::uint32_t> >().swap(postings_);
+   loaded_ = false;
+   rotatedCount_ = 0;
+   base_ = 0;
+   rotatedFileSize_ = 0;
+   fileSize_ = 0;
+}
+
 const std::vector<HistoryEntry>& HistoryArchive::entries() const
 {
-   // calculate path to history db
-   FilePath historyDBPath = historyDatabaseFilePath();
+   sync();
+   return entries_;
+}
 
-   // if the file doesn't exist then clear the collection
-   if (!historyDBPath.exists())
+bool HistoryArchive::candidates(const std::vector<std::string>& terms,
+                                std::vector<std::size_t>* pPositions) const
+{
+   std::vector<Trigram> termTrigrams;
+   BOOST_FOREACH(const std::string& term, terms)
    {
-      entries_.clear();
+      trigrams(term, &termTrigrams);
    }
+   if (termTrigrams.empty())
+      return false;
 
-   // otherwise check for divergent lastWriteTime and read the file
-   // if our internal list isn't up to date
-   else if (historyDBPath.lastWriteTime() != entryCacheLastWriteTime_)
+   // intersect the postings, smallest first
+   std::vector<const std::vector<boost::uint32_t>*> postings;
+   BOOST_FOREACH(Trigram trigram, termTrigrams)
    {
-      entries_.clear();
+      boost::unordered_map<Trigram, std::vector<boost::uint32_t> >::const_iterator
+                                                it = postings_.find(trigram);
+      if (it == postings_.end())
+         return true;
+      postings.push_back(&it->second);
+   }
+   std::sort(postings.begin(), postings.end(), smallerPostings);
 
-      // establish a next index counter
-      int nextIndex = 0;
+   std::vector<boost::uint32_t> serials(*postings.front());
+   for (std::size_t i = 1; i < postings.size() && !serials.empty(); i++)
+   {
+      std::vector<boost::uint32_t> intersection;
+      std::set_intersection(serials.begin(), serials.end(),
+                            postings[i]->begin(), postings[i]->end(),
+                            std::back_inserter(intersection));
+      serials.swap(intersection);
+   }
 
-      // first read from rotated file if it exists
-      FilePath rotatedHistoryDBPath = historyDatabaseRotatedFilePath();
-      if (rotatedHistoryDBPath.exists())
-      {
-         Error error = readCollectionFromFile<std::vector<HistoryEntry> >(
-                           rotatedHistoryDBPath,
-                           &entries_,
-                           boost::bind(readHistoryEntry, _1, _2, &nextIndex));
-         if (error)
-            LOG_ERROR(error);
-      }
+   BOOST_FOREACH(boost::uint32_t serial, serials)
+   {
+      if (serial >= base_ && serial - base_ < entries_.size())
+         pPositions->push_back(serial - base_);
+   }
+   return true;
+}
 
+void HistoryArchive::sync() const
+{
+   if (!loaded_)
+   {
+      load();
+      return;
+   }
 
-      // now read from main history db
-      std::vector<HistoryEntry> entries;
-      Error error = readCollectionFromFile<std::vector<HistoryEntry> >(
-                           historyDBPath,
-                           &entries,
-                           boost::bind(readHistoryEntry, _1, _2, &nextIndex));
+   // another session rotated the database (or it was removed) so the
+   // entries we have are no longer the ones in it
+   uintmax_t size = fileSize(historyDatabaseFilePath());
+   if (size < fileSize_ ||
+       fileSize(historyDatabaseRotatedFilePath()) != rotatedFileSize_)
+   {
+      load();
+      return;
+   }
+
+   // read any entries appended since we last looked
+   if (size > fileSize_)
+   {
+      std::vector<std::string> lines;
+      Error error = readHistoryLines(historyDatabaseFilePath(),
+                                     &fileSize_,
+                                     &lines);
       if (error)
-      {
          LOG_ERROR(error);
-      }
-      else
-      {
-         std::copy(entries.begin(),
-                   entries.end(),
-                   std::back_inserter(entries_));
+      append(lines);
+   }
+}
+
+void HistoryArchive::load() const
+{
+   releaseCache();
+   loaded_ = true;
+
+   // first read from rotated file if it exists
+   FilePath rotatedHistoryDBPath = historyDatabaseRotatedFilePath();
+   std::vector<std::string> lines;
+   uintmax_t rotatedOffset = 0;
+   Error error = readHistoryLines(rotatedHistoryDBPath, &rotatedOffset, &lines);
+   if (error)
+      LOG_ERROR(error);
+   append(lines);
+   rotatedCount_ = entries_.size();
+   rotatedFileSize_ = fileSize(rotatedHistoryDBPath);
+
+   // now read from main history db
+   lines.clear();
+   error = readHistoryLines(historyDatabaseFilePath(), &fileSize_, &lines);
+   if (error)
+      LOG_ERROR(error);
+   append(lines);
+}
 
-         entryCacheLastWriteTime_ = historyDBPath.lastWriteTime();
+void HistoryArchive::append(const std::vector<std::string>& lines) const
+{
+   int nextIndex = static_cast<int>(entries_.size());
+   std::vector<Trigram> entryTrigrams;
+   BOOST_FOREACH(const std::string& line, lines)
+   {
+      HistoryEntry entry;
+      if (readHistoryEntry(line, &entry, &nextIndex) != ReadCollectionAddLine)
+         continue;
+
+      boost::uint32_t serial =
+               base_ + static_cast<boost::uint32_t>(entries_.size());
+      entryTrigrams.clear();
+      trigrams(entry.command, &entryTrigrams);
+      BOOST_FOREACH(Trigram trigram, entryTrigrams)
+      {
+         postings_[trigram].push_back(serial);
       }
 
+      entries_.push_back(entry);
    }
+}
 
-   // return entries
-   return entries_;
+void HistoryArchive::onRotated() const
+{
+   // the entries from the old rotated file are gone and those from the
+   // current file are now the rotated ones
+   entries_.erase(entries_.begin(), entries_.begin() + rotatedCount_);
+   for (std::size_t i = 0; i < entries_.size(); i++)
+      entries_[i].index = static_cast<int>(i);
+
+   base_ += static_cast<boost::uint32_t>(rotatedCount_);
+   typedef boost::unordered_map<Trigram, std::vector<boost::uint32_t> > Postings;
+   for (Postings::iterator it = postings_.begin(); it != postings_.end(); )
+   {
+      std::vector<boost::uint32_t>& serials = it->second;
+      serials.erase(serials.begin(),
+                    std::lower_bound(serials.begin(), serials.end(), base_));
+      if (serials.empty())
+         it = postings_.erase(it);
+      else
+         ++it;
+   }
+
+   rotatedCount_ = entries_.size();
+   rotatedFileSize_ = fileSize(historyDatabaseRotatedFilePath());
+   fileSize_ = 0;
 }
 
 void HistoryArchive::migrateRhistoryIfNecessary()
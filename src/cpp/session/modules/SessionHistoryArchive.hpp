@@ -19,7 +19,9 @@
 #include <string>
 #include <vector>
 
+#include <boost/cstdint.hpp>
 #include <boost/utility.hpp>
+#include <boost/unordered_map.hpp>
 
 namespace rstudio {
 namespace core {
@@ -48,10 +50,17 @@ struct HistoryEntry
 class HistoryArchive;
 HistoryArchive& historyArchive();
 
+// The archive keeps the entries of the (rotated and current) history
+// database in memory. Entries appended since they were last read, whether
+// by this session or another, are read incrementally; the database is only
+// re-read in full if another session rotated it.
 class HistoryArchive : boost::noncopyable
 {
 private:
-   HistoryArchive() : entryCacheLastWriteTime_(-1) {}
+   HistoryArchive()
+      : loaded_(false), rotatedCount_(0), base_(0), rotatedFileSize_(0), fileSize_(0)
+   {
+   }
    friend HistoryArchive& historyArchive();
 
 public:
@@ -59,11 +68,47 @@ public:
 
 public:
    core::Error add(const std::string& command);
+   core::Error add(const std::vector<std::string>& commands);
    const std::vector<HistoryEntry>& entries() const;
 
+   // positions within entries() (as of the last call to it) of the entries
+   // which may contain all of the search terms, in ascending order. returns
+   // false if none of the terms are long enough to narrow the search, in
+   // which case every entry is a candidate. matching must still be done on
+   // the candidates
+   bool candidates(const std::vector<std::string>& terms,
+                   std::vector<std::size_t>* pPositions) const;
+
+   // bytes held by the cached entries, and release of them (they'll be
+   // re-read from the history database the next time they're needed)
+   std::size_t memoryUsage() const;
+   std::size_t cachedEntryCount() const { return entries_.size(); }
+   void releaseCache() const;
+
 private:
-   mutable time_t entryCacheLastWriteTime_;
+   typedef boost::uint32_t Trigram;
+
+   void sync() const;
+   void load() const;
+   void append(const std::vector<std::string>& lines) const;
+   void onRotated() const;
+
+   mutable bool loaded_;
+
+   // entries (and their postings) from the rotated file come first
    mutable std::vector<HistoryEntry> entries_;
+   mutable std::size_t rotatedCount_;
+
+   // postings refer to entries by serial number (position + base) so that
+   // rotation doesn't require renumbering them
+   mutable boost::uint32_t base_;
+
+   // bytes of the rotated and current files reflected in entries_
+   mutable uintmax_t rotatedFileSize_;
+   mutable uintmax_t fileSize_;
+
+   // trigram => ascending positions of the entries containing it
+   mutable boost::unordered_map<Trigram, std::vector<boost::uint32_t> > postings_;
 };
                        
 } // namespace history
@@ -15,13 +15,21 @@
 
 #include "SessionLibPathsIndexer.hpp"
 
+#include <ctime>
+#include <sstream>
 #include <vector>
 #include <map>
 
+#include <boost/foreach.hpp>
+
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/json/JsonRpc.hpp>
 
-#include <session/SessionPackageProvidedExtension.hpp>
+#include <session/SessionModuleContext.hpp>
 
 using namespace rstudio::core;
 
@@ -32,46 +40,251 @@ namespace libpaths {
 
 namespace {
 
-std::vector<FilePath> s_installedPackages_;
+struct LibraryEntry
+{
+   LibraryEntry() : writeTime(0), scanTime(0) {}
+
+   std::time_t writeTime;
+   std::time_t scanTime;
+   std::vector<InstalledPackage> packages;
+};
+
+std::map<std::string, LibraryEntry> s_libraries;
+std::vector<InstalledPackage> s_installedPackages;
+std::vector<FilePath> s_installedPackagePaths;
+bool s_loaded = false;
 
-class Worker : public ppe::Worker
+FilePath snapshotPath()
 {
-   void onIndexingStarted()
+   return module_context::userScratchPath().complete(
+                                 "libpaths/installed-packages.json");
+}
+
+std::string packageSignature(const FilePath& packagePath)
+{
+   FilePath descPath = packagePath.childPath("DESCRIPTION");
+   if (!descPath.exists())
+      return std::string();
+
+   return safe_convert::numberToString(descPath.lastWriteTime()) + ":" +
+          safe_convert::numberToString(descPath.size());
+}
+
+void scanLibrary(const FilePath& libPath, LibraryEntry* pEntry)
+{
+   pEntry->writeTime = libPath.lastWriteTime();
+   pEntry->scanTime = std::time(NULL);
+   pEntry->packages.clear();
+
+   std::vector<FilePath> children;
+   Error error = libPath.children(&children);
+   if (error)
    {
-      s_installedPackages_.clear();
+      LOG_ERROR(error);
+      return;
    }
-   
-   void onWork(const std::string& pkgName, const FilePath& pkgPath)
+
+   BOOST_FOREACH(const FilePath& child, children)
    {
-      s_installedPackages_.push_back(pkgPath);
+      std::string signature = packageSignature(child);
+      if (signature.empty())
+         continue;
+
+      InstalledPackage package;
+      package.name = child.filename();
+      package.path = child;
+      package.signature = signature;
+      pEntry->packages.push_back(package);
    }
-   
-   void onIndexingCompleted(json::Object* pPayload)
+}
+
+json::Object libraryAsJson(const std::string& libPath,
+                           const LibraryEntry& entry)
+{
+   json::Array packagesJson;
+   BOOST_FOREACH(const InstalledPackage& package, entry.packages)
    {
-      // no need to update client state
+      json::Object packageJson;
+      packageJson["name"] = package.name;
+      packageJson["signature"] = package.signature;
+      packagesJson.push_back(packageJson);
    }
-   
-public:
-   
-   Worker() : ppe::Worker() {}
-};
 
-boost::shared_ptr<Worker>& worker()
+   json::Object libraryJson;
+   libraryJson["path"] = libPath;
+   libraryJson["write_time"] = safe_convert::numberToString(entry.writeTime);
+   libraryJson["scan_time"] = safe_convert::numberToString(entry.scanTime);
+   libraryJson["packages"] = packagesJson;
+   return libraryJson;
+}
+
+Error libraryFromJson(const json::Object& libraryJson,
+                      std::string* pLibPath,
+                      LibraryEntry* pEntry)
 {
-   static boost::shared_ptr<Worker> instance(new Worker);
-   return instance;
+   std::string writeTime, scanTime;
+   json::Array packagesJson;
+   Error error = json::readObject(libraryJson,
+                                  "path", pLibPath,
+                                  "write_time", &writeTime,
+                                  "scan_time", &scanTime,
+                                  "packages", &packagesJson);
+   if (error)
+      return error;
+
+   pEntry->writeTime = safe_convert::stringTo<std::time_t>(writeTime, 0);
+   pEntry->scanTime = safe_convert::stringTo<std::time_t>(scanTime, 0);
+
+   FilePath libPath(*pLibPath);
+   BOOST_FOREACH(const json::Value& packageJson, packagesJson)
+   {
+      if (packageJson.type() != json::ObjectType)
+         continue;
+
+      InstalledPackage package;
+      error = json::readObject(packageJson.get_obj(),
+                               "name", &package.name,
+                               "signature", &package.signature);
+      if (error)
+         return error;
+
+      package.path = libPath.childPath(package.name);
+      pEntry->packages.push_back(package);
+   }
+
+   return Success();
+}
+
+void loadSnapshot()
+{
+   FilePath path = snapshotPath();
+   if (!path.exists())
+      return;
+
+   std::string contents;
+   Error error = readStringFromFile(path, &contents);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   json::Value value;
+   if (!json::parse(contents, &value) || value.type() != json::ArrayType)
+   {
+      LOG_ERROR_MESSAGE("Failed to parse installed packages: " +
+                        path.absolutePath());
+      return;
+   }
+
+   BOOST_FOREACH(const json::Value& libraryJson, value.get_array())
+   {
+      if (libraryJson.type() != json::ObjectType)
+         continue;
+
+      std::string libPath;
+      LibraryEntry entry;
+      error = libraryFromJson(libraryJson.get_obj(), &libPath, &entry);
+      if (error)
+      {
+         LOG_ERROR(error);
+         continue;
+      }
+      s_libraries[libPath] = entry;
+   }
+}
+
+void saveSnapshot()
+{
+   json::Array librariesJson;
+   for (std::map<std::string, LibraryEntry>::const_iterator it =
+            s_libraries.begin();
+        it != s_libraries.end();
+        ++it)
+   {
+      librariesJson.push_back(libraryAsJson(it->first, it->second));
+   }
+
+   FilePath path = snapshotPath();
+   Error error = path.parent().ensureDirectory();
+   if (!error)
+   {
+      std::ostringstream ostr;
+      json::write(librariesJson, ostr);
+      error = writeStringToFile(path, ostr.str());
+   }
+   if (error)
+      LOG_ERROR(error);
 }
 
 } // end anonymous namespace
 
+void refreshInstalledPackages()
+{
+   if (!s_loaded)
+   {
+      loadSnapshot();
+      s_loaded = true;
+   }
+
+   bool changed = false;
+   std::map<std::string, LibraryEntry> libraries;
+   s_installedPackages.clear();
+   s_installedPackagePaths.clear();
+
+   BOOST_FOREACH(const FilePath& libPath, module_context::getLibPaths())
+   {
+      std::string key = libPath.absolutePath();
+      if (libraries.count(key) || !libPath.exists())
+         continue;
+
+      LibraryEntry& entry = libraries[key];
+      std::map<std::string, LibraryEntry>::const_iterator it =
+                                                   s_libraries.find(key);
+      if (it != s_libraries.end())
+         entry = it->second;
+
+      // a library's directory changes when packages are added, removed or
+      // reinstalled (file times are coarse, so libraries changed as they
+      // were scanned are scanned again)
+      std::time_t writeTime = libPath.lastWriteTime();
+      if (it == s_libraries.end() ||
+          writeTime != entry.writeTime ||
+          writeTime >= entry.scanTime)
+      {
+         scanLibrary(libPath, &entry);
+         changed = true;
+      }
+
+      BOOST_FOREACH(const InstalledPackage& package, entry.packages)
+      {
+         s_installedPackages.push_back(package);
+         s_installedPackagePaths.push_back(package.path);
+      }
+   }
+
+   if (libraries.size() != s_libraries.size())
+      changed = true;
+   s_libraries.swap(libraries);
+
+   if (changed)
+      saveSnapshot();
+}
+
+const std::vector<InstalledPackage>& installedPackages()
+{
+   return s_installedPackages;
+}
+
 const std::vector<FilePath>& getInstalledPackages()
 {
-   return s_installedPackages_;
+   return s_installedPackagePaths;
 }
 
 Error initialize()
 {
-   ppe::indexer().addWorker(worker());
+   // the record is brought up to date whenever packages are indexed
+   // (see ppe::Indexer)
    return Success();
 }
 
@@ -16,9 +16,12 @@
 #ifndef SESSION_MODULES_LIB_PATHS_INDEXER_HPP
 #define SESSION_MODULES_LIB_PATHS_INDEXER_HPP
 
+#include <string>
 #include <vector>
 #include <map>
 
+#include <core/FilePath.hpp>
+
 namespace rstudio {
 namespace core {
 
@@ -33,6 +36,24 @@ namespace session {
 namespace modules {
 namespace libpaths {
 
+struct InstalledPackage
+{
+   std::string name;
+   core::FilePath path;
+
+   // changes whenever the package is (re)installed
+   std::string signature;
+};
+
+// bring the record of installed packages up to date with the library paths.
+// only libraries whose directories have changed since they were last scanned
+// are listed again (and only then are their packages' DESCRIPTION files
+// examined). the record is persisted so it carries across sessions
+void refreshInstalledPackages();
+
+// the packages found by the last refresh (in library path order)
+const std::vector<InstalledPackage>& installedPackages();
+
 const std::vector<core::FilePath>& getInstalledPackages();
 core::Error initialize();
 
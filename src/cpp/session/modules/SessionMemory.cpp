@@ -0,0 +1,132 @@
+/*
+ * SessionMemory.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionMemory.hpp"
+
+#include <algorithm>
+#include <map>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include <core/Error.hpp>
+#include <core/Exec.hpp>
+#include <core/Log.hpp>
+#include <core/InternedString.hpp>
+#include <core/MemoryAccounting.hpp>
+
+#include <monitor/MonitorClient.hpp>
+
+#include <session/SessionModuleContext.hpp>
+#include <session/SessionOptions.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules { 
+namespace memory {
+
+namespace {
+
+int intervalSeconds()
+{
+   return std::max(session::options().monitorIntervalSeconds(), 1);
+}
+
+memory_accounting::Usage stringPoolUsage()
+{
+   return memory_accounting::Usage(string_pool::bytes(), string_pool::size());
+}
+
+json::Array statsAsJson(const std::vector<memory_accounting::SubsystemStats>& stats)
+{
+   json::Array statsJson;
+   BOOST_FOREACH(const memory_accounting::SubsystemStats& subsystem, stats)
+   {
+      json::Object subsystemJson;
+      subsystemJson["name"] = subsystem.name;
+      subsystemJson["bytes"] = static_cast<double>(subsystem.usage.bytes);
+      subsystemJson["entries"] = static_cast<double>(subsystem.usage.entries);
+      subsystemJson["budget"] = static_cast<double>(subsystem.budget);
+      subsystemJson["evictable"] = subsystem.evictable;
+      subsystemJson["evictions"] = static_cast<double>(subsystem.evictions);
+      statsJson.push_back(subsystemJson);
+   }
+   return statsJson;
+}
+
+bool collectUsage()
+{
+   // subsystem caches are owned by the main thread, so usage is collected
+   // (and budgets enforced) here rather than on a background thread
+   std::vector<memory_accounting::SubsystemStats> stats =
+                                             memory_accounting::collect();
+
+   if (session::options().programMode() == kSessionProgramModeServer)
+   {
+      monitor::client().sendMultiMetrics(monitor::metrics::memoryMetrics(
+                                                   "rsession.memory",
+                                                   intervalSeconds(),
+                                                   stats));
+   }
+
+   return true;
+}
+
+Error getMemoryUsage(const json::JsonRpcRequest& /*request*/,
+                     json::JsonRpcResponse* pResponse)
+{
+   pResponse->setResult(statsAsJson(memory_accounting::collect()));
+   return Success();
+}
+
+} // anonymous namespace
+   
+Error initialize()
+{
+   std::map<std::string, std::size_t> budgets;
+   Error error = memory_accounting::parseBudgets(
+                              session::options().limitCacheMemory(), &budgets);
+   if (error)
+      LOG_ERROR(error);
+
+   for (std::map<std::string, std::size_t>::const_iterator it = budgets.begin();
+        it != budgets.end();
+        ++it)
+   {
+      memory_accounting::setBudget(it->first, it->second);
+   }
+
+   memory_accounting::registerSubsystem("string-pool", stringPoolUsage);
+
+   module_context::schedulePeriodicWork(
+            boost::posix_time::seconds(intervalSeconds()),
+            collectUsage,
+            true,
+            false);
+
+   using boost::bind;
+   using namespace module_context;
+   ExecBlock initBlock ;
+   initBlock.addFunctions()
+      (bind(registerRpcMethod, "get_memory_usage", getMemoryUsage));
+   return initBlock.execute();
+}
+
+} // namespace memory
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -17,18 +17,25 @@
 
 #include "SessionObjectExplorer.hpp"
 
+#include <algorithm>
+#include <map>
+#include <set>
+
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <core/Algorithm.hpp>
 #include <core/Error.hpp>
 #include <core/Exec.hpp>
+#include <core/collection/LruCache.hpp>
 
 #include <r/RExec.hpp>
 #include <r/RRoutines.hpp>
 #include <r/RSexp.hpp>
 
 #include <session/SessionModuleContext.hpp>
+#include <session/SessionLocalScratch.hpp>
 
 using namespace rstudio::core;
 
@@ -41,10 +48,18 @@ namespace {
 
 const char * const kExplorerCacheDir = "explorer-cache";
 
+// inspection results for expanded nodes, keyed by the id of the cached
+// object they were extracted from (and the extracting code and page); the
+// keys are tracked by id so that an object's results can be dropped when
+// the object is refreshed or removed
+typedef boost::shared_ptr<r::sexp::PreservedSEXP> PreservedResult;
+collection::LruCache<std::string, PreservedResult> s_inspectionCache(200);
+std::map<std::string, std::set<std::string> > s_inspectionKeys;
+
 FilePath explorerCacheDir() 
 {
-   return module_context::sessionScratchPath()
-         .childPath(kExplorerCacheDir);
+   return local_scratch::localPath(
+            module_context::sessionScratchPath().childPath(kExplorerCacheDir));
 }
 
 std::string explorerCacheDirSystem()
@@ -60,6 +75,18 @@ void removeOrphanedCacheItems()
    if (!explorerCacheDir().exists())
       return;
    
+   // list objects in explorer cache (nothing more to do if it's empty)
+   std::vector<FilePath> cachedFiles;
+   error = explorerCacheDir().children(&cachedFiles);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+   
+   if (cachedFiles.empty())
+      return;
+   
    // list source documents
    std::vector<FilePath> docPaths;
    error = source_database::list(&docPaths);
@@ -69,11 +96,11 @@ void removeOrphanedCacheItems()
       return;
    }
    
-   // read their properties
+   // collect their ids
    typedef source_database::SourceDocument SourceDocument;
    typedef boost::shared_ptr<SourceDocument> Document;
    
-   std::vector<Document> documents;
+   std::set<std::string> ids;
    BOOST_FOREACH(const FilePath& docPath, docPaths)
    {
       Document pDoc(new SourceDocument());
@@ -83,45 +110,42 @@ void removeOrphanedCacheItems()
          LOG_ERROR(error);
          continue;
       }
-      documents.push_back(pDoc);
-   }
-   
-   // list objects in explorer cache
-   std::vector<FilePath> cachedFiles;
-   error = explorerCacheDir().children(&cachedFiles);
-   if (error)
-   {
-      LOG_ERROR(error);
-      return;
+      ids.insert(pDoc->getProperty("id"));
    }
    
    // remove any objects for which we don't have an associated
    // source document available
    BOOST_FOREACH(const FilePath& cacheFile, cachedFiles)
    {
-      std::string id = cacheFile.filename();
-      
-      bool foundId = false;
-      BOOST_FOREACH(Document pDoc, documents)
-      {
-         if (id == pDoc->getProperty("id"))
-         {
-            foundId = true;
-            break;
-         }
-      }
+      if (ids.count(cacheFile.filename()))
+         continue;
       
-      if (!foundId)
-      {
-         error = cacheFile.remove();
-         if (error)
-            LOG_ERROR(error);
-      }
+      error = cacheFile.remove();
+      if (error)
+         LOG_ERROR(error);
    }
 }
 
+void removeCachedInspections(const std::string& id)
+{
+   std::map<std::string, std::set<std::string> >::iterator it =
+         s_inspectionKeys.find(id);
+   if (it == s_inspectionKeys.end())
+      return;
+   
+   BOOST_FOREACH(const std::string& key, it->second)
+   {
+      s_inspectionCache.remove(key);
+   }
+   s_inspectionKeys.erase(it);
+}
+
 void onShutdown(bool terminatedNormally)
 {
+   // release cached results while R is still around
+   s_inspectionCache.clear();
+   s_inspectionKeys.clear();
+   
    if (!terminatedNormally)
       return;
    
@@ -183,15 +207,10 @@ void onDeferredInit(bool)
       return;
    }
    
-   removeOrphanedCacheItems();
-   
-   using namespace r::exec;
-   error = RFunction(".rs.explorer.restoreCache")
-         .addParam(explorerCacheDirSystem())
-         .call();
-   
-   if (error)
-      LOG_ERROR(error);
+   // cached objects are restored on demand (as their documents are opened);
+   // those whose documents have gone are removed once the session is idle
+   module_context::scheduleDelayedWork(boost::posix_time::seconds(30),
+                                       removeOrphanedCacheItems);
 }
 
 SEXP rs_objectClass(SEXP objectSEXP)
@@ -259,6 +278,105 @@ SEXP rs_explorerCacheDir()
    return r::sexp::create(explorerCacheDirSystem(), &protect);
 }
 
+// list the children of a list or environment with (1-based) indices from
+// 'start' to 'end', returning their names, indices and values and whether
+// there are more; returns NULL for other objects, and for environments whose
+// children would need code run to retrieve (active bindings and promises yet
+// to be forced), leaving those to R
+SEXP rs_explorerListChildren(SEXP objectSEXP, SEXP startSEXP, SEXP endSEXP)
+{
+   r::sexp::Protect protect;
+   
+   int type = TYPEOF(objectSEXP);
+   if (type != VECSXP && type != EXPRSXP && type != ENVSXP)
+      return R_NilValue;
+   
+   // an environment's children are its bindings, in sorted order (as 'ls')
+   SEXP keysSEXP = R_NilValue;
+   if (type == ENVSXP)
+      keysSEXP = r::sexp::objects(objectSEXP, true, &protect);
+   
+   int n = (type == ENVSXP) ? Rf_length(keysSEXP) : Rf_length(objectSEXP);
+   int start = std::max(r::sexp::asInteger(startSEXP), 1);
+   int end = std::min(r::sexp::asInteger(endSEXP), n);
+   int count = std::max(end - start + 1, 0);
+   
+   SEXP namesSEXP = (type == ENVSXP) ?
+         keysSEXP :
+         ::Rf_getAttrib(objectSEXP, R_NamesSymbol);
+   
+   SEXP childNamesSEXP = R_NilValue;
+   if (namesSEXP != R_NilValue)
+      protect.add(childNamesSEXP = ::Rf_allocVector(STRSXP, count));
+   
+   SEXP indicesSEXP, valuesSEXP;
+   protect.add(indicesSEXP = ::Rf_allocVector(INTSXP, count));
+   protect.add(valuesSEXP = ::Rf_allocVector(VECSXP, count));
+   
+   for (int i = 0; i < count; i++)
+   {
+      int index = start + i - 1;
+      INTEGER(indicesSEXP)[i] = index + 1;
+      if (childNamesSEXP != R_NilValue)
+         SET_STRING_ELT(childNamesSEXP, i, STRING_ELT(namesSEXP, index));
+      
+      SEXP valueSEXP;
+      if (type == ENVSXP)
+      {
+         std::string key = CHAR(STRING_ELT(keysSEXP, index));
+         if (r::sexp::isActiveBinding(key, objectSEXP))
+            return R_NilValue;
+         
+         valueSEXP = ::Rf_findVarInFrame(objectSEXP, ::Rf_install(key.c_str()));
+         if (valueSEXP == R_UnboundValue)
+            valueSEXP = R_NilValue;
+         
+         if (TYPEOF(valueSEXP) == PROMSXP)
+         {
+            if (PRVALUE(valueSEXP) == R_UnboundValue)
+               return R_NilValue;
+            valueSEXP = PRVALUE(valueSEXP);
+         }
+      }
+      else
+      {
+         valueSEXP = VECTOR_ELT(objectSEXP, index);
+      }
+      SET_VECTOR_ELT(valuesSEXP, i, valueSEXP);
+   }
+   
+   r::sexp::ListBuilder builder(&protect);
+   builder.add("names", childNamesSEXP);
+   builder.add("indices", indicesSEXP);
+   builder.add("values", valuesSEXP);
+   builder.add("more", n > end);
+   return r::sexp::create(builder, &protect);
+}
+
+SEXP rs_explorerGetCachedInspection(SEXP keySEXP)
+{
+   PreservedResult pResult;
+   if (!s_inspectionCache.get(r::sexp::asString(keySEXP), &pResult))
+      return R_NilValue;
+   
+   return pResult->get();
+}
+
+SEXP rs_explorerSetCachedInspection(SEXP idSEXP, SEXP keySEXP, SEXP resultSEXP)
+{
+   std::string key = r::sexp::asString(keySEXP);
+   s_inspectionCache.insert(key, PreservedResult(
+                               new r::sexp::PreservedSEXP(resultSEXP)));
+   s_inspectionKeys[r::sexp::asString(idSEXP)].insert(key);
+   return R_NilValue;
+}
+
+SEXP rs_explorerRemoveCachedInspections(SEXP idSEXP)
+{
+   removeCachedInspections(r::sexp::asString(idSEXP));
+   return R_NilValue;
+}
+
 } // end anonymous namespace
 
 core::Error initialize()
@@ -278,6 +396,10 @@ core::Error initialize()
    RS_REGISTER_CALL_METHOD(rs_objectClass, 1);
    RS_REGISTER_CALL_METHOD(rs_objectAttributes, 1);
    RS_REGISTER_CALL_METHOD(rs_explorerCacheDir, 0);
+   RS_REGISTER_CALL_METHOD(rs_explorerListChildren, 3);
+   RS_REGISTER_CALL_METHOD(rs_explorerGetCachedInspection, 1);
+   RS_REGISTER_CALL_METHOD(rs_explorerSetCachedInspection, 3);
+   RS_REGISTER_CALL_METHOD(rs_explorerRemoveCachedInspections, 1);
    
    ExecBlock initBlock;
    initBlock.addFunctions()
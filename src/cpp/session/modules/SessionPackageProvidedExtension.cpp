@@ -26,6 +26,8 @@
 
 #include <session/SessionModuleContext.hpp>
 
+#include "SessionLibPathsIndexer.hpp"
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -95,7 +97,9 @@ void Indexer::start()
             boost::posix_time::milliseconds(300),
             boost::posix_time::milliseconds(20),
             boost::bind(&Indexer::work, this),
-            true);
+            true,
+            WorkPriorityLow,
+            "package_extensions");
 }
 
 bool Indexer::work()
@@ -133,23 +137,10 @@ void Indexer::beginIndexing()
    pkgDirs_.clear();
    index_ = 0;
 
-   // discover packages available on the current library paths
-   std::vector<core::FilePath> libPaths = module_context::getLibPaths();
-   BOOST_FOREACH(const core::FilePath& libPath, libPaths)
-   {
-      if (!libPath.exists())
-         continue;
-
-      std::vector<core::FilePath> pkgPaths;
-      core::Error error = libPath.children(&pkgPaths);
-      if (error)
-         LOG_ERROR(error);
-
-      pkgDirs_.insert(
-               pkgDirs_.end(),
-               pkgPaths.begin(),
-               pkgPaths.end());
-   }
+   // discover packages available on the current library paths (only
+   // libraries which have changed since they were last seen are listed)
+   libpaths::refreshInstalledPackages();
+   pkgDirs_ = libpaths::getInstalledPackages();
    n_ = pkgDirs_.size();
    
    BOOST_FOREACH(boost::shared_ptr<Worker> pWorker, workers_)
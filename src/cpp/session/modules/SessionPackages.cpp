@@ -20,12 +20,20 @@
 
 #include "SessionPackages.hpp"
 
+#include <algorithm>
+#include <set>
+#include <sstream>
+
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/regex.hpp>
 #include <boost/format.hpp>
 
 #include <core/Error.hpp>
 #include <core/Exec.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/StringUtils.hpp>
+#include <core/json/JsonRpc.hpp>
 #include <core/http/URL.hpp>
 #include <core/http/TcpIpBlockingClient.hpp>
 
@@ -42,6 +50,7 @@
 #include <session/SessionAsyncRProcess.hpp>
 
 #include "SessionPackrat.hpp"
+#include "SessionLibPathsIndexer.hpp"
 
 #include "session-config.h"
 
@@ -407,39 +416,377 @@ Error availablePackages(const core::json::JsonRpcRequest&,
    return Success();
 }
 
-Error getPackageStateJson(json::Object* pJson)
+// The package pane's rows for installed packages, keyed by package path.
+// Rows are only read (from R) for packages which are new or have been
+// reinstalled since they were last read; the rows are persisted so that
+// they carry across sessions.
+class InstalledPackagesCache : public boost::noncopyable
+{
+public:
+
+   static InstalledPackagesCache& get()
+   {
+      static InstalledPackagesCache instance;
+      return instance;
+   }
+
+private:
+
+   InstalledPackagesCache() : loaded_(false)
+   {
+   }
+
+   struct Entry
+   {
+      std::string signature;
+
+      // empty for directories which aren't loadable packages
+      json::Object row;
+   };
+
+public:
+
+   Error listPackages(json::Array* pPackages)
+   {
+      if (!loaded_)
+      {
+         load();
+         loaded_ = true;
+      }
+
+      libpaths::refreshInstalledPackages();
+      const std::vector<libpaths::InstalledPackage>& installed =
+                                             libpaths::installedPackages();
+
+      // rows include the package's browse url (which depends on the CRAN
+      // repository) so start over if that changes
+      std::string cran;
+      Error error = r::exec::RFunction(".rs.installedPackagesCranUrl")
+            .call(&cran);
+      if (error)
+         return error;
+      if (cran != cran_)
+      {
+         entries_.clear();
+         cran_ = cran;
+      }
+
+      // read rows for new and reinstalled packages
+      std::vector<std::string> stalePaths;
+      std::map<std::string, std::string> staleSignatures;
+      BOOST_FOREACH(const libpaths::InstalledPackage& package, installed)
+      {
+         std::string path = package.path.absolutePath();
+         std::map<std::string, Entry>::const_iterator it = entries_.find(path);
+         if (it == entries_.end() || it->second.signature != package.signature)
+         {
+            stalePaths.push_back(path);
+            staleSignatures[path] = package.signature;
+         }
+      }
+      if (!stalePaths.empty())
+      {
+         error = readRows(stalePaths, staleSignatures);
+         if (error)
+            return error;
+      }
+
+      // fill in the fields which depend on session state
+      std::vector<std::string> loadedNamespaces;
+      error = r::exec::RFunction("loadedNamespaces").call(&loadedNamespaces);
+      if (error)
+         return error;
+      std::set<std::string> loaded(loadedNamespaces.begin(),
+                                   loadedNamespaces.end());
+      std::vector<FilePath> libPaths = module_context::getLibPaths();
+
+      std::vector<json::Object> rows;
+      std::set<std::string> paths;
+      BOOST_FOREACH(const libpaths::InstalledPackage& package, installed)
+      {
+         std::string path = package.path.absolutePath();
+         paths.insert(path);
+
+         const json::Object& cachedRow = entries_[path].row;
+         if (cachedRow.empty())
+            continue;
+
+         FilePath libPath = package.path.parent();
+         std::vector<FilePath>::const_iterator libIt =
+               std::find(libPaths.begin(), libPaths.end(), libPath);
+
+         json::Object row = cachedRow;
+         row["library"] = module_context::createAliasedPath(libPath);
+         row["library_index"] = libIt == libPaths.end() ? 0 :
+                     static_cast<int>(libIt - libPaths.begin()) + 1;
+         row["loaded"] = loaded.count(package.name) > 0;
+         rows.push_back(row);
+      }
+      std::stable_sort(rows.begin(), rows.end(), compareRowNames);
+
+      pPackages->clear();
+      pPackages->insert(pPackages->end(), rows.begin(), rows.end());
+
+      // forget packages which are no longer installed
+      std::map<std::string, Entry>::iterator it = entries_.begin();
+      bool removed = false;
+      while (it != entries_.end())
+      {
+         if (paths.count(it->first))
+         {
+            ++it;
+         }
+         else
+         {
+            entries_.erase(it++);
+            removed = true;
+         }
+      }
+      if (removed || !stalePaths.empty())
+         save();
+
+      return Success();
+   }
+
+private:
+
+   static bool compareRowNames(const json::Object& a, const json::Object& b)
+   {
+      std::string nameA, nameB;
+      json::readObject(a, "name", &nameA);
+      json::readObject(b, "name", &nameB);
+      return string_utils::toLower(nameA) < string_utils::toLower(nameB);
+   }
+
+   static FilePath cachePath()
+   {
+      return module_context::userScratchPath().complete(
+                                    "packages/installed-packages.json");
+   }
+
+   Error readRows(const std::vector<std::string>& paths,
+                  const std::map<std::string, std::string>& signatures)
+   {
+      r::sexp::Protect protect;
+      SEXP rowsSEXP;
+      Error error = r::exec::RFunction(".rs.installedPackageRows")
+            .addParam(paths)
+            .addParam(cran_)
+            .call(&rowsSEXP, &protect);
+      if (error)
+         return error;
+
+      // paths which don't yield a row aren't packages
+      BOOST_FOREACH(const std::string& path, paths)
+      {
+         Entry& entry = entries_[path];
+         entry.signature = signatures.find(path)->second;
+         entry.row.clear();
+      }
+
+      json::Value rowsJson;
+      r::json::jsonValueFromObject(rowsSEXP, &rowsJson);
+      if (rowsJson.type() != json::ArrayType)
+         return Success();
+
+      BOOST_FOREACH(const json::Value& rowJson, rowsJson.get_array())
+      {
+         if (rowJson.type() != json::ObjectType)
+            continue;
+
+         json::Object row = rowJson.get_obj();
+         std::string path;
+         error = json::readObject(row, "path", &path);
+         if (error)
+         {
+            LOG_ERROR(error);
+            continue;
+         }
+         row.erase("path");
+
+         std::map<std::string, Entry>::iterator it = entries_.find(path);
+         if (it != entries_.end())
+            it->second.row = row;
+      }
+
+      return Success();
+   }
+
+   void load()
+   {
+      FilePath path = cachePath();
+      if (!path.exists())
+         return;
+
+      std::string contents;
+      Error error = readStringFromFile(path, &contents);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+
+      json::Value value;
+      json::Array entriesJson;
+      if (!json::parse(contents, &value) ||
+          value.type() != json::ObjectType ||
+          json::readObject(value.get_obj(),
+                           "cran", &cran_,
+                           "packages", &entriesJson))
+      {
+         LOG_ERROR_MESSAGE("Failed to parse installed packages: " +
+                           path.absolutePath());
+         return;
+      }
+
+      BOOST_FOREACH(const json::Value& entryJson, entriesJson)
+      {
+         std::string packagePath;
+         Entry entry;
+         if (entryJson.type() != json::ObjectType ||
+             json::readObject(entryJson.get_obj(),
+                              "path", &packagePath,
+                              "signature", &entry.signature,
+                              "row", &entry.row))
+         {
+            continue;
+         }
+
+         entries_[packagePath] = entry;
+      }
+   }
+
+   void save()
+   {
+      json::Array entriesJson;
+      for (std::map<std::string, Entry>::const_iterator it = entries_.begin();
+           it != entries_.end();
+           ++it)
+      {
+         json::Object entryJson;
+         entryJson["path"] = it->first;
+         entryJson["signature"] = it->second.signature;
+         entryJson["row"] = it->second.row;
+         entriesJson.push_back(entryJson);
+      }
+
+      json::Object cacheJson;
+      cacheJson["cran"] = cran_;
+      cacheJson["packages"] = entriesJson;
+
+      FilePath path = cachePath();
+      Error error = path.parent().ensureDirectory();
+      if (!error)
+      {
+         std::ostringstream ostr;
+         json::write(cacheJson, ostr);
+         error = writeStringToFile(path, ostr.str());
+      }
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   bool loaded_;
+   std::string cran_;
+   std::map<std::string, Entry> entries_;
+};
+
+// the installed packages as last sent to the client (keyed by library and
+// name) so that changes can be sent as a delta
+std::map<std::string, json::Object> s_clientPackages;
+bool s_clientHasPackages = false;
+
+std::string clientPackageKey(const json::Object& row)
+{
+   std::string name, library;
+   json::readObject(row, "name", &name, "library_absolute", &library);
+   return library + "/" + name;
+}
+
+// record the packages sent to the client, returning the changes since
+// those last sent
+json::Object updateClientPackages(const json::Array& packages)
+{
+   std::map<std::string, json::Object> clientPackages;
+   json::Array updated;
+   BOOST_FOREACH(const json::Value& package, packages)
+   {
+      const json::Object& row = package.get_obj();
+      std::string key = clientPackageKey(row);
+      clientPackages[key] = row;
+
+      std::map<std::string, json::Object>::const_iterator it =
+                                                s_clientPackages.find(key);
+      if (it == s_clientPackages.end() || !(it->second == row))
+         updated.push_back(row);
+   }
+
+   json::Array removed;
+   for (std::map<std::string, json::Object>::const_iterator it =
+            s_clientPackages.begin();
+        it != s_clientPackages.end();
+        ++it)
+   {
+      if (!clientPackages.count(it->first))
+         removed.push_back(it->second);
+   }
+
+   s_clientPackages.swap(clientPackages);
+
+   json::Object delta;
+   delta["updated"] = updated;
+   delta["removed"] = removed;
+   return delta;
+}
+
+// when asDelta is true the package list is replaced by the changes since
+// the list last sent to the client (if there was one)
+Error getPackageStateJson(json::Object* pJson, bool asDelta)
 {
-   Error error = Success();
    module_context::PackratContext context = module_context::packratContext();
-   json::Value packageListJson;
-   r::sexp::Protect protect;
-   SEXP packageList;
 
    // determine the appropriate package listing method from the current 
    // packrat mode status
    if (context.modeOn)
    {
+      r::sexp::Protect protect;
+      SEXP packageList;
       FilePath projectDir = projects::projectContext().directory();
-      error = r::exec::RFunction(".rs.listPackagesPackrat", 
-                                 string_utils::utf8ToSystem(
-                                    projectDir.absolutePath()))
-              .call(&packageList, &protect);
-   }
-   else
-   {
-      error = r::exec::RFunction(".rs.listInstalledPackages")
+      Error error = r::exec::RFunction(".rs.listPackagesPackrat", 
+                                       string_utils::utf8ToSystem(
+                                          projectDir.absolutePath()))
               .call(&packageList, &protect);
-   }
+      if (error)
+         return error;
 
-   if (!error)
-   {
-      // return the generated package list and the Packrat context
+      // return the generated package list and the Packrat context (packrat
+      // libraries are always listed in full)
+      json::Value packageListJson;
       r::json::jsonValueFromObject(packageList, &packageListJson);
       (*pJson)["package_list"] = packageListJson;
       (*pJson)["packrat_context"] = packrat::contextAsJson(context);
+      s_clientHasPackages = false;
+      return Success();
    }
 
-   return error;
+   json::Array packages;
+   Error error = InstalledPackagesCache::get().listPackages(&packages);
+   if (error)
+      return error;
+
+   if (asDelta && s_clientHasPackages)
+   {
+      (*pJson)["package_delta"] = updateClientPackages(packages);
+   }
+   else
+   {
+      updateClientPackages(packages);
+      (*pJson)["package_list"] = packages;
+   }
+   (*pJson)["packrat_context"] = packrat::contextAsJson(context);
+   s_clientHasPackages = true;
+
+   return Success();
 }
 
 SEXP rs_enqueLoadedPackageUpdates(SEXP installCmdSEXP)
@@ -535,7 +882,7 @@ Error getPackageState(const json::JsonRpcRequest& ,
                       json::JsonRpcResponse* pResponse)
 {
    json::Object result;
-   Error error = getPackageStateJson(&result);
+   Error error = getPackageStateJson(&result, false);
    if (error) 
       LOG_ERROR(error);
    else
@@ -548,7 +895,7 @@ Error getPackageState(const json::JsonRpcRequest& ,
 void enquePackageStateChanged()
 {
    json::Object pkgState;
-   Error error = getPackageStateJson(&pkgState);
+   Error error = getPackageStateJson(&pkgState, true);
    if (error)
       LOG_ERROR(error);
    else
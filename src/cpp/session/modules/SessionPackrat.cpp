@@ -153,6 +153,7 @@ std::string packratActionName(PackratActionType action)
 static PackratActionType s_runningPackratAction = PACKRAT_ACTION_NONE;
 static bool s_autoSnapshotPending = false;
 static bool s_autoSnapshotRunning = false;
+static bool s_libraryCheckPending = false;
 
 // Forward declarations ------------------------------------------------------
 
@@ -217,18 +218,49 @@ std::string updateHash(PackratHashType hashType, PackratHashState hashState,
    return newHash;
 }
 
+// the content of the library's DESCRIPTION files, as of their last
+// modification, so that only the files which changed since the library was
+// last hashed need be read
+struct DescFile
+{
+   std::time_t lastWriteTime;
+   uintmax_t size;
+   std::string content;
+};
+
+typedef std::map<std::string, DescFile> DescFiles;
+DescFiles s_descFiles;
+
 // adds content from the given file to the given file if it's a 
 // DESCRIPTION file (used to summarize library content for hashing)
-bool addDescContent(int level, const FilePath& path, std::string* pDescContent)
+bool addDescContent(int level, const FilePath& path, DescFiles* pDescFiles,
+                    std::string* pDescContent)
 {
-   std::string newDescContent;
    if (path.filename() == "DESCRIPTION") 
    {
-      Error error = readStringFromFile(path, &newDescContent);
+      DescFile descFile;
+      descFile.lastWriteTime = path.lastWriteTime();
+      descFile.size = path.size();
+
+      std::string filePath = path.absolutePath();
+      DescFiles::const_iterator it = s_descFiles.find(filePath);
+      if (it != s_descFiles.end() &&
+          it->second.lastWriteTime == descFile.lastWriteTime &&
+          it->second.size == descFile.size)
+      {
+         descFile.content = it->second.content;
+      }
+      else
+      {
+         Error error = readStringFromFile(path, &descFile.content);
+      }
+
       // include the path of the file; on Windows the DESCRIPTION file moves
       // inside the library post-installation
-      pDescContent->append(path.absolutePath());
-      pDescContent->append(newDescContent);
+      pDescContent->append(filePath);
+      pDescContent->append(descFile.content);
+
+      (*pDescFiles)[filePath] = descFile;
    }
    return true;
 }
@@ -242,9 +274,13 @@ std::string computeLibraryHash()
 
    // find all DESCRIPTION files in the library and concatenate them to form
    // a hashable state
+   DescFiles descFiles;
    std::string descFileContent;
    libraryPath.childrenRecursive(
-         boost::bind(addDescContent, _1, _2, &descFileContent));
+         boost::bind(addDescContent, _1, _2, &descFiles, &descFileContent));
+
+   // remember only the files which are still present
+   s_descFiles.swap(descFiles);
 
    if (descFileContent.empty())
       return "";
@@ -565,6 +601,15 @@ void onLibraryUpdate(const std::string& oldHash, const std::string& newHash)
       packages::enquePackageStateChanged();
 }
 
+void checkLibraryHash()
+{
+   s_libraryCheckPending = false;
+   if (s_runningPackratAction != PACKRAT_ACTION_NONE)
+      return;
+
+   checkHashes(HASH_TYPE_LIBRARY, HASH_STATE_OBSERVED, onLibraryUpdate);
+}
+
 void onFileChanged(FilePath sourceFilePath)
 {
    // ignore file changes while Packrat is running
@@ -595,7 +640,17 @@ void onFileChanged(FilePath sourceFilePath)
          return;
       }
       PACKRAT_TRACE("detected change to library file " << sourceFilePath);
-      checkHashes(HASH_TYPE_LIBRARY, HASH_STATE_OBSERVED, onLibraryUpdate);
+
+      // installing a package changes many files at once (as may installing
+      // several), so the library is checked once the changes have settled
+      if (!s_libraryCheckPending)
+      {
+         s_libraryCheckPending = true;
+         module_context::scheduleDelayedWork(
+                  boost::posix_time::milliseconds(500),
+                  checkLibraryHash,
+                  false);
+      }
    }
 }
 
@@ -25,6 +25,7 @@
 #include <core/FilePath.hpp>
 #include <core/BoostErrors.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/MemoryAccounting.hpp>
 
 #include <core/system/Environment.hpp>
 
@@ -457,9 +458,16 @@ void setImageFileResponse(const FilePath& imageFilePath,
    // set content type
    pResponse->setContentType(imageFilePath.mimeContentType());
    
-   // attempt gzip
-   if (request.acceptsEncoding(http::kGzipEncoding))
-      pResponse->setContentEncoding(http::kGzipEncoding);
+   // attempt compression (skipped for already compressed formats like png)
+   pResponse->negotiateContentEncoding(request);
+   
+   // uncompressed images are written to the connection directly from disk
+   // (rather than being read into the body)
+   if (pResponse->contentEncoding().empty() && imageFilePath.exists())
+   {
+      pResponse->setSendFile(imageFilePath);
+      return;
+   }
    
    // set file
    Error error = pResponse->setBody(imageFilePath);
@@ -479,11 +487,20 @@ void setTemporaryFileResponse(const FilePath& filePath,
    // no cache (dynamic content)
    pResponse->setNoCacheHeaders();
    
-   // return the file
-   pResponse->setFile(filePath, request);
+   // return the file. it's read into the body (rather than being streamed
+   // or sent from disk) since it's deleted before the response is written
+   pResponse->setContentType(filePath.mimeContentType());
+   pResponse->negotiateContentEncoding(request);
+   Error error = pResponse->setBody(filePath);
+   if (error)
+   {
+      LOG_ERROR(error);
+      pResponse->setError(http::status::InternalServerError,
+                          error.code().message());
+   }
    
    // delete the file
-   Error error = filePath.remove();
+   error = filePath.remove();
    if (error)
       LOG_ERROR(error);
 }
@@ -579,13 +596,8 @@ void handleZoomPngRequest(const http::Request& request,
       return;
    }
    
-   // send it back
-   setImageFileResponse(imagePath, request, pResponse);
-   
-   // delete the temp file
-   Error error = imagePath.remove();
-   if (error)
-      LOG_ERROR(error);
+   // send it back (and delete it)
+   setTemporaryFileResponse(imagePath, request, pResponse);
 }
 
 void handlePngRequest(const http::Request& request, 
@@ -846,6 +858,14 @@ SEXP rs_savePlotAsImage(SEXP fileSEXP,
 }
 
 
+core::memory_accounting::Usage plotsUsage()
+{
+   // rendered plots live on disk and display lists in the R heap, so there
+   // are no bytes of our own to report
+   return core::memory_accounting::Usage(
+            0, r::session::graphics::display().plotCount());
+}
+
 } // anonymous namespace  
    
 bool haveCairoPdf()
@@ -893,6 +913,8 @@ Error initialize()
    // connect to onShowManipulator
    using namespace rstudio::r::session;
    graphics::display().onShowManipulator().connect(bind(onShowManipulator));
+
+   core::memory_accounting::registerSubsystem("plots", plotsUsage);
    
    using namespace module_context;
    ExecBlock initBlock ;
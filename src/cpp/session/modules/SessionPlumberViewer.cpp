@@ -211,7 +211,8 @@ Error initialize()
    methodDefViewer.numArgs = 3;
    r::routines::addCallMethod(methodDefViewer);
 
-   userSettings().onChanged.connect(bind(onUserSettingsChanged, pPlumberViewerType));
+   userSettings().onKeyChanged(UserSettings::uiPrefKey("plumber_viewer_type"),
+                               bind(onUserSettingsChanged, pPlumberViewerType));
 
    ExecBlock initBlock;
    initBlock.addFunctions()
@@ -13,6 +13,9 @@
  *
  */
 
+#include <set>
+#include <sstream>
+
 #include <core/Macros.hpp>
 #include <core/Algorithm.hpp>
 #include <core/Debug.hpp>
@@ -20,6 +23,7 @@
 #include <core/Exec.hpp>
 #include <core/FilePath.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/text/DcfParser.hpp>
 
 #include <boost/regex.hpp>
@@ -35,6 +39,8 @@
 #include <session/SessionModuleContext.hpp>
 #include <session/SessionPackageProvidedExtension.hpp>
 
+#include "SessionLibPathsIndexer.hpp"
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -213,7 +219,24 @@ public:
             addins_.size() + 1));
    }
 
+   void add(const std::string& pkgName,
+            const std::vector<std::map<std::string, std::string> >& records)
+   {
+      BOOST_FOREACH(std::map<std::string, std::string> fields, records)
+      {
+         add(pkgName, fields);
+      }
+   }
+
    void add(const std::string& pkgName, const FilePath& addinPath)
+   {
+      std::vector<std::map<std::string, std::string> > records;
+      readRecords(addinPath, &records);
+      add(pkgName, records);
+   }
+
+   static void readRecords(const FilePath& addinPath,
+                           std::vector<std::map<std::string, std::string> >* pRecords)
    {
       static const boost::regex reSeparator("\\n{2,}");
 
@@ -232,8 +255,7 @@ public:
 
          for (; it != end; ++it)
          {
-            std::map<std::string, std::string> fields = parseAddinDcf(*it);
-            add(pkgName, fields);
+            pRecords->push_back(parseAddinDcf(*it));
          }
       }
       CATCH_UNEXPECTED_EXCEPTION;
@@ -318,14 +340,133 @@ void updateAddinRegistry(boost::shared_ptr<AddinRegistry> pRegistry)
    module_context::enqueClientEvent(event);
 }
 
-void loadAddinRegistry()
+AddinRegistry& addinRegistry()
 {
-   s_pCurrentRegistry->loadFromFile(addinRegistryPath());
+   return *s_pCurrentRegistry;
 }
 
-AddinRegistry& addinRegistry()
+// the records read from a package's addins.dcf, along with the signature of
+// the package and the file when they were read
+struct AddinFileEntry
 {
-   return *s_pCurrentRegistry;
+   std::string signature;
+   std::vector<std::map<std::string, std::string> > records;
+};
+
+// addins.dcf path => records; persisted so that the files of packages which
+// haven't changed needn't be read again (in this or later sessions)
+std::map<std::string, AddinFileEntry> s_addinFiles;
+bool s_addinFilesLoaded = false;
+
+FilePath addinFilesCachePath()
+{
+   return module_context::userScratchPath().complete("addins/files.json");
+}
+
+void loadAddinFiles()
+{
+   if (s_addinFilesLoaded)
+      return;
+   s_addinFilesLoaded = true;
+
+   FilePath path = addinFilesCachePath();
+   if (!path.exists())
+      return;
+
+   std::string contents;
+   Error error = readStringFromFile(path, &contents);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   json::Value value;
+   if (!json::parse(contents, &value) || value.type() != json::ArrayType)
+   {
+      LOG_ERROR_MESSAGE("Failed to parse addin files: " + path.absolutePath());
+      return;
+   }
+
+   BOOST_FOREACH(const json::Value& fileJson, value.get_array())
+   {
+      if (fileJson.type() != json::ObjectType)
+         continue;
+
+      std::string addinPath;
+      AddinFileEntry entry;
+      json::Array recordsJson;
+      error = json::readObject(fileJson.get_obj(),
+                               "path", &addinPath,
+                               "signature", &entry.signature,
+                               "records", &recordsJson);
+      if (error)
+      {
+         LOG_ERROR(error);
+         continue;
+      }
+
+      BOOST_FOREACH(const json::Value& recordJson, recordsJson)
+      {
+         if (recordJson.type() != json::ObjectType)
+            continue;
+
+         std::map<std::string, std::string> fields;
+         const json::Object& fieldsJson = recordJson.get_obj();
+         for (json::Object::const_iterator it = fieldsJson.begin();
+              it != fieldsJson.end();
+              ++it)
+         {
+            if (it->second.type() == json::StringType)
+               fields[it->first] = it->second.get_str();
+         }
+         entry.records.push_back(fields);
+      }
+
+      s_addinFiles[addinPath] = entry;
+   }
+}
+
+void saveAddinFiles()
+{
+   json::Array filesJson;
+   for (std::map<std::string, AddinFileEntry>::const_iterator it =
+            s_addinFiles.begin();
+        it != s_addinFiles.end();
+        ++it)
+   {
+      json::Array recordsJson;
+      BOOST_FOREACH(const std::map<std::string, std::string>& fields,
+                    it->second.records)
+      {
+         json::Object fieldsJson;
+         for (std::map<std::string, std::string>::const_iterator field =
+                  fields.begin();
+              field != fields.end();
+              ++field)
+         {
+            fieldsJson[field->first] = field->second;
+         }
+         recordsJson.push_back(fieldsJson);
+      }
+
+      json::Object fileJson;
+      fileJson["path"] = it->first;
+      fileJson["signature"] = it->second.signature;
+      fileJson["records"] = recordsJson;
+      filesJson.push_back(fileJson);
+   }
+
+   FilePath path = addinFilesCachePath();
+   Error error = path.parent().ensureDirectory();
+   if (!error)
+   {
+      std::ostringstream ostr;
+      json::write(filesJson, ostr);
+      error = writeStringToFile(path, ostr.str());
+   }
+   if (error)
+      LOG_ERROR(error);
 }
 
 class AddinWorker : public ppe::Worker
@@ -333,15 +474,61 @@ class AddinWorker : public ppe::Worker
    void onIndexingStarted()
    {
       pRegistry_ = boost::make_shared<AddinRegistry>();
+      loadAddinFiles();
+
+      // the installed packages have just been brought up to date, so their
+      // signatures tell us which have been (re)installed
+      packageSignatures_.clear();
+      BOOST_FOREACH(const libpaths::InstalledPackage& package,
+                    libpaths::installedPackages())
+      {
+         packageSignatures_[package.path.absolutePath()] = package.signature;
+      }
+      indexed_.clear();
+      changed_ = false;
    }
    
    void onWork(const std::string& pkgName, const FilePath& addinPath)
    {
-      pRegistry_->add(pkgName, addinPath);
+      // (the addins.dcf is found at <package>/rstudio/addins.dcf)
+      std::string path = addinPath.absolutePath();
+      std::string signature =
+            packageSignatures_[addinPath.parent().parent().absolutePath()] +
+            ":" + safe_convert::numberToString(addinPath.lastWriteTime()) +
+            ":" + safe_convert::numberToString(addinPath.size());
+      indexed_.insert(path);
+
+      AddinFileEntry& entry = s_addinFiles[path];
+      if (entry.signature != signature)
+      {
+         entry.signature = signature;
+         entry.records.clear();
+         AddinRegistry::readRecords(addinPath, &entry.records);
+         changed_ = true;
+      }
+
+      pRegistry_->add(pkgName, entry.records);
    }
    
    void onIndexingCompleted(json::Object* pPayload)
    {
+      // forget packages which have been removed and persist any changes
+      std::map<std::string, AddinFileEntry>::iterator it = s_addinFiles.begin();
+      while (it != s_addinFiles.end())
+      {
+         if (indexed_.count(it->first))
+         {
+            ++it;
+         }
+         else
+         {
+            s_addinFiles.erase(it++);
+            changed_ = true;
+         }
+      }
+      if (changed_)
+         saveAddinFiles();
+
       // finalize by indexing current package
       if (isDevtoolsLoadAllActive())
       {
@@ -376,7 +563,7 @@ class AddinWorker : public ppe::Worker
 
 public:
    
-   AddinWorker() : ppe::Worker("rstudio/addins.dcf") {}
+   AddinWorker() : ppe::Worker("rstudio/addins.dcf"), changed_(false) {}
    
    void addContinuation(json::JsonRpcFunctionContinuation continuation)
    {
@@ -386,6 +573,9 @@ public:
 private:
    boost::shared_ptr<AddinRegistry> pRegistry_;
    std::vector<json::JsonRpcFunctionContinuation> continuations_;
+   std::map<std::string, std::string> packageSignatures_;
+   std::set<std::string> indexed_;
+   bool changed_;
 };
 
 boost::shared_ptr<AddinWorker>& addinWorker()
@@ -493,16 +683,19 @@ core::json::Value addinRegistryAsJson()
 {
    return addinRegistry().toJson();
 }
+
+Error loadAddinRegistry()
+{
+   s_pCurrentRegistry->loadFromFile(addinRegistryPath());
+   return Success();
+}
   
 Error initialize()
 {
    using boost::bind;
    using namespace module_context;
    
-   // load cached registry
-   loadAddinRegistry();
-   
-   // register worker
+   // register worker (the cached registry was read by loadAddinRegistry)
    ppe::indexer().addWorker(addinWorker());
    
    ExecBlock initBlock;
@@ -31,6 +31,10 @@ namespace r_addins {
 
 core::json::Value addinRegistryAsJson();
 
+// reads the cached registry (file i/o only, so safe off the main thread);
+// must finish before initialize
+core::Error loadAddinRegistry();
+
 core::Error initialize();
 
 } // namespace r_addins
@@ -16,10 +16,13 @@
 #include "SessionRCompletions.hpp"
 
 #include <core/Exec.hpp>
+#include <core/FuzzyMatch.hpp>
+#include <core/YamlUtil.hpp>
 
 #include <boost/range/adaptors.hpp>
 
 #include <r/RSexp.hpp>
+#include <r/RSexpView.hpp>
 #include <r/RInternal.hpp>
 #include <r/RExec.hpp>
 #include <r/RJson.hpp>
@@ -37,6 +40,7 @@
 
 #include <session/projects/SessionProjects.hpp>
 #include <session/SessionModuleContext.hpp>
+#include <session/SessionSourceDatabase.hpp>
 
 #include "SessionCodeSearch.hpp"
 #include "SessionLibPathsIndexer.hpp"
@@ -201,11 +205,11 @@ SourceIndexCompletions getSourceIndexCompletions(const std::string& token)
    return srcCompletions;
 }
 
-SEXP rs_getSourceIndexCompletions(SEXP tokenSEXP)
+SEXP rs_getSourceIndexCompletions(const r::sexp::StringView& token)
 {
    r::sexp::Protect protect;
-   std::string token = r::sexp::asString(tokenSEXP);
-   SourceIndexCompletions srcCompletions = getSourceIndexCompletions(token);
+   SourceIndexCompletions srcCompletions =
+         getSourceIndexCompletions(token.str());
 
    std::vector<std::string> names;
    names.push_back("completions");
@@ -221,7 +225,7 @@ SEXP rs_getSourceIndexCompletions(SEXP tokenSEXP)
 }
 
 bool subsequenceFilter(const FileInfo& fileInfo,
-                       const std::string& pattern,
+                       const core::fuzzy_match::Query& query,
                        int parentPathLength,
                        int maxCount,
                        std::vector<std::string>* pPaths,
@@ -234,10 +238,12 @@ bool subsequenceFilter(const FileInfo& fileInfo,
       return false;
    }
    
-   bool isSubsequence = string_utils::isSubsequence(
-            fileInfo.absolutePath().substr(parentPathLength + 2),
-            pattern,
-            true);
+   // match against the path relative to the parent
+   const std::string& path = fileInfo.absolutePath();
+   std::size_t offset = std::min(path.size(),
+                                 static_cast<std::size_t>(parentPathLength + 2));
+   bool isSubsequence = query.isSubsequenceOf(path.data() + offset,
+                                              path.data() + path.size());
    
    if (isSubsequence)
    {
@@ -277,7 +283,7 @@ SEXP rs_scanFiles(SEXP pathSEXP,
    bool moreAvailable = false;
    options.filter = boost::bind(subsequenceFilter,
                                 _1,
-                                pattern,
+                                core::fuzzy_match::Query(pattern, true),
                                 path.length(),
                                 maxCount,
                                 &paths,
@@ -297,27 +303,26 @@ SEXP rs_scanFiles(SEXP pathSEXP,
    return r::sexp::create(builder, &protect);
 }
 
-SEXP rs_isSubsequence(SEXP stringsSEXP, SEXP querySEXP)
+SEXP rs_isSubsequence(const r::sexp::StringVectorView& strings,
+                      const r::sexp::StringView& query)
 {
-   std::vector<std::string> strings;
-   if (!r::sexp::fillVectorString(stringsSEXP, &strings))
+   if (!strings.valid())
       return R_NilValue;
 
-   std::string query = r::sexp::asString(querySEXP);
-
+   // match the strings in place (this is called as completions are typed)
+   core::fuzzy_match::Query subsequenceQuery(query.str());
    std::vector<bool> result(strings.size());
-
-   std::transform(strings.begin(),
-                  strings.end(),
-                  result.begin(),
-                  boost::bind(
-                     string_utils::isSubsequence,
-                     _1,
-                     query));
+   for (std::size_t i = 0; i < strings.size(); i++)
+   {
+      r::sexp::StringView string = strings[i];
+      boost::uint64_t mask = core::fuzzy_match::characterMask(
+               string.begin(), string.end(), false);
+      result[i] = subsequenceQuery.mayMatch(mask) &&
+                  subsequenceQuery.isSubsequenceOf(string.begin(), string.end());
+   }
 
    r::sexp::Protect protect;
    return r::sexp::create(result, &protect);
-
 }
 
 SEXP rs_getNAMESPACEImportedSymbols(SEXP documentIdSEXP)
@@ -443,6 +448,27 @@ SEXP rs_listInferredPackages(SEXP documentIdSEXP)
    
 }
 
+// the params of each R Markdown document, as of its current YAML header
+// (completions are requested on most keystrokes, and knitr::knit_params scans
+// the whole document)
+struct KnitParams : boost::noncopyable
+{
+   std::string yamlHeader;
+   r::sexp::PreservedSEXP params;
+};
+
+std::map<std::string, boost::shared_ptr<KnitParams> > s_knitParams;
+
+void onDocRemoved(const std::string& id, const std::string&)
+{
+   s_knitParams.erase(id);
+}
+
+void onRemoveAll()
+{
+   s_knitParams.clear();
+}
+
 SEXP rs_getKnitParamsForDocument(SEXP documentIdSEXP)
 {
    using namespace source_database;
@@ -465,6 +491,13 @@ SEXP rs_getKnitParamsForDocument(SEXP documentIdSEXP)
    if (!pDoc->isRMarkdownDocument())
       return R_NilValue;
    
+   // params are declared in the YAML header, so are unchanged by edits to
+   // the rest of the document
+   std::string yamlHeader = yaml::extractYamlHeader(pDoc->contents());
+   boost::shared_ptr<KnitParams>& pCached = s_knitParams[documentId];
+   if (pCached && pCached->yamlHeader == yamlHeader)
+      return pCached->params.get();
+   
    r::exec::RFunction knitParams(".rs.knitParams");
    knitParams.addParam(pDoc->contents());
    
@@ -474,9 +507,14 @@ SEXP rs_getKnitParamsForDocument(SEXP documentIdSEXP)
    if (error)
    {
       LOG_ERROR(error);
+      s_knitParams.erase(documentId);
       return R_NilValue;
    }
    
+   pCached.reset(new KnitParams());
+   pCached->yamlHeader = yamlHeader;
+   pCached->params.set(resultSEXP);
+   
    return resultSEXP;
 }
 
@@ -500,15 +538,18 @@ SEXP rs_listIndexedPackages()
 Error initialize() {
 
    RS_REGISTER_CALL_METHOD(rs_finishExpression, 1);
-   RS_REGISTER_CALL_METHOD(rs_getSourceIndexCompletions, 1);
+   RS_REGISTER_TYPED_CALL_METHOD(rs_getSourceIndexCompletions);
    RS_REGISTER_CALL_METHOD(rs_scanFiles, 4);
-   RS_REGISTER_CALL_METHOD(rs_isSubsequence, 2);
+   RS_REGISTER_TYPED_CALL_METHOD(rs_isSubsequence);
    RS_REGISTER_CALL_METHOD(rs_listInferredPackages, 1);
    RS_REGISTER_CALL_METHOD(rs_getInferredCompletions, 1);
    RS_REGISTER_CALL_METHOD(rs_getNAMESPACEImportedSymbols, 1);
    RS_REGISTER_CALL_METHOD(rs_getKnitParamsForDocument, 1);
    RS_REGISTER_CALL_METHOD(rs_listIndexedPackages, 0);
    
+   source_database::events().onDocRemoved.connect(onDocRemoved);
+   source_database::events().onRemoveAll.connect(onRemoveAll);
+   
    using boost::bind;
    using namespace module_context;
    ExecBlock initBlock;
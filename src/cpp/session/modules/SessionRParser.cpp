@@ -98,7 +98,22 @@ Error safeEvaluateString(const std::string& string,
    }
 }
 
-bool isDataTableSingleBracketCall(RTokenCursor& cursor)
+// Get the key for the call at the cursor in an RSnapshot: the code
+// evaluated for the function (assignment calls, e.g. 'names(x) <- y', are
+// resolved differently so are keyed separately)
+std::string snapshotKey(const RTokenCursor& cursor)
+{
+   std::string key = string_utils::wideToUtf8(
+            cursor.getEvaluationAssociatedWithCall());
+   
+   if (cursor.isAssignmentCall())
+      key += " <-";
+   
+   return key;
+}
+
+// Get the code evaluated for the object subset by the '[' at the cursor
+bool singleBracketObject(const RTokenCursor& cursor, std::string* pObject)
 {
    if (!cursor.contentEquals(L"["))
       return false;
@@ -118,22 +133,42 @@ bool isDataTableSingleBracketCall(RTokenCursor& cursor)
             startCursor.currentToken().begin(),
             cursor.currentToken().begin()));
    
+   // Avoid evaluating function calls
    if (objectString.find('(') != std::string::npos)
       return false;
    
+   *pObject = objectString;
+   return true;
+}
+
+bool isDataTable(const std::string& object)
+{
    // avoid output leaking to console
    r::session::utils::SuppressOutputInScope scope;
    
    // Get the object and check if it inherits from data.table
    SEXP objectSEXP;
    r::sexp::Protect protect;
-   Error error = safeEvaluateString(objectString, &objectSEXP, &protect);
+   Error error = safeEvaluateString(object, &objectSEXP, &protect);
    if (error)
       return false;
    
    return r::sexp::inherits(objectSEXP, "data.table");
 }
 
+bool isDataTableSingleBracketCall(RTokenCursor& cursor,
+                                  const ParseStatus& status)
+{
+   std::string object;
+   if (!singleBracketObject(cursor, &object))
+      return false;
+   
+   if (const RSnapshot* pSnapshot = status.parseOptions().rSnapshot())
+      return pSnapshot->isDataTable(object);
+   
+   return isDataTable(object);
+}
+
 class NSEDatabase : boost::noncopyable
 {
 public:
@@ -335,37 +370,11 @@ bool maybePerformsNSE(RTokenCursor cursor)
    return false;
 }
 
-bool mightPerformNonstandardEvaluation(const RTokenCursor& origin,
-                                       ParseStatus& status)
+// Check whether the function called at the cursor performs NSE, using the
+// source index and (failing that) the function on the search path.
+bool performsNseOutsideDocument(const RTokenCursor& cursor,
+                                const FilePath& filePath)
 {
-   RTokenCursor cursor = origin.clone();
-   
-   if (canOpenArgumentList(cursor))
-      if (!cursor.moveToPreviousSignificantToken())
-         return false;
-   
-   if (!canOpenArgumentList(cursor.nextSignificantToken()))
-      return false;
-   
-   DEBUG("- Checking whether NSE performed here: " << cursor);
-   
-   // TODO: How should we resolve conflicts between a function on
-   // the search path with some set of arguments, versus an identically
-   // named function in the source document which has not yet been sourced?
-   //
-   // For now, we prefer the current source document + the source
-   // index, and then use the search path after if necessary.
-   const ParseNode* pNode;
-   if (status.node()->findFunction(cursor.contentAsUtf8(),
-                                   cursor.currentPosition(),
-                                   &pNode))
-   {
-      DEBUG("--- Found function in parse tree: '" << pNode->name() << "'");
-      if (cursor.moveToPosition(pNode->position()))
-         if (maybePerformsNSE(cursor))
-            return true;
-   }
-   
    // Search the R source index if this is a simple call, and
    // we're within a package project.
    const std::string& symbol = cursor.contentAsUtf8();
@@ -390,10 +399,10 @@ bool mightPerformNonstandardEvaluation(const RTokenCursor& origin,
    bool failed = false;
    
    std::vector<std::string> inferredPkgs;
-   if (status.filePath().exists())
+   if (filePath.exists())
    {
       boost::shared_ptr<RSourceIndex> pIndex =
-            code_search::rSourceIndex().get(status.filePath());
+            code_search::rSourceIndex().get(filePath);
       
       if (pIndex)
          inferredPkgs = pIndex->getInferredPackages();
@@ -447,6 +456,44 @@ bool mightPerformNonstandardEvaluation(const RTokenCursor& origin,
    return result;
 }
 
+bool mightPerformNonstandardEvaluation(const RTokenCursor& origin,
+                                       ParseStatus& status)
+{
+   RTokenCursor cursor = origin.clone();
+   
+   if (canOpenArgumentList(cursor))
+      if (!cursor.moveToPreviousSignificantToken())
+         return false;
+   
+   if (!canOpenArgumentList(cursor.nextSignificantToken()))
+      return false;
+   
+   DEBUG("- Checking whether NSE performed here: " << cursor);
+   
+   // TODO: How should we resolve conflicts between a function on
+   // the search path with some set of arguments, versus an identically
+   // named function in the source document which has not yet been sourced?
+   //
+   // For now, we prefer the current source document + the source
+   // index, and then use the search path after if necessary.
+   const ParseNode* pNode;
+   if (status.node()->findFunction(cursor.contentAsUtf8(),
+                                   cursor.currentPosition(),
+                                   &pNode))
+   {
+      DEBUG("--- Found function in parse tree: '" << pNode->name() << "'");
+      RTokenCursor definition = cursor.clone();
+      if (definition.moveToPosition(pNode->position()))
+         if (maybePerformsNSE(definition))
+            return true;
+   }
+   
+   if (const RSnapshot* pSnapshot = status.parseOptions().rSnapshot())
+      return pSnapshot->performsNse(snapshotKey(cursor));
+   
+   return performsNseOutsideDocument(cursor, status.filePath());
+}
+
 } // end anonymous namespace
 
 std::string& complement(const std::string& bracket)
@@ -979,6 +1026,73 @@ bool extractInfoFromFunctionDefinition(
 }
 
 
+// Get the information for the function called at the cursor from the source
+// index or (failing that) the function on the search path.
+FunctionInformation getInfoAssociatedWithFunctionOutsideDocument(
+      RTokenCursor cursor,
+      const FilePath& filePath)
+{
+   if (cursor.isSimpleCall())
+   {
+      if (cursor.isType(RToken::LPAREN))
+         if (!cursor.moveToPreviousSignificantToken())
+            return FunctionInformation();
+      
+      // If we're within a package project, then attempt searching the
+      // source index for the formals associated with this function.
+      const std::string& fnName = cursor.contentAsUtf8();
+      if (projects::projectContext().isPackageProject())
+      {
+         std::string pkgName = projects::projectContext().packageInfo().name();
+         if (RSourceIndex::hasFunctionInformation(fnName, pkgName))
+                  return RSourceIndex::getFunctionInformation(fnName, pkgName);
+      }
+      
+      // Try looking up the symbol by name.
+      bool lookupFailed = false;
+      std::vector<std::string> inferredPkgs;
+      if (filePath.exists())
+      {
+         boost::shared_ptr<RSourceIndex> pIndex =
+               code_search::rSourceIndex().get(filePath);
+
+         if (pIndex)
+            inferredPkgs = pIndex->getInferredPackages();
+      }
+      
+      FunctionInformation info =
+            RSourceIndex::getFunctionInformationAnywhere(fnName, inferredPkgs, &lookupFailed);
+      
+      if (!lookupFailed)
+         return info;
+      
+   }
+   
+   // If the above failed, we'll fall back to evaluating and looking up
+   // the symbol on the search path.
+   r::sexp::Protect protect;
+   SEXP functionSEXP = resolveFunctionAssociatedWithCall(cursor, &protect);
+   if (functionSEXP == R_UnboundValue || !Rf_isFunction(functionSEXP))
+      return FunctionInformation();
+   
+   // Get the formals associated with this function.
+   FunctionInformation info(
+            string_utils::wideToUtf8(cursor.getEvaluationAssociatedWithCall()),
+            r::sexp::environmentName(functionSEXP));
+   
+   Error error = r::sexp::extractFunctionInfo(
+            functionSEXP,
+            &info,
+            true,
+            true);
+   
+   if (error)
+      LOG_ERROR(error);
+   
+   return info;
+   
+}
+
 // Extract formals from the underlying object mapped by the symbol, or expression,
 // at the cursor. This involves (potentially) evaluating the expresion forming
 // the function object, e.g.
@@ -1046,60 +1160,12 @@ FunctionInformation getInfoAssociatedWithFunctionAtCursor(
       // supply incorrect diagnostics, rather than attempt to supply correct diagnostics.
       if (status.node()->findVariable(cursor.contentAsUtf8(), cursor.currentPosition()))
          return FunctionInformation();
-      
-      // If we're within a package project, then attempt searching the
-      // source index for the formals associated with this function.
-      const std::string& fnName = cursor.contentAsUtf8();
-      if (projects::projectContext().isPackageProject())
-      {
-         std::string pkgName = projects::projectContext().packageInfo().name();
-         if (RSourceIndex::hasFunctionInformation(fnName, pkgName))
-                  return RSourceIndex::getFunctionInformation(fnName, pkgName);
-      }
-      
-      // Try looking up the symbol by name.
-      bool lookupFailed = false;
-      std::vector<std::string> inferredPkgs;
-      if (status.filePath().exists())
-      {
-         boost::shared_ptr<RSourceIndex> pIndex =
-               code_search::rSourceIndex().get(status.filePath());
-
-         if (pIndex)
-            inferredPkgs = pIndex->getInferredPackages();
-      }
-      
-      FunctionInformation info =
-            RSourceIndex::getFunctionInformationAnywhere(fnName, inferredPkgs, &lookupFailed);
-      
-      if (!lookupFailed)
-         return info;
-      
    }
    
-   // If the above failed, we'll fall back to evaluating and looking up
-   // the symbol on the search path.
-   r::sexp::Protect protect;
-   SEXP functionSEXP = resolveFunctionAssociatedWithCall(cursor, &protect);
-   if (functionSEXP == R_UnboundValue || !Rf_isFunction(functionSEXP))
-      return FunctionInformation();
-   
-   // Get the formals associated with this function.
-   FunctionInformation info(
-            string_utils::wideToUtf8(cursor.getEvaluationAssociatedWithCall()),
-            r::sexp::environmentName(functionSEXP));
-   
-   Error error = r::sexp::extractFunctionInfo(
-            functionSEXP,
-            &info,
-            true,
-            true);
-   
-   if (error)
-      LOG_ERROR(error);
-   
-   return info;
+   if (const RSnapshot* pSnapshot = status.parseOptions().rSnapshot())
+      return pSnapshot->functionInfo(snapshotKey(cursor));
    
+   return getInfoAssociatedWithFunctionOutsideDocument(cursor, status.filePath());
 }
 
 // This class represents a matched call, similar to the result from R's
@@ -1535,6 +1601,32 @@ void checkBinaryOperatorWhitespace(RTokenCursor& cursor,
    }
 }
 
+// Get the R function which finds the symbols made available within the
+// methods of a class defined by the call at the cursor, if any
+const char* classSymbolsFunction(const RTokenCursor& cursor)
+{
+   if (cursor.contentEquals(L"setRefClass"))
+      return ".rs.getSetRefClassSymbols";
+   else if (cursor.contentEquals(L"R6Class"))
+      return ".rs.getR6ClassSymbols";
+   else
+      return NULL;
+}
+
+std::set<std::string> classSymbols(const char* function,
+                                   const std::string& call)
+{
+   std::set<std::string> symbols;
+   r::exec::RFunction getClassSymbols(function);
+   getClassSymbols.addParam(call);
+   
+   Error error = getClassSymbols.call(&symbols);
+   if (error)
+      LOG_ERROR(error);
+   
+   return symbols;
+}
+
 void addExtraScopedSymbolsForCall(RTokenCursor startCursor,
                                   ParseStatus& status)
 {
@@ -1542,61 +1634,30 @@ void addExtraScopedSymbolsForCall(RTokenCursor startCursor,
       if (!startCursor.moveToPreviousSignificantToken())
          return;
    
-   if (startCursor.contentEquals(L"setRefClass"))
-   {
-      RTokenCursor endCursor = startCursor.clone();
-      if (!endCursor.moveToNextSignificantToken())
-         return;
-      
-      if (!endCursor.fwdToMatchingToken())
-         return;
-      
-      std::set<std::string> symbols;
-      r::exec::RFunction getSetRefClassCall(".rs.getSetRefClassSymbols");
-      getSetRefClassCall.addParam(
-               string_utils::wideToUtf8(
-                  std::wstring(startCursor.begin(), endCursor.end())));
-      
-      Error error = getSetRefClassCall.call(&symbols);
-      if (error)
-      {
-         LOG_ERROR(error);
-         return;
-      }
-      
-      status.makeSymbolsAvailableInRange(
-               symbols,
-               startCursor.currentPosition(),
-               endCursor.currentPosition());
-   }
+   const char* function = classSymbolsFunction(startCursor);
+   if (function == NULL)
+      return;
    
-   if (startCursor.contentEquals(L"R6Class"))
-   {
-      RTokenCursor endCursor = startCursor.clone();
-      if (!endCursor.moveToNextSignificantToken())
-         return;
-      
-      if (!endCursor.fwdToMatchingToken())
-         return;
-      
-      std::set<std::string> symbols;
-      r::exec::RFunction getR6ClassSymbols(".rs.getR6ClassSymbols");
-      getR6ClassSymbols.addParam(
-               string_utils::wideToUtf8(std::wstring(startCursor.begin(), endCursor.end())));
-      
-      Error error = getR6ClassSymbols.call(&symbols);
-      if (error)
-      {
-         LOG_ERROR(error);
-         return;
-      }
-      
-      status.makeSymbolsAvailableInRange(
-               symbols,
-               startCursor.currentPosition(),
-               endCursor.currentPosition());
-   }
+   RTokenCursor endCursor = startCursor.clone();
+   if (!endCursor.moveToNextSignificantToken())
+      return;
    
+   if (!endCursor.fwdToMatchingToken())
+      return;
+   
+   std::string call = string_utils::wideToUtf8(
+            std::wstring(startCursor.begin(), endCursor.end()));
+   
+   std::set<std::string> symbols;
+   if (const RSnapshot* pSnapshot = status.parseOptions().rSnapshot())
+      symbols = pSnapshot->classSymbols(call);
+   else
+      symbols = classSymbols(function, call);
+   
+   status.makeSymbolsAvailableInRange(
+            symbols,
+            startCursor.currentPosition(),
+            endCursor.currentPosition());
 }
 
 void validateFunctionCall(RTokenCursor cursor,
@@ -1961,6 +2022,25 @@ bool handleElseToken(RTokenCursor& cursor,
    return true;
 }
 
+// Get the names of the object subset by the call at the cursor
+bool objectNamesAssociatedWithCall(const RTokenCursor& cursor,
+                                   std::vector<std::string>* pNames)
+{
+   r::sexp::Protect protect;
+   SEXP objectSEXP = resolveObjectAssociatedWithCall(cursor, &protect);
+   if (objectSEXP == R_UnboundValue)
+      return false;
+   
+   r::exec::RFunction getNames(".rs.getNames");
+   getNames.addParam(objectSEXP);
+   
+   Error error = getNames.call(pNames);
+   if (error)
+      LOG_ERROR(error);
+   
+   return true;
+}
+
 bool makeSymbolsAvailableInCallFromObjectNames(RTokenCursor cursor,
                                                ParseStatus& status)
 {
@@ -1972,27 +2052,29 @@ bool makeSymbolsAvailableInCallFromObjectNames(RTokenCursor cursor,
    if (!endCursor.fwdToMatchingToken())
       return false;
    
-   r::sexp::Protect protect;
-   SEXP objectSEXP = resolveObjectAssociatedWithCall(startCursor, &protect);
-   if (objectSEXP != R_UnboundValue)
+   std::vector<std::string> names;
+   if (const RSnapshot* pSnapshot = status.parseOptions().rSnapshot())
    {
-      r::exec::RFunction getNames(".rs.getNames");
-      getNames.addParam(objectSEXP);
-      
-      std::vector<std::string> names;
-      Error error = getNames.call(&names);
-      if (error)
-         LOG_ERROR(error);
-      
-      status.makeSymbolsAvailableInRange(
-               names,
-               startCursor.currentPosition(),
-               endCursor.currentPosition(true));
+      std::string object;
+      if (!singleBracketObject(startCursor, &object) ||
+          !pSnapshot->isDataTable(object))
+      {
+         return false;
+      }
       
-      return true;
+      names = pSnapshot->dataTableNames(object);
+   }
+   else if (!objectNamesAssociatedWithCall(startCursor, &names))
+   {
+      return false;
    }
    
-   return false;
+   status.makeSymbolsAvailableInRange(
+            names,
+            startCursor.currentPosition(),
+            endCursor.currentPosition(true));
+   
+   return true;
 }
 
 } // anonymous namespace
@@ -2428,7 +2510,7 @@ ARGUMENT_LIST:
       }
       
       // Skip over data.table `[` calls
-      if (isDataTableSingleBracketCall(cursor))
+      if (isDataTableSingleBracketCall(cursor, status))
          makeSymbolsAvailableInCallFromObjectNames(cursor, status);
       
       status.pushBracket(cursor);
@@ -2720,6 +2802,75 @@ INVALID_TOKEN:
    return;
 }
 
+void collectRSnapshot(const FilePath& filePath,
+                      const std::wstring& rCode,
+                      const ParseOptions& parseOptions,
+                      RSnapshot* pSnapshot)
+{
+   RTokens rTokens(rCode, RTokens::StripComments);
+   
+   // build the (static) set of NSE primitives here rather than on the
+   // thread parsing with the snapshot
+   wideNsePrimitives();
+   
+   // each call site is resolved as the parser would resolve it (see
+   // ARGUMENT_LIST in doParse)
+   std::set<std::string> objects;
+   for (std::size_t i = 0, n = rTokens.size(); i < n; ++i)
+   {
+      const RToken& token = rTokens.atUnsafe(i);
+      if (token.isType(RToken::LPAREN))
+      {
+         RTokenCursor cursor(rTokens, i);
+         if (!cursor.moveToPreviousSignificantToken())
+            continue;
+         
+         std::string call = snapshotKey(cursor);
+         if (!pSnapshot->hasNse(call))
+         {
+            pSnapshot->setPerformsNse(
+                     call,
+                     performsNseOutsideDocument(cursor, filePath));
+         }
+         
+         if (parseOptions.checkArgumentsToRFunctionCalls() &&
+             !pSnapshot->hasFunctionInfo(call))
+         {
+            pSnapshot->setFunctionInfo(
+                     call,
+                     getInfoAssociatedWithFunctionOutsideDocument(cursor, filePath));
+         }
+         
+         if (const char* function = classSymbolsFunction(cursor))
+         {
+            RTokenCursor endCursor(rTokens, i);
+            if (!endCursor.fwdToMatchingToken())
+               continue;
+            
+            std::string classCall = string_utils::wideToUtf8(
+                     std::wstring(cursor.begin(), endCursor.end()));
+            
+            if (!pSnapshot->hasClassSymbols(classCall))
+               pSnapshot->setClassSymbols(classCall, classSymbols(function, classCall));
+         }
+      }
+      else if (token.isType(RToken::LBRACKET))
+      {
+         RTokenCursor cursor(rTokens, i);
+         std::string object;
+         if (!singleBracketObject(cursor, &object))
+            continue;
+         
+         if (!objects.insert(object).second)
+            continue;
+         
+         std::vector<std::string> names;
+         if (isDataTable(object) && objectNamesAssociatedWithCall(cursor, &names))
+            pSnapshot->setDataTableNames(object, names);
+      }
+   }
+}
+
 } // namespace rparser
 } // namespace modules
 } // namespace session
@@ -42,6 +42,7 @@
 #include <boost/bind.hpp>
 #include <boost/container/flat_set.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string.hpp>
 
@@ -54,6 +55,106 @@ namespace rparser {
 
 using namespace core::collection;
 
+// The results of the lookups into R the parser makes while linting a
+// document: whether the functions it calls perform non-standard evaluation,
+// their formals, the names of the data.table objects it subsets, and the
+// symbols made available within reference class definitions. Each is keyed
+// by the code evaluated for the call (e.g. 'foo', 'pkg::foo', 'x$y').
+//
+// The parser normally makes these lookups as it goes, which ties parsing
+// to the main thread. When the parse options carry a snapshot (collected on
+// the main thread by collectRSnapshot) the parser consults it instead and
+// never touches R, so the parse itself can run on a background thread.
+class RSnapshot
+{
+public:
+
+   // calls missing from the snapshot are assumed to perform NSE, so that
+   // we don't report symbols which might be evaluated elsewhere
+   bool performsNse(const std::string& call) const
+   {
+      std::map<std::string, bool>::const_iterator it = nse_.find(call);
+      return it == nse_.end() || it->second;
+   }
+
+   bool hasNse(const std::string& call) const
+   {
+      return nse_.count(call);
+   }
+
+   void setPerformsNse(const std::string& call, bool performsNse)
+   {
+      nse_[call] = performsNse;
+   }
+
+   core::r_util::FunctionInformation functionInfo(const std::string& call) const
+   {
+      std::map<std::string, core::r_util::FunctionInformation>::const_iterator it =
+            functionInfo_.find(call);
+
+      if (it == functionInfo_.end())
+         return core::r_util::FunctionInformation();
+
+      return it->second;
+   }
+
+   bool hasFunctionInfo(const std::string& call) const
+   {
+      return functionInfo_.count(call);
+   }
+
+   void setFunctionInfo(const std::string& call,
+                        const core::r_util::FunctionInformation& info)
+   {
+      functionInfo_[call] = info;
+   }
+
+   // objects that aren't data.tables have no names recorded
+   bool isDataTable(const std::string& object) const
+   {
+      return dataTableNames_.count(object);
+   }
+
+   const std::vector<std::string>& dataTableNames(const std::string& object) const
+   {
+      static const std::vector<std::string> empty;
+      std::map<std::string, std::vector<std::string> >::const_iterator it =
+            dataTableNames_.find(object);
+      return it == dataTableNames_.end() ? empty : it->second;
+   }
+
+   void setDataTableNames(const std::string& object,
+                          const std::vector<std::string>& names)
+   {
+      dataTableNames_[object] = names;
+   }
+
+   const std::set<std::string>& classSymbols(const std::string& call) const
+   {
+      static const std::set<std::string> empty;
+      std::map<std::string, std::set<std::string> >::const_iterator it =
+            classSymbols_.find(call);
+      return it == classSymbols_.end() ? empty : it->second;
+   }
+
+   bool hasClassSymbols(const std::string& call) const
+   {
+      return classSymbols_.count(call);
+   }
+
+   void setClassSymbols(const std::string& call,
+                        const std::set<std::string>& symbols)
+   {
+      classSymbols_[call] = symbols;
+   }
+
+private:
+   std::map<std::string, bool> nse_;
+   std::map<std::string, core::r_util::FunctionInformation> functionInfo_;
+   std::map<std::string, std::vector<std::string> > dataTableNames_;
+   std::map<std::string, std::set<std::string> > classSymbols_;
+};
+
 class ParseOptions
 {
 public:
@@ -147,14 +248,27 @@ public:
    std::set<std::string>& globals() { return globals_; }
    const std::set<std::string>& globals() const { return globals_; }
 
+   // when set, R lookups are answered by the snapshot (see RSnapshot)
+   void setRSnapshot(boost::shared_ptr<const RSnapshot> pSnapshot)
+   {
+      pRSnapshot_ = pSnapshot;
+   }
+
+   const RSnapshot* rSnapshot() const
+   {
+      return pRSnapshot_.get();
+   }
+
 private:
    bool lintRFunctions_;
    bool checkArgumentsToRFunctionCalls_;
    bool warnIfNoSuchVariableInScope_;
    bool warnIfVariableIsDefinedButNotUsed_;
    bool recordStyleLint_;
-   
+
    std::set<std::string> globals_;
+
+   boost::shared_ptr<const RSnapshot> pRSnapshot_;
 };
 
 struct ParseItem;
@@ -515,6 +629,8 @@ using namespace linter;
 
 std::string& complement(const std::string& bracket);
 
+class ParseNodeArena;
+
 class ParseNode : public boost::noncopyable
 {
    
@@ -530,6 +646,8 @@ public:
    
 private:
    
+   friend class ParseNodeArena;
+   
    // private constructor: root node should be created through
    // 'createRootNode()', with future nodes appended to that node;
    // child nodes with 'createChildNode()'.
@@ -539,7 +657,7 @@ private:
    ParseNode(ParseNode* pParent,
              const std::string& name,
              Position position)
-      : pParent_(pParent), name_(name), position_(position) {}
+      : pParent_(pParent), pArena_(NULL), name_(name), position_(position) {}
    
 public:
    
@@ -649,12 +767,49 @@ public:
       return children_;
    }
    
+   // NOTE: children allocated in the same arena as this node are referenced
+   // without sharing ownership of it (the arena would otherwise own itself)
    void addChild(boost::shared_ptr<ParseNode>& pChild,
-                 const Position& position)
+                 const Position& position);
+   
+   // Incremental parsing: add the symbols and child scopes of 'other'
+   // positioned within rows [beginRow, endRow) to this node (the scopes are
+   // shared, and become children of this node)
+   void addContentsInRows(const ParseNode& other,
+                          std::size_t beginRow,
+                          std::size_t endRow)
+   {
+      copySymbolsInRows(other.definedSymbols_, beginRow, endRow, &definedSymbols_);
+      copySymbolsInRows(other.referencedSymbols_, beginRow, endRow, &referencedSymbols_);
+      copySymbolsInRows(other.nseReferencedSymbols_, beginRow, endRow, &nseReferencedSymbols_);
+      
+      for (PackageSymbols::const_iterator it = other.internalSymbols_.begin();
+           it != other.internalSymbols_.end();
+           ++it)
+         internalSymbols_[it->first].insert(it->second.begin(), it->second.end());
+      
+      for (PackageSymbols::const_iterator it = other.exportedSymbols_.begin();
+           it != other.exportedSymbols_.end();
+           ++it)
+         exportedSymbols_[it->first].insert(it->second.begin(), it->second.end());
+      
+      BOOST_FOREACH(boost::shared_ptr<ParseNode> pChild, other.children_)
+      {
+         if (pChild->position_.row >= beginRow && pChild->position_.row < endRow)
+            addChild(pChild, pChild->position_);
+      }
+   }
+   
+   // Move this node, and the nodes below it, by the given number of rows
+   void shiftRows(int delta)
    {
-      pChild->pParent_ = this;
-      pChild->position_ = position;
-      children_.push_back(pChild);
+      position_.row += delta;
+      shiftSymbolRows(&definedSymbols_, delta);
+      shiftSymbolRows(&referencedSymbols_, delta);
+      shiftSymbolRows(&nseReferencedSymbols_, delta);
+      
+      BOOST_FOREACH(boost::shared_ptr<ParseNode>& pChild, children_)
+         pChild->shiftRows(delta);
    }
    
    void findAllUnresolvedSymbols(std::vector<ParseItem>* pItems) const
@@ -664,9 +819,9 @@ public:
       pItems->insert(pItems->end(), unresolved.begin(), unresolved.end());
       
       // Apply this over all children on the node
-      Children children = getChildren();
+      const Children& children = getChildren();
       
-      for (Children::iterator it = children.begin();
+      for (Children::const_iterator it = children.begin();
            it != children.end();
            ++it)
       {
@@ -682,6 +837,34 @@ public:
    
 private:
    
+   static void copySymbolsInRows(const SymbolPositions& from,
+                                 std::size_t beginRow,
+                                 std::size_t endRow,
+                                 SymbolPositions* pTo)
+   {
+      for (SymbolPositions::const_iterator it = from.begin();
+           it != from.end();
+           ++it)
+      {
+         BOOST_FOREACH(const Position& position, it->second)
+         {
+            if (position.row >= beginRow && position.row < endRow)
+               (*pTo)[it->first].push_back(position);
+         }
+      }
+   }
+   
+   static void shiftSymbolRows(SymbolPositions* pSymbols, int delta)
+   {
+      for (SymbolPositions::iterator it = pSymbols->begin();
+           it != pSymbols->end();
+           ++it)
+      {
+         BOOST_FOREACH(Position& position, it->second)
+            position.row += delta;
+      }
+   }
+   
    static bool findFunctionImpl(const ParseNode* pNode,
                                 const std::string& name,
                                 const Position& position,
@@ -961,6 +1144,9 @@ private:
    // tree reference -- children and parent
    ParseNode* pParent_;
    
+   // the arena owning this node (if any)
+   ParseNodeArena* pArena_;
+   
    Children children_;
    
    // member variables
@@ -994,13 +1180,116 @@ private:
    }
 };
 
+
+// Allocates the nodes of a parse tree in blocks, rather than one at a time,
+// and frees them all at once. The nodes are handed out as pointers sharing
+// ownership of the arena, so the arena lives for as long as any of its nodes
+// are referenced (e.g. by the tree of a later incremental parse).
+class ParseNodeArena : public boost::noncopyable,
+                       public boost::enable_shared_from_this<ParseNodeArena>
+{
+private:
+   
+   ParseNodeArena()
+      : used_(kBlockSize)
+   {
+   }
+   
+public:
+   
+   static boost::shared_ptr<ParseNodeArena> create()
+   {
+      return boost::shared_ptr<ParseNodeArena>(new ParseNodeArena());
+   }
+   
+   ~ParseNodeArena()
+   {
+      // destroy the nodes in the reverse order of their creation
+      for (std::size_t i = blocks_.size(); i != 0; --i)
+      {
+         ParseNode* pBlock = blocks_[i - 1];
+         std::size_t n = (i == blocks_.size()) ? used_ : kBlockSize;
+         for (std::size_t j = n; j != 0; --j)
+            pBlock[j - 1].~ParseNode();
+         
+         ::operator delete(pBlock);
+      }
+   }
+   
+   boost::shared_ptr<ParseNode> createRootNode()
+   {
+      return allocate("<root>");
+   }
+   
+   boost::shared_ptr<ParseNode> createNode(const std::string& name)
+   {
+      return allocate(name);
+   }
+   
+   std::size_t size() const
+   {
+      if (blocks_.empty())
+         return 0;
+      
+      return (blocks_.size() - 1) * kBlockSize + used_;
+   }
+   
+private:
+   
+   boost::shared_ptr<ParseNode> allocate(const std::string& name)
+   {
+      if (used_ == kBlockSize)
+      {
+         blocks_.reserve(blocks_.size() + 1);
+         blocks_.push_back(static_cast<ParseNode*>(
+               ::operator new(kBlockSize * sizeof(ParseNode))));
+         used_ = 0;
+      }
+      
+      ParseNode* pNode = blocks_.back() + used_;
+      new (pNode) ParseNode(NULL, name, Position(0, 0));
+      pNode->pArena_ = this;
+      ++used_;
+      
+      return share(pNode);
+   }
+   
+   boost::shared_ptr<ParseNode> share(ParseNode* pNode)
+   {
+      return boost::shared_ptr<ParseNode>(shared_from_this(), pNode);
+   }
+   
+   friend class ParseNode;
+   
+   static const std::size_t kBlockSize = 64;
+   
+   std::vector<ParseNode*> blocks_;
+   std::size_t used_;
+};
+
+inline void ParseNode::addChild(boost::shared_ptr<ParseNode>& pChild,
+                                const Position& position)
+{
+   pChild->pParent_ = this;
+   pChild->position_ = position;
+   
+   if (pChild->pArena_ == NULL)
+      children_.push_back(pChild);
+   else if (pChild->pArena_ == pArena_)
+      children_.push_back(boost::shared_ptr<ParseNode>(
+                             boost::shared_ptr<ParseNode>(), pChild.get()));
+   else
+      children_.push_back(pChild->pArena_->share(pChild.get()));
+}
+
 class ParseStatus
 {
    
 public:
    
    explicit ParseStatus(const FilePath& filePath, const ParseOptions& parseOptions)
-      : pRoot_(ParseNode::createRootNode()),
+      : pArena_(ParseNodeArena::create()),
+        pRoot_(pArena_->createRootNode()),
         pNode_(pRoot_.get()),
         lint_(parseOptions),
         parseOptions_(parseOptions),
@@ -1097,7 +1386,7 @@ public:
                            const Position& position)
    {
       addChildAndSetAsCurrentNode(
-               ParseNode::createNode(name),
+               pArena_->createNode(name),
                position);
       
       DEBUG("Entering function scope: '" << name << "' at " << position);
@@ -1379,6 +1668,7 @@ public:
    }
 
 private:
+   boost::shared_ptr<ParseNodeArena> pArena_;
    boost::shared_ptr<ParseNode> pRoot_;
    ParseNode* pNode_;
    LintItems lint_;
@@ -1462,6 +1752,14 @@ ParseResults parse(const std::string& rCode,
 ParseResults parse(const std::wstring& rCode,
                    const ParseOptions& parseOptions = ParseOptions());
 
+// Make the lookups into R that parsing the code with the given options
+// would, recording their results in the snapshot. Must be called on the
+// main thread.
+void collectRSnapshot(const core::FilePath& filePath,
+                      const std::wstring& rCode,
+                      const ParseOptions& parseOptions,
+                      RSnapshot* pSnapshot);
+
 } // namespace rparser
 } // namespace modules
 } // namespace session
@@ -21,8 +21,10 @@
 #include <core/FileSerializer.hpp>
 #include <core/Macros.hpp>
 #include <core/YamlUtil.hpp>
+#include <core/json/JsonWriter.hpp>
 
 #include <r/RExec.hpp>
+#include <r/RJson.hpp>
 #include <r/RRoutines.hpp>
 #include <r/RSexp.hpp>
 
@@ -126,6 +128,21 @@ SEXP rs_fromJSON(SEXP objectSEXP)
    return r::sexp::create(jsonValue, &protect);
 }
 
+SEXP rs_writeJSON(SEXP objectSEXP)
+{
+   std::string output;
+   json::Writer writer(&output);
+   Error error = r::json::writeJsonFromObject(objectSEXP, &writer);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return R_NilValue;
+   }
+
+   r::sexp::Protect protect;
+   return r::sexp::create(output, &protect);
+}
+
 SEXP rs_isNullExternalPointer(SEXP objectSEXP)
 {
    using namespace r::sexp;
@@ -295,6 +312,7 @@ SEXP rs_runAsyncRProcess(SEXP codeSEXP,
 Error initialize()
 {
    RS_REGISTER_CALL_METHOD(rs_fromJSON, 1);
+   RS_REGISTER_CALL_METHOD(rs_writeJSON, 1);
    RS_REGISTER_CALL_METHOD(rs_isNullExternalPointer, 1);
    RS_REGISTER_CALL_METHOD(rs_readIniFile, 1);
    RS_REGISTER_CALL_METHOD(rs_rResourcesPath, 0);
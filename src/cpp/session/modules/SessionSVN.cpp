@@ -15,6 +15,9 @@
 
 #include "SessionSVN.hpp"
 
+#include <limits>
+#include <map>
+
 #ifdef _WIN32
 #include <windows.h>
 #include <shlobj.h>
@@ -456,11 +459,25 @@ struct SvnInfo
 };
 
 
+// svn info results for working copies we've already asked about. the
+// repository root of a working copy only changes if it is relocated, so
+// there's no need to run svn again for every query (note that we don't
+// remember directories that aren't working copies, as they may become one)
+std::map<std::string, SvnInfo> s_svnInfoCache;
+
 Error runSvnInfo(const core::FilePath& workingDir, SvnInfo* pSvnInfo)
 {
    if (workingDir.empty())
       return Success();
 
+   std::map<std::string, SvnInfo>::const_iterator cached =
+         s_svnInfoCache.find(workingDir.absolutePath());
+   if (cached != s_svnInfoCache.end())
+   {
+      *pSvnInfo = cached->second;
+      return Success();
+   }
+
    core::system::ProcessResult result;
    Error error = runSvn(ShellArgs() << "info" << "--xml",
                         workingDir,
@@ -495,6 +512,8 @@ Error runSvnInfo(const core::FilePath& workingDir, SvnInfo* pSvnInfo)
 
       // get the value
       pSvnInfo->repositoryRoot = pRoot->value();
+      if (!pSvnInfo->empty())
+         s_svnInfoCache[workingDir.absolutePath()] = *pSvnInfo;
    }
 
    return Success();
@@ -1486,6 +1505,161 @@ void svnHistoryEnd(int skip,
    cont(Success(), &response);
 }
 
+// The log entries fetched so far for the history being viewed. Scrolling
+// through history requests successively larger pages; rather than fetch
+// the log from the start again for each one (a round trip to the server
+// that grows with every page), we keep what we have and fetch only the
+// entries that follow it.
+struct HistoryCache
+{
+   HistoryCache() : complete(false) {}
+
+   void reset(const std::string& newKey)
+   {
+      key = newKey;
+      commits.clear();
+      complete = false;
+   }
+
+   // the revision and file filter the history is for
+   std::string key;
+
+   std::vector<CommitInfo> commits;
+
+   // have we reached the first revision?
+   bool complete;
+};
+
+HistoryCache s_historyCache;
+
+Error appendCommit(std::vector<CommitInfo>* pCommits, const CommitInfo& commit)
+{
+   pCommits->push_back(commit);
+   return Success();
+}
+
+void respondWithCachedHistory(int skip,
+                              int maxentries,
+                              const json::JsonRpcFunctionContinuation& cont)
+{
+   json::Array ids;
+   json::Array authors;
+   json::Array subjects;
+   json::Array descriptions;
+   json::Array dates;
+
+   const std::vector<CommitInfo>& commits = s_historyCache.commits;
+   std::size_t begin = skip > 0 ? skip : 0;
+   std::size_t end = begin + (maxentries > 0 ? maxentries : 0);
+   for (std::size_t i = begin; i < end && i < commits.size(); i++)
+   {
+      svnHistoryEnd_CommitCallback(&ids, &authors, &subjects, &descriptions,
+                                   &dates, commits[i]);
+   }
+
+   json::Object result;
+   result["id"] = ids;
+   result["author"] = authors;
+   result["subject"] = subjects;
+   result["description"] = descriptions;
+   result["date"] = dates;
+
+   json::JsonRpcResponse response;
+   response.setResult(result);
+   cont(Success(), &response);
+}
+
+void svnCachedHistoryEnd(const std::string& key,
+                         std::size_t startSize,
+                         std::size_t limit,
+                         int skip,
+                         int maxentries,
+                         const json::JsonRpcFunctionContinuation& cont,
+                         Error error,
+                         const std::string& output)
+{
+   if (error)
+   {
+      json::JsonRpcResponse response;
+      cont(error, &response);
+      return;
+   }
+
+   std::vector<CommitInfo> commits;
+   error = parseHistoryXml(0, std::numeric_limits<int>::max(), std::string(),
+                           output, boost::bind(appendCommit, &commits, _1));
+   if (error)
+   {
+      json::JsonRpcResponse response;
+      cont(error, &response);
+      return;
+   }
+
+   // only extend the cache if it hasn't moved on (e.g. been reset by a
+   // reload) while we were waiting on svn
+   if (s_historyCache.key == key && s_historyCache.commits.size() == startSize)
+   {
+      s_historyCache.commits.insert(s_historyCache.commits.end(),
+                                    commits.begin(),
+                                    commits.end());
+      if (commits.size() < limit)
+         s_historyCache.complete = true;
+   }
+
+   respondWithCachedHistory(skip, maxentries, cont);
+}
+
+void svnCachedHistory(int rev,
+                      const FilePath& fileFilter,
+                      int skip,
+                      int maxentries,
+                      const json::JsonRpcFunctionContinuation& cont)
+{
+   // a request for the first page of history at HEAD is a (re)load, so
+   // start afresh in order to pick up new commits; an explicit revision
+   // range never changes
+   std::string key = safe_convert::numberToString(rev) + "\n" +
+                     fileFilter.absolutePath();
+   if (s_historyCache.key != key || (skip == 0 && rev <= 0))
+      s_historyCache.reset(key);
+
+   std::size_t size = s_historyCache.commits.size();
+   std::size_t needed = static_cast<std::size_t>(std::max(skip, 0)) +
+                        static_cast<std::size_t>(std::max(maxentries, 0));
+   if (s_historyCache.complete || size >= needed)
+   {
+      respondWithCachedHistory(skip, maxentries, cont);
+      return;
+   }
+
+   // continue from the revision before the last one we have
+   int startRev = rev;
+   if (size > 0)
+   {
+      startRev = safe_convert::stringTo<int>(s_historyCache.commits.back().id, 0) - 1;
+      if (startRev < 1)
+      {
+         s_historyCache.complete = true;
+         respondWithCachedHistory(skip, maxentries, cont);
+         return;
+      }
+   }
+
+   std::size_t limit = needed - size;
+   ShellArgs options;
+   options << "--limit" << safe_convert::numberToString(limit);
+   history(startRev, fileFilter, options,
+           boost::bind(svnCachedHistoryEnd,
+                       key,
+                       size,
+                       limit,
+                       skip,
+                       maxentries,
+                       cont,
+                       _1,
+                       _2));
+}
+
 void svnHistory(const json::JsonRpcRequest& request,
                 const json::JsonRpcFunctionContinuation& cont)
 {
@@ -1507,14 +1681,14 @@ void svnHistory(const json::JsonRpcRequest& request,
 
    ask_pass::setActiveWindow(request.sourceWindow);
 
-   ShellArgs options;
+   FilePath fileFilter = fileFilterPath(fileFilterJson);
    if (searchText.empty())
    {
-      int limit = skip + maxentries;
-      options << "--limit" << safe_convert::numberToString(limit);
+      svnCachedHistory(rev, fileFilter, skip, maxentries, cont);
+      return;
    }
 
-   FilePath fileFilter = fileFilterPath(fileFilterJson);
+   ShellArgs options;
    history(rev, fileFilter, options,
            boost::bind(svnHistoryEnd,
                        skip,
@@ -1902,7 +2076,7 @@ Error initializeSvn(const core::FilePath& workingDir)
    std::string repoURL = repositoryRoot(s_workingDir);
    s_isSvnSshRepository = boost::algorithm::starts_with(repoURL, "svn+ssh");
 
-   userSettings().onChanged.connect(onUserSettingsChanged);
+   userSettings().onKeyChanged(kUserSettingsSvnExePath, onUserSettingsChanged);
 
    return Success();
 }
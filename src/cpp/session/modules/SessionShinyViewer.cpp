@@ -290,8 +290,8 @@ Error initialize()
    r::routines::addCallMethod(methodDefViewer);
 
    events().onConsoleInput.connect(onConsoleInput);
-   userSettings().onChanged.connect(bind(onUserSettingsChanged,
-                                         pShinyViewerType));
+   userSettings().onKeyChanged(UserSettings::uiPrefKey("shiny_viewer_type"),
+                               bind(onUserSettingsChanged, pShinyViewerType));
 
    ExecBlock initBlock;
    initBlock.addFunctions()
@@ -145,7 +145,7 @@ void detectExtendedType(boost::shared_ptr<SourceDocument> pDoc)
 int numSourceDocuments()
 {
    std::vector<boost::shared_ptr<SourceDocument> > docs;
-   source_database::list(&docs);
+   source_database::list(&docs, false);
    return static_cast<int>(docs.size());
 }
 
@@ -372,16 +372,15 @@ Error saveDocumentCore(const std::string& contents,
       // note whether the file existed prior to writing
       bool newFile = !fullDocPath.exists();
 
-      // write the contents to the file
-      error = writeStringToFile(fullDocPath, encoded,
-                                module_context::lineEndings(fullDocPath));
+      // write the contents to the file (replacing it atomically, and
+      // durably, so a failed or interrupted save never truncates it)
+      error = writeStringToFileAtomically(fullDocPath, encoded,
+                                          module_context::lineEndings(fullDocPath));
       if (error)
          return error ;
 
-      // set the new path and contents for the document
-      error = pDoc->setPathAndContents(path);
-      if (error)
-         return error ;
+      // set the new path for the document (the contents are set below)
+      pDoc->setSavedPath(path);
 
       // enque file changed event if we need to
       if (!module_context::isDirectoryMonitored(fullDocPath.parent()))
@@ -516,6 +515,9 @@ Error saveDocumentDiff(const json::JsonRpcRequest& request,
       if (error)
          return Success(); // UTF8 decoding failed. Abort differential save.
 
+      std::size_t byteOffset = rangeBegin - contents.begin();
+      std::size_t byteLength = rangeEnd - rangeBegin;
+
       contents.erase(rangeBegin, rangeEnd);
       contents.insert(rangeBegin, replacement.begin(), replacement.end());
       
@@ -526,11 +528,26 @@ Error saveDocumentDiff(const json::JsonRpcRequest& request,
       if (error)
          return error;
       
-      // write to the source database (don't worry about writing document
-      // contents if those have not changed)
-      error = sourceDatabasePutWithUpdatedContents(pDoc, hasChanges);
-      if (error)
-         return error;
+      // write to the source database (logging just the change to the
+      // contents if there was one)
+      if (hasChanges)
+      {
+         error = source_database::putChange(pDoc,
+                                            hash,
+                                            byteOffset,
+                                            byteLength,
+                                            replacement);
+         if (error)
+            return error;
+
+         source_database::events().onDocUpdated(pDoc);
+      }
+      else
+      {
+         error = sourceDatabasePutWithUpdatedContents(pDoc, false);
+         if (error)
+            return error;
+      }
 
       pResponse->setResult(pDoc->hash());
    }
@@ -1031,7 +1048,7 @@ Error setDocOrder(const json::JsonRpcRequest& request,
    Error error = json::readParams(request.params, &ids);
    if (error)
       return error;
-   source_database::list(&docs);
+   source_database::list(&docs, false);
 
    BOOST_FOREACH( boost::shared_ptr<SourceDocument>& pDoc, docs )
    {
@@ -1043,7 +1060,7 @@ Error setDocOrder(const json::JsonRpcRequest& request,
              pDoc->relativeOrder() != static_cast<int>(i + 1))
          {
             pDoc->setRelativeOrder(i + 1);
-            source_database::put(pDoc);
+            source_database::put(pDoc, false);
          }
       }
    }
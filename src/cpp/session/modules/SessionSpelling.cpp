@@ -15,10 +15,15 @@
 
 #include "SessionSpelling.hpp"
 
+#include <set>
+
+#include <boost/foreach.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <core/Error.hpp>
 #include <core/Exec.hpp>
+#include <core/Thread.hpp>
+#include <core/collection/LruCache.hpp>
 
 #include <core/spelling/HunspellSpellingEngine.hpp>
 
@@ -29,6 +34,7 @@
 
 #include <session/SessionUserSettings.hpp>
 #include <session/SessionModuleContext.hpp>
+#include <session/SessionWorkerContext.hpp>
 
 using namespace rstudio::core;
 
@@ -42,13 +48,27 @@ namespace {
 // underlying spelling engine
 boost::scoped_ptr<core::spelling::SpellingEngine> s_pSpellingEngine;
 
+// checks and suggestions run on the rpc worker pool while dictionary
+// changes happen on the main thread, so all use of the engine is serialized
+boost::mutex s_spellingEngineMutex;
+
+// results of recent checks (documents repeat most of their words, and are
+// re-checked as they are edited); cleared whenever the dictionaries change
+const unsigned int kMaxCachedWords = 20000;
+core::collection::LruCache<std::string, bool> s_checkedWords(kMaxCachedWords);
+
 // R function for testing & debugging
 SEXP rs_checkSpelling(SEXP wordSEXP)
 {
-   bool isCorrect;
+   bool isCorrect = true;
    std::string word = r::sexp::asString(wordSEXP);
 
-   Error error = s_pSpellingEngine->checkSpelling(word, &isCorrect);
+   Error error;
+   LOCK_MUTEX(s_spellingEngineMutex)
+   {
+      error = s_pSpellingEngine->checkSpelling(word, &isCorrect);
+   }
+   END_LOCK_MUTEX
 
    // We'll return true here so as not to tie up the front end.
    if (error)
@@ -78,7 +98,12 @@ FilePath userDictionariesDir()
 
 void syncSpellingEngineDictionaries()
 {
-   s_pSpellingEngine->useDictionary(userSettings().spellingLanguage());
+   LOCK_MUTEX(s_spellingEngineMutex)
+   {
+      s_pSpellingEngine->useDictionary(userSettings().spellingLanguage());
+      s_checkedWords.clear();
+   }
+   END_LOCK_MUTEX
 }
 
 
@@ -116,7 +141,11 @@ Error checkSpelling(const json::JsonRpcRequest& request,
 
       std::string word = words[i].get_str();
       bool isCorrect = true;
-      error = s_pSpellingEngine->checkSpelling(word, &isCorrect);
+      LOCK_MUTEX(s_spellingEngineMutex)
+      {
+         error = s_pSpellingEngine->checkSpelling(word, &isCorrect);
+      }
+      END_LOCK_MUTEX
       if (error)
       {
          // if we can't check a word, ignore it; some combinations of platform, non-ASCII
@@ -135,6 +164,66 @@ Error checkSpelling(const json::JsonRpcRequest& request,
    return Success();
 }
 
+Error checkSpellingBatch(const json::JsonRpcRequest& request,
+                         json::JsonRpcResponse* pResponse)
+{
+   json::Array words;
+   Error error = json::readParams(request.params, &words);
+   if (error)
+      return error;
+
+   // check each distinct word once, consulting the cache first
+   std::set<std::string> distinctWords;
+   std::vector<std::string> uncheckedWords;
+   json::Array misspelledWords;
+   BOOST_FOREACH(const json::Value& wordJson, words)
+   {
+      if (!json::isType<std::string>(wordJson))
+      {
+         BOOST_ASSERT(false);
+         continue;
+      }
+
+      const std::string& word = wordJson.get_str();
+      if (!distinctWords.insert(word).second)
+         continue;
+
+      bool isCorrect = true;
+      if (!s_checkedWords.get(word, &isCorrect))
+         uncheckedWords.push_back(word);
+      else if (!isCorrect)
+         misspelledWords.push_back(word);
+   }
+
+   if (!uncheckedWords.empty())
+   {
+      LOCK_MUTEX(s_spellingEngineMutex)
+      {
+         BOOST_FOREACH(const std::string& word, uncheckedWords)
+         {
+            bool isCorrect = true;
+            error = s_pSpellingEngine->checkSpelling(word, &isCorrect);
+            if (error)
+            {
+               // as for check_spelling, words we can't check are treated as
+               // correct (but not cached, so they're retried later)
+               LOG_ERROR(error);
+               continue;
+            }
+
+            s_checkedWords.insert(word, isCorrect);
+            if (!isCorrect)
+               misspelledWords.push_back(word);
+         }
+      }
+      END_LOCK_MUTEX
+   }
+
+   pResponse->setResult(misspelledWords);
+
+   return Success();
+}
+
 Error suggestionList(const json::JsonRpcRequest& request,
                      json::JsonRpcResponse* pResponse)
 {
@@ -144,7 +233,11 @@ Error suggestionList(const json::JsonRpcRequest& request,
       return error;
 
    std::vector<std::string> sugs;
-   error = s_pSpellingEngine->suggestionList(word, &sugs);
+   LOCK_MUTEX(s_spellingEngineMutex)
+   {
+      error = s_pSpellingEngine->suggestionList(word, &sugs);
+   }
+   END_LOCK_MUTEX
    if (error)
       return error;
 
@@ -162,7 +255,12 @@ Error getWordChars(const json::JsonRpcRequest& request,
                    json::JsonRpcResponse* pResponse)
 {
    std::wstring wordChars;
-   Error error = s_pSpellingEngine->wordChars(&wordChars);
+   Error error;
+   LOCK_MUTEX(s_spellingEngineMutex)
+   {
+      error = s_pSpellingEngine->wordChars(&wordChars);
+   }
+   END_LOCK_MUTEX
    if (error)
       return error;
 
@@ -313,16 +411,21 @@ Error initialize()
                                              &r::util::iconvstr);
    s_pSpellingEngine.reset(pHunspell);
 
-   // connect to user settings changed
-   userSettings().onChanged.connect(onUserSettingsChanged);
+   // connect to changes in the spelling user settings
+   std::vector<std::string> spellingKeys;
+   spellingKeys.push_back(UserSettings::uiPrefKey("spelling_dictionary_language"));
+   spellingKeys.push_back(UserSettings::uiPrefKey("spelling_custom_dictionaries"));
+   userSettings().onKeysChanged(spellingKeys, onUserSettingsChanged);
 
    // register rpc methods
    using boost::bind;
    using namespace module_context;
    ExecBlock initBlock ;
+   using namespace worker_context;
    initBlock.addFunctions()
-      (bind(registerRpcMethod, "check_spelling", checkSpelling))
-      (bind(registerRpcMethod, "suggestion_list", suggestionList))
+      (bind(registerWorkerSafeRpcMethod, "check_spelling", checkSpelling))
+      (bind(registerWorkerSafeRpcMethod, "check_spelling_batch", checkSpellingBatch))
+      (bind(registerWorkerSafeRpcMethod, "suggestion_list", suggestionList))
       (bind(registerRpcMethod, "get_word_chars", getWordChars))
       (bind(registerRpcMethod, "add_custom_dictionary", addCustomDictionary))
       (bind(registerRpcMethod, "remove_custom_dictionary", removeCustomDictionary))
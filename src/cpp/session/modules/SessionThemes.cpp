@@ -24,6 +24,8 @@
 #include <core/Error.hpp>
 #include <core/Exec.hpp>
 #include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/json/JsonRpc.hpp>
 #include <core/system/System.hpp>
 
@@ -38,6 +40,8 @@
 
 #include <fstream>
 #include <map>
+#include <set>
+#include <sstream>
 #include <string>
 
 using namespace rstudio::core;
@@ -116,16 +120,196 @@ bool extractError(SEXP object, json::JsonRpcResponse* pResponse)
 }
 
 /**
- * @brief Gets themes in the specified location.
+ * @brief Reads the name and darkness of a theme from its file.
+ *
+ * @param themeFile     The theme file to read.
+ * @param pName         The name of the theme. (NOT OWN)
+ * @param pIsDark       Whether or not the theme is dark. (NOT OWN)
+ */
+void readThemeFile(const rstudio::core::FilePath& themeFile,
+                   std::string* pName,
+                   bool* pIsDark)
+{
+   const std::string k_themeFileStr = themeFile.canonicalPath();
+   std::ifstream themeIFStream(k_themeFileStr);
+   std::string themeContents(
+      (std::istreambuf_iterator<char>(themeIFStream)),
+      (std::istreambuf_iterator<char>()));
+   themeIFStream.close();
+
+   boost::smatch matches;
+   boost::regex_search(
+      themeContents,
+      matches,
+      boost::regex("rs-theme-name\\s*:\\s*([^\\*]+?)\\s*(?:\\*|$)"));
+
+   // If there's no name specified,use the name of the file
+   if (matches.size() < 2)
+   {
+      *pName = themeFile.stem();
+   }
+   else
+   {
+      // If there's at least one name specified, get the first one.
+      *pName = matches[1];
+   }
+
+   // Find out if the theme is dark or not.
+   boost::regex_search(
+            themeContents,
+            matches,
+            boost::regex("rs-theme-is-dark\\s*:\\s*([^\\*]+?)\\s*(?:\\*|$)"));
+
+   *pIsDark = false;
+   if (matches.size() >= 2)
+   {
+      try
+      {
+         *pIsDark = convertToBool(matches[1].str());
+      }
+      catch (boost::bad_lexical_cast)
+      {
+         LOG_WARNING_MESSAGE("rs-theme-is-dark value is not a valid boolean string for theme \"" + *pName + "\".");
+      }
+   }
+   else
+   {
+      LOG_WARNING_MESSAGE("rs-theme-is-dark is not set for theme \"" + *pName + "\".");
+   }
+}
+
+// The name and darkness read from a theme file, along with the signature of the file when it
+// was read.
+struct ThemeIndexEntry
+{
+   ThemeIndexEntry() : isDark(false) {}
+
+   std::string signature;
+   std::string name;
+   bool isDark;
+};
+
+// A map from the path of each theme file to what was read from it. It is persisted so that
+// theme files which haven't changed needn't be read again (in this or later sessions).
+std::map<std::string, ThemeIndexEntry> s_themeIndex;
+bool s_themeIndexLoaded = false;
+
+/**
+ * @brief Gets the location in which the theme index is persisted.
+ *
+ * @return The location of the theme index.
+ */
+FilePath themeIndexPath()
+{
+   return module_context::userScratchPath().complete("themes/index.json");
+}
+
+/**
+ * @brief Gets the signature of a theme file, which changes whenever the file does.
+ *
+ * @param themeFile     The theme file.
+ *
+ * @return The signature of the theme file.
+ */
+std::string themeFileSignature(const FilePath& themeFile)
+{
+   return safe_convert::numberToString(themeFile.lastWriteTime()) + ":" +
+          safe_convert::numberToString(themeFile.size());
+}
+
+/**
+ * @brief Loads the theme index persisted by an earlier session (if any).
+ */
+void loadThemeIndex()
+{
+   if (s_themeIndexLoaded)
+      return;
+   s_themeIndexLoaded = true;
+
+   FilePath path = themeIndexPath();
+   if (!path.exists())
+      return;
+
+   std::string contents;
+   Error error = readStringFromFile(path, &contents);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   json::Value value;
+   if (!json::parse(contents, &value) || value.type() != json::ArrayType)
+   {
+      LOG_ERROR_MESSAGE("Failed to parse theme index: " + path.absolutePath());
+      return;
+   }
+
+   for (const json::Value& entryJson: value.get_array())
+   {
+      if (entryJson.type() != json::ObjectType)
+         continue;
+
+      std::string themePath;
+      ThemeIndexEntry entry;
+      error = json::readObject(entryJson.get_obj(),
+                               "path", &themePath,
+                               "signature", &entry.signature,
+                               "name", &entry.name,
+                               "is_dark", &entry.isDark);
+      if (error)
+      {
+         LOG_ERROR(error);
+         continue;
+      }
+      s_themeIndex[themePath] = entry;
+   }
+}
+
+/**
+ * @brief Persists the theme index for later sessions.
+ */
+void saveThemeIndex()
+{
+   json::Array indexJson;
+   for (const auto& entry: s_themeIndex)
+   {
+      json::Object entryJson;
+      entryJson["path"] = entry.first;
+      entryJson["signature"] = entry.second.signature;
+      entryJson["name"] = entry.second.name;
+      entryJson["is_dark"] = entry.second.isDark;
+      indexJson.push_back(entryJson);
+   }
+
+   FilePath path = themeIndexPath();
+   Error error = path.parent().ensureDirectory();
+   if (!error)
+   {
+      std::ostringstream ostr;
+      json::write(indexJson, ostr);
+      error = writeStringToFile(path, ostr.str());
+   }
+   if (error)
+      LOG_ERROR(error);
+}
+
+/**
+ * @brief Gets themes in the specified location. Only theme files which have changed since they
+ *        were last indexed are read.
  *
  * @param location         The location in which to look for themes.
  * @param urlPrefix        The URL prefix for the theme. Must end with "/"
  * @param themeMap         The map which will contain all found themes after the call. (NOT OWN)
+ * @param pIndexed         The paths of the theme files found. (NOT OWN)
+ * @param pChanged         Set to true if the theme index was updated. (NOT OWN)
  */
 void getThemesInLocation(
       const rstudio::core::FilePath& location,
       const std::string& urlPrefix,
-      ThemeMap* themeMap)
+      ThemeMap* themeMap,
+      std::set<std::string>* pIndexed,
+      bool* pChanged)
 {
    using rstudio::core::FilePath;
    if (location.isDirectory())
@@ -136,58 +320,22 @@ void getThemesInLocation(
       {
          if (themeFile.hasExtensionLowerCase(".rstheme"))
          {
-            const std::string k_themeFileStr = themeFile.canonicalPath();
-            std::ifstream themeIFStream(k_themeFileStr);
-            std::string themeContents(
-               (std::istreambuf_iterator<char>(themeIFStream)),
-               (std::istreambuf_iterator<char>()));
-            themeIFStream.close();
-
-            boost::smatch matches;
-            boost::regex_search(
-               themeContents,
-               matches,
-               boost::regex("rs-theme-name\\s*:\\s*([^\\*]+?)\\s*(?:\\*|$)"));
-
-            // If there's no name specified,use the name of the file
-            std::string name;
-            if (matches.size() < 2)
-            {
-               name = themeFile.stem();
-            }
-            else
-            {
-               // If there's at least one name specified, get the first one.
-               name = matches[1];
-            }
+            const std::string themePath = themeFile.absolutePath();
+            const std::string signature = themeFileSignature(themeFile);
+            pIndexed->insert(themePath);
 
-            // Find out if the theme is dark or not.
-            boost::regex_search(
-                     themeContents,
-                     matches,
-                     boost::regex("rs-theme-is-dark\\s*:\\s*([^\\*]+?)\\s*(?:\\*|$)"));
-
-            bool isDark = false;
-            if (matches.size() >= 2)
-            {
-               try
-               {
-                  isDark = convertToBool(matches[1].str());
-               }
-               catch (boost::bad_lexical_cast)
-               {
-                  LOG_WARNING_MESSAGE("rs-theme-is-dark value is not a valid boolean string for theme \"" + name + "\".");
-               }
-            }
-            else
+            ThemeIndexEntry& entry = s_themeIndex[themePath];
+            if (entry.signature != signature)
             {
-               LOG_WARNING_MESSAGE("rs-theme-is-dark is not set for theme \"" + name + "\".");
+               entry.signature = signature;
+               readThemeFile(themeFile, &entry.name, &entry.isDark);
+               *pChanged = true;
             }
 
-            (*themeMap)[boost::algorithm::to_lower_copy(name)] = std::make_tuple(
-               name,
+            (*themeMap)[boost::algorithm::to_lower_copy(entry.name)] = std::make_tuple(
+               entry.name,
                urlPrefix + themeFile.filename(),
-               isDark);
+               entry.isDark);
          }
       }
    }
@@ -257,10 +405,32 @@ ThemeMap getAllThemes()
 {
    // Intentionally get global themes before getting user specific themes so that user specific
    // themes will override global ones.
+   loadThemeIndex();
+
    ThemeMap themeMap;
-   getThemesInLocation(getDefaultThemePath(), kDefaultThemeLocation, &themeMap);
-   getThemesInLocation(getGlobalCustomThemePath(), kGlobalCustomThemeLocation, &themeMap);
-   getThemesInLocation(getLocalCustomThemePath(), kLocalCustomThemeLocation, &themeMap);
+   std::set<std::string> indexed;
+   bool changed = false;
+   getThemesInLocation(getDefaultThemePath(), kDefaultThemeLocation, &themeMap, &indexed, &changed);
+   getThemesInLocation(getGlobalCustomThemePath(), kGlobalCustomThemeLocation, &themeMap, &indexed,
+                       &changed);
+   getThemesInLocation(getLocalCustomThemePath(), kLocalCustomThemeLocation, &themeMap, &indexed,
+                       &changed);
+
+   // Forget themes which have been removed and persist any changes.
+   for (auto it = s_themeIndex.begin(); it != s_themeIndex.end();)
+   {
+      if (indexed.count(it->first))
+      {
+         ++it;
+      }
+      else
+      {
+         it = s_themeIndex.erase(it);
+         changed = true;
+      }
+   }
+   if (changed)
+      saveThemeIndex();
 
    return themeMap;
 }
@@ -332,7 +502,7 @@ void handleDefaultThemeRequest(const http::Request& request,
                                      http::Response* pResponse)
 {
    std::string fileName = http::util::pathAfterPrefix(request, "/" + kDefaultThemeLocation);
-   pResponse->setCacheableFile(getDefaultThemePath().childPath(fileName), request);
+   pResponse->setResourceFile(getDefaultThemePath().childPath(fileName), request);
 }
 
 /**
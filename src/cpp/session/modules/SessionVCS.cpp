@@ -15,8 +15,11 @@
 
 #include "SessionVCS.hpp"
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 
+#include <core/BoostThread.hpp>
+
 #include <core/Exec.hpp>
 #include <core/StringUtils.hpp>
 #include <core/system/Environment.hpp>
@@ -132,6 +135,57 @@ class NullFileDecorationContext : public FileDecorationContext
    }
 };
 
+// the version control systems installed, and the repositories (if any)
+// the working directory is within
+struct VcsDetection
+{
+   VcsDetection() : gitInstalled(false), svnInstalled(false) {}
+
+   bool gitInstalled;
+   FilePath gitRoot;
+   bool svnInstalled;
+   std::string svnRepositoryRoot;
+};
+
+void detectGit(const FilePath& workingDir, VcsDetection* pDetection)
+{
+   pDetection->gitInstalled = git::isGitInstalled();
+   if (pDetection->gitInstalled)
+      pDetection->gitRoot = git::detectGitRoot(workingDir);
+}
+
+void detectSvn(const FilePath& workingDir, VcsDetection* pDetection)
+{
+   pDetection->svnInstalled = svn::isSvnInstalled();
+   if (pDetection->svnInstalled)
+      pDetection->svnRepositoryRoot = svn::repositoryRoot(workingDir);
+}
+
+// each probe runs git or svn (which can take a while, e.g. for a working
+// directory on a network drive) so probe for svn on another thread while
+// probing for git
+VcsDetection detectVcs(const FilePath& workingDir)
+{
+   VcsDetection detection;
+
+   boost::thread_group threads;
+   try
+   {
+      threads.create_thread(boost::bind(detectSvn, workingDir, &detection));
+   }
+   catch (const boost::thread_resource_error& e)
+   {
+      LOG_ERROR(Error(boost::thread_error::ec_from_exception(e),
+                      ERROR_LOCATION));
+      detectSvn(workingDir, &detection);
+   }
+
+   detectGit(workingDir, &detection);
+   threads.join_all();
+
+   return detection;
+}
+
 } // anonymous namespace
 
 boost::shared_ptr<FileDecorationContext> fileDecorationContext(
@@ -240,22 +294,27 @@ core::Error initialize()
    }
    else if (vcsOptions.vcsOverride == git::kVcsId)
    {
-      if (git::isGitInstalled() && git::isGitDirectory(workingDir))
-         return git::initializeGit(workingDir);
+      VcsDetection detection;
+      detectGit(workingDir, &detection);
+      if (!detection.gitRoot.empty())
+         return git::initializeGitRoot(detection.gitRoot);
       return Success();
    }
    else if (vcsOptions.vcsOverride == svn::kVcsId)
    {
-      if (svn::isSvnInstalled() && svn::isSvnDirectory(workingDir))
+      VcsDetection detection;
+      detectSvn(workingDir, &detection);
+      if (!detection.svnRepositoryRoot.empty())
          return svn::initializeSvn(workingDir);
       return Success();
    }
 
-   if (git::isGitInstalled() && git::isGitDirectory(workingDir))
+   VcsDetection detection = detectVcs(workingDir);
+   if (!detection.gitRoot.empty())
    {
-      return git::initializeGit(workingDir);
+      return git::initializeGitRoot(detection.gitRoot);
    }
-   else if (svn::isSvnInstalled() && svn::isSvnDirectory(workingDir))
+   else if (!detection.svnRepositoryRoot.empty())
    {
       return svn::initializeSvn(workingDir);
    }
@@ -281,10 +340,10 @@ VcsContext vcsContext(const FilePath& workingDir)
 
    // inspect current vcs state (underlying functions execute child
    // processes so we want to be sure to only call them once)
-   bool gitInstalled = isGitInstalled();
-   bool isGitDirectory = gitInstalled && git::isGitDirectory(workingDir);
-   bool svnInstalled = isSvnInstalled();
-   bool isSvnDirectory = svnInstalled && svn::isSvnDirectory(workingDir);
+   VcsDetection detection = detectVcs(workingDir);
+   bool gitInstalled = detection.gitInstalled;
+   bool isGitDirectory = !detection.gitRoot.empty();
+   bool isSvnDirectory = !detection.svnRepositoryRoot.empty();
 
    // detected vcs
    VcsContext context;
@@ -305,7 +364,7 @@ VcsContext vcsContext(const FilePath& workingDir)
    if (isGitDirectory)
       context.gitRemoteOriginUrl = git::remoteOriginUrl(workingDir);
    if (isSvnDirectory)
-      context.svnRepositoryRoot = svn::repositoryRoot(workingDir);
+      context.svnRepositoryRoot = detection.svnRepositoryRoot;
 
    return context;
 }
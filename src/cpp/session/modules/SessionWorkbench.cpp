@@ -371,6 +371,7 @@ Error setPrefs(const json::JsonRpcRequest& request, json::JsonRpcResponse*)
    // read and set packages prefs
    bool useInternet2, cleanupAfterCheckSuccess, viewDirAfterCheckFailure;
    bool hideObjectFiles, useDevtools, useSecureDownload, useNewlineInMakefiles;
+   bool useCompileCache, useParallelTests;
    json::Object cranMirrorJson;
    error = json::readObject(packagesPrefs,
                             "cran_mirror", &cranMirrorJson,
@@ -383,7 +384,9 @@ Error setPrefs(const json::JsonRpcRequest& request, json::JsonRpcResponse*)
                             "hide_object_files", &hideObjectFiles,
                             "use_devtools", &useDevtools,
                             "use_secure_download", &useSecureDownload,
-                            "use_newline_in_makefiles", &useNewlineInMakefiles);
+                            "use_newline_in_makefiles", &useNewlineInMakefiles,
+                            "use_compile_cache", &useCompileCache,
+                            "use_parallel_tests", &useParallelTests);
 
    if (error)
        return error;
@@ -396,6 +399,8 @@ Error setPrefs(const json::JsonRpcRequest& request, json::JsonRpcResponse*)
    userSettings().setHideObjectFiles(hideObjectFiles);
    userSettings().setViewDirAfterRCmdCheck(viewDirAfterCheckFailure);
    userSettings().setUseNewlineInMakefiles(useNewlineInMakefiles);
+   userSettings().setUseCompileCache(useCompileCache);
+   userSettings().setUseParallelTests(useParallelTests);
 
    // NOTE: currently there is no UI for bioconductor mirror so we
    // don't want to set it (would have side effect of overwriting
@@ -575,6 +580,8 @@ Error getRPrefs(const json::JsonRpcRequest& request,
    packagesPrefs["hide_object_files"] = userSettings().hideObjectFiles();
    packagesPrefs["use_secure_download"] = userSettings().securePackageDownload();
    packagesPrefs["use_newline_in_makefiles"] = userSettings().useNewlineInMakefiles();
+   packagesPrefs["use_compile_cache"] = userSettings().useCompileCache();
+   packagesPrefs["use_parallel_tests"] = userSettings().useParallelTests();
 
    // get projects prefs
    json::Object projectsPrefs;
@@ -986,11 +993,8 @@ void handleFileShow(const http::Request& request, http::Response* pResponse)
    pResponse->setCacheableFile(filePath, request);
 }
 
-void onUserSettingsChanged()
+void onUiPrefsChanged()
 {
-   // sync underlying R save action
-   module_context::syncRSaveAction();
-
    // fire event notifying the client that uiPrefs changed
    json::Object dataJson;
    dataJson["type"] = "global";
@@ -1010,7 +1014,9 @@ std::string editFileCommand()
 Error initialize()
 {
    // register for change notifications on user settings
-   userSettings().onChanged.connect(onUserSettingsChanged);
+   userSettings().onKeyChanged(kUserSettingsSaveAction,
+                               module_context::syncRSaveAction);
+   userSettings().onKeyChanged(kUserSettingsUiPrefs, onUiPrefsChanged);
 
    // register postback handler for viewPDF (server-only)
    if (session::options().programMode() == kSessionProgramModeServer)
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include <boost/utility.hpp>
+#include <boost/thread.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/format.hpp>
 #include <boost/scope_exit.hpp>
@@ -33,6 +34,9 @@
 #include <core/system/Process.hpp>
 #include <core/system/Environment.hpp>
 #include <core/system/ShellUtils.hpp>
+#ifndef _WIN32
+#include <core/system/PosixCgroups.hpp>
+#endif
 #include <core/r_util/RPackageInfo.hpp>
 
 #include <session/SessionOptions.hpp>
@@ -658,7 +662,10 @@ private:
       }
       else if (type == kTestPackage) {
          openErrorList_ = false;
-         parsers.add(testthatErrorParser(packagePath.complete("tests/testthat")));
+
+         // the parallel runner reports its failures as they happen
+         if (!useParallelTests(packagePath))
+            parsers.add(testthatErrorParser(packagePath.complete("tests/testthat")));
       }
 
       initErrorParser(packagePath, parsers);
@@ -694,6 +701,27 @@ private:
       // add r tools to path if necessary
       module_context::addRtoolsToPathIfNecessary(&childEnv, &buildToolsWarning_);
 
+      // compile through the project's object cache if requested
+      FilePath scratchPath = projects::projectContext().scratchPath();
+      if (userSettings().useCompileCache() &&
+          !scratchPath.empty() &&
+          packagePath.childPath("src").exists())
+      {
+         FilePath cachePath = scratchPath.childPath("compile-cache");
+         if (module_context::addCompileCacheToEnvironment(cachePath,
+                                                          packagePath,
+                                                          &childEnv))
+         {
+            compileCachePath_ = cachePath;
+         }
+         else
+         {
+            enqueBuildOutput(module_context::kCompileOutputNormal,
+                             "NOTE: ccache was not found on the PATH so "
+                             "compiled objects will not be cached\n\n");
+         }
+      }
+
       pkgOptions.environment = childEnv;
 
       // get R bin directory
@@ -802,8 +830,9 @@ private:
 
       else if (type == kTestPackage)
       {
-
-         if (useDevtools())
+         if (useParallelTests(packagePath))
+            parallelTestPackage(packagePath, pkgOptions, cb);
+         else if (useDevtools())
             devtoolsTestPackage(packagePath, pkgOptions, cb);
          else
             testPackage(packagePath, pkgOptions, cb);
@@ -1132,6 +1161,81 @@ private:
 
    }
 
+   // spread testthat files across workers when there's more than one
+   bool useParallelTests(const FilePath& packagePath)
+   {
+      if (!userSettings().useParallelTests())
+         return false;
+
+      std::vector<FilePath> children;
+      Error error = packagePath.complete("tests/testthat").children(&children);
+      if (error)
+         return false;
+
+      int testFiles = 0;
+      BOOST_FOREACH(const FilePath& child, children)
+      {
+         if (boost::algorithm::starts_with(child.filename(), "test") &&
+             child.extensionLowerCase() == ".r")
+         {
+            testFiles++;
+         }
+      }
+      return testFiles > 1;
+   }
+
+   void parallelTestPackage(const FilePath& packagePath,
+                            core::system::ProcessOptions pkgOptions,
+                            const core::system::ProcessCallbacks& cb)
+   {
+      FilePath rScriptPath;
+      Error error = module_context::rScriptPath(&rScriptPath);
+      if (error)
+      {
+         terminateWithError("Locating R script", error);
+         return;
+      }
+
+#ifndef _WIN32
+      int workers = core::system::cgroups::availableCpuCount();
+#else
+      int workers = std::max(static_cast<int>(boost::thread::hardware_concurrency()), 1);
+#endif
+
+      // construct a shell command to execute
+      shell_utils::ShellCommand cmd(rScriptPath);
+      cmd << "--slave";
+      cmd << "--vanilla";
+      cmd << "-e";
+
+      boost::format fmt(
+         "source('%1%');"
+         "runTestsInParallel('%2%', workers = %3%L)"
+      );
+
+      std::string runnerPathEscaped =
+         string_utils::singleQuotedStrEscape(string_utils::utf8ToSystem(
+            session::options().modulesRSourcePath()
+                              .complete("TestRunner.R").absolutePath()));
+      std::string packagePathEscaped =
+         string_utils::singleQuotedStrEscape(string_utils::utf8ToSystem(
+            packagePath.absolutePath()));
+
+      cmd << boost::str(fmt %
+                        runnerPathEscaped %
+                        packagePathEscaped %
+                        workers);
+
+      pTestResults_.reset(
+            new TestResultsParser(packagePath.complete("tests/testthat")));
+
+      boost::format cmdFmt("Running tests in parallel (%1% workers)");
+      enqueCommandString(boost::str(cmdFmt % workers));
+      module_context::processSupervisor().runCommand(cmd,
+                                                     pkgOptions,
+                                                     cb);
+   }
+
    void testFile(const FilePath& testPath,
                  core::system::ProcessOptions pkgOptions,
                  const core::system::ProcessCallbacks& cb)
@@ -1571,6 +1675,14 @@ private:
 
    void onStandardOutput(const std::string& output)
    {
+      if (pTestResults_)
+      {
+         bool markersChanged = false;
+         std::string text = pTestResults_->parse(output, &markersChanged);
+         onTestResults(text, markersChanged);
+         return;
+      }
+
       if (errorOutputFilterFunction_)
          outputWithFilter(output);
       else
@@ -1585,10 +1697,25 @@ private:
          enqueBuildOutput(module_context::kCompileOutputError, output);
    }
 
+   void onTestResults(const std::string& text, bool markersChanged)
+   {
+      if (!text.empty())
+         enqueBuildOutput(module_context::kCompileOutputNormal, text);
+
+      if (markersChanged)
+      {
+         errorsJson_ = module_context::sourceMarkersAsJson(pTestResults_->markers());
+         enqueBuildErrors(errorsJson_);
+      }
+   }
+
    void onCompleted(int exitStatus)
    {
       using namespace module_context;
 
+      if (pTestResults_)
+         onTestResults(pTestResults_->flush(), false);
+
       // call the error parser if one has been specified
       if (errorParser_)
       {
@@ -1600,6 +1727,14 @@ private:
          }
       }
 
+      // report how much compilation the cache saved
+      if (!compileCachePath_.empty())
+      {
+         std::string summary = compileCacheSummary(compileCachePath_);
+         if (!summary.empty())
+            enqueBuildOutput(kCompileOutputNormal, "\n" + summary + "\n");
+      }
+
       if (exitStatus != EXIT_SUCCESS)
       {
          boost::format fmt("\nExited with status %1%.\n\n");
@@ -1800,6 +1935,8 @@ private:
    std::vector<FilePath> libPaths_;
    std::string successMessage_;
    std::string buildToolsWarning_;
+   FilePath compileCachePath_;
+   boost::shared_ptr<TestResultsParser> pTestResults_;
    boost::function<void()> successFunction_;
    boost::function<void()> failureFunction_;
    boost::function<bool(const std::string&)> errorOutputFilterFunction_;
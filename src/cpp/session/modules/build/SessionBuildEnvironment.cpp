@@ -24,6 +24,9 @@
 #include <core/FilePath.hpp>
 
 #include <core/FileSerializer.hpp>
+#include <core/RegexUtils.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/system/Process.hpp>
 #include <core/system/System.hpp>
 #include <core/system/Environment.hpp>
 #include <core/r_util/RToolsInfo.hpp>
@@ -268,6 +271,165 @@ bool addRtoolsToPathIfNecessary(core::system::Options* pEnvironment,
 }
 #endif
 
+namespace {
+
+// compilers routed through the compile cache (fortran isn't supported by
+// ccache)
+const char * const kCachedCompilers[] = {
+   "CC", "CXX", "CXX98", "CXX11", "CXX14", "CXX17", "CXX1X", NULL
+};
+
+FilePath ccachePath()
+{
+   return module_context::findProgram("ccache");
+}
+
+FilePath userMakevarsPath(const core::system::Options& environment)
+{
+   std::string makevars = core::system::getenv(environment, "R_MAKEVARS_USER");
+   if (!makevars.empty())
+      return FilePath(makevars);
+
+#ifdef _WIN32
+   return module_context::userHomePath().childPath(".R/Makevars.win");
+#else
+   return module_context::userHomePath().childPath(".R/Makevars");
+#endif
+}
+
+Error runCcache(const FilePath& cachePath,
+                const std::vector<std::string>& args,
+                std::string* pOutput)
+{
+   core::system::Options environment;
+   core::system::environment(&environment);
+   core::system::setenv(&environment, "CCACHE_DIR", cachePath.absolutePath());
+
+   core::system::ProcessOptions options;
+   options.environment = environment;
+
+   core::system::ProcessResult result;
+   Error error = core::system::runProgram(ccachePath().absolutePath(),
+                                          args,
+                                          "",
+                                          options,
+                                          &result);
+   if (error)
+      return error;
+   if (result.exitStatus != EXIT_SUCCESS)
+      return systemError(boost::system::errc::state_not_recoverable,
+                         result.stdErr,
+                         ERROR_LOCATION);
+
+   if (pOutput)
+      *pOutput = result.stdOut;
+   return Success();
+}
+
+int statisticValue(const std::string& stats, const std::string& name)
+{
+   boost::regex re("^" + name + "\\s+(\\d+)\\s*$");
+   boost::smatch match;
+   if (regex_utils::search(stats, match, re))
+      return safe_convert::stringTo<int>(match[1], 0);
+   return 0;
+}
+
+} // anonymous namespace
+
+bool addCompileCacheToEnvironment(const FilePath& cachePath,
+                                  const FilePath& packagePath,
+                                  core::system::Options* pEnvironment)
+{
+   FilePath ccache = ccachePath();
+   if (ccache.empty())
+      return false;
+
+   Error error = cachePath.ensureDirectory();
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+
+   // R reads the compilers from its Makeconf and then the user's Makevars;
+   // we substitute our own Makevars which includes the user's and then
+   // prefixes the compilers they have settled on with ccache
+   std::string makevars =
+      "# compile through ccache (generated by RStudio)\n"
+      "CCACHE = \"" + ccache.absolutePath() + "\"\n";
+   FilePath userMakevars = userMakevarsPath(*pEnvironment);
+   if (userMakevars.exists())
+      makevars += "include " + userMakevars.absolutePath() + "\n";
+   for (const char * const * pCompiler = kCachedCompilers; *pCompiler; ++pCompiler)
+   {
+      std::string compiler(*pCompiler);
+      // (compilers R wasn't configured with are left empty so that
+      // requesting their standard still fails clearly)
+      boost::format fmt("ifneq ($(strip $(%1%)),)\n"
+                        "ifeq ($(findstring ccache,$(%1%)),)\n"
+                        "%1% := $(CCACHE) $(%1%)\n"
+                        "endif\n"
+                        "endif\n");
+      makevars += boost::str(fmt % compiler);
+   }
+
+   FilePath makevarsPath = cachePath.childPath("Makevars");
+   error = writeStringToFile(makevarsPath, makevars);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return false;
+   }
+
+   // start counting hits afresh for this build
+   std::vector<std::string> args;
+   args.push_back("--zero-stats");
+   error = runCcache(cachePath, args, NULL);
+   if (error)
+      LOG_ERROR(error);
+
+   // hash paths relative to the package so the objects can be reused if
+   // the project moves
+   core::system::setenv(pEnvironment, "R_MAKEVARS_USER", makevarsPath.absolutePath());
+   core::system::setenv(pEnvironment, "CCACHE_DIR", cachePath.absolutePath());
+   core::system::setenv(pEnvironment, "CCACHE_BASEDIR", packagePath.absolutePath());
+   return true;
+}
+
+std::string compileCacheSummary(const FilePath& cachePath)
+{
+   std::string stats;
+   std::vector<std::string> args;
+   args.push_back("--show-stats");
+   Error error = runCcache(cachePath, args, &stats);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return std::string();
+   }
+
+   int hits = statisticValue(stats, "cache hit \\(direct\\)") +
+              statisticValue(stats, "cache hit \\(preprocessed\\)");
+   int misses = statisticValue(stats, "cache miss");
+
+   // newer versions of ccache summarize as "Hits: <hits> / <total>"
+   boost::regex reHits("^\\s*Hits:\\s+(\\d+)\\s*/\\s*(\\d+)");
+   boost::smatch match;
+   if (hits + misses == 0 && regex_utils::search(stats, match, reHits))
+   {
+      hits = safe_convert::stringTo<int>(match[1], 0);
+      misses = safe_convert::stringTo<int>(match[2], 0) - hits;
+   }
+
+   int total = hits + misses;
+   if (total <= 0)
+      return std::string();
+
+   boost::format fmt("Compile cache: %1% of %2% objects reused (%3%%%)");
+   return boost::str(fmt % hits % total % (hits * 100 / total));
+}
+
 } // namespace module_context
 } // namespace session
 } // namespace rstudio
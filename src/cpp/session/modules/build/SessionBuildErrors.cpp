@@ -16,12 +16,16 @@
 #include "SessionBuildErrors.hpp"
 
 #include <algorithm>
+#include <cstring>
 
 #include <boost/bind.hpp>
 #include <boost/regex.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
 
 #include <core/Error.hpp>
 #include <core/SafeConvert.hpp>
@@ -102,8 +106,12 @@ std::vector<module_context::SourceMarker> parseRErrors(
    using namespace module_context;
    std::vector<SourceMarker> errors;
 
-   boost::regex re("^Error in parse\\(outFile\\) : ([0-9]+?):([0-9]+?): (.+?)\\n"
-                   "([0-9]+?): (.*?)\\n([0-9]+?): (.+?)$");
+   // (the regex is costly over long output, so skip output without errors)
+   if (output.find("Error in parse(outFile)") == std::string::npos)
+      return errors;
+
+   static boost::regex re("^Error in parse\\(outFile\\) : ([0-9]+?):([0-9]+?): (.+?)\\n"
+                          "([0-9]+?): (.*?)\\n([0-9]+?): (.+?)$");
    try
    {
       boost::sregex_iterator iter(output.begin(), output.end(), re,
@@ -168,8 +176,16 @@ std::vector<module_context::SourceMarker> parseGccErrors(
 
    // parse standard gcc errors and warning lines but also pickup "from"
    // prefixed errors and substitute the from file for the error/warning file
-   boost::regex re("(?:from (.+?):([0-9]+?).+?\\n)?"
-                   "^(.+?):([0-9]+?):(?:([0-9]+?):)? (error|warning): (.+)$");
+   // (the regex is costly over long output, so skip output without errors
+   // or warnings)
+   if (output.find("error: ") == std::string::npos &&
+       output.find("warning: ") == std::string::npos)
+   {
+      return errors;
+   }
+
+   static boost::regex re("(?:from (.+?):([0-9]+?).+?\\n)?"
+                          "^(.+?):([0-9]+?):(?:([0-9]+?):)? (error|warning): (.+)$");
    try
    {
       boost::sregex_iterator iter(output.begin(), output.end(), re,
@@ -269,7 +285,7 @@ std::vector<module_context::SourceMarker> parseTestThatErrors(
    {
       FilePath basePathResolved = module_context::resolveAliasedPath(basePath.absolutePath());
 
-      boost::regex re("\\[[0-9]+m([^:\\n]+):([0-9]+): ?([^:\\n]+): ([^\\n]*)\\[[0-9]+m");
+      static boost::regex re("\\[[0-9]+m([^:\\n]+):([0-9]+): ?([^:\\n]+): ([^\\n]*)\\[[0-9]+m");
 
       boost::sregex_iterator iter(output.begin(), output.end(), re);
       boost::sregex_iterator end;
@@ -377,6 +393,141 @@ CompileErrorParser shinytestErrorParser(const FilePath& basePath, const FilePath
    return boost::bind(parseShinyTestErrors, basePath, rdsPath, _1);
 }
 
+namespace {
+
+const char * const kTestResultPrefix = "##rs-test\t";
+
+std::string unescapeTestField(const std::string& field)
+{
+   std::string unescaped;
+   unescaped.reserve(field.size());
+   for (std::size_t i = 0; i < field.size(); i++)
+   {
+      if (field[i] == '\\' && i + 1 < field.size())
+      {
+         char next = field[++i];
+         if (next == 't')
+            unescaped.push_back('\t');
+         else if (next == 'n')
+            unescaped.push_back('\n');
+         else
+            unescaped.push_back(next);
+      }
+      else
+      {
+         unescaped.push_back(field[i]);
+      }
+   }
+   return unescaped;
+}
+
+std::string indentLines(const std::string& text)
+{
+   return "  " + boost::algorithm::replace_all_copy(text, "\n", "\n  ");
+}
+
+} // anonymous namespace
+
+std::string TestResultsParser::parse(const std::string& output,
+                                     bool* pMarkersChanged)
+{
+   *pMarkersChanged = false;
+   pending_.append(output);
+
+   std::string text;
+   std::size_t pos;
+   while ((pos = pending_.find('\n')) != std::string::npos)
+   {
+      text.append(parseLine(pending_.substr(0, pos), pMarkersChanged));
+      pending_.erase(0, pos + 1);
+   }
+   return text;
+}
+
+std::string TestResultsParser::flush()
+{
+   bool markersChanged;
+   std::string text = parseLine(pending_, &markersChanged);
+   pending_.clear();
+   return text;
+}
+
+std::string TestResultsParser::parseLine(const std::string& line,
+                                         bool* pMarkersChanged)
+{
+   using namespace module_context;
+
+   if (!boost::algorithm::starts_with(line, kTestResultPrefix))
+      return line.empty() ? std::string() : line + "\n";
+
+   std::vector<std::string> fields;
+   boost::algorithm::split(fields,
+                           line.substr(std::strlen(kTestResultPrefix)),
+                           boost::algorithm::is_any_of("\t"));
+   BOOST_FOREACH(std::string& field, fields)
+   {
+      field = unescapeTestField(field);
+   }
+
+   const std::string& kind = fields[0];
+   if (kind == "result" && fields.size() >= 6)
+   {
+      const std::string& status = fields[1];
+      const std::string& file = fields[2];
+      int lineNumber = safe_convert::stringTo<int>(fields[3], 0);
+      const std::string& test = fields[4];
+      const std::string& message = fields[5];
+      if (status == "pass")
+         return std::string();
+
+      SourceMarker::Type type = SourceMarker::Info;
+      std::string label = "SKIPPED";
+      if (status == "fail" || status == "error")
+      {
+         type = SourceMarker::Error;
+         label = status == "fail" ? "FAILED" : "ERROR";
+      }
+      else if (status == "warning")
+      {
+         type = SourceMarker::Warning;
+         label = "WARNING";
+      }
+
+      markers_.push_back(SourceMarker(type,
+                                      testsPath_.complete(file),
+                                      std::max(lineNumber, 1),
+                                      1,
+                                      core::html_utils::HTML(test + ": " + message),
+                                      true));
+      *pMarkersChanged = true;
+
+      std::string location = file;
+      if (lineNumber > 0)
+         location += ":" + safe_convert::numberToString(lineNumber);
+      boost::format fmt("%1% [%2%] %3%\n%4%\n");
+      return boost::str(fmt % label % location % test % indentLines(message));
+   }
+   else if (kind == "file" && fields.size() >= 6)
+   {
+      int passed = safe_convert::stringTo<int>(fields[2], 0);
+      int failed = safe_convert::stringTo<int>(fields[3], 0);
+      int skipped = safe_convert::stringTo<int>(fields[4], 0);
+      passed_ += passed;
+      failed_ += failed;
+      skipped_ += skipped;
+
+      boost::format fmt("%1%: %2% passed, %3% failed, %4% skipped (%5%s)\n");
+      return boost::str(fmt % fields[1] % passed % failed % skipped % fields[5]);
+   }
+   else if (kind == "done")
+   {
+      boost::format fmt("\nTests: %1% passed, %2% failed, %3% skipped\n");
+      return boost::str(fmt % passed_ % failed_ % skipped_);
+   }
+
+   return std::string();
+}
+
 } // namespace build
 } // namespace modules
 } // namespace session
@@ -21,6 +21,7 @@
 
 #include <boost/function.hpp>
 #include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
 
 #include <core/FilePath.hpp>
 #include <core/json/Json.hpp>
@@ -73,6 +74,41 @@ CompileErrorParser testthatErrorParser(const core::FilePath& basePath);
 
 CompileErrorParser shinytestErrorParser(const core::FilePath& basePath, const core::FilePath& rdsPath);
 
+// reads the results written by the parallel test runner (TestRunner.R) as
+// they arrive, turning them into readable output and source markers
+class TestResultsParser : boost::noncopyable
+{
+public:
+   explicit TestResultsParser(const core::FilePath& testsPath)
+      : testsPath_(testsPath), passed_(0), failed_(0), skipped_(0)
+   {
+   }
+
+   // consume output from the runner, returning the text to show in its
+   // place (*pMarkersChanged is set if failures were added to markers())
+   std::string parse(const std::string& output, bool* pMarkersChanged);
+
+   // whatever is left of an incomplete final line
+   std::string flush();
+
+   const std::vector<module_context::SourceMarker>& markers() const
+   {
+      return markers_;
+   }
+
+   int failed() const { return failed_; }
+
+private:
+   std::string parseLine(const std::string& line, bool* pMarkersChanged);
+
+   core::FilePath testsPath_;
+   std::string pending_;
+   std::vector<module_context::SourceMarker> markers_;
+   int passed_;
+   int failed_;
+   int skipped_;
+};
+
 } // namespace build
 } // namespace modules
 } // namespace session
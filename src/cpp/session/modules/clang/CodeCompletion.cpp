@@ -15,8 +15,11 @@
 
 #include "CodeCompletion.hpp"
 
+#include <algorithm>
 #include <iostream>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 #include <core/Debug.hpp>
 #include <core/Error.hpp>
 #include <core/FileSerializer.hpp>
@@ -494,6 +497,29 @@ Error getHeaderCompletions(std::string line,
 }
 
 
+// the completions for the most recent completion request, and where they
+// were requested. they're only reused while the user keeps typing (edits
+// elsewhere in the document could change them)
+struct CompletionCache
+{
+   CompletionCache() : row(0), anchorColumn(0) {}
+   
+   std::string filename;
+   int row;
+   int anchorColumn;
+   std::string linePrefix;
+   boost::posix_time::ptime lastUsed;
+   boost::shared_ptr<CodeCompleteResults> pResults;
+};
+
+const boost::posix_time::seconds kCompletionCacheExpiry(5);
+
+CompletionCache& completionCache()
+{
+   static CompletionCache instance;
+   return instance;
+}
+
 } // anonymous namespace
 
 
@@ -525,59 +551,86 @@ Error getCppCompletions(const core::json::JsonRpcRequest& request,
    if (regex_utils::textMatches(line, reInclude, true, true))
       return getHeaderCompletions(line, filePath, docId, request, pResponse);
 
-   // get the translation unit and do the code completion
+   // use the completions from the last request if they were made at the
+   // start of the same identifier (the results aren't filtered by clang,
+   // so only need filtering on the new user text)
    std::string filename = filePath.absolutePath();
-   TranslationUnit tu = rSourceIndex().getTranslationUnit(filename);
-
-   if (!tu.empty())
+   int anchorColumn = column - static_cast<int>(userText.length());
+   std::string linePrefix = line.substr(
+            0, std::min(line.length(), static_cast<std::size_t>(
+                           std::max(anchorColumn - 1, 0))));
+   
+   using namespace boost::posix_time;
+   ptime now = microsec_clock::universal_time();
+   CompletionCache& cache = completionCache();
+   if (!cache.pResults ||
+       now - cache.lastUsed > kCompletionCacheExpiry ||
+       cache.filename != filename ||
+       cache.row != row ||
+       cache.anchorColumn != anchorColumn ||
+       cache.linePrefix != linePrefix)
    {
-      std::string lastTypedText;
-      json::Array completionsJson;
-      boost::shared_ptr<CodeCompleteResults> pResults =
-                              tu.codeCompleteAt(filename, row, column);
-      if (!pResults->empty())
+      // get the translation unit and do the code completion
+      TranslationUnit tu = rSourceIndex().getTranslationUnit(filename);
+      if (tu.empty())
       {
-         // get results
-         for (unsigned i = 0; i<pResults->getNumResults(); i++)
+         cache = CompletionCache();
+         return Success();
+      }
+      
+      cache.filename = filename;
+      cache.row = row;
+      cache.anchorColumn = anchorColumn;
+      cache.linePrefix = linePrefix;
+      cache.pResults = tu.codeCompleteAt(filename, row, column);
+   }
+   cache.lastUsed = now;
+   
+   std::string lastTypedText;
+   json::Array completionsJson;
+   boost::shared_ptr<CodeCompleteResults> pResults = cache.pResults;
+   if (!pResults->empty())
+   {
+      // get results
+      for (unsigned i = 0; i<pResults->getNumResults(); i++)
+      {
+         CodeCompleteResult result = pResults->getResult(i);
+
+         // filter on user text if we have it
+         if (!userText.empty() &&
+             !boost::algorithm::starts_with(result.getTypedText(), userText))
          {
-            CodeCompleteResult result = pResults->getResult(i);
-
-            // filter on user text if we have it
-            if (!userText.empty() &&
-                !boost::algorithm::starts_with(result.getTypedText(), userText))
-            {
-               continue;
-            }
-
-            // check whether this completion is valid and bail if not
-            if (result.getAvailability() != CXAvailability_Available)
-            {
-               continue;
-            }
-
-            std::string typedText = result.getTypedText();
-
-            // if we have the same typed text then just ammend previous result
-            if ((typedText == lastTypedText) && !completionsJson.empty())
-            {
-               json::Object& res = completionsJson.back().get_obj();
-               json::Array& text = res["text"].get_array();
-               text.push_back(friendlyCompletionText(result));
-            }
-            else
-            {
-               completionsJson.push_back(toJson(result));
-            }
-
-            lastTypedText = typedText;
+            continue;
          }
-      }
 
-      json::Object resultJson;
-      resultJson["completions"] = completionsJson;
-      pResponse->setResult(resultJson);
+         // check whether this completion is valid and bail if not
+         if (result.getAvailability() != CXAvailability_Available)
+         {
+            continue;
+         }
+
+         std::string typedText = result.getTypedText();
+
+         // if we have the same typed text then just ammend previous result
+         if ((typedText == lastTypedText) && !completionsJson.empty())
+         {
+            json::Object& res = completionsJson.back().get_obj();
+            json::Array& text = res["text"].get_array();
+            text.push_back(friendlyCompletionText(result));
+         }
+         else
+         {
+            completionsJson.push_back(toJson(result));
+         }
+
+         lastTypedText = typedText;
+      }
    }
 
+   json::Object resultJson;
+   resultJson["completions"] = completionsJson;
+   pResponse->setResult(resultJson);
+
    return Success();
 }
 
@@ -15,8 +15,11 @@
 
 #include "DefinitionIndex.hpp"
 
+#include <cctype>
 #include <deque>
 
+#include <boost/unordered_map.hpp>
+
 #include <core/FilePath.hpp>
 #include <core/DateTime.hpp>
 #include <core/PerformanceTimer.hpp>
@@ -55,6 +58,127 @@ struct CppDefinitions
 typedef std::map<std::string,CppDefinitions> DefinitionsByFile;
 DefinitionsByFile s_definitionsByFile;
 
+// lookup structures over the definitions in s_definitionsByFile: the
+// definitions with each USR, and the definitions whose (lowercased) names
+// contain each character. these are built on demand, and invalidated
+// whenever the definitions change
+struct IndexedDefinition
+{
+   IndexedDefinition(const std::string* pFile, const CppDefinition* pDefinition)
+      : pFile(pFile), pDefinition(pDefinition)
+   {
+   }
+   
+   const std::string* pFile;
+   const CppDefinition* pDefinition;
+};
+
+class DefinitionLookup
+{
+public:
+   
+   DefinitionLookup()
+      : valid_(false)
+   {
+   }
+   
+   void invalidate()
+   {
+      valid_ = false;
+      byUSR_.clear();
+      byCharacter_.clear();
+   }
+   
+   // the definition with the given USR (if any)
+   const CppDefinition* findUSR(const std::string& USR)
+   {
+      build();
+      
+      // a USR which was never interned can't be that of any definition
+      core::InternedString interned;
+      if (!core::InternedString::find(USR, &interned))
+         return NULL;
+      
+      boost::unordered_multimap<core::InternedString,
+                                IndexedDefinition>::const_iterator it =
+            byUSR_.find(interned);
+      if (it == byUSR_.end())
+         return NULL;
+      
+      return it->second.pDefinition;
+   }
+   
+   // the definitions that could match the term: those whose names contain
+   // all of its characters (in any order, ignoring case and wildcards)
+   const std::vector<IndexedDefinition>& candidates(const std::string& term)
+   {
+      build();
+      
+      // use the character with the fewest definitions
+      const std::vector<IndexedDefinition>* pCandidates = &all_;
+      BOOST_FOREACH(char ch, term)
+      {
+         if (ch == '*')
+            continue;
+         
+         const std::vector<IndexedDefinition>& definitions =
+               byCharacter_[characterIndex(ch)];
+         if (definitions.size() < pCandidates->size())
+            pCandidates = &definitions;
+      }
+      
+      return *pCandidates;
+   }
+   
+private:
+   
+   static unsigned char characterIndex(char ch)
+   {
+      return static_cast<unsigned char>(
+               std::tolower(static_cast<unsigned char>(ch)));
+   }
+   
+   void build()
+   {
+      if (valid_)
+         return;
+      
+      all_.clear();
+      byCharacter_.assign(256, std::vector<IndexedDefinition>());
+      
+      BOOST_FOREACH(const DefinitionsByFile::value_type& defs,
+                    s_definitionsByFile)
+      {
+         BOOST_FOREACH(const CppDefinition& def, defs.second.definitions)
+         {
+            IndexedDefinition indexed(&defs.first, &def);
+            all_.push_back(indexed);
+            byUSR_.insert(std::make_pair(def.USR, indexed));
+            
+            bool seen[256] = { false };
+            BOOST_FOREACH(char ch, def.name.str())
+            {
+               unsigned char index = characterIndex(ch);
+               if (!seen[index])
+               {
+                  seen[index] = true;
+                  byCharacter_[index].push_back(indexed);
+               }
+            }
+         }
+      }
+      
+      valid_ = true;
+   }
+   
+   bool valid_;
+   std::vector<IndexedDefinition> all_;
+   boost::unordered_multimap<core::InternedString, IndexedDefinition> byUSR_;
+   std::vector<std::vector<IndexedDefinition> > byCharacter_;
+};
+
+DefinitionLookup s_definitionLookup;
+
 // visitor used to populate deque
 bool insertDefinition(const CppDefinition& definition,
                       CppDefinitions* pDefinitions)
@@ -194,6 +318,7 @@ void fileChangeHandler(const core::system::FileChangeEvent& event)
 
    // always remove existing definitions
    s_definitionsByFile.erase(file);
+   s_definitionLookup.invalidate();
 
    // if this is an add or an update then re-index
    if (event.type() == core::system::FileChangeEvent::FileAdded ||
@@ -306,7 +431,7 @@ bool findUSR(const std::string& USR,
              const CppDefinition& definition,
              CppDefinition* pFoundDefinition)
 {
-   if (definition.USR == USR)
+   if (definition.USR.str() == USR)
    {
       *pFoundDefinition = definition;
       return false;
@@ -358,15 +483,9 @@ FileLocation findDefinitionLocation(const FileLocation& location)
 
       // if we didn't find it there then look for it in our index
       // of all saved files
-      BOOST_FOREACH(const DefinitionsByFile::value_type& defs,
-                    s_definitionsByFile)
-      {
-         BOOST_FOREACH(const CppDefinition& def, defs.second.definitions)
-         {
-            if (def.USR == USR)
-               return def.location;
-         }
-      }
+      const CppDefinition* pDefinition = s_definitionLookup.findUSR(USR);
+      if (pDefinition)
+         return pDefinition->location;
    }
 
    // see if we can resolve the cursor to a definition (if we can't
@@ -393,9 +512,9 @@ bool matches(const std::string& term,
              const CppDefinition& definition)
 {
    if (!pattern.empty())
-      return regex_utils::textMatches(definition.name, pattern, false, false);
+      return regex_utils::textMatches(definition.name.str(), pattern, false, false);
    else
-      return string_utils::isSubsequence(definition.name, term, true);
+      return string_utils::isSubsequence(definition.name.str(), term, true);
 }
 
 bool insertMatching(const std::string& term,
@@ -409,32 +528,62 @@ bool insertMatching(const std::string& term,
 }
 
 
-json::Object cppDefinitionToJson(const CppDefinition& definition)
+// definitions are written as arrays of their fields, rather than as
+// objects, and without their file (which is that of the definitions they
+// belong to) to keep the index small and quick to read.
+json::Array cppDefinitionToJson(const CppDefinition& definition)
 {
    using namespace safe_convert;
-   json::Object definitionJson;
-   definitionJson["usr"] = definition.USR;
-   definitionJson["kind"] = numberTo<int>(definition.kind, 0);
-   definitionJson["parent_name"] = definition.parentName;
-   definitionJson["name"] = definition.name;
-   definitionJson["file"] = definition.location.filePath.absolutePath();
-   definitionJson["line"] = numberTo<int>(definition.location.line, 1);
-   definitionJson["column"] = numberTo<int>(definition.location.column, 1);
+   json::Array definitionJson;
+   definitionJson.push_back(definition.USR.str());
+   definitionJson.push_back(numberTo<int>(definition.kind, 0));
+   definitionJson.push_back(definition.parentName.str());
+   definitionJson.push_back(definition.name.str());
+   definitionJson.push_back(numberTo<int>(definition.location.line, 1));
+   definitionJson.push_back(numberTo<int>(definition.location.column, 1));
    return definitionJson;
 }
 
+CppDefinition cppDefinitionFromJson(const json::Array& array,
+                                    const std::string& file)
+{
+   if (array.size() != 6 ||
+       !json::isType<std::string>(array[0]) ||
+       !json::isType<int>(array[1]) ||
+       !json::isType<std::string>(array[2]) ||
+       !json::isType<std::string>(array[3]) ||
+       !json::isType<int>(array[4]) ||
+       !json::isType<int>(array[5]))
+   {
+      LOG_ERROR_MESSAGE("Unexpected definition in definition index");
+      return CppDefinition();
+   }
+
+   using namespace safe_convert;
+   CppDefinition definition;
+   definition.USR = core::InternedString(array[0].get_str());
+   definition.kind = static_cast<CppDefinitionKind>(array[1].get_int());
+   definition.parentName = core::InternedString(array[2].get_str());
+   definition.name = core::InternedString(array[3].get_str());
+   definition.location.filePath = FilePath(file);
+   definition.location.line = numberTo<unsigned>(array[4].get_int(), 1);
+   definition.location.column = numberTo<unsigned>(array[5].get_int(), 1);
+   return definition;
+}
+
+// read a definition written by earlier versions (as an object)
 CppDefinition cppDefinitionFromJson(const json::Object& object)
 {
    // read json
    int kind;
    int line, column;
-   std::string file;
+   std::string USR, parentName, name, file;
    CppDefinition definition;
    Error error = json::readObject(object,
-                                  "usr", &definition.USR,
+                                  "usr", &USR,
                                   "kind", &kind,
-                                  "parent_name", &definition.parentName,
-                                  "name", &definition.name,
+                                  "parent_name", &parentName,
+                                  "name", &name,
                                   "file", &file,
                                   "line", &line,
                                   "column", &column);
@@ -446,6 +595,9 @@ CppDefinition cppDefinitionFromJson(const json::Object& object)
 
    // required data transforms
    using namespace safe_convert;
+   definition.USR = core::InternedString(USR);
+   definition.parentName = core::InternedString(parentName);
+   definition.name = core::InternedString(name);
    definition.kind = static_cast<CppDefinitionKind>(kind);
    definition.location.filePath = FilePath(file);
    definition.location.line = numberTo<unsigned>(line, 1);
@@ -456,6 +608,12 @@ CppDefinition cppDefinitionFromJson(const json::Object& object)
 }
 
 FilePath definitionIndexFilePath()
+{
+   return module_context::scopedScratchPath().childPath("cpp-definition-index");
+}
+
+// index written (in the older, object based format) by earlier versions
+FilePath legacyDefinitionIndexFilePath()
 {
    return module_context::scopedScratchPath().childPath("cpp-definition-cache");
 }
@@ -465,6 +623,8 @@ void loadDefinitionIndex()
    using namespace safe_convert;
 
    FilePath indexFilePath = definitionIndexFilePath();
+   if (!indexFilePath.exists())
+      indexFilePath = legacyDefinitionIndexFilePath();
    if (!indexFilePath.exists())
       return;
 
@@ -513,19 +673,30 @@ void loadDefinitionIndex()
 
       BOOST_FOREACH(const json::Value& defJson, defsArrayJson)
       {
-         if (!json::isType<json::Object>(defJson))
+         CppDefinition definition;
+         if (json::isType<json::Array>(defJson))
+         {
+            definition = cppDefinitionFromJson(defJson.get_array(),
+                                               definitions.file);
+         }
+         else if (json::isType<json::Object>(defJson))
+         {
+            definition = cppDefinitionFromJson(defJson.get_obj());
+         }
+         else
          {
-            LOG_ERROR_MESSAGE("Unexpected non-object type in definition index");
+            LOG_ERROR_MESSAGE("Unexpected type in definition index");
             continue;
          }
 
-         CppDefinition definition = cppDefinitionFromJson(defJson.get_obj());
          if (!definition.empty())
             definitions.definitions.push_back(definition);
       }
 
       s_definitionsByFile[definitions.file] = definitions;
    }
+
+   s_definitionLookup.invalidate();
 }
 
 
@@ -552,10 +723,14 @@ void saveDefinitionIndex()
    }
 
    std::ostringstream ostr;
-   json::writeFormatted(indexJson, ostr);
+   json::write(indexJson, ostr);
    Error error = writeStringToFile(definitionIndexFilePath(), ostr.str());
    if (error)
       LOG_ERROR(error);
+
+   error = legacyDefinitionIndexFilePath().removeIfExists();
+   if (error)
+      LOG_ERROR(error);
 }
 
 void onShutdown(bool terminatedNormally)
@@ -598,17 +773,15 @@ void searchDefinitions(const std::string& term,
    // for within the in-memory index)
    // if we didn't find it there then look for it in our index
    // of all saved files
-   BOOST_FOREACH(const DefinitionsByFile::value_type& defs, s_definitionsByFile)
+   BOOST_FOREACH(const IndexedDefinition& indexed,
+                 s_definitionLookup.candidates(term))
    {
       // skip files we've already searched
-      if (units.find(defs.first) != units.end())
+      if (units.find(*indexed.pFile) != units.end())
          continue;
 
-      BOOST_FOREACH(const CppDefinition& def, defs.second.definitions)
-      {
-         if (matches(term, pattern, def))
-            pDefinitions->push_back(def);
-      }
+      if (matches(term, pattern, *indexed.pDefinition))
+         pDefinitions->push_back(*indexed.pDefinition);
    }
 }
 
@@ -20,6 +20,7 @@
 #include <iosfwd>
 
 #include <core/FilePath.hpp>
+#include <core/InternedString.hpp>
 #include <core/libclang/LibClang.hpp>
 
 namespace rstudio {
@@ -70,10 +71,12 @@ struct CppDefinition
 
    bool empty() const { return name.empty(); }
 
-   std::string USR;
+   // interned, as the same USRs and (especially) parent names recur
+   // throughout the definitions of all indexed files
+   core::InternedString USR;
    CppDefinitionKind kind;
-   std::string parentName; // e.g. containing C++ class
-   std::string name;
+   core::InternedString parentName; // e.g. containing C++ class
+   core::InternedString name;
    core::libclang::FileLocation location;
 };
 
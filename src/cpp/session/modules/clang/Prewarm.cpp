@@ -0,0 +1,213 @@
+/*
+ * Prewarm.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "Prewarm.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <set>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include <core/Error.hpp>
+#include <core/FileInfo.hpp>
+#include <core/FilePath.hpp>
+#include <core/libclang/LibClang.hpp>
+
+#include <session/SessionModuleContext.hpp>
+#include <session/SessionSourceDatabase.hpp>
+#include <session/projects/SessionProjects.hpp>
+
+#include "../jobs/JobsApi.hpp"
+
+#include "RSourceIndex.hpp"
+
+using namespace rstudio::core ;
+using namespace rstudio::core::libclang;
+
+namespace rstudio {
+namespace session {
+namespace modules { 
+namespace clang {
+
+namespace {
+
+// fraction of the (idle) time spent parsing translation units: after each
+// parse we wait long enough to keep to this budget
+const double kCpuBudget = 0.25;
+
+// translation units are held in memory once parsed (and can be large), so
+// we only prewarm the most recently modified of the project's files
+const std::size_t kMaxProjectFiles = 8;
+
+std::deque<std::string> s_pending;
+std::set<std::string> s_queued;
+boost::shared_ptr<jobs::Job> s_pJob;
+int s_completed = 0;
+
+bool compareLastWriteTime(const FilePath& lhs, const FilePath& rhs)
+{
+   return lhs.lastWriteTime() > rhs.lastWriteTime();
+}
+
+void enqueue(const FilePath& filePath)
+{
+   std::string filename = filePath.absolutePath();
+   if (s_queued.insert(filename).second)
+      s_pending.push_back(filename);
+}
+
+void enqueueOpenDocuments()
+{
+   std::vector<boost::shared_ptr<source_database::SourceDocument> > docs;
+   Error error = source_database::list(&docs, false);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+   
+   // dirty documents first (they're being edited), then the rest in order
+   // of modification
+   std::vector<FilePath> dirty, saved;
+   BOOST_FOREACH(boost::shared_ptr<source_database::SourceDocument> pDoc, docs)
+   {
+      if (pDoc->path().empty())
+         continue;
+      
+      FilePath docPath = module_context::resolveAliasedPath(pDoc->path());
+      if (!SourceIndex::isSourceFile(docPath))
+         continue;
+      
+      if (pDoc->dirty())
+         dirty.push_back(docPath);
+      else
+         saved.push_back(docPath);
+   }
+   
+   std::sort(dirty.begin(), dirty.end(), compareLastWriteTime);
+   std::sort(saved.begin(), saved.end(), compareLastWriteTime);
+   
+   std::for_each(dirty.begin(), dirty.end(), enqueue);
+   std::for_each(saved.begin(), saved.end(), enqueue);
+}
+
+void enqueueProjectFiles()
+{
+   using namespace projects;
+   if (projectContext().config().buildType != r_util::kBuildTypePackage)
+      return;
+   
+   FilePath srcPath = projectContext().buildTargetPath().childPath("src");
+   if (!srcPath.exists())
+      return;
+   
+   std::vector<FilePath> children;
+   Error error = srcPath.children(&children);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+   
+   // translation units only (headers are parsed as part of them)
+   std::vector<FilePath> files;
+   BOOST_FOREACH(const FilePath& child, children)
+   {
+      if (!SourceIndex::isHeaderFile(child) &&
+          isIndexableFile(FileInfo(child), srcPath, FilePath()))
+      {
+         files.push_back(child);
+      }
+   }
+   
+   std::sort(files.begin(), files.end(), compareLastWriteTime);
+   if (files.size() > kMaxProjectFiles)
+      files.resize(kMaxProjectFiles);
+   
+   std::for_each(files.begin(), files.end(), enqueue);
+}
+
+void prewarmNext()
+{
+   if (s_pending.empty())
+   {
+      if (s_pJob)
+      {
+         jobs::setJobState(s_pJob, jobs::JobSucceeded);
+         s_pJob.reset();
+      }
+      return;
+   }
+   
+   std::string filename = s_pending.front();
+   s_pending.pop_front();
+   
+   if (s_pJob)
+      jobs::setJobStatus(s_pJob, FilePath(filename).filename());
+   
+   // parse the translation unit (if we don't already have it)
+   using namespace boost::posix_time;
+   ptime start = microsec_clock::universal_time();
+   rSourceIndex().primeEditorTranslationUnit(filename);
+   time_duration elapsed = microsec_clock::universal_time() - start;
+   
+   if (s_pJob)
+      jobs::setJobProgress(s_pJob, ++s_completed);
+   
+   // wait before parsing the next one to keep to our budget
+   long waitMs = static_cast<long>(
+            elapsed.total_milliseconds() * (1 - kCpuBudget) / kCpuBudget);
+   module_context::scheduleDelayedWork(
+            milliseconds(std::max(waitMs, 100L)),
+            prewarmNext,
+            true); // require idle
+}
+
+void onDeferredInit(bool newSession)
+{
+   enqueueOpenDocuments();
+   enqueueProjectFiles();
+   if (s_pending.empty())
+      return;
+   
+   s_pJob = jobs::addJob("Indexing C/C++ files",
+                         "",
+                         "",
+                         static_cast<int>(s_pending.size()),
+                         jobs::JobRunning,
+                         true,  // remove when complete
+                         R_NilValue,
+                         false);
+   
+   module_context::scheduleDelayedWork(
+            boost::posix_time::seconds(1),
+            prewarmNext,
+            true); // require idle
+}
+
+} // anonymous namespace
+
+Error initializePrewarm()
+{
+   module_context::events().onDeferredInit.connect(onDeferredInit);
+   return Success();
+}
+
+} // namespace clang
+} // namespace modules
+} // namespace session
+} // namespace rstudio
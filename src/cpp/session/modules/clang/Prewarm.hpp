@@ -0,0 +1,40 @@
+/*
+ * Prewarm.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_MODULES_CLANG_PREWARM_HPP
+#define SESSION_MODULES_CLANG_PREWARM_HPP
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace session {
+namespace modules {      
+namespace clang {
+
+// parse the translation units of open C++ documents, and then of the
+// project's src/ files, during idle time once the session has started (so
+// that the first completion or definition search in them doesn't stall)
+core::Error initializePrewarm();
+
+} // namespace clang
+} // namepace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_MODULES_CLANG_PREWARM_HPP
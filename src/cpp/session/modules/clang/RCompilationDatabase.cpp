@@ -18,6 +18,7 @@
 #include <algorithm>
 
 #include <boost/format.hpp>
+#include <boost/foreach.hpp>
 #include <boost/regex.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/trim_all.hpp>
@@ -26,10 +27,12 @@
 #include <core/Algorithm.hpp>
 #include <core/PerformanceTimer.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
 
 #include <core/r_util/RToolsInfo.hpp>
 #include <core/r_util/RPackageInfo.hpp>
 
+#include <core/system/System.hpp>
 #include <core/system/ProcessArgs.hpp>
 #include <core/system/FileScanner.hpp>
 
@@ -163,9 +166,20 @@ std::string buildFileHash(const FilePath& filePath)
    }
 }
 
+// compilation args depend on the R installation as well as on the build
+// files (so are discovered again when R is upgraded)
+const std::string& rVersionHash()
+{
+   static std::string hash;
+   if (hash.empty())
+      hash = module_context::rVersion() + ":" + module_context::rHomeDir();
+   return hash;
+}
+
 std::string packageBuildFileHash()
 {
    std::ostringstream ostr;
+   ostr << rVersionHash();
    FilePath buildPath = projects::projectContext().buildTargetPath();
    ostr << buildFileHash(buildPath.childPath("DESCRIPTION"));
    FilePath srcPath = buildPath.childPath("src");
@@ -271,11 +285,7 @@ RCompilationDatabase::RCompilationDatabase()
 void RCompilationDatabase::updateForCurrentPackage()
 {
    // one time restore of compilation config
-   if (!restoredCompilationConfig_)
-   {
-      restorePackageCompilationConfig();
-      restoredCompilationConfig_ = true;
-   }
+   restoreCompilationConfig();
 
    // check hash to see if we can avoid this computation
    std::string buildFileHash = packageBuildFileHash();
@@ -357,7 +367,7 @@ void RCompilationDatabase::updateForCurrentPackage()
       packageBuildFileHash_ = buildFileHash;
 
       // save them to disk
-      savePackageCompilationConfig();
+      saveCompilationConfig();
    }
 
 }
@@ -423,16 +433,71 @@ FilePath compilationConfigFilePath()
    return module_context::scopedScratchPath().complete("cpp-complilation-config");
 }
 
+json::Object compilationConfigToJson(const std::vector<std::string>& args,
+                                     const std::string& PCH,
+                                     bool isCpp,
+                                     const std::string& hash)
+{
+   json::Object configJson;
+   configJson["args"] = json::toJsonArray(args);
+   configJson["pch"] = PCH;
+   configJson["is_cpp"] = isCpp;
+   configJson["hash"] = hash;
+   return configJson;
+}
+
+Error compilationConfigFromJson(const json::Object& configJson,
+                                std::vector<std::string>* pArgs,
+                                std::string* pPCH,
+                                bool* pIsCpp,
+                                std::string* pHash)
+{
+   json::Array argsJson;
+   Error error = json::readObject(configJson,
+                                  "args", &argsJson,
+                                  "pch", pPCH,
+                                  "is_cpp", pIsCpp,
+                                  "hash", pHash);
+   if (error)
+      return error;
+
+   pArgs->clear();
+   BOOST_FOREACH(const json::Value& argJson, argsJson)
+   {
+      if (json::isType<std::string>(argJson))
+         pArgs->push_back(argJson.get_str());
+   }
+   return Success();
+}
 
 } // anonymous namespace
 
-void RCompilationDatabase::savePackageCompilationConfig()
+// the package's config is saved along with those of its sourceCpp files
+// (keyed by file), so that none need be discovered again in new sessions
+void RCompilationDatabase::saveCompilationConfig()
 {
-   json::Object configJson;
-   configJson["args"] = json::toJsonArray(packageCompilationConfig_.args);
-   configJson["pch"] = packageCompilationConfig_.PCH;
-   configJson["is_cpp"] = packageCompilationConfig_.isCpp;
-   configJson["hash"] = packageBuildFileHash_;
+   json::Object configJson = compilationConfigToJson(
+                                       packageCompilationConfig_.args,
+                                       packageCompilationConfig_.PCH,
+                                       packageCompilationConfig_.isCpp,
+                                       packageBuildFileHash_);
+
+   json::Object sourceCppJson;
+   for (ConfigMap::const_iterator it = sourceCppConfigMap_.begin();
+        it != sourceCppConfigMap_.end();
+        ++it)
+   {
+      // (don't keep configs of files which have since been removed)
+      SourceCppHashes::const_iterator hash = sourceCppHashes_.find(it->first);
+      if (hash == sourceCppHashes_.end() || !FilePath(it->first).exists())
+         continue;
+
+      sourceCppJson[it->first] = compilationConfigToJson(it->second.args,
+                                                         it->second.PCH,
+                                                         it->second.isCpp,
+                                                         hash->second);
+   }
+   configJson["source_cpp"] = sourceCppJson;
 
    std::ostringstream ostr;
    json::writeFormatted(configJson, ostr);
@@ -441,8 +506,12 @@ void RCompilationDatabase::savePackageCompilationConfig()
       LOG_ERROR(error);
 }
 
-void RCompilationDatabase::restorePackageCompilationConfig()
+void RCompilationDatabase::restoreCompilationConfig()
 {
+   if (restoredCompilationConfig_)
+      return;
+   restoredCompilationConfig_ = true;
+
    FilePath configFilePath = compilationConfigFilePath();
    if (!configFilePath.exists())
       return;
@@ -463,12 +532,12 @@ void RCompilationDatabase::restorePackageCompilationConfig()
       return;
    }
 
-   json::Array argsJson;
-   error = json::readObject(configJson.get_obj(),
-                            "args", &argsJson,
-                            "pch", &packageCompilationConfig_.PCH,
-                            "is_cpp", &packageCompilationConfig_.isCpp,
-                            "hash", &packageBuildFileHash_);
+   const json::Object& configObject = configJson.get_obj();
+   error = compilationConfigFromJson(configObject,
+                                     &packageCompilationConfig_.args,
+                                     &packageCompilationConfig_.PCH,
+                                     &packageCompilationConfig_.isCpp,
+                                     &packageBuildFileHash_);
    if (error)
    {
       error.addProperty("json", contents);
@@ -476,27 +545,55 @@ void RCompilationDatabase::restorePackageCompilationConfig()
       return;
    }
 
-   packageCompilationConfig_.args.clear();
-   BOOST_FOREACH(const json::Value& argJson, argsJson)
+   // sourceCpp configs (not saved by older versions)
+   json::Object::const_iterator sourceCpp = configObject.find("source_cpp");
+   if (sourceCpp == configObject.end() ||
+       !json::isType<json::Object>(sourceCpp->second))
+      return;
+
+   const json::Object& sourceCppJson = sourceCpp->second.get_obj();
+   for (json::Object::const_iterator it = sourceCppJson.begin();
+        it != sourceCppJson.end();
+        ++it)
    {
-      if (json::isType<std::string>(argJson))
-         packageCompilationConfig_.args.push_back(argJson.get_str());
+      if (!json::isType<json::Object>(it->second))
+         continue;
+
+      CompilationConfig config;
+      std::string hash;
+      error = compilationConfigFromJson(it->second.get_obj(),
+                                        &config.args,
+                                        &config.PCH,
+                                        &config.isCpp,
+                                        &hash);
+      if (error)
+      {
+         LOG_ERROR(error);
+         continue;
+      }
+
+      sourceCppConfigMap_[it->first] = config;
+      sourceCppHashes_[it->first] = hash;
    }
 }
 
 void RCompilationDatabase::updateForSourceCpp(const core::FilePath& srcFile)
 {
+   // one time restore of compilation config
+   restoreCompilationConfig();
+
    // read the the source cpp hash for this file
    SourceCppFileInfo info = sourceCppFileInfo(srcFile);
 
+   // if there is no info then bail
+   if (info.empty())
+      return;
+
    // check if we already have the args for this hash value
    std::string filename = srcFile.absolutePath();
+   std::string hash = rVersionHash() + info.hash;
    SourceCppHashes::const_iterator it = sourceCppHashes_.find(filename);
-   if (it != sourceCppHashes_.end() && it->second == info.hash)
-      return;
-
-   // if there is no info then bail
-   if (info.empty())
+   if (it != sourceCppHashes_.end() && it->second == hash)
       return;
 
    // if we are disabling indexing then bail
@@ -518,7 +615,10 @@ void RCompilationDatabase::updateForSourceCpp(const core::FilePath& srcFile)
       sourceCppConfigMap_[filename] = config;
 
       // save hash to prevent recomputation
-      sourceCppHashes_[filename] = info.hash;
+      sourceCppHashes_[filename] = hash;
+
+      // save them to disk
+      saveCompilationConfig();
    }
 }
 
@@ -948,10 +1048,37 @@ core::system::Options RCompilationDatabase::compilationEnvironment() const
 
 namespace {
 
+// precompiled headers are kept in user scratch storage (rather than the
+// session temp dir) so they survive session restarts; parsing e.g. the
+// RcppArmadillo headers from scratch takes several seconds
 FilePath precompiledHeaderDir(const std::string& pkgName)
 {
-   return module_context::tempDir().childPath("rstudio/libclang/precompiled/"
-                                              + pkgName);
+   return module_context::userScratchPath().childPath("libclang/precompiled/"
+                                                      + pkgName);
+}
+
+// key identifying the inputs a precompiled header was built from: the
+// compilation args and the modification times of the package's headers
+// (which change if the package is reinstalled)
+std::string precompiledHeaderKey(const std::string& pkgPath,
+                                 const std::string& pkgName,
+                                 const std::vector<std::string>& args)
+{
+   std::string key = boost::algorithm::join(args, " ");
+   
+   FilePath pkgDir(pkgPath);
+   FilePath files[] = {
+      pkgDir.childPath("DESCRIPTION"),
+      pkgDir.childPath("include/" + pkgName + ".h")
+   };
+   
+   BOOST_FOREACH(const FilePath& file, files)
+   {
+      key += " " + file.absolutePath() + ":" +
+             safe_convert::numberToString(file.lastWriteTime());
+   }
+   
+   return core::hash::crc32HexHash(key);
 }
 
 } // anonymous namespace
@@ -975,8 +1102,8 @@ std::vector<std::string> RCompilationDatabase::precompiledHeaderArgs(
       LOG_ERROR(error);
       return std::vector<std::string>();
    }
-   pkgPath = core::hash::crc32HexHash(pkgPath);
-   precompiledDir = precompiledDir.childPath(pkgPath);
+   precompiledDir = precompiledDir.childPath(
+                                    core::hash::crc32HexHash(pkgPath));
 
    // platform/rcpp version specific directory name
    std::string clangVersion = clang().version().asString();
@@ -1013,12 +1140,35 @@ std::vector<std::string> RCompilationDatabase::precompiledHeaderArgs(
       }
    }
 
+   // base args used to create the PCH
+   std::vector<std::string> baseArgs = baseCompilationArgs(true);
+   if (!stdArg.empty())
+      baseArgs.push_back(stdArg);
+   
    // now create the PCH if we need to
-   FilePath pchPath = platformPath.childPath(pkgName + stdArg + ".pch");
+   std::string pchStem = pkgName + stdArg;
+   std::string key = precompiledHeaderKey(pkgPath, pkgName, baseArgs);
+   FilePath pchPath = platformPath.childPath(pchStem + "-" + key + ".pch");
    if (!pchPath.exists())
    {
+      // remove PCHs built from other inputs
+      std::vector<FilePath> children;
+      Error error = platformPath.children(&children);
+      if (error)
+         LOG_ERROR(error);
+      BOOST_FOREACH(const FilePath& child, children)
+      {
+         if (child.extensionLowerCase() == ".pch" &&
+             boost::algorithm::starts_with(child.stem(), pchStem + "-"))
+         {
+            Error error = child.removeIfExists();
+            if (error)
+               LOG_ERROR(error);
+         }
+      }
+      
       // state cpp file for creating precompiled headers
-      FilePath cppPath = platformPath.childPath(pkgName + stdArg + ".cpp");
+      FilePath cppPath = platformPath.childPath(pchStem + ".cpp");
       std::string contents;
       boost::format fmt("#include <%1%.h>\n");
       contents.append(boost::str(fmt % pkgName));
@@ -1029,12 +1179,8 @@ std::vector<std::string> RCompilationDatabase::precompiledHeaderArgs(
          return std::vector<std::string>();
       }
 
-      // start with base args
-      std::vector<std::string> args = baseCompilationArgs(true);
-
-      // -std argument
-      if (!stdArg.empty())
-         args.push_back(stdArg);
+      // start with base args (including -std argument)
+      std::vector<std::string> args = baseArgs;
 
       // run R CMD SHLIB
       core::system::Options env = compilationEnvironment();
@@ -1074,8 +1220,12 @@ std::vector<std::string> RCompilationDatabase::precompiledHeaderArgs(
          return std::vector<std::string>();
       }
 
+      // save to a temporary file and then move it into place, so that
+      // other sessions never see a partially written PCH
+      FilePath tempPchPath = platformPath.childPath(
+               pchStem + "-" + core::system::generateShortenedUuid() + ".tmp");
       int ret = clang().saveTranslationUnit(tu,
-                                            pchPath.absolutePath().c_str(),
+                                            tempPchPath.absolutePath().c_str(),
                                             clang().defaultSaveOptions(tu));
       if (ret != CXSaveError_None)
       {
@@ -1087,6 +1237,18 @@ std::vector<std::string> RCompilationDatabase::precompiledHeaderArgs(
          if (removeError)
             LOG_ERROR(removeError);
       }
+      else
+      {
+         Error error = tempPchPath.move(pchPath);
+         if (error)
+         {
+            LOG_ERROR(error);
+            
+            Error removeError = tempPchPath.removeIfExists();
+            if (removeError)
+               LOG_ERROR(removeError);
+         }
+      }
 
       clang().disposeTranslationUnit(tu);
 
@@ -68,12 +68,13 @@ private:
                                      const core::FilePath& pkgPath);
 
 
-   void savePackageCompilationConfig();
-   void restorePackageCompilationConfig();
+   void saveCompilationConfig();
+   void restoreCompilationConfig();
 
    // struct used to represent compilation settings
    struct CompilationConfig
    {
+      CompilationConfig() : isCpp(false) {}
       bool empty() const { return args.empty(); }
       std::vector<std::string> args;
       std::string PCH;
@@ -15,7 +15,12 @@
 
 #include "SessionClang.hpp"
 
+#include <algorithm>
+
+#include <boost/foreach.hpp>
+
 #include <core/Exec.hpp>
+#include <core/MemoryAccounting.hpp>
 
 #include <core/json/JsonRpc.hpp>
 
@@ -35,6 +40,7 @@
 #include "DefinitionIndex.hpp"
 #include "FindReferences.hpp"
 #include "GoToDefinition.hpp"
+#include "Prewarm.hpp"
 #include "CodeCompletion.hpp"
 #include "RSourceIndex.hpp"
 
@@ -151,6 +157,62 @@ void onAllSourceDocsRemoved()
    rSourceIndex().removeAllTranslationUnits();
 }
 
+void onLowMemory()
+{
+   // translation units are reparsed when next needed
+   rSourceIndex().removeAllTranslationUnits();
+}
+
+typedef std::pair<std::size_t, std::string> TranslationUnitUsage;
+
+// the memory held by each translation unit, largest first
+std::vector<TranslationUnitUsage> translationUnitsUsage()
+{
+   typedef std::map<std::string, libclang::TranslationUnit> TranslationUnits;
+
+   std::vector<TranslationUnitUsage> usage;
+   TranslationUnits units = rSourceIndex().getIndexedTranslationUnits();
+   for (TranslationUnits::const_iterator it = units.begin(); it != units.end(); ++it)
+      usage.push_back(std::make_pair(it->second.memoryUsage(), it->first));
+
+   std::sort(usage.rbegin(), usage.rend());
+   return usage;
+}
+
+memory_accounting::Usage translationUnitsMemoryUsage()
+{
+   std::vector<TranslationUnitUsage> units = translationUnitsUsage();
+
+   memory_accounting::Usage usage(0, units.size());
+   BOOST_FOREACH(const TranslationUnitUsage& unit, units)
+   {
+      usage.bytes += unit.first;
+   }
+   return usage;
+}
+
+// remove the largest translation units until we're within budget (like
+// on low memory, they're reparsed when next needed)
+void evictTranslationUnits(std::size_t budget)
+{
+   std::vector<TranslationUnitUsage> units = translationUnitsUsage();
+
+   std::size_t bytes = 0;
+   BOOST_FOREACH(const TranslationUnitUsage& unit, units)
+   {
+      bytes += unit.first;
+   }
+
+   BOOST_FOREACH(const TranslationUnitUsage& unit, units)
+   {
+      if (bytes <= budget)
+         break;
+
+      rSourceIndex().removeTranslationUnit(unit.second);
+      bytes -= unit.first;
+   }
+}
+
 bool cppIndexingDisabled()
 {
    return ! r::options::getOption<bool>("rstudio.indexCpp", true, false);
@@ -245,11 +307,22 @@ Error initialize()
    if (error)
       return error;
 
+   // parse the translation units we're likely to need once the session
+   // has started
+   error = initializePrewarm();
+   if (error)
+      return error;
+
    // subscribe to source docs events for maintaining the unsaved files list
    // main source index and the unsaved files list)
    source_database::events().onDocUpdated.connect(onSourceDocUpdated);
    source_database::events().onDocRemoved.connect(onSourceDocRemoved);
    source_database::events().onRemoveAll.connect(onAllSourceDocsRemoved);
+   module_context::events().onLowMemory.connect(onLowMemory);
+
+   memory_accounting::registerSubsystem("clang",
+                                        translationUnitsMemoryUsage,
+                                        evictTranslationUnits);
 
    return Success();
 }
@@ -13,6 +13,9 @@
  *
  */
 
+#include <set>
+#include <sstream>
+
 #include <core/Macros.hpp>
 #include <core/Algorithm.hpp>
 #include <core/Debug.hpp>
@@ -20,6 +23,7 @@
 #include <core/Exec.hpp>
 #include <core/FilePath.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
 #include <core/text/DcfParser.hpp>
 
 #include <boost/regex.hpp>
@@ -38,6 +42,8 @@
 #include <session/SessionModuleContext.hpp>
 #include <session/SessionPackageProvidedExtension.hpp>
 
+#include "../SessionLibPathsIndexer.hpp"
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -91,6 +97,17 @@ public:
       
       return object;
    }
+
+   static Error fromJson(const json::Object& object,
+                         ConnectionsIndexEntry* pEntry)
+   {
+      return json::readObject(object,
+                              "name", &pEntry->name_,
+                              "package", &pEntry->package_,
+                              "shinyapp", &pEntry->shinyapp_,
+                              "help", &pEntry->help_,
+                              "icon", &pEntry->icon_);
+   }
    
 private:
    std::string name_;
@@ -109,18 +126,24 @@ public:
       connections_[constructKey(package, spec.getName())] = spec;
    }
 
-   void add(const std::string& pkgName,
-            std::map<std::string, std::string>& fields)
-   {  
-      add(pkgName, ConnectionsIndexEntry(
-         fields["Name"],
-         pkgName,
-         fields["ShinyApp"],
-         fields["HelpUrl"],
-         fields["Icon"]));
+   void add(const std::vector<ConnectionsIndexEntry>& entries)
+   {
+      BOOST_FOREACH(const ConnectionsIndexEntry& entry, entries)
+      {
+         add(entry.getPackage(), entry);
+      }
    }
 
    void add(const std::string& pkgName, const FilePath& connectionExtensionPath)
+   {
+      std::vector<ConnectionsIndexEntry> entries;
+      readEntries(pkgName, connectionExtensionPath, &entries);
+      add(entries);
+   }
+
+   static void readEntries(const std::string& pkgName,
+                           const FilePath& connectionExtensionPath,
+                           std::vector<ConnectionsIndexEntry>* pEntries)
    {
       static const boost::regex reSeparator("\\n{2,}");
 
@@ -140,7 +163,12 @@ public:
          for (; it != end; ++it)
          {
             std::map<std::string, std::string> fields = parseConnectionsDcf(*it);
-            add(pkgName, fields);
+            pEntries->push_back(ConnectionsIndexEntry(
+               fields["Name"],
+               pkgName,
+               fields["ShinyApp"],
+               fields["HelpUrl"],
+               fields["Icon"]));
          }
       }
       CATCH_UNEXPECTED_EXCEPTION;
@@ -206,20 +234,181 @@ void updateConnectionsRegistry(boost::shared_ptr<ConnectionsRegistry> pRegistry)
    s_pCurrentConnectionsRegistry = pRegistry;
 }
 
+// the entries read from a package's connections.dcf, along with the
+// signature of the package and the file when they were read
+struct ExtensionEntries
+{
+   std::string signature;
+   std::vector<ConnectionsIndexEntry> entries;
+};
+
+// connections.dcf path => entries; persisted so that the files of packages
+// which haven't changed needn't be read again (in this or later sessions)
+std::map<std::string, ExtensionEntries> s_extensions;
+bool s_extensionsLoaded = false;
+
+FilePath extensionsCachePath()
+{
+   return module_context::userScratchPath().complete(
+                                 "connections/extensions.json");
+}
+
+void loadExtensions()
+{
+   if (s_extensionsLoaded)
+      return;
+   s_extensionsLoaded = true;
+
+   FilePath path = extensionsCachePath();
+   if (!path.exists())
+      return;
+
+   std::string contents;
+   Error error = readStringFromFile(path, &contents);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   json::Value value;
+   if (!json::parse(contents, &value) || value.type() != json::ArrayType)
+   {
+      LOG_ERROR_MESSAGE("Failed to parse connection extensions: " +
+                        path.absolutePath());
+      return;
+   }
+
+   BOOST_FOREACH(const json::Value& extensionJson, value.get_array())
+   {
+      if (extensionJson.type() != json::ObjectType)
+         continue;
+
+      std::string extensionPath;
+      ExtensionEntries extension;
+      json::Array entriesJson;
+      error = json::readObject(extensionJson.get_obj(),
+                               "path", &extensionPath,
+                               "signature", &extension.signature,
+                               "entries", &entriesJson);
+      if (!error)
+      {
+         BOOST_FOREACH(const json::Value& entryJson, entriesJson)
+         {
+            if (entryJson.type() != json::ObjectType)
+               continue;
+
+            ConnectionsIndexEntry entry;
+            error = ConnectionsIndexEntry::fromJson(entryJson.get_obj(), &entry);
+            if (error)
+               break;
+            extension.entries.push_back(entry);
+         }
+      }
+
+      if (error)
+      {
+         LOG_ERROR(error);
+         continue;
+      }
+      s_extensions[extensionPath] = extension;
+   }
+}
+
+void saveExtensions()
+{
+   json::Array extensionsJson;
+   for (std::map<std::string, ExtensionEntries>::const_iterator it =
+            s_extensions.begin();
+        it != s_extensions.end();
+        ++it)
+   {
+      json::Array entriesJson;
+      BOOST_FOREACH(const ConnectionsIndexEntry& entry, it->second.entries)
+      {
+         entriesJson.push_back(entry.toJson());
+      }
+
+      json::Object extensionJson;
+      extensionJson["path"] = it->first;
+      extensionJson["signature"] = it->second.signature;
+      extensionJson["entries"] = entriesJson;
+      extensionsJson.push_back(extensionJson);
+   }
+
+   FilePath path = extensionsCachePath();
+   Error error = path.parent().ensureDirectory();
+   if (!error)
+   {
+      std::ostringstream ostr;
+      json::write(extensionsJson, ostr);
+      error = writeStringToFile(path, ostr.str());
+   }
+   if (error)
+      LOG_ERROR(error);
+}
+
 class ConnectionsWorker : public ppe::Worker
 {
    void onIndexingStarted()
    {
       pRegistry_ = boost::make_shared<ConnectionsRegistry>();
+      loadExtensions();
+
+      // the installed packages have just been brought up to date, so their
+      // signatures tell us which have been (re)installed
+      packageSignatures_.clear();
+      BOOST_FOREACH(const libpaths::InstalledPackage& package,
+                    libpaths::installedPackages())
+      {
+         packageSignatures_[package.path.absolutePath()] = package.signature;
+      }
+      indexed_.clear();
+      changed_ = false;
    }
    
    void onWork(const std::string& pkgName, const FilePath& connectionExtensionPath)
    {
-      pRegistry_->add(pkgName, connectionExtensionPath);
+      std::string path = connectionExtensionPath.absolutePath();
+      std::string signature =
+            packageSignatures_[connectionExtensionPath.parent().parent().absolutePath()] +
+            ":" + safe_convert::numberToString(connectionExtensionPath.lastWriteTime()) +
+            ":" + safe_convert::numberToString(connectionExtensionPath.size());
+      indexed_.insert(path);
+
+      ExtensionEntries& extension = s_extensions[path];
+      if (extension.signature != signature)
+      {
+         extension.signature = signature;
+         extension.entries.clear();
+         ConnectionsRegistry::readEntries(pkgName,
+                                          connectionExtensionPath,
+                                          &extension.entries);
+         changed_ = true;
+      }
+
+      pRegistry_->add(extension.entries);
    }
    
    void onIndexingCompleted(json::Object* pPayload)
    {
+      // forget packages which have been removed and persist any changes
+      std::map<std::string, ExtensionEntries>::iterator it = s_extensions.begin();
+      while (it != s_extensions.end())
+      {
+         if (indexed_.count(it->first))
+         {
+            ++it;
+         }
+         else
+         {
+            s_extensions.erase(it++);
+            changed_ = true;
+         }
+      }
+      if (changed_)
+         saveExtensions();
+
       // finalize by indexing current package
       if (isDevtoolsLoadAllActive())
       {
@@ -254,7 +443,7 @@ class ConnectionsWorker : public ppe::Worker
 
 public:
    
-   ConnectionsWorker() : ppe::Worker("rstudio/connections.dcf") {}
+   ConnectionsWorker() : ppe::Worker("rstudio/connections.dcf"), changed_(false) {}
    
    void addContinuation(json::JsonRpcFunctionContinuation continuation)
    {
@@ -264,6 +453,9 @@ public:
 private:
    boost::shared_ptr<ConnectionsRegistry> pRegistry_;
    std::vector<json::JsonRpcFunctionContinuation> continuations_;
+   std::map<std::string, std::string> packageSignatures_;
+   std::set<std::string> indexed_;
+   bool changed_;
 };
 
 boost::shared_ptr<ConnectionsWorker>& connectionsWorker()
@@ -287,6 +479,20 @@ void registerConnectionsRegistryEntry(std::string packageName, std::string exten
 
 void registerConnectionsWorker()
 {
+   // start out with the connections found by the last session so they're
+   // available before the packages have been indexed
+   loadExtensions();
+   boost::shared_ptr<ConnectionsRegistry> pRegistry =
+                                 boost::make_shared<ConnectionsRegistry>();
+   for (std::map<std::string, ExtensionEntries>::const_iterator it =
+            s_extensions.begin();
+        it != s_extensions.end();
+        ++it)
+   {
+      pRegistry->add(it->second.entries);
+   }
+   updateConnectionsRegistry(pRegistry);
+
    ppe::indexer().addWorker(connectionsWorker());
 }
 
@@ -15,7 +15,11 @@
 
 #include "SessionConnections.hpp"
 
+#include <algorithm>
+#include <map>
+
 #include <boost/foreach.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -54,6 +58,60 @@ namespace connections {
 
 namespace {
 
+// listings of a connection's objects and fields are cached for a while
+// since catalog queries against large databases can be slow; a
+// connection's listings are dropped when it's updated, closed or refreshed
+const int kListingCacheTtlSeconds = 120;
+
+struct CachedListing
+{
+   json::Value listing;
+   boost::posix_time::ptime fetched;
+};
+
+// connection => (listing function and object specifier) => listing
+std::map<ConnectionId, std::map<std::string, CachedListing> > s_listingCache;
+
+bool cachedListing(const ConnectionId& id,
+                   const std::string& key,
+                   json::Value* pListing)
+{
+   std::map<ConnectionId, std::map<std::string, CachedListing> >::iterator it =
+                                                      s_listingCache.find(id);
+   if (it == s_listingCache.end())
+      return false;
+
+   std::map<std::string, CachedListing>::iterator listingIt =
+                                                      it->second.find(key);
+   if (listingIt == it->second.end())
+      return false;
+
+   using namespace boost::posix_time;
+   if (second_clock::universal_time() - listingIt->second.fetched >
+       seconds(kListingCacheTtlSeconds))
+   {
+      it->second.erase(listingIt);
+      return false;
+   }
+
+   *pListing = listingIt->second.listing;
+   return true;
+}
+
+void cacheListing(const ConnectionId& id,
+                  const std::string& key,
+                  const json::Value& listing)
+{
+   CachedListing& cached = s_listingCache[id][key];
+   cached.listing = listing;
+   cached.fetched = boost::posix_time::second_clock::universal_time();
+}
+
+void clearListingCache(const ConnectionId& id)
+{
+   s_listingCache.erase(id);
+}
+
 SEXP rs_connectionOpened(SEXP connectionSEXP)
 {
    // read params -- note that these attributes are already guaranteed to
@@ -183,6 +241,7 @@ SEXP rs_connectionClosed(SEXP typeSEXP, SEXP hostSEXP)
 
    // update active connections
    activeConnections().remove(ConnectionId(type, host));
+   clearListingCache(ConnectionId(type, host));
 
    return R_NilValue;
 }
@@ -193,6 +252,7 @@ SEXP rs_connectionUpdated(SEXP typeSEXP, SEXP hostSEXP, SEXP hintSEXP)
    std::string host = r::sexp::safeAsString(hostSEXP);
    std::string hint = r::sexp::safeAsString(hintSEXP);
    ConnectionId id(type, host);
+   clearListingCache(id);
 
    json::Object updatedJson;
    updatedJson["id"] = connectionIdJson(id);
@@ -349,6 +409,78 @@ Error connectionExecuteAction(const json::JsonRpcRequest& request,
                                  action).call();
 }
 
+// list the objects or fields (per the given R function) within the
+// specified object of a connection
+Error listConnection(const std::string& function,
+                     const ConnectionId& connectionId,
+                     const json::Array& objectSpecifier,
+                     json::Value* pListing)
+{
+   std::string key = function + ":" + json::write(objectSpecifier);
+   if (cachedListing(connectionId, key, pListing))
+      return Success();
+
+   SEXP listing;
+   r::sexp::Protect protect;
+   r::exec::RFunction list(function, connectionId.type, connectionId.host);
+   addObjectSpecifiers(objectSpecifier, &list);
+   Error error = list.call(&listing, &protect);
+   if (error)
+      return error;
+
+   error = r::json::jsonValueFromObject(listing, pListing);
+   if (error)
+      return error;
+
+   cacheListing(connectionId, key, *pListing);
+   return Success();
+}
+
+// respond with the listing, or (if the request has offset and limit
+// params) just a page of it along with the total number of entries
+void sendListing(const json::JsonRpcRequest& request,
+                 const json::Value& listing,
+                 const json::JsonRpcFunctionContinuation& continuation)
+{
+   json::JsonRpcResponse response;
+
+   if (request.params.size() < 4)
+   {
+      response.setResult(listing);
+      continuation(Success(), &response);
+      return;
+   }
+
+   int offset = 0, limit = 0;
+   Error error = json::readParam(request.params, 2, &offset);
+   if (!error)
+      error = json::readParam(request.params, 3, &limit);
+   if (!error && (offset < 0 || limit < 0))
+      error = Error(json::errc::ParamInvalid, ERROR_LOCATION);
+   if (error)
+   {
+      continuation(error, &response);
+      return;
+   }
+
+   json::Array items;
+   std::size_t total = 0;
+   if (json::isType<json::Array>(listing))
+   {
+      const json::Array& entries = listing.get_array();
+      total = entries.size();
+      std::size_t begin = std::min(static_cast<std::size_t>(offset), total);
+      std::size_t end = std::min(begin + static_cast<std::size_t>(limit), total);
+      items.assign(entries.begin() + begin, entries.begin() + end);
+   }
+
+   json::Object page;
+   page["items"] = items;
+   page["total"] = static_cast<int>(total);
+   response.setResult(page);
+   continuation(Success(), &response);
+}
+
 void connectionListObjects(const json::JsonRpcRequest& request,
                            const json::JsonRpcFunctionContinuation& continuation)
 {
@@ -364,35 +496,18 @@ void connectionListObjects(const json::JsonRpcRequest& request,
       return;
    }
 
-   // response
-   json::JsonRpcResponse response;
-
    // get the list of objects
-   SEXP objects;
-   r::sexp::Protect protect;
-   r::exec::RFunction listObjects(".rs.connectionListObjects",
-                                 connectionId.type,
-                                 connectionId.host);
-   addObjectSpecifiers(objectSpecifier, &listObjects);
-   error = listObjects.call(&objects, &protect);
+   json::Value objects;
+   error = listConnection(".rs.connectionListObjects", connectionId,
+                          objectSpecifier, &objects);
    if (error)
    {
+      json::JsonRpcResponse response;
       continuation(error, &response);
+      return;
    }
-   else
-   {
-      json::Value result;
-      error = r::json::jsonValueFromObject(objects, &result);
-      if (error)
-      {
-         continuation(error, &response);
-      }
-      else
-      {
-         response.setResult(result);
-         continuation(Success(), &response);
-      }
-   }
+
+   sendListing(request, objects, continuation);
 }
 
 void sendResponse(const Error& error,
@@ -442,17 +557,30 @@ void connectionListFields(const json::JsonRpcRequest& request,
    }
 
    // get the list of fields
-   r::sexp::Protect rProtect;
-   SEXP sexpResult;
-   r::exec::RFunction listCols(".rs.connectionListColumns",
-                                 connectionId.type,
-                                 connectionId.host);
-   
-   addObjectSpecifiers(objectSpecifier, &listCols);
-   error = listCols.call(&sexpResult, &rProtect);
+   json::Value fields;
+   error = listConnection(".rs.connectionListColumns", connectionId,
+                          objectSpecifier, &fields);
+   if (error)
+   {
+      LOG_ERROR(error);
+      json::JsonRpcResponse response;
+      continuation(error, &response);
+      return;
+   }
 
-   // send the response
-   sendResponse(error, sexpResult, continuation, ERROR_LOCATION);
+   sendListing(request, fields, continuation);
+}
+
+Error connectionRefresh(const json::JsonRpcRequest& request,
+                        json::JsonRpcResponse* pResponse)
+{
+   ConnectionId connectionId;
+   Error error = readConnectionIdParam(request, &connectionId);
+   if (error)
+      return error;
+
+   clearListingCache(connectionId);
+   return Success();
 }
 
 void connectionPreviewObject(const json::JsonRpcRequest& request,
@@ -722,6 +850,7 @@ Error initialize()
       (bind(registerRpcMethod, "connection_execute_action", connectionExecuteAction))
       (bind(registerIdleOnlyAsyncRpcMethod, "connection_list_objects", connectionListObjects))
       (bind(registerIdleOnlyAsyncRpcMethod, "connection_list_fields", connectionListFields))
+      (bind(registerRpcMethod, "connection_refresh", connectionRefresh))
       (bind(registerIdleOnlyAsyncRpcMethod, "connection_preview_object", connectionPreviewObject))
       (bind(module_context::registerUriHandler, "/" kConnectionsPath, 
             handleConnectionsResourceRequest))
@@ -14,7 +14,10 @@
  */
 
 #include "DataViewer.hpp"
+#include "DataViewerFormat.hpp"
+#include "DataViewerIndex.hpp"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -25,12 +28,14 @@
 #include <boost/algorithm/string/predicate.hpp>
 
 #include <core/Log.hpp>
+#include <core/MemoryAccounting.hpp>
 #include <core/Error.hpp>
 #include <core/Exec.hpp>
 #include <core/FileSerializer.hpp>
 #include <core/RecursionGuard.hpp>
 #include <core/StringUtils.hpp>
 #include <core/SafeConvert.hpp>
+#include <core/json/JsonWriter.hpp>
 
 #define R_INTERNAL_FUNCTIONS
 #include <r/RInternal.hpp>
@@ -43,6 +48,7 @@
 
 #include <session/SessionModuleContext.hpp>
 #include <session/SessionContentUrls.hpp>
+#include <session/SessionLocalScratch.hpp>
 #include <session/SessionSourceDatabase.hpp>
 
 #ifndef _WIN32
@@ -195,6 +201,27 @@ bool isFilterSubset(const std::string& outer, const std::string& inner)
    return false;
 }
 
+// indicates whether a search and filter set selects a subset of the rows
+// selected by another
+bool isTransformSubset(const std::string& outerSearch,
+                       const std::vector<std::string>& outerFilters,
+                       const std::string& innerSearch,
+                       const std::vector<std::string>& innerFilters)
+{
+   if (!isFilterSubset(outerSearch, innerSearch))
+      return false;
+
+   for (unsigned i = 0; 
+        i < std::min(innerFilters.size(), outerFilters.size()); 
+        i++)
+   {
+      if (!isFilterSubset(outerFilters[i], innerFilters[i]))
+         return false;
+   }
+
+   return true;
+}
+
 typedef enum 
 {
   DIM_ROWS,
@@ -205,10 +232,13 @@ typedef enum
 // can succesfully obtain dimensions
 int safeDim(SEXP data, DimType dimType)
 {
+   RS_FUNCTION_HANDLE(s_nrow, ".rs.nrow");
+   RS_FUNCTION_HANDLE(s_ncol, ".rs.ncol");
+
    r::sexp::Protect protect;
    SEXP result = R_NilValue;
-   Error err = r::exec::RFunction(dimType == DIM_ROWS ? 
-         ".rs.nrow" : ".rs.ncol", data).call(&result, &protect);
+   Error err = r::exec::RFunction(dimType == DIM_ROWS ? s_nrow : s_ncol)
+         .addParam(data).call(&result, &protect);
    // bail if we encountered an error
    if (err)
    {
@@ -269,24 +299,19 @@ struct CachedFrame
    bool isSupersetOf(const std::string& newSearch, 
                      const std::vector<std::string> &newFilters)
    {
-      if (!isFilterSubset(workingSearch, newSearch))
-         return false;
-
-      for (unsigned i = 0; 
-           i < std::min(newFilters.size(), workingFilters.size()); 
-           i++)
-      {
-         if (!isFilterSubset(workingFilters[i], newFilters[i]))
-            return false;
-      }
-
-      return true;
+      return isTransformSubset(workingSearch, workingFilters,
+                               newSearch, newFilters);
    };
 
    // The current order column and direction
    int workingOrderCol;
    std::string workingOrderDir;
 
+   // The rows of the original object in the current (natively computed)
+   // search, filter set and order; used in place of a working copy when the
+   // frame's columns can be read directly
+   RowIndex rowIndex;
+
    // NB: There's no protection on this SEXP and it may be a stale pointer!
    // Used only to test for changes.
    SEXP observedSEXP;
@@ -297,7 +322,8 @@ std::map<std::string, CachedFrame> s_cachedFrames;
 
 std::string viewerCacheDir() 
 {
-   return module_context::sessionScratchPath().childPath(kViewerCacheDir)
+   return local_scratch::localPath(
+            module_context::sessionScratchPath().childPath(kViewerCacheDir))
       .absolutePath();
 }
 
@@ -441,10 +467,14 @@ void handleGridResReq(const http::Request& request,
 
 json::Value getCols(SEXP dataSEXP)
 {
+   RS_FUNCTION_HANDLE(s_describeCols, ".rs.describeCols");
+
    SEXP colsSEXP = R_NilValue;
    r::sexp::Protect protect;
    json::Value result;
-   Error error = r::exec::RFunction(".rs.describeCols", dataSEXP, MAX_FACTORS)
+   Error error = r::exec::RFunction(s_describeCols)
+      .addParam(dataSEXP)
+      .addParam(MAX_FACTORS)
       .call(&colsSEXP, &protect);
    if (error || colsSEXP == R_NilValue) 
    {
@@ -469,10 +499,13 @@ json::Value getCols(SEXP dataSEXP)
 // the shape of the API is described here:
 // http://datatables.net/manual/server-side
 // 
+// the result is written as it's produced, since pages of wide frames can be
+// large.
+//
 // NB: may throw exceptions! these are expected to be handled by the handlers
 // in getGridData, where they will be marshaled to JSON and displayed on the
-// client.
-json::Value getData(SEXP dataSEXP, const http::Fields& fields)
+// client. (all the R calls are made before anything is written)
+void getData(SEXP dataSEXP, const http::Fields& fields, json::Writer* pWriter)
 {
    Error error;
    r::sexp::Protect protect;
@@ -516,6 +549,35 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
    // check to see if we have an ordered/filtered view we can build from
    std::map<std::string, CachedFrame>::iterator cachedFrame = 
       s_cachedFrames.find(cacheKey);
+
+   // sort and filter natively when we can read the columns involved; this
+   // gives us the rows to display (in order) without making a working copy
+   RowIndex localRowIndex;
+   const std::vector<int>* pRows = NULL;
+   if (needsTransform)
+   {
+      RowIndex& rowIndex = cachedFrame != s_cachedFrames.end() ?
+         cachedFrame->second.rowIndex : localRowIndex;
+      if (RowIndex::supports(dataSEXP, nrow, filters, search, ordercol))
+      {
+         // if we're narrowing the rows already in the index, start from those
+         bool narrowing = rowIndex.isValidFor(nrow) &&
+            isTransformSubset(rowIndex.search(), rowIndex.filters(),
+                              search, filters);
+         error = rowIndex.update(dataSEXP, nrow, filters, search, ordercol,
+                                 orderdir, narrowing);
+         if (error)
+            throw r::exec::RErrorException(error.summary());
+
+         pRows = &rowIndex.rows();
+         needsTransform = false;
+      }
+      else
+      {
+         rowIndex.clear();
+      }
+   }
+
    if (needsTransform)
    {
       if (cachedFrame != s_cachedFrames.end())
@@ -584,17 +646,44 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
    }
 
    // apply new row count if we've tansformed the data (or need to)
-   filteredNRow = needsTransform || hasTransform ?
-      safeDim(dataSEXP, DIM_ROWS) : 
-      nrow;
+   if (pRows != NULL)
+      filteredNRow = static_cast<int>(pRows->size());
+   else
+      filteredNRow = needsTransform || hasTransform ?
+         safeDim(dataSEXP, DIM_ROWS) : 
+         nrow;
 
    // return the lesser of the rows available and rows requested
    length = std::min(length, filteredNRow - start);
 
+   // when sorted/filtered natively, the (1-based) rows of the original data
+   // on the requested page
+   std::vector<int> pageRows;
+   if (pRows != NULL)
+   {
+      for (int i = 0; i < length; i++)
+         pageRows.push_back((*pRows)[start + i] + 1);
+   }
+
+   // the (0-based) rows displayed, and the rows whose values determine the
+   // common format of numbers (.rs.formatDataColumn formats one row past
+   // the end of the page)
+   std::vector<int> displayRows, formatRows;
+   for (int i = 0; i < length; i++)
+      displayRows.push_back(pRows != NULL ? pageRows[i] - 1 : start + i);
+   formatRows = displayRows;
+   if (pRows == NULL && length > 0 && start + length < filteredNRow)
+      formatRows.push_back(start + length);
+
    // DataTables uses 0-based indexing, but R uses 1-based indexing
    start ++;
 
-   // extract the portion of the column vector requested by the client
+   // extract the portion of the column vector requested by the client;
+   // atomic vectors are formatted here and only classed columns are
+   // formatted in R
+   NumberFormat numberFormat = NumberFormat::fromOptions();
+   std::vector<FormattedCells> nativeCells(ncol);
+   std::vector<bool> formattedNatively(ncol, false);
    SEXP formattedDataSEXP = Rf_allocVector(VECSXP, ncol);
    protect.add(formattedDataSEXP);
    for (unsigned i = 0; i < static_cast<unsigned>(ncol); i++)
@@ -606,28 +695,64 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
          throw r::exec::RErrorException("No data in column " + 
                boost::lexical_cast<std::string>(i));
       }
+      if (formatColumn(columnSEXP, formatRows, numberFormat, &nativeCells[i]))
+      {
+         formattedNatively[i] = true;
+         continue;
+      }
       SEXP formattedColumnSEXP;
-      r::exec::RFunction formatFx(".rs.formatDataColumn");
-      formatFx.addParam(columnSEXP);
-      formatFx.addParam(static_cast<int>(start));
-      formatFx.addParam(static_cast<int>(length));
-      error = formatFx.call(&formattedColumnSEXP, &protect);
+      if (pRows != NULL)
+      {
+         r::exec::RFunction formatFx(".rs.formatDataColumnRows");
+         formatFx.addParam(columnSEXP);
+         formatFx.addParam(pageRows);
+         error = formatFx.call(&formattedColumnSEXP, &protect);
+      }
+      else
+      {
+         r::exec::RFunction formatFx(".rs.formatDataColumn");
+         formatFx.addParam(columnSEXP);
+         formatFx.addParam(static_cast<int>(start));
+         formatFx.addParam(static_cast<int>(length));
+         error = formatFx.call(&formattedColumnSEXP, &protect);
+      }
       if (error)
          throw r::exec::RErrorException(error.summary());
       SET_VECTOR_ELT(formattedDataSEXP, i, formattedColumnSEXP);
     }
 
    // format the row names 
-   SEXP rownamesSEXP;
-   r::exec::RFunction(".rs.formatRowNames", dataSEXP, start, length)
-      .call(&rownamesSEXP, &protect);
+   SEXP rownamesSEXP = R_NilValue;
+   std::vector<std::string> rowNames;
+   bool rowNamesNative = formatRowNames(dataSEXP, displayRows, &rowNames);
+   if (!rowNamesNative)
+   {
+      if (pRows != NULL)
+         r::exec::RFunction(".rs.formatRowNamesRows", dataSEXP, pageRows)
+            .call(&rownamesSEXP, &protect);
+      else
+         r::exec::RFunction(".rs.formatRowNames", dataSEXP, start, length)
+            .call(&rownamesSEXP, &protect);
+   }
    
-   // create the result grid as JSON
-   json::Array data;
+   // write the result grid as JSON
+   pWriter->startObject();
+   pWriter->member("draw", draw);
+   pWriter->member("recordsTotal", nrow);
+   pWriter->member("recordsFiltered", filteredNRow);
+   pWriter->key("data");
+   pWriter->startArray();
    for (int row = 0; row < length; row++)
    {
-      json::Array rowData;
-      if (rownamesSEXP != NULL &&
+      pWriter->startArray();
+      if (rowNamesNative)
+      {
+         if (!rowNames[row].empty())
+            pWriter->value(rowNames[row]);
+         else
+            pWriter->value(row + start);
+      }
+      else if (rownamesSEXP != NULL &&
           TYPEOF(rownamesSEXP) != NILSXP &&
           !Rf_isNull(rownamesSEXP) )
       {
@@ -636,20 +761,30 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
              nameSEXP != NA_STRING &&
              r::sexp::length(nameSEXP) > 0)
          {
-            rowData.push_back(Rf_translateCharUTF8(nameSEXP));
+            pWriter->value(Rf_translateCharUTF8(nameSEXP));
          }
          else
          {
-            rowData.push_back(row + start);
+            pWriter->value(row + start);
          }
       }
       else
       {
-         rowData.push_back(row + start);
+         pWriter->value(row + start);
       }
 
       for (int col = 0; col<Rf_length(formattedDataSEXP); col++)
       {
+         if (formattedNatively[col])
+         {
+            const FormattedCells& cells = nativeCells[col];
+            if (cells.missing[row])
+               pWriter->value(SPECIAL_CELL_NA);
+            else
+               pWriter->value(cells.values[row]);
+            continue;
+         }
+
          SEXP columnSEXP = VECTOR_ELT(formattedDataSEXP, col);
          if (columnSEXP != NULL && 
              TYPEOF(columnSEXP) != NILSXP &&
@@ -660,37 +795,32 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
                 stringSEXP != NA_STRING &&
                 r::sexp::length(stringSEXP) > 0)
             {
-               rowData.push_back(Rf_translateCharUTF8(stringSEXP));
+               pWriter->value(Rf_translateCharUTF8(stringSEXP));
             }
             else if (stringSEXP == NA_STRING) 
             {
-               rowData.push_back(SPECIAL_CELL_NA);
+               pWriter->value(SPECIAL_CELL_NA);
             }
             else
             {
-               rowData.push_back("");
+               pWriter->value("");
             }
          }
          else
          {
-            rowData.push_back("");
+            pWriter->value("");
          }
       }
-      data.push_back(rowData);
+      pWriter->endArray();
    }
-
-   json::Object result;
-   result["draw"] = draw;
-   result["recordsTotal"] = nrow;
-   result["recordsFiltered"] = filteredNRow;
-   result["data"] = data;
-   return result;
+   pWriter->endArray();
+   pWriter->endObject();
 }
 
 Error getGridData(const http::Request& request,
                   http::Response* pResponse)
 {
-   json::Value result;
+   std::string output;
    http::status::Code status = http::status::Ok;
 
    try
@@ -740,7 +870,7 @@ Error getGridData(const http::Request& request,
          json::Object err;
          err["error"] = "The object no longer exists.";
          status = http::status::NotFound;
-         result = err;
+         output = json::write(err);
       }
       else 
       {
@@ -753,11 +883,12 @@ Error getGridData(const http::Request& request,
       
          if (show == "cols")
          {
-            result = getCols(dataSEXP);
+            output = json::write(getCols(dataSEXP));
          }
          else if (show == "data")
          {
-            result = getData(dataSEXP, fields);
+            json::Writer writer(&output);
+            getData(dataSEXP, fields, &writer);
          }
       }
 
@@ -768,33 +899,15 @@ Error getGridData(const http::Request& request,
       // error handling code) expects
       json::Object err;
       err["error"] = e.message();
-      result = err;
+      output = json::write(err);
       status = http::status::InternalServerError;
    }
    CATCH_UNEXPECTED_EXCEPTION
 
-   std::ostringstream ostr;
-   json::write(result, ostr);
-
-   // There are some unprintable ASCII control characters that are written
-   // verbatim by json::write, but that won't parse in most Javascript JSON
-   // parsing implementations, even if contained in a string literal. Scan the
-   // output data for these characters and replace them with spaces. Escaping
-   // is another option here for some character ranges but since (a) these are
-   // unprintable and (b) some characters are invalid *even if escaped* e.g.
-   // \v, there's little to be gained here in trying to marshal them to the
-   // viewer.
-   std::string output = ostr.str();
-   for (size_t i = 0; i < output.size(); i++) 
-   {
-      char c = output[i];
-      // These ranges for control character values come from empirical testing
-      if ((c >= 1 && c <= 7) || c == 11 || (c >= 14 && c <= 31))
-      {
-         output[i] = ' ';
-      }
-   }
- 
+   // nothing was written (e.g. on an unexpected exception)
+   if (output.empty())
+      output = "null";
+
    pResponse->setNoCacheHeaders();    // don't cache data/grid shape
    pResponse->setStatusCode(status);
    pResponse->setBody(output);
@@ -849,6 +962,60 @@ void onResume(const Settings&)
 {
 }
 
+void onLowMemory()
+{
+   Error error = r::exec::RFunction(".rs.releaseCachedData", viewerCacheDir())
+      .call();
+   if (error)
+      LOG_ERROR(error);
+}
+
+memory_accounting::Usage cachedFramesUsage()
+{
+   memory_accounting::Usage usage(0, s_cachedFrames.size());
+   for (std::map<std::string, CachedFrame>::const_iterator it = s_cachedFrames.begin();
+        it != s_cachedFrames.end();
+        ++it)
+   {
+      usage.bytes += it->second.rowIndex.memoryUsage();
+      BOOST_FOREACH(const std::string& colName, it->second.colNames)
+      {
+         usage.bytes += colName.capacity();
+      }
+   }
+   return usage;
+}
+
+bool hasLargerRowIndex(const CachedFrame* pLhs, const CachedFrame* pRhs)
+{
+   return pLhs->rowIndex.memoryUsage() > pRhs->rowIndex.memoryUsage();
+}
+
+// drop the largest row indexes until we're within budget; they're rebuilt
+// when the frame is next sorted or filtered
+void evictCachedFrames(std::size_t budget)
+{
+   std::vector<CachedFrame*> frames;
+   for (std::map<std::string, CachedFrame>::iterator it = s_cachedFrames.begin();
+        it != s_cachedFrames.end();
+        ++it)
+   {
+      frames.push_back(&it->second);
+   }
+   std::sort(frames.begin(), frames.end(), hasLargerRowIndex);
+
+   std::size_t bytes = cachedFramesUsage().bytes;
+   BOOST_FOREACH(CachedFrame* pFrame, frames)
+   {
+      if (bytes <= budget)
+         break;
+
+      std::size_t indexBytes = pFrame->rowIndex.memoryUsage();
+      pFrame->rowIndex.clear();
+      bytes -= std::min(bytes, indexBytes);
+   }
+}
+
 void onDetectChanges(module_context::ChangeSource source)
 {
    DROP_RECURSIVE_CALLS;
@@ -943,7 +1110,7 @@ void onDeferredInit(bool newSession)
 {
    // get all the cache keys in the source database
    std::vector<boost::shared_ptr<source_database::SourceDocument> > docs;
-   Error error = source_database::list(&docs);
+   Error error = source_database::list(&docs, false);
    if (error)
    {
       LOG_ERROR(error);
@@ -1011,11 +1178,16 @@ Error initialize()
    source_database::events().onDocPendingRemove.connect(onDocPendingRemove);
 
    module_context::events().onShutdown.connect(onShutdown);
+   module_context::events().onLowMemory.connect(onLowMemory);
    module_context::events().onDetectChanges.connect(onDetectChanges);
    module_context::events().onClientInit.connect(onClientInit);
    module_context::events().onDeferredInit.connect(onDeferredInit);
    addSuspendHandler(SuspendHandler(onSuspend, onResume));
 
+   memory_accounting::registerSubsystem("data-viewer",
+                                        cachedFramesUsage,
+                                        evictCachedFrames);
+
    using boost::bind;
    using namespace rstudio::r::function_hook ;
    using namespace session::module_context;
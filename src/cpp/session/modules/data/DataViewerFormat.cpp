@@ -0,0 +1,421 @@
+/*
+ * DataViewerFormat.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "DataViewerFormat.hpp"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+#define R_INTERNAL_FUNCTIONS
+#include <r/RInternal.hpp>
+#include <r/ROptions.hpp>
+
+// the largest power of 10 we scale by exactly (as R's formatReal does)
+#define kMaxExactPower 22
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+namespace {
+
+int integerOption(const std::string& name, int defaultValue)
+{
+   SEXP valueSEXP = r::options::getOption(name);
+   if (Rf_length(valueSEXP) < 1)
+      return defaultValue;
+   if (TYPEOF(valueSEXP) == INTSXP && INTEGER(valueSEXP)[0] != NA_INTEGER)
+      return INTEGER(valueSEXP)[0];
+   if (TYPEOF(valueSEXP) == REALSXP && R_FINITE(REAL(valueSEXP)[0]))
+      return static_cast<int>(REAL(valueSEXP)[0]);
+   return defaultValue;
+}
+
+long double powerOf10(int power)
+{
+   static long double powers[kMaxExactPower + 1];
+   static bool initialized = false;
+   if (!initialized)
+   {
+      powers[0] = 1;
+      for (int i = 1; i <= kMaxExactPower; i++)
+         powers[i] = powers[i - 1] * 10;
+      initialized = true;
+   }
+
+   if (power >= 0 && power <= kMaxExactPower)
+      return powers[power];
+   return std::pow(10.0L, static_cast<long double>(power));
+}
+
+// A finite number in scientific terms: |x| = alpha * 10^kpower, where
+// 1 <= alpha < 10 has nsig significant digits (at most the print digits).
+// This mirrors scientific() in R's format.c so that we choose the same
+// format that format() would.
+struct Scientific
+{
+   Scientific(double x, int digits)
+      : neg(false), kpower(0), nsig(1), roundingWidens(false)
+   {
+      if (x == 0.0)
+         return;
+
+      neg = x < 0.0;
+      double r = neg ? -x : x;
+
+      // scale r to an integer with the print digits
+      int kp = static_cast<int>(std::floor(std::log10(r))) - digits + 1;
+      long double scaled = r;
+      if (kp > 0)
+         scaled /= powerOf10(kp);
+      else if (kp < 0 && kp > DBL_MIN_10_EXP)
+         scaled *= powerOf10(-kp);
+      else if (kp < 0)
+         scaled = (r * 1e+303) / powerOf10(kp + 303);
+      if (scaled < powerOf10(digits - 1))
+      {
+         scaled *= 10;
+         kp--;
+      }
+
+      // count significant digits (dropping trailing zeros)
+      double alpha = static_cast<double>(std::nearbyint(scaled));
+      nsig = digits;
+      for (int j = 1; j <= digits; j++)
+      {
+         alpha /= 10.0;
+         if (alpha == std::floor(alpha))
+            nsig--;
+         else
+            break;
+      }
+      if (nsig == 0 && digits > 0)
+      {
+         nsig = 1;
+         kp++;
+      }
+      kpower = kp + digits - 1;
+
+      // scientific format may do more rounding than fixed (e.g. 9996 with
+      // 3 digits is 1e+04 in scientific but 9996 in fixed)
+      int rgt = std::max(0, std::min(digits - kpower, kMaxExactPower));
+      long double fuzz = 0.5 / powerOf10(rgt);
+      roundingWidens = kpower > 0 && kpower <= kMaxExactPower &&
+                       r < powerOf10(kpower) - fuzz;
+   }
+
+   bool neg;
+   int kpower;
+   int nsig;
+   bool roundingWidens;
+};
+
+// The common format for a set of numbers, as formatReal computes it:
+// either fixed with the given decimals or scientific with the given
+// mantissa decimals
+struct RealFormat
+{
+   RealFormat(const std::vector<double>& values, const NumberFormat& format)
+      : scientific(false), decimals(0)
+   {
+      bool neg = false;
+      int rgt = INT_MIN, mxl = INT_MIN, mxsl = INT_MIN, mxns = INT_MIN;
+      int mxe = INT_MIN, mne = INT_MAX;
+      BOOST_FOREACH(double value, values)
+      {
+         if (!R_FINITE(value))
+            continue;
+
+         Scientific sci(value, format.digits);
+         int left = sci.kpower + 1;
+         if (sci.roundingWidens)
+            left--;
+         int sleft = sci.neg + ((left <= 0) ? 1 : left);
+         int right = sci.nsig - left;
+         if (sci.neg)
+            neg = true;
+
+         rgt = std::max(rgt, right);
+         mxl = std::max(mxl, left);
+         mxsl = std::max(mxsl, sleft);
+         mxns = std::max(mxns, sci.nsig);
+         mxe = std::max(mxe, sci.kpower);
+         mne = std::min(mne, sci.kpower);
+      }
+
+      // all values non-finite; these format the same either way
+      if (mxl == INT_MIN)
+         return;
+
+      if (mxl < 0)
+         mxsl = 1 + neg;
+      if (rgt < 0)
+         rgt = 0;
+      int fixedWidth = mxsl + rgt + (rgt != 0);
+
+      // use fixed notation unless scientific is narrower (with the penalty)
+      int exponentDigits = (mxe >= 100 || mne <= -99) ? 2 : 1;
+      int mantissaDecimals = mxns - 1;
+      int scientificWidth = neg + (mantissaDecimals > 0) + mantissaDecimals +
+                            4 + exponentDigits;
+      if (fixedWidth <= scientificWidth + format.scipen)
+      {
+         decimals = rgt;
+      }
+      else
+      {
+         scientific = true;
+         decimals = mantissaDecimals;
+      }
+   }
+
+   std::string format(double value) const
+   {
+      if (ISNA(value))
+         return "NA";
+      else if (ISNAN(value))
+         return "NaN";
+      else if (value == R_PosInf)
+         return "Inf";
+      else if (value == R_NegInf)
+         return "-Inf";
+
+      // no negative zero
+      if (value == 0.0)
+         value = 0.0;
+
+      char buffer[NUMBER_BUFFER_SIZE];
+      std::snprintf(buffer, sizeof(buffer), scientific ? "%.*e" : "%.*f",
+                    decimals, value);
+      return buffer;
+   }
+
+   static const int NUMBER_BUFFER_SIZE = 1000;
+
+   bool scientific;
+   int decimals;
+};
+
+void formatNumbers(const std::vector<double>& values,
+                   const NumberFormat& format,
+                   FormattedCells* pCells)
+{
+   RealFormat realFormat(values, format);
+   BOOST_FOREACH(double value, values)
+   {
+      // NaN is displayed as text (only NA is missing)
+      bool missing = ISNA(value);
+      pCells->values.push_back(missing ? std::string() :
+                                         realFormat.format(value));
+      pCells->missing.push_back(missing);
+   }
+}
+
+void addText(SEXP charSEXP, FormattedCells* pCells)
+{
+   bool missing = charSEXP == NA_STRING;
+   pCells->values.push_back(missing ? std::string() :
+                                      Rf_translateCharUTF8(charSEXP));
+   pCells->missing.push_back(missing);
+}
+
+} // anonymous namespace
+
+NumberFormat NumberFormat::fromOptions()
+{
+   NumberFormat format;
+   format.digits = integerOption("digits", format.digits);
+   format.scipen = integerOption("scipen", format.scipen);
+   return format;
+}
+
+bool formatColumn(SEXP columnSEXP,
+                  const std::vector<int>& rows,
+                  const NumberFormat& format,
+                  FormattedCells* pCells)
+{
+   pCells->values.clear();
+   pCells->missing.clear();
+
+   // matrix columns are subset by element in R; leave those to R too
+   if (!Rf_isNull(Rf_getAttrib(columnSEXP, R_DimSymbol)))
+      return false;
+
+   bool isFactor = TYPEOF(columnSEXP) == INTSXP && Rf_isFactor(columnSEXP);
+   if (OBJECT(columnSEXP) && !isFactor)
+      return false;
+
+   int length = Rf_length(columnSEXP);
+   BOOST_FOREACH(int row, rows)
+   {
+      if (row < 0 || row >= length)
+         return false;
+   }
+
+   const void* vmax = vmaxget();
+   bool formatted = true;
+   switch (TYPEOF(columnSEXP))
+   {
+   case REALSXP:
+   case INTSXP:
+   {
+      if (isFactor)
+      {
+         SEXP levelsSEXP = Rf_getAttrib(columnSEXP, R_LevelsSymbol);
+         if (TYPEOF(levelsSEXP) != STRSXP)
+         {
+            formatted = false;
+            break;
+         }
+         int levels = Rf_length(levelsSEXP);
+         BOOST_FOREACH(int row, rows)
+         {
+            int level = INTEGER(columnSEXP)[row];
+            addText(level == NA_INTEGER || level < 1 || level > levels ?
+                       NA_STRING : STRING_ELT(levelsSEXP, level - 1),
+                    pCells);
+         }
+         break;
+      }
+
+      // very high precision is formatted with sprintf in R
+      if (format.digits < 1 || format.digits > DBL_DIG)
+      {
+         formatted = false;
+         break;
+      }
+
+      // numbers are shown as doubles
+      std::vector<double> values;
+      values.reserve(rows.size());
+      BOOST_FOREACH(int row, rows)
+      {
+         if (TYPEOF(columnSEXP) == REALSXP)
+         {
+            values.push_back(REAL(columnSEXP)[row]);
+         }
+         else
+         {
+            int value = INTEGER(columnSEXP)[row];
+            values.push_back(value == NA_INTEGER ? NA_REAL : value);
+         }
+      }
+      formatNumbers(values, format, pCells);
+      break;
+   }
+   case LGLSXP:
+      BOOST_FOREACH(int row, rows)
+      {
+         int value = LOGICAL(columnSEXP)[row];
+         bool missing = value == NA_LOGICAL;
+         pCells->values.push_back(missing ? "" : (value ? "TRUE" : "FALSE"));
+         pCells->missing.push_back(missing);
+      }
+      break;
+   case STRSXP:
+      BOOST_FOREACH(int row, rows)
+      {
+         addText(STRING_ELT(columnSEXP, row), pCells);
+      }
+      break;
+   default:
+      formatted = false;
+      break;
+   }
+   vmaxset(vmax);
+
+   return formatted;
+}
+
+bool formatRowNames(SEXP dataSEXP,
+                    const std::vector<int>& rows,
+                    std::vector<std::string>* pNames)
+{
+   pNames->clear();
+   if (TYPEOF(dataSEXP) != VECSXP || !Rf_inherits(dataSEXP, "data.frame"))
+      return false;
+
+   // look up the attribute directly; Rf_getAttrib would expand compact row
+   // names for the whole frame
+   SEXP rowNamesSEXP = R_NilValue;
+   for (SEXP attribSEXP = ATTRIB(dataSEXP);
+        attribSEXP != R_NilValue;
+        attribSEXP = CDR(attribSEXP))
+   {
+      if (TAG(attribSEXP) == R_RowNamesSymbol)
+      {
+         rowNamesSEXP = CAR(attribSEXP);
+         break;
+      }
+   }
+
+   // compact (automatic) row names, e.g. c(NA, -150)
+   if (TYPEOF(rowNamesSEXP) == INTSXP && Rf_length(rowNamesSEXP) == 2 &&
+       INTEGER(rowNamesSEXP)[0] == NA_INTEGER)
+   {
+      BOOST_FOREACH(int row, rows)
+      {
+         pNames->push_back(boost::lexical_cast<std::string>(row + 1));
+      }
+      return true;
+   }
+
+   int length = Rf_length(rowNamesSEXP);
+   BOOST_FOREACH(int row, rows)
+   {
+      if (row < 0 || row >= length)
+         return false;
+   }
+
+   if (TYPEOF(rowNamesSEXP) == INTSXP)
+   {
+      BOOST_FOREACH(int row, rows)
+      {
+         int name = INTEGER(rowNamesSEXP)[row];
+         pNames->push_back(name == NA_INTEGER ? std::string() :
+                              boost::lexical_cast<std::string>(name));
+      }
+      return true;
+   }
+   else if (TYPEOF(rowNamesSEXP) == STRSXP)
+   {
+      const void* vmax = vmaxget();
+      BOOST_FOREACH(int row, rows)
+      {
+         SEXP nameSEXP = STRING_ELT(rowNamesSEXP, row);
+         pNames->push_back(nameSEXP == NA_STRING ? std::string() :
+                              Rf_translateCharUTF8(nameSEXP));
+      }
+      vmaxset(vmax);
+      return true;
+   }
+
+   return false;
+}
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -0,0 +1,73 @@
+/*
+ * DataViewerFormat.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_DATA_VIEWER_FORMAT_HPP
+#define SESSION_DATA_VIEWER_FORMAT_HPP
+
+#include <string>
+#include <vector>
+
+typedef struct SEXPREC *SEXP;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+// The display text of a page of cells; missing values are flagged so the
+// viewer can display them specially.
+struct FormattedCells
+{
+   std::vector<std::string> values;
+   std::vector<bool> missing;
+};
+
+// The R print options that determine how numbers are formatted
+struct NumberFormat
+{
+   NumberFormat() : digits(7), scipen(0) {}
+
+   // read from options("digits") and options("scipen")
+   static NumberFormat fromOptions();
+
+   int digits;
+   int scipen;
+};
+
+// Formats the given (0-based) rows of a column as .rs.formatDataColumn
+// does, without calling into R: numbers share a common fixed or scientific
+// format across the rows (as format() gives them) and other values are
+// displayed as their text. Returns false for columns that need to be
+// formatted in R (classed vectors other than factors, lists, etc.).
+bool formatColumn(SEXP columnSEXP,
+                  const std::vector<int>& rows,
+                  const NumberFormat& format,
+                  FormattedCells* pCells);
+
+// Gets the names of the given (0-based) rows of a data frame as
+// .rs.formatRowNames does; automatic row names are the row numbers. Returns
+// false if the names need to be computed in R.
+bool formatRowNames(SEXP dataSEXP,
+                    const std::vector<int>& rows,
+                    std::vector<std::string>* pNames);
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_DATA_VIEWER_FORMAT_HPP
@@ -0,0 +1,653 @@
+/*
+ * DataViewerIndex.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "DataViewerIndex.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
+#include <core/Error.hpp>
+
+#define R_INTERNAL_FUNCTIONS
+#include <r/RInternal.hpp>
+#include <r/RExec.hpp>
+
+// separates filter type from contents (e.g. "numeric|12-25")
+#define kFilterSeparator '|'
+
+// separates the bounds of a numeric range filter (e.g. "2.71_3.14")
+#define kRangeSeparator '_'
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+namespace {
+
+// the kinds of column values we can evaluate natively
+enum ColumnKind
+{
+   ColumnUnsupported,
+   ColumnLogical,
+   ColumnInteger,
+   ColumnDouble,
+   ColumnFactor,
+   ColumnCharacter
+};
+
+// classify a column for filtering and search. classed vectors (other than
+// factors) are unsupported since their text depends on their format method
+ColumnKind columnKind(SEXP columnSEXP, int nrow)
+{
+   if (Rf_length(columnSEXP) != nrow ||
+       !Rf_isNull(Rf_getAttrib(columnSEXP, R_DimSymbol)))
+   {
+      return ColumnUnsupported;
+   }
+
+   switch (TYPEOF(columnSEXP))
+   {
+   case LGLSXP:
+      return OBJECT(columnSEXP) ? ColumnUnsupported : ColumnLogical;
+   case INTSXP:
+      if (Rf_isFactor(columnSEXP))
+         return ColumnFactor;
+      return OBJECT(columnSEXP) ? ColumnUnsupported : ColumnInteger;
+   case REALSXP:
+      return OBJECT(columnSEXP) ? ColumnUnsupported : ColumnDouble;
+   case STRSXP:
+      return OBJECT(columnSEXP) ? ColumnUnsupported : ColumnCharacter;
+   default:
+      return ColumnUnsupported;
+   }
+}
+
+// classify a column for sorting; dates and times order on their underlying
+// values (as xtfrm would) so these are supported in addition
+ColumnKind sortKind(SEXP columnSEXP, int nrow)
+{
+   ColumnKind kind = columnKind(columnSEXP, nrow);
+   if (kind != ColumnUnsupported || Rf_length(columnSEXP) != nrow)
+      return kind;
+
+   if ((TYPEOF(columnSEXP) == REALSXP || TYPEOF(columnSEXP) == INTSXP) &&
+       (Rf_inherits(columnSEXP, "Date") ||
+        Rf_inherits(columnSEXP, "POSIXct") ||
+        Rf_inherits(columnSEXP, "difftime")))
+   {
+      return TYPEOF(columnSEXP) == REALSXP ? ColumnDouble : ColumnInteger;
+   }
+
+   return ColumnUnsupported;
+}
+
+// whether the column's text (as.character) can be computed natively
+bool hasNativeText(ColumnKind kind)
+{
+   return kind == ColumnLogical || kind == ColumnInteger ||
+          kind == ColumnFactor || kind == ColumnCharacter;
+}
+
+bool isAscii(const std::string& value)
+{
+   BOOST_FOREACH(char ch, value)
+   {
+      if (static_cast<unsigned char>(ch) > 0x7F)
+         return false;
+   }
+   return true;
+}
+
+char asciiLower(char ch)
+{
+   return (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+}
+
+// split a filter into its type and value as strsplit(filter, "|") would;
+// returns false if the filter has no value
+bool parseFilter(const std::string& filter,
+                 std::string* pType,
+                 std::string* pValue)
+{
+   std::size_t typeEnd = filter.find(kFilterSeparator);
+   if (typeEnd == std::string::npos || typeEnd + 1 == filter.size())
+      return false;
+
+   std::size_t valueEnd = filter.find(kFilterSeparator, typeEnd + 1);
+   *pType = filter.substr(0, typeEnd);
+   *pValue = filter.substr(typeEnd + 1,
+         valueEnd == std::string::npos ? std::string::npos :
+                                         valueEnd - typeEnd - 1);
+   return true;
+}
+
+// parse a number as as.numeric would; returns false where R would give NA
+bool parseNumber(const std::string& value, double* pNumber)
+{
+   std::string trimmed = boost::algorithm::trim_copy(value);
+   if (trimmed.empty())
+      return false;
+
+   char* end = NULL;
+   *pNumber = std::strtod(trimmed.c_str(), &end);
+   return *end == '\0';
+}
+
+// parse the bounds of a numeric filter ("2.71_3.14", or "15" for equality)
+bool parseRange(const std::string& value, double* pLower, double* pUpper)
+{
+   std::size_t separator = value.find(kRangeSeparator);
+   if (separator == std::string::npos || separator + 1 == value.size())
+   {
+      if (!parseNumber(value.substr(0, separator), pLower))
+         return false;
+      *pUpper = *pLower;
+      return true;
+   }
+
+   std::size_t upperEnd = value.find(kRangeSeparator, separator + 1);
+   return parseNumber(value.substr(0, separator), pLower) &&
+          parseNumber(value.substr(separator + 1,
+                upperEnd == std::string::npos ? std::string::npos :
+                                                upperEnd - separator - 1),
+                pUpper);
+}
+
+// case-insensitive literal substring match (the needle is lower case ASCII)
+bool containsText(const char* text, const std::string& needle)
+{
+   std::size_t length = needle.size();
+   for (const char* pos = text; *pos != '\0'; pos++)
+   {
+      std::size_t i = 0;
+      while (i < length && pos[i] != '\0' && asciiLower(pos[i]) == needle[i])
+         i++;
+      if (i == length)
+         return true;
+   }
+   return length == 0;
+}
+
+// matches the text of a column's values against a search string (as grepl
+// does on the column); missing values never match
+class TextMatcher
+{
+public:
+   TextMatcher(SEXP columnSEXP, ColumnKind kind, const std::string& needle)
+      : columnSEXP_(columnSEXP), kind_(kind), needle_(needle)
+   {
+      std::transform(needle_.begin(), needle_.end(), needle_.begin(),
+                     asciiLower);
+
+      // levels are matched once up front
+      if (kind_ == ColumnFactor)
+      {
+         SEXP levelsSEXP = Rf_getAttrib(columnSEXP_, R_LevelsSymbol);
+         int levels = TYPEOF(levelsSEXP) == STRSXP ? Rf_length(levelsSEXP) : 0;
+         levelMatches_.resize(levels, false);
+         for (int i = 0; i < levels; i++)
+         {
+            SEXP levelSEXP = STRING_ELT(levelsSEXP, i);
+            levelMatches_[i] = levelSEXP != NA_STRING &&
+                  containsText(Rf_translateCharUTF8(levelSEXP), needle_);
+         }
+      }
+   }
+
+   bool matches(int row) const
+   {
+      switch (kind_)
+      {
+      case ColumnCharacter:
+      {
+         SEXP valueSEXP = STRING_ELT(columnSEXP_, row);
+         return valueSEXP != NA_STRING &&
+                containsText(Rf_translateCharUTF8(valueSEXP), needle_);
+      }
+      case ColumnFactor:
+      {
+         int level = INTEGER(columnSEXP_)[row];
+         return level != NA_INTEGER && level >= 1 &&
+                level <= static_cast<int>(levelMatches_.size()) &&
+                levelMatches_[level - 1];
+      }
+      case ColumnInteger:
+      {
+         int value = INTEGER(columnSEXP_)[row];
+         if (value == NA_INTEGER)
+            return false;
+         char buffer[16];
+         std::snprintf(buffer, sizeof(buffer), "%d", value);
+         return containsText(buffer, needle_);
+      }
+      case ColumnLogical:
+      {
+         int value = LOGICAL(columnSEXP_)[row];
+         return value != NA_LOGICAL &&
+                containsText(value ? "TRUE" : "FALSE", needle_);
+      }
+      default:
+         return false;
+      }
+   }
+
+private:
+   SEXP columnSEXP_;
+   ColumnKind kind_;
+   std::string needle_;
+   std::vector<bool> levelMatches_;
+};
+
+// numeric value of a row as as.numeric would give it (factors give their
+// level codes); returns false for missing values
+bool numericValue(SEXP columnSEXP, ColumnKind kind, int row, double* pValue)
+{
+   switch (kind)
+   {
+   case ColumnLogical:
+   case ColumnInteger:
+   case ColumnFactor:
+   {
+      int value = kind == ColumnLogical ? LOGICAL(columnSEXP)[row] :
+                                          INTEGER(columnSEXP)[row];
+      if (value == NA_INTEGER)
+         return false;
+      *pValue = value;
+      return true;
+   }
+   case ColumnDouble:
+   {
+      double value = REAL(columnSEXP)[row];
+      if (ISNAN(value))
+         return false;
+      *pValue = value;
+      return true;
+   }
+   default:
+      return false;
+   }
+}
+
+bool supportsFilter(ColumnKind kind,
+                    const std::string& type,
+                    const std::string& value)
+{
+   if (type == "factor" || type == "boolean")
+   {
+      return kind == ColumnLogical || kind == ColumnInteger ||
+             kind == ColumnDouble ||
+             (type == "factor" && kind == ColumnFactor);
+   }
+   else if (type == "character")
+   {
+      return hasNativeText(kind) && isAscii(value);
+   }
+   else if (type == "numeric")
+   {
+      double lower, upper;
+      return (kind == ColumnLogical || kind == ColumnInteger ||
+              kind == ColumnDouble) &&
+             parseRange(value, &lower, &upper);
+   }
+
+   // unknown filter types are ignored
+   return true;
+}
+
+// remove the rows that don't pass a column's filter
+void applyFilter(SEXP columnSEXP,
+                 ColumnKind kind,
+                 const std::string& type,
+                 const std::string& value,
+                 std::vector<int>* pRows)
+{
+   std::vector<int>::iterator keep = pRows->begin();
+   if (type == "factor" || type == "boolean")
+   {
+      // compare to the level code or logical value; an unparseable factor
+      // code matches nothing
+      double target = value == "TRUE" ? 1 : 0;
+      bool valid = type == "boolean" || parseNumber(value, &target);
+      for (std::vector<int>::iterator it = pRows->begin();
+           valid && it != pRows->end(); ++it)
+      {
+         double number;
+         if (numericValue(columnSEXP, kind, *it, &number) && number == target)
+            *keep++ = *it;
+      }
+   }
+   else if (type == "character")
+   {
+      TextMatcher matcher(columnSEXP, kind, value);
+      for (std::vector<int>::iterator it = pRows->begin();
+           it != pRows->end(); ++it)
+      {
+         if (matcher.matches(*it))
+            *keep++ = *it;
+      }
+   }
+   else if (type == "numeric")
+   {
+      // infinite values never pass (as with is.finite)
+      double lower = 0, upper = 0;
+      parseRange(value, &lower, &upper);
+      for (std::vector<int>::iterator it = pRows->begin();
+           it != pRows->end(); ++it)
+      {
+         double number;
+         if (numericValue(columnSEXP, kind, *it, &number) &&
+             number != R_PosInf && number != R_NegInf &&
+             number >= lower && number <= upper)
+         {
+            *keep++ = *it;
+         }
+      }
+   }
+   else
+   {
+      return;
+   }
+
+   pRows->erase(keep, pRows->end());
+}
+
+// remove the rows which don't match the search text in any column
+void applySearch(SEXP dataSEXP,
+                 int nrow,
+                 const std::string& search,
+                 std::vector<int>* pRows)
+{
+   std::vector<TextMatcher> matchers;
+   for (int i = 0; i < Rf_length(dataSEXP); i++)
+   {
+      SEXP columnSEXP = VECTOR_ELT(dataSEXP, i);
+      matchers.push_back(TextMatcher(columnSEXP,
+                                     columnKind(columnSEXP, nrow),
+                                     search));
+   }
+
+   std::vector<int>::iterator keep = pRows->begin();
+   for (std::vector<int>::iterator it = pRows->begin();
+        it != pRows->end(); ++it)
+   {
+      BOOST_FOREACH(const TextMatcher& matcher, matchers)
+      {
+         if (matcher.matches(*it))
+         {
+            *keep++ = *it;
+            break;
+         }
+      }
+   }
+   pRows->erase(keep, pRows->end());
+}
+
+void filterRows(SEXP dataSEXP,
+                int nrow,
+                const std::vector<std::string>& filters,
+                const std::string& search,
+                std::vector<int>* pRows)
+{
+   // translated strings are allocated on R's transient stack; release them
+   // once we're done
+   const void* vmax = vmaxget();
+
+   for (std::size_t i = 0; i < filters.size(); i++)
+   {
+      std::string type, value;
+      if (!parseFilter(filters[i], &type, &value))
+         continue;
+
+      SEXP columnSEXP = VECTOR_ELT(dataSEXP, i);
+      applyFilter(columnSEXP, columnKind(columnSEXP, nrow), type, value,
+                  pRows);
+   }
+
+   if (!search.empty())
+      applySearch(dataSEXP, nrow, search, pRows);
+
+   vmaxset(vmax);
+}
+
+inline bool isMissing(int value)
+{
+   return value == NA_INTEGER;
+}
+
+inline bool isMissing(double value)
+{
+   return ISNAN(value);
+}
+
+// orders rows on their values as order() does: ties keep their existing
+// order and missing values sort last in either direction
+template <typename T>
+class ValueOrder
+{
+public:
+   ValueOrder(const T* pValues, bool descending)
+      : pValues_(pValues), descending_(descending)
+   {
+   }
+
+   bool operator()(int lhs, int rhs) const
+   {
+      T lhsValue = pValues_[lhs];
+      T rhsValue = pValues_[rhs];
+      if (isMissing(lhsValue))
+         return false;
+      if (isMissing(rhsValue))
+         return true;
+      return descending_ ? rhsValue < lhsValue : lhsValue < rhsValue;
+   }
+
+private:
+   const T* pValues_;
+   bool descending_;
+};
+
+Error orderRows(SEXP columnSEXP,
+                ColumnKind kind,
+                bool descending,
+                std::vector<int>* pRows)
+{
+   switch (kind)
+   {
+   case ColumnLogical:
+      std::stable_sort(pRows->begin(), pRows->end(),
+                       ValueOrder<int>(LOGICAL(columnSEXP), descending));
+      return Success();
+   case ColumnInteger:
+   case ColumnFactor:
+      std::stable_sort(pRows->begin(), pRows->end(),
+                       ValueOrder<int>(INTEGER(columnSEXP), descending));
+      return Success();
+   case ColumnDouble:
+      std::stable_sort(pRows->begin(), pRows->end(),
+                       ValueOrder<double>(REAL(columnSEXP), descending));
+      return Success();
+   default:
+      break;
+   }
+
+   // strings are ordered by R so that they collate exactly as they would
+   // in the session's locale; only the rows being ordered are passed
+   std::vector<int> rows;
+   rows.reserve(pRows->size());
+   BOOST_FOREACH(int row, *pRows)
+   {
+      rows.push_back(row + 1);
+   }
+
+   r::sexp::Protect protect;
+   SEXP orderedSEXP = R_NilValue;
+   r::exec::RFunction order(".rs.orderRows");
+   order.addParam(columnSEXP);
+   order.addParam(rows);
+   order.addParam(descending);
+   Error error = order.call(&orderedSEXP, &protect);
+   if (error)
+      return error;
+
+   error = r::sexp::extract(orderedSEXP, &rows);
+   if (error)
+      return error;
+
+   if (rows.size() != pRows->size())
+      return systemError(boost::system::errc::invalid_argument,
+                         ERROR_LOCATION);
+
+   for (std::size_t i = 0; i < rows.size(); i++)
+      (*pRows)[i] = rows[i] - 1;
+   return Success();
+}
+
+} // anonymous namespace
+
+RowIndex::RowIndex()
+   : valid_(false), nrow_(0), orderCol_(0)
+{
+}
+
+bool RowIndex::supports(SEXP dataSEXP,
+                        int nrow,
+                        const std::vector<std::string>& filters,
+                        const std::string& search,
+                        int orderCol)
+{
+   if (TYPEOF(dataSEXP) != VECSXP || !Rf_inherits(dataSEXP, "data.frame"))
+      return false;
+
+   int ncol = Rf_length(dataSEXP);
+   if (static_cast<int>(filters.size()) > ncol || orderCol > ncol)
+      return false;
+
+   for (std::size_t i = 0; i < filters.size(); i++)
+   {
+      std::string type, value;
+      if (!parseFilter(filters[i], &type, &value))
+         continue;
+
+      ColumnKind kind = columnKind(VECTOR_ELT(dataSEXP, i), nrow);
+      if (!supportsFilter(kind, type, value))
+         return false;
+   }
+
+   if (!search.empty())
+   {
+      if (!isAscii(search))
+         return false;
+      for (int i = 0; i < ncol; i++)
+      {
+         if (!hasNativeText(columnKind(VECTOR_ELT(dataSEXP, i), nrow)))
+            return false;
+      }
+   }
+
+   if (orderCol > 0 &&
+       sortKind(VECTOR_ELT(dataSEXP, orderCol - 1), nrow) == ColumnUnsupported)
+   {
+      return false;
+   }
+
+   return true;
+}
+
+Error RowIndex::update(SEXP dataSEXP,
+                       int nrow,
+                       const std::vector<std::string>& filters,
+                       const std::string& search,
+                       int orderCol,
+                       const std::string& orderDir,
+                       bool narrowing)
+{
+   if (!isValidFor(nrow) || filters != filters_ || search != search_)
+   {
+      std::vector<int> rows;
+      if (narrowing && isValidFor(nrow))
+      {
+         rows.swap(filteredRows_);
+      }
+      else
+      {
+         rows.resize(nrow);
+         for (int i = 0; i < nrow; i++)
+            rows[i] = i;
+      }
+
+      filterRows(dataSEXP, nrow, filters, search, &rows);
+      filteredRows_.swap(rows);
+      filters_ = filters;
+      search_ = search;
+      nrow_ = nrow;
+      valid_ = true;
+
+      // the order needs to be recomputed for the new rows
+      orderedRows_.clear();
+      orderCol_ = 0;
+      orderDir_.clear();
+   }
+
+   if (orderCol > 0 && (orderCol != orderCol_ || orderDir != orderDir_))
+   {
+      orderedRows_ = filteredRows_;
+      SEXP columnSEXP = VECTOR_ELT(dataSEXP, orderCol - 1);
+      Error error = orderRows(columnSEXP,
+                              sortKind(columnSEXP, nrow),
+                              orderDir == "desc",
+                              &orderedRows_);
+      if (error)
+      {
+         clear();
+         return error;
+      }
+   }
+   else if (orderCol <= 0)
+   {
+      orderedRows_.clear();
+   }
+
+   orderCol_ = std::max(orderCol, 0);
+   orderDir_ = orderDir;
+   return Success();
+}
+
+void RowIndex::clear()
+{
+   valid_ = false;
+   nrow_ = 0;
+   search_.clear();
+   filters_.clear();
+   orderCol_ = 0;
+   orderDir_.clear();
+
+   // release the rows' storage (not just their contents)
+   std::vector<int>().swap(filteredRows_);
+   std::vector<int>().swap(orderedRows_);
+}
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -0,0 +1,110 @@
+/*
+ * DataViewerIndex.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_DATA_VIEWER_INDEX_HPP
+#define SESSION_DATA_VIEWER_INDEX_HPP
+
+#include <string>
+#include <vector>
+
+typedef struct SEXPREC *SEXP;
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+// The rows of a data frame that satisfy the data viewer's column filters and
+// global search, in display order. Rows are computed by reading the frame's
+// column vectors directly (rather than by subsetting a copy of the frame in
+// R) so paging through a sorted or filtered view of a large frame only needs
+// the rows being displayed. Row numbers are 0-based.
+//
+// Filters and search have the same semantics as .rs.applyTransform; the
+// frame is only indexed if every column involved can be evaluated natively
+// (see RowIndex::supports), otherwise the caller should fall back to
+// transforming the frame in R.
+class RowIndex
+{
+public:
+   RowIndex();
+
+   // indicates whether the given transform can be computed for the frame
+   static bool supports(SEXP dataSEXP,
+                        int nrow,
+                        const std::vector<std::string>& filters,
+                        const std::string& search,
+                        int orderCol);
+
+   // bring the index up to date with the given transform. if narrowing is
+   // set, the new filters and search are known to select a subset of the
+   // rows currently in the index, so only those rows are examined
+   core::Error update(SEXP dataSEXP,
+                      int nrow,
+                      const std::vector<std::string>& filters,
+                      const std::string& search,
+                      int orderCol,
+                      const std::string& orderDir,
+                      bool narrowing);
+
+   void clear();
+
+   // whether the index holds rows for a frame with nrow rows
+   bool isValidFor(int nrow) const { return valid_ && nrow_ == nrow; }
+
+   const std::string& search() const { return search_; }
+   const std::vector<std::string>& filters() const { return filters_; }
+
+   // the rows to display, in order
+   const std::vector<int>& rows() const
+   {
+      return orderCol_ > 0 ? orderedRows_ : filteredRows_;
+   }
+
+   // bytes held by the index's rows
+   std::size_t memoryUsage() const
+   {
+      return (filteredRows_.capacity() + orderedRows_.capacity()) * sizeof(int);
+   }
+
+private:
+   bool valid_;
+   int nrow_;
+
+   std::string search_;
+   std::vector<std::string> filters_;
+   int orderCol_;
+   std::string orderDir_;
+
+   // rows that pass the filters and search (ascending), and the same rows
+   // sorted on the order column (when there is one)
+   std::vector<int> filteredRows_;
+   std::vector<int> orderedRows_;
+};
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_DATA_VIEWER_INDEX_HPP
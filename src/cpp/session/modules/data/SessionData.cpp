@@ -16,6 +16,7 @@
 #include "SessionData.hpp"
 
 #include <core/Exec.hpp>
+#include <core/text/CsvReader.hpp>
  
 #include <r/RExec.hpp>
 #include <r/RErrorCategory.hpp>
@@ -110,7 +111,10 @@ private:
       sources.push_back(pathFromModulesSource("SessionDataViewer.R"));
       sources.push_back(pathFromModulesSource("SessionDataImportV2.R"));
 
-      async_r::AsyncRProcess::start(cmd.c_str(), FilePath(), async_r::R_PROCESS_VANILLA, sources);
+      async_r::AsyncRProcess::start(cmd.c_str(), FilePath(),
+                                    async_r::R_PROCESS_VANILLA |
+                                    async_r::R_PROCESS_POOLED,
+                                    sources);
    }
 
    Error readRDS(SEXP* pResult)
@@ -231,6 +235,50 @@ Error abortPreviewDataImportAsync(const json::JsonRpcRequest& request,
    return Success();
 }
 
+// previews a delimited file natively (without R), returning its first rows
+// by column along with guessed column types (used by the import dialog when
+// its options are ones the native reader handles)
+Error previewCsvFile(const json::JsonRpcRequest& request,
+                     json::JsonRpcResponse* pResponse)
+{
+   std::string path, delimiter;
+   bool header;
+   int maxRows;
+   Error error = json::readParams(request.params,
+                                  &path,
+                                  &delimiter,
+                                  &header,
+                                  &maxRows);
+   if (error)
+      return error;
+
+   text::CsvReadOptions options;
+   if (!delimiter.empty())
+      options.delimiter = delimiter[0];
+   options.header = header;
+   options.maxRows = std::max(maxRows, 0);
+
+   std::vector<text::CsvColumn> columns;
+   error = text::readCsvFile(module_context::resolveAliasedPath(path),
+                             options,
+                             &columns);
+   if (error)
+      return error;
+
+   json::Array columnsJson;
+   for (std::size_t i = 0; i < columns.size(); i++)
+   {
+      json::Object columnJson;
+      columnJson["name"] = columns[i].name;
+      columnJson["type"] = text::csvColumnTypeName(columns[i].type);
+      columnJson["values"] = json::toJsonArray(columns[i].values);
+      columnsJson.push_back(columnJson);
+   }
+
+   pResponse->setResult(columnsJson);
+   return Success();
+}
+
 Error initialize()
 {
    using boost::bind;
@@ -242,7 +290,8 @@ Error initialize()
       (bind(sourceModuleRFile, "SessionDataImportV2.R"))
       (bind(sourceModuleRFile, "SessionDataPreview.R"))
       (bind(registerAsyncRpcMethod, "preview_data_import_async", getPreviewDataImportAsync))
-      (bind(registerRpcMethod, "preview_data_import_async_abort", abortPreviewDataImportAsync));
+      (bind(registerRpcMethod, "preview_data_import_async_abort", abortPreviewDataImportAsync))
+      (bind(registerRpcMethod, "preview_csv_file", previewCsvFile));
 
    return initBlock.execute();
 }
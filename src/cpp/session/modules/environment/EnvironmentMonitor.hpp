@@ -13,9 +13,16 @@
  *
  */
 
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
 #include <r/RSexp.hpp>
 #include <r/RInterface.hpp>
 
+#include "EnvironmentUtils.hpp"
+
 namespace rstudio {
 namespace session {
 namespace modules {
@@ -32,12 +39,13 @@ public:
    bool hasEnvironment();
    void checkForChanges();
 private:
+   typedef boost::unordered_map<std::string, ValueFingerprint> Fingerprints;
+
    void listEnv(std::vector<r::sexp::Variable>* pEnvironment);
-   void enqueRemovedEvent(const r::sexp::Variable& variable);
+   void enqueRemovedEvent(const std::string& name);
    void enqueAssignedEvent(const r::sexp::Variable& variable);
 
-   std::vector<r::sexp::Variable> lastEnv_;
-   std::vector<r::sexp::Variable> unevaledPromises_;
+   Fingerprints lastEnv_;
    r::sexp::PreservedSEXP environment_;
    bool initialized_;
    bool refreshOnInit_;
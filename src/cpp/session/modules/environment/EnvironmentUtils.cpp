@@ -15,6 +15,8 @@
 
 #include "EnvironmentUtils.hpp"
 
+#include <boost/foreach.hpp>
+
 #include <r/RCntxt.hpp>
 #include <r/RCntxtUtils.hpp>
 #include <r/RExec.hpp>
@@ -35,6 +37,25 @@ namespace {
 // of a variable
 const char UNKNOWN_VALUE[] = "<unknown>";
 
+// the string sent to the client while a variable's value is being described
+const char PENDING_VALUE[] = "Computing summary...";
+
+// the string sent to the client for a value restored from a suspended
+// session which hasn't been read back in yet
+const char NOT_LOADED_VALUE[] = "<Not yet loaded>";
+
+// is this an unevaluated promise bound by lazyLoad (which is how a suspended
+// session's global environment is restored)?
+bool isLazyLoadPromise(SEXP var)
+{
+   if (!isUnevaluatedPromise(var))
+      return false;
+
+   SEXP code = PRCODE(var);
+   return TYPEOF(code) == LANGSXP &&
+          CAR(code) == Rf_install("lazyLoadDBfetch");
+}
+
 json::Value descriptionOfVar(SEXP var)
 {
    std::string value;
@@ -84,6 +105,45 @@ json::Value languageVarToJson(SEXP env, std::string objectName)
    }
 }
 
+ValueFingerprint::ValueFingerprint()
+   : value(NULL), type(NILSXP), named(0), length(0), unevaluated(false)
+{
+}
+
+ValueFingerprint::ValueFingerprint(SEXP valueSEXP)
+   : value(valueSEXP),
+     type(TYPEOF(valueSEXP)),
+     named(NAMED(valueSEXP)),
+     length(0),
+     unevaluated(isUnevaluatedPromise(valueSEXP))
+{
+   // only take the length of vectors (for which it's cheap)
+   switch (type)
+   {
+   case LGLSXP:
+   case INTSXP:
+   case REALSXP:
+   case CPLXSXP:
+   case STRSXP:
+   case VECSXP:
+   case EXPRSXP:
+   case RAWSXP:
+      length = XLENGTH(valueSEXP);
+      break;
+   default:
+      break;
+   }
+}
+
+bool ValueFingerprint::operator==(const ValueFingerprint& other) const
+{
+   return value == other.value &&
+          type == other.type &&
+          named == other.named &&
+          length == other.length &&
+          unevaluated == other.unevaluated;
+}
+
 json::Value varToJson(SEXP env, const r::sexp::Variable& var)
 {
    json::Object varJson;
@@ -107,7 +167,10 @@ json::Value varToJson(SEXP env, const r::sexp::Variable& var)
       if (isUnevaluatedPromise(varSEXP))
       {
          varJson["type"] = std::string("promise");
-         varJson["value"] = descriptionOfVar(varSEXP);
+         if (env == R_GlobalEnv && isLazyLoadPromise(varSEXP))
+            varJson["value"] = std::string(NOT_LOADED_VALUE);
+         else
+            varJson["value"] = descriptionOfVar(varSEXP);
       }
       else if (isActiveBinding)
       {
@@ -155,6 +218,68 @@ json::Value varToJson(SEXP env, const r::sexp::Variable& var)
    return varJson;
 }
 
+json::Value placeholderVarToJson(const r::sexp::Variable& var)
+{
+   SEXP varSEXP = var.second;
+
+   std::string typeName;
+   switch (TYPEOF(varSEXP))
+   {
+   case VECSXP:
+      typeName = "list";
+      break;
+   case EXPRSXP:
+      typeName = "expression";
+      break;
+   case ENVSXP:
+      typeName = "environment";
+      break;
+   case S4SXP:
+      typeName = "S4";
+      break;
+   default:
+      typeName = "unknown";
+      break;
+   }
+
+   // the object's class as class() would give it, read from its attributes
+   // so that no methods are dispatched on it
+   std::vector<std::string> classes;
+   SEXP classSEXP = r::sexp::getAttrib(varSEXP, R_ClassSymbol);
+   if (TYPEOF(classSEXP) == STRSXP)
+   {
+      Error error = r::sexp::extract(classSEXP, &classes);
+      if (error)
+         LOG_ERROR(error);
+   }
+   if (classes.empty())
+      classes.push_back(typeName);
+
+   json::Array clazz;
+   BOOST_FOREACH(const std::string& className, classes)
+   {
+      clazz.push_back(className);
+   }
+   clazz.push_back(typeName);
+
+   int length = 0;
+   if (TYPEOF(varSEXP) == VECSXP || TYPEOF(varSEXP) == EXPRSXP)
+      length = r::sexp::length(varSEXP);
+
+   json::Object varJson;
+   varJson["name"] = var.first;
+   varJson["type"] = classes.front();
+   varJson["clazz"] = clazz;
+   varJson["is_data"] = r::sexp::isDataFrame(varSEXP);
+   varJson["value"] = std::string(PENDING_VALUE);
+   varJson["description"] = std::string("");
+   varJson["size"] = 0;
+   varJson["length"] = length;
+   varJson["contents"] = json::Array();
+   varJson["contents_deferred"] = true;
+   return varJson;
+}
+
 bool functionDiffersFromSource(
       SEXP srcRef,
       const std::string& functionCode)
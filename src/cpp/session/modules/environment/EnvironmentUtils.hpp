@@ -13,6 +13,9 @@
  *
  */
 
+#ifndef SESSION_ENVIRONMENT_UTILS_HPP
+#define SESSION_ENVIRONMENT_UTILS_HPP
+
 #include <core/json/Json.hpp>
 #include <r/RSexp.hpp>
 
@@ -21,7 +24,33 @@ namespace session {
 namespace modules {
 namespace environment {
 
+// identifies the value bound to a name; when any part of it changes
+// (including the evaluation of a promise) the binding is treated as
+// assigned
+struct ValueFingerprint
+{
+   ValueFingerprint();
+   explicit ValueFingerprint(SEXP value);
+
+   bool operator==(const ValueFingerprint& other) const;
+   bool operator!=(const ValueFingerprint& other) const
+   {
+      return !(*this == other);
+   }
+
+   SEXP value;
+   int type;
+   int named;
+   R_xlen_t length;
+   bool unevaluated;
+};
+
 core::json::Value varToJson(SEXP env, const r::sexp::Variable& var);
+
+// a stand-in for varToJson (with the object's name, class and length but
+// no value or contents) for objects too expensive to describe immediately
+core::json::Value placeholderVarToJson(const r::sexp::Variable& var);
+
 bool isUnevaluatedPromise(SEXP var);
 bool functionDiffersFromSource(SEXP srcRef, const std::string& functionCode);
 void sourceRefToJson(const SEXP srcref, core::json::Object* pObject);
@@ -31,3 +60,5 @@ core::Error sourceFileFromRef(const SEXP srcref, std::string* pFileName);
 } // namespace modules
 } // namespace session
 } // namespace rstudio
+
+#endif // SESSION_ENVIRONMENT_UTILS_HPP
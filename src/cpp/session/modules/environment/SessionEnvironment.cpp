@@ -17,9 +17,14 @@
 #include "EnvironmentMonitor.hpp"
 
 #include <algorithm>
+#include <deque>
+#include <map>
+
+#include <boost/unordered_map.hpp>
 
 #include <core/Exec.hpp>
 #include <core/RecursionGuard.hpp>
+#include <core/json/JsonWriter.hpp>
 
 #define INTERNAL_R_FUNCTIONS
 #include <r/RJson.hpp>
@@ -112,8 +117,19 @@ bool handleRBrowseEnv(const core::FilePath& filePath)
    }
 }
 
+// the most bindings (and slots) we'll visit when searching an object for
+// external pointers
+const int kMaxExternalPtrSearch = 100000;
+
+// objects with more list elements than this (counted to the given depth) or
+// environments with more bindings aren't described while listing the
+// environment; their descriptions are computed during idle time instead
+const int kMaxDescribeNodes = 10000;
+const int kMaxDescribeDepth = 5;
+
 bool hasExternalPtr(SEXP obj,      // environment to search for external pointers
                     bool nullPtr,  // whether to look for NULL pointers 
+                    int* pBudget,  // bindings left to visit (< 0 if the search was cut short)
                     int level = 5) // maximum recursion depth (envs can have self-ref loops)
 {
    // list the contents of this environment
@@ -151,6 +167,11 @@ bool hasExternalPtr(SEXP obj,      // environment to search for external pointer
                                &rProtect, &vars);
    }
 
+   // give up once we've looked at too many objects
+   *pBudget -= static_cast<int>(vars.size());
+   if (*pBudget < 0)
+      return false;
+
    // check for external pointers
    for (std::vector<r::sexp::Variable>::iterator it = vars.begin(); it != vars.end(); it++)
    {
@@ -164,8 +185,10 @@ bool hasExternalPtr(SEXP obj,      // environment to search for external pointer
       {
          // if this object is itself an environment, check it recursively for external pointers. 
          // (we do this only if there's sufficient recursion depth remaining)
-         if (level > 0 && hasExternalPtr(it->second, nullPtr, level - 1))
+         if (level > 0 && hasExternalPtr(it->second, nullPtr, pBudget, level - 1))
             return true;
+         if (*pBudget < 0)
+            return false;
       }
    }
 
@@ -185,11 +208,62 @@ SEXP rs_hasExternalPointer(SEXP objSEXP, SEXP nullSEXP)
    else if (r::sexp::isPrimitiveEnvironment(objSEXP) || TYPEOF(objSEXP) == S4SXP)
    {
       // object is an environment; check it for external pointers
-      hasPtr = hasExternalPtr(objSEXP, nullPtr);
+      int budget = kMaxExternalPtrSearch;
+      hasPtr = hasExternalPtr(objSEXP, nullPtr, &budget);
+
+      // we don't know if we couldn't search the whole object
+      if (budget < 0)
+      {
+         SEXP naSEXP = Rf_allocVector(LGLSXP, 1);
+         protect.add(naSEXP);
+         LOGICAL(naSEXP)[0] = NA_LOGICAL;
+         return naSEXP;
+      }
    }
    return r::sexp::create(hasPtr, &protect);
 }
 
+// count the elements of a list (and the lists within it), returning false if
+// there are more than the budget allows
+bool countListElements(SEXP obj, int depth, int* pBudget)
+{
+   if (TYPEOF(obj) != VECSXP && TYPEOF(obj) != EXPRSXP)
+      return true;
+
+   int length = r::sexp::length(obj);
+   *pBudget -= length;
+   if (*pBudget < 0)
+      return false;
+
+   if (depth > 0)
+   {
+      for (int i = 0; i < length; i++)
+      {
+         if (!countListElements(VECTOR_ELT(obj, i), depth - 1, pBudget))
+            return false;
+      }
+   }
+   return true;
+}
+
+// whether describing the object could take long enough to hold up
+// listing the environment (describing it includes computing its size and
+// searching it for external pointers)
+bool isExpensiveToDescribe(SEXP obj)
+{
+   int budget = kMaxDescribeNodes;
+   if (TYPEOF(obj) == VECSXP || TYPEOF(obj) == EXPRSXP)
+   {
+      return !countListElements(obj, kMaxDescribeDepth, &budget);
+   }
+   else if (TYPEOF(obj) == ENVSXP || TYPEOF(obj) == S4SXP)
+   {
+      hasExternalPtr(obj, true, &budget);
+      return budget < 0;
+   }
+   return false;
+}
+
 // Construct a simulated source reference from a context containing a
 // function being debugged, and either the context containing the current
 // invocation or a string containing the last debug ouput from R.
@@ -224,6 +298,48 @@ SEXP simulatedSourceRefsOfContext(const r::context::RCntxt& context,
    return simulatedSrcref;
 }
 
+// identity of a call frame as serialized: the invocation (its environment,
+// function and call) and the source references it was described with
+// (the call of the previous context is used only to simulate references)
+struct CallFrameKey
+{
+   CallFrameKey(SEXP cloenv, SEXP callfun, SEXP call, SEXP srcref,
+                SEXP prevCall)
+      : cloenv(cloenv), callfun(callfun), call(call), srcref(srcref),
+        prevCall(prevCall)
+   {
+   }
+
+   bool operator<(const CallFrameKey& other) const
+   {
+      if (cloenv != other.cloenv)
+         return cloenv < other.cloenv;
+      if (callfun != other.callfun)
+         return callfun < other.callfun;
+      if (call != other.call)
+         return call < other.call;
+      if (srcref != other.srcref)
+         return srcref < other.srcref;
+      return prevCall < other.prevCall;
+   }
+
+   SEXP cloenv;
+   SEXP callfun;
+   SEXP call;
+   SEXP srcref;
+   SEXP prevCall;
+};
+
+// NB: the SEXPs are not protected; they're used only to identify the frames,
+// and the frames are forgotten as soon as they leave the stack (so an
+// address reused by a later frame can't match a stale frame)
+typedef std::map<CallFrameKey, json::Object> CallFrames;
+CallFrames s_callFrames;
+
+// deparsed code of the functions on the stack (keyed by function), for
+// testing whether they're out of sync with their sources
+std::map<SEXP, std::string> s_deparsedFunctions;
+
 // Return the call frames and debug information as a JSON object.
 json::Array callFramesAsJson(LineDebugState* pLineDebugState)
 {
@@ -235,6 +351,11 @@ json::Array callFramesAsJson(LineDebugState* pLineDebugState)
    Error error;
    std::map<SEXP,r::context::RCntxt> envSrcrefCtx;
 
+   // frames unchanged since the stack was last walked are taken from those
+   // serialized then; the frames serialized now replace them
+   CallFrames callFrames;
+   std::map<SEXP, std::string> deparsedFunctions;
+
    for (; context != r::context::RCntxt::end(); context++)
    {
       // if this context has a valid srcref, use it to supply the srcrefs for
@@ -252,9 +373,54 @@ json::Array callFramesAsJson(LineDebugState* pLineDebugState)
 
       if (context->callflag() & CTXT_FUNCTION)
       {
+         ++contextDepth;
+
+         std::map<SEXP, std::string>::const_iterator deparsed =
+               s_deparsedFunctions.find(context->callfun());
+         if (deparsed != s_deparsedFunctions.end())
+            deparsedFunctions.insert(*deparsed);
+
+         // attempt to find the refs for the source that invoked this function;
+         // use our own refs otherwise
+         std::map<SEXP,r::context::RCntxt>::iterator srcCtx =
+            envSrcrefCtx.find(context->cloenv());
+         if (srcCtx != envSrcrefCtx.end())
+            srcContext = srcCtx->second;
+         else
+            srcContext = *context;
+
+         // the top frame's references, when it has none of its own, are
+         // simulated from the last debug output and update the debug state;
+         // both change with every step, so such a frame is always
+         // serialized afresh
+         SEXP srcref = srcContext.srcref();
+         bool realSrcref = isValidSrcref(srcref);
+         bool stepping = !realSrcref &&
+               contextDepth == 1 &&
+               pLineDebugState != NULL;
+         bool fromDebugOutput = stepping &&
+               pLineDebugState->lastDebugText.length() > 0;
+
+         CallFrameKey key(context->cloenv(), context->callfun(),
+                          context->call(), srcref,
+                          realSrcref ? R_NilValue : prevContext.call());
+         if (!stepping)
+         {
+            CallFrames::const_iterator cached = s_callFrames.find(key);
+            if (cached != s_callFrames.end())
+            {
+               json::Object varFrame = cached->second;
+               varFrame["context_depth"] = contextDepth;
+               callFrames.insert(*cached);
+               listFrames.push_back(varFrame);
+               prevContext = *context;
+               continue;
+            }
+         }
+
          json::Object varFrame;
          std::string functionName;
-         varFrame["context_depth"] = ++contextDepth;
+         varFrame["context_depth"] = contextDepth;
 
          error = context->functionName(&functionName);
          if (error)
@@ -265,19 +431,10 @@ json::Array callFramesAsJson(LineDebugState* pLineDebugState)
          varFrame["is_error_handler"] = context->isErrorHandler();
          varFrame["is_hidden"] = context->isDebugHidden();
 
-         // attempt to find the refs for the source that invoked this function;
-         // use our own refs otherwise
-         std::map<SEXP,r::context::RCntxt>::iterator srcCtx =
-            envSrcrefCtx.find(context->cloenv());
-         if (srcCtx != envSrcrefCtx.end())
-            srcContext = srcCtx->second;
-         else
-            srcContext = *context;
-
          // mark this as a source-equivalent function if it's evaluating user
          // code into the global environment
          varFrame["is_source_equiv"] = context->cloenv() == R_GlobalEnv &&
-            isValidSrcref(srcContext.srcref());
+            realSrcref;
 
          std::string filename;
          error = srcContext.fileName(&filename);
@@ -287,8 +444,7 @@ json::Array callFramesAsJson(LineDebugState* pLineDebugState)
          varFrame["aliased_file_name"] =
                module_context::createAliasedPath(FilePath(filename));
 
-         SEXP srcref = srcContext.srcref();
-         if (isValidSrcref(srcref))
+         if (realSrcref)
          {
             varFrame["real_sourceref"] = true;
             sourceRefToJson(srcref, &varFrame);
@@ -300,9 +456,7 @@ json::Array callFramesAsJson(LineDebugState* pLineDebugState)
             // output of the last debugged statement; if it isn't, we
             // construct it by deparsing calls in the context stack.
             SEXP simulatedSrcref;
-            if (contextDepth == 1 &&
-                pLineDebugState != NULL &&
-                pLineDebugState->lastDebugText.length() > 0)
+            if (fromDebugOutput)
                simulatedSrcref =
                      simulatedSourceRefsOfContext(*context, 
                            r::context::RCntxt(), pLineDebugState);
@@ -351,19 +505,88 @@ json::Array callFramesAsJson(LineDebugState* pLineDebugState)
          // If this is a Shiny function, provide its label
          varFrame["shiny_function_label"] = context->shinyFunctionLabel();
 
+         if (!stepping)
+            callFrames[key] = varFrame;
          listFrames.push_back(varFrame);
       }
       prevContext = *context;
    }
+
+   s_callFrames.swap(callFrames);
+   s_deparsedFunctions.swap(deparsedFunctions);
    return listFrames;
 }
 
-json::Array environmentListAsJson()
+// descriptions of the objects in the monitored environment, kept while the
+// objects are unchanged so that listing the environment again doesn't
+// describe every object again
+struct CachedDescription
+{
+   ValueFingerprint fingerprint;
+   json::Value description;
+};
+typedef boost::unordered_map<std::string, CachedDescription> Descriptions;
+Descriptions s_descriptions;
+
+// NB: not protected; used only to test whether the environment has changed
+SEXP s_describedEnvironment = NULL;
+
+// objects listed with placeholder descriptions, still to be described
+std::deque<r::sexp::Variable> s_pendingDescriptions;
+bool s_describingPending = false;
+
+json::Value describeVar(SEXP env, const r::sexp::Variable& var)
+{
+   json::Value description = varToJson(env, var);
+
+   // take the fingerprint after describing the object, which may have marked
+   // it as shared
+   CachedDescription cached;
+   cached.fingerprint = ValueFingerprint(var.second);
+   cached.description = description;
+   s_descriptions[var.first] = cached;
+
+   return description;
+}
+
+// describe objects in the background (one at a time, while idle), sending
+// each description to the client as it's computed
+bool describePendingObjects()
+{
+   SEXP env = s_pEnvironmentMonitor->getMonitoredEnvironment();
+   if (env != s_describedEnvironment)
+      s_pendingDescriptions.clear();
+
+   if (s_pendingDescriptions.empty())
+   {
+      s_describingPending = false;
+      return false;
+   }
+
+   r::sexp::Variable var = s_pendingDescriptions.front();
+   s_pendingDescriptions.pop_front();
+
+   // if the object has since been replaced or removed the environment
+   // monitor will report it
+   if (r::sexp::findVar(var.first, env) == var.second)
+   {
+      json::Value description = describeVar(env, var);
+      ClientEvent assignedEvent(client_events::kEnvironmentAssigned,
+                                description);
+      module_context::enqueClientEvent(assignedEvent);
+   }
+
+   return true;
+}
+
+// produce the descriptions of the objects in the monitored environment, one
+// at a time
+void describeEnvironment(
+      const boost::function<void(const json::Value&)>& onDescription)
 {
     using namespace rstudio::r::sexp;
     Protect rProtect;
     std::vector<Variable> vars;
-    json::Array listJson;
 
     if (s_pEnvironmentMonitor->hasEnvironment())
     {
@@ -375,22 +598,87 @@ json::Array environmentListAsJson()
                           &rProtect,
                           &vars);
 
-       // get object details and transform to json
-       std::transform(vars.begin(),
-                      vars.end(),
-                      std::back_inserter(listJson),
-                      boost::bind(varToJson, env, _1));
+       // drop descriptions of objects no longer present (or from another
+       // environment)
+       Descriptions descriptions;
+       if (env == s_describedEnvironment)
+       {
+          BOOST_FOREACH(const Variable& var, vars)
+          {
+             Descriptions::const_iterator it = s_descriptions.find(var.first);
+             if (it != s_descriptions.end())
+                descriptions.insert(*it);
+          }
+       }
+       s_descriptions.swap(descriptions);
+       s_describedEnvironment = env;
+       s_pendingDescriptions.clear();
+
+       // get object details and transform to json; objects which haven't
+       // changed since we last described them use their cached details, and
+       // objects which would take a while to describe get a placeholder
+       // until they can be described in the background
+       BOOST_FOREACH(const Variable& var, vars)
+       {
+          Descriptions::const_iterator it = s_descriptions.find(var.first);
+          if (it != s_descriptions.end() &&
+              it->second.fingerprint == ValueFingerprint(var.second))
+          {
+             onDescription(it->second.description);
+          }
+          else if (isExpensiveToDescribe(var.second))
+          {
+             onDescription(placeholderVarToJson(var));
+             s_pendingDescriptions.push_back(var);
+          }
+          else
+          {
+             onDescription(describeVar(env, var));
+          }
+       }
+
+       if (!s_pendingDescriptions.empty() && !s_describingPending)
+       {
+          s_describingPending = true;
+          module_context::scheduleIncrementalWork(
+                boost::posix_time::milliseconds(20),
+                describePendingObjects,
+                true,
+                WorkPriorityHigh,
+                "environment_descriptions");
+       }
     }
+}
+
+void appendDescription(json::Array* pList, const json::Value& description)
+{
+   pList->push_back(description);
+}
+
+void writeDescription(json::Writer* pWriter, const json::Value& description)
+{
+   pWriter->value(description);
+}
 
-    return listJson;
+json::Array environmentListAsJson()
+{
+   json::Array listJson;
+   describeEnvironment(boost::bind(appendDescription, &listJson, _1));
+   return listJson;
 }
 
 Error listEnvironment(boost::shared_ptr<int> pContextDepth,
                       const json::JsonRpcRequest&,
                       json::JsonRpcResponse* pResponse)
 {
-   // return list
-   pResponse->setResult(environmentListAsJson());
+   // return list (written as it's produced, since environments can be large)
+   std::string list;
+   json::Writer writer(&list);
+   writer.startArray();
+   describeEnvironment(boost::bind(writeDescription, &writer, _1));
+   writer.endArray();
+
+   pResponse->setResultJson(list);
    return Success();
 }
 
@@ -500,22 +788,35 @@ bool functionIsOutOfSync(const r::context::RCntxt& context,
    r::sexp::Protect protect;
    SEXP sexpCode = R_NilValue;
 
-   // start by extracting the source code from the call site
-   error = r::exec::RFunction(".rs.deparseFunction",
-                              context.originalFunctionCall(),
-                              true, true)
-         .call(&sexpCode, &protect);
-   if (error)
+   // start by extracting the source code from the call site (deparsed once
+   // for as long as the function remains on the stack; its sources may
+   // change on disk, so they're compared afresh each time)
+   std::map<SEXP, std::string>::const_iterator deparsed =
+         s_deparsedFunctions.find(context.callfun());
+   if (deparsed != s_deparsedFunctions.end())
    {
-      LOG_ERROR(error);
-      return true;
+      *pFunctionCode = deparsed->second;
    }
-
-   error = r::sexp::extract(sexpCode, pFunctionCode, true);
-   if (error)
+   else
    {
-      LOG_ERROR(error);
-      return true;
+      error = r::exec::RFunction(".rs.deparseFunction",
+                                 context.originalFunctionCall(),
+                                 true, true)
+            .call(&sexpCode, &protect);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return true;
+      }
+
+      error = r::sexp::extract(sexpCode, pFunctionCode, true);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return true;
+      }
+
+      s_deparsedFunctions[context.callfun()] = *pFunctionCode;
    }
 
    // make sure the function has source references
@@ -1024,8 +1325,11 @@ SEXP rs_isBrowserActive()
 
 bool isSuspendable()
 {
-   // suppress suspension if any object has a live external pointer; these can't be restored
-   return !hasExternalPtr(R_GlobalEnv, false);
+   // suppress suspension if any object has a live external pointer; these
+   // can't be restored (nor can objects too large to search for them)
+   int budget = kMaxExternalPtrSearch;
+   bool hasPtr = hasExternalPtr(R_GlobalEnv, false, &budget);
+   return !hasPtr && budget >= 0;
 }
 
 Error initialize()
@@ -15,7 +15,9 @@
 
 #include <ctime>
 
+#include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/weak_ptr.hpp>
 #include <core/json/JsonRpc.hpp>
 
 #include <session/SessionModuleContext.hpp>
@@ -41,6 +43,7 @@
 #define kJobStateSucceeded "succeeded"
 #define kJobStateCancelled "cancelled"
 #define kJobStateFailed    "failed"
+#define kJobStateQueued    "queued"
 
 using namespace rstudio::core;
 
@@ -49,6 +52,22 @@ namespace session {
 namespace modules { 
 namespace jobs {
 
+namespace {
+
+// buffered output is flushed shortly after it's added, or as soon as this
+// much of it is pending
+const int kOutputFlushDelayMs = 100;
+const std::size_t kMaxPendingOutputBytes = 64 * 1024;
+
+void flushJobOutput(boost::weak_ptr<Job> pWeakJob)
+{
+   boost::shared_ptr<Job> pJob = pWeakJob.lock();
+   if (pJob)
+      pJob->flushOutput();
+}
+
+} // anonymous namespace
+
 Job::Job(const std::string& id, 
          const std::string& name,
          const std::string& status,
@@ -72,6 +91,8 @@ Job::Job(const std::string& id,
    autoRemove_(autoRemove),
    listening_(false),
    show_(show),
+   pendingOutputBytes_(0),
+   flushScheduled_(false),
    actions_(actions)
 {
    setState(state);
@@ -87,6 +108,8 @@ Job::Job():
    autoRemove_(true),
    listening_(false),
    show_(true),
+   pendingOutputBytes_(0),
+   flushScheduled_(false),
    actions_(R_NilValue)
 {
 }
@@ -242,9 +265,12 @@ void Job::setState(JobState state)
    if (state_ == state)
       return;
 
-   // if transitioning away from idle, set start time
+   // if transitioning away from idle, set start time (queued jobs go idle
+   // when they are launched)
    if (state_ == JobIdle && state != JobIdle)
       started_ = ::time(0);
+   else if (state_ == JobQueued && state != JobIdle)
+      started_ = ::time(0);
 
    // record new state
    state_ = state;
@@ -261,7 +287,7 @@ void Job::setListening(bool listening)
 
 bool Job::complete() const
 {
-   return state_ != JobIdle && state_ != JobRunning;
+   return state_ != JobIdle && state_ != JobRunning && state_ != JobQueued;
 }
 
 bool Job::autoRemove() const
@@ -301,27 +327,62 @@ FilePath Job::outputCacheFile()
 
 void Job::addOutput(const std::string& output, bool asError)
 {
-   // look up output file
-   Error error;
-   FilePath outputFile = outputCacheFile();
    int type = asError ? 
             module_context::kCompileOutputError : 
             module_context::kCompileOutputNormal;
 
+   pendingOutput_.push_back(std::make_pair(type, output));
+   pendingOutputBytes_ += output.size();
+
+   if (pendingOutputBytes_ >= kMaxPendingOutputBytes)
+   {
+      flushOutput();
+   }
+   else if (!flushScheduled_)
+   {
+      flushScheduled_ = true;
+      module_context::scheduleDelayedWork(
+            boost::posix_time::milliseconds(kOutputFlushDelayMs),
+            boost::bind(flushJobOutput, boost::weak_ptr<Job>(shared_from_this())),
+            false /* idle only */);
+   }
+}
+
+void Job::flushOutput()
+{
+   flushScheduled_ = false;
+   if (pendingOutput_.empty())
+      return;
+
+   std::vector<std::pair<int, std::string> > pending;
+   pending.swap(pendingOutput_);
+   pendingOutputBytes_ = 0;
+
    // let the client know, if the client happens to be listening (the client doesn't listen by
    // default because listening to all jobs simultaneously could produce an overwhelming number of
-   // client events)
+   // client events); consecutive chunks of the same type are sent as a single event
    if (listening_)
    {
-      json::Array data;
-      data.push_back(id_);
-      data.push_back(type);
-      data.push_back(output);
-      module_context::enqueClientEvent(
-            ClientEvent(client_events::kJobOutput, data));
+      std::size_t i = 0;
+      while (i < pending.size())
+      {
+         int type = pending[i].first;
+         std::string output;
+         for (; i < pending.size() && pending[i].first == type; i++)
+            output.append(pending[i].second);
+
+         json::Array data;
+         data.push_back(id_);
+         data.push_back(type);
+         data.push_back(output);
+         module_context::enqueClientEvent(
+               ClientEvent(client_events::kJobOutput, data));
+      }
    }
 
    // create parent folder if necessary
+   Error error;
+   FilePath outputFile = outputCacheFile();
    if (!outputFile.parent().exists())
    {
       error = outputFile.parent().ensureDirectory();
@@ -341,18 +402,24 @@ void Job::addOutput(const std::string& output, bool asError)
       return;
    }
 
-   // create json array with output and write it to the file
-   json::Array contents;
-   contents.push_back(type);
-   contents.push_back(output);
-   json::write(contents, *file);
-
-   // append a newline (the file is newline-delimited JSON)
-   *file << std::endl;
+   // write each chunk as a json array of [type, output] on its own line
+   // (the file is newline-delimited JSON)
+   for (std::size_t i = 0; i < pending.size(); i++)
+   {
+      json::Array contents;
+      contents.push_back(pending[i].first);
+      contents.push_back(pending[i].second);
+      json::write(contents, *file);
+      *file << "\n";
+   }
+   file->flush();
 }
 
-json::Array Job::output(int position)
+json::Array Job::output(int position, int maxEntries)
 {
+   // make sure the file has everything so far
+   flushOutput();
+
    // read the lines from the file
    json::Array output;
    FilePath outputFile = outputCacheFile();
@@ -376,8 +443,9 @@ json::Array Job::output(int position)
       pIfs->exceptions(std::istream::badbit);
 
       // read each line; parse it as JSON and add it to the output array if it's past the sought
-      // position
-      while (!pIfs->eof())
+      // position (stopping once we have as many entries as were asked for)
+      while (!pIfs->eof() &&
+             (maxEntries < 0 || output.size() < static_cast<std::size_t>(maxEntries)))
       {
          std::getline(*pIfs, content);
          if (++line > position)
@@ -403,6 +471,8 @@ json::Array Job::output(int position)
 
 void Job::cleanup()
 {
+   pendingOutput_.clear();
+   pendingOutputBytes_ = 0;
    outputCacheFile().removeIfExists();
 }
 
@@ -415,6 +485,7 @@ std::string Job::stateAsString(JobState state)
       case JobSucceeded: return kJobStateSucceeded;
       case JobCancelled: return kJobStateCancelled;
       case JobFailed:    return kJobStateFailed;
+      case JobQueued:    return kJobStateQueued;
       case JobInvalid:   return "";
    }
    return "";
@@ -427,6 +498,7 @@ JobState Job::stringAsState(const std::string& state)
    else if (state == kJobStateSucceeded)  return JobSucceeded;
    else if (state == kJobStateCancelled)  return JobCancelled;
    else if (state == kJobStateFailed)     return JobFailed;
+   else if (state == kJobStateQueued)     return JobQueued;
 
    return JobInvalid;
 }
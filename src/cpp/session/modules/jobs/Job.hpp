@@ -17,9 +17,13 @@
 #define SESSION_JOBS_JOB_HPP
 
 #include <string>
+#include <utility>
+#include <vector>
+
 #include <core/json/Json.hpp>
 #include <r/RSexp.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/enable_shared_from_this.hpp>
 
 namespace rstudio {
 namespace session {
@@ -36,13 +40,14 @@ enum JobState {
    JobSucceeded  = 3,
    JobCancelled  = 4,
    JobFailed     = 5,
+   JobQueued     = 6,
 
    // min/max valid state sentries
    JobStateMin   = JobIdle,
-   JobStateMax   = JobFailed
+   JobStateMax   = JobQueued
 };
 
-class Job
+class Job : public boost::enable_shared_from_this<Job>
 {
 public:
    Job();
@@ -92,9 +97,14 @@ public:
    core::Error executeAction(const std::string& name);
    void setActions(SEXP actions);
 
-   // add and retrieve output
+   // add and retrieve output; output is buffered briefly so that bursts of
+   // small chunks are written (and sent to the client) together. at most
+   // maxEntries entries are returned (starting at position) if specified
    void addOutput(const std::string& output, bool error); 
-   core::json::Array output(int position);
+   core::json::Array output(int position, int maxEntries = -1);
+
+   // write any buffered output to the file and the client
+   void flushOutput();
 
    // whether the job pane should should be shown at start
    bool show() const;
@@ -142,6 +152,11 @@ private:
    bool listening_;
    bool show_;
 
+   // output not yet flushed, as (type, output) chunks
+   std::vector<std::pair<int, std::string> > pendingOutput_;
+   std::size_t pendingOutputBytes_;
+   bool flushScheduled_;
+
    r::sexp::PreservedSEXP actions_;
 };
 
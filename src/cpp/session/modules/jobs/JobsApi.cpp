@@ -36,12 +36,45 @@ namespace {
 // map of job ID to jobs
 std::map<std::string, boost::shared_ptr<Job> > s_jobs;
 
-// notify client that job has been updated
+// map of job ID to the job as the client last saw it
+std::map<std::string, json::Object> s_sentJobs;
+
+// notify client that job has been updated; updates only carry the fields
+// which have changed since the client was last notified (along with the ID)
 void notifyClient(JobUpdateType update, boost::shared_ptr<Job> pJob)
 {
+   json::Object job = pJob->toJson();
    json::Object data;
    data["type"] = static_cast<int>(update);
-   data["job"]  = pJob->toJson();
+
+   if (update == JobUpdated)
+   {
+      json::Object& sent = s_sentJobs[pJob->id()];
+      json::Object delta;
+      for (json::Object::const_iterator it = job.begin(); it != job.end(); ++it)
+      {
+         json::Object::const_iterator prev = sent.find(it->first);
+         if (prev == sent.end() || !(prev->second == it->second))
+            delta[it->first] = it->second;
+      }
+      sent = job;
+
+      // nothing to tell the client
+      if (delta.empty())
+         return;
+
+      delta["id"] = pJob->id();
+      data["job"] = delta;
+   }
+   else
+   {
+      if (update == JobRemoved)
+         s_sentJobs.erase(pJob->id());
+      else
+         s_sentJobs[pJob->id()] = job;
+      data["job"] = job;
+   }
+
    module_context::enqueClientEvent(
          ClientEvent(client_events::kJobUpdated, data));
 }
@@ -153,6 +186,7 @@ void removeAllJobs()
       notifyClient(JobRemoved, job.second);
    }
    s_jobs.clear();
+   s_sentJobs.clear();
 }
 
 void removeCompletedJobs()
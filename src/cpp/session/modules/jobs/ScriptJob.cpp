@@ -13,12 +13,20 @@
  *
  */
 
+#include <algorithm>
+#include <deque>
+
 #include <boost/asio.hpp>
+#include <boost/thread.hpp>
 
 #include <r/RExec.hpp>
 
 #include <core/Algorithm.hpp>
 
+#ifndef _WIN32
+#include <core/system/PosixSched.hpp>
+#endif
+
 #include <session/SessionModuleContext.hpp>
 #include <session/SessionAsyncRProcess.hpp>
  
@@ -42,14 +50,24 @@ namespace {
 class ScriptJob : public async_r::AsyncRProcess 
 {
 public:
+   // create the job (it appears in the jobs pane right away, but is queued
+   // until start is called)
    static boost::shared_ptr<ScriptJob> create(
          const ScriptLaunchSpec& spec,
-         boost::function<void()> onComplete)
+         boost::function<void(const std::string&)> onComplete)
    {
       boost::shared_ptr<ScriptJob> pJob(new ScriptJob(spec, onComplete));
-      pJob->start();
+      pJob->prepare();
       return pJob;
    }
+
+   // cancel the job before it has started
+   void cancel()
+   {
+      import_.removeIfExists();
+      if (job_)
+         setJobState(job_, JobCancelled);
+   }
    
    std::string id()
    {
@@ -58,16 +76,54 @@ public:
       return "";
    }
    
+   // launch the job
+   void start()
+   {
+      // currently idle until we get some content from it
+      setJobState(job_, JobIdle);
+
+      std::string importRdata = "NULL";
+      std::string exportRdata = "NULL";
+
+      if (!import_.empty())
+         importRdata = "'" + string_utils::utf8ToSystem(import_.absolutePath()) + "'";
+
+      if (!spec_.exportEnv().empty())
+      {
+         // if exporting, create a file to host the exported values
+         FilePath::tempFilePath(&export_);
+         exportRdata = "'" + string_utils::utf8ToSystem(export_.absolutePath()) + "'";
+      }
+      
+      // form the command to send to R
+      std::string cmd = "source('" +
+         string_utils::utf8ToSystem(
+            string_utils::singleQuotedStrEscape(
+                  session::options().modulesRSourcePath()
+                                    .complete("SourceWithProgress.R").absolutePath())) + 
+         "'); sourceWithProgress(script = '" +
+         string_utils::utf8ToSystem(
+               string_utils::singleQuotedStrEscape(spec_.path().absolutePath())) + "', "
+         "encoding = '" + spec_.encoding() + "', "
+         "con = stdout(), "
+         "importRdata = " + importRdata + ", "
+         "exportRdata = " + exportRdata + ");";
+        
+      core::system::Options environment;
+      async_r::AsyncRProcess::start(cmd.c_str(), environment, spec_.workingDir(),
+                                    async_r::R_PROCESS_NO_RDATA);
+   }
+
 private:
    ScriptJob(const ScriptLaunchSpec& spec, 
-         boost::function<void()> onComplete):
+         boost::function<void(const std::string&)> onComplete):
       spec_(spec),
       completed_(false),
       onComplete_(onComplete)
    {
    }
 
-   void start()
+   void prepare()
    {
       Error error;
       r::sexp::Protect protect;
@@ -78,19 +134,17 @@ private:
       if (error)
          LOG_ERROR(error);
 
-      // add the job -- currently idle until we get some content from it
-      job_ = addJob(spec_.path().filename(), "", "", 0, JobIdle, false, actions, true);
-      
-      std::string importRdata = "NULL";
-      std::string exportRdata = "NULL";
+      // add the job -- queued until there's capacity to run it
+      job_ = addJob(spec_.path().filename(), "", "", 0, JobQueued, false, actions, true);
 
       if (spec_.importEnv())
       {
          // create temporary file to save/load the data
          FilePath::tempFilePath(&import_);
-         importRdata = "'" + string_utils::utf8ToSystem(import_.absolutePath()) + "'";
 
-         // prepare the environment for the script by exporting the current env
+         // prepare the environment for the script by exporting the current
+         // env (now, rather than when the job starts, so the script sees the
+         // environment as it was when it was launched)
          setJobStatus(job_, "Preparing environment");
          r::exec::RFunction save("save.image");
          save.addParam("file", string_utils::utf8ToSystem(import_.absolutePath()));
@@ -104,31 +158,6 @@ private:
          // clear status in preparation for execution
          setJobStatus(job_, "");
       }
-
-      if (!spec_.exportEnv().empty())
-      {
-         // if exporting, create a file to host the exported values
-         FilePath::tempFilePath(&export_);
-         exportRdata = "'" + string_utils::utf8ToSystem(export_.absolutePath()) + "'";
-      }
-      
-      // form the command to send to R
-      std::string cmd = "source('" +
-         string_utils::utf8ToSystem(
-            string_utils::singleQuotedStrEscape(
-                  session::options().modulesRSourcePath()
-                                    .complete("SourceWithProgress.R").absolutePath())) + 
-         "'); sourceWithProgress(script = '" +
-         string_utils::utf8ToSystem(
-               string_utils::singleQuotedStrEscape(spec_.path().absolutePath())) + "', "
-         "encoding = '" + spec_.encoding() + "', "
-         "con = stdout(), "
-         "importRdata = " + importRdata + ", "
-         "exportRdata = " + exportRdata + ");";
-        
-      core::system::Options environment;
-      async_r::AsyncRProcess::start(cmd.c_str(), environment, spec_.workingDir(),
-                                    async_r::R_PROCESS_NO_RDATA);
    }
 
    void onStdout(const std::string& output)
@@ -262,7 +291,7 @@ private:
       export_.removeIfExists();
 
       // run caller-provided completion function
-      onComplete_();
+      onComplete_(id());
    }
 
    void onProgress(const std::string& cat, const std::string& argument)
@@ -300,12 +329,62 @@ private:
    bool completed_;
    FilePath import_;
    FilePath export_;
-   boost::function<void()> onComplete_;
+   boost::function<void(const std::string&)> onComplete_;
 };
 
 
+// running scripts
 std::vector<boost::shared_ptr<ScriptJob> > s_scripts;
 
+// scripts waiting for a running one to finish (in launch order)
+std::deque<boost::shared_ptr<ScriptJob> > s_queuedScripts;
+
+// the number of scripts which can run at once
+std::size_t maxRunningScripts()
+{
+   int max = session::options().maxConcurrentJobs();
+   if (max > 0)
+      return max;
+
+#ifndef _WIN32
+   // one per core this session is allowed to run on
+   core::system::CpuAffinity cpus;
+   Error error = core::system::getCpuAffinity(&cpus);
+   if (!error && !core::system::isCpuAffinityEmpty(cpus))
+      return std::count(cpus.begin(), cpus.end(), true);
+   return std::max(core::system::cpuCount(), 1);
+#else
+   return std::max(boost::thread::hardware_concurrency(), 1u);
+#endif
+}
+
+void startQueuedScripts()
+{
+   while (!s_queuedScripts.empty() && s_scripts.size() < maxRunningScripts())
+   {
+      boost::shared_ptr<ScriptJob> pScript = s_queuedScripts.front();
+      s_queuedScripts.pop_front();
+      s_scripts.push_back(pScript);
+      pScript->start();
+   }
+}
+
+void onScriptCompleted(const std::string& id)
+{
+   // remove the script from the list of those running
+   for (auto it = s_scripts.begin(); it != s_scripts.end(); ++it)
+   {
+      if ((*it)->id() == id)
+      {
+         s_scripts.erase(it);
+         break;
+      }
+   }
+
+   // and start the next in line
+   startQueuedScripts();
+}
+
 } // anonymous namespace
 
 ScriptLaunchSpec::ScriptLaunchSpec(
@@ -349,19 +428,16 @@ std::string ScriptLaunchSpec::encoding()
 
 Error startScriptJob(const ScriptLaunchSpec& spec, std::string* pId)
 {
-   boost::shared_ptr<ScriptJob> job = ScriptJob::create(spec,
-         [&]() 
-         { 
-            // remove the script from the list of those running
-            s_scripts.erase(std::remove(s_scripts.begin(), s_scripts.end(), job), s_scripts.end());
-         });
+   boost::shared_ptr<ScriptJob> job = ScriptJob::create(spec, onScriptCompleted);
 
    if (pId != nullptr)
    {
       *pId = job->id();
    }
 
-   s_scripts.push_back(job);
+   // queue the script and start it if there's room
+   s_queuedScripts.push_back(job);
+   startQueuedScripts();
    return Success();
 }
 
@@ -377,6 +453,18 @@ Error stopScriptJob(const std::string& id)
       }
    }
 
+   for (auto it = s_queuedScripts.begin(); it != s_queuedScripts.end(); ++it)
+   {
+      if ((*it)->id() == id)
+      {
+         // not started yet; just drop it from the queue
+         boost::shared_ptr<ScriptJob> pScript = *it;
+         s_queuedScripts.erase(it);
+         pScript->cancel();
+         return Success();
+      }
+   }
+
    // indicate that we didn't find the job
    Error error = systemError(boost::system::errc::no_such_file_or_directory, 
          ERROR_LOCATION);
@@ -265,20 +265,29 @@ Error getJobs(const json::JsonRpcRequest& request,
 Error jobOutput(const json::JsonRpcRequest& request,
                 json::JsonRpcResponse* pResponse)
 {
-   // extract job ID
+   // extract job ID, position and (optionally) the number of entries to
+   // return, so that long output can be fetched a page at a time
    std::string id;
    int position;
+   int maxEntries = -1;
    Error error = json::readParams(request.params, &id, &position);
    if (error)
       return error;
 
+   if (request.params.size() > 2)
+   {
+      error = json::readParam(request.params, 2, &maxEntries);
+      if (error)
+         return error;
+   }
+
    // look up in cache
    boost::shared_ptr<Job> pJob;
    if (!lookupJob(id, &pJob))
       return Error(json::errc::ParamInvalid, ERROR_LOCATION);
 
    // show output
-   pResponse->setResult(pJob->output(position));
+   pResponse->setResult(pJob->output(position, maxEntries));
 
    return Success();
 }
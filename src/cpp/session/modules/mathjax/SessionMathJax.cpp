@@ -42,7 +42,7 @@ void handleMathJax(const http::Request& request, http::Response* pResponse)
    // construct path to resource
    FilePath mathjaxPath = options().mathjaxPath();
    FilePath resourcePath = mathjaxPath.complete(path);
-   pResponse->setCacheableFile(resourcePath, request);
+   pResponse->setResourceFile(resourcePath, request);
 }
 
 } // end anonymous namespace
@@ -59,14 +59,27 @@ std::string commandsAsJsonArray(const Slide& slide)
    return ostr.str();
 }
 
+// the HTML rendered for the markdown of each slide of the last deck rendered
+// (so that only slides which changed are re-rendered when a deck is
+// refreshed)
+markdown::BlockCache s_slideMarkdownCache;
+
 Error renderMarkdown(const std::string& content, std::string* pHTML)
 {
+   if (s_slideMarkdownCache.lookup(content, pHTML))
+      return Success();
+
    markdown::Extensions extensions;
    markdown::HTMLOptions htmlOptions;
-   return markdown::markdownToHTML(content,
-                                   extensions,
-                                   htmlOptions,
-                                   pHTML);
+   Error error = markdown::markdownToHTML(content,
+                                          extensions,
+                                          htmlOptions,
+                                          pHTML);
+   if (error)
+      return error;
+
+   s_slideMarkdownCache.add(content, *pHTML);
+   return Success();
 }
 
 
@@ -342,6 +355,9 @@ Error renderSlides(const SlideDeck& slideDeck,
    // track json version of slide list
    SlideNavigationList navigationList(slideDeck.navigation());
 
+   // reuse the markdown rendered for unchanged slides
+   s_slideMarkdownCache.startRender("");
+
    // now the slides
    std::string cmdPad(8, ' ');
    int slideNumber = 0;
@@ -540,6 +556,8 @@ Error renderSlides(const SlideDeck& slideDeck,
       slideNumber++;
    }
 
+   s_slideMarkdownCache.finishRender();
+
    // init slide list as part of actions
    navigationList.complete();
    ostrInitActions << navigationList.asCall() << "\n";
@@ -21,6 +21,7 @@
 #include <boost/utility.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
@@ -29,6 +30,7 @@
 #include <boost/iostreams/filter/regex.hpp>
 
 #include <core/FileSerializer.hpp>
+#include <core/Hash.hpp>
 #include <core/HtmlUtils.hpp>
 #include <core/markdown/Markdown.hpp>
 #include <core/text/TemplateFilter.hpp>
@@ -256,6 +258,23 @@ std::string extractKnitrError(const std::string& stdError)
 
 }
 
+// hashes of the contents of the R markdown files as they were last knit
+// (keyed by path) -- lets us skip knits of files which were saved without
+// being changed
+std::map<std::string,std::string> s_knitHashes;
+
+std::string knitHash(const FilePath& rmdPath)
+{
+   std::string contents;
+   Error error = core::readStringFromFile(rmdPath, &contents);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return std::string();
+   }
+   return hash::crc32HexHash(contents);
+}
+
 bool performKnit(const FilePath& rmdPath,
                  bool clearCache,
                  ErrorResponse* pErrorResponse)
@@ -276,6 +295,17 @@ bool performKnit(const FilePath& rmdPath,
    if (mdPath.exists() && (mdPath.lastWriteTime() > rmdPath.lastWriteTime()))
       return true;
 
+   // also skip it if the .Rmd is newer but its contents haven't changed
+   // since we last knit it
+   std::string rmdHash = knitHash(rmdPath);
+   std::string& lastKnitHash = s_knitHashes[rmdPath.absolutePath()];
+   if (!clearCache && mdPath.exists() &&
+       !rmdHash.empty() && (rmdHash == lastKnitHash))
+   {
+      return true;
+   }
+   lastKnitHash.clear();
+
    // R binary
    FilePath rProgramPath;
    Error error = module_context::rScriptPath(&rProgramPath);
@@ -380,6 +410,7 @@ bool performKnit(const FilePath& rmdPath,
    }
    else
    {
+      s_knitHashes[rmdPath.absolutePath()] = rmdHash;
       return true;
    }
 }
@@ -469,9 +500,8 @@ std::string fixupLink(const boost::cmatch& match)
 
 boost::iostreams::regex_filter linkFilter()
 {
-   return boost::iostreams::regex_filter(
-            boost::regex("<a href=\"([^\"]+)\""),
-            fixupLink);
+   static boost::regex reLink("<a href=\"([^\"]+)\"");
+   return boost::iostreams::regex_filter(reLink, fixupLink);
 }
 
 std::string userSlidesCss(const SlideDeck& slideDeck)
@@ -603,6 +633,25 @@ typedef boost::function<void(const FilePath&,
                              const std::string&,
                              std::map<std::string,std::string>*)> VarSource;
 
+// the preview most recently rendered by handlePresentationRootRequest and
+// a hash of the vars it was rendered from
+std::string s_previewKey;
+std::string s_previewHTML;
+
+std::string previewCacheKey(const std::map<std::string,std::string>& vars)
+{
+   std::string key;
+   for (std::map<std::string,std::string>::const_iterator it = vars.begin();
+        it != vars.end();
+        ++it)
+   {
+      key.append(it->first).append(1, '\0')
+         .append(it->second).append(1, '\0');
+   }
+   return hash::crc32HexHash(key) + ":" +
+          boost::lexical_cast<std::string>(key.size());
+}
+
 void publishToRPubsVars(const FilePath&,
                         const std::string& slides,
                         std::map<std::string,std::string>* pVars)
@@ -902,15 +951,31 @@ void handlePresentationRootRequest(const std::string& path,
    vars["reveal_rtl"] = slideDeck.rtl();
 
    // render to output stream
-   std::stringstream previewOutputStream;
-   std::vector<boost::iostreams::regex_filter> filters;
-   filters.push_back(linkFilter());
-   if (renderPresentation(vars, filters, previewOutputStream, &errorResponse))
+   // the template and link filters are only re-run when the vars change
+   std::string previewKey = previewCacheKey(vars);
+   bool rendered = previewKey == s_previewKey;
+   if (!rendered)
+   {
+      std::stringstream previewOutputStream;
+      std::vector<boost::iostreams::regex_filter> filters;
+      filters.push_back(linkFilter());
+      rendered = renderPresentation(vars,
+                                    filters,
+                                    previewOutputStream,
+                                    &errorResponse);
+      if (rendered)
+      {
+         s_previewKey = previewKey;
+         s_previewHTML = previewOutputStream.str();
+      }
+   }
+
+   if (rendered)
    {
       // set response
       pResponse->setNoCacheHeaders();
       pResponse->setContentType("text/html");
-      pResponse->setBody(previewOutputStream);
+      pResponse->setBody(s_previewHTML);
 
       // also save a view in browser version if that path already exists
       // (allows the user to do a simple browser refresh to see changes)
@@ -992,54 +1057,6 @@ void handlePresentationHelpMarkdownRequest(const FilePath& filePath,
                       text::TemplateFilter(vars));
 }
 
-void handleRangeRequest(const FilePath& targetFile,
-                        const http::Request& request,
-                        http::Response* pResponse)
-{
-   // cache the last file
-   struct RangeFileCache
-   {
-      FileInfo file;
-      std::string contentType;
-      std::string contents;
-
-      void clear()
-      {
-         file = FileInfo();
-         contentType.clear();
-         contents.clear();
-      }
-   };
-   static RangeFileCache s_cache;
-
-   // see if we need to do a fresh read
-   if (targetFile.absolutePath() != s_cache.file.absolutePath() ||
-       targetFile.lastWriteTime() != s_cache.file.lastWriteTime())
-   {
-      // clear the cache
-      s_cache.clear();
-
-      // read the file in from disk
-      Error error = core::readStringFromFile(targetFile, &(s_cache.contents));
-      if (error)
-      {
-         pResponse->setError(error);
-         return;
-      }
-
-      // update the cache
-      s_cache.file = FileInfo(targetFile);
-      s_cache.contentType = targetFile.mimeContentType();
-   }
-
-   // always serve from the cache
-   pResponse->setRangeableFile(s_cache.contents,
-                               s_cache.contentType,
-                               request);
-
-
-}
-
 void handlePresentationViewInBrowserRequest(const http::Request& request,
                                             http::Response* pResponse)
 {
@@ -1168,7 +1185,7 @@ void handlePresentationPaneRequest(const http::Request& request,
       FilePath targetFile = presentation::state::directory().childPath(path);
       if (!request.headerValue("Range").empty())
       {
-         handleRangeRequest(targetFile, request, pResponse);
+         pResponse->setRangeableFile(targetFile, request);
       }
       else
       {
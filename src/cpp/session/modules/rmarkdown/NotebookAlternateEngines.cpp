@@ -801,6 +801,28 @@ Error executeAlternateEngineChunk(const std::string& docId,
    return error;
 }
 
+bool isProcessEngine(const std::string& engine)
+{
+   // these engines have custom routines which run in R
+   if (engine == "Rcpp" || engine == "stan" || engine == "sql")
+      return false;
+
+   bool isSystemInterpreter = false;
+   Error error = r::exec::RFunction(".rs.isSystemInterpreter")
+         .addParam(engine)
+         .call(&isSystemInterpreter);
+   if (error)
+      LOG_ERROR(error);
+
+   return isSystemInterpreter;
+}
+
+void interruptAlternateEngineChunk(const std::string& docId,
+                                   const std::string& chunkId)
+{
+   interruptChunk(docId, chunkId);
+}
+
 Error initAlternateEngines()
 {
    using namespace module_context;
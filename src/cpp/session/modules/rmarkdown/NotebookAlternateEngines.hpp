@@ -36,6 +36,15 @@ core::Error executeAlternateEngineChunk(const std::string& docId,
                                   ExecScope execScope,
                                   int pixelWidth,
                                   int charWidth);
+
+// whether chunks for the given engine are run in a child process (rather
+// than on the R thread), and so can run alongside other chunks
+bool isProcessEngine(const std::string& engine);
+
+// stop a chunk running in a child process
+void interruptAlternateEngineChunk(const std::string& docId,
+                                   const std::string& chunkId);
+
 } // namespace notebook
 } // namespace rmarkdown
 } // namespace modules
@@ -20,6 +20,8 @@
 #include "NotebookOutput.hpp"
 #include "NotebookHtmlWidgets.hpp"
 
+#include <algorithm>
+
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 
@@ -30,8 +32,11 @@
 #include <core/Algorithm.hpp>
 #include <core/Exec.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/Hash.hpp>
+#include <core/SafeConvert.hpp>
 
 #include <r/RExec.hpp>
+#include <r/ROptions.hpp>
 #include <r/RRoutines.hpp>
 #include <r/RJson.hpp>
 
@@ -42,6 +47,16 @@
 
 #define kCacheAgeThresholdMs 1000 * 60 * 60 * 24 * 2
 
+// the folder (in the cache root) holding the content-addressed output store
+#define kOutputStoreDir "store"
+
+// outputs smaller than this aren't worth sharing
+#define kMinStoredOutputBytes 1024
+
+// default limit on the size of the notebook caches, in megabytes (can be set
+// with options(rstudio.notebook.cacheBudgetMb))
+#define kDefaultCacheBudgetMb 1024
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -51,6 +66,241 @@ namespace rmarkdown {
 namespace notebook {
 namespace {
 
+FilePath outputStoreRoot()
+{
+   return notebookCacheRoot().complete(kOutputStoreDir);
+}
+
+// chunk outputs (plots, widgets and their HTML dependencies, data) are often
+// identical across executions and documents. once outputs are committed to a
+// document's saved cache, each one is made a hard link to a single copy in a
+// content-addressed store, keyed by size and checksum. a stored output's link
+// count is then its reference count: one for the store, plus one for each
+// cache using it.
+bool storeOutputFile(int level, const FilePath& file)
+{
+   if (file.isDirectory())
+      return true;
+
+   // console output and chunk metadata are appended to or rewritten in place,
+   // so they can't be shared
+   std::string ext = file.extensionLowerCase();
+   if (ext == ".csv" || ext == ".json" || ext == ".txt")
+      return true;
+
+   // skip small outputs and those which are already shared
+   if (file.size() < kMinStoredOutputBytes || file.hardLinkCount() != 1)
+      return true;
+
+   std::string checksum;
+   Error error = hash::crc32cHexHash(file, &checksum);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return true;
+   }
+
+   FilePath stored = outputStoreRoot().complete(
+         safe_convert::numberToString(file.size()) + "-" + checksum);
+
+   // first copy of these contents; add it to the store
+   if (!stored.exists())
+   {
+      error = file.link(stored);
+      if (error)
+         LOG_ERROR(error);
+      return true;
+   }
+
+   // confirm the match (the checksum is only a hint)
+   std::string contents, storedContents;
+   error = readStringFromFile(file, &contents);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return true;
+   }
+   error = readStringFromFile(stored, &storedContents);
+   if (error || storedContents != contents)
+      return true;
+
+   // replace our copy with a link to the stored one (if we can't link for
+   // some reason, put our copy back)
+   error = file.remove();
+   if (error)
+   {
+      LOG_ERROR(error);
+      return true;
+   }
+   error = stored.link(file);
+   if (error)
+   {
+      LOG_ERROR(error);
+      error = writeStringToFile(file, contents);
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   return true;
+}
+
+void storeOutputs(const FilePath& cacheFolder)
+{
+   Error error = outputStoreRoot().ensureDirectory();
+   if (!error)
+      error = cacheFolder.childrenRecursive(storeOutputFile);
+   if (error)
+      LOG_ERROR(error);
+}
+
+// remove stored outputs which are no longer used by any cache
+void pruneOutputStore()
+{
+   std::vector<FilePath> stored;
+   Error error = outputStoreRoot().children(&stored);
+   if (error)
+      return;
+
+   BOOST_FOREACH(const FilePath& file, stored)
+   {
+      if (file.hardLinkCount() == 1)
+      {
+         error = file.remove();
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+}
+
+// accumulate the disk space used by a file; the space used by a shared file
+// is split across the links to it, so each file is counted once in total
+bool addSharedSize(int level, const FilePath& file, double* pBytes)
+{
+   uintmax_t links = file.hardLinkCount();
+   if (links > 0)
+      *pBytes += static_cast<double>(file.size()) / links;
+   return true;
+}
+
+double sharedSize(const FilePath& folder)
+{
+   if (!folder.exists())
+      return 0;
+
+   double bytes = 0;
+   Error error = folder.childrenRecursive(
+            boost::bind(addSharedSize, _1, _2, &bytes));
+   if (error)
+      LOG_ERROR(error);
+   return bytes;
+}
+
+// indicates whether the notebook with the given ID is open
+bool isCacheOpen(const FilePath& cache, const std::string& notebookId)
+{
+   FilePath path;
+   Error error = notebookIdToPath(notebookId, &path);
+   if (error)
+      return false;
+
+   std::string id;
+   source_database::getId(module_context::createAliasedPath(
+            FileInfo(path)), &id);
+   return !id.empty();
+}
+
+struct CacheContextUsage
+{
+   FilePath path;
+   std::time_t lastUsed;
+   double bytes;
+};
+
+bool lessRecentlyUsed(const CacheContextUsage& a, const CacheContextUsage& b)
+{
+   return a.lastUsed < b.lastUsed;
+}
+
+// keep the total size of the notebook caches within the budget by removing
+// the caches of documents which aren't open, least recently used first
+void enforceCacheBudget()
+{
+   FilePath cacheRoot = notebookCacheRoot();
+   if (!cacheRoot.exists())
+      return;
+
+   double budgetMb = kDefaultCacheBudgetMb;
+   SEXP budgetSEXP = r::options::getOption("rstudio.notebook.cacheBudgetMb");
+   if (budgetSEXP != R_NilValue)
+      budgetMb = r::sexp::asReal(budgetSEXP);
+   if (!(budgetMb > 0))
+      return;
+   double budget = budgetMb * 1024 * 1024;
+
+   pruneOutputStore();
+   pruneLibraryStore();
+   double total = sharedSize(outputStoreRoot()) +
+                  sharedSize(libraryStoreRoot());
+
+   std::vector<FilePath> caches;
+   Error error = cacheRoot.children(&caches);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   std::vector<CacheContextUsage> evictable;
+   BOOST_FOREACH(const FilePath& cache, caches)
+   {
+      std::vector<std::string> parts = core::algorithm::split(
+            cache.stem(), "-");
+      if (!cache.isDirectory() || parts.size() < 2)
+         continue;
+
+      bool open = isCacheOpen(cache, parts[0]);
+
+      std::vector<FilePath> contexts;
+      error = cache.complete(kCacheVersion).children(&contexts);
+      if (error)
+         continue;
+
+      BOOST_FOREACH(const FilePath& context, contexts)
+      {
+         CacheContextUsage usage;
+         usage.path = context;
+         usage.bytes = sharedSize(context);
+         FilePath chunkDefs = context.complete(kNotebookChunkDefFilename);
+         usage.lastUsed = chunkDefs.exists() ? chunkDefs.lastWriteTime() :
+                                               context.lastWriteTime();
+         total += usage.bytes;
+         if (!open)
+            evictable.push_back(usage);
+      }
+   }
+
+   if (total <= budget)
+      return;
+
+   std::sort(evictable.begin(), evictable.end(), lessRecentlyUsed);
+   BOOST_FOREACH(const CacheContextUsage& usage, evictable)
+   {
+      if (total <= budget)
+         break;
+
+      error = usage.path.remove();
+      if (error)
+      {
+         LOG_ERROR(error);
+         continue;
+      }
+      total -= usage.bytes;
+   }
+
+   pruneOutputStore();
+   pruneLibraryStore();
+}
+
 // it's much faster to load a notebook from its cache than it is to rehydrate
 // it from its .Rnb, so we keep it around even if the document is closed (as
 // it's somewhat common to open and close a document periodically over the 
@@ -107,13 +357,8 @@ void cleanUnusedCaches()
       }
 
       // is this document still open? if so, leave the cache alone.
-      std::string id;
-      source_database::getId(module_context::createAliasedPath(
-               FileInfo(path)), &id);
-      if (!id.empty())
-      {
+      if (isCacheOpen(cache, parts[0]))
          continue;
-      }
 
       std::vector<FilePath> contexts;
       error = cache.complete(kCacheVersion).children(&contexts);
@@ -135,7 +380,8 @@ void cleanUnusedCaches()
          FilePath chunkDefs = context.complete(kNotebookChunkDefFilename);
          if (!chunkDefs.exists())
             continue;
-         if ((std::time(NULL) - chunkDefs.lastWriteTime()) > kCacheAgeThresholdMs) 
+         if ((std::time(NULL) - chunkDefs.lastWriteTime()) * 1000 >
+             kCacheAgeThresholdMs)
          {
             // the cache is old and the document hasn't been opened in a while --
             // remove it.
@@ -145,6 +391,9 @@ void cleanUnusedCaches()
          }
       }
    }
+
+   // with the stale caches gone, make sure the rest fit in the budget
+   enforceCacheBudget();
 }
 
 Error notebookContentMatches(const FilePath& nbPath, const FilePath& rmdPath, 
@@ -480,6 +729,9 @@ void onDocSaved(FilePath path)
       if (error)
          LOG_ERROR(error);
    }
+
+   // share the committed outputs with identical outputs in other caches
+   storeOutputs(saved);
 }
 
 FilePath unsavedNotebookCache()
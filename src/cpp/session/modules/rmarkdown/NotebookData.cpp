@@ -27,6 +27,9 @@
 #include <r/RJson.hpp>
 
 #include <core/Exec.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/StringUtils.hpp>
 
 #include <session/SessionModuleContext.hpp>
 
@@ -68,6 +71,177 @@ void handleNotebookDataResReq(const http::Request& request,
    pResponse->setCacheableFile(pagedTableResource, request);
 }
 
+// data outputs are read from R once and stored alongside the .rdf file as a
+// table of column vectors, so pages of rows can be served without loading
+// the data frame again
+FilePath dataColumnsPath(const FilePath& dataPath)
+{
+   return dataPath.parent().complete(dataPath.stem() + kDataColumnsExt);
+}
+
+// the most recently read table; paging through an output reads it repeatedly
+FilePath s_cachedTablePath;
+std::time_t s_cachedTableTime = 0;
+json::Object s_cachedTable;
+
+std::string columnKey(const json::Value& name)
+{
+   if (name.type() == json::IntegerType)
+      return safe_convert::numberToString(name.get_int());
+   else if (name.type() == json::StringType)
+      return name.get_str();
+   return std::string();
+}
+
+// converts the row objects produced by .rs.readDataCapture into columns
+void dataColumnsFromCapture(const json::Object& capture, json::Object* pTable)
+{
+   json::Array columns;
+   json::Object::const_iterator it = capture.find("columns");
+   if (it != capture.end() && it->second.type() == json::ArrayType)
+      columns = it->second.get_array();
+
+   json::Array rows;
+   it = capture.find("data");
+   if (it != capture.end() && it->second.type() == json::ArrayType)
+      rows = it->second.get_array();
+
+   json::Array keys;
+   json::Array values;
+   BOOST_FOREACH(const json::Value& column, columns)
+   {
+      if (column.type() != json::ObjectType)
+         continue;
+      json::Object::const_iterator name = column.get_obj().find("name");
+      if (name == column.get_obj().end())
+         continue;
+      std::string key = columnKey(name->second);
+
+      json::Array vector;
+      BOOST_FOREACH(const json::Value& row, rows)
+      {
+         json::Value cell;
+         if (row.type() == json::ObjectType)
+         {
+            json::Object::const_iterator val = row.get_obj().find(key);
+            if (val != row.get_obj().end())
+               cell = val->second;
+         }
+         vector.push_back(cell);
+      }
+
+      keys.push_back(key);
+      values.push_back(vector);
+   }
+
+   (*pTable)["columns"] = columns;
+   it = capture.find("options");
+   (*pTable)["options"] = it != capture.end() ? it->second : json::Value();
+   (*pTable)["keys"] = keys;
+   (*pTable)["values"] = values;
+   (*pTable)["rows"] = static_cast<int>(rows.size());
+}
+
+Error readDataTable(const FilePath& dataPath, json::Object* pTable)
+{
+   FilePath columnsPath = dataColumnsPath(dataPath);
+   bool stale = !columnsPath.exists() ||
+                columnsPath.lastWriteTime() < dataPath.lastWriteTime();
+
+   if (!stale && columnsPath == s_cachedTablePath &&
+       columnsPath.lastWriteTime() == s_cachedTableTime)
+   {
+      *pTable = s_cachedTable;
+      return Success();
+   }
+
+   Error error;
+   if (stale)
+   {
+      SEXP captureSEXP;
+      r::sexp::Protect rProtect;
+      error = r::exec::RFunction(
+         ".rs.readDataCapture",
+         string_utils::utf8ToSystem(dataPath.absolutePath())).call(
+            &captureSEXP,
+            &rProtect);
+      if (error)
+         return error;
+
+      json::Value capture;
+      error = r::json::jsonValueFromList(captureSEXP, &capture);
+      if (error)
+         return error;
+      if (capture.type() != json::ObjectType)
+         return Error(json::errc::ParseError, ERROR_LOCATION);
+
+      dataColumnsFromCapture(capture.get_obj(), pTable);
+
+      // failing to store the table only costs us a re-read later
+      std::ostringstream oss;
+      json::write(*pTable, oss);
+      error = writeStringToFile(columnsPath, oss.str());
+      if (error)
+      {
+         LOG_ERROR(error);
+         return Success();
+      }
+   }
+   else
+   {
+      std::string contents;
+      error = readStringFromFile(columnsPath, &contents);
+      if (error)
+         return error;
+
+      json::Value table;
+      if (!json::parse(contents, &table) || table.type() != json::ObjectType)
+         return Error(json::errc::ParseError, ERROR_LOCATION);
+      *pTable = table.get_obj();
+   }
+
+   s_cachedTablePath = columnsPath;
+   s_cachedTableTime = columnsPath.lastWriteTime();
+   s_cachedTable = *pTable;
+   return Success();
+}
+
+int tableRowCount(const json::Object& table)
+{
+   json::Object::const_iterator it = table.find("rows");
+   if (it == table.end() || it->second.type() != json::IntegerType)
+      return 0;
+   return it->second.get_int();
+}
+
+void tableRows(const json::Object& table, int start, int count,
+               json::Array* pRows)
+{
+   json::Object::const_iterator keysIt = table.find("keys");
+   json::Object::const_iterator valuesIt = table.find("values");
+   if (keysIt == table.end() || keysIt->second.type() != json::ArrayType ||
+       valuesIt == table.end() || valuesIt->second.type() != json::ArrayType)
+      return;
+
+   const json::Array& keys = keysIt->second.get_array();
+   const json::Array& values = valuesIt->second.get_array();
+
+   int end = std::min(tableRowCount(table), start + count);
+   for (int row = std::max(start, 0); row < end; row++)
+   {
+      json::Object rowObject;
+      for (std::size_t col = 0; col < keys.size() && col < values.size(); col++)
+      {
+         const json::Value& vector = values[col];
+         if (vector.type() != json::ArrayType ||
+             static_cast<std::size_t>(row) >= vector.get_array().size())
+            continue;
+         rowObject[keys[col].get_str()] = vector.get_array()[row];
+      }
+      pRows->push_back(rowObject);
+   }
+}
+
 } // anonymous namespace
 
 // provide default constructor/destructor
@@ -98,6 +272,40 @@ core::Error DataCapture::connectDataCapture(
          chunkOptions).call();
 }
 
+Error readDataOutput(const FilePath& dataPath,
+                     int rows,
+                     json::Object* pOutput,
+                     int* pTotal)
+{
+   json::Object table;
+   Error error = readDataTable(dataPath, &table);
+   if (error)
+      return error;
+
+   json::Array data;
+   tableRows(table, 0, rows, &data);
+
+   (*pOutput)["columns"] = table["columns"];
+   (*pOutput)["options"] = table["options"];
+   (*pOutput)["data"] = data;
+   *pTotal = tableRowCount(table);
+   return Success();
+}
+
+Error readDataOutputRows(const FilePath& dataPath,
+                         int start,
+                         int count,
+                         json::Array* pRows)
+{
+   json::Object table;
+   Error error = readDataTable(dataPath, &table);
+   if (error)
+      return error;
+
+   tableRows(table, start, count, pRows);
+   return Success();
+}
+
 core::Error initData()
 {
    RS_REGISTER_CALL_METHOD(rs_recordData, 2);
@@ -19,6 +19,8 @@
 
 #include "NotebookCapture.hpp"
 
+#define kDataColumnsExt ".columns"
+
 namespace rstudio {
 namespace core {
    class FilePath;
@@ -44,6 +46,20 @@ private:
    void disconnect();
 };
 
+// reads a data frame output for display, including only its first rows; the
+// remaining rows (pTotal gives the number available) can be fetched as they
+// are needed with readDataOutputRows
+core::Error readDataOutput(const core::FilePath& dataPath,
+                           int rows,
+                           core::json::Object* pOutput,
+                           int* pTotal);
+
+// reads rows [start, start + count) of a data frame output, as row objects
+core::Error readDataOutputRows(const core::FilePath& dataPath,
+                               int start,
+                               int count,
+                               core::json::Array* pRows);
+
 core::Error initData();
 
 } // namespace notebook
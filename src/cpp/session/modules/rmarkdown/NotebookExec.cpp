@@ -47,6 +47,10 @@ namespace notebook {
 
 namespace {
 
+// console output is buffered in the chunk's open text output file, and
+// flushed once this much has accumulated (or when the expression completes)
+const std::size_t kConsoleTextFlushSize = 16384;
+
 FilePath getNextOutputFile(const std::string& docId, const std::string& chunkId,
    const std::string& nbCtxId, ChunkOutputType outputType, unsigned *pOrdinal)
 {
@@ -98,6 +102,7 @@ ChunkExecContext::ChunkExecContext(const std::string& docId,
    charWidth_(charWidth),
    prevCharWidth_(0),
    lastOutputType_(kChunkConsoleInput),
+   consoleTextUnflushed_(0),
    execScope_(execScope),
    hasOutput_(false),
    hasErrors_(false)
@@ -405,36 +410,69 @@ void ChunkExecContext::onConsoleText(int type, const std::string& output,
       onConsoleText(kChunkConsoleInput, input, true);
    }
 
-   // determine output filename and ensure it exists
+   // determine output filename; console text is appended to the chunk's
+   // current text output until other output (e.g. a plot) follows it
    FilePath outputCsv = chunkOutputFile(docId_, chunkId_, nbCtxId_, 
          ChunkOutputText);
-   Error error = outputCsv.ensureFile();
-   if (error)
+   if (truncate || !pConsoleText_ || outputCsv != consoleTextPath_)
    {
-      LOG_ERROR(error);
-      return;
+      closeConsoleText();
+      Error error = outputCsv.open_w(&pConsoleText_, truncate);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+      consoleTextPath_ = outputCsv;
    }
 
    std::vector<std::string> vals; 
    vals.push_back(safe_convert::numberToString(type));
    vals.push_back(output);
-   error = core::writeStringToFile(outputCsv, 
-         text::encodeCsvLine(vals) + "\n", 
-         string_utils::LineEndingPassthrough, truncate);
-   if (error)
-   {
-      LOG_ERROR(error);
-   }
+   std::string line = text::encodeCsvLine(vals) + "\n";
+   pConsoleText_->write(line.c_str(), line.size());
+   consoleTextUnflushed_ += line.size();
+   if (consoleTextUnflushed_ >= kConsoleTextFlushSize)
+      flushConsoleText();
 
    // if we got some real output, fire event for it
    if (!output.empty())
       events().onChunkConsoleOutput(docId_, chunkId_, type, output);
 }
 
+void ChunkExecContext::flushConsoleText()
+{
+   if (!pConsoleText_)
+      return;
+
+   pConsoleText_->flush();
+   consoleTextUnflushed_ = 0;
+   if (pConsoleText_->fail())
+   {
+      Error error = systemError(boost::system::errc::io_error, ERROR_LOCATION);
+      error.addProperty("path", consoleTextPath_);
+      LOG_ERROR(error);
+
+      // don't write any more to the stream; the file is reopened for the
+      // next output
+      pConsoleText_.reset();
+   }
+}
+
+void ChunkExecContext::closeConsoleText()
+{
+   flushConsoleText();
+   pConsoleText_.reset();
+   consoleTextPath_ = FilePath();
+}
+
 void ChunkExecContext::disconnect()
 {
    Error error;
 
+   // write out any buffered console output
+   closeConsoleText();
+
    // clean up capturing modules (includes plots, errors, and HTML widgets)
    BOOST_FOREACH(boost::shared_ptr<NotebookCapture> pCapture, captures_)
    {
@@ -515,6 +553,8 @@ ExecScope ChunkExecContext::execScope()
 
 void ChunkExecContext::onExprComplete()
 {
+   flushConsoleText();
+
    // notify capturing submodules
    BOOST_FOREACH(boost::shared_ptr<NotebookCapture> pCapture, captures_)
    {
@@ -76,6 +76,8 @@ private:
    void onConsoleOutput(module_context::ConsoleOutputType type, 
          const std::string& output);
    void onConsoleText(int type, const std::string& output, bool truncate);
+   void flushConsoleText();
+   void closeConsoleText();
    void onConsolePrompt(const std::string&);
    void onFileOutput(const core::FilePath& file, const core::FilePath& sidecar,
         const core::json::Value& metadata, ChunkOutputType outputType, 
@@ -89,6 +91,9 @@ private:
    std::string nbCtxId_;
    std::string pendingInput_;
    core::FilePath outputPath_;
+   core::FilePath consoleTextPath_;
+   boost::shared_ptr<std::ostream> pConsoleText_;
+   std::size_t consoleTextUnflushed_;
    core::FilePath workingDir_;
    ChunkOptions options_;
 
@@ -14,11 +14,19 @@
  */
 
 #include "SessionRmdNotebook.hpp"
+#include "NotebookCache.hpp"
 #include "NotebookHtmlWidgets.hpp"
 #include "NotebookOutput.hpp"
 
 #include <iostream>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 
@@ -30,6 +38,9 @@
 
 #include <session/SessionModuleContext.hpp>
 
+// the folder (in the cache root) holding the library store
+#define kLibraryStoreDir "libs"
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -51,23 +62,108 @@ SEXP rs_recordHtmlWidget(SEXP htmlFileSEXP, SEXP depFileSEXP, SEXP metadata)
    return R_NilValue;
 }
 
-bool copyLibFile(const FilePath& from, const FilePath& to,
-      const FilePath& path)
+#ifdef __linux__
+// make target a copy-on-write clone of source (on filesystems which support
+// reflinks, e.g. btrfs and xfs)
+bool cloneFile(const FilePath& source, const FilePath& target)
+{
+   int sourceFd = ::open(source.absolutePath().c_str(), O_RDONLY | O_CLOEXEC);
+   if (sourceFd == -1)
+      return false;
+
+   int targetFd = ::open(target.absolutePath().c_str(),
+                         O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                         0644);
+   if (targetFd == -1)
+   {
+      ::close(sourceFd);
+      return false;
+   }
+
+   bool cloned = ::ioctl(targetFd, FICLONE, sourceFd) == 0;
+   ::close(targetFd);
+   ::close(sourceFd);
+
+   if (!cloned)
+      ::unlink(target.absolutePath().c_str());
+   return cloned;
+}
+#endif
+
+// put a file from the library store into a cache's library folder: as a
+// hard link where we can, a reflink where the filesystem supports them, and
+// a copy otherwise
+Error linkLibFile(const FilePath& stored, const FilePath& target)
+{
+   Error error = stored.link(target);
+   if (!error)
+      return Success();
+
+#ifdef __linux__
+   if (cloneFile(stored, target))
+      return Success();
+#endif
+
+   return stored.copy(target);
+}
+
+bool mergeLibFile(const FilePath& sourceDep,
+                  const FilePath& storedDep,
+                  const FilePath& targetDep,
+                  const FilePath& path)
 {
-   std::string relativePath = path.relativePath(from);
-   FilePath target = to.complete(relativePath);
+   std::string relativePath = path.relativePath(sourceDep);
+   FilePath stored = storedDep.complete(relativePath);
+   FilePath target = targetDep.complete(relativePath);
 
-   if (target.exists())
-       return true;
+   Error error;
+   if (path.isDirectory())
+   {
+      error = stored.ensureDirectory();
+      if (!error)
+         error = target.ensureDirectory();
+   }
+   else if (!target.exists())
+   {
+      // first copy of the file: move it into the store
+      if (!stored.exists())
+         error = path.move(stored, FilePath::MoveCrossDevice);
+      if (!error)
+         error = linkLibFile(stored, target);
+   }
 
-   Error error = path.isDirectory() ?
-                     target.ensureDirectory() :
-                     path.copy(target);
    if (error)
       LOG_ERROR(error);
    return true;
 }
 
+// merge one dependency (a folder named for the library and its version, e.g.
+// leaflet-1.3.1) into the target library folder
+Error mergeLibDependency(const FilePath& sourceDep, const FilePath& targetLib)
+{
+   FilePath storedDep = libraryStoreRoot().complete(sourceDep.filename());
+   FilePath targetDep = targetLib.complete(sourceDep.filename());
+
+   Error error = storedDep.ensureDirectory();
+   if (!error)
+      error = targetDep.ensureDirectory();
+   if (error)
+      return error;
+
+   return sourceDep.childrenRecursive(
+         boost::bind(mergeLibFile, sourceDep, storedDep, targetDep, _2));
+}
+
+bool isLinkedLibFile(const FilePath& file, bool* pLinked)
+{
+   if (file.hardLinkCount() > 1)
+   {
+      *pLinked = true;
+      return false;
+   }
+   return true;
+}
+
 } // anonymous namespace
 
 // provide default constructor/destructor
@@ -111,17 +207,76 @@ core::Error initHtmlWidgets()
    return initBlock.execute();
 }
 
+FilePath libraryStoreRoot()
+{
+   return notebookCacheRoot().complete(kLibraryStoreDir);
+}
+
+// html widget dependencies are written by each widget output, and are
+// frequently the same few (large) libraries. each library is stored once (per
+// name and version) in the library store, and the library folder of each
+// cache holds links to (or clones or copies of) the stored files
 core::Error mergeLib(const core::FilePath& source, 
                      const core::FilePath& target)
 {
-   Error error = source.childrenRecursive(
-         boost::bind(copyLibFile, source, target, _2));
+   std::vector<FilePath> dependencies;
+   Error error = source.children(&dependencies);
+   if (error)
+      return error;
 
-   if (error) return error;
+   error = target.ensureDirectory();
+   if (error)
+      return error;
+
+   BOOST_FOREACH(const FilePath& dependency, dependencies)
+   {
+      if (dependency.isDirectory())
+      {
+         error = mergeLibDependency(dependency, target);
+      }
+      else if (!target.complete(dependency.filename()).exists())
+      {
+         // (not expected; dependencies are all folders)
+         error = dependency.copy(target.complete(dependency.filename()));
+      }
+
+      if (error)
+         LOG_ERROR(error);
+   }
 
    return source.remove();
 }
 
+void pruneLibraryStore()
+{
+   std::vector<FilePath> dependencies;
+   Error error = libraryStoreRoot().children(&dependencies);
+   if (error)
+      return;
+
+   BOOST_FOREACH(const FilePath& dependency, dependencies)
+   {
+      // remove libraries none of whose files are linked from a cache (note
+      // that libraries copied rather than linked into caches are never in
+      // use by this measure, but those caches have their own copies)
+      bool used = false;
+      error = dependency.childrenRecursive(
+            boost::bind(isLinkedLibFile, _2, &used));
+      if (error)
+      {
+         LOG_ERROR(error);
+         continue;
+      }
+
+      if (!used)
+      {
+         error = dependency.remove();
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+}
+
 } // namespace notebook
 } // namespace rmarkdown
 } // namespace modules
@@ -50,6 +50,12 @@ core::Error initHtmlWidgets();
 core::Error mergeLib(const core::FilePath& source, 
                      const core::FilePath& target);
 
+// the store of html widget dependency libraries shared by the caches
+core::FilePath libraryStoreRoot();
+
+// remove stored libraries which are no longer used by any cache
+void pruneLibraryStore();
+
 } // namespace notebook
 } // namespace rmarkdown
 } // namespace modules
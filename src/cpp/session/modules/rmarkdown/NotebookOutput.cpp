@@ -15,6 +15,7 @@
 
 #include "SessionRmdNotebook.hpp"
 #include "NotebookCache.hpp"
+#include "NotebookData.hpp"
 #include "NotebookOutput.hpp"
 #include "NotebookPlots.hpp"
 
@@ -49,6 +50,9 @@
 #define MAX_ORDINAL        16777215
 #define OUTPUT_THRESHOLD   25
 
+// the number of rows of each data frame output sent with the document
+#define kDataOutputFirstRows 100
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -181,24 +185,21 @@ Error fillOutputObject(const std::string& docId, const std::string& chunkId,
    }
    else if (outputType == ChunkOutputData)
    {
-      SEXP argsSEXP;
-      r::sexp::Protect rProtect;
-
-      Error error = r::exec::RFunction(
-         ".rs.readDataCapture",
-         string_utils::utf8ToSystem(path.absolutePath())).call(
-            &argsSEXP,
-            &rProtect);
-
+      // send only the first page of rows with the document; the client
+      // requests the rest from the output's URL as they're displayed
+      json::Object data;
+      int total = 0;
+      Error error = readDataOutput(path, kDataOutputFirstRows, &data, &total);
       if (error)
          return error;
 
-      json::Value valJson;
-      error = r::json::jsonValueFromList(argsSEXP, &valJson);
-      if (error)
-         return error;
+      json::Object paging;
+      paging["url"] = kChunkOutputPath "/" + nbCtxId + "/" + docId + "/" +
+                      chunkId + "/" + path.filename();
+      paging["total"] = total;
+      data["paging"] = paging;
 
-      (*pObj)[kChunkOutputValue] = valJson;
+      (*pObj)[kChunkOutputValue] = data;
    }
 
    return Success();
@@ -300,6 +301,33 @@ Error handleChunkOutputRequest(const http::Request& request,
       return Success();
    }
 
+   // a page of rows from a data frame output
+   if (target.hasExtensionLowerCase(".rdf") &&
+       !request.queryParamValue("start").empty())
+   {
+      int start = safe_convert::stringTo<int>(
+            request.queryParamValue("start"), 0);
+      int count = safe_convert::stringTo<int>(
+            request.queryParamValue("count"), kDataOutputFirstRows);
+
+      json::Array rows;
+      Error error = readDataOutputRows(target, start, count, &rows);
+      if (error)
+      {
+         LOG_ERROR(error);
+         pResponse->setError(http::status::InternalServerError,
+                             error.summary());
+         return Success();
+      }
+
+      std::ostringstream oss;
+      json::write(rows, oss);
+      pResponse->setNoCacheHeaders();
+      pResponse->setContentType("application/json");
+      pResponse->setBody(oss.str());
+      return Success();
+   }
+
    bool isHtml = target.hasExtensionLowerCase(".htm") ||
                  target.hasExtensionLowerCase(".html");
 
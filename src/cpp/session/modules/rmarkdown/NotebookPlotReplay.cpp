@@ -22,6 +22,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <core/StringUtils.hpp>
 #include <core/Exec.hpp>
@@ -45,17 +46,47 @@ namespace notebook {
 
 namespace {
 
-// this class supervises an asynchronous replay of all of a notebook's 
+// the maximum number of R processes a notebook's plots are replayed in, and
+// the minimum number of plots given to each (starting an R process isn't
+// free, so a handful of plots are replayed in a single process)
+const std::size_t kMaxReplayWorkers = 4;
+const std::size_t kMinSnapshotsPerWorker = 4;
+
+// the state shared by the processes replaying the plots for a single replay
+// request; the client is notified when all of them have completed
+struct ReplayGroup
+{
+   ReplayGroup(const std::string& docId,
+               const std::string& replayId,
+               int width,
+               bool persistOutput)
+      : docId(docId), replayId(replayId), width(width),
+        persistOutput(persistOutput), pending(0), failed(false),
+        cancelled(false)
+   {
+   }
+
+   std::string docId;
+   std::string replayId;
+   int width;
+   bool persistOutput;
+
+   std::size_t pending;
+   bool failed;
+
+   // set when the replay has been superseded by another request; the
+   // processes are terminated and no further events are sent for it
+   bool cancelled;
+};
+
+// this class supervises an asynchronous replay of (a share of) a notebook's 
 // plot display lists
 class ReplayPlots : public async_r::AsyncRProcess
 {
 public:
    static boost::shared_ptr<ReplayPlots> create(
-         const std::string& docId, 
-         const std::string& replayId,
-         int width,
+         boost::shared_ptr<ReplayGroup> pGroup,
          int height,
-         bool persistOutput,
          const std::vector<FilePath>& snapshotFiles)
    {
       // create the text to send to the process (it'll be read on stdin
@@ -85,21 +116,18 @@ public:
 
       // form command to pass to R 
       std::string cmd(".rs.replayNotebookPlots(" + 
-                      safe_convert::numberToString(width) + ", " + 
+                      safe_convert::numberToString(pGroup->width) + ", " + 
                       safe_convert::numberToString(height) + ", " + 
                       safe_convert::numberToString(
                          r::session::graphics::device::devicePixelRatio()) +
                       ", " +
-                      (persistOutput ? "FALSE" : "TRUE") +
+                      (pGroup->persistOutput ? "FALSE" : "TRUE") +
                       ", " +
                       "'" + extraParams + "')");
 
       // invoke the asynchronous process
       boost::shared_ptr<ReplayPlots> pReplayer(new ReplayPlots());
-      pReplayer->docId_ = docId;
-      pReplayer->replayId_ = replayId;
-      pReplayer->width_ = width;
-      pReplayer->persistOutput_ = persistOutput;
+      pReplayer->pGroup_ = pGroup;
       pReplayer->start(cmd.c_str(), FilePath(),
                        async_r::R_PROCESS_VANILLA,
                        sources,
@@ -110,9 +138,16 @@ public:
 private:
    void onStdout(const std::string& output)
    {
+      // don't emit plots for a superseded replay
+      if (pGroup_->cancelled)
+         return;
+
       r::sexp::Protect protect;
       Error error;
 
+      const std::string& docId = pGroup_->docId;
+      bool persistOutput = pGroup_->persistOutput;
+
       // output is queued/buffered so multiple paths may be emitted
       std::vector<std::string> paths;
       boost::algorithm::split(paths, output,
@@ -125,22 +160,22 @@ private:
             continue;
 
          FilePath chunkBase = png;
-         if (!persistOutput_) chunkBase = png.parent();
+         if (!persistOutput) chunkBase = png.parent();
 
          // create the event and send to the client. consider: this makes some
          // assumptions about the way output URLs are formed and some
          // assumptions about cache structure that might be better localized.
          json::Object result;
          result["chunk_id"] = chunkBase.parent().filename();
-         result["doc_id"] = docId_;
-         result["replay_id"] = replayId_;
+         result["doc_id"] = docId;
+         result["replay_id"] = pGroup_->replayId;
 
          result["plot_url"] = kChunkOutputPath "/" + 
             chunkBase.parent().parent().filename() + "/" + // context ID = folder name
-            docId_ + "/" + 
+            docId + "/" + 
             chunkBase.parent().filename() + 
             "/" + 
-            (persistOutput_ ? "" : png.parent().filename() + "/") +
+            (persistOutput ? "" : png.parent().filename() + "/") +
             png.filename();
 
          ClientEvent event(client_events::kChunkPlotRefreshed, result);
@@ -150,31 +185,80 @@ private:
 
    void onCompleted(int exitStatus)
    {
-      // let client know the process is completed (even if it failed)
+      if (pGroup_->cancelled)
+         return;
+
+      if (exitStatus != EXIT_SUCCESS)
+         pGroup_->failed = true;
+
+      // wait for the other processes in the replay
+      if (--pGroup_->pending > 0)
+         return;
+
+      // let client know the replay is completed (even if it failed)
       json::Object result;
-      result["doc_id"] = docId_;
-      result["width"] = width_;
-      result["replay_id"] = replayId_;
+      result["doc_id"] = pGroup_->docId;
+      result["width"] = pGroup_->width;
+      result["replay_id"] = pGroup_->replayId;
       module_context::enqueClientEvent(ClientEvent(
                client_events::kChunkPlotRefreshFinished, result));
 
       // if we succeeded, write the new rendered width into the notebook chunk
       // file
-      if (exitStatus == EXIT_SUCCESS && persistOutput_)
+      if (!pGroup_->failed && pGroup_->persistOutput)
       {
          std::string docPath;
-         source_database::getPath(docId_, &docPath);
-         setChunkValue(docPath, docId_, "chunk_rendered_width", width_);
+         source_database::getPath(pGroup_->docId, &docPath);
+         setChunkValue(docPath, pGroup_->docId, "chunk_rendered_width",
+                       pGroup_->width);
       }
    }
 
-   std::string docId_;
-   std::string replayId_;
-   bool persistOutput_;
-   int width_;
+   boost::shared_ptr<ReplayGroup> pGroup_;
 };
 
-boost::shared_ptr<ReplayPlots> s_pPlotReplayer;
+typedef std::vector<boost::shared_ptr<ReplayPlots> > ReplayPlotsList;
+
+// replays the snapshots (in priority order) across as many processes as are
+// worthwhile; each process is given every n'th snapshot so that they all
+// start with the snapshots of highest priority
+ReplayPlotsList replayPlots(boost::shared_ptr<ReplayGroup> pGroup,
+                            int height,
+                            const std::vector<FilePath>& snapshotFiles,
+                            std::size_t maxWorkers)
+{
+   std::size_t workers = (snapshotFiles.size() + kMinSnapshotsPerWorker - 1) /
+                         kMinSnapshotsPerWorker;
+   workers = std::max<std::size_t>(1, std::min(workers, maxWorkers));
+
+   std::vector<std::vector<FilePath> > shares(workers);
+   for (std::size_t i = 0; i < snapshotFiles.size(); i++)
+      shares[i % workers].push_back(snapshotFiles[i]);
+
+   // all processes must be counted before any is started, as a process which
+   // fails to start completes immediately
+   pGroup->pending = workers;
+
+   ReplayPlotsList replayers;
+   BOOST_FOREACH(const std::vector<FilePath>& share, shares)
+   {
+      replayers.push_back(ReplayPlots::create(pGroup, height, share));
+   }
+   return replayers;
+}
+
+bool isReplaying(const ReplayPlotsList& replayers)
+{
+   BOOST_FOREACH(const boost::shared_ptr<ReplayPlots>& pReplayer, replayers)
+   {
+      if (pReplayer->isRunning())
+         return true;
+   }
+   return false;
+}
+
+boost::shared_ptr<ReplayGroup> s_pPlotReplayGroup;
+ReplayPlotsList s_plotReplayers;
 
 typedef std::map<std::string, boost::shared_ptr<ReplayPlots> > ReplayPlotsMap;
 ReplayPlotsMap s_pPlotReplayerForChunkId;
@@ -192,12 +276,23 @@ Error replayPlotOutput(const json::JsonRpcRequest& request,
    if (error)
       return error;
 
-   // do nothing if we're already replaying plots (consider: maybe better to
-   // abort and restart with the new pixel width?)
-   if (s_pPlotReplayer && s_pPlotReplayer->isRunning())
+   if (isReplaying(s_plotReplayers))
    {
-      pResponse->setResult("");
-      return Success();
+      // do nothing if we're replaying the plots of another notebook (the
+      // client will ask again on its next resize)
+      if (s_pPlotReplayGroup->docId != docId)
+      {
+         pResponse->setResult("");
+         return Success();
+      }
+
+      // otherwise the replay in progress is stale; abandon it in favor of 
+      // this one
+      s_pPlotReplayGroup->cancelled = true;
+      BOOST_FOREACH(boost::shared_ptr<ReplayPlots>& pReplayer, s_plotReplayers)
+      {
+         pReplayer->terminate();
+      }
    }
 
    // extract the list of chunks to replay
@@ -212,14 +307,16 @@ Error replayPlotOutput(const json::JsonRpcRequest& request,
    std::vector<std::string> chunkIds;
    extractChunkIds(chunkIdVals, &chunkIds);
 
-   // shuffle the chunk IDs so we re-render the visible ones first
+   // shuffle the chunk IDs so we re-render the visible ones first, followed
+   // by the ones above them (nearest first)
    std::vector<std::string>::iterator it = std::find(
          chunkIds.begin(), chunkIds.end(), initialChunkId);
    if (it != chunkIds.end())
    {
       std::vector<std::string> shuffledChunkIds;
       std::copy(it, chunkIds.end(), std::back_inserter(shuffledChunkIds));
-      std::copy(chunkIds.begin(), it, std::back_inserter(shuffledChunkIds));
+      std::reverse_copy(chunkIds.begin(), it, 
+                        std::back_inserter(shuffledChunkIds));
       chunkIds = shuffledChunkIds;
    }
 
@@ -248,7 +345,13 @@ Error replayPlotOutput(const json::JsonRpcRequest& request,
       }
    }
 
-   s_pPlotReplayer = ReplayPlots::create(docId, replayId, pixelWidth, pixelHeight, true, snapshotFiles);
+   std::size_t maxWorkers = std::min<std::size_t>(
+            kMaxReplayWorkers,
+            std::max(1u, boost::thread::hardware_concurrency()));
+   s_pPlotReplayGroup.reset(
+            new ReplayGroup(docId, replayId, pixelWidth, true));
+   s_plotReplayers = replayPlots(s_pPlotReplayGroup, pixelHeight,
+                                 snapshotFiles, maxWorkers);
    pResponse->setResult(replayId);
 
    return Success();
@@ -309,7 +412,11 @@ Error replayChunkPlotOutput(const json::JsonRpcRequest& request,
          snapshotFiles.push_back(content);
    }
 
-   s_pPlotReplayerForChunkId[docId + chunkId] = ReplayPlots::create(docId, replayId, pixelWidth, pixelHeight, false, snapshotFiles);
+   boost::shared_ptr<ReplayGroup> pGroup(
+            new ReplayGroup(docId, replayId, pixelWidth, false));
+   pGroup->pending = 1;
+   s_pPlotReplayerForChunkId[docId + chunkId] = 
+            ReplayPlots::create(pGroup, pixelHeight, snapshotFiles);
    pResponse->setResult(replayId);
 
    return Success();
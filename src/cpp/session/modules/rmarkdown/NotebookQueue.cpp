@@ -30,12 +30,15 @@
 #include "NotebookAlternateEngines.hpp"
 #include "NotebookChunkOptions.hpp"
 
+#include <algorithm>
+
 #include <boost/foreach.hpp>
 
 #include <r/RCntxtUtils.hpp>
 #include <r/RInterface.hpp>
 #include <r/RExec.hpp>
 #include <r/RJson.hpp>
+#include <r/ROptions.hpp>
 #include <r/RSexp.hpp>
 
 #include <core/Exec.hpp>
@@ -64,6 +67,39 @@ enum ChunkExecState
    ChunkExecCancelled = 2
 };
 
+// a chunk running in a child process alongside the rest of the queue
+struct ConcurrentUnit
+{
+   ConcurrentUnit(boost::shared_ptr<NotebookQueueUnit> pUnit,
+                  const std::string& engine,
+                  const std::string& label)
+      : pUnit(pUnit), engine(engine), label(label)
+   {
+   }
+
+   boost::shared_ptr<NotebookQueueUnit> pUnit;
+   std::string engine;
+   std::string label;
+};
+
+// when options(rstudio.notebook.concurrentEngines = TRUE) is set, chunks for
+// engines that run in a child process (bash, etc.) don't hold up the queue:
+// they're started and the queue moves on to the next chunk. R chunks (and
+// engines evaluated in R, such as SQL) still run one at a time
+bool concurrentEnginesEnabled()
+{
+   return r::options::getOption<bool>("rstudio.notebook.concurrentEngines",
+                                      false, false);
+}
+
+std::string normalizedEngine(const ChunkOptions& options)
+{
+   // if the chunk doesn't have an engine specified it will receive the knitr
+   // default of "R"
+   std::string engine = options.getOverlayOption("engine", std::string("r"));
+   return engine == "R" ? "r" : engine;
+}
+
 // represents the global queue of work 
 class NotebookQueue : boost::noncopyable
 {
@@ -95,7 +131,7 @@ public:
 
    bool complete()
    {
-      return queue_.empty();
+      return queue_.empty() && concurrentUnits_.empty();
    }
 
    Error process(ExpressionMode mode)
@@ -205,6 +241,14 @@ public:
       if (execUnit_)
          execUnit_.reset();
 
+      // stop any chunks running alongside the queue
+      BOOST_FOREACH(const ConcurrentUnit& concurrent, concurrentUnits_)
+      {
+         interruptAlternateEngineChunk(concurrent.pUnit->docId(),
+                                       concurrent.pUnit->chunkId());
+      }
+      concurrentUnits_.clear();
+
       // remove all document queues
       queue_.clear();
    }
@@ -232,6 +276,25 @@ private:
    void onChunkExecCompleted(const std::string& docId, 
          const std::string& chunkId, const std::string& nbCtxId)
    {
+      // check for a chunk which was running alongside the queue
+      for (std::vector<ConcurrentUnit>::iterator it = concurrentUnits_.begin();
+           it != concurrentUnits_.end();
+           ++it)
+      {
+         if (it->pUnit->docId() == docId && it->pUnit->chunkId() == chunkId)
+         {
+            boost::shared_ptr<NotebookQueueUnit> pUnit = it->pUnit;
+            concurrentUnits_.erase(it);
+            enqueueExecStateChanged(pUnit, ChunkExecFinished, json::Object());
+
+            // if the queue was waiting on this chunk, resume it (when an R
+            // chunk is executing, the console prompt drives the queue)
+            if (!execUnit_)
+               process(ExprModeNew);
+            return;
+         }
+      }
+
       if (!execUnit_)
          return;
 
@@ -355,6 +418,11 @@ private:
          LOG_ERROR(error);
       ChunkOptions options(docQueue->defaultChunkOptions(), chunkOptions);
 
+      // if the unit depends on a chunk that is still running alongside the
+      // queue, wait for it to finish (we'll resume when it does)
+      if (dependsOnConcurrentUnit(options))
+         return Success();
+
       // establish execution context for the unit
 
       // in batch mode, make sure unit should be evaluated -- note that
@@ -394,12 +462,7 @@ private:
       }
 
       // compute engine
-      std::string engine = options.getOverlayOption("engine", std::string("r"));
-
-      // normalize engine case - if the chunk doesn't have an engine specified
-      // it will receive the knitr default of "R"
-      if (engine == "R")
-         engine = "r";
+      std::string engine = normalizedEngine(options);
 
       if (engine == "r")
       {
@@ -423,6 +486,34 @@ private:
          execUnit_ = unit;
          enqueueExecStateChanged(ChunkExecStarted, options.chunkOptions());
       }
+      else if (unit->execScope() == ExecScopeChunk &&
+               concurrentEnginesEnabled() &&
+               isProcessEngine(engine))
+      {
+         // start the chunk in its child process and move on to the next unit
+         std::string innerCode;
+         error = unit->innerCode(&innerCode);
+         if (error)
+         {
+            LOG_ERROR(error);
+         }
+         else
+         {
+            popUnit(unit);
+            concurrentUnits_.push_back(ConcurrentUnit(unit, engine, label));
+            enqueueExecStateChanged(unit, ChunkExecStarted,
+                                    options.chunkOptions());
+
+            Error execError = executeAlternateEngineChunk(
+               unit->docId(), unit->chunkId(), ctx, docQueue->workingDir(),
+               engine, innerCode, options, unit->execScope(),
+               docQueue->pixelWidth(), docQueue->charWidth());
+            if (execError)
+               LOG_ERROR(execError);
+
+            return executeNextUnit(mode);
+         }
+      }
       else
       {
          // execute with alternate engine
@@ -490,12 +581,59 @@ private:
       }
    }
 
+   // whether the given chunk must wait for a chunk running alongside the
+   // queue: chunks for the same engine run in order, and chunks wait for any
+   // running chunk they name in their 'dependson' option
+   bool dependsOnConcurrentUnit(const ChunkOptions& options)
+   {
+      if (concurrentUnits_.empty())
+         return false;
+
+      std::vector<std::string> dependsOn;
+      json::Object merged = options.mergedOptions();
+      json::Object::const_iterator it = merged.find("dependson");
+      if (it != merged.end())
+      {
+         if (it->second.type() == json::StringType)
+         {
+            dependsOn.push_back(it->second.get_str());
+         }
+         else if (it->second.type() == json::ArrayType)
+         {
+            BOOST_FOREACH(const json::Value& label, it->second.get_array())
+            {
+               if (label.type() == json::StringType)
+                  dependsOn.push_back(label.get_str());
+            }
+         }
+      }
+
+      std::string engine = normalizedEngine(options);
+      BOOST_FOREACH(const ConcurrentUnit& concurrent, concurrentUnits_)
+      {
+         if (concurrent.engine == engine)
+            return true;
+         if (!concurrent.label.empty() &&
+             std::find(dependsOn.begin(), dependsOn.end(), concurrent.label) !=
+             dependsOn.end())
+            return true;
+      }
+
+      return false;
+   }
+
    void enqueueExecStateChanged(ChunkExecState state, 
          const json::Object& options)
+   {
+      enqueueExecStateChanged(execUnit_, state, options);
+   }
+
+   void enqueueExecStateChanged(boost::shared_ptr<NotebookQueueUnit> pUnit,
+         ChunkExecState state, const json::Object& options)
    {
       json::Object event;
-      event["doc_id"]     = execUnit_->docId();
-      event["chunk_id"]   = execUnit_->chunkId();
+      event["doc_id"]     = pUnit->docId();
+      event["chunk_id"]   = pUnit->chunkId();
       event["exec_state"] = state;
       event["options"]    = options;
       module_context::enqueClientEvent(ClientEvent(
@@ -651,6 +789,9 @@ private:
    boost::shared_ptr<NotebookQueueUnit> execUnit_;
    boost::shared_ptr<ChunkExecContext> execContext_;
 
+   // chunks running in child processes alongside the queue
+   std::vector<ConcurrentUnit> concurrentUnits_;
+
    // registered signal handlers
    std::vector<boost::signals::connection> handlers_;
 
@@ -13,6 +13,10 @@
  *
  */
 
+#include <map>
+#include <set>
+
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/foreach.hpp>
 
 #include "RMarkdownTemplates.hpp"
@@ -30,6 +34,8 @@
 #include <session/SessionPackageProvidedExtension.hpp>
 #include <session/SessionModuleContext.hpp>
 
+#include "../SessionLibPathsIndexer.hpp"
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -39,7 +45,22 @@ namespace rmarkdown {
 namespace templates {
 namespace {
 
-json::Array s_templates;
+// the templates found in a package, along with the signature the package
+// had when they were found (templates are only looked for again once the
+// package is reinstalled)
+struct PackageTemplates
+{
+   std::string signature;
+   json::Array templates;
+};
+
+// templates by package path
+std::map<std::string, PackageTemplates> s_packageTemplates;
+
+// package paths in library path order, as of the last completed indexing
+// pass (the templates of the last pass are served while indexing is
+// under way)
+std::vector<std::string> s_packagePaths;
 
 // This class is responsible for discovering R Markdown document templates in
 // all installed packages. It works by crawling the installed package base
@@ -49,11 +70,31 @@ class Worker : public ppe::Worker
 {
    void onIndexingStarted()
    {
-      s_templates.clear();
+      signatures_.clear();
+      BOOST_FOREACH(const libpaths::InstalledPackage& package,
+                    libpaths::installedPackages())
+      {
+         signatures_[package.path.absolutePath()] = package.signature;
+      }
+      packagePaths_.clear();
    }
    
    void onWork(const std::string& pkgName, const FilePath& pkgPath)
    {
+      std::string path = pkgPath.absolutePath();
+      packagePaths_.push_back(path);
+
+      // nothing to do if the package hasn't changed since it was last seen
+      std::string signature = signatures_[path];
+      std::map<std::string, PackageTemplates>::const_iterator it =
+                                                s_packageTemplates.find(path);
+      if (it != s_packageTemplates.end() && it->second.signature == signature)
+         return;
+
+      PackageTemplates& packageTemplates = s_packageTemplates[path];
+      packageTemplates.signature = signature;
+      packageTemplates.templates.clear();
+
       // form the path to the template folder
       FilePath templateRoot = pkgPath.complete("rmarkdown")
                                      .complete("templates");
@@ -78,45 +119,71 @@ class Worker : public ppe::Worker
          if (!templateDir.isDirectory())
             continue;
 
-         discoverTemplate(pkgName, templateDir);
+         discoverTemplate(pkgName, templateDir, &packageTemplates.templates);
       }
    }
 
    void discoverTemplate(const std::string& pkgName, 
-         const FilePath& templateDir)
+                         const FilePath& templateDir,
+                         json::Array* pTemplates)
    {
-      json::Object dataJson;
-
-      std::string templateYaml;
-      bool multiFile;
+      // check for required files (a template without them isn't
+      // well-formed)
+      FilePath templateYaml = templateDir.complete("template.yaml");
+      if (!templateYaml.exists())
+      {
+         templateYaml = templateDir.complete("template.yml");
+         if (!templateYaml.exists())
+            return;
+      }
 
-      SEXP templateFile;
-      r::sexp::Protect protect;
-      Error error = r::exec::RFunction(
-         ".rs.getTemplateYamlFile", 
-           string_utils::utf8ToSystem(templateDir.absolutePath()))
-         .call(&templateFile, &protect);
+      FilePath skeletonPath = templateDir.complete("skeleton");
+      if (!skeletonPath.complete("skeleton.Rmd").exists())
+         return;
 
-      // .rs.getTemplateDetails may return null if the template is not
-      // well-formed
-      if (error || TYPEOF(templateFile) == NILSXP)
+      // will need to enforce create_dir if there are multiple files in
+      // the skeleton folder (hidden files aside)
+      std::vector<FilePath> skeletonFiles;
+      Error error = skeletonPath.children(&skeletonFiles);
+      if (error)
+      {
+         LOG_ERROR(error);
          return;
+      }
 
-      r::sexp::getNamedListElement(templateFile,
-                                   "template_yaml", &templateYaml);
-      r::sexp::getNamedListElement(templateFile,
-                                   "multi_file", &multiFile);
+      int fileCount = 0;
+      BOOST_FOREACH(const FilePath& skeletonFile, skeletonFiles)
+      {
+         if (!boost::algorithm::starts_with(skeletonFile.filename(), "."))
+            fileCount++;
+      }
 
+      // record metadata; we won't parse the template until the client
+      // requests templates
+      json::Object dataJson;
       dataJson["package_name"] = pkgName;
       dataJson["path"] = templateDir.absolutePath();
-      dataJson["template_yaml"] = templateYaml;
-      dataJson["multi_file"] = multiFile;
+      dataJson["template_yaml"] = templateYaml.absolutePath();
+      dataJson["multi_file"] = fileCount > 1;
 
-      s_templates.push_back(dataJson);
+      pTemplates->push_back(dataJson);
    }
    
    void onIndexingCompleted(json::Object* pPayload)
    {
+      // forget packages which are no longer installed
+      std::set<std::string> seen(packagePaths_.begin(), packagePaths_.end());
+      for (std::map<std::string, PackageTemplates>::iterator it =
+              s_packageTemplates.begin();
+           it != s_packageTemplates.end(); )
+      {
+         if (seen.count(it->first))
+            ++it;
+         else
+            s_packageTemplates.erase(it++);
+      }
+
+      s_packagePaths = packagePaths_;
    }
    
 public:
@@ -124,6 +191,10 @@ public:
    Worker() : ppe::Worker() 
    {
    }
+
+private:
+   std::map<std::string, std::string> signatures_;
+   std::vector<std::string> packagePaths_;
 };
 
 Error getRmdTemplates(const json::JsonRpcRequest&,
@@ -131,58 +202,67 @@ Error getRmdTemplates(const json::JsonRpcRequest&,
 {
    Error error;
    json::Array result;
-   for (auto &it: s_templates)
+   BOOST_FOREACH(const std::string& packagePath, s_packagePaths)
    {
-      // skip if not an object type
-      if (it.type() != json::ObjectType)
+      std::map<std::string, PackageTemplates>::iterator pkgIt =
+                                       s_packageTemplates.find(packagePath);
+      if (pkgIt == s_packageTemplates.end())
          continue;
 
-      // if we already know this template's name, no need to re-parse
-      json::Object& item = it.get_obj();
-      if (item.find("name") != item.end())
+      for (auto &it: pkgIt->second.templates)
       {
-         result.push_back(item);
-         continue;
-      }
+         // skip if not an object type
+         if (it.type() != json::ObjectType)
+            continue;
 
-      // read filename and directory info
-      bool multiFile = false;
-      std::string templateYaml;
-      error = json::readObject(item, 
-            "multi_file",    &multiFile,
-            "template_yaml", &templateYaml);
-      if (error)
-         continue;
+         // if we already know this template's name, no need to re-parse
+         // (parsed details are kept until the package is reinstalled)
+         json::Object& item = it.get_obj();
+         if (item.find("name") != item.end())
+         {
+            result.push_back(item);
+            continue;
+         }
+
+         // read filename and directory info
+         bool multiFile = false;
+         std::string templateYaml;
+         error = json::readObject(item, 
+               "multi_file",    &multiFile,
+               "template_yaml", &templateYaml);
+         if (error)
+            continue;
 
-      // read template details
-      SEXP templateDetails;
-      r::sexp::Protect protect;
-      error = r::exec::RFunction(
-         ".rs.getTemplateDetails", string_utils::utf8ToSystem(templateYaml))
-         .call(&templateDetails, &protect);
-      if (error)
-         continue;
+         // read template details
+         SEXP templateDetails;
+         r::sexp::Protect protect;
+         error = r::exec::RFunction(
+            ".rs.getTemplateDetails", string_utils::utf8ToSystem(templateYaml))
+            .call(&templateDetails, &protect);
+         if (error)
+            continue;
 
-      // load template name/description
-      std::string name;
-      std::string description;
-      bool createDirFlag;
-      r::sexp::getNamedListElement(templateDetails,
-                                   "name", &name);
-      r::sexp::getNamedListElement(templateDetails,
-                                   "description", &description);
-      r::sexp::getNamedListElement(templateDetails,
-                                   "create_dir", &createDirFlag);
-
-      // append to metadata already known
-      item["name"] = name;
-      item["description"] = description;
-
-      // force directory creation if multi file
-      item["create_dir"] = (createDirFlag || multiFile) ? "true" : "false";
-
-      // save result to be delivered to client
-      result.push_back(item);
+         // load template name/description
+         std::string name;
+         std::string description;
+         bool createDirFlag;
+         r::sexp::getNamedListElement(templateDetails,
+                                      "name", &name);
+         r::sexp::getNamedListElement(templateDetails,
+                                      "description", &description);
+         r::sexp::getNamedListElement(templateDetails,
+                                      "create_dir", &createDirFlag);
+
+         // append to metadata already known
+         item["name"] = name;
+         item["description"] = description;
+
+         // force directory creation if multi file
+         item["create_dir"] = (createDirFlag || multiFile) ? "true" : "false";
+
+         // save result to be delivered to client
+         result.push_back(item);
+      }
    }
    pResponse->setResult(result);
    return Success();
@@ -266,6 +266,11 @@ void getOutputFormat(const std::string& path,
 }
 
 
+class RenderRmd;
+
+// a render process started ahead of time, waiting for its render command
+boost::shared_ptr<RenderRmd> s_pWarmRender_;
+
 class RenderRmd : public async_r::AsyncRProcess
 {
 public:
@@ -281,15 +286,34 @@ public:
                                               const std::string& workingDir,
                                               const std::string& viewerType)
    {
-      boost::shared_ptr<RenderRmd> pRender(new RenderRmd(targetFile,
-                                                         sourceLine,
-                                                         sourceNavigation,
-                                                         asShiny));
+      boost::shared_ptr<RenderRmd> pRender;
+      if (existingOutputFile.empty())
+         pRender = takeWarmRender();
+
+      if (pRender)
+         pRender->claim(targetFile, sourceLine, sourceNavigation, asShiny);
+      else
+         pRender.reset(new RenderRmd(targetFile,
+                                     sourceLine,
+                                     sourceNavigation,
+                                     asShiny));
+
       pRender->start(format, encoding, paramsFile, asTempfile, 
                      existingOutputFile, workingDir, viewerType);
       return pRender;
    }
 
+   // start a process (with rmarkdown and knitr loaded) to take the next
+   // render, so that it doesn't have to wait for R to start up
+   static void prepareWarmRender()
+   {
+      if (s_pWarmRender_ && s_pWarmRender_->isRunning())
+         return;
+
+      s_pWarmRender_.reset(new RenderRmd());
+      s_pWarmRender_->startWarm();
+   }
+
    void terminateProcess(RenderTerminateType terminateType)
    {
       terminateType_ = terminateType;
@@ -340,9 +364,84 @@ private:
       hasShinyContent_(false),
       targetFile_(targetFile),
       sourceLine_(sourceLine),
-      sourceNavigation_(sourceNavigation)
+      sourceNavigation_(sourceNavigation),
+      isWarm_(false)
+   {}
+
+   // a warm process, which has no document until it is claimed
+   RenderRmd() :
+      terminateType_(renderTerminateQuiet),
+      isShiny_(false),
+      hasShinyContent_(false),
+      sourceLine_(-1),
+      sourceNavigation_(false),
+      isWarm_(true)
    {}
 
+   static boost::shared_ptr<RenderRmd> takeWarmRender()
+   {
+      boost::shared_ptr<RenderRmd> pRender = s_pWarmRender_;
+      s_pWarmRender_.reset();
+      if (!pRender || !pRender->isRunning())
+         return boost::shared_ptr<RenderRmd>();
+
+      // the warm process is only good for renders it could have been
+      // started for
+      if (!userSettings().rmdRenderCache() ||
+          pRender->libPaths_ != module_context::libPathsString())
+      {
+         pRender->terminateProcess(renderTerminateQuiet);
+         return boost::shared_ptr<RenderRmd>();
+      }
+
+      return pRender;
+   }
+
+   void claim(const FilePath& targetFile, int sourceLine,
+              bool sourceNavigation, bool asShiny)
+   {
+      terminateType_ = renderTerminateAbnormal;
+      isShiny_ = asShiny;
+      targetFile_ = targetFile;
+      sourceLine_ = sourceLine;
+      sourceNavigation_ = sourceNavigation;
+      isWarm_ = false;
+   }
+
+   core::system::Options renderEnvironment()
+   {
+      core::system::Options environment;
+      std::string tempDir;
+      Error error = r::exec::RFunction("tempdir").call(&tempDir);
+      if (!error)
+         environment.push_back(std::make_pair("RMARKDOWN_PREVIEW_DIR", tempDir));
+      else
+         LOG_ERROR(error);
+
+      // pass along the RSTUDIO_VERSION
+      environment.push_back(std::make_pair("RSTUDIO_VERSION", RSTUDIO_VERSION));
+
+      // set the not cran env var
+      environment.push_back(std::make_pair("NOT_CRAN", "true"));
+
+      return environment;
+   }
+
+   void startWarm()
+   {
+      // the library paths the process was started with
+      libPaths_ = module_context::libPathsString();
+
+      // load the packages every render needs, then wait for the render
+      // command (which is written when the process is claimed)
+      std::string cmd(
+         "invisible(lapply(c('rmarkdown', 'knitr'), requireNamespace, quietly = TRUE));"
+         "eval(parse(text = readLines(file('stdin'), warn = FALSE)));");
+
+      async_r::AsyncRProcess::start(cmd.c_str(), renderEnvironment(), FilePath(),
+                                    async_r::R_PROCESS_NO_RDATA);
+   }
+
    void start(const std::string& format,
               const std::string& encoding,
               const std::string& paramsFile,
@@ -448,20 +547,14 @@ private:
                              extraParams %
                              renderOptions);
 
-      // environment
-      core::system::Options environment;
-      std::string tempDir;
-      error = r::exec::RFunction("tempdir").call(&tempDir);
-      if (!error)
-         environment.push_back(std::make_pair("RMARKDOWN_PREVIEW_DIR", tempDir));
-      else
-         LOG_ERROR(error);
-
-      // pass along the RSTUDIO_VERSION
-      environment.push_back(std::make_pair("RSTUDIO_VERSION", RSTUDIO_VERSION));
-
-      // set the not cran env var
-      environment.push_back(std::make_pair("NOT_CRAN", "true"));
+      // let knitr skip chunks whose code (and the chunks it depends on)
+      // haven't changed since the last render; the cache lives alongside
+      // the document as for any cached chunk
+      if (userSettings().rmdRenderCache() && !isShiny_ &&
+          renderFunc == kStandardRenderFunc)
+      {
+         cmd = "knitr::opts_chunk$set(cache = TRUE, autodep = TRUE); " + cmd;
+      }
 
       // render unless we were handed an existing output file
       allOutput_.clear();
@@ -479,9 +572,20 @@ private:
             onRenderOutput(module_context::kCompileOutputNormal, "==> " + cmd + "\n");
          }
 
-         // start the render process
-         async_r::AsyncRProcess::start(cmd.c_str(), environment, working,
-                                       async_r::R_PROCESS_NO_RDATA);
+         // start the render process, or hand the command to the one we
+         // started ahead of time (which still needs to move to the working
+         // directory)
+         if (async_r::AsyncRProcess::isRunning())
+         {
+            std::string dir = string_utils::singleQuotedStrEscape(
+                     string_utils::utf8ToSystem(working.absolutePath()));
+            writeInput("setwd('" + dir + "'); " + cmd + "\n");
+         }
+         else
+         {
+            async_r::AsyncRProcess::start(cmd.c_str(), renderEnvironment(),
+                                          working, async_r::R_PROCESS_NO_RDATA);
+         }
       }
       else
       {
@@ -504,12 +608,18 @@ private:
 
    void onStdout(const std::string& output)
    {
+      if (isWarm_)
+         return;
+
       onRenderOutput(module_context::kCompileOutputNormal,
                      string_utils::systemToUtf8(output));
    }
 
    void onStderr(const std::string& output)
    {
+      if (isWarm_)
+         return;
+
       onRenderOutput(module_context::kCompileOutputError,
                      string_utils::systemToUtf8(output));
    }
@@ -570,6 +680,11 @@ private:
 
    void onCompleted(int exitStatus)
    {
+      // a warm process which exits before it is claimed has nothing to
+      // report
+      if (isWarm_)
+         return;
+
       // see if we can determine the output file
       FilePath outputFile = module_context::extractOutputFileCreated
                                                    (targetFile_, allOutput_);
@@ -727,6 +842,8 @@ private:
    json::Object outputFormat_;
    std::vector<module_context::SourceMarker> knitrErrors_;
    std::string allOutput_;
+   bool isWarm_;
+   std::string libPaths_;
 };
 
 boost::shared_ptr<RenderRmd> s_pCurrentRender_;
@@ -905,6 +1022,10 @@ void doRenderRmd(const std::string& file,
                workingDir,
                viewerType);
       pResponse->setResult(true);
+
+      // get a process ready for the next render while this one runs
+      if (userSettings().rmdRenderCache())
+         RenderRmd::prepareWarmRender();
    }
 }
 
@@ -488,6 +488,7 @@ public:
          // remove known auxillary files
          remove(".out");
          remove(".aux");
+         remove(".fls");
 
          // only clean bbl if .bib exists
          if (exists(".bib"))
@@ -531,6 +532,59 @@ private:
 
 // implement pdf compilation within a class so we can maintain state
 // accross the various async callbacks the compile is composed of
+// Shows the errors latex reports in its output while it runs, so they can be
+// seen before a (possibly long) compile completes; the issues parsed from the
+// log once it has replace them
+class LatexErrorMonitor : boost::noncopyable
+{
+public:
+   LatexErrorMonitor(const FilePath& texFilePath,
+                     const rnw_concordance::Concordances& concordances)
+      : parser_(ancillaryFilePath(texFilePath, ".log")),
+        concordances_(concordances),
+        parsedEntries_(0)
+   {
+   }
+
+   // COPYING: boost::noncopyable
+
+   void onOutput(const std::string& output)
+   {
+      parser_.addOutput(output);
+
+      bool added = false;
+      const core::tex::LogEntries& entries = parser_.logEntries();
+      for ( ; parsedEntries_ < entries.size(); parsedEntries_++)
+      {
+         const core::tex::LogEntry& entry = entries[parsedEntries_];
+         if (entry.type() != core::tex::LogEntry::Error)
+            continue;
+
+         // (each latex pass reports the errors again)
+         std::string key = entry.filePath().absolutePath() + ":" +
+                           safe_convert::numberToString(entry.line()) + ":" +
+                           entry.message();
+         if (reported_.insert(key).second)
+         {
+            errors_.push_back(entry);
+            added = true;
+         }
+      }
+
+      if (added)
+         showLogEntries(errors_, concordances_);
+   }
+
+   bool shownErrors() const { return !errors_.empty(); }
+
+private:
+   core::tex::LatexLogParser parser_;
+   const rnw_concordance::Concordances& concordances_;
+   std::size_t parsedEntries_;
+   std::set<std::string> reported_;
+   core::tex::LogEntries errors_;
+};
+
 class AsyncPdfCompiler : boost::noncopyable,
                     public boost::enable_shared_from_this<AsyncPdfCompiler>
 {
@@ -559,7 +613,8 @@ private:
       : targetFilePath_(targetFilePath),
         encoding_(encoding),
         sourceLocation_(sourceLocation),
-        onCompleted_(onCompleted)
+        onCompleted_(onCompleted),
+        latexErrorsShown_(false)
    {
       if (targetFilePath_.exists())
       {
@@ -681,6 +736,15 @@ private:
          texFilePath = targetFilePath_;
       }
 
+      // nothing to do if none of the files the last compile read have
+      // changed (its log is kept so that its issues are still shown)
+      if (pdflatex::isUpToDate(texProgramPath_, texFilePath, options))
+      {
+         enqueOutputEvent(texFilePath.filename() + " is up to date...");
+         onLatexCompileCompleted(EXIT_SUCCESS, texFilePath, concordances);
+         return;
+      }
+
       // remove log files if they exist (avoids confusion created by parsing
       // old log files for errors)
       removeExistingLatexAncillaryFiles(texFilePath);
@@ -702,10 +766,21 @@ private:
       enqueOutputEvent("Running " + texProgramPath_.filename() +
                        " on " + texFilePath.filename() + "...");
 
+      // show errors as latex reports them (when they'll be in the list)
+      LatexErrorMonitor errorMonitor(texFilePath, concordances);
+      boost::function<void(const std::string&)> onLatexOutput;
+      if (useIssuesList(concordances))
+      {
+         onLatexOutput = boost::bind(&LatexErrorMonitor::onOutput,
+                                     &errorMonitor, _1);
+      }
+
       error = tex::pdflatex::texToPdf(texProgramPath_,
                                       texFilePath,
                                       options,
-                                      &result);
+                                      &result,
+                                      onLatexOutput);
+      latexErrorsShown_ = errorMonitor.shownErrors();
 
       if (error)
       {
@@ -730,7 +805,7 @@ private:
 
       // determine whether they will be shown in the list
       // list or within the console
-      bool showIssuesList = !isTargetRnw() || !concords.empty();
+      bool showIssuesList = useIssuesList(concords);
 
       // notify the cleanp context of log entries (so it can
       // preserve any referenced files)
@@ -744,6 +819,11 @@ private:
          showLogEntries(logEntries, concords);
          issuesMsg = buildIssuesMessage(logEntries);
       }
+      else if (showIssuesList && latexErrorsShown_)
+      {
+         // clear the errors shown while latex ran
+         showLogEntries(logEntries);
+      }
 
       if (exitStatus == EXIT_SUCCESS)
       {
@@ -809,6 +889,11 @@ private:
       return targetFilePath_.extensionLowerCase() == ".rnw";
    }
 
+   bool useIssuesList(const rnw_concordance::Concordances& concords) const
+   {
+      return !isTargetRnw() || !concords.empty();
+   }
+
 private:
    FilePath targetFilePath_;
    std::string encoding_;
@@ -817,6 +902,7 @@ private:
    core::tex::TexMagicComments magicComments_;
    FilePath texProgramPath_;
    AuxillaryFileCleanupContext auxillaryFileCleanupContext_;
+   bool latexErrorsShown_;
 };
 
 
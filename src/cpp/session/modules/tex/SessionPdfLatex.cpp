@@ -15,11 +15,16 @@
 
 #include "SessionPdfLatex.hpp"
 
+#include <map>
+#include <set>
+
 #include <boost/regex.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <core/system/Environment.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/Hash.hpp>
 
 #include <session/projects/SessionProjects.hpp>
 
@@ -193,6 +198,7 @@ shell_utils::ShellArgs shellArgs(const PdfLatexOptions& options)
       else
          args << kShellEscapeOption;
    }
+   args << kRecorderOption;
    args << "-interaction=nonstopmode";
 
    return args;
@@ -207,29 +213,228 @@ FilePath programPath(const std::string& name, const std::string& envOverride)
 
 
 
-bool lineIncludes(const std::string& line, const boost::regex& regex)
+// upper bound on the number of latex passes for a single compile
+const int kMaxPasses = 10;
+
+// files whose contents latex reads back on its next pass (so a change to
+// any of them means cross references may still be moving)
+const char * const kCrossRefExtensions[] = { ".aux", ".toc", ".lof", ".lot",
+                                             ".out", NULL };
+
+// what we know about the last compile of a document: the files it read (and
+// a stamp of each) along with the bibtex and makeindex inputs they were
+// last run on
+struct CompileState
+{
+   std::string signature;
+   std::map<std::string, std::string> inputs;
+   std::string bibtexInputs;
+   std::string makeindexInput;
+};
+
+// compile states by tex file path
+std::map<std::string, CompileState> s_compileStates;
+
+FilePath ancillaryPath(const FilePath& texFilePath, const std::string& ext)
+{
+   return texFilePath.parent().childPath(texFilePath.stem() + ext);
+}
+
+std::string fileHash(const FilePath& filePath)
+{
+   if (!filePath.exists())
+      return std::string();
+
+   std::string checksum;
+   Error error = hash::crc32cHexHash(filePath, &checksum);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return std::string();
+   }
+
+   return checksum;
+}
+
+// files alongside the document are stamped by content (they are the ones
+// being edited); files elsewhere (packages, fonts, etc.) by their size and
+// modification time, which is much cheaper for the hundreds a document
+// typically reads
+std::string inputStamp(const FilePath& filePath, const FilePath& docDir)
+{
+   if (!filePath.exists())
+      return std::string();
+
+   if (filePath.isWithin(docDir))
+      return fileHash(filePath);
+
+   return boost::lexical_cast<std::string>(filePath.size()) + ":" +
+          boost::lexical_cast<std::string>(filePath.lastWriteTime());
+}
+
+std::string crossRefHash(const FilePath& texFilePath)
+{
+   std::string hashes;
+   for (const char * const * ext = kCrossRefExtensions; *ext; ext++)
+      hashes += fileHash(ancillaryPath(texFilePath, *ext));
+   return hashes;
+}
+
+// the files latex read for the document, from the .fls file written by
+// -recorder. generated files (anything it also wrote, and the document's
+// own ancillary files such as the .bbl) are left out since they are
+// checked by the passes themselves
+void readRecordedInputs(const FilePath& texFilePath,
+                        std::vector<FilePath>* pInputs)
 {
-    boost::smatch match;
-    return regex_utils::search(line, match, regex);
+   FilePath flsPath = ancillaryPath(texFilePath, ".fls");
+   std::vector<std::string> lines;
+   Error error = core::readStringVectorFromFile(flsPath, &lines);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   FilePath workingDir = texFilePath.parent();
+   std::vector<FilePath> inputs;
+   std::set<FilePath> outputs;
+   BOOST_FOREACH(const std::string& line, lines)
+   {
+      std::string::size_type pos = line.find(' ');
+      if (pos == std::string::npos)
+         continue;
+
+      std::string type = line.substr(0, pos);
+      std::string path = boost::algorithm::trim_right_copy(line.substr(pos + 1));
+      if (type == "PWD")
+         workingDir = FilePath(string_utils::systemToUtf8(path));
+      else if (type == "INPUT")
+         inputs.push_back(workingDir.complete(string_utils::systemToUtf8(path)));
+      else if (type == "OUTPUT")
+         outputs.insert(workingDir.complete(string_utils::systemToUtf8(path)));
+   }
+
+   std::set<FilePath> seen;
+   BOOST_FOREACH(const FilePath& input, inputs)
+   {
+      if (outputs.count(input) || !seen.insert(input).second)
+         continue;
+
+      if (input != texFilePath &&
+          input.parent() == texFilePath.parent() &&
+          input.stem() == texFilePath.stem())
+      {
+         continue;
+      }
+
+      pInputs->push_back(input);
+   }
+}
+
+// the .bib files named by \bibdata in the aux file
+void auxBibFiles(const FilePath& auxFilePath, std::vector<FilePath>* pBibFiles)
+{
+   std::vector<std::string> lines;
+   Error error = core::readStringVectorFromFile(auxFilePath, &lines);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   boost::regex bibdataRegex("^\\\\bibdata\\{([^}]*)\\}");
+   BOOST_FOREACH(const std::string& line, lines)
+   {
+      boost::smatch match;
+      if (!regex_utils::search(line, match, bibdataRegex))
+         continue;
+
+      std::string bibdata = match[1];
+      std::vector<std::string> names;
+      boost::algorithm::split(names, bibdata, boost::is_any_of(","));
+      BOOST_FOREACH(std::string name, names)
+      {
+         boost::algorithm::trim(name);
+         if (name.empty())
+            continue;
+         if (!boost::algorithm::ends_with(name, ".bib"))
+            name += ".bib";
+         pBibFiles->push_back(auxFilePath.parent().complete(name));
+      }
+   }
 }
 
-int countCitationMisses(const FilePath& logFilePath)
+// everything bibtex reads: the citation, style and database lines of the
+// aux file (and of those it includes, as \include does) and the databases
+// themselves. empty if the document has no bibliography.
+std::string bibtexInputs(const FilePath& auxFilePath)
 {
-   // read the log file
    std::vector<std::string> lines;
-   Error error = core::readStringVectorFromFile(logFilePath, &lines);
+   Error error = core::readStringVectorFromFile(auxFilePath, &lines);
    if (error)
    {
       LOG_ERROR(error);
-      return 0;
+      return std::string();
+   }
+
+   boost::regex inputRegex("^\\\\@input\\{([^}]*)\\}");
+   std::string inputs;
+   bool hasBibdata = false;
+   BOOST_FOREACH(const std::string& line, lines)
+   {
+      boost::smatch match;
+      if (regex_utils::search(line, match, inputRegex))
+      {
+         inputs += bibtexInputs(auxFilePath.parent().complete(match[1].str()));
+      }
+      else if (boost::algorithm::starts_with(line, "\\citation") ||
+               boost::algorithm::starts_with(line, "\\bibstyle"))
+      {
+         inputs += line + "\n";
+      }
+      else if (boost::algorithm::starts_with(line, "\\bibdata"))
+      {
+         inputs += line + "\n";
+         hasBibdata = true;
+      }
    }
 
-   // look for misses
-   boost::regex missRegex("Warning:.*Citation.*undefined");
-   int misses = std::count_if(lines.begin(),
-                              lines.end(),
-                              boost::bind(lineIncludes, _1, missRegex));
-   return misses;
+   if (hasBibdata)
+   {
+      std::vector<FilePath> bibFiles;
+      auxBibFiles(auxFilePath, &bibFiles);
+      BOOST_FOREACH(const FilePath& bibFile, bibFiles)
+      {
+         inputs += fileHash(bibFile) + "\n";
+      }
+   }
+
+   return inputs;
+}
+
+std::string compileSignature(const FilePath& texProgramPath,
+                             const PdfLatexOptions& options)
+{
+   return texProgramPath.absolutePath() + " " +
+          boost::algorithm::join(shellArgs(options).args(), " ");
+}
+
+void recordCompile(const FilePath& texFilePath,
+                   const std::string& signature,
+                   CompileState* pState)
+{
+   pState->signature = signature;
+   pState->inputs.clear();
+
+   FilePath docDir = texFilePath.parent();
+   std::vector<FilePath> inputs;
+   readRecordedInputs(texFilePath, &inputs);
+   auxBibFiles(ancillaryPath(texFilePath, ".aux"), &inputs);
+   BOOST_FOREACH(const FilePath& input, inputs)
+   {
+      pState->inputs[input.absolutePath()] = inputStamp(input, docDir);
+   }
 }
 
 bool logIncludesRerun(const FilePath& logFilePath)
@@ -242,7 +447,8 @@ bool logIncludesRerun(const FilePath& logFilePath)
       return false;
    }
 
-   return logContents.find("Rerun to get") != std::string::npos;
+   return logContents.find("Rerun to get") != std::string::npos ||
+          logContents.find("Rerun LaTeX") != std::string::npos;
 }
 
 } // anonymous namespace
@@ -251,7 +457,8 @@ const char * const kFileLineErrorOption = "-file-line-error";
 const char * const kCStyleErrorsOption = "-c-style-errors";
 const char * const kShellEscapeOption = "-shell-escape";
 const char * const kEnableWrite18Option = "-enable-write18";
-const char * const kSynctexOption = "-synctex=1";
+const char * const kSynctexOption = "-synctex=-1";
+const char * const kRecorderOption = "-recorder";
 
 bool isInstalled()
 {
@@ -341,23 +548,66 @@ bool latexProgramForFile(const core::tex::TexMagicComments& magicComments,
    }
 }
 
+bool isUpToDate(const core::FilePath& texProgramPath,
+                const core::FilePath& texFilePath,
+                const PdfLatexOptions& options)
+{
+   std::map<std::string, CompileState>::const_iterator it =
+                           s_compileStates.find(texFilePath.absolutePath());
+   if (it == s_compileStates.end())
+      return false;
+
+   const CompileState& state = it->second;
+   if (state.signature != compileSignature(texProgramPath, options) ||
+       state.inputs.empty())
+   {
+      return false;
+   }
+
+   // the outputs we'd show need to still be around
+   if (!ancillaryPath(texFilePath, ".pdf").exists() ||
+       !ancillaryPath(texFilePath, ".log").exists())
+   {
+      return false;
+   }
+
+   FilePath docDir = texFilePath.parent();
+   for (std::map<std::string, std::string>::const_iterator input =
+            state.inputs.begin();
+        input != state.inputs.end();
+        ++input)
+   {
+      if (inputStamp(FilePath(input->first), docDir) != input->second)
+         return false;
+   }
+
+   return true;
+}
+
 // this function provides an "emulated" version of texi2dvi for when the
 // user has texi2dvi disabled. For example to workaround this bug:
 //
 //  http://bugs.debian.org/cgi-bin/bugreport.cgi?bug=534458
 //
-// this code is a port of the simillar logic which exists in the
-// tools::texi2dvi function (but the regex for detecting citation
-// warnings was made a bit more liberal)
+// it was originally a port of the simillar logic which exists in the
+// tools::texi2dvi function. passes are now only run when their inputs have
+// changed: bibtex when the citations or databases have, makeindex when the
+// index entries have, and latex again when any of those produced new output,
+// when the files latex reads back (aux, toc, etc.) changed during the pass,
+// or when the log asks for a rerun
 //
 core::Error texToPdf(const core::FilePath& texProgramPath,
                      const core::FilePath& texFilePath,
                      const tex::pdflatex::PdfLatexOptions& options,
-                     core::system::ProcessResult* pResult)
+                     core::system::ProcessResult* pResult,
+                     const boost::function<void(const std::string&)>& onLatexOutput)
 {
    // input file paths
    FilePath baseFilePath = texFilePath.parent().complete(texFilePath.stem());
+   FilePath auxFilePath(baseFilePath.absolutePath() + ".aux");
+   FilePath bblFilePath(baseFilePath.absolutePath() + ".bbl");
    FilePath idxFilePath(baseFilePath.absolutePath() + ".idx");
+   FilePath indFilePath(baseFilePath.absolutePath() + ".ind");
    FilePath logFilePath(baseFilePath.absolutePath() + ".log");
 
    // bibtex and makeindex program paths
@@ -373,26 +623,32 @@ core::Error texToPdf(const core::FilePath& texProgramPath,
    procOptions.environment = utils::rTexInputsEnvVars();
    procOptions.workingDir = texFilePath.parent();
 
+   // forget what we knew about the document until this compile succeeds
+   CompileState& state = s_compileStates[texFilePath.absolutePath()];
+   state.signature.clear();
+
    // run the initial compile
+   std::string crossRefs = crossRefHash(texFilePath);
    Error error = utils::runTexCompile(texProgramPath,
                                       utils::rTexInputsEnvVars(),
                                       shellArgs(options),
                                       texFilePath,
-                                      pResult);
+                                      pResult,
+                                      onLatexOutput);
    if (error)
       return error;
 
-   // count misses
-   int misses = countCitationMisses(logFilePath);
-   int previousMisses = 0;
-
-   // resolve citation misses and index
-   for (int i=0; i<10; i++)
+   // resolve citations, index and cross references
+   for (int i=1; i<kMaxPasses; i++)
    {
-      // run bibtex if necessary
-      if (misses > 0 && !bibtexProgramPath.empty())
+      bool rerun = logIncludesRerun(logFilePath);
+
+      // run bibtex if the citations or databases changed
+      std::string bibInputs = bibtexInputs(auxFilePath);
+      if (!bibInputs.empty() && !bibtexProgramPath.empty() &&
+          (bibInputs != state.bibtexInputs || !bblFilePath.exists()))
       {
-         core::system::ProcessResult result;
+         std::string bblHash = fileHash(bblFilePath);
          Error error = core::system::runProgram(
                string_utils::utf8ToSystem(bibtexProgramPath.absolutePath()),
                bibtexArgs,
@@ -403,12 +659,18 @@ core::Error texToPdf(const core::FilePath& texProgramPath,
             LOG_ERROR(error);
          else if (pResult->exitStatus != EXIT_SUCCESS)
             return Success(); // pass error state on to caller
+
+         state.bibtexInputs = bibInputs;
+         if (fileHash(bblFilePath) != bblHash)
+            rerun = true;
       }
-      previousMisses = misses;
 
-      // run makeindex if necessary
-      if (idxFilePath.exists() && !makeindexProgramPath.empty())
+      // run makeindex if the index entries changed
+      std::string idxHash = fileHash(idxFilePath);
+      if (!idxHash.empty() && !makeindexProgramPath.empty() &&
+          (idxHash != state.makeindexInput || !indFilePath.exists()))
       {
+         std::string indHash = fileHash(indFilePath);
          Error error = core::system::runProgram(
                string_utils::utf8ToSystem(makeindexProgramPath.absolutePath()),
                makeindexArgs,
@@ -419,26 +681,38 @@ core::Error texToPdf(const core::FilePath& texProgramPath,
             LOG_ERROR(error);
          else if (pResult->exitStatus != EXIT_SUCCESS)
             return Success(); // pass error state on to caller
+
+         state.makeindexInput = idxHash;
+         if (fileHash(indFilePath) != indHash)
+            rerun = true;
       }
 
+      // cross references may still be moving if the pass changed them
+      std::string passCrossRefs = crossRefHash(texFilePath);
+      if (passCrossRefs != crossRefs)
+         rerun = true;
+      crossRefs = passCrossRefs;
+
+      if (!rerun)
+         break;
+
       // re-run latex
       Error error = utils::runTexCompile(texProgramPath,
                                          utils::rTexInputsEnvVars(),
                                          shellArgs(options),
                                          texFilePath,
-                                         pResult);
+                                         pResult,
+                                         onLatexOutput);
       if (error)
          return error;
-
-      // count misses
-      misses = countCitationMisses(logFilePath);
-
-      // if there is no change in misses and there is no "Rerun to get"
-      // in the log file then break
-      if ((misses == previousMisses) && !logIncludesRerun(logFilePath))
-         break;
    }
 
+   // remember what the compile read so an unchanged document needn't be
+   // compiled again
+   if (pResult->exitStatus == EXIT_SUCCESS)
+      recordCompile(texFilePath, compileSignature(texProgramPath, options),
+                    &state);
+
    return Success();
 }
 
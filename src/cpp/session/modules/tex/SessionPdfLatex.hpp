@@ -16,6 +16,10 @@
 #ifndef SESSION_MODULES_TEX_PDFLATEX_HPP
 #define SESSION_MODULES_TEX_PDFLATEX_HPP
 
+#include <string>
+
+#include <boost/function.hpp>
+
 #include <core/FilePath.hpp>
 
 #include <core/json/Json.hpp>
@@ -52,6 +56,7 @@ extern const char * const kCStyleErrorsOption;
 extern const char * const kShellEscapeOption;
 extern const char * const kEnableWrite18Option;
 extern const char * const kSynctexOption;
+extern const char * const kRecorderOption;
 
 struct PdfLatexOptions
 {
@@ -71,10 +76,20 @@ struct PdfLatexOptions
    std::string versionInfo;
 };
 
+// is the pdf from the last compile of the file (with the same program and
+// options) still current, i.e. are the files it read unchanged
+bool isUpToDate(const core::FilePath& texProgramPath,
+                const core::FilePath& texFilePath,
+                const PdfLatexOptions& options);
+
+// onLatexOutput (if provided) is passed the output of each latex pass as
+// it is written
 core::Error texToPdf(const core::FilePath& texProgramPath,
                      const core::FilePath& texFilePath,
                      const tex::pdflatex::PdfLatexOptions& options,
-                     core::system::ProcessResult* pResult);
+                     core::system::ProcessResult* pResult,
+                     const boost::function<void(const std::string&)>&
+                           onLatexOutput = boost::function<void(const std::string&)>());
 
 bool isInstalled();
 
@@ -15,6 +15,7 @@
 
 #include "SessionRnwConcordance.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 #include <boost/foreach.hpp>
@@ -28,7 +29,7 @@
 #include <core/FilePath.hpp>
 #include <core/FileSerializer.hpp>
 #include <core/SafeConvert.hpp>
-#include <core/Algorithm.hpp>
+#include <core/collection/LruCache.hpp>
 
 #include <core/tex/TexSynctex.hpp>
 
@@ -50,6 +51,18 @@ FilePath concordanceFilePath(const FilePath& rnwFilePath)
    return parentDir.complete(rnwFilePath.stem() + "-concordance.tex");
 }
 
+// concordances as last read from a concordance file (reused while the file
+// is unchanged, since they're read for every synctex lookup)
+struct CachedConcordances
+{
+   CachedConcordances() : lastWriteTime(0), size(0) {}
+   std::time_t lastWriteTime;
+   uintmax_t size;
+   Concordances concordances;
+};
+
+collection::LruCache<std::string, CachedConcordances> s_concordancesCache(10);
+
 Error badFormatError(const FilePath& concordanceFile,
                      const std::string& context,
                      const ErrorLocation& location)
@@ -178,6 +191,7 @@ Error Concordance::parse(const FilePath& sourceFile,
       mapping_[i] = pos;
       pos += diffs[i];
    }
+   indexRnwLines();
 
    return Success();
 }
@@ -220,6 +234,58 @@ void Concordance::append(const Concordance& concordance)
    std::copy(concordance.mapping_.begin(),
              concordance.mapping_.end(),
              std::back_inserter(mapping_));
+   indexRnwLines();
+}
+
+int Concordance::texLine(int rnwLine) const
+{
+   typedef std::vector<std::pair<int, std::size_t> >::const_iterator Iterator;
+
+   if (rnwIndex_.empty())
+      return -1;
+
+   // the nearest rnw lines are the first at or after the line sought and the
+   // last before it; of the entries for each the first has the lowest index
+   Iterator after = std::lower_bound(rnwIndex_.begin(),
+                                     rnwIndex_.end(),
+                                     std::make_pair(rnwLine, std::size_t(0)));
+   Iterator nearest = after;
+   if (after == rnwIndex_.end() || after->first != rnwLine)
+   {
+      if (after != rnwIndex_.begin())
+      {
+         Iterator before = std::lower_bound(
+                  rnwIndex_.begin(),
+                  after,
+                  std::make_pair((after - 1)->first, std::size_t(0)));
+
+         if (after == rnwIndex_.end())
+         {
+            nearest = before;
+         }
+         else
+         {
+            int beforeDistance = rnwLine - before->first;
+            int afterDistance = after->first - rnwLine;
+            if (beforeDistance < afterDistance ||
+                (beforeDistance == afterDistance && before->second < after->second))
+            {
+               nearest = before;
+            }
+         }
+      }
+   }
+
+   return static_cast<int>(nearest->second + 1 + offset_);
+}
+
+void Concordance::indexRnwLines()
+{
+   rnwIndex_.clear();
+   rnwIndex_.reserve(mapping_.size());
+   for (std::size_t i = 0; i < mapping_.size(); i++)
+      rnwIndex_.push_back(std::make_pair(mapping_[i], i));
+   std::sort(rnwIndex_.begin(), rnwIndex_.end());
 }
 
 std::ostream& operator << (std::ostream& stream, const FileAndLine& fileLine)
@@ -243,25 +309,39 @@ bool hasInputFile(const Concordance& concord, const FilePath& inputFile)
 
 } // anonymous namespace
 
+void Concordances::add(Concordance& concordance)
+{
+   concordances_.push_back(concordance);
+
+   for (std::vector<Concordance>::iterator it = inputFileConcordances_.begin();
+        it != inputFileConcordances_.end();
+        ++it)
+   {
+      if (it->inputFile() == concordance.inputFile())
+      {
+         it->append(concordance);
+         return;
+      }
+   }
+
+   Concordance inputFileConcord;
+   inputFileConcord.append(concordance);
+   inputFileConcordances_.push_back(inputFileConcord);
+}
+
 FileAndLine Concordances::rnwLine(const FileAndLine& texLine) const
 {
    if (texLine.filePath().empty())
       return FileAndLine();
 
-   // inspect concordance where output file is equivliant to tex file
-   std::vector<Concordance> texFileConcords;
-   algorithm::copy_if(
-      concordances_.begin(),
-      concordances_.end(),
-      std::back_inserter(texFileConcords),
-      boost::bind(hasOutputFile, _1, texLine.filePath()));
-
-   // reverse search for the first concordances whose offset is less than
+   // reverse search (among the concordances whose output file is equivalent
+   // to the tex file) for the first concordance whose offset is less than
    // the text line we are seeking concordance for
    for (std::vector<Concordance>::const_reverse_iterator it =
-      texFileConcords.rbegin(); it != texFileConcords.rend(); ++it)
+      concordances_.rbegin(); it != concordances_.rend(); ++it)
    {
-      if (texLine.line() > static_cast<int>(it->offset()))
+      if (texLine.line() > static_cast<int>(it->offset()) &&
+          hasOutputFile(*it, texLine.filePath()))
       {
           return FileAndLine(it->inputFile(),
                              it->rnwLine(texLine.line()));
@@ -277,28 +357,15 @@ FileAndLine Concordances::texLine(const FileAndLine& rnwLine) const
    if (rnwLine.filePath().empty())
       return FileAndLine();
 
-   // inspect concordance where input file is equivilant to rnw file
-   std::vector<Concordance> rnwFileConcords;
-   algorithm::copy_if(
-      concordances_.begin(),
-      concordances_.end(),
-      std::back_inserter(rnwFileConcords),
-      boost::bind(hasInputFile, _1, rnwLine.filePath()));
-   if (rnwFileConcords.size() == 0)
-      return FileAndLine();
-
-   // build a single concordance structure for seeking
-   Concordance rnwFileConcord;
-   for (std::vector<Concordance>::const_iterator
-      it = rnwFileConcords.begin(); it != rnwFileConcords.end(); ++it)
+   // seek in the concordances for the input file equivalent to the rnw file
+   for (std::vector<Concordance>::const_iterator it =
+      inputFileConcordances_.begin(); it != inputFileConcordances_.end(); ++it)
    {
-      rnwFileConcord.append(*it);
+      if (hasInputFile(*it, rnwLine.filePath()))
+         return FileAndLine(it->outputFile(), it->texLine(rnwLine.line()));
    }
 
-   // seek
-   FileAndLine texLine(rnwFileConcord.outputFile(),
-                       rnwFileConcord.texLine(rnwLine.line()));
-   return texLine;
+   return FileAndLine();
 }
 
 std::string fixup_formatter(const Concordances& concordances,
@@ -338,7 +405,7 @@ core::tex::LogEntry Concordances::fixup(const core::tex::LogEntry &entry,
    if (!mapped.empty())
    {
       boost::function<std::string(boost::smatch)> formatter =
-            boost::bind(fixup_formatter, *this, entry.filePath(), _1);
+            boost::bind(fixup_formatter, boost::cref(*this), entry.filePath(), _1);
       std::string mappedMsg =
             boost::regex_replace(entry.message(), regexLines, formatter);
 
@@ -362,7 +429,9 @@ core::tex::LogEntry Concordances::fixup(const core::tex::LogEntry &entry,
 
 void removePrevious(const core::FilePath& rnwFile)
 {
-   Error error = concordanceFilePath(rnwFile).removeIfExists();
+   FilePath concordanceFile = concordanceFilePath(rnwFile);
+   s_concordancesCache.remove(concordanceFile.absolutePath());
+   Error error = concordanceFile.removeIfExists();
    if (error)
       LOG_ERROR(error);
 }
@@ -375,6 +444,17 @@ Error readIfExists(const core::FilePath& srcFile, Concordances* pConcordances)
    if (!concordanceFile.exists())
       return Success();
 
+   // use the cached concordances if the file hasn't changed since
+   CachedConcordances cached;
+   std::time_t lastWriteTime = concordanceFile.lastWriteTime();
+   uintmax_t size = concordanceFile.size();
+   if (s_concordancesCache.get(concordanceFile.absolutePath(), &cached) &&
+       cached.lastWriteTime == lastWriteTime && cached.size == size)
+   {
+      *pConcordances = cached.concordances;
+      return Success();
+   }
+
    // read the file
    std::string contents;
    Error error = core::readStringFromFile(concordanceFile,
@@ -400,10 +480,15 @@ Error readIfExists(const core::FilePath& srcFile, Concordances* pConcordances)
          if (error)
             LOG_ERROR(error);
          else
-            pConcordances->add(concord);
+            cached.concordances.add(concord);
       }
    }
 
+   cached.lastWriteTime = lastWriteTime;
+   cached.size = size;
+   s_concordancesCache.insert(concordanceFile.absolutePath(), cached);
+
+   *pConcordances = cached.concordances;
    return Success();
 }
 
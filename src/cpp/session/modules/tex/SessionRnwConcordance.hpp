@@ -17,6 +17,7 @@
 #define SESSION_MODULES_RNW_CONCORDANCE_HPP
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/utility.hpp>
@@ -85,40 +86,21 @@ public:
 
    // checked access to tex lines from rnw lines. note that this returns
    // the tex line which is closest to the specified rnw line (since some
-   // rnw lines don't result in tex output e.g. ones in hidden sweave chunks)
-   int texLine(int rnwLine) const
-   {
-      int texLine = -1;
-      int smallestDistance = -1;
-      for (std::size_t i = 0; i<mapping_.size(); i++)
-      {
-         if (texLine == -1)
-         {
-            texLine = i + 1 + offset_;
-            smallestDistance = std::abs(mapping_[i] - rnwLine);
-         }
-         else
-         {
-            int thisDistance = std::abs(mapping_[i] - rnwLine);
-            if (thisDistance < smallestDistance)
-            {
-               texLine = i + 1 + offset_;
-               smallestDistance = thisDistance;
-
-               if (smallestDistance == 0)
-                  break;
-            }
-         }
-      }
-
-      return texLine;
-   }
+   // rnw lines don't result in tex output e.g. ones in hidden sweave chunks),
+   // and the first such tex line if there are several
+   int texLine(int rnwLine) const;
 
 private:
+   void indexRnwLines();
+
    core::FilePath outputFile_;
    core::FilePath inputFile_;
    std::size_t offset_;
    std::vector<int> mapping_;
+
+   // (rnw line, mapping index) for each entry in the mapping, sorted so that
+   // tex lines can be found by binary search
+   std::vector<std::pair<int, std::size_t> > rnwIndex_;
 };
 
 class FileAndLine
@@ -157,10 +139,7 @@ public:
 
    bool empty() const { return concordances_.empty(); }
 
-   void add(Concordance& concordance)
-   {
-      concordances_.push_back(concordance);
-   }
+   void add(Concordance& concordance);
 
    FileAndLine rnwLine(const FileAndLine& texLine) const;
    FileAndLine texLine(const FileAndLine& rnwLine) const;
@@ -170,10 +149,16 @@ public:
 
 private:
    std::vector<Concordance> concordances_;
+
+   // the concordances for each input file appended together (for seeking
+   // tex lines)
+   std::vector<Concordance> inputFileConcordances_;
 };
 
 void removePrevious(const core::FilePath& rnwFile);
 
+// read the concordances for srcFile (if they exist) into pConcordances. they
+// are cached until the concordance file changes
 core::Error readIfExists(const core::FilePath& srcFile,
                          Concordances* pConcordances);
 
@@ -15,6 +15,10 @@
 
 #include "SessionSynctex.hpp"
 
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+
 #include <core/Error.hpp>
 #include <core/FilePath.hpp>
 #include <core/Exec.hpp>
@@ -38,6 +42,56 @@ namespace synctex {
 
 namespace {
 
+// parsed synctex data is kept for the most recently searched pdfs so that
+// repeated searches (e.g. clicking around a long document) don't re-read
+// and decompress the synctex file each time
+const std::size_t kMaxCachedSynctex = 4;
+
+struct CachedSynctex
+{
+   std::time_t pdfWriteTime;
+   uintmax_t pdfSize;
+   boost::shared_ptr<core::tex::Synctex> pSynctex;
+};
+
+std::map<std::string, CachedSynctex> s_synctexCache;
+
+// get the synctex data for a pdf (re-parsing it if the pdf has been
+// rebuilt since it was last parsed); returns NULL if there is none
+boost::shared_ptr<core::tex::Synctex> synctexForPdf(const FilePath& pdfPath)
+{
+   std::string key = pdfPath.absolutePath();
+   std::time_t pdfWriteTime = pdfPath.exists() ? pdfPath.lastWriteTime() : 0;
+   uintmax_t pdfSize = pdfPath.exists() ? pdfPath.size() : 0;
+
+   std::map<std::string, CachedSynctex>::iterator it = s_synctexCache.find(key);
+   if (it != s_synctexCache.end())
+   {
+      if (it->second.pdfWriteTime == pdfWriteTime &&
+          it->second.pdfSize == pdfSize)
+      {
+         return it->second.pSynctex;
+      }
+
+      s_synctexCache.erase(it);
+   }
+
+   boost::shared_ptr<core::tex::Synctex> pSynctex(new core::tex::Synctex());
+   if (!pSynctex->parse(pdfPath))
+      return boost::shared_ptr<core::tex::Synctex>();
+
+   if (s_synctexCache.size() >= kMaxCachedSynctex)
+      s_synctexCache.erase(s_synctexCache.begin());
+
+   CachedSynctex cached;
+   cached.pdfWriteTime = pdfWriteTime;
+   cached.pdfSize = pdfSize;
+   cached.pSynctex = pSynctex;
+   s_synctexCache[key] = cached;
+
+   return pSynctex;
+}
+
 json::Value toJson(const FilePath& pdfFile,
                    const core::tex::PdfLocation& pdfLoc,
                    bool fromClick)
@@ -245,8 +299,8 @@ Error synctexInverseSearch(const json::JsonRpcRequest& request,
       return error;
    FilePath pdfPath = module_context::resolveAliasedPath(file);
 
-   core::tex::Synctex synctex;
-   if (synctex.parse(pdfPath))
+   boost::shared_ptr<core::tex::Synctex> pSynctex = synctexForPdf(pdfPath);
+   if (pSynctex)
    {
       if (!fromClick)
       {
@@ -254,7 +308,7 @@ Error synctexInverseSearch(const json::JsonRpcRequest& request,
          // the passed x and y coordinates since they represent the
          // top of the user-visible content (in case the page is
          // scrolled down from the top)
-         core::tex::PdfLocation contLoc = synctex.topOfPageContent(page);
+         core::tex::PdfLocation contLoc = pSynctex->topOfPageContent(page);
          x = std::max(static_cast<float>(x), contLoc.x());
          y = std::max(static_cast<float>(y), contLoc.y());
       }
@@ -263,7 +317,7 @@ Error synctexInverseSearch(const json::JsonRpcRequest& request,
             static_cast<float>(x), static_cast<float>(y),
             static_cast<float>(width), static_cast<float>(height));
 
-      core::tex::SourceLocation srcLoc = synctex.inverseSearch(pdfLocation);
+      core::tex::SourceLocation srcLoc = pSynctex->inverseSearch(pdfLocation);
       applyInverseConcordance(&srcLoc);
 
       pResponse->setResult(toJson(srcLoc));
@@ -326,13 +380,13 @@ Error forwardSearch(const FilePath& rootFile,
    // determine pdf
    FilePath pdfFile = rootFile.parent().complete(rootFile.stem() + ".pdf");
 
-   core::tex::Synctex synctex;
-   if (synctex.parse(pdfFile))
+   boost::shared_ptr<core::tex::Synctex> pSynctex = synctexForPdf(pdfFile);
+   if (pSynctex)
    {
       core::tex::SourceLocation srcLoc(inputFile, line, column);
       applyForwardConcordance(rootFile, &srcLoc);
 
-      core::tex::PdfLocation pdfLoc = synctex.forwardSearch(srcLoc);
+      core::tex::PdfLocation pdfLoc = pSynctex->forwardSearch(srcLoc);
       *pPdfLocation = toJson(pdfFile, pdfLoc, fromClick);
    }
    else
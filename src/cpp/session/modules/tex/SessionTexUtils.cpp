@@ -15,9 +15,11 @@
 
 #include "SessionTexUtils.hpp"
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <core/Log.hpp>
 #include <core/system/Process.hpp>
 #include <core/system/Environment.hpp>
 
@@ -74,6 +76,26 @@ void ignoreOutput(const std::string& output)
 {
 }
 
+void closeStdin(core::system::ProcessOperations& ops)
+{
+   Error error = ops.writeToStdin(std::string(), true);
+   if (error)
+      LOG_ERROR(error);
+}
+
+void onCompileOutput(const boost::function<void(const std::string&)>& onOutput,
+                     core::system::ProcessResult* pResult,
+                     const std::string& output)
+{
+   pResult->stdOut.append(output);
+   onOutput(output);
+}
+
+void onCompileExit(core::system::ProcessResult* pResult, int exitStatus)
+{
+   pResult->exitStatus = exitStatus;
+}
+
 } // anonymous namespace
 
 RTexmfPaths rTexmfPaths()
@@ -137,7 +159,8 @@ Error runTexCompile(const FilePath& texProgramPath,
                     const core::system::Options& envVars,
                     const shell_utils::ShellArgs& args,
                     const FilePath& texFilePath,
-                    core::system::ProcessResult* pResult)
+                    core::system::ProcessResult* pResult,
+                    const boost::function<void(const std::string&)>& onOutput)
 {
    // copy extra environment variables
    core::system::Options env;
@@ -155,12 +178,36 @@ Error runTexCompile(const FilePath& texProgramPath,
    procOptions.workingDir = texFilePath.parent();
 
    // run the program
-   return core::system::runProgram(
-               string_utils::utf8ToSystem(texProgramPath.absolutePath()),
-               buildArgs(args, texFilePath),
-               "",
-               procOptions,
-               pResult);
+   std::string programPath =
+               string_utils::utf8ToSystem(texProgramPath.absolutePath());
+   if (!onOutput)
+   {
+      return core::system::runProgram(programPath,
+                                      buildArgs(args, texFilePath),
+                                      "",
+                                      procOptions,
+                                      pResult);
+   }
+
+   // run it under a supervisor of its own (polled until it exits) so that
+   // its output can be passed on as it's written
+   core::system::ProcessSupervisor supervisor;
+   core::system::ProcessCallbacks cb;
+   cb.onStarted = closeStdin;
+   cb.onStdout = cb.onStderr = boost::bind(onCompileOutput,
+                                           boost::cref(onOutput),
+                                           pResult,
+                                           _2);
+   cb.onExit = boost::bind(onCompileExit, pResult, _1);
+   Error error = supervisor.runProgram(programPath,
+                                       buildArgs(args, texFilePath),
+                                       procOptions,
+                                       cb);
+   if (error)
+      return error;
+
+   supervisor.wait(boost::posix_time::milliseconds(25));
+   return Success();
 }
 
 core::Error runTexCompile(
@@ -16,6 +16,10 @@
 #ifndef SESSION_MODULES_TEX_UTILS_HPP
 #define SESSION_MODULES_TEX_UTILS_HPP
 
+#include <string>
+
+#include <boost/function.hpp>
+
 #include <core/FilePath.hpp>
 
 #include <core/system/ShellUtils.hpp>
@@ -47,11 +51,16 @@ RTexmfPaths rTexmfPaths();
 
 core::system::Options rTexInputsEnvVars();
 
+// run the compile to completion. if onOutput is provided then the
+// compiler's output is passed to it as it is written (as well as being
+// collected in the result)
 core::Error runTexCompile(const core::FilePath& texProgramPath,
                           const core::system::Options& envVars,
                           const core::shell_utils::ShellArgs& args,
                           const core::FilePath& texFilePath,
-                          core::system::ProcessResult* pResult);
+                          core::system::ProcessResult* pResult,
+                          const boost::function<void(const std::string&)>&
+                                 onOutput = boost::function<void(const std::string&)>());
 
 core::Error runTexCompile(
               const core::FilePath& texProgramPath,
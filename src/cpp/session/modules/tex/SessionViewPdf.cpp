@@ -45,9 +45,10 @@ void handleViewPdf(const http::Request& request, http::Response* pResponse)
       return;
    }
 
-   // send it back
+   // send it back (pdf.js requests large files a range at a time so that
+   // it can show the first pages before the rest has arrived)
    pResponse->setNoCacheHeaders();
-   pResponse->setFile(filePath, request);
+   pResponse->setRangeableFile(filePath, request);
    pResponse->setContentType("application/pdf");
 }
 
@@ -0,0 +1,252 @@
+/*
+ * SessionGitObjectReader.cpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionGitObjectReader.hpp"
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/system/ChildProcess.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace git {
+
+namespace {
+
+// how long we wait on a single request before giving up on the process
+const boost::posix_time::milliseconds kRequestTimeout =
+                                       boost::posix_time::milliseconds(5000);
+
+// how long we wait for the process to exit when stopping it
+const boost::posix_time::milliseconds kStopTimeout =
+                                       boost::posix_time::milliseconds(500);
+
+} // anonymous namespace
+
+GitObjectReader::GitObjectReader()
+   : exited_(true)
+{
+}
+
+GitObjectReader::~GitObjectReader()
+{
+   try
+   {
+      stop();
+   }
+   catch(...)
+   {
+   }
+}
+
+bool GitObjectReader::readBlob(const std::string& catFileCommand,
+                               const core::system::ProcessOptions& options,
+                               const std::string& object,
+                               std::string* pContents)
+{
+   // object names are newline delimited on the batch's standard input
+   if (object.empty() || object.find_first_of("\r\n") != std::string::npos)
+      return false;
+
+   if (!ensureRunning(catFileCommand, options))
+      return false;
+
+   Error error = pProcess_->writeToStdin(object + "\n", false);
+   if (error)
+   {
+      LOG_ERROR(error);
+      stop();
+      return false;
+   }
+
+   // read the header: "<sha> <type> <size>", or "<object> missing"
+   std::size_t headerEnd;
+   while ((headerEnd = buffer_.find('\n')) == std::string::npos)
+   {
+      if (!waitForOutput())
+         return false;
+   }
+
+   std::string header = buffer_.substr(0, headerEnd);
+   std::size_t sizePos = header.rfind(' ');
+   std::size_t typePos = sizePos != std::string::npos && sizePos > 0 ?
+                            header.rfind(' ', sizePos - 1) :
+                            std::string::npos;
+   std::string type = typePos != std::string::npos ?
+                         header.substr(typePos + 1, sizePos - typePos - 1) :
+                         std::string();
+   if (boost::algorithm::ends_with(header, " missing") ||
+       boost::algorithm::ends_with(header, " ambiguous") ||
+       typePos == std::string::npos)
+   {
+      buffer_.erase(0, headerEnd + 1);
+      return false;
+   }
+
+   std::size_t size = safe_convert::stringTo<std::size_t>(
+                                          header.substr(sizePos + 1), 0);
+
+   // read the contents along with their trailing newline
+   std::size_t responseSize = headerEnd + 1 + size + 1;
+   while (buffer_.size() < responseSize)
+   {
+      if (!waitForOutput())
+         return false;
+   }
+
+   bool isBlob = type == "blob";
+   if (isBlob)
+      *pContents = buffer_.substr(headerEnd + 1, size);
+   buffer_.erase(0, responseSize);
+   return isBlob;
+}
+
+void GitObjectReader::stop()
+{
+   if (!pProcess_)
+      return;
+
+   // closing standard input asks the batch to exit; give it a moment to do
+   // so (which lets us reap it) before terminating it outright
+   if (!exited_)
+   {
+      Error error = pProcess_->writeToStdin(std::string(), true);
+      if (!error)
+      {
+         boost::posix_time::ptime deadline =
+               boost::posix_time::microsec_clock::universal_time() + kStopTimeout;
+         while (!exited_ &&
+                boost::posix_time::microsec_clock::universal_time() < deadline)
+         {
+            pProcess_->poll();
+            if (!exited_)
+               boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+         }
+      }
+
+      if (!exited_)
+      {
+         error = pProcess_->terminate();
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+
+   pProcess_.reset();
+   buffer_.clear();
+   key_.clear();
+   exited_ = true;
+}
+
+bool GitObjectReader::ensureRunning(const std::string& catFileCommand,
+                                    const core::system::ProcessOptions& options)
+{
+   std::string key = catFileCommand + "\n" + options.workingDir.absolutePath();
+   if (pProcess_ && !exited_ && key == key_)
+      return true;
+
+   stop();
+
+   pProcess_.reset(new core::system::AsyncChildProcess(catFileCommand, options));
+
+   core::system::ProcessCallbacks callbacks;
+   callbacks.onStdout = boost::bind(&GitObjectReader::onStdout, this, _2);
+   callbacks.onExit = boost::bind(&GitObjectReader::onExit, this);
+
+   Error error = pProcess_->run(callbacks);
+   if (error)
+   {
+      LOG_ERROR(error);
+      pProcess_.reset();
+      return false;
+   }
+
+   key_ = key;
+   exited_ = false;
+   return true;
+}
+
+bool GitObjectReader::waitForOutput()
+{
+   boost::posix_time::ptime deadline =
+         boost::posix_time::microsec_clock::universal_time() + kRequestTimeout;
+
+   std::size_t previousSize = buffer_.size();
+   while (buffer_.size() == previousSize)
+   {
+      pProcess_->poll();
+      if (buffer_.size() != previousSize)
+         break;
+
+      boost::posix_time::ptime now =
+            boost::posix_time::microsec_clock::universal_time();
+      if (exited_ || now >= deadline)
+      {
+         // drop the process, as its output can no longer be matched up
+         // with our requests
+         stop();
+         return false;
+      }
+
+#ifndef _WIN32
+      std::vector<int> fds = pProcess_->outputDescriptors();
+      if (!fds.empty())
+      {
+         std::vector<pollfd> pollFds(fds.size());
+         for (std::size_t i = 0; i < fds.size(); i++)
+         {
+            pollFds[i].fd = fds[i];
+            pollFds[i].events = POLLIN;
+            pollFds[i].revents = 0;
+         }
+         int timeoutMs = static_cast<int>((deadline - now).total_milliseconds());
+         ::poll(&pollFds[0], pollFds.size(), timeoutMs);
+         continue;
+      }
+#endif
+      boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+   }
+
+   return true;
+}
+
+void GitObjectReader::onStdout(const std::string& output)
+{
+   buffer_.append(output);
+}
+
+void GitObjectReader::onExit()
+{
+   exited_ = true;
+}
+
+} // namespace git
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -0,0 +1,78 @@
+/*
+ * SessionGitObjectReader.hpp
+ *
+ * Copyright (C) 2009-18 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_GIT_OBJECT_READER_HPP
+#define SESSION_GIT_OBJECT_READER_HPP
+
+#include <string>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <core/system/Process.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+   class AsyncChildProcess;
+} // namespace system
+} // namespace core
+} // namespace rstudio
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace git {
+
+// Reads blobs through a long-lived 'git cat-file --batch' process, so that
+// repeated requests for file contents at a revision don't each pay for
+// starting git. The process is (re)started on demand for the given command
+// and working directory and is stopped when the reader is destroyed.
+class GitObjectReader : boost::noncopyable
+{
+public:
+   GitObjectReader();
+   ~GitObjectReader();
+
+   // Reads the blob named by object (e.g. "HEAD:R/file.R"). Returns false if
+   // the object isn't a blob or the batch process couldn't answer, in which
+   // case the caller should fall back to running git directly.
+   bool readBlob(const std::string& catFileCommand,
+                 const core::system::ProcessOptions& options,
+                 const std::string& object,
+                 std::string* pContents);
+
+   void stop();
+
+private:
+   bool ensureRunning(const std::string& catFileCommand,
+                      const core::system::ProcessOptions& options);
+   bool waitForOutput();
+   void onStdout(const std::string& output);
+   void onExit();
+
+private:
+   std::string key_;
+   std::string buffer_;
+   bool exited_;
+   boost::shared_ptr<core::system::AsyncChildProcess> pProcess_;
+};
+
+} // namespace git
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_GIT_OBJECT_READER_HPP
@@ -15,11 +15,19 @@
 
 #include "ViewerHistory.hpp"
 
+#include <cstdlib>
+#include <algorithm>
+
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/foreach.hpp>
+#include <boost/algorithm/string/replace.hpp>
 
 #include <core/SafeConvert.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/ZipStream.hpp>
+
+#include <r/RExec.hpp>
 
 #include <session/SessionModuleContext.hpp>
 
@@ -30,6 +38,100 @@ namespace session {
 namespace modules { 
 namespace viewer {
 
+namespace {
+
+const std::size_t kMaxEntries = 20;
+const uintmax_t kMaxExpandedBytes = 50 * 1024 * 1024;
+
+// archives are kept in this folder of the session temp dir
+const char * const kArchiveDir = "viewer-history";
+
+// the entry's directory, relative to the session temp dir (empty if the
+// entry's file is in the temp dir itself, in which case it isn't archived)
+std::string entryDir(const module_context::ViewerHistoryEntry& entry)
+{
+   std::string::size_type pos = entry.sessionTempPath().rfind('/');
+   if (pos == std::string::npos)
+      return std::string();
+   return entry.sessionTempPath().substr(0, pos);
+}
+
+FilePath archivePath(const FilePath& parentDir, const std::string& dir)
+{
+   return parentDir.complete(kArchiveDir).complete(
+            boost::algorithm::replace_all_copy(dir, "/", "_") + ".zip");
+}
+
+Error archiveDir(const std::string& dir)
+{
+   FilePath tempDir = module_context::tempDir();
+   FilePath dirPath = tempDir.complete(dir);
+   FilePath archive = archivePath(tempDir, dir);
+
+   Error error = archive.parent().ensureDirectory();
+   if (error)
+      return error;
+
+   boost::shared_ptr<ZipStream> pZip;
+   error = ZipStream::create(dirPath.parent(),
+                             std::vector<std::string>(1, dirPath.filename()),
+                             0,
+                             &pZip);
+   if (error)
+      return error;
+
+   boost::shared_ptr<std::ostream> pStream;
+   error = archive.open_w(&pStream);
+   if (error)
+      return error;
+
+   std::string data;
+   while (!error)
+   {
+      error = pZip->read(65536, &data);
+      if (error || data.empty())
+         break;
+
+      pStream->write(data.data(), data.size());
+      if (!pStream->good())
+         error = systemError(boost::system::errc::io_error, ERROR_LOCATION);
+   }
+   pStream.reset();
+
+   if (error)
+   {
+      Error removeError = archive.removeIfExists();
+      if (removeError)
+         LOG_ERROR(removeError);
+      return error;
+   }
+
+   return dirPath.remove();
+}
+
+Error expandDir(const std::string& dir)
+{
+   FilePath tempDir = module_context::tempDir();
+   FilePath dirPath = tempDir.complete(dir);
+   FilePath archive = archivePath(tempDir, dir);
+
+   r::exec::RFunction unzip("unzip");
+   unzip.addParam("zipfile", archive.absolutePath());
+   unzip.addParam("exdir", dirPath.parent().absolutePath());
+   Error error = unzip.call();
+   if (error)
+      return error;
+
+   return archive.remove();
+}
+
+bool isFartherFromCurrent(int currentIndex, int index1, int index2)
+{
+   return std::abs(index1 - currentIndex) > std::abs(index2 - currentIndex);
+}
+
+} // anonymous namespace
+
 ViewerHistory& viewerHistory()
 {
    static ViewerHistory instance;
@@ -37,21 +139,54 @@ ViewerHistory& viewerHistory()
 }
 
 ViewerHistory::ViewerHistory()
-   : currentIndex_(-1)
+   : currentIndex_(-1),
+     enforceBudgetScheduled_(false)
 {
-   entries_.set_capacity(20);
+   entries_.set_capacity(kMaxEntries);
 }
 
 void ViewerHistory::add(const module_context::ViewerHistoryEntry& entry)
 {
+   // note the entry which is pushed out of the history (if any)
+   module_context::ViewerHistoryEntry removed;
+   if (entries_.full())
+      removed = entries_.front();
+
    entries_.push_back(entry);
    currentIndex_ = static_cast<int>(entries_.size() - 1);
+
+   // remove its archive if no other entry shares it
+   std::string dir = entryDir(removed);
+   if (archivedDirs_.count(dir))
+   {
+      bool shared = false;
+      BOOST_FOREACH(const module_context::ViewerHistoryEntry& other, entries_)
+      {
+         if (entryDir(other) == dir)
+            shared = true;
+      }
+
+      if (!shared)
+      {
+         archivedDirs_.erase(dir);
+         Error error = archivePath(module_context::tempDir(), dir).removeIfExists();
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+
+   scheduleEnforceBudget();
 }
 
 void ViewerHistory::clear()
 {
    currentIndex_ = -1;
    entries_.clear();
+
+   archivedDirs_.clear();
+   Error error = module_context::tempDir().complete(kArchiveDir).removeIfExists();
+   if (error)
+      LOG_ERROR(error);
 }
 
 module_context::ViewerHistoryEntry ViewerHistory::current() const
@@ -84,7 +219,10 @@ bool ViewerHistory::hasNext() const
 module_context::ViewerHistoryEntry ViewerHistory::goForward()
 {
    if (hasNext())
-      return entries_[++currentIndex_];
+   {
+      ensureExpanded(entries_[++currentIndex_]);
+      return entries_[currentIndex_];
+   }
    else
       return module_context::ViewerHistoryEntry();
 }
@@ -97,11 +235,92 @@ bool ViewerHistory::hasPrevious() const
 module_context::ViewerHistoryEntry ViewerHistory::goBack()
 {
    if (hasPrevious())
-      return entries_[--currentIndex_];
+   {
+      ensureExpanded(entries_[--currentIndex_]);
+      return entries_[currentIndex_];
+   }
    else
       return module_context::ViewerHistoryEntry();
 }
 
+void ViewerHistory::ensureExpanded(const module_context::ViewerHistoryEntry& entry)
+{
+   std::string dir = entryDir(entry);
+   if (!archivedDirs_.count(dir))
+      return;
+
+   archivedDirs_.erase(dir);
+   Error error = expandDir(dir);
+   if (error)
+      LOG_ERROR(error);
+
+   // (others may need archiving to make room)
+   scheduleEnforceBudget();
+}
+
+void ViewerHistory::scheduleEnforceBudget()
+{
+   // archiving is done in idle time
+   if (enforceBudgetScheduled_)
+      return;
+
+   enforceBudgetScheduled_ = true;
+   module_context::scheduleDelayedWork(
+            boost::posix_time::seconds(1),
+            boost::bind(&ViewerHistory::enforceBudget, this),
+            true);
+}
+
+void ViewerHistory::enforceBudget()
+{
+   enforceBudgetScheduled_ = false;
+   if (currentIndex_ == -1)
+      return;
+
+   // archive the entries farthest from the current one first
+   std::vector<int> indexes;
+   for (int i = 0; i < static_cast<int>(entries_.size()); i++)
+      indexes.push_back(i);
+   std::stable_sort(indexes.begin(),
+                    indexes.end(),
+                    boost::bind(isFartherFromCurrent, currentIndex_, _1, _2));
+
+   // the expanded directories (each once) and their sizes
+   FilePath tempDir = module_context::tempDir();
+   std::string currentDir = entryDir(entries_[currentIndex_]);
+   std::vector<std::pair<std::string, uintmax_t> > dirs;
+   std::set<std::string> seen;
+   uintmax_t total = 0;
+   BOOST_FOREACH(int index, indexes)
+   {
+      std::string dir = entryDir(entries_[index]);
+      if (dir.empty() || archivedDirs_.count(dir) || !seen.insert(dir).second)
+         continue;
+
+      FilePath dirPath = tempDir.complete(dir);
+      if (!dirPath.exists())
+         continue;
+
+      uintmax_t size = dirPath.sizeRecursive();
+      total += size;
+      if (dir != currentDir)
+         dirs.push_back(std::make_pair(dir, size));
+   }
+
+   for (std::size_t i = 0; i < dirs.size() && total > kMaxExpandedBytes; i++)
+   {
+      Error error = archiveDir(dirs[i].first);
+      if (error)
+      {
+         LOG_ERROR(error);
+         continue;
+      }
+
+      archivedDirs_.insert(dirs[i].first);
+      total -= dirs[i].second;
+   }
+}
+
 namespace {
 
 FilePath historyEntriesPath(const core::FilePath& serializationPath)
@@ -170,11 +389,23 @@ void ViewerHistory::saveTo(const core::FilePath& serializationPath) const
       return;
    }
 
-   // copy the files
+   // copy the files (or their archives)
    FilePath tempDir = module_context::tempDir();
    BOOST_FOREACH(const ViewerHistoryEntry& entry, entries_)
    {
-      Error error = entry.copy(tempDir, serializationPath);
+      std::string dir = entryDir(entry);
+      Error error;
+      if (archivedDirs_.count(dir))
+      {
+         FilePath archive = archivePath(serializationPath, dir);
+         error = archive.parent().ensureDirectory();
+         if (!error && !archive.exists())
+            error = archivePath(tempDir, dir).copy(archive);
+      }
+      else
+      {
+         error = entry.copy(tempDir, serializationPath);
+      }
       if (error)
          LOG_ERROR(error);
    }
@@ -187,8 +418,7 @@ void ViewerHistory::restoreFrom(const core::FilePath& serializationPath)
       return;
 
    // clear existing
-   currentIndex_ = -1;
-   entries_.clear();
+   clear();
 
    // check if we have an index path (bail if we can't find one)
    FilePath indexPath = currentIndexPath(serializationPath);
@@ -221,14 +451,32 @@ void ViewerHistory::restoreFrom(const core::FilePath& serializationPath)
       return;
    }
 
-   // copy the files to the session temp dir
+   // copy the files (or their archives) to the session temp dir
    FilePath tempDir = module_context::tempDir();
    BOOST_FOREACH(const ViewerHistoryEntry& entry, entries_)
    {
-      Error error = entry.copy(serializationPath, tempDir);
+      std::string dir = entryDir(entry);
+      FilePath archive = archivePath(serializationPath, dir);
+      Error error;
+      if (!dir.empty() && archive.exists())
+      {
+         if (!archivedDirs_.insert(dir).second)
+            continue;
+         error = archivePath(tempDir, dir).parent().ensureDirectory();
+         if (!error)
+            error = archive.copy(archivePath(tempDir, dir));
+      }
+      else
+      {
+         error = entry.copy(serializationPath, tempDir);
+      }
       if (error)
          LOG_ERROR(error);
    }
+
+   // (the current entry is always expanded)
+   if (currentIndex_ >= 0 && currentIndex_ < static_cast<int>(entries_.size()))
+      ensureExpanded(entries_[currentIndex_]);
 }
 
 
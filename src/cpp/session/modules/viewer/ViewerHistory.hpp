@@ -16,6 +16,9 @@
 #ifndef SESSION_VIEWER_HISTORY_HPP
 #define SESSION_VIEWER_HISTORY_HPP
 
+#include <set>
+#include <string>
+
 #include <boost/utility.hpp>
 #include <boost/circular_buffer.hpp>
 
@@ -35,6 +38,10 @@ namespace viewer {
 class ViewerHistory;
 ViewerHistory& viewerHistory();
 
+// history of the html widgets shown in the viewer. the history holds at most
+// 20 entries, and (other than the current entry's) the directories of those
+// beyond a budget of 50MB are compressed into archives, to be expanded again
+// when navigated back (or forward) to
 class ViewerHistory : boost::noncopyable
 {
 private:
@@ -57,10 +64,20 @@ public:
    void saveTo(const core::FilePath& serializationPath) const;
    void restoreFrom(const core::FilePath& serializationPath);
 
+private:
+   void ensureExpanded(const module_context::ViewerHistoryEntry& entry);
+   void scheduleEnforceBudget();
+   void enforceBudget();
+
 private:
    int currentIndex_;
    boost::circular_buffer<module_context::ViewerHistoryEntry> entries_;
 
+   // the entries' directories (relative to the session temp dir) which are
+   // held in archives
+   std::set<std::string> archivedDirs_;
+   bool enforceBudgetScheduled_;
+
 };
                        
 } // namespace viewer
@@ -33,6 +33,7 @@
 
 #include <session/SessionConstants.hpp>
 
+#include <session/http/SessionPostbackChannel.hpp>
 #include <session/http/SessionRequest.hpp>
 
 #include "PostbackOptions.hpp"
@@ -65,6 +66,24 @@ int main(int argc, char * const argv[])
       if ( status.exit() )
          return status.exitCode() ;
       
+      // prefer the session's postback channel (if it can't be reached then
+      // fall back on a session request)
+      if (session::http::postbackChannelAvailable())
+      {
+         int exitCode;
+         std::string output;
+         error = session::http::sendPostbackChannelRequest(options.command(),
+                                                           options.argument(),
+                                                           &exitCode,
+                                                           &output);
+         if (!error)
+         {
+            std::cout << output;
+            return exitCode;
+         }
+         LOG_ERROR(error);
+      }
+
       http::Response response;
       error = session::http::sendSessionRequest(
             kLocalUriLocationPrefix kPostbackUriScope + options.command(), 
@@ -33,6 +33,7 @@
 #include <r/RExec.hpp>
 #include <r/RRoutines.hpp>
 
+#include <session/DebouncedFileChangeHandler.hpp>
 #include <session/SessionUserSettings.hpp>
 #include <session/SessionModuleContext.hpp>
 
@@ -409,15 +410,11 @@ Error ProjectContext::initialize()
       // compute the default encoding
       updateDefaultEncoding();
 
-      // augment .Rbuildignore if this is a package
-      augmentRbuildignore();
-
-      // subscribe to deferred init (for initializing our file monitor)
-      if (config().enableCodeIndexing)
-      {
-         module_context::events().onDeferredInit.connect(
-                      boost::bind(&ProjectContext::onDeferredInit, this, _1));
-      }
+      // subscribe to deferred init (for augmenting .Rbuildignore and
+      // initializing our file monitor, neither of which is needed for the
+      // session to start)
+      module_context::events().onDeferredInit.connect(
+                   boost::bind(&ProjectContext::onDeferredInit, this, _1));
    }
    else
    {
@@ -431,6 +428,17 @@ Error ProjectContext::initialize()
 
 void ProjectContext::onDeferredInit(bool newSession)
 {
+   // augment .Rbuildignore if this is a package
+   augmentRbuildignore();
+
+   if (!config().enableCodeIndexing)
+      return;
+
+   // collapse bursts of changes (e.g. from a git checkout) into a single
+   // batch for the client and subscribers
+   pFileChangeHandler_ = DebouncedFileChangeHandler::create(
+            boost::bind(&ProjectContext::notifyFilesChanged, this, _1));
+
    // kickoff file monitoring for this directory
    using boost::bind;
    core::system::file_monitor::Callbacks cb;
@@ -444,11 +452,14 @@ void ProjectContext::onDeferredInit(bool newSession)
                             this, _1);
    cb.onUnregistered = bind(&ProjectContext::fileMonitorTermination,
                             this, Success());
+   // the monitor sees everything but git's own metadata (some subscribers
+   // track files the listing hides); the file listing filter is applied
+   // as changes are passed on to the client and subscribers
    core::system::file_monitor::registerMonitor(
-                                         directory(),
-                                         true,
-                                         module_context::fileListingFilter,
-                                         cb);
+                     directory(),
+                     true,
+                     core::system::file_monitor::excludeDirectoryFilter(".git"),
+                     cb);
 }
 
 void ProjectContext::fileMonitorRegistered(
@@ -458,18 +469,68 @@ void ProjectContext::fileMonitorRegistered(
    // update state
    hasFileMonitor_ = true;
 
-   // notify subscribers
-   onMonitoringEnabled_(files);
+   // notify subscribers (of the files the listing would show)
+   tree<core::FileInfo> listedFiles = files;
+   tree<core::FileInfo>::iterator it = listedFiles.begin();
+   if (it != listedFiles.end())
+      ++it; // the project directory itself
+   while (it != listedFiles.end())
+   {
+      if (module_context::fileListingFilter(*it))
+         ++it;
+      else
+         it = listedFiles.erase(it);
+   }
+   onMonitoringEnabled_(listedFiles);
 }
 
 void ProjectContext::fileMonitorFilesChanged(
                    const std::vector<core::system::FileChangeEvent>& events)
 {
-   // notify client (gwt)
-   module_context::enqueFileChangedEvents(directory(), events);
+   pFileChangeHandler_->enqueFileChanges(events);
+}
+
+void ProjectContext::notifyFilesChanged(
+                   const std::vector<core::system::FileChangeEvent>& events)
+{
+   // changes to files the listing hides (or within directories it hides)
+   // only go to subscribers of the unfiltered stream
+   std::vector<core::system::FileChangeEvent> listedEvents;
+   BOOST_FOREACH(const core::system::FileChangeEvent& event, events)
+   {
+      if (isListedFile(event.fileInfo()))
+         listedEvents.push_back(event);
+   }
+
+   if (!listedEvents.empty())
+   {
+      // notify client (gwt)
+      module_context::enqueFileChangedEvents(directory(), listedEvents);
+
+      // notify subscribers
+      onFilesChanged_(listedEvents);
+   }
+
+   onUnfilteredFilesChanged_(events);
+}
+
+bool ProjectContext::isListedFile(const core::FileInfo& fileInfo) const
+{
+   if (!module_context::fileListingFilter(fileInfo))
+      return false;
+
+   FilePath parent = FilePath(fileInfo.absolutePath()).parent();
+   while (parent.isWithin(directory()) && parent != directory())
+   {
+      if (!module_context::fileListingFilter(
+                              core::FileInfo(parent.absolutePath(), true)))
+      {
+         return false;
+      }
+      parent = parent.parent();
+   }
 
-   // notify subscribers
-   onFilesChanged_(events);
+   return true;
 }
 
 void ProjectContext::fileMonitorTermination(const Error& error)
@@ -484,6 +545,10 @@ void ProjectContext::fileMonitorTermination(const Error& error)
       // do this only once
       hasFileMonitor_ = false;
 
+      // subscribers are about to discard their state
+      if (pFileChangeHandler_)
+         pFileChangeHandler_->clear();
+
       // notify end-user if this was an error condition
       if (error)
       {
@@ -534,10 +599,18 @@ void ProjectContext::subscribeToFileMonitor(const std::string& featureName,
       onMonitoringEnabled_.connect(cb.onMonitoringEnabled);
    if (cb.onFilesChanged)
       onFilesChanged_.connect(cb.onFilesChanged);
+   if (cb.onUnfilteredFilesChanged)
+      onUnfilteredFilesChanged_.connect(cb.onUnfilteredFilesChanged);
    if (cb.onMonitoringDisabled)
       onMonitoringDisabled_.connect(cb.onMonitoringDisabled);
 }
 
+void ProjectContext::flushFileChanges()
+{
+   if (pFileChangeHandler_)
+      pFileChangeHandler_->flush();
+}
+
 std::string ProjectContext::defaultEncoding() const
 {
    return defaultEncoding_;
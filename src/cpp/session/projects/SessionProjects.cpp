@@ -982,20 +982,58 @@ ProjectContext& projectContext()
    return s_projectContext;
 }
 
+namespace {
+
+// the formats of the website are read from its index file (and the output
+// options shared by its files), so they're enumerated again only when one
+// of those changes
+std::string websiteFormatsKey(const FilePath& websiteDir,
+                              const std::string& encoding)
+{
+   std::string key = websiteDir.absolutePath() + ":" + encoding;
+   const char* const files[] = { "index.Rmd", "index.md",
+                                 "_output.yml", "_output.yaml" };
+   BOOST_FOREACH(const char* file, files)
+   {
+      FilePath filePath = websiteDir.complete(file);
+      key += ":";
+      if (filePath.exists())
+         key += safe_convert::numberToString(filePath.lastWriteTime());
+   }
+   return key;
+}
+
+} // anonymous namespace
+
 json::Array websiteOutputFormatsJson()
 {
+   static std::string s_formatsKey;
+   static json::Array s_formatsJson;
+
    json::Array formatsJson;
    if (projectContext().config().buildType == r_util::kBuildTypeWebsite)
    {
+      FilePath websiteDir = projectContext().buildTargetPath();
+      std::string key = websiteFormatsKey(websiteDir,
+                                          projectContext().defaultEncoding());
+      if (key == s_formatsKey)
+         return s_formatsJson;
+
       r::exec::RFunction getFormats(".rs.getAllOutputFormats");
       getFormats.addParam(string_utils::utf8ToSystem(
-              projectContext().buildTargetPath().absolutePath()));
+              websiteDir.absolutePath()));
       getFormats.addParam(projectContext().defaultEncoding());
       std::vector<std::string> formats;
       Error error = getFormats.call(&formats);
       if (error)
          LOG_ERROR(error);
       formatsJson = json::toJsonArray(formats);
+
+      if (!error)
+      {
+         s_formatsKey = key;
+         s_formatsJson = formatsJson;
+      }
    }
    return formatsJson;
 }
@@ -363,6 +363,7 @@ var PagedTable = function (pagedTable) {
         );
 
         for (var idxRow = 0; idxRow < Math.min(widthsLookAhead, data.length); idxRow++) {
+          if (typeof(data[idxRow]) === "undefined") continue;
           maxChars = Math.max(maxChars, data[idxRow][column.name.toString()].length);
         }
 
@@ -452,6 +453,13 @@ var PagedTable = function (pagedTable) {
   };
 
   var data = source.data;
+
+  // when the source is paged, only the first rows are included; the rest are
+  // fetched from the paging url as they're displayed
+  var paging = typeof(source.paging) !== "undefined" ? source.paging : null;
+  if (paging !== null && paging.total > data.length) data.length = paging.total;
+  var pendingRows = false;
+
   var page = new Page(data, options);
   var measurer = new Measurer(data, options);
   var columns = new Columns(data, source.columns, options);
@@ -655,9 +663,38 @@ var PagedTable = function (pagedTable) {
     }
   };
 
+  var fetchRows = function(start, count) {
+    pendingRows = true;
+
+    var request = new XMLHttpRequest();
+    request.open("GET", paging.url + "?start=" + start + "&count=" + count);
+    request.onreadystatechange = function() {
+      if (request.readyState !== 4) return;
+      pendingRows = false;
+      if (request.status !== 200) return;
+
+      var rows = JSON.parse(request.responseText);
+      rows.forEach(function(row, idxRow) {
+        data[start + idxRow] = row;
+      });
+
+      if (rows.length > 0) renderBody();
+    };
+    request.send();
+  };
+
   var renderBody = function(clear) {
     cachedPagedTableClientWidth = pagedTable.clientWidth
 
+    if (paging !== null && !pendingRows) {
+      for (var idxMissing = page.getRowStart(); idxMissing < page.getRowEnd(); idxMissing++) {
+        if (typeof(data[idxMissing]) === "undefined") {
+          fetchRows(idxMissing, Math.max(page.rows, 100));
+          break;
+        }
+      }
+    }
+
     var fragment = document.createDocumentFragment();
 
     var pageData = data.slice(page.getRowStart(), page.getRowEnd());
@@ -1,7 +1,7 @@
 /*
  * SessionWebRequestWorker.cpp
  *
- * Copyright (C) 2009-12 by RStudio, Inc.
+ * Copyright (C) 2009-18 by RStudio, Inc.
  *
  * Unless you have received this program directly from RStudio pursuant
  * to the terms of a commercial license agreement with RStudio, then
@@ -13,7 +13,27 @@
  *
  */
 
+#include <map>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <boost/asio/io_service.hpp>
+
 #include <core/Error.hpp>
+#include <core/Thread.hpp>
+
+#include <core/http/Request.hpp>
+#include <core/http/Response.hpp>
+#include <core/http/TcpIpAsyncClient.hpp>
+#include <core/http/URL.hpp>
+
+#ifndef _WIN32
+#include <core/http/TcpIpAsyncClientSsl.hpp>
+#endif
 
 #include <session/SessionWorkerContext.hpp>
 
@@ -26,20 +46,263 @@ namespace web_request {
 
 namespace {
 
+const boost::posix_time::time_duration kConnectionTimeout =
+                                          boost::posix_time::seconds(30);
+
+// requests are executed on an io_service run by a thread of its own (so that
+// the rpc worker threads waiting on them needn't drive the io themselves)
+boost::asio::io_service s_ioService;
+
+void runIoService()
+{
+   // keep running while idle between requests
+   boost::asio::io_service::work work(s_ioService);
+   s_ioService.run();
+}
+
+// the outcome of a request, which the client's handlers deliver to the rpc
+// worker thread waiting on it
+class RequestResult : boost::noncopyable
+{
+public:
+   RequestResult()
+      : complete_(false)
+   {
+   }
+
+   void complete(const http::Response& response, const Error& error)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         if (complete_)
+            return;
+
+         complete_ = true;
+         response_.assign(response);
+         error_ = error;
+      }
+      END_LOCK_MUTEX
+
+      completed_.notify_all();
+   }
+
+   Error wait(http::Response* pResponse)
+   {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (!complete_)
+         completed_.wait(lock);
+
+      pResponse->assign(response_);
+      return error_;
+   }
+
+private:
+   boost::mutex mutex_;
+   boost::condition completed_;
+   bool complete_;
+   http::Response response_;
+   Error error_;
+};
+
+void handleResponse(boost::shared_ptr<RequestResult> pResult,
+                    const http::Response& response)
+{
+   pResult->complete(response, Success());
+}
+
+void handleError(boost::shared_ptr<RequestResult> pResult,
+                 const Error& error)
+{
+   pResult->complete(http::Response(), error);
+}
+
+void initializeRequest(const http::URL& url,
+                       const std::string& method,
+                       http::Request* pRequest)
+{
+   pRequest->setMethod(method);
+   pRequest->setUri(url.path());
+   pRequest->setHost(url.host());
+   pRequest->setHeader("Accept", "*/*");
+}
+
+#ifndef _WIN32
+
+// established connections to each server ("host:port") which are idle and
+// available for reuse, so that repeated requests to the same server (e.g.
+// the polling of a repository) needn't reconnect and handshake each time
+typedef http::TcpIpAsyncClientSsl::PersistentConnection SslConnection;
+
+const std::size_t kMaxIdleConnectionsPerServer = 4;
+
+boost::mutex s_poolMutex;
+std::map<std::string, std::vector<SslConnection> > s_idleConnections;
+
+SslConnection checkoutConnection(const std::string& server)
+{
+   LOCK_MUTEX(s_poolMutex)
+   {
+      std::vector<SslConnection>& connections = s_idleConnections[server];
+      if (!connections.empty())
+      {
+         SslConnection pConnection = connections.back();
+         connections.pop_back();
+         return pConnection;
+      }
+   }
+   END_LOCK_MUTEX
+
+   return SslConnection();
+}
+
+void checkinConnection(const std::string& server,
+                       const SslConnection& pConnection)
+{
+   LOCK_MUTEX(s_poolMutex)
+   {
+      std::vector<SslConnection>& connections = s_idleConnections[server];
+      if (connections.size() < kMaxIdleConnectionsPerServer)
+         connections.push_back(pConnection);
+   }
+   END_LOCK_MUTEX
+}
+
+void handleSslResponse(http::TcpIpAsyncClientSsl* pClient,
+                       const std::string& server,
+                       boost::shared_ptr<RequestResult> pResult,
+                       const http::Response& response)
+{
+   // return the connection to the pool before waking the waiting thread
+   // (the client is guaranteed to be alive while it calls its handler)
+   SslConnection pConnection = pClient->releaseConnection();
+   if (pConnection)
+      checkinConnection(server, pConnection);
+
+   pResult->complete(response, Success());
+}
+
+Error executeSslRequest(const http::URL& url,
+                        const std::string& method,
+                        http::Response* pResponse)
+{
+   std::string server = url.hostname() + ":" + url.portStr();
+
+   // a pooled connection may have since been closed by the server, in which
+   // case the request is retried (once) on a fresh connection
+   for (int attempt = 0; attempt < 2; attempt++)
+   {
+      boost::shared_ptr<http::TcpIpAsyncClientSsl> pClient(
+               new http::TcpIpAsyncClientSsl(s_ioService,
+                                             url.hostname(),
+                                             url.portStr(),
+                                             true,
+                                             kConnectionTimeout));
+      pClient->setPersistentConnection(
+               attempt == 0 ? checkoutConnection(server) : SslConnection());
+      initializeRequest(url, method, &pClient->request());
+
+      boost::shared_ptr<RequestResult> pResult(new RequestResult());
+      pClient->execute(
+               boost::bind(handleSslResponse, pClient.get(), server, pResult, _1),
+               boost::bind(handleError, pResult, _1));
+
+      Error error = pResult->wait(pResponse);
+      if (!error || !pClient->reusedConnection())
+         return error;
+   }
+
+   // not reached
+   return Success();
+}
+
+#else
+
+Error executeSslRequest(const http::URL& url,
+                        const std::string& method,
+                        http::Response* pResponse)
+{
+   return systemError(boost::system::errc::protocol_not_supported,
+                      ERROR_LOCATION);
+}
+
+#endif
+
+Error executeRequest(const http::URL& url,
+                     const std::string& method,
+                     http::Response* pResponse)
+{
+   boost::shared_ptr<http::TcpIpAsyncClient> pClient(
+            new http::TcpIpAsyncClient(s_ioService,
+                                       url.hostname(),
+                                       url.portStr(),
+                                       kConnectionTimeout));
+   initializeRequest(url, method, &pClient->request());
+
+   boost::shared_ptr<RequestResult> pResult(new RequestResult());
+   pClient->execute(boost::bind(handleResponse, pResult, _1),
+                    boost::bind(handleError, pResult, _1));
+
+   return pResult->wait(pResponse);
+}
+
 Error webRequest(const json::JsonRpcRequest& request,
                  json::JsonRpcResponse* pResponse)
 {
+   // the method is optional (defaulting to GET)
+   std::string urlString, method = "GET";
+   Error error = json::readParam(request.params, 0, &urlString);
+   if (error)
+      return error;
+   if (request.params.size() > 1)
+   {
+      error = json::readParam(request.params, 1, &method);
+      if (error)
+         return error;
+   }
 
+   http::URL url(urlString);
+   if (!url.isValid())
+      return systemError(boost::system::errc::invalid_argument, ERROR_LOCATION);
 
+   http::Response response;
+   if (url.protocol() == "https")
+      error = executeSslRequest(url, method, &response);
+   else if (url.protocol() == "http")
+      error = executeRequest(url, method, &response);
+   else
+      error = systemError(boost::system::errc::protocol_not_supported,
+                          ERROR_LOCATION);
+   if (error)
+   {
+      error.addProperty("url", urlString);
+      return error;
+   }
+
+   json::Object headersJson;
+   BOOST_FOREACH(const http::Header& header, response.headers())
+   {
+      headersJson[header.name] = header.value;
+   }
+
+   json::Object resultJson;
+   resultJson["status"] = response.statusCode();
+   resultJson["headers"] = headersJson;
+   resultJson["body"] = response.body();
+   pResponse->setResult(resultJson);
 
    return Success();
 }
 
-} // anonymouys namespace
+} // anonymous namespace
 
 Error initialize()
 {
-   return worker_context::registerWorkerRpcMethod("web_request", webRequest);
+   core::thread::safeLaunchThread(runIoService);
+
+   // requests are executed on the rpc worker threads rather than holding
+   // up the main thread for the duration of the network round trip
+   return worker_context::registerWorkerSafeRpcMethod("web_request",
+                                                      webRequest);
 }
 
 } // namespace web_request
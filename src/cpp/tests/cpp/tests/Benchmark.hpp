@@ -0,0 +1,93 @@
+/*
+ * Benchmark.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+// Include this to define benchmarks. Each benchmark is a function which
+// performs the operation being measured the given number of times:
+//
+//    BENCHMARK(json, parse)
+//    {
+//       for (std::size_t i = 0; i < iterations; i++)
+//          tests::benchmark::doNotOptimize(json::parse(...));
+//    }
+//
+// Input for a benchmark is best built once, in function-local statics; the
+// runner calls each benchmark once before timing it. See BenchmarkMain.hpp
+// for the runner.
+
+#ifndef TESTS_BENCHMARK_HPP
+#define TESTS_BENCHMARK_HPP
+
+#include <string>
+#include <vector>
+
+namespace rstudio {
+namespace tests {
+namespace benchmark {
+
+typedef void (*BenchmarkFunction)(std::size_t iterations);
+
+struct Benchmark
+{
+   std::string suite;
+   std::string name;
+   BenchmarkFunction function;
+};
+
+inline std::vector<Benchmark>& benchmarks()
+{
+   static std::vector<Benchmark> instance;
+   return instance;
+}
+
+struct Registrar
+{
+   Registrar(const char* suite, const char* name, BenchmarkFunction function)
+   {
+      Benchmark benchmark;
+      benchmark.suite = suite;
+      benchmark.name = name;
+      benchmark.function = function;
+      benchmarks().push_back(benchmark);
+   }
+};
+
+// keeps the compiler from optimizing away a computation whose result is
+// otherwise unused
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+   asm volatile("" : : "g"(&value) : "memory");
+#else
+   static const void* volatile sink;
+   sink = &value;
+#endif
+}
+
+} // namespace benchmark
+} // namespace tests
+} // namespace rstudio
+
+#define RSTUDIO_BENCHMARK_FUNCTION(suite, name) benchmark_##suite##_##name
+#define RSTUDIO_BENCHMARK_REGISTRAR(suite, name) registrar_##suite##_##name
+
+#define BENCHMARK(suite, name)                                                 \
+   static void RSTUDIO_BENCHMARK_FUNCTION(suite, name)(std::size_t);           \
+   static ::rstudio::tests::benchmark::Registrar                               \
+      RSTUDIO_BENCHMARK_REGISTRAR(suite, name)(                                \
+         #suite, #name, &RSTUDIO_BENCHMARK_FUNCTION(suite, name));             \
+   static void RSTUDIO_BENCHMARK_FUNCTION(suite, name)(std::size_t iterations)
+
+#endif // TESTS_BENCHMARK_HPP
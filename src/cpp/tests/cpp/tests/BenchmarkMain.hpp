@@ -0,0 +1,186 @@
+/*
+ * BenchmarkMain.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+// Include this (once) to build a benchmark executable. The executable runs
+// the benchmarks and writes their results as JSON, so that results can be
+// compared across builds and releases. Options:
+//
+//    --filter <text>     run only benchmarks whose suite/name contains text
+//    --min-time <ms>     time each repetition for at least this long
+//    --label <text>      label the results (e.g. with the version built)
+//    --output <file>     write the results to file rather than stdout
+
+#ifndef TESTS_BENCHMARKMAIN_HPP
+#define TESTS_BENCHMARKMAIN_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/chrono.hpp>
+#include <boost/foreach.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/json/Json.hpp>
+
+#include "Benchmark.hpp"
+
+namespace rstudio {
+namespace tests {
+namespace benchmark {
+namespace {
+
+// each benchmark is timed this many times (at the same number of
+// iterations) so that the spread of its timings can be seen
+const int kRepetitions = 5;
+
+double timeIterations(const Benchmark& benchmark, std::size_t iterations)
+{
+   using namespace boost::chrono;
+   steady_clock::time_point start = steady_clock::now();
+   benchmark.function(iterations);
+   return duration<double, boost::nano>(steady_clock::now() - start).count();
+}
+
+core::json::Object runBenchmark(const Benchmark& benchmark, double minTimeNs)
+{
+   // first call builds any inputs (and warms caches)
+   benchmark.function(1);
+
+   // find a number of iterations which takes at least the minimum time
+   std::size_t iterations = 1;
+   double elapsedNs = timeIterations(benchmark, iterations);
+   while (elapsedNs < minTimeNs && iterations < 1000000000)
+   {
+      // grow toward the minimum time, but not by too much at once (the
+      // estimate is poor when the elapsed time is small)
+      double scale = elapsedNs > 0 ? (minTimeNs * 1.2) / elapsedNs : 100;
+      scale = std::min(std::max(scale, 2.0), 100.0);
+      iterations = static_cast<std::size_t>(iterations * scale);
+      elapsedNs = timeIterations(benchmark, iterations);
+   }
+
+   std::vector<double> nsPerOp;
+   nsPerOp.push_back(elapsedNs / iterations);
+   for (int i = 1; i < kRepetitions; i++)
+      nsPerOp.push_back(timeIterations(benchmark, iterations) / iterations);
+
+   std::sort(nsPerOp.begin(), nsPerOp.end());
+   double totalNs = 0;
+   core::json::Array timings;
+   BOOST_FOREACH(double ns, nsPerOp)
+   {
+      totalNs += ns;
+      timings.push_back(ns);
+   }
+
+   core::json::Object result;
+   result["suite"] = benchmark.suite;
+   result["name"] = benchmark.name;
+   result["iterations"] = static_cast<boost::int64_t>(iterations);
+   result["repetitions"] = kRepetitions;
+   result["ns_per_op_min"] = nsPerOp.front();
+   result["ns_per_op_median"] = nsPerOp[nsPerOp.size() / 2];
+   result["ns_per_op_mean"] = totalNs / nsPerOp.size();
+   result["ns_per_op"] = timings;
+   return result;
+}
+
+int run(int argc, char** argv)
+{
+   std::string filter, label, output;
+   double minTimeMs = 100;
+   for (int i = 1; i < argc; i++)
+   {
+      std::string arg = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (arg == "--filter" && hasValue)
+         filter = argv[++i];
+      else if (arg == "--label" && hasValue)
+         label = argv[++i];
+      else if (arg == "--output" && hasValue)
+         output = argv[++i];
+      else if (arg == "--min-time" && hasValue)
+         minTimeMs = std::atof(argv[++i]);
+      else
+      {
+         std::cerr << "Usage: " << argv[0] << " [--filter <text>] "
+                   << "[--min-time <ms>] [--label <text>] [--output <file>]"
+                   << std::endl;
+         return EXIT_FAILURE;
+      }
+   }
+
+   core::json::Array results;
+   BOOST_FOREACH(const Benchmark& benchmark, benchmarks())
+   {
+      std::string fullName = benchmark.suite + "/" + benchmark.name;
+      if (!filter.empty() && fullName.find(filter) == std::string::npos)
+         continue;
+
+      std::cerr << fullName << "... " << std::flush;
+      core::json::Object result = runBenchmark(benchmark, minTimeMs * 1e6);
+      std::cerr << result["ns_per_op_median"].get_real() << " ns/op"
+                << std::endl;
+      results.push_back(result);
+   }
+
+   core::json::Object context;
+   context["date"] = boost::posix_time::to_iso_extended_string(
+                        boost::posix_time::second_clock::universal_time());
+   context["label"] = label;
+#ifdef NDEBUG
+   context["optimized"] = true;
+#else
+   context["optimized"] = false;
+#endif
+   context["min_time_ms"] = minTimeMs;
+
+   core::json::Object report;
+   report["context"] = context;
+   report["benchmarks"] = results;
+
+   if (output.empty())
+   {
+      core::json::writeFormatted(report, std::cout);
+      std::cout << std::endl;
+      return EXIT_SUCCESS;
+   }
+
+   std::ofstream ostr(output.c_str());
+   core::json::writeFormatted(report, ostr);
+   ostr << std::endl;
+   if (!ostr)
+   {
+      std::cerr << "Unable to write " << output << std::endl;
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
+
+} // anonymous namespace
+} // namespace benchmark
+} // namespace tests
+} // namespace rstudio
+
+int main(int argc, char** argv)
+{
+   return rstudio::tests::benchmark::run(argc, argv);
+}
+
+#endif // TESTS_BENCHMARKMAIN_HPP
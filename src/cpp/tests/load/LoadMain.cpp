@@ -0,0 +1,378 @@
+/*
+ * LoadMain.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+// Applies load to an rserver by simulating users who sign in, start sessions
+// and then (with a think time between each) run console commands, view data
+// and draw plots; reports the throughput and latency of the requests made and
+// the cpu and memory used by the server's processes, as JSON. e.g.
+//
+//    rstudio-load --server localhost:8787 --users-file users.txt \
+//                 --duration 300 --ramp-up 60 --output results.json
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/deadline_timer.hpp>
+
+#include <core/Error.hpp>
+#include <core/Log.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/json/Json.hpp>
+#include <core/system/System.hpp>
+
+#include "LoadStats.hpp"
+#include "LoadUser.hpp"
+
+using namespace rstudio;
+using namespace rstudio::core;
+using namespace rstudio::load_test;
+
+namespace {
+
+struct User
+{
+   std::string username;
+   std::string password;
+};
+
+Error readUsers(const FilePath& usersFile, std::vector<User>* pUsers)
+{
+   std::vector<std::string> lines;
+   Error error = readStringVectorFromFile(usersFile, &lines);
+   if (error)
+      return error;
+
+   BOOST_FOREACH(std::string line, lines)
+   {
+      boost::algorithm::trim(line);
+      if (line.empty() || line[0] == '#')
+         continue;
+
+      std::vector<std::string> fields;
+      boost::algorithm::split(fields, line, boost::algorithm::is_space(),
+                              boost::algorithm::token_compress_on);
+      User user;
+      user.username = fields[0];
+      if (fields.size() > 1)
+         user.password = fields[1];
+      pUsers->push_back(user);
+   }
+   return Success();
+}
+
+Error parseActions(const std::string& actionsArg,
+                   std::vector<ActionType>* pActions)
+{
+   std::vector<std::string> names;
+   boost::algorithm::split(names, actionsArg, boost::algorithm::is_any_of(","));
+   BOOST_FOREACH(const std::string& name, names)
+   {
+      if (name == "console")
+         pActions->push_back(ActionConsole);
+      else if (name == "view")
+         pActions->push_back(ActionDataViewer);
+      else if (name == "plot")
+         pActions->push_back(ActionPlot);
+      else
+         return systemError(boost::system::errc::invalid_argument,
+                            "Unknown action: " + name,
+                            ERROR_LOCATION);
+   }
+   return Success();
+}
+
+void startUser(boost::shared_ptr<LoadUser> pUser,
+               const boost::system::error_code& ec)
+{
+   if (!ec)
+      pUser->start();
+}
+
+void stopLoad(boost::asio::io_service* pIoService,
+              std::vector<boost::shared_ptr<LoadUser> >* pUsers,
+              ResourceSampler* pSampler,
+              const boost::system::error_code& ec)
+{
+   if (ec)
+      return;
+
+   BOOST_FOREACH(boost::shared_ptr<LoadUser> pUser, *pUsers)
+   {
+      pUser->stop();
+   }
+   pSampler->stop();
+
+   // don't wait for requests under way (long polls may take some time)
+   pIoService->stop();
+}
+
+void printSummary(const json::Object& requests)
+{
+   json::Object::const_iterator operations = requests.find("operations");
+   if (operations == requests.end())
+      return;
+
+   const json::Object& ops = operations->second.get_obj();
+   for (json::Object::const_iterator it = ops.begin(); it != ops.end(); ++it)
+   {
+      const json::Object& op = it->second.get_obj();
+      std::cerr << it->first << ": "
+                << op.find("count")->second.get_int64() << " ok, "
+                << op.find("errors")->second.get_int64() << " errors, "
+                << op.find("per_second")->second.get_real() << "/s, "
+                << "p50 " << op.find("p50_ms")->second.get_real() << "ms, "
+                << "p95 " << op.find("p95_ms")->second.get_real() << "ms, "
+                << "p99 " << op.find("p99_ms")->second.get_real() << "ms"
+                << std::endl;
+   }
+}
+
+} // anonymous namespace
+
+int main(int argc, char * const argv[])
+{
+   try
+   {
+      initializeStderrLog("rstudio-load", core::system::kLogLevelWarning);
+
+      Error error = core::system::ignoreSignal(core::system::SigPipe);
+      if (error)
+         LOG_ERROR(error);
+
+      using namespace boost::program_options;
+      std::string server, socket, usersFile, userPrefix, password;
+      std::string actions, processes, output, label;
+      int userCount, duration, rampUp, thinkTimeMs, sampleMs;
+      UserOptions userOptions;
+
+      options_description options("rstudio-load");
+      options.add_options()
+         ("help", "print this help")
+         ("server",
+            value<std::string>(&server)->default_value("localhost:8787"),
+            "server address and port")
+         ("socket",
+            value<std::string>(&socket),
+            "server local stream socket (rather than address and port)")
+         ("users-file",
+            value<std::string>(&usersFile),
+            "file with a 'username password' line for each user")
+         ("users",
+            value<int>(&userCount)->default_value(10),
+            "number of users (when there is no users file)")
+         ("user-prefix",
+            value<std::string>(&userPrefix)->default_value("user"),
+            "usernames (with the user's number appended)")
+         ("password",
+            value<std::string>(&password),
+            "password of every user (when there is no users file)")
+         ("no-encrypt-password",
+            "send passwords unencrypted (auth-encrypt-password=0)")
+         ("duration",
+            value<int>(&duration)->default_value(120),
+            "seconds to apply load for (including the ramp up)")
+         ("ramp-up",
+            value<int>(&rampUp)->default_value(30),
+            "seconds over which to start the users")
+         ("think-time",
+            value<int>(&thinkTimeMs)->default_value(3000),
+            "mean milliseconds between a user's actions")
+         ("actions",
+            value<std::string>(&actions)->default_value("console,view,plot"),
+            "actions users take in turn (console, view, plot)")
+         ("console-code",
+            value<std::string>(&userOptions.consoleCode)->default_value(
+               "x <- sum(rnorm(1e5))"),
+            "code run by the console action")
+         ("view-code",
+            value<std::string>(&userOptions.dataViewerCode)->default_value(
+               "View(mtcars)"),
+            "code run by the data viewer action")
+         ("plot-code",
+            value<std::string>(&userOptions.plotCode)->default_value(
+               "plot(rnorm(1000))"),
+            "code run by the plot action")
+         ("processes",
+            value<std::string>(&processes)->default_value("rserver,rsession"),
+            "names of the processes whose resources are sampled")
+         ("sample-interval",
+            value<int>(&sampleMs)->default_value(1000),
+            "milliseconds between samples of the processes' resources")
+         ("label",
+            value<std::string>(&label),
+            "label for the results (e.g. the version under test)")
+         ("output",
+            value<std::string>(&output),
+            "file to write the results to (rather than stdout)");
+
+      variables_map vm;
+      store(parse_command_line(argc, argv, options), vm);
+      notify(vm);
+
+      if (vm.count("help"))
+      {
+         std::cerr << options << std::endl;
+         return EXIT_SUCCESS;
+      }
+
+      // users
+      std::vector<User> users;
+      if (!usersFile.empty())
+      {
+         error = readUsers(FilePath(usersFile), &users);
+         if (error)
+         {
+            LOG_ERROR(error);
+            return EXIT_FAILURE;
+         }
+      }
+      else
+      {
+         for (int i = 1; i <= userCount; i++)
+         {
+            User user;
+            user.username = userPrefix + safe_convert::numberToString(i);
+            user.password = password;
+            users.push_back(user);
+         }
+      }
+      if (users.empty())
+      {
+         std::cerr << "No users to simulate" << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      // options shared by all users
+      if (!socket.empty())
+      {
+         userOptions.localStreamPath = FilePath(socket);
+      }
+      else
+      {
+         std::string::size_type colon = server.rfind(':');
+         userOptions.address = server.substr(0, colon);
+         userOptions.port = colon != std::string::npos ?
+                               server.substr(colon + 1) : "80";
+      }
+      userOptions.encryptPassword = !vm.count("no-encrypt-password");
+      userOptions.thinkTime = boost::posix_time::milliseconds(thinkTimeMs);
+      error = parseActions(actions, &userOptions.actions);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return EXIT_FAILURE;
+      }
+
+      std::srand(static_cast<unsigned>(std::time(NULL)));
+
+      boost::asio::io_service ioService;
+      LoadStats stats;
+
+      std::vector<std::string> processNames;
+      boost::algorithm::split(processNames, processes,
+                              boost::algorithm::is_any_of(","));
+      ResourceSampler sampler(ioService, processNames,
+                              boost::posix_time::milliseconds(sampleMs));
+
+      // start the users evenly over the ramp up
+      std::vector<boost::shared_ptr<LoadUser> > loadUsers;
+      std::vector<boost::shared_ptr<boost::asio::deadline_timer> > startTimers;
+      for (std::size_t i = 0; i < users.size(); i++)
+      {
+         boost::shared_ptr<LoadUser> pUser(
+               new LoadUser(ioService, userOptions,
+                            users[i].username, users[i].password, &stats));
+         loadUsers.push_back(pUser);
+
+         long delayMs = static_cast<long>(rampUp * 1000.0 * i / users.size());
+         boost::shared_ptr<boost::asio::deadline_timer> pTimer(
+               new boost::asio::deadline_timer(
+                     ioService, boost::posix_time::milliseconds(delayMs)));
+         pTimer->async_wait(boost::bind(startUser, pUser, _1));
+         startTimers.push_back(pTimer);
+      }
+
+      boost::asio::deadline_timer stopTimer(ioService,
+                                            boost::posix_time::seconds(duration));
+      stopTimer.async_wait(boost::bind(stopLoad, &ioService, &loadUsers,
+                                       &sampler, _1));
+
+      std::cerr << "Simulating " << users.size() << " users for "
+                << duration << "s" << std::endl;
+
+      boost::posix_time::ptime started =
+            boost::posix_time::microsec_clock::universal_time();
+      sampler.start();
+      ioService.run();
+      double elapsedSeconds =
+            (boost::posix_time::microsec_clock::universal_time() - started)
+               .total_milliseconds() / 1000.0;
+
+      // report
+      json::Object context;
+      context["date"] = boost::posix_time::to_iso_extended_string(
+                           boost::posix_time::second_clock::universal_time());
+      context["label"] = label;
+      context["server"] = socket.empty() ? server : socket;
+      context["users"] = static_cast<boost::int64_t>(users.size());
+      context["duration_seconds"] = elapsedSeconds;
+      context["ramp_up_seconds"] = rampUp;
+      context["think_time_ms"] = thinkTimeMs;
+      context["actions"] = actions;
+
+      json::Object requests = stats.toJson(elapsedSeconds);
+      json::Object report;
+      report["context"] = context;
+      report["requests"] = requests;
+      report["resources"] = sampler.toJson(elapsedSeconds);
+
+      printSummary(requests);
+
+      if (output.empty())
+      {
+         json::writeFormatted(report, std::cout);
+         std::cout << std::endl;
+         return EXIT_SUCCESS;
+      }
+
+      std::ofstream ostr(output.c_str());
+      json::writeFormatted(report, ostr);
+      ostr << std::endl;
+      if (!ostr)
+      {
+         std::cerr << "Unable to write " << output << std::endl;
+         return EXIT_FAILURE;
+      }
+      return EXIT_SUCCESS;
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+
+   // if we got this far we had an unexpected exception
+   return EXIT_FAILURE;
+}
@@ -0,0 +1,263 @@
+/*
+ * LoadStats.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "LoadStats.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+
+#include <core/Error.hpp>
+#include <core/FilePath.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/system/PosixSystem.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace load_test {
+
+namespace {
+
+// the value at the given percentile of sorted values (nearest rank)
+double percentile(const std::vector<double>& sorted, double percent)
+{
+   if (sorted.empty())
+      return 0;
+
+   std::size_t rank = static_cast<std::size_t>(
+                         (percent / 100.0) * sorted.size() + 0.5);
+   rank = std::min(std::max<std::size_t>(rank, 1), sorted.size());
+   return sorted[rank - 1];
+}
+
+json::Object latencyJson(std::vector<double> latencies,
+                         std::size_t errors,
+                         double elapsedSeconds)
+{
+   std::sort(latencies.begin(), latencies.end());
+
+   double totalMs = 0;
+   BOOST_FOREACH(double ms, latencies)
+   {
+      totalMs += ms;
+   }
+
+   json::Object result;
+   result["count"] = static_cast<boost::int64_t>(latencies.size());
+   result["errors"] = static_cast<boost::int64_t>(errors);
+   result["per_second"] = elapsedSeconds > 0 ?
+                             latencies.size() / elapsedSeconds : 0;
+   result["mean_ms"] = latencies.empty() ? 0 : totalMs / latencies.size();
+   result["p50_ms"] = percentile(latencies, 50);
+   result["p90_ms"] = percentile(latencies, 90);
+   result["p95_ms"] = percentile(latencies, 95);
+   result["p99_ms"] = percentile(latencies, 99);
+   result["max_ms"] = latencies.empty() ? 0 : latencies.back();
+   return result;
+}
+
+// the cpu time (user and system) the process has used
+Error processCpuSeconds(PidType pid, double* pSeconds)
+{
+   FilePath statPath("/proc/" + safe_convert::numberToString(pid) + "/stat");
+   std::string stat;
+   Error error = readStringFromFile(statPath, &stat);
+   if (error)
+      return error;
+
+   // the fields following the command (which may itself contain spaces)
+   // begin with the state; utime and stime are the 12th and 13th of them
+   std::string::size_type commandEnd = stat.rfind(')');
+   if (commandEnd == std::string::npos || commandEnd + 2 >= stat.size())
+      return systemError(boost::system::errc::protocol_error, ERROR_LOCATION);
+
+   std::vector<std::string> fields;
+   std::string rest = stat.substr(commandEnd + 2);
+   boost::algorithm::split(fields, rest, boost::algorithm::is_space());
+   if (fields.size() < 13)
+      return systemError(boost::system::errc::protocol_error, ERROR_LOCATION);
+
+   double ticks = safe_convert::stringTo<double>(fields[11], 0) +
+                  safe_convert::stringTo<double>(fields[12], 0);
+   *pSeconds = ticks / ::sysconf(_SC_CLK_TCK);
+   return Success();
+}
+
+} // anonymous namespace
+
+void LoadStats::recordSuccess(const std::string& operation, double ms)
+{
+   operations_[operation].latencies.push_back(ms);
+}
+
+void LoadStats::recordError(const std::string& operation,
+                            const std::string& message)
+{
+   Operation& op = operations_[operation];
+   op.errors++;
+   op.lastError = message;
+}
+
+json::Object LoadStats::toJson(double elapsedSeconds) const
+{
+   json::Object operations;
+   std::vector<double> allLatencies;
+   std::size_t allErrors = 0;
+   for (std::map<std::string, Operation>::const_iterator it =
+           operations_.begin(); it != operations_.end(); ++it)
+   {
+      const Operation& op = it->second;
+      json::Object opJson = latencyJson(op.latencies, op.errors,
+                                        elapsedSeconds);
+      if (!op.lastError.empty())
+         opJson["last_error"] = op.lastError;
+      operations[it->first] = opJson;
+
+      allLatencies.insert(allLatencies.end(),
+                          op.latencies.begin(), op.latencies.end());
+      allErrors += op.errors;
+   }
+
+   json::Object result;
+   result["total"] = latencyJson(allLatencies, allErrors, elapsedSeconds);
+   result["operations"] = operations;
+   return result;
+}
+
+ResourceSampler::ResourceSampler(
+                     boost::asio::io_service& ioService,
+                     const std::vector<std::string>& processNames,
+                     const boost::posix_time::time_duration& interval)
+   : timer_(ioService),
+     processNames_(processNames),
+     interval_(interval),
+     started_(false),
+     stopped_(false)
+{
+}
+
+void ResourceSampler::start()
+{
+   sample();
+   started_ = true;
+   scheduleSample();
+}
+
+void ResourceSampler::stop()
+{
+   if (stopped_)
+      return;
+
+   // take a last sample so cpu time covers the whole run
+   sample();
+   stopped_ = true;
+   boost::system::error_code ec;
+   timer_.cancel(ec);
+}
+
+void ResourceSampler::scheduleSample()
+{
+   timer_.expires_from_now(interval_);
+   timer_.async_wait(boost::bind(&ResourceSampler::onTimer, this,
+                                 boost::asio::placeholders::error));
+}
+
+void ResourceSampler::onTimer(const boost::system::error_code& ec)
+{
+   if (ec || stopped_)
+      return;
+
+   sample();
+   scheduleSample();
+}
+
+void ResourceSampler::sample()
+{
+   BOOST_FOREACH(const std::string& name, processNames_)
+   {
+      std::vector<system::ProcessInfo> processes;
+      Error error = system::processInfo(name, &processes, true);
+      if (error)
+         continue;
+
+      ProcessSamples& samples = samples_[name];
+      long rssKb = 0;
+      BOOST_FOREACH(const system::ProcessInfo& process, processes)
+      {
+         long processRssKb = 0;
+         if (!system::processResidentMemoryKb(process.pid, &processRssKb))
+            rssKb += processRssKb;
+
+         double cpuSeconds = 0;
+         if (processCpuSeconds(process.pid, &cpuSeconds))
+            continue;
+
+         std::map<PidType, std::pair<double, double> >::iterator it =
+                                          samples.cpuSeconds.find(process.pid);
+         if (it != samples.cpuSeconds.end())
+            it->second.second = cpuSeconds;
+         else
+            samples.cpuSeconds[process.pid] =
+                  std::make_pair(started_ ? 0 : cpuSeconds, cpuSeconds);
+      }
+
+      samples.samples++;
+      samples.maxProcesses = std::max(samples.maxProcesses, processes.size());
+      samples.totalRssKb += rssKb;
+      samples.maxRssKb = std::max(samples.maxRssKb, rssKb);
+   }
+}
+
+json::Object ResourceSampler::toJson(double elapsedSeconds) const
+{
+   json::Object result;
+   for (std::map<std::string, ProcessSamples>::const_iterator it =
+           samples_.begin(); it != samples_.end(); ++it)
+   {
+      const ProcessSamples& samples = it->second;
+
+      double cpuSeconds = 0;
+      for (std::map<PidType, std::pair<double, double> >::const_iterator
+              cpu = samples.cpuSeconds.begin();
+           cpu != samples.cpuSeconds.end();
+           ++cpu)
+      {
+         cpuSeconds += cpu->second.second - cpu->second.first;
+      }
+
+      json::Object processJson;
+      processJson["max_processes"] =
+            static_cast<boost::int64_t>(samples.maxProcesses);
+      processJson["cpu_seconds"] = cpuSeconds;
+      processJson["cpus_busy"] = elapsedSeconds > 0 ?
+                                    cpuSeconds / elapsedSeconds : 0;
+      processJson["mean_rss_mb"] = samples.samples > 0 ?
+            samples.totalRssKb / samples.samples / 1024 : 0;
+      processJson["max_rss_mb"] = samples.maxRssKb / 1024.0;
+      result[it->first] = processJson;
+   }
+   return result;
+}
+
+} // namespace load_test
+} // namespace rstudio
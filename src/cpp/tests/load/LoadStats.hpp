@@ -0,0 +1,113 @@
+/*
+ * LoadStats.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef LOAD_STATS_HPP
+#define LOAD_STATS_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/json/Json.hpp>
+#include <core/system/System.hpp>
+
+namespace rstudio {
+namespace load_test {
+
+// the latencies of the operations performed by the simulated users, by
+// operation (e.g. sign_in, console_input, plot)
+class LoadStats : boost::noncopyable
+{
+public:
+   LoadStats() {}
+
+   // COPYING: boost::noncopyable
+
+   void recordSuccess(const std::string& operation, double ms);
+   void recordError(const std::string& operation, const std::string& message);
+
+   // throughput, latency percentiles and errors of each operation (and of
+   // all of them together)
+   core::json::Object toJson(double elapsedSeconds) const;
+
+private:
+   struct Operation
+   {
+      Operation() : errors(0) {}
+
+      std::vector<double> latencies;
+      std::size_t errors;
+      std::string lastError;
+   };
+
+   std::map<std::string, Operation> operations_;
+};
+
+// samples the cpu time and resident memory of the processes with the given
+// names (e.g. rserver and rsession) while the load is applied; processes
+// first seen after sampling starts are assumed to have started since
+class ResourceSampler : boost::noncopyable
+{
+public:
+   ResourceSampler(boost::asio::io_service& ioService,
+                   const std::vector<std::string>& processNames,
+                   const boost::posix_time::time_duration& interval);
+
+   // COPYING: boost::noncopyable
+
+   void start();
+   void stop();
+
+   // cpu used (as a number of cpus busy over the elapsed time) and memory
+   // (mean and peak of the total resident across processes), by process
+   core::json::Object toJson(double elapsedSeconds) const;
+
+private:
+   void sample();
+   void scheduleSample();
+   void onTimer(const boost::system::error_code& ec);
+
+   struct ProcessSamples
+   {
+      ProcessSamples() : samples(0), maxProcesses(0), totalRssKb(0),
+                         maxRssKb(0)
+      {
+      }
+
+      // cpu seconds of each process when first and last seen
+      std::map<PidType, std::pair<double, double> > cpuSeconds;
+      std::size_t samples;
+      std::size_t maxProcesses;
+      double totalRssKb;
+      long maxRssKb;
+   };
+
+   boost::asio::deadline_timer timer_;
+   std::vector<std::string> processNames_;
+   boost::posix_time::time_duration interval_;
+   bool started_;
+   bool stopped_;
+   std::map<std::string, ProcessSamples> samples_;
+};
+
+} // namespace load_test
+} // namespace rstudio
+
+#endif // LOAD_STATS_HPP
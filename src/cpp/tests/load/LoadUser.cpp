@@ -0,0 +1,622 @@
+/*
+ * LoadUser.cpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "LoadUser.hpp"
+
+#include <cstdlib>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <core/Error.hpp>
+#include <core/SafeConvert.hpp>
+#include <core/http/LocalStreamAsyncClient.hpp>
+#include <core/http/TcpIpAsyncClient.hpp>
+#include <core/http/Util.hpp>
+#include <core/system/Crypto.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace load_test {
+
+namespace {
+
+const char * const kSignIn = "sign_in";
+const char * const kClientInit = "client_init";
+const char * const kSessionStart = "session_start";
+const char * const kGetEvents = "get_events";
+const char * const kConsoleInput = "console_input";
+const char * const kConsoleCommand = "console_command";
+const char * const kDataViewer = "data_viewer";
+const char * const kPlot = "plot";
+
+// how long to wait before retrying a request which failed in a way that
+// may be transient (e.g. while the session is starting)
+const int kRetryDelayMs = 1000;
+
+boost::posix_time::ptime now()
+{
+   return boost::posix_time::microsec_clock::universal_time();
+}
+
+double msSince(const boost::posix_time::ptime& time)
+{
+   return (now() - time).total_microseconds() / 1000.0;
+}
+
+const char* actionOperation(ActionType type)
+{
+   switch (type)
+   {
+      case ActionDataViewer:
+         return kDataViewer;
+      case ActionPlot:
+         return kPlot;
+      case ActionConsole:
+      default:
+         return kConsoleCommand;
+   }
+}
+
+} // anonymous namespace
+
+LoadUser::LoadUser(boost::asio::io_service& ioService,
+                   const UserOptions& options,
+                   const std::string& username,
+                   const std::string& password,
+                   LoadStats* pStats)
+   : ioService_(ioService),
+     options_(options),
+     username_(username),
+     password_(password),
+     pStats_(pStats),
+     stopped_(false),
+     lastEventId_(-1),
+     actionTimer_(ioService),
+     timeoutTimer_(ioService),
+     retryTimer_(ioService),
+     nextAction_(0)
+{
+}
+
+void LoadUser::start()
+{
+   requestPublicKey();
+}
+
+void LoadUser::stop()
+{
+   // requests under way are left to finish (their results are ignored)
+   stopped_ = true;
+   boost::system::error_code ec;
+   actionTimer_.cancel(ec);
+   timeoutTimer_.cancel(ec);
+   retryTimer_.cancel(ec);
+}
+
+void LoadUser::send(const std::string& operation,
+                    http::Request* pRequest,
+                    const ResponseHandler& onResponse,
+                    const FailureHandler& onFailure)
+{
+   boost::shared_ptr<http::IAsyncClient> pClient;
+   if (!options_.localStreamPath.empty())
+   {
+      pClient.reset(new http::LocalStreamAsyncClient(ioService_,
+                                                     options_.localStreamPath));
+   }
+   else
+   {
+      pClient.reset(new http::TcpIpAsyncClient(ioService_,
+                                               options_.address,
+                                               options_.port));
+   }
+
+   pClient->request().assign(*pRequest);
+   pClient->execute(
+         boost::bind(&LoadUser::handleResponse, shared_from_this(),
+                     operation, now(), onResponse, onFailure, _1),
+         boost::bind(&LoadUser::handleError, shared_from_this(),
+                     operation, onFailure, _1));
+}
+
+void LoadUser::handleResponse(const std::string& operation,
+                              const boost::posix_time::ptime& started,
+                              const ResponseHandler& onResponse,
+                              const FailureHandler& onFailure,
+                              const http::Response& response)
+{
+   if (stopped_)
+      return;
+
+   if (response.statusCode() >= http::status::BadRequest)
+   {
+      failed(operation, "HTTP status " +
+                        safe_convert::numberToString(response.statusCode()));
+      if (onFailure)
+         onFailure();
+      return;
+   }
+
+   pStats_->recordSuccess(operation, msSince(started));
+   onResponse(response);
+}
+
+void LoadUser::handleError(const std::string& operation,
+                           const FailureHandler& onFailure,
+                           const Error& error)
+{
+   if (stopped_)
+      return;
+
+   failed(operation, error.summary());
+   if (onFailure)
+      onFailure();
+}
+
+void LoadUser::failed(const std::string& operation, const std::string& message)
+{
+   pStats_->recordError(operation, message);
+}
+
+void LoadUser::initRequest(const std::string& method,
+                           const std::string& uri,
+                           http::Request* pRequest)
+{
+   pRequest->setMethod(method);
+   pRequest->setUri(uri);
+   if (options_.localStreamPath.empty())
+      pRequest->setHost(options_.address + ":" + options_.port);
+   else
+      pRequest->setHost("localhost");
+   pRequest->setHeader("Accept", "*/*");
+
+   if (!cookies_.empty())
+   {
+      std::string cookies;
+      for (std::map<std::string, std::string>::const_iterator it =
+              cookies_.begin(); it != cookies_.end(); ++it)
+      {
+         if (!cookies.empty())
+            cookies += "; ";
+         cookies += it->first + "=" + it->second;
+      }
+      pRequest->setHeader("Cookie", cookies);
+   }
+}
+
+void LoadUser::initRpcRequest(const std::string& uri,
+                              const std::string& method,
+                              const json::Array& params,
+                              http::Request* pRequest)
+{
+   json::Object rpc;
+   rpc["method"] = method;
+   rpc["params"] = params;
+   if (!clientId_.empty())
+      rpc["clientId"] = clientId_;
+
+   initRequest("POST", uri, pRequest);
+   pRequest->setContentType("application/json");
+   pRequest->setBody(json::write(rpc));
+}
+
+bool LoadUser::readRpcResult(const std::string& operation,
+                             const http::Response& response,
+                             json::Value* pResult)
+{
+   json::Value value;
+   if (!json::parse(response.body(), &value) ||
+       value.type() != json::ObjectType)
+   {
+      failed(operation, "Invalid JSON-RPC response");
+      return false;
+   }
+
+   const json::Object& object = value.get_obj();
+   json::Object::const_iterator error = object.find("error");
+   if (error != object.end())
+   {
+      failed(operation, json::write(error->second));
+      return false;
+   }
+
+   json::Object::const_iterator result = object.find("result");
+   if (result != object.end())
+      *pResult = result->second;
+   return true;
+}
+
+void LoadUser::saveCookies(const http::Response& response)
+{
+   BOOST_FOREACH(const http::Header& header, response.headers())
+   {
+      if (!boost::algorithm::iequals(header.name, "Set-Cookie"))
+         continue;
+
+      // keep just the name and value (not the attributes)
+      std::string cookie = header.value.substr(0, header.value.find(';'));
+      std::string::size_type equals = cookie.find('=');
+      if (equals != std::string::npos)
+         cookies_[cookie.substr(0, equals)] = cookie.substr(equals + 1);
+   }
+}
+
+void LoadUser::requestPublicKey()
+{
+   if (!options_.encryptPassword)
+   {
+      signIn(http::Response());
+      return;
+   }
+
+   http::Request request;
+   initRequest("GET", "/auth-public-key", &request);
+   send(kSignIn, &request,
+        boost::bind(&LoadUser::signIn, shared_from_this(), _1),
+        FailureHandler());
+}
+
+void LoadUser::signIn(const http::Response& publicKeyResponse)
+{
+   std::string form = "persist=0&appUri=";
+   if (options_.encryptPassword)
+   {
+      // the key is served as exponent:modulo
+      const std::string& key = publicKeyResponse.body();
+      std::string::size_type colon = key.find(':');
+      std::string cipherText;
+      Error error = colon == std::string::npos ?
+            systemError(boost::system::errc::protocol_error, ERROR_LOCATION) :
+            system::crypto::rsaPublicEncrypt(username_ + "\n" + password_,
+                                             key.substr(0, colon),
+                                             key.substr(colon + 1),
+                                             &cipherText);
+      if (error)
+      {
+         failed(kSignIn, error.summary());
+         return;
+      }
+      form += "&v=" + http::util::urlEncode(cipherText);
+   }
+   else
+   {
+      form += "&username=" + http::util::urlEncode(username_) +
+              "&password=" + http::util::urlEncode(password_);
+   }
+
+   http::Request request;
+   initRequest("POST", "/auth-do-sign-in", &request);
+   request.setContentType("application/x-www-form-urlencoded");
+   request.setBody(form);
+   send(kSignIn, &request,
+        boost::bind(&LoadUser::onSignedIn, shared_from_this(), _1),
+        FailureHandler());
+}
+
+void LoadUser::onSignedIn(const http::Response& response)
+{
+   // a failed sign in redirects back to the sign in page (with an error)
+   std::string location = response.headerValue("Location");
+   if (location.find("error=") != std::string::npos)
+   {
+      failed(kSignIn, "Sign in rejected for " + username_);
+      return;
+   }
+
+   saveCookies(response);
+   sessionStartTime_ = now();
+   clientInit();
+}
+
+void LoadUser::clientInit()
+{
+   if (stopped_)
+      return;
+
+   http::Request request;
+   initRpcRequest("/rpc/client_init", "client_init", json::Array(), &request);
+   send(kClientInit, &request,
+        boost::bind(&LoadUser::onClientInit, shared_from_this(), _1),
+        boost::bind(&LoadUser::retryClientInit, shared_from_this()));
+}
+
+void LoadUser::onClientInit(const http::Response& response)
+{
+   json::Value result;
+   if (!readRpcResult(kClientInit, response, &result))
+   {
+      retryClientInit();
+      return;
+   }
+
+   if (result.type() != json::ObjectType ||
+       result.get_obj().find("clientId") == result.get_obj().end())
+   {
+      failed(kClientInit, "No client id in client_init result");
+      retryClientInit();
+      return;
+   }
+
+   clientId_ = result.get_obj().find("clientId")->second.get_str();
+   pStats_->recordSuccess(kSessionStart, msSince(sessionStartTime_));
+
+   pollEvents();
+   scheduleAction();
+}
+
+void LoadUser::retryClientInit()
+{
+   // the session may still be starting
+   if (now() - sessionStartTime_ > options_.sessionStartTimeout)
+   {
+      failed(kSessionStart, "Session didn't start for " + username_);
+      return;
+   }
+
+   retryTimer_.expires_from_now(boost::posix_time::milliseconds(kRetryDelayMs));
+   retryTimer_.async_wait(boost::bind(&LoadUser::clientInit,
+                                      shared_from_this()));
+}
+
+void LoadUser::pollEvents()
+{
+   if (stopped_)
+      return;
+
+   json::Array params;
+   params.push_back(lastEventId_);
+   http::Request request;
+   initRpcRequest("/events/get_events", "get_events", params, &request);
+   send(kGetEvents, &request,
+        boost::bind(&LoadUser::onEvents, shared_from_this(), _1),
+        boost::bind(&LoadUser::retryPollEvents, shared_from_this()));
+}
+
+void LoadUser::onEvents(const http::Response& response)
+{
+   json::Value result;
+   if (!readRpcResult(kGetEvents, response, &result))
+   {
+      retryPollEvents();
+      return;
+   }
+
+   // (there are no events when the request times out)
+   if (result.type() == json::ArrayType)
+   {
+      BOOST_FOREACH(const json::Value& eventValue, result.get_array())
+      {
+         if (eventValue.type() != json::ObjectType)
+            continue;
+
+         const json::Object& event = eventValue.get_obj();
+         json::Object::const_iterator id = event.find("id");
+         json::Object::const_iterator type = event.find("type");
+         json::Object::const_iterator data = event.find("data");
+         if (id == event.end() || type == event.end() || data == event.end())
+            continue;
+
+         lastEventId_ = std::max(lastEventId_, id->second.get_int());
+         onEvent(type->second.get_str(), data->second);
+      }
+   }
+
+   pollEvents();
+}
+
+void LoadUser::retryPollEvents()
+{
+   retryTimer_.expires_from_now(boost::posix_time::milliseconds(kRetryDelayMs));
+   retryTimer_.async_wait(boost::bind(&LoadUser::pollEvents,
+                                      shared_from_this()));
+}
+
+void LoadUser::onEvent(const std::string& type, const json::Value& data)
+{
+   if (!action_.active)
+      return;
+
+   if (type == "console_prompt")
+   {
+      action_.prompted = true;
+      completeActionIfDone();
+   }
+   else if (type == "show_data" &&
+            action_.type == ActionDataViewer &&
+            !action_.fetching &&
+            data.type() == json::ObjectType)
+   {
+      json::Object::const_iterator url = data.get_obj().find("contentUrl");
+      if (url != data.get_obj().end())
+         fetchDataViewer(url->second.get_str());
+   }
+   else if (type == "plots_state_changed" &&
+            action_.type == ActionPlot &&
+            !action_.fetching &&
+            data.type() == json::ObjectType)
+   {
+      json::Object::const_iterator file = data.get_obj().find("filename");
+      if (file != data.get_obj().end() && !file->second.get_str().empty())
+         fetchPlot(file->second.get_str());
+   }
+}
+
+void LoadUser::scheduleAction()
+{
+   if (stopped_ || options_.actions.empty())
+      return;
+
+   // think for between half and one and a half times the think time
+   long thinkMs = options_.thinkTime.total_milliseconds();
+   long delayMs = thinkMs / 2 + (thinkMs > 0 ? std::rand() % (thinkMs + 1) : 0);
+   actionTimer_.expires_from_now(boost::posix_time::milliseconds(delayMs));
+   actionTimer_.async_wait(boost::bind(&LoadUser::startAction,
+                                       shared_from_this()));
+}
+
+void LoadUser::startAction()
+{
+   if (stopped_)
+      return;
+
+   action_ = Action();
+   action_.active = true;
+   action_.type = options_.actions[nextAction_++ % options_.actions.size()];
+   action_.started = now();
+
+   std::string code;
+   switch (action_.type)
+   {
+      case ActionDataViewer:
+         code = options_.dataViewerCode;
+         break;
+      case ActionPlot:
+         code = options_.plotCode;
+         break;
+      case ActionConsole:
+      default:
+         code = options_.consoleCode;
+         break;
+   }
+
+   timeoutTimer_.expires_from_now(options_.actionTimeout);
+   timeoutTimer_.async_wait(boost::bind(&LoadUser::onActionTimeout,
+                                        shared_from_this(),
+                                        boost::asio::placeholders::error));
+
+   json::Array params;
+   params.push_back(code);
+   params.push_back("");
+   http::Request request;
+   initRpcRequest("/rpc/console_input", "console_input", params, &request);
+   send(kConsoleInput, &request,
+        boost::bind(&LoadUser::onConsoleInput, shared_from_this(), _1),
+        boost::bind(&LoadUser::endAction, shared_from_this(), false));
+}
+
+void LoadUser::onConsoleInput(const http::Response& response)
+{
+   json::Value result;
+   if (!readRpcResult(kConsoleInput, response, &result))
+      endAction(false);
+}
+
+void LoadUser::fetchDataViewer(const std::string& contentUrl)
+{
+   action_.fetching = true;
+   action_.fetchStarted = now();
+
+   http::Request request;
+   initRequest("GET", "/" + contentUrl, &request);
+   send(kDataViewer + std::string("_page"), &request,
+        boost::bind(&LoadUser::onDataViewerPage, shared_from_this(),
+                    contentUrl, _1),
+        boost::bind(&LoadUser::fetchFailed, shared_from_this()));
+}
+
+void LoadUser::onDataViewerPage(const std::string& contentUrl,
+                                const http::Response&)
+{
+   // then load the first page of data, as the viewer does (the viewer's
+   // query identifies the data)
+   std::string query;
+   std::string::size_type queryStart = contentUrl.find('?');
+   if (queryStart != std::string::npos)
+      query = contentUrl.substr(queryStart + 1);
+
+   http::Request request;
+   initRequest("POST", "/grid_data", &request);
+   request.setContentType("application/x-www-form-urlencoded");
+   request.setBody(query + "&show=data&draw=1&start=0&length=100");
+   send(kDataViewer + std::string("_data"), &request,
+        boost::bind(&LoadUser::onDataViewerData, shared_from_this(), _1),
+        boost::bind(&LoadUser::fetchFailed, shared_from_this()));
+}
+
+void LoadUser::onDataViewerData(const http::Response&)
+{
+   action_.fetched = true;
+   completeActionIfDone();
+}
+
+void LoadUser::fetchPlot(const std::string& filename)
+{
+   action_.fetching = true;
+   action_.fetchStarted = now();
+
+   http::Request request;
+   initRequest("GET", "/graphics/" + filename, &request);
+   send(kPlot + std::string("_image"), &request,
+        boost::bind(&LoadUser::onPlot, shared_from_this(), _1),
+        boost::bind(&LoadUser::fetchFailed, shared_from_this()));
+}
+
+void LoadUser::onPlot(const http::Response&)
+{
+   action_.fetched = true;
+   completeActionIfDone();
+}
+
+void LoadUser::fetchFailed()
+{
+   endAction(false);
+}
+
+void LoadUser::completeActionIfDone()
+{
+   if (!action_.active || !action_.prompted)
+      return;
+
+   if (action_.type != ActionConsole && !action_.fetched)
+      return;
+
+   endAction(true);
+}
+
+void LoadUser::onActionTimeout(const boost::system::error_code& ec)
+{
+   if (ec || stopped_ || !action_.active)
+      return;
+
+   failed(actionOperation(action_.type), "Timed out");
+   action_.active = false;
+   scheduleAction();
+}
+
+void LoadUser::endAction(bool succeeded)
+{
+   if (!action_.active)
+      return;
+
+   // the action is timed from the input to its completion (the prompt, and
+   // any data or plot fetched)
+   if (succeeded)
+      pStats_->recordSuccess(actionOperation(action_.type),
+                             msSince(action_.started));
+   else
+      failed(actionOperation(action_.type), "Request failed");
+
+   action_.active = false;
+   boost::system::error_code ec;
+   timeoutTimer_.cancel(ec);
+   scheduleAction();
+}
+
+} // namespace load_test
+} // namespace rstudio
@@ -0,0 +1,196 @@
+/*
+ * LoadUser.hpp
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef LOAD_USER_HPP
+#define LOAD_USER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/FilePath.hpp>
+#include <core/http/Request.hpp>
+#include <core/http/Response.hpp>
+#include <core/json/Json.hpp>
+
+#include "LoadStats.hpp"
+
+namespace rstudio {
+namespace load_test {
+
+enum ActionType
+{
+   ActionConsole,    // run a command in the console
+   ActionDataViewer, // view a data frame and load its first page
+   ActionPlot        // draw a plot and fetch its image
+};
+
+struct UserOptions
+{
+   UserOptions()
+      : encryptPassword(true),
+        thinkTime(boost::posix_time::seconds(3)),
+        actionTimeout(boost::posix_time::seconds(60)),
+        sessionStartTimeout(boost::posix_time::seconds(60))
+   {
+   }
+
+   // the server, at either a tcp address and port or a local stream
+   std::string address;
+   std::string port;
+   core::FilePath localStreamPath;
+
+   // whether the server expects the password encrypted (auth-encrypt-password)
+   bool encryptPassword;
+
+   // mean time between the end of one action and the start of the next (the
+   // actual times vary uniformly by half of this either way)
+   boost::posix_time::time_duration thinkTime;
+   boost::posix_time::time_duration actionTimeout;
+   boost::posix_time::time_duration sessionStartTimeout;
+
+   // the actions (taken in turn) and their code
+   std::vector<ActionType> actions;
+   std::string consoleCode;
+   std::string dataViewerCode;
+   std::string plotCode;
+};
+
+// A simulated user: signs in, starts a session, polls for its events, and
+// (until stopped) repeatedly thinks then takes an action, waiting for each
+// action to complete (the console to return to the prompt and any data or
+// plot to be fetched) before thinking about the next. The time taken by each
+// request and action is recorded in the stats. All of a user's work is done
+// on the io service's thread.
+class LoadUser : boost::noncopyable,
+                 public boost::enable_shared_from_this<LoadUser>
+{
+public:
+   LoadUser(boost::asio::io_service& ioService,
+            const UserOptions& options,
+            const std::string& username,
+            const std::string& password,
+            LoadStats* pStats);
+
+   // COPYING: boost::noncopyable
+
+   void start();
+   void stop();
+
+private:
+   typedef boost::function<void(const core::http::Response&)> ResponseHandler;
+   typedef boost::function<void()> FailureHandler;
+
+   void send(const std::string& operation,
+             core::http::Request* pRequest,
+             const ResponseHandler& onResponse,
+             const FailureHandler& onFailure);
+   void handleResponse(const std::string& operation,
+                       const boost::posix_time::ptime& started,
+                       const ResponseHandler& onResponse,
+                       const FailureHandler& onFailure,
+                       const core::http::Response& response);
+   void handleError(const std::string& operation,
+                    const FailureHandler& onFailure,
+                    const core::Error& error);
+   void failed(const std::string& operation, const std::string& message);
+
+   void initRequest(const std::string& method,
+                    const std::string& uri,
+                    core::http::Request* pRequest);
+   void initRpcRequest(const std::string& uri,
+                       const std::string& method,
+                       const core::json::Array& params,
+                       core::http::Request* pRequest);
+   bool readRpcResult(const std::string& operation,
+                      const core::http::Response& response,
+                      core::json::Value* pResult);
+   void saveCookies(const core::http::Response& response);
+
+   void requestPublicKey();
+   void signIn(const core::http::Response& response);
+   void onSignedIn(const core::http::Response& response);
+   void clientInit();
+   void onClientInit(const core::http::Response& response);
+   void retryClientInit();
+
+   void pollEvents();
+   void onEvents(const core::http::Response& response);
+   void retryPollEvents();
+   void onEvent(const std::string& type, const core::json::Value& data);
+
+   void scheduleAction();
+   void startAction();
+   void onConsoleInput(const core::http::Response& response);
+   void fetchDataViewer(const std::string& contentUrl);
+   void onDataViewerPage(const std::string& contentUrl,
+                         const core::http::Response& response);
+   void onDataViewerData(const core::http::Response& response);
+   void fetchPlot(const std::string& filename);
+   void onPlot(const core::http::Response& response);
+   void fetchFailed();
+   void completeActionIfDone();
+   void onActionTimeout(const boost::system::error_code& ec);
+   void endAction(bool succeeded);
+
+   boost::asio::io_service& ioService_;
+   UserOptions options_;
+   std::string username_;
+   std::string password_;
+   LoadStats* pStats_;
+
+   bool stopped_;
+   std::map<std::string, std::string> cookies_;
+   std::string clientId_;
+   int lastEventId_;
+   boost::posix_time::ptime sessionStartTime_;
+
+   boost::asio::deadline_timer actionTimer_;
+   boost::asio::deadline_timer timeoutTimer_;
+   boost::asio::deadline_timer retryTimer_;
+
+   // the action under way (if any)
+   struct Action
+   {
+      Action()
+         : active(false), type(ActionConsole), prompted(false),
+           fetching(false), fetched(false)
+      {
+      }
+
+      bool active;
+      ActionType type;
+      boost::posix_time::ptime started;
+      boost::posix_time::ptime fetchStarted;
+      bool prompted;
+      bool fetching;
+      bool fetched;
+   };
+   Action action_;
+   std::size_t nextAction_;
+};
+
+} // namespace load_test
+} // namespace rstudio
+
+#endif // LOAD_USER_HPP
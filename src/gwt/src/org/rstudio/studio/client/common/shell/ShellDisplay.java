@@ -24,6 +24,7 @@ import com.google.gwt.event.dom.client.HasKeyUpHandlers;
 import com.google.gwt.event.dom.client.KeyDownHandler;
 import com.google.gwt.event.dom.client.KeyUpHandler;
 import com.google.gwt.event.shared.HandlerRegistration;
+import com.google.gwt.user.client.Command;
 import com.google.gwt.user.client.ui.Widget;
 
 public interface ShellDisplay extends ShellOutputWriter, 
@@ -33,6 +34,7 @@ public interface ShellDisplay extends ShellOutputWriter,
 {
    void consoleWriteInput(String input, String console);
    void consoleWritePrompt(String prompt);
+   void consoleWriteOutputSuppressed(Command showSuppressed);
    void consolePrompt(String prompt, boolean showInput) ;
    void ensureInputVisible() ;
    InputEditorDisplay getInputEditorDisplay() ;
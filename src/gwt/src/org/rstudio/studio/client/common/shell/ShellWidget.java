@@ -60,7 +60,12 @@ import com.google.gwt.event.dom.client.KeyDownHandler;
 import com.google.gwt.event.dom.client.KeyPressHandler;
 import com.google.gwt.event.dom.client.KeyUpHandler;
 import com.google.gwt.event.shared.HandlerRegistration;
+import com.google.gwt.user.client.Command;
+import com.google.gwt.user.client.DOM;
+import com.google.gwt.user.client.Event;
+import com.google.gwt.user.client.EventListener;
 import com.google.gwt.user.client.Timer;
+import com.google.gwt.user.client.ui.Anchor;
 import com.google.gwt.user.client.ui.Composite;
 import com.google.gwt.user.client.ui.DockPanel;
 import com.google.gwt.user.client.ui.HTML;
@@ -329,6 +334,32 @@ public class ShellWidget extends Composite implements ShellDisplay,
       output(output, styles_.output(), false /*isError*/, false /*ignoreLineCount*/);
    }
 
+   public void consoleWriteOutputSuppressed(final Command showSuppressed)
+   {
+      // only the most recent notice links to the suppressed output (which is
+      // retrieved as a whole)
+      if (suppressedOutputLink_ != null)
+         suppressedOutputLink_.removeFromParent();
+
+      output_.ensureStartingOnNewLine();
+      Anchor link = new Anchor("Show suppressed output");
+      DOM.sinkEvents(link.getElement(), Event.ONCLICK);
+      DOM.setEventListener(link.getElement(), new EventListener()
+      {
+         @Override
+         public void onBrowserEvent(Event event)
+         {
+            showSuppressed.execute();
+         }
+      });
+      suppressedOutputLink_ = Document.get().createDivElement();
+      suppressedOutputLink_.appendChild(link.getElement());
+      output_.getElement().appendChild(suppressedOutputLink_);
+
+      if (scrollPanel_.isScrolledToBottom())
+         resizeCommand_.nudge();
+   }
+
    public void consoleWriteInput(final String input, String console)
    {
       // if coming from another console id (i.e. notebook chunk), clear the
@@ -637,6 +668,7 @@ public class ShellWidget extends Composite implements ShellDisplay,
    public void clearOutput()
    {
       output_.clearConsoleOutput();
+      suppressedOutputLink_ = null;
       cleared_ = true;
    }
    
@@ -749,6 +781,7 @@ public class ShellWidget extends Composite implements ShellDisplay,
    
    private boolean cleared_ = false;
    private final ConsoleOutputWriter output_;
+   private Element suppressedOutputLink_;
    private PreWidget pendingInput_ ;
    private final HTML prompt_ ;
    protected final AceEditor input_ ;
@@ -17,6 +17,7 @@ package org.rstudio.studio.client.common.spelling;
 
 import java.util.ArrayList;
 import java.util.HashMap;
+import java.util.HashSet;
 import java.util.List;
 
 import org.rstudio.core.client.js.JsUtil;
@@ -27,7 +28,6 @@ import org.rstudio.studio.client.server.ServerRequestCallback;
 import org.rstudio.studio.client.workbench.prefs.model.SpellingPrefsContext;
 import org.rstudio.studio.client.workbench.prefs.model.UIPrefs;
 
-import com.google.gwt.core.client.JsArrayInteger;
 import com.google.gwt.core.client.JsArrayString;
 import com.google.gwt.dom.client.Document;
 import com.google.gwt.event.dom.client.ChangeEvent;
@@ -104,23 +104,23 @@ public class SpellingService implements HasChangeHandlers
          return;
       }
       
-      // hit the server
-      server_.checkSpelling(JsUtil.toJsArrayString(wordsToCheck), 
-                            new ServerRequestCallback<JsArrayInteger>() {
+      // hit the server (which checks each distinct word once)
+      server_.checkSpellingBatch(JsUtil.toJsArrayString(wordsToCheck), 
+                                 new ServerRequestCallback<JsArrayString>() {
 
          @Override
-         public void onResponseReceived(JsArrayInteger result)
+         public void onResponseReceived(JsArrayString result)
          {
-            // get misspelled indexes
-            ArrayList<Integer> misspelledIndexes = new ArrayList<Integer>();
+            // get misspelled words
+            HashSet<String> misspelledWords = new HashSet<String>();
             for (int i=0; i<result.length(); i++)
-               misspelledIndexes.add(result.get(i));
+               misspelledWords.add(result.get(i));
             
             // determine correct/incorrect status and populate result & cache
             for (int i=0; i<wordsToCheck.size(); i++)
             {
                String word = wordsToCheck.get(i);
-               if (misspelledIndexes.contains(i))
+               if (misspelledWords.contains(word))
                {
                   spellCheckerResult.getIncorrect().add(word);
                   previousResults_.put(word, false);
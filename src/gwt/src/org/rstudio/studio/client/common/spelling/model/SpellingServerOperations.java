@@ -27,6 +27,11 @@ public interface SpellingServerOperations
    void checkSpelling(JsArrayString words, 
                       ServerRequestCallback<JsArrayInteger> requestCallback);
    
+   // check the specified array of words (which may contain duplicates),
+   // returning the distinct mis-spelled words
+   void checkSpellingBatch(JsArrayString words,
+                           ServerRequestCallback<JsArrayString> requestCallback);
+   
    void suggestionList(String word,
                        ServerRequestCallback<JsArrayString> requestCallback);
    
@@ -183,6 +183,8 @@ class ClientEvent extends JavaScriptObject
    public static final String NewDocumentWithCode = "new_document_with_code";
    public static final String AvailablePackagesReady = "available_packages_ready";
    public static final String PlumberViewer = "plumber_viewer";
+   public static final String ConsoleWriteInputBatch = "console_write_input_batch";
+   public static final String ConsoleOutputSuppressed = "console_output_suppressed";
 
    protected ClientEvent()
    {
@@ -263,6 +263,17 @@ public class ClientEventDispatcher
             ConsoleText input = event.getData();
             eventBus_.dispatchEvent(new ConsoleWriteInputEvent(input));
          }
+         else if (type == ClientEvent.ConsoleWriteInputBatch)
+         {
+            // a run of console_write_prompt and console_write_input events
+            JsArray<ClientEvent> echoes = event.getData();
+            for (int i = 0; i < echoes.length(); i++)
+               dispatchEvent(echoes.get(i));
+         }
+         else if (type == ClientEvent.ConsoleOutputSuppressed)
+         {
+            eventBus_.dispatchEvent(new ConsoleOutputSuppressedEvent());
+         }
          else if (type == ClientEvent.ConsolePrompt)
          {
             ConsolePrompt prompt = event.getData();
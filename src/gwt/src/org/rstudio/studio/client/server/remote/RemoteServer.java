@@ -172,6 +172,7 @@ import org.rstudio.studio.client.workbench.views.console.model.ProcessBufferChun
 import org.rstudio.studio.client.workbench.views.environment.dataimport.DataImportOptions;
 import org.rstudio.studio.client.workbench.views.environment.dataimport.model.DataImportAssembleResponse;
 import org.rstudio.studio.client.workbench.views.environment.dataimport.model.DataImportPreviewResponse;
+import org.rstudio.studio.client.workbench.views.environment.model.CsvPreviewColumn;
 import org.rstudio.studio.client.workbench.views.environment.model.DataPreviewResult;
 import org.rstudio.studio.client.workbench.views.environment.model.DownloadInfo;
 import org.rstudio.studio.client.workbench.views.environment.model.EnvironmentContextData;
@@ -646,6 +647,12 @@ public class RemoteServer implements Server
       sendRequest(RPC_SCOPE, RESET_CONSOLE_ACTIONS, requestCallback);
    }
 
+   public void getSuppressedConsoleOutput(
+                        ServerRequestCallback<String> requestCallback)
+   {
+      sendRequest(RPC_SCOPE, GET_SUPPRESSED_CONSOLE_OUTPUT, requestCallback);
+   }
+
    public void processStart(String handle,
                             ServerRequestCallback<Void> requestCallback)
    {
@@ -1107,6 +1114,24 @@ public class RemoteServer implements Server
                   requestCallback);
    }
 
+   public void previewCsvFile(String dataFilePath,
+                              String separator,
+                              boolean heading,
+                              int maxRows,
+                              ServerRequestCallback<JsArray<CsvPreviewColumn>> requestCallback)
+   {
+      JSONArray params = new JSONArray();
+      params.set(0, new JSONString(dataFilePath));
+      params.set(1, new JSONString(separator));
+      params.set(2, JSONBoolean.getInstance(heading));
+      params.set(3, new JSONNumber(maxRows));
+
+      sendRequest(RPC_SCOPE,
+                  PREVIEW_CSV_FILE,
+                  params,
+                  requestCallback);
+   }
+
    public void editCompleted(String text,
                              ServerRequestCallback<Void> requestCallback)
    {
@@ -2801,6 +2826,16 @@ public class RemoteServer implements Server
       return eventBus_;
    }
 
+   String getClientId()
+   {
+      return clientId_;
+   }
+
+   SessionInfo getSessionInfo()
+   {
+      return session_.getSessionInfo();
+   }
+
    RpcRequest getEvents(
                   int lastEventId,
                   ServerRequestCallback<JsArray<ClientEvent>> requestCallback,
@@ -3950,6 +3985,15 @@ public class RemoteServer implements Server
       sendRequest(RPC_SCOPE, CHECK_SPELLING, params, requestCallback);
    }
    
+   public void checkSpellingBatch(
+                         JsArrayString words,
+                         ServerRequestCallback<JsArrayString> requestCallback)
+   {
+      JSONArray params = new JSONArray();
+      params.set(0, new JSONArray(words));
+      sendRequest(RPC_SCOPE, CHECK_SPELLING_BATCH, params, requestCallback);
+   }
+   
    public void suggestionList(
                      String word,
                      ServerRequestCallback<JsArrayString> requestCallback)
@@ -5292,6 +5336,15 @@ public class RemoteServer implements Server
       sendRequest(RPC_SCOPE, CONNECTION_LIST_OBJECTS, params, callback);
    }
 
+   @Override
+   public void connectionRefresh(ConnectionId connectionId,
+                                 ServerRequestCallback<Void> callback)
+   {
+      JSONArray params = new JSONArray();
+      params.set(0, new JSONObject(connectionId));
+      sendRequest(RPC_SCOPE, CONNECTION_REFRESH, params, callback);
+   }
+
    @Override
    public void connectionListFields(
                               ConnectionId connectionId, 
@@ -5597,6 +5650,7 @@ public class RemoteServer implements Server
 
    private static final String CONSOLE_INPUT = "console_input";
    private static final String RESET_CONSOLE_ACTIONS = "reset_console_actions";
+   private static final String GET_SUPPRESSED_CONSOLE_OUTPUT = "get_suppressed_console_output";
    private static final String INTERRUPT = "interrupt";
    private static final String ABORT = "abort";
    private static final String ADAPT_TO_LANGUAGE = "adapt_to_language";
@@ -5631,6 +5685,7 @@ public class RemoteServer implements Server
    private static final String DOWNLOAD_DATA_FILE = "download_data_file";
    private static final String GET_DATA_PREVIEW = "get_data_preview";
    private static final String GET_OUTPUT_PREVIEW = "get_output_preview";
+   private static final String PREVIEW_CSV_FILE = "preview_csv_file";
 
    private static final String EDIT_COMPLETED = "edit_completed";
    private static final String CHOOSE_FILE_COMPLETED = "choose_file_completed";
@@ -5837,6 +5892,7 @@ public class RemoteServer implements Server
    private static final String APPLY_INVERSE_CONCORDANCE = "apply_inverse_concordance";
    
    private static final String CHECK_SPELLING = "check_spelling";
+   private static final String CHECK_SPELLING_BATCH = "check_spelling_batch";
    private static final String SUGGESTION_LIST = "suggestion_list";
    private static final String ADD_CUSTOM_DICTIONARY = "add_custom_dictionary";
    private static final String REMOVE_CUSTOM_DICTIONARY = "remove_custom_dictionary";
@@ -5959,6 +6015,7 @@ public class RemoteServer implements Server
    private static final String CONNECTION_EXECUTE_ACTION = "connection_execute_action";
    private static final String CONNECTION_LIST_OBJECTS = "connection_list_objects";
    private static final String CONNECTION_LIST_FIELDS = "connection_list_fields";
+   private static final String CONNECTION_REFRESH = "connection_refresh";
    private static final String CONNECTION_PREVIEW_OBJECT = "connection_preview_object";
    private static final String CONNECTION_TEST = "connection_test";
    private static final String GET_NEW_CONNECTION_CONTEXT = "get_new_connection_context";
@@ -16,17 +16,24 @@ package org.rstudio.studio.client.server.remote;
 
 import com.google.gwt.core.client.GWT;
 import com.google.gwt.core.client.JsArray;
+import com.google.gwt.core.client.JsonUtils;
 import com.google.gwt.user.client.Timer;
 import com.google.gwt.user.client.Window;
 import com.google.gwt.user.client.Window.ClosingEvent;
 import com.google.gwt.user.client.Window.ClosingHandler;
+import com.sksamuel.gwt.websockets.CloseEvent;
+import com.sksamuel.gwt.websockets.Websocket;
+import com.sksamuel.gwt.websockets.WebsocketListenerExt;
+import org.rstudio.core.client.StringUtil;
 import org.rstudio.core.client.jsonrpc.RpcError;
 import org.rstudio.core.client.jsonrpc.RpcRequest;
 import org.rstudio.core.client.jsonrpc.RpcRequestCallback;
 import org.rstudio.core.client.jsonrpc.RpcResponse;
+import org.rstudio.studio.client.application.Desktop;
 import org.rstudio.studio.client.application.events.*;
 import org.rstudio.studio.client.server.ServerError;
 import org.rstudio.studio.client.server.ServerRequestCallback;
+import org.rstudio.studio.client.workbench.views.terminal.TerminalSocketPacket;
 
 import java.util.HashMap;
 
@@ -123,22 +130,18 @@ class RemoteServerEventListener
       
       // start listening
       listen();
+      
+      // switch to having events pushed over a WebSocket if the session
+      // offers one (we keep polling until it is connected)
+      connectEventSocket();
    }
      
    public void stop()
    {        
       isListening_ = false;
       listenCount_ = 0;
-      if (activeRequestCallback_ != null)
-      {
-         activeRequestCallback_.cancel();
-         activeRequestCallback_ = null;
-      }
-      if (activeRequest_ != null)
-      {
-         activeRequest_.cancel();
-         activeRequest_ = null;
-      }
+      closeEventSocket();
+      cancelActiveRequest();
    }
    
    // ensure that we are actively listening for events (used to make 
@@ -243,8 +246,8 @@ class RemoteServerEventListener
    
    private void doListen()
    {  
-      // abort if we are no longer running
-      if (!isListening_)
+      // abort if we are no longer running (or events are being pushed)
+      if (!isListening_ || eventSocketReady_)
          return;
           
       // setup request callback (save reference for cancellation)
@@ -258,24 +261,8 @@ class RemoteServerEventListener
             
             try
             {
-               // only processs events if we are still listening
-               if (isListening_ && (events != null))
-               {
-                  for (int i=0; i<events.length(); i++)
-                  {
-                     // we can stop listening in the middle of dispatching
-                     // events (e.g. if we dispatch a Suicide event) so we 
-                     // need to check the listening_ flag before each event
-                     // is dispatched
-                     if (!isListening_)
-                        return;
-                     
-                     // disppatch event
-                     ClientEvent event = events.get(i);
-                     dispatchEvent(event);
-                     lastEventId_ = event.getId();
-                  }   
-               }
+               if (!processEvents(events))
+                  return;
             }
             // catch all here to make sure that in all cases we call
             // listen() again after processing
@@ -356,6 +343,167 @@ class RemoteServerEventListener
    }
    
    
+   // dispatch events received from the server; returns false if we stopped
+   // listening while doing so
+   private boolean processEvents(JsArray<ClientEvent> events)
+   {
+      // only processs events if we are still listening
+      if (isListening_ && (events != null))
+      {
+         for (int i=0; i<events.length(); i++)
+         {
+            // we can stop listening in the middle of dispatching
+            // events (e.g. if we dispatch a Suicide event) so we 
+            // need to check the listening_ flag before each event
+            // is dispatched
+            if (!isListening_)
+               return false;
+            
+            // skip events we've already seen (an event can be delivered
+            // both by polling and over the WebSocket when switching
+            // between them)
+            ClientEvent event = events.get(i);
+            if (lastEventId_ >= 0 && event.getId() <= lastEventId_)
+               continue;
+            
+            // disppatch event
+            dispatchEvent(event);
+            lastEventId_ = event.getId();
+         }   
+      }
+      return true;
+   }
+   
+   private void connectEventSocket()
+   {
+      if (eventSocket_ != null)
+         return;
+      
+      int port = server_.getSessionInfo().getClientEventsWebSocketPort();
+      String clientId = server_.getClientId();
+      if (port <= 0 || StringUtil.isNullOrEmpty(clientId))
+         return;
+      
+      // for desktop talk directly to the WebSocket; otherwise go through
+      // the server via the /p proxy (as terminals do)
+      String urlSuffix = port + "/events/" + clientId + "/";
+      String url;
+      if (Desktop.isDesktop())
+      {
+         url = "ws://127.0.0.1:" + urlSuffix;
+      }
+      else
+      {
+         url = GWT.getHostPageBaseURL();
+         if (url.startsWith("https:"))
+            url = "wss:" + url.substring(6) + "p/" + urlSuffix;
+         else if (url.startsWith("http:"))
+            url = "ws:" + url.substring(5) + "p/" + urlSuffix;
+         else
+            return;
+      }
+      
+      final Websocket socket = new Websocket(url);
+      socket.addListener(new WebsocketListenerExt()
+      {
+         @Override
+         public void onOpen()
+         {
+            if (socket != eventSocket_)
+               return;
+            
+            // tell the server where we're up to (it replies with any events
+            // we haven't seen then pushes the rest as they arrive)
+            socket.send(TerminalSocketPacket.textPacket(
+                                          String.valueOf(lastEventId_)));
+            eventSocketReady_ = true;
+            
+            // stop polling
+            cancelActiveRequest();
+         }
+         
+         @Override
+         public void onMessage(String msg)
+         {
+            if (socket != eventSocket_ || TerminalSocketPacket.isKeepAlive(msg))
+               return;
+            
+            watchdog_.notifyResponseReceived();
+            try
+            {
+               JsArray<ClientEvent> events = JsonUtils.safeEval(
+                                       TerminalSocketPacket.getMessage(msg));
+               if (!processEvents(events))
+                  return;
+            }
+            catch(Throwable e)
+            {
+               GWT.log("ERROR: Processing client events", e);
+            }
+            
+            // acknowledge the events
+            if (eventSocket_ != null)
+            {
+               eventSocket_.send(TerminalSocketPacket.textPacket(
+                                          String.valueOf(lastEventId_)));
+            }
+         }
+         
+         @Override
+         public void onClose(CloseEvent event)
+         {
+            onEventSocketClosed(socket);
+         }
+         
+         @Override
+         public void onError()
+         {
+            onEventSocketClosed(socket);
+         }
+      });
+      
+      eventSocket_ = socket;
+      eventSocketReady_ = false;
+      socket.open();
+   }
+   
+   private void onEventSocketClosed(Websocket socket)
+   {
+      if (socket != eventSocket_)
+         return;
+      
+      // go back to polling (the server retains any events we haven't
+      // acknowledged and delivers them then)
+      boolean wasReady = eventSocketReady_;
+      eventSocket_ = null;
+      eventSocketReady_ = false;
+      if (wasReady && isListening_)
+         listen();
+   }
+   
+   private void closeEventSocket()
+   {
+      Websocket socket = eventSocket_;
+      eventSocket_ = null;
+      eventSocketReady_ = false;
+      if (socket != null)
+         socket.close();
+   }
+   
+   private void cancelActiveRequest()
+   {
+      if (activeRequestCallback_ != null)
+      {
+         activeRequestCallback_.cancel();
+         activeRequestCallback_ = null;
+      }
+      if (activeRequest_ != null)
+      {
+         activeRequest_.cancel();
+         activeRequest_ = null;
+      }
+   }
+   
    private void dispatchEvent(ClientEvent event)
    {
       // do some special handling before calling the standard dispatcher
@@ -489,6 +637,11 @@ class RemoteServerEventListener
    
    private RpcRequest activeRequest_ ;
    private ServerRequestCallback<JsArray<ClientEvent>> activeRequestCallback_;
+   
+   // WebSocket over which the server pushes events (when it offers one);
+   // ready once we've told the server the last event we've seen
+   private Websocket eventSocket_;
+   private boolean eventSocketReady_;
 
    private final ClientEventDispatcher eventDispatcher_;
    
@@ -380,6 +380,10 @@ public class SessionInfo extends JavaScriptObject
       return this.websocket_ping_interval;
    }-*/;
    
+   public final native int getClientEventsWebSocketPort() /*-{
+      return this.client_events_websocket_port || 0;
+   }-*/;
+
    public final native int getWebSocketConnectTimeout() /*-{
       return this.websocket_connect_timeout;
    }-*/;
@@ -32,7 +32,9 @@ public class PackagesPrefs extends JavaScriptObject
                                   boolean hideObjectFiles,
                                   boolean useDevtools,
                                   boolean useSecureDownload,
-                                  boolean useNewlineInMakefiles) /*-{
+                                  boolean useNewlineInMakefiles,
+                                  boolean useCompileCache,
+                                  boolean useParallelTests) /*-{
       var prefs = new Object();
       prefs.cran_mirror = cranMirror;
       prefs.use_internet2 = useInternet2;
@@ -43,6 +45,8 @@ public class PackagesPrefs extends JavaScriptObject
       prefs.use_devtools = useDevtools;
       prefs.use_secure_download = useSecureDownload;
       prefs.use_newline_in_makefiles = useNewlineInMakefiles;
+      prefs.use_compile_cache = useCompileCache;
+      prefs.use_parallel_tests = useParallelTests;
       return prefs ;
    }-*/;
 
@@ -82,5 +86,13 @@ public class PackagesPrefs extends JavaScriptObject
       return this.use_newline_in_makefiles;
    }-*/;
    
+   public native final boolean getUseCompileCache() /*-{
+      return this.use_compile_cache;
+   }-*/;
+   
+   public native final boolean getUseParallelTests() /*-{
+      return this.use_parallel_tests;
+   }-*/;
+   
    
 }
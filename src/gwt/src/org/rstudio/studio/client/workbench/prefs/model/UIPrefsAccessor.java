@@ -661,6 +661,11 @@ public class UIPrefsAccessor extends Prefs
    {
       return bool("show_rmd_render_command", false);
    }
+   
+   public PrefValue<Boolean> rmdRenderCache()
+   {
+      return bool("rmd_render_cache", false);
+   }
 
    public PrefValue<Boolean> enableTextDrag()
    {
@@ -188,6 +188,14 @@ public class PackagesPreferencesPane extends PreferencesPane
       lessSpaced(hideObjectFiles_);
       development.add(hideObjectFiles_);
       
+      useCompileCache_ = new CheckBox("Cache compiled objects between package builds (ccache)");
+      lessSpaced(useCompileCache_);
+      development.add(useCompileCache_);
+      
+      useParallelTests_ = new CheckBox("Run testthat package tests in parallel");
+      lessSpaced(useParallelTests_);
+      development.add(useParallelTests_);
+      
       cleanupAfterCheckSuccess_ = new CheckBox("Cleanup output after successful R CMD check");
       lessSpaced(cleanupAfterCheckSuccess_);
       development.add(cleanupAfterCheckSuccess_);
@@ -212,6 +220,8 @@ public class PackagesPreferencesPane extends PreferencesPane
       cleanupAfterCheckSuccess_.setEnabled(false);
       viewDirAfterCheckFailure_.setEnabled(false); 
       hideObjectFiles_.setEnabled(false);
+      useCompileCache_.setEnabled(false);
+      useParallelTests_.setEnabled(false);
       useDevtools_.setEnabled(false);
       useSecurePackageDownload_.setEnabled(false);
 
@@ -294,6 +304,12 @@ public class PackagesPreferencesPane extends PreferencesPane
       hideObjectFiles_.setEnabled(true);
       hideObjectFiles_.setValue(packagesPrefs.getHideObjectFiles());
       
+      useCompileCache_.setEnabled(true);
+      useCompileCache_.setValue(packagesPrefs.getUseCompileCache());
+      
+      useParallelTests_.setEnabled(true);
+      useParallelTests_.setValue(packagesPrefs.getUseParallelTests());
+      
       useDevtools_.setEnabled(true);
       useDevtools_.setValue(packagesPrefs.getUseDevtools());
       
@@ -350,7 +366,9 @@ public class PackagesPreferencesPane extends PreferencesPane
                                               hideObjectFiles_.getValue(),
                                               useDevtools_.getValue(),
                                               useSecurePackageDownload_.getValue(),
-                                              useNewlineInMakefiles_.getValue());
+                                              useNewlineInMakefiles_.getValue(),
+                                              useCompileCache_.getValue(),
+                                              useParallelTests_.getValue());
       rPrefs.setPackagesPrefs(packagesPrefs);
       
       return reload || reloadRequired_;
@@ -366,6 +384,8 @@ public class PackagesPreferencesPane extends PreferencesPane
    private CheckBox cleanupAfterCheckSuccess_;
    private CheckBox viewDirAfterCheckFailure_;
    private CheckBox hideObjectFiles_;
+   private CheckBox useCompileCache_;
+   private CheckBox useParallelTests_;
    private CheckBox useDevtools_;
    private CheckBox useSecurePackageDownload_;
    private CheckBox useNewlineInMakefiles_;
@@ -130,6 +130,11 @@ public class RMarkdownPreferencesPane extends PreferencesPane
             prefs_.showRmdRenderCommand());
       add(showRmdRenderCommand);
       
+      final CheckBox rmdRenderCache = checkboxPref(
+            "Cache unchanged chunks and keep a render process ready",
+            prefs_.rmdRenderCache());
+      add(rmdRenderCache);
+      
       add(spacedBefore(headerLabel("R Notebooks")));
 
       // auto-execute the setup chunk
@@ -496,7 +496,22 @@ public class ConnectionsPresenter extends BasePresenter
       if (exploredConnection_ == null)
          return;
       
-      display_.updateExploredConnection("");
+      // drop the server's cached listings first so they're fetched anew
+      server_.connectionRefresh(exploredConnection_.getId(),
+            new VoidServerRequestCallback()
+      {
+         @Override
+         public void onSuccess()
+         {
+            display_.updateExploredConnection("");
+         }
+         
+         @Override
+         public void onFailure()
+         {
+            display_.updateExploredConnection("");
+         }
+      });
    }
    
    private void showAllConnections(boolean animate)
@@ -41,6 +41,9 @@ public interface ConnectionsServerOperations extends CryptoServerOperations
                              ConnectionObjectSpecifier object,
                              ServerRequestCallback<JsArray<Field>> callback);
    
+   void connectionRefresh(ConnectionId connectionId,
+                          ServerRequestCallback<Void> callback);
+   
    void connectionPreviewObject(ConnectionId connectionId,
                                 ConnectionObjectSpecifier object,
                                 ServerRequestCallback<Void> callback);
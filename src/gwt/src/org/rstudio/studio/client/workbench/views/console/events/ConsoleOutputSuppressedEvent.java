@@ -0,0 +1,48 @@
+/*
+ * ConsoleOutputSuppressedEvent.java
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+package org.rstudio.studio.client.workbench.views.console.events;
+
+import com.google.gwt.event.shared.EventHandler;
+import com.google.gwt.event.shared.GwtEvent;
+
+// console output arrived faster than it could be shown, so some of it was
+// suppressed (it can be retrieved with get_suppressed_console_output)
+public class ConsoleOutputSuppressedEvent 
+   extends GwtEvent<ConsoleOutputSuppressedEvent.Handler>
+{
+   public static final GwtEvent.Type<ConsoleOutputSuppressedEvent.Handler> TYPE =
+      new GwtEvent.Type<ConsoleOutputSuppressedEvent.Handler>();
+  
+   public interface Handler extends EventHandler
+   {
+      void onConsoleOutputSuppressed(ConsoleOutputSuppressedEvent event);
+   }
+   
+   public ConsoleOutputSuppressedEvent()
+   {
+   }
+         
+   @Override
+   public Type<ConsoleOutputSuppressedEvent.Handler> getAssociatedType()
+   {
+      return TYPE;
+   }
+
+   @Override
+   protected void dispatch(Handler handler)
+   {
+      handler.onConsoleOutputSuppressed(this);
+   }
+}
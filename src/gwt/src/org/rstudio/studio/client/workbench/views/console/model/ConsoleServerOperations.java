@@ -37,6 +37,9 @@ public interface ConsoleServerOperations extends CodeToolsServerOperations,
    
    void resetConsoleActions(ServerRequestCallback<Void> requestCallback);
 
+   // console output which was suppressed rather than shown
+   void getSuppressedConsoleOutput(ServerRequestCallback<String> requestCallback);
+
    void processStart(String handle,
                      ServerRequestCallback<Void> requestCallback);
 
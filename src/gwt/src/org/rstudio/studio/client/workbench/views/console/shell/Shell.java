@@ -67,12 +67,14 @@ import org.rstudio.studio.client.workbench.views.source.SourceWindowManager;
 import org.rstudio.studio.client.workbench.views.source.editors.text.DocDisplay;
 import org.rstudio.studio.client.workbench.views.source.editors.text.ace.AceEditorNative;
 import org.rstudio.studio.client.workbench.views.source.editors.text.events.PasteEvent;
+import org.rstudio.studio.client.workbench.views.source.events.NewDocumentWithCodeEvent;
 
 import java.util.ArrayList;
 
 public class Shell implements ConsoleHistoryAddedEvent.Handler,
                               ConsoleInputHandler,
                               ConsoleWriteOutputHandler,
+                              ConsoleOutputSuppressedEvent.Handler,
                               ConsoleWriteErrorHandler,
                               ConsoleWritePromptHandler,
                               ConsoleWriteInputHandler,
@@ -154,6 +156,7 @@ public class Shell implements ConsoleHistoryAddedEvent.Handler,
       eventBus.addHandler(ConsoleHistoryAddedEvent.TYPE, this);
       eventBus.addHandler(ConsoleInputEvent.TYPE, this); 
       eventBus.addHandler(ConsoleWriteOutputEvent.TYPE, this);
+      eventBus.addHandler(ConsoleOutputSuppressedEvent.TYPE, this);
       eventBus.addHandler(ConsoleWriteErrorEvent.TYPE, this);
       eventBus.addHandler(ConsoleWritePromptEvent.TYPE, this);
       eventBus.addHandler(ConsoleWriteInputEvent.TYPE, this);
@@ -292,6 +295,34 @@ public class Shell implements ConsoleHistoryAddedEvent.Handler,
       view_.consoleWriteOutput(event.getOutput()) ;
    }
 
+   public void onConsoleOutputSuppressed(ConsoleOutputSuppressedEvent event)
+   {
+      view_.consoleWriteOutputSuppressed(new Command()
+      {
+         @Override
+         public void execute()
+         {
+            server_.getSuppressedConsoleOutput(
+                                       new ServerRequestCallback<String>()
+            {
+               @Override
+               public void onResponseReceived(String output)
+               {
+                  eventBus_.fireEvent(new NewDocumentWithCodeEvent(
+                        NewDocumentWithCodeEvent.TEXT, output, null, false));
+               }
+
+               @Override
+               public void onError(ServerError error)
+               {
+                  view_.consoleWriteError(
+                        "Error: " + error.getUserMessage() + "\n");
+               }
+            });
+         }
+      });
+   }
+
    public void onConsoleWriteError(final ConsoleWriteErrorEvent event)
    {
       view_.consoleWriteError(event.getError());
@@ -38,6 +38,7 @@ import org.rstudio.core.client.widget.ProgressIndicator;
 import org.rstudio.studio.client.common.GlobalDisplay;
 import org.rstudio.studio.client.server.ServerError;
 import org.rstudio.studio.client.server.ServerRequestCallback;
+import org.rstudio.studio.client.workbench.views.environment.model.CsvPreviewColumn;
 import org.rstudio.studio.client.workbench.views.environment.model.DataPreviewResult;
 import org.rstudio.studio.client.workbench.views.environment.model.EnvironmentServerOperations;
 import org.rstudio.studio.client.workbench.views.source.editors.text.IconvListResult;
@@ -198,6 +199,13 @@ public class ImportFileSettingsDialog extends ModalDialog<ImportFileSettingsDial
       updateRequest_.invalidate();
       final Token invalidationToken = updateRequest_.getInvalidationToken();
       progress_.onProgress("Updating preview");
+
+      if (canPreviewNatively())
+      {
+         previewNatively(invalidationToken);
+         return;
+      }
+
       server_.getOutputPreview(
             dataFile_.getPath(),
             encoding_.getValue(encoding_.getSelectedIndex()),
@@ -232,6 +240,52 @@ public class ImportFileSettingsDialog extends ModalDialog<ImportFileSettingsDial
             });
    }
 
+   // the session can parse the file itself (rather than with read.table)
+   // when it's delimited by a single character and quoted the way its
+   // parser expects, and nothing needs converting
+   private boolean canPreviewNatively()
+   {
+      String separator = separator_.getValue(separator_.getSelectedIndex());
+      return separator.length() == 1
+            && equal(quote_.getValue(quote_.getSelectedIndex()), "\"")
+            && equal(decimal_.getValue(decimal_.getSelectedIndex()), ".")
+            && equal(comment_.getValue(comment_.getSelectedIndex()), "")
+            && equal(encoding_.getValue(encoding_.getSelectedIndex()), "unknown");
+   }
+
+   private void previewNatively(final Token invalidationToken)
+   {
+      server_.previewCsvFile(
+            dataFile_.getPath(),
+            separator_.getValue(separator_.getSelectedIndex()),
+            headingYes_.getValue().booleanValue(),
+            MAX_PREVIEW_ROWS,
+            new ServerRequestCallback<JsArray<CsvPreviewColumn>>()
+            {
+               @Override
+               public void onResponseReceived(JsArray<CsvPreviewColumn> columns)
+               {
+                  if (invalidationToken.isInvalid())
+                     return;
+
+                  progress_.onProgress(null);
+                  populateOutput(columns);
+               }
+
+               @Override
+               public void onError(ServerError error)
+               {
+                  if (invalidationToken.isInvalid())
+                     return;
+
+                  progress_.onProgress(null);
+                  globalDisplay_.showErrorMessage(
+                        "Error",
+                        error.getUserMessage());
+               }
+            });
+   }
+
    private void loadData()
    {
       final Token invalidationToken = updateRequest_.getInvalidationToken();
@@ -308,10 +362,7 @@ public class ImportFileSettingsDialog extends ModalDialog<ImportFileSettingsDial
 
       int rows = output.length();
       int cols = names.length();
-      Grid grid = new Grid(rows + 1, cols);
-      grid.setCellPadding(0);
-      grid.setCellSpacing(0);
-      grid.getRowFormatter().addStyleName(0, styles_.header());
+      Grid grid = createOutputGrid(rows, cols);
       for (int col = 0; col < cols; col++)
          grid.setText(0, col, names.get(col));
 
@@ -329,6 +380,41 @@ public class ImportFileSettingsDialog extends ModalDialog<ImportFileSettingsDial
       outputPanel_.setWidget(grid);
    }
 
+   private void populateOutput(JsArray<CsvPreviewColumn> columns)
+   {
+      int cols = columns.length();
+      int rows = cols > 0 ? columns.get(0).getValues().length() : 0;
+      Grid grid = createOutputGrid(rows, cols);
+      for (int col = 0; col < cols; col++)
+      {
+         CsvPreviewColumn column = columns.get(col);
+         grid.setText(0, col, column.getName());
+
+         // as read.table would, show missing values as NA unless the
+         // column is read as character
+         boolean character = equal(column.getType(), "character");
+         JsArrayString values = column.getValues();
+         for (int row = 0; row < rows; row++)
+         {
+            String val = values.get(row);
+            if (!character && (val == null || val.length() == 0))
+               val = "NA";
+            grid.setText(row + 1, col, val);
+         }
+      }
+
+      outputPanel_.setWidget(grid);
+   }
+
+   private Grid createOutputGrid(int rows, int cols)
+   {
+      Grid grid = new Grid(rows + 1, cols);
+      grid.setCellPadding(0);
+      grid.setCellSpacing(0);
+      grid.getRowFormatter().addStyleName(0, styles_.header());
+      return grid;
+   }
+
    private String toInputHtml(DataPreviewResult response)
    {
       String input = response.getInputLines();
@@ -427,4 +513,7 @@ public class ImportFileSettingsDialog extends ModalDialog<ImportFileSettingsDial
    private final Styles styles_;
    
    private static final String autoValue = "Auto";
+
+   // (as many rows as get_output_preview reads)
+   private static final int MAX_PREVIEW_ROWS = 20;
 }
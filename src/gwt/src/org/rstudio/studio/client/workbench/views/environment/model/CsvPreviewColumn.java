@@ -0,0 +1,39 @@
+/*
+ * CsvPreviewColumn.java
+ *
+ * Copyright (C) 2018 by RStudio, Inc.
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+package org.rstudio.studio.client.workbench.views.environment.model;
+
+import com.google.gwt.core.client.JavaScriptObject;
+import com.google.gwt.core.client.JsArrayString;
+
+// a column of a delimited file as previewed by the session (without R)
+public class CsvPreviewColumn extends JavaScriptObject
+{
+   protected CsvPreviewColumn()
+   {
+   }
+
+   public final native String getName() /*-{
+      return this.name;
+   }-*/;
+
+   // the guessed type: logical, integer, double or character
+   public final native String getType() /*-{
+      return this.type;
+   }-*/;
+
+   public final native JsArrayString getValues() /*-{
+      return this.values;
+   }-*/;
+}
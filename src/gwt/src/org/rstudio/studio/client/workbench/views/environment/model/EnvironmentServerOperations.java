@@ -48,6 +48,13 @@ public interface EnvironmentServerOperations
            String comment,
            ServerRequestCallback<DataPreviewResult> requestCallback);
 
+   void previewCsvFile(
+           String dataFilePath,
+           String separator,
+           boolean heading,
+           int maxRows,
+           ServerRequestCallback<JsArray<CsvPreviewColumn>> requestCallback);
+
    void setContextDepth(int newContextDepth,
                         ServerRequestCallback<Void> requestCallback);   
    
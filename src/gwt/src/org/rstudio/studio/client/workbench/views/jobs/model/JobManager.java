@@ -113,7 +113,10 @@ public class JobManager implements JobRefreshEvent.Handler,
             break;
 
          case JobConstants.JOB_UPDATED:
-            state_.updateJob(job);
+            // updates only carry the fields that have changed; hand the
+            // complete job on to the other listeners (we're an eager
+            // singleton, so we see the event first)
+            event.getData().job = state_.mergeJob(job);
             break;
             
          default:
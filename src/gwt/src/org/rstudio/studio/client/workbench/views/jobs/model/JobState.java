@@ -39,6 +39,20 @@ public class JobState extends JsObject
       updateJob(job);
    }
    
+   // applies an update (which only carries the fields that have changed)
+   // to the job, returning the updated job
+   public final Job mergeJob(Job update)
+   {
+      Job job = getJob(update.id);
+      if (job == null)
+      {
+         updateJob(update);
+         return update;
+      }
+      mergeFields(job, update);
+      return job;
+   }
+   
    public final void removeJob(Job job)
    {
       unset(job.id);
@@ -61,6 +75,14 @@ public class JobState extends JsObject
       job.received = timestamp;     
    }
 
+   private final static native void mergeFields(Job job, Job update) /*-{
+      for (var key in update)
+      {
+         if (update.hasOwnProperty(key))
+            job[key] = update[key];
+      }
+   }-*/;
+
    public final static JobState create()
    {
       return (JobState)JsObject.createJsObject();
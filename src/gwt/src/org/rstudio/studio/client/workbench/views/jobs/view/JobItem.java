@@ -142,6 +142,7 @@ public class JobItem extends Composite
       switch(job.state)
       {
          case JobConstants.STATE_IDLE:
+         case JobConstants.STATE_QUEUED:
             state_.setResource(new ImageResource2x(RESOURCES.jobIdle()));
             break;
          case JobConstants.STATE_RUNNING:
@@ -173,6 +174,11 @@ public class JobItem extends Composite
          elapsed_.setText("Waiting");
          return;
       }
+      else if (job_.state == JobConstants.STATE_QUEUED)
+      {
+         elapsed_.setText("Queued");
+         return;
+      }
       
       // only use timestamp if job is still running
       int delta = 0;
@@ -86,6 +86,7 @@ import org.rstudio.studio.client.workbench.views.packages.ui.CleanUnusedDialog;
 import java.util.ArrayList;
 import java.util.Collections;
 import java.util.Comparator;
+import java.util.HashSet;
 import java.util.LinkedHashMap;
 import java.util.List;
 import java.util.Set;
@@ -733,7 +734,9 @@ public class Packages
       
       // if the event contains embedded state, apply it directly; if it doesn't,
       // fetch the new state from the server.
-      if (newState != null)
+      if (newState != null && newState.hasPackageDelta())
+         applyPackageDelta(newState);
+      else if (newState != null)
          setPackageState(newState);
       else
          updatePackageState(false, false);
@@ -1149,11 +1152,48 @@ public class Packages
 
    private void setPackageState(PackageState newState)
    {
-      // sort the packages
       allPackages_ = new ArrayList<PackageInfo>();
       JsArray<PackageInfo> serverPackages = newState.getPackageList();
       for (int i = 0; i < serverPackages.length(); i++)
          allPackages_.add(serverPackages.get(i));
+      setPackageList(newState.getPackratContext());
+   }
+   
+   private void applyPackageDelta(PackageState newState)
+   {
+      // drop the packages which were removed or have been replaced
+      JsArray<PackageInfo> updated = newState.getUpdatedPackages();
+      JsArray<PackageInfo> removed = newState.getRemovedPackages();
+      Set<String> changed = new HashSet<String>();
+      for (int i = 0; i < updated.length(); i++)
+         changed.add(packageKey(updated.get(i)));
+      for (int i = 0; i < removed.length(); i++)
+         changed.add(packageKey(removed.get(i)));
+      
+      ArrayList<PackageInfo> packages = new ArrayList<PackageInfo>();
+      for (PackageInfo pkgInfo : allPackages_)
+      {
+         if (!changed.contains(packageKey(pkgInfo)))
+         {
+            pkgInfo.setFirstInLibrary(false);
+            packages.add(pkgInfo);
+         }
+      }
+      for (int i = 0; i < updated.length(); i++)
+         packages.add(updated.get(i));
+      
+      allPackages_ = packages;
+      setPackageList(newState.getPackratContext());
+   }
+   
+   private static String packageKey(PackageInfo pkgInfo)
+   {
+      return pkgInfo.getLibraryAbsolute() + "/" + pkgInfo.getName();
+   }
+   
+   private void setPackageList(PackratContext packratContext)
+   {
+      // sort the packages
       Collections.sort(allPackages_, new Comparator<PackageInfo>() {
          public int compare(PackageInfo o1, PackageInfo o2)
          {
@@ -1183,7 +1223,7 @@ public class Packages
          }
       }
       
-      packratContext_ = newState.getPackratContext();
+      packratContext_ = packratContext;
       view_.setProgress(false);
       setViewPackageList();
    }
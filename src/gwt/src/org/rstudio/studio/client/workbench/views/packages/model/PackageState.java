@@ -29,6 +29,22 @@ public class PackageState extends JavaScriptObject
       return this.package_list;
    }-*/;
    
+   // present (in place of the package list) when the state only contains
+   // the packages which changed since the state was last sent
+   public final native boolean hasPackageDelta() /*-{
+      return typeof this.package_delta !== "undefined";
+   }-*/;
+   
+   // packages which were added or changed
+   public final native JsArray<PackageInfo> getUpdatedPackages() /*-{
+      return this.package_delta.updated;
+   }-*/;
+   
+   // packages which were removed (only their name and library are set)
+   public final native JsArray<PackageInfo> getRemovedPackages() /*-{
+      return this.package_delta.removed;
+   }-*/;
+   
    public final native PackratContext getPackratContext() /*-{
       return this.packrat_context;
    }-*/;
@@ -2608,6 +2608,8 @@ public class Source implements InsertSourceHandler,
          docType = FileTypeRegistry.R;
       else if (event.getType() == NewDocumentWithCodeEvent.SQL)
          docType = FileTypeRegistry.SQL;
+      else if (event.getType() == NewDocumentWithCodeEvent.TEXT)
+         docType = FileTypeRegistry.TEXT;
       else
          docType = FileTypeRegistry.RMARKDOWN;
       
@@ -2651,7 +2653,8 @@ public class Source implements InsertSourceHandler,
       };
      
       // do it
-      if (docType.equals(FileTypeRegistry.R))
+      if (docType.equals(FileTypeRegistry.R) ||
+          docType.equals(FileTypeRegistry.TEXT))
       {
          newDocCommand.execute();
       }
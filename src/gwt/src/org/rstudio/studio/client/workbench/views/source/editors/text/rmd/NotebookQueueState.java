@@ -323,12 +323,21 @@ public class NotebookQueueState implements NotebookRangeExecutedEvent.Handler,
 
       case NotebookDocQueue.CHUNK_EXEC_FINISHED:
 
+         // usually the executing unit has finished, but chunks which run
+         // alongside the queue (in child processes) can finish at any time
+         NotebookQueueUnit finishedUnit = null;
          if (executingUnit_ != null && 
              executingUnit_.getChunkId() == event.getChunkId())
+            finishedUnit = executingUnit_;
+         else
+            finishedUnit = getUnit(event.getChunkId());
+
+         if (finishedUnit != null)
          {
-            queue_.removeUnit(executingUnit_);
-            queue_.addCompletedUnit(executingUnit_);
-            executingUnit_ = null;
+            queue_.removeUnit(finishedUnit);
+            queue_.addCompletedUnit(finishedUnit);
+            if (finishedUnit == executingUnit_)
+               executingUnit_ = null;
             
             // if there are no more units, clean up the queue so we get a clean
             // slate on the next execution
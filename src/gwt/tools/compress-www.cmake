@@ -0,0 +1,49 @@
+#
+# compress-www.cmake
+#
+# Copyright (C) 2018 by RStudio, Inc.
+#
+# Unless you have received this program directly from RStudio pursuant
+# to the terms of a commercial license agreement with RStudio, then
+# this program is licensed to you under the terms of version 3 of the
+# GNU Affero General Public License. This program is distributed WITHOUT
+# ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+# MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+# AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+#
+#
+
+# writes a .gz sibling next to each compressible static asset in WWW_DIR so
+# that Response::setStaticFile can send it directly instead of compressing
+# the asset on every request. usage:
+#
+#    cmake -DWWW_DIR=<installed www dir> -P compress-www.cmake
+
+if(NOT IS_DIRECTORY "${WWW_DIR}")
+   message(FATAL_ERROR "WWW_DIR '${WWW_DIR}' is not a directory")
+endif()
+
+find_program(GZIP_EXECUTABLE gzip)
+if(NOT GZIP_EXECUTABLE)
+   message(STATUS "gzip not found; static assets will be compressed on request")
+   return()
+endif()
+
+file(GLOB_RECURSE WWW_ASSETS
+   "${WWW_DIR}/*.js"
+   "${WWW_DIR}/*.css"
+   "${WWW_DIR}/*.html"
+   "${WWW_DIR}/*.svg"
+   "${WWW_DIR}/*.json"
+   "${WWW_DIR}/*.xml"
+   "${WWW_DIR}/*.txt")
+
+foreach(ASSET ${WWW_ASSETS})
+   execute_process(COMMAND "${GZIP_EXECUTABLE}" -9 -n -c "${ASSET}"
+                   OUTPUT_FILE "${ASSET}.gz"
+                   RESULT_VARIABLE GZIP_RESULT)
+   if(NOT GZIP_RESULT EQUAL 0)
+      message(WARNING "Failed to compress ${ASSET}")
+      file(REMOVE "${ASSET}.gz")
+   endif()
+endforeach()